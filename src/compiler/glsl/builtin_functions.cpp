@@ -60,6 +60,8 @@
 #include "ir_builder.h"
 #include "glsl_parser_extras.h"
 #include "program/prog_instruction.h"
+#include "util/hash_table.h"
+#include "util/set.h"
 #include <math.h>
 
 #define M_PIf   ((float) M_PI)
@@ -544,6 +546,7 @@ public:
    void release();
    ir_function_signature *find(_mesa_glsl_parse_state *state,
                                const char *name, exec_list *actual_parameters);
+   ir_function *get_function(const char *name);
 
    /**
     * A shader to hold all the built-in signatures; created by this module.
@@ -551,12 +554,31 @@ public:
     * This includes signatures for every built-in, regardless of version or
     * enabled extensions.  The availability predicate associated with each
     * signature allows matching_signature() to filter out the irrelevant ones.
+    *
+    * The intrinsics are created up front, but the built-ins are only added
+    * when get_function() first looks them up.
     */
    gl_shader *shader;
 
 private:
    void *mem_ctx;
 
+   /**
+    * What add_function() and add_image_function() do with the functions
+    * they are given during create_builtins().
+    */
+   enum {
+      CREATE_ALL,     /**< Create every function. */
+      COLLECT_NAMES,  /**< Only record the names in \c builtin_names. */
+      CREATE_ONE,     /**< Create the function named \c requested_name. */
+   } create_mode;
+
+   /** Names of the built-ins that haven't been created yet. */
+   struct set *builtin_names;
+   const char *requested_name;
+
+   bool wants_function(const char *name);
+
    /** Global variables used by built-in functions. */
    ir_variable *gl_ModelViewProjectionMatrix;
    ir_variable *gl_Vertex;
@@ -876,6 +898,9 @@ enum image_function_flags {
  */
 builtin_builder::builtin_builder()
    : shader(NULL),
+     create_mode(CREATE_ALL),
+     builtin_names(NULL),
+     requested_name(NULL),
      gl_ModelViewProjectionMatrix(NULL),
      gl_Vertex(NULL)
 {
@@ -900,7 +925,7 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
     */
    state->uses_builtin_functions = true;
 
-   ir_function *f = shader->symbols->get_function(name);
+   ir_function *f = get_function(name);
    if (f == NULL)
       return NULL;
 
@@ -921,7 +946,17 @@ builtin_builder::initialize()
 
    mem_ctx = ralloc_context(NULL);
    create_shader();
+
+   create_mode = CREATE_ALL;
    create_intrinsics();
+
+   /* Building the IR for the whole built-in catalogue is expensive, and
+    * most programs only use a handful of functions.  Just remember which
+    * names exist, get_function() creates them on first use.
+    */
+   builtin_names = _mesa_set_create(mem_ctx, _mesa_key_hash_string,
+                                    _mesa_key_string_equal);
+   create_mode = COLLECT_NAMES;
    create_builtins();
 }
 
@@ -930,11 +965,55 @@ builtin_builder::release()
 {
    ralloc_free(mem_ctx);
    mem_ctx = NULL;
+   builtin_names = NULL;
 
    ralloc_free(shader);
    shader = NULL;
 }
 
+/**
+ * Look up a built-in function or intrinsic, creating it if needed.
+ */
+ir_function *
+builtin_builder::get_function(const char *name)
+{
+   ir_function *f = shader->symbols->get_function(name);
+   if (f != NULL)
+      return f;
+
+   struct set_entry *entry = _mesa_set_search(builtin_names, name);
+   if (entry == NULL)
+      return NULL;
+
+   _mesa_set_remove(builtin_names, entry);
+
+   /* Walking the list is cheap compared to building the signatures, which
+    * only happens for the requested name.
+    */
+   create_mode = CREATE_ONE;
+   requested_name = name;
+   create_builtins();
+   requested_name = NULL;
+
+   return shader->symbols->get_function(name);
+}
+
+bool
+builtin_builder::wants_function(const char *name)
+{
+   switch (create_mode) {
+   case CREATE_ALL:
+      return true;
+   case COLLECT_NAMES:
+      _mesa_set_add(builtin_names, name);
+      return false;
+   case CREATE_ONE:
+      return strcmp(name, requested_name) == 0;
+   }
+
+   return false;
+}
+
 void
 builtin_builder::create_shader()
 {
@@ -1070,6 +1149,15 @@ builtin_builder::create_intrinsics()
 void
 builtin_builder::create_builtins()
 {
+   /* Skip the signature constructors of the functions that aren't wanted,
+    * see builtin_builder::get_function().
+    */
+#define add_function(NAME, ...)                 \
+   do {                                         \
+      if (wants_function(NAME))                 \
+         add_function(NAME, __VA_ARGS__);       \
+   } while (0)
+
 #define F(NAME)                                 \
    add_function(#NAME,                          \
                 _##NAME(glsl_type::float_type), \
@@ -2927,6 +3015,7 @@ builtin_builder::create_builtins()
 #undef FIUD
 #undef FIUBD
 #undef FIU2_MIXED
+#undef add_function
 }
 
 void
@@ -2962,6 +3051,9 @@ builtin_builder::add_image_function(const char *name,
                                     unsigned num_arguments,
                                     unsigned flags)
 {
+   if (!wants_function(name))
+      return;
+
    static const glsl_type *const types[] = {
       glsl_type::image1D_type,
       glsl_type::image2D_type,
@@ -5607,7 +5699,7 @@ _mesa_glsl_find_builtin_function_by_name(const char *name)
 {
    ir_function *f;
    mtx_lock(&builtins_lock);
-   f = builtins.shader->symbols->get_function(name);
+   f = builtins.get_function(name);
    mtx_unlock(&builtins_lock);
    return f;
 }
@@ -293,6 +293,7 @@ control_line_success:
 		if (macro) {
 			hash_table_remove (parser->defines, $3);
 			ralloc_free (macro);
+			parser->defines_generation++;
 		}
 		ralloc_free ($3);
 	}
@@ -1002,6 +1003,34 @@ _token_list_copy (void *ctx, token_list_t *other)
 	return copy;
 }
 
+/* Like _token_list_copy, but the copy also owns its strings rather than
+ * sharing them with 'other'. */
+static token_list_t *
+_token_list_copy_deep (void *ctx, token_list_t *other)
+{
+	token_list_t *copy;
+	token_node_t *node;
+
+	copy = _token_list_copy (ctx, other);
+	if (copy == NULL)
+		return NULL;
+
+	for (node = copy->head; node; node = node->next) {
+		token_t *token = node->token;
+
+		switch (token->type) {
+		case IDENTIFIER:
+		case INTEGER_STRING:
+		case OTHER:
+			token->value.str = ralloc_strdup (token,
+							  token->value.str);
+			break;
+		}
+	}
+
+	return copy;
+}
+
 static void
 _token_list_trim_trailing_space (token_list_t *list)
 {
@@ -1366,6 +1395,10 @@ glcpp_parser_create (const struct gl_extensions *extensions, gl_api api)
 	parser->has_new_source_number = 0;
 	parser->new_source_number = 0;
 
+	parser->expansion_cache = NULL;
+	parser->defines_generation = 0;
+	parser->expanded_line_or_file = false;
+
 	return parser;
 }
 
@@ -1374,6 +1407,8 @@ glcpp_parser_destroy (glcpp_parser_t *parser)
 {
 	glcpp_lex_destroy (parser->scanner);
 	hash_table_dtor (parser->defines);
+	if (parser->expansion_cache)
+		hash_table_dtor (parser->expansion_cache);
 	ralloc_free (parser);
 }
 
@@ -1683,6 +1718,55 @@ _glcpp_parser_apply_pastes (glcpp_parser_t *parser, token_list_t *list)
 	list->non_space_tail = list->tail;
 }
 
+typedef struct expansion_cache_entry {
+	/* Value of parser->defines_generation when the entry was made. */
+	unsigned generation;
+	token_list_t *expansion;
+} expansion_cache_entry_t;
+
+/* Build the key under which the expansion of the function-like macro
+ * 'identifier' applied to 'arguments' is cached. */
+static char *
+_expansion_cache_key (void *ctx, const char *identifier,
+		      argument_list_t *arguments, expansion_mode_t mode)
+{
+	argument_node_t *arg;
+	token_node_t *node;
+	size_t len = 0;
+	char *key;
+
+	key = ralloc_strdup (ctx, "");
+	ralloc_asprintf_rewrite_tail (&key, &len, "%d %s", mode, identifier);
+
+	for (arg = arguments->head; arg; arg = arg->next) {
+		ralloc_asprintf_rewrite_tail (&key, &len, ",");
+
+		for (node = arg->argument->head; node; node = node->next) {
+			token_t *token = node->token;
+
+			ralloc_asprintf_rewrite_tail (&key, &len, " %d",
+						      token->type);
+
+			switch (token->type) {
+			case INTEGER:
+				ralloc_asprintf_rewrite_tail (&key, &len,
+							      ":%" PRIiMAX,
+							      token->value.ival);
+				break;
+			case IDENTIFIER:
+			case INTEGER_STRING:
+			case OTHER:
+				ralloc_asprintf_rewrite_tail (&key, &len,
+							      ":%s",
+							      token->value.str);
+				break;
+			}
+		}
+	}
+
+	return key;
+}
+
 /* This is a helper function that's essentially part of the
  * implementation of _glcpp_parser_expand_node. It shouldn't be called
  * except for by that function.
@@ -1715,6 +1799,10 @@ _glcpp_parser_expand_function (glcpp_parser_t *parser,
 	function_status_t status;
 	token_list_t *substituted;
 	int parameter_index;
+	char *cache_key = NULL;
+	size_t info_log_length;
+	bool expanded_line_or_file;
+	expansion_cache_entry_t *entry = NULL;
 
 	identifier = node->token->value.str;
 
@@ -1755,6 +1843,33 @@ _glcpp_parser_expand_function (glcpp_parser_t *parser,
 		return NULL;
 	}
 
+	/* Generated shaders tend to apply the same macros to the same
+	 * arguments over and over again.  Unless we are in the middle of
+	 * another expansion, which affects how the arguments get expanded,
+	 * the result of the substitution below only depends on the
+	 * arguments and the set of defined macros, so it can be reused. */
+	if (parser->active == NULL) {
+		if (parser->expansion_cache == NULL) {
+			parser->expansion_cache =
+				hash_table_ctor (512, hash_table_string_hash,
+						 hash_table_string_compare);
+		}
+
+		cache_key = _expansion_cache_key (parser, identifier,
+						  arguments, mode);
+		entry = hash_table_find (parser->expansion_cache, cache_key);
+		if (entry &&
+		    entry->generation == parser->defines_generation) {
+			ralloc_free (cache_key);
+			ralloc_free (arguments);
+			return _token_list_copy (parser, entry->expansion);
+		}
+	}
+
+	info_log_length = parser->info_log_length;
+	expanded_line_or_file = parser->expanded_line_or_file;
+	parser->expanded_line_or_file = false;
+
 	/* Perform argument substitution on the replacement list. */
 	substituted = _token_list_create (arguments);
 
@@ -1800,6 +1915,32 @@ _glcpp_parser_expand_function (glcpp_parser_t *parser,
 
 	_glcpp_parser_apply_pastes (parser, substituted);
 
+	/* Don't cache anything that depends on the location of the
+	 * invocation or that produced diagnostics. */
+	if (cache_key &&
+	    (parser->expanded_line_or_file ||
+	     parser->info_log_length != info_log_length)) {
+		ralloc_free (cache_key);
+		cache_key = NULL;
+	}
+
+	parser->expanded_line_or_file |= expanded_line_or_file;
+
+	if (cache_key) {
+		if (entry == NULL) {
+			entry = ralloc (parser, expansion_cache_entry_t);
+			ralloc_steal (entry, cache_key);
+			hash_table_insert (parser->expansion_cache, entry,
+					   cache_key);
+		} else {
+			ralloc_free (cache_key);
+			ralloc_free (entry->expansion);
+		}
+
+		entry->generation = parser->defines_generation;
+		entry->expansion = _token_list_copy_deep (entry, substituted);
+	}
+
 	return substituted;
 }
 
@@ -1841,11 +1982,15 @@ _glcpp_parser_expand_node (glcpp_parser_t *parser,
 
 	/* Special handling for __LINE__ and __FILE__, (not through
 	 * the hash table). */
-	if (strcmp(identifier, "__LINE__") == 0)
+	if (strcmp(identifier, "__LINE__") == 0) {
+		parser->expanded_line_or_file = true;
 		return _token_list_create_with_one_integer (parser, node->token->location.first_line);
+	}
 
-	if (strcmp(identifier, "__FILE__") == 0)
+	if (strcmp(identifier, "__FILE__") == 0) {
+		parser->expanded_line_or_file = true;
 		return _token_list_create_with_one_integer (parser, node->token->location.source);
+	}
 
 	/* Look up this identifier in the hash table. */
 	macro = hash_table_find (parser->defines, identifier);
@@ -2138,6 +2283,7 @@ _define_object_macro (glcpp_parser_t *parser,
 	}
 
 	hash_table_insert (parser->defines, macro, identifier);
+	parser->defines_generation++;
 }
 
 void
@@ -2177,6 +2323,7 @@ _define_function_macro (glcpp_parser_t *parser,
 	}
 
 	hash_table_insert (parser->defines, macro, identifier);
+	parser->defines_generation++;
 }
 
 static int
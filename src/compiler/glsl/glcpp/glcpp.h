@@ -202,6 +202,14 @@ struct glcpp_parser {
 	bool has_new_source_number;
 	int new_source_number;
 	bool is_gles;
+
+	/* Results of function-like macro argument substitution, see
+	 * _glcpp_parser_expand_function(). */
+	struct hash_table *expansion_cache;
+	/* Incremented whenever a macro is defined or undefined. */
+	unsigned defines_generation;
+	/* Set when __LINE__ or __FILE__ gets expanded. */
+	bool expanded_line_or_file;
 };
 
 struct gl_extensions;
@@ -222,6 +230,9 @@ int
 glcpp_preprocess(void *ralloc_ctx, const char **shader, char **info_log,
 	   const struct gl_extensions *extensions, struct gl_context *g_ctx);
 
+bool
+glcpp_shader_needs_no_preprocessing(const char *shader);
+
 /* Functions for writing to the info log */
 
 void
@@ -211,6 +211,50 @@ remove_line_continuations(glcpp_parser_t *ctx, const char *shader)
 	return clean;
 }
 
+/* Return true if preprocessing the shader would not change anything the
+ * GLSL lexer cares about, that is if it has no directives, comments, line
+ * continuations or references to any of the pre-defined macros.  The
+ * preprocessor would still collapse whitespace.
+ *
+ * Shaders using anything but "\n" or "\r\n" as newline also go through
+ * the preprocessor, which normalizes them.
+ */
+bool
+glcpp_shader_needs_no_preprocessing(const char *shader)
+{
+	const char *c;
+
+	for (c = shader; *c != '\0'; c++) {
+		switch (*c) {
+		case '#':
+		case '\\':
+		case '\v':
+		case '\f':
+			return false;
+		case '\r':
+			if (c[1] != '\n')
+				return false;
+			break;
+		case '/':
+			if (c[1] == '/' || c[1] == '*')
+				return false;
+			break;
+		case '_':
+			/* __LINE__, __FILE__, __VERSION__ */
+			if (c[1] == '_')
+				return false;
+			break;
+		case 'G':
+			/* GL_ES, GL_ARB_..., ... */
+			if (c[1] == 'L' && c[2] == '_')
+				return false;
+			break;
+		}
+	}
+
+	return true;
+}
+
 int
 glcpp_preprocess(void *ralloc_ctx, const char **shader, char **info_log,
 	   const struct gl_extensions *extensions, struct gl_context *gl_ctx)
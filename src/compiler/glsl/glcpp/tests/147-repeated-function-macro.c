@@ -0,0 +1,8 @@
+#define f(x) (x + 1)
+f(a) f(a)
+#undef f
+#define f(x) (x - 1)
+f(a)
+#define line(x) x
+line(__LINE__) line(__LINE__)
+line(__LINE__)
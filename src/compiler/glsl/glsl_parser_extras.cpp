@@ -24,6 +24,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 #include "main/core.h" /* for struct gl_context */
 #include "main/context.h"
@@ -31,11 +32,13 @@
 #include "main/shaderobj.h"
 #include "util/u_atomic.h" /* for p_atomic_cmpxchg */
 #include "util/ralloc.h"
+#include "util/debug.h"
 #include "ast.h"
 #include "glsl_parser_extras.h"
 #include "glsl_parser.h"
 #include "ir_optimization.h"
 #include "loop_analysis.h"
+#include "program.h"
 
 /**
  * Format a short human-readable description of the given GLSL version.
@@ -62,6 +65,7 @@ _mesa_glsl_parse_state::_mesa_glsl_parse_state(struct gl_context *_ctx,
    this->stage = stage;
 
    this->scanner = NULL;
+   this->linalloc = linear_context(this);
    this->translation_unit.make_empty();
    this->symbols = new(mem_ctx) glsl_symbol_table;
 
@@ -1548,19 +1552,22 @@ ast_struct_specifier::print(void) const
 }
 
 
-ast_struct_specifier::ast_struct_specifier(const char *identifier,
+ast_struct_specifier::ast_struct_specifier(linear_ctx *lin_ctx,
+                                           const char *identifier,
 					   ast_declarator_list *declarator_list)
 {
    if (identifier == NULL) {
       static mtx_t mutex = _MTX_INITIALIZER_NP;
       static unsigned anon_count = 1;
       unsigned count;
+      char anon_name[32];
 
       mtx_lock(&mutex);
       count = anon_count++;
       mtx_unlock(&mutex);
 
-      identifier = ralloc_asprintf(this, "#anon_struct_%04x", count);
+      snprintf(anon_name, sizeof(anon_name), "#anon_struct_%04x", count);
+      identifier = linear_strdup(lin_ctx, anon_name);
    }
    name = identifier;
    this->declarations.push_degenerate_list_at_head(&declarator_list->link);
@@ -1707,28 +1714,93 @@ set_shader_inout_layout(struct gl_shader *shader,
    }
 }
 
+static int64_t
+get_time_ns(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_nsec + tv.tv_sec * INT64_C(1000000000);
+#else
+   return (int64_t) clock() * (INT64_C(1000000000) / CLOCKS_PER_SEC);
+#endif
+}
+
+static void
+count_ir_instruction(ir_instruction *ir, void *data)
+{
+   (void) ir;
+   (*(unsigned *) data)++;
+}
+
 extern "C" {
 
+/**
+ * Count the IR instructions in \p ir, including the ones nested inside
+ * functions and control flow.
+ */
+unsigned
+_mesa_glsl_count_ir_instructions(struct exec_list *ir)
+{
+   unsigned count = 0;
+
+   foreach_in_list(ir_instruction, node, ir)
+      visit_tree(node, count_ir_instruction, &count);
+
+   return count;
+}
+
 void
 _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
                           bool dump_ast, bool dump_hir)
+{
+   _mesa_glsl_compile_shader_with_stats(ctx, shader, dump_ast, dump_hir, NULL);
+}
+
+/**
+ * Compile \p shader like _mesa_glsl_compile_shader(), additionally
+ * recording the time spent in each phase in \p stats if it isn't NULL.
+ */
+void
+_mesa_glsl_compile_shader_with_stats(struct gl_context *ctx,
+                                     struct gl_shader *shader,
+                                     bool dump_ast, bool dump_hir,
+                                     struct _mesa_glsl_compile_stats *stats)
 {
    struct _mesa_glsl_parse_state *state =
       new(shader) _mesa_glsl_parse_state(ctx, shader->Stage, shader);
    const char *source = shader->Source;
+   int64_t start = stats ? get_time_ns() : 0;
+   int64_t now;
+
+#define PHASE_DONE(field) do {                  \
+      if (stats) {                              \
+         now = get_time_ns();                   \
+         stats->field += now - start;           \
+         start = now;                           \
+      }                                         \
+   } while (false)
 
    if (ctx->Const.GenerateTemporaryNames)
       (void) p_atomic_cmpxchg(&ir_variable::temporaries_allocate_names,
                               false, true);
 
-   state->error = glcpp_preprocess(state, &source, &state->info_log,
-                             &ctx->Extensions, ctx);
+   /* Most of the preprocessor's time is spent tokenizing, which the GLSL
+    * lexer will do once more anyway, so don't bother for shaders that don't
+    * use it.
+    */
+   if (!glcpp_shader_needs_no_preprocessing(source)) {
+      state->error = glcpp_preprocess(state, &source, &state->info_log,
+                                      &ctx->Extensions, ctx);
+   }
+   PHASE_DONE(preprocess_ns);
 
    if (!state->error) {
      _mesa_glsl_lexer_ctor(state, source);
      _mesa_glsl_parse(state);
      _mesa_glsl_lexer_dtor(state);
    }
+   PHASE_DONE(parse_ns);
 
    if (dump_ast) {
       foreach_list_typed(ast_node, ast, link, &state->translation_unit) {
@@ -1741,6 +1813,7 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
    shader->ir = new(shader) exec_list;
    if (!state->error && !state->translation_unit.is_empty())
       _mesa_ast_to_hir(shader->ir, state);
+   PHASE_DONE(ast_to_hir_ns);
 
    if (!state->error) {
       validate_ir_tree(shader->ir);
@@ -1760,8 +1833,9 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
       /* Do some optimization at compile time to reduce shader IR size
        * and reduce later work if the same shader is linked multiple times
        */
+      ir_opt_tracker tracker;
       while (do_common_optimization(shader->ir, false, false, options,
-                                    ctx->Const.NativeIntegers))
+                                    ctx->Const.NativeIntegers, &tracker))
          ;
 
       validate_ir_tree(shader->ir);
@@ -1786,6 +1860,8 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
 
       validate_ir_tree(shader->ir);
    }
+   PHASE_DONE(optimize_ns);
+#undef PHASE_DONE
 
    if (shader->InfoLog)
       ralloc_free(shader->InfoLog);
@@ -1832,6 +1908,9 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
 
    _mesa_glsl_initialize_derived_variables(shader);
 
+   if (stats)
+      stats->ir_instructions += _mesa_glsl_count_ir_instructions(shader->ir);
+
    delete state->symbols;
    ralloc_free(state);
 }
@@ -1855,26 +1934,136 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
  *                                    unrolling.
  * \param options                     The driver's preferred shader options.
  */
+ir_opt_tracker::ir_opt_tracker()
+   : iterations(0), generation(0), num_passes(0)
+{
+   static int opt_timing = -1;
+   if (opt_timing < 0)
+      opt_timing = env_var_as_boolean("MESA_GLSL_OPT_TIMING", false);
+   timing = opt_timing;
+}
+
+ir_opt_tracker::~ir_opt_tracker()
+{
+   if (!timing || iterations == 0)
+      return;
+
+   int64_t total_ns = 0;
+   for (unsigned i = 0; i < num_passes; i++)
+      total_ns += passes[i].time_ns;
+
+   fprintf(stderr, "GLSL optimization: %u iterations, %.3f ms\n",
+           iterations, total_ns / 1000000.0);
+   fprintf(stderr, "   %-36s %6s %6s %8s %10s\n",
+           "pass", "runs", "skips", "progress", "ms");
+   for (unsigned i = 0; i < num_passes; i++) {
+      const pass_info *pass = &passes[i];
+      fprintf(stderr, "   %-36s %6u %6u %8u %10.3f\n",
+              pass->name, pass->runs, pass->skips, pass->progress,
+              pass->time_ns / 1000000.0);
+   }
+}
+
+/**
+ * Look up the bookkeeping for the pass called \p name.
+ *
+ * \return NULL if there is no room left, in which case the pass is run
+ * every time.
+ */
+ir_opt_tracker::pass_info *
+ir_opt_tracker::get_pass(const char *name)
+{
+   for (unsigned i = 0; i < num_passes; i++) {
+      if (passes[i].name == name || strcmp(passes[i].name, name) == 0)
+         return &passes[i];
+   }
+
+   if (num_passes == ARRAY_SIZE(passes))
+      return NULL;
+
+   pass_info *pass = &passes[num_passes++];
+   memset(pass, 0, sizeof(*pass));
+   pass->name = name;
+   pass->clean_generation = ~0u;
+   return pass;
+}
+
+bool
+ir_opt_tracker::should_run(pass_info *pass)
+{
+   if (pass == NULL)
+      return true;
+
+   return pass->clean_generation != generation;
+}
+
+int64_t
+ir_opt_tracker::begin_pass()
+{
+   return timing ? get_time_ns() : 0;
+}
+
+void
+ir_opt_tracker::end_pass(pass_info *pass, bool progress, int64_t start)
+{
+   if (pass == NULL)
+      return;
+
+   pass->runs++;
+   if (timing)
+      pass->time_ns += get_time_ns() - start;
+
+   if (progress) {
+      pass->progress++;
+      generation++;
+   } else {
+      pass->clean_generation = generation;
+   }
+}
+
+/**
+ * Run the common set of optimization passes once over \p ir.
+ *
+ * Callers run this until it stops making progress.  Passing the same
+ * \p tracker to every iteration lets passes that cannot make progress be
+ * skipped.
+ */
 bool
 do_common_optimization(exec_list *ir, bool linked,
 		       bool uniform_locations_assigned,
                        const struct gl_shader_compiler_options *options,
-                       bool native_integers)
+                       bool native_integers,
+                       ir_opt_tracker *tracker)
 {
    const bool debug = false;
    GLboolean progress = GL_FALSE;
 
+   if (tracker)
+      tracker->iterations++;
+
 #define OPT(PASS, ...) do {                                             \
+      ir_opt_tracker::pass_info *pass =                                 \
+         tracker ? tracker->get_pass(#PASS) : NULL;                     \
+      if (tracker && !tracker->should_run(pass)) {                      \
+         pass->skips++;                                                 \
+         break;                                                         \
+      }                                                                 \
+      const int64_t start = tracker ? tracker->begin_pass() : 0;        \
       if (debug) {                                                      \
          fprintf(stderr, "START GLSL optimization %s\n", #PASS);        \
          const bool opt_progress = PASS(__VA_ARGS__);                   \
          progress = opt_progress || progress;                           \
+         if (tracker)                                                   \
+            tracker->end_pass(pass, opt_progress, start);               \
          if (opt_progress)                                              \
             _mesa_print_ir(stderr, ir, NULL);                           \
          fprintf(stderr, "GLSL optimization %s: %s progress\n",         \
                  #PASS, opt_progress ? "made" : "no");                  \
       } else {                                                          \
-         progress = PASS(__VA_ARGS__) || progress;                      \
+         const bool opt_progress = PASS(__VA_ARGS__);                   \
+         progress = opt_progress || progress;                           \
+         if (tracker)                                                   \
+            tracker->end_pass(pass, opt_progress, start);               \
       }                                                                 \
    } while (false)
 
@@ -1923,12 +2112,19 @@ do_common_optimization(exec_list *ir, bool linked,
    OPT(optimize_split_arrays, ir, linked);
    OPT(optimize_redundant_jumps, ir);
 
-   loop_state *ls = analyze_loop_variables(ir);
-   if (ls->loop_found) {
-      OPT(set_loop_controls, ir, ls);
-      OPT(unroll_loops, ir, ls, options);
+   /* The loop analysis is only needed by the loop passes, don't bother if
+    * both of them are going to be skipped.
+    */
+   if (tracker == NULL ||
+       tracker->should_run(tracker->get_pass("set_loop_controls")) ||
+       tracker->should_run(tracker->get_pass("unroll_loops"))) {
+      loop_state *ls = analyze_loop_variables(ir);
+      if (ls->loop_found) {
+         OPT(set_loop_controls, ir, ls);
+         OPT(unroll_loops, ir, ls, options);
+      }
+      delete ls;
    }
-   delete ls;
 
 #undef OPT
 
@@ -275,6 +275,15 @@ struct _mesa_glsl_parse_state {
 
    struct gl_context *const ctx;
    void *scanner;
+
+   /**
+    * Allocator for the AST and the identifiers returned by the lexer.
+    *
+    * Both are only needed until the AST has been converted to IR and are
+    * freed along with the parser state.
+    */
+   linear_ctx *linalloc;
+
    exec_list translation_unit;
    glsl_symbol_table *symbols;
 
@@ -749,6 +758,8 @@ extern "C" {
 extern int glcpp_preprocess(void *ctx, const char **shader, char **info_log,
                       const struct gl_extensions *extensions, struct gl_context *gl_ctx);
 
+extern bool glcpp_shader_needs_no_preprocessing(const char *shader);
+
 extern void _mesa_destroy_shader_compiler(void);
 extern void _mesa_destroy_shader_compiler_caches(void);
 
@@ -251,7 +251,15 @@ ir_function *glsl_symbol_table::get_function(const char *name)
 
 int glsl_symbol_table::get_default_precision_qualifier(const char *type_name)
 {
-   char *name = ralloc_asprintf(mem_ctx, "#default_precision_%s", type_name);
+   /* This is looked up for every declaration in GLSL ES, don't leave a copy
+    * of the name behind every time.  Only built-in types can have a default
+    * precision, so the name is short.
+    */
+   char name[64];
+   int len = snprintf(name, sizeof(name), "#default_precision_%s", type_name);
+   assert(len < (int) sizeof(name));
+   (void) len;
+
    symbol_table_entry *entry = get_entry(name);
    if (!entry)
       return ast_precision_none;
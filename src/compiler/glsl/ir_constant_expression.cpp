@@ -470,6 +470,72 @@ constant_referenced(const ir_dereference *deref,
 }
 
 
+/**
+ * Like rv->constant_expression_value(), except that for constant variables,
+ * and for array elements and record fields of them, the stored constant is
+ * returned instead of a copy.
+ *
+ * Reading one element of a large constant array would otherwise copy the
+ * whole array every time.  The result may be shared with the IR, so callers
+ * must copy whatever they return and must not modify it.
+ */
+static ir_constant *
+constant_value_no_copy(ir_rvalue *rv, struct hash_table *variable_context)
+{
+   switch (rv->ir_type) {
+   case ir_type_constant:
+      return (ir_constant *) rv;
+
+   case ir_type_dereference_variable: {
+      ir_variable *const var = ((ir_dereference_variable *) rv)->var;
+
+      if (variable_context) {
+         ir_constant *value =
+            (ir_constant *) hash_table_find(variable_context, var);
+         if (value)
+            return value;
+      }
+
+      /* See ir_dereference_variable::constant_expression_value(). */
+      if (var->data.mode == ir_var_uniform)
+         return NULL;
+
+      return var->constant_value;
+   }
+
+   case ir_type_dereference_array: {
+      ir_dereference_array *const da = (ir_dereference_array *) rv;
+
+      if (!da->array->type->is_array())
+         break;
+
+      ir_constant *array = constant_value_no_copy(da->array, variable_context);
+      if (array == NULL)
+         return NULL;
+
+      ir_constant *idx =
+         da->array_index->constant_expression_value(variable_context);
+      if (idx == NULL)
+         return NULL;
+
+      return array->get_array_element(idx->value.u[0]);
+   }
+
+   case ir_type_dereference_record: {
+      ir_dereference_record *const dr = (ir_dereference_record *) rv;
+      ir_constant *record = constant_value_no_copy(dr->record, NULL);
+
+      return (record != NULL) ? record->get_record_field(dr->field) : NULL;
+   }
+
+   default:
+      break;
+   }
+
+   return rv->constant_expression_value(variable_context);
+}
+
+
 ir_constant *
 ir_rvalue::constant_expression_value(struct hash_table *)
 {
@@ -1777,7 +1843,7 @@ ir_texture::constant_expression_value(struct hash_table *)
 ir_constant *
 ir_swizzle::constant_expression_value(struct hash_table *variable_context)
 {
-   ir_constant *v = this->val->constant_expression_value(variable_context);
+   ir_constant *v = constant_value_no_copy(this->val, variable_context);
 
    if (v != NULL) {
       ir_constant_data data = { { 0 } };
@@ -1832,7 +1898,7 @@ ir_dereference_variable::constant_expression_value(struct hash_table *variable_c
 ir_constant *
 ir_dereference_array::constant_expression_value(struct hash_table *variable_context)
 {
-   ir_constant *array = this->array->constant_expression_value(variable_context);
+   ir_constant *array = constant_value_no_copy(this->array, variable_context);
    ir_constant *idx = this->array_index->constant_expression_value(variable_context);
 
    if ((array != NULL) && (idx != NULL)) {
@@ -1893,9 +1959,12 @@ ir_dereference_array::constant_expression_value(struct hash_table *variable_cont
 ir_constant *
 ir_dereference_record::constant_expression_value(struct hash_table *)
 {
-   ir_constant *v = this->record->constant_expression_value();
+   ir_constant *v = constant_value_no_copy(this->record, NULL);
+   if (v == NULL)
+      return NULL;
 
-   return (v != NULL) ? v->get_record_field(this->field) : NULL;
+   ir_constant *field = v->get_record_field(this->field);
+   return (field != NULL) ? field->clone(ralloc_parent(this), NULL) : NULL;
 }
 
 
@@ -68,10 +68,61 @@ enum lower_packing_builtins_op {
    LOWER_PACK_USE_BFE                   = 0x0800,
 };
 
+/**
+ * State kept across the iterations of a do_common_optimization() loop.
+ *
+ * A pass that made no progress cannot make any until another pass changes
+ * the IR, so the tracker records the last time each pass came up empty and
+ * lets do_common_optimization() skip it while nothing else has happened.
+ * Code running other passes inside the loop must call invalidate() when
+ * they make progress.
+ *
+ * With MESA_GLSL_OPT_TIMING set, the time spent in each pass is printed to
+ * stderr when the tracker is destroyed.
+ */
+class ir_opt_tracker {
+public:
+   ir_opt_tracker();
+   ~ir_opt_tracker();
+
+   /** Note a change of the IR made outside of do_common_optimization(). */
+   void invalidate()
+   {
+      generation++;
+   }
+
+   struct pass_info {
+      const char *name;
+
+      /** Value of ::generation when the pass last made no progress */
+      unsigned clean_generation;
+
+      unsigned runs;
+      unsigned skips;
+      unsigned progress;
+      int64_t time_ns;
+   };
+
+   pass_info *get_pass(const char *name);
+   bool should_run(pass_info *pass);
+   int64_t begin_pass();
+   void end_pass(pass_info *pass, bool progress, int64_t start);
+
+   unsigned iterations;
+
+private:
+   unsigned generation;
+   bool timing;
+
+   unsigned num_passes;
+   pass_info passes[40];
+};
+
 bool do_common_optimization(exec_list *ir, bool linked,
 			    bool uniform_locations_assigned,
                             const struct gl_shader_compiler_options *options,
-                            bool native_integers);
+                            bool native_integers,
+                            ir_opt_tracker *tracker = NULL);
 
 bool do_rebalance_tree(exec_list *instructions);
 bool do_algebraic(exec_list *instructions, bool native_integers,
@@ -125,7 +176,8 @@ void lower_ubo_reference(struct gl_shader *shader);
 void lower_packed_varyings(void *mem_ctx,
                            unsigned locations_used, ir_variable_mode mode,
                            unsigned gs_input_vertices, gl_shader *shader,
-                           bool disable_varying_packing, bool xfb_enabled);
+                           bool disable_varying_packing, bool xfb_enabled,
+                           bool pack_as_flat);
 bool lower_vector_insert(exec_list *instructions, bool lower_nonconstant_index);
 bool lower_vector_derefs(gl_shader *shader);
 void lower_named_interface_blocks(void *mem_ctx, gl_shader *shader);
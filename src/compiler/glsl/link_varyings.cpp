@@ -38,6 +38,7 @@
 #include "main/macros.h"
 #include "program/hash_table.h"
 #include "program.h"
+#include "util/debug.h"
 
 
 /**
@@ -827,6 +828,7 @@ class varying_matches
 {
 public:
    varying_matches(bool disable_varying_packing, bool xfb_enabled,
+                   bool aggressive_packing,
                    gl_shader_stage producer_stage,
                    gl_shader_stage consumer_stage);
    ~varying_matches();
@@ -834,6 +836,14 @@ public:
    unsigned assign_locations(struct gl_shader_program *prog,
                              uint64_t reserved_slots, bool separate_shader);
    void store_locations() const;
+   unsigned count_interpolation_packed_slots() const;
+
+   /**
+    * If true, the consumer doesn't interpolate its inputs, so varyings are
+    * packed regardless of their interpolation qualifiers.  The packed
+    * varyings are then all flat ivec4s, see lower_packed_varyings().
+    */
+   const bool pack_across_interpolation;
 
 private:
    bool is_varying_packing_safe(const glsl_type *type,
@@ -935,9 +945,14 @@ private:
 
 varying_matches::varying_matches(bool disable_varying_packing,
                                  bool xfb_enabled,
+                                 bool aggressive_packing,
                                  gl_shader_stage producer_stage,
                                  gl_shader_stage consumer_stage)
-   : disable_varying_packing(disable_varying_packing),
+   : pack_across_interpolation(aggressive_packing &&
+                               !disable_varying_packing &&
+                               consumer_stage != (gl_shader_stage) -1 &&
+                               consumer_stage != MESA_SHADER_FRAGMENT),
+     disable_varying_packing(disable_varying_packing),
      xfb_enabled(xfb_enabled),
      producer_stage(producer_stage),
      consumer_stage(consumer_stage)
@@ -1054,7 +1069,8 @@ varying_matches::record(ir_variable *producer_var, ir_variable *consumer_var)
    const glsl_type *type = get_varying_type(var, stage);
 
    this->matches[this->num_matches].packing_class
-      = this->compute_packing_class(var);
+      = this->pack_across_interpolation ? var->data.patch
+                                        : this->compute_packing_class(var);
    this->matches[this->num_matches].packing_order
       = this->compute_packing_order(var);
    if (this->disable_varying_packing && !is_varying_packing_safe(type, var)) {
@@ -1227,6 +1243,51 @@ varying_matches::store_locations() const
 }
 
 
+/**
+ * Count the generic slots the varyings would take up if each interpolation
+ * qualifier was packed separately, as it is when
+ * \c pack_across_interpolation isn't set.  This is only an estimate for
+ * debug output, which ignores slots reserved by explicit locations.
+ */
+unsigned
+varying_matches::count_interpolation_packed_slots() const
+{
+   unsigned num_classes = 0;
+   unsigned classes[32];
+   unsigned components[32];
+
+   for (unsigned i = 0; i < this->num_matches; i++) {
+      const ir_variable *var = this->matches[i].consumer_var
+         ? this->matches[i].consumer_var : this->matches[i].producer_var;
+      const unsigned packing_class = compute_packing_class(var);
+      unsigned c;
+
+      if (var->data.patch)
+         continue;
+
+      for (c = 0; c < num_classes; c++) {
+         if (classes[c] == packing_class)
+            break;
+      }
+
+      if (c == num_classes) {
+         if (num_classes == ARRAY_SIZE(classes))
+            continue;
+         classes[num_classes] = packing_class;
+         components[num_classes++] = 0;
+      }
+
+      components[c] += this->matches[i].num_components;
+   }
+
+   unsigned slots = 0;
+   for (unsigned c = 0; c < num_classes; c++)
+      slots += (components[c] + 3) / 4;
+
+   return slots;
+}
+
+
 /**
  * Compute the "packing class" of the given varying.  This is an unsigned
  * integer with the property that two variables in the same packing class can
@@ -1696,6 +1757,7 @@ assign_varying_locations(struct gl_context *ctx,
       disable_varying_packing = true;
 
    varying_matches matches(disable_varying_packing, xfb_enabled,
+                           ctx->Const.AggressiveVaryingPacking,
                            producer ? producer->Stage : (gl_shader_stage)-1,
                            consumer ? consumer->Stage : (gl_shader_stage)-1);
    hash_table *tfeedback_candidates
@@ -1828,6 +1890,20 @@ assign_varying_locations(struct gl_context *ctx,
                                                         prog->SeparateShader);
    matches.store_locations();
 
+   if (matches.pack_across_interpolation) {
+      static int varying_stats = -1;
+      if (varying_stats < 0)
+         varying_stats = env_var_as_boolean("MESA_GLSL_VARYING_STATS", false);
+
+      if (varying_stats) {
+         fprintf(stderr, "%s -> %s varyings: %u slots, %u when packed by "
+                 "interpolation qualifier\n",
+                 _mesa_shader_stage_to_string(producer->Stage),
+                 _mesa_shader_stage_to_string(consumer->Stage),
+                 slots_used, matches.count_interpolation_packed_slots());
+      }
+   }
+
    for (unsigned i = 0; i < num_tfeedback_decls; ++i) {
       if (!tfeedback_decls[i].is_varying())
          continue;
@@ -1892,13 +1968,14 @@ assign_varying_locations(struct gl_context *ctx,
    if (producer) {
       lower_packed_varyings(mem_ctx, slots_used, ir_var_shader_out,
                             0, producer, disable_varying_packing,
-                            xfb_enabled);
+                            xfb_enabled, matches.pack_across_interpolation);
    }
 
    if (consumer) {
       lower_packed_varyings(mem_ctx, slots_used, ir_var_shader_in,
                             consumer_vertices, consumer,
-                            disable_varying_packing, xfb_enabled);
+                            disable_varying_packing, xfb_enabled,
+                            matches.pack_across_interpolation);
    }
 
    return true;
@@ -65,6 +65,7 @@
  */
 
 #include <ctype.h>
+#include "c11/threads.h"
 #include "util/strndup.h"
 #include "main/core.h"
 #include "glsl_symbol_table.h"
@@ -4029,7 +4030,7 @@ link_assign_subroutine_types(struct gl_shader_program *prog)
    }
 }
 
-static void
+void
 split_ubos_and_ssbos(void *mem_ctx,
                      struct gl_uniform_block **s_blks,
                      struct gl_uniform_block *p_blks,
@@ -4143,6 +4144,95 @@ disable_varying_optimizations_for_sso(struct gl_shader_program *prog)
    }
 }
 
+struct stage_optimization {
+   struct gl_context *ctx;
+   struct gl_shader *sh;
+};
+
+/**
+ * Lower and optimize a single linked shader.
+ *
+ * This only touches the IR of \p sh, so it can run for all stages at once.
+ */
+static int
+optimize_linked_shader(void *data)
+{
+   const struct stage_optimization *job =
+      (const struct stage_optimization *) data;
+   struct gl_context *ctx = job->ctx;
+   struct gl_shader *sh = job->sh;
+   const struct gl_shader_compiler_options *options =
+      &ctx->Const.ShaderCompilerOptions[sh->Stage];
+
+   if (options->LowerClipDistance) {
+      lower_clip_distance(sh);
+   }
+
+   if (ctx->Const.LowerTessLevel) {
+      lower_tess_level(sh);
+   }
+
+   ir_opt_tracker tracker;
+   while (do_common_optimization(sh->ir, true, false, options,
+                                 ctx->Const.NativeIntegers, &tracker))
+      ;
+
+   lower_const_arrays_to_uniforms(sh->ir);
+
+   return 0;
+}
+
+/**
+ * Run optimize_linked_shader() on every linked stage of \p prog.
+ *
+ * Each stage but the last one gets a thread of its own, the last one is
+ * handled by the calling thread.  Stages for which no thread could be
+ * created are optimized in turn by the calling thread as well.
+ */
+static void
+optimize_linked_shaders(void *mem_ctx, struct gl_context *ctx,
+                        struct gl_shader_program *prog)
+{
+   struct stage_optimization jobs[MESA_SHADER_STAGES];
+   thrd_t threads[MESA_SHADER_STAGES];
+   bool threaded[MESA_SHADER_STAGES];
+   unsigned num_jobs = 0;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i] == NULL)
+         continue;
+
+      jobs[num_jobs].ctx = ctx;
+      jobs[num_jobs].sh = prog->_LinkedShaders[i];
+      num_jobs++;
+   }
+
+   /* The IR of all stages lives in the temporary linker context, and the
+    * passes allocate new IR next to the old.  ralloc isn't thread safe, so
+    * give each stage a context of its own first.
+    */
+   if (num_jobs > 1) {
+      for (unsigned i = 0; i < num_jobs; i++)
+         reparent_ir(jobs[i].sh->ir, ralloc_context(mem_ctx));
+   }
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      threaded[i] = i + 1 < num_jobs &&
+         thrd_create(&threads[i], optimize_linked_shader,
+                     &jobs[i]) == thrd_success;
+   }
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      if (!threaded[i])
+         optimize_linked_shader(&jobs[i]);
+   }
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      if (threaded[i])
+         thrd_join(threads[i], NULL);
+   }
+}
+
 void
 link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
 {
@@ -4424,23 +4514,13 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
       detect_recursion_linked(prog, prog->_LinkedShaders[i]->ir);
       if (!prog->LinkStatus)
 	 goto done;
-
-      if (ctx->Const.ShaderCompilerOptions[i].LowerClipDistance) {
-         lower_clip_distance(prog->_LinkedShaders[i]);
-      }
-
-      if (ctx->Const.LowerTessLevel) {
-         lower_tess_level(prog->_LinkedShaders[i]);
-      }
-
-      while (do_common_optimization(prog->_LinkedShaders[i]->ir, true, false,
-                                    &ctx->Const.ShaderCompilerOptions[i],
-                                    ctx->Const.NativeIntegers))
-	 ;
-
-      lower_const_arrays_to_uniforms(prog->_LinkedShaders[i]->ir);
    }
 
+   /* The stages are independent of each other until the varyings get
+    * matched up, so optimize them all at once.
+    */
+   optimize_linked_shaders(mem_ctx, ctx, prog);
+
    /* Validation for special cases where we allow sampler array indexing
     * with loop induction variable. This check emits a warning or error
     * depending if backend can handle dynamic indexing.
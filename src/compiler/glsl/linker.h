@@ -33,6 +33,16 @@ link_function_calls(gl_shader_program *prog, gl_shader *main,
 extern void
 link_invalidate_variable_locations(exec_list *ir);
 
+extern void
+split_ubos_and_ssbos(void *mem_ctx,
+                     struct gl_uniform_block **s_blks,
+                     struct gl_uniform_block *p_blks,
+                     unsigned num_blocks,
+                     struct gl_uniform_block ***ubos,
+                     unsigned *num_ubos,
+                     struct gl_uniform_block ***ssbos,
+                     unsigned *num_ssbos);
+
 extern void
 link_assign_uniform_locations(struct gl_shader_program *prog,
                               unsigned int boolean_true,
@@ -170,7 +170,8 @@ public:
                                  exec_list *out_instructions,
                                  exec_list *out_variables,
                                  bool disable_varying_packing,
-                                 bool xfb_enabled);
+                                 bool xfb_enabled,
+                                 bool pack_as_flat);
 
    void run(struct gl_shader *shader);
 
@@ -236,6 +237,13 @@ private:
 
    bool disable_varying_packing;
    bool xfb_enabled;
+
+   /**
+    * If true, the interface isn't interpolated and components with
+    * different interpolation qualifiers may share a slot, so every packed
+    * varying is created as a flat ivec4.
+    */
+   bool pack_as_flat;
 };
 
 } /* anonymous namespace */
@@ -244,7 +252,7 @@ lower_packed_varyings_visitor::lower_packed_varyings_visitor(
       void *mem_ctx, unsigned locations_used, ir_variable_mode mode,
       unsigned gs_input_vertices, exec_list *out_instructions,
       exec_list *out_variables, bool disable_varying_packing,
-      bool xfb_enabled)
+      bool xfb_enabled, bool pack_as_flat)
    : mem_ctx(mem_ctx),
      locations_used(locations_used),
      packed_varyings((ir_variable **)
@@ -255,7 +263,8 @@ lower_packed_varyings_visitor::lower_packed_varyings_visitor(
      out_instructions(out_instructions),
      out_variables(out_variables),
      disable_varying_packing(disable_varying_packing),
-     xfb_enabled(xfb_enabled)
+     xfb_enabled(xfb_enabled),
+     pack_as_flat(pack_as_flat)
 {
 }
 
@@ -592,7 +601,7 @@ lower_packed_varyings_visitor::lower_arraylike(ir_rvalue *rvalue,
  *
  * The newly created varying inherits its interpolation parameters from \c
  * unpacked_var.  Its base type is ivec4 if we are lowering a flat varying,
- * vec4 otherwise.
+ * vec4 otherwise.  With \c pack_as_flat, it is always a flat ivec4.
  *
  * \param vertex_index: if we are lowering geometry shader inputs, then this
  * indicates which vertex we are currently lowering.  Otherwise it is ignored.
@@ -607,7 +616,8 @@ lower_packed_varyings_visitor::get_packed_varying_deref(
    if (this->packed_varyings[slot] == NULL) {
       char *packed_name = ralloc_asprintf(this->mem_ctx, "packed:%s", name);
       const glsl_type *packed_type;
-      if (unpacked_var->data.interpolation == INTERP_QUALIFIER_FLAT)
+      if (this->pack_as_flat ||
+          unpacked_var->data.interpolation == INTERP_QUALIFIER_FLAT)
          packed_type = glsl_type::ivec4_type;
       else
          packed_type = glsl_type::vec4_type;
@@ -624,10 +634,14 @@ lower_packed_varyings_visitor::get_packed_varying_deref(
           */
          packed_var->data.max_array_access = this->gs_input_vertices - 1;
       }
-      packed_var->data.centroid = unpacked_var->data.centroid;
-      packed_var->data.sample = unpacked_var->data.sample;
+      if (this->pack_as_flat) {
+         packed_var->data.interpolation = INTERP_QUALIFIER_FLAT;
+      } else {
+         packed_var->data.centroid = unpacked_var->data.centroid;
+         packed_var->data.sample = unpacked_var->data.sample;
+         packed_var->data.interpolation = unpacked_var->data.interpolation;
+      }
       packed_var->data.patch = unpacked_var->data.patch;
-      packed_var->data.interpolation = unpacked_var->data.interpolation;
       packed_var->data.location = location;
       packed_var->data.precision = unpacked_var->data.precision;
       packed_var->data.always_active_io = unpacked_var->data.always_active_io;
@@ -729,7 +743,7 @@ void
 lower_packed_varyings(void *mem_ctx, unsigned locations_used,
                       ir_variable_mode mode, unsigned gs_input_vertices,
                       gl_shader *shader, bool disable_varying_packing,
-                      bool xfb_enabled)
+                      bool xfb_enabled, bool pack_as_flat)
 {
    exec_list *instructions = shader->ir;
    ir_function *main_func = shader->symbols->get_function("main");
@@ -742,7 +756,7 @@ lower_packed_varyings(void *mem_ctx, unsigned locations_used,
                                          &new_instructions,
                                          &new_variables,
                                          disable_varying_packing,
-                                         xfb_enabled);
+                                         xfb_enabled, pack_as_flat);
    visitor.run(shader);
    if (mode == ir_var_shader_out) {
       if (shader->Stage == MESA_SHADER_GEOMETRY) {
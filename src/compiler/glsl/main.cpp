@@ -21,6 +21,9 @@
  * DEALINGS IN THE SOFTWARE.
  */
 #include <getopt.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
 
 /** @file main.cpp
  *
@@ -38,6 +41,8 @@
 #include "program/hash_table.h"
 #include "loop_analysis.h"
 #include "standalone_scaffolding.h"
+#include "c11/threads.h"
+#include "util/u_atomic.h"
 
 static int glsl_version = 330;
 
@@ -274,12 +279,16 @@ int dump_ast = 0;
 int dump_hir = 0;
 int dump_lir = 0;
 int do_link = 0;
+int do_bench = 0;
+static unsigned bench_jobs = 1;
 
 const struct option compiler_opts[] = {
    { "dump-ast", no_argument, &dump_ast, 1 },
    { "dump-hir", no_argument, &dump_hir, 1 },
    { "dump-lir", no_argument, &dump_lir, 1 },
    { "link",     no_argument, &do_link,  1 },
+   { "bench",    no_argument, &do_bench, 1 },
+   { "jobs",     required_argument, NULL, 'j' },
    { "version",  required_argument, NULL, 'v' },
    { NULL, 0, NULL, 0 }
 };
@@ -293,9 +302,10 @@ usage_fail(const char *name)
 
    const char *header =
       "usage: %s [options] <file.vert | file.tesc | file.tese | file.geom | file.frag | file.comp>\n"
+      "       %s --bench [--link] [--jobs N] [options] <file | directory>...\n"
       "\n"
       "Possible options are:\n";
-   printf(header, name);
+   printf(header, name, name);
    for (const struct option *o = compiler_opts; o->name != 0; ++o) {
       printf("    --%s\n", o->name);
    }
@@ -319,6 +329,349 @@ compile_shader(struct gl_context *ctx, struct gl_shader *shader)
    return;
 }
 
+/**
+ * Returns the shader type implied by the extension of \p filename, or 0 if
+ * it isn't one the compiler knows about.
+ */
+static GLenum
+shader_type_for_filename(const char *filename)
+{
+   const unsigned len = strlen(filename);
+   if (len < 6)
+      return 0;
+
+   const char *const ext = &filename[len - 5];
+   if (strncmp(".vert", ext, 5) == 0 || strncmp(".glsl", ext, 5) == 0)
+      return GL_VERTEX_SHADER;
+   else if (strncmp(".tesc", ext, 5) == 0)
+      return GL_TESS_CONTROL_SHADER;
+   else if (strncmp(".tese", ext, 5) == 0)
+      return GL_TESS_EVALUATION_SHADER;
+   else if (strncmp(".geom", ext, 5) == 0)
+      return GL_GEOMETRY_SHADER;
+   else if (strncmp(".frag", ext, 5) == 0)
+      return GL_FRAGMENT_SHADER;
+   else if (strncmp(".comp", ext, 5) == 0)
+      return GL_COMPUTE_SHADER;
+
+   return 0;
+}
+
+static struct gl_shader_program *
+create_shader_program(void)
+{
+   struct gl_shader_program *prog = rzalloc(NULL, struct gl_shader_program);
+   assert(prog != NULL);
+   prog->InfoLog = ralloc_strdup(prog, "");
+
+   /* Created just to avoid segmentation faults */
+   prog->AttributeBindings = new string_to_uint_map;
+   prog->FragDataBindings = new string_to_uint_map;
+   prog->FragDataIndexBindings = new string_to_uint_map;
+
+   return prog;
+}
+
+static struct gl_shader *
+add_shader(struct gl_shader_program *prog, GLenum type)
+{
+   prog->Shaders = reralloc(prog, prog->Shaders, struct gl_shader *,
+                            prog->NumShaders + 1);
+   assert(prog->Shaders != NULL);
+
+   struct gl_shader *shader = rzalloc(prog, gl_shader);
+   shader->Type = type;
+   shader->Stage = _mesa_shader_enum_to_shader_stage(type);
+
+   prog->Shaders[prog->NumShaders++] = shader;
+   return shader;
+}
+
+static void
+destroy_shader_program(struct gl_shader_program *prog)
+{
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++)
+      ralloc_free(prog->_LinkedShaders[i]);
+
+   delete prog->AttributeBindings;
+   delete prog->FragDataBindings;
+   delete prog->FragDataIndexBindings;
+
+   ralloc_free(prog);
+}
+
+
+/**
+ * \name Corpus benchmark
+ *
+ * With --bench, every file given on the command line, and every shader
+ * file found in the directories given, is compiled and the time spent in
+ * each phase is reported, shader-db style.  Files that only differ in
+ * their extension make up one program, which is linked when --link is
+ * given as well.  The programs are spread across --jobs threads, each with
+ * its own context.
+ */
+/*@{*/
+
+struct bench_program {
+   char *name;
+   unsigned num_files;
+   char *files[MESA_SHADER_STAGES];
+};
+
+struct bench_stats {
+   struct _mesa_glsl_compile_stats compile;
+   int64_t link_ns;
+   unsigned linked_ir_instructions;
+   unsigned shaders;
+   unsigned programs;
+   unsigned failures;
+};
+
+struct bench_state {
+   void *mem_ctx;
+   struct hash_table *program_table;
+   struct bench_program *programs;
+   unsigned num_programs;
+   unsigned next_program;
+   bool glsl_es;
+};
+
+struct bench_worker {
+   struct bench_state *bench;
+   struct bench_stats stats;
+   thrd_t thread;
+};
+
+static int64_t
+bench_time_ns(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_nsec + tv.tv_sec * INT64_C(1000000000);
+}
+
+static void
+bench_add_file(struct bench_state *bench, const char *path)
+{
+   if (shader_type_for_filename(path) == 0)
+      return;
+
+   /* Files are grouped by their name without the extension. */
+   char *name = ralloc_strndup(bench->mem_ctx, path, strlen(path) - 5);
+   uintptr_t index = (uintptr_t) hash_table_find(bench->program_table, name);
+
+   if (index == 0) {
+      bench->programs = reralloc(bench->mem_ctx, bench->programs,
+                                 struct bench_program,
+                                 bench->num_programs + 1);
+      struct bench_program *prog = &bench->programs[bench->num_programs++];
+      prog->name = name;
+      prog->num_files = 0;
+      index = bench->num_programs;
+      hash_table_insert(bench->program_table, (void *) index, name);
+   }
+
+   struct bench_program *prog = &bench->programs[index - 1];
+   if (prog->num_files == ARRAY_SIZE(prog->files)) {
+      fprintf(stderr, "Too many shaders for program %s, skipping %s\n",
+              prog->name, path);
+      return;
+   }
+   prog->files[prog->num_files++] = ralloc_strdup(bench->mem_ctx, path);
+}
+
+static void
+bench_add_path(struct bench_state *bench, const char *path)
+{
+   struct stat st;
+
+   if (stat(path, &st) != 0) {
+      fprintf(stderr, "File \"%s\" does not exist.\n", path);
+      exit(EXIT_FAILURE);
+   }
+
+   if (!S_ISDIR(st.st_mode)) {
+      bench_add_file(bench, path);
+      return;
+   }
+
+   DIR *dir = opendir(path);
+   if (dir == NULL)
+      return;
+
+   struct dirent *entry;
+   while ((entry = readdir(dir)) != NULL) {
+      if (entry->d_name[0] == '.')
+         continue;
+
+      char *child = ralloc_asprintf(bench->mem_ctx, "%s/%s", path,
+                                    entry->d_name);
+      bench_add_path(bench, child);
+      ralloc_free(child);
+   }
+
+   closedir(dir);
+}
+
+static void
+bench_run_program(struct gl_context *ctx, const struct bench_program *bp,
+                  struct bench_stats *stats)
+{
+   struct gl_shader_program *prog = create_shader_program();
+   bool ok = true;
+
+   for (unsigned i = 0; i < bp->num_files; i++) {
+      struct gl_shader *shader =
+         add_shader(prog, shader_type_for_filename(bp->files[i]));
+
+      shader->Source = load_text_file(prog, bp->files[i]);
+      if (shader->Source == NULL) {
+         fprintf(stderr, "Failed to read %s\n", bp->files[i]);
+         ok = false;
+         break;
+      }
+
+      _mesa_glsl_compile_shader_with_stats(ctx, shader, false, false,
+                                           &stats->compile);
+      stats->shaders++;
+
+      if (!shader->CompileStatus) {
+         fprintf(stderr, "Info log for %s:\n%s\n", bp->files[i],
+                 shader->InfoLog);
+         ok = false;
+         break;
+      }
+   }
+
+   if (ok && do_link) {
+      int64_t start = bench_time_ns();
+
+      _mesa_clear_shader_program_data(prog);
+      link_shaders(ctx, prog);
+      stats->link_ns += bench_time_ns() - start;
+
+      if (prog->LinkStatus) {
+         for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+            if (prog->_LinkedShaders[i]) {
+               stats->linked_ir_instructions +=
+                  _mesa_glsl_count_ir_instructions(prog->_LinkedShaders[i]->ir);
+            }
+         }
+      } else {
+         fprintf(stderr, "Info log for linking %s:\n%s\n", bp->name,
+                 prog->InfoLog);
+         ok = false;
+      }
+   }
+
+   stats->programs++;
+   if (!ok)
+      stats->failures++;
+
+   destroy_shader_program(prog);
+}
+
+static int
+bench_thread(void *data)
+{
+   struct bench_worker *worker = (struct bench_worker *) data;
+   struct bench_state *bench = worker->bench;
+   struct gl_context *ctx = (struct gl_context *) malloc(sizeof(*ctx));
+
+   initialize_context(ctx, bench->glsl_es ? API_OPENGLES2 : API_OPENGL_COMPAT);
+
+   for (;;) {
+      unsigned i = p_atomic_inc_return(&bench->next_program) - 1;
+      if (i >= bench->num_programs)
+         break;
+
+      bench_run_program(ctx, &bench->programs[i], &worker->stats);
+   }
+
+   free(ctx);
+   return 0;
+}
+
+static int
+run_bench(int argc, char **argv, bool glsl_es)
+{
+   struct bench_state bench;
+   memset(&bench, 0, sizeof(bench));
+   bench.mem_ctx = ralloc_context(NULL);
+   bench.program_table = hash_table_ctor(0, hash_table_string_hash,
+                                         hash_table_string_compare);
+   bench.glsl_es = glsl_es;
+
+   for (int i = optind; i < argc; i++)
+      bench_add_path(&bench, argv[i]);
+
+   hash_table_dtor(bench.program_table);
+
+   if (bench.num_programs == 0) {
+      fprintf(stderr, "No shaders found.\n");
+      ralloc_free(bench.mem_ctx);
+      return EXIT_FAILURE;
+   }
+
+   struct bench_worker *workers =
+      rzalloc_array(bench.mem_ctx, struct bench_worker, bench_jobs);
+   int64_t start = bench_time_ns();
+
+   for (unsigned i = 0; i < bench_jobs; i++) {
+      workers[i].bench = &bench;
+      if (thrd_create(&workers[i].thread, bench_thread,
+                      &workers[i]) != thrd_success) {
+         fprintf(stderr, "Failed to create benchmark thread\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   struct bench_stats total;
+   memset(&total, 0, sizeof(total));
+
+   for (unsigned i = 0; i < bench_jobs; i++) {
+      const struct bench_stats *s = &workers[i].stats;
+
+      thrd_join(workers[i].thread, NULL);
+      total.compile.preprocess_ns += s->compile.preprocess_ns;
+      total.compile.parse_ns += s->compile.parse_ns;
+      total.compile.ast_to_hir_ns += s->compile.ast_to_hir_ns;
+      total.compile.optimize_ns += s->compile.optimize_ns;
+      total.compile.ir_instructions += s->compile.ir_instructions;
+      total.link_ns += s->link_ns;
+      total.linked_ir_instructions += s->linked_ir_instructions;
+      total.shaders += s->shaders;
+      total.programs += s->programs;
+      total.failures += s->failures;
+   }
+
+   int64_t wall_ns = bench_time_ns() - start;
+
+   printf("%u programs, %u shaders, %u failed, %u threads\n",
+          total.programs, total.shaders, total.failures, bench_jobs);
+   printf("wall time: %.3f ms\n", wall_ns / 1000000.0);
+   printf("   %-12s %12s\n", "phase", "total (ms)");
+   printf("   %-12s %12.3f\n", "glcpp", total.compile.preprocess_ns / 1000000.0);
+   printf("   %-12s %12.3f\n", "parse", total.compile.parse_ns / 1000000.0);
+   printf("   %-12s %12.3f\n", "ast_to_hir",
+          total.compile.ast_to_hir_ns / 1000000.0);
+   printf("   %-12s %12.3f\n", "optimize",
+          total.compile.optimize_ns / 1000000.0);
+   if (do_link)
+      printf("   %-12s %12.3f\n", "link", total.link_ns / 1000000.0);
+   printf("IR instructions: %u compiled", total.compile.ir_instructions);
+   if (do_link)
+      printf(", %u linked", total.linked_ir_instructions);
+   printf("\n");
+
+   ralloc_free(bench.mem_ctx);
+
+   return total.failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*@}*/
+
 int
 main(int argc, char **argv)
 {
@@ -352,6 +705,13 @@ main(int argc, char **argv)
             break;
          }
          break;
+      case 'j':
+         bench_jobs = strtol(optarg, NULL, 10);
+         if (bench_jobs == 0) {
+            fprintf(stderr, "Invalid number of jobs `%s'\n", optarg);
+            usage_fail(argv[0]);
+         }
+         break;
       default:
          break;
       }
@@ -361,50 +721,23 @@ main(int argc, char **argv)
    if (argc <= optind)
       usage_fail(argv[0]);
 
-   initialize_context(ctx, (glsl_es) ? API_OPENGLES2 : API_OPENGL_COMPAT);
-
-   struct gl_shader_program *whole_program;
+   if (do_bench) {
+      status = run_bench(argc, argv, glsl_es);
+      _mesa_glsl_release_types();
+      _mesa_glsl_release_builtin_functions();
+      return status;
+   }
 
-   whole_program = rzalloc (NULL, struct gl_shader_program);
-   assert(whole_program != NULL);
-   whole_program->InfoLog = ralloc_strdup(whole_program, "");
+   initialize_context(ctx, (glsl_es) ? API_OPENGLES2 : API_OPENGL_COMPAT);
 
-   /* Created just to avoid segmentation faults */
-   whole_program->AttributeBindings = new string_to_uint_map;
-   whole_program->FragDataBindings = new string_to_uint_map;
-   whole_program->FragDataIndexBindings = new string_to_uint_map;
+   struct gl_shader_program *whole_program = create_shader_program();
 
    for (/* empty */; argc > optind; optind++) {
-      whole_program->Shaders =
-	 reralloc(whole_program, whole_program->Shaders,
-		  struct gl_shader *, whole_program->NumShaders + 1);
-      assert(whole_program->Shaders != NULL);
-
-      struct gl_shader *shader = rzalloc(whole_program, gl_shader);
-
-      whole_program->Shaders[whole_program->NumShaders] = shader;
-      whole_program->NumShaders++;
-
-      const unsigned len = strlen(argv[optind]);
-      if (len < 6)
+      const GLenum type = shader_type_for_filename(argv[optind]);
+      if (type == 0)
 	 usage_fail(argv[0]);
 
-      const char *const ext = & argv[optind][len - 5];
-      if (strncmp(".vert", ext, 5) == 0 || strncmp(".glsl", ext, 5) == 0)
-	 shader->Type = GL_VERTEX_SHADER;
-      else if (strncmp(".tesc", ext, 5) == 0)
-	 shader->Type = GL_TESS_CONTROL_SHADER;
-      else if (strncmp(".tese", ext, 5) == 0)
-	 shader->Type = GL_TESS_EVALUATION_SHADER;
-      else if (strncmp(".geom", ext, 5) == 0)
-	 shader->Type = GL_GEOMETRY_SHADER;
-      else if (strncmp(".frag", ext, 5) == 0)
-	 shader->Type = GL_FRAGMENT_SHADER;
-      else if (strncmp(".comp", ext, 5) == 0)
-         shader->Type = GL_COMPUTE_SHADER;
-      else
-	 usage_fail(argv[0]);
-      shader->Stage = _mesa_shader_enum_to_shader_stage(shader->Type);
+      struct gl_shader *shader = add_shader(whole_program, type);
 
       shader->Source = load_text_file(whole_program, argv[optind]);
       if (shader->Source == NULL) {
@@ -433,14 +766,7 @@ main(int argc, char **argv)
 	 printf("Info log for linking:\n%s\n", whole_program->InfoLog);
    }
 
-   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++)
-      ralloc_free(whole_program->_LinkedShaders[i]);
-
-   delete whole_program->AttributeBindings;
-   delete whole_program->FragDataBindings;
-   delete whole_program->FragDataIndexBindings;
-
-   ralloc_free(whole_program);
+   destroy_shader_program(whole_program);
    _mesa_glsl_release_types();
    _mesa_glsl_release_builtin_functions();
 
@@ -23,18 +23,43 @@
  */
 
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+struct exec_list;
 struct gl_context;
 struct gl_shader;
 struct gl_shader_program;
 
+/**
+ * Time spent in each phase of compiling a shader, and the number of IR
+ * instructions left at the end, as filled in by
+ * _mesa_glsl_compile_shader_with_stats().
+ */
+struct _mesa_glsl_compile_stats {
+   int64_t preprocess_ns;
+   int64_t parse_ns;
+   int64_t ast_to_hir_ns;
+   int64_t optimize_ns;
+   unsigned ir_instructions;
+};
+
 extern void
 _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
 			  bool dump_ast, bool dump_hir);
 
+extern void
+_mesa_glsl_compile_shader_with_stats(struct gl_context *ctx,
+                                     struct gl_shader *shader,
+                                     bool dump_ast, bool dump_hir,
+                                     struct _mesa_glsl_compile_stats *stats);
+
+extern unsigned
+_mesa_glsl_count_ir_instructions(struct exec_list *ir);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
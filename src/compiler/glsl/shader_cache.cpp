@@ -0,0 +1,1362 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file shader_cache.cpp
+ *
+ * GLSL shader cache implementation
+ *
+ * This uses the on-disk cache in util/disk_cache.c to skip the GLSL linker
+ * for programs that were linked before, possibly by another process.
+ *
+ * On a successful link, all of the linker results that the GL API needs to
+ * answer queries about the program (uniforms, resources, blocks, ...) are
+ * serialized with the blob writer and stored under a key derived from the
+ * sources of the attached shaders plus the program state that influences
+ * linking.  When the same program is linked again, that data is read back
+ * into the gl_shader_program, the per-stage linked shaders are recreated
+ * without any IR, and the driver is asked to restore its compiled programs
+ * from its own cache entries through
+ * dd_function_table::LinkShaderFromCache.
+ *
+ * Pointers within the linker results are serialized as indices into the
+ * arrays they point to.  GLSL types are serialized structurally and
+ * recreated through the glsl_type instance functions, so they become the
+ * unique type objects the rest of the compiler expects.
+ */
+
+#include "main/core.h"
+#include "main/shaderapi.h"
+#include "main/shaderobj.h"
+#include "compiler/glsl_types.h"
+#include "program/hash_table.h"
+#include "util/mesa-sha1.h"
+#include "blob.h"
+#include "ir.h"
+#include "ir_uniform.h"
+#include "linker.h"
+#include "shader_cache.h"
+
+#define SHADER_CACHE_NULL_INDEX     0xffffffff
+#define SHADER_CACHE_INACTIVE_INDEX 0xfffffffe
+
+static void
+encode_type_to_blob(struct blob *blob, const glsl_type *type)
+{
+   if (type == NULL) {
+      blob_write_uint32(blob, SHADER_CACHE_NULL_INDEX);
+      return;
+   }
+
+   blob_write_uint32(blob, type->base_type);
+
+   switch (type->base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_DOUBLE:
+   case GLSL_TYPE_BOOL:
+      blob_write_uint32(blob, type->vector_elements);
+      blob_write_uint32(blob, type->matrix_columns);
+      return;
+   case GLSL_TYPE_SAMPLER:
+      blob_write_uint32(blob, type->sampler_dimensionality);
+      blob_write_uint32(blob, type->sampler_shadow);
+      blob_write_uint32(blob, type->sampler_array);
+      blob_write_uint32(blob, type->sampled_type);
+      return;
+   case GLSL_TYPE_IMAGE:
+      blob_write_uint32(blob, type->sampler_dimensionality);
+      blob_write_uint32(blob, type->sampler_array);
+      blob_write_uint32(blob, type->sampled_type);
+      return;
+   case GLSL_TYPE_SUBROUTINE:
+      blob_write_string(blob, type->name);
+      return;
+   case GLSL_TYPE_ARRAY:
+      blob_write_uint32(blob, type->length);
+      encode_type_to_blob(blob, type->fields.array);
+      return;
+   case GLSL_TYPE_STRUCT:
+   case GLSL_TYPE_INTERFACE:
+      blob_write_string(blob, type->name);
+      blob_write_uint32(blob, type->length);
+      blob_write_uint32(blob, type->interface_packing);
+      for (unsigned i = 0; i < type->length; i++) {
+         const glsl_struct_field *field = &type->fields.structure[i];
+
+         encode_type_to_blob(blob, field->type);
+         blob_write_string(blob, field->name);
+         blob_write_uint32(blob, field->location);
+         blob_write_uint32(blob, field->offset);
+         blob_write_uint32(blob, field->interpolation);
+         blob_write_uint32(blob, field->centroid);
+         blob_write_uint32(blob, field->sample);
+         blob_write_uint32(blob, field->matrix_layout);
+         blob_write_uint32(blob, field->patch);
+         blob_write_uint32(blob, field->precision);
+         blob_write_uint32(blob, field->image_read_only);
+         blob_write_uint32(blob, field->image_write_only);
+         blob_write_uint32(blob, field->image_coherent);
+         blob_write_uint32(blob, field->image_volatile);
+         blob_write_uint32(blob, field->image_restrict);
+      }
+      return;
+   case GLSL_TYPE_ATOMIC_UINT:
+   case GLSL_TYPE_VOID:
+   case GLSL_TYPE_ERROR:
+   case GLSL_TYPE_FUNCTION:
+      return;
+   }
+}
+
+static const glsl_type *
+decode_type_from_blob(struct blob_reader *blob)
+{
+   uint32_t base_type = blob_read_uint32(blob);
+
+   if (base_type == SHADER_CACHE_NULL_INDEX)
+      return NULL;
+
+   switch (base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_DOUBLE:
+   case GLSL_TYPE_BOOL: {
+      unsigned rows = blob_read_uint32(blob);
+      unsigned columns = blob_read_uint32(blob);
+      return glsl_type::get_instance(base_type, rows, columns);
+   }
+   case GLSL_TYPE_SAMPLER: {
+      glsl_sampler_dim dim = (glsl_sampler_dim) blob_read_uint32(blob);
+      bool shadow = blob_read_uint32(blob);
+      bool array = blob_read_uint32(blob);
+      glsl_base_type type = (glsl_base_type) blob_read_uint32(blob);
+      return glsl_type::get_sampler_instance(dim, shadow, array, type);
+   }
+   case GLSL_TYPE_IMAGE: {
+      glsl_sampler_dim dim = (glsl_sampler_dim) blob_read_uint32(blob);
+      bool array = blob_read_uint32(blob);
+      glsl_base_type type = (glsl_base_type) blob_read_uint32(blob);
+      return glsl_type::get_image_instance(dim, array, type);
+   }
+   case GLSL_TYPE_SUBROUTINE:
+      return glsl_type::get_subroutine_instance(blob_read_string(blob));
+   case GLSL_TYPE_ARRAY: {
+      unsigned length = blob_read_uint32(blob);
+      const glsl_type *element = decode_type_from_blob(blob);
+      if (element == NULL)
+         return glsl_type::error_type;
+      return glsl_type::get_array_instance(element, length);
+   }
+   case GLSL_TYPE_STRUCT:
+   case GLSL_TYPE_INTERFACE: {
+      char *name = blob_read_string(blob);
+      unsigned num_fields = blob_read_uint32(blob);
+      glsl_interface_packing packing =
+         (glsl_interface_packing) blob_read_uint32(blob);
+
+      if (blob->overrun)
+         return glsl_type::error_type;
+
+      glsl_struct_field *fields = new glsl_struct_field[num_fields];
+      for (unsigned i = 0; i < num_fields; i++) {
+         fields[i].type = decode_type_from_blob(blob);
+         fields[i].name = blob_read_string(blob);
+         fields[i].location = blob_read_uint32(blob);
+         fields[i].offset = blob_read_uint32(blob);
+         fields[i].interpolation = blob_read_uint32(blob);
+         fields[i].centroid = blob_read_uint32(blob);
+         fields[i].sample = blob_read_uint32(blob);
+         fields[i].matrix_layout = blob_read_uint32(blob);
+         fields[i].patch = blob_read_uint32(blob);
+         fields[i].precision = blob_read_uint32(blob);
+         fields[i].image_read_only = blob_read_uint32(blob);
+         fields[i].image_write_only = blob_read_uint32(blob);
+         fields[i].image_coherent = blob_read_uint32(blob);
+         fields[i].image_volatile = blob_read_uint32(blob);
+         fields[i].image_restrict = blob_read_uint32(blob);
+
+         if (blob->overrun || fields[i].type == NULL) {
+            delete [] fields;
+            return glsl_type::error_type;
+         }
+      }
+
+      /* The instance functions copy the fields and names, so the strings
+       * pointing into the blob don't need to outlive this call.
+       */
+      const glsl_type *t = base_type == GLSL_TYPE_STRUCT
+         ? glsl_type::get_record_instance(fields, num_fields, name)
+         : glsl_type::get_interface_instance(fields, num_fields, packing, name);
+
+      delete [] fields;
+      return t;
+   }
+   case GLSL_TYPE_ATOMIC_UINT:
+      return glsl_type::atomic_uint_type;
+   case GLSL_TYPE_VOID:
+      return glsl_type::void_type;
+   default:
+      return glsl_type::error_type;
+   }
+}
+
+/**
+ * Number of gl_constant_value slots backing a uniform's storage.
+ *
+ * This must match values_for_type() in link_uniforms.cpp.
+ */
+static unsigned
+uniform_storage_slots(const struct gl_uniform_storage *uni)
+{
+   const unsigned elements = MAX2(1, uni->array_elements);
+
+   if (uni->type->is_sampler())
+      return elements;
+
+   return uni->type->component_slots() * elements;
+}
+
+static void
+write_uniforms(struct blob *metadata, struct gl_shader_program *prog)
+{
+   union gl_constant_value *data = NULL;
+   unsigned num_data_slots = 0;
+
+   /* All of the uniform storage comes from a single allocation made by
+    * link_assign_uniform_locations(), find its base and extent.
+    */
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      const struct gl_uniform_storage *uni = &prog->UniformStorage[i];
+
+      if (uni->storage && (data == NULL || uni->storage < data))
+         data = uni->storage;
+   }
+
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      const struct gl_uniform_storage *uni = &prog->UniformStorage[i];
+
+      if (uni->storage) {
+         unsigned end = (uni->storage - data) + uniform_storage_slots(uni);
+         num_data_slots = MAX2(num_data_slots, end);
+      }
+   }
+
+   blob_write_uint32(metadata, prog->NumUniformStorage);
+   blob_write_uint32(metadata, prog->NumHiddenUniforms);
+   blob_write_uint32(metadata, num_data_slots);
+
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      const struct gl_uniform_storage *uni = &prog->UniformStorage[i];
+
+      encode_type_to_blob(metadata, uni->type);
+      blob_write_uint32(metadata, uni->array_elements);
+      blob_write_string(metadata, uni->name);
+      blob_write_uint32(metadata, uni->initialized);
+      blob_write_bytes(metadata, uni->opaque, sizeof(uni->opaque));
+      blob_write_uint32(metadata, uni->storage ?
+                        (uint32_t) (uni->storage - data) :
+                        SHADER_CACHE_NULL_INDEX);
+      blob_write_uint32(metadata, uni->block_index);
+      blob_write_uint32(metadata, uni->offset);
+      blob_write_uint32(metadata, uni->matrix_stride);
+      blob_write_uint32(metadata, uni->array_stride);
+      blob_write_uint32(metadata, uni->row_major);
+      blob_write_uint32(metadata, uni->hidden);
+      blob_write_uint32(metadata, uni->builtin);
+      blob_write_uint32(metadata, uni->is_shader_storage);
+      blob_write_uint32(metadata, uni->atomic_buffer_index);
+      blob_write_uint32(metadata, uni->remap_location);
+      blob_write_uint32(metadata, uni->num_compatible_subroutines);
+      blob_write_uint32(metadata, uni->top_level_array_size);
+      blob_write_uint32(metadata, uni->top_level_array_stride);
+   }
+
+   /* The current values include the uniform initializers and the default
+    * sampler and image units, which would otherwise be lost.
+    */
+   if (num_data_slots)
+      blob_write_bytes(metadata, data, sizeof(*data) * num_data_slots);
+}
+
+static bool
+read_uniforms(struct blob_reader *metadata, struct gl_shader_program *prog)
+{
+   struct gl_uniform_storage *uniforms;
+   union gl_constant_value *data;
+
+   prog->NumUniformStorage = blob_read_uint32(metadata);
+   prog->NumHiddenUniforms = blob_read_uint32(metadata);
+   unsigned num_data_slots = blob_read_uint32(metadata);
+
+   if (metadata->overrun)
+      return false;
+
+   uniforms = rzalloc_array(prog, struct gl_uniform_storage,
+                            prog->NumUniformStorage);
+   data = rzalloc_array(uniforms, union gl_constant_value, num_data_slots);
+   if (uniforms == NULL || data == NULL)
+      return false;
+
+   prog->UniformStorage = uniforms;
+
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      struct gl_uniform_storage *uni = &uniforms[i];
+
+      uni->type = decode_type_from_blob(metadata);
+      uni->array_elements = blob_read_uint32(metadata);
+      uni->name = ralloc_strdup(uniforms, blob_read_string(metadata));
+      uni->initialized = blob_read_uint32(metadata);
+      blob_copy_bytes(metadata, (uint8_t *) uni->opaque, sizeof(uni->opaque));
+
+      uint32_t offset = blob_read_uint32(metadata);
+      if (offset != SHADER_CACHE_NULL_INDEX) {
+         if (offset >= num_data_slots)
+            return false;
+         uni->storage = &data[offset];
+      }
+
+      uni->block_index = blob_read_uint32(metadata);
+      uni->offset = blob_read_uint32(metadata);
+      uni->matrix_stride = blob_read_uint32(metadata);
+      uni->array_stride = blob_read_uint32(metadata);
+      uni->row_major = blob_read_uint32(metadata);
+      uni->hidden = blob_read_uint32(metadata);
+      uni->builtin = blob_read_uint32(metadata);
+      uni->is_shader_storage = blob_read_uint32(metadata);
+      uni->atomic_buffer_index = blob_read_uint32(metadata);
+      uni->remap_location = blob_read_uint32(metadata);
+      uni->num_compatible_subroutines = blob_read_uint32(metadata);
+      uni->top_level_array_size = blob_read_uint32(metadata);
+      uni->top_level_array_stride = blob_read_uint32(metadata);
+
+      if (metadata->overrun || uni->type == NULL || uni->type->is_error())
+         return false;
+   }
+
+   if (num_data_slots)
+      blob_copy_bytes(metadata, (uint8_t *) data, sizeof(*data) * num_data_slots);
+
+   return !metadata->overrun;
+}
+
+static void
+write_uniform_pointer(struct blob *metadata, struct gl_shader_program *prog,
+                      const struct gl_uniform_storage *uni)
+{
+   if (uni == NULL)
+      blob_write_uint32(metadata, SHADER_CACHE_NULL_INDEX);
+   else if (uni == INACTIVE_UNIFORM_EXPLICIT_LOCATION)
+      blob_write_uint32(metadata, SHADER_CACHE_INACTIVE_INDEX);
+   else
+      blob_write_uint32(metadata, uni - prog->UniformStorage);
+}
+
+static bool
+read_uniform_pointer(struct blob_reader *metadata,
+                     struct gl_shader_program *prog,
+                     struct gl_uniform_storage **uni)
+{
+   uint32_t index = blob_read_uint32(metadata);
+
+   if (index == SHADER_CACHE_NULL_INDEX)
+      *uni = NULL;
+   else if (index == SHADER_CACHE_INACTIVE_INDEX)
+      *uni = INACTIVE_UNIFORM_EXPLICIT_LOCATION;
+   else if (index < prog->NumUniformStorage)
+      *uni = &prog->UniformStorage[index];
+   else
+      return false;
+
+   return true;
+}
+
+static void
+write_uniform_remap_table(struct blob *metadata,
+                          struct gl_shader_program *prog)
+{
+   blob_write_uint32(metadata, prog->NumUniformRemapTable);
+
+   for (unsigned i = 0; i < prog->NumUniformRemapTable; i++)
+      write_uniform_pointer(metadata, prog, prog->UniformRemapTable[i]);
+}
+
+static bool
+read_uniform_remap_table(struct blob_reader *metadata,
+                         struct gl_shader_program *prog)
+{
+   prog->NumUniformRemapTable = blob_read_uint32(metadata);
+   if (metadata->overrun)
+      return false;
+
+   prog->UniformRemapTable = rzalloc_array(prog, struct gl_uniform_storage *,
+                                           prog->NumUniformRemapTable);
+   if (prog->UniformRemapTable == NULL)
+      return false;
+
+   for (unsigned i = 0; i < prog->NumUniformRemapTable; i++) {
+      if (!read_uniform_pointer(metadata, prog, &prog->UniformRemapTable[i]))
+         return false;
+   }
+
+   return !metadata->overrun;
+}
+
+struct uniform_hash_closure {
+   struct blob *blob;
+   unsigned num_entries;
+};
+
+static void
+count_uniform_hash_entry(const char *key, unsigned value, void *closure)
+{
+   ((struct uniform_hash_closure *) closure)->num_entries++;
+}
+
+static void
+write_uniform_hash_entry(const char *key, unsigned value, void *closure)
+{
+   struct blob *blob = ((struct uniform_hash_closure *) closure)->blob;
+
+   blob_write_string(blob, key);
+   blob_write_uint32(blob, value);
+}
+
+static void
+write_uniform_hash(struct blob *metadata, struct string_to_uint_map *map)
+{
+   struct uniform_hash_closure closure = { metadata, 0 };
+
+   if (map == NULL) {
+      blob_write_uint32(metadata, 0);
+      return;
+   }
+
+   map->iterate(count_uniform_hash_entry, &closure);
+   blob_write_uint32(metadata, closure.num_entries);
+   map->iterate(write_uniform_hash_entry, &closure);
+}
+
+static bool
+read_uniform_hash(struct blob_reader *metadata,
+                  struct gl_shader_program *prog)
+{
+   unsigned num_entries = blob_read_uint32(metadata);
+
+   prog->UniformHash = new string_to_uint_map;
+
+   for (unsigned i = 0; i < num_entries; i++) {
+      const char *key = blob_read_string(metadata);
+      unsigned value = blob_read_uint32(metadata);
+
+      if (metadata->overrun)
+         return false;
+
+      prog->UniformHash->put(value, key);
+   }
+
+   return true;
+}
+
+static void
+write_buffer_blocks(struct blob *metadata, struct gl_shader_program *prog)
+{
+   blob_write_uint32(metadata, prog->NumBufferInterfaceBlocks);
+
+   for (unsigned i = 0; i < prog->NumBufferInterfaceBlocks; i++) {
+      const struct gl_uniform_block *block = &prog->BufferInterfaceBlocks[i];
+
+      blob_write_string(metadata, block->Name);
+      blob_write_uint32(metadata, block->NumUniforms);
+      blob_write_uint32(metadata, block->Binding);
+      blob_write_uint32(metadata, block->UniformBufferSize);
+      blob_write_uint32(metadata, block->IsShaderStorage);
+      blob_write_uint32(metadata, block->_Packing);
+
+      for (unsigned j = 0; j < block->NumUniforms; j++) {
+         const struct gl_uniform_buffer_variable *var = &block->Uniforms[j];
+
+         blob_write_string(metadata, var->Name);
+         /* IndexName is usually the same string as Name. */
+         if (var->IndexName == var->Name) {
+            blob_write_uint32(metadata, 0);
+         } else {
+            blob_write_uint32(metadata, 1);
+            blob_write_string(metadata, var->IndexName);
+         }
+         encode_type_to_blob(metadata, var->Type);
+         blob_write_uint32(metadata, var->Offset);
+         blob_write_uint32(metadata, var->RowMajor);
+      }
+   }
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      for (unsigned j = 0; j < prog->NumBufferInterfaceBlocks; j++)
+         blob_write_uint32(metadata, prog->InterfaceBlockStageIndex[i][j]);
+   }
+}
+
+static bool
+read_buffer_blocks(struct blob_reader *metadata,
+                   struct gl_shader_program *prog)
+{
+   prog->NumBufferInterfaceBlocks = blob_read_uint32(metadata);
+   if (metadata->overrun)
+      return false;
+
+   prog->BufferInterfaceBlocks =
+      rzalloc_array(prog, struct gl_uniform_block,
+                    prog->NumBufferInterfaceBlocks);
+   if (prog->BufferInterfaceBlocks == NULL)
+      return false;
+
+   for (unsigned i = 0; i < prog->NumBufferInterfaceBlocks; i++) {
+      struct gl_uniform_block *block = &prog->BufferInterfaceBlocks[i];
+
+      block->Name = ralloc_strdup(prog->BufferInterfaceBlocks,
+                                  blob_read_string(metadata));
+      block->NumUniforms = blob_read_uint32(metadata);
+      block->Binding = blob_read_uint32(metadata);
+      block->UniformBufferSize = blob_read_uint32(metadata);
+      block->IsShaderStorage = blob_read_uint32(metadata);
+      block->_Packing = (gl_uniform_block_packing) blob_read_uint32(metadata);
+
+      if (metadata->overrun)
+         return false;
+
+      block->Uniforms = rzalloc_array(prog->BufferInterfaceBlocks,
+                                      struct gl_uniform_buffer_variable,
+                                      block->NumUniforms);
+      if (block->Uniforms == NULL)
+         return false;
+
+      for (unsigned j = 0; j < block->NumUniforms; j++) {
+         struct gl_uniform_buffer_variable *var = &block->Uniforms[j];
+
+         var->Name = ralloc_strdup(block->Uniforms, blob_read_string(metadata));
+         if (blob_read_uint32(metadata))
+            var->IndexName = ralloc_strdup(block->Uniforms,
+                                           blob_read_string(metadata));
+         else
+            var->IndexName = var->Name;
+         var->Type = decode_type_from_blob(metadata);
+         var->Offset = blob_read_uint32(metadata);
+         var->RowMajor = blob_read_uint32(metadata);
+
+         if (metadata->overrun || var->Type == NULL)
+            return false;
+      }
+   }
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      prog->InterfaceBlockStageIndex[i] =
+         ralloc_array(prog, int, prog->NumBufferInterfaceBlocks);
+      if (prog->InterfaceBlockStageIndex[i] == NULL)
+         return false;
+
+      for (unsigned j = 0; j < prog->NumBufferInterfaceBlocks; j++)
+         prog->InterfaceBlockStageIndex[i][j] = blob_read_uint32(metadata);
+   }
+
+   split_ubos_and_ssbos(prog,
+                        NULL,
+                        prog->BufferInterfaceBlocks,
+                        prog->NumBufferInterfaceBlocks,
+                        &prog->UniformBlocks,
+                        &prog->NumUniformBlocks,
+                        &prog->ShaderStorageBlocks,
+                        &prog->NumShaderStorageBlocks);
+
+   return !metadata->overrun;
+}
+
+static void
+write_atomic_buffers(struct blob *metadata, struct gl_shader_program *prog)
+{
+   blob_write_uint32(metadata, prog->NumAtomicBuffers);
+
+   for (unsigned i = 0; i < prog->NumAtomicBuffers; i++) {
+      const struct gl_active_atomic_buffer *ab = &prog->AtomicBuffers[i];
+
+      blob_write_uint32(metadata, ab->NumUniforms);
+      blob_write_bytes(metadata, ab->Uniforms,
+                       sizeof(*ab->Uniforms) * ab->NumUniforms);
+      blob_write_uint32(metadata, ab->Binding);
+      blob_write_uint32(metadata, ab->MinimumSize);
+      blob_write_bytes(metadata, ab->StageReferences,
+                       sizeof(ab->StageReferences));
+   }
+}
+
+static bool
+read_atomic_buffers(struct blob_reader *metadata,
+                    struct gl_shader_program *prog)
+{
+   prog->NumAtomicBuffers = blob_read_uint32(metadata);
+   if (metadata->overrun)
+      return false;
+
+   prog->AtomicBuffers = rzalloc_array(prog, gl_active_atomic_buffer,
+                                       prog->NumAtomicBuffers);
+   if (prog->AtomicBuffers == NULL)
+      return false;
+
+   for (unsigned i = 0; i < prog->NumAtomicBuffers; i++) {
+      struct gl_active_atomic_buffer *ab = &prog->AtomicBuffers[i];
+
+      ab->NumUniforms = blob_read_uint32(metadata);
+      if (metadata->overrun)
+         return false;
+
+      ab->Uniforms = ralloc_array(prog->AtomicBuffers, GLuint,
+                                  ab->NumUniforms);
+      if (ab->Uniforms == NULL)
+         return false;
+
+      blob_copy_bytes(metadata, (uint8_t *) ab->Uniforms,
+                      sizeof(*ab->Uniforms) * ab->NumUniforms);
+      ab->Binding = blob_read_uint32(metadata);
+      ab->MinimumSize = blob_read_uint32(metadata);
+      blob_copy_bytes(metadata, (uint8_t *) ab->StageReferences,
+                      sizeof(ab->StageReferences));
+   }
+
+   return !metadata->overrun;
+}
+
+static void
+write_xfb(struct blob *metadata, struct gl_shader_program *prog)
+{
+   const struct gl_transform_feedback_info *info =
+      &prog->LinkedTransformFeedback;
+
+   blob_write_uint32(metadata, info->NumOutputs);
+   blob_write_uint32(metadata, info->NumBuffers);
+   blob_write_uint32(metadata, info->NumVarying);
+   blob_write_bytes(metadata, info->Outputs,
+                    sizeof(*info->Outputs) * info->NumOutputs);
+
+   for (int i = 0; i < info->NumVarying; i++) {
+      blob_write_string(metadata, info->Varyings[i].Name);
+      blob_write_uint32(metadata, info->Varyings[i].Type);
+      blob_write_uint32(metadata, info->Varyings[i].Size);
+   }
+
+   blob_write_bytes(metadata, info->BufferStride, sizeof(info->BufferStride));
+   blob_write_bytes(metadata, info->BufferStream, sizeof(info->BufferStream));
+}
+
+static bool
+read_xfb(struct blob_reader *metadata, struct gl_shader_program *prog)
+{
+   struct gl_transform_feedback_info *info = &prog->LinkedTransformFeedback;
+
+   /* Same as store_tfeedback_info(): drop any earlier link results. */
+   ralloc_free(info->Varyings);
+   ralloc_free(info->Outputs);
+   memset(info, 0, sizeof(*info));
+
+   info->NumOutputs = blob_read_uint32(metadata);
+   info->NumBuffers = blob_read_uint32(metadata);
+   info->NumVarying = blob_read_uint32(metadata);
+
+   if (metadata->overrun)
+      return false;
+
+   info->Outputs = rzalloc_array(prog, struct gl_transform_feedback_output,
+                                 info->NumOutputs);
+   info->Varyings = rzalloc_array(prog,
+                                  struct gl_transform_feedback_varying_info,
+                                  info->NumVarying);
+   if (info->Outputs == NULL || info->Varyings == NULL)
+      return false;
+
+   blob_copy_bytes(metadata, (uint8_t *) info->Outputs,
+                   sizeof(*info->Outputs) * info->NumOutputs);
+
+   for (int i = 0; i < info->NumVarying; i++) {
+      info->Varyings[i].Name = ralloc_strdup(prog, blob_read_string(metadata));
+      info->Varyings[i].Type = blob_read_uint32(metadata);
+      info->Varyings[i].Size = blob_read_uint32(metadata);
+   }
+
+   blob_copy_bytes(metadata, (uint8_t *) info->BufferStride,
+                   sizeof(info->BufferStride));
+   blob_copy_bytes(metadata, (uint8_t *) info->BufferStream,
+                   sizeof(info->BufferStream));
+
+   return !metadata->overrun;
+}
+
+static void
+write_linked_shader(struct blob *metadata, struct gl_shader_program *prog,
+                    struct gl_shader *sh)
+{
+   blob_write_uint32(metadata, sh->Type);
+   blob_write_uint32(metadata, sh->Version);
+   blob_write_uint32(metadata, sh->IsES);
+
+   blob_write_uint32(metadata, sh->num_samplers);
+   blob_write_uint32(metadata, sh->active_samplers);
+   blob_write_uint32(metadata, sh->shadow_samplers);
+   blob_write_bytes(metadata, sh->SamplerUnits, sizeof(sh->SamplerUnits));
+   for (unsigned i = 0; i < MAX_SAMPLERS; i++)
+      blob_write_uint32(metadata, sh->SamplerTargets[i]);
+
+   blob_write_uint32(metadata, sh->num_uniform_components);
+   blob_write_uint32(metadata, sh->num_combined_uniform_components);
+
+   blob_write_uint32(metadata, sh->uses_builtin_functions);
+   blob_write_uint32(metadata, sh->uses_gl_fragcoord);
+   blob_write_uint32(metadata, sh->redeclares_gl_fragcoord);
+   blob_write_uint32(metadata, sh->ARB_fragment_coord_conventions_enable);
+   blob_write_uint32(metadata, sh->origin_upper_left);
+   blob_write_uint32(metadata, sh->pixel_center_integer);
+   blob_write_uint32(metadata, sh->EarlyFragmentTests);
+
+   blob_write_uint32(metadata, sh->TessCtrl.VerticesOut);
+   blob_write_uint32(metadata, sh->TessEval.PrimitiveMode);
+   blob_write_uint32(metadata, sh->TessEval.Spacing);
+   blob_write_uint32(metadata, sh->TessEval.VertexOrder);
+   blob_write_uint32(metadata, sh->TessEval.PointMode);
+   blob_write_uint32(metadata, sh->Geom.VerticesOut);
+   blob_write_uint32(metadata, sh->Geom.Invocations);
+   blob_write_uint32(metadata, sh->Geom.InputType);
+   blob_write_uint32(metadata, sh->Geom.OutputType);
+   blob_write_bytes(metadata, sh->Comp.LocalSize, sizeof(sh->Comp.LocalSize));
+
+   blob_write_uint32(metadata, sh->NumImages);
+   blob_write_bytes(metadata, sh->ImageUnits, sizeof(sh->ImageUnits));
+   for (unsigned i = 0; i < MAX_IMAGE_UNIFORMS; i++)
+      blob_write_uint32(metadata, sh->ImageAccess[i]);
+
+   /* The per-stage blocks point into the program's block list, see
+    * interstage_cross_validate_uniform_blocks().
+    */
+   blob_write_uint32(metadata, sh->NumBufferInterfaceBlocks);
+   for (unsigned i = 0; i < sh->NumBufferInterfaceBlocks; i++)
+      blob_write_uint32(metadata,
+                        sh->BufferInterfaceBlocks[i] -
+                        prog->BufferInterfaceBlocks);
+
+   blob_write_uint32(metadata, sh->NumAtomicBuffers);
+   for (unsigned i = 0; i < sh->NumAtomicBuffers; i++)
+      blob_write_uint32(metadata, sh->AtomicBuffers[i] - prog->AtomicBuffers);
+
+   blob_write_uint32(metadata, sh->NumSubroutineUniformTypes);
+   blob_write_uint32(metadata, sh->NumSubroutineUniformRemapTable);
+   for (unsigned i = 0; i < sh->NumSubroutineUniformRemapTable; i++)
+      write_uniform_pointer(metadata, prog, sh->SubroutineUniformRemapTable[i]);
+
+   blob_write_uint32(metadata, sh->NumSubroutineFunctions);
+   for (unsigned i = 0; i < sh->NumSubroutineFunctions; i++) {
+      const struct gl_subroutine_function *fn = &sh->SubroutineFunctions[i];
+
+      blob_write_string(metadata, fn->name);
+      blob_write_uint32(metadata, fn->index);
+      blob_write_uint32(metadata, fn->num_compat_types);
+      for (int j = 0; j < fn->num_compat_types; j++)
+         encode_type_to_blob(metadata, fn->types[j]);
+   }
+}
+
+static struct gl_shader *
+read_linked_shader(struct gl_context *ctx, struct blob_reader *metadata,
+                   struct gl_shader_program *prog)
+{
+   GLenum type = blob_read_uint32(metadata);
+
+   if (metadata->overrun || !_mesa_validate_shader_target(ctx, type))
+      return NULL;
+
+   struct gl_shader *sh = ctx->Driver.NewShader(NULL, 0, type);
+   if (sh == NULL)
+      return NULL;
+
+   sh->CompileStatus = GL_TRUE;
+   sh->Version = blob_read_uint32(metadata);
+   sh->IsES = blob_read_uint32(metadata);
+
+   sh->num_samplers = blob_read_uint32(metadata);
+   sh->active_samplers = blob_read_uint32(metadata);
+   sh->shadow_samplers = blob_read_uint32(metadata);
+   blob_copy_bytes(metadata, (uint8_t *) sh->SamplerUnits,
+                   sizeof(sh->SamplerUnits));
+   for (unsigned i = 0; i < MAX_SAMPLERS; i++)
+      sh->SamplerTargets[i] = (gl_texture_index) blob_read_uint32(metadata);
+
+   sh->num_uniform_components = blob_read_uint32(metadata);
+   sh->num_combined_uniform_components = blob_read_uint32(metadata);
+
+   sh->uses_builtin_functions = blob_read_uint32(metadata);
+   sh->uses_gl_fragcoord = blob_read_uint32(metadata);
+   sh->redeclares_gl_fragcoord = blob_read_uint32(metadata);
+   sh->ARB_fragment_coord_conventions_enable = blob_read_uint32(metadata);
+   sh->origin_upper_left = blob_read_uint32(metadata);
+   sh->pixel_center_integer = blob_read_uint32(metadata);
+   sh->EarlyFragmentTests = blob_read_uint32(metadata);
+
+   sh->TessCtrl.VerticesOut = blob_read_uint32(metadata);
+   sh->TessEval.PrimitiveMode = blob_read_uint32(metadata);
+   sh->TessEval.Spacing = blob_read_uint32(metadata);
+   sh->TessEval.VertexOrder = blob_read_uint32(metadata);
+   sh->TessEval.PointMode = blob_read_uint32(metadata);
+   sh->Geom.VerticesOut = blob_read_uint32(metadata);
+   sh->Geom.Invocations = blob_read_uint32(metadata);
+   sh->Geom.InputType = blob_read_uint32(metadata);
+   sh->Geom.OutputType = blob_read_uint32(metadata);
+   blob_copy_bytes(metadata, (uint8_t *) sh->Comp.LocalSize,
+                   sizeof(sh->Comp.LocalSize));
+
+   sh->NumImages = blob_read_uint32(metadata);
+   blob_copy_bytes(metadata, (uint8_t *) sh->ImageUnits,
+                   sizeof(sh->ImageUnits));
+   for (unsigned i = 0; i < MAX_IMAGE_UNIFORMS; i++)
+      sh->ImageAccess[i] = blob_read_uint32(metadata);
+
+   sh->NumBufferInterfaceBlocks = blob_read_uint32(metadata);
+   if (metadata->overrun)
+      goto fail;
+
+   sh->BufferInterfaceBlocks =
+      ralloc_array(sh, gl_uniform_block *, sh->NumBufferInterfaceBlocks);
+   for (unsigned i = 0; i < sh->NumBufferInterfaceBlocks; i++) {
+      uint32_t index = blob_read_uint32(metadata);
+      if (index >= prog->NumBufferInterfaceBlocks)
+         goto fail;
+      sh->BufferInterfaceBlocks[i] = &prog->BufferInterfaceBlocks[index];
+   }
+
+   split_ubos_and_ssbos(sh,
+                        sh->BufferInterfaceBlocks,
+                        NULL,
+                        sh->NumBufferInterfaceBlocks,
+                        &sh->UniformBlocks,
+                        &sh->NumUniformBlocks,
+                        &sh->ShaderStorageBlocks,
+                        &sh->NumShaderStorageBlocks);
+
+   sh->NumAtomicBuffers = blob_read_uint32(metadata);
+   if (metadata->overrun)
+      goto fail;
+
+   /* Allocated off the program like link_assign_atomic_counter_resources()
+    * does.
+    */
+   sh->AtomicBuffers = rzalloc_array(prog, gl_active_atomic_buffer *,
+                                     sh->NumAtomicBuffers);
+   for (unsigned i = 0; i < sh->NumAtomicBuffers; i++) {
+      uint32_t index = blob_read_uint32(metadata);
+      if (index >= prog->NumAtomicBuffers)
+         goto fail;
+      sh->AtomicBuffers[i] = &prog->AtomicBuffers[index];
+   }
+
+   sh->NumSubroutineUniformTypes = blob_read_uint32(metadata);
+   sh->NumSubroutineUniformRemapTable = blob_read_uint32(metadata);
+   if (metadata->overrun)
+      goto fail;
+
+   sh->SubroutineUniformRemapTable =
+      rzalloc_array(sh, struct gl_uniform_storage *,
+                    sh->NumSubroutineUniformRemapTable);
+   for (unsigned i = 0; i < sh->NumSubroutineUniformRemapTable; i++) {
+      if (!read_uniform_pointer(metadata, prog,
+                                &sh->SubroutineUniformRemapTable[i]))
+         goto fail;
+   }
+
+   sh->NumSubroutineFunctions = blob_read_uint32(metadata);
+   if (metadata->overrun)
+      goto fail;
+
+   sh->SubroutineFunctions = rzalloc_array(sh, struct gl_subroutine_function,
+                                           sh->NumSubroutineFunctions);
+   for (unsigned i = 0; i < sh->NumSubroutineFunctions; i++) {
+      struct gl_subroutine_function *fn = &sh->SubroutineFunctions[i];
+
+      fn->name = ralloc_strdup(sh, blob_read_string(metadata));
+      fn->index = blob_read_uint32(metadata);
+      fn->num_compat_types = blob_read_uint32(metadata);
+      if (metadata->overrun)
+         goto fail;
+
+      fn->types = ralloc_array(sh, const struct glsl_type *,
+                               fn->num_compat_types);
+      for (int j = 0; j < fn->num_compat_types; j++)
+         fn->types[j] = decode_type_from_blob(metadata);
+   }
+
+   if (metadata->overrun)
+      goto fail;
+
+   return sh;
+
+fail:
+   _mesa_delete_shader(ctx, sh);
+   return NULL;
+}
+
+static void
+write_shader_variable(struct blob *metadata,
+                      const struct gl_shader_variable *var)
+{
+   encode_type_to_blob(metadata, var->type);
+   blob_write_string(metadata, var->name);
+   blob_write_uint32(metadata, var->location);
+   blob_write_uint32(metadata, var->index);
+   blob_write_uint32(metadata, var->patch);
+   blob_write_uint32(metadata, var->mode);
+}
+
+static struct gl_shader_variable *
+read_shader_variable(struct blob_reader *metadata,
+                     struct gl_shader_program *prog)
+{
+   gl_shader_variable *var = ralloc(prog, struct gl_shader_variable);
+   if (var == NULL)
+      return NULL;
+
+   var->type = decode_type_from_blob(metadata);
+   var->name = ralloc_strdup(prog, blob_read_string(metadata));
+   var->location = blob_read_uint32(metadata);
+   var->index = blob_read_uint32(metadata);
+   var->patch = blob_read_uint32(metadata);
+   var->mode = blob_read_uint32(metadata);
+
+   return var;
+}
+
+static void
+write_program_resource_list(struct blob *metadata,
+                            struct gl_shader_program *prog)
+{
+   blob_write_uint32(metadata, prog->NumProgramResourceList);
+
+   for (unsigned i = 0; i < prog->NumProgramResourceList; i++) {
+      const struct gl_program_resource *res = &prog->ProgramResourceList[i];
+
+      blob_write_uint32(metadata, res->Type);
+      blob_write_uint32(metadata, res->StageReferences);
+
+      switch (res->Type) {
+      case GL_PROGRAM_INPUT:
+      case GL_PROGRAM_OUTPUT:
+         write_shader_variable(metadata,
+                               (const struct gl_shader_variable *) res->Data);
+         break;
+      case GL_UNIFORM:
+      case GL_BUFFER_VARIABLE:
+      case GL_VERTEX_SUBROUTINE_UNIFORM:
+      case GL_GEOMETRY_SUBROUTINE_UNIFORM:
+      case GL_FRAGMENT_SUBROUTINE_UNIFORM:
+      case GL_COMPUTE_SUBROUTINE_UNIFORM:
+      case GL_TESS_CONTROL_SUBROUTINE_UNIFORM:
+      case GL_TESS_EVALUATION_SUBROUTINE_UNIFORM:
+         blob_write_uint32(metadata,
+                           (const struct gl_uniform_storage *) res->Data -
+                           prog->UniformStorage);
+         break;
+      case GL_UNIFORM_BLOCK:
+      case GL_SHADER_STORAGE_BLOCK:
+         blob_write_uint32(metadata,
+                           (const struct gl_uniform_block *) res->Data -
+                           prog->BufferInterfaceBlocks);
+         break;
+      case GL_ATOMIC_COUNTER_BUFFER:
+         blob_write_uint32(metadata,
+                           (const struct gl_active_atomic_buffer *) res->Data -
+                           prog->AtomicBuffers);
+         break;
+      case GL_TRANSFORM_FEEDBACK_VARYING:
+         blob_write_uint32(metadata,
+                           (const struct gl_transform_feedback_varying_info *)
+                           res->Data - prog->LinkedTransformFeedback.Varyings);
+         break;
+      case GL_VERTEX_SUBROUTINE:
+      case GL_GEOMETRY_SUBROUTINE:
+      case GL_FRAGMENT_SUBROUTINE:
+      case GL_COMPUTE_SUBROUTINE:
+      case GL_TESS_CONTROL_SUBROUTINE:
+      case GL_TESS_EVALUATION_SUBROUTINE: {
+         gl_shader_stage stage = _mesa_shader_stage_from_subroutine(res->Type);
+         blob_write_uint32(metadata,
+                           (const struct gl_subroutine_function *) res->Data -
+                           prog->_LinkedShaders[stage]->SubroutineFunctions);
+         break;
+      }
+      default:
+         unreachable("unknown program resource type");
+      }
+   }
+}
+
+static bool
+read_program_resource_list(struct blob_reader *metadata,
+                           struct gl_shader_program *prog)
+{
+   prog->NumProgramResourceList = blob_read_uint32(metadata);
+   if (metadata->overrun)
+      return false;
+
+   prog->ProgramResourceList =
+      ralloc_array(prog, gl_program_resource, prog->NumProgramResourceList);
+   if (prog->ProgramResourceList == NULL)
+      return false;
+
+   for (unsigned i = 0; i < prog->NumProgramResourceList; i++) {
+      struct gl_program_resource *res = &prog->ProgramResourceList[i];
+      uint32_t index;
+
+      res->Type = blob_read_uint32(metadata);
+      res->StageReferences = blob_read_uint32(metadata);
+      res->Data = NULL;
+
+      switch (res->Type) {
+      case GL_PROGRAM_INPUT:
+      case GL_PROGRAM_OUTPUT:
+         res->Data = read_shader_variable(metadata, prog);
+         break;
+      case GL_UNIFORM:
+      case GL_BUFFER_VARIABLE:
+      case GL_VERTEX_SUBROUTINE_UNIFORM:
+      case GL_GEOMETRY_SUBROUTINE_UNIFORM:
+      case GL_FRAGMENT_SUBROUTINE_UNIFORM:
+      case GL_COMPUTE_SUBROUTINE_UNIFORM:
+      case GL_TESS_CONTROL_SUBROUTINE_UNIFORM:
+      case GL_TESS_EVALUATION_SUBROUTINE_UNIFORM:
+         index = blob_read_uint32(metadata);
+         if (index < prog->NumUniformStorage)
+            res->Data = &prog->UniformStorage[index];
+         break;
+      case GL_UNIFORM_BLOCK:
+      case GL_SHADER_STORAGE_BLOCK:
+         index = blob_read_uint32(metadata);
+         if (index < prog->NumBufferInterfaceBlocks)
+            res->Data = &prog->BufferInterfaceBlocks[index];
+         break;
+      case GL_ATOMIC_COUNTER_BUFFER:
+         index = blob_read_uint32(metadata);
+         if (index < prog->NumAtomicBuffers)
+            res->Data = &prog->AtomicBuffers[index];
+         break;
+      case GL_TRANSFORM_FEEDBACK_VARYING:
+         index = blob_read_uint32(metadata);
+         if ((int) index < prog->LinkedTransformFeedback.NumVarying)
+            res->Data = &prog->LinkedTransformFeedback.Varyings[index];
+         break;
+      case GL_VERTEX_SUBROUTINE:
+      case GL_GEOMETRY_SUBROUTINE:
+      case GL_FRAGMENT_SUBROUTINE:
+      case GL_COMPUTE_SUBROUTINE:
+      case GL_TESS_CONTROL_SUBROUTINE:
+      case GL_TESS_EVALUATION_SUBROUTINE: {
+         gl_shader_stage stage = _mesa_shader_stage_from_subroutine(res->Type);
+         struct gl_shader *sh = prog->_LinkedShaders[stage];
+
+         index = blob_read_uint32(metadata);
+         if (sh && index < sh->NumSubroutineFunctions)
+            res->Data = &sh->SubroutineFunctions[index];
+         break;
+      }
+      default:
+         return false;
+      }
+
+      if (metadata->overrun || res->Data == NULL)
+         return false;
+   }
+
+   return true;
+}
+
+static void
+write_program_state(struct blob *metadata, struct gl_shader_program *prog)
+{
+   blob_write_uint32(metadata, prog->Version);
+   blob_write_uint32(metadata, prog->IsES);
+   blob_write_uint32(metadata, prog->FragDepthLayout);
+   blob_write_uint32(metadata, prog->TessCtrl.VerticesOut);
+   blob_write_uint32(metadata, prog->TessEval.PrimitiveMode);
+   blob_write_uint32(metadata, prog->TessEval.Spacing);
+   blob_write_uint32(metadata, prog->TessEval.VertexOrder);
+   blob_write_uint32(metadata, prog->TessEval.PointMode);
+   blob_write_uint32(metadata, prog->TessEval.ClipDistanceArraySize);
+   blob_write_uint32(metadata, prog->Geom.VerticesIn);
+   blob_write_uint32(metadata, prog->Geom.VerticesOut);
+   blob_write_uint32(metadata, prog->Geom.Invocations);
+   blob_write_uint32(metadata, prog->Geom.InputType);
+   blob_write_uint32(metadata, prog->Geom.OutputType);
+   blob_write_uint32(metadata, prog->Geom.ClipDistanceArraySize);
+   blob_write_uint32(metadata, prog->Geom.UsesEndPrimitive);
+   blob_write_uint32(metadata, prog->Geom.UsesStreams);
+   blob_write_uint32(metadata, prog->Vert.ClipDistanceArraySize);
+   blob_write_bytes(metadata, prog->Comp.LocalSize,
+                    sizeof(prog->Comp.LocalSize));
+   blob_write_uint32(metadata, prog->Comp.SharedSize);
+   blob_write_uint32(metadata, prog->LastClipDistanceArraySize);
+   blob_write_uint32(metadata, prog->ARB_fragment_coord_conventions_enable);
+}
+
+static void
+read_program_state(struct blob_reader *metadata,
+                   struct gl_shader_program *prog)
+{
+   prog->Version = blob_read_uint32(metadata);
+   prog->IsES = blob_read_uint32(metadata);
+   prog->FragDepthLayout = (gl_frag_depth_layout) blob_read_uint32(metadata);
+   prog->TessCtrl.VerticesOut = blob_read_uint32(metadata);
+   prog->TessEval.PrimitiveMode = blob_read_uint32(metadata);
+   prog->TessEval.Spacing = blob_read_uint32(metadata);
+   prog->TessEval.VertexOrder = blob_read_uint32(metadata);
+   prog->TessEval.PointMode = blob_read_uint32(metadata);
+   prog->TessEval.ClipDistanceArraySize = blob_read_uint32(metadata);
+   prog->Geom.VerticesIn = blob_read_uint32(metadata);
+   prog->Geom.VerticesOut = blob_read_uint32(metadata);
+   prog->Geom.Invocations = blob_read_uint32(metadata);
+   prog->Geom.InputType = blob_read_uint32(metadata);
+   prog->Geom.OutputType = blob_read_uint32(metadata);
+   prog->Geom.ClipDistanceArraySize = blob_read_uint32(metadata);
+   prog->Geom.UsesEndPrimitive = blob_read_uint32(metadata);
+   prog->Geom.UsesStreams = blob_read_uint32(metadata);
+   prog->Vert.ClipDistanceArraySize = blob_read_uint32(metadata);
+   blob_copy_bytes(metadata, (uint8_t *) prog->Comp.LocalSize,
+                   sizeof(prog->Comp.LocalSize));
+   prog->Comp.SharedSize = blob_read_uint32(metadata);
+   prog->LastClipDistanceArraySize = blob_read_uint32(metadata);
+   prog->ARB_fragment_coord_conventions_enable = blob_read_uint32(metadata);
+}
+
+struct binding_closure {
+   struct mesa_sha1 *ctx;
+};
+
+static void
+hash_binding(const char *key, unsigned value, void *closure)
+{
+   struct mesa_sha1 *sha1_ctx = ((struct binding_closure *) closure)->ctx;
+
+   _mesa_sha1_update(sha1_ctx, key, strlen(key) + 1);
+   _mesa_sha1_update(sha1_ctx, &value, sizeof(value));
+}
+
+static void
+hash_bindings(struct mesa_sha1 *sha1_ctx, struct string_to_uint_map *map)
+{
+   struct binding_closure closure = { sha1_ctx };
+   static const char separator = 0;
+
+   if (map)
+      map->iterate(hash_binding, &closure);
+
+   _mesa_sha1_update(sha1_ctx, &separator, sizeof(separator));
+}
+
+bool
+shader_cache_compute_program_key(struct gl_context *ctx,
+                                 struct gl_shader_program *prog,
+                                 cache_key key)
+{
+   struct mesa_sha1 *sha1_ctx;
+   unsigned char sha1[20];
+
+   if (ctx->Cache == NULL || ctx->Driver.LinkShaderFromCache == NULL)
+      return false;
+
+   if (prog->NumShaders == 0)
+      return false;
+
+   sha1_ctx = _mesa_sha1_init();
+   if (sha1_ctx == NULL)
+      return false;
+
+   /* Anything that can change the output of the compiler or the linker
+    * for a given set of sources.  The driver identity has already been
+    * folded in by the disk cache.
+    */
+   _mesa_sha1_update(sha1_ctx, &ctx->API, sizeof(ctx->API));
+   _mesa_sha1_update(sha1_ctx, &ctx->Version, sizeof(ctx->Version));
+   _mesa_sha1_update(sha1_ctx, &ctx->Extensions, sizeof(ctx->Extensions));
+   _mesa_sha1_update(sha1_ctx, &ctx->Const.GLSLVersion,
+                     sizeof(ctx->Const.GLSLVersion));
+   _mesa_sha1_update(sha1_ctx, &ctx->Shader.Flags, sizeof(ctx->Shader.Flags));
+
+   for (unsigned i = 0; i < prog->NumShaders; i++) {
+      struct gl_shader *sh = prog->Shaders[i];
+
+      if (sh->Source == NULL) {
+         _mesa_sha1_final(sha1_ctx, sha1);
+         return false;
+      }
+
+      _mesa_sha1_compute(sh->Source, strlen(sh->Source), sha1);
+      _mesa_sha1_update(sha1_ctx, &sh->Type, sizeof(sh->Type));
+      _mesa_sha1_update(sha1_ctx, sha1, sizeof(sha1));
+   }
+
+   hash_bindings(sha1_ctx, prog->AttributeBindings);
+   hash_bindings(sha1_ctx, prog->FragDataBindings);
+   hash_bindings(sha1_ctx, prog->FragDataIndexBindings);
+
+   _mesa_sha1_update(sha1_ctx, &prog->SeparateShader,
+                     sizeof(prog->SeparateShader));
+   _mesa_sha1_update(sha1_ctx, &prog->TransformFeedback.BufferMode,
+                     sizeof(prog->TransformFeedback.BufferMode));
+   for (unsigned i = 0; i < prog->TransformFeedback.NumVarying; i++) {
+      const char *name = prog->TransformFeedback.VaryingNames[i];
+      _mesa_sha1_update(sha1_ctx, name, strlen(name) + 1);
+   }
+
+   _mesa_sha1_final(sha1_ctx, sha1);
+
+   disk_cache_compute_key(ctx->Cache, sha1, sizeof(sha1), key);
+
+   return true;
+}
+
+void
+shader_cache_write_program_metadata(struct gl_context *ctx,
+                                    struct gl_shader_program *prog,
+                                    const cache_key key)
+{
+   struct blob *metadata = blob_create(NULL);
+   uint32_t stage_mask = 0;
+
+   if (metadata == NULL)
+      return;
+
+   write_program_state(metadata, prog);
+   write_xfb(metadata, prog);
+   write_uniforms(metadata, prog);
+   write_uniform_remap_table(metadata, prog);
+   write_uniform_hash(metadata, prog->UniformHash);
+   write_buffer_blocks(metadata, prog);
+   write_atomic_buffers(metadata, prog);
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i])
+         stage_mask |= 1 << i;
+   }
+
+   blob_write_uint32(metadata, stage_mask);
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i])
+         write_linked_shader(metadata, prog, prog->_LinkedShaders[i]);
+   }
+
+   write_program_resource_list(metadata, prog);
+
+   blob_write_string(metadata, prog->InfoLog ? prog->InfoLog : "");
+
+   disk_cache_put(ctx->Cache, key, metadata->data, metadata->size);
+
+   ralloc_free(metadata);
+}
+
+static bool
+restore_program(struct gl_context *ctx, struct blob_reader *metadata,
+                struct gl_shader_program *prog)
+{
+   read_program_state(metadata, prog);
+
+   if (!read_xfb(metadata, prog) ||
+       !read_uniforms(metadata, prog) ||
+       !read_uniform_remap_table(metadata, prog) ||
+       !read_uniform_hash(metadata, prog) ||
+       !read_buffer_blocks(metadata, prog) ||
+       !read_atomic_buffers(metadata, prog))
+      return false;
+
+   uint32_t stage_mask = blob_read_uint32(metadata);
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (!(stage_mask & (1 << i)))
+         continue;
+
+      struct gl_shader *sh = read_linked_shader(ctx, metadata, prog);
+      if (sh == NULL || sh->Stage != i) {
+         if (sh)
+            _mesa_delete_shader(ctx, sh);
+         return false;
+      }
+
+      prog->_LinkedShaders[i] = sh;
+   }
+
+   if (!read_program_resource_list(metadata, prog))
+      return false;
+
+   const char *info_log = blob_read_string(metadata);
+   if (metadata->overrun)
+      return false;
+
+   ralloc_free(prog->InfoLog);
+   prog->InfoLog = ralloc_strdup(prog, info_log);
+
+   /* Detect truncated or stale entries that happen to parse. */
+   return metadata->current == metadata->end;
+}
+
+bool
+shader_cache_read_program_metadata(struct gl_context *ctx,
+                                   struct gl_shader_program *prog,
+                                   const cache_key key)
+{
+   struct blob_reader metadata;
+   size_t size;
+   uint8_t *buffer;
+
+   buffer = (uint8_t *) disk_cache_get(ctx->Cache, key, &size);
+   if (buffer == NULL)
+      return false;
+
+   /* The previous link results were already released by the caller. */
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i] != NULL)
+         _mesa_delete_shader(ctx, prog->_LinkedShaders[i]);
+
+      prog->_LinkedShaders[i] = NULL;
+   }
+
+   blob_reader_init(&metadata, buffer, size);
+
+   bool success = restore_program(ctx, &metadata, prog);
+
+   free(buffer);
+
+   if (!success) {
+      /* Stale or corrupt entry, drop it so we don't retry it next time. */
+      disk_cache_remove(ctx->Cache, key);
+
+      _mesa_clear_shader_program_data(prog);
+      for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+         if (prog->_LinkedShaders[i] != NULL)
+            _mesa_delete_shader(ctx, prog->_LinkedShaders[i]);
+
+         prog->_LinkedShaders[i] = NULL;
+      }
+   }
+
+   return success;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include "util/disk_cache.h"
+
+struct gl_context;
+struct gl_shader_program;
+
+#ifdef ENABLE_SHADER_CACHE
+
+/**
+ * Compute the key under which the linker results for \p prog are cached.
+ *
+ * The key covers the source of every attached shader together with all of
+ * the program state that influences linking (attribute and fragment data
+ * bindings, transform feedback varyings, separability, ...).
+ *
+ * \return false if the program cannot be cached, (no cache configured or
+ * driver support is missing).
+ */
+bool
+shader_cache_compute_program_key(struct gl_context *ctx,
+                                 struct gl_shader_program *prog,
+                                 cache_key key);
+
+/**
+ * Store the results of a successful link of \p prog in the cache.
+ *
+ * Everything the GL API needs to query a linked program is written:
+ * uniform storage and its initial values, the uniform remap tables, the
+ * program resource list, uniform and shader storage blocks, atomic
+ * buffers, transform feedback outputs and the per-stage state of the
+ * linked shaders, including subroutine tables.
+ */
+void
+shader_cache_write_program_metadata(struct gl_context *ctx,
+                                    struct gl_shader_program *prog,
+                                    const cache_key key);
+
+/**
+ * Restore \p prog from the data written by
+ * shader_cache_write_program_metadata().
+ *
+ * On success the linked shaders of \p prog exist but carry no IR; the
+ * driver is then expected to restore its programs through
+ * dd_function_table::LinkShaderFromCache.
+ *
+ * \return false on a cache miss or if the cached data could not be parsed,
+ * in which case \p prog is left without any link results.
+ */
+bool
+shader_cache_read_program_metadata(struct gl_context *ctx,
+                                   struct gl_shader_program *prog,
+                                   const cache_key key);
+
+#else
+
+static inline bool
+shader_cache_compute_program_key(struct gl_context *ctx,
+                                 struct gl_shader_program *prog,
+                                 cache_key key)
+{
+   return false;
+}
+
+static inline void
+shader_cache_write_program_metadata(struct gl_context *ctx,
+                                    struct gl_shader_program *prog,
+                                    const cache_key key)
+{
+   return;
+}
+
+static inline bool
+shader_cache_read_program_metadata(struct gl_context *ctx,
+                                   struct gl_shader_program *prog,
+                                   const cache_key key)
+{
+   return false;
+}
+
+#endif /* ENABLE_SHADER_CACHE */
+
+#endif /* SHADER_CACHE_H */
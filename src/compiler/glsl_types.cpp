@@ -808,33 +808,67 @@ glsl_type::get_image_instance(enum glsl_sampler_dim dim,
    unreachable("switch statement above should be complete");
 }
 
+namespace {
+
+/**
+ * Key of glsl_type::array_types
+ *
+ * The base type pointer is used rather than its name, as the name of the
+ * base type may not be unique across shaders.  For example, two shaders may
+ * have different record types named 'foo'.
+ */
+struct array_key {
+   const glsl_type *base;
+   unsigned size;
+};
+
+}
+
+static uint32_t
+array_key_hash(const void *a)
+{
+   const array_key *key = (const array_key *) a;
+
+   return _mesa_hash_pointer(key->base) * 31 + key->size;
+}
+
+static bool
+array_key_compare(const void *a, const void *b)
+{
+   const array_key *key1 = (const array_key *) a;
+   const array_key *key2 = (const array_key *) b;
+
+   return key1->base == key2->base && key1->size == key2->size;
+}
+
 const glsl_type *
 glsl_type::get_array_instance(const glsl_type *base, unsigned array_size)
 {
-   /* Generate a name using the base type pointer in the key.  This is
-    * done because the name of the base type may not be unique across
-    * shaders.  For example, two shaders may have different record types
-    * named 'foo'.
-    */
-   char key[128];
-   snprintf(key, sizeof(key), "%p[%u]", (void *) base, array_size);
+   array_key key;
+   key.base = base;
+   key.size = array_size;
+
+   const uint32_t hash = array_key_hash(&key);
 
    mtx_lock(&glsl_type::mutex);
 
    if (array_types == NULL) {
-      array_types = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
-                                            _mesa_key_string_equal);
+      array_types = _mesa_hash_table_create(NULL, array_key_hash,
+                                            array_key_compare);
    }
 
-   const struct hash_entry *entry = _mesa_hash_table_search(array_types, key);
+   const struct hash_entry *entry =
+      _mesa_hash_table_search_pre_hashed(array_types, hash, &key);
    if (entry == NULL) {
       mtx_unlock(&glsl_type::mutex);
       const glsl_type *t = new glsl_type(base, array_size);
       mtx_lock(&glsl_type::mutex);
 
-      entry = _mesa_hash_table_insert(array_types,
-                                      ralloc_strdup(mem_ctx, key),
-                                      (void *) t);
+      array_key *stored_key = ralloc(mem_ctx, array_key);
+      *stored_key = key;
+
+      entry = _mesa_hash_table_insert_pre_hashed(array_types, hash,
+                                                 stored_key, (void *) t);
    }
 
    assert(((glsl_type *) entry->data)->base_type == GLSL_TYPE_ARRAY);
@@ -938,7 +972,7 @@ unsigned
 glsl_type::record_key_hash(const void *a)
 {
    const glsl_type *const key = (glsl_type *) a;
-   uintptr_t hash = key->length;
+   uintptr_t hash = key->length ^ _mesa_hash_string(key->name);
    unsigned retval;
 
    for (unsigned i = 0; i < key->length; i++) {
@@ -57,6 +57,11 @@ nir_shader_create(void *mem_ctx,
 
    shader->stage = stage;
 
+   for (unsigned i = 0; i < ARRAY_SIZE(shader->free_alu_instrs); i++)
+      exec_list_make_empty(&shader->free_alu_instrs[i]);
+   exec_list_make_empty(&shader->free_load_const_instrs);
+   exec_list_make_empty(&shader->free_ssa_undef_instrs);
+
    return shader;
 }
 
@@ -352,6 +357,11 @@ nir_block_create(nir_shader *shader)
     */
    block->dom_frontier = _mesa_set_create(block, _mesa_hash_pointer,
                                           _mesa_key_pointer_equal);
+   block->num_dom_children = 0;
+   block->dom_children = NULL;
+
+   block->live_in = NULL;
+   block->live_out = NULL;
 
    exec_list_make_empty(&block->instr_list);
 
@@ -394,6 +404,7 @@ nir_loop_create(nir_shader *shader)
    nir_loop *loop = ralloc(shader, nir_loop);
 
    cf_init(&loop->cf_node, nir_cf_node_loop);
+   loop->info = NULL;
 
    nir_block *body = nir_block_create(shader);
    exec_list_make_empty(&loop->body);
@@ -442,12 +453,28 @@ alu_src_init(nir_alu_src *src)
    src->swizzle[3] = 3;
 }
 
+/* Takes an instruction from the free list if there is one, a fresh
+ * allocation otherwise.  Either way the memory comes back zeroed, like
+ * ralloc_size() does.
+ */
+static void *
+instr_alloc(nir_shader *shader, struct exec_list *free_list, size_t size)
+{
+   if (exec_list_is_empty(free_list))
+      return ralloc_size(shader, size);
+
+   nir_instr *instr = exec_node_data(nir_instr, exec_list_pop_head(free_list),
+                                     node);
+   memset(instr, 0, size);
+   return instr;
+}
+
 nir_alu_instr *
 nir_alu_instr_create(nir_shader *shader, nir_op op)
 {
    unsigned num_srcs = nir_op_infos[op].num_inputs;
    nir_alu_instr *instr =
-      ralloc_size(shader,
+      instr_alloc(shader, &shader->free_alu_instrs[num_srcs],
                   sizeof(nir_alu_instr) + num_srcs * sizeof(nir_alu_src));
 
    instr_init(&instr->instr, nir_instr_type_alu);
@@ -471,7 +498,9 @@ nir_jump_instr_create(nir_shader *shader, nir_jump_type type)
 nir_load_const_instr *
 nir_load_const_instr_create(nir_shader *shader, unsigned num_components)
 {
-   nir_load_const_instr *instr = ralloc(shader, nir_load_const_instr);
+   nir_load_const_instr *instr =
+      instr_alloc(shader, &shader->free_load_const_instrs,
+                  sizeof(nir_load_const_instr));
    instr_init(&instr->instr, nir_instr_type_load_const);
 
    nir_ssa_def_init(&instr->instr, &instr->def, num_components, 32, NULL);
@@ -560,7 +589,9 @@ nir_parallel_copy_instr_create(nir_shader *shader)
 nir_ssa_undef_instr *
 nir_ssa_undef_instr_create(nir_shader *shader, unsigned num_components)
 {
-   nir_ssa_undef_instr *instr = ralloc(shader, nir_ssa_undef_instr);
+   nir_ssa_undef_instr *instr =
+      instr_alloc(shader, &shader->free_ssa_undef_instrs,
+                  sizeof(nir_ssa_undef_instr));
    instr_init(&instr->instr, nir_instr_type_ssa_undef);
 
    nir_ssa_def_init(&instr->instr, &instr->def, num_components, 32, NULL);
@@ -918,6 +949,68 @@ void nir_instr_remove(nir_instr *instr)
    }
 }
 
+/* Sources and destinations only own memory if they have an indirect and
+ * SSA defs only if they were given a name.
+ */
+static bool
+src_is_leaf(const nir_src *src)
+{
+   return src->is_ssa || src->reg.indirect == NULL;
+}
+
+static bool
+dest_is_leaf(const nir_dest *dest)
+{
+   return dest->is_ssa ? dest->ssa.name == NULL : dest->reg.indirect == NULL;
+}
+
+static struct exec_list *
+instr_free_list(nir_shader *shader, nir_instr *instr)
+{
+   switch (instr->type) {
+   case nir_instr_type_alu: {
+      nir_alu_instr *alu = nir_instr_as_alu(instr);
+      unsigned num_srcs = nir_op_infos[alu->op].num_inputs;
+
+      if (!dest_is_leaf(&alu->dest.dest))
+         return NULL;
+      for (unsigned i = 0; i < num_srcs; i++) {
+         if (!src_is_leaf(&alu->src[i].src))
+            return NULL;
+      }
+
+      return &shader->free_alu_instrs[num_srcs];
+   }
+
+   case nir_instr_type_load_const:
+      if (nir_instr_as_load_const(instr)->def.name)
+         return NULL;
+      return &shader->free_load_const_instrs;
+
+   case nir_instr_type_ssa_undef:
+      if (nir_instr_as_ssa_undef(instr)->def.name)
+         return NULL;
+      return &shader->free_ssa_undef_instrs;
+
+   default:
+      return NULL;
+   }
+}
+
+void
+nir_instr_free(nir_shader *shader, nir_instr *instr)
+{
+   /* Only recycle memory that really belongs to this shader; anything else
+    * (and anything holding on to other allocations) is swept up eventually.
+    */
+   if (ralloc_parent(instr) != shader)
+      return;
+
+   struct exec_list *free_list = instr_free_list(shader, instr);
+   if (free_list)
+      exec_list_push_head(free_list, &instr->node);
+}
+
 /*@}*/
 
 void
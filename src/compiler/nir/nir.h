@@ -444,7 +444,10 @@ typedef struct nir_ssa_def {
    /** generic SSA definition index. */
    unsigned index;
 
-   /** Index into the live_in and live_out bitfields */
+   /**
+    * Position of the definition in the function, in block order, as
+    * computed by nir_live_ssa_defs_impl().  0 for ssa_undef values.
+    */
    unsigned live_index;
 
    nir_instr *parent_instr;
@@ -459,6 +462,13 @@ typedef struct nir_ssa_def {
 
    /* The bit-size of each channel; must be one of 8, 16, 32, or 64 */
    uint8_t bit_size;
+
+   /**
+    * Index into the live_in and live_out bitfields.  Values that are never
+    * live across a block boundary (and ssa_undefs) share the index 0, which
+    * is never set.
+    */
+   unsigned live_set_index;
 } nir_ssa_def;
 
 struct nir_src;
@@ -1439,10 +1449,40 @@ nir_if_last_else_node(nir_if *if_stmt)
    return exec_node_data(nir_cf_node, tail, node);
 }
 
+/**
+ * Information about a loop gathered by nir_loop_analyze_impl().  Only valid
+ * while nir_metadata_loop_analysis is.
+ */
+typedef struct {
+   /** Number of instructions in the loop, including nested control flow */
+   unsigned num_instructions;
+
+   /**
+    * The if statement at the top of the loop that breaks out of it, or NULL
+    * if the loop doesn't have that shape.  The loop must not have any other
+    * way out and there may not be any continues.
+    */
+   nir_if *terminator;
+
+   /** True if the break is in the else side of the terminator */
+   bool break_in_else;
+
+   /** True if trip_count is valid */
+   bool trip_count_known;
+
+   /**
+    * Number of times the body after the terminator runs before the loop
+    * exits.  The part of the loop before the terminator runs one more time.
+    */
+   unsigned trip_count;
+} nir_loop_info;
+
 typedef struct {
    nir_cf_node cf_node;
 
    struct exec_list body; /** < list of nir_cf_node */
+
+   nir_loop_info *info;
 } nir_loop;
 
 static inline nir_cf_node *
@@ -1467,6 +1507,7 @@ typedef enum {
    nir_metadata_dominance = 0x2,
    nir_metadata_live_ssa_defs = 0x4,
    nir_metadata_not_properly_reset = 0x8,
+   nir_metadata_loop_analysis = 0x10,
 } nir_metadata;
 
 typedef struct {
@@ -1623,6 +1664,21 @@ typedef struct nir_shader_compiler_options {
     * are simulated by floats.)
     */
    bool native_integers;
+
+   /**
+    * Limits for nir_opt_loop_unroll.  Loops are only unrolled if they run at
+    * most max_unroll_iterations times and the unrolled code is at most
+    * max_unroll_instructions long.  Zero disables unrolling.
+    */
+   unsigned max_unroll_iterations;
+   unsigned max_unroll_instructions;
+
+   /**
+    * Number of 32-bit register components nir_opt_gcm may let the values
+    * live across a loop add up to when it hoists code out of the loop.
+    * Zero means no limit.
+    */
+   unsigned gcm_register_budget;
 } nir_shader_compiler_options;
 
 typedef struct nir_shader_info {
@@ -1756,6 +1812,15 @@ typedef struct nir_shader {
 
    /** The shader stage, such as MESA_SHADER_VERTEX. */
    gl_shader_stage stage;
+
+   /**
+    * Instructions handed back with nir_instr_free(), waiting to be reused by
+    * the corresponding _create() function.  ALU instructions are binned by
+    * their number of sources (0 to 4) since that determines their size.
+    */
+   struct exec_list free_alu_instrs[5];
+   struct exec_list free_load_const_instrs;
+   struct exec_list free_ssa_undef_instrs;
 } nir_shader;
 
 #define nir_foreach_function(shader, func) \
@@ -2023,6 +2088,16 @@ nir_instr_insert_after_cf_list(struct exec_list *list, nir_instr *after)
 
 void nir_instr_remove(nir_instr *instr);
 
+/** Hands an instruction that has been removed and is known to be dead back
+ * to the shader, so that its memory can be reused for a new instruction of
+ * the same type.  Only ALU, load_const and ssa_undef instructions which
+ * don't own any other allocations are recycled; anything else is left for
+ * nir_sweep() to clean up.  The caller must not touch the instruction
+ * afterwards, so passes should only do this once nothing else can still
+ * point at it.
+ */
+void nir_instr_free(nir_shader *shader, nir_instr *instr);
+
 /** @} */
 
 typedef bool (*nir_foreach_ssa_def_cb)(nir_ssa_def *def, void *state);
@@ -2105,8 +2180,39 @@ static inline void nir_metadata_check_validation_flag(nir_shader *shader) { (voi
 static inline bool should_clone_nir(void) { return false; }
 #endif /* DEBUG */
 
-#define _PASS(nir, do_pass) do {                                     \
+/* Runtime pass statistics, enabled by NIR_PASS_STATS (see nir_pass_stats.c) */
+struct nir_pass_sample {
+   int64_t start_ns;
+   unsigned num_instrs;
+};
+
+bool nir_pass_stats_init(void);
+void nir_pass_stats_begin(nir_shader *shader, struct nir_pass_sample *sample);
+void nir_pass_stats_end(nir_shader *shader, struct nir_pass_sample *sample,
+                        const char *name, int progress);
+void nir_pass_stats_loop(const char *name, unsigned iterations);
+
+static inline bool
+nir_should_record_pass_stats(void)
+{
+   static int should_record = -1;
+   if (should_record < 0)
+      should_record = nir_pass_stats_init();
+
+   return should_record;
+}
+
+/* do_pass sets _pass_progress to the pass's return value, if it has one */
+#define _PASS(nir, pass_name, do_pass) do {                          \
+   struct nir_pass_sample _pass_sample;                              \
+   const bool _record_stats = nir_should_record_pass_stats();        \
+   int _pass_progress = -1;                                          \
+   if (_record_stats)                                                \
+      nir_pass_stats_begin(nir, &_pass_sample);                      \
    do_pass                                                           \
+   if (_record_stats)                                                \
+      nir_pass_stats_end(nir, &_pass_sample, pass_name,              \
+                         _pass_progress);                            \
    nir_validate_shader(nir);                                         \
    if (should_clone_nir()) {                                         \
       nir_shader *clone = nir_shader_clone(ralloc_parent(nir), nir); \
@@ -2115,15 +2221,16 @@ static inline bool should_clone_nir(void) { return false; }
    }                                                                 \
 } while (0)
 
-#define NIR_PASS(progress, nir, pass, ...) _PASS(nir,                \
+#define NIR_PASS(progress, nir, pass, ...) _PASS(nir, #pass,         \
    nir_metadata_set_validation_flag(nir);                            \
-   if (pass(nir, ##__VA_ARGS__)) {                                   \
+   _pass_progress = pass(nir, ##__VA_ARGS__);                        \
+   if (_pass_progress) {                                             \
       progress = true;                                               \
       nir_metadata_check_validation_flag(nir);                       \
    }                                                                 \
 )
 
-#define NIR_PASS_V(nir, pass, ...) _PASS(nir,                        \
+#define NIR_PASS_V(nir, pass, ...) _PASS(nir, #pass,                 \
    pass(nir, ##__VA_ARGS__);                                         \
 )
 
@@ -2255,6 +2362,8 @@ bool nir_normalize_cubemap_coords(nir_shader *shader);
 void nir_live_ssa_defs_impl(nir_function_impl *impl);
 bool nir_ssa_defs_interfere(nir_ssa_def *a, nir_ssa_def *b);
 
+void nir_loop_analyze_impl(nir_function_impl *impl);
+
 void nir_convert_to_ssa_impl(nir_function_impl *impl);
 void nir_convert_to_ssa(nir_shader *shader);
 
@@ -2281,7 +2390,24 @@ bool nir_opt_dce(nir_shader *shader);
 
 bool nir_opt_dead_cf(nir_shader *shader);
 
-void nir_opt_gcm(nir_shader *shader);
+void nir_opt_gcm(nir_shader *shader, bool value_number);
+
+/**
+ * Asked by nir_opt_load_store_vectorize whether a combined access of the
+ * given intrinsic with num_components 32-bit components can be used, when
+ * its byte offset is known to be align_offset modulo align_mul.
+ */
+typedef bool (*nir_should_vectorize_mem_func)(nir_intrinsic_op intrin,
+                                              unsigned num_components,
+                                              unsigned align_mul,
+                                              unsigned align_offset,
+                                              void *data);
+
+bool nir_opt_load_store_vectorize(nir_shader *shader,
+                                  nir_should_vectorize_mem_func callback,
+                                  void *data);
+
+bool nir_opt_loop_unroll(nir_shader *shader);
 
 bool nir_opt_peephole_select(nir_shader *shader);
 
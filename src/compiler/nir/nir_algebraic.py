@@ -30,6 +30,8 @@ import sys
 import mako.template
 import re
 
+from nir_opcodes import opcodes
+
 # Represents a set of variables, each with a unique id
 class VarSet(object):
    def __init__(self):
@@ -197,6 +199,127 @@ class SearchAndReplace(object):
       else:
          self.replace = Value.create(replace, "replace{0}".format(self.id), varset)
 
+class TreeAutomaton(object):
+   """Bottom-up tree automaton matching the search expressions of a pass.
+
+   Every sub-expression of the search expressions is an "item", with
+   variables reduced to a wildcard item, or to a constant item when they
+   only match constants.  The state of an SSA value is the set of items it
+   may match, looking at opcodes only.  It is computed from the opcode and
+   the states of the sources with a table lookup, after projecting each
+   source state onto the items that can appear as sources of that opcode
+   ("filtering"), which keeps the tables small.
+
+   The state of an instruction then selects the transforms whose search
+   expression may match it; match_expression() in nir_search.c checks the
+   rest (variables, constant values, types, swizzles, exactness).
+   """
+
+   WILDCARD = 0
+   CONST = 1
+
+   def __init__(self, transforms):
+      self.items = [('__wildcard',), ('__const',)]
+      self.item_ids = {}
+      self.opcode_items = {}
+
+      self.xform_items = [self._add_item(xform.search)
+                          for xform in transforms]
+      self.opcodes = sorted(self.opcode_items.keys())
+
+      self._build_tables()
+
+      # Transforms to try for each state, in the order of the pass.
+      self.state_xforms = [[i for (i, item) in enumerate(self.xform_items)
+                            if item in state]
+                           for state in self.states]
+
+   def _add_item(self, val):
+      if isinstance(val, Expression):
+         assert len(val.sources) == opcodes[val.opcode].num_inputs
+         item = (val.opcode,) + tuple(self._add_item(src)
+                                      for src in val.sources)
+         if item not in self.item_ids:
+            self.item_ids[item] = len(self.items)
+            self.items.append(item)
+            self.opcode_items.setdefault(val.opcode, []) \
+                             .append(self.item_ids[item])
+         return self.item_ids[item]
+      elif isinstance(val, Constant) or val.is_constant:
+         return self.CONST
+      else:
+         return self.WILDCARD
+
+   def _match(self, opcode, filtered):
+      """Items of opcode matching an instruction with the given filtered
+      source states."""
+      commutative = 'commutative' in opcodes[opcode].algebraic_properties
+      state = set([self.WILDCARD])
+      for item_id in self.opcode_items[opcode]:
+         srcs = self.items[item_id][1:]
+         if all(src in filtered[i] for (i, src) in enumerate(srcs)) or \
+            (commutative and srcs[0] in filtered[1] and srcs[1] in filtered[0]):
+            state.add(item_id)
+      return frozenset(state)
+
+   def _build_tables(self):
+      # State 0 is that of any value which is not an ALU instruction we
+      # have patterns for, state 1 that of load_const instructions.
+      self.states = [frozenset([self.WILDCARD]),
+                     frozenset([self.WILDCARD, self.CONST])]
+      state_ids = dict((state, i) for (i, state) in enumerate(self.states))
+
+      src_items = {}
+      for opcode in self.opcodes:
+         src_items[opcode] = frozenset(src
+                                       for item_id in self.opcode_items[opcode]
+                                       for src in self.items[item_id][1:])
+
+      self.filters = dict((opcode, []) for opcode in self.opcodes)
+      self.state_filter = dict((opcode, []) for opcode in self.opcodes)
+      self.tables = dict((opcode, {}) for opcode in self.opcodes)
+      filter_ids = dict((opcode, {}) for opcode in self.opcodes)
+
+      # Processing a state may add filters, whose table entries may add
+      # states in turn; this stops as there are finitely many item sets.
+      next_state = 0
+      while next_state < len(self.states):
+         state = self.states[next_state]
+         next_state += 1
+
+         for opcode in self.opcodes:
+            filtered = state & src_items[opcode]
+            if filtered in filter_ids[opcode]:
+               self.state_filter[opcode].append(filter_ids[opcode][filtered])
+               continue
+
+            filter_id = len(self.filters[opcode])
+            filter_ids[opcode][filtered] = filter_id
+            self.filters[opcode].append(filtered)
+            self.state_filter[opcode].append(filter_id)
+
+            num_inputs = opcodes[opcode].num_inputs
+            for srcs in itertools.product(range(len(self.filters[opcode])),
+                                          repeat=num_inputs):
+               if filter_id not in srcs:
+                  continue
+               result = self._match(opcode, [self.filters[opcode][f]
+                                             for f in srcs])
+               if result not in state_ids:
+                  state_ids[result] = len(self.states)
+                  self.states.append(result)
+               self.tables[opcode][srcs] = state_ids[result]
+
+      assert len(self.states) <= 1 << 16
+
+   def table(self, opcode):
+      """Flattened table of opcode, indexed by
+      ((filter[src0] * num_filters) + filter[src1]) * num_filters + ..."""
+      num_inputs = opcodes[opcode].num_inputs
+      return [self.tables[opcode][srcs]
+              for srcs in itertools.product(range(len(self.filters[opcode])),
+                                            repeat=num_inputs)]
+
 _algebraic_pass_template = mako.template.Template("""
 #include "nir.h"
 #include "nir_search.h"
@@ -210,26 +333,125 @@ struct transform {
    unsigned condition_offset;
 };
 
+struct transform_list {
+   const struct transform *xforms;
+   unsigned num_xforms;
+};
+
+struct per_op_table {
+   /** Maps automaton states of the sources to indices into table */
+   const uint16_t *filter;
+   unsigned num_filtered_states;
+   /** Next state, indexed by the filtered states of all sources */
+   const uint16_t *table;
+};
+
 struct opt_state {
    void *mem_ctx;
    bool progress;
    const bool *condition_flags;
+   /** Automaton state of each SSA def, indexed by nir_ssa_def::index */
+   uint16_t *states;
+   unsigned num_states;
 };
 
 #endif
 
-% for (opcode, xform_list) in xform_dict.iteritems():
-% for xform in xform_list:
+% for xform in xforms:
    ${xform.search.render()}
    ${xform.replace.render()}
 % endfor
 
-static const struct transform ${pass_name}_${opcode}_xforms[] = {
-% for xform in xform_list:
-   { &${xform.search.name}, ${xform.replace.c_ptr}, ${xform.condition_index} },
+% for state_id, state_xforms in enumerate(automaton.state_xforms):
+% if state_xforms:
+static const struct transform ${pass_name}_state${state_id}_xforms[] = {
+% for i in state_xforms:
+   { &${xforms[i].search.name}, ${xforms[i].replace.c_ptr}, ${xforms[i].condition_index} },
+% endfor
+};
+% endif
+% endfor
+
+static const struct transform_list ${pass_name}_transforms[] = {
+% for state_id, state_xforms in enumerate(automaton.state_xforms):
+% if state_xforms:
+   { ${pass_name}_state${state_id}_xforms, ARRAY_SIZE(${pass_name}_state${state_id}_xforms) },
+% else:
+   { NULL, 0 },
+% endif
+% endfor
+};
+
+% for opcode in automaton.opcodes:
+static const uint16_t ${pass_name}_${opcode}_filter[] = {
+% for i in range(0, len(automaton.state_filter[opcode]), 16):
+   ${', '.join(str(f) for f in automaton.state_filter[opcode][i:i + 16])},
 % endfor
 };
+
+<% table = automaton.table(opcode) %>
+static const uint16_t ${pass_name}_${opcode}_table[] = {
+% for i in range(0, len(table), 16):
+   ${', '.join(str(s) for s in table[i:i + 16])},
+% endfor
+};
+
 % endfor
+static const struct per_op_table ${pass_name}_table[nir_num_opcodes] = {
+% for opcode in automaton.opcodes:
+   [nir_op_${opcode}] = {
+      ${pass_name}_${opcode}_filter,
+      ${len(automaton.filters[opcode])},
+      ${pass_name}_${opcode}_table,
+   },
+% endfor
+};
+
+static void
+${pass_name}_automaton_instr(nir_alu_instr *alu, uint16_t *states)
+{
+   const struct per_op_table *tbl = &${pass_name}_table[alu->op];
+   uint16_t state = 0;
+
+   if (tbl->table) {
+      unsigned index = 0;
+
+      for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+         uint16_t src_state =
+            alu->src[i].src.is_ssa ? states[alu->src[i].src.ssa->index] : 0;
+         index = index * tbl->num_filtered_states + tbl->filter[src_state];
+      }
+
+      state = tbl->table[index];
+   }
+
+   states[alu->dest.dest.ssa.index] = state;
+}
+
+static bool
+${pass_name}_automaton_block(nir_block *block, void *void_state)
+{
+   struct opt_state *state = void_state;
+
+   nir_foreach_instr(block, instr) {
+      switch (instr->type) {
+      case nir_instr_type_alu: {
+         nir_alu_instr *alu = nir_instr_as_alu(instr);
+         if (alu->dest.dest.is_ssa)
+            ${pass_name}_automaton_instr(alu, state->states);
+         break;
+      }
+      case nir_instr_type_load_const:
+         state->states[nir_instr_as_load_const(instr)->def.index] =
+            ${automaton.CONST};
+         break;
+      default:
+         break;
+      }
+   }
+
+   return true;
+}
 
 static bool
 ${pass_name}_block(nir_block *block, void *void_state)
@@ -244,22 +466,23 @@ ${pass_name}_block(nir_block *block, void *void_state)
       if (!alu->dest.dest.is_ssa)
          continue;
 
-      switch (alu->op) {
-      % for opcode in xform_dict.keys():
-      case nir_op_${opcode}:
-         for (unsigned i = 0; i < ARRAY_SIZE(${pass_name}_${opcode}_xforms); i++) {
-            const struct transform *xform = &${pass_name}_${opcode}_xforms[i];
-            if (state->condition_flags[xform->condition_offset] &&
-                nir_replace_instr(alu, xform->search, xform->replace,
-                                  state->mem_ctx)) {
-               state->progress = true;
-               break;
-            }
+      /* Instructions added by replacements are never visited, as they go
+       * before the one replaced, and have no state.
+       */
+      assert(alu->dest.dest.ssa.index < state->num_states);
+
+      const struct transform_list *list =
+         &${pass_name}_transforms[state->states[alu->dest.dest.ssa.index]];
+
+      for (unsigned i = 0; i < list->num_xforms; i++) {
+         const struct transform *xform = &list->xforms[i];
+         if (state->condition_flags[xform->condition_offset] &&
+             nir_replace_instr(alu, xform->search, xform->replace,
+                               state->mem_ctx)) {
+            nir_instr_free(state->mem_ctx, &alu->instr);
+            state->progress = true;
+            break;
          }
-         break;
-      % endfor
-      default:
-         break;
       }
    }
 
@@ -275,8 +498,21 @@ ${pass_name}_impl(nir_function_impl *impl, const bool *condition_flags)
    state.progress = false;
    state.condition_flags = condition_flags;
 
+   /* SSA def indices are all below ssa_alloc, if not necessarily dense */
+   state.num_states = impl->ssa_alloc;
+   state.states = calloc(state.num_states, sizeof(*state.states));
+   if (!state.states)
+      return false;
+
+   /* Sources come before their uses, except for phis, which have state 0
+    * like all other non-ALU values.
+    */
+   nir_foreach_block(impl, ${pass_name}_automaton_block, &state);
+
    nir_foreach_block_reverse(impl, ${pass_name}_block, &state);
 
+   free(state.states);
+
    if (state.progress)
       nir_metadata_preserve(impl, nir_metadata_block_index |
                                   nir_metadata_dominance);
@@ -307,19 +543,19 @@ ${pass_name}(nir_shader *shader)
 
 class AlgebraicPass(object):
    def __init__(self, pass_name, transforms):
-      self.xform_dict = {}
+      self.xforms = []
       self.pass_name = pass_name
 
       for xform in transforms:
          if not isinstance(xform, SearchAndReplace):
             xform = SearchAndReplace(xform)
 
-         if xform.search.opcode not in self.xform_dict:
-            self.xform_dict[xform.search.opcode] = []
+         self.xforms.append(xform)
 
-         self.xform_dict[xform.search.opcode].append(xform)
+      self.automaton = TreeAutomaton(self.xforms)
 
    def render(self):
       return _algebraic_pass_template.render(pass_name=self.pass_name,
-                                             xform_dict=self.xform_dict,
+                                             xforms=self.xforms,
+                                             automaton=self.automaton,
                                              condition_list=condition_list)
@@ -141,6 +141,20 @@ void nir_cf_reinsert(nir_cf_list *cf_list, nir_cursor cursor);
 
 void nir_cf_delete(nir_cf_list *cf_list);
 
+/**
+ * Clones an extracted control flow list.  The clone is not inserted
+ * anywhere; use nir_cf_reinsert() for that.  parent is the CF node the clone
+ * will end up under.
+ *
+ * remap_table maps pointers in the original list (SSA defs, blocks, ...) to
+ * their replacements in the clone and is updated as things get cloned.  The
+ * caller may seed it to redirect references to values defined outside the
+ * list; other such references are left pointing at the original values.  If
+ * remap_table is NULL, a temporary table is used.
+ */
+void nir_cf_list_clone(nir_cf_list *dst, nir_cf_list *src, nir_cf_node *parent,
+                       struct hash_table *remap_table);
+
 static inline void
 nir_cf_list_extract(nir_cf_list *extracted, struct exec_list *cf_list)
 {
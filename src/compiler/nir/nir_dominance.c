@@ -48,10 +48,7 @@ init_block_cb(nir_block *block, void *_state)
       block->imm_dom = NULL;
    block->num_dom_children = 0;
 
-   struct set_entry *entry;
-   set_foreach(block->dom_frontier, entry) {
-      _mesa_set_remove(block->dom_frontier, entry);
-   }
+   _mesa_set_clear(block->dom_frontier, NULL);
 
    return true;
 }
@@ -74,6 +71,15 @@ intersect(nir_block *b1, nir_block *b2)
    return b1;
 }
 
+/*
+ * NIR control flow is structured, so the block index order is a reverse
+ * post-order in which the only edges going backwards are loop back-edges,
+ * and the source of a back-edge is always dominated by the loop header it
+ * jumps to.  Ignoring back-edges therefore doesn't change the result and
+ * every other predecessor has been visited already, so a single pass in
+ * index order computes the final immediate dominators instead of iterating
+ * to a fixed point.
+ */
 static bool
 calc_dominance_cb(nir_block *block, void *_state)
 {
@@ -86,6 +92,10 @@ calc_dominance_cb(nir_block *block, void *_state)
    set_foreach(block->predecessors, entry) {
       nir_block *pred = (nir_block *) entry->key;
 
+      /* Skip back-edges */
+      if (pred->index >= block->index)
+         continue;
+
       if (pred->imm_dom) {
          if (new_idom)
             new_idom = intersect(pred, new_idom);
@@ -102,6 +112,34 @@ calc_dominance_cb(nir_block *block, void *_state)
    return true;
 }
 
+#ifdef DEBUG
+static bool
+verify_dominance_cb(nir_block *block, void *_state)
+{
+   dom_state *state = (dom_state *) _state;
+   if (block == nir_start_block(state->impl))
+      return true;
+
+   nir_block *new_idom = NULL;
+   struct set_entry *entry;
+   set_foreach(block->predecessors, entry) {
+      nir_block *pred = (nir_block *) entry->key;
+
+      if (pred->imm_dom) {
+         if (new_idom)
+            new_idom = intersect(pred, new_idom);
+         else
+            new_idom = pred;
+      }
+   }
+
+   if (block->imm_dom != new_idom)
+      state->progress = true;
+
+   return true;
+}
+#endif
+
 static bool
 calc_dom_frontier_cb(nir_block *block, void *state)
 {
@@ -153,8 +191,9 @@ block_alloc_children(nir_block *block, void *state)
 {
    void *mem_ctx = state;
 
-   block->dom_children = ralloc_array(mem_ctx, nir_block *,
-                                      block->num_dom_children);
+   /* Reuse the array from the last time dominance was computed */
+   block->dom_children = reralloc(mem_ctx, block->dom_children, nir_block *,
+                                  block->num_dom_children);
    block->num_dom_children = 0;
 
    return true;
@@ -206,10 +245,15 @@ nir_calc_dominance_impl(nir_function_impl *impl)
 
    nir_foreach_block(impl, init_block_cb, &state);
 
-   while (state.progress) {
-      state.progress = false;
-      nir_foreach_block(impl, calc_dominance_cb, &state);
-   }
+   state.progress = false;
+   nir_foreach_block(impl, calc_dominance_cb, &state);
+
+#ifdef DEBUG
+   /* A second pass over all predecessors must not find anything new */
+   state.progress = false;
+   nir_foreach_block(impl, verify_dominance_cb, &state);
+   assert(!state.progress);
+#endif
 
    nir_foreach_block(impl, calc_dom_frontier_cb, &state);
 
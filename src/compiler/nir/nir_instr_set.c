@@ -409,7 +409,7 @@ dest_is_ssa(nir_dest *dest, void *data)
  */
 
 static bool
-instr_can_rewrite(nir_instr *instr)
+instr_can_rewrite(nir_instr *instr, unsigned read_only_modes)
 {
    /* We only handle SSA. */
    if (!nir_foreach_dest(instr, dest_is_ssa, NULL) ||
@@ -433,6 +433,8 @@ instr_can_rewrite(nir_instr *instr)
    case nir_instr_type_intrinsic: {
       const nir_intrinsic_info *info =
          &nir_intrinsic_infos[nir_instr_as_intrinsic(instr)->intrinsic];
+      if (nir_instr_is_read_only_load(instr, read_only_modes))
+         return true;
       return (info->flags & NIR_INTRINSIC_CAN_ELIMINATE) &&
              (info->flags & NIR_INTRINSIC_CAN_REORDER) &&
              info->num_variables == 0; /* not implemented yet */
@@ -449,6 +451,94 @@ instr_can_rewrite(nir_instr *instr)
    return false;
 }
 
+static bool
+remove_written_modes_block(nir_block *block, void *data)
+{
+   unsigned *read_only_modes = data;
+
+   nir_foreach_instr(block, instr) {
+      if (instr->type != nir_instr_type_intrinsic)
+         continue;
+
+      switch (nir_instr_as_intrinsic(instr)->intrinsic) {
+      case nir_intrinsic_store_ssbo:
+      case nir_intrinsic_ssbo_atomic_add:
+      case nir_intrinsic_ssbo_atomic_imin:
+      case nir_intrinsic_ssbo_atomic_umin:
+      case nir_intrinsic_ssbo_atomic_imax:
+      case nir_intrinsic_ssbo_atomic_umax:
+      case nir_intrinsic_ssbo_atomic_and:
+      case nir_intrinsic_ssbo_atomic_or:
+      case nir_intrinsic_ssbo_atomic_xor:
+      case nir_intrinsic_ssbo_atomic_exchange:
+      case nir_intrinsic_ssbo_atomic_comp_swap:
+         *read_only_modes &= ~(1u << nir_var_shader_storage);
+         break;
+
+      case nir_intrinsic_store_shared:
+      case nir_intrinsic_shared_atomic_add:
+      case nir_intrinsic_shared_atomic_imin:
+      case nir_intrinsic_shared_atomic_umin:
+      case nir_intrinsic_shared_atomic_imax:
+      case nir_intrinsic_shared_atomic_umax:
+      case nir_intrinsic_shared_atomic_and:
+      case nir_intrinsic_shared_atomic_or:
+      case nir_intrinsic_shared_atomic_xor:
+      case nir_intrinsic_shared_atomic_exchange:
+      case nir_intrinsic_shared_atomic_comp_swap:
+         *read_only_modes &= ~(1u << nir_var_shared);
+         break;
+
+      case nir_intrinsic_store_var:
+      case nir_intrinsic_copy_var:
+         /* Stores through variables haven't been lowered to offsets yet so
+          * we can't tell which memory they touch from the intrinsic alone;
+          * the variable's mode tells us.
+          */
+         *read_only_modes &=
+            ~(1u << nir_instr_as_intrinsic(instr)->variables[0]->var->data.mode);
+         break;
+
+      default:
+         break;
+      }
+   }
+
+   return true;
+}
+
+unsigned
+nir_shader_get_read_only_modes(nir_shader *shader)
+{
+   unsigned read_only_modes = (1u << nir_var_shader_storage) |
+                              (1u << nir_var_shared);
+
+   nir_foreach_function(shader, function) {
+      if (function->impl) {
+         nir_foreach_block(function->impl, remove_written_modes_block,
+                           &read_only_modes);
+      }
+   }
+
+   return read_only_modes;
+}
+
+bool
+nir_instr_is_read_only_load(const nir_instr *instr, unsigned read_only_modes)
+{
+   if (instr->type != nir_instr_type_intrinsic)
+      return false;
+
+   switch (nir_instr_as_intrinsic(instr)->intrinsic) {
+   case nir_intrinsic_load_ssbo:
+      return read_only_modes & (1u << nir_var_shader_storage);
+   case nir_intrinsic_load_shared:
+      return read_only_modes & (1u << nir_var_shared);
+   default:
+      return false;
+   }
+}
+
 static nir_ssa_def *
 nir_instr_get_dest_ssa_def(nir_instr *instr)
 {
@@ -493,7 +583,15 @@ nir_instr_set_destroy(struct set *instr_set)
 bool
 nir_instr_set_add_or_rewrite(struct set *instr_set, nir_instr *instr)
 {
-   if (!instr_can_rewrite(instr))
+   return nir_instr_set_add_or_rewrite_read_only(instr_set, instr, 0);
+}
+
+bool
+nir_instr_set_add_or_rewrite_read_only(struct set *instr_set,
+                                       nir_instr *instr,
+                                       unsigned read_only_modes)
+{
+   if (!instr_can_rewrite(instr, read_only_modes))
       return false;
 
    struct set_entry *entry = _mesa_set_search(instr_set, instr);
@@ -521,7 +619,10 @@ nir_instr_set_add_or_rewrite(struct set *instr_set, nir_instr *instr)
 void
 nir_instr_set_remove(struct set *instr_set, nir_instr *instr)
 {
-   if (!instr_can_rewrite(instr))
+   /* Accept every read-only mode here so that loads added through
+    * nir_instr_set_add_or_rewrite_read_only() get removed as well.
+    */
+   if (!instr_can_rewrite(instr, ~0u))
       return;
 
    struct set_entry *entry = _mesa_set_search(instr_set, instr);
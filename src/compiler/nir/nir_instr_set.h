@@ -38,6 +38,22 @@
 
 /*@{*/
 
+/**
+ * Returns a mask of (1 << nir_var_shader_storage) and (1 << nir_var_shared)
+ * for the kinds of memory that no instruction anywhere in the shader can
+ * write.  Since every invocation runs the same code, loads from such memory
+ * always return the same value for the same address and can be treated as
+ * reorderable by nir_instr_set_add_or_rewrite_read_only().
+ */
+unsigned nir_shader_get_read_only_modes(nir_shader *shader);
+
+/**
+ * Returns true if the given instruction is a load_ssbo or load_shared that
+ * reads from one of the read-only memory modes in the given mask.
+ */
+bool nir_instr_is_read_only_load(const nir_instr *instr,
+                                 unsigned read_only_modes);
+
 /** Creates an instruction set, using a given ralloc mem_ctx */
 struct set *nir_instr_set_create(void *mem_ctx);
 
@@ -52,6 +68,14 @@ void nir_instr_set_destroy(struct set *instr_set);
  */
 bool nir_instr_set_add_or_rewrite(struct set *instr_set, nir_instr *instr);
 
+/**
+ * Same as nir_instr_set_add_or_rewrite() but also merges loads of memory in
+ * read_only_modes, as returned by nir_shader_get_read_only_modes().
+ */
+bool nir_instr_set_add_or_rewrite_read_only(struct set *instr_set,
+                                            nir_instr *instr,
+                                            unsigned read_only_modes);
+
 /**
  * Removes an instruction from an instruction set, so that other instructions
  * won't be merged with it.
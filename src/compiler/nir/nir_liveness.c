@@ -40,24 +40,57 @@
  * SSA value may not dominate a use is if the use is in a phi node and the
  * uses in phi no are in the live-out of the corresponding predecessor
  * block but not in the live-in of the block containing the phi node.
+ *
+ * Most SSA values are only used in the block that defines them, and those
+ * can never show up in a live-in or live-out set.  Only values that escape
+ * their block get a bit in the sets, which keeps them small (and the
+ * dataflow cheap) in large shaders where the bulk of the values are
+ * temporaries.
  */
 
 struct live_ssa_defs_state {
    unsigned num_ssa_defs;
+   unsigned num_live_set_defs;
    unsigned bitset_words;
 
    nir_block_worklist worklist;
 };
 
+/* Returns true if the value may be live-in or live-out of some block */
+static bool
+ssa_def_escapes_block(nir_ssa_def *def)
+{
+   /* Phi destinations are in the live-in of their own block */
+   if (def->parent_instr->type == nir_instr_type_phi)
+      return true;
+
+   if (!list_empty(&def->if_uses))
+      return true;
+
+   nir_foreach_use(def, use) {
+      if (use->parent_instr->block != def->parent_instr->block ||
+          use->parent_instr->type == nir_instr_type_phi)
+         return true;
+   }
+
+   return false;
+}
+
 static bool
 index_ssa_def(nir_ssa_def *def, void *void_state)
 {
    struct live_ssa_defs_state *state = void_state;
 
-   if (def->parent_instr->type == nir_instr_type_ssa_undef)
+   if (def->parent_instr->type == nir_instr_type_ssa_undef) {
       def->live_index = 0;
-   else
+      def->live_set_index = 0;
+   } else {
       def->live_index = state->num_ssa_defs++;
+      if (ssa_def_escapes_block(def))
+         def->live_set_index = state->num_live_set_defs++;
+      else
+         def->live_set_index = 0;
+   }
 
    return true;
 }
@@ -100,10 +133,13 @@ set_src_live(nir_src *src, void *void_live)
    if (!src->is_ssa)
       return true;
 
-   if (src->ssa->live_index == 0)
-      return true;   /* undefined variables are never live */
+   /* Undefined variables are never live and block-local values are not
+    * tracked in the sets.
+    */
+   if (src->ssa->live_set_index == 0)
+      return true;
 
-   BITSET_SET(live, src->ssa->live_index);
+   BITSET_SET(live, src->ssa->live_set_index);
 
    return true;
 }
@@ -113,7 +149,7 @@ set_ssa_def_dead(nir_ssa_def *def, void *void_live)
 {
    BITSET_WORD *live = void_live;
 
-   BITSET_CLEAR(live, def->live_index);
+   BITSET_CLEAR(live, def->live_set_index);
 
    return true;
 }
@@ -171,9 +207,11 @@ nir_live_ssa_defs_impl(nir_function_impl *impl)
 
    /* We start at 1 because we reserve the index value of 0 for ssa_undef
     * instructions.  Those are never live, so their liveness information
-    * can be compacted into a single bit.
+    * can be compacted into a single bit.  The same bit is shared by values
+    * that never leave their block.
     */
    state.num_ssa_defs = 1;
+   state.num_live_set_defs = 1;
    nir_foreach_block(impl, index_ssa_definitions_block, &state);
 
    nir_block_worklist_init(&state.worklist, impl->num_blocks, NULL);
@@ -182,7 +220,7 @@ nir_live_ssa_defs_impl(nir_function_impl *impl)
     * ahead and allocate live_in and live_out sets and add all of the
     * blocks to the worklist.
     */
-   state.bitset_words = BITSET_WORDS(state.num_ssa_defs);
+   state.bitset_words = BITSET_WORDS(state.num_live_set_defs);
    nir_foreach_block(impl, init_liveness_block, &state);
 
    /* We're now ready to work through the worklist and update the liveness
@@ -259,13 +297,13 @@ search_for_use_after_instr(nir_instr *start, nir_ssa_def *def)
 static bool
 nir_ssa_def_is_live_at(nir_ssa_def *def, nir_instr *instr)
 {
-   if (BITSET_TEST(instr->block->live_out, def->live_index)) {
+   if (BITSET_TEST(instr->block->live_out, def->live_set_index)) {
       /* Since def dominates instr, if def is in the liveout of the block,
        * it's live at instr
        */
       return true;
    } else {
-      if (BITSET_TEST(instr->block->live_in, def->live_index) ||
+      if (BITSET_TEST(instr->block->live_in, def->live_set_index) ||
           def->parent_instr->block == instr->block) {
          /* In this case it is either live coming into instr's block or it
           * is defined in the same block.  In this case, we simply need to
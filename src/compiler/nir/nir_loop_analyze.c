@@ -0,0 +1,390 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_constant_expressions.h"
+
+/*
+ * Implements a simple loop analysis.  For every loop in the function we
+ * count the instructions in it and look for the shape that GLSL for and
+ * while loops come out of nir_lower_vars_to_ssa in:
+ *
+ *    loop {
+ *       block_0:
+ *       vec1 ssa_1 = phi block_pre: ssa_0, block_n: ssa_5
+ *       vec1 ssa_2 = ige ssa_1, ssa_limit
+ *       if ssa_2 {
+ *          break
+ *       }
+ *       ...
+ *       vec1 ssa_5 = iadd ssa_1, ssa_step
+ *    }
+ *
+ * That is, a loop whose only exit is an if right after the first block with
+ * nothing but a break on one side and nothing at all on the other.  For
+ * those, we try to find the trip count by simulating the loop: every header
+ * phi whose starting value is a constant and whose back-edge value is an ALU
+ * expression of constants and header phis is stepped with the constant
+ * expression evaluator until the terminator condition says the loop exits.
+ * This handles the usual induction variables (i++, i += 2, i *= 2, ...) and
+ * comparisons (including inverted ones) without needing a separate case for
+ * each.
+ */
+
+/* Loops that run more often than this are treated as unknown.  Nothing we
+ * do with the trip count cares about loops this long.
+ */
+#define MAX_SIMULATED_ITERATIONS 1024
+
+/* How deep an ALU expression tree we are willing to evaluate */
+#define MAX_EVAL_DEPTH 16
+
+struct loop_sim_state {
+   unsigned num_phis;
+   nir_phi_instr **phis;
+   nir_ssa_def **latch_srcs;
+   nir_const_value *values;
+   bool *known;
+};
+
+static bool
+eval_def(struct loop_sim_state *state, nir_ssa_def *def, unsigned depth,
+         nir_const_value *out)
+{
+   if (def->bit_size != 32)
+      return false;
+
+   nir_instr *instr = def->parent_instr;
+
+   switch (instr->type) {
+   case nir_instr_type_load_const:
+      *out = nir_instr_as_load_const(instr)->value;
+      return true;
+
+   case nir_instr_type_phi:
+      for (unsigned i = 0; i < state->num_phis; i++) {
+         if (&state->phis[i]->dest.ssa == def) {
+            if (!state->known[i])
+               return false;
+
+            *out = state->values[i];
+            return true;
+         }
+      }
+      return false;
+
+   case nir_instr_type_alu: {
+      nir_alu_instr *alu = nir_instr_as_alu(instr);
+      const nir_op_info *info = &nir_op_infos[alu->op];
+      nir_const_value src[4];
+
+      if (depth == 0 || alu->dest.saturate)
+         return false;
+
+      for (unsigned i = 0; i < info->num_inputs; i++) {
+         nir_const_value val;
+
+         if (!alu->src[i].src.is_ssa || alu->src[i].abs ||
+             alu->src[i].negate ||
+             !eval_def(state, alu->src[i].src.ssa, depth - 1, &val))
+            return false;
+
+         for (unsigned j = 0; j < nir_ssa_alu_instr_src_components(alu, i); j++)
+            src[i].u32[j] = val.u32[alu->src[i].swizzle[j]];
+      }
+
+      *out = nir_eval_const_opcode(alu->op, def->num_components, 32, src);
+      return true;
+   }
+
+   default:
+      return false;
+   }
+}
+
+static unsigned
+count_instructions(struct exec_list *cf_list)
+{
+   unsigned count = 0;
+
+   foreach_list_typed(nir_cf_node, node, node, cf_list) {
+      switch (node->type) {
+      case nir_cf_node_block:
+         nir_foreach_instr(nir_cf_node_as_block(node), instr) {
+            if (instr->type != nir_instr_type_phi)
+               count++;
+         }
+         break;
+
+      case nir_cf_node_if: {
+         nir_if *if_stmt = nir_cf_node_as_if(node);
+         count += count_instructions(&if_stmt->then_list);
+         count += count_instructions(&if_stmt->else_list);
+         break;
+      }
+
+      case nir_cf_node_loop:
+         count += count_instructions(&nir_cf_node_as_loop(node)->body);
+         break;
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+
+   return count;
+}
+
+static bool
+cf_list_is_single_break(struct exec_list *cf_list)
+{
+   nir_cf_node *node = exec_node_data(nir_cf_node,
+                                      exec_list_get_head(cf_list), node);
+   if (exec_list_get_tail(cf_list) != &node->node)
+      return false;
+
+   nir_instr *instr = nir_block_first_instr(nir_cf_node_as_block(node));
+   return instr && instr == nir_block_last_instr(nir_cf_node_as_block(node)) &&
+          instr->type == nir_instr_type_jump &&
+          nir_instr_as_jump(instr)->type == nir_jump_break;
+}
+
+static bool
+cf_list_is_empty(struct exec_list *cf_list)
+{
+   nir_cf_node *node = exec_node_data(nir_cf_node,
+                                      exec_list_get_head(cf_list), node);
+   return exec_list_get_tail(cf_list) == &node->node &&
+          exec_list_is_empty(&nir_cf_node_as_block(node)->instr_list);
+}
+
+/* Returns true if anything other than the terminator can leave or restart
+ * the loop: a break or continue that isn't inside a nested loop, or a return
+ * anywhere.
+ */
+static bool
+cf_list_has_other_jumps(struct exec_list *cf_list, nir_if *terminator,
+                        bool in_nested_loop)
+{
+   foreach_list_typed(nir_cf_node, node, node, cf_list) {
+      switch (node->type) {
+      case nir_cf_node_block: {
+         nir_instr *instr = nir_block_last_instr(nir_cf_node_as_block(node));
+         if (instr && instr->type == nir_instr_type_jump &&
+             (!in_nested_loop ||
+              nir_instr_as_jump(instr)->type == nir_jump_return))
+            return true;
+         break;
+      }
+
+      case nir_cf_node_if: {
+         nir_if *if_stmt = nir_cf_node_as_if(node);
+         if (if_stmt == terminator)
+            break;
+
+         if (cf_list_has_other_jumps(&if_stmt->then_list, terminator,
+                                     in_nested_loop) ||
+             cf_list_has_other_jumps(&if_stmt->else_list, terminator,
+                                     in_nested_loop))
+            return true;
+         break;
+      }
+
+      case nir_cf_node_loop:
+         if (cf_list_has_other_jumps(&nir_cf_node_as_loop(node)->body,
+                                     terminator, true))
+            return true;
+         break;
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+
+   return false;
+}
+
+static bool
+find_terminator(nir_loop *loop, nir_loop_info *info)
+{
+   nir_cf_node *next = nir_cf_node_next(nir_loop_first_cf_node(loop));
+   if (!next || next->type != nir_cf_node_if)
+      return false;
+
+   nir_if *if_stmt = nir_cf_node_as_if(next);
+   if (!if_stmt->condition.is_ssa)
+      return false;
+
+   if (cf_list_is_single_break(&if_stmt->then_list) &&
+       cf_list_is_empty(&if_stmt->else_list)) {
+      info->break_in_else = false;
+   } else if (cf_list_is_single_break(&if_stmt->else_list) &&
+              cf_list_is_empty(&if_stmt->then_list)) {
+      info->break_in_else = true;
+   } else {
+      return false;
+   }
+
+   if (cf_list_has_other_jumps(&loop->body, if_stmt, false))
+      return false;
+
+   info->terminator = if_stmt;
+   return true;
+}
+
+static void
+compute_trip_count(nir_loop *loop, nir_loop_info *info, void *mem_ctx)
+{
+   nir_block *header = nir_cf_node_as_block(nir_loop_first_cf_node(loop));
+   nir_block *preheader =
+      nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+   nir_block *latch = nir_cf_node_as_block(nir_loop_last_cf_node(loop));
+   struct loop_sim_state state;
+
+   state.num_phis = 0;
+   nir_foreach_instr(header, instr) {
+      if (instr->type != nir_instr_type_phi)
+         break;
+      state.num_phis++;
+   }
+
+   state.phis = ralloc_array(mem_ctx, nir_phi_instr *, state.num_phis);
+   state.latch_srcs = ralloc_array(mem_ctx, nir_ssa_def *, state.num_phis);
+   state.values = ralloc_array(mem_ctx, nir_const_value, state.num_phis);
+   state.known = rzalloc_array(mem_ctx, bool, state.num_phis);
+
+   nir_ssa_def **init_srcs = ralloc_array(mem_ctx, nir_ssa_def *,
+                                          state.num_phis);
+   nir_const_value *next_values = ralloc_array(mem_ctx, nir_const_value,
+                                               state.num_phis);
+   bool *next_known = ralloc_array(mem_ctx, bool, state.num_phis);
+
+   unsigned i = 0;
+   nir_foreach_instr(header, instr) {
+      if (instr->type != nir_instr_type_phi)
+         break;
+
+      nir_phi_instr *phi = nir_instr_as_phi(instr);
+      state.phis[i] = phi;
+      init_srcs[i] = NULL;
+      state.latch_srcs[i] = NULL;
+
+      nir_foreach_phi_src(phi, src) {
+         if (!src->src.is_ssa)
+            return;
+
+         if (src->pred == preheader)
+            init_srcs[i] = src->src.ssa;
+         else if (src->pred == latch)
+            state.latch_srcs[i] = src->src.ssa;
+         else
+            return;
+      }
+
+      if (!init_srcs[i] || !state.latch_srcs[i])
+         return;
+
+      i++;
+   }
+
+   /* The starting values can't depend on the phis themselves */
+   for (i = 0; i < state.num_phis; i++) {
+      next_known[i] = eval_def(&state, init_srcs[i], MAX_EVAL_DEPTH,
+                               &state.values[i]);
+   }
+   memcpy(state.known, next_known, state.num_phis * sizeof(bool));
+
+   for (unsigned iter = 0; iter <= MAX_SIMULATED_ITERATIONS; iter++) {
+      nir_const_value cond;
+      if (!eval_def(&state, info->terminator->condition.ssa, MAX_EVAL_DEPTH,
+                    &cond))
+         return;
+
+      if ((cond.u32[0] != 0) != info->break_in_else) {
+         info->trip_count = iter;
+         info->trip_count_known = true;
+         return;
+      }
+
+      for (i = 0; i < state.num_phis; i++) {
+         next_known[i] = eval_def(&state, state.latch_srcs[i], MAX_EVAL_DEPTH,
+                                  &next_values[i]);
+      }
+      memcpy(state.known, next_known, state.num_phis * sizeof(bool));
+      memcpy(state.values, next_values,
+             state.num_phis * sizeof(nir_const_value));
+   }
+}
+
+static void
+analyze_loop(nir_loop *loop, void *mem_ctx)
+{
+   if (!loop->info)
+      loop->info = ralloc(loop, nir_loop_info);
+
+   nir_loop_info *info = loop->info;
+   memset(info, 0, sizeof(*info));
+
+   info->num_instructions = count_instructions(&loop->body);
+
+   if (find_terminator(loop, info))
+      compute_trip_count(loop, info, mem_ctx);
+}
+
+static void
+analyze_cf_list(struct exec_list *cf_list, void *mem_ctx)
+{
+   foreach_list_typed(nir_cf_node, node, node, cf_list) {
+      switch (node->type) {
+      case nir_cf_node_block:
+         break;
+
+      case nir_cf_node_if: {
+         nir_if *if_stmt = nir_cf_node_as_if(node);
+         analyze_cf_list(&if_stmt->then_list, mem_ctx);
+         analyze_cf_list(&if_stmt->else_list, mem_ctx);
+         break;
+      }
+
+      case nir_cf_node_loop: {
+         nir_loop *loop = nir_cf_node_as_loop(node);
+         analyze_cf_list(&loop->body, mem_ctx);
+         analyze_loop(loop, mem_ctx);
+         break;
+      }
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+}
+
+void
+nir_loop_analyze_impl(nir_function_impl *impl)
+{
+   void *mem_ctx = ralloc_context(NULL);
+
+   analyze_cf_list(&impl->body, mem_ctx);
+
+   ralloc_free(mem_ctx);
+}
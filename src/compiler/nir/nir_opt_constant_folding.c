@@ -27,21 +27,60 @@
 
 #include "nir_constant_expressions.h"
 #include <math.h>
+#include <string.h>
 
 /*
  * Implements SSA-based constant folding.
+ *
+ * Folded values are remembered per block, keyed by the opcode and the
+ * actual source values rather than the source SSA defs, so expressions
+ * that recur with different copies of the same constants (as they do all
+ * over the place after loop unrolling) are only evaluated once and share
+ * the resulting load_const.  Since a chain of constant expressions folds
+ * from the bottom up, that goes for whole expression trees too.
  */
 
+struct fold_key {
+   nir_op op;
+   unsigned bit_size;
+   unsigned dest_bit_size;
+   unsigned num_components;
+   nir_const_value src[4];
+};
+
 struct constant_fold_state {
    void *mem_ctx;
    nir_function_impl *impl;
    bool progress;
+
+   /** Maps a fold_key to the nir_ssa_def of a load_const earlier in the
+    * current block holding its result.
+    */
+   struct hash_table *folded;
 };
 
+static uint32_t
+hash_fold_key(const void *key)
+{
+   return _mesa_hash_data(key, sizeof(struct fold_key));
+}
+
 static bool
-constant_fold_alu_instr(nir_alu_instr *instr, void *mem_ctx)
+fold_keys_equal(const void *a, const void *b)
 {
-   nir_const_value src[4];
+   return memcmp(a, b, sizeof(struct fold_key)) == 0;
+}
+
+static bool
+constant_fold_alu_instr(nir_alu_instr *instr,
+                        struct constant_fold_state *state)
+{
+   void *mem_ctx = state->mem_ctx;
+   struct fold_key key;
+   nir_const_value *src = key.src;
+
+   /* Unused components and sources have to compare equal too. */
+   memset(&key, 0, sizeof(key));
 
    if (!instr->dest.dest.is_ssa)
       return false;
@@ -92,24 +131,38 @@ constant_fold_alu_instr(nir_alu_instr *instr, void *mem_ctx)
    /* We shouldn't have any saturate modifiers in the optimization loop. */
    assert(!instr->dest.saturate);
 
-   nir_const_value dest =
-      nir_eval_const_opcode(instr->op, instr->dest.dest.ssa.num_components,
-                            bit_size, src);
+   key.op = instr->op;
+   key.bit_size = bit_size;
+   key.dest_bit_size = instr->dest.dest.ssa.bit_size;
+   key.num_components = instr->dest.dest.ssa.num_components;
+
+   nir_ssa_def *result;
+   struct hash_entry *entry = _mesa_hash_table_search(state->folded, &key);
+   if (entry) {
+      result = entry->data;
+   } else {
+      nir_const_value dest =
+         nir_eval_const_opcode(instr->op, key.num_components, bit_size, src);
 
-   nir_load_const_instr *new_instr =
-      nir_load_const_instr_create(mem_ctx,
-                                  instr->dest.dest.ssa.num_components);
+      nir_load_const_instr *new_instr =
+         nir_load_const_instr_create(mem_ctx, key.num_components);
 
-   new_instr->def.bit_size = instr->dest.dest.ssa.bit_size;
-   new_instr->value = dest;
+      new_instr->def.bit_size = key.dest_bit_size;
+      new_instr->value = dest;
 
-   nir_instr_insert_before(&instr->instr, &new_instr->instr);
+      nir_instr_insert_before(&instr->instr, &new_instr->instr);
 
-   nir_ssa_def_rewrite_uses(&instr->dest.dest.ssa,
-                            nir_src_for_ssa(&new_instr->def));
+      result = &new_instr->def;
+
+      struct fold_key *stored_key = ralloc(state->folded, struct fold_key);
+      memcpy(stored_key, &key, sizeof(key));
+      _mesa_hash_table_insert(state->folded, stored_key, result);
+   }
+
+   nir_ssa_def_rewrite_uses(&instr->dest.dest.ssa, nir_src_for_ssa(result));
 
    nir_instr_remove(&instr->instr);
-   ralloc_free(instr);
+   nir_instr_free(mem_ctx, &instr->instr);
 
    return true;
 }
@@ -177,11 +230,14 @@ constant_fold_block(nir_block *block, void *void_state)
 {
    struct constant_fold_state *state = void_state;
 
+   /* Only values from this block are known to dominate what follows. */
+   _mesa_hash_table_clear(state->folded, NULL);
+
    nir_foreach_instr_safe(block, instr) {
       switch (instr->type) {
       case nir_instr_type_alu:
          state->progress |= constant_fold_alu_instr(nir_instr_as_alu(instr),
-                                                    state->mem_ctx);
+                                                    state);
          break;
       case nir_instr_type_intrinsic:
          state->progress |=
@@ -207,9 +263,13 @@ nir_opt_constant_folding_impl(nir_function_impl *impl)
    state.mem_ctx = ralloc_parent(impl);
    state.impl = impl;
    state.progress = false;
+   state.folded = _mesa_hash_table_create(NULL, hash_fold_key,
+                                          fold_keys_equal);
 
    nir_foreach_block(impl, constant_fold_block, &state);
 
+   _mesa_hash_table_destroy(state.folded, NULL);
+
    if (state.progress)
       nir_metadata_preserve(impl, nir_metadata_block_index |
                                   nir_metadata_dominance);
@@ -39,20 +39,23 @@
  */
 
 static bool
-cse_block(nir_block *block, struct set *instr_set)
+cse_block(nir_shader *shader, nir_block *block, struct set *instr_set,
+          unsigned read_only_modes)
 {
    bool progress = false;
 
    nir_foreach_instr_safe(block, instr) {
-      if (nir_instr_set_add_or_rewrite(instr_set, instr)) {
+      if (nir_instr_set_add_or_rewrite_read_only(instr_set, instr,
+                                                 read_only_modes)) {
          progress = true;
          nir_instr_remove(instr);
+         nir_instr_free(shader, instr);
       }
    }
 
    for (unsigned i = 0; i < block->num_dom_children; i++) {
       nir_block *child = block->dom_children[i];
-      progress |= cse_block(child, instr_set);
+      progress |= cse_block(shader, child, instr_set, read_only_modes);
    }
 
    nir_foreach_instr(block, instr)
@@ -62,13 +65,14 @@ cse_block(nir_block *block, struct set *instr_set)
 }
 
 static bool
-nir_opt_cse_impl(nir_function_impl *impl)
+nir_opt_cse_impl(nir_function_impl *impl, unsigned read_only_modes)
 {
    struct set *instr_set = nir_instr_set_create(NULL);
 
    nir_metadata_require(impl, nir_metadata_dominance);
 
-   bool progress = cse_block(nir_start_block(impl), instr_set);
+   bool progress = cse_block(impl->function->shader, nir_start_block(impl),
+                             instr_set, read_only_modes);
 
    if (progress)
       nir_metadata_preserve(impl, nir_metadata_block_index |
@@ -83,9 +87,14 @@ nir_opt_cse(nir_shader *shader)
 {
    bool progress = false;
 
+   /* Loads from SSBO or shared memory that nothing in the shader writes
+    * behave like UBO loads and can be merged the same way.
+    */
+   unsigned read_only_modes = nir_shader_get_read_only_modes(shader);
+
    nir_foreach_function(shader, function) {
       if (function->impl)
-         progress |= nir_opt_cse_impl(function->impl);
+         progress |= nir_opt_cse_impl(function->impl, read_only_modes);
    }
 
    return progress;
@@ -133,12 +133,12 @@ init_block_cb(nir_block *block, void *_state)
 static bool
 delete_block_cb(nir_block *block, void *_state)
 {
-   bool *progress = (bool *) _state;
+   struct exec_list *dead_instrs = (struct exec_list *) _state;
 
    nir_foreach_instr_safe(block, instr) {
       if (!instr->pass_flags) {
          nir_instr_remove(instr);
-         *progress = true;
+         exec_list_push_tail(dead_instrs, &instr->node);
       }
    }
 
@@ -160,8 +160,17 @@ nir_opt_dce_impl(nir_function_impl *impl)
 
    ralloc_free(worklist);
 
-   bool progress = false;
-   nir_foreach_block(impl, delete_block_cb, &progress);
+   /* Dead instructions are only freed once all of them have been removed,
+    * since removing one that uses another touches the other's use list.
+    */
+   struct exec_list dead_instrs;
+   exec_list_make_empty(&dead_instrs);
+   nir_foreach_block(impl, delete_block_cb, &dead_instrs);
+
+   bool progress = !exec_list_is_empty(&dead_instrs);
+
+   foreach_list_typed_safe(nir_instr, instr, node, &dead_instrs)
+      nir_instr_free(impl->function->shader, instr);
 
    if (progress)
       nir_metadata_preserve(impl, nir_metadata_block_index |
@@ -169,7 +169,7 @@ def_not_live_out(nir_ssa_def *def, void *state)
 {
    nir_block *after = state;
 
-   return !BITSET_TEST(after->live_in, def->live_index);
+   return !BITSET_TEST(after->live_in, def->live_set_index);
 }
 
 /*
@@ -26,6 +26,7 @@
  */
 
 #include "nir.h"
+#include "nir_instr_set.h"
 
 /*
  * Implements Global Code Motion.  A description of GCM can be found in
@@ -34,12 +35,42 @@
  * number of ways.  The algorithm used here differs substantially from the
  * one in the paper but it is, in my opinion, much easier to read and
  * verify correcness.
+ *
+ * If requested, we also do global value numbering as described in the same
+ * paper.  Once the unpinned instructions are pulled out of the program,
+ * their blocks no longer matter: two identical instructions are merged even
+ * if neither dominates the other (say, one in each side of an if) and the
+ * late scheduling pass then places the survivor in a block that dominates
+ * all of the uses.  This catches redundancies that dominance-scoped CSE
+ * can't, including ones that are only partial along one path.
+ *
+ * Hoisting a value out of a loop makes it live across the entire loop, so
+ * if the driver sets nir_shader_compiler_options::gcm_register_budget we
+ * keep a rough register pressure estimate for every loop and only hoist
+ * as long as the loops stay within the budget.  The estimate is the peak
+ * number of live 32-bit components anywhere in the loop, going by the
+ * liveness of the shader before GCM, plus whatever we have already hoisted
+ * out of it.  Values that don't fit stay in the innermost loop they do fit
+ * around, or where they were if there is none.
  */
 
+struct gcm_loop_info {
+   struct gcm_loop_info *parent;
+
+   /* Number of loops this loop is inside, plus one */
+   unsigned depth;
+
+   /* Estimated peak register pressure in the loop, in 32-bit components */
+   unsigned pressure;
+};
+
 struct gcm_block_info {
    /* Number of loops this block is inside */
    unsigned loop_depth;
 
+   /* The innermost loop this block is inside, or NULL */
+   struct gcm_loop_info *loop;
+
    /* The last instruction inserted into this block.  This is used as we
     * traverse the instructions and insert them back into the program to
     * put them in the right order.
@@ -67,29 +98,44 @@ struct gcm_state {
    struct exec_list instrs;
 
    struct gcm_block_info *blocks;
+
+   /* Memory modes that nothing in the shader writes, as returned by
+    * nir_shader_get_read_only_modes().  Loads from them are free to move.
+    */
+   unsigned read_only_modes;
+
+   /* gcm_register_budget from the compiler options; 0 if unlimited */
+   unsigned register_budget;
 };
 
 /* Recursively walks the CFG and builds the block_info structure */
 static void
 gcm_build_block_info(struct exec_list *cf_list, struct gcm_state *state,
-                     unsigned loop_depth)
+                     unsigned loop_depth, struct gcm_loop_info *loop_info)
 {
    foreach_list_typed(nir_cf_node, node, node, cf_list) {
       switch (node->type) {
       case nir_cf_node_block: {
          nir_block *block = nir_cf_node_as_block(node);
          state->blocks[block->index].loop_depth = loop_depth;
+         state->blocks[block->index].loop = loop_info;
          break;
       }
       case nir_cf_node_if: {
          nir_if *if_stmt = nir_cf_node_as_if(node);
-         gcm_build_block_info(&if_stmt->then_list, state, loop_depth);
-         gcm_build_block_info(&if_stmt->else_list, state, loop_depth);
+         gcm_build_block_info(&if_stmt->then_list, state, loop_depth,
+                              loop_info);
+         gcm_build_block_info(&if_stmt->else_list, state, loop_depth,
+                              loop_info);
          break;
       }
       case nir_cf_node_loop: {
          nir_loop *loop = nir_cf_node_as_loop(node);
-         gcm_build_block_info(&loop->body, state, loop_depth + 1);
+         struct gcm_loop_info *inner =
+            rzalloc(state->blocks, struct gcm_loop_info);
+         inner->parent = loop_info;
+         inner->depth = loop_depth + 1;
+         gcm_build_block_info(&loop->body, state, loop_depth + 1, inner);
          break;
       }
       default:
@@ -98,6 +144,182 @@ gcm_build_block_info(struct exec_list *cf_list, struct gcm_state *state,
    }
 }
 
+/* Size of a value in 32-bit register components */
+static unsigned
+gcm_def_size(const nir_ssa_def *def)
+{
+   return def->num_components * MAX2(def->bit_size / 32, 1);
+}
+
+struct gcm_pressure_state {
+   /* SSA defs by live_set_index */
+   nir_ssa_def **live_defs;
+   unsigned num_live_defs;
+
+   /* Values live at the current point, by nir_ssa_def::index */
+   BITSET_WORD *live;
+   unsigned live_words;
+
+   unsigned pressure;
+
+   struct gcm_state *gcm;
+};
+
+static bool
+gcm_record_live_def(nir_ssa_def *def, void *void_state)
+{
+   struct gcm_pressure_state *state = void_state;
+
+   if (def->live_set_index) {
+      state->live_defs[def->live_set_index] = def;
+      state->num_live_defs = MAX2(state->num_live_defs,
+                                  def->live_set_index + 1);
+   }
+
+   return true;
+}
+
+static bool
+gcm_record_live_defs_block(nir_block *block, void *state)
+{
+   nir_foreach_instr(block, instr)
+      nir_foreach_ssa_def(instr, gcm_record_live_def, state);
+
+   return true;
+}
+
+static void
+gcm_pressure_add(struct gcm_pressure_state *state, nir_ssa_def *def)
+{
+   if (def->parent_instr->type == nir_instr_type_ssa_undef ||
+       BITSET_TEST(state->live, def->index))
+      return;
+
+   BITSET_SET(state->live, def->index);
+   state->pressure += gcm_def_size(def);
+}
+
+static bool
+gcm_pressure_add_src(nir_src *src, void *void_state)
+{
+   assert(src->is_ssa);
+   gcm_pressure_add(void_state, src->ssa);
+   return true;
+}
+
+static bool
+gcm_pressure_remove_def(nir_ssa_def *def, void *void_state)
+{
+   struct gcm_pressure_state *state = void_state;
+
+   if (BITSET_TEST(state->live, def->index)) {
+      BITSET_CLEAR(state->live, def->index);
+      state->pressure -= gcm_def_size(def);
+   }
+
+   return true;
+}
+
+/* Walks the block backwards from its live-out set to find the most
+ * components live at any point in it, and makes sure every loop around
+ * the block has at least that much pressure.
+ */
+static bool
+gcm_compute_pressure_block(nir_block *block, void *void_state)
+{
+   struct gcm_pressure_state *state = void_state;
+   struct gcm_block_info *info = &state->gcm->blocks[block->index];
+
+   if (!info->loop)
+      return true;
+
+   memset(state->live, 0, state->live_words * sizeof(BITSET_WORD));
+   state->pressure = 0;
+
+   unsigned i;
+   BITSET_WORD tmp;
+   BITSET_FOREACH_SET(i, tmp, block->live_out, state->num_live_defs)
+      gcm_pressure_add(state, state->live_defs[i]);
+
+   nir_if *following_if = nir_block_get_following_if(block);
+   if (following_if)
+      gcm_pressure_add_src(&following_if->condition, state);
+
+   unsigned max_pressure = state->pressure;
+
+   nir_foreach_instr_reverse(block, instr) {
+      if (instr->type == nir_instr_type_phi)
+         break;
+
+      nir_foreach_ssa_def(instr, gcm_pressure_remove_def, state);
+      nir_foreach_src(instr, gcm_pressure_add_src, state);
+      max_pressure = MAX2(max_pressure, state->pressure);
+   }
+
+   for (struct gcm_loop_info *loop = info->loop; loop; loop = loop->parent)
+      loop->pressure = MAX2(loop->pressure, max_pressure);
+
+   return true;
+}
+
+static void
+gcm_compute_loop_pressure(struct gcm_state *state)
+{
+   struct gcm_pressure_state pstate;
+
+   pstate.gcm = state;
+   pstate.num_live_defs = 0;
+
+   /* Every value gets at most one live set index, starting from 1 */
+   pstate.live_defs = rzalloc_array(NULL, nir_ssa_def *,
+                                    state->impl->ssa_alloc + 1);
+   pstate.live_words = BITSET_WORDS(state->impl->ssa_alloc);
+   pstate.live = ralloc_array(pstate.live_defs, BITSET_WORD,
+                              pstate.live_words);
+
+   nir_foreach_block(state->impl, gcm_record_live_defs_block, &pstate);
+   nir_foreach_block(state->impl, gcm_compute_pressure_block, &pstate);
+
+   ralloc_free(pstate.live_defs);
+}
+
+/* Returns true if the given loop contains the given block */
+static bool
+gcm_loop_contains(struct gcm_state *state, struct gcm_loop_info *loop,
+                  nir_block *block)
+{
+   struct gcm_loop_info *inner = state->blocks[block->index].loop;
+   while (inner && inner->depth > loop->depth)
+      inner = inner->parent;
+
+   return inner == loop;
+}
+
+/* Returns true if the value fits into every loop it would have to stay
+ * live across if it moved from block "from" up to block "to".  With
+ * "commit" set, also accounts for it in those loops.
+ */
+static bool
+gcm_hoist_fits(struct gcm_state *state, nir_ssa_def *def,
+               nir_block *from, nir_block *to, bool commit)
+{
+   if (state->register_budget == 0)
+      return true;
+
+   unsigned size = gcm_def_size(def);
+
+   for (struct gcm_loop_info *loop = state->blocks[from->index].loop;
+        loop && !gcm_loop_contains(state, loop, to);
+        loop = loop->parent) {
+      if (commit)
+         loop->pressure += size;
+      else if (loop->pressure + size > state->register_budget)
+         return false;
+   }
+
+   return true;
+}
+
 /* Walks the instruction list and marks immovable instructions as pinned
  *
  * This function also serves to initialize the instr->pass_flags field.
@@ -152,8 +374,9 @@ gcm_pin_instructions_block(nir_block *block, void *void_state)
          const nir_intrinsic_info *info =
             &nir_intrinsic_infos[nir_instr_as_intrinsic(instr)->intrinsic];
 
-         if ((info->flags & NIR_INTRINSIC_CAN_ELIMINATE) &&
-             (info->flags & NIR_INTRINSIC_CAN_REORDER)) {
+         if (((info->flags & NIR_INTRINSIC_CAN_ELIMINATE) &&
+              (info->flags & NIR_INTRINSIC_CAN_REORDER)) ||
+             nir_instr_is_read_only_load(instr, state->read_only_modes)) {
             instr->pass_flags = 0;
          } else {
             instr->pass_flags = GCM_INSTR_PINNED;
@@ -327,13 +550,19 @@ gcm_schedule_late_def(nir_ssa_def *def, void *void_state)
     * as far outside loops as we can get.
     */
    nir_block *best = lca;
-   while (lca != def->parent_instr->block) {
-      assert(lca);
-      if (state->blocks[lca->index].loop_depth <
-          state->blocks[best->index].loop_depth)
-         best = lca;
-      lca = lca->imm_dom;
+   for (nir_block *block = lca; block; block = block->imm_dom) {
+      if (state->blocks[block->index].loop_depth <
+          state->blocks[best->index].loop_depth &&
+          gcm_hoist_fits(state, def, lca, block, false))
+         best = block;
+
+      /* The block we were scheduled into early is a candidate too; it's
+       * often the one right in front of the loop.
+       */
+      if (block == def->parent_instr->block)
+         break;
    }
+   gcm_hoist_fits(state, def, lca, best, true);
    def->parent_instr->block = best;
 
    return true;
@@ -453,22 +682,56 @@ gcm_place_instr(nir_instr *instr, struct gcm_state *state)
    block_info->last_instr = instr;
 }
 
+/** Merges identical unpinned instructions
+ *
+ * The list of unpinned instructions is still in program order at this
+ * point so the sources of an instruction have already been numbered by the
+ * time we get to it; we never rewrite the sources of something that's
+ * already in the set.  Pinned instructions are left alone.
+ */
+static void
+gcm_value_number_instrs(struct gcm_state *state)
+{
+   struct set *gvn_set = nir_instr_set_create(NULL);
+
+   foreach_list_typed_safe(nir_instr, instr, node, &state->instrs) {
+      if (nir_instr_set_add_or_rewrite_read_only(gvn_set, instr,
+                                                 state->read_only_modes))
+         nir_instr_remove(instr);
+   }
+
+   nir_instr_set_destroy(gvn_set);
+}
+
 static void
-opt_gcm_impl(nir_function_impl *impl)
+opt_gcm_impl(nir_function_impl *impl, bool value_number,
+             unsigned read_only_modes, unsigned register_budget)
 {
    struct gcm_state state;
 
    state.impl = impl;
    state.instr = NULL;
+   state.read_only_modes = read_only_modes;
+   state.register_budget = register_budget;
    exec_list_make_empty(&state.instrs);
-   state.blocks = rzalloc_array(NULL, struct gcm_block_info, impl->num_blocks);
 
    nir_metadata_require(impl, nir_metadata_block_index |
                               nir_metadata_dominance);
+   if (register_budget)
+      nir_metadata_require(impl, nir_metadata_live_ssa_defs);
+
+   state.blocks = rzalloc_array(NULL, struct gcm_block_info, impl->num_blocks);
+
+   gcm_build_block_info(&impl->body, &state, 0, NULL);
 
-   gcm_build_block_info(&impl->body, &state, 0);
+   /* This has to happen before any instructions move */
+   if (register_budget)
+      gcm_compute_loop_pressure(&state);
    nir_foreach_block(impl, gcm_pin_instructions_block, &state);
 
+   if (value_number)
+      gcm_value_number_instrs(&state);
+
    foreach_list_typed(nir_instr, instr, node, &state.instrs)
       gcm_schedule_early_instr(instr, &state);
 
@@ -482,13 +745,19 @@ opt_gcm_impl(nir_function_impl *impl)
    }
 
    ralloc_free(state.blocks);
+
+   nir_metadata_preserve(impl, nir_metadata_block_index |
+                               nir_metadata_dominance);
 }
 
 void
-nir_opt_gcm(nir_shader *shader)
+nir_opt_gcm(nir_shader *shader, bool value_number)
 {
+   unsigned read_only_modes = nir_shader_get_read_only_modes(shader);
+
    nir_foreach_function(shader, function) {
       if (function->impl)
-         opt_gcm_impl(function->impl);
+         opt_gcm_impl(function->impl, value_number, read_only_modes,
+                      shader->options->gcm_register_budget);
    }
 }
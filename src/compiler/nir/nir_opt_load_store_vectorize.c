@@ -0,0 +1,536 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_builder.h"
+
+#include <string.h>
+
+/** @file nir_opt_load_store_vectorize.c
+ *
+ * Combines UBO, SSBO and shared memory accesses of adjacent addresses into
+ * single, wider accesses.
+ *
+ * Scalarizing passes, struct member accesses and the like tend to leave
+ * behind runs of one-component loads and stores at consecutive offsets from
+ * the same base.  Within a block, we look for pairs of 32-bit accesses of
+ * the same kind whose byte ranges touch, and replace them by one access
+ * covering both as long as the driver's callback accepts the resulting size
+ * and alignment.  Repeating that on the result builds up vec2, vec3 and vec4
+ * accesses.
+ *
+ * Combined loads are emitted at the position of the earlier load and stores
+ * at the position of the later store.  Anything that may touch the same
+ * memory in between (other stores, atomics, barriers, ...) stops the pass
+ * from pairing across it; UBOs are read-only, so UBO loads pair freely.
+ */
+
+/** How many recent accesses we try pairing each new one with. */
+#define VECTORIZE_WINDOW 32
+
+enum mem_kind {
+   MEM_UBO,
+   MEM_SSBO,
+   MEM_SHARED,
+};
+
+struct mem_access {
+   nir_intrinsic_instr *intrin;
+   enum mem_kind kind;
+   bool is_store;
+
+   /** Non-constant part of the offset, or NULL if the offset is constant. */
+   nir_ssa_def *base;
+
+   /** Constant part of the offset in bytes, including any BASE index. */
+   int32_t offset;
+
+   unsigned num_components;
+};
+
+struct vectorize_state {
+   nir_builder builder;
+   nir_should_vectorize_mem_func callback;
+   void *data;
+   bool progress;
+
+   struct mem_access pending[VECTORIZE_WINDOW];
+   unsigned num_pending;
+};
+
+static int
+block_src_index(nir_intrinsic_op op)
+{
+   switch (op) {
+   case nir_intrinsic_load_ubo:
+   case nir_intrinsic_load_ssbo:
+      return 0;
+   case nir_intrinsic_store_ssbo:
+      return 1;
+   default:
+      return -1;
+   }
+}
+
+static int
+offset_src_index(nir_intrinsic_op op)
+{
+   switch (op) {
+   case nir_intrinsic_load_shared:
+      return 0;
+   case nir_intrinsic_load_ubo:
+   case nir_intrinsic_load_ssbo:
+   case nir_intrinsic_store_shared:
+      return 1;
+   case nir_intrinsic_store_ssbo:
+      return 2;
+   default:
+      unreachable("not a vectorizable memory access");
+   }
+}
+
+/**
+ * Splits an offset into a non-constant base plus a constant, looking
+ * through (chains of) iadds with a constant.
+ */
+static nir_ssa_def *
+parse_offset(nir_ssa_def *def, int32_t *offset)
+{
+   *offset = 0;
+
+   while (def->num_components == 1) {
+      nir_instr *parent = def->parent_instr;
+
+      if (parent->type == nir_instr_type_load_const) {
+         *offset += nir_instr_as_load_const(parent)->value.i32[0];
+         return NULL;
+      }
+
+      if (parent->type != nir_instr_type_alu)
+         break;
+
+      nir_alu_instr *alu = nir_instr_as_alu(parent);
+      if (alu->op != nir_op_iadd)
+         break;
+
+      nir_const_value *const_val = NULL;
+      unsigned other = 0;
+      for (unsigned i = 0; i < 2; i++) {
+         const_val = nir_src_as_const_value(alu->src[i].src);
+         if (const_val) {
+            other = 1 - i;
+            break;
+         }
+      }
+
+      if (!const_val || !alu->src[other].src.is_ssa ||
+          alu->src[other].src.ssa->num_components != 1 ||
+          alu->src[other].negate || alu->src[other].abs)
+         break;
+
+      *offset += const_val->i32[alu->src[1 - other].swizzle[0]];
+      def = alu->src[other].src.ssa;
+   }
+
+   return def;
+}
+
+/**
+ * Returns a power of two known to divide the value of def.
+ *
+ * Offsets of 32-bit accesses are always multiples of four.
+ */
+static unsigned
+ssa_alignment(nir_ssa_def *def)
+{
+   if (def->parent_instr->type != nir_instr_type_alu)
+      return 4;
+
+   nir_alu_instr *alu = nir_instr_as_alu(def->parent_instr);
+   nir_const_value *const_val;
+   unsigned align = 4;
+
+   switch (alu->op) {
+   case nir_op_imul:
+      for (unsigned i = 0; i < 2; i++) {
+         const_val = nir_src_as_const_value(alu->src[i].src);
+         if (const_val) {
+            uint32_t c = const_val->u32[alu->src[i].swizzle[0]];
+            if (c)
+               align = MAX2(align, c & -c);
+         }
+      }
+      break;
+   case nir_op_ishl:
+      const_val = nir_src_as_const_value(alu->src[1].src);
+      if (const_val) {
+         unsigned shift = const_val->u32[alu->src[1].swizzle[0]] & 31;
+         align = MAX2(align, 1u << shift);
+      }
+      break;
+   default:
+      break;
+   }
+
+   return align;
+}
+
+static bool
+parse_access(nir_intrinsic_instr *intrin, struct mem_access *access)
+{
+   switch (intrin->intrinsic) {
+   case nir_intrinsic_load_ubo:
+      access->kind = MEM_UBO;
+      access->is_store = false;
+      break;
+   case nir_intrinsic_load_ssbo:
+      access->kind = MEM_SSBO;
+      access->is_store = false;
+      break;
+   case nir_intrinsic_store_ssbo:
+      access->kind = MEM_SSBO;
+      access->is_store = true;
+      break;
+   case nir_intrinsic_load_shared:
+      access->kind = MEM_SHARED;
+      access->is_store = false;
+      break;
+   case nir_intrinsic_store_shared:
+      access->kind = MEM_SHARED;
+      access->is_store = true;
+      break;
+   default:
+      return false;
+   }
+
+   for (unsigned i = 0; i < nir_intrinsic_infos[intrin->intrinsic].num_srcs; i++) {
+      if (!intrin->src[i].is_ssa)
+         return false;
+   }
+
+   if (access->is_store) {
+      if (intrin->src[0].ssa->bit_size != 32 ||
+          nir_intrinsic_write_mask(intrin) != (1u << intrin->num_components) - 1)
+         return false;
+   } else {
+      if (!intrin->dest.is_ssa || intrin->dest.ssa.bit_size != 32)
+         return false;
+   }
+
+   access->intrin = intrin;
+   access->num_components = intrin->num_components;
+   access->base =
+      parse_offset(intrin->src[offset_src_index(intrin->intrinsic)].ssa,
+                   &access->offset);
+
+   if (access->kind == MEM_SHARED)
+      access->offset += nir_intrinsic_base(intrin);
+
+   return true;
+}
+
+static bool
+same_block_index(const struct mem_access *a, const struct mem_access *b)
+{
+   int index = block_src_index(a->intrin->intrinsic);
+   if (index < 0)
+      return true;
+
+   nir_ssa_def *block_a = a->intrin->src[index].ssa;
+   nir_ssa_def *block_b = b->intrin->src[index].ssa;
+   if (block_a == block_b)
+      return true;
+
+   nir_const_value *const_a = nir_src_as_const_value(a->intrin->src[index]);
+   nir_const_value *const_b = nir_src_as_const_value(b->intrin->src[index]);
+   return const_a && const_b && const_a->u32[0] == const_b->u32[0];
+}
+
+/** Is def defined somewhere that dominates instr? */
+static bool
+def_available_before(nir_ssa_def *def, nir_instr *instr)
+{
+   /* Any def used in this block from another block dominates all of it. */
+   if (def->parent_instr->block != instr->block)
+      return true;
+
+   for (nir_instr *prev = nir_instr_prev(instr); prev;
+        prev = nir_instr_prev(prev)) {
+      if (prev == def->parent_instr)
+         return true;
+   }
+
+   return false;
+}
+
+static bool
+srcs_available_before(nir_intrinsic_instr *intrin, nir_instr *instr)
+{
+   for (unsigned i = 0; i < nir_intrinsic_infos[intrin->intrinsic].num_srcs; i++) {
+      if (!def_available_before(intrin->src[i].ssa, instr))
+         return false;
+   }
+   return true;
+}
+
+/**
+ * Try to combine the earlier access "first" with the later one "second",
+ * filling in the combined access on success.
+ */
+static bool
+try_combine(struct vectorize_state *state,
+            const struct mem_access *first, const struct mem_access *second,
+            struct mem_access *combined)
+{
+   if (first->intrin->intrinsic != second->intrin->intrinsic ||
+       first->base != second->base || !same_block_index(first, second))
+      return false;
+
+   const struct mem_access *low, *high;
+   if (first->offset + 4 * (int32_t) first->num_components == second->offset) {
+      low = first;
+      high = second;
+   } else if (second->offset + 4 * (int32_t) second->num_components ==
+              first->offset) {
+      low = second;
+      high = first;
+   } else {
+      return false;
+   }
+
+   const unsigned num_components = low->num_components + high->num_components;
+   if (num_components > 4)
+      return false;
+
+   unsigned align_mul = low->base ? ssa_alignment(low->base) : 1u << 31;
+   unsigned align_offset = (uint32_t) low->offset & (align_mul - 1);
+   if (!state->callback(low->intrin->intrinsic, num_components,
+                        align_mul, align_offset, state->data))
+      return false;
+
+   nir_builder *b = &state->builder;
+   nir_intrinsic_op op = low->intrin->intrinsic;
+   int block_index = block_src_index(op);
+   int offset_index = offset_src_index(op);
+
+   nir_intrinsic_instr *intrin = nir_intrinsic_instr_create(b->shader, op);
+   intrin->num_components = num_components;
+   if (block_index >= 0)
+      intrin->src[block_index] = nir_src_for_ssa(low->intrin->src[block_index].ssa);
+   intrin->src[offset_index] = nir_src_for_ssa(low->intrin->src[offset_index].ssa);
+   if (low->kind == MEM_SHARED)
+      nir_intrinsic_set_base(intrin, nir_intrinsic_base(low->intrin));
+
+   if (first->is_store) {
+      /* The values and addresses of both stores are available at the later
+       * one, so that's where the combined store goes.
+       */
+      nir_ssa_def *comps[4];
+      b->cursor = nir_before_instr(&second->intrin->instr);
+      for (unsigned i = 0; i < low->num_components; i++)
+         comps[i] = nir_channel(b, low->intrin->src[0].ssa, i);
+      for (unsigned i = 0; i < high->num_components; i++)
+         comps[low->num_components + i] =
+            nir_channel(b, high->intrin->src[0].ssa, i);
+
+      intrin->src[0] = nir_src_for_ssa(nir_vec(b, comps, num_components));
+      nir_intrinsic_set_write_mask(intrin, (1u << num_components) - 1);
+      nir_builder_instr_insert(b, &intrin->instr);
+   } else {
+      /* The combined load replaces the earlier one, so whatever it uses has
+       * to be around already at that point.
+       */
+      if (!srcs_available_before(low->intrin, &first->intrin->instr)) {
+         ralloc_free(intrin);
+         return false;
+      }
+
+      nir_ssa_dest_init(&intrin->instr, &intrin->dest, num_components, 32,
+                        NULL);
+      b->cursor = nir_before_instr(&first->intrin->instr);
+      nir_builder_instr_insert(b, &intrin->instr);
+
+      unsigned swiz[4] = { 0, 1, 2, 3 };
+      nir_ssa_def *low_val =
+         nir_swizzle(b, &intrin->dest.ssa, swiz, low->num_components, false);
+      for (unsigned i = 0; i < high->num_components; i++)
+         swiz[i] = low->num_components + i;
+      nir_ssa_def *high_val =
+         nir_swizzle(b, &intrin->dest.ssa, swiz, high->num_components, false);
+
+      nir_ssa_def_rewrite_uses(&low->intrin->dest.ssa,
+                               nir_src_for_ssa(low_val));
+      nir_ssa_def_rewrite_uses(&high->intrin->dest.ssa,
+                               nir_src_for_ssa(high_val));
+   }
+
+   *combined = *low;
+   combined->intrin = intrin;
+   combined->num_components = num_components;
+
+   nir_instr_remove(&first->intrin->instr);
+   nir_instr_remove(&second->intrin->instr);
+
+   return true;
+}
+
+/** Forget the pending accesses of the given kind matching is_store. */
+static void
+invalidate(struct vectorize_state *state, enum mem_kind kind, bool is_store)
+{
+   unsigned j = 0;
+
+   for (unsigned i = 0; i < state->num_pending; i++) {
+      if (state->pending[i].kind != kind ||
+          state->pending[i].is_store != is_store)
+         state->pending[j++] = state->pending[i];
+   }
+
+   state->num_pending = j;
+}
+
+static void
+add_pending(struct vectorize_state *state, const struct mem_access *access)
+{
+   if (state->num_pending == VECTORIZE_WINDOW) {
+      memmove(&state->pending[0], &state->pending[1],
+              (VECTORIZE_WINDOW - 1) * sizeof(state->pending[0]));
+      state->num_pending--;
+   }
+
+   state->pending[state->num_pending++] = *access;
+}
+
+static void
+handle_access(struct vectorize_state *state, struct mem_access *access)
+{
+   for (unsigned i = 0; i < state->num_pending; i++) {
+      struct mem_access *pending = &state->pending[i];
+      struct mem_access combined;
+
+      if (pending->is_store != access->is_store)
+         continue;
+
+      if (try_combine(state, pending, access, &combined)) {
+         state->progress = true;
+
+         /* Drop the old entry; the combined access is now the most recent
+          * one and may be combined again.
+          */
+         memmove(pending, pending + 1,
+                 (state->num_pending - i - 1) * sizeof(*pending));
+         state->num_pending--;
+         *access = combined;
+         break;
+      }
+   }
+
+   if (access->kind != MEM_UBO) {
+      if (access->is_store) {
+         /* Neither an earlier load nor an earlier store may be moved across
+          * this store anymore.
+          */
+         invalidate(state, access->kind, false);
+         invalidate(state, access->kind, true);
+      } else {
+         /* Stores can't be delayed past a load that might read them. */
+         invalidate(state, access->kind, true);
+      }
+   }
+
+   add_pending(state, access);
+}
+
+static bool
+vectorize_block(nir_block *block, void *void_state)
+{
+   struct vectorize_state *state = void_state;
+
+   state->num_pending = 0;
+
+   nir_foreach_instr_safe(block, instr) {
+      if (instr->type == nir_instr_type_call) {
+         state->num_pending = 0;
+         continue;
+      }
+
+      if (instr->type != nir_instr_type_intrinsic)
+         continue;
+
+      nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+      struct mem_access access;
+
+      if (parse_access(intrin, &access)) {
+         handle_access(state, &access);
+      } else if (!(nir_intrinsic_infos[intrin->intrinsic].flags &
+                   NIR_INTRINSIC_CAN_REORDER)) {
+         /* Barriers, atomics, other stores and so on: only UBO loads may
+          * still be combined across them.
+          */
+         invalidate(state, MEM_SSBO, false);
+         invalidate(state, MEM_SSBO, true);
+         invalidate(state, MEM_SHARED, false);
+         invalidate(state, MEM_SHARED, true);
+      }
+   }
+
+   return true;
+}
+
+static bool
+nir_opt_load_store_vectorize_impl(nir_function_impl *impl,
+                                  nir_should_vectorize_mem_func callback,
+                                  void *data)
+{
+   struct vectorize_state state;
+
+   nir_builder_init(&state.builder, impl);
+   state.callback = callback;
+   state.data = data;
+   state.progress = false;
+   state.num_pending = 0;
+
+   nir_foreach_block(impl, vectorize_block, &state);
+
+   if (state.progress)
+      nir_metadata_preserve(impl, nir_metadata_block_index |
+                                  nir_metadata_dominance);
+
+   return state.progress;
+}
+
+bool
+nir_opt_load_store_vectorize(nir_shader *shader,
+                             nir_should_vectorize_mem_func callback,
+                             void *data)
+{
+   bool progress = false;
+
+   nir_foreach_function(shader, function) {
+      if (function->impl)
+         progress |= nir_opt_load_store_vectorize_impl(function->impl,
+                                                       callback, data);
+   }
+
+   return progress;
+}
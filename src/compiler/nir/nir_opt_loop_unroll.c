@@ -0,0 +1,245 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_control_flow.h"
+
+/*
+ * Fully unrolls loops whose trip count nir_loop_analyze_impl() was able to
+ * work out, as long as the result stays within the limits the driver set in
+ * nir_shader_compiler_options.
+ *
+ * A loop of the form
+ *
+ *    loop {
+ *       header (phis, terminator condition)
+ *       if (cond) break;
+ *       body
+ *    }
+ *
+ * that runs the body N times becomes N copies of header + body followed by
+ * one last copy of the header, which is the iteration in which the
+ * terminator fires.  The terminator itself is dropped since we know which
+ * way it goes every time; the condition computations are left for DCE.
+ *
+ * Header phis are handled with the remap table of nir_cf_list_clone(): each
+ * phi is mapped to its value on entry to the iteration being cloned,
+ * starting with the value from the block before the loop and then whatever
+ * the previous copy computed for the back-edge.  Only values from the
+ * header dominate the code after the loop, so the original header is used
+ * as the last copy and uses after the loop don't have to be touched.
+ */
+
+static nir_ssa_def *
+remap_def(struct hash_table *remap_table, nir_ssa_def *def)
+{
+   struct hash_entry *entry = _mesa_hash_table_search(remap_table, def);
+   return entry ? entry->data : def;
+}
+
+static void
+loop_unroll_full(nir_loop *loop)
+{
+   nir_loop_info *info = loop->info;
+   nir_block *header = nir_cf_node_as_block(nir_loop_first_cf_node(loop));
+   nir_block *preheader =
+      nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+   nir_block *latch = nir_cf_node_as_block(nir_loop_last_cf_node(loop));
+   nir_cf_node *parent = loop->cf_node.parent;
+
+   struct hash_table *remap_table =
+      _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                              _mesa_key_pointer_equal);
+
+   /* Grab everything we need from the phis up front.  Extracting the body
+    * and header below splits blocks, so the block pointers in the phi
+    * sources can't be trusted afterwards.
+    */
+   unsigned num_phis = 0;
+   nir_instr *last_phi = NULL;
+   nir_foreach_instr(header, instr) {
+      if (instr->type != nir_instr_type_phi)
+         break;
+
+      last_phi = instr;
+      num_phis++;
+   }
+
+   nir_ssa_def **phi_defs = ralloc_array(NULL, nir_ssa_def *, num_phis);
+   nir_ssa_def **latch_defs = ralloc_array(phi_defs, nir_ssa_def *, num_phis);
+   nir_ssa_def **next_values = ralloc_array(phi_defs, nir_ssa_def *, num_phis);
+
+   unsigned p = 0;
+   nir_foreach_instr(header, instr) {
+      if (instr->type != nir_instr_type_phi)
+         break;
+
+      nir_phi_instr *phi = nir_instr_as_phi(instr);
+      phi_defs[p] = &phi->dest.ssa;
+      nir_foreach_phi_src(phi, src) {
+         if (src->pred == preheader)
+            _mesa_hash_table_insert(remap_table, phi_defs[p], src->src.ssa);
+         else if (src->pred == latch)
+            latch_defs[p] = src->src.ssa;
+      }
+      p++;
+   }
+
+   /* Pull the body and the non-phi part of the header out of the loop.
+    * What's left is the phis and the terminator.
+    */
+   nir_cf_list header_list, body_list;
+   nir_cf_extract(&body_list, nir_after_cf_node(&info->terminator->cf_node),
+                  nir_after_block(latch));
+   nir_cf_extract(&header_list,
+                  last_phi ? nir_after_instr(last_phi) :
+                             nir_before_block(header),
+                  nir_before_cf_node(&info->terminator->cf_node));
+
+   for (unsigned i = 0; i < info->trip_count; i++) {
+      nir_cf_list clone;
+
+      nir_cf_list_clone(&clone, &header_list, parent, remap_table);
+      nir_cf_reinsert(&clone, nir_before_cf_node(&loop->cf_node));
+
+      nir_cf_list_clone(&clone, &body_list, parent, remap_table);
+      nir_cf_reinsert(&clone, nir_before_cf_node(&loop->cf_node));
+
+      /* All of the new values have to be looked up before any of them get
+       * replaced since a phi may feed another phi's back-edge value.
+       */
+      for (p = 0; p < num_phis; p++)
+         next_values[p] = remap_def(remap_table, latch_defs[p]);
+
+      for (p = 0; p < num_phis; p++)
+         _mesa_hash_table_insert(remap_table, phi_defs[p], next_values[p]);
+   }
+
+   /* The original header becomes the final iteration.  Any remaining uses
+    * of the phis, in there or after the loop, get the values from the last
+    * trip through the body.
+    */
+   for (p = 0; p < num_phis; p++) {
+      nir_ssa_def_rewrite_uses(phi_defs[p],
+                               nir_src_for_ssa(remap_def(remap_table,
+                                                         phi_defs[p])));
+   }
+
+   nir_cf_reinsert(&header_list, nir_before_cf_node(&loop->cf_node));
+
+   nir_cf_node_remove(&loop->cf_node);
+   nir_cf_delete(&body_list);
+
+   ralloc_free(phi_defs);
+   _mesa_hash_table_destroy(remap_table, NULL);
+}
+
+static bool
+should_unroll(nir_loop_info *info, const nir_shader_compiler_options *options)
+{
+   if (!info || !info->terminator || !info->trip_count_known)
+      return false;
+
+   if (info->trip_count > options->max_unroll_iterations)
+      return false;
+
+   /* The header runs one more time than the body, but it's usually just a
+    * compare so don't bother counting it separately.
+    */
+   return info->num_instructions * info->trip_count <=
+          options->max_unroll_instructions;
+}
+
+/* Returns true if anything in the list was unrolled.  A loop is only
+ * considered once nothing inside it has been unrolled in this pass since
+ * its analysis is stale otherwise.  We also stop walking a list as soon as
+ * we've unrolled something in it because unrolling merges the blocks around
+ * the loop.  In both cases the driver's optimization loop gets to the rest
+ * on the next round.
+ */
+static bool
+process_cf_list(struct exec_list *cf_list,
+                const nir_shader_compiler_options *options)
+{
+   bool progress = false;
+
+   foreach_list_typed(nir_cf_node, node, node, cf_list) {
+      switch (node->type) {
+      case nir_cf_node_block:
+         break;
+
+      case nir_cf_node_if: {
+         nir_if *if_stmt = nir_cf_node_as_if(node);
+         progress |= process_cf_list(&if_stmt->then_list, options);
+         progress |= process_cf_list(&if_stmt->else_list, options);
+         break;
+      }
+
+      case nir_cf_node_loop: {
+         nir_loop *loop = nir_cf_node_as_loop(node);
+         if (process_cf_list(&loop->body, options)) {
+            progress = true;
+         } else if (should_unroll(loop->info, options)) {
+            loop_unroll_full(loop);
+            return true;
+         }
+         break;
+      }
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+
+   return progress;
+}
+
+static bool
+nir_opt_loop_unroll_impl(nir_function_impl *impl,
+                         const nir_shader_compiler_options *options)
+{
+   nir_metadata_require(impl, nir_metadata_loop_analysis);
+
+   bool progress = process_cf_list(&impl->body, options);
+
+   if (progress)
+      nir_metadata_preserve(impl, nir_metadata_none);
+
+   return progress;
+}
+
+bool
+nir_opt_loop_unroll(nir_shader *shader)
+{
+   bool progress = false;
+
+   if (shader->options->max_unroll_iterations == 0)
+      return false;
+
+   nir_foreach_function(shader, function) {
+      if (function->impl)
+         progress |= nir_opt_loop_unroll_impl(function->impl, shader->options);
+   }
+
+   return progress;
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "c11/threads.h"
+#include "util/debug.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Runtime statistics for passes run through NIR_PASS() and NIR_PASS_V().
+ *
+ * Setting NIR_PASS_STATS to 1 (or true/yes) prints a report to stderr when
+ * the process exits; any other value that isn't 0/false/no is taken as the
+ * name of a file to append the report to instead.  For every pass, the
+ * report has the number of runs, how many of them made progress (passes
+ * run through NIR_PASS_V() don't report it), the total wall time and the
+ * total change in instruction count.  Drivers also report the number of
+ * iterations their optimization loops took with nir_pass_stats_loop().
+ *
+ * Statistics are aggregated by name across all shaders and threads.
+ */
+
+struct pass_stats {
+   const char *name;
+   unsigned runs;
+   unsigned progress_known;
+   unsigned progress;
+   int64_t time_ns;
+   int64_t instr_delta;
+};
+
+struct loop_stats {
+   const char *name;
+   unsigned runs;
+   unsigned iterations;
+   unsigned max_iterations;
+};
+
+static mtx_t stats_mutex = _MTX_INITIALIZER_NP;
+static const char *stats_file;
+static struct hash_table *pass_table;
+static struct hash_table *loop_table;
+
+static int64_t
+get_time_ns(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_nsec + tv.tv_sec * INT64_C(1000000000);
+#else
+   return (int64_t) clock() * (INT64_C(1000000000) / CLOCKS_PER_SEC);
+#endif
+}
+
+static bool
+count_instrs_block(nir_block *block, void *data)
+{
+   unsigned *count = data;
+
+   nir_foreach_instr(block, instr)
+      (*count)++;
+
+   return true;
+}
+
+static unsigned
+count_instrs(nir_shader *shader)
+{
+   unsigned count = 0;
+
+   nir_foreach_function(shader, function) {
+      if (function->impl)
+         nir_foreach_block(function->impl, count_instrs_block, &count);
+   }
+
+   return count;
+}
+
+static int
+compare_pass_time(const void *a, const void *b)
+{
+   const struct pass_stats *pa = *(const struct pass_stats **) a;
+   const struct pass_stats *pb = *(const struct pass_stats **) b;
+
+   if (pa->time_ns != pb->time_ns)
+      return pa->time_ns < pb->time_ns ? 1 : -1;
+   return strcmp(pa->name, pb->name);
+}
+
+static void
+print_report(void)
+{
+   FILE *fp = stderr;
+
+   mtx_lock(&stats_mutex);
+
+   if (pass_table == NULL) {
+      mtx_unlock(&stats_mutex);
+      return;
+   }
+
+   if (strcmp(stats_file, "stderr") != 0) {
+      fp = fopen(stats_file, "a");
+      if (!fp) {
+         fprintf(stderr, "NIR_PASS_STATS: couldn't open %s\n", stats_file);
+         fp = stderr;
+      }
+   }
+
+   unsigned num_passes = pass_table->entries;
+   struct pass_stats **passes =
+      ralloc_array(NULL, struct pass_stats *, num_passes);
+   unsigned i = 0;
+   int64_t total_ns = 0;
+   struct hash_entry *entry;
+   hash_table_foreach(pass_table, entry) {
+      passes[i] = entry->data;
+      total_ns += passes[i]->time_ns;
+      i++;
+   }
+   qsort(passes, num_passes, sizeof(*passes), compare_pass_time);
+
+   fprintf(fp, "NIR pass statistics: %.3f ms in passes\n",
+           total_ns / 1000000.0);
+   fprintf(fp, "   %-36s %8s %8s %10s %6s %12s\n",
+           "pass", "runs", "progress", "ms", "%", "instr delta");
+   for (i = 0; i < num_passes; i++) {
+      const struct pass_stats *pass = passes[i];
+      char progress[16];
+
+      if (pass->progress_known)
+         snprintf(progress, sizeof(progress), "%u", pass->progress);
+      else
+         snprintf(progress, sizeof(progress), "-");
+
+      fprintf(fp, "   %-36s %8u %8s %10.3f %6.1f %+12" PRId64 "\n",
+              pass->name, pass->runs, progress, pass->time_ns / 1000000.0,
+              total_ns ? pass->time_ns * 100.0 / total_ns : 0.0,
+              pass->instr_delta);
+   }
+   ralloc_free(passes);
+
+   if (loop_table->entries) {
+      fprintf(fp, "   %-36s %8s %10s %8s\n",
+              "optimization loop", "runs", "avg iters", "max");
+      hash_table_foreach(loop_table, entry) {
+         const struct loop_stats *loop = entry->data;
+         fprintf(fp, "   %-36s %8u %10.2f %8u\n",
+                 loop->name, loop->runs,
+                 (double) loop->iterations / loop->runs,
+                 loop->max_iterations);
+      }
+   }
+
+   if (fp != stderr)
+      fclose(fp);
+
+   ralloc_free(pass_table);
+   ralloc_free(loop_table);
+   pass_table = loop_table = NULL;
+
+   mtx_unlock(&stats_mutex);
+}
+
+bool
+nir_pass_stats_init(void)
+{
+   static int enabled = -1;
+
+   mtx_lock(&stats_mutex);
+
+   if (enabled < 0) {
+      /* Anything env_var_as_boolean() doesn't recognize is a file name */
+      if (env_var_as_boolean("NIR_PASS_STATS", false))
+         stats_file = "stderr";
+      else if (env_var_as_boolean("NIR_PASS_STATS", true))
+         stats_file = getenv("NIR_PASS_STATS");
+
+      enabled = stats_file != NULL;
+      if (enabled) {
+         pass_table = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                                              _mesa_key_string_equal);
+         loop_table = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                                              _mesa_key_string_equal);
+         atexit(print_report);
+      }
+   }
+
+   mtx_unlock(&stats_mutex);
+
+   return enabled;
+}
+
+void
+nir_pass_stats_begin(nir_shader *shader, struct nir_pass_sample *sample)
+{
+   sample->num_instrs = count_instrs(shader);
+   sample->start_ns = get_time_ns();
+}
+
+void
+nir_pass_stats_end(nir_shader *shader, struct nir_pass_sample *sample,
+                   const char *name, int progress)
+{
+   int64_t time_ns = get_time_ns() - sample->start_ns;
+   int64_t instr_delta = (int64_t) count_instrs(shader) - sample->num_instrs;
+
+   mtx_lock(&stats_mutex);
+
+   if (pass_table) {
+      struct pass_stats *pass;
+      struct hash_entry *entry = _mesa_hash_table_search(pass_table, name);
+      if (entry) {
+         pass = entry->data;
+      } else {
+         pass = rzalloc(pass_table, struct pass_stats);
+         pass->name = ralloc_strdup(pass, name);
+         _mesa_hash_table_insert(pass_table, pass->name, pass);
+      }
+
+      pass->runs++;
+      pass->time_ns += time_ns;
+      pass->instr_delta += instr_delta;
+      if (progress >= 0) {
+         pass->progress_known++;
+         pass->progress += progress != 0;
+      }
+   }
+
+   mtx_unlock(&stats_mutex);
+}
+
+void
+nir_pass_stats_loop(const char *name, unsigned iterations)
+{
+   if (!nir_should_record_pass_stats())
+      return;
+
+   mtx_lock(&stats_mutex);
+
+   if (loop_table) {
+      struct loop_stats *loop;
+      struct hash_entry *entry = _mesa_hash_table_search(loop_table, name);
+      if (entry) {
+         loop = entry->data;
+      } else {
+         loop = rzalloc(loop_table, struct loop_stats);
+         loop->name = ralloc_strdup(loop, name);
+         _mesa_hash_table_insert(loop_table, loop->name, loop);
+      }
+
+      loop->runs++;
+      loop->iterations += iterations;
+      if (iterations > loop->max_iterations)
+         loop->max_iterations = iterations;
+   }
+
+   mtx_unlock(&stats_mutex);
+}
@@ -0,0 +1,1413 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir_serialize.h"
+#include "nir_control_flow_private.h"
+
+/* The writer and the reader walk the shader in exactly the same order.
+ * Every object that can be pointed to (variables, registers, SSA values,
+ * blocks and functions) gets the next index from a single counter when it
+ * is written, so the reader can rebuild the mapping by appending objects to
+ * a table as it creates them.  Index 0 is reserved for NULL.
+ *
+ * The only forward references in NIR are phi sources, which may name a
+ * value or predecessor block that comes later in the function.  Those are
+ * written after the body of each function_impl, once everything in it has
+ * an index, and wired up by the reader in the same place.
+ *
+ * glsl_types go into a separate table.  The first reference to a type is
+ * written as NEW_TYPE followed by its description (whose own type
+ * references may define further types); the type gets its index once the
+ * description is complete.  Every later reference is just the index.
+ */
+
+#define NEW_TYPE UINT32_MAX
+
+typedef struct {
+   struct blob *blob;
+
+   /* maps pointer to object index */
+   struct hash_table *remap_table;
+   uint32_t next_idx;
+
+   /* maps glsl_type pointer to type index */
+   struct hash_table *type_table;
+   uint32_t next_type_idx;
+
+   /* phis in the function_impl being written, in order */
+   const nir_phi_instr **phis;
+   unsigned num_phis, phis_size;
+} write_ctx;
+
+typedef struct {
+   nir_shader *nir;
+
+   struct blob_reader *blob;
+
+   /* object index -> pointer */
+   void **idx_table;
+   uint32_t next_idx, idx_table_size;
+
+   /* type index -> glsl_type */
+   const struct glsl_type **types;
+   uint32_t next_type_idx, types_size;
+
+   /* phis in the function_impl being read, in order */
+   nir_phi_instr **phis;
+   unsigned num_phis, phis_size;
+} read_ctx;
+
+static void
+write_add_object(write_ctx *ctx, const void *obj)
+{
+   uint32_t index = ctx->next_idx++;
+   _mesa_hash_table_insert(ctx->remap_table, obj, (void *)(uintptr_t) index);
+}
+
+static uint32_t
+write_lookup_object(write_ctx *ctx, const void *obj)
+{
+   struct hash_entry *entry;
+
+   if (!obj)
+      return 0;
+
+   entry = _mesa_hash_table_search(ctx->remap_table, obj);
+   assert(entry && "Failed to find pointer!");
+   if (!entry)
+      return 0;
+
+   return (uint32_t)(uintptr_t) entry->data;
+}
+
+static void
+read_add_object(read_ctx *ctx, void *obj)
+{
+   if (ctx->next_idx == ctx->idx_table_size) {
+      ctx->idx_table_size *= 2;
+      ctx->idx_table = reralloc(ctx, ctx->idx_table, void *,
+                                ctx->idx_table_size);
+   }
+   ctx->idx_table[ctx->next_idx++] = obj;
+}
+
+static void *
+read_lookup_object(read_ctx *ctx, uint32_t idx)
+{
+   assert(idx < ctx->next_idx);
+   return idx < ctx->next_idx ? ctx->idx_table[idx] : NULL;
+}
+
+static void
+read_add_type(read_ctx *ctx, const struct glsl_type *type)
+{
+   if (ctx->next_type_idx == ctx->types_size) {
+      ctx->types_size *= 2;
+      ctx->types = reralloc(ctx, ctx->types, const struct glsl_type *,
+                            ctx->types_size);
+   }
+   ctx->types[ctx->next_type_idx++] = type;
+}
+
+static void
+write_string(write_ctx *ctx, const char *str)
+{
+   blob_write_uint32(ctx->blob, str != NULL);
+   if (str)
+      blob_write_string(ctx->blob, str);
+}
+
+static const char *
+read_string(read_ctx *ctx)
+{
+   if (!blob_read_uint32(ctx->blob))
+      return NULL;
+   return blob_read_string(ctx->blob);
+}
+
+static void write_type(write_ctx *ctx, const struct glsl_type *type);
+static const struct glsl_type *read_type(read_ctx *ctx);
+
+static void
+write_struct_fields(write_ctx *ctx, const struct glsl_type *type)
+{
+   unsigned length = glsl_get_length(type);
+
+   blob_write_uint32(ctx->blob, length);
+   for (unsigned i = 0; i < length; i++) {
+      const struct glsl_struct_field *field =
+         glsl_get_struct_field_data(type, i);
+
+      write_type(ctx, field->type);
+      blob_write_string(ctx->blob, field->name);
+      blob_write_uint32(ctx->blob, field->location);
+      blob_write_uint32(ctx->blob, field->offset);
+      blob_write_uint32(ctx->blob,
+                        field->interpolation |
+                        field->centroid << 2 |
+                        field->sample << 3 |
+                        field->matrix_layout << 4 |
+                        field->patch << 6 |
+                        field->precision << 7 |
+                        field->image_read_only << 9 |
+                        field->image_write_only << 10 |
+                        field->image_coherent << 11 |
+                        field->image_volatile << 12 |
+                        field->image_restrict << 13);
+   }
+}
+
+static struct glsl_struct_field *
+read_struct_fields(read_ctx *ctx, void *mem_ctx, unsigned *num_fields)
+{
+   unsigned length = blob_read_uint32(ctx->blob);
+   struct glsl_struct_field *fields =
+      rzalloc_array(mem_ctx, struct glsl_struct_field, length);
+
+   for (unsigned i = 0; i < length; i++) {
+      struct glsl_struct_field *field = &fields[i];
+
+      field->type = read_type(ctx);
+      field->name = blob_read_string(ctx->blob);
+      field->location = blob_read_uint32(ctx->blob);
+      field->offset = blob_read_uint32(ctx->blob);
+
+      uint32_t flags = blob_read_uint32(ctx->blob);
+      field->interpolation = flags & 0x3;
+      field->centroid = (flags >> 2) & 0x1;
+      field->sample = (flags >> 3) & 0x1;
+      field->matrix_layout = (flags >> 4) & 0x3;
+      field->patch = (flags >> 6) & 0x1;
+      field->precision = (flags >> 7) & 0x3;
+      field->image_read_only = (flags >> 9) & 0x1;
+      field->image_write_only = (flags >> 10) & 0x1;
+      field->image_coherent = (flags >> 11) & 0x1;
+      field->image_volatile = (flags >> 12) & 0x1;
+      field->image_restrict = (flags >> 13) & 0x1;
+   }
+
+   *num_fields = length;
+   return fields;
+}
+
+static void
+encode_type(write_ctx *ctx, const struct glsl_type *type)
+{
+   enum glsl_base_type base_type = glsl_get_base_type(type);
+
+   blob_write_uint32(ctx->blob, base_type);
+
+   switch (base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_DOUBLE:
+   case GLSL_TYPE_BOOL:
+      blob_write_uint32(ctx->blob, glsl_get_vector_elements(type) |
+                                   glsl_get_matrix_columns(type) << 8);
+      break;
+   case GLSL_TYPE_SAMPLER:
+      /* The bare sampler has no result type */
+      if (type == glsl_bare_sampler_type()) {
+         blob_write_uint32(ctx->blob, GLSL_TYPE_VOID);
+         break;
+      }
+      blob_write_uint32(ctx->blob, glsl_get_sampler_result_type(type));
+      blob_write_uint32(ctx->blob, glsl_get_sampler_dim(type) |
+                                   glsl_sampler_type_is_shadow(type) << 4 |
+                                   glsl_sampler_type_is_array(type) << 5);
+      break;
+   case GLSL_TYPE_IMAGE:
+      blob_write_uint32(ctx->blob, glsl_get_sampler_result_type(type));
+      blob_write_uint32(ctx->blob, glsl_get_sampler_dim(type) |
+                                   glsl_sampler_type_is_array(type) << 5);
+      break;
+   case GLSL_TYPE_ATOMIC_UINT:
+   case GLSL_TYPE_VOID:
+      break;
+   case GLSL_TYPE_STRUCT:
+      blob_write_string(ctx->blob, glsl_get_type_name(type));
+      write_struct_fields(ctx, type);
+      break;
+   case GLSL_TYPE_INTERFACE:
+      blob_write_string(ctx->blob, glsl_get_type_name(type));
+      blob_write_uint32(ctx->blob, glsl_get_interface_packing(type));
+      write_struct_fields(ctx, type);
+      break;
+   case GLSL_TYPE_ARRAY:
+      write_type(ctx, glsl_get_array_element(type));
+      blob_write_uint32(ctx->blob, glsl_get_length(type));
+      break;
+   case GLSL_TYPE_SUBROUTINE:
+      blob_write_string(ctx->blob, glsl_get_type_name(type));
+      break;
+   case GLSL_TYPE_FUNCTION: {
+      unsigned num_params = glsl_get_length(type);
+
+      write_type(ctx, glsl_get_function_return_type(type));
+      blob_write_uint32(ctx->blob, num_params);
+      for (unsigned i = 0; i < num_params; i++) {
+         const struct glsl_function_param *param =
+            glsl_get_function_param(type, i);
+         write_type(ctx, param->type);
+         blob_write_uint32(ctx->blob, param->in | param->out << 1);
+      }
+      break;
+   }
+   default:
+      unreachable("cannot serialize this type");
+   }
+}
+
+static const struct glsl_type *
+decode_type(read_ctx *ctx)
+{
+   enum glsl_base_type base_type = blob_read_uint32(ctx->blob);
+
+   switch (base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_DOUBLE:
+   case GLSL_TYPE_BOOL: {
+      uint32_t dims = blob_read_uint32(ctx->blob);
+      unsigned rows = dims & 0xff, columns = dims >> 8;
+      if (columns > 1)
+         return glsl_matrix_type(base_type, rows, columns);
+      else if (rows > 1)
+         return glsl_vector_type(base_type, rows);
+      else
+         return glsl_scalar_type(base_type);
+   }
+   case GLSL_TYPE_SAMPLER: {
+      enum glsl_base_type result = blob_read_uint32(ctx->blob);
+      if (result == GLSL_TYPE_VOID)
+         return glsl_bare_sampler_type();
+      uint32_t bits = blob_read_uint32(ctx->blob);
+      return glsl_sampler_type(bits & 0xf, (bits >> 4) & 1, (bits >> 5) & 1,
+                               result);
+   }
+   case GLSL_TYPE_IMAGE: {
+      enum glsl_base_type result = blob_read_uint32(ctx->blob);
+      uint32_t bits = blob_read_uint32(ctx->blob);
+      return glsl_image_type(bits & 0xf, (bits >> 5) & 1, result);
+   }
+   case GLSL_TYPE_ATOMIC_UINT:
+      return glsl_atomic_uint_type();
+   case GLSL_TYPE_VOID:
+      return glsl_void_type();
+   case GLSL_TYPE_STRUCT: {
+      const char *name = blob_read_string(ctx->blob);
+      unsigned num_fields;
+      struct glsl_struct_field *fields =
+         read_struct_fields(ctx, ctx, &num_fields);
+      const struct glsl_type *type = glsl_struct_type(fields, num_fields, name);
+      ralloc_free(fields);
+      return type;
+   }
+   case GLSL_TYPE_INTERFACE: {
+      const char *name = blob_read_string(ctx->blob);
+      enum glsl_interface_packing packing = blob_read_uint32(ctx->blob);
+      unsigned num_fields;
+      struct glsl_struct_field *fields =
+         read_struct_fields(ctx, ctx, &num_fields);
+      const struct glsl_type *type =
+         glsl_interface_type(fields, num_fields, packing, name);
+      ralloc_free(fields);
+      return type;
+   }
+   case GLSL_TYPE_ARRAY: {
+      const struct glsl_type *elem = read_type(ctx);
+      return glsl_array_type(elem, blob_read_uint32(ctx->blob));
+   }
+   case GLSL_TYPE_SUBROUTINE:
+      return glsl_subroutine_type(blob_read_string(ctx->blob));
+   case GLSL_TYPE_FUNCTION: {
+      const struct glsl_type *return_type = read_type(ctx);
+      unsigned num_params = blob_read_uint32(ctx->blob);
+      struct glsl_function_param *params =
+         ralloc_array(ctx, struct glsl_function_param, num_params);
+      for (unsigned i = 0; i < num_params; i++) {
+         params[i].type = read_type(ctx);
+         uint32_t dir = blob_read_uint32(ctx->blob);
+         params[i].in = dir & 1;
+         params[i].out = (dir >> 1) & 1;
+      }
+      const struct glsl_type *type =
+         glsl_function_type(return_type, params, num_params);
+      ralloc_free(params);
+      return type;
+   }
+   default:
+      assert(!"invalid type in NIR blob");
+      return glsl_void_type();
+   }
+}
+
+static void
+write_type(write_ctx *ctx, const struct glsl_type *type)
+{
+   struct hash_entry *entry;
+
+   if (!type) {
+      blob_write_uint32(ctx->blob, 0);
+      return;
+   }
+
+   entry = _mesa_hash_table_search(ctx->type_table, type);
+   if (entry) {
+      blob_write_uint32(ctx->blob, (uint32_t)(uintptr_t) entry->data);
+      return;
+   }
+
+   blob_write_uint32(ctx->blob, NEW_TYPE);
+   encode_type(ctx, type);
+
+   /* Types referenced by the description have already been numbered */
+   _mesa_hash_table_insert(ctx->type_table, type,
+                           (void *)(uintptr_t) ctx->next_type_idx++);
+}
+
+static const struct glsl_type *
+read_type(read_ctx *ctx)
+{
+   uint32_t idx = blob_read_uint32(ctx->blob);
+
+   if (idx != NEW_TYPE) {
+      assert(idx < ctx->next_type_idx);
+      return idx < ctx->next_type_idx ? ctx->types[idx] : NULL;
+   }
+
+   const struct glsl_type *type = decode_type(ctx);
+   read_add_type(ctx, type);
+   return type;
+}
+
+static void
+write_constant(write_ctx *ctx, const nir_constant *c)
+{
+   blob_write_bytes(ctx->blob, &c->value, sizeof(c->value));
+   blob_write_uint32(ctx->blob, c->num_elements);
+   for (unsigned i = 0; i < c->num_elements; i++)
+      write_constant(ctx, c->elements[i]);
+}
+
+static nir_constant *
+read_constant(read_ctx *ctx, nir_variable *nvar)
+{
+   nir_constant *c = ralloc(nvar, nir_constant);
+
+   blob_copy_bytes(ctx->blob, (uint8_t *) &c->value, sizeof(c->value));
+   c->num_elements = blob_read_uint32(ctx->blob);
+   c->elements = ralloc_array(nvar, nir_constant *, c->num_elements);
+   for (unsigned i = 0; i < c->num_elements; i++)
+      c->elements[i] = read_constant(ctx, nvar);
+
+   return c;
+}
+
+static void
+write_variable(write_ctx *ctx, const nir_variable *var)
+{
+   write_add_object(ctx, var);
+   write_type(ctx, var->type);
+   write_string(ctx, var->name);
+   blob_write_bytes(ctx->blob, &var->data, sizeof(var->data));
+   blob_write_uint32(ctx->blob, var->num_state_slots);
+   blob_write_bytes(ctx->blob, var->state_slots,
+                    var->num_state_slots * sizeof(nir_state_slot));
+   blob_write_uint32(ctx->blob, var->constant_initializer != NULL);
+   if (var->constant_initializer)
+      write_constant(ctx, var->constant_initializer);
+   write_type(ctx, var->interface_type);
+}
+
+/* NOTE: like nir_variable_clone, bypass nir_variable_create to avoid having
+ * to deal with locals and globals separately:
+ */
+static nir_variable *
+read_variable(read_ctx *ctx)
+{
+   nir_variable *var = rzalloc(ctx->nir, nir_variable);
+   read_add_object(ctx, var);
+
+   var->type = read_type(ctx);
+   var->name = ralloc_strdup(var, read_string(ctx));
+   blob_copy_bytes(ctx->blob, (uint8_t *) &var->data, sizeof(var->data));
+   var->num_state_slots = blob_read_uint32(ctx->blob);
+   var->state_slots = ralloc_array(var, nir_state_slot, var->num_state_slots);
+   blob_copy_bytes(ctx->blob, (uint8_t *) var->state_slots,
+                   var->num_state_slots * sizeof(nir_state_slot));
+   if (blob_read_uint32(ctx->blob))
+      var->constant_initializer = read_constant(ctx, var);
+   var->interface_type = read_type(ctx);
+
+   return var;
+}
+
+static void
+write_var_list(write_ctx *ctx, const struct exec_list *src)
+{
+   blob_write_uint32(ctx->blob, exec_list_length(src));
+   foreach_list_typed(nir_variable, var, node, src)
+      write_variable(ctx, var);
+}
+
+static void
+read_var_list(read_ctx *ctx, struct exec_list *dst)
+{
+   exec_list_make_empty(dst);
+   unsigned num_vars = blob_read_uint32(ctx->blob);
+   for (unsigned i = 0; i < num_vars; i++) {
+      nir_variable *var = read_variable(ctx);
+      exec_list_push_tail(dst, &var->node);
+   }
+}
+
+static void
+write_register(write_ctx *ctx, const nir_register *reg)
+{
+   write_add_object(ctx, reg);
+   blob_write_uint32(ctx->blob, reg->num_components);
+   blob_write_uint32(ctx->blob, reg->bit_size);
+   blob_write_uint32(ctx->blob, reg->num_array_elems);
+   blob_write_uint32(ctx->blob, reg->index);
+   write_string(ctx, reg->name);
+   blob_write_uint32(ctx->blob, reg->is_global << 1 | reg->is_packed);
+}
+
+static nir_register *
+read_register(read_ctx *ctx)
+{
+   nir_register *reg = rzalloc(ctx->nir, nir_register);
+   read_add_object(ctx, reg);
+
+   reg->num_components = blob_read_uint32(ctx->blob);
+   reg->bit_size = blob_read_uint32(ctx->blob);
+   reg->num_array_elems = blob_read_uint32(ctx->blob);
+   reg->index = blob_read_uint32(ctx->blob);
+   reg->name = ralloc_strdup(reg, read_string(ctx));
+
+   uint32_t flags = blob_read_uint32(ctx->blob);
+   reg->is_global = (flags >> 1) & 1;
+   reg->is_packed = flags & 1;
+
+   /* reconstructing uses/defs/if_uses handled by nir_instr_insert() */
+   list_inithead(&reg->uses);
+   list_inithead(&reg->defs);
+   list_inithead(&reg->if_uses);
+
+   return reg;
+}
+
+static void
+write_reg_list(write_ctx *ctx, const struct exec_list *src)
+{
+   blob_write_uint32(ctx->blob, exec_list_length(src));
+   foreach_list_typed(nir_register, reg, node, src)
+      write_register(ctx, reg);
+}
+
+static void
+read_reg_list(read_ctx *ctx, struct exec_list *dst)
+{
+   exec_list_make_empty(dst);
+   unsigned num_regs = blob_read_uint32(ctx->blob);
+   for (unsigned i = 0; i < num_regs; i++) {
+      nir_register *reg = read_register(ctx);
+      exec_list_push_tail(dst, &reg->node);
+   }
+}
+
+/* A source is a single word in the common (SSA) case: the object index
+ * shifted up by two, with is_ssa and "has indirect" in the low bits.
+ */
+static void
+write_src(write_ctx *ctx, const nir_src *src)
+{
+   if (src->is_ssa) {
+      blob_write_uint32(ctx->blob, write_lookup_object(ctx, src->ssa) << 2 | 1);
+   } else {
+      blob_write_uint32(ctx->blob, write_lookup_object(ctx, src->reg.reg) << 2 |
+                                   (src->reg.indirect != NULL) << 1);
+      blob_write_uint32(ctx->blob, src->reg.base_offset);
+      if (src->reg.indirect)
+         write_src(ctx, src->reg.indirect);
+   }
+}
+
+static void
+read_src(read_ctx *ctx, nir_src *src, void *mem_ctx)
+{
+   uint32_t val = blob_read_uint32(ctx->blob);
+
+   src->is_ssa = val & 1;
+   if (src->is_ssa) {
+      src->ssa = read_lookup_object(ctx, val >> 2);
+   } else {
+      src->reg.reg = read_lookup_object(ctx, val >> 2);
+      src->reg.base_offset = blob_read_uint32(ctx->blob);
+      if (val & 2) {
+         src->reg.indirect = ralloc(mem_ctx, nir_src);
+         read_src(ctx, src->reg.indirect, mem_ctx);
+      } else {
+         src->reg.indirect = NULL;
+      }
+   }
+}
+
+static void
+write_dest(write_ctx *ctx, const nir_dest *dst)
+{
+   if (dst->is_ssa) {
+      blob_write_uint32(ctx->blob, 1 |
+                                   (dst->ssa.name != NULL) << 1 |
+                                   dst->ssa.num_components << 2 |
+                                   dst->ssa.bit_size << 5);
+      if (dst->ssa.name)
+         blob_write_string(ctx->blob, dst->ssa.name);
+      write_add_object(ctx, &dst->ssa);
+   } else {
+      blob_write_uint32(ctx->blob, (dst->reg.indirect != NULL) << 1);
+      blob_write_uint32(ctx->blob, write_lookup_object(ctx, dst->reg.reg));
+      blob_write_uint32(ctx->blob, dst->reg.base_offset);
+      if (dst->reg.indirect)
+         write_src(ctx, dst->reg.indirect);
+   }
+}
+
+static void
+read_dest(read_ctx *ctx, nir_dest *dst, nir_instr *instr)
+{
+   uint32_t val = blob_read_uint32(ctx->blob);
+
+   if (val & 1) {
+      const char *name = (val & 2) ? blob_read_string(ctx->blob) : NULL;
+      nir_ssa_dest_init(instr, dst, (val >> 2) & 0x7, val >> 5, name);
+      read_add_object(ctx, &dst->ssa);
+   } else {
+      dst->is_ssa = false;
+      dst->reg.reg = read_lookup_object(ctx, blob_read_uint32(ctx->blob));
+      dst->reg.base_offset = blob_read_uint32(ctx->blob);
+      if (val & 2) {
+         dst->reg.indirect = ralloc(instr, nir_src);
+         read_src(ctx, dst->reg.indirect, instr);
+      } else {
+         dst->reg.indirect = NULL;
+      }
+   }
+}
+
+/* A deref chain is the variable index followed by one record per child,
+ * terminated by nir_deref_type_var.  A NULL chain is just index 0.
+ */
+static void
+write_deref_chain(write_ctx *ctx, const nir_deref_var *deref_var)
+{
+   if (!deref_var) {
+      blob_write_uint32(ctx->blob, 0);
+      return;
+   }
+
+   blob_write_uint32(ctx->blob, write_lookup_object(ctx, deref_var->var));
+
+   for (const nir_deref *deref = deref_var->deref.child; deref;
+        deref = deref->child) {
+      blob_write_uint32(ctx->blob, deref->deref_type);
+      write_type(ctx, deref->type);
+
+      switch (deref->deref_type) {
+      case nir_deref_type_array: {
+         const nir_deref_array *deref_array = nir_deref_as_array(deref);
+         blob_write_uint32(ctx->blob, deref_array->deref_array_type);
+         blob_write_uint32(ctx->blob, deref_array->base_offset);
+         if (deref_array->deref_array_type == nir_deref_array_type_indirect)
+            write_src(ctx, &deref_array->indirect);
+         break;
+      }
+      case nir_deref_type_struct:
+         blob_write_uint32(ctx->blob, nir_deref_as_struct(deref)->index);
+         break;
+      default:
+         unreachable("bad deref type");
+      }
+   }
+
+   blob_write_uint32(ctx->blob, nir_deref_type_var);
+}
+
+static nir_deref_var *
+read_deref_chain(read_ctx *ctx, nir_instr *instr)
+{
+   nir_variable *var = read_lookup_object(ctx, blob_read_uint32(ctx->blob));
+   if (!var)
+      return NULL;
+
+   nir_deref_var *deref_var = nir_deref_var_create(instr, var);
+   nir_deref *tail = &deref_var->deref;
+
+   while (true) {
+      nir_deref_type deref_type = blob_read_uint32(ctx->blob);
+      if (deref_type == nir_deref_type_var)
+         break;
+
+      const struct glsl_type *type = read_type(ctx);
+
+      switch (deref_type) {
+      case nir_deref_type_array: {
+         nir_deref_array *deref_array = nir_deref_array_create(tail);
+         deref_array->deref_array_type = blob_read_uint32(ctx->blob);
+         deref_array->base_offset = blob_read_uint32(ctx->blob);
+         if (deref_array->deref_array_type == nir_deref_array_type_indirect)
+            read_src(ctx, &deref_array->indirect, instr);
+         tail->child = &deref_array->deref;
+         break;
+      }
+      case nir_deref_type_struct: {
+         unsigned index = blob_read_uint32(ctx->blob);
+         nir_deref_struct *deref_struct = nir_deref_struct_create(tail, index);
+         tail->child = &deref_struct->deref;
+         break;
+      }
+      default:
+         unreachable("bad deref type");
+      }
+
+      tail->child->type = type;
+      tail = tail->child;
+   }
+
+   return deref_var;
+}
+
+static void
+write_alu(write_ctx *ctx, const nir_alu_instr *alu)
+{
+   blob_write_uint32(ctx->blob, alu->op);
+   blob_write_uint32(ctx->blob, alu->exact |
+                                alu->dest.saturate << 1 |
+                                alu->dest.write_mask << 2);
+
+   write_dest(ctx, &alu->dest.dest);
+
+   for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+      const nir_alu_src *src = &alu->src[i];
+
+      write_src(ctx, &src->src);
+      blob_write_uint32(ctx->blob, src->negate |
+                                   src->abs << 1 |
+                                   src->swizzle[0] << 2 |
+                                   src->swizzle[1] << 4 |
+                                   src->swizzle[2] << 6 |
+                                   src->swizzle[3] << 8);
+   }
+}
+
+static nir_alu_instr *
+read_alu(read_ctx *ctx)
+{
+   nir_op op = blob_read_uint32(ctx->blob);
+   nir_alu_instr *alu = nir_alu_instr_create(ctx->nir, op);
+
+   uint32_t flags = blob_read_uint32(ctx->blob);
+   alu->exact = flags & 1;
+   alu->dest.saturate = (flags >> 1) & 1;
+   alu->dest.write_mask = flags >> 2;
+
+   read_dest(ctx, &alu->dest.dest, &alu->instr);
+
+   for (unsigned i = 0; i < nir_op_infos[op].num_inputs; i++) {
+      nir_alu_src *src = &alu->src[i];
+
+      read_src(ctx, &src->src, &alu->instr);
+
+      uint32_t packed = blob_read_uint32(ctx->blob);
+      src->negate = packed & 1;
+      src->abs = (packed >> 1) & 1;
+      for (unsigned c = 0; c < 4; c++)
+         src->swizzle[c] = (packed >> (2 + 2 * c)) & 0x3;
+   }
+
+   return alu;
+}
+
+static void
+write_intrinsic(write_ctx *ctx, const nir_intrinsic_instr *intrin)
+{
+   const nir_intrinsic_info *info = &nir_intrinsic_infos[intrin->intrinsic];
+
+   blob_write_uint32(ctx->blob, intrin->intrinsic);
+   blob_write_uint32(ctx->blob, intrin->num_components);
+
+   for (unsigned i = 0; i < NIR_INTRINSIC_MAX_CONST_INDEX; i++)
+      blob_write_uint32(ctx->blob, intrin->const_index[i]);
+
+   if (info->has_dest)
+      write_dest(ctx, &intrin->dest);
+
+   for (unsigned i = 0; i < info->num_variables; i++)
+      write_deref_chain(ctx, intrin->variables[i]);
+
+   for (unsigned i = 0; i < info->num_srcs; i++)
+      write_src(ctx, &intrin->src[i]);
+}
+
+static nir_intrinsic_instr *
+read_intrinsic(read_ctx *ctx)
+{
+   nir_intrinsic_op op = blob_read_uint32(ctx->blob);
+   nir_intrinsic_instr *intrin = nir_intrinsic_instr_create(ctx->nir, op);
+   const nir_intrinsic_info *info = &nir_intrinsic_infos[op];
+
+   intrin->num_components = blob_read_uint32(ctx->blob);
+
+   for (unsigned i = 0; i < NIR_INTRINSIC_MAX_CONST_INDEX; i++)
+      intrin->const_index[i] = blob_read_uint32(ctx->blob);
+
+   if (info->has_dest)
+      read_dest(ctx, &intrin->dest, &intrin->instr);
+
+   for (unsigned i = 0; i < info->num_variables; i++)
+      intrin->variables[i] = read_deref_chain(ctx, &intrin->instr);
+
+   for (unsigned i = 0; i < info->num_srcs; i++)
+      read_src(ctx, &intrin->src[i], &intrin->instr);
+
+   return intrin;
+}
+
+static void
+write_load_const(write_ctx *ctx, const nir_load_const_instr *lc)
+{
+   blob_write_uint32(ctx->blob, lc->def.num_components |
+                                lc->def.bit_size << 3);
+   blob_write_bytes(ctx->blob, &lc->value, sizeof(lc->value));
+   write_add_object(ctx, &lc->def);
+}
+
+static nir_load_const_instr *
+read_load_const(read_ctx *ctx)
+{
+   uint32_t val = blob_read_uint32(ctx->blob);
+   nir_load_const_instr *lc =
+      nir_load_const_instr_create(ctx->nir, val & 0x7);
+
+   lc->def.bit_size = val >> 3;
+   blob_copy_bytes(ctx->blob, (uint8_t *) &lc->value, sizeof(lc->value));
+   read_add_object(ctx, &lc->def);
+
+   return lc;
+}
+
+static void
+write_ssa_undef(write_ctx *ctx, const nir_ssa_undef_instr *undef)
+{
+   blob_write_uint32(ctx->blob, undef->def.num_components |
+                                undef->def.bit_size << 3);
+   write_add_object(ctx, &undef->def);
+}
+
+static nir_ssa_undef_instr *
+read_ssa_undef(read_ctx *ctx)
+{
+   uint32_t val = blob_read_uint32(ctx->blob);
+   nir_ssa_undef_instr *undef =
+      nir_ssa_undef_instr_create(ctx->nir, val & 0x7);
+
+   undef->def.bit_size = val >> 3;
+   read_add_object(ctx, &undef->def);
+
+   return undef;
+}
+
+static void
+write_tex(write_ctx *ctx, const nir_tex_instr *tex)
+{
+   blob_write_uint32(ctx->blob, tex->num_srcs);
+   blob_write_uint32(ctx->blob, tex->sampler_dim);
+   blob_write_uint32(ctx->blob, tex->dest_type);
+   blob_write_uint32(ctx->blob, tex->op);
+   blob_write_uint32(ctx->blob, tex->coord_components |
+                                tex->is_array << 3 |
+                                tex->is_shadow << 4 |
+                                tex->is_new_style_shadow << 5 |
+                                tex->component << 6);
+   blob_write_uint32(ctx->blob, tex->texture_index);
+   blob_write_uint32(ctx->blob, tex->texture_array_size);
+   blob_write_uint32(ctx->blob, tex->sampler_index);
+
+   write_dest(ctx, &tex->dest);
+   for (unsigned i = 0; i < tex->num_srcs; i++) {
+      blob_write_uint32(ctx->blob, tex->src[i].src_type);
+      write_src(ctx, &tex->src[i].src);
+   }
+
+   write_deref_chain(ctx, tex->texture);
+   write_deref_chain(ctx, tex->sampler);
+}
+
+static nir_tex_instr *
+read_tex(read_ctx *ctx)
+{
+   unsigned num_srcs = blob_read_uint32(ctx->blob);
+   nir_tex_instr *tex = nir_tex_instr_create(ctx->nir, num_srcs);
+
+   tex->sampler_dim = blob_read_uint32(ctx->blob);
+   tex->dest_type = blob_read_uint32(ctx->blob);
+   tex->op = blob_read_uint32(ctx->blob);
+
+   uint32_t packed = blob_read_uint32(ctx->blob);
+   tex->coord_components = packed & 0x7;
+   tex->is_array = (packed >> 3) & 1;
+   tex->is_shadow = (packed >> 4) & 1;
+   tex->is_new_style_shadow = (packed >> 5) & 1;
+   tex->component = (packed >> 6) & 0x3;
+
+   tex->texture_index = blob_read_uint32(ctx->blob);
+   tex->texture_array_size = blob_read_uint32(ctx->blob);
+   tex->sampler_index = blob_read_uint32(ctx->blob);
+
+   read_dest(ctx, &tex->dest, &tex->instr);
+   for (unsigned i = 0; i < num_srcs; i++) {
+      tex->src[i].src_type = blob_read_uint32(ctx->blob);
+      read_src(ctx, &tex->src[i].src, &tex->instr);
+   }
+
+   tex->texture = read_deref_chain(ctx, &tex->instr);
+   tex->sampler = read_deref_chain(ctx, &tex->instr);
+
+   return tex;
+}
+
+static void
+write_phi(write_ctx *ctx, const nir_phi_instr *phi)
+{
+   /* The sources go at the end of the function_impl; see write_phi_srcs() */
+   write_dest(ctx, &phi->dest);
+
+   if (ctx->num_phis == ctx->phis_size) {
+      ctx->phis_size = MAX2(ctx->phis_size * 2, 16);
+      ctx->phis = reralloc(ctx->remap_table, ctx->phis,
+                           const nir_phi_instr *, ctx->phis_size);
+   }
+   ctx->phis[ctx->num_phis++] = phi;
+}
+
+static nir_phi_instr *
+read_phi(read_ctx *ctx, nir_block *blk)
+{
+   nir_phi_instr *phi = nir_phi_instr_create(ctx->nir);
+
+   read_dest(ctx, &phi->dest, &phi->instr);
+
+   /* As in nir_clone, insert the phi before it has any sources so that
+    * nir_instr_insert() doesn't try to set up uses for them.
+    */
+   nir_instr_insert_after_block(blk, &phi->instr);
+
+   if (ctx->num_phis == ctx->phis_size) {
+      ctx->phis_size = MAX2(ctx->phis_size * 2, 16);
+      ctx->phis = reralloc(ctx, ctx->phis, nir_phi_instr *, ctx->phis_size);
+   }
+   ctx->phis[ctx->num_phis++] = phi;
+
+   return phi;
+}
+
+static void
+write_phi_srcs(write_ctx *ctx)
+{
+   for (unsigned i = 0; i < ctx->num_phis; i++) {
+      const nir_phi_instr *phi = ctx->phis[i];
+
+      blob_write_uint32(ctx->blob, exec_list_length(&phi->srcs));
+      nir_foreach_phi_src(phi, src) {
+         assert(src->src.is_ssa);
+         blob_write_uint32(ctx->blob, write_lookup_object(ctx, src->pred));
+         blob_write_uint32(ctx->blob, write_lookup_object(ctx, src->src.ssa));
+      }
+   }
+   ctx->num_phis = 0;
+}
+
+static void
+read_phi_srcs(read_ctx *ctx)
+{
+   for (unsigned i = 0; i < ctx->num_phis; i++) {
+      nir_phi_instr *phi = ctx->phis[i];
+      unsigned num_srcs = blob_read_uint32(ctx->blob);
+
+      for (unsigned j = 0; j < num_srcs; j++) {
+         nir_phi_src *src = ralloc(phi, nir_phi_src);
+
+         src->pred = read_lookup_object(ctx, blob_read_uint32(ctx->blob));
+         src->src = NIR_SRC_INIT;
+         src->src.is_ssa = true;
+         src->src.ssa = read_lookup_object(ctx, blob_read_uint32(ctx->blob));
+         src->src.parent_instr = &phi->instr;
+
+         /* The phi is already in the IR, so add the use by hand */
+         list_addtail(&src->src.use_link, &src->src.ssa->uses);
+
+         exec_list_push_tail(&phi->srcs, &src->node);
+      }
+   }
+   ctx->num_phis = 0;
+}
+
+static void
+write_jump(write_ctx *ctx, const nir_jump_instr *jmp)
+{
+   blob_write_uint32(ctx->blob, jmp->type);
+}
+
+static nir_jump_instr *
+read_jump(read_ctx *ctx)
+{
+   nir_jump_type type = blob_read_uint32(ctx->blob);
+   return nir_jump_instr_create(ctx->nir, type);
+}
+
+static void
+write_call(write_ctx *ctx, const nir_call_instr *call)
+{
+   blob_write_uint32(ctx->blob, write_lookup_object(ctx, call->callee));
+
+   for (unsigned i = 0; i < call->num_params; i++)
+      write_deref_chain(ctx, call->params[i]);
+
+   write_deref_chain(ctx, call->return_deref);
+}
+
+static nir_call_instr *
+read_call(read_ctx *ctx)
+{
+   nir_function *callee = read_lookup_object(ctx, blob_read_uint32(ctx->blob));
+   nir_call_instr *call = nir_call_instr_create(ctx->nir, callee);
+
+   for (unsigned i = 0; i < call->num_params; i++)
+      call->params[i] = read_deref_chain(ctx, &call->instr);
+
+   call->return_deref = read_deref_chain(ctx, &call->instr);
+
+   return call;
+}
+
+static void
+write_instr(write_ctx *ctx, const nir_instr *instr)
+{
+   blob_write_uint32(ctx->blob, instr->type);
+
+   switch (instr->type) {
+   case nir_instr_type_alu:
+      write_alu(ctx, nir_instr_as_alu(instr));
+      break;
+   case nir_instr_type_intrinsic:
+      write_intrinsic(ctx, nir_instr_as_intrinsic(instr));
+      break;
+   case nir_instr_type_load_const:
+      write_load_const(ctx, nir_instr_as_load_const(instr));
+      break;
+   case nir_instr_type_ssa_undef:
+      write_ssa_undef(ctx, nir_instr_as_ssa_undef(instr));
+      break;
+   case nir_instr_type_tex:
+      write_tex(ctx, nir_instr_as_tex(instr));
+      break;
+   case nir_instr_type_phi:
+      write_phi(ctx, nir_instr_as_phi(instr));
+      break;
+   case nir_instr_type_jump:
+      write_jump(ctx, nir_instr_as_jump(instr));
+      break;
+   case nir_instr_type_call:
+      write_call(ctx, nir_instr_as_call(instr));
+      break;
+   case nir_instr_type_parallel_copy:
+      unreachable("Cannot serialize parallel copies");
+   default:
+      unreachable("bad instr type");
+   }
+}
+
+static void
+read_instr(read_ctx *ctx, nir_block *blk)
+{
+   nir_instr_type type = blob_read_uint32(ctx->blob);
+   nir_instr *instr;
+
+   switch (type) {
+   case nir_instr_type_alu:
+      instr = &read_alu(ctx)->instr;
+      break;
+   case nir_instr_type_intrinsic:
+      instr = &read_intrinsic(ctx)->instr;
+      break;
+   case nir_instr_type_load_const:
+      instr = &read_load_const(ctx)->instr;
+      break;
+   case nir_instr_type_ssa_undef:
+      instr = &read_ssa_undef(ctx)->instr;
+      break;
+   case nir_instr_type_tex:
+      instr = &read_tex(ctx)->instr;
+      break;
+   case nir_instr_type_phi:
+      /* Phis insert themselves; their sources are set up by read_phi_srcs */
+      read_phi(ctx, blk);
+      return;
+   case nir_instr_type_jump:
+      instr = &read_jump(ctx)->instr;
+      break;
+   case nir_instr_type_call:
+      instr = &read_call(ctx)->instr;
+      break;
+   case nir_instr_type_parallel_copy:
+      unreachable("Cannot deserialize parallel copies");
+   default:
+      unreachable("bad instr type");
+   }
+
+   nir_instr_insert_after_block(blk, instr);
+}
+
+static void
+write_block(write_ctx *ctx, const nir_block *block)
+{
+   write_add_object(ctx, block);
+   blob_write_uint32(ctx->blob, exec_list_length(&block->instr_list));
+   nir_foreach_instr(block, instr)
+      write_instr(ctx, instr);
+}
+
+static void
+read_block(read_ctx *ctx, struct exec_list *cf_list)
+{
+   /* Don't actually create a new block.  Just use the one from the tail of
+    * the list.  NIR guarantees that the tail of the list is a block and that
+    * no two blocks are side-by-side in the IR;  It should be empty.
+    */
+   nir_block *blk =
+      exec_node_data(nir_block, exec_list_get_tail(cf_list), cf_node.node);
+   assert(blk->cf_node.type == nir_cf_node_block);
+   assert(exec_list_is_empty(&blk->instr_list));
+
+   read_add_object(ctx, blk);
+
+   unsigned num_instrs = blob_read_uint32(ctx->blob);
+   for (unsigned i = 0; i < num_instrs; i++)
+      read_instr(ctx, blk);
+}
+
+static void write_cf_list(write_ctx *ctx, const struct exec_list *cf_list);
+static void read_cf_list(read_ctx *ctx, struct exec_list *cf_list);
+
+static void
+write_if(write_ctx *ctx, const nir_if *nif)
+{
+   write_src(ctx, &nif->condition);
+   write_cf_list(ctx, &nif->then_list);
+   write_cf_list(ctx, &nif->else_list);
+}
+
+static void
+read_if(read_ctx *ctx, struct exec_list *cf_list)
+{
+   nir_if *nif = nir_if_create(ctx->nir);
+
+   read_src(ctx, &nif->condition, nif);
+
+   nir_cf_node_insert_end(cf_list, &nif->cf_node);
+
+   read_cf_list(ctx, &nif->then_list);
+   read_cf_list(ctx, &nif->else_list);
+}
+
+static void
+write_loop(write_ctx *ctx, const nir_loop *loop)
+{
+   write_cf_list(ctx, &loop->body);
+}
+
+static void
+read_loop(read_ctx *ctx, struct exec_list *cf_list)
+{
+   nir_loop *loop = nir_loop_create(ctx->nir);
+
+   nir_cf_node_insert_end(cf_list, &loop->cf_node);
+
+   read_cf_list(ctx, &loop->body);
+}
+
+static void
+write_cf_node(write_ctx *ctx, const nir_cf_node *cf)
+{
+   blob_write_uint32(ctx->blob, cf->type);
+
+   switch (cf->type) {
+   case nir_cf_node_block:
+      write_block(ctx, nir_cf_node_as_block(cf));
+      break;
+   case nir_cf_node_if:
+      write_if(ctx, nir_cf_node_as_if(cf));
+      break;
+   case nir_cf_node_loop:
+      write_loop(ctx, nir_cf_node_as_loop(cf));
+      break;
+   default:
+      unreachable("bad cf type");
+   }
+}
+
+static void
+read_cf_node(read_ctx *ctx, struct exec_list *list)
+{
+   nir_cf_node_type type = blob_read_uint32(ctx->blob);
+
+   switch (type) {
+   case nir_cf_node_block:
+      read_block(ctx, list);
+      break;
+   case nir_cf_node_if:
+      read_if(ctx, list);
+      break;
+   case nir_cf_node_loop:
+      read_loop(ctx, list);
+      break;
+   default:
+      unreachable("bad cf type");
+   }
+}
+
+static void
+write_cf_list(write_ctx *ctx, const struct exec_list *cf_list)
+{
+   blob_write_uint32(ctx->blob, exec_list_length(cf_list));
+   foreach_list_typed(nir_cf_node, cf, node, cf_list)
+      write_cf_node(ctx, cf);
+}
+
+static void
+read_cf_list(read_ctx *ctx, struct exec_list *cf_list)
+{
+   uint32_t num_cf_nodes = blob_read_uint32(ctx->blob);
+   for (unsigned i = 0; i < num_cf_nodes; i++)
+      read_cf_node(ctx, cf_list);
+}
+
+static void
+write_function_impl(write_ctx *ctx, const nir_function_impl *fi)
+{
+   write_var_list(ctx, &fi->locals);
+   write_reg_list(ctx, &fi->registers);
+   blob_write_uint32(ctx->blob, fi->reg_alloc);
+
+   blob_write_uint32(ctx->blob, fi->num_params);
+   for (unsigned i = 0; i < fi->num_params; i++)
+      write_variable(ctx, fi->params[i]);
+
+   blob_write_uint32(ctx->blob, fi->return_var != NULL);
+   if (fi->return_var)
+      write_variable(ctx, fi->return_var);
+
+   write_cf_list(ctx, &fi->body);
+   write_phi_srcs(ctx);
+}
+
+static nir_function_impl *
+read_function_impl(read_ctx *ctx, nir_function *fxn)
+{
+   nir_function_impl *fi = nir_function_impl_create_bare(ctx->nir);
+   fi->function = fxn;
+
+   read_var_list(ctx, &fi->locals);
+   read_reg_list(ctx, &fi->registers);
+   fi->reg_alloc = blob_read_uint32(ctx->blob);
+
+   fi->num_params = blob_read_uint32(ctx->blob);
+   fi->params = ralloc_array(ctx->nir, nir_variable *, fi->num_params);
+   for (unsigned i = 0; i < fi->num_params; i++)
+      fi->params[i] = read_variable(ctx);
+
+   if (blob_read_uint32(ctx->blob))
+      fi->return_var = read_variable(ctx);
+
+   read_cf_list(ctx, &fi->body);
+   read_phi_srcs(ctx);
+
+   fi->valid_metadata = 0;
+
+   return fi;
+}
+
+static void
+write_function(write_ctx *ctx, const nir_function *fxn)
+{
+   write_add_object(ctx, fxn);
+
+   write_string(ctx, fxn->name);
+
+   blob_write_uint32(ctx->blob, fxn->num_params);
+   for (unsigned i = 0; i < fxn->num_params; i++) {
+      blob_write_uint32(ctx->blob, fxn->params[i].param_type);
+      write_type(ctx, fxn->params[i].type);
+   }
+
+   write_type(ctx, fxn->return_type);
+
+   /* At first glance, it looks like we should write the function_impl here.
+    * However, call instructions need to be able to reference at least the
+    * function and those will get processed as we write the function_impls.
+    * We stop here and write function_impls as a second pass.
+    */
+}
+
+static void
+read_function(read_ctx *ctx)
+{
+   nir_function *fxn = nir_function_create(ctx->nir, read_string(ctx));
+
+   read_add_object(ctx, fxn);
+
+   fxn->num_params = blob_read_uint32(ctx->blob);
+   fxn->params = ralloc_array(fxn, nir_parameter, fxn->num_params);
+   for (unsigned i = 0; i < fxn->num_params; i++) {
+      fxn->params[i].param_type = blob_read_uint32(ctx->blob);
+      fxn->params[i].type = read_type(ctx);
+   }
+
+   fxn->return_type = read_type(ctx);
+}
+
+void
+nir_serialize(struct blob *blob, const nir_shader *nir)
+{
+   write_ctx ctx;
+   ctx.blob = blob;
+   ctx.remap_table = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                             _mesa_key_pointer_equal);
+   ctx.next_idx = 1;
+   ctx.type_table = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                            _mesa_key_pointer_equal);
+   ctx.next_type_idx = 1;
+   ctx.phis = NULL;
+   ctx.num_phis = ctx.phis_size = 0;
+
+   blob_write_uint32(blob, nir->stage);
+
+   /* The name and label pointers are written as strings below */
+   nir_shader_info info = nir->info;
+   info.name = NULL;
+   info.label = NULL;
+   blob_write_bytes(blob, &info, sizeof(info));
+   write_string(&ctx, nir->info.name);
+   write_string(&ctx, nir->info.label);
+
+   write_var_list(&ctx, &nir->uniforms);
+   write_var_list(&ctx, &nir->inputs);
+   write_var_list(&ctx, &nir->outputs);
+   write_var_list(&ctx, &nir->shared);
+   write_var_list(&ctx, &nir->globals);
+   write_var_list(&ctx, &nir->system_values);
+
+   write_reg_list(&ctx, &nir->registers);
+   blob_write_uint32(blob, nir->reg_alloc);
+
+   blob_write_uint32(blob, exec_list_length(&nir->functions));
+   nir_foreach_function(nir, fxn)
+      write_function(&ctx, fxn);
+
+   nir_foreach_function(nir, fxn) {
+      blob_write_uint32(blob, fxn->impl != NULL);
+      if (fxn->impl)
+         write_function_impl(&ctx, fxn->impl);
+   }
+
+   blob_write_uint32(blob, nir->num_inputs);
+   blob_write_uint32(blob, nir->num_uniforms);
+   blob_write_uint32(blob, nir->num_outputs);
+   blob_write_uint32(blob, nir->num_shared);
+
+   _mesa_hash_table_destroy(ctx.type_table, NULL);
+   _mesa_hash_table_destroy(ctx.remap_table, NULL);
+}
+
+nir_shader *
+nir_deserialize(void *mem_ctx,
+                const nir_shader_compiler_options *options,
+                struct blob_reader *blob)
+{
+   read_ctx *ctx = ralloc(NULL, read_ctx);
+   ctx->blob = blob;
+   ctx->idx_table_size = 64;
+   ctx->idx_table = ralloc_array(ctx, void *, ctx->idx_table_size);
+   ctx->idx_table[0] = NULL;
+   ctx->next_idx = 1;
+   ctx->types_size = 16;
+   ctx->types = ralloc_array(ctx, const struct glsl_type *, ctx->types_size);
+   ctx->types[0] = NULL;
+   ctx->next_type_idx = 1;
+   ctx->phis = NULL;
+   ctx->num_phis = ctx->phis_size = 0;
+
+   gl_shader_stage stage = blob_read_uint32(blob);
+   nir_shader *nir = nir_shader_create(mem_ctx, stage, options);
+   ctx->nir = nir;
+
+   blob_copy_bytes(blob, (uint8_t *) &nir->info, sizeof(nir->info));
+   nir->info.name = ralloc_strdup(nir, read_string(ctx));
+   nir->info.label = ralloc_strdup(nir, read_string(ctx));
+
+   read_var_list(ctx, &nir->uniforms);
+   read_var_list(ctx, &nir->inputs);
+   read_var_list(ctx, &nir->outputs);
+   read_var_list(ctx, &nir->shared);
+   read_var_list(ctx, &nir->globals);
+   read_var_list(ctx, &nir->system_values);
+
+   read_reg_list(ctx, &nir->registers);
+   nir->reg_alloc = blob_read_uint32(blob);
+
+   unsigned num_functions = blob_read_uint32(blob);
+   for (unsigned i = 0; i < num_functions; i++)
+      read_function(ctx);
+
+   nir_foreach_function(nir, fxn) {
+      if (blob_read_uint32(blob))
+         fxn->impl = read_function_impl(ctx, fxn);
+   }
+
+   nir->num_inputs = blob_read_uint32(blob);
+   nir->num_uniforms = blob_read_uint32(blob);
+   nir->num_outputs = blob_read_uint32(blob);
+   nir->num_shared = blob_read_uint32(blob);
+
+   ralloc_free(ctx);
+
+   if (blob->overrun) {
+      ralloc_free(nir);
+      return NULL;
+   }
+
+   return nir;
+}
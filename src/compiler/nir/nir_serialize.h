@@ -0,0 +1,55 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "nir.h"
+#include "compiler/glsl/blob.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** NIR binary serialization
+ *
+ * nir_serialize() appends a self-contained encoding of a shader to a blob
+ * and nir_deserialize() rebuilds an equivalent shader from it.  Pointers
+ * between IR objects (variables, registers, SSA values, blocks, functions)
+ * are written as dense indices in definition order and every distinct
+ * glsl_type is encoded once and referenced by index afterwards, so the
+ * output depends only on the IR and not on where it lives in memory.
+ *
+ * The encoding is tied to the NIR data structures of the build that wrote
+ * it; callers that persist it (e.g. to a disk cache) must key it on the
+ * build as well.  Parallel copy instructions are not supported.
+ */
+
+void nir_serialize(struct blob *blob, const nir_shader *shader);
+
+nir_shader *nir_deserialize(void *mem_ctx,
+                            const nir_shader_compiler_options *options,
+                            struct blob_reader *blob);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
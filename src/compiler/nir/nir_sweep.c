@@ -151,6 +151,12 @@ nir_sweep(nir_shader *nir)
    /* First, move ownership of all the memory to a temporary context; assume dead. */
    ralloc_adopt(rubbish, nir);
 
+   /* Anything on the free lists is dead by definition. */
+   for (unsigned i = 0; i < ARRAY_SIZE(nir->free_alu_instrs); i++)
+      exec_list_make_empty(&nir->free_alu_instrs[i]);
+   exec_list_make_empty(&nir->free_load_const_instrs);
+   exec_list_make_empty(&nir->free_ssa_undef_instrs);
+
    ralloc_steal(nir, (char *)nir->info.name);
    if (nir->info.label)
       ralloc_steal(nir, (char *)nir->info.label);
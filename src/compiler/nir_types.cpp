@@ -130,6 +130,26 @@ glsl_get_struct_elem_name(const struct glsl_type *type, unsigned index)
    return type->fields.structure[index].name;
 }
 
+const struct glsl_struct_field *
+glsl_get_struct_field_data(const struct glsl_type *type, unsigned index)
+{
+   assert(type->is_record() || type->is_interface());
+   return &type->fields.structure[index];
+}
+
+const char *
+glsl_get_type_name(const struct glsl_type *type)
+{
+   return type->name;
+}
+
+enum glsl_interface_packing
+glsl_get_interface_packing(const struct glsl_type *type)
+{
+   assert(type->is_interface());
+   return (enum glsl_interface_packing)type->interface_packing;
+}
+
 glsl_sampler_dim
 glsl_get_sampler_dim(const struct glsl_type *type)
 {
@@ -300,6 +320,15 @@ glsl_struct_type(const glsl_struct_field *fields,
    return glsl_type::get_record_instance(fields, num_fields, name);
 }
 
+const glsl_type *
+glsl_interface_type(const glsl_struct_field *fields,
+                    unsigned num_fields,
+                    enum glsl_interface_packing packing,
+                    const char *name)
+{
+   return glsl_type::get_interface_instance(fields, num_fields, packing, name);
+}
+
 const struct glsl_type *
 glsl_sampler_type(enum glsl_sampler_dim dim, bool is_shadow, bool is_array,
                   enum glsl_base_type base_type)
@@ -320,6 +349,18 @@ glsl_image_type(enum glsl_sampler_dim dim, bool is_array,
    return glsl_type::get_image_instance(dim, is_array, base_type);
 }
 
+const struct glsl_type *
+glsl_atomic_uint_type(void)
+{
+   return glsl_type::atomic_uint_type;
+}
+
+const struct glsl_type *
+glsl_subroutine_type(const char *name)
+{
+   return glsl_type::get_subroutine_instance(name);
+}
+
 const glsl_type *
 glsl_function_type(const glsl_type *return_type,
                    const glsl_function_param *params, unsigned num_params)
@@ -71,6 +71,14 @@ unsigned glsl_get_aoa_size(const struct glsl_type *type);
 const char *glsl_get_struct_elem_name(const struct glsl_type *type,
                                       unsigned index);
 
+const struct glsl_struct_field *
+glsl_get_struct_field_data(const struct glsl_type *type, unsigned index);
+
+const char *glsl_get_type_name(const struct glsl_type *type);
+
+enum glsl_interface_packing
+glsl_get_interface_packing(const struct glsl_type *type);
+
 enum glsl_sampler_dim glsl_get_sampler_dim(const struct glsl_type *type);
 enum glsl_base_type glsl_get_sampler_result_type(const struct glsl_type *type);
 
@@ -128,6 +136,11 @@ const struct glsl_type *glsl_array_type(const struct glsl_type *base,
                                         unsigned elements);
 const struct glsl_type *glsl_struct_type(const struct glsl_struct_field *fields,
                                          unsigned num_fields, const char *name);
+const struct glsl_type *
+glsl_interface_type(const struct glsl_struct_field *fields,
+                    unsigned num_fields,
+                    enum glsl_interface_packing packing,
+                    const char *name);
 const struct glsl_type *glsl_sampler_type(enum glsl_sampler_dim dim,
                                           bool is_shadow, bool is_array,
                                           enum glsl_base_type base_type);
@@ -135,6 +148,8 @@ const struct glsl_type *glsl_bare_sampler_type();
 const struct glsl_type *glsl_image_type(enum glsl_sampler_dim dim,
                                         bool is_array,
                                         enum glsl_base_type base_type);
+const struct glsl_type *glsl_atomic_uint_type(void);
+const struct glsl_type *glsl_subroutine_type(const char *name);
 const struct glsl_type * glsl_function_type(const struct glsl_type *return_type,
                                             const struct glsl_function_param *params,
                                             unsigned num_params);
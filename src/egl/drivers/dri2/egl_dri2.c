@@ -810,6 +810,16 @@ dri2_terminate(_EGLDriver *drv, _EGLDisplay *disp)
    _eglReleaseDisplayResources(drv, disp);
    _eglCleanupDisplay(disp);
 
+   for (i = 0; i < DRI2_DMA_BUF_CACHE_SIZE; i++) {
+      if (dri2_dpy->dma_buf_cache[i].dri_image)
+         dri2_dpy->image->destroyImage(dri2_dpy->dma_buf_cache[i].dri_image);
+   }
+
+#ifdef HAVE_SURFACELESS_PLATFORM
+   if (disp->Platform == _EGL_PLATFORM_SURFACELESS)
+      dri2_surfaceless_release_buffer_pool(disp);
+#endif
+
    if (dri2_dpy->own_dri_screen)
       dri2_dpy->core->destroyScreen(dri2_dpy->dri_screen);
    if (dri2_dpy->fd >= 0)
@@ -1953,6 +1963,65 @@ dri2_check_dma_buf_format(const _EGLImageAttribs *attrs)
  *
  * Therefore we must never close or otherwise modify the file descriptors.
  */
+/**
+ * Fill in the lookup key for a dma-buf import.  The fds themselves change
+ * between imports of the same buffer, so planes are identified by the
+ * device and inode of the dma-buf they refer to instead.
+ */
+static EGLBoolean
+dri2_dma_buf_cache_key(struct dri2_dma_buf_cache_entry *key,
+                       const _EGLImageAttribs *attrs, unsigned num_fds,
+                       const int *fds, const int *pitches,
+                       const int *offsets)
+{
+   unsigned i;
+
+   memset(key, 0, sizeof(*key));
+
+   for (i = 0; i < num_fds; i++) {
+      struct stat st;
+
+      if (fstat(fds[i], &st) != 0)
+         return EGL_FALSE;
+
+      key->dev[i] = st.st_dev;
+      key->ino[i] = st.st_ino;
+      key->pitches[i] = pitches[i];
+      key->offsets[i] = offsets[i];
+   }
+
+   key->num_fds = num_fds;
+   key->width = attrs->Width;
+   key->height = attrs->Height;
+   key->fourcc = attrs->DMABufFourCC.Value;
+   key->hints[0] = attrs->DMABufYuvColorSpaceHint.Value;
+   key->hints[1] = attrs->DMABufSampleRangeHint.Value;
+   key->hints[2] = attrs->DMABufChromaHorizontalSiting.Value;
+   key->hints[3] = attrs->DMABufChromaVerticalSiting.Value;
+
+   return EGL_TRUE;
+}
+
+static EGLBoolean
+dri2_dma_buf_cache_key_equal(const struct dri2_dma_buf_cache_entry *a,
+                             const struct dri2_dma_buf_cache_entry *b)
+{
+   unsigned i;
+
+   if (a->num_fds != b->num_fds || a->width != b->width ||
+       a->height != b->height || a->fourcc != b->fourcc ||
+       memcmp(a->hints, b->hints, sizeof(a->hints)) != 0)
+      return EGL_FALSE;
+
+   for (i = 0; i < a->num_fds; i++) {
+      if (a->dev[i] != b->dev[i] || a->ino[i] != b->ino[i] ||
+          a->pitches[i] != b->pitches[i] || a->offsets[i] != b->offsets[i])
+         return EGL_FALSE;
+   }
+
+   return EGL_TRUE;
+}
+
 static _EGLImage *
 dri2_create_image_dma_buf(_EGLDisplay *disp, _EGLContext *ctx,
 			  EGLClientBuffer buffer, const EGLint *attr_list)
@@ -1968,6 +2037,8 @@ dri2_create_image_dma_buf(_EGLDisplay *disp, _EGLContext *ctx,
    int pitches[3];
    int offsets[3];
    unsigned error;
+   struct dri2_dma_buf_cache_entry key, *entry = NULL;
+   EGLBoolean have_key;
 
    /**
     * The spec says:
@@ -1999,6 +2070,38 @@ dri2_create_image_dma_buf(_EGLDisplay *disp, _EGLContext *ctx,
       offsets[i] = attrs.DMABufPlaneOffsets[i].Value;
    }
 
+   /* Video pipelines import the same few decoder buffers over and over.
+    * Keep the images of recent imports around and hand out duplicates of
+    * them, which share the driver resource without another import.  The
+    * cached image holds a reference to the dma-buf, so its inode can't be
+    * reused while the entry exists.
+    */
+   have_key = dri2_dpy->image->dupImage &&
+              dri2_dma_buf_cache_key(&key, &attrs, num_fds, fds,
+                                     pitches, offsets);
+   if (have_key) {
+      struct dri2_dma_buf_cache_entry *lru = &dri2_dpy->dma_buf_cache[0];
+
+      for (i = 0; i < DRI2_DMA_BUF_CACHE_SIZE; i++) {
+         entry = &dri2_dpy->dma_buf_cache[i];
+
+         if (entry->dri_image &&
+             dri2_dma_buf_cache_key_equal(entry, &key)) {
+            dri_image = dri2_dpy->image->dupImage(entry->dri_image, NULL);
+            if (!dri_image)
+               break;
+
+            entry->last_use = ++dri2_dpy->dma_buf_cache_serial;
+            return dri2_create_image_from_dri(disp, dri_image);
+         }
+
+         if (!entry->dri_image || (lru->dri_image &&
+                                   entry->last_use < lru->last_use))
+            lru = entry;
+      }
+      entry = lru;
+   }
+
    dri_image =
       dri2_dpy->image->createImageFromDmaBufs(dri2_dpy->dri_screen,
          attrs.Width, attrs.Height, attrs.DMABufFourCC.Value,
@@ -2014,6 +2117,18 @@ dri2_create_image_dma_buf(_EGLDisplay *disp, _EGLContext *ctx,
    if (!dri_image)
       return EGL_NO_IMAGE_KHR;
 
+   if (have_key) {
+      __DRIimage *cached = dri2_dpy->image->dupImage(dri_image, NULL);
+
+      if (cached) {
+         if (entry->dri_image)
+            dri2_dpy->image->destroyImage(entry->dri_image);
+         *entry = key;
+         entry->dri_image = cached;
+         entry->last_use = ++dri2_dpy->dma_buf_cache_serial;
+      }
+   }
+
    res = dri2_create_image_from_dri(disp, dri_image);
 
    return res;
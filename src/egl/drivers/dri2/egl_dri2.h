@@ -153,6 +153,39 @@ struct dri2_egl_display_vtbl {
    __DRIdrawable *(*get_dri_drawable)(_EGLSurface *surf);
 };
 
+/* Number of dma-buf imports remembered per display, see
+ * dri2_create_image_dma_buf().
+ */
+#define DRI2_DMA_BUF_CACHE_SIZE 16
+
+struct dri2_dma_buf_cache_entry
+{
+   __DRIimage *dri_image;       /* NULL for an unused slot */
+   uint64_t    last_use;
+
+   unsigned    num_fds;
+   uint64_t    dev[3];
+   uint64_t    ino[3];
+   int         pitches[3];
+   int         offsets[3];
+   EGLint      width, height;
+   EGLint      fourcc;
+   EGLint      hints[4];
+};
+
+#ifdef HAVE_SURFACELESS_PLATFORM
+/* Number of idle pbuffer buffers kept per surfaceless display */
+#define DRI2_BUFFER_POOL_SIZE 32
+
+struct dri2_pooled_buffer
+{
+   __DRIbuffer *buffer;
+   unsigned     attachment;
+   unsigned     format;
+   int          width, height;  /* allocated size, rounded up */
+};
+#endif
+
 struct dri2_egl_display
 {
    const struct dri2_egl_display_vtbl *vtbl;
@@ -216,6 +249,19 @@ struct dri2_egl_display
 #endif
 
    int			     is_different_gpu;
+
+   struct dri2_dma_buf_cache_entry dma_buf_cache[DRI2_DMA_BUF_CACHE_SIZE];
+   uint64_t                  dma_buf_cache_serial;
+
+#ifdef HAVE_SURFACELESS_PLATFORM
+   /* Buffers of destroyed pbuffers, shared by all surfaces and contexts of
+    * the display.  Accessed from getBuffersWithFormat(), which isn't
+    * called under the display lock, hence the separate mutex.
+    */
+   mtx_t                     buffer_pool_mutex;
+   struct dri2_pooled_buffer buffer_pool[DRI2_BUFFER_POOL_SIZE];
+   unsigned                  buffer_pool_count;
+#endif
 };
 
 struct dri2_egl_context
@@ -289,6 +335,10 @@ struct dri2_egl_surface
    /* EGL-owned buffers */
    __DRIbuffer           *local_buffers[__DRI_BUFFER_COUNT];
 #endif
+
+#ifdef HAVE_SURFACELESS_PLATFORM
+   struct dri2_pooled_buffer pooled_buffers[__DRI_BUFFER_COUNT];
+#endif
 };
 
 
@@ -372,6 +422,9 @@ dri2_initialize_android(_EGLDriver *drv, _EGLDisplay *disp);
 EGLBoolean
 dri2_initialize_surfaceless(_EGLDriver *drv, _EGLDisplay *disp);
 
+void
+dri2_surfaceless_release_buffer_pool(_EGLDisplay *disp);
+
 void
 dri2_flush_drawable_for_swapbuffers(_EGLDisplay *disp, _EGLSurface *draw);
 
@@ -37,10 +37,185 @@
 #include "egl_dri2_fallbacks.h"
 #include "loader.h"
 
+/* Pooled buffers are allocated with their size rounded up to a multiple of
+ * this, so that pbuffers of similar size can reuse each other's buffers.
+ */
+#define SURFACELESS_BUFFER_ALIGN 128
+
+static int
+surfaceless_size_class(int size)
+{
+   return (size + SURFACELESS_BUFFER_ALIGN - 1) &
+          ~(SURFACELESS_BUFFER_ALIGN - 1);
+}
+
+/**
+ * Get a buffer for the given attachment of a pbuffer, reusing one from the
+ * display's pool if one of the same size class is available.
+ */
+static __DRIbuffer *
+surfaceless_alloc_buffer(struct dri2_egl_surface *dri2_surf,
+                         unsigned int att, unsigned int format)
+{
+   struct dri2_egl_display *dri2_dpy =
+      dri2_egl_display(dri2_surf->base.Resource.Display);
+   struct dri2_pooled_buffer *pooled;
+   const int width = surfaceless_size_class(dri2_surf->base.Width);
+   const int height = surfaceless_size_class(dri2_surf->base.Height);
+   unsigned i;
+
+   if (att >= ARRAY_SIZE(dri2_surf->pooled_buffers))
+      return NULL;
+
+   pooled = &dri2_surf->pooled_buffers[att];
+   if (pooled->buffer)
+      return pooled->buffer;
+
+   mtx_lock(&dri2_dpy->buffer_pool_mutex);
+   for (i = 0; i < dri2_dpy->buffer_pool_count; i++) {
+      struct dri2_pooled_buffer *entry = &dri2_dpy->buffer_pool[i];
+
+      if (entry->attachment == att && entry->format == format &&
+          entry->width == width && entry->height == height) {
+         *pooled = *entry;
+         *entry = dri2_dpy->buffer_pool[--dri2_dpy->buffer_pool_count];
+         break;
+      }
+   }
+   mtx_unlock(&dri2_dpy->buffer_pool_mutex);
+
+   if (!pooled->buffer) {
+      pooled->buffer =
+         dri2_dpy->dri2->allocateBuffer(dri2_dpy->dri_screen, att, format,
+                                        width, height);
+      pooled->attachment = att;
+      pooled->format = format;
+      pooled->width = width;
+      pooled->height = height;
+   }
+
+   return pooled->buffer;
+}
+
+/**
+ * Hand the buffers of a pbuffer back to the display's pool, releasing the
+ * ones that don't fit anymore.
+ */
+static void
+surfaceless_free_buffers(struct dri2_egl_surface *dri2_surf)
+{
+   struct dri2_egl_display *dri2_dpy =
+      dri2_egl_display(dri2_surf->base.Resource.Display);
+   unsigned i;
+
+   mtx_lock(&dri2_dpy->buffer_pool_mutex);
+   for (i = 0; i < ARRAY_SIZE(dri2_surf->pooled_buffers); i++) {
+      struct dri2_pooled_buffer *pooled = &dri2_surf->pooled_buffers[i];
+
+      if (!pooled->buffer)
+         continue;
+
+      if (dri2_dpy->buffer_pool_count < DRI2_BUFFER_POOL_SIZE)
+         dri2_dpy->buffer_pool[dri2_dpy->buffer_pool_count++] = *pooled;
+      else
+         dri2_dpy->dri2->releaseBuffer(dri2_dpy->dri_screen, pooled->buffer);
+
+      pooled->buffer = NULL;
+   }
+   mtx_unlock(&dri2_dpy->buffer_pool_mutex);
+}
+
+void
+dri2_surfaceless_release_buffer_pool(_EGLDisplay *disp)
+{
+   struct dri2_egl_display *dri2_dpy = dri2_egl_display(disp);
+   unsigned i;
+
+   for (i = 0; i < dri2_dpy->buffer_pool_count; i++) {
+      dri2_dpy->dri2->releaseBuffer(dri2_dpy->dri_screen,
+                                    dri2_dpy->buffer_pool[i].buffer);
+   }
+   dri2_dpy->buffer_pool_count = 0;
+
+   mtx_destroy(&dri2_dpy->buffer_pool_mutex);
+}
+
+static _EGLSurface *
+surfaceless_create_pbuffer_surface(_EGLDriver *drv, _EGLDisplay *disp,
+                                   _EGLConfig *conf, const EGLint *attrib_list)
+{
+   struct dri2_egl_display *dri2_dpy = dri2_egl_display(disp);
+   struct dri2_egl_config *dri2_conf = dri2_egl_config(conf);
+   struct dri2_egl_surface *dri2_surf;
+   const __DRIconfig *config;
+
+   (void) drv;
+
+   dri2_surf = calloc(1, sizeof *dri2_surf);
+   if (!dri2_surf) {
+      _eglError(EGL_BAD_ALLOC, "surfaceless_create_pbuffer_surface");
+      return NULL;
+   }
+
+   if (!_eglInitSurface(&dri2_surf->base, disp, EGL_PBUFFER_BIT, conf,
+                        attrib_list))
+      goto cleanup_surface;
+
+   config = dri2_get_dri_config(dri2_conf, EGL_PBUFFER_BIT,
+                                dri2_surf->base.GLColorspace);
+
+   dri2_surf->dri_drawable =
+      (*dri2_dpy->dri2->createNewDrawable)(dri2_dpy->dri_screen, config,
+                                           dri2_surf);
+   if (dri2_surf->dri_drawable == NULL) {
+      _eglError(EGL_BAD_ALLOC, "dri2->createNewDrawable");
+      goto cleanup_surface;
+   }
+
+   return &dri2_surf->base;
+
+cleanup_surface:
+   free(dri2_surf);
+
+   return NULL;
+}
+
+static EGLBoolean
+surfaceless_destroy_surface(_EGLDriver *drv, _EGLDisplay *disp,
+                            _EGLSurface *surf)
+{
+   struct dri2_egl_display *dri2_dpy = dri2_egl_display(disp);
+   struct dri2_egl_surface *dri2_surf = dri2_egl_surface(surf);
+
+   (void) drv;
+
+   if (!_eglPutSurface(surf))
+      return EGL_TRUE;
+
+   (*dri2_dpy->core->destroyDrawable)(dri2_surf->dri_drawable);
+
+   surfaceless_free_buffers(dri2_surf);
+
+   free(dri2_surf);
+
+   return EGL_TRUE;
+}
+
+static EGLBoolean
+surfaceless_swap_buffers(_EGLDriver *drv, _EGLDisplay *disp,
+                         _EGLSurface *draw)
+{
+   /* eglSwapBuffers() has no effect on pbuffers */
+   return EGL_TRUE;
+}
+
 static struct dri2_egl_display_vtbl dri2_surfaceless_display_vtbl = {
    .create_pixmap_surface = dri2_fallback_create_pixmap_surface,
+   .create_pbuffer_surface = surfaceless_create_pbuffer_surface,
+   .destroy_surface = surfaceless_destroy_surface,
    .create_image = dri2_create_image_khr,
    .swap_interval = dri2_fallback_swap_interval,
+   .swap_buffers = surfaceless_swap_buffers,
    .swap_buffers_with_damage = dri2_fallback_swap_buffers_with_damage,
    .swap_buffers_region = dri2_fallback_swap_buffers_region,
    .post_sub_buffer = dri2_fallback_post_sub_buffer,
@@ -48,6 +223,7 @@ static struct dri2_egl_display_vtbl dri2_surfaceless_display_vtbl = {
    .query_buffer_age = dri2_fallback_query_buffer_age,
    .create_wayland_buffer_from_image = dri2_fallback_create_wayland_buffer_from_image,
    .get_sync_values = dri2_fallback_get_sync_values,
+   .get_dri_drawable = dri2_surface_get_dri_drawable,
 };
 
 static void
@@ -62,8 +238,33 @@ surfaceless_get_buffers_with_format(__DRIdrawable * driDrawable,
                              int *out_count, void *loaderPrivate)
 {
    struct dri2_egl_surface *dri2_surf = loaderPrivate;
+   int i;
+
+   dri2_surf->buffer_count = 0;
+   for (i = 0; i < count * 2; i += 2) {
+      __DRIbuffer *buf;
+
+      switch (attachments[i]) {
+      case __DRI_BUFFER_FRONT_LEFT:
+      case __DRI_BUFFER_BACK_LEFT:
+      case __DRI_BUFFER_DEPTH:
+      case __DRI_BUFFER_STENCIL:
+      case __DRI_BUFFER_ACCUM:
+      case __DRI_BUFFER_DEPTH_STENCIL:
+      case __DRI_BUFFER_HIZ:
+         buf = surfaceless_alloc_buffer(dri2_surf,
+                                        attachments[i], attachments[i + 1]);
+         if (buf) {
+            assert(dri2_surf->buffer_count < ARRAY_SIZE(dri2_surf->buffers));
+            dri2_surf->buffers[dri2_surf->buffer_count++] = *buf;
+         }
+         break;
+      default:
+         /* no fake front or right buffers */
+         break;
+      }
+   }
 
-   dri2_surf->buffer_count = 1;
    if (width)
       *width = dri2_surf->base.Width;
    if (height)
@@ -89,6 +290,7 @@ dri2_initialize_surfaceless(_EGLDriver *drv, _EGLDisplay *disp)
       return _eglError(EGL_BAD_ALLOC, "eglInitialize");
 
    disp->DriverData = (void *) dri2_dpy;
+   mtx_init(&dri2_dpy->buffer_pool_mutex, mtx_plain);
 
    const int limit = 64;
    const int base = 128;
@@ -139,7 +341,7 @@ dri2_initialize_surfaceless(_EGLDriver *drv, _EGLDisplay *disp)
 
    for (i = 0; dri2_dpy->driver_configs[i]; i++) {
       dri2_add_config(disp, dri2_dpy->driver_configs[i],
-                      i + 1, EGL_WINDOW_BIT, NULL, NULL);
+                      i + 1, EGL_WINDOW_BIT | EGL_PBUFFER_BIT, NULL, NULL);
    }
 
    disp->Extensions.KHR_image_base = EGL_TRUE;
@@ -156,6 +358,7 @@ cleanup_driver:
    free(dri2_dpy->driver_name);
    close(dri2_dpy->fd);
 cleanup_display:
+   mtx_destroy(&dri2_dpy->buffer_pool_mutex);
    free(dri2_dpy);
 
    return _eglError(EGL_NOT_INITIALIZED, err);
@@ -35,6 +35,16 @@
 #include "cso_cache.h"
 #include "cso_hash.h"
 
+/**
+ * Per-type lookup statistics, printed on cache destruction when the
+ * GALLIUM_CSO_STATS environment variable is set (debug builds only).
+ */
+struct cso_cache_stats {
+   unsigned lookups;     /**< calls to cso_find_state_template */
+   unsigned misses;      /**< lookups which found no matching state */
+   unsigned collisions;  /**< entries with the same key but other state */
+   unsigned max_chain;   /**< longest same-key run walked by one lookup */
+};
 
 struct cso_cache {
    struct cso_hash *hashes[CSO_CACHE_MAX];
@@ -42,38 +52,50 @@ struct cso_cache {
 
    cso_sanitize_callback sanitize_cb;
    void                 *sanitize_data;
+
+#ifdef DEBUG
+   struct cso_cache_stats stats[CSO_CACHE_MAX];
+#endif
 };
 
-#if 1
+#ifdef DEBUG
+DEBUG_GET_ONCE_BOOL_OPTION(cso_stats, "GALLIUM_CSO_STATS", FALSE)
+#endif
+
+/**
+ * Hash the state words with the MurmurHash3 (32-bit) mixing steps.
+ *
+ * Plain XOR of the words made states which only differ in a symmetric
+ * pair of fields (e.g. front/back stencil, src/dst blend factors) collide.
+ */
 static unsigned hash_key(const void *key, unsigned key_size)
 {
-   unsigned *ikey = (unsigned *)key;
-   unsigned hash = 0, i;
+   const uint32_t *ikey = (const uint32_t *)key;
+   uint32_t hash = 0, i;
 
    assert(key_size % 4 == 0);
 
-   /* I'm sure this can be improved on:
-    */
-   for (i = 0; i < key_size/4; i++)
-      hash ^= ikey[i];
+   for (i = 0; i < key_size/4; i++) {
+      uint32_t k = ikey[i];
 
-   return hash;
-}
-#else
-static unsigned hash_key(const unsigned char *p, int n)
-{
-   unsigned h = 0;
-   unsigned g;
-
-   while (n--) {
-      h = (h << 4) + *p++;
-      if ((g = (h & 0xf0000000)) != 0)
-         h ^= g >> 23;
-      h &= ~g;
+      k *= 0xcc9e2d51;
+      k = (k << 15) | (k >> 17);
+      k *= 0x1b873593;
+
+      hash ^= k;
+      hash = (hash << 13) | (hash >> 19);
+      hash = hash * 5 + 0xe6546b64;
    }
-   return h;
+
+   hash ^= key_size;
+   hash ^= hash >> 16;
+   hash *= 0x85ebca6b;
+   hash ^= hash >> 13;
+   hash *= 0xc2b2ae35;
+   hash ^= hash >> 16;
+
+   return hash;
 }
-#endif
 
 unsigned cso_construct_key(void *item, int item_size)
 {
@@ -203,13 +225,19 @@ cso_find_state(struct cso_cache *sc,
 }
 
 
+/*
+ * Entries with the same key are adjacent in the hash, so the walks below
+ * stop at the first entry with another key instead of iterating through
+ * the rest of the table.
+ */
 void *cso_hash_find_data_from_template( struct cso_hash *hash,
 				        unsigned hash_key, 
 				        void *templ,
 				        int size )
 {
    struct cso_hash_iter iter = cso_hash_find(hash, hash_key);
-   while (!cso_hash_iter_is_null(iter)) {
+   while (!cso_hash_iter_is_null(iter) &&
+          cso_hash_iter_key(iter) == hash_key) {
       void *iter_data = cso_hash_iter_data(iter);
       if (!memcmp(iter_data, templ, size)) {
 	 /* We found a match
@@ -227,13 +255,32 @@ struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
                                              void *templ, unsigned size)
 {
    struct cso_hash_iter iter = cso_find_state(sc, hash_key, type);
-   while (!cso_hash_iter_is_null(iter)) {
+   struct cso_hash_iter null_iter = {iter.hash, NULL};
+#ifdef DEBUG
+   struct cso_cache_stats *stats = &sc->stats[type];
+   unsigned chain = 0;
+
+   stats->lookups++;
+#endif
+
+   while (!cso_hash_iter_is_null(iter) &&
+          cso_hash_iter_key(iter) == hash_key) {
       void *iter_data = cso_hash_iter_data(iter);
+#ifdef DEBUG
+      if (++chain > stats->max_chain)
+         stats->max_chain = chain;
+#endif
       if (!memcmp(iter_data, templ, size))
          return iter;
+#ifdef DEBUG
+      stats->collisions++;
+#endif
       iter = cso_hash_iter_next(iter);
    }
-   return iter;
+#ifdef DEBUG
+   stats->misses++;
+#endif
+   return null_iter;
 }
 
 void * cso_take_state(struct cso_cache *sc,
@@ -250,6 +297,8 @@ struct cso_cache *cso_cache_create(void)
    if (!sc)
       return NULL;
 
+   memset(sc, 0, sizeof(*sc));
+
    sc->max_size           = 4096;
    for (i = 0; i < CSO_CACHE_MAX; i++)
       sc->hashes[i] = cso_hash_create();
@@ -276,6 +325,26 @@ void cso_for_each_state(struct cso_cache *sc, enum cso_cache_type type,
    }
 }
 
+#ifdef DEBUG
+static void print_stats(struct cso_cache *sc)
+{
+   static const char *names[CSO_CACHE_MAX] = {
+      "rasterizer", "blend", "depth_stencil_alpha", "sampler", "velements"
+   };
+   int i;
+
+   debug_printf("cso cache: %-20s %8s %10s %10s %10s %9s\n", "type",
+                "entries", "lookups", "misses", "collisions", "max chain");
+   for (i = 0; i < CSO_CACHE_MAX; i++) {
+      const struct cso_cache_stats *stats = &sc->stats[i];
+
+      debug_printf("cso cache: %-20s %8d %10u %10u %10u %9u\n", names[i],
+                   cso_hash_size(sc->hashes[i]), stats->lookups,
+                   stats->misses, stats->collisions, stats->max_chain);
+   }
+}
+#endif
+
 void cso_cache_delete(struct cso_cache *sc)
 {
    int i;
@@ -284,6 +353,11 @@ void cso_cache_delete(struct cso_cache *sc)
    if (!sc)
       return;
 
+#ifdef DEBUG
+   if (debug_get_option_cso_stats())
+      print_stats(sc);
+#endif
+
    /* delete driver data */
    cso_for_each_state(sc, CSO_BLEND, delete_blend_state, 0);
    cso_for_each_state(sc, CSO_DEPTH_STENCIL_ALPHA, delete_depth_stencil_state, 0);
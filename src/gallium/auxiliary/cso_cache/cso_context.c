@@ -50,6 +50,12 @@
 #include "cso_context.h"
 
 
+/** Number of most recently used states of each type checked before
+ * hashing the template, see cso_mru_find().
+ */
+#define CSO_MRU_SIZE 4
+
+
 /**
  * Info related to samplers and sampler views.
  * We have one of these for fragment samplers and another for vertex samplers.
@@ -121,9 +127,63 @@ struct cso_context {
    unsigned sample_mask, sample_mask_saved;
    unsigned min_samples, min_samples_saved;
    struct pipe_stencil_ref stencil_ref, stencil_ref_saved;
+
+   /** Most recently used cache entries of each type, most recent first */
+   void *mru[CSO_CACHE_MAX][CSO_MRU_SIZE];
 };
 
 
+/**
+ * Look for the template among the most recently used states of the type.
+ * This saves hashing the template and walking the hash chain when an app
+ * switches between a few states, which is the common case. All cso_x
+ * structures start with the state itself.
+ */
+static inline void *
+cso_mru_find(struct cso_context *ctx, enum cso_cache_type type,
+             const void *templ, unsigned key_size)
+{
+   void **mru = ctx->mru[type];
+   unsigned i;
+
+   for (i = 0; i < CSO_MRU_SIZE && mru[i]; i++) {
+      if (!memcmp(mru[i], templ, key_size)) {
+         void *cso = mru[i];
+
+         memmove(&mru[1], &mru[0], i * sizeof(mru[0]));
+         mru[0] = cso;
+         return cso;
+      }
+   }
+   return NULL;
+}
+
+static inline void
+cso_mru_add(struct cso_context *ctx, enum cso_cache_type type, void *cso)
+{
+   void **mru = ctx->mru[type];
+
+   memmove(&mru[1], &mru[0], (CSO_MRU_SIZE - 1) * sizeof(mru[0]));
+   mru[0] = cso;
+}
+
+static void
+cso_mru_remove(struct cso_context *ctx, enum cso_cache_type type, void *cso)
+{
+   void **mru = ctx->mru[type];
+   unsigned i;
+
+   for (i = 0; i < CSO_MRU_SIZE; i++) {
+      if (mru[i] == cso) {
+         memmove(&mru[i], &mru[i + 1],
+                 (CSO_MRU_SIZE - 1 - i) * sizeof(mru[0]));
+         mru[CSO_MRU_SIZE - 1] = NULL;
+         return;
+      }
+   }
+}
+
+
 static boolean delete_blend_state(struct cso_context *ctx, void *state)
 {
    struct cso_blend *cso = (struct cso_blend *)state;
@@ -227,6 +287,7 @@ sanitize_hash(struct cso_hash *hash, enum cso_cache_type type,
       /*fixme: currently we pick the nodes to remove at random*/
       void *cso = cso_hash_iter_data(iter);
       if (delete_cso(ctx, cso, type)) {
+         cso_mru_remove(ctx, type, cso);
          iter = cso_hash_erase(hash, iter);
          --to_remove;
       } else
@@ -403,38 +464,46 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
 {
    unsigned key_size, hash_key;
    struct cso_hash_iter iter;
+   struct cso_blend *cso;
    void *handle;
 
    key_size = templ->independent_blend_enable ?
       sizeof(struct pipe_blend_state) :
       (char *)&(templ->rt[1]) - (char *)templ;
-   hash_key = cso_construct_key((void*)templ, key_size);
-   iter = cso_find_state_template(ctx->cache, hash_key, CSO_BLEND,
-                                  (void*)templ, key_size);
-
-   if (cso_hash_iter_is_null(iter)) {
-      struct cso_blend *cso = MALLOC(sizeof(struct cso_blend));
-      if (!cso)
-         return PIPE_ERROR_OUT_OF_MEMORY;
-
-      memset(&cso->state, 0, sizeof cso->state);
-      memcpy(&cso->state, templ, key_size);
-      cso->data = ctx->pipe->create_blend_state(ctx->pipe, &cso->state);
-      cso->delete_state = (cso_state_callback)ctx->pipe->delete_blend_state;
-      cso->context = ctx->pipe;
-
-      iter = cso_insert_state(ctx->cache, hash_key, CSO_BLEND, cso);
+
+   cso = cso_mru_find(ctx, CSO_BLEND, templ, key_size);
+   if (!cso) {
+      hash_key = cso_construct_key((void*)templ, key_size);
+      iter = cso_find_state_template(ctx->cache, hash_key, CSO_BLEND,
+                                     (void*)templ, key_size);
+
       if (cso_hash_iter_is_null(iter)) {
-         FREE(cso);
-         return PIPE_ERROR_OUT_OF_MEMORY;
+         cso = MALLOC(sizeof(struct cso_blend));
+         if (!cso)
+            return PIPE_ERROR_OUT_OF_MEMORY;
+
+         memset(&cso->state, 0, sizeof cso->state);
+         memcpy(&cso->state, templ, key_size);
+         cso->data = ctx->pipe->create_blend_state(ctx->pipe, &cso->state);
+         cso->delete_state =
+            (cso_state_callback)ctx->pipe->delete_blend_state;
+         cso->context = ctx->pipe;
+
+         iter = cso_insert_state(ctx->cache, hash_key, CSO_BLEND, cso);
+         if (cso_hash_iter_is_null(iter)) {
+            FREE(cso);
+            return PIPE_ERROR_OUT_OF_MEMORY;
+         }
+      }
+      else {
+         cso = (struct cso_blend *)cso_hash_iter_data(iter);
       }
 
-      handle = cso->data;
-   }
-   else {
-      handle = ((struct cso_blend *)cso_hash_iter_data(iter))->data;
+      cso_mru_add(ctx, CSO_BLEND, cso);
    }
 
+   handle = cso->data;
+
    if (ctx->blend != handle) {
       ctx->blend = handle;
       ctx->pipe->bind_blend_state(ctx->pipe, handle);
@@ -466,40 +535,45 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
                             const struct pipe_depth_stencil_alpha_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_depth_stencil_alpha_state);
-   unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_DEPTH_STENCIL_ALPHA,
-                                                       (void*)templ, key_size);
+   struct cso_depth_stencil_alpha *cso;
    void *handle;
 
-   if (cso_hash_iter_is_null(iter)) {
-      struct cso_depth_stencil_alpha *cso =
-         MALLOC(sizeof(struct cso_depth_stencil_alpha));
-      if (!cso)
-         return PIPE_ERROR_OUT_OF_MEMORY;
-
-      memcpy(&cso->state, templ, sizeof(*templ));
-      cso->data = ctx->pipe->create_depth_stencil_alpha_state(ctx->pipe,
-                                                              &cso->state);
-      cso->delete_state =
-         (cso_state_callback)ctx->pipe->delete_depth_stencil_alpha_state;
-      cso->context = ctx->pipe;
-
-      iter = cso_insert_state(ctx->cache, hash_key,
-                              CSO_DEPTH_STENCIL_ALPHA, cso);
+   cso = cso_mru_find(ctx, CSO_DEPTH_STENCIL_ALPHA, templ, key_size);
+   if (!cso) {
+      unsigned hash_key = cso_construct_key((void*)templ, key_size);
+      struct cso_hash_iter iter =
+         cso_find_state_template(ctx->cache, hash_key,
+                                 CSO_DEPTH_STENCIL_ALPHA,
+                                 (void*)templ, key_size);
+
       if (cso_hash_iter_is_null(iter)) {
-         FREE(cso);
-         return PIPE_ERROR_OUT_OF_MEMORY;
+         cso = MALLOC(sizeof(struct cso_depth_stencil_alpha));
+         if (!cso)
+            return PIPE_ERROR_OUT_OF_MEMORY;
+
+         memcpy(&cso->state, templ, sizeof(*templ));
+         cso->data = ctx->pipe->create_depth_stencil_alpha_state(ctx->pipe,
+                                                                 &cso->state);
+         cso->delete_state =
+            (cso_state_callback)ctx->pipe->delete_depth_stencil_alpha_state;
+         cso->context = ctx->pipe;
+
+         iter = cso_insert_state(ctx->cache, hash_key,
+                                 CSO_DEPTH_STENCIL_ALPHA, cso);
+         if (cso_hash_iter_is_null(iter)) {
+            FREE(cso);
+            return PIPE_ERROR_OUT_OF_MEMORY;
+         }
+      }
+      else {
+         cso = (struct cso_depth_stencil_alpha *)cso_hash_iter_data(iter);
       }
 
-      handle = cso->data;
-   }
-   else {
-      handle = ((struct cso_depth_stencil_alpha *)
-                cso_hash_iter_data(iter))->data;
+      cso_mru_add(ctx, CSO_DEPTH_STENCIL_ALPHA, cso);
    }
 
+   handle = cso->data;
+
    if (ctx->depth_stencil != handle) {
       ctx->depth_stencil = handle;
       ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe, handle);
@@ -531,36 +605,43 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
                                    const struct pipe_rasterizer_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_rasterizer_state);
-   unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_RASTERIZER,
-                                                       (void*)templ, key_size);
+   struct cso_rasterizer *cso;
    void *handle = NULL;
 
-   if (cso_hash_iter_is_null(iter)) {
-      struct cso_rasterizer *cso = MALLOC(sizeof(struct cso_rasterizer));
-      if (!cso)
-         return PIPE_ERROR_OUT_OF_MEMORY;
-
-      memcpy(&cso->state, templ, sizeof(*templ));
-      cso->data = ctx->pipe->create_rasterizer_state(ctx->pipe, &cso->state);
-      cso->delete_state =
-         (cso_state_callback)ctx->pipe->delete_rasterizer_state;
-      cso->context = ctx->pipe;
+   cso = cso_mru_find(ctx, CSO_RASTERIZER, templ, key_size);
+   if (!cso) {
+      unsigned hash_key = cso_construct_key((void*)templ, key_size);
+      struct cso_hash_iter iter =
+         cso_find_state_template(ctx->cache, hash_key, CSO_RASTERIZER,
+                                 (void*)templ, key_size);
 
-      iter = cso_insert_state(ctx->cache, hash_key, CSO_RASTERIZER, cso);
       if (cso_hash_iter_is_null(iter)) {
-         FREE(cso);
-         return PIPE_ERROR_OUT_OF_MEMORY;
+         cso = MALLOC(sizeof(struct cso_rasterizer));
+         if (!cso)
+            return PIPE_ERROR_OUT_OF_MEMORY;
+
+         memcpy(&cso->state, templ, sizeof(*templ));
+         cso->data = ctx->pipe->create_rasterizer_state(ctx->pipe,
+                                                        &cso->state);
+         cso->delete_state =
+            (cso_state_callback)ctx->pipe->delete_rasterizer_state;
+         cso->context = ctx->pipe;
+
+         iter = cso_insert_state(ctx->cache, hash_key, CSO_RASTERIZER, cso);
+         if (cso_hash_iter_is_null(iter)) {
+            FREE(cso);
+            return PIPE_ERROR_OUT_OF_MEMORY;
+         }
+      }
+      else {
+         cso = (struct cso_rasterizer *)cso_hash_iter_data(iter);
       }
 
-      handle = cso->data;
-   }
-   else {
-      handle = ((struct cso_rasterizer *)cso_hash_iter_data(iter))->data;
+      cso_mru_add(ctx, CSO_RASTERIZER, cso);
    }
 
+   handle = cso->data;
+
    if (ctx->rasterizer != handle) {
       ctx->rasterizer = handle;
       ctx->pipe->bind_rasterizer_state(ctx->pipe, handle);
@@ -998,6 +1079,7 @@ cso_set_vertex_elements(struct cso_context *ctx,
    struct u_vbuf *vbuf = ctx->vbuf;
    unsigned key_size, hash_key;
    struct cso_hash_iter iter;
+   struct cso_velements *cso;
    void *handle;
    struct cso_velems_state velems_state;
 
@@ -1015,34 +1097,41 @@ cso_set_vertex_elements(struct cso_context *ctx,
    velems_state.count = count;
    memcpy(velems_state.velems, states,
           sizeof(struct pipe_vertex_element) * count);
-   hash_key = cso_construct_key((void*)&velems_state, key_size);
-   iter = cso_find_state_template(ctx->cache, hash_key, CSO_VELEMENTS,
-                                  (void*)&velems_state, key_size);
-
-   if (cso_hash_iter_is_null(iter)) {
-      struct cso_velements *cso = MALLOC(sizeof(struct cso_velements));
-      if (!cso)
-         return PIPE_ERROR_OUT_OF_MEMORY;
-
-      memcpy(&cso->state, &velems_state, key_size);
-      cso->data = ctx->pipe->create_vertex_elements_state(ctx->pipe, count,
-                                                      &cso->state.velems[0]);
-      cso->delete_state =
-         (cso_state_callback) ctx->pipe->delete_vertex_elements_state;
-      cso->context = ctx->pipe;
-
-      iter = cso_insert_state(ctx->cache, hash_key, CSO_VELEMENTS, cso);
+
+   cso = cso_mru_find(ctx, CSO_VELEMENTS, &velems_state, key_size);
+   if (!cso) {
+      hash_key = cso_construct_key((void*)&velems_state, key_size);
+      iter = cso_find_state_template(ctx->cache, hash_key, CSO_VELEMENTS,
+                                     (void*)&velems_state, key_size);
+
       if (cso_hash_iter_is_null(iter)) {
-         FREE(cso);
-         return PIPE_ERROR_OUT_OF_MEMORY;
+         cso = MALLOC(sizeof(struct cso_velements));
+         if (!cso)
+            return PIPE_ERROR_OUT_OF_MEMORY;
+
+         memcpy(&cso->state, &velems_state, key_size);
+         cso->data =
+            ctx->pipe->create_vertex_elements_state(ctx->pipe, count,
+                                                    &cso->state.velems[0]);
+         cso->delete_state =
+            (cso_state_callback) ctx->pipe->delete_vertex_elements_state;
+         cso->context = ctx->pipe;
+
+         iter = cso_insert_state(ctx->cache, hash_key, CSO_VELEMENTS, cso);
+         if (cso_hash_iter_is_null(iter)) {
+            FREE(cso);
+            return PIPE_ERROR_OUT_OF_MEMORY;
+         }
+      }
+      else {
+         cso = (struct cso_velements *)cso_hash_iter_data(iter);
       }
 
-      handle = cso->data;
-   }
-   else {
-      handle = ((struct cso_velements *)cso_hash_iter_data(iter))->data;
+      cso_mru_add(ctx, CSO_VELEMENTS, cso);
    }
 
+   handle = cso->data;
+
    if (ctx->velements != handle) {
       ctx->velements = handle;
       ctx->pipe->bind_vertex_elements_state(ctx->pipe, handle);
@@ -1164,34 +1253,42 @@ cso_single_sampler(struct cso_context *ctx, unsigned shader_stage,
 
    if (templ) {
       unsigned key_size = sizeof(struct pipe_sampler_state);
-      unsigned hash_key = cso_construct_key((void*)templ, key_size);
-      struct cso_hash_iter iter =
-         cso_find_state_template(ctx->cache,
-                                 hash_key, CSO_SAMPLER,
-                                 (void *) templ, key_size);
+      struct cso_sampler *cso;
 
-      if (cso_hash_iter_is_null(iter)) {
-         struct cso_sampler *cso = MALLOC(sizeof(struct cso_sampler));
-         if (!cso)
-            return PIPE_ERROR_OUT_OF_MEMORY;
+      cso = cso_mru_find(ctx, CSO_SAMPLER, templ, key_size);
+      if (!cso) {
+         unsigned hash_key = cso_construct_key((void*)templ, key_size);
+         struct cso_hash_iter iter =
+            cso_find_state_template(ctx->cache,
+                                    hash_key, CSO_SAMPLER,
+                                    (void *) templ, key_size);
 
-         memcpy(&cso->state, templ, sizeof(*templ));
-         cso->data = ctx->pipe->create_sampler_state(ctx->pipe, &cso->state);
-         cso->delete_state =
-            (cso_state_callback) ctx->pipe->delete_sampler_state;
-         cso->context = ctx->pipe;
-
-         iter = cso_insert_state(ctx->cache, hash_key, CSO_SAMPLER, cso);
          if (cso_hash_iter_is_null(iter)) {
-            FREE(cso);
-            return PIPE_ERROR_OUT_OF_MEMORY;
+            cso = MALLOC(sizeof(struct cso_sampler));
+            if (!cso)
+               return PIPE_ERROR_OUT_OF_MEMORY;
+
+            memcpy(&cso->state, templ, sizeof(*templ));
+            cso->data = ctx->pipe->create_sampler_state(ctx->pipe,
+                                                        &cso->state);
+            cso->delete_state =
+               (cso_state_callback) ctx->pipe->delete_sampler_state;
+            cso->context = ctx->pipe;
+
+            iter = cso_insert_state(ctx->cache, hash_key, CSO_SAMPLER, cso);
+            if (cso_hash_iter_is_null(iter)) {
+               FREE(cso);
+               return PIPE_ERROR_OUT_OF_MEMORY;
+            }
+         }
+         else {
+            cso = (struct cso_sampler *)cso_hash_iter_data(iter);
          }
 
-         handle = cso->data;
-      }
-      else {
-         handle = ((struct cso_sampler *)cso_hash_iter_data(iter))->data;
+         cso_mru_add(ctx, CSO_SAMPLER, cso);
       }
+
+      handle = cso->data;
    }
 
    ctx->samplers[shader_stage].samplers[idx] = handle;
@@ -31,36 +31,19 @@ static boolean TAG(do_cliptest)( struct pt_post_vs *pvs,
 {
    struct vertex_header *out = info->verts;
    /* const */ float (*plane)[4] = pvs->draw->plane;
-   const unsigned pos = draw_current_shader_position_output(pvs->draw);
-   const unsigned cv = draw_current_shader_clipvertex_output(pvs->draw);
-   unsigned cd[2];
-   const unsigned ef = pvs->draw->vs.edgeflag_output;
-   unsigned ucp_enable = pvs->draw->rasterizer->clip_plane_enable;
-   unsigned flags = (FLAGS);
+   const unsigned pos = pvs->pos;
+   const unsigned cv = pvs->cv;
+   const unsigned *cd = pvs->cd;
+   const unsigned ef = pvs->ef;
+   const unsigned ucp_enable = pvs->ucp_enable;
+   const unsigned flags = (FLAGS);
+   const unsigned viewport_index_output = pvs->viewport_index_output;
+   const unsigned verts_per_prim =
+      (flags & DO_VIEWPORT_INDEX) ? u_vertices_per_prim(prim_info->prim) : 1;
    unsigned need_pipeline = 0;
    unsigned j;
    unsigned i;
-   bool have_cd = false;
-   unsigned viewport_index_output =
-      draw_current_shader_viewport_index_output(pvs->draw);
-   int viewport_index = 
-      draw_current_shader_uses_viewport_index(pvs->draw) ?
-      *((unsigned*)out->data[viewport_index_output]): 0;
-   int num_written_clipdistance =
-      draw_current_shader_num_written_clipdistances(pvs->draw);
-
-   cd[0] = draw_current_shader_clipdistance_output(pvs->draw, 0);
-   cd[1] = draw_current_shader_clipdistance_output(pvs->draw, 1);
-
-   if (cd[0] != pos || cd[1] != pos)
-      have_cd = true;
-
-   /* If clipdistance semantic has been written by the shader
-    * that means we're expected to do 'user plane clipping' */
-   if (num_written_clipdistance && !(flags & DO_CLIP_USER)) {
-      flags |= DO_CLIP_USER;
-      ucp_enable = (1 << num_written_clipdistance) - 1;
-   }
+   int viewport_index = 0;
 
    assert(pos != -1);
    for (j = 0; j < info->count; j++) {
@@ -68,8 +51,7 @@ static boolean TAG(do_cliptest)( struct pt_post_vs *pvs,
       unsigned mask = 0x0;
       float *scale = pvs->draw->viewports[0].scale;
       float *trans = pvs->draw->viewports[0].translate;
-      if (draw_current_shader_uses_viewport_index(pvs->draw)) {
-         unsigned verts_per_prim = u_vertices_per_prim(prim_info->prim);
+      if (flags & DO_VIEWPORT_INDEX) {
          /* only change the viewport_index for the leading vertex */
          if (!(j % verts_per_prim)) {
             viewport_index = *((unsigned*)out->data[viewport_index_output]);
@@ -134,7 +116,7 @@ static boolean TAG(do_cliptest)( struct pt_post_vs *pvs,
                 * and the shader has written to it, otherwise use clipvertex
                 * to decide when the plane is clipping.
                 */
-               if (have_cd && num_written_clipdistance) {
+               if (flags & DO_CLIP_DIST) {
                   float clipdist;
                   i = plane_idx - 6;
                   /* first four clip distance in first vector etc. */
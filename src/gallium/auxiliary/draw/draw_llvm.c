@@ -30,6 +30,7 @@
 #include "draw_context.h"
 #include "draw_vs.h"
 #include "draw_gs.h"
+#include "draw_vs_threads.h"
 
 #include "gallivm/lp_bld_arit.h"
 #include "gallivm/lp_bld_arit_overflow.h"
@@ -511,6 +512,8 @@ draw_llvm_create(struct draw_context *draw, LLVMContextRef context)
    llvm->nr_gs_variants = 0;
    make_empty_list(&llvm->gs_variants_list);
 
+   llvm->vs_threads = draw_vs_threads_create();
+
    return llvm;
 
 fail:
@@ -525,6 +528,8 @@ fail:
 void
 draw_llvm_destroy(struct draw_llvm *llvm)
 {
+   draw_vs_threads_destroy(llvm->vs_threads);
+
    if (llvm->context_owned)
       LLVMContextDispose(llvm->context);
    llvm->context = NULL;
@@ -628,7 +633,7 @@ generate_vs(struct draw_llvm_variant *variant,
                      NULL,
                      draw_sampler,
                      &llvm->draw->vs.vertex_shader->info,
-                     NULL);
+                     NULL, NULL);
 
    {
       LLVMValueRef out;
@@ -2237,7 +2242,8 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
                      NULL,
                      sampler,
                      &llvm->draw->gs.geometry_shader->info,
-                     (const struct lp_build_tgsi_gs_iface *)&gs_iface);
+                     (const struct lp_build_tgsi_gs_iface *)&gs_iface,
+                     NULL);
 
    sampler->destroy(sampler);
 
@@ -41,6 +41,7 @@
 
 
 struct draw_llvm;
+struct draw_vs_threads;
 struct llvm_vertex_shader;
 struct llvm_geometry_shader;
 
@@ -466,6 +467,9 @@ struct draw_llvm {
 
    struct draw_gs_llvm_variant_list_item gs_variants_list;
    int nr_gs_variants;
+
+   /** Workers for splitting large vertex chunks, NULL if single-threaded */
+   struct draw_vs_threads *vs_threads;
 };
 
 
@@ -36,6 +36,7 @@
 #include "draw/draw_prim_assembler.h"
 #include "draw/draw_vs.h"
 #include "draw/draw_llvm.h"
+#include "draw/draw_vs_threads.h"
 #include "gallivm/lp_bld_init.h"
 
 
@@ -336,6 +337,113 @@ emit(struct pt_emit *emit,
 }
 
 
+/**
+ * Run fetch, the vertex shader and clip testing on count vertices starting
+ * at the first'th of the chunk, writing them at the same position in verts.
+ */
+static unsigned
+llvm_pipeline_run_vs_range(struct llvm_middle_end *fpme,
+                           const struct draw_fetch_info *fetch_info,
+                           struct vertex_header *verts,
+                           unsigned first, unsigned count)
+{
+   struct draw_context *draw = fpme->draw;
+
+   verts = (struct vertex_header *)
+      ((char *) verts + first * fpme->vertex_size);
+
+   if (fetch_info->linear)
+      return fpme->current_variant->jit_func( &fpme->llvm->jit_context,
+                                       verts,
+                                       draw->pt.user.vbuffer,
+                                       fetch_info->start + first,
+                                       count,
+                                       fpme->vertex_size,
+                                       draw->pt.vertex_buffer,
+                                       draw->instance_id,
+                                       draw->start_index,
+                                       draw->start_instance);
+   else
+      return fpme->current_variant->jit_func_elts( &fpme->llvm->jit_context,
+                                            verts,
+                                            draw->pt.user.vbuffer,
+                                            fetch_info->elts + first,
+                                            draw->pt.user.eltMax,
+                                            count,
+                                            fpme->vertex_size,
+                                            draw->pt.vertex_buffer,
+                                            draw->instance_id,
+                                            draw->pt.user.eltBias,
+                                            draw->start_instance);
+}
+
+
+/** Smallest number of vertices worth handing to another thread */
+#define VS_MIN_SHARD_SIZE 256
+
+struct llvm_vs_shards {
+   struct llvm_middle_end *fpme;
+   const struct draw_fetch_info *fetch_info;
+   struct vertex_header *verts;
+   unsigned shard_size;
+   unsigned clipped[DRAW_VS_MAX_THREADS];
+};
+
+
+static void
+llvm_pipeline_vs_shard(void *data, unsigned shard)
+{
+   struct llvm_vs_shards *shards = (struct llvm_vs_shards *) data;
+   unsigned first = shard * shards->shard_size;
+   unsigned count = MIN2(shards->shard_size,
+                         shards->fetch_info->count - first);
+
+   shards->clipped[shard] = llvm_pipeline_run_vs_range(shards->fpme,
+                                                       shards->fetch_info,
+                                                       shards->verts,
+                                                       first, count);
+}
+
+
+/**
+ * Shade the vertices of a chunk, splitting large chunks across the vertex
+ * shader threads.  Each shard writes its own slice of verts, so the output
+ * is what a single call would have produced.  Shards are a multiple of the
+ * vector length, only the last one can end in a partial vector, which
+ * stays within the padding the caller allocated.
+ */
+static unsigned
+llvm_pipeline_run_vs(struct llvm_middle_end *fpme,
+                     const struct draw_fetch_info *fetch_info,
+                     struct vertex_header *verts)
+{
+   struct draw_vs_threads *pool = fpme->llvm->vs_threads;
+   struct llvm_vs_shards shards;
+   unsigned num_shards, i;
+   unsigned clipped = 0;
+
+   num_shards = MIN2(draw_vs_threads_count(pool),
+                     fetch_info->count / VS_MIN_SHARD_SIZE);
+   if (num_shards <= 1)
+      return llvm_pipeline_run_vs_range(fpme, fetch_info, verts,
+                                        0, fetch_info->count);
+
+   shards.fpme = fpme;
+   shards.fetch_info = fetch_info;
+   shards.verts = verts;
+   shards.shard_size = align(DIV_ROUND_UP(fetch_info->count, num_shards),
+                             lp_native_vector_width / 32);
+   num_shards = DIV_ROUND_UP(fetch_info->count, shards.shard_size);
+
+   draw_vs_threads_run(pool, num_shards, llvm_pipeline_vs_shard, &shards);
+
+   for (i = 0; i < num_shards; i++)
+      clipped |= shards.clipped[i];
+
+   return clipped;
+}
+
+
 static void
 llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                       const struct draw_fetch_info *fetch_info,
@@ -373,29 +481,7 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       draw->statistics.vs_invocations += fetch_info->count;
    }
 
-   if (fetch_info->linear)
-      clipped = fpme->current_variant->jit_func( &fpme->llvm->jit_context,
-                                       llvm_vert_info.verts,
-                                       draw->pt.user.vbuffer,
-                                       fetch_info->start,
-                                       fetch_info->count,
-                                       fpme->vertex_size,
-                                       draw->pt.vertex_buffer,
-                                       draw->instance_id,
-                                       draw->start_index,
-                                       draw->start_instance);
-   else
-      clipped = fpme->current_variant->jit_func_elts( &fpme->llvm->jit_context,
-                                            llvm_vert_info.verts,
-                                            draw->pt.user.vbuffer,
-                                            fetch_info->elts,
-                                            draw->pt.user.eltMax,
-                                            fetch_info->count,
-                                            fpme->vertex_size,
-                                            draw->pt.vertex_buffer,
-                                            draw->instance_id,
-                                            draw->pt.user.eltBias,
-                                            draw->start_instance);
+   clipped = llvm_pipeline_run_vs(fpme, fetch_info, llvm_vert_info.verts);
 
    /* Finished with fetch and vs:
     */
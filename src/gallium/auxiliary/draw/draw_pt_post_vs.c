@@ -41,6 +41,8 @@
 #define DO_VIEWPORT          0x10
 #define DO_EDGEFLAG          0x20
 #define DO_CLIP_XY_GUARD_BAND 0x40
+#define DO_CLIP_DIST         0x80  /* user planes come from clipdistance */
+#define DO_VIEWPORT_INDEX    0x100 /* viewport selected per primitive */
 
 
 struct pt_post_vs {
@@ -48,6 +50,16 @@ struct pt_post_vs {
 
    unsigned flags;
 
+   /* Shader output slots and user plane mask, looked up once at prepare
+    * time rather than on every run.
+    */
+   unsigned pos;
+   unsigned cv;
+   unsigned cd[2];
+   unsigned ef;
+   unsigned viewport_index_output;
+   unsigned ucp_enable;
+
    boolean (*run)( struct pt_post_vs *pvs,
                    struct draw_vertex_info *info,
                    const struct draw_prim_info *prim_info );
@@ -103,12 +115,52 @@ dot4(const float *a, const float *b)
 #define TAG(x) x##_xy_fullz_user_viewport_edgeflag
 #include "draw_cliptest_tmp.h"
 
+#define FLAGS (DO_CLIP_XY | DO_CLIP_FULL_Z | DO_VIEWPORT | DO_EDGEFLAG)
+#define TAG(x) x##_xy_fullz_viewport_edgeflag
+#include "draw_cliptest_tmp.h"
 
+#define FLAGS (DO_CLIP_XY | DO_CLIP_HALF_Z | DO_CLIP_USER | DO_VIEWPORT)
+#define TAG(x) x##_xy_halfz_user_viewport
+#include "draw_cliptest_tmp.h"
 
-/* Don't want to create 64 versions of this function, so catch the
- * less common ones here.  This is looking like something which should
- * be code-generated, perhaps appended to the end of the vertex
- * shader.
+#define FLAGS (DO_CLIP_XY_GUARD_BAND | DO_CLIP_HALF_Z | DO_CLIP_USER | DO_VIEWPORT)
+#define TAG(x) x##_xy_gb_halfz_user_viewport
+#include "draw_cliptest_tmp.h"
+
+#define FLAGS (DO_CLIP_XY | DO_CLIP_FULL_Z | DO_CLIP_USER | DO_CLIP_DIST | DO_VIEWPORT)
+#define TAG(x) x##_xy_fullz_clipdist_viewport
+#include "draw_cliptest_tmp.h"
+
+#define FLAGS (DO_CLIP_XY | DO_CLIP_HALF_Z | DO_CLIP_USER | DO_CLIP_DIST | DO_VIEWPORT)
+#define TAG(x) x##_xy_halfz_clipdist_viewport
+#include "draw_cliptest_tmp.h"
+
+#define FLAGS (DO_CLIP_XY_GUARD_BAND | DO_CLIP_HALF_Z | DO_CLIP_USER | DO_CLIP_DIST | DO_VIEWPORT)
+#define TAG(x) x##_xy_gb_halfz_clipdist_viewport
+#include "draw_cliptest_tmp.h"
+
+#define FLAGS (DO_CLIP_XY | DO_CLIP_FULL_Z | DO_VIEWPORT | DO_VIEWPORT_INDEX)
+#define TAG(x) x##_xy_fullz_viewport_vpindex
+#include "draw_cliptest_tmp.h"
+
+#define FLAGS (DO_CLIP_XY | DO_CLIP_HALF_Z | DO_VIEWPORT | DO_VIEWPORT_INDEX)
+#define TAG(x) x##_xy_halfz_viewport_vpindex
+#include "draw_cliptest_tmp.h"
+
+#define FLAGS (DO_CLIP_XY | DO_CLIP_FULL_Z)
+#define TAG(x) x##_xy_fullz
+#include "draw_cliptest_tmp.h"
+
+#define FLAGS (DO_CLIP_XY | DO_CLIP_HALF_Z)
+#define TAG(x) x##_xy_halfz
+#include "draw_cliptest_tmp.h"
+
+
+
+/* Don't want to create a version for every flag combination, so catch
+ * the less common ones here.  The flags are all settled at prepare time,
+ * which covers everything that is constant while the shaders are bound;
+ * this variant only pays for testing them per vertex.
  */
 #define FLAGS (pvs->flags)
 #define TAG(x) x##_generic
@@ -133,8 +185,21 @@ void draw_pt_post_vs_prepare( struct pt_post_vs *pvs,
                               boolean clip_halfz,
 			      boolean need_edgeflags )
 {
+   struct draw_context *draw = pvs->draw;
+   unsigned num_written_clipdistance =
+      draw_current_shader_num_written_clipdistances(draw);
+
    pvs->flags = 0;
 
+   pvs->pos = draw_current_shader_position_output(draw);
+   pvs->cv = draw_current_shader_clipvertex_output(draw);
+   pvs->cd[0] = draw_current_shader_clipdistance_output(draw, 0);
+   pvs->cd[1] = draw_current_shader_clipdistance_output(draw, 1);
+   pvs->ef = draw->vs.edgeflag_output;
+   pvs->viewport_index_output =
+      draw_current_shader_viewport_index_output(draw);
+   pvs->ucp_enable = draw->rasterizer->clip_plane_enable;
+
    /* This combination not currently tested/in use:
     */
    if (!clip_halfz)
@@ -165,15 +230,33 @@ void draw_pt_post_vs_prepare( struct pt_post_vs *pvs,
       }
    }
 
-   if (clip_user)
+   /* If clipdistance semantic has been written by the shader
+    * that means we're expected to do 'user plane clipping' */
+   if (num_written_clipdistance && !clip_user) {
+      clip_user = TRUE;
+      pvs->ucp_enable = (1 << num_written_clipdistance) - 1;
+   }
+
+   if (clip_user) {
       pvs->flags |= DO_CLIP_USER;
 
+      /* Test against the written clip distances instead of clipvertex
+       * dot plane.
+       */
+      if (num_written_clipdistance &&
+          (pvs->cd[0] != pvs->pos || pvs->cd[1] != pvs->pos))
+         pvs->flags |= DO_CLIP_DIST;
+   }
+
    if (!bypass_viewport)
       pvs->flags |= DO_VIEWPORT;
 
    if (need_edgeflags)
       pvs->flags |= DO_EDGEFLAG;
 
+   if (draw_current_shader_uses_viewport_index(draw))
+      pvs->flags |= DO_VIEWPORT_INDEX;
+
    /* Now select the relevant function:
     */
    switch (pvs->flags) {
@@ -209,7 +292,48 @@ void draw_pt_post_vs_prepare( struct pt_post_vs *pvs,
          DO_VIEWPORT | DO_EDGEFLAG):
       pvs->run = do_cliptest_xy_fullz_user_viewport_edgeflag;
       break;
-      
+
+   case DO_CLIP_XY | DO_CLIP_FULL_Z | DO_VIEWPORT | DO_EDGEFLAG:
+      pvs->run = do_cliptest_xy_fullz_viewport_edgeflag;
+      break;
+
+   case DO_CLIP_XY | DO_CLIP_HALF_Z | DO_CLIP_USER | DO_VIEWPORT:
+      pvs->run = do_cliptest_xy_halfz_user_viewport;
+      break;
+
+   case DO_CLIP_XY_GUARD_BAND | DO_CLIP_HALF_Z | DO_CLIP_USER | DO_VIEWPORT:
+      pvs->run = do_cliptest_xy_gb_halfz_user_viewport;
+      break;
+
+   case DO_CLIP_XY | DO_CLIP_FULL_Z | DO_CLIP_USER | DO_CLIP_DIST | DO_VIEWPORT:
+      pvs->run = do_cliptest_xy_fullz_clipdist_viewport;
+      break;
+
+   case DO_CLIP_XY | DO_CLIP_HALF_Z | DO_CLIP_USER | DO_CLIP_DIST | DO_VIEWPORT:
+      pvs->run = do_cliptest_xy_halfz_clipdist_viewport;
+      break;
+
+   case (DO_CLIP_XY_GUARD_BAND | DO_CLIP_HALF_Z | DO_CLIP_USER |
+         DO_CLIP_DIST | DO_VIEWPORT):
+      pvs->run = do_cliptest_xy_gb_halfz_clipdist_viewport;
+      break;
+
+   case DO_CLIP_XY | DO_CLIP_FULL_Z | DO_VIEWPORT | DO_VIEWPORT_INDEX:
+      pvs->run = do_cliptest_xy_fullz_viewport_vpindex;
+      break;
+
+   case DO_CLIP_XY | DO_CLIP_HALF_Z | DO_VIEWPORT | DO_VIEWPORT_INDEX:
+      pvs->run = do_cliptest_xy_halfz_viewport_vpindex;
+      break;
+
+   case DO_CLIP_XY | DO_CLIP_FULL_Z:
+      pvs->run = do_cliptest_xy_fullz;
+      break;
+
+   case DO_CLIP_XY | DO_CLIP_HALF_Z:
+      pvs->run = do_cliptest_xy_halfz;
+      break;
+
    default:
       pvs->run = do_cliptest_generic;
       break;
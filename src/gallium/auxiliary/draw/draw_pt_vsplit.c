@@ -23,6 +23,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 
@@ -31,7 +32,14 @@
 #include "draw/draw_pt.h"
 
 #define SEGMENT_SIZE 1024
-#define MAP_SIZE     256
+
+/*
+ * The fetch cache is two-way set associative with LRU replacement, so
+ * that indices which are MAP_SETS apart (e.g. consecutive rows of a
+ * 256 wide grid) don't keep evicting each other.
+ */
+#define MAP_SETS     256
+#define MAP_WAYS     2
 
 /* The largest possible index withing an index buffer */
 #define MAX_ELT_IDX 0xffffffff
@@ -54,20 +62,29 @@ struct vsplit_frontend {
 
    struct {
       /* map a fetch element to a draw element */
-      unsigned fetches[MAP_SIZE];
-      ushort draws[MAP_SIZE];
+      unsigned fetches[MAP_SETS][MAP_WAYS];
+      ushort draws[MAP_SETS][MAP_WAYS];
+      ubyte lru[MAP_SETS];  /**< way to replace next in each set */
       boolean has_max_fetch;
 
       ushort num_fetch_elts;
       ushort num_draw_elts;
    } cache;
+
+   /* totals for DRAW_VSPLIT_STATS */
+   uint64_t total_fetch_elts;
+   uint64_t total_draw_elts;
 };
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(draw_vsplit_stats, "DRAW_VSPLIT_STATS", FALSE)
+
+
 static void
 vsplit_clear_cache(struct vsplit_frontend *vsplit)
 {
    memset(vsplit->cache.fetches, 0xff, sizeof(vsplit->cache.fetches));
+   memset(vsplit->cache.lru, 0, sizeof(vsplit->cache.lru));
    vsplit->cache.has_max_fetch = FALSE;
    vsplit->cache.num_fetch_elts = 0;
    vsplit->cache.num_draw_elts = 0;
@@ -76,6 +93,9 @@ vsplit_clear_cache(struct vsplit_frontend *vsplit)
 static void
 vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 {
+   vsplit->total_fetch_elts += vsplit->cache.num_fetch_elts;
+   vsplit->total_draw_elts += vsplit->cache.num_draw_elts;
+
    vsplit->middle->run(vsplit->middle,
          vsplit->fetch_elts, vsplit->cache.num_fetch_elts,
          vsplit->draw_elts, vsplit->cache.num_draw_elts, flags);
@@ -87,23 +107,31 @@ vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 static inline void
 vsplit_add_cache(struct vsplit_frontend *vsplit, unsigned fetch, unsigned ofbias)
 {
-   unsigned hash;
-
-   hash = fetch % MAP_SIZE;
+   const unsigned set = fetch % MAP_SETS;
+   unsigned way;
 
    /* If the value isn't in the cache or it's an overflow due to the
     * element bias */
-   if (vsplit->cache.fetches[hash] != fetch || ofbias) {
+   if (vsplit->cache.fetches[set][0] == fetch && !ofbias) {
+      way = 0;
+   }
+   else if (vsplit->cache.fetches[set][1] == fetch && !ofbias) {
+      way = 1;
+   }
+   else {
       /* update cache */
-      vsplit->cache.fetches[hash] = fetch;
-      vsplit->cache.draws[hash] = vsplit->cache.num_fetch_elts;
+      way = vsplit->cache.lru[set];
+      vsplit->cache.fetches[set][way] = fetch;
+      vsplit->cache.draws[set][way] = vsplit->cache.num_fetch_elts;
 
       /* add fetch */
       assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
       vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
    }
+   vsplit->cache.lru[set] = !way;
 
-   vsplit->draw_elts[vsplit->cache.num_draw_elts++] = vsplit->cache.draws[hash];
+   vsplit->draw_elts[vsplit->cache.num_draw_elts++] =
+      vsplit->cache.draws[set][way];
 }
 
 /**
@@ -203,8 +231,10 @@ vsplit_add_cache_uint(struct vsplit_frontend *vsplit, const uint *elts,
 
    /* special care for DRAW_MAX_FETCH_IDX */
    if (raw_elem_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = fetch % MAP_SIZE;
-      vsplit->cache.fetches[hash] = raw_elem_idx - 1; /* force update */
+      unsigned set = fetch % MAP_SETS;
+      /* force update */
+      vsplit->cache.fetches[set][0] = raw_elem_idx - 1;
+      vsplit->cache.fetches[set][1] = raw_elem_idx - 1;
       vsplit->cache.has_max_fetch = TRUE;
    }
 
@@ -279,6 +309,17 @@ static void vsplit_flush(struct draw_pt_front_end *frontend, unsigned flags)
 
 static void vsplit_destroy(struct draw_pt_front_end *frontend)
 {
+   struct vsplit_frontend *vsplit = (struct vsplit_frontend *) frontend;
+
+   if (debug_get_option_draw_vsplit_stats() && vsplit->total_draw_elts) {
+      debug_printf("draw vsplit: %llu vertices fetched for %llu elements"
+                   " (%.1f%% reused)\n",
+                   (unsigned long long) vsplit->total_fetch_elts,
+                   (unsigned long long) vsplit->total_draw_elts,
+                   100.0 * (1.0 - (double) vsplit->total_fetch_elts /
+                            vsplit->total_draw_elts));
+   }
+
    FREE(frontend);
 }
 
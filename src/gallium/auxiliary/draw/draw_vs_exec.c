@@ -47,6 +47,7 @@
 struct exec_vertex_shader {
    struct draw_vertex_shader base;
    struct tgsi_exec_machine *machine;
+   struct tgsi_decoded_shader *decoded;  /**< decoded base.state.tokens */
 };
 
 static struct exec_vertex_shader *exec_vertex_shader( struct draw_vertex_shader *vs )
@@ -68,9 +69,9 @@ vs_exec_prepare( struct draw_vertex_shader *shader,
     * Avoid rebinding when possible.
     */
    if (evs->machine->Tokens != shader->state.tokens) {
-      tgsi_exec_machine_bind_shader(evs->machine,
-                                    shader->state.tokens,
-                                    draw->vs.tgsi.sampler);
+      tgsi_exec_machine_bind_decoded(evs->machine,
+                                     evs->decoded,
+                                     draw->vs.tgsi.sampler);
    }
 }
 
@@ -208,6 +209,14 @@ vs_exec_run_linear( struct draw_vertex_shader *shader,
 static void
 vs_exec_delete( struct draw_vertex_shader *dvs )
 {
+   struct exec_vertex_shader *evs = exec_vertex_shader(dvs);
+
+   /* the machine references the decoded shader */
+   if (evs->machine->Tokens == dvs->state.tokens) {
+      tgsi_exec_machine_bind_shader(evs->machine, NULL, NULL);
+   }
+
+   tgsi_free_decoded_shader(evs->decoded);
    FREE((void*) dvs->state.tokens);
    FREE( dvs );
 }
@@ -229,6 +238,13 @@ draw_create_vs_exec(struct draw_context *draw,
       return NULL;
    }
 
+   vs->decoded = tgsi_decode_shader(vs->base.state.tokens);
+   if (!vs->decoded) {
+      FREE((void *) vs->base.state.tokens);
+      FREE(vs);
+      return NULL;
+   }
+
    tgsi_scan_shader(state->tokens, &vs->base.info);
 
    vs->base.state.stream_output = state->stream_output;
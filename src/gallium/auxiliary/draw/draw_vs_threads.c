@@ -0,0 +1,181 @@
+/**************************************************************************
+ *
+ * Copyright 2016 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "os/os_thread.h"
+
+#include "draw_vs_threads.h"
+
+
+struct draw_vs_worker {
+   struct draw_vs_threads *pool;
+   unsigned shard;
+   pipe_thread thread;
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+};
+
+struct draw_vs_threads {
+   /** Number of threads taking part in a run, including the caller */
+   unsigned num_threads;
+   boolean exit_flag;
+
+   /** The current job, set before waking the workers */
+   draw_vs_shard_func func;
+   void *data;
+
+   struct draw_vs_worker workers[DRAW_VS_MAX_THREADS - 1];
+};
+
+
+static PIPE_THREAD_ROUTINE(draw_vs_thread_function, init_data)
+{
+   struct draw_vs_worker *worker = (struct draw_vs_worker *) init_data;
+   struct draw_vs_threads *pool = worker->pool;
+   char thread_name[16];
+
+   util_snprintf(thread_name, sizeof thread_name, "draw-vs-%u",
+                 worker->shard);
+   pipe_thread_setname(thread_name);
+
+   while (1) {
+      pipe_semaphore_wait(&worker->work_ready);
+
+      if (pool->exit_flag)
+         break;
+
+      pool->func(pool->data, worker->shard);
+
+      pipe_semaphore_signal(&worker->work_done);
+   }
+
+   return 0;
+}
+
+
+/**
+ * Create the pool, sized by DRAW_VS_THREADS (the number of cores by
+ * default).  Returns NULL if that leaves no thread besides the caller, in
+ * which case vertex shading stays on the calling thread.
+ */
+struct draw_vs_threads *
+draw_vs_threads_create(void)
+{
+   struct draw_vs_threads *pool;
+   unsigned num_threads;
+   unsigned i;
+
+   num_threads = debug_get_num_option("DRAW_VS_THREADS",
+                                      util_cpu_caps.nr_cpus);
+   num_threads = MIN2(num_threads, DRAW_VS_MAX_THREADS);
+   if (num_threads <= 1)
+      return NULL;
+
+   pool = CALLOC_STRUCT(draw_vs_threads);
+   if (!pool)
+      return NULL;
+
+   pool->num_threads = num_threads;
+
+   for (i = 0; i < num_threads - 1; i++) {
+      struct draw_vs_worker *worker = &pool->workers[i];
+
+      worker->pool = pool;
+      worker->shard = i + 1;
+      pipe_semaphore_init(&worker->work_ready, 0);
+      pipe_semaphore_init(&worker->work_done, 0);
+      worker->thread = pipe_thread_create(draw_vs_thread_function, worker);
+   }
+
+   return pool;
+}
+
+
+void
+draw_vs_threads_destroy(struct draw_vs_threads *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   pool->exit_flag = TRUE;
+   for (i = 0; i < pool->num_threads - 1; i++)
+      pipe_semaphore_signal(&pool->workers[i].work_ready);
+
+   for (i = 0; i < pool->num_threads - 1; i++) {
+      pipe_thread_wait(pool->workers[i].thread);
+      pipe_semaphore_destroy(&pool->workers[i].work_ready);
+      pipe_semaphore_destroy(&pool->workers[i].work_done);
+   }
+
+   FREE(pool);
+}
+
+
+unsigned
+draw_vs_threads_count(const struct draw_vs_threads *pool)
+{
+   return pool ? pool->num_threads : 1;
+}
+
+
+/**
+ * Call func(data, shard) for every shard in [0, num_shards), shard 0 on
+ * the calling thread, and return once all of them are done.
+ */
+void
+draw_vs_threads_run(struct draw_vs_threads *pool,
+                    unsigned num_shards,
+                    draw_vs_shard_func func,
+                    void *data)
+{
+   unsigned i;
+
+   assert(num_shards <= draw_vs_threads_count(pool));
+
+   if (num_shards <= 1) {
+      if (num_shards)
+         func(data, 0);
+      return;
+   }
+
+   pool->func = func;
+   pool->data = data;
+
+   for (i = 1; i < num_shards; i++)
+      pipe_semaphore_signal(&pool->workers[i - 1].work_ready);
+
+   func(data, 0);
+
+   for (i = 1; i < num_shards; i++)
+      pipe_semaphore_wait(&pool->workers[i - 1].work_done);
+}
@@ -0,0 +1,61 @@
+/**************************************************************************
+ *
+ * Copyright 2016 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * A small pool of worker threads for splitting the vertex shader of a
+ * single vertex chunk across several cores.  The caller runs one shard
+ * itself and blocks until the workers are done with theirs, so the rest
+ * of the pipeline still sees the vertices in order and on one thread.
+ */
+
+#ifndef DRAW_VS_THREADS_H
+#define DRAW_VS_THREADS_H
+
+#include "pipe/p_compiler.h"
+
+#define DRAW_VS_MAX_THREADS 8
+
+struct draw_vs_threads;
+
+typedef void (*draw_vs_shard_func)(void *data, unsigned shard);
+
+struct draw_vs_threads *
+draw_vs_threads_create(void);
+
+void
+draw_vs_threads_destroy(struct draw_vs_threads *pool);
+
+unsigned
+draw_vs_threads_count(const struct draw_vs_threads *pool);
+
+void
+draw_vs_threads_run(struct draw_vs_threads *pool,
+                    unsigned num_shards,
+                    draw_vs_shard_func func,
+                    void *data);
+
+#endif /* DRAW_VS_THREADS_H */
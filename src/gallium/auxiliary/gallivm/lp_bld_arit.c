@@ -80,6 +80,13 @@
 
 #define LOG_POLY_DEGREE 4
 
+/*
+ * With gallivm_state::fast_math the exp2/log2 polynomials are of degree 3,
+ * giving roughly 15 instead of 22 bits of precision, rcp and rsqrt use the
+ * ~12 bit hardware approximations without refinement, and sin/cos do the
+ * range reduction in a single step.
+ */
+
 
 /**
  * Generate min(a, b)
@@ -2490,8 +2497,9 @@ lp_build_rcp(struct lp_build_context *bld,
     * particular uses that require less workarounds.
     */
 
-   if (FALSE && ((util_cpu_caps.has_sse && type.width == 32 && type.length == 4) ||
-         (util_cpu_caps.has_avx && type.width == 32 && type.length == 8))){
+   if (bld->gallivm->fast_math &&
+       ((util_cpu_caps.has_sse && type.width == 32 && type.length == 4) ||
+        (util_cpu_caps.has_avx && type.width == 32 && type.length == 8))) {
       const unsigned num_iterations = 0;
       LLVMValueRef res;
       unsigned i;
@@ -2561,8 +2569,8 @@ lp_build_rsqrt(struct lp_build_context *bld,
    /*
     * This should be faster but all denormals will end up as infinity.
     */
-   if (0 && lp_build_fast_rsqrt_available(type)) {
-      const unsigned num_iterations = 1;
+   if (bld->gallivm->fast_math && lp_build_fast_rsqrt_available(type)) {
+      const unsigned num_iterations = 0;
       LLVMValueRef res;
       unsigned i;
 
@@ -2752,30 +2760,38 @@ lp_build_sin_or_cos(struct lp_build_context *bld,
     * _PS_CONST(minus_cephes_DP2, -2.4187564849853515625e-4);
     * _PS_CONST(minus_cephes_DP3, -3.77489497744594108e-8);
     */
-   LLVMValueRef DP1 = lp_build_const_vec(gallivm, bld->type, -0.78515625);
-   LLVMValueRef DP2 = lp_build_const_vec(gallivm, bld->type, -2.4187564849853515625e-4);
-   LLVMValueRef DP3 = lp_build_const_vec(gallivm, bld->type, -3.77489497744594108e-8);
+   LLVMValueRef x_3;
 
-   /*
-    * The magic pass: "Extended precision modular arithmetic"
-    * x = ((x - y * DP1) - y * DP2) - y * DP3;
-    * xmm1 = _mm_mul_ps(y, xmm1);
-    * xmm2 = _mm_mul_ps(y, xmm2);
-    * xmm3 = _mm_mul_ps(y, xmm3);
-    */
-   LLVMValueRef xmm1 = LLVMBuildFMul(b, y_2, DP1, "xmm1");
-   LLVMValueRef xmm2 = LLVMBuildFMul(b, y_2, DP2, "xmm2");
-   LLVMValueRef xmm3 = LLVMBuildFMul(b, y_2, DP3, "xmm3");
+   if (gallivm->fast_math) {
+      /* x = x - y * Pi/4, which loses precision for large x */
+      LLVMValueRef DP = lp_build_const_vec(gallivm, bld->type, -0.785398163397448);
+      x_3 = LLVMBuildFAdd(b, x_abs, LLVMBuildFMul(b, y_2, DP, ""), "x_3");
+   } else {
+      LLVMValueRef DP1 = lp_build_const_vec(gallivm, bld->type, -0.78515625);
+      LLVMValueRef DP2 = lp_build_const_vec(gallivm, bld->type, -2.4187564849853515625e-4);
+      LLVMValueRef DP3 = lp_build_const_vec(gallivm, bld->type, -3.77489497744594108e-8);
 
-   /*
-    * x = _mm_add_ps(x, xmm1);
-    * x = _mm_add_ps(x, xmm2);
-    * x = _mm_add_ps(x, xmm3);
-    */
+      /*
+       * The magic pass: "Extended precision modular arithmetic"
+       * x = ((x - y * DP1) - y * DP2) - y * DP3;
+       * xmm1 = _mm_mul_ps(y, xmm1);
+       * xmm2 = _mm_mul_ps(y, xmm2);
+       * xmm3 = _mm_mul_ps(y, xmm3);
+       */
+      LLVMValueRef xmm1 = LLVMBuildFMul(b, y_2, DP1, "xmm1");
+      LLVMValueRef xmm2 = LLVMBuildFMul(b, y_2, DP2, "xmm2");
+      LLVMValueRef xmm3 = LLVMBuildFMul(b, y_2, DP3, "xmm3");
+
+      /*
+       * x = _mm_add_ps(x, xmm1);
+       * x = _mm_add_ps(x, xmm2);
+       * x = _mm_add_ps(x, xmm3);
+       */
 
-   LLVMValueRef x_1 = LLVMBuildFAdd(b, x_abs, xmm1, "x_1");
-   LLVMValueRef x_2 = LLVMBuildFAdd(b, x_1, xmm2, "x_2");
-   LLVMValueRef x_3 = LLVMBuildFAdd(b, x_2, xmm3, "x_3");
+      LLVMValueRef x_1 = LLVMBuildFAdd(b, x_abs, xmm1, "x_1");
+      LLVMValueRef x_2 = LLVMBuildFAdd(b, x_1, xmm2, "x_2");
+      x_3 = LLVMBuildFAdd(b, x_2, xmm3, "x_3");
+   }
 
    /*
     * Evaluate the first polynom  (0 <= x <= Pi/4)
@@ -3063,6 +3079,17 @@ const double lp_build_exp2_polynomial[] = {
 };
 
 
+/**
+ * Degree 3 fit of 2**x, in range [0, 1[, for gallivm_state::fast_math
+ */
+static const double lp_build_exp2_polynomial_fast[] = {
+   0.999925218562710312959,
+   0.695833540494823811697,
+   0.226067155427249155588,
+   0.0780245226406372992967
+};
+
+
 LLVMValueRef
 lp_build_exp2(struct lp_build_context *bld,
               LLVMValueRef x)
@@ -3105,8 +3132,12 @@ lp_build_exp2(struct lp_build_context *bld,
                            lp_build_const_int_vec(bld->gallivm, type, 23), "");
    expipart = LLVMBuildBitCast(builder, expipart, vec_type, "");
 
-   expfpart = lp_build_polynomial(bld, fpart, lp_build_exp2_polynomial,
-                                  Elements(lp_build_exp2_polynomial));
+   if (bld->gallivm->fast_math)
+      expfpart = lp_build_polynomial(bld, fpart, lp_build_exp2_polynomial_fast,
+                                     Elements(lp_build_exp2_polynomial_fast));
+   else
+      expfpart = lp_build_polynomial(bld, fpart, lp_build_exp2_polynomial,
+                                     Elements(lp_build_exp2_polynomial));
 
    res = LLVMBuildFMul(builder, expipart, expfpart, "");
 
@@ -3215,6 +3246,16 @@ const double lp_build_log2_polynomial[] = {
 #endif
 };
 
+/**
+ * Degree 3 fit of the above, for gallivm_state::fast_math
+ */
+static const double lp_build_log2_polynomial_fast[] = {
+   2.88538959748872753838L,
+   0.961932915889597772928L,
+   0.571118517972136195241L,
+   0.493997535084709500285L,
+};
+
 /**
  * See http://www.devmaster.net/forums/showthread.php?p=43580
  * http://en.wikipedia.org/wiki/Logarithm#Calculation
@@ -3303,8 +3344,12 @@ lp_build_log2_approx(struct lp_build_context *bld,
       z = lp_build_mul(bld, y, y);
 
       /* compute P(z) */
-      logmant = lp_build_polynomial(bld, z, lp_build_log2_polynomial,
-                                    Elements(lp_build_log2_polynomial));
+      if (bld->gallivm->fast_math)
+         logmant = lp_build_polynomial(bld, z, lp_build_log2_polynomial_fast,
+                                       Elements(lp_build_log2_polynomial_fast));
+      else
+         logmant = lp_build_polynomial(bld, z, lp_build_log2_polynomial,
+                                       Elements(lp_build_log2_polynomial));
 
       /* logmant = y * P(z) */
       logmant = lp_build_mul(bld, y, logmant);
@@ -44,7 +44,6 @@ struct lp_type;
 struct lp_build_context;
 
 
-#define LP_BUILD_FORMAT_CACHE_DEBUG 0
 /*
  * Block cache
  *
@@ -61,20 +60,17 @@ struct lp_build_format_cache
 {
    PIPE_ALIGN_VAR(16) uint32_t cache_data[LP_BUILD_FORMAT_CACHE_SIZE][4][4];
    uint64_t cache_tags[LP_BUILD_FORMAT_CACHE_SIZE];
-#if LP_BUILD_FORMAT_CACHE_DEBUG
+   /* statistics, counted by the generated code */
    uint64_t cache_access_total;
    uint64_t cache_access_miss;
-#endif
 };
 
 
 enum {
    LP_BUILD_FORMAT_CACHE_MEMBER_DATA = 0,
    LP_BUILD_FORMAT_CACHE_MEMBER_TAGS,
-#if LP_BUILD_FORMAT_CACHE_DEBUG
    LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_TOTAL,
    LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS,
-#endif
    LP_BUILD_FORMAT_CACHE_MEMBER_COUNT
 };
 
@@ -164,6 +160,9 @@ lp_build_fetch_subsampled_rgba_aos(struct gallivm_state *gallivm,
                                    LLVMValueRef j);
 
 
+boolean
+lp_build_format_cacheable(const struct util_format_description *format_desc);
+
 LLVMValueRef
 lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
                              const struct util_format_description *format_desc,
@@ -32,6 +32,7 @@
 #include "lp_bld_flow.h"
 #include "lp_bld_swizzle.h"
 
+#include "util/u_format.h"
 #include "util/u_math.h"
 
 
@@ -43,7 +44,7 @@
  * a small cache helps.
  * The elements in the cache are the decoded blocks - currently things
  * are restricted to formats which are 4x4 block based, and the decoded
- * texels must fit into 4x8 bits.
+ * texels must fit into 4x8 bits, see lp_build_format_cacheable().
  * The cache is direct mapped so hitrates aren't all that great and cache
  * thrashing could happen.
  *
@@ -51,7 +52,6 @@
  */
 
 
-#if LP_BUILD_FORMAT_CACHE_DEBUG
 static void
 update_cache_access(struct gallivm_state *gallivm,
                     LLVMValueRef ptr,
@@ -71,40 +71,6 @@ update_cache_access(struct gallivm_state *gallivm,
                                                                    count, 0), "");
    LLVMBuildStore(builder, cache_access, member_ptr);
 }
-#endif
-
-
-static void
-store_cached_block(struct gallivm_state *gallivm,
-                   LLVMValueRef *col,
-                   LLVMValueRef tag_value,
-                   LLVMValueRef hash_index,
-                   LLVMValueRef cache)
-{
-   LLVMBuilderRef builder = gallivm->builder;
-   LLVMValueRef ptr, indices[3];
-   LLVMTypeRef type_ptr4x32;
-   unsigned count;
-
-   type_ptr4x32 = LLVMPointerType(LLVMVectorType(LLVMInt32TypeInContext(gallivm->context), 4), 0);
-   indices[0] = lp_build_const_int32(gallivm, 0);
-   indices[1] = lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_MEMBER_TAGS);
-   indices[2] = hash_index;
-   ptr = LLVMBuildGEP(builder, cache, indices, Elements(indices), "");
-   LLVMBuildStore(builder, tag_value, ptr);
-
-   indices[1] = lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_MEMBER_DATA);
-   hash_index = LLVMBuildMul(builder, hash_index,
-                             lp_build_const_int32(gallivm, 16), "");
-   for (count = 0; count < 4; count++) {
-      indices[2] = hash_index;
-      ptr = LLVMBuildGEP(builder, cache, indices, Elements(indices), "");
-      ptr = LLVMBuildBitCast(builder, ptr, type_ptr4x32, "");
-      LLVMBuildStore(builder, col[count], ptr);
-      hash_index = LLVMBuildAdd(builder, hash_index,
-                                lp_build_const_int32(gallivm, 4), "");
-   }
-}
 
 
 static LLVMValueRef
@@ -151,41 +117,41 @@ update_cached_block(struct gallivm_state *gallivm,
    LLVMTypeRef i8t = LLVMInt8TypeInContext(gallivm->context);
    LLVMTypeRef pi8t = LLVMPointerType(i8t, 0);
    LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
-   LLVMTypeRef i32x4 = LLVMVectorType(LLVMInt32TypeInContext(gallivm->context), 4);
    LLVMValueRef function;
-   LLVMValueRef tag_value, tmp_ptr;
-   LLVMValueRef col[4];
-   unsigned i, j;
+   LLVMValueRef tag_value, dst_ptr, indices[3];
+   LLVMValueRef args[6];
 
    /*
-    * Use format_desc->fetch_rgba_8unorm() for each pixel in the block.
-    * This doesn't actually make any sense whatsoever, someone would need
-    * to write a function doing this for all pixels in a block (either as
-    * an external c function or with generated code). Don't ask.
+    * Decode the whole block with a single call to
+    * format_desc->unpack_rgba_8unorm(), straight into the cache line.
     */
 
    {
       /*
        * Function to call looks like:
-       *   fetch(uint8_t *dst, const uint8_t *src, unsigned i, unsigned j)
+       *   unpack(uint8_t *dst, unsigned dst_stride,
+       *          const uint8_t *src, unsigned src_stride,
+       *          unsigned width, unsigned height)
        */
       LLVMTypeRef ret_type;
-      LLVMTypeRef arg_types[4];
+      LLVMTypeRef arg_types[6];
       LLVMTypeRef function_type;
 
-      assert(format_desc->fetch_rgba_8unorm);
+      assert(format_desc->unpack_rgba_8unorm);
 
       ret_type = LLVMVoidTypeInContext(gallivm->context);
       arg_types[0] = pi8t;
-      arg_types[1] = pi8t;
-      arg_types[2] = i32t;
+      arg_types[1] = i32t;
+      arg_types[2] = pi8t;
       arg_types[3] = i32t;
+      arg_types[4] = i32t;
+      arg_types[5] = i32t;
       function_type = LLVMFunctionType(ret_type, arg_types,
                                        Elements(arg_types), 0);
 
-      /* make const pointer for the C fetch_rgba_8unorm function */
+      /* make const pointer for the C unpack_rgba_8unorm function */
       function = lp_build_const_int_pointer(gallivm,
-         func_to_pointer((func_pointer) format_desc->fetch_rgba_8unorm));
+         func_to_pointer((func_pointer) format_desc->unpack_rgba_8unorm));
 
       /* cast the callee pointer to the function's type */
       function = LLVMBuildBitCast(builder, function,
@@ -193,45 +159,68 @@ update_cached_block(struct gallivm_state *gallivm,
                                   "cast callee");
    }
 
-   tmp_ptr = lp_build_array_alloca(gallivm, i32x4,
-                                   lp_build_const_int32(gallivm, 16),
-                                   "tmp_decode_store");
-   tmp_ptr = LLVMBuildBitCast(builder, tmp_ptr, pi8t, "");
+   /*
+    * The block is stored row by row, i.e. x0y0 x1y0 x2y0 x3y0 x0y1 ...
+    */
+   indices[0] = lp_build_const_int32(gallivm, 0);
+   indices[1] = lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_MEMBER_DATA);
+   indices[2] = LLVMBuildMul(builder, hash_index,
+                             lp_build_const_int32(gallivm, 16), "");
+   dst_ptr = LLVMBuildGEP(builder, cache, indices, Elements(indices), "");
+   dst_ptr = LLVMBuildBitCast(builder, dst_ptr, pi8t, "");
 
    /*
-    * Invoke format_desc->fetch_rgba_8unorm() for each pixel.
-    * This is going to be really really slow.
-    * Note: the block store format is actually
-    * x0y0x0y1x0y2x0y3 x1y0x1y1x1y2x1y3 ...
+    * Note we actually supply a pointer to the start of the block,
+    * not the start of the texture. The block is a single block row so
+    * the source stride doesn't matter.
     */
-   for (i = 0; i < 4; ++i) {
-      for (j = 0; j < 4; ++j) {
-         LLVMValueRef args[4];
-         LLVMValueRef dst_offset = lp_build_const_int32(gallivm, (i * 4 + j) * 4);
-
-         /*
-          * Note we actually supply a pointer to the start of the block,
-          * not the start of the texture.
-          */
-         args[0] = LLVMBuildGEP(gallivm->builder, tmp_ptr, &dst_offset, 1, "");
-         args[1] = ptr_addr;
-         args[2] = LLVMConstInt(i32t, i, 0);
-         args[3] = LLVMConstInt(i32t, j, 0);
-         LLVMBuildCall(builder, function, args, Elements(args), "");
-      }
-   }
+   args[0] = dst_ptr;
+   args[1] = lp_build_const_int32(gallivm, 4 * 4);
+   args[2] = ptr_addr;
+   args[3] = lp_build_const_int32(gallivm, format_desc->block.bits / 8);
+   args[4] = lp_build_const_int32(gallivm, 4);
+   args[5] = lp_build_const_int32(gallivm, 4);
+   LLVMBuildCall(builder, function, args, Elements(args), "");
+
+   /* Update the tag */
+   tag_value = LLVMBuildPtrToInt(gallivm->builder, ptr_addr,
+                                 LLVMInt64TypeInContext(gallivm->context), "");
+   indices[1] = lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_MEMBER_TAGS);
+   indices[2] = hash_index;
+   LLVMBuildStore(builder, tag_value,
+                  LLVMBuildGEP(builder, cache, indices, Elements(indices), ""));
+}
+
 
-   /* Finally store the block - pointless mem copy + update tag. */
-   tmp_ptr = LLVMBuildBitCast(builder, tmp_ptr, LLVMPointerType(i32x4, 0), "");
-   for (i = 0; i < 4; ++i) {
-      LLVMValueRef tmp_offset = lp_build_const_int32(gallivm, i);
-      LLVMValueRef ptr = LLVMBuildGEP(gallivm->builder, tmp_ptr, &tmp_offset, 1, "");
-      col[i] = LLVMBuildLoad(builder, ptr, "");
+/**
+ * Whether lp_build_fetch_cached_texels() can be used for the format.
+ * These are the 4x4 block compressed formats which decode to unorm8
+ * without loss. sRGB formats qualify through their linear counterparts.
+ */
+boolean
+lp_build_format_cacheable(const struct util_format_description *format_desc)
+{
+   if (format_desc->block.width != 4 ||
+       format_desc->block.height != 4 ||
+       format_desc->colorspace == UTIL_FORMAT_COLORSPACE_SRGB ||
+       !format_desc->unpack_rgba_8unorm) {
+      return FALSE;
    }
 
-   tag_value = LLVMBuildPtrToInt(gallivm->builder, ptr_addr,
-                                 LLVMInt64TypeInContext(gallivm->context), "");
-   store_cached_block(gallivm, col, tag_value, hash_index, cache);
+   switch (format_desc->layout) {
+   case UTIL_FORMAT_LAYOUT_S3TC:
+   case UTIL_FORMAT_LAYOUT_RGTC:
+   case UTIL_FORMAT_LAYOUT_BPTC:
+      return util_format_fits_8unorm(format_desc);
+   case UTIL_FORMAT_LAYOUT_ETC:
+      /* the EAC R11/RG11 formats have more than 8 bits of precision */
+      return format_desc->format == PIPE_FORMAT_ETC1_RGB8 ||
+             format_desc->format == PIPE_FORMAT_ETC2_RGB8 ||
+             format_desc->format == PIPE_FORMAT_ETC2_RGB8A1 ||
+             format_desc->format == PIPE_FORMAT_ETC2_RGBA8;
+   default:
+      return FALSE;
+   }
 }
 
 
@@ -302,8 +291,8 @@ lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
 
    hash_mask = lp_build_const_int_vec(gallivm, type, LP_BUILD_FORMAT_CACHE_SIZE - 1);
    hash_index = LLVMBuildAnd(builder, hash_index, hash_mask, "");
-   ij_index = LLVMBuildShl(builder, i, lp_build_const_int_vec(gallivm, type, 2), "");
-   ij_index = LLVMBuildAdd(builder, ij_index, j, "");
+   ij_index = LLVMBuildShl(builder, j, lp_build_const_int_vec(gallivm, type, 2), "");
+   ij_index = LLVMBuildAdd(builder, ij_index, i, "");
    block_index = LLVMBuildShl(builder, hash_index,
                               lp_build_const_int_vec(gallivm, type, 4), "");
    block_index = LLVMBuildAdd(builder, ij_index, block_index, "");
@@ -330,10 +319,8 @@ lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
             ptr_addrx = LLVMBuildIntToPtr(builder, addrx,
                                           LLVMPointerType(i8t, 0), "");
             update_cached_block(gallivm, format_desc, ptr_addrx, hash_indexx, cache);
-#if LP_BUILD_FORMAT_CACHE_DEBUG
             update_cache_access(gallivm, cache, 1,
                                 LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS);
-#endif
          }
          lp_build_endif(&if_ctx);
 
@@ -356,19 +343,15 @@ lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
       {
          tmp = LLVMBuildIntToPtr(builder, addr, LLVMPointerType(i8t, 0), "");
          update_cached_block(gallivm, format_desc, tmp, hash_index, cache);
-#if LP_BUILD_FORMAT_CACHE_DEBUG
          update_cache_access(gallivm, cache, 1,
                              LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS);
-#endif
       }
       lp_build_endif(&if_ctx);
 
       color = lookup_cached_pixel(gallivm, cache, block_index);
    }
-#if LP_BUILD_FORMAT_CACHE_DEBUG
    update_cache_access(gallivm, cache, n,
                        LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_TOTAL);
-#endif
    return LLVMBuildBitCast(builder, color, LLVMVectorType(i8t, n * 4), "");
 }
 
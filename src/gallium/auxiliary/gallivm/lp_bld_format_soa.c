@@ -40,6 +40,9 @@
 #include "lp_bld_debug.h"
 #include "lp_bld_format.h"
 #include "lp_bld_arit.h"
+#include "lp_bld_flow.h"
+#include "lp_bld_init.h"
+#include "lp_bld_library.h"
 
 
 void
@@ -331,6 +334,253 @@ lp_build_rgba8_to_fi32_soa(struct gallivm_state *gallivm,
 
 
 
+
+/**
+ * Fetch texels of formats with no vectorized SoA unpacking, by way of
+ * lp_build_fetch_rgba_aos().  See lp_build_fetch_rgba_soa() for the
+ * parameters.
+ */
+static void
+fetch_rgba_soa_generic(struct gallivm_state *gallivm,
+                       const struct util_format_description *format_desc,
+                       struct lp_type type,
+                       LLVMValueRef base_ptr,
+                       LLVMValueRef offset,
+                       LLVMValueRef i,
+                       LLVMValueRef j,
+                       LLVMValueRef cache,
+                       LLVMValueRef rgba_out[4])
+{
+   LLVMBuilderRef builder = gallivm->builder;
+
+   /*
+    * Try calling lp_build_fetch_rgba_aos for all pixels.
+    */
+
+   if (util_format_fits_8unorm(format_desc) &&
+       type.floating && type.width == 32 &&
+       (type.length == 1 || (type.length % 4 == 0))) {
+      struct lp_type tmp_type;
+      LLVMValueRef tmp;
+
+      memset(&tmp_type, 0, sizeof tmp_type);
+      tmp_type.width = 8;
+      tmp_type.length = type.length * 4;
+      tmp_type.norm = TRUE;
+
+      tmp = lp_build_fetch_rgba_aos(gallivm, format_desc, tmp_type,
+                                    TRUE, base_ptr, offset, i, j, cache);
+
+      lp_build_rgba8_to_fi32_soa(gallivm,
+                                type,
+                                tmp,
+                                rgba_out);
+
+      return;
+   }
+
+   /*
+    * Fallback to calling lp_build_fetch_rgba_aos for each pixel.
+    *
+    * This is not the most efficient way of fetching pixels, as we
+    * miss some opportunities to do vectorization, but this is
+    * convenient for formats or scenarios for which there was no
+    * opportunity or incentive to optimize.
+    */
+
+   {
+      unsigned k, chan;
+      struct lp_type tmp_type;
+
+      if (gallivm_debug & GALLIVM_DEBUG_PERF) {
+         debug_printf("%s: scalar unpacking of %s\n",
+                      __FUNCTION__, format_desc->short_name);
+      }
+
+      tmp_type = type;
+      tmp_type.length = 4;
+
+      for (chan = 0; chan < 4; ++chan) {
+         rgba_out[chan] = lp_build_undef(gallivm, type);
+      }
+
+      /* loop over number of pixels */
+      for(k = 0; k < type.length; ++k) {
+         LLVMValueRef index = lp_build_const_int32(gallivm, k);
+         LLVMValueRef offset_elem;
+         LLVMValueRef i_elem, j_elem;
+         LLVMValueRef tmp;
+
+         offset_elem = LLVMBuildExtractElement(builder, offset,
+                                               index, "");
+
+         i_elem = LLVMBuildExtractElement(builder, i, index, "");
+         j_elem = LLVMBuildExtractElement(builder, j, index, "");
+
+         /* Get a single float[4]={R,G,B,A} pixel */
+         tmp = lp_build_fetch_rgba_aos(gallivm, format_desc, tmp_type,
+                                       TRUE, base_ptr, offset_elem,
+                                       i_elem, j_elem, cache);
+
+         /*
+          * Insert the AoS tmp value channels into the SoA result vectors at
+          * position = 'index'.
+          */
+         for (chan = 0; chan < 4; ++chan) {
+            LLVMValueRef chan_val = lp_build_const_int32(gallivm, chan),
+            tmp_chan = LLVMBuildExtractElement(builder, tmp, chan_val, "");
+            rgba_out[chan] = LLVMBuildInsertElement(builder, rgba_out[chan],
+                                                    tmp_chan, index, "");
+         }
+      }
+   }
+}
+
+
+struct fetch_rgba_soa_key
+{
+   const struct util_format_description *format_desc;
+   struct lp_type type;
+};
+
+
+/**
+ * Prototype of the shared fetch functions:
+ *
+ *   void fetch(i8 *base_ptr, <n x i32> offset, <n x i32> i, <n x i32> j,
+ *              <n x T> rgba_out[4])
+ */
+static LLVMTypeRef
+fetch_rgba_soa_library_type(struct gallivm_state *gallivm, const void *data)
+{
+   const struct fetch_rgba_soa_key *key = data;
+   LLVMTypeRef int_vec_type = lp_build_int_vec_type(gallivm, key->type);
+   LLVMTypeRef arg_types[5];
+
+   arg_types[0] = LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+   arg_types[1] = int_vec_type;
+   arg_types[2] = int_vec_type;
+   arg_types[3] = int_vec_type;
+   arg_types[4] = LLVMPointerType(lp_build_vec_type(gallivm, key->type), 0);
+
+   return LLVMFunctionType(LLVMVoidTypeInContext(gallivm->context),
+                           arg_types, Elements(arg_types), 0);
+}
+
+
+static void
+fetch_rgba_soa_library_body(struct gallivm_state *gallivm,
+                            LLVMValueRef function,
+                            const void *data)
+{
+   const struct fetch_rgba_soa_key *key = data;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMBasicBlockRef block;
+   LLVMValueRef rgba[4];
+   LLVMValueRef out_ptr;
+   unsigned chan;
+
+   block = LLVMAppendBasicBlockInContext(gallivm->context, function, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   fetch_rgba_soa_generic(gallivm, key->format_desc, key->type,
+                          LLVMGetParam(function, 0),
+                          LLVMGetParam(function, 1),
+                          LLVMGetParam(function, 2),
+                          LLVMGetParam(function, 3),
+                          NULL, rgba);
+
+   out_ptr = LLVMGetParam(function, 4);
+   for (chan = 0; chan < 4; ++chan) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, chan);
+      LLVMBuildStore(builder, rgba[chan],
+                     LLVMBuildGEP(builder, out_ptr, &index, 1, ""));
+   }
+
+   LLVMBuildRetVoid(builder);
+}
+
+
+/**
+ * Call the shared library's copy of fetch_rgba_soa_generic() for this
+ * format and type.
+ * \return FALSE if there is none, and the code has to be generated inline.
+ */
+static boolean
+fetch_rgba_soa_library(struct gallivm_state *gallivm,
+                       const struct util_format_description *format_desc,
+                       struct lp_type type,
+                       LLVMValueRef base_ptr,
+                       LLVMValueRef offset,
+                       LLVMValueRef i,
+                       LLVMValueRef j,
+                       LLVMValueRef rgba_out[4])
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef int_vec_type;
+   struct fetch_rgba_soa_key key;
+   struct lp_library_function func;
+   char name[128];
+   LLVMValueRef function;
+   LLVMValueRef args[5];
+   LLVMValueRef out_ptr;
+   unsigned chan;
+
+   if (!lp_build_library_enabled() || type.width != 32 || !i || !j)
+      return FALSE;
+
+   /* the arguments have to match the prototype */
+   int_vec_type = lp_build_int_vec_type(gallivm, type);
+   if (LLVMTypeOf(offset) != int_vec_type ||
+       LLVMTypeOf(i) != int_vec_type ||
+       LLVMTypeOf(j) != int_vec_type ||
+       LLVMTypeOf(base_ptr) !=
+          LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0))
+      return FALSE;
+
+   memset(&key, 0, sizeof key);
+   key.format_desc = format_desc;
+   key.type = type;
+
+   util_snprintf(name, sizeof name, "fetch_rgba_soa_%s_%s%s%s%s%ux%u",
+                 format_desc->short_name,
+                 type.floating ? "f" : "",
+                 type.fixed ? "x" : "",
+                 type.sign ? "s" : "u",
+                 type.norm ? "n" : "",
+                 type.width, type.length);
+
+   func.name = name;
+   func.build_type = fetch_rgba_soa_library_type;
+   func.build_body = fetch_rgba_soa_library_body;
+   func.data = &key;
+
+   function = lp_build_library_function(gallivm, &func);
+   if (!function)
+      return FALSE;
+
+   out_ptr = lp_build_array_alloca(gallivm, lp_build_vec_type(gallivm, type),
+                                   lp_build_const_int32(gallivm, 4),
+                                   "rgba");
+
+   args[0] = base_ptr;
+   args[1] = offset;
+   args[2] = i;
+   args[3] = j;
+   args[4] = out_ptr;
+   LLVMBuildCall(builder, function, args, Elements(args), "");
+
+   for (chan = 0; chan < 4; ++chan) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, chan);
+      rgba_out[chan] = LLVMBuildLoad(builder,
+                                     LLVMBuildGEP(builder, out_ptr,
+                                                  &index, 1, ""), "");
+   }
+
+   return TRUE;
+}
+
+
 /**
  * Fetch a texels from a texture, returning them in SoA layout.
  *
@@ -460,117 +710,57 @@ lp_build_fetch_rgba_soa(struct gallivm_state *gallivm,
    }
 
    /*
-    * Try calling lp_build_fetch_rgba_aos for all pixels.
+    * Block compressed formats with a decoded block cache. sRGB ones are
+    * cached in their linear form and converted on unpack.
     */
 
-   if (util_format_fits_8unorm(format_desc) &&
+   if (cache &&
        type.floating && type.width == 32 &&
        (type.length == 1 || (type.length % 4 == 0))) {
-      struct lp_type tmp_type;
-      LLVMValueRef tmp;
-
-      memset(&tmp_type, 0, sizeof tmp_type);
-      tmp_type.width = 8;
-      tmp_type.length = type.length * 4;
-      tmp_type.norm = TRUE;
-
-      tmp = lp_build_fetch_rgba_aos(gallivm, format_desc, tmp_type,
-                                    TRUE, base_ptr, offset, i, j, cache);
-
-      lp_build_rgba8_to_fi32_soa(gallivm,
-                                type,
-                                tmp,
-                                rgba_out);
-
-      return;
-   }
-
-   if (format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC &&
-       /* non-srgb case is already handled above */
-       format_desc->colorspace == UTIL_FORMAT_COLORSPACE_SRGB &&
-       type.floating && type.width == 32 &&
-       (type.length == 1 || (type.length % 4 == 0)) &&
-       cache) {
-      const struct util_format_description *format_decompressed;
       const struct util_format_description *flinear_desc;
-      LLVMValueRef packed;
+
       flinear_desc = util_format_description(util_format_linear(format_desc->format));
-      packed = lp_build_fetch_cached_texels(gallivm,
-                                            flinear_desc,
-                                            type.length,
-                                            base_ptr,
-                                            offset,
-                                            i, j,
-                                            cache);
-      packed = LLVMBuildBitCast(builder, packed,
-                                lp_build_int_vec_type(gallivm, type), "");
-      /*
-       * The values are now packed so they match ordinary srgb RGBA8 format,
-       * hence need to use matching format for unpack.
-       */
-      format_decompressed = util_format_description(PIPE_FORMAT_R8G8B8A8_SRGB);
+      if (lp_build_format_cacheable(flinear_desc)) {
+         const struct util_format_description *format_decompressed;
+         LLVMValueRef packed;
+
+         packed = lp_build_fetch_cached_texels(gallivm,
+                                               flinear_desc,
+                                               type.length,
+                                               base_ptr,
+                                               offset,
+                                               i, j,
+                                               cache);
+         packed = LLVMBuildBitCast(builder, packed,
+                                   lp_build_int_vec_type(gallivm, type), "");
+         /*
+          * The values are now packed so they match ordinary RGBA8 formats,
+          * hence need to use matching format for unpack.
+          */
+         format_decompressed = util_format_description(
+            format_desc->colorspace == UTIL_FORMAT_COLORSPACE_SRGB ?
+            PIPE_FORMAT_R8G8B8A8_SRGB : PIPE_FORMAT_R8G8B8A8_UNORM);
 
-      lp_build_unpack_rgba_soa(gallivm,
-                               format_decompressed,
-                               type,
-                               packed, rgba_out);
+         lp_build_unpack_rgba_soa(gallivm,
+                                  format_decompressed,
+                                  type,
+                                  packed, rgba_out);
 
-      return;
+         return;
+      }
    }
 
    /*
-    * Fallback to calling lp_build_fetch_rgba_aos for each pixel.
-    *
-    * This is not the most efficient way of fetching pixels, as we
-    * miss some opportunities to do vectorization, but this is
-    * convenient for formats or scenarios for which there was no
-    * opportunity or incentive to optimize.
+    * The remaining paths generate a lot of code, so share one compiled
+    * copy between all the shaders fetching this format if possible.
     */
 
-   {
-      unsigned k, chan;
-      struct lp_type tmp_type;
-
-      if (gallivm_debug & GALLIVM_DEBUG_PERF) {
-         debug_printf("%s: scalar unpacking of %s\n",
-                      __FUNCTION__, format_desc->short_name);
-      }
-
-      tmp_type = type;
-      tmp_type.length = 4;
-
-      for (chan = 0; chan < 4; ++chan) {
-         rgba_out[chan] = lp_build_undef(gallivm, type);
-      }
-
-      /* loop over number of pixels */
-      for(k = 0; k < type.length; ++k) {
-         LLVMValueRef index = lp_build_const_int32(gallivm, k);
-         LLVMValueRef offset_elem;
-         LLVMValueRef i_elem, j_elem;
-         LLVMValueRef tmp;
-
-         offset_elem = LLVMBuildExtractElement(builder, offset,
-                                               index, "");
-
-         i_elem = LLVMBuildExtractElement(builder, i, index, "");
-         j_elem = LLVMBuildExtractElement(builder, j, index, "");
-
-         /* Get a single float[4]={R,G,B,A} pixel */
-         tmp = lp_build_fetch_rgba_aos(gallivm, format_desc, tmp_type,
-                                       TRUE, base_ptr, offset_elem,
-                                       i_elem, j_elem, cache);
-
-         /*
-          * Insert the AoS tmp value channels into the SoA result vectors at
-          * position = 'index'.
-          */
-         for (chan = 0; chan < 4; ++chan) {
-            LLVMValueRef chan_val = lp_build_const_int32(gallivm, chan),
-            tmp_chan = LLVMBuildExtractElement(builder, tmp, chan_val, "");
-            rgba_out[chan] = LLVMBuildInsertElement(builder, rgba_out[chan],
-                                                    tmp_chan, index, "");
-         }
-      }
+   if (!cache &&
+       fetch_rgba_soa_library(gallivm, format_desc, type,
+                              base_ptr, offset, i, j, rgba_out)) {
+      return;
    }
+
+   fetch_rgba_soa_generic(gallivm, format_desc, type,
+                          base_ptr, offset, i, j, cache, rgba_out);
 }
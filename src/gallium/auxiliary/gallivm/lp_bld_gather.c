@@ -27,12 +27,15 @@
 
 
 #include "util/u_debug.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_memory.h"
 #include "lp_bld_debug.h"
 #include "lp_bld_const.h"
 #include "lp_bld_format.h"
 #include "lp_bld_gather.h"
 #include "lp_bld_init.h"
 #include "lp_bld_intr.h"
+#include "lp_bld_type.h"
 
 
 /**
@@ -132,6 +135,37 @@ lp_build_gather_elem(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Gather 32-bit elements with the AVX2 gather instructions.
+ *
+ * @sa lp_build_gather()
+ */
+static LLVMValueRef
+lp_build_gather_avx2(struct gallivm_state *gallivm,
+                     unsigned length,
+                     LLVMValueRef base_ptr,
+                     LLVMValueRef offsets)
+{
+   struct lp_type type = lp_type_int_vec(32, 32 * length);
+   LLVMTypeRef vec_type = lp_build_vec_type(gallivm, type);
+   const char *intrinsic;
+   LLVMValueRef args[5];
+
+   intrinsic = length == 8 ? "llvm.x86.avx2.gather.d.d.256" :
+                             "llvm.x86.avx2.gather.d.d";
+
+   args[0] = LLVMGetUndef(vec_type);
+   args[1] = base_ptr;
+   args[2] = offsets;
+   /* all elements, the offsets are in bytes */
+   args[3] = lp_build_const_int_vec(gallivm, type, -1);
+   args[4] = LLVMConstInt(LLVMInt8TypeInContext(gallivm->context), 1, 0);
+
+   return lp_build_intrinsic(gallivm->builder, intrinsic, vec_type,
+                             args, Elements(args), 0);
+}
+
+
 /**
  * Gather elements from scatter positions in memory into a single vector.
  * Use for fetching texels from a texture.
@@ -170,6 +204,15 @@ lp_build_gather(struct gallivm_state *gallivm,
       return lp_build_gather_elem(gallivm, length,
                                   src_width, dst_width, aligned,
                                   base_ptr, offsets, 0, vector_justify);
+   } else if (util_cpu_caps.has_avx2 &&
+              src_width == 32 && dst_width == 32 &&
+              (length == 4 || length == 8) &&
+              LLVMTypeOf(offsets) == LLVMVectorType(
+                 LLVMInt32TypeInContext(gallivm->context), length)) {
+      /* One gather instruction instead of an extract, load and insert per
+       * element.
+       */
+      res = lp_build_gather_avx2(gallivm, length, base_ptr, offsets);
    } else {
       /* Vector */
 
@@ -28,10 +28,14 @@
 
 #include "pipe/p_config.h"
 #include "pipe/p_compiler.h"
+#include "util/disk_cache.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_debug.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
+#include "util/u_string.h"
 #include "util/simple_list.h"
+#include "os/os_thread.h"
 #include "os/os_time.h"
 #include "lp_bld.h"
 #include "lp_bld_debug.h"
@@ -78,6 +82,41 @@ DEBUG_GET_ONCE_FLAGS_OPTION(gallivm_debug, "GALLIVM_DEBUG", lp_bld_debug_flags,
 
 static boolean gallivm_initialized = FALSE;
 
+/** Persistent cache of object code, see gallivm_compile_module() */
+static struct disk_cache *gallivm_disk_cache = NULL;
+
+/**
+ * IR optimization level (GALLIVM_OPT_LEVEL), see add_optimization_passes().
+ */
+static unsigned gallivm_opt_level = 2;
+
+/**
+ * Functions with more IR instructions than this (GALLIVM_OPT_BUDGET) are
+ * optimized at level 1 at most, to bound the time spent on huge shaders.
+ * Zero means no limit.
+ */
+static unsigned gallivm_opt_budget = 0;
+
+/** Default of gallivm_state::fast_math (GALLIVM_FAST_MATH) */
+static boolean gallivm_fast_math = FALSE;
+
+/*
+ * Compile threads, see gallivm_compile_module_async().
+ *
+ * Modules are queued in FIFO order through gallivm_state::next_compile.  The
+ * mutex protects the queue and the compiling flag of every gallivm_state.
+ */
+#define GALLIVM_MAX_COMPILE_THREADS 8
+
+static unsigned gallivm_num_compile_threads = 0;
+static pipe_thread gallivm_compile_threads[GALLIVM_MAX_COMPILE_THREADS];
+pipe_static_mutex(gallivm_compile_mutex);
+static pipe_condvar gallivm_compile_queued;
+static pipe_condvar gallivm_compile_done;
+static struct gallivm_state *gallivm_compile_head = NULL;
+static struct gallivm_state *gallivm_compile_tail = NULL;
+static boolean gallivm_compile_exit = FALSE;
+
 unsigned lp_native_vector_width;
 
 
@@ -103,26 +142,85 @@ enum LLVM_CodeGenOpt_Level {
  * relevant optimization passes.
  * \return  TRUE for success, FALSE for failure
  */
+/**
+ * Add the function passes for the given optimization level:
+ *  0 - only promote allocas to registers, which the backends need
+ *  1 - cheap scalar cleanups
+ *  2 - the full pass list
+ */
+static void
+add_optimization_passes(LLVMPassManagerRef passmgr, unsigned level)
+{
+   if (level >= 2) {
+      /* These are the passes currently listed in llvm-c/Transforms/Scalar.h,
+       * but there are more on SVN.
+       * TODO: Add more passes.
+       */
+      LLVMAddScalarReplAggregatesPass(passmgr);
+      LLVMAddLICMPass(passmgr);
+      LLVMAddCFGSimplificationPass(passmgr);
+      LLVMAddReassociatePass(passmgr);
+      LLVMAddPromoteMemoryToRegisterPass(passmgr);
+      LLVMAddConstantPropagationPass(passmgr);
+      LLVMAddInstructionCombiningPass(passmgr);
+      LLVMAddGVNPass(passmgr);
+   }
+   else if (level == 1) {
+      LLVMAddPromoteMemoryToRegisterPass(passmgr);
+      LLVMAddEarlyCSEPass(passmgr);
+      LLVMAddInstructionCombiningPass(passmgr);
+      LLVMAddCFGSimplificationPass(passmgr);
+   }
+   else {
+      /* We need at least this pass to prevent the backends to fail in
+       * unexpected ways.
+       */
+      LLVMAddPromoteMemoryToRegisterPass(passmgr);
+   }
+}
+
+
+static LLVMPassManagerRef
+create_function_pass_manager(struct gallivm_state *gallivm, unsigned level)
+{
+   LLVMPassManagerRef passmgr;
+
+   passmgr = LLVMCreateFunctionPassManagerForModule(gallivm->module);
+   if (!passmgr)
+      return NULL;
+
+#if HAVE_LLVM < 0x0309
+   // Old versions of LLVM get the DataLayout from the pass manager.
+   LLVMAddTargetData(gallivm->target, passmgr);
+#endif
+
+   add_optimization_passes(passmgr, level);
+
+   return passmgr;
+}
+
+
+static unsigned
+get_opt_level(void)
+{
+   if (gallivm_debug & GALLIVM_DEBUG_NO_OPT)
+      return 0;
+   return gallivm_opt_level;
+}
+
+
 static boolean
 create_pass_manager(struct gallivm_state *gallivm)
 {
    assert(!gallivm->passmgr);
    assert(gallivm->target);
 
-   gallivm->passmgr = LLVMCreateFunctionPassManagerForModule(gallivm->module);
-   if (!gallivm->passmgr)
-      return FALSE;
    /*
     * TODO: some per module pass manager with IPO passes might be helpful -
     * the generated texture functions may benefit from inlining if they are
     * simple, or constant propagation into them, etc.
     */
 
-#if HAVE_LLVM < 0x0309
-   // Old versions of LLVM get the DataLayout from the pass manager.
-   LLVMAddTargetData(gallivm->target, gallivm->passmgr);
-#endif
-
    /* Setting the module's DataLayout to an empty string will cause the
     * ExecutionEngine to copy to the DataLayout string from its target
     * machine to the module.  As of LLVM 3.8 the module and the execution
@@ -147,28 +245,140 @@ create_pass_manager(struct gallivm_state *gallivm)
    LLVMSetDataLayout(gallivm->module, "");
 #endif
 
-   if ((gallivm_debug & GALLIVM_DEBUG_NO_OPT) == 0) {
-      /* These are the passes currently listed in llvm-c/Transforms/Scalar.h,
-       * but there are more on SVN.
-       * TODO: Add more passes.
-       */
-      LLVMAddScalarReplAggregatesPass(gallivm->passmgr);
-      LLVMAddLICMPass(gallivm->passmgr);
-      LLVMAddCFGSimplificationPass(gallivm->passmgr);
-      LLVMAddReassociatePass(gallivm->passmgr);
-      LLVMAddPromoteMemoryToRegisterPass(gallivm->passmgr);
-      LLVMAddConstantPropagationPass(gallivm->passmgr);
-      LLVMAddInstructionCombiningPass(gallivm->passmgr);
-      LLVMAddGVNPass(gallivm->passmgr);
+   gallivm->passmgr = create_function_pass_manager(gallivm, get_opt_level());
+
+   return gallivm->passmgr != NULL;
+}
+
+
+/**
+ * Count the IR instructions of a function, as an estimate of how long
+ * the optimization passes will take on it.
+ */
+static unsigned
+count_instructions(LLVMValueRef func)
+{
+   LLVMBasicBlockRef block;
+   unsigned count = 0;
+
+   for (block = LLVMGetFirstBasicBlock(func); block;
+        block = LLVMGetNextBasicBlock(block)) {
+      LLVMValueRef inst;
+      for (inst = LLVMGetFirstInstruction(block); inst;
+           inst = LLVMGetNextInstruction(inst)) {
+         count++;
+      }
    }
-   else {
-      /* We need at least this pass to prevent the backends to fail in
-       * unexpected ways.
+
+   return count;
+}
+
+
+/**
+ * Wait for a compile queued by gallivm_compile_module_async() to finish.
+ */
+static void
+gallivm_wait_compile(struct gallivm_state *gallivm)
+{
+   if (!gallivm_num_compile_threads)
+      return;
+
+   pipe_mutex_lock(gallivm_compile_mutex);
+   while (gallivm->compiling)
+      pipe_condvar_wait(gallivm_compile_done, gallivm_compile_mutex);
+   pipe_mutex_unlock(gallivm_compile_mutex);
+}
+
+
+static PIPE_THREAD_ROUTINE(gallivm_compile_thread, param)
+{
+   pipe_mutex_lock(gallivm_compile_mutex);
+
+   while (!gallivm_compile_exit) {
+      struct gallivm_state *gallivm = gallivm_compile_head;
+      LLVMValueRef func;
+
+      if (!gallivm) {
+         pipe_condvar_wait(gallivm_compile_queued, gallivm_compile_mutex);
+         continue;
+      }
+
+      gallivm_compile_head = gallivm->next_compile;
+      if (!gallivm_compile_head)
+         gallivm_compile_tail = NULL;
+      gallivm->next_compile = NULL;
+      pipe_mutex_unlock(gallivm_compile_mutex);
+
+      gallivm_compile_module(gallivm);
+
+      /* MCJIT generates the machine code of the whole module on the first
+       * lookup of a function, so do it here rather than in
+       * gallivm_jit_function().
        */
-      LLVMAddPromoteMemoryToRegisterPass(gallivm->passmgr);
+      func = LLVMGetFirstFunction(gallivm->module);
+      while (func && LLVMIsDeclaration(func))
+         func = LLVMGetNextFunction(func);
+      if (func)
+         LLVMGetPointerToGlobal(gallivm->engine, func);
+
+      pipe_mutex_lock(gallivm_compile_mutex);
+      gallivm->compiling = FALSE;
+      pipe_condvar_broadcast(gallivm_compile_done);
    }
 
-   return TRUE;
+   pipe_mutex_unlock(gallivm_compile_mutex);
+
+   return 0;
+}
+
+
+static void
+gallivm_destroy_compile_threads(void)
+{
+   unsigned i;
+
+   pipe_mutex_lock(gallivm_compile_mutex);
+   gallivm_compile_exit = TRUE;
+   pipe_condvar_broadcast(gallivm_compile_queued);
+   pipe_mutex_unlock(gallivm_compile_mutex);
+
+   for (i = 0; i < gallivm_num_compile_threads; i++)
+      pipe_thread_wait(gallivm_compile_threads[i]);
+
+   gallivm_num_compile_threads = 0;
+}
+
+
+/**
+ * Start the compile threads.  There are GALLIVM_COMPILE_THREADS of them,
+ * by default one less than the number of CPUs, up to four.
+ */
+static void
+gallivm_init_compile_threads(void)
+{
+#if USE_MCJIT
+   unsigned num_threads = MIN2(util_cpu_caps.nr_cpus - 1, 4);
+   unsigned i;
+
+   num_threads = debug_get_num_option("GALLIVM_COMPILE_THREADS", num_threads);
+   num_threads = MIN2(num_threads, GALLIVM_MAX_COMPILE_THREADS);
+   if (!num_threads)
+      return;
+
+   pipe_condvar_init(gallivm_compile_queued);
+   pipe_condvar_init(gallivm_compile_done);
+
+   for (i = 0; i < num_threads; i++) {
+      gallivm_compile_threads[i] =
+         pipe_thread_create(gallivm_compile_thread, NULL);
+      if (!gallivm_compile_threads[i])
+         break;
+      gallivm_num_compile_threads++;
+   }
+
+   if (gallivm_num_compile_threads)
+      atexit(gallivm_destroy_compile_threads);
+#endif
 }
 
 
@@ -179,6 +389,8 @@ create_pass_manager(struct gallivm_state *gallivm)
 void
 gallivm_free_ir(struct gallivm_state *gallivm)
 {
+   gallivm_wait_compile(gallivm);
+
    if (gallivm->passmgr) {
       LLVMDisposePassManager(gallivm->passmgr);
    }
@@ -201,7 +413,21 @@ gallivm_free_ir(struct gallivm_state *gallivm)
    if (gallivm->builder)
       LLVMDisposeBuilder(gallivm->builder);
 
-   /* The LLVMContext should be owned by the parent of gallivm. */
+#if USE_MCJIT && HAVE_LLVM >= 0x0306
+   if (gallivm->owns_cache) {
+      lp_free_disk_object_cache(gallivm->cache);
+      gallivm->cache = NULL;
+      gallivm->owns_cache = FALSE;
+   }
+#endif
+
+   /* Unless created for this gallivm, the LLVMContext is owned by the
+    * parent of gallivm.
+    */
+   if (gallivm->context_owned) {
+      LLVMContextDispose(gallivm->context);
+      gallivm->context_owned = FALSE;
+   }
 
    gallivm->engine = NULL;
    gallivm->target = NULL;
@@ -246,6 +472,7 @@ init_gallivm_engine(struct gallivm_state *gallivm)
                                                     &gallivm->code,
                                                     gallivm->module,
                                                     gallivm->memorymgr,
+                                                    gallivm->cache,
                                                     (unsigned) optlevel,
                                                     USE_MCJIT,
                                                     &error);
@@ -304,7 +531,13 @@ init_gallivm_state(struct gallivm_state *gallivm, const char *name,
    if (!lp_build_init())
       return FALSE;
 
+   if (!context) {
+      context = LLVMContextCreate();
+      gallivm->context_owned = TRUE;
+   }
+
    gallivm->context = context;
+   gallivm->fast_math = gallivm_fast_math;
 
    if (!gallivm->context)
       goto fail;
@@ -405,9 +638,13 @@ lp_build_init(void)
     *
     * See also:
     * - http://www.anandtech.com/show/4955/the-bulldozer-review-amd-fx8150-tested/2
+    *
+    * AVX2 capable parts from either vendor do have full-rate 256bit integer
+    * and float ops, so shade 8 pixels per vector op there.
     */
-   if (util_cpu_caps.has_avx &&
-       util_cpu_caps.has_intel) {
+   if ((util_cpu_caps.has_avx &&
+        util_cpu_caps.has_intel) ||
+       util_cpu_caps.has_avx2) {
       lp_native_vector_width = 256;
    } else {
       /* Leave it at 128, even when no SIMD extensions are available.
@@ -454,6 +691,22 @@ lp_build_init(void)
    }
 #endif
 
+   gallivm_opt_level = MIN2(debug_get_num_option("GALLIVM_OPT_LEVEL", 2), 2);
+   gallivm_opt_budget = debug_get_num_option("GALLIVM_OPT_BUDGET", 100000);
+   gallivm_fast_math = debug_get_bool_option("GALLIVM_FAST_MATH", FALSE);
+
+#if USE_MCJIT && HAVE_LLVM >= 0x0306
+   if (debug_get_bool_option("GALLIVM_DISK_CACHE", FALSE)) {
+      /* the optimization settings change the code for the same IR */
+      char id[64];
+      util_snprintf(id, sizeof id, "gallivm " __DATE__ " " __TIME__ " O%u/%u",
+                    gallivm_opt_level, gallivm_opt_budget);
+      gallivm_disk_cache = disk_cache_create("gallivm", id);
+   }
+#endif
+
+   gallivm_init_compile_threads();
+
    gallivm_initialized = TRUE;
 
 #if 0
@@ -537,7 +790,9 @@ void
 gallivm_compile_module(struct gallivm_state *gallivm)
 {
    LLVMValueRef func;
+   LLVMPassManagerRef passmgr_cheap = NULL;
    int64_t time_begin = 0;
+   boolean cache_hit = FALSE;
 
    assert(!gallivm->compiled);
 
@@ -549,10 +804,27 @@ gallivm_compile_module(struct gallivm_state *gallivm)
    if (gallivm_debug & GALLIVM_DEBUG_PERF)
       time_begin = os_time_get();
 
+#if USE_MCJIT && HAVE_LLVM >= 0x0306
+   /* With GALLIVM_DISK_CACHE set, look the module up before optimizing it:
+    * on a hit MCJIT gets the object code from the cache and neither the
+    * passes below nor code generation need to run.  Debug options changing
+    * the code or disassembling it bypass the cache.
+    */
+   if (gallivm_disk_cache && !gallivm->cache &&
+       !(gallivm_debug & (GALLIVM_DEBUG_NO_OPT | GALLIVM_DEBUG_ASM))) {
+      gallivm->cache = lp_create_disk_object_cache(gallivm_disk_cache,
+                                                   gallivm->module,
+                                                   &cache_hit);
+      gallivm->owns_cache = TRUE;
+   }
+#endif
+
    /* Run optimization passes */
    LLVMInitializeFunctionPassManager(gallivm->passmgr);
-   func = LLVMGetFirstFunction(gallivm->module);
+   func = cache_hit ? NULL : LLVMGetFirstFunction(gallivm->module);
    while (func) {
+      LLVMPassManagerRef passmgr = gallivm->passmgr;
+
       if (0) {
          debug_printf("optimizing func %s...\n", LLVMGetValueName(func));
       }
@@ -566,15 +838,36 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       LLVMAddTargetDependentFunctionAttr(func, "no-frame-pointer-elim-non-leaf", "true");
 #endif
 
-      LLVMRunFunctionPassManager(gallivm->passmgr, func);
+      /* Keep the optimization time of huge functions in check */
+      if (gallivm_opt_budget && get_opt_level() > 1 &&
+          count_instructions(func) > gallivm_opt_budget) {
+         if (!passmgr_cheap) {
+            passmgr_cheap = create_function_pass_manager(gallivm, 1);
+            if (passmgr_cheap)
+               LLVMInitializeFunctionPassManager(passmgr_cheap);
+         }
+         if (passmgr_cheap) {
+            passmgr = passmgr_cheap;
+            if (gallivm_debug & GALLIVM_DEBUG_PERF)
+               debug_printf("function %s is over the optimization budget\n",
+                            LLVMGetValueName(func));
+         }
+      }
+
+      LLVMRunFunctionPassManager(passmgr, func);
       func = LLVMGetNextFunction(func);
    }
    LLVMFinalizeFunctionPassManager(gallivm->passmgr);
+   if (passmgr_cheap) {
+      LLVMFinalizeFunctionPassManager(passmgr_cheap);
+      LLVMDisposePassManager(passmgr_cheap);
+   }
 
    if (gallivm_debug & GALLIVM_DEBUG_PERF) {
       int64_t time_end = os_time_get();
       int time_msec = (int)(time_end - time_begin) / 1000;
-      debug_printf("optimizing module %s took %d msec\n",
+      debug_printf("%s module %s took %d msec\n",
+                   cache_hit ? "looking up" : "optimizing",
                    lp_get_module_id(gallivm->module), time_msec);
    }
 
@@ -629,6 +922,47 @@ gallivm_compile_module(struct gallivm_state *gallivm)
 
 
 
+/**
+ * Whether gallivm_compile_module_async() actually compiles in the
+ * background, for modules whose gallivm_state owns its LLVMContext.
+ */
+boolean
+gallivm_can_compile_async(void)
+{
+   return gallivm_num_compile_threads != 0;
+}
+
+
+/**
+ * Like gallivm_compile_module(), but done by a compile thread if the
+ * gallivm_state owns its LLVMContext (gallivm_create() was passed no
+ * context), as LLVM contexts must not be used by several threads at once.
+ * Nothing but gallivm_jit_function() and freeing may be done with the
+ * gallivm_state afterwards; both wait for the compile to finish.
+ */
+void
+gallivm_compile_module_async(struct gallivm_state *gallivm)
+{
+   if (!gallivm_num_compile_threads || !gallivm->context_owned) {
+      gallivm_compile_module(gallivm);
+      return;
+   }
+
+   pipe_mutex_lock(gallivm_compile_mutex);
+   assert(!gallivm->compiling);
+   gallivm->compiling = TRUE;
+   gallivm->next_compile = NULL;
+   if (gallivm_compile_tail)
+      gallivm_compile_tail->next_compile = gallivm;
+   else
+      gallivm_compile_head = gallivm;
+   gallivm_compile_tail = gallivm;
+   pipe_condvar_signal(gallivm_compile_queued);
+   pipe_mutex_unlock(gallivm_compile_mutex);
+}
+
+
+
 func_pointer
 gallivm_jit_function(struct gallivm_state *gallivm,
                      LLVMValueRef func)
@@ -636,6 +970,8 @@ gallivm_jit_function(struct gallivm_state *gallivm,
    void *code;
    func_pointer jit_func;
 
+   gallivm_wait_compile(gallivm);
+
    assert(gallivm->compiled);
    assert(gallivm->engine);
 
@@ -39,6 +39,8 @@
 extern "C" {
 #endif
 
+struct lp_object_cache;
+
 struct gallivm_state
 {
    LLVMModuleRef module;
@@ -49,7 +51,24 @@ struct gallivm_state
    LLVMBuilderRef builder;
    LLVMMCJITMemoryManagerRef memorymgr;
    struct lp_generated_code *code;
+   /**
+    * Optional llvm::ObjectCache for the engine, owned by the caller unless
+    * owns_cache is set, in which case it is the disk cache's.
+    */
+   struct lp_object_cache *cache;
+   boolean owns_cache;
    unsigned compiled;
+   /** Whether context was created by gallivm_create() */
+   boolean context_owned;
+   /** Queued or running on a compile thread, protected by the queue mutex */
+   boolean compiling;
+   /**
+    * Use shorter, less precise sequences for transcendentals and rcp/rsqrt,
+    * see lp_bld_arit.c.  Defaults to GALLIVM_FAST_MATH, but may be changed
+    * by the caller before generating any code.
+    */
+   boolean fast_math;
+   struct gallivm_state *next_compile;
 };
 
 
@@ -73,6 +92,12 @@ gallivm_verify_function(struct gallivm_state *gallivm,
 void
 gallivm_compile_module(struct gallivm_state *gallivm);
 
+boolean
+gallivm_can_compile_async(void);
+
+void
+gallivm_compile_module_async(struct gallivm_state *gallivm);
+
 func_pointer
 gallivm_jit_function(struct gallivm_state *gallivm,
                      LLVMValueRef func);
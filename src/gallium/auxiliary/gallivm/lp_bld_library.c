@@ -0,0 +1,197 @@
+/**************************************************************************
+ *
+ * Copyright 2016 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Process wide library of pre-compiled helper functions.
+ *
+ * Each helper is compiled the first time it is asked for, in a gallivm_state
+ * with a private LLVMContext, and its code is kept until the process exits.
+ * Helpers are found by name, so the name must identify the code completely.
+ *
+ * The library can be disabled with GALLIVM_SHARED_HELPERS=false, in which
+ * case callers generate the code inline as before.
+ */
+
+
+#include "pipe/p_compiler.h"
+#include "os/os_thread.h"
+#include "util/u_debug.h"
+#include "util/u_hash.h"
+#include "util/u_hash_table.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+
+#include "lp_bld_const.h"
+#include "lp_bld_debug.h"
+#include "lp_bld_init.h"
+#include "lp_bld_library.h"
+
+
+struct lp_library_entry
+{
+   char *name;
+   struct gallivm_state *gallivm;
+   const void *code;
+};
+
+
+pipe_static_mutex(lp_library_mutex);
+static struct util_hash_table *lp_library_table = NULL;
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(shared_helpers, "GALLIVM_SHARED_HELPERS", TRUE)
+
+
+static unsigned
+library_hash(void *key)
+{
+   const char *name = key;
+   return util_hash_crc32(name, strlen(name));
+}
+
+
+static int
+library_compare(void *key1, void *key2)
+{
+   return strcmp(key1, key2);
+}
+
+
+boolean
+lp_build_library_enabled(void)
+{
+   return debug_get_option_shared_helpers();
+}
+
+
+/**
+ * Compile a new library function.
+ * Called with the library mutex held.
+ */
+static struct lp_library_entry *
+library_compile(const struct lp_library_function *func)
+{
+   struct lp_library_entry *entry;
+   struct gallivm_state *gallivm;
+   LLVMValueRef function;
+
+   /* a private context, as the callers' ones may be used by other threads */
+   gallivm = gallivm_create(func->name, NULL);
+   if (!gallivm)
+      return NULL;
+
+   function = LLVMAddFunction(gallivm->module, func->name,
+                              func->build_type(gallivm, func->data));
+   LLVMSetFunctionCallConv(function, LLVMCCallConv);
+
+   func->build_body(gallivm, function, func->data);
+
+   gallivm_verify_function(gallivm, function);
+
+   gallivm_compile_module(gallivm);
+
+   entry = CALLOC_STRUCT(lp_library_entry);
+   if (entry) {
+      entry->name = strdup(func->name);
+      entry->gallivm = gallivm;
+      entry->code = (const void *)gallivm_jit_function(gallivm, function);
+   }
+
+   /* only the machine code is needed from now on */
+   gallivm_free_ir(gallivm);
+
+   if (!entry || !entry->name || !entry->code) {
+      if (entry)
+         FREE(entry->name);
+      FREE(entry);
+      gallivm_destroy(gallivm);
+      return NULL;
+   }
+
+   if (gallivm_debug & GALLIVM_DEBUG_PERF) {
+      debug_printf("%s: compiled %s\n", __FUNCTION__, func->name);
+   }
+
+   return entry;
+}
+
+
+/**
+ * Return a pointer to the library function described by func, which can be
+ * called from gallivm's code with LLVMBuildCall() and the C calling
+ * convention, compiling it first if this is the first request for it.
+ *
+ * Returns NULL if the library is disabled or the compilation failed, in
+ * which case the caller should generate the code inline.
+ */
+LLVMValueRef
+lp_build_library_function(struct gallivm_state *gallivm,
+                          const struct lp_library_function *func)
+{
+   struct lp_library_entry *entry = NULL;
+   LLVMTypeRef function_type;
+
+   if (!lp_build_library_enabled())
+      return NULL;
+
+   pipe_mutex_lock(lp_library_mutex);
+
+   if (!lp_library_table) {
+      lp_library_table = util_hash_table_create(library_hash,
+                                                library_compare);
+   }
+
+   if (lp_library_table) {
+      entry = util_hash_table_get(lp_library_table, (void *)func->name);
+      if (!entry) {
+         entry = library_compile(func);
+         if (entry &&
+             util_hash_table_set(lp_library_table, entry->name, entry) !=
+             PIPE_OK) {
+            /* still usable, but will be compiled again next time */
+            if (gallivm_debug & GALLIVM_DEBUG_PERF) {
+               debug_printf("%s: failed to add %s\n", __FUNCTION__,
+                            func->name);
+            }
+         }
+      }
+   }
+
+   pipe_mutex_unlock(lp_library_mutex);
+
+   if (!entry)
+      return NULL;
+
+   function_type = func->build_type(gallivm, func->data);
+
+   return LLVMBuildBitCast(gallivm->builder,
+                           lp_build_const_int_pointer(gallivm, entry->code),
+                           LLVMPointerType(function_type, 0),
+                           func->name);
+}
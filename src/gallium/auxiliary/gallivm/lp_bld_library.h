@@ -0,0 +1,81 @@
+/**************************************************************************
+ *
+ * Copyright 2016 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Process wide library of pre-compiled helper functions.
+ *
+ * Helpers which many shader variants would otherwise each carry an identical
+ * copy of are compiled once, in a gallivm_state of their own, and the
+ * variants call the machine code through a function pointer constant.
+ */
+
+
+#ifndef LP_BLD_LIBRARY_H
+#define LP_BLD_LIBRARY_H
+
+
+#include "gallivm/lp_bld.h"
+
+
+struct gallivm_state;
+
+
+/**
+ * Description of a library function.
+ *
+ * As both the library's and the caller's modules need the prototype, which
+ * live in different LLVM contexts, it is built by a callback.
+ */
+struct lp_library_function
+{
+   /** Unique name, encoding everything the generated code depends on */
+   const char *name;
+
+   /** Build the function type in the given gallivm's context */
+   LLVMTypeRef
+   (*build_type)(struct gallivm_state *gallivm, const void *data);
+
+   /** Build the body of the (empty) function */
+   void
+   (*build_body)(struct gallivm_state *gallivm, LLVMValueRef function,
+                 const void *data);
+
+   const void *data;
+};
+
+
+boolean
+lp_build_library_enabled(void);
+
+LLVMValueRef
+lp_build_library_function(struct gallivm_state *gallivm,
+                          const struct lp_library_function *func);
+
+
+#endif /* !LP_BLD_LIBRARY_H */
@@ -70,6 +70,7 @@
 #include <llvm/ExecutionEngine/JITMemoryManager.h>
 #else
 #include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
 #endif
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Host.h>
@@ -89,6 +90,7 @@
 #include "c11/threads.h"
 #include "os/os_thread.h"
 #include "pipe/p_config.h"
+#include "util/disk_cache.h"
 #include "util/u_debug.h"
 #include "util/u_cpu_detect.h"
 
@@ -456,6 +458,7 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
  * Same as LLVMCreateJITCompilerForModule, but:
  * - allows using MCJIT and enabling AVX feature where available.
  * - set target options
+ * - optionally hooks up an llvm::ObjectCache (MCJIT only)
  *
  * See also:
  * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
@@ -468,6 +471,7 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         lp_generated_code **OutCode,
                                         LLVMModuleRef M,
                                         LLVMMCJITMemoryManagerRef CMM,
+                                        struct lp_object_cache *Cache,
                                         unsigned OptLevel,
                                         int useMCJIT,
                                         char **OutError)
@@ -626,6 +630,10 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
 
    JIT = builder.create();
    if (JIT) {
+#if HAVE_LLVM >= 0x0306
+      if (useMCJIT && Cache)
+         JIT->setObjectCache(reinterpret_cast<ObjectCache *>(Cache));
+#endif
       *OutJIT = wrap(JIT);
       return 0;
    }
@@ -663,3 +671,122 @@ lp_free_memory_manager(LLVMMCJITMemoryManagerRef memorymgr)
 {
    delete reinterpret_cast<BaseMemoryManager*>(memorymgr);
 }
+
+
+#if HAVE_LLVM >= 0x0306
+
+namespace {
+
+/**
+ * llvm::ObjectCache handing MCJIT the object code of one module from the
+ * disk cache, or storing it there once compiled.
+ */
+class DiskObjectCache : public llvm::ObjectCache {
+public:
+   DiskObjectCache(struct disk_cache *cache) :
+      cache(cache), object(NULL), size(0)
+   {
+   }
+
+   virtual ~DiskObjectCache()
+   {
+      free(object);
+   }
+
+   virtual void notifyObjectCompiled(const llvm::Module *M,
+                                     llvm::MemoryBufferRef Obj)
+   {
+      if (!object)
+         disk_cache_put(cache, key, Obj.getBufferStart(), Obj.getBufferSize());
+   }
+
+   virtual std::unique_ptr<llvm::MemoryBuffer>
+   getObject(const llvm::Module *M)
+   {
+      if (!object)
+         return nullptr;
+
+      return llvm::MemoryBuffer::getMemBufferCopy(
+         llvm::StringRef((const char *) object, size));
+   }
+
+   struct disk_cache *cache;
+   cache_key key;
+   void *object;
+   size_t size;
+};
+
+}
+
+
+/**
+ * Look up the object code of module M in the disk cache.
+ *
+ * The key is made of the IR of the module as it is before optimization, the
+ * target and the CPU features the code is generated for, so that on a hit
+ * both the optimization passes and code generation can be skipped.  The
+ * module identifier is left out, everything else that names the functions
+ * has to match for MCJIT to find them in the cached object.
+ *
+ * \param hit  set to whether the object code was found
+ * \return the llvm::ObjectCache to give to the engine of M, to be freed with
+ * lp_free_disk_object_cache() once the engine is gone.
+ */
+extern "C"
+struct lp_object_cache *
+lp_create_disk_object_cache(struct disk_cache *cache,
+                            LLVMModuleRef M,
+                            boolean *hit)
+{
+   using namespace llvm;
+
+   DiskObjectCache *obj_cache = new DiskObjectCache(cache);
+   std::string data;
+   raw_string_ostream stream(data);
+
+   stream << sys::getProcessTriple() << " " << sys::getHostCPUName()
+          << " LLVM " << HAVE_LLVM
+          << " sse " << util_cpu_caps.has_sse
+          << " sse2 " << util_cpu_caps.has_sse2
+          << " sse3 " << util_cpu_caps.has_sse3
+          << " ssse3 " << util_cpu_caps.has_ssse3
+          << " sse4.1 " << util_cpu_caps.has_sse4_1
+          << " sse4.2 " << util_cpu_caps.has_sse4_2
+          << " avx " << util_cpu_caps.has_avx
+          << " f16c " << util_cpu_caps.has_f16c
+          << " avx2 " << util_cpu_caps.has_avx2
+          << " altivec " << util_cpu_caps.has_altivec << "\n";
+
+   std::string ir;
+   raw_string_ostream ir_stream(ir);
+   unwrap(M)->print(ir_stream, NULL);
+   ir_stream.flush();
+
+   StringRef lines(ir);
+   while (!lines.empty()) {
+      std::pair<StringRef, StringRef> split = lines.split('\n');
+      if (!split.first.startswith("; ModuleID") &&
+          !split.first.startswith("source_filename"))
+         stream << split.first << "\n";
+      lines = split.second;
+   }
+   stream.flush();
+
+   disk_cache_compute_key(cache, data.data(), data.size(), obj_cache->key);
+   obj_cache->object = disk_cache_get(cache, obj_cache->key, &obj_cache->size);
+
+   *hit = obj_cache->object != NULL;
+   return reinterpret_cast<lp_object_cache *>(
+      static_cast<ObjectCache *>(obj_cache));
+}
+
+
+extern "C"
+void
+lp_free_disk_object_cache(struct lp_object_cache *cache)
+{
+   delete static_cast<DiskObjectCache *>(
+      reinterpret_cast<llvm::ObjectCache *>(cache));
+}
+
+#endif
@@ -40,7 +40,9 @@ extern "C" {
 #endif
 
 
+struct disk_cache;
 struct lp_generated_code;
+struct lp_object_cache;
 
 extern void
 gallivm_init_llvm_targets(void);
@@ -64,6 +66,7 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         struct lp_generated_code **OutCode,
                                         LLVMModuleRef M,
                                         LLVMMCJITMemoryManagerRef MM,
+                                        struct lp_object_cache *Cache,
                                         unsigned OptLevel,
                                         int useMCJIT,
                                         char **OutError);
@@ -77,6 +80,16 @@ lp_get_default_memory_manager();
 extern void
 lp_free_memory_manager(LLVMMCJITMemoryManagerRef memorymgr);
 
+#if HAVE_LLVM >= 0x0306
+extern struct lp_object_cache *
+lp_create_disk_object_cache(struct disk_cache *cache,
+                            LLVMModuleRef M,
+                            boolean *hit);
+
+extern void
+lp_free_disk_object_cache(struct lp_object_cache *cache);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -490,6 +490,7 @@ lp_build_pack2(struct gallivm_state *gallivm,
    if ((util_cpu_caps.has_sse2 || util_cpu_caps.has_altivec) &&
         src_type.width * src_type.length >= 128) {
       const char *intrinsic = NULL;
+      const char *intrinsic_avx2 = NULL;
       boolean swap_intrinsic_operands = FALSE;
 
       switch(src_type.width) {
@@ -497,9 +498,11 @@ lp_build_pack2(struct gallivm_state *gallivm,
          if (util_cpu_caps.has_sse2) {
            if (dst_type.sign) {
               intrinsic = "llvm.x86.sse2.packssdw.128";
+              intrinsic_avx2 = "llvm.x86.avx2.packssdw";
            } else {
               if (util_cpu_caps.has_sse4_1) {
                  intrinsic = "llvm.x86.sse41.packusdw";
+                 intrinsic_avx2 = "llvm.x86.avx2.packusdw";
               }
            }
          } else if (util_cpu_caps.has_altivec) {
@@ -517,6 +520,7 @@ lp_build_pack2(struct gallivm_state *gallivm,
          if (dst_type.sign) {
             if (util_cpu_caps.has_sse2) {
                intrinsic = "llvm.x86.sse2.packsswb.128";
+               intrinsic_avx2 = "llvm.x86.avx2.packsswb";
             } else if (util_cpu_caps.has_altivec) {
                intrinsic = "llvm.ppc.altivec.vpkshss";
 #ifdef PIPE_ARCH_LITTLE_ENDIAN
@@ -526,6 +530,7 @@ lp_build_pack2(struct gallivm_state *gallivm,
          } else {
             if (util_cpu_caps.has_sse2) {
                intrinsic = "llvm.x86.sse2.packuswb.128";
+               intrinsic_avx2 = "llvm.x86.avx2.packuswb";
             } else if (util_cpu_caps.has_altivec) {
                intrinsic = "llvm.ppc.altivec.vpkshus";
 #ifdef PIPE_ARCH_LITTLE_ENDIAN
@@ -548,6 +553,28 @@ lp_build_pack2(struct gallivm_state *gallivm,
                res = LLVMBuildBitCast(builder, res, dst_vec_type, "");
             }
          }
+         else if (src_type.width * src_type.length == 256 &&
+                  intrinsic_avx2 && util_cpu_caps.has_avx2) {
+            /*
+             * The AVX2 packs work within each 128bit lane, so the result
+             * comes out as lo.lane0 hi.lane0 lo.lane1 hi.lane1. A single
+             * 64bit permute puts the halves back in order, which is still
+             * cheaper than splitting both sources into 128bit vectors.
+             */
+            LLVMTypeRef intr_vec_type = lp_build_vec_type(gallivm, intr_type);
+            LLVMTypeRef i64x4_type = LLVMVectorType(LLVMInt64TypeInContext(gallivm->context), 4);
+            LLVMValueRef order[4];
+
+            res = lp_build_intrinsic_binary(builder, intrinsic_avx2, intr_vec_type, lo, hi);
+            res = LLVMBuildBitCast(builder, res, i64x4_type, "");
+            order[0] = lp_build_const_int32(gallivm, 0);
+            order[1] = lp_build_const_int32(gallivm, 2);
+            order[2] = lp_build_const_int32(gallivm, 1);
+            order[3] = lp_build_const_int32(gallivm, 3);
+            res = LLVMBuildShuffleVector(builder, res, LLVMGetUndef(i64x4_type),
+                                         LLVMConstVector(order, 4), "");
+            res = LLVMBuildBitCast(builder, res, dst_vec_type, "");
+         }
          else {
             int num_split = src_type.width * src_type.length / 128;
             int i;
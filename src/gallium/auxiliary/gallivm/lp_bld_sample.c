@@ -118,6 +118,7 @@ lp_sampler_static_texture_state(struct lp_static_texture_state *state,
    state->pot_height        = util_is_power_of_two(texture->height0);
    state->pot_depth         = util_is_power_of_two(texture->depth0);
    state->level_zero_only   = !view->u.tex.last_level;
+   state->tiled             = !!(texture->flags & LP_RESOURCE_FLAG_TILED);
 
    /*
     * the layer / element / level parameters are all either dynamic
@@ -2073,3 +2074,57 @@ lp_build_sample_offset(struct lp_build_context *bld,
 
    *out_offset = offset;
 }
+
+
+/**
+ * Like lp_build_sample_offset(), but for textures stored in
+ * LP_TEX_TILE_SIZE square tiles (see LP_RESOURCE_FLAG_TILED), with
+ * y_stride being the stride between rows of tiles.
+ * Compressed formats are never tiled, so i and j are always zero.
+ */
+void
+lp_build_sample_offset_tiled(struct lp_build_context *bld,
+                             const struct util_format_description *format_desc,
+                             LLVMValueRef x,
+                             LLVMValueRef y,
+                             LLVMValueRef z,
+                             LLVMValueRef y_stride,
+                             LLVMValueRef z_stride,
+                             LLVMValueRef *out_offset,
+                             LLVMValueRef *out_i,
+                             LLVMValueRef *out_j)
+{
+   const unsigned tile_order = util_logbase2(LP_TEX_TILE_SIZE);
+   const unsigned bpp = format_desc->block.bits/8;
+   LLVMValueRef tile_mask = lp_build_const_int_vec(bld->gallivm, bld->type,
+                                                   LP_TEX_TILE_SIZE - 1);
+   LLVMValueRef offset, sub;
+
+   assert(format_desc->block.width == 1 && format_desc->block.height == 1);
+
+   /* x: whole tiles plus the pixel within the tile row */
+   offset = lp_build_shr_imm(bld, x, tile_order);
+   offset = lp_build_mul_imm(bld, offset,
+                             bpp * LP_TEX_TILE_SIZE * LP_TEX_TILE_SIZE);
+   sub = LLVMBuildAnd(bld->gallivm->builder, x, tile_mask, "");
+   offset = lp_build_add(bld, offset, lp_build_mul_imm(bld, sub, bpp));
+
+   if (y && y_stride) {
+      LLVMValueRef y_offset;
+      y_offset = lp_build_shr_imm(bld, y, tile_order);
+      y_offset = lp_build_mul(bld, y_offset, y_stride);
+      sub = LLVMBuildAnd(bld->gallivm->builder, y, tile_mask, "");
+      y_offset = lp_build_add(bld, y_offset,
+                              lp_build_mul_imm(bld, sub,
+                                               bpp * LP_TEX_TILE_SIZE));
+      offset = lp_build_add(bld, offset, y_offset);
+   }
+
+   if (z && z_stride) {
+      offset = lp_build_add(bld, offset, lp_build_mul(bld, z, z_stride));
+   }
+
+   *out_offset = offset;
+   *out_i = bld->zero;
+   *out_j = bld->zero;
+}
@@ -132,9 +132,22 @@ struct lp_static_texture_state
    unsigned pot_height:1;
    unsigned pot_depth:1;
    unsigned level_zero_only:1;
+   unsigned tiled:1;         /**< stored in LP_TEX_TILE_SIZE square tiles */
+   unsigned block_cache:1;   /**< decode blocks through the texel cache */
 };
 
 
+/**
+ * Driver private pipe_resource flag for textures stored as rows of
+ * LP_TEX_TILE_SIZE x LP_TEX_TILE_SIZE pixel tiles instead of linearly.
+ * Pixels within a tile are linear, tiles in a row of tiles are adjacent,
+ * and the row stride is the distance between rows of tiles.
+ * See lp_build_sample_offset_tiled().
+ */
+#define LP_RESOURCE_FLAG_TILED PIPE_RESOURCE_FLAG_DRV_PRIV
+#define LP_TEX_TILE_SIZE 4
+
+
 /**
  * Sampler static state.
  *
@@ -585,6 +598,19 @@ lp_build_sample_offset(struct lp_build_context *bld,
                        LLVMValueRef *out_j);
 
 
+void
+lp_build_sample_offset_tiled(struct lp_build_context *bld,
+                             const struct util_format_description *format_desc,
+                             LLVMValueRef x,
+                             LLVMValueRef y,
+                             LLVMValueRef z,
+                             LLVMValueRef y_stride,
+                             LLVMValueRef z_stride,
+                             LLVMValueRef *out_offset,
+                             LLVMValueRef *out_i,
+                             LLVMValueRef *out_j);
+
+
 void
 lp_build_sample_soa(const struct lp_static_texture_state *static_texture_state,
                     const struct lp_static_sampler_state *static_sampler_state,
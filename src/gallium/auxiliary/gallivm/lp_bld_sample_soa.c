@@ -136,10 +136,18 @@ lp_build_sample_texel_soa(struct lp_build_sample_context *bld,
    }
 
    /* convert x,y,z coords to linear offset from start of texture, in bytes */
-   lp_build_sample_offset(&bld->int_coord_bld,
-                          bld->format_desc,
-                          x, y, z, y_stride, z_stride,
-                          &offset, &i, &j);
+   if (bld->static_texture_state->tiled) {
+      lp_build_sample_offset_tiled(&bld->int_coord_bld,
+                                   bld->format_desc,
+                                   x, y, z, y_stride, z_stride,
+                                   &offset, &i, &j);
+   }
+   else {
+      lp_build_sample_offset(&bld->int_coord_bld,
+                             bld->format_desc,
+                             x, y, z, y_stride, z_stride,
+                             &offset, &i, &j);
+   }
    if (mipoffsets) {
       offset = lp_build_add(&bld->int_coord_bld, offset, mipoffsets);
    }
@@ -2373,10 +2381,18 @@ lp_build_fetch_texel(struct lp_build_sample_context *bld,
       }
    }
 
-   lp_build_sample_offset(int_coord_bld,
-                          bld->format_desc,
-                          x, y, z, row_stride_vec, img_stride_vec,
-                          &offset, &i, &j);
+   if (bld->static_texture_state->tiled) {
+      lp_build_sample_offset_tiled(int_coord_bld,
+                                   bld->format_desc,
+                                   x, y, z, row_stride_vec, img_stride_vec,
+                                   &offset, &i, &j);
+   }
+   else {
+      lp_build_sample_offset(int_coord_bld,
+                             bld->format_desc,
+                             x, y, z, row_stride_vec, img_stride_vec,
+                             &offset, &i, &j);
+   }
 
    if (bld->static_texture_state->target != PIPE_BUFFER) {
       offset = lp_build_add(int_coord_bld, offset,
@@ -2710,7 +2726,8 @@ lp_build_sample_soa_code(struct gallivm_state *gallivm,
                                                 context_ptr, texture_index);
    /* Note that mip_offsets is an array[level] of offsets to texture images */
 
-   if (dynamic_state->cache_ptr && thread_data_ptr) {
+   if (static_texture_state->block_cache &&
+       dynamic_state->cache_ptr && thread_data_ptr) {
       bld.cache = dynamic_state->cache_ptr(dynamic_state, gallivm,
                                            thread_data_ptr, texture_index);
    }
@@ -2811,6 +2828,10 @@ lp_build_sample_soa_code(struct gallivm_state *gallivm,
          /* theoretically possible with AoS filtering but not implemented (complex!) */
          use_aos = 0;
       }
+      if (static_texture_state->tiled) {
+         /* the AoS path does its own linear addressing */
+         use_aos = 0;
+      }
 
       if ((gallivm_debug & GALLIVM_DEBUG_PERF) &&
           !use_aos && util_format_fits_8unorm(bld.format_desc)) {
@@ -3105,12 +3126,8 @@ lp_build_sample_gen_func(struct gallivm_state *gallivm,
    get_target_info(static_texture_state->target,
                    &num_coords, &num_derivs, &num_offsets, &layer);
 
-   if (dynamic_state->cache_ptr) {
-      const struct util_format_description *format_desc;
-      format_desc = util_format_description(static_texture_state->format);
-      if (format_desc && format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
-         need_cache = TRUE;
-      }
+   if (dynamic_state->cache_ptr && static_texture_state->block_cache) {
+      need_cache = TRUE;
    }
 
    /* "unpack" arguments */
@@ -3220,16 +3237,8 @@ lp_build_sample_soa_func(struct gallivm_state *gallivm,
    get_target_info(static_texture_state->target,
                    &num_coords, &num_derivs, &num_offsets, &layer);
 
-   if (dynamic_state->cache_ptr) {
-      const struct util_format_description *format_desc;
-      format_desc = util_format_description(static_texture_state->format);
-      if (format_desc && format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
-         /*
-          * This is not 100% correct, if we have cache but the
-          * util_format_s3tc_prefer is true the cache won't get used
-          * regardless (could hook up the block decode there...) */
-         need_cache = TRUE;
-      }
+   if (dynamic_state->cache_ptr && static_texture_state->block_cache) {
+      need_cache = TRUE;
    }
    /*
     * texture function matches are found by name.
@@ -170,6 +170,28 @@ struct lp_bld_tgsi_system_values {
    LLVMValueRef prim_id;
    LLVMValueRef basevertex;
    LLVMValueRef invocation_id;
+   /** Compute shaders: per-lane vectors */
+   LLVMValueRef thread_id[3];
+   /** Compute shaders: scalars */
+   LLVMValueRef block_id[3];
+   LLVMValueRef grid_size[3];
+   LLVMValueRef block_size[3];
+};
+
+
+/**
+ * Memory accessible to compute shaders with LOAD and STORE.
+ *
+ * Accesses out of bounds of a buffer are dropped, or read as zero.
+ */
+struct lp_build_tgsi_cs_iface {
+   /** Pointer to an array of PIPE_MAX_SHADER_BUFFERS pointers to int32 */
+   LLVMValueRef ssbo_ptr;
+   /** Pointer to an array of PIPE_MAX_SHADER_BUFFERS sizes in bytes */
+   LLVMValueRef ssbo_sizes_ptr;
+   /** Pointer to and size in bytes of the workgroup's shared memory */
+   LLVMValueRef shared_ptr;
+   LLVMValueRef shared_size;
 };
 
 
@@ -237,7 +259,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef thread_data_ptr,
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface);
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface);
 
 
 void
@@ -440,6 +463,7 @@ struct lp_build_tgsi_soa_context
    struct lp_build_context elem_bld;
 
    const struct lp_build_tgsi_gs_iface *gs_iface;
+   const struct lp_build_tgsi_cs_iface *cs_iface;
    LLVMValueRef emitted_prims_vec_ptr;
    LLVMValueRef total_emitted_vertices_vec_ptr;
    LLVMValueRef emitted_vertices_vec_ptr;
@@ -1678,6 +1678,36 @@ emit_fetch_system_value(
       atype = TGSI_TYPE_UNSIGNED;
       break;
 
+   case TGSI_SEMANTIC_THREAD_ID:
+      res = swizzle < 3 ? bld->system_values.thread_id[swizzle] :
+                          bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_ID:
+      res = swizzle < 3 ?
+         lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                   bld->system_values.block_id[swizzle]) :
+         bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_GRID_SIZE:
+      res = swizzle < 3 ?
+         lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                   bld->system_values.grid_size[swizzle]) :
+         bld_base->uint_bld.one;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_SIZE:
+      res = swizzle < 3 ?
+         lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                   bld->system_values.block_size[swizzle]) :
+         bld_base->uint_bld.one;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
    default:
       assert(!"unexpected semantic in emit_fetch_system_value");
       res = bld_base->base.zero;
@@ -3434,6 +3464,167 @@ clamp_mask_to_max_output_vertices(struct lp_build_tgsi_soa_context * bld,
    return LLVMBuildAnd(builder, current_mask_vec, max_mask, "");
 }
 
+/**
+ * Get the int32 pointer to and the size in dwords of the buffer or shared
+ * memory accessed by a LOAD or STORE.
+ */
+static void
+get_memory_ptr(struct lp_build_tgsi_soa_context *bld,
+               unsigned file, unsigned index,
+               LLVMValueRef *ptr, LLVMValueRef *num_dwords)
+{
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld->bld_base.uint_bld;
+   const struct lp_build_tgsi_cs_iface *cs_iface = bld->cs_iface;
+   LLVMValueRef size;
+
+   assert(cs_iface);
+
+   if (file == TGSI_FILE_MEMORY) {
+      *ptr = cs_iface->shared_ptr;
+      size = cs_iface->shared_size;
+   } else {
+      LLVMValueRef idx = lp_build_const_int32(gallivm, index);
+
+      assert(file == TGSI_FILE_BUFFER);
+      assert(index < PIPE_MAX_SHADER_BUFFERS);
+      *ptr = lp_build_array_get(gallivm, cs_iface->ssbo_ptr, idx);
+      size = lp_build_array_get(gallivm, cs_iface->ssbo_sizes_ptr, idx);
+   }
+
+   size = LLVMBuildLShr(builder, size, lp_build_const_int32(gallivm, 2), "");
+   *num_dwords = lp_build_broadcast_scalar(uint_bld, size);
+}
+
+/**
+ * LOAD dst, BUFFER[n] or MEMORY[n], byte address
+ *
+ * Each enabled dst channel reads the next dword, channels out of bounds
+ * return zero.
+ */
+static void
+load_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   const struct tgsi_full_src_register *resource = &inst->Src[0];
+   LLVMValueRef ptr, num_dwords, addr;
+   unsigned chan;
+
+   assert(!resource->Register.Indirect);
+
+   get_memory_ptr(bld, resource->Register.File, resource->Register.Index,
+                  &ptr, &num_dwords);
+   ptr = LLVMBuildBitCast(builder, ptr,
+                          LLVMPointerType(bld_base->base.elem_type, 0), "");
+
+   addr = lp_build_emit_fetch(bld_base, inst, 1, TGSI_CHAN_X);
+   addr = LLVMBuildBitCast(builder, addr, uint_bld->vec_type, "");
+   addr = lp_build_shr_imm(uint_bld, addr, 2);
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      LLVMValueRef index = lp_build_add(uint_bld, addr,
+                                        lp_build_const_int_vec(gallivm,
+                                                               uint_bld->type,
+                                                               chan));
+      LLVMValueRef overflow = lp_build_cmp(uint_bld, PIPE_FUNC_GEQUAL,
+                                           index, num_dwords);
+
+      emit_data->output[chan] = build_gather(bld_base, ptr, index,
+                                             overflow, NULL);
+   }
+}
+
+/**
+ * STORE BUFFER[n] or MEMORY[n], byte address, value
+ *
+ * Each enabled dst channel writes the next dword.  Stores are done lane by
+ * lane and only for active lanes, since other threads may be writing the
+ * same buffer.
+ */
+static void
+store_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   const struct tgsi_full_dst_register *resource = &inst->Dst[0];
+   LLVMValueRef ptr, num_dwords, addr, exec_mask;
+   unsigned chan, i;
+
+   assert(!resource->Register.Indirect);
+
+   get_memory_ptr(bld, resource->Register.File, resource->Register.Index,
+                  &ptr, &num_dwords);
+
+   addr = lp_build_emit_fetch(bld_base, inst, 0, TGSI_CHAN_X);
+   addr = LLVMBuildBitCast(builder, addr, uint_bld->vec_type, "");
+   addr = lp_build_shr_imm(uint_bld, addr, 2);
+
+   exec_mask = mask_vec(bld_base);
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      LLVMValueRef index = lp_build_add(uint_bld, addr,
+                                        lp_build_const_int_vec(gallivm,
+                                                               uint_bld->type,
+                                                               chan));
+      LLVMValueRef in_bounds = lp_build_cmp(uint_bld, PIPE_FUNC_LESS,
+                                            index, num_dwords);
+      LLVMValueRef store_mask = LLVMBuildAnd(builder, exec_mask, in_bounds, "");
+      LLVMValueRef value = lp_build_emit_fetch(bld_base, inst, 1, chan);
+
+      value = LLVMBuildBitCast(builder, value, uint_bld->vec_type, "");
+
+      for (i = 0; i < uint_bld->type.length; i++) {
+         LLVMValueRef ii = lp_build_const_int32(gallivm, i);
+         LLVMValueRef lane_mask =
+            LLVMBuildExtractElement(builder, store_mask, ii, "");
+         LLVMValueRef cond = LLVMBuildICmp(builder, LLVMIntNE, lane_mask,
+                                           lp_build_const_int32(gallivm, 0), "");
+         struct lp_build_if_state ifthen;
+
+         lp_build_if(&ifthen, gallivm, cond);
+         {
+            LLVMValueRef lane_index =
+               LLVMBuildExtractElement(builder, index, ii, "");
+            LLVMValueRef scalar_ptr =
+               LLVMBuildGEP(builder, ptr, &lane_index, 1, "store_ptr");
+
+            LLVMBuildStore(builder,
+                           LLVMBuildExtractElement(builder, value, ii, ""),
+                           scalar_ptr);
+         }
+         lp_build_endif(&ifthen);
+      }
+   }
+}
+
+/**
+ * The caller runs all invocations of a workgroup using barriers in a single
+ * vector (see llvmpipe's lp_state_cs.c), so barriers are trivially met.
+ * Memory barriers are no-ops as well, as every access is done in program
+ * order.
+ */
+static void
+barrier_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+}
+
 static void
 emit_vertex(
    const struct lp_build_tgsi_action * action,
@@ -3881,7 +4072,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef thread_data_ptr,
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface)
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface)
 {
    struct lp_build_tgsi_soa_context bld;
 
@@ -4022,6 +4214,14 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                                 max_output_vertices);
    }
 
+   if (cs_iface) {
+      bld.cs_iface = cs_iface;
+      bld.bld_base.op_actions[TGSI_OPCODE_LOAD].emit = load_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_STORE].emit = store_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_BARRIER].emit = barrier_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_MEMBAR].emit = barrier_emit;
+   }
+
    lp_exec_mask_init(&bld.exec_mask, &bld.bld_base.int_bld);
 
    bld.system_values = *system_values;
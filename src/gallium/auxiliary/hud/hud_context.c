@@ -63,6 +63,8 @@ struct hud_context {
    struct hud_batch_query_context *batch_query;
    struct list_head pane_list;
 
+   struct hud_phase_dump *phase_dump;
+
    /* states */
    struct pipe_blend_state alpha_blend;
    struct pipe_depth_stencil_alpha_state dsa;
@@ -452,6 +454,9 @@ hud_draw(struct hud_context *hud, struct pipe_resource *tex)
    struct hud_pane *pane;
    struct hud_graph *gr;
 
+   if (hud->phase_dump)
+      hud_phase_dump_frame(hud->phase_dump);
+
    if (!huds_visible)
       return;
 
@@ -918,10 +923,11 @@ hud_parse_env_var(struct hud_context *hud, const char *env)
                                 0);
       }
       else {
-         boolean processed = FALSE;
+         /* CPU time per frame phase */
+         boolean processed = hud_phase_graph_install(pane, name);
 
          /* pipeline statistics queries */
-         if (has_pipeline_stats_query(hud->pipe->screen)) {
+         if (!processed && has_pipeline_stats_query(hud->pipe->screen)) {
             static const char *pipeline_statistics_names[] =
             {
                "ia-vertices",
@@ -1082,6 +1088,11 @@ print_help(struct pipe_screen *screen)
    puts("");
    puts("  Example: GALLIUM_HUD=\".w256.h64.x1600.y520.d.c1000fps+cpu,.datom-count\"");
    puts("");
+   puts("  The phase-* graphs show the average CPU time per frame spent in");
+   puts("  the instrumented parts of the state tracker and driver.");
+   puts("  GALLIUM_HUD_PHASE_DUMP=file additionally writes one CSV line");
+   puts("  with these times per frame.");
+   puts("");
    puts("  Available names:");
    puts("    fps");
    puts("    cpu");
@@ -1089,6 +1100,11 @@ print_help(struct pipe_screen *screen)
    for (i = 0; i < num_cpus; i++)
       printf("    cpu%i\n", i);
 
+   puts("    phase-validate");
+   puts("    phase-draw");
+   puts("    phase-flush");
+   puts("    phase-shader-compile");
+
    if (has_occlusion_query(screen))
       puts("    samples-passed");
    if (has_streamout(screen))
@@ -1137,6 +1153,7 @@ hud_create(struct pipe_context *pipe, struct cso_context *cso)
    struct pipe_sampler_view view_templ;
    unsigned i;
    const char *env = debug_get_option("GALLIUM_HUD", NULL);
+   const char *phase_dump;
    unsigned signo = debug_get_num_option("GALLIUM_HUD_TOGGLE_SIGNAL", 0);
 #ifdef PIPE_OS_UNIX
    static boolean sig_handled = FALSE;
@@ -1303,6 +1320,14 @@ hud_create(struct pipe_context *pipe, struct cso_context *cso)
 #endif
 
    hud_parse_env_var(hud, env);
+
+   /* Dump the CPU time of each frame phase as CSV.
+    * Combine with GALLIUM_HUD_VISIBLE=false to only get the dump.
+    */
+   phase_dump = debug_get_option("GALLIUM_HUD_PHASE_DUMP", NULL);
+   if (phase_dump)
+      hud->phase_dump = hud_phase_dump_create(phase_dump);
+
    return hud;
 }
 
@@ -1323,6 +1348,8 @@ hud_destroy(struct hud_context *hud)
    }
 
    hud_batch_query_cleanup(&hud->batch_query);
+   if (hud->phase_dump)
+      hud_phase_dump_destroy(hud->phase_dump);
    pipe->delete_fs_state(pipe, hud->fs_color);
    pipe->delete_fs_state(pipe, hud->fs_text);
    pipe->delete_vs_state(pipe, hud->vs);
@@ -0,0 +1,186 @@
+/**************************************************************************
+ *
+ * Copyright 2016 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/* This file contains the HUD graphs and the CSV dump of the per-phase CPU
+ * times collected by util/u_phase.h.
+ */
+
+#include <stdio.h>
+
+#include "hud/hud_private.h"
+#include "os/os_time.h"
+#include "util/u_memory.h"
+#include "util/u_phase.h"
+
+struct phase_info {
+   enum util_phase phase;
+   uint64_t last_total;
+   uint64_t last_time;
+   uint64_t accum_ns;
+   unsigned frames;
+};
+
+static void
+query_phase(struct hud_graph *gr)
+{
+   struct phase_info *info = gr->query_data;
+   uint64_t now = os_time_get();
+   uint64_t total = util_phase_total_ns(info->phase);
+
+   info->accum_ns += total - info->last_total;
+   info->last_total = total;
+   info->frames++;
+
+   if (info->last_time) {
+      if (info->last_time + gr->pane->period <= now) {
+         /* average microseconds per frame */
+         hud_graph_add_value(gr, info->accum_ns / 1000 / info->frames);
+         info->accum_ns = 0;
+         info->frames = 0;
+         info->last_time = now;
+      }
+   }
+   else {
+      info->accum_ns = 0;
+      info->frames = 0;
+      info->last_time = now;
+   }
+}
+
+static void
+free_phase_info(void *p)
+{
+   FREE(p);
+   util_phase_disable();
+}
+
+/**
+ * Parse a "phase-<name>" graph name.  Return false if it doesn't name a
+ * phase.
+ */
+boolean
+hud_phase_graph_install(struct hud_pane *pane, const char *name)
+{
+   struct hud_graph *gr;
+   struct phase_info *info;
+   unsigned i;
+
+   if (strncmp(name, "phase-", 6) != 0)
+      return FALSE;
+
+   for (i = 0; i < UTIL_PHASE_COUNT; i++) {
+      if (strcmp(name + 6, util_phase_name(i)) == 0)
+         break;
+   }
+   if (i == UTIL_PHASE_COUNT)
+      return FALSE;
+
+   gr = CALLOC_STRUCT(hud_graph);
+   if (!gr)
+      return TRUE;
+
+   info = CALLOC_STRUCT(phase_info);
+   if (!info) {
+      FREE(gr);
+      return TRUE;
+   }
+
+   util_phase_enable();
+   info->phase = i;
+   info->last_total = util_phase_total_ns(i);
+
+   strcpy(gr->name, name);
+   gr->query_data = info;
+   gr->query_new_value = query_phase;
+   gr->free_query_data = free_phase_info;
+
+   hud_pane_add_graph(pane, gr);
+   pane->type = PIPE_DRIVER_QUERY_TYPE_MICROSECONDS;
+   return TRUE;
+}
+
+
+struct hud_phase_dump {
+   FILE *file;
+   unsigned frame;
+   uint64_t last_total[UTIL_PHASE_COUNT];
+};
+
+struct hud_phase_dump *
+hud_phase_dump_create(const char *filename)
+{
+   struct hud_phase_dump *dump;
+   unsigned i;
+
+   dump = CALLOC_STRUCT(hud_phase_dump);
+   if (!dump)
+      return NULL;
+
+   dump->file = fopen(filename, "w");
+   if (!dump->file) {
+      fprintf(stderr, "gallium_hud: can't open '%s' for writing\n", filename);
+      FREE(dump);
+      return NULL;
+   }
+
+   util_phase_enable();
+
+   fprintf(dump->file, "frame");
+   for (i = 0; i < UTIL_PHASE_COUNT; i++) {
+      dump->last_total[i] = util_phase_total_ns(i);
+      fprintf(dump->file, ",%s (us)", util_phase_name(i));
+   }
+   fprintf(dump->file, "\n");
+   return dump;
+}
+
+/**
+ * Write the time spent in each phase since the previous call as one CSV
+ * row.  Called once per frame.
+ */
+void
+hud_phase_dump_frame(struct hud_phase_dump *dump)
+{
+   unsigned i;
+
+   fprintf(dump->file, "%u", dump->frame++);
+   for (i = 0; i < UTIL_PHASE_COUNT; i++) {
+      uint64_t total = util_phase_total_ns(i);
+
+      fprintf(dump->file, ",%.1f", (total - dump->last_total[i]) / 1000.0);
+      dump->last_total[i] = total;
+   }
+   fprintf(dump->file, "\n");
+}
+
+void
+hud_phase_dump_destroy(struct hud_phase_dump *dump)
+{
+   fclose(dump->file);
+   FREE(dump);
+   util_phase_disable();
+}
@@ -87,6 +87,7 @@ struct hud_batch_query_context;
 int hud_get_num_cpus(void);
 
 void hud_fps_graph_install(struct hud_pane *pane);
+boolean hud_phase_graph_install(struct hud_pane *pane, const char *name);
 void hud_cpu_graph_install(struct hud_pane *pane, unsigned cpu_index);
 void hud_pipe_query_install(struct hud_batch_query_context **pbq,
                             struct hud_pane *pane, struct pipe_context *pipe,
@@ -102,4 +103,10 @@ boolean hud_driver_query_install(struct hud_batch_query_context **pbq,
 void hud_batch_query_update(struct hud_batch_query_context *bq);
 void hud_batch_query_cleanup(struct hud_batch_query_context **pbq);
 
+struct hud_phase_dump;
+
+struct hud_phase_dump *hud_phase_dump_create(const char *filename);
+void hud_phase_dump_frame(struct hud_phase_dump *dump);
+void hud_phase_dump_destroy(struct hud_phase_dump *dump);
+
 #endif
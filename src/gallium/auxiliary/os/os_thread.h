@@ -85,6 +85,11 @@ static inline int pipe_thread_destroy( pipe_thread thread )
    return thrd_detach( thread );
 }
 
+static inline boolean pipe_thread_is_self( pipe_thread thread )
+{
+   return thrd_equal(thrd_current(), thread);
+}
+
 static inline void pipe_thread_setname( const char *name )
 {
 #if defined(HAVE_PTHREAD)
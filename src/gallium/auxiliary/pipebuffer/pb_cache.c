@@ -27,10 +27,17 @@
  **************************************************************************/
 
 #include "pb_cache.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_time.h"
 
 
+static inline unsigned
+pb_cache_bucket_index(pb_size size)
+{
+   return util_logbase2(size);
+}
+
 /**
  * Actually destroy the buffer.
  */
@@ -42,9 +49,12 @@ destroy_buffer_locked(struct pb_cache_entry *entry)
    assert(!pipe_is_referenced(&entry->buffer->reference));
    if (entry->head.next) {
       LIST_DEL(&entry->head);
+      LIST_DEL(&entry->lru);
       assert(mgr->num_buffers);
       --mgr->num_buffers;
       mgr->cache_size -= entry->buffer->size;
+      mgr->bucket_size[pb_cache_bucket_index(entry->buffer->size)] -=
+         entry->buffer->size;
    }
    entry->mgr->destroy_buffer(entry->buffer);
 }
@@ -61,10 +71,10 @@ release_expired_buffers_locked(struct pb_cache *mgr)
 
    now = os_time_get();
 
-   curr = mgr->cache.next;
+   curr = mgr->lru.next;
    next = curr->next;
-   while (curr != &mgr->cache) {
-      entry = LIST_ENTRY(struct pb_cache_entry, curr, head);
+   while (curr != &mgr->lru) {
+      entry = LIST_ENTRY(struct pb_cache_entry, curr, lru);
 
       if (!os_time_timeout(entry->start, entry->end, now))
          break;
@@ -84,24 +94,39 @@ void
 pb_cache_add_buffer(struct pb_cache_entry *entry)
 {
    struct pb_cache *mgr = entry->mgr;
+   pb_size size = entry->buffer->size;
+   unsigned index = pb_cache_bucket_index(size);
+   struct list_head *bucket = &mgr->buckets[index];
 
    pipe_mutex_lock(mgr->mutex);
    assert(!pipe_is_referenced(&entry->buffer->reference));
 
    release_expired_buffers_locked(mgr);
 
-   /* Directly release any buffer that exceeds the limit. */
-   if (mgr->cache_size + entry->buffer->size > mgr->max_cache_size) {
+   /* Directly release any buffer that exceeds the limits. */
+   if (size > mgr->max_bucket_size) {
       entry->mgr->destroy_buffer(entry->buffer);
       pipe_mutex_unlock(mgr->mutex);
       return;
    }
 
+   /* Otherwise make room by releasing the oldest buffers, of the same size
+    * class first, so that a single size class can't fill up the cache. */
+   while (mgr->bucket_size[index] + size > mgr->max_bucket_size)
+      destroy_buffer_locked(LIST_ENTRY(struct pb_cache_entry,
+                                       bucket->next, head));
+
+   while (mgr->cache_size + size > mgr->max_cache_size)
+      destroy_buffer_locked(LIST_ENTRY(struct pb_cache_entry,
+                                       mgr->lru.next, lru));
+
    entry->start = os_time_get();
    entry->end = entry->start + mgr->usecs;
-   LIST_ADDTAIL(&entry->head, &mgr->cache);
+   LIST_ADDTAIL(&entry->head, bucket);
+   LIST_ADDTAIL(&entry->lru, &mgr->lru);
    ++mgr->num_buffers;
-   mgr->cache_size += entry->buffer->size;
+   mgr->cache_size += size;
+   mgr->bucket_size[index] += size;
    pipe_mutex_unlock(mgr->mutex);
 }
 
@@ -116,9 +141,6 @@ pb_cache_is_buffer_compat(struct pb_cache_entry *entry,
 {
    struct pb_buffer *buf = entry->buffer;
 
-   if (usage & entry->mgr->bypass_usage)
-      return 0;
-
    if (buf->size < size)
       return 0;
 
@@ -138,60 +160,46 @@ pb_cache_is_buffer_compat(struct pb_cache_entry *entry,
 /**
  * Find a compatible buffer in the cache, return it, and remove it
  * from the cache.
+ *
+ * Only the size classes which can contain buffers between size and
+ * size_factor * size are searched.
  */
 struct pb_buffer *
 pb_cache_reclaim_buffer(struct pb_cache *mgr, pb_size size,
                         unsigned alignment, unsigned usage)
 {
-   struct pb_cache_entry *entry;
-   struct pb_cache_entry *cur_entry;
-   struct list_head *cur, *next;
-   int64_t now;
-   int ret = 0;
+   struct pb_cache_entry *entry = NULL;
+   unsigned first, last, i;
+   double max_size;
 
-   pipe_mutex_lock(mgr->mutex);
+   if (usage & mgr->bypass_usage)
+      return NULL;
 
-   entry = NULL;
-   cur = mgr->cache.next;
-   next = cur->next;
+   max_size = MIN2((double) mgr->size_factor * size, (double) ~(pb_size)0);
+   first = pb_cache_bucket_index(size);
+   last = pb_cache_bucket_index((pb_size) max_size);
 
-   /* search in the expired buffers, freeing them in the process */
-   now = os_time_get();
-   while (cur != &mgr->cache) {
-      cur_entry = LIST_ENTRY(struct pb_cache_entry, cur, head);
-
-      if (!entry && (ret = pb_cache_is_buffer_compat(cur_entry, size,
-                                                     alignment, usage) > 0))
-         entry = cur_entry;
-      else if (os_time_timeout(cur_entry->start, cur_entry->end, now))
-         destroy_buffer_locked(cur_entry);
-      else
-         /* This buffer (and all hereafter) are still hot in cache */
-         break;
+   pipe_mutex_lock(mgr->mutex);
 
-      /* the buffer is busy (and probably all remaining ones too) */
-      if (ret == -1)
-         break;
+   release_expired_buffers_locked(mgr);
 
-      cur = next;
-      next = cur->next;
-   }
+   for (i = first; i <= last && !entry; i++) {
+      struct list_head *bucket = &mgr->buckets[i];
+      struct list_head *cur;
 
-   /* keep searching in the hot buffers */
-   if (!entry && ret != -1) {
-      while (cur != &mgr->cache) {
-         cur_entry = LIST_ENTRY(struct pb_cache_entry, cur, head);
-         ret = pb_cache_is_buffer_compat(cur_entry, size, alignment, usage);
+      for (cur = bucket->next; cur != bucket; cur = cur->next) {
+         struct pb_cache_entry *cur_entry =
+            LIST_ENTRY(struct pb_cache_entry, cur, head);
+         int ret = pb_cache_is_buffer_compat(cur_entry, size,
+                                             alignment, usage);
 
          if (ret > 0) {
             entry = cur_entry;
             break;
          }
+         /* the buffer is busy (and probably all newer ones too) */
          if (ret == -1)
             break;
-         /* no need to check the timeout here */
-         cur = next;
-         next = cur->next;
       }
    }
 
@@ -200,7 +208,9 @@ pb_cache_reclaim_buffer(struct pb_cache *mgr, pb_size size,
       struct pb_buffer *buf = entry->buffer;
 
       mgr->cache_size -= buf->size;
+      mgr->bucket_size[pb_cache_bucket_index(buf->size)] -= buf->size;
       LIST_DEL(&entry->head);
+      LIST_DEL(&entry->lru);
       --mgr->num_buffers;
       pipe_mutex_unlock(mgr->mutex);
       /* Increase refcount */
@@ -222,10 +232,10 @@ pb_cache_release_all_buffers(struct pb_cache *mgr)
    struct pb_cache_entry *buf;
 
    pipe_mutex_lock(mgr->mutex);
-   curr = mgr->cache.next;
+   curr = mgr->lru.next;
    next = curr->next;
-   while (curr != &mgr->cache) {
-      buf = LIST_ENTRY(struct pb_cache_entry, curr, head);
+   while (curr != &mgr->lru) {
+      buf = LIST_ENTRY(struct pb_cache_entry, curr, lru);
       destroy_buffer_locked(buf);
       curr = next;
       next = curr->next;
@@ -253,7 +263,8 @@ pb_cache_init_entry(struct pb_cache *mgr, struct pb_cache_entry *entry,
  * @param bypass_usage  Bitmask. If (requested usage & bypass_usage) != 0,
  *                      buffer allocation requests are rejected.
  * @param maximum_cache_size  Maximum size of all unused buffers the cache can
- *                            hold.
+ *                            hold. Buffers of one size class may use at most
+ *                            half of it.
  * @param destroy_buffer  Function that destroys a buffer for good.
  * @param can_reclaim     Whether a buffer can be reclaimed (e.g. is not busy)
  */
@@ -263,10 +274,17 @@ pb_cache_init(struct pb_cache *mgr, uint usecs, float size_factor,
               void (*destroy_buffer)(struct pb_buffer *buf),
               bool (*can_reclaim)(struct pb_buffer *buf))
 {
-   LIST_INITHEAD(&mgr->cache);
+   unsigned i;
+
+   for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++) {
+      LIST_INITHEAD(&mgr->buckets[i]);
+      mgr->bucket_size[i] = 0;
+   }
+   LIST_INITHEAD(&mgr->lru);
    pipe_mutex_init(mgr->mutex);
    mgr->cache_size = 0;
    mgr->max_cache_size = maximum_cache_size;
+   mgr->max_bucket_size = maximum_cache_size / 2;
    mgr->usecs = usecs;
    mgr->num_buffers = 0;
    mgr->bypass_usage = bypass_usage;
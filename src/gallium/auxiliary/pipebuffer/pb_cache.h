@@ -33,12 +33,17 @@
 #include "util/list.h"
 #include "os/os_thread.h"
 
+/* Number of size classes; cached buffers are bucketed by log2 of their size.
+ */
+#define PB_CACHE_NUM_BUCKETS (sizeof(pb_size) * 8)
+
 /**
  * Statically inserted into the driver-specific buffer structure.
  */
 struct pb_cache_entry
 {
-   struct list_head head;
+   struct list_head head; /**< in the size class bucket */
+   struct list_head lru;  /**< in the list of all cached buffers */
    struct pb_buffer *buffer; /**< Pointer to the structure this is part of. */
    struct pb_cache *mgr;
    int64_t start, end; /**< Caching time interval */
@@ -46,10 +51,16 @@ struct pb_cache_entry
 
 struct pb_cache
 {
-   struct list_head cache;
+   /* Both kinds of lists are sorted by the time the buffers were added,
+    * oldest first. */
+   struct list_head buckets[PB_CACHE_NUM_BUCKETS];
+   uint64_t bucket_size[PB_CACHE_NUM_BUCKETS];
+   struct list_head lru;
+
    pipe_mutex mutex;
    uint64_t cache_size;
    uint64_t max_cache_size;
+   uint64_t max_bucket_size;
    unsigned usecs;
    unsigned num_buffers;
    unsigned bypass_usage;
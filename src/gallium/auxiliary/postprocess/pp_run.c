@@ -254,8 +254,8 @@ pp_tgsi_to_state(struct pipe_context *pipe, const char *text, bool isvs,
       return NULL;
    }
 
+   memset(&state, 0, sizeof(state));
    state.tokens = tokens;
-   memset(&state.stream_output, 0, sizeof(state.stream_output));
 
    if (isvs) {
       ret_state = pipe->create_vs_state(pipe, &state);
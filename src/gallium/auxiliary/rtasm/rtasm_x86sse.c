@@ -1508,6 +1508,70 @@ void sse2_rcpss( struct x86_function *p,
    emit_modrm( p, dst, src );
 }
 
+/***********************************************************************
+ * SSE4.1 instructions
+ */
+static void sse4_1_emit_pmov( struct x86_function *p,
+                              unsigned char op,
+                              struct x86_reg dst,
+                              struct x86_reg src )
+{
+   emit_3ub(p, 0x66, X86_TWOB, 0x38);
+   emit_1ub(p, op);
+   emit_modrm( p, dst, src );
+}
+
+void sse4_1_pmovzxbd( struct x86_function *p,
+                      struct x86_reg dst,
+                      struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   sse4_1_emit_pmov(p, 0x31, dst, src);
+}
+
+void sse4_1_pmovzxwd( struct x86_function *p,
+                      struct x86_reg dst,
+                      struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   sse4_1_emit_pmov(p, 0x33, dst, src);
+}
+
+void sse4_1_pmovsxbd( struct x86_function *p,
+                      struct x86_reg dst,
+                      struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   sse4_1_emit_pmov(p, 0x21, dst, src);
+}
+
+void sse4_1_pmovsxwd( struct x86_function *p,
+                      struct x86_reg dst,
+                      struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   sse4_1_emit_pmov(p, 0x23, dst, src);
+}
+
+/***********************************************************************
+ * F16C instructions
+ */
+
+/**
+ * Convert the four half floats in the low 64 bits of src to floats.
+ * Encoded as VEX.128.66.0F38.W0 13 /r; only the low eight registers
+ * are supported, like emit_modrm().
+ */
+void f16c_vcvtph2ps( struct x86_function *p,
+                     struct x86_reg dst,
+                     struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_3ub(p, 0xC4, 0xE2, 0x79);
+   emit_1ub(p, 0x13);
+   emit_modrm( p, dst, src );
+}
+
 /***********************************************************************
  * x87 instructions
  */
@@ -2164,6 +2228,8 @@ static void x86_init_func_common( struct x86_function *p )
       p->caps |= X86_SSE3;
    if(util_cpu_caps.has_sse4_1)
       p->caps |= X86_SSE4_1;
+   if(util_cpu_caps.has_f16c)
+      p->caps |= X86_F16C;
    p->csr = p->store;
    DUMP_START();
 }
@@ -61,6 +61,7 @@
 #include "util/u_half.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
+#include "util/u_sse.h"
 
 
 #define DEBUG_EXECUTION 0
@@ -507,10 +508,15 @@ micro_mad(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
+#if defined(PIPE_ARCH_SSE)
+   __m128 a = _mm_mul_ps(_mm_loadu_ps(src0->f), _mm_loadu_ps(src1->f));
+   _mm_storeu_ps(dst->f, _mm_add_ps(a, _mm_loadu_ps(src2->f)));
+#else
    dst->f[0] = src0->f[0] * src1->f[0] + src2->f[0];
    dst->f[1] = src0->f[1] * src1->f[1] + src2->f[1];
    dst->f[2] = src0->f[2] * src1->f[2] + src2->f[2];
    dst->f[3] = src0->f[3] * src1->f[3] + src2->f[3];
+#endif
 }
 
 static void
@@ -845,53 +851,37 @@ tgsi_check_soa_dependencies(const struct tgsi_full_instruction *inst)
 
 
 /**
- * Initialize machine state by expanding tokens to full instructions,
- * allocating temporary storage, setting up constants, etc.
+ * Initialize machine state from a decoded shader: load immediates,
+ * allocate geometry shader storage, etc.
  * After this, we can call tgsi_exec_machine_run() many times.
  */
-void 
-tgsi_exec_machine_bind_shader(
+void
+tgsi_exec_machine_bind_decoded(
    struct tgsi_exec_machine *mach,
-   const struct tgsi_token *tokens,
+   const struct tgsi_decoded_shader *decoded,
    struct tgsi_sampler *sampler)
 {
-   uint k;
-   struct tgsi_parse_context parse;
-   struct tgsi_full_instruction *instructions;
-   struct tgsi_full_declaration *declarations;
-   uint maxInstructions = 10, numInstructions = 0;
-   uint maxDeclarations = 10, numDeclarations = 0;
-
-#if 0
-   tgsi_dump(tokens, 0);
-#endif
+   uint i, j;
 
    util_init_math();
 
+   /* drop the shader decoded by a previous tgsi_exec_machine_bind_shader() */
+   if (mach->OwnedDecoded != decoded) {
+      tgsi_free_decoded_shader(mach->OwnedDecoded);
+      mach->OwnedDecoded = NULL;
+   }
 
-   mach->Tokens = tokens;
    mach->Sampler = sampler;
+   mach->Tokens = NULL;
+   mach->Declarations = NULL;
+   mach->NumDeclarations = 0;
+   mach->Instructions = NULL;
+   mach->NumInstructions = 0;
 
-   if (!tokens) {
-      /* unbind and free all */
-      FREE(mach->Declarations);
-      mach->Declarations = NULL;
-      mach->NumDeclarations = 0;
-
-      FREE(mach->Instructions);
-      mach->Instructions = NULL;
-      mach->NumInstructions = 0;
-
-      return;
-   }
-
-   k = tgsi_parse_init (&parse, mach->Tokens);
-   if (k != TGSI_PARSE_OK) {
-      debug_printf( "Problem parsing!\n" );
+   if (!decoded)
       return;
-   }
 
-   mach->Processor = parse.FullHeader.Processor.Processor;
+   mach->Processor = decoded->processor;
    mach->ImmLimit = 0;
    mach->NumOutputs = 0;
 
@@ -923,104 +913,72 @@ tgsi_exec_machine_bind_shader(
       mach->UsedGeometryShader = TRUE;
    }
 
-   declarations = (struct tgsi_full_declaration *)
-      MALLOC( maxDeclarations * sizeof(struct tgsi_full_declaration) );
+   for (i = 0; i < decoded->num_declarations; i++) {
+      const struct tgsi_full_declaration *decl = &decoded->declarations[i];
 
-   if (!declarations) {
-      return;
+      if (decl->Declaration.File == TGSI_FILE_OUTPUT) {
+         mach->NumOutputs += decl->Range.Last - decl->Range.First + 1;
+      }
    }
 
-   instructions = (struct tgsi_full_instruction *)
-      MALLOC( maxInstructions * sizeof(struct tgsi_full_instruction) );
+   for (i = 0; i < decoded->num_immediates; i++) {
+      const struct tgsi_full_immediate *imm = &decoded->immediates[i];
+      uint size = imm->Immediate.NrTokens - 1;
+      assert( size <= 4 );
+      assert( mach->ImmLimit + 1 <= TGSI_EXEC_NUM_IMMEDIATES );
 
-   if (!instructions) {
-      FREE( declarations );
-      return;
+      for (j = 0; j < size; j++) {
+         mach->Imms[mach->ImmLimit][j] = imm->u[j].Float;
+      }
+      mach->ImmLimit += 1;
    }
 
-   while( !tgsi_parse_end_of_tokens( &parse ) ) {
-      uint i;
-
-      tgsi_parse_token( &parse );
-      switch( parse.FullToken.Token.Type ) {
-      case TGSI_TOKEN_TYPE_DECLARATION:
-         /* save expanded declaration */
-         if (numDeclarations == maxDeclarations) {
-            declarations = REALLOC(declarations,
-                                   maxDeclarations
-                                   * sizeof(struct tgsi_full_declaration),
-                                   (maxDeclarations + 10)
-                                   * sizeof(struct tgsi_full_declaration));
-            maxDeclarations += 10;
-         }
-         if (parse.FullToken.FullDeclaration.Declaration.File == TGSI_FILE_OUTPUT) {
-            unsigned reg;
-            for (reg = parse.FullToken.FullDeclaration.Range.First;
-                 reg <= parse.FullToken.FullDeclaration.Range.Last;
-                 ++reg) {
-               ++mach->NumOutputs;
-            }
-         }
-         memcpy(declarations + numDeclarations,
-                &parse.FullToken.FullDeclaration,
-                sizeof(declarations[0]));
-         numDeclarations++;
-         break;
+   for (i = 0; i < decoded->num_properties; i++) {
+      const struct tgsi_full_property *prop = &decoded->properties[i];
 
-      case TGSI_TOKEN_TYPE_IMMEDIATE:
-         {
-            uint size = parse.FullToken.FullImmediate.Immediate.NrTokens - 1;
-            assert( size <= 4 );
-            assert( mach->ImmLimit + 1 <= TGSI_EXEC_NUM_IMMEDIATES );
+      if (mach->Processor == TGSI_PROCESSOR_GEOMETRY &&
+          prop->Property.PropertyName == TGSI_PROPERTY_GS_MAX_OUTPUT_VERTICES) {
+         mach->MaxOutputVertices = prop->u[0].Data;
+      }
+   }
 
-            for( i = 0; i < size; i++ ) {
-               mach->Imms[mach->ImmLimit][i] = 
-		  parse.FullToken.FullImmediate.u[i].Float;
-            }
-            mach->ImmLimit += 1;
-         }
-         break;
+   mach->Tokens = decoded->tokens;
 
-      case TGSI_TOKEN_TYPE_INSTRUCTION:
+   mach->Declarations = decoded->declarations;
+   mach->NumDeclarations = decoded->num_declarations;
 
-         /* save expanded instruction */
-         if (numInstructions == maxInstructions) {
-            instructions = REALLOC(instructions,
-                                   maxInstructions
-                                   * sizeof(struct tgsi_full_instruction),
-                                   (maxInstructions + 10)
-                                   * sizeof(struct tgsi_full_instruction));
-            maxInstructions += 10;
-         }
+   mach->Instructions = decoded->instructions;
+   mach->NumInstructions = decoded->num_instructions;
+}
 
-         memcpy(instructions + numInstructions,
-                &parse.FullToken.FullInstruction,
-                sizeof(instructions[0]));
 
-         numInstructions++;
-         break;
+/**
+ * Initialize machine state by expanding tokens to full instructions,
+ * allocating temporary storage, setting up constants, etc.
+ * After this, we can call tgsi_exec_machine_run() many times.
+ */
+void 
+tgsi_exec_machine_bind_shader(
+   struct tgsi_exec_machine *mach,
+   const struct tgsi_token *tokens,
+   struct tgsi_sampler *sampler)
+{
+   struct tgsi_decoded_shader *decoded = NULL;
 
-      case TGSI_TOKEN_TYPE_PROPERTY:
-         if (mach->Processor == TGSI_PROCESSOR_GEOMETRY) {
-            if (parse.FullToken.FullProperty.Property.PropertyName == TGSI_PROPERTY_GS_MAX_OUTPUT_VERTICES) {
-               mach->MaxOutputVertices = parse.FullToken.FullProperty.u[0].Data;
-            }
-         }
-         break;
+#if 0
+   tgsi_dump(tokens, 0);
+#endif
 
-      default:
-         assert( 0 );
+   if (tokens) {
+      decoded = tgsi_decode_shader(tokens);
+      if (!decoded) {
+         debug_printf( "Problem parsing!\n" );
+         return;
       }
    }
-   tgsi_parse_free (&parse);
-
-   FREE(mach->Declarations);
-   mach->Declarations = declarations;
-   mach->NumDeclarations = numDeclarations;
 
-   FREE(mach->Instructions);
-   mach->Instructions = instructions;
-   mach->NumInstructions = numInstructions;
+   tgsi_exec_machine_bind_decoded(mach, decoded, sampler);
+   mach->OwnedDecoded = decoded;
 }
 
 
@@ -1081,8 +1039,7 @@ void
 tgsi_exec_machine_destroy(struct tgsi_exec_machine *mach)
 {
    if (mach) {
-      FREE(mach->Instructions);
-      FREE(mach->Declarations);
+      tgsi_free_decoded_shader(mach->OwnedDecoded);
 
       align_free(mach->Inputs);
       align_free(mach->Outputs);
@@ -1096,10 +1053,14 @@ micro_add(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   _mm_storeu_ps(dst->f, _mm_add_ps(_mm_loadu_ps(src0->f), _mm_loadu_ps(src1->f)));
+#else
    dst->f[0] = src0->f[0] + src1->f[0];
    dst->f[1] = src0->f[1] + src1->f[1];
    dst->f[2] = src0->f[2] + src1->f[2];
    dst->f[3] = src0->f[3] + src1->f[3];
+#endif
 }
 
 static void
@@ -1141,10 +1102,14 @@ micro_max(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   _mm_storeu_ps(dst->f, _mm_max_ps(_mm_loadu_ps(src0->f), _mm_loadu_ps(src1->f)));
+#else
    dst->f[0] = src0->f[0] > src1->f[0] ? src0->f[0] : src1->f[0];
    dst->f[1] = src0->f[1] > src1->f[1] ? src0->f[1] : src1->f[1];
    dst->f[2] = src0->f[2] > src1->f[2] ? src0->f[2] : src1->f[2];
    dst->f[3] = src0->f[3] > src1->f[3] ? src0->f[3] : src1->f[3];
+#endif
 }
 
 static void
@@ -1152,10 +1117,14 @@ micro_min(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   _mm_storeu_ps(dst->f, _mm_min_ps(_mm_loadu_ps(src0->f), _mm_loadu_ps(src1->f)));
+#else
    dst->f[0] = src0->f[0] < src1->f[0] ? src0->f[0] : src1->f[0];
    dst->f[1] = src0->f[1] < src1->f[1] ? src0->f[1] : src1->f[1];
    dst->f[2] = src0->f[2] < src1->f[2] ? src0->f[2] : src1->f[2];
    dst->f[3] = src0->f[3] < src1->f[3] ? src0->f[3] : src1->f[3];
+#endif
 }
 
 static void
@@ -1163,10 +1132,14 @@ micro_mul(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   _mm_storeu_ps(dst->f, _mm_mul_ps(_mm_loadu_ps(src0->f), _mm_loadu_ps(src1->f)));
+#else
    dst->f[0] = src0->f[0] * src1->f[0];
    dst->f[1] = src0->f[1] * src1->f[1];
    dst->f[2] = src0->f[2] * src1->f[2];
    dst->f[3] = src0->f[3] * src1->f[3];
+#endif
 }
 
 static void
@@ -1204,10 +1177,14 @@ micro_sub(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   _mm_storeu_ps(dst->f, _mm_sub_ps(_mm_loadu_ps(src0->f), _mm_loadu_ps(src1->f)));
+#else
    dst->f[0] = src0->f[0] - src1->f[0];
    dst->f[1] = src0->f[1] - src1->f[1];
    dst->f[2] = src0->f[2] - src1->f[2];
    dst->f[3] = src0->f[3] - src1->f[3];
+#endif
 }
 
 static void
@@ -1331,6 +1308,60 @@ fetch_src_file_channel(const struct tgsi_exec_machine *mach,
    }
 }
 
+/**
+ * Fetch a channel of a directly addressed, one dimensional source register.
+ * All four lanes read the same register here, so there is no need to build
+ * the per-lane index vectors of fetch_src_file_channel().
+ * Returns FALSE if the register file is not handled.
+ */
+static boolean
+fetch_src_file_channel_direct(const struct tgsi_exec_machine *mach,
+                              const uint file,
+                              const uint swizzle,
+                              const int index,
+                              union tgsi_exec_channel *chan)
+{
+   assert(swizzle < 4);
+
+   switch (file) {
+   case TGSI_FILE_CONSTANT:
+      assert(mach->Consts[0]);
+      {
+         const uint *buf = (const uint *)mach->Consts[0];
+         const int pos = index * 4 + swizzle;
+         /* const buffer bounds check */
+         const uint val = (index < 0 || pos >= (int) mach->ConstsSize[0]) ?
+                             0 : buf[pos];
+         chan->u[0] = chan->u[1] = chan->u[2] = chan->u[3] = val;
+      }
+      return TRUE;
+
+   case TGSI_FILE_INPUT:
+      assert(index >= 0);
+      *chan = mach->Inputs[index].xyzw[swizzle];
+      return TRUE;
+
+   case TGSI_FILE_TEMPORARY:
+      assert(index < TGSI_EXEC_NUM_TEMPS);
+      *chan = mach->Temps[index].xyzw[swizzle];
+      return TRUE;
+
+   case TGSI_FILE_IMMEDIATE:
+      assert(index >= 0 && index < (int)mach->ImmLimit);
+      chan->f[0] = chan->f[1] = chan->f[2] = chan->f[3] =
+         mach->Imms[index][swizzle];
+      return TRUE;
+
+   case TGSI_FILE_OUTPUT:
+      assert(index >= 0);
+      *chan = mach->Outputs[index].xyzw[swizzle];
+      return TRUE;
+
+   default:
+      return FALSE;
+   }
+}
+
 static void
 fetch_source_d(const struct tgsi_exec_machine *mach,
                union tgsi_exec_channel *chan,
@@ -1342,6 +1373,19 @@ fetch_source_d(const struct tgsi_exec_machine *mach,
    union tgsi_exec_channel index2D;
    uint swizzle;
 
+   /* Most source operands are plain file[1] accesses; handle those without
+    * going through the generic per-lane indexing below.
+    */
+   if (!reg->Register.Indirect && !reg->Register.Dimension) {
+      swizzle = tgsi_util_get_full_src_register_swizzle( reg, chan_index );
+      if (fetch_src_file_channel_direct(mach,
+                                        reg->Register.File,
+                                        swizzle,
+                                        reg->Register.Index,
+                                        chan))
+         return;
+   }
+
    /* We start with a direct index into a register file.
     *
     *    file[1],
@@ -1767,6 +1811,10 @@ store_dest(struct tgsi_exec_machine *mach,
       return;
 
    if (!inst->Instruction.Saturate) {
+      if (execmask == 0xf) {
+         *dst = *chan;
+         return;
+      }
       for (i = 0; i < TGSI_QUAD_SIZE; i++)
          if (execmask & (1 << i))
             dst->i[i] = chan->i[i];
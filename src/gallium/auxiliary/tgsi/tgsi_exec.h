@@ -37,6 +37,8 @@
 extern "C" {
 #endif
 
+struct tgsi_decoded_shader;
+
 #define TGSI_CHAN_X 0
 #define TGSI_CHAN_Y 1
 #define TGSI_CHAN_Z 2
@@ -361,6 +363,9 @@ struct tgsi_exec_machine
    struct tgsi_full_declaration *Declarations;
    uint NumDeclarations;
 
+   /** Decoded shader allocated by tgsi_exec_machine_bind_shader() */
+   struct tgsi_decoded_shader *OwnedDecoded;
+
    struct tgsi_declaration_sampler_view
       SamplerViews[PIPE_MAX_SHADER_SAMPLER_VIEWS];
 
@@ -380,6 +385,18 @@ tgsi_exec_machine_bind_shader(
    const struct tgsi_token *tokens,
    struct tgsi_sampler *sampler);
 
+/**
+ * Like tgsi_exec_machine_bind_shader(), but binds a shader decoded by the
+ * caller with tgsi_decode_shader().  The machine only references it, so
+ * it must stay alive until the machine is unbound or bound to another
+ * shader.
+ */
+void
+tgsi_exec_machine_bind_decoded(
+   struct tgsi_exec_machine *mach,
+   const struct tgsi_decoded_shader *decoded,
+   struct tgsi_sampler *sampler);
+
 uint
 tgsi_exec_machine_run(
    struct tgsi_exec_machine *mach );
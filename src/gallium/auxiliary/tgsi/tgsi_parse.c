@@ -332,3 +332,108 @@ tgsi_get_processor_type(const struct tgsi_token *tokens)
    }
    return parse.FullHeader.Processor.Processor;
 }
+
+
+/**
+ * Append one element of element_size bytes to a growable array.
+ * \return FALSE on out of memory
+ */
+static boolean
+append_decoded(void **array, unsigned *count, unsigned *max,
+               const void *elem, size_t element_size)
+{
+   if (*count == *max) {
+      unsigned new_max = *max ? *max * 2 : 16;
+      void *new_array = REALLOC(*array, *max * element_size,
+                                new_max * element_size);
+      if (!new_array)
+         return FALSE;
+      *array = new_array;
+      *max = new_max;
+   }
+   memcpy((char *) *array + *count * element_size, elem, element_size);
+   (*count)++;
+   return TRUE;
+}
+
+
+/**
+ * Parse a whole token stream into a tgsi_decoded_shader.
+ * \return NULL if the tokens can't be parsed or on out of memory
+ */
+struct tgsi_decoded_shader *
+tgsi_decode_shader(const struct tgsi_token *tokens)
+{
+   struct tgsi_parse_context parse;
+   struct tgsi_decoded_shader *decoded;
+   unsigned max_declarations = 0, max_immediates = 0;
+   unsigned max_instructions = 0, max_properties = 0;
+   boolean ok = TRUE;
+
+   if (tgsi_parse_init(&parse, tokens) != TGSI_PARSE_OK)
+      return NULL;
+
+   decoded = CALLOC_STRUCT(tgsi_decoded_shader);
+   if (!decoded) {
+      tgsi_parse_free(&parse);
+      return NULL;
+   }
+
+   decoded->tokens = tokens;
+   decoded->processor = parse.FullHeader.Processor.Processor;
+
+   while (ok && !tgsi_parse_end_of_tokens(&parse)) {
+      tgsi_parse_token(&parse);
+
+      switch (parse.FullToken.Token.Type) {
+      case TGSI_TOKEN_TYPE_DECLARATION:
+         ok = append_decoded((void **) &decoded->declarations,
+                             &decoded->num_declarations, &max_declarations,
+                             &parse.FullToken.FullDeclaration,
+                             sizeof(decoded->declarations[0]));
+         break;
+      case TGSI_TOKEN_TYPE_IMMEDIATE:
+         ok = append_decoded((void **) &decoded->immediates,
+                             &decoded->num_immediates, &max_immediates,
+                             &parse.FullToken.FullImmediate,
+                             sizeof(decoded->immediates[0]));
+         break;
+      case TGSI_TOKEN_TYPE_INSTRUCTION:
+         ok = append_decoded((void **) &decoded->instructions,
+                             &decoded->num_instructions, &max_instructions,
+                             &parse.FullToken.FullInstruction,
+                             sizeof(decoded->instructions[0]));
+         break;
+      case TGSI_TOKEN_TYPE_PROPERTY:
+         ok = append_decoded((void **) &decoded->properties,
+                             &decoded->num_properties, &max_properties,
+                             &parse.FullToken.FullProperty,
+                             sizeof(decoded->properties[0]));
+         break;
+      default:
+         assert(0);
+      }
+   }
+
+   tgsi_parse_free(&parse);
+
+   if (!ok) {
+      tgsi_free_decoded_shader(decoded);
+      return NULL;
+   }
+
+   return decoded;
+}
+
+
+void
+tgsi_free_decoded_shader(struct tgsi_decoded_shader *decoded)
+{
+   if (decoded) {
+      FREE(decoded->declarations);
+      FREE(decoded->immediates);
+      FREE(decoded->instructions);
+      FREE(decoded->properties);
+      FREE(decoded);
+   }
+}
@@ -157,6 +157,36 @@ tgsi_free_tokens(const struct tgsi_token *tokens);
 unsigned
 tgsi_get_processor_type(const struct tgsi_token *tokens);
 
+
+/**
+ * A shader decoded into flat arrays of full tokens.  Consumers which walk
+ * the same shader many times can build this once, keep it with the shader
+ * object and iterate over it instead of calling tgsi_parse_token() again.
+ */
+struct tgsi_decoded_shader
+{
+   const struct tgsi_token *tokens;  /**< not owned */
+   unsigned processor;  /**< TGSI_PROCESSOR_x */
+
+   struct tgsi_full_declaration *declarations;
+   unsigned num_declarations;
+
+   struct tgsi_full_immediate *immediates;
+   unsigned num_immediates;
+
+   struct tgsi_full_instruction *instructions;
+   unsigned num_instructions;
+
+   struct tgsi_full_property *properties;
+   unsigned num_properties;
+};
+
+struct tgsi_decoded_shader *
+tgsi_decode_shader(const struct tgsi_token *tokens);
+
+void
+tgsi_free_decoded_shader(struct tgsi_decoded_shader *decoded);
+
 #if defined __cplusplus
 }
 #endif
@@ -531,9 +531,12 @@ translate_attr_convert(struct translate_sse *p,
                            input_desc->channel[0].size *
                            input_desc->nr_channels >> 3);
 
-            /* TODO: add support for SSE4.1 pmovzx */
             switch (input_desc->channel[0].size) {
             case 8:
+               if (x86_target_caps(p->func) & X86_SSE4_1) {
+                  sse4_1_pmovzxbd(p->func, dataXMM, dataXMM);
+                  break;
+               }
                /* TODO: this may be inefficient due to get_identity() being
                 *  used both as a float and integer register.
                 */
@@ -541,6 +544,10 @@ translate_attr_convert(struct translate_sse *p,
                sse2_punpcklbw(p->func, dataXMM, get_const(p, CONST_IDENTITY));
                break;
             case 16:
+               if (x86_target_caps(p->func) & X86_SSE4_1) {
+                  sse4_1_pmovzxwd(p->func, dataXMM, dataXMM);
+                  break;
+               }
                sse2_punpcklwd(p->func, dataXMM, get_const(p, CONST_IDENTITY));
                break;
             case 32:           /* we lose precision here */
@@ -583,14 +590,21 @@ translate_attr_convert(struct translate_sse *p,
                            input_desc->channel[0].size *
                            input_desc->nr_channels >> 3);
 
-            /* TODO: add support for SSE4.1 pmovsx */
             switch (input_desc->channel[0].size) {
             case 8:
+               if (x86_target_caps(p->func) & X86_SSE4_1) {
+                  sse4_1_pmovsxbd(p->func, dataXMM, dataXMM);
+                  break;
+               }
                sse2_punpcklbw(p->func, dataXMM, dataXMM);
                sse2_punpcklbw(p->func, dataXMM, dataXMM);
                sse2_psrad_imm(p->func, dataXMM, 24);
                break;
             case 16:
+               if (x86_target_caps(p->func) & X86_SSE4_1) {
+                  sse4_1_pmovsxwd(p->func, dataXMM, dataXMM);
+                  break;
+               }
                sse2_punpcklwd(p->func, dataXMM, dataXMM);
                sse2_psrad_imm(p->func, dataXMM, 16);
                break;
@@ -626,6 +640,14 @@ translate_attr_convert(struct translate_sse *p,
 
             break;
          case UTIL_FORMAT_TYPE_FLOAT:
+            if (input_desc->channel[0].size == 16) {
+               /* the zero-extending loads leave 0.0 in the unused channels */
+               if (!(x86_target_caps(p->func) & X86_F16C))
+                  return FALSE;
+               emit_load_sse2(p, dataXMM, src, 2 * input_desc->nr_channels);
+               f16c_vcvtph2ps(p->func, dataXMM, dataXMM);
+               break;
+            }
             if (input_desc->channel[0].size != 32
                 && input_desc->channel[0].size != 64) {
                return FALSE;
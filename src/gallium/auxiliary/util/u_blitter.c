@@ -540,6 +540,20 @@ static void blitter_unset_running_flag(struct blitter_context_priv *ctx)
    ctx->base.running = FALSE;
 }
 
+/**
+ * Inside a batch, keep the saved states of the given group bound for the
+ * next operation and restore them in util_blitter_end_batch instead.
+ */
+static boolean blitter_hold_states(struct blitter_context_priv *ctx,
+                                   unsigned group)
+{
+   if (!ctx->base.in_batch)
+      return FALSE;
+
+   ctx->base.held_states |= group;
+   return TRUE;
+}
+
 static void blitter_check_saved_vertex_states(struct blitter_context_priv *ctx)
 {
    assert(ctx->base.saved_velem_state != INVALID_PTR);
@@ -556,6 +570,9 @@ static void blitter_restore_vertex_states(struct blitter_context_priv *ctx)
    struct pipe_context *pipe = ctx->base.pipe;
    unsigned i;
 
+   if (blitter_hold_states(ctx, UTIL_BLITTER_HELD_VERTEX))
+      return;
+
    /* Vertex buffer. */
    pipe->set_vertex_buffers(pipe, ctx->base.vb_slot, 1,
                             &ctx->base.saved_vertex_buffer);
@@ -613,6 +630,9 @@ static void blitter_restore_fragment_states(struct blitter_context_priv *ctx)
 {
    struct pipe_context *pipe = ctx->base.pipe;
 
+   if (blitter_hold_states(ctx, UTIL_BLITTER_HELD_FRAGMENT))
+      return;
+
    /* Fragment shader. */
    ctx->bind_fs_state(pipe, ctx->base.saved_fs);
    ctx->base.saved_fs = INVALID_PTR;
@@ -656,7 +676,8 @@ static void blitter_restore_render_cond(struct blitter_context_priv *ctx)
 {
    struct pipe_context *pipe = ctx->base.pipe;
 
-   if (ctx->base.saved_render_cond_query) {
+   if (ctx->base.saved_render_cond_query &&
+       !blitter_hold_states(ctx, UTIL_BLITTER_HELD_RENDER_COND)) {
       pipe->render_condition(pipe, ctx->base.saved_render_cond_query,
                              ctx->base.saved_render_cond_cond,
                              ctx->base.saved_render_cond_mode);
@@ -668,6 +689,9 @@ static void blitter_restore_fb_state(struct blitter_context_priv *ctx)
 {
    struct pipe_context *pipe = ctx->base.pipe;
 
+   if (blitter_hold_states(ctx, UTIL_BLITTER_HELD_FRAMEBUFFER))
+      return;
+
    pipe->set_framebuffer_state(pipe, &ctx->base.saved_fb_state);
    util_unreference_framebuffer_state(&ctx->base.saved_fb_state);
 }
@@ -683,6 +707,9 @@ static void blitter_restore_textures(struct blitter_context_priv *ctx)
    struct pipe_context *pipe = ctx->base.pipe;
    unsigned i;
 
+   if (blitter_hold_states(ctx, UTIL_BLITTER_HELD_TEXTURES))
+      return;
+
    /* Fragment sampler states. */
    pipe->bind_sampler_states(pipe, PIPE_SHADER_FRAGMENT, 0,
                              ctx->base.saved_num_sampler_states,
@@ -701,6 +728,39 @@ static void blitter_restore_textures(struct blitter_context_priv *ctx)
    ctx->base.saved_num_sampler_views = ~0;
 }
 
+void util_blitter_begin_batch(struct blitter_context *blitter)
+{
+   assert(!blitter->in_batch && !blitter->running);
+
+   blitter->in_batch = TRUE;
+   blitter->held_states = 0;
+}
+
+void util_blitter_end_batch(struct blitter_context *blitter)
+{
+   struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
+   struct pipe_context *pipe = ctx->base.pipe;
+   unsigned held = blitter->held_states;
+
+   assert(blitter->in_batch && !blitter->running);
+
+   blitter->in_batch = FALSE;
+   blitter->held_states = 0;
+
+   if (held & UTIL_BLITTER_HELD_VERTEX)
+      blitter_restore_vertex_states(ctx);
+   if (held & UTIL_BLITTER_HELD_FRAGMENT)
+      blitter_restore_fragment_states(ctx);
+   if (held & UTIL_BLITTER_HELD_TEXTURES)
+      blitter_restore_textures(ctx);
+   if (held & UTIL_BLITTER_HELD_FRAMEBUFFER)
+      blitter_restore_fb_state(ctx);
+   if (held & UTIL_BLITTER_HELD_SCISSOR)
+      pipe->set_scissor_states(pipe, 0, 1, &ctx->base.saved_scissor);
+   if (held & UTIL_BLITTER_HELD_RENDER_COND)
+      blitter_restore_render_cond(ctx);
+}
+
 static void blitter_set_rectangle(struct blitter_context_priv *ctx,
                                   int x1, int y1, int x2, int y2,
                                   float depth)
@@ -1776,7 +1836,7 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
    blitter_restore_fragment_states(ctx);
    blitter_restore_textures(ctx);
    blitter_restore_fb_state(ctx);
-   if (scissor) {
+   if (scissor && !blitter_hold_states(ctx, UTIL_BLITTER_HELD_SCISSOR)) {
       pipe->set_scissor_states(pipe, 0, 1, &ctx->base.saved_scissor);
    }
    blitter_restore_render_cond(ctx);
@@ -95,6 +95,13 @@ struct blitter_context
    /* Whether the blitter is running. */
    boolean running;
 
+   /* Whether we are between util_blitter_begin_batch and
+    * util_blitter_end_batch, and which groups of saved states
+    * (UTIL_BLITTER_HELD_*) have been kept instead of restored since.
+    */
+   boolean in_batch;
+   unsigned held_states;
+
    /* Private members, really. */
    struct pipe_context *pipe; /**< pipe context */
 
@@ -128,6 +135,13 @@ struct blitter_context
    boolean saved_render_cond_cond;
 };
 
+#define UTIL_BLITTER_HELD_VERTEX       (1 << 0)
+#define UTIL_BLITTER_HELD_FRAGMENT     (1 << 1)
+#define UTIL_BLITTER_HELD_SCISSOR      (1 << 2)
+#define UTIL_BLITTER_HELD_FRAMEBUFFER  (1 << 3)
+#define UTIL_BLITTER_HELD_TEXTURES     (1 << 4)
+#define UTIL_BLITTER_HELD_RENDER_COND  (1 << 5)
+
 /**
  * Create a blitter context.
  */
@@ -365,6 +379,18 @@ void util_blitter_custom_resolve_color(struct blitter_context *blitter,
                                        void *custom_blend,
                                        enum pipe_format format);
 
+/* Start a batch of blitter operations.
+ *
+ * Inside a batch the states saved for the first operation are kept rather
+ * than restored after each operation, and the save functions below ignore
+ * states that are already held, so a driver can keep saving its states
+ * before every operation as usual. Everything held is restored once in
+ * util_blitter_end_batch. Meant for loops like decompressing all levels and
+ * layers of a texture, where nothing but the blitter draws in between. */
+void util_blitter_begin_batch(struct blitter_context *blitter);
+
+void util_blitter_end_batch(struct blitter_context *blitter);
+
 /* The functions below should be used to save currently bound constant state
  * objects inside a driver. The objects are automatically restored at the end
  * of the util_blitter_{clear, copy_region, fill_region} functions and then
@@ -372,9 +398,17 @@ void util_blitter_custom_resolve_color(struct blitter_context *blitter,
  *
  * States not listed here are not affected by util_blitter. */
 
+static inline boolean
+util_blitter_is_held(struct blitter_context *blitter, unsigned group)
+{
+   return (blitter->held_states & group) != 0;
+}
+
 static inline void
 util_blitter_save_blend(struct blitter_context *blitter, void *state)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_FRAGMENT))
+      return;
    blitter->saved_blend_state = state;
 }
 
@@ -382,12 +416,16 @@ static inline void
 util_blitter_save_depth_stencil_alpha(struct blitter_context *blitter,
                                       void *state)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_FRAGMENT))
+      return;
    blitter->saved_dsa_state = state;
 }
 
 static inline void
 util_blitter_save_vertex_elements(struct blitter_context *blitter, void *state)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_VERTEX))
+      return;
    blitter->saved_velem_state = state;
 }
 
@@ -395,30 +433,40 @@ static inline void
 util_blitter_save_stencil_ref(struct blitter_context *blitter,
                               const struct pipe_stencil_ref *state)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_FRAGMENT))
+      return;
    blitter->saved_stencil_ref = *state;
 }
 
 static inline void
 util_blitter_save_rasterizer(struct blitter_context *blitter, void *state)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_VERTEX))
+      return;
    blitter->saved_rs_state = state;
 }
 
 static inline void
 util_blitter_save_fragment_shader(struct blitter_context *blitter, void *fs)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_FRAGMENT))
+      return;
    blitter->saved_fs = fs;
 }
 
 static inline void
 util_blitter_save_vertex_shader(struct blitter_context *blitter, void *vs)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_VERTEX))
+      return;
    blitter->saved_vs = vs;
 }
 
 static inline void
 util_blitter_save_geometry_shader(struct blitter_context *blitter, void *gs)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_VERTEX))
+      return;
    blitter->saved_gs = gs;
 }
 
@@ -426,6 +474,8 @@ static inline void
 util_blitter_save_tessctrl_shader(struct blitter_context *blitter,
                                   void *sh)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_VERTEX))
+      return;
    blitter->saved_tcs = sh;
 }
 
@@ -433,6 +483,8 @@ static inline void
 util_blitter_save_tesseval_shader(struct blitter_context *blitter,
                                   void *sh)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_VERTEX))
+      return;
    blitter->saved_tes = sh;
 }
 
@@ -440,6 +492,8 @@ static inline void
 util_blitter_save_framebuffer(struct blitter_context *blitter,
                               const struct pipe_framebuffer_state *state)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_FRAMEBUFFER))
+      return;
    blitter->saved_fb_state.nr_cbufs = 0; /* It's ~0 now, meaning it's unsaved. */
    util_copy_framebuffer_state(&blitter->saved_fb_state, state);
 }
@@ -448,6 +502,8 @@ static inline void
 util_blitter_save_viewport(struct blitter_context *blitter,
                            struct pipe_viewport_state *state)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_FRAGMENT))
+      return;
    blitter->saved_viewport = *state;
 }
 
@@ -455,6 +511,8 @@ static inline void
 util_blitter_save_scissor(struct blitter_context *blitter,
                           struct pipe_scissor_state *state)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_SCISSOR))
+      return;
    blitter->saved_scissor = *state;
 }
 
@@ -464,6 +522,8 @@ util_blitter_save_fragment_sampler_states(
                   unsigned num_sampler_states,
                   void **sampler_states)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_TEXTURES))
+      return;
    assert(num_sampler_states <= Elements(blitter->saved_sampler_states));
 
    blitter->saved_num_sampler_states = num_sampler_states;
@@ -477,6 +537,9 @@ util_blitter_save_fragment_sampler_views(struct blitter_context *blitter,
                                          struct pipe_sampler_view **views)
 {
    unsigned i;
+
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_TEXTURES))
+      return;
    assert(num_views <= Elements(blitter->saved_sampler_views));
 
    blitter->saved_num_sampler_views = num_views;
@@ -489,6 +552,8 @@ static inline void
 util_blitter_save_vertex_buffer_slot(struct blitter_context *blitter,
                                      struct pipe_vertex_buffer *vertex_buffers)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_VERTEX))
+      return;
    pipe_resource_reference(&blitter->saved_vertex_buffer.buffer,
                            vertex_buffers[blitter->vb_slot].buffer);
    memcpy(&blitter->saved_vertex_buffer, &vertex_buffers[blitter->vb_slot],
@@ -501,6 +566,9 @@ util_blitter_save_so_targets(struct blitter_context *blitter,
                              struct pipe_stream_output_target **targets)
 {
    unsigned i;
+
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_VERTEX))
+      return;
    assert(num_targets <= Elements(blitter->saved_so_targets));
 
    blitter->saved_num_so_targets = num_targets;
@@ -513,6 +581,8 @@ static inline void
 util_blitter_save_sample_mask(struct blitter_context *blitter,
                               unsigned sample_mask)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_FRAGMENT))
+      return;
    blitter->is_sample_mask_saved = TRUE;
    blitter->saved_sample_mask = sample_mask;
 }
@@ -523,6 +593,8 @@ util_blitter_save_render_condition(struct blitter_context *blitter,
                                    boolean condition,
                                    uint mode)
 {
+   if (util_blitter_is_held(blitter, UTIL_BLITTER_HELD_RENDER_COND))
+      return;
    blitter->saved_render_cond_query = query;
    blitter->saved_render_cond_mode = mode;
    blitter->saved_render_cond_cond = condition;
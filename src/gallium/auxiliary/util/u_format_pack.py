@@ -611,11 +611,297 @@ def generate_pack_kernel(format, src_channel, src_native_type):
         print_channels(format, pack_into_union)
 
 
+def sse2_unpack_float_kind(format):
+    '''Return the kind of SSE2 row kernel usable to unpack this format into
+    floats, or None when only the scalar path applies.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB or format.block_width != 1:
+        return None
+
+    channels = format.le_channels
+
+    if format.is_bitmask() and format.block_size() in (16, 32):
+        for channel in channels:
+            if channel.type == VOID:
+                continue
+            if channel.type != UNSIGNED or not channel.norm or channel.size >= 32:
+                return None
+        return 'bitmask'
+
+    if format.block_size() == 64:
+        for channel in channels:
+            if channel.size != 16 or channel.type not in (VOID, FLOAT):
+                return None
+        return 'half'
+
+    return None
+
+
+def is_sse2_rgba8(format):
+    '''Whether the format has four 8 bit unorm channels (or padding) in a
+    32 bit word, which the 8unorm and float packing kernels handle.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB or format.block_width != 1:
+        return False
+    if not format.is_bitmask() or format.block_size() != 32:
+        return False
+    for channel in format.le_channels:
+        if channel.size != 8:
+            return False
+        if channel.type != VOID and (channel.type != UNSIGNED or not channel.norm):
+            return False
+    return True
+
+
+def sse2_kernel_name(format, direction, suffix):
+    if direction == 'unpack':
+        if suffix == 'rgba_float' and sse2_unpack_float_kind(format):
+            return 'util_format_%s_unpack_%s_sse2' % (format.short_name(), suffix)
+        if suffix == 'rgba_8unorm' and is_sse2_rgba8(format):
+            return 'util_format_%s_unpack_%s_sse2' % (format.short_name(), suffix)
+    else:
+        if suffix in ('rgba_float', 'rgba_8unorm') and is_sse2_rgba8(format):
+            return 'util_format_%s_pack_%s_sse2' % (format.short_name(), suffix)
+    return None
+
+
+def sse2_swizzle_expr(vectors, swizzles):
+    '''Return the float vector expressions of the four destination
+    channels, given one float vector per source channel.'''
+
+    exprs = []
+    for i in range(4):
+        swizzle = swizzles[i]
+        if swizzle < 4:
+            exprs.append(vectors[swizzle])
+        elif swizzle == SWIZZLE_1:
+            exprs.append('_mm_set1_ps(1.0f)')
+        else:
+            exprs.append('_mm_setzero_ps()')
+    return exprs
+
+
+def generate_unpack_sse2_bitmask(format):
+    depth = format.block_size()
+    channels = format.le_channels
+
+    print '      __m128i value;'
+    print '      __m128 c0, c1, c2, c3;'
+    for i in range(format.nr_channels()):
+        if channels[i].type != VOID:
+            print '      __m128 ch%u;' % i
+    if depth == 16:
+        print '      value = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)src), _mm_setzero_si128());'
+    else:
+        print '      value = _mm_loadu_si128((const __m128i *)src);'
+
+    vectors = [None]*4
+    for i in range(format.nr_channels()):
+        channel = channels[i]
+        if channel.type == VOID:
+            continue
+        value = 'value'
+        if channel.shift:
+            value = '_mm_srli_epi32(%s, %u)' % (value, channel.shift)
+        if channel.shift + channel.size < depth:
+            value = '_mm_and_si128(%s, _mm_set1_epi32(0x%x))' % (value, (1 << channel.size) - 1)
+        print '      ch%u = _mm_mul_ps(_mm_cvtepi32_ps(%s), _mm_set1_ps(1.0f/0x%x));' % (i, value, (1 << channel.size) - 1)
+        vectors[i] = 'ch%u' % i
+
+    exprs = sse2_swizzle_expr(vectors, format.le_swizzles)
+    for i in range(4):
+        print '      c%u = %s;' % (i, exprs[i])
+    print '      _MM_TRANSPOSE4_PS(c0, c1, c2, c3);'
+    print '      _mm_storeu_ps(dst + 0, c0);'
+    print '      _mm_storeu_ps(dst + 4, c1);'
+    print '      _mm_storeu_ps(dst + 8, c2);'
+    print '      _mm_storeu_ps(dst + 12, c3);'
+
+
+def generate_unpack_sse2_half(format):
+    swizzles = format.le_swizzles
+
+    # Shuffle the memory channels into place, then blend in the constant
+    # channels.
+    shuffle = [0]*4
+    keep = ['0']*4
+    consts = ['0.0f']*4
+    needs_blend = False
+    for i in range(4):
+        swizzle = swizzles[i]
+        if swizzle < 4:
+            shuffle[i] = swizzle
+            keep[i] = '~0'
+        else:
+            needs_blend = True
+            if swizzle == SWIZZLE_1:
+                consts[i] = '1.0f'
+
+    print '      __m128i lo = _mm_loadu_si128((const __m128i *)src);'
+    print '      __m128i hi = _mm_loadu_si128((const __m128i *)(src + 16));'
+    print '      __m128 p[4];'
+    print '      unsigned i;'
+    print '      p[0] = util_format_sse2_half_to_float(_mm_unpacklo_epi16(lo, _mm_setzero_si128()));'
+    print '      p[1] = util_format_sse2_half_to_float(_mm_unpackhi_epi16(lo, _mm_setzero_si128()));'
+    print '      p[2] = util_format_sse2_half_to_float(_mm_unpacklo_epi16(hi, _mm_setzero_si128()));'
+    print '      p[3] = util_format_sse2_half_to_float(_mm_unpackhi_epi16(hi, _mm_setzero_si128()));'
+    print '      for (i = 0; i < 4; i++) {'
+    value = 'p[i]'
+    if shuffle != [0, 1, 2, 3]:
+        value = '_mm_shuffle_ps(%s, %s, _MM_SHUFFLE(%u, %u, %u, %u))' % (value, value, shuffle[3], shuffle[2], shuffle[1], shuffle[0])
+    if needs_blend:
+        value = '_mm_or_ps(_mm_and_ps(%s, _mm_castsi128_ps(_mm_setr_epi32(%s))), _mm_setr_ps(%s))' % (value, ', '.join(keep), ', '.join(consts))
+    print '         _mm_storeu_ps(dst + 4*i, %s);' % value
+    print '      }'
+
+
+def generate_rgba8_shuffle(dst_shifts, src_shifts, consts):
+    '''Emit code computing "value" from the 32 bit words in "pixels" by
+    moving the byte at src_shifts[i] to dst_shifts[i].'''
+
+    terms = []
+    if consts:
+        terms.append('_mm_set1_epi32(0x%x)' % consts)
+    for dst_shift, src_shift in zip(dst_shifts, src_shifts):
+        term = 'pixels'
+        if src_shift:
+            term = '_mm_srli_epi32(%s, %u)' % (term, src_shift)
+        if src_shift != 24:
+            term = '_mm_and_si128(%s, _mm_set1_epi32(0xff))' % term
+        if dst_shift:
+            term = '_mm_slli_epi32(%s, %u)' % (term, dst_shift)
+        terms.append(term)
+
+    if not terms:
+        terms.append('_mm_setzero_si128()')
+    print '      value = %s;' % terms[0]
+    for term in terms[1:]:
+        print '      value = _mm_or_si128(value, %s);' % term
+
+
+def generate_unpack_sse2_rgba8(format):
+    channels = format.le_channels
+    swizzles = format.le_swizzles
+    dst_shifts = []
+    src_shifts = []
+    consts = 0
+    for i in range(4):
+        swizzle = swizzles[i]
+        if swizzle < 4:
+            dst_shifts.append(8*i)
+            src_shifts.append(channels[swizzle].shift)
+        elif swizzle == SWIZZLE_1:
+            consts |= 0xff << (8*i)
+
+    print '      __m128i pixels = _mm_loadu_si128((const __m128i *)src);'
+    print '      __m128i value;'
+    generate_rgba8_shuffle(dst_shifts, src_shifts, consts)
+    print '      _mm_storeu_si128((__m128i *)dst, value);'
+
+
+def generate_pack_sse2_rgba8(format, src_suffix):
+    channels = format.le_channels
+    inv_swizzle = inv_swizzles(format.le_swizzles)
+
+    print '      __m128i pixels;'
+    print '      __m128i value;'
+    if src_suffix == 'rgba_float':
+        print '      __m128 c0 = _mm_loadu_ps(src + 0);'
+        print '      __m128 c1 = _mm_loadu_ps(src + 4);'
+        print '      __m128 c2 = _mm_loadu_ps(src + 8);'
+        print '      __m128 c3 = _mm_loadu_ps(src + 12);'
+        print '      __m128i r, g, b, a;'
+        print '      _MM_TRANSPOSE4_PS(c0, c1, c2, c3);'
+        print '      r = util_format_sse2_float_to_ubyte(c0);'
+        print '      g = util_format_sse2_float_to_ubyte(c1);'
+        print '      b = util_format_sse2_float_to_ubyte(c2);'
+        print '      a = util_format_sse2_float_to_ubyte(c3);'
+        print '      pixels = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),'
+        print '                            _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));'
+    else:
+        print '      pixels = _mm_loadu_si128((const __m128i *)src);'
+
+    dst_shifts = []
+    src_shifts = []
+    for i in range(4):
+        channel = channels[i]
+        if channel.type == VOID or inv_swizzle[i] is None:
+            continue
+        dst_shifts.append(channel.shift)
+        src_shifts.append(8*inv_swizzle[i])
+
+    generate_rgba8_shuffle(dst_shifts, src_shifts, 0)
+    print '      _mm_storeu_si128((__m128i *)dst, value);'
+
+
+def generate_format_sse2(format, direction, native_type, suffix):
+    '''Generate a SSE2 kernel which converts the largest multiple of four
+    pixels of a row and returns how many pixels it did.'''
+
+    name = sse2_kernel_name(format, direction, suffix)
+    if name is None:
+        return
+
+    print '#if defined(PIPE_ARCH_SSE)'
+    print 'static inline unsigned'
+    if direction == 'unpack':
+        print '%s(%s *dst, const uint8_t *src, unsigned width)' % (name, native_type)
+    else:
+        print '%s(uint8_t *dst, const %s *src, unsigned width)' % (name, native_type)
+    print '{'
+    print '   unsigned x;'
+    print '   for(x = 0; x + 4 <= width; x += 4) {'
+    if direction == 'unpack':
+        if suffix == 'rgba_8unorm':
+            generate_unpack_sse2_rgba8(format)
+        elif sse2_unpack_float_kind(format) == 'half':
+            generate_unpack_sse2_half(format)
+        else:
+            generate_unpack_sse2_bitmask(format)
+        print '      src += %u;' % (format.block_size() / 2,)
+        print '      dst += 16;'
+    else:
+        generate_pack_sse2_rgba8(format, suffix)
+        print '      src += 16;'
+        print '      dst += %u;' % (format.block_size() / 2,)
+    print '   }'
+    print '   return x;'
+    print '}'
+    print '#endif'
+    print
+
+
+def generate_sse2_dispatch(format, direction, suffix):
+    '''Emit the row prologue handing the bulk of a row to the SSE2 kernel,
+    if there is one, leaving the remainder to the scalar loop.'''
+
+    name = sse2_kernel_name(format, direction, suffix)
+    if name is None:
+        print '      x = 0;'
+        return
+
+    if direction == 'unpack':
+        src_size, dst_size = format.block_size() / 8, 4
+    else:
+        src_size, dst_size = 4, format.block_size() / 8
+
+    print '      x = 0;'
+    print '#if defined(PIPE_ARCH_SSE)'
+    print '      if (util_cpu_caps.has_sse2) {'
+    print '         x = %s(dst, src, width);' % name
+    print '         src += x * %u;' % src_size
+    print '         dst += x * %u;' % dst_size
+    print '      }'
+    print '#endif'
+
+
 def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     '''Generate the function to unpack pixels from a particular format'''
 
     name = format.short_name()
 
+    generate_format_sse2(format, 'unpack', dst_native_type, dst_suffix)
+
     print 'static inline void'
     print 'util_format_%s_unpack_%s(%s *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, dst_suffix, dst_native_type)
     print '{'
@@ -625,7 +911,8 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
         print '      %s *dst = dst_row;' % (dst_native_type)
         print '      const uint8_t *src = src_row;'
-        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
+        generate_sse2_dispatch(format, 'unpack', dst_suffix)
+        print '      for(; x < width; x += %u) {' % (format.block_width,)
         
         generate_unpack_kernel(format, dst_channel, dst_native_type)
     
@@ -645,6 +932,8 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
 
     name = format.short_name()
 
+    generate_format_sse2(format, 'pack', src_native_type, src_suffix)
+
     print 'static inline void'
     print 'util_format_%s_pack_%s(uint8_t *dst_row, unsigned dst_stride, const %s *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, src_suffix, src_native_type)
     print '{'
@@ -654,7 +943,8 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
         print '      const %s *src = src_row;' % (src_native_type)
         print '      uint8_t *dst = dst_row;'
-        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
+        generate_sse2_dispatch(format, 'pack', src_suffix)
+        print '      for(; x < width; x += %u) {' % (format.block_width,)
     
         generate_pack_kernel(format, src_channel, src_native_type)
             
@@ -699,6 +989,37 @@ def generate(formats):
     print '#include "util/format_srgb.h"'
     print '#include "u_format_yuv.h"'
     print '#include "u_format_zs.h"'
+    print '#include "u_cpu_detect.h"'
+    print
+    print '#if defined(PIPE_ARCH_SSE)'
+    print '#include <emmintrin.h>'
+    print
+    print '/* Same as float_to_ubyte(), four at a time. */'
+    print 'static inline __m128i'
+    print 'util_format_sse2_float_to_ubyte(__m128 f)'
+    print '{'
+    print '   __m128i i = _mm_castps_si128(f);'
+    print '   __m128i zero = _mm_cmplt_epi32(i, _mm_setzero_si128());'
+    print '   __m128i one = _mm_cmpgt_epi32(i, _mm_set1_epi32(0x3f7fffff));'
+    print '   __m128i value;'
+    print '   f = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.0f/256.0f)), _mm_set1_ps(32768.0f));'
+    print '   value = _mm_and_si128(_mm_castps_si128(f), _mm_set1_epi32(0xff));'
+    print '   value = _mm_andnot_si128(_mm_or_si128(zero, one), value);'
+    print '   return _mm_or_si128(value, _mm_and_si128(one, _mm_set1_epi32(0xff)));'
+    print '}'
+    print
+    print '/* Same as util_half_to_float(), on the low halves of four dwords. */'
+    print 'static inline __m128'
+    print 'util_format_sse2_half_to_float(__m128i h)'
+    print '{'
+    print '   __m128 f = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13));'
+    print '   __m128 infnan;'
+    print '   f = _mm_mul_ps(f, _mm_castsi128_ps(_mm_set1_epi32(0xef << 23)));'
+    print '   infnan = _mm_cmpge_ps(f, _mm_set1_ps(65536.0f));'
+    print '   f = _mm_or_ps(f, _mm_and_ps(infnan, _mm_castsi128_ps(_mm_set1_epi32(0xff << 23))));'
+    print '   return _mm_or_ps(f, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16)));'
+    print '}'
+    print '#endif'
     print
 
     for format in formats:
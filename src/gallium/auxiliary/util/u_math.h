@@ -523,6 +523,34 @@ u_bit_scan_consecutive_range(unsigned *mask, int *start, int *count)
    *mask &= ~(((1 << *count) - 1) << *start);
 }
 
+#ifndef _MSC_VER
+static inline void
+u_bit_scan_consecutive_range64(uint64_t *mask, int *start, int *count)
+{
+   if (*mask == ~0llu) {
+      *start = 0;
+      *count = 64;
+      *mask = 0;
+      return;
+   }
+   *start = ffsll(*mask) - 1;
+   *count = ffsll(~(*mask >> *start)) - 1;
+   *mask &= ~(((1llu << *count) - 1) << *start);
+}
+#endif
+
+/* Returns a bitfield in which the first count bits starting at start are
+ * set.
+ */
+static inline uint64_t
+u_bit_consecutive64(unsigned start, unsigned count)
+{
+   assert(start + count <= 64);
+   if (count == 64)
+      return ~0llu;
+   return ((1llu << count) - 1) << start;
+}
+
 /**
  * Return float bits.
  */
@@ -0,0 +1,67 @@
+/**************************************************************************
+ *
+ * Copyright 2016 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#include "util/u_debug.h"
+#include "util/u_phase.h"
+
+
+int util_phase_listeners = 0;
+uint64_t util_phase_time_ns[UTIL_PHASE_COUNT];
+
+
+const char *
+util_phase_name(enum util_phase phase)
+{
+   static const char *names[UTIL_PHASE_COUNT] = {
+      "validate",
+      "draw",
+      "flush",
+      "shader-compile",
+   };
+
+   assert(phase < UTIL_PHASE_COUNT);
+   return names[phase];
+}
+
+
+/**
+ * Start accumulating phase times.  Calls nest; the timers stay on until
+ * every util_phase_enable() is matched by util_phase_disable().
+ */
+void
+util_phase_enable(void)
+{
+   p_atomic_inc(&util_phase_listeners);
+}
+
+
+void
+util_phase_disable(void)
+{
+   assert(p_atomic_read(&util_phase_listeners) > 0);
+   p_atomic_dec(&util_phase_listeners);
+}
@@ -0,0 +1,103 @@
+/**************************************************************************
+ *
+ * Copyright 2016 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * CPU time accounting for the phases of a frame.
+ *
+ * State trackers and drivers bracket their expensive phases with
+ * util_phase_begin()/util_phase_end().  The time is accumulated process
+ * wide, and consumers like the HUD sample the totals once per frame.
+ * While nobody listens (see util_phase_enable()) the timers cost a load
+ * and a branch.
+ *
+ * Phases may nest, e.g. shader compiles usually happen during state
+ * validation and are counted in both.
+ */
+
+#ifndef U_PHASE_H
+#define U_PHASE_H
+
+#include "pipe/p_compiler.h"
+#include "os/os_time.h"
+#include "util/u_atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum util_phase {
+   UTIL_PHASE_VALIDATE,        /**< state validation */
+   UTIL_PHASE_DRAW,            /**< draw calls into the driver */
+   UTIL_PHASE_FLUSH,           /**< context flushes */
+   UTIL_PHASE_SHADER_COMPILE,  /**< shader variant creation */
+   UTIL_PHASE_COUNT
+};
+
+extern int util_phase_listeners;
+extern uint64_t util_phase_time_ns[UTIL_PHASE_COUNT];
+
+const char *
+util_phase_name(enum util_phase phase);
+
+void
+util_phase_enable(void);
+
+void
+util_phase_disable(void);
+
+/**
+ * Start timing a phase.  Returns the value to pass to util_phase_end().
+ */
+static inline int64_t
+util_phase_begin(void)
+{
+   return p_atomic_read(&util_phase_listeners) ? os_time_get_nano() : 0;
+}
+
+static inline void
+util_phase_end(enum util_phase phase, int64_t start)
+{
+   if (start)
+      p_atomic_add(&util_phase_time_ns[phase],
+                   (uint64_t)(os_time_get_nano() - start));
+}
+
+/**
+ * Total time spent in a phase while timers were enabled, in nanoseconds.
+ */
+static inline uint64_t
+util_phase_total_ns(enum util_phase phase)
+{
+   return p_atomic_read(&util_phase_time_ns[phase]);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_PHASE_H */
@@ -22,6 +22,7 @@
 
 #include "util/u_slab.h"
 
+#include "util/u_atomic.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/simple_list.h"
@@ -169,3 +170,205 @@ void util_slab_destroy(struct util_slab_mempool *pool)
 
    pipe_mutex_destroy(pool->mutex);
 }
+
+
+/* Parent/child pools.
+ *
+ * Each element is preceded by a header pointing at the child pool owning
+ * it.  When the owner is destroyed, the headers of all its elements are
+ * pointed at their page with the lowest bit set instead, and the page
+ * counts the elements still in use.
+ */
+
+struct util_slab_element_header {
+   struct util_slab_element_header *next;
+
+   /* Owning child pool, or page pointer | 1 when orphaned. */
+   intptr_t owner;
+};
+
+struct util_slab_page_header {
+   union {
+      /* Next page in the owning child pool. */
+      struct util_slab_page_header *next;
+
+      /* Number of elements still in use once the page is orphaned. */
+      unsigned num_remaining;
+   } u;
+
+   /* Memory after the last member is dedicated to the elements. */
+};
+
+static struct util_slab_element_header *
+util_slab_get_element(struct util_slab_parent_pool *parent,
+                      struct util_slab_page_header *page, unsigned index)
+{
+   return (struct util_slab_element_header*)
+          ((uint8_t*)&page[1] + (parent->element_size * index));
+}
+
+void util_slab_create_parent(struct util_slab_parent_pool *parent,
+                             unsigned item_size,
+                             unsigned num_items)
+{
+   pipe_mutex_init(parent->mutex);
+   parent->element_size = align(sizeof(struct util_slab_element_header) +
+                                item_size, sizeof(intptr_t));
+   parent->num_elements = num_items;
+}
+
+void util_slab_destroy_parent(struct util_slab_parent_pool *parent)
+{
+   pipe_mutex_destroy(parent->mutex);
+}
+
+void util_slab_create_child(struct util_slab_child_pool *pool,
+                            struct util_slab_parent_pool *parent)
+{
+   pool->parent = parent;
+   pool->pages = NULL;
+   pool->free = NULL;
+   pool->migrated = NULL;
+}
+
+static void
+util_slab_free_orphaned(struct util_slab_element_header *elt)
+{
+   struct util_slab_page_header *page;
+
+   assert(elt->owner & 1);
+
+   page = (struct util_slab_page_header *)(elt->owner & ~(intptr_t)1);
+   if (!p_atomic_dec_return(&page->u.num_remaining))
+      FREE(page);
+}
+
+/**
+ * Destroy a child pool.  Elements which are still in use get orphaned and
+ * their pages are released once they are all freed.
+ */
+void util_slab_destroy_child(struct util_slab_child_pool *pool)
+{
+   struct util_slab_parent_pool *parent = pool->parent;
+   struct util_slab_element_header *elt;
+   unsigned i;
+
+   /* The mutex keeps other pools from migrating elements to us while the
+    * owners are switched. */
+   pipe_mutex_lock(parent->mutex);
+
+   while (pool->pages) {
+      struct util_slab_page_header *page = pool->pages;
+
+      pool->pages = page->u.next;
+      p_atomic_set(&page->u.num_remaining, parent->num_elements);
+
+      for (i = 0; i < parent->num_elements; ++i) {
+         elt = util_slab_get_element(parent, page, i);
+         p_atomic_set(&elt->owner, (intptr_t)page | 1);
+      }
+   }
+
+   while (pool->migrated) {
+      elt = pool->migrated;
+      pool->migrated = elt->next;
+      util_slab_free_orphaned(elt);
+   }
+
+   pipe_mutex_unlock(parent->mutex);
+
+   while (pool->free) {
+      elt = pool->free;
+      pool->free = elt->next;
+      util_slab_free_orphaned(elt);
+   }
+
+   pool->parent = NULL;
+}
+
+static boolean
+util_slab_child_add_new_page(struct util_slab_child_pool *pool)
+{
+   struct util_slab_parent_pool *parent = pool->parent;
+   struct util_slab_page_header *page;
+   unsigned i;
+
+   page = MALLOC(sizeof(struct util_slab_page_header) +
+                 parent->num_elements * parent->element_size);
+   if (!page)
+      return FALSE;
+
+   for (i = 0; i < parent->num_elements; ++i) {
+      struct util_slab_element_header *elt =
+         util_slab_get_element(parent, page, i);
+
+      elt->owner = (intptr_t)pool;
+      elt->next = pool->free;
+      pool->free = elt;
+   }
+
+   page->u.next = pool->pages;
+   pool->pages = page;
+   return TRUE;
+}
+
+/**
+ * Allocate an element.  Only the thread owning the child pool may call
+ * this.  The memory is not zeroed.
+ */
+void *util_slab_child_alloc(struct util_slab_child_pool *pool)
+{
+   struct util_slab_element_header *elt;
+
+   if (!pool->free) {
+      /* Take back the elements freed through other pools first. */
+      pipe_mutex_lock(pool->parent->mutex);
+      pool->free = pool->migrated;
+      pool->migrated = NULL;
+      pipe_mutex_unlock(pool->parent->mutex);
+
+      if (!pool->free && !util_slab_child_add_new_page(pool))
+         return NULL;
+   }
+
+   elt = pool->free;
+   pool->free = elt->next;
+   return &elt[1];
+}
+
+/**
+ * Free an element allocated from any child pool of the same parent.  Only
+ * the thread owning the given child pool may call this.
+ */
+void util_slab_child_free(struct util_slab_child_pool *pool, void *ptr)
+{
+   struct util_slab_element_header *elt =
+      (struct util_slab_element_header*)ptr - 1;
+   intptr_t owner;
+
+   if (!ptr)
+      return;
+
+   /* The common case: the element is ours. */
+   if (p_atomic_read(&elt->owner) == (intptr_t)pool) {
+      elt->next = pool->free;
+      pool->free = elt;
+      return;
+   }
+
+   pipe_mutex_lock(pool->parent->mutex);
+
+   /* Re-read the owner, it may have been destroyed in the meantime. */
+   owner = p_atomic_read(&elt->owner);
+   if (!(owner & 1)) {
+      struct util_slab_child_pool *owner_pool =
+         (struct util_slab_child_pool *)owner;
+
+      elt->next = owner_pool->migrated;
+      owner_pool->migrated = elt;
+      pipe_mutex_unlock(pool->parent->mutex);
+   } else {
+      pipe_mutex_unlock(pool->parent->mutex);
+      util_slab_free_orphaned(elt);
+   }
+}
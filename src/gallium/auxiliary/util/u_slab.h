@@ -93,4 +93,51 @@ util_slab_free(struct util_slab_mempool *pool, void *ptr)
    pool->free(pool, ptr);
 }
 
+
+/* Slab allocator with per-thread caches.
+ *
+ * A parent pool is created once (per screen, say) and determines the
+ * element size.  Every thread (or context) allocating from it uses its own
+ * child pool, so that the common paths of util_slab_child_alloc and
+ * util_slab_child_free don't need any locking.
+ *
+ * Elements may be freed through any child pool of the same parent, e.g. by
+ * a different context than the one which allocated them; such elements are
+ * handed back to the owning child pool under the parent's mutex.  Child
+ * pools may be destroyed while some of their elements are still in use;
+ * the memory is then released when the last of those elements is freed.
+ */
+struct util_slab_element_header;
+struct util_slab_page_header;
+
+struct util_slab_parent_pool {
+   pipe_mutex mutex;
+   unsigned element_size;
+   unsigned num_elements;
+};
+
+struct util_slab_child_pool {
+   struct util_slab_parent_pool *parent;
+   struct util_slab_page_header *pages;
+
+   /* Elements which may be allocated by this pool without locking. */
+   struct util_slab_element_header *free;
+
+   /* Elements owned by this pool but freed through a different pool.
+    * Protected by the parent's mutex. */
+   struct util_slab_element_header *migrated;
+};
+
+void util_slab_create_parent(struct util_slab_parent_pool *parent,
+                             unsigned item_size,
+                             unsigned num_items);
+void util_slab_destroy_parent(struct util_slab_parent_pool *parent);
+
+void util_slab_create_child(struct util_slab_child_pool *pool,
+                            struct util_slab_parent_pool *parent);
+void util_slab_destroy_child(struct util_slab_child_pool *pool);
+
+void *util_slab_child_alloc(struct util_slab_child_pool *pool);
+void util_slab_child_free(struct util_slab_child_pool *pool, void *ptr);
+
 #endif
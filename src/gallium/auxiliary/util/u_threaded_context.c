@@ -0,0 +1,1631 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#include "u_threaded_context.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+
+#define TC_CALL_HEADER_SLOTS \
+   ((sizeof(struct tc_call) + sizeof(uint64_t) - 1) / sizeof(uint64_t))
+
+
+/********************************************************************
+ * batches
+ */
+
+enum tc_ref_type {
+   TC_REF_RESOURCE,
+   TC_REF_SAMPLER_VIEW,
+   TC_REF_SURFACE,
+   TC_REF_SO_TARGET,
+};
+
+struct tc_ref {
+   enum tc_ref_type type;
+   void *object;
+};
+
+static void
+tc_batch_execute(void *job, int thread_index)
+{
+   struct tc_batch *batch = job;
+   struct threaded_context *tc = batch->tc;
+   unsigned i = 0;
+
+   while (i < batch->num_slots) {
+      struct tc_call *call = (struct tc_call *)&batch->slots[i];
+
+      call->execute(tc, &batch->slots[i + TC_CALL_HEADER_SLOTS]);
+      i += call->num_slots;
+   }
+}
+
+/* Drop the references held by an executed batch. This runs on the
+ * application thread: destroying sampler views, surfaces and stream output
+ * targets records a call in the current batch.
+ */
+static void
+tc_batch_release_refs(struct tc_batch *batch)
+{
+   struct util_dynarray refs = batch->refs;
+   struct tc_ref *ref;
+
+   util_dynarray_init(&batch->refs);
+
+   for (ref = util_dynarray_begin(&refs);
+        ref != util_dynarray_end(&refs); ++ref) {
+      switch (ref->type) {
+      case TC_REF_RESOURCE: {
+         struct pipe_resource *res = ref->object;
+         pipe_resource_reference(&res, NULL);
+         break;
+      }
+      case TC_REF_SAMPLER_VIEW: {
+         struct pipe_sampler_view *view = ref->object;
+         pipe_sampler_view_reference(&view, NULL);
+         break;
+      }
+      case TC_REF_SURFACE: {
+         struct pipe_surface *surf = ref->object;
+         pipe_surface_reference(&surf, NULL);
+         break;
+      }
+      case TC_REF_SO_TARGET: {
+         struct pipe_stream_output_target *target = ref->object;
+         pipe_so_target_reference(&target, NULL);
+         break;
+      }
+      }
+   }
+   util_dynarray_fini(&refs);
+}
+
+/* Submit the batch being recorded and start recording into the next one. */
+static void
+tc_batch_flush(struct threaded_context *tc)
+{
+   struct tc_batch *batch = &tc->batch_slots[tc->next];
+
+   if (!batch->num_slots)
+      return;
+
+   util_queue_add_job(&tc->queue, batch, &batch->fence, tc_batch_execute);
+   tc->last = tc->next;
+   tc->next = (tc->next + 1) % TC_MAX_BATCHES;
+
+   batch = &tc->batch_slots[tc->next];
+   util_queue_job_wait(&batch->fence);
+   batch->num_slots = 0;
+   tc_batch_release_refs(batch);
+}
+
+/* Wait until the worker has executed everything recorded so far. */
+static void
+tc_sync(struct threaded_context *tc)
+{
+   tc_batch_flush(tc);
+   /* there is only one worker thread, so batches complete in order */
+   util_queue_job_wait(&tc->batch_slots[tc->last].fence);
+}
+
+/* Call this before calling the driver context directly. */
+static inline struct pipe_context *
+tc_sync_pipe(struct pipe_context *_pipe)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   tc_sync(tc);
+   return tc->pipe;
+}
+
+/* Record a call with a payload of @size bytes, which is returned. */
+static void *
+tc_add_call(struct threaded_context *tc, tc_execute execute, unsigned size)
+{
+   const unsigned num_slots =
+      TC_CALL_HEADER_SLOTS + DIV_ROUND_UP(size, sizeof(uint64_t));
+   struct tc_batch *batch = &tc->batch_slots[tc->next];
+   struct tc_call *call;
+
+   assert(num_slots <= TC_SLOTS_PER_BATCH);
+
+   while (batch->num_slots + num_slots > TC_SLOTS_PER_BATCH) {
+      tc_batch_flush(tc);
+      batch = &tc->batch_slots[tc->next];
+   }
+
+   call = (struct tc_call *)&batch->slots[batch->num_slots];
+   call->execute = execute;
+   call->num_slots = num_slots;
+   batch->num_slots += num_slots;
+
+   return (uint64_t *)call + TC_CALL_HEADER_SLOTS;
+}
+
+/* Keep @object alive until the last recorded call has executed. */
+static void
+tc_add_ref(struct threaded_context *tc, enum tc_ref_type type,
+           struct pipe_reference *reference, void *object)
+{
+   struct tc_ref ref;
+
+   pipe_reference(NULL, reference);
+
+   ref.type = type;
+   ref.object = object;
+   util_dynarray_append(&tc->batch_slots[tc->next].refs, struct tc_ref, ref);
+}
+
+static inline void
+tc_ref_resource(struct threaded_context *tc, struct pipe_resource *res)
+{
+   if (res)
+      tc_add_ref(tc, TC_REF_RESOURCE, &res->reference, res);
+}
+
+static inline void
+tc_ref_sampler_view(struct threaded_context *tc,
+                    struct pipe_sampler_view *view)
+{
+   if (view)
+      tc_add_ref(tc, TC_REF_SAMPLER_VIEW, &view->reference, view);
+}
+
+static inline void
+tc_ref_surface(struct threaded_context *tc, struct pipe_surface *surf)
+{
+   if (surf)
+      tc_add_ref(tc, TC_REF_SURFACE, &surf->reference, surf);
+}
+
+static inline void
+tc_ref_so_target(struct threaded_context *tc,
+                 struct pipe_stream_output_target *target)
+{
+   if (target)
+      tc_add_ref(tc, TC_REF_SO_TARGET, &target->reference, target);
+}
+
+
+/********************************************************************
+ * generic recorded calls
+ */
+
+/* func(pipe, type *) */
+#define TC_FUNC_PTR(func, type) \
+   static void \
+   tc_call_##func(struct threaded_context *tc, void *payload) \
+   { \
+      tc->pipe->func(tc->pipe, *(type **)payload); \
+   } \
+ \
+   static void \
+   tc_##func(struct pipe_context *_pipe, type *ptr) \
+   { \
+      struct threaded_context *tc = threaded_context(_pipe); \
+ \
+      *(type **)tc_add_call(tc, tc_call_##func, sizeof(ptr)) = ptr; \
+   }
+
+/* Destroying a view, called on the worker thread as well when the driver
+ * drops the last reference.
+ */
+#define TC_FUNC_DESTROY(func, type) \
+   static void \
+   tc_call_##func(struct threaded_context *tc, void *payload) \
+   { \
+      tc->pipe->func(tc->pipe, *(type **)payload); \
+   } \
+ \
+   static void \
+   tc_##func(struct pipe_context *_pipe, type *view) \
+   { \
+      struct threaded_context *tc = threaded_context(_pipe); \
+ \
+      if (pipe_thread_is_self(tc->queue.threads[0])) { \
+         tc->pipe->func(tc->pipe, view); \
+         return; \
+      } \
+      *(type **)tc_add_call(tc, tc_call_##func, sizeof(view)) = view; \
+   }
+
+/* func(pipe, const type *) */
+#define TC_FUNC_STRUCT(func, type) \
+   static void \
+   tc_call_##func(struct threaded_context *tc, void *payload) \
+   { \
+      tc->pipe->func(tc->pipe, (const type *)payload); \
+   } \
+ \
+   static void \
+   tc_##func(struct pipe_context *_pipe, const type *state) \
+   { \
+      struct threaded_context *tc = threaded_context(_pipe); \
+ \
+      memcpy(tc_add_call(tc, tc_call_##func, sizeof(type)), state, \
+             sizeof(type)); \
+   }
+
+/* func(pipe, unsigned) */
+#define TC_FUNC_UNSIGNED(func) \
+   static void \
+   tc_call_##func(struct threaded_context *tc, void *payload) \
+   { \
+      tc->pipe->func(tc->pipe, *(unsigned *)payload); \
+   } \
+ \
+   static void \
+   tc_##func(struct pipe_context *_pipe, unsigned value) \
+   { \
+      struct threaded_context *tc = threaded_context(_pipe); \
+ \
+      *(unsigned *)tc_add_call(tc, tc_call_##func, sizeof(unsigned)) = value; \
+   }
+
+/* func(pipe, struct pipe_resource *) */
+#define TC_FUNC_RESOURCE(func) \
+   static void \
+   tc_call_##func(struct threaded_context *tc, void *payload) \
+   { \
+      tc->pipe->func(tc->pipe, *(struct pipe_resource **)payload); \
+   } \
+ \
+   static void \
+   tc_##func(struct pipe_context *_pipe, struct pipe_resource *res) \
+   { \
+      struct threaded_context *tc = threaded_context(_pipe); \
+ \
+      *(struct pipe_resource **) \
+         tc_add_call(tc, tc_call_##func, sizeof(res)) = res; \
+      tc_ref_resource(tc, res); \
+   }
+
+
+/********************************************************************
+ * queries
+ */
+
+static struct pipe_query *
+tc_create_query(struct pipe_context *_pipe, unsigned query_type,
+                unsigned index)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   return pipe->create_query(pipe, query_type, index);
+}
+
+static struct pipe_query *
+tc_create_batch_query(struct pipe_context *_pipe, unsigned num_queries,
+                      unsigned *query_types)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   return pipe->create_batch_query(pipe, num_queries, query_types);
+}
+
+TC_FUNC_PTR(destroy_query, struct pipe_query)
+
+static void
+tc_call_begin_query(struct threaded_context *tc, void *payload)
+{
+   tc->pipe->begin_query(tc->pipe, *(struct pipe_query **)payload);
+}
+
+static boolean
+tc_begin_query(struct pipe_context *_pipe, struct pipe_query *query)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   /* the result isn't known yet, failures show up as missing results */
+   *(struct pipe_query **)
+      tc_add_call(tc, tc_call_begin_query, sizeof(query)) = query;
+   return TRUE;
+}
+
+TC_FUNC_PTR(end_query, struct pipe_query)
+
+static boolean
+tc_get_query_result(struct pipe_context *_pipe, struct pipe_query *query,
+                    boolean wait, union pipe_query_result *result)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   return pipe->get_query_result(pipe, query, wait, result);
+}
+
+struct tc_query_result_resource {
+   struct pipe_query *query;
+   boolean wait;
+   enum pipe_query_value_type result_type;
+   int index;
+   struct pipe_resource *resource;
+   unsigned offset;
+};
+
+static void
+tc_call_get_query_result_resource(struct threaded_context *tc, void *payload)
+{
+   struct tc_query_result_resource *p = payload;
+
+   tc->pipe->get_query_result_resource(tc->pipe, p->query, p->wait,
+                                       p->result_type, p->index,
+                                       p->resource, p->offset);
+}
+
+static void
+tc_get_query_result_resource(struct pipe_context *_pipe,
+                             struct pipe_query *query, boolean wait,
+                             enum pipe_query_value_type result_type,
+                             int index, struct pipe_resource *resource,
+                             unsigned offset)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_query_result_resource *p =
+      tc_add_call(tc, tc_call_get_query_result_resource, sizeof(*p));
+
+   p->query = query;
+   p->wait = wait;
+   p->result_type = result_type;
+   p->index = index;
+   p->resource = resource;
+   p->offset = offset;
+   tc_ref_resource(tc, resource);
+}
+
+struct tc_render_condition {
+   struct pipe_query *query;
+   boolean condition;
+   uint mode;
+};
+
+static void
+tc_call_render_condition(struct threaded_context *tc, void *payload)
+{
+   struct tc_render_condition *p = payload;
+
+   tc->pipe->render_condition(tc->pipe, p->query, p->condition, p->mode);
+}
+
+static void
+tc_render_condition(struct pipe_context *_pipe, struct pipe_query *query,
+                    boolean condition, uint mode)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_render_condition *p =
+      tc_add_call(tc, tc_call_render_condition, sizeof(*p));
+
+   p->query = query;
+   p->condition = condition;
+   p->mode = mode;
+}
+
+
+/********************************************************************
+ * constant (immutable) states
+ */
+
+#define TC_CSO_CREATE(name, type) \
+   static void * \
+   tc_create_##name##_state(struct pipe_context *_pipe, \
+                            const struct type *state) \
+   { \
+      struct pipe_context *pipe = tc_sync_pipe(_pipe); \
+ \
+      return pipe->create_##name##_state(pipe, state); \
+   }
+
+#define TC_CSO_WHOLE(name, type) \
+   TC_CSO_CREATE(name, type) \
+   TC_FUNC_PTR(bind_##name##_state, void) \
+   TC_FUNC_PTR(delete_##name##_state, void)
+
+TC_CSO_WHOLE(blend, pipe_blend_state)
+TC_CSO_WHOLE(rasterizer, pipe_rasterizer_state)
+TC_CSO_WHOLE(depth_stencil_alpha, pipe_depth_stencil_alpha_state)
+TC_CSO_WHOLE(fs, pipe_shader_state)
+TC_CSO_WHOLE(vs, pipe_shader_state)
+TC_CSO_WHOLE(gs, pipe_shader_state)
+TC_CSO_WHOLE(tcs, pipe_shader_state)
+TC_CSO_WHOLE(tes, pipe_shader_state)
+TC_CSO_WHOLE(compute, pipe_compute_state)
+
+TC_CSO_CREATE(sampler, pipe_sampler_state)
+TC_FUNC_PTR(delete_sampler_state, void)
+
+struct tc_sampler_states {
+   ubyte shader, start, count;
+   bool unbind;
+   void *slot[0]; /* more will be allocated if needed */
+};
+
+static void
+tc_call_bind_sampler_states(struct threaded_context *tc, void *payload)
+{
+   struct tc_sampler_states *p = payload;
+
+   tc->pipe->bind_sampler_states(tc->pipe, p->shader, p->start, p->count,
+                                 p->unbind ? NULL : p->slot);
+}
+
+static void
+tc_bind_sampler_states(struct pipe_context *_pipe, unsigned shader,
+                       unsigned start, unsigned count, void **states)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_sampler_states *p =
+      tc_add_call(tc, tc_call_bind_sampler_states,
+                  sizeof(*p) + (states ? count : 0) * sizeof(void *));
+
+   p->shader = shader;
+   p->start = start;
+   p->count = count;
+   p->unbind = !states;
+   if (states)
+      memcpy(p->slot, states, count * sizeof(void *));
+}
+
+static void *
+tc_create_vertex_elements_state(struct pipe_context *_pipe,
+                                unsigned num_elements,
+                                const struct pipe_vertex_element *elements)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   return pipe->create_vertex_elements_state(pipe, num_elements, elements);
+}
+
+TC_FUNC_PTR(bind_vertex_elements_state, void)
+TC_FUNC_PTR(delete_vertex_elements_state, void)
+
+
+/********************************************************************
+ * immediate states
+ */
+
+TC_FUNC_STRUCT(set_blend_color, struct pipe_blend_color)
+TC_FUNC_STRUCT(set_stencil_ref, struct pipe_stencil_ref)
+TC_FUNC_STRUCT(set_clip_state, struct pipe_clip_state)
+TC_FUNC_STRUCT(set_polygon_stipple, struct pipe_poly_stipple)
+TC_FUNC_UNSIGNED(set_sample_mask)
+TC_FUNC_UNSIGNED(set_min_samples)
+
+static void
+tc_call_set_framebuffer_state(struct threaded_context *tc, void *payload)
+{
+   tc->pipe->set_framebuffer_state(tc->pipe,
+                                   (struct pipe_framebuffer_state *)payload);
+}
+
+static void
+tc_set_framebuffer_state(struct pipe_context *_pipe,
+                         const struct pipe_framebuffer_state *fb)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct pipe_framebuffer_state *p =
+      tc_add_call(tc, tc_call_set_framebuffer_state, sizeof(*p));
+   unsigned i;
+
+   *p = *fb;
+   for (i = 0; i < fb->nr_cbufs; ++i)
+      tc_ref_surface(tc, fb->cbufs[i]);
+   tc_ref_surface(tc, fb->zsbuf);
+}
+
+struct tc_tess_state {
+   float outer[4];
+   float inner[2];
+};
+
+static void
+tc_call_set_tess_state(struct threaded_context *tc, void *payload)
+{
+   struct tc_tess_state *p = payload;
+
+   tc->pipe->set_tess_state(tc->pipe, p->outer, p->inner);
+}
+
+static void
+tc_set_tess_state(struct pipe_context *_pipe,
+                  const float default_outer_level[4],
+                  const float default_inner_level[2])
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_tess_state *p =
+      tc_add_call(tc, tc_call_set_tess_state, sizeof(*p));
+
+   memcpy(p->outer, default_outer_level, sizeof(p->outer));
+   memcpy(p->inner, default_inner_level, sizeof(p->inner));
+}
+
+struct tc_scissors {
+   ubyte start, count;
+   struct pipe_scissor_state slot[0]; /* more will be allocated if needed */
+};
+
+static void
+tc_call_set_scissor_states(struct threaded_context *tc, void *payload)
+{
+   struct tc_scissors *p = payload;
+
+   tc->pipe->set_scissor_states(tc->pipe, p->start, p->count, p->slot);
+}
+
+static void
+tc_set_scissor_states(struct pipe_context *_pipe,
+                      unsigned start, unsigned count,
+                      const struct pipe_scissor_state *states)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_scissors *p =
+      tc_add_call(tc, tc_call_set_scissor_states,
+                  sizeof(*p) + count * sizeof(*states));
+
+   p->start = start;
+   p->count = count;
+   memcpy(p->slot, states, count * sizeof(*states));
+}
+
+struct tc_viewports {
+   ubyte start, count;
+   struct pipe_viewport_state slot[0]; /* more will be allocated if needed */
+};
+
+static void
+tc_call_set_viewport_states(struct threaded_context *tc, void *payload)
+{
+   struct tc_viewports *p = payload;
+
+   tc->pipe->set_viewport_states(tc->pipe, p->start, p->count, p->slot);
+}
+
+static void
+tc_set_viewport_states(struct pipe_context *_pipe,
+                       unsigned start, unsigned count,
+                       const struct pipe_viewport_state *states)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_viewports *p =
+      tc_add_call(tc, tc_call_set_viewport_states,
+                  sizeof(*p) + count * sizeof(*states));
+
+   p->start = start;
+   p->count = count;
+   memcpy(p->slot, states, count * sizeof(*states));
+}
+
+static void
+tc_set_debug_callback(struct pipe_context *_pipe,
+                      const struct pipe_debug_callback *cb)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   pipe->set_debug_callback(pipe, cb);
+}
+
+struct tc_constant_buffer {
+   ubyte shader, index;
+   bool unbind;
+   struct pipe_constant_buffer cb;
+};
+
+static void
+tc_call_set_constant_buffer(struct threaded_context *tc, void *payload)
+{
+   struct tc_constant_buffer *p = payload;
+
+   tc->pipe->set_constant_buffer(tc->pipe, p->shader, p->index,
+                                 p->unbind ? NULL : &p->cb);
+
+   /* The driver isn't using the previous user buffer copy anymore. */
+   FREE(tc->user_cbufs[p->shader][p->index]);
+   tc->user_cbufs[p->shader][p->index] = (void *)p->cb.user_buffer;
+}
+
+static void
+tc_set_constant_buffer(struct pipe_context *_pipe,
+                       uint shader, uint index,
+                       struct pipe_constant_buffer *cb)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_constant_buffer *p;
+   void *copy = NULL;
+
+   /* User buffers may change as soon as we return and the driver may keep
+    * pointing to them, so give it a copy that lives until the slot is
+    * rebound.
+    */
+   if (cb && cb->user_buffer) {
+      if (cb->buffer_size > TC_MAX_USER_CONST_SIZE ||
+          !(copy = MALLOC(cb->buffer_size))) {
+         struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+         pipe->set_constant_buffer(pipe, shader, index, cb);
+         FREE(tc->user_cbufs[shader][index]);
+         tc->user_cbufs[shader][index] = NULL;
+         return;
+      }
+      memcpy(copy, cb->user_buffer, cb->buffer_size);
+   }
+
+   p = tc_add_call(tc, tc_call_set_constant_buffer, sizeof(*p));
+   p->shader = shader;
+   p->index = index;
+   p->unbind = !cb;
+   if (cb) {
+      p->cb = *cb;
+      p->cb.user_buffer = copy;
+      tc_ref_resource(tc, cb->buffer);
+   } else {
+      memset(&p->cb, 0, sizeof(p->cb));
+   }
+}
+
+struct tc_sampler_views {
+   ubyte shader, start, count;
+   bool unbind;
+   struct pipe_sampler_view *slot[0]; /* more will be allocated if needed */
+};
+
+static void
+tc_call_set_sampler_views(struct threaded_context *tc, void *payload)
+{
+   struct tc_sampler_views *p = payload;
+
+   tc->pipe->set_sampler_views(tc->pipe, p->shader, p->start, p->count,
+                               p->unbind ? NULL : p->slot);
+}
+
+static void
+tc_set_sampler_views(struct pipe_context *_pipe, unsigned shader,
+                     unsigned start, unsigned count,
+                     struct pipe_sampler_view **views)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_sampler_views *p =
+      tc_add_call(tc, tc_call_set_sampler_views,
+                  sizeof(*p) + (views ? count : 0) * sizeof(*views));
+   unsigned i;
+
+   p->shader = shader;
+   p->start = start;
+   p->count = count;
+   p->unbind = !views;
+   if (views) {
+      memcpy(p->slot, views, count * sizeof(*views));
+      for (i = 0; i < count; ++i)
+         tc_ref_sampler_view(tc, views[i]);
+   }
+}
+
+struct tc_shader_buffers {
+   ubyte shader, start, count;
+   bool unbind;
+   struct pipe_shader_buffer slot[0]; /* more will be allocated if needed */
+};
+
+static void
+tc_call_set_shader_buffers(struct threaded_context *tc, void *payload)
+{
+   struct tc_shader_buffers *p = payload;
+
+   tc->pipe->set_shader_buffers(tc->pipe, p->shader, p->start, p->count,
+                                p->unbind ? NULL : p->slot);
+}
+
+static void
+tc_set_shader_buffers(struct pipe_context *_pipe, unsigned shader,
+                      unsigned start, unsigned count,
+                      struct pipe_shader_buffer *buffers)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_shader_buffers *p =
+      tc_add_call(tc, tc_call_set_shader_buffers,
+                  sizeof(*p) + (buffers ? count : 0) * sizeof(*buffers));
+   unsigned i;
+
+   p->shader = shader;
+   p->start = start;
+   p->count = count;
+   p->unbind = !buffers;
+   if (buffers) {
+      memcpy(p->slot, buffers, count * sizeof(*buffers));
+      for (i = 0; i < count; ++i)
+         tc_ref_resource(tc, buffers[i].buffer);
+   }
+}
+
+struct tc_shader_images {
+   ubyte shader, start, count;
+   bool unbind;
+   struct pipe_image_view slot[0]; /* more will be allocated if needed */
+};
+
+static void
+tc_call_set_shader_images(struct threaded_context *tc, void *payload)
+{
+   struct tc_shader_images *p = payload;
+
+   tc->pipe->set_shader_images(tc->pipe, p->shader, p->start, p->count,
+                               p->unbind ? NULL : p->slot);
+}
+
+static void
+tc_set_shader_images(struct pipe_context *_pipe, unsigned shader,
+                     unsigned start, unsigned count,
+                     struct pipe_image_view *images)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_shader_images *p =
+      tc_add_call(tc, tc_call_set_shader_images,
+                  sizeof(*p) + (images ? count : 0) * sizeof(*images));
+   unsigned i;
+
+   p->shader = shader;
+   p->start = start;
+   p->count = count;
+   p->unbind = !images;
+   if (images) {
+      memcpy(p->slot, images, count * sizeof(*images));
+      for (i = 0; i < count; ++i)
+         tc_ref_resource(tc, images[i].resource);
+   }
+}
+
+struct tc_vertex_buffers {
+   ubyte start, count;
+   bool unbind;
+   struct pipe_vertex_buffer slot[0]; /* more will be allocated if needed */
+};
+
+static void
+tc_call_set_vertex_buffers(struct threaded_context *tc, void *payload)
+{
+   struct tc_vertex_buffers *p = payload;
+
+   tc->pipe->set_vertex_buffers(tc->pipe, p->start, p->count,
+                                p->unbind ? NULL : p->slot);
+}
+
+static void
+tc_set_vertex_buffers(struct pipe_context *_pipe,
+                      unsigned start, unsigned count,
+                      const struct pipe_vertex_buffer *buffers)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   const uint32_t range = u_bit_consecutive64(start, count);
+   struct tc_vertex_buffers *p;
+   uint32_t user_mask = 0;
+   unsigned i;
+
+   if (buffers) {
+      for (i = 0; i < count; ++i) {
+         if (buffers[i].user_buffer)
+            user_mask |= 1u << (start + i);
+      }
+   }
+   tc->user_vbuf_mask = (tc->user_vbuf_mask & ~range) | user_mask;
+
+   if (user_mask) {
+      struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+      pipe->set_vertex_buffers(pipe, start, count, buffers);
+      return;
+   }
+
+   p = tc_add_call(tc, tc_call_set_vertex_buffers,
+                   sizeof(*p) + (buffers ? count : 0) * sizeof(*buffers));
+   p->start = start;
+   p->count = count;
+   p->unbind = !buffers;
+   if (buffers) {
+      memcpy(p->slot, buffers, count * sizeof(*buffers));
+      for (i = 0; i < count; ++i)
+         tc_ref_resource(tc, buffers[i].buffer);
+   }
+}
+
+struct tc_index_buffer {
+   bool unbind;
+   struct pipe_index_buffer ib;
+};
+
+static void
+tc_call_set_index_buffer(struct threaded_context *tc, void *payload)
+{
+   struct tc_index_buffer *p = payload;
+
+   tc->pipe->set_index_buffer(tc->pipe, p->unbind ? NULL : &p->ib);
+}
+
+static void
+tc_set_index_buffer(struct pipe_context *_pipe,
+                    const struct pipe_index_buffer *ib)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_index_buffer *p;
+
+   tc->user_ib = ib && ib->user_buffer;
+   if (tc->user_ib) {
+      struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+      pipe->set_index_buffer(pipe, ib);
+      return;
+   }
+
+   p = tc_add_call(tc, tc_call_set_index_buffer, sizeof(*p));
+   p->unbind = !ib;
+   if (ib) {
+      p->ib = *ib;
+      tc_ref_resource(tc, ib->buffer);
+   }
+}
+
+struct tc_so_targets {
+   unsigned count;
+   bool has_offsets;
+   struct pipe_stream_output_target *targets[PIPE_MAX_SO_BUFFERS];
+   unsigned offsets[PIPE_MAX_SO_BUFFERS];
+};
+
+static void
+tc_call_set_stream_output_targets(struct threaded_context *tc, void *payload)
+{
+   struct tc_so_targets *p = payload;
+
+   tc->pipe->set_stream_output_targets(tc->pipe, p->count, p->targets,
+                                       p->has_offsets ? p->offsets : NULL);
+}
+
+static void
+tc_set_stream_output_targets(struct pipe_context *_pipe,
+                             unsigned count,
+                             struct pipe_stream_output_target **targets,
+                             const unsigned *offsets)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_so_targets *p =
+      tc_add_call(tc, tc_call_set_stream_output_targets, sizeof(*p));
+   unsigned i;
+
+   assert(count <= PIPE_MAX_SO_BUFFERS);
+
+   p->count = count;
+   p->has_offsets = offsets != NULL;
+   for (i = 0; i < count; ++i) {
+      p->targets[i] = targets[i];
+      p->offsets[i] = offsets ? offsets[i] : 0;
+      tc_ref_so_target(tc, targets[i]);
+   }
+}
+
+static void
+tc_set_compute_resources(struct pipe_context *_pipe,
+                         unsigned start, unsigned count,
+                         struct pipe_surface **resources)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   pipe->set_compute_resources(pipe, start, count, resources);
+}
+
+static void
+tc_set_global_binding(struct pipe_context *_pipe,
+                      unsigned first, unsigned count,
+                      struct pipe_resource **resources,
+                      uint32_t **handles)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   /* handles are written back by the driver */
+   pipe->set_global_binding(pipe, first, count, resources, handles);
+}
+
+
+/********************************************************************
+ * views
+ */
+
+static struct pipe_sampler_view *
+tc_create_sampler_view(struct pipe_context *_pipe,
+                       struct pipe_resource *resource,
+                       const struct pipe_sampler_view *templ)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+   struct pipe_sampler_view *view =
+      pipe->create_sampler_view(pipe, resource, templ);
+
+   if (view)
+      view->context = _pipe;
+   return view;
+}
+
+TC_FUNC_DESTROY(sampler_view_destroy, struct pipe_sampler_view)
+
+static struct pipe_surface *
+tc_create_surface(struct pipe_context *_pipe,
+                  struct pipe_resource *resource,
+                  const struct pipe_surface *surf_tmpl)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+   struct pipe_surface *view =
+      pipe->create_surface(pipe, resource, surf_tmpl);
+
+   if (view)
+      view->context = _pipe;
+   return view;
+}
+
+TC_FUNC_DESTROY(surface_destroy, struct pipe_surface)
+
+static struct pipe_stream_output_target *
+tc_create_stream_output_target(struct pipe_context *_pipe,
+                               struct pipe_resource *res,
+                               unsigned buffer_offset,
+                               unsigned buffer_size)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+   struct pipe_stream_output_target *view =
+      pipe->create_stream_output_target(pipe, res, buffer_offset,
+                                        buffer_size);
+
+   if (view)
+      view->context = _pipe;
+   return view;
+}
+
+TC_FUNC_DESTROY(stream_output_target_destroy, struct pipe_stream_output_target)
+
+
+/********************************************************************
+ * transfers
+ */
+
+static void *
+tc_transfer_map(struct pipe_context *_pipe,
+                struct pipe_resource *resource, unsigned level,
+                unsigned usage, const struct pipe_box *box,
+                struct pipe_transfer **transfer)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   return pipe->transfer_map(pipe, resource, level, usage, box, transfer);
+}
+
+static void
+tc_transfer_flush_region(struct pipe_context *_pipe,
+                         struct pipe_transfer *transfer,
+                         const struct pipe_box *box)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   pipe->transfer_flush_region(pipe, transfer, box);
+}
+
+static void
+tc_transfer_unmap(struct pipe_context *_pipe,
+                  struct pipe_transfer *transfer)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   pipe->transfer_unmap(pipe, transfer);
+}
+
+static void
+tc_transfer_inline_write(struct pipe_context *_pipe,
+                         struct pipe_resource *resource,
+                         unsigned level, unsigned usage,
+                         const struct pipe_box *box,
+                         const void *data, unsigned stride,
+                         unsigned layer_stride)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   pipe->transfer_inline_write(pipe, resource, level, usage, box, data,
+                               stride, layer_stride);
+}
+
+
+/********************************************************************
+ * draws, clears and blits
+ */
+
+static void
+tc_call_draw_vbo(struct threaded_context *tc, void *payload)
+{
+   tc->pipe->draw_vbo(tc->pipe, (struct pipe_draw_info *)payload);
+}
+
+static void
+tc_draw_vbo(struct pipe_context *_pipe, const struct pipe_draw_info *info)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct pipe_draw_info *p;
+
+   /* user arrays are only valid until we return */
+   if (unlikely(tc->user_vbuf_mask || (info->indexed && tc->user_ib))) {
+      struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+      pipe->draw_vbo(pipe, info);
+      return;
+   }
+
+   p = tc_add_call(tc, tc_call_draw_vbo, sizeof(*p));
+   *p = *info;
+   tc_ref_so_target(tc, info->count_from_stream_output);
+   tc_ref_resource(tc, info->indirect);
+   tc_ref_resource(tc, info->indirect_params);
+}
+
+static void
+tc_launch_grid(struct pipe_context *_pipe, const struct pipe_grid_info *info)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   /* the size of the kernel input isn't known here */
+   pipe->launch_grid(pipe, info);
+}
+
+struct tc_resource_copy_region {
+   struct pipe_resource *dst;
+   unsigned dst_level;
+   unsigned dstx, dsty, dstz;
+   struct pipe_resource *src;
+   unsigned src_level;
+   struct pipe_box src_box;
+};
+
+static void
+tc_call_resource_copy_region(struct threaded_context *tc, void *payload)
+{
+   struct tc_resource_copy_region *p = payload;
+
+   tc->pipe->resource_copy_region(tc->pipe, p->dst, p->dst_level,
+                                  p->dstx, p->dsty, p->dstz,
+                                  p->src, p->src_level, &p->src_box);
+}
+
+static void
+tc_resource_copy_region(struct pipe_context *_pipe,
+                        struct pipe_resource *dst, unsigned dst_level,
+                        unsigned dstx, unsigned dsty, unsigned dstz,
+                        struct pipe_resource *src, unsigned src_level,
+                        const struct pipe_box *src_box)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_resource_copy_region *p =
+      tc_add_call(tc, tc_call_resource_copy_region, sizeof(*p));
+
+   p->dst = dst;
+   p->dst_level = dst_level;
+   p->dstx = dstx;
+   p->dsty = dsty;
+   p->dstz = dstz;
+   p->src = src;
+   p->src_level = src_level;
+   p->src_box = *src_box;
+   tc_ref_resource(tc, dst);
+   tc_ref_resource(tc, src);
+}
+
+static void
+tc_call_blit(struct threaded_context *tc, void *payload)
+{
+   tc->pipe->blit(tc->pipe, (struct pipe_blit_info *)payload);
+}
+
+static void
+tc_blit(struct pipe_context *_pipe, const struct pipe_blit_info *info)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct pipe_blit_info *p = tc_add_call(tc, tc_call_blit, sizeof(*p));
+
+   *p = *info;
+   tc_ref_resource(tc, info->dst.resource);
+   tc_ref_resource(tc, info->src.resource);
+}
+
+struct tc_clear {
+   unsigned buffers;
+   union pipe_color_union color;
+   double depth;
+   unsigned stencil;
+};
+
+static void
+tc_call_clear(struct threaded_context *tc, void *payload)
+{
+   struct tc_clear *p = payload;
+
+   tc->pipe->clear(tc->pipe, p->buffers, &p->color, p->depth, p->stencil);
+}
+
+static void
+tc_clear(struct pipe_context *_pipe, unsigned buffers,
+         const union pipe_color_union *color, double depth,
+         unsigned stencil)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_clear *p = tc_add_call(tc, tc_call_clear, sizeof(*p));
+
+   p->buffers = buffers;
+   p->color = *color;
+   p->depth = depth;
+   p->stencil = stencil;
+}
+
+struct tc_clear_render_target {
+   struct pipe_surface *dst;
+   union pipe_color_union color;
+   unsigned dstx, dsty, width, height;
+};
+
+static void
+tc_call_clear_render_target(struct threaded_context *tc, void *payload)
+{
+   struct tc_clear_render_target *p = payload;
+
+   tc->pipe->clear_render_target(tc->pipe, p->dst, &p->color,
+                                 p->dstx, p->dsty, p->width, p->height);
+}
+
+static void
+tc_clear_render_target(struct pipe_context *_pipe,
+                       struct pipe_surface *dst,
+                       const union pipe_color_union *color,
+                       unsigned dstx, unsigned dsty,
+                       unsigned width, unsigned height)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_clear_render_target *p =
+      tc_add_call(tc, tc_call_clear_render_target, sizeof(*p));
+
+   p->dst = dst;
+   p->color = *color;
+   p->dstx = dstx;
+   p->dsty = dsty;
+   p->width = width;
+   p->height = height;
+   tc_ref_surface(tc, dst);
+}
+
+struct tc_clear_depth_stencil {
+   struct pipe_surface *dst;
+   unsigned clear_flags;
+   double depth;
+   unsigned stencil;
+   unsigned dstx, dsty, width, height;
+};
+
+static void
+tc_call_clear_depth_stencil(struct threaded_context *tc, void *payload)
+{
+   struct tc_clear_depth_stencil *p = payload;
+
+   tc->pipe->clear_depth_stencil(tc->pipe, p->dst, p->clear_flags,
+                                 p->depth, p->stencil,
+                                 p->dstx, p->dsty, p->width, p->height);
+}
+
+static void
+tc_clear_depth_stencil(struct pipe_context *_pipe,
+                       struct pipe_surface *dst, unsigned clear_flags,
+                       double depth, unsigned stencil,
+                       unsigned dstx, unsigned dsty,
+                       unsigned width, unsigned height)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_clear_depth_stencil *p =
+      tc_add_call(tc, tc_call_clear_depth_stencil, sizeof(*p));
+
+   p->dst = dst;
+   p->clear_flags = clear_flags;
+   p->depth = depth;
+   p->stencil = stencil;
+   p->dstx = dstx;
+   p->dsty = dsty;
+   p->width = width;
+   p->height = height;
+   tc_ref_surface(tc, dst);
+}
+
+struct tc_clear_texture {
+   struct pipe_resource *res;
+   unsigned level;
+   struct pipe_box box;
+   uint8_t data[16]; /* one texel */
+};
+
+static void
+tc_call_clear_texture(struct threaded_context *tc, void *payload)
+{
+   struct tc_clear_texture *p = payload;
+
+   tc->pipe->clear_texture(tc->pipe, p->res, p->level, &p->box, p->data);
+}
+
+static void
+tc_clear_texture(struct pipe_context *_pipe, struct pipe_resource *res,
+                 unsigned level, const struct pipe_box *box,
+                 const void *data)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_clear_texture *p =
+      tc_add_call(tc, tc_call_clear_texture, sizeof(*p));
+
+   p->res = res;
+   p->level = level;
+   p->box = *box;
+   memset(p->data, 0, sizeof(p->data));
+   if (data)
+      memcpy(p->data, data,
+             MIN2(util_format_get_blocksize(res->format), sizeof(p->data)));
+   tc_ref_resource(tc, res);
+}
+
+struct tc_clear_buffer {
+   struct pipe_resource *res;
+   unsigned offset;
+   unsigned size;
+   int clear_value_size;
+   uint8_t clear_value[16];
+};
+
+static void
+tc_call_clear_buffer(struct threaded_context *tc, void *payload)
+{
+   struct tc_clear_buffer *p = payload;
+
+   tc->pipe->clear_buffer(tc->pipe, p->res, p->offset, p->size,
+                          p->clear_value, p->clear_value_size);
+}
+
+static void
+tc_clear_buffer(struct pipe_context *_pipe, struct pipe_resource *res,
+                unsigned offset, unsigned size,
+                const void *clear_value, int clear_value_size)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_clear_buffer *p;
+
+   if (clear_value_size > 16) {
+      struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+      pipe->clear_buffer(pipe, res, offset, size, clear_value,
+                         clear_value_size);
+      return;
+   }
+
+   p = tc_add_call(tc, tc_call_clear_buffer, sizeof(*p));
+   p->res = res;
+   p->offset = offset;
+   p->size = size;
+   p->clear_value_size = clear_value_size;
+   memcpy(p->clear_value, clear_value, clear_value_size);
+   tc_ref_resource(tc, res);
+}
+
+
+/********************************************************************
+ * miscellaneous
+ */
+
+static void
+tc_call_flush(struct threaded_context *tc, void *payload)
+{
+   tc->pipe->flush(tc->pipe, NULL, *(unsigned *)payload);
+}
+
+static void
+tc_flush(struct pipe_context *_pipe, struct pipe_fence_handle **fence,
+         unsigned flags)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   if (fence) {
+      struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+      pipe->flush(pipe, fence, flags);
+      return;
+   }
+
+   *(unsigned *)tc_add_call(tc, tc_call_flush, sizeof(flags)) = flags;
+   /* good time to let the worker catch up */
+   tc_batch_flush(tc);
+}
+
+static void
+tc_call_texture_barrier(struct threaded_context *tc, void *payload)
+{
+   tc->pipe->texture_barrier(tc->pipe);
+}
+
+static void
+tc_texture_barrier(struct pipe_context *_pipe)
+{
+   tc_add_call(threaded_context(_pipe), tc_call_texture_barrier, 0);
+}
+
+TC_FUNC_UNSIGNED(memory_barrier)
+TC_FUNC_RESOURCE(flush_resource)
+TC_FUNC_RESOURCE(invalidate_resource)
+
+static boolean
+tc_generate_mipmap(struct pipe_context *_pipe,
+                   struct pipe_resource *resource,
+                   enum pipe_format format,
+                   unsigned base_level, unsigned last_level,
+                   unsigned first_layer, unsigned last_layer)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   return pipe->generate_mipmap(pipe, resource, format, base_level,
+                                last_level, first_layer, last_layer);
+}
+
+static struct pipe_video_codec *
+tc_create_video_codec(struct pipe_context *_pipe,
+                      const struct pipe_video_codec *templ)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   return pipe->create_video_codec(pipe, templ);
+}
+
+static struct pipe_video_buffer *
+tc_create_video_buffer(struct pipe_context *_pipe,
+                       const struct pipe_video_buffer *templ)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   return pipe->create_video_buffer(pipe, templ);
+}
+
+static void
+tc_get_sample_position(struct pipe_context *_pipe,
+                       unsigned sample_count, unsigned sample_index,
+                       float *out_value)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   pipe->get_sample_position(pipe, sample_count, sample_index, out_value);
+}
+
+static uint64_t
+tc_get_timestamp(struct pipe_context *_pipe)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   return pipe->get_timestamp(pipe);
+}
+
+static enum pipe_reset_status
+tc_get_device_reset_status(struct pipe_context *_pipe)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   return pipe->get_device_reset_status(pipe);
+}
+
+static void
+tc_dump_debug_state(struct pipe_context *_pipe, FILE *stream,
+                    unsigned flags)
+{
+   struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+   pipe->dump_debug_state(pipe, stream, flags);
+}
+
+struct tc_string_marker {
+   int len;
+   char string[0]; /* more will be allocated if needed */
+};
+
+static void
+tc_call_emit_string_marker(struct threaded_context *tc, void *payload)
+{
+   struct tc_string_marker *p = payload;
+
+   tc->pipe->emit_string_marker(tc->pipe, p->string, p->len);
+}
+
+static void
+tc_emit_string_marker(struct pipe_context *_pipe, const char *string,
+                      int len)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_string_marker *p;
+
+   if (len > 1024) {
+      struct pipe_context *pipe = tc_sync_pipe(_pipe);
+
+      pipe->emit_string_marker(pipe, string, len);
+      return;
+   }
+
+   p = tc_add_call(tc, tc_call_emit_string_marker, sizeof(*p) + len);
+   p->len = len;
+   memcpy(p->string, string, len);
+}
+
+static void
+tc_destroy(struct pipe_context *_pipe)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct pipe_context *pipe = tc->pipe;
+   unsigned i, j;
+
+   /* Releasing the last references can record destroy calls, so go idle,
+    * release, and go idle again.
+    */
+   tc_sync(tc);
+   for (i = 0; i < TC_MAX_BATCHES; ++i)
+      tc_batch_release_refs(&tc->batch_slots[i]);
+   tc_sync(tc);
+
+   util_queue_destroy(&tc->queue);
+   for (i = 0; i < TC_MAX_BATCHES; ++i) {
+      util_queue_fence_destroy(&tc->batch_slots[i].fence);
+      util_dynarray_fini(&tc->batch_slots[i].refs);
+   }
+
+   pipe->destroy(pipe);
+
+   for (i = 0; i < PIPE_SHADER_TYPES; ++i)
+      for (j = 0; j < PIPE_MAX_CONSTANT_BUFFERS; ++j)
+         FREE(tc->user_cbufs[i][j]);
+   FREE(tc);
+}
+
+
+#define CTX_INIT(_member) \
+   tc->base._member = tc->pipe->_member ? tc_##_member : NULL
+
+struct pipe_context *
+threaded_context_create(struct pipe_context *pipe)
+{
+   struct threaded_context *tc;
+   unsigned i;
+
+   if (!pipe)
+      return NULL;
+
+   tc = CALLOC_STRUCT(threaded_context);
+   if (!tc)
+      return pipe;
+
+   if (!util_queue_init(&tc->queue, "gallium_drv", TC_MAX_BATCHES, 1)) {
+      FREE(tc);
+      return pipe;
+   }
+
+   for (i = 0; i < TC_MAX_BATCHES; ++i) {
+      tc->batch_slots[i].tc = tc;
+      util_queue_fence_init(&tc->batch_slots[i].fence);
+      util_dynarray_init(&tc->batch_slots[i].refs);
+   }
+
+   tc->pipe = pipe;
+   tc->base.priv = pipe->priv; /* expose wrapped priv data */
+   tc->base.screen = pipe->screen;
+
+   tc->base.destroy = tc_destroy;
+
+   CTX_INIT(draw_vbo);
+   CTX_INIT(render_condition);
+   CTX_INIT(create_query);
+   CTX_INIT(create_batch_query);
+   CTX_INIT(destroy_query);
+   CTX_INIT(begin_query);
+   CTX_INIT(end_query);
+   CTX_INIT(get_query_result);
+   CTX_INIT(get_query_result_resource);
+   CTX_INIT(create_blend_state);
+   CTX_INIT(bind_blend_state);
+   CTX_INIT(delete_blend_state);
+   CTX_INIT(create_sampler_state);
+   CTX_INIT(bind_sampler_states);
+   CTX_INIT(delete_sampler_state);
+   CTX_INIT(create_rasterizer_state);
+   CTX_INIT(bind_rasterizer_state);
+   CTX_INIT(delete_rasterizer_state);
+   CTX_INIT(create_depth_stencil_alpha_state);
+   CTX_INIT(bind_depth_stencil_alpha_state);
+   CTX_INIT(delete_depth_stencil_alpha_state);
+   CTX_INIT(create_fs_state);
+   CTX_INIT(bind_fs_state);
+   CTX_INIT(delete_fs_state);
+   CTX_INIT(create_vs_state);
+   CTX_INIT(bind_vs_state);
+   CTX_INIT(delete_vs_state);
+   CTX_INIT(create_gs_state);
+   CTX_INIT(bind_gs_state);
+   CTX_INIT(delete_gs_state);
+   CTX_INIT(create_tcs_state);
+   CTX_INIT(bind_tcs_state);
+   CTX_INIT(delete_tcs_state);
+   CTX_INIT(create_tes_state);
+   CTX_INIT(bind_tes_state);
+   CTX_INIT(delete_tes_state);
+   CTX_INIT(create_vertex_elements_state);
+   CTX_INIT(bind_vertex_elements_state);
+   CTX_INIT(delete_vertex_elements_state);
+   CTX_INIT(set_blend_color);
+   CTX_INIT(set_stencil_ref);
+   CTX_INIT(set_sample_mask);
+   CTX_INIT(set_min_samples);
+   CTX_INIT(set_clip_state);
+   CTX_INIT(set_constant_buffer);
+   CTX_INIT(set_framebuffer_state);
+   CTX_INIT(set_polygon_stipple);
+   CTX_INIT(set_scissor_states);
+   CTX_INIT(set_viewport_states);
+   CTX_INIT(set_sampler_views);
+   CTX_INIT(set_tess_state);
+   CTX_INIT(set_debug_callback);
+   CTX_INIT(set_shader_buffers);
+   CTX_INIT(set_shader_images);
+   CTX_INIT(set_vertex_buffers);
+   CTX_INIT(set_index_buffer);
+   CTX_INIT(create_stream_output_target);
+   CTX_INIT(stream_output_target_destroy);
+   CTX_INIT(set_stream_output_targets);
+   CTX_INIT(resource_copy_region);
+   CTX_INIT(blit);
+   CTX_INIT(clear);
+   CTX_INIT(clear_render_target);
+   CTX_INIT(clear_depth_stencil);
+   CTX_INIT(clear_texture);
+   CTX_INIT(clear_buffer);
+   CTX_INIT(flush);
+   CTX_INIT(create_sampler_view);
+   CTX_INIT(sampler_view_destroy);
+   CTX_INIT(create_surface);
+   CTX_INIT(surface_destroy);
+   CTX_INIT(transfer_map);
+   CTX_INIT(transfer_flush_region);
+   CTX_INIT(transfer_unmap);
+   CTX_INIT(transfer_inline_write);
+   CTX_INIT(texture_barrier);
+   CTX_INIT(memory_barrier);
+   CTX_INIT(create_video_codec);
+   CTX_INIT(create_video_buffer);
+   CTX_INIT(create_compute_state);
+   CTX_INIT(bind_compute_state);
+   CTX_INIT(delete_compute_state);
+   CTX_INIT(set_compute_resources);
+   CTX_INIT(set_global_binding);
+   CTX_INIT(launch_grid);
+   CTX_INIT(get_sample_position);
+   CTX_INIT(get_timestamp);
+   CTX_INIT(flush_resource);
+   CTX_INIT(invalidate_resource);
+   CTX_INIT(get_device_reset_status);
+   CTX_INIT(dump_debug_state);
+   CTX_INIT(emit_string_marker);
+   CTX_INIT(generate_mipmap);
+
+   return &tc->base;
+}
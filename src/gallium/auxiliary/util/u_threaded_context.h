@@ -0,0 +1,103 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/* A pipe_context wrapper that executes the wrapped driver context in
+ * a separate thread.
+ *
+ * State changes, draws, clears, blits and copies are recorded into batches,
+ * which are executed by a worker thread in order. Everything else, i.e.
+ * object creation, transfers, query results and fences, waits for the worker
+ * to go idle and then calls the driver directly. The driver context is thus
+ * never used by two threads at the same time and doesn't need to be aware of
+ * the wrapper.
+ *
+ * Objects passed to recorded calls are referenced until the batch has
+ * executed. Sampler views, surfaces and stream output targets created
+ * through the wrapper point back to the wrapper, so that destroying them
+ * is recorded as well.
+ */
+
+#ifndef U_THREADED_CONTEXT_H
+#define U_THREADED_CONTEXT_H
+
+#include "pipe/p_context.h"
+#include "pipe/p_state.h"
+#include "util/u_dynarray.h"
+#include "util/u_queue.h"
+
+#define TC_SLOTS_PER_BATCH       4096 /* in units of 8 bytes */
+#define TC_MAX_BATCHES           4
+#define TC_MAX_USER_CONST_SIZE   (16 * 1024)
+
+struct threaded_context;
+
+typedef void (*tc_execute)(struct threaded_context *tc, void *payload);
+
+struct tc_call {
+   tc_execute execute;
+   unsigned num_slots; /* including this header */
+};
+
+struct tc_batch {
+   struct threaded_context *tc;
+   struct util_queue_fence fence;
+   unsigned num_slots;
+   struct util_dynarray refs; /* struct tc_ref, released after execution */
+   uint64_t slots[TC_SLOTS_PER_BATCH];
+};
+
+struct threaded_context {
+   struct pipe_context base;
+   struct pipe_context *pipe;
+
+   struct util_queue queue;
+
+   /* user vertex/index buffers are only valid during the draw call, draws
+    * using them are executed immediately
+    */
+   uint32_t user_vbuf_mask;
+   bool user_ib;
+
+   /* copies of user constant buffers the driver may still point to, only
+    * accessed by the worker thread
+    */
+   void *user_cbufs[PIPE_SHADER_TYPES][PIPE_MAX_CONSTANT_BUFFERS];
+
+   unsigned next; /* batch being recorded */
+   unsigned last; /* batch submitted last */
+   struct tc_batch batch_slots[TC_MAX_BATCHES];
+};
+
+static inline struct threaded_context *
+threaded_context(struct pipe_context *pipe)
+{
+   return (struct threaded_context *)pipe;
+}
+
+/* Wrap @pipe in a threaded context. If that fails, @pipe is returned as is
+ * and can still be used directly.
+ */
+struct pipe_context *
+threaded_context_create(struct pipe_context *pipe);
+
+#endif
@@ -32,12 +32,25 @@
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
 #include "pipe/p_context.h"
+#include "pipe/p_screen.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 
 #include "u_upload_mgr.h"
 
 
+/* Number of full upload buffers kept for recycling in ring mode. */
+#define U_UPLOAD_RING_SIZE 4
+
+/* A full, still mapped upload buffer waiting for the GPU to be done with it.
+ */
+struct u_upload_retired {
+   struct pipe_resource *buffer;
+   struct pipe_transfer *transfer;
+   uint8_t *map;
+   struct pipe_fence_handle *fence; /* NULL until u_upload_fence is called */
+};
+
 struct u_upload_mgr {
    struct pipe_context *pipe;
 
@@ -52,6 +65,14 @@ struct u_upload_mgr {
    uint8_t *map;    /* Pointer to the mapped upload buffer. */
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
+
+   /* Ring mode: with persistent mappings, full buffers are kept mapped and
+    * reused once the fence passed to u_upload_fence after they filled up
+    * has signalled, instead of being released. Enabled by the first
+    * u_upload_fence call. */
+   boolean use_ring;
+   struct u_upload_retired ring[U_UPLOAD_RING_SIZE]; /* oldest first */
+   unsigned num_retired;
 };
 
 
@@ -121,9 +142,95 @@ static void u_upload_release_buffer(struct u_upload_mgr *upload)
 }
 
 
+static void u_upload_release_oldest_retired(struct u_upload_mgr *upload)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   struct u_upload_retired *retired = &upload->ring[0];
+
+   assert(upload->num_retired);
+
+   pipe_transfer_unmap(upload->pipe, retired->transfer);
+   pipe_resource_reference(&retired->buffer, NULL);
+   screen->fence_reference(screen, &retired->fence, NULL);
+
+   upload->num_retired--;
+   memmove(&upload->ring[0], &upload->ring[1],
+           upload->num_retired * sizeof(upload->ring[0]));
+}
+
+
+/* Keep the full current buffer mapped for recycling, see use_ring.
+ */
+static void u_upload_retire_buffer(struct u_upload_mgr *upload)
+{
+   struct u_upload_retired *retired;
+
+   if (upload->num_retired == U_UPLOAD_RING_SIZE)
+      u_upload_release_oldest_retired(upload);
+
+   retired = &upload->ring[upload->num_retired++];
+   retired->buffer = upload->buffer;
+   retired->transfer = upload->transfer;
+   retired->map = upload->map;
+   retired->fence = NULL;
+
+   upload->buffer = NULL;
+   upload->transfer = NULL;
+   upload->map = NULL;
+}
+
+
+/* Make the oldest retired buffer current again if the GPU is done with it.
+ */
+static boolean u_upload_reuse_buffer(struct u_upload_mgr *upload,
+                                     unsigned min_size)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   struct u_upload_retired *retired = &upload->ring[0];
+
+   if (!upload->num_retired || !retired->fence ||
+       retired->buffer->width0 < min_size ||
+       !screen->fence_finish(screen, retired->fence, 0))
+      return FALSE;
+
+   upload->buffer = retired->buffer;
+   upload->transfer = retired->transfer;
+   upload->map = retired->map;
+   upload->offset = 0;
+   screen->fence_reference(screen, &retired->fence, NULL);
+
+   upload->num_retired--;
+   memmove(&upload->ring[0], &upload->ring[1],
+           upload->num_retired * sizeof(upload->ring[0]));
+   return TRUE;
+}
+
+
+void u_upload_fence(struct u_upload_mgr *upload,
+                    struct pipe_fence_handle *fence)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   unsigned i;
+
+   if (!upload->map_persistent || !fence)
+      return;
+
+   upload->use_ring = TRUE;
+
+   for (i = 0; i < upload->num_retired; i++) {
+      if (!upload->ring[i].fence)
+         screen->fence_reference(screen, &upload->ring[i].fence, fence);
+   }
+}
+
+
 void u_upload_destroy( struct u_upload_mgr *upload )
 {
    u_upload_release_buffer( upload );
+
+   while (upload->num_retired)
+      u_upload_release_oldest_retired(upload);
+
    FREE( upload );
 }
 
@@ -136,9 +243,17 @@ u_upload_alloc_buffer(struct u_upload_mgr *upload,
    struct pipe_resource buffer;
    unsigned size;
 
-   /* Release the old buffer, if present:
+   /* Release the old buffer, if present, or keep it for recycling:
     */
-   u_upload_release_buffer( upload );
+   if (upload->use_ring && upload->buffer && upload->map) {
+      u_upload_retire_buffer(upload);
+
+      if (u_upload_reuse_buffer(upload, min_size))
+         return;
+   }
+   else {
+      u_upload_release_buffer( upload );
+   }
 
    /* Allocate a new one: 
     */
@@ -36,6 +36,7 @@
 
 struct pipe_context;
 struct pipe_resource;
+struct pipe_fence_handle;
 
 
 /**
@@ -67,6 +68,21 @@ void u_upload_destroy( struct u_upload_mgr *upload );
  */
 void u_upload_unmap( struct u_upload_mgr *upload );
 
+/**
+ * Tell the upload manager that all commands using its allocations so far
+ * have been submitted and complete when \p fence signals.
+ *
+ * \param upload           Upload manager
+ * \param fence            Fence of the flush which submitted them
+ *
+ * With persistent mappings, this enables recycling of full upload buffers,
+ * which are then kept mapped and reused once their fence has signalled,
+ * so that no buffers are allocated, mapped or unmapped in steady state.
+ * Does nothing if persistent mappings aren't supported.
+ */
+void u_upload_fence(struct u_upload_mgr *upload,
+                    struct pipe_fence_handle *fence);
+
 /**
  * Sub-allocate new memory from the upload buffer.
  *
@@ -133,6 +133,31 @@ struct u_vbuf_elements {
    void *driver_cso;
 };
 
+/* Vertex data translated from a real (non-user) buffer is kept for this
+ * many distinct inputs, so that static meshes in unsupported formats are
+ * only translated again when their contents change. */
+#define U_VBUF_TRANSLATED_CACHE_SIZE 8
+
+/* Largest source range cached, in bytes. */
+#define U_VBUF_TRANSLATED_MAX_SIZE (8 * 1024 * 1024)
+
+struct u_vbuf_translated {
+   /* Inputs. The buffer isn't referenced, it's only compared as part of
+    * the lookup key; the contents are always compared with the copy. */
+   struct pipe_resource *src;
+   unsigned src_offset;
+   unsigned src_size;
+   unsigned src_stride;
+   int start_vertex;
+   unsigned num_vertices;
+   struct translate_key key;
+   void *src_copy;          /* copy of the translated source range */
+
+   /* Output, with the translated vertex data at
+    * key.output_stride * start_vertex. */
+   struct pipe_resource *out;
+};
+
 enum {
    VB_VERTEX = 0,
    VB_INSTANCE = 1,
@@ -184,6 +209,10 @@ struct u_vbuf {
    uint32_t incompatible_vb_mask; /* each bit describes a corresp. buffer */
    /* Which buffer has a non-zero stride. */
    uint32_t nonzero_stride_vb_mask; /* each bit describes a corresp. buffer */
+
+   /* Translated vertex data of real buffers, replaced round-robin. */
+   struct u_vbuf_translated translated[U_VBUF_TRANSLATED_CACHE_SIZE];
+   unsigned translated_next;
 };
 
 static void *
@@ -389,12 +418,139 @@ void u_vbuf_destroy(struct u_vbuf *mgr)
    }
    pipe_resource_reference(&mgr->aux_vertex_buffer_saved.buffer, NULL);
 
+   for (i = 0; i < U_VBUF_TRANSLATED_CACHE_SIZE; i++) {
+      pipe_resource_reference(&mgr->translated[i].out, NULL);
+      FREE(mgr->translated[i].src_copy);
+   }
+
    translate_cache_destroy(mgr->translate_cache);
    u_upload_destroy(mgr->uploader);
    cso_cache_delete(mgr->cso_cache);
    FREE(mgr);
 }
 
+/**
+ * Translate vertices of the real buffer vb_index, reusing the result of an
+ * earlier draw if the inputs and the source data are the same.
+ *
+ * The source still has to be mapped and compared, since buffer writes
+ * can't be tracked here, but memcmp is much cheaper than running the
+ * translate and uploading its output for every draw.
+ */
+static enum pipe_error
+u_vbuf_translate_buffer_cached(struct u_vbuf *mgr, struct translate_key *key,
+                               unsigned vb_index, unsigned out_vb,
+                               int start_vertex, unsigned num_vertices)
+{
+   struct pipe_vertex_buffer *vb = &mgr->vertex_buffer[vb_index];
+   struct u_vbuf_translated *entry = NULL;
+   struct pipe_transfer *src_transfer, *out_transfer;
+   struct translate *tr;
+   uint8_t *src_map, *out_map;
+   unsigned offset, size, out_size, i;
+
+   if (start_vertex < 0)
+      return PIPE_ERROR;
+
+   offset = vb->buffer_offset + vb->stride * start_vertex;
+   size = vb->stride ? num_vertices * vb->stride : sizeof(double)*4;
+   if (offset >= vb->buffer->width0)
+      return PIPE_ERROR;
+   if (offset + size > vb->buffer->width0)
+      size = vb->buffer->width0 - offset;
+
+   out_size = key->output_stride * (start_vertex + num_vertices);
+   if (size > U_VBUF_TRANSLATED_MAX_SIZE ||
+       out_size > U_VBUF_TRANSLATED_MAX_SIZE)
+      return PIPE_ERROR;
+
+   for (i = 0; i < U_VBUF_TRANSLATED_CACHE_SIZE; i++) {
+      struct u_vbuf_translated *t = &mgr->translated[i];
+
+      if (t->src == vb->buffer &&
+          t->src_offset == offset &&
+          t->src_size == size &&
+          t->src_stride == vb->stride &&
+          t->start_vertex == start_vertex &&
+          t->num_vertices == num_vertices &&
+          !translate_key_compare(&t->key, key)) {
+         entry = t;
+         break;
+      }
+   }
+
+   src_map = pipe_buffer_map_range(mgr->pipe, vb->buffer, offset, size,
+                                   PIPE_TRANSFER_READ, &src_transfer);
+   if (!src_map)
+      return PIPE_ERROR_OUT_OF_MEMORY;
+
+   if (entry && !memcmp(entry->src_copy, src_map, size)) {
+      pipe_buffer_unmap(mgr->pipe, src_transfer);
+      goto done;
+   }
+
+   if (!entry) {
+      entry = &mgr->translated[mgr->translated_next];
+      mgr->translated_next = (mgr->translated_next + 1) %
+                             U_VBUF_TRANSLATED_CACHE_SIZE;
+
+      FREE(entry->src_copy);
+      entry->src_copy = MALLOC(size);
+      if (!entry->src_copy)
+         goto fail;
+
+      entry->src = vb->buffer;
+      entry->src_offset = offset;
+      entry->src_size = size;
+      entry->src_stride = vb->stride;
+      entry->start_vertex = start_vertex;
+      entry->num_vertices = num_vertices;
+      memcpy(&entry->key, key, sizeof(*key));
+   }
+
+   /* Translate into a new buffer, as the old one may still be in use. */
+   pipe_resource_reference(&entry->out, NULL);
+   entry->out = pipe_buffer_create(mgr->pipe->screen,
+                                   PIPE_BIND_VERTEX_BUFFER,
+                                   PIPE_USAGE_DEFAULT, out_size);
+   if (!entry->out)
+      goto fail;
+
+   out_map = pipe_buffer_map(mgr->pipe, entry->out,
+                             PIPE_TRANSFER_WRITE |
+                             PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+                             &out_transfer);
+   if (!out_map) {
+      pipe_resource_reference(&entry->out, NULL);
+      goto fail;
+   }
+
+   tr = translate_cache_find(mgr->translate_cache, key);
+   tr->set_buffer(tr, vb_index, src_map, vb->stride, ~0);
+   tr->run(tr, 0, num_vertices, 0, 0,
+           out_map + key->output_stride * start_vertex);
+
+   memcpy(entry->src_copy, src_map, size);
+
+   pipe_buffer_unmap(mgr->pipe, out_transfer);
+   pipe_buffer_unmap(mgr->pipe, src_transfer);
+
+done:
+   /* Setup the new vertex buffer. */
+   mgr->real_vertex_buffer[out_vb].buffer_offset = 0;
+   mgr->real_vertex_buffer[out_vb].stride = key->output_stride;
+   pipe_resource_reference(&mgr->real_vertex_buffer[out_vb].buffer,
+                           entry->out);
+   return PIPE_OK;
+
+fail:
+   /* Drop the entry, so that it isn't matched with stale contents. */
+   FREE(entry->src_copy);
+   memset(entry, 0, sizeof(*entry));
+   pipe_buffer_unmap(mgr->pipe, src_transfer);
+   return PIPE_ERROR_OUT_OF_MEMORY;
+}
+
 static enum pipe_error
 u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
                          unsigned vb_mask, unsigned out_vb,
@@ -408,6 +564,13 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
    uint8_t *out_map;
    unsigned out_offset, mask;
 
+   /* Vertices of a single real buffer can be cached across draws. */
+   if (!unroll_indices && util_bitcount(vb_mask) == 1 &&
+       !mgr->vertex_buffer[ffs(vb_mask) - 1].user_buffer &&
+       u_vbuf_translate_buffer_cached(mgr, key, ffs(vb_mask) - 1, out_vb,
+                                      start_vertex, num_vertices) == PIPE_OK)
+      return PIPE_OK;
+
    /* Get a translate object. */
    tr = translate_cache_find(mgr->translate_cache, key);
 
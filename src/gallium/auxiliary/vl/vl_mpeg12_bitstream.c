@@ -28,6 +28,7 @@
 
 #include "pipe/p_video_codec.h"
 #include "util/u_memory.h"
+#include "util/u_queue.h"
 
 #include "vl_vlc.h"
 #include "vl_mpeg12_bitstream.h"
@@ -965,6 +966,52 @@ decode_slice(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target)
    bs->decoder->decode_macroblock(bs->decoder, target, &bs->desc->base, &mb.base, 1);
 }
 
+/* slices handed to a worker at once, and jobs in flight per picture */
+#define VL_MPG12_BS_SLICES_PER_JOB 4
+#define VL_MPG12_BS_NUM_JOBS 16
+
+struct vl_mpg12_bs_job
+{
+   struct util_queue_fence fence;
+
+   /* private copy of the reader, positioned at the first slice */
+   struct vl_mpg12_bs bs;
+   struct pipe_video_buffer *target;
+   unsigned num_slices;
+};
+
+static void
+decode_slices(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target,
+              unsigned num_slices)
+{
+   while (num_slices && vl_vlc_search_byte(&bs->vlc, ~0, 0x00) &&
+          vl_vlc_bits_left(&bs->vlc) > 32) {
+      uint32_t code = vl_vlc_peekbits(&bs->vlc, 32);
+
+      if (code >= 0x101 && code <= 0x1AF) {
+         vl_vlc_eatbits(&bs->vlc, 24);
+         decode_slice(bs, target);
+
+         /* align to a byte again */
+         vl_vlc_eatbits(&bs->vlc, vl_vlc_valid_bits(&bs->vlc) & 7);
+
+         --num_slices;
+      } else {
+         vl_vlc_eatbits(&bs->vlc, 8);
+      }
+
+      vl_vlc_fillbits(&bs->vlc);
+   }
+}
+
+static void
+decode_slices_job(void *data, int thread_index)
+{
+   struct vl_mpg12_bs_job *job = data;
+
+   decode_slices(&job->bs, job->target, job->num_slices);
+}
+
 void
 vl_mpg12_bs_init(struct vl_mpg12_bs *bs, struct pipe_video_codec *decoder)
 {
@@ -982,6 +1029,42 @@ vl_mpg12_bs_init(struct vl_mpg12_bs *bs, struct pipe_video_codec *decoder)
    }
 }
 
+void
+vl_mpg12_bs_set_queue(struct vl_mpg12_bs *bs, struct util_queue *queue)
+{
+   unsigned i;
+
+   assert(bs && queue);
+
+   /* without the jobs we simply stay single threaded */
+   bs->jobs = CALLOC(VL_MPG12_BS_NUM_JOBS, sizeof(struct vl_mpg12_bs_job));
+   if (!bs->jobs)
+      return;
+
+   for (i = 0; i < VL_MPG12_BS_NUM_JOBS; ++i)
+      util_queue_fence_init(&bs->jobs[i].fence);
+
+   bs->queue = queue;
+}
+
+void
+vl_mpg12_bs_cleanup(struct vl_mpg12_bs *bs)
+{
+   unsigned i;
+
+   assert(bs);
+
+   if (!bs->jobs)
+      return;
+
+   for (i = 0; i < VL_MPG12_BS_NUM_JOBS; ++i)
+      util_queue_fence_destroy(&bs->jobs[i].fence);
+
+   FREE(bs->jobs);
+   bs->jobs = NULL;
+   bs->queue = NULL;
+}
+
 void
 vl_mpg12_bs_decode(struct vl_mpg12_bs *bs,
                    struct pipe_video_buffer *target,
@@ -990,26 +1073,54 @@ vl_mpg12_bs_decode(struct vl_mpg12_bs *bs,
                    const void * const *buffers,
                    const unsigned *sizes)
 {
+   struct vl_mpg12_bs_job *job = NULL;
+   unsigned i, num_jobs = 0;
+
    assert(bs);
 
    bs->desc = picture;
    bs->intra_dct_tbl = picture->intra_vlc_format ? tbl_B15 : tbl_B14_AC;
 
    vl_vlc_init(&bs->vlc, num_buffers, buffers, sizes);
+
+   if (!bs->queue) {
+      decode_slices(bs, target, ~0u);
+      return;
+   }
+
+   /* Slices start with a fresh predictor state, so only scan for their
+    * start codes here and let the workers decode runs of them, each with
+    * its own copy of the reader. */
    while (vl_vlc_search_byte(&bs->vlc, ~0, 0x00) && vl_vlc_bits_left(&bs->vlc) > 32) {
       uint32_t code = vl_vlc_peekbits(&bs->vlc, 32);
 
       if (code >= 0x101 && code <= 0x1AF) {
-         vl_vlc_eatbits(&bs->vlc, 24);
-         decode_slice(bs, target);
+         if (!job || job->num_slices == VL_MPG12_BS_SLICES_PER_JOB) {
+            if (job)
+               util_queue_add_job(bs->queue, job, &job->fence, decode_slices_job);
 
-         /* align to a byte again */
-         vl_vlc_eatbits(&bs->vlc, vl_vlc_valid_bits(&bs->vlc) & 7);
+            job = &bs->jobs[num_jobs++ % VL_MPG12_BS_NUM_JOBS];
+            if (num_jobs > VL_MPG12_BS_NUM_JOBS)
+               util_queue_job_wait(&job->fence);
 
+            job->bs = *bs;
+            job->target = target;
+            job->num_slices = 0;
+         }
+
+         ++job->num_slices;
+         vl_vlc_eatbits(&bs->vlc, 32);
       } else {
          vl_vlc_eatbits(&bs->vlc, 8);
       }
 
       vl_vlc_fillbits(&bs->vlc);
    }
+
+   if (job)
+      util_queue_add_job(bs->queue, job, &job->fence, decode_slices_job);
+
+   /* the input buffers are only valid during this call */
+   for (i = 0; i < MIN2(num_jobs, VL_MPG12_BS_NUM_JOBS); ++i)
+      util_queue_job_wait(&bs->jobs[i].fence);
 }
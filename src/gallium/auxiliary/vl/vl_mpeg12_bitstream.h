@@ -31,6 +31,9 @@
 #include "vl_defines.h"
 #include "vl_vlc.h"
 
+struct util_queue;
+struct vl_mpg12_bs_job;
+
 struct vl_mpg12_bs
 {
    struct pipe_video_codec *decoder;
@@ -40,11 +43,25 @@ struct vl_mpg12_bs
 
    struct vl_vlc vlc;
    short pred_dc[3];
+
+   /* slices are decoded on this queue when set, see vl_mpg12_bs_set_queue */
+   struct util_queue *queue;
+   struct vl_mpg12_bs_job *jobs;
 };
 
 void
 vl_mpg12_bs_init(struct vl_mpg12_bs *bs, struct pipe_video_codec *decoder);
 
+/**
+ * decode independent slices in parallel on queue, the decoder's
+ * decode_macroblock must then be safe to call from several threads
+ */
+void
+vl_mpg12_bs_set_queue(struct vl_mpg12_bs *bs, struct util_queue *queue);
+
+void
+vl_mpg12_bs_cleanup(struct vl_mpg12_bs *bs);
+
 void
 vl_mpg12_bs_decode(struct vl_mpg12_bs *bs,
                    struct pipe_video_buffer *target,
@@ -28,6 +28,8 @@
 #include <math.h>
 #include <assert.h>
 
+#include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_memory.h"
 #include "util/u_sampler.h"
 #include "util/u_surface.h"
@@ -36,6 +38,8 @@
 #include "vl_mpeg12_decoder.h"
 #include "vl_defines.h"
 
+#define MAX_BITSTREAM_THREADS 4
+
 #define SCALE_FACTOR_SNORM (32768.0f / 256.0f)
 #define SCALE_FACTOR_SSCALED (1.0f / 256.0f)
 
@@ -403,13 +407,33 @@ MotionVectorToPipe(const struct pipe_mpeg12_macroblock *mb, unsigned vector,
    return mv;
 }
 
+static inline void
+UploadYcbcrBlock(struct vl_mpeg12_buffer *buf, unsigned component,
+                 unsigned x, unsigned y, unsigned intra, unsigned coding,
+                 const short *texels)
+{
+   /* slices can be decoded on several threads at once, so claim the slots */
+   unsigned block_num = p_atomic_inc_return(&buf->block_num) - 1;
+   unsigned idx = p_atomic_inc_return(&buf->num_ycbcr_blocks[component]) - 1;
+   struct vl_ycbcr_block *stream = &buf->ycbcr_stream[component][idx];
+
+   stream->x = x;
+   stream->y = y;
+   stream->intra = intra;
+   stream->coding = coding;
+   stream->block_num = block_num;
+
+   memcpy(buf->texels + 64 * block_num, texels, 64 * sizeof(short));
+}
+
 static inline void
 UploadYcbcrBlocks(struct vl_mpeg12_decoder *dec,
                   struct vl_mpeg12_buffer *buf,
                   const struct pipe_mpeg12_macroblock *mb)
 {
+   const short *texels = mb->blocks;
    unsigned intra;
-   unsigned tb, x, y, num_blocks = 0;
+   unsigned tb, x, y;
 
    assert(dec && buf);
    assert(mb);
@@ -422,18 +446,9 @@ UploadYcbcrBlocks(struct vl_mpeg12_decoder *dec,
    for (y = 0; y < 2; ++y) {
       for (x = 0; x < 2; ++x) {
          if (mb->coded_block_pattern & const_empty_block_mask_420[0][y][x]) {
-
-            struct vl_ycbcr_block *stream = buf->ycbcr_stream[0];
-            stream->x = mb->x * 2 + x;
-            stream->y = mb->y * 2 + y;
-            stream->intra = intra;
-            stream->coding = mb->macroblock_modes.bits.dct_type;
-            stream->block_num = buf->block_num++;
-
-            buf->num_ycbcr_blocks[0]++;
-            buf->ycbcr_stream[0]++;
-
-            num_blocks++;
+            UploadYcbcrBlock(buf, 0, mb->x * 2 + x, mb->y * 2 + y, intra,
+                             mb->macroblock_modes.bits.dct_type, texels);
+            texels += 64;
          }
       }
    }
@@ -443,23 +458,10 @@ UploadYcbcrBlocks(struct vl_mpeg12_decoder *dec,
 
    for (tb = 1; tb < 3; ++tb) {
       if (mb->coded_block_pattern & const_empty_block_mask_420[tb][0][0]) {
-
-         struct vl_ycbcr_block *stream = buf->ycbcr_stream[tb];
-         stream->x = mb->x;
-         stream->y = mb->y;
-         stream->intra = intra;
-         stream->coding = 0;
-         stream->block_num = buf->block_num++;
-
-         buf->num_ycbcr_blocks[tb]++;
-         buf->ycbcr_stream[tb]++;
-
-         num_blocks++;
+         UploadYcbcrBlock(buf, tb, mb->x, mb->y, intra, 0, texels);
+         texels += 64;
       }
    }
-
-   memcpy(buf->texels, mb->blocks, 64 * sizeof(short) * num_blocks);
-   buf->texels += 64 * num_blocks;
 }
 
 static void
@@ -472,6 +474,7 @@ vl_mpeg12_destroy_buffer(struct vl_mpeg12_buffer *buf)
    cleanup_idct_buffer(buf);
    cleanup_mc_buffer(buf);
    vl_vb_cleanup(&buf->vertex_stream);
+   vl_mpg12_bs_cleanup(&buf->bs);
 
    FREE(buf);
 }
@@ -520,6 +523,9 @@ vl_mpeg12_destroy(struct pipe_video_codec *decoder)
       if (dec->dec_buffers[i])
          vl_mpeg12_destroy_buffer(dec->dec_buffers[i]);
 
+   if (util_queue_is_initialized(&dec->bs_queue))
+      util_queue_destroy(&dec->bs_queue);
+
    dec->context->destroy(dec->context);
 
    FREE(dec);
@@ -560,8 +566,11 @@ vl_mpeg12_get_decode_buffer(struct vl_mpeg12_decoder *dec, struct pipe_video_buf
    if (!init_zscan_buffer(dec, buffer))
       goto error_zscan;
 
-   if (dec->base.entrypoint == PIPE_VIDEO_ENTRYPOINT_BITSTREAM)
+   if (dec->base.entrypoint == PIPE_VIDEO_ENTRYPOINT_BITSTREAM) {
       vl_mpg12_bs_init(&buffer->bs, &dec->base);
+      if (util_queue_is_initialized(&dec->bs_queue))
+         vl_mpg12_bs_set_queue(&buffer->bs, &dec->bs_queue);
+   }
 
    if (dec->base.expect_chunked_decode)
       priv->buffer = buffer;
@@ -1211,6 +1220,15 @@ vl_create_mpeg12_decoder(struct pipe_context *context,
 
    list_inithead(&dec->buffer_privates);
 
+   /* Slice parsing and coefficient decoding is all CPU work, spread it
+    * over a few threads. Staying single threaded is fine if this fails. */
+   if (templat->entrypoint == PIPE_VIDEO_ENTRYPOINT_BITSTREAM) {
+      util_cpu_detect();
+      if (util_cpu_caps.nr_cpus > 1)
+         util_queue_init(&dec->bs_queue, "mpeg12bs", 32,
+                         MIN2(util_cpu_caps.nr_cpus, MAX_BITSTREAM_THREADS));
+   }
+
    return &dec->base;
 
 error_pipe_state:
@@ -31,6 +31,7 @@
 #include "pipe/p_video_codec.h"
 
 #include "util/list.h"
+#include "util/u_queue.h"
 
 #include "vl_mpeg12_bitstream.h"
 #include "vl_zscan.h"
@@ -81,6 +82,9 @@ struct vl_mpeg12_decoder
    struct vl_mpeg12_buffer *dec_buffers[4];
 
    struct list_head buffer_privates;
+
+   /* worker threads decoding slices, only for the bitstream entrypoint */
+   struct util_queue bs_queue;
 };
 
 struct vl_mpeg12_buffer
@@ -158,7 +158,7 @@ emit_binning_workaround(struct fd_context *ctx)
 {
 	struct fd3_context *fd3_ctx = fd3_context(ctx);
 	struct fd_gmem_stateobj *gmem = &ctx->gmem;
-	struct fd_ringbuffer *ring = ctx->ring;
+	struct fd_ringbuffer *ring = ctx->batch->ring;
 	struct fd3_emit emit = {
 			.vtx = &fd3_ctx->solid_vbuf_state,
 			.prog = &ctx->solid_prog,
@@ -311,7 +311,7 @@ emit_gmem2mem_surf(struct fd_context *ctx,
 				   bool stencil,
 				   uint32_t base, struct pipe_surface *psurf)
 {
-	struct fd_ringbuffer *ring = ctx->ring;
+	struct fd_ringbuffer *ring = ctx->batch->ring;
 	struct fd_resource *rsc = fd_resource(psurf->texture);
 	enum pipe_format format = psurf->format;
 	if (stencil) {
@@ -348,8 +348,8 @@ static void
 fd3_emit_tile_gmem2mem(struct fd_context *ctx, struct fd_tile *tile)
 {
 	struct fd3_context *fd3_ctx = fd3_context(ctx);
-	struct fd_ringbuffer *ring = ctx->ring;
-	struct pipe_framebuffer_state *pfb = &ctx->framebuffer;
+	struct fd_ringbuffer *ring = ctx->batch->ring;
+	struct pipe_framebuffer_state *pfb = &ctx->batch->framebuffer;
 	struct fd3_emit emit = {
 			.vtx = &fd3_ctx->solid_vbuf_state,
 			.prog = &ctx->solid_prog,
@@ -434,21 +434,21 @@ fd3_emit_tile_gmem2mem(struct fd_context *ctx, struct fd_tile *tile)
 	fd3_program_emit(ring, &emit, 0, NULL);
 	fd3_emit_vertex_bufs(ring, &emit);
 
-	if (ctx->resolve & (FD_BUFFER_DEPTH | FD_BUFFER_STENCIL)) {
+	if (fd_gmem_needs_resolve(ctx, tile, FD_BUFFER_DEPTH | FD_BUFFER_STENCIL)) {
 		struct fd_resource *rsc = fd_resource(pfb->zsbuf->texture);
-		if (!rsc->stencil || ctx->resolve & FD_BUFFER_DEPTH)
+		if (!rsc->stencil || fd_gmem_needs_resolve(ctx, tile, FD_BUFFER_DEPTH))
 			emit_gmem2mem_surf(ctx, RB_COPY_DEPTH_STENCIL, false,
 							   ctx->gmem.zsbuf_base[0], pfb->zsbuf);
-		if (rsc->stencil && ctx->resolve & FD_BUFFER_STENCIL)
+		if (rsc->stencil && fd_gmem_needs_resolve(ctx, tile, FD_BUFFER_STENCIL))
 			emit_gmem2mem_surf(ctx, RB_COPY_DEPTH_STENCIL, true,
 							   ctx->gmem.zsbuf_base[1], pfb->zsbuf);
 	}
 
-	if (ctx->resolve & FD_BUFFER_COLOR) {
+	if (fd_gmem_needs_resolve(ctx, tile, FD_BUFFER_COLOR)) {
 		for (i = 0; i < pfb->nr_cbufs; i++) {
 			if (!pfb->cbufs[i])
 				continue;
-			if (!(ctx->resolve & (PIPE_CLEAR_COLOR0 << i)))
+			if (!(ctx->batch->resolve & (PIPE_CLEAR_COLOR0 << i)))
 				continue;
 			emit_gmem2mem_surf(ctx, RB_COPY_RESOLVE, false,
 							   ctx->gmem.cbuf_base[i], pfb->cbufs[i]);
@@ -472,7 +472,7 @@ static void
 emit_mem2gmem_surf(struct fd_context *ctx, uint32_t bases[],
 		struct pipe_surface **psurf, uint32_t bufs, uint32_t bin_w)
 {
-	struct fd_ringbuffer *ring = ctx->ring;
+	struct fd_ringbuffer *ring = ctx->batch->ring;
 	struct pipe_surface *zsbufs[2];
 
 	assert(bufs > 0);
@@ -529,8 +529,8 @@ fd3_emit_tile_mem2gmem(struct fd_context *ctx, struct fd_tile *tile)
 {
 	struct fd3_context *fd3_ctx = fd3_context(ctx);
 	struct fd_gmem_stateobj *gmem = &ctx->gmem;
-	struct fd_ringbuffer *ring = ctx->ring;
-	struct pipe_framebuffer_state *pfb = &ctx->framebuffer;
+	struct fd_ringbuffer *ring = ctx->batch->ring;
+	struct pipe_framebuffer_state *pfb = &ctx->batch->framebuffer;
 	struct fd3_emit emit = {
 			.vtx = &fd3_ctx->blit_vbuf_state,
 			.sprite_coord_enable = 1,
@@ -694,11 +694,11 @@ static void
 patch_draws(struct fd_context *ctx, enum pc_di_vis_cull_mode vismode)
 {
 	unsigned i;
-	for (i = 0; i < fd_patch_num_elements(&ctx->draw_patches); i++) {
-		struct fd_cs_patch *patch = fd_patch_element(&ctx->draw_patches, i);
+	for (i = 0; i < fd_patch_num_elements(&ctx->batch->draw_patches); i++) {
+		struct fd_cs_patch *patch = fd_patch_element(&ctx->batch->draw_patches, i);
 		*patch->cs = patch->val | DRAW(0, 0, 0, vismode, 0);
 	}
-	util_dynarray_resize(&ctx->draw_patches, 0);
+	util_dynarray_resize(&ctx->batch->draw_patches, 0);
 }
 
 static void
@@ -717,8 +717,8 @@ patch_rbrc(struct fd_context *ctx, uint32_t val)
 static void
 fd3_emit_sysmem_prep(struct fd_context *ctx)
 {
-	struct pipe_framebuffer_state *pfb = &ctx->framebuffer;
-	struct fd_ringbuffer *ring = ctx->ring;
+	struct pipe_framebuffer_state *pfb = &ctx->batch->framebuffer;
+	struct fd_ringbuffer *ring = ctx->batch->ring;
 	uint32_t i, pitch = 0;
 
 	for (i = 0; i < pfb->nr_cbufs; i++) {
@@ -761,7 +761,7 @@ static void
 update_vsc_pipe(struct fd_context *ctx)
 {
 	struct fd3_context *fd3_ctx = fd3_context(ctx);
-	struct fd_ringbuffer *ring = ctx->ring;
+	struct fd_ringbuffer *ring = ctx->batch->ring;
 	int i;
 
 	OUT_PKT0(ring, REG_A3XX_VSC_SIZE_ADDRESS, 1);
@@ -789,8 +789,8 @@ static void
 emit_binning_pass(struct fd_context *ctx)
 {
 	struct fd_gmem_stateobj *gmem = &ctx->gmem;
-	struct pipe_framebuffer_state *pfb = &ctx->framebuffer;
-	struct fd_ringbuffer *ring = ctx->ring;
+	struct pipe_framebuffer_state *pfb = &ctx->batch->framebuffer;
+	struct fd_ringbuffer *ring = ctx->batch->ring;
 	int i;
 
 	uint32_t x1 = gmem->minx;
@@ -853,7 +853,7 @@ emit_binning_pass(struct fd_context *ctx)
 			A3XX_PC_VSTREAM_CONTROL_N(0));
 
 	/* emit IB to binning drawcmds: */
-	ctx->emit_ib(ring, ctx->binning_start, ctx->binning_end);
+	ctx->emit_ib(ring, ctx->batch->binning_start, ctx->batch->binning_end);
 	fd_reset_wfi(ctx);
 
 	fd_wfi(ctx, ring);
@@ -915,7 +915,7 @@ emit_binning_pass(struct fd_context *ctx)
 static void
 fd3_emit_tile_init(struct fd_context *ctx)
 {
-	struct fd_ringbuffer *ring = ctx->ring;
+	struct fd_ringbuffer *ring = ctx->batch->ring;
 	struct fd_gmem_stateobj *gmem = &ctx->gmem;
 	uint32_t rb_render_control;
 
@@ -949,8 +949,8 @@ fd3_emit_tile_init(struct fd_context *ctx)
 static void
 fd3_emit_tile_prep(struct fd_context *ctx, struct fd_tile *tile)
 {
-	struct fd_ringbuffer *ring = ctx->ring;
-	struct pipe_framebuffer_state *pfb = &ctx->framebuffer;
+	struct fd_ringbuffer *ring = ctx->batch->ring;
+	struct pipe_framebuffer_state *pfb = &ctx->batch->framebuffer;
 
 	if (ctx->needs_rb_fbd) {
 		fd_wfi(ctx, ring);
@@ -971,9 +971,9 @@ static void
 fd3_emit_tile_renderprep(struct fd_context *ctx, struct fd_tile *tile)
 {
 	struct fd3_context *fd3_ctx = fd3_context(ctx);
-	struct fd_ringbuffer *ring = ctx->ring;
+	struct fd_ringbuffer *ring = ctx->batch->ring;
 	struct fd_gmem_stateobj *gmem = &ctx->gmem;
-	struct pipe_framebuffer_state *pfb = &ctx->framebuffer;
+	struct pipe_framebuffer_state *pfb = &ctx->batch->framebuffer;
 
 	uint32_t x1 = tile->xoff;
 	uint32_t y1 = tile->yoff;
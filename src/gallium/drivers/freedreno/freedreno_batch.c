@@ -0,0 +1,412 @@
+/* -*- mode: C; c-file-style: "k&r"; tab-width 4; indent-tabs-mode: t; -*- */
+
+/*
+ * Copyright (C) 2016 Rob Clark <robclark@freedesktop.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Authors:
+ *    Rob Clark <robclark@freedesktop.org>
+ */
+
+#include "util/hash_table.h"
+#include "util/set.h"
+#include "util/u_framebuffer.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#include "freedreno_batch.h"
+#include "freedreno_context.h"
+#include "freedreno_gmem.h"
+#include "freedreno_resource.h"
+#include "freedreno_util.h"
+
+static struct fd_ringbuffer *next_rb(struct fd_batch *batch)
+{
+	struct fd_ringbuffer *ring;
+	uint32_t ts;
+
+	/* grab next ringbuffer: */
+	ring = batch->rings[(batch->rings_idx++) % ARRAY_SIZE(batch->rings)];
+
+	/* wait for new rb to be idle: */
+	ts = fd_ringbuffer_timestamp(ring);
+	if (ts) {
+		DBG("wait: %u", ts);
+		fd_pipe_wait(batch->ctx->screen->pipe, ts);
+	}
+
+	fd_ringbuffer_reset(ring);
+
+	return ring;
+}
+
+static void
+batch_next_rb(struct fd_batch *batch)
+{
+	struct fd_ringbuffer *ring;
+
+	if (batch->draw_start)
+		fd_ringmarker_del(batch->draw_start);
+	if (batch->draw_end)
+		fd_ringmarker_del(batch->draw_end);
+
+	ring = next_rb(batch);
+
+	batch->draw_start = fd_ringmarker_new(ring);
+	batch->draw_end = fd_ringmarker_new(ring);
+
+	fd_ringbuffer_set_parent(ring, NULL);
+	batch->ring = ring;
+
+	if (batch->binning_start)
+		fd_ringmarker_del(batch->binning_start);
+	if (batch->binning_end)
+		fd_ringmarker_del(batch->binning_end);
+
+	ring = next_rb(batch);
+
+	batch->binning_start = fd_ringmarker_new(ring);
+	batch->binning_end = fd_ringmarker_new(ring);
+
+	fd_ringbuffer_set_parent(ring, batch->ring);
+	batch->binning_ring = ring;
+}
+
+static bool
+rect_contains(const struct pipe_scissor_state *a,
+		const struct pipe_scissor_state *b)
+{
+	return (b->minx >= a->minx) && (b->maxx <= a->maxx) &&
+			(b->miny >= a->miny) && (b->maxy <= a->maxy);
+}
+
+static unsigned
+rect_area(const struct pipe_scissor_state *r)
+{
+	return (r->maxx - r->minx) * (r->maxy - r->miny);
+}
+
+static void
+rect_union(struct pipe_scissor_state *a, const struct pipe_scissor_state *b)
+{
+	a->minx = MIN2(a->minx, b->minx);
+	a->miny = MIN2(a->miny, b->miny);
+	a->maxx = MAX2(a->maxx, b->maxx);
+	a->maxy = MAX2(a->maxy, b->maxy);
+}
+
+void
+fd_region_add(struct fd_region *region,
+		const struct pipe_scissor_state *rect, bool grow)
+{
+	unsigned i, best = 0, best_growth = ~0;
+
+	if ((rect->minx >= rect->maxx) || (rect->miny >= rect->maxy))
+		return;
+
+	/* drop rects made redundant by the new one, and skip the new one
+	 * if it is already covered:
+	 */
+	for (i = 0; i < region->num_rects; ) {
+		if (rect_contains(&region->rects[i], rect))
+			return;
+		if (rect_contains(rect, &region->rects[i]))
+			region->rects[i] = region->rects[--region->num_rects];
+		else
+			i++;
+	}
+
+	if (region->num_rects < ARRAY_SIZE(region->rects)) {
+		region->rects[region->num_rects++] = *rect;
+		return;
+	}
+
+	if (!grow)
+		return;
+
+	/* merge into the rect which grows the least: */
+	for (i = 0; i < region->num_rects; i++) {
+		struct pipe_scissor_state u = region->rects[i];
+		unsigned growth;
+
+		rect_union(&u, rect);
+		growth = rect_area(&u) - rect_area(&region->rects[i]);
+		if (growth < best_growth) {
+			best_growth = growth;
+			best = i;
+		}
+	}
+
+	rect_union(&region->rects[best], rect);
+}
+
+static void
+reset_max_scissor(struct fd_batch *batch)
+{
+	batch->max_scissor.minx = batch->max_scissor.miny = ~0;
+	batch->max_scissor.maxx = batch->max_scissor.maxy = 0;
+}
+
+struct fd_batch *
+fd_batch_create(struct fd_context *ctx, unsigned idx)
+{
+	struct fd_batch *batch = CALLOC_STRUCT(fd_batch);
+	unsigned i;
+
+	if (!batch)
+		return NULL;
+
+	batch->ctx = ctx;
+	batch->idx = idx;
+
+	for (i = 0; i < ARRAY_SIZE(batch->rings); i++) {
+		batch->rings[i] = fd_ringbuffer_new(ctx->screen->pipe, 0x100000);
+		if (!batch->rings[i])
+			goto fail;
+	}
+
+	batch->resources = _mesa_set_create(NULL, _mesa_hash_pointer,
+			_mesa_key_pointer_equal);
+	if (!batch->resources)
+		goto fail;
+
+	util_dynarray_init(&batch->draw_patches);
+	reset_max_scissor(batch);
+	batch_next_rb(batch);
+
+	return batch;
+
+fail:
+	fd_batch_destroy(batch);
+	return NULL;
+}
+
+/* forget about the resources used by the batch, once its cmds have been
+ * submitted (or discarded):
+ */
+static void
+batch_reset_resources(struct fd_batch *batch)
+{
+	struct set_entry *entry;
+
+	set_foreach(batch->resources, entry) {
+		struct fd_resource *rsc = (struct fd_resource *)entry->key;
+
+		rsc->batch_mask &= ~(1 << batch->idx);
+		if (rsc->write_batch == batch)
+			rsc->write_batch = NULL;
+		if (!rsc->batch_mask)
+			rsc->pending_ctx = NULL;
+	}
+
+	_mesa_set_clear(batch->resources, NULL);
+}
+
+void
+fd_batch_destroy(struct fd_batch *batch)
+{
+	unsigned i;
+
+	if (batch->resources) {
+		batch_reset_resources(batch);
+		_mesa_set_destroy(batch->resources, NULL);
+	}
+
+	util_dynarray_fini(&batch->draw_patches);
+	util_unreference_framebuffer_state(&batch->framebuffer);
+
+	if (batch->draw_start)
+		fd_ringmarker_del(batch->draw_start);
+	if (batch->draw_end)
+		fd_ringmarker_del(batch->draw_end);
+	if (batch->binning_start)
+		fd_ringmarker_del(batch->binning_start);
+	if (batch->binning_end)
+		fd_ringmarker_del(batch->binning_end);
+
+	for (i = 0; i < ARRAY_SIZE(batch->rings); i++)
+		if (batch->rings[i])
+			fd_ringbuffer_del(batch->rings[i]);
+
+	FREE(batch);
+}
+
+/* emit accumulated render cmds, needed for example if some other batch
+ * or the cpu needs the result, or for flush()
+ */
+void
+fd_batch_flush(struct fd_batch *batch)
+{
+	struct fd_context *ctx = batch->ctx;
+	struct fd_batch *bound = ctx->batch;
+
+	DBG("%u: needs_flush: %d", batch->idx, batch->needs_flush);
+
+	if (!batch->needs_flush)
+		return;
+
+	/* the gmem code only looks at ctx->batch: */
+	ctx->batch = batch;
+
+	fd_gmem_render_tiles(ctx);
+
+	ctx->last_timestamp = fd_ringbuffer_timestamp(batch->ring);
+
+	DBG("%p/%p/%p", batch->ring->start, batch->ring->cur, batch->ring->end);
+
+	/* if size in dwords is more than half the buffer size, then wait and
+	 * wrap around:
+	 */
+	if ((batch->ring->cur - batch->ring->start) > batch->ring->size/8)
+		batch_next_rb(batch);
+
+	batch->needs_flush = false;
+	batch->cleared = batch->restore = batch->resolve = 0;
+	memset(&batch->cleared_region, 0, sizeof(batch->cleared_region));
+	memset(&batch->written_region, 0, sizeof(batch->written_region));
+	batch->gmem_reason = 0;
+	batch->num_draws = 0;
+
+	batch_reset_resources(batch);
+
+	ctx->batch = bound;
+}
+
+/* find the batch for a framebuffer that is about to be bound.  If there
+ * isn't one yet, an idle batch is retargeted, or a new one created, and
+ * only if all FD_MAX_BATCHES have rendering queued up does the least
+ * recently used one get flushed to make room.
+ */
+struct fd_batch *
+fd_batch_for_framebuffer(struct fd_context *ctx,
+		const struct pipe_framebuffer_state *pfb)
+{
+	struct fd_batch *batch = NULL;
+	unsigned i;
+
+	for (i = 0; i < ARRAY_SIZE(ctx->batches); i++) {
+		struct fd_batch *b = ctx->batches[i];
+		if (b && util_framebuffer_state_equal(&b->framebuffer, pfb)) {
+			batch = b;
+			goto out;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(ctx->batches); i++) {
+		struct fd_batch *b = ctx->batches[i];
+		if (b && !b->needs_flush && (!batch || (b->seqno < batch->seqno)))
+			batch = b;
+	}
+
+	for (i = 0; !batch && (i < ARRAY_SIZE(ctx->batches)); i++)
+		if (!ctx->batches[i])
+			batch = ctx->batches[i] = fd_batch_create(ctx, i);
+
+	if (!batch) {
+		for (i = 0; i < ARRAY_SIZE(ctx->batches); i++) {
+			struct fd_batch *b = ctx->batches[i];
+			if (b && (!batch || (b->seqno < batch->seqno)))
+				batch = b;
+		}
+		DBG("evicting batch %u", batch->idx);
+		fd_batch_flush(batch);
+	}
+
+	util_copy_framebuffer_state(&batch->framebuffer, pfb);
+
+out:
+	batch->seqno = ++ctx->batch_seqno;
+	return batch;
+}
+
+/* track a resource read or written by the batch's cmds.  If another
+ * batch has queued up a write to it, or (for writes) any access at
+ * all, that batch is flushed first to keep things in order.
+ */
+void
+fd_batch_resource_used(struct fd_batch *batch, struct fd_resource *rsc,
+		bool write)
+{
+	struct fd_context *ctx = batch->ctx;
+
+	/* TODO resources can actually be shared across contexts,
+	 * so I'm not sure a single pending_ctx will do the trick?
+	 */
+	debug_assert((rsc->pending_ctx == ctx) || !rsc->pending_ctx);
+
+	if (write) {
+		uint32_t mask = rsc->batch_mask & ~(1 << batch->idx);
+		while (mask)
+			fd_batch_flush(ctx->batches[u_bit_scan(&mask)]);
+	} else if (rsc->write_batch && (rsc->write_batch != batch)) {
+		fd_batch_flush(rsc->write_batch);
+	}
+
+	rsc->batch_mask |= (1 << batch->idx);
+	if (write)
+		rsc->write_batch = batch;
+	rsc->pending_ctx = ctx;
+
+	_mesa_set_add(batch->resources, rsc);
+
+	if (rsc->stencil)
+		fd_batch_resource_used(batch, rsc->stencil, write);
+}
+
+/* flush whatever batches the cpu needs to wait for before accessing the
+ * resource, ie. the one writing it, or for writes every batch using it:
+ */
+void
+fd_batch_flush_resource(struct fd_context *ctx, struct fd_resource *rsc,
+		bool write)
+{
+	if (rsc->pending_ctx == ctx) {
+		if (write) {
+			uint32_t mask = rsc->batch_mask;
+			while (mask)
+				fd_batch_flush(ctx->batches[u_bit_scan(&mask)]);
+		} else if (rsc->write_batch) {
+			fd_batch_flush(rsc->write_batch);
+		}
+	}
+
+	if (rsc->stencil)
+		fd_batch_flush_resource(ctx, rsc->stencil, write);
+}
+
+/* stop tracking a resource that is destroyed, or gets a new bo: */
+void
+fd_batch_resource_remove(struct fd_resource *rsc)
+{
+	struct fd_context *ctx = rsc->pending_ctx;
+	uint32_t mask = rsc->batch_mask;
+
+	while (ctx && mask) {
+		struct fd_batch *batch = ctx->batches[u_bit_scan(&mask)];
+		struct set_entry *entry = _mesa_set_search(batch->resources, rsc);
+		if (entry)
+			_mesa_set_remove(batch->resources, entry);
+	}
+
+	rsc->batch_mask = 0;
+	rsc->write_batch = NULL;
+	rsc->pending_ctx = NULL;
+}
@@ -0,0 +1,195 @@
+/* -*- mode: C; c-file-style: "k&r"; tab-width 4; indent-tabs-mode: t; -*- */
+
+/*
+ * Copyright (C) 2016 Rob Clark <robclark@freedesktop.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Authors:
+ *    Rob Clark <robclark@freedesktop.org>
+ */
+
+#ifndef FREEDRENO_BATCH_H_
+#define FREEDRENO_BATCH_H_
+
+#include "pipe/p_state.h"
+#include "util/u_dynarray.h"
+
+#include "freedreno_util.h"
+
+struct fd_context;
+struct fd_resource;
+struct set;
+
+/* max # of batches (ie. framebuffers with queued up rendering) per
+ * context, limited by the size of fd_resource::batch_mask:
+ */
+#define FD_MAX_BATCHES 4
+
+/* A handful of rects (in framebuffer coords), the union of which is the
+ * area of a buffer that was cleared or written by the batch.  If there
+ * are too many rects, a region of written pixels is grown to cover the
+ * new rect, whereas a region of cleared pixels just drops it, since each
+ * region must err on the side of causing a restore/resolve.
+ */
+#define FD_MAX_REGION_RECTS 8
+
+struct fd_region {
+	unsigned num_rects;
+	struct pipe_scissor_state rects[FD_MAX_REGION_RECTS];
+};
+
+void fd_region_add(struct fd_region *region,
+		const struct pipe_scissor_state *rect, bool grow);
+
+/* A batch is the clear/draw cmds queued up for one framebuffer, which
+ * only get turned into per-tile cmds and submitted when the batch is
+ * flushed (see fd_gmem_render_tiles()).  Each framebuffer the app
+ * renders to gets its own batch, so switching render targets doesn't
+ * need to flush.  Instead the resources read and written by each batch
+ * are tracked, and a batch is only flushed when the cpu or another
+ * batch needs the result.
+ *
+ * The bound framebuffer's batch is ctx->batch.  While flushing some
+ * other batch, ctx->batch temporarily points to that one, so the gmem
+ * code (and the per-generation tile cmd emit fxns) only ever need to
+ * look at ctx->batch.
+ */
+struct fd_batch {
+	struct fd_context *ctx;
+
+	/* index in ctx->batches[], and bit in fd_resource::batch_mask: */
+	unsigned idx;
+
+	/* updated whenever the batch is bound, to pick the least recently
+	 * used batch when all of them are in use:
+	 */
+	uint32_t seqno;
+
+	struct pipe_framebuffer_state framebuffer;
+
+	/* do we need to mem2gmem before rendering.  We don't, if for example,
+	 * there was a glClear() that invalidated the entire previous buffer
+	 * contents.  Keep track of which buffer(s) are cleared, or needs
+	 * restore.  Masks of PIPE_CLEAR_*
+	 *
+	 * The 'cleared' bits will be set for buffers which are *entirely*
+	 * cleared.  Which tiles of partially cleared buffers can skip the
+	 * mem2gmem is figured out per-tile from cleared_region.
+	 */
+	enum {
+		/* align bitmask values w/ PIPE_CLEAR_*.. since that is convenient.. */
+		FD_BUFFER_COLOR   = PIPE_CLEAR_COLOR,
+		FD_BUFFER_DEPTH   = PIPE_CLEAR_DEPTH,
+		FD_BUFFER_STENCIL = PIPE_CLEAR_STENCIL,
+		FD_BUFFER_ALL     = FD_BUFFER_COLOR | FD_BUFFER_DEPTH | FD_BUFFER_STENCIL,
+	} cleared, restore, resolve;
+
+	bool needs_flush;
+
+	/* To decide whether to render to system memory, keep track of the
+	 * number of draws, and whether any of them require multisample,
+	 * depth_test (or depth write), stencil_test, blending, and
+	 * color_logic_Op (since those functions are disabled when by-
+	 * passing GMEM.
+	 */
+	enum {
+		FD_GMEM_CLEARS_DEPTH_STENCIL = 0x01,
+		FD_GMEM_DEPTH_ENABLED        = 0x02,
+		FD_GMEM_STENCIL_ENABLED      = 0x04,
+
+		FD_GMEM_MSAA_ENABLED         = 0x08,
+		FD_GMEM_BLEND_ENABLED        = 0x10,
+		FD_GMEM_LOGICOP_ENABLED      = 0x20,
+	} gmem_reason;
+	unsigned num_draws;   /* number of draws in current batch */
+
+	/* we can't really sanely deal with wraparound point in ringbuffer
+	 * and because of the way tiling works we can't really flush at
+	 * arbitrary points (without a big performance hit).  When we get
+	 * too close to the end of the current ringbuffer, cycle to the next
+	 * one (and wait for pending rendering from next rb to complete).
+	 * We want the # of ringbuffers to be high enough that we don't
+	 * normally have to wait before resetting to the start of the next
+	 * rb.  Since each batch has its own set, and only cycles when it
+	 * is flushed, fewer are needed than when a single batch had to
+	 * absorb every render target switch.
+	 */
+	struct fd_ringbuffer *rings[4];
+	unsigned rings_idx;
+
+	/* NOTE: currently using a single ringbuffer for both draw and
+	 * tiling commands, we need to make sure we need to leave enough
+	 * room at the end to append the tiling commands when we flush.
+	 * 0x7000 dwords should be a couple times more than we ever need
+	 * so should be a nice conservative threshold.
+	 */
+#define FD_TILING_COMMANDS_DWORDS 0x7000
+
+	/* normal draw/clear cmds: */
+	struct fd_ringbuffer *ring;
+	struct fd_ringmarker *draw_start, *draw_end;
+
+	/* binning pass draw/clear cmds: */
+	struct fd_ringbuffer *binning_ring;
+	struct fd_ringmarker *binning_start, *binning_end;
+
+	/* Keep track of DRAW initiators that need to be patched up depending
+	 * on whether we using binning or not:
+	 */
+	struct util_dynarray draw_patches;
+
+	/* Track the maximal bounds of the scissor of all the draws within a
+	 * batch.  Used at the tile rendering step (fd_gmem_render_tiles(),
+	 * mem2gmem/gmem2mem) to avoid needlessly moving data in/out of gmem.
+	 */
+	struct pipe_scissor_state max_scissor;
+
+	/* Track, per color/depth/stencil, the area cleared before the first
+	 * draw to the buffer, and the area written by any clear or draw, so
+	 * we know per-tile whether mem2gmem (restore) and gmem2mem (resolve)
+	 * are needed.  Tiles that no clear or draw touched are left alone
+	 * in both directions.
+	 */
+	struct {
+		struct fd_region color[PIPE_MAX_COLOR_BUFS], depth, stencil;
+	} cleared_region;
+	struct {
+		struct fd_region color, depth, stencil;
+	} written_region;
+
+	/* set of resources read or written by the queued up cmds: */
+	struct set *resources;
+};
+
+struct fd_batch * fd_batch_create(struct fd_context *ctx, unsigned idx);
+void fd_batch_destroy(struct fd_batch *batch);
+void fd_batch_flush(struct fd_batch *batch);
+
+struct fd_batch * fd_batch_for_framebuffer(struct fd_context *ctx,
+		const struct pipe_framebuffer_state *pfb);
+
+void fd_batch_resource_used(struct fd_batch *batch,
+		struct fd_resource *rsc, bool write);
+void fd_batch_flush_resource(struct fd_context *ctx,
+		struct fd_resource *rsc, bool write);
+void fd_batch_resource_remove(struct fd_resource *rsc);
+
+#endif /* FREEDRENO_BATCH_H_ */
@@ -38,106 +38,31 @@
 #include "freedreno_query_hw.h"
 #include "freedreno_util.h"
 
-static struct fd_ringbuffer *next_rb(struct fd_context *ctx)
-{
-	struct fd_ringbuffer *ring;
-	uint32_t ts;
-
-	/* grab next ringbuffer: */
-	ring = ctx->rings[(ctx->rings_idx++) % ARRAY_SIZE(ctx->rings)];
-
-	/* wait for new rb to be idle: */
-	ts = fd_ringbuffer_timestamp(ring);
-	if (ts) {
-		DBG("wait: %u", ts);
-		fd_pipe_wait(ctx->screen->pipe, ts);
-	}
-
-	fd_ringbuffer_reset(ring);
-
-	return ring;
-}
-
-static void
-fd_context_next_rb(struct pipe_context *pctx)
-{
-	struct fd_context *ctx = fd_context(pctx);
-	struct fd_ringbuffer *ring;
-
-	fd_ringmarker_del(ctx->draw_start);
-	fd_ringmarker_del(ctx->draw_end);
-
-	ring = next_rb(ctx);
-
-	ctx->draw_start = fd_ringmarker_new(ring);
-	ctx->draw_end = fd_ringmarker_new(ring);
-
-	fd_ringbuffer_set_parent(ring, NULL);
-	ctx->ring = ring;
-
-	fd_ringmarker_del(ctx->binning_start);
-	fd_ringmarker_del(ctx->binning_end);
-
-	ring = next_rb(ctx);
-
-	ctx->binning_start = fd_ringmarker_new(ring);
-	ctx->binning_end = fd_ringmarker_new(ring);
-
-	fd_ringbuffer_set_parent(ring, ctx->ring);
-	ctx->binning_ring = ring;
-}
-
-/* emit accumulated render cmds, needed for example if render target has
- * changed, or for flush()
+/* emit accumulated render cmds of all batches, needed for example if
+ * render target is about to be read back, or for flush()
  */
 void
 fd_context_render(struct pipe_context *pctx)
 {
 	struct fd_context *ctx = fd_context(pctx);
-	struct fd_resource *rsc, *rsc_tmp;
-
-	DBG("needs_flush: %d", ctx->needs_flush);
-
-	if (!ctx->needs_flush)
-		return;
-
-	fd_gmem_render_tiles(ctx);
-
-	DBG("%p/%p/%p", ctx->ring->start, ctx->ring->cur, ctx->ring->end);
-
-	/* if size in dwords is more than half the buffer size, then wait and
-	 * wrap around:
-	 */
-	if ((ctx->ring->cur - ctx->ring->start) > ctx->ring->size/8)
-		fd_context_next_rb(pctx);
-
-	ctx->needs_flush = false;
-	ctx->cleared = ctx->partial_cleared = ctx->restore = ctx->resolve = 0;
-	ctx->gmem_reason = 0;
-	ctx->num_draws = 0;
-
-	/* go through all the used resources and clear their reading flag */
-	LIST_FOR_EACH_ENTRY_SAFE(rsc, rsc_tmp, &ctx->used_resources, list) {
-		debug_assert(rsc->status != 0);
-		rsc->status = 0;
-		rsc->pending_ctx = NULL;
-		list_delinit(&rsc->list);
-	}
+	unsigned i;
 
-	assert(LIST_IS_EMPTY(&ctx->used_resources));
+	for (i = 0; i < ARRAY_SIZE(ctx->batches); i++)
+		if (ctx->batches[i])
+			fd_batch_flush(ctx->batches[i]);
 }
 
 static void
 fd_context_flush(struct pipe_context *pctx, struct pipe_fence_handle **fence,
 		unsigned flags)
 {
-	struct fd_ringbuffer *ring = fd_context(pctx)->ring;
+	struct fd_context *ctx = fd_context(pctx);
 
 	fd_context_render(pctx);
 
 	if (fence) {
 		fd_screen_fence_ref(pctx->screen, fence, NULL);
-		*fence = fd_fence_create(pctx, fd_ringbuffer_timestamp(ring));
+		*fence = fd_fence_create(pctx, ctx->last_timestamp);
 	}
 }
 
@@ -149,7 +74,7 @@ static void
 fd_emit_string_marker(struct pipe_context *pctx, const char *string, int len)
 {
 	struct fd_context *ctx = fd_context(pctx);
-	struct fd_ringbuffer *ring = ctx->ring;
+	struct fd_ringbuffer *ring = ctx->batch->ring;
 	const uint32_t *buf = (const void *)string;
 
 	/* max packet size is 0x3fff dwords: */
@@ -181,8 +106,6 @@ fd_context_destroy(struct pipe_context *pctx)
 	fd_prog_fini(pctx);
 	fd_hw_query_fini(pctx);
 
-	util_dynarray_fini(&ctx->draw_patches);
-
 	if (ctx->blitter)
 		util_blitter_destroy(ctx->blitter);
 
@@ -191,13 +114,13 @@ fd_context_destroy(struct pipe_context *pctx)
 
 	util_slab_destroy(&ctx->transfer_pool);
 
-	fd_ringmarker_del(ctx->draw_start);
-	fd_ringmarker_del(ctx->draw_end);
-	fd_ringmarker_del(ctx->binning_start);
-	fd_ringmarker_del(ctx->binning_end);
-
-	for (i = 0; i < ARRAY_SIZE(ctx->rings); i++)
-		fd_ringbuffer_del(ctx->rings[i]);
+	/* whatever was queued up but not flushed is dropped: */
+	for (i = 0; i < ARRAY_SIZE(ctx->batches); i++) {
+		if (ctx->batches[i])
+			fd_batch_destroy(ctx->batches[i]);
+		ctx->batches[i] = NULL;
+	}
+	ctx->batch = NULL;
 
 	for (i = 0; i < ARRAY_SIZE(ctx->pipe); i++) {
 		struct fd_vsc_pipe *pipe = &ctx->pipe[i];
@@ -238,17 +161,12 @@ fd_context_init(struct fd_context *ctx, struct pipe_screen *pscreen,
 	pctx->flush = fd_context_flush;
 	pctx->emit_string_marker = fd_emit_string_marker;
 
-	for (i = 0; i < ARRAY_SIZE(ctx->rings); i++) {
-		ctx->rings[i] = fd_ringbuffer_new(screen->pipe, 0x100000);
-		if (!ctx->rings[i])
-			goto fail;
-	}
+	ctx->batch = ctx->batches[0] = fd_batch_create(ctx, 0);
+	if (!ctx->batch)
+		goto fail;
 
-	fd_context_next_rb(pctx);
 	fd_reset_wfi(ctx);
 
-	util_dynarray_init(&ctx->draw_patches);
-
 	util_slab_create(&ctx->transfer_pool, sizeof(struct fd_transfer),
 			16, UTIL_SLAB_SINGLETHREADED);
 
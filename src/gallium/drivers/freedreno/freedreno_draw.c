@@ -40,45 +40,57 @@
 #include "freedreno_util.h"
 
 static void
-resource_used(struct fd_context *ctx, struct pipe_resource *prsc,
-		enum fd_resource_status status)
+resource_read(struct fd_context *ctx, struct pipe_resource *prsc)
 {
-	struct fd_resource *rsc;
-
 	if (!prsc)
 		return;
+	fd_batch_resource_used(ctx->batch, fd_resource(prsc), false);
+}
 
-	rsc = fd_resource(prsc);
-	rsc->status |= status;
-	if (rsc->stencil)
-		rsc->stencil->status |= status;
-
-	/* TODO resources can actually be shared across contexts,
-	 * so I'm not sure a single list-head will do the trick?
-	 */
-	debug_assert((rsc->pending_ctx == ctx) || !rsc->pending_ctx);
-	list_delinit(&rsc->list);
-	list_addtail(&rsc->list, &ctx->used_resources);
-	rsc->pending_ctx = ctx;
+static void
+resource_written(struct fd_context *ctx, struct pipe_resource *prsc)
+{
+	if (!prsc)
+		return;
+	fd_batch_resource_used(ctx->batch, fd_resource(prsc), true);
 }
 
+/* the current scissor, clipped to the framebuffer: */
 static void
-resource_read(struct fd_context *ctx, struct pipe_resource *prsc)
+framebuffer_rect(struct fd_context *ctx, struct pipe_scissor_state *rect)
 {
-	resource_used(ctx, prsc, FD_PENDING_READ);
+	struct pipe_scissor_state *scissor = fd_context_get_scissor(ctx);
+
+	rect->minx = MIN2(scissor->minx, ctx->disabled_scissor.maxx);
+	rect->miny = MIN2(scissor->miny, ctx->disabled_scissor.maxy);
+	rect->maxx = MIN2(scissor->maxx, ctx->disabled_scissor.maxx);
+	rect->maxy = MIN2(scissor->maxy, ctx->disabled_scissor.maxy);
 }
 
+/* record the area of each buffer a clear/draw may write, so tiles
+ * untouched by the batch can skip restore and resolve:
+ */
 static void
-resource_written(struct fd_context *ctx, struct pipe_resource *prsc)
+mark_written(struct fd_context *ctx, unsigned buffers)
 {
-	resource_used(ctx, prsc, FD_PENDING_WRITE);
+	struct fd_batch *batch = ctx->batch;
+	struct pipe_scissor_state rect;
+
+	framebuffer_rect(ctx, &rect);
+
+	if (buffers & FD_BUFFER_COLOR)
+		fd_region_add(&batch->written_region.color, &rect, true);
+	if (buffers & FD_BUFFER_DEPTH)
+		fd_region_add(&batch->written_region.depth, &rect, true);
+	if (buffers & FD_BUFFER_STENCIL)
+		fd_region_add(&batch->written_region.stencil, &rect, true);
 }
 
 static void
 fd_draw_vbo(struct pipe_context *pctx, const struct pipe_draw_info *info)
 {
 	struct fd_context *ctx = fd_context(pctx);
-	struct pipe_framebuffer_state *pfb = &ctx->framebuffer;
+	struct pipe_framebuffer_state *pfb = &ctx->batch->framebuffer;
 	struct pipe_scissor_state *scissor = fd_context_get_scissor(ctx);
 	unsigned i, prims, buffers = 0;
 
@@ -102,7 +114,7 @@ fd_draw_vbo(struct pipe_context *pctx, const struct pipe_draw_info *info)
 		return;
 	}
 
-	ctx->needs_flush = true;
+	ctx->batch->needs_flush = true;
 
 	/*
 	 * Figure out the buffers/features we need:
@@ -111,17 +123,17 @@ fd_draw_vbo(struct pipe_context *pctx, const struct pipe_draw_info *info)
 	if (fd_depth_enabled(ctx)) {
 		buffers |= FD_BUFFER_DEPTH;
 		resource_written(ctx, pfb->zsbuf->texture);
-		ctx->gmem_reason |= FD_GMEM_DEPTH_ENABLED;
+		ctx->batch->gmem_reason |= FD_GMEM_DEPTH_ENABLED;
 	}
 
 	if (fd_stencil_enabled(ctx)) {
 		buffers |= FD_BUFFER_STENCIL;
 		resource_written(ctx, pfb->zsbuf->texture);
-		ctx->gmem_reason |= FD_GMEM_STENCIL_ENABLED;
+		ctx->batch->gmem_reason |= FD_GMEM_STENCIL_ENABLED;
 	}
 
 	if (fd_logicop_enabled(ctx))
-		ctx->gmem_reason |= FD_GMEM_LOGICOP_ENABLED;
+		ctx->batch->gmem_reason |= FD_GMEM_LOGICOP_ENABLED;
 
 	for (i = 0; i < pfb->nr_cbufs; i++) {
 		struct pipe_resource *surf;
@@ -135,10 +147,10 @@ fd_draw_vbo(struct pipe_context *pctx, const struct pipe_draw_info *info)
 		buffers |= PIPE_CLEAR_COLOR0 << i;
 
 		if (surf->nr_samples > 1)
-			ctx->gmem_reason |= FD_GMEM_MSAA_ENABLED;
+			ctx->batch->gmem_reason |= FD_GMEM_MSAA_ENABLED;
 
 		if (fd_blend_enabled(ctx, i))
-			ctx->gmem_reason |= FD_GMEM_BLEND_ENABLED;
+			ctx->batch->gmem_reason |= FD_GMEM_BLEND_ENABLED;
 	}
 
 	/* Skip over buffer 0, that is sent along with the command stream */
@@ -169,7 +181,7 @@ fd_draw_vbo(struct pipe_context *pctx, const struct pipe_draw_info *info)
 		if (ctx->streamout.targets[i])
 			resource_written(ctx, ctx->streamout.targets[i]->buffer);
 
-	ctx->num_draws++;
+	ctx->batch->num_draws++;
 
 	prims = u_reduced_prims_for_vertices(info->mode, info->count);
 
@@ -177,15 +189,16 @@ fd_draw_vbo(struct pipe_context *pctx, const struct pipe_draw_info *info)
 	ctx->stats.prims_emitted += prims;
 
 	/* any buffers that haven't been cleared yet, we need to restore: */
-	ctx->restore |= buffers & (FD_BUFFER_ALL & ~ctx->cleared);
+	ctx->batch->restore |= buffers & (FD_BUFFER_ALL & ~ctx->batch->cleared);
 	/* and any buffers used, need to be resolved: */
-	ctx->resolve |= buffers;
+	ctx->batch->resolve |= buffers;
+	mark_written(ctx, buffers);
 
-	DBG("%x num_draws=%u (%s/%s)", buffers, ctx->num_draws,
+	DBG("%x num_draws=%u (%s/%s)", buffers, ctx->batch->num_draws,
 		util_format_short_name(pipe_surface_format(pfb->cbufs[0])),
 		util_format_short_name(pipe_surface_format(pfb->zsbuf)));
 
-	fd_hw_query_set_stage(ctx, ctx->ring, FD_STAGE_DRAW);
+	fd_hw_query_set_stage(ctx, ctx->batch->ring, FD_STAGE_DRAW);
 	ctx->draw_vbo(ctx, info);
 
 	for (i = 0; i < ctx->streamout.num_targets; i++)
@@ -196,16 +209,17 @@ fd_draw_vbo(struct pipe_context *pctx, const struct pipe_draw_info *info)
 
 	/* if an app (or, well, piglit test) does many thousands of draws
 	 * without flush (or anything which implicitly flushes, like
-	 * changing render targets), we can exceed the ringbuffer size.
+	 * reading back the render target), we can exceed the ringbuffer
+	 * size.
 	 * Since we don't currently have a sane way to wrapparound, and
 	 * we use the same buffer for both draw and tiling commands, for
 	 * now we need to do this hack and trigger flush if we are running
 	 * low on remaining space for cmds:
 	 */
-	if (((ctx->ring->cur - ctx->ring->start) >
-				(ctx->ring->size/4 - FD_TILING_COMMANDS_DWORDS)) ||
+	if (((ctx->batch->ring->cur - ctx->batch->ring->start) >
+				(ctx->batch->ring->size/4 - FD_TILING_COMMANDS_DWORDS)) ||
 			(fd_mesa_debug & FD_DBG_FLUSH))
-		fd_context_render(pctx);
+		fd_batch_flush(ctx->batch);
 }
 
 /* TODO figure out how to make better use of existing state mechanism
@@ -219,7 +233,7 @@ fd_clear(struct pipe_context *pctx, unsigned buffers,
 		const union pipe_color_union *color, double depth, unsigned stencil)
 {
 	struct fd_context *ctx = fd_context(pctx);
-	struct pipe_framebuffer_state *pfb = &ctx->framebuffer;
+	struct pipe_framebuffer_state *pfb = &ctx->batch->framebuffer;
 	struct pipe_scissor_state *scissor = fd_context_get_scissor(ctx);
 	unsigned cleared_buffers;
 	int i;
@@ -235,22 +249,26 @@ fd_clear(struct pipe_context *pctx, unsigned buffers,
 	 * something like alpha-test causes side effects from the draw in
 	 * the depth buffer, etc)
 	 */
-	cleared_buffers = buffers & (FD_BUFFER_ALL & ~ctx->restore);
+	cleared_buffers = buffers & (FD_BUFFER_ALL & ~ctx->batch->restore);
 
 	/* do we have full-screen scissor? */
 	if (!memcmp(scissor, &ctx->disabled_scissor, sizeof(*scissor))) {
-		ctx->cleared |= cleared_buffers;
+		ctx->batch->cleared |= cleared_buffers;
 	} else {
-		ctx->partial_cleared |= cleared_buffers;
-		if (cleared_buffers & PIPE_CLEAR_COLOR)
-			ctx->cleared_scissor.color = *scissor;
+		struct pipe_scissor_state rect;
+
+		framebuffer_rect(ctx, &rect);
+		for (i = 0; i < pfb->nr_cbufs; i++)
+			if (cleared_buffers & (PIPE_CLEAR_COLOR0 << i))
+				fd_region_add(&ctx->batch->cleared_region.color[i], &rect, false);
 		if (cleared_buffers & PIPE_CLEAR_DEPTH)
-			ctx->cleared_scissor.depth = *scissor;
+			fd_region_add(&ctx->batch->cleared_region.depth, &rect, false);
 		if (cleared_buffers & PIPE_CLEAR_STENCIL)
-			ctx->cleared_scissor.stencil = *scissor;
+			fd_region_add(&ctx->batch->cleared_region.stencil, &rect, false);
 	}
-	ctx->resolve |= buffers;
-	ctx->needs_flush = true;
+	ctx->batch->resolve |= buffers;
+	mark_written(ctx, buffers);
+	ctx->batch->needs_flush = true;
 
 	if (buffers & PIPE_CLEAR_COLOR)
 		for (i = 0; i < pfb->nr_cbufs; i++)
@@ -259,14 +277,14 @@ fd_clear(struct pipe_context *pctx, unsigned buffers,
 
 	if (buffers & (PIPE_CLEAR_DEPTH | PIPE_CLEAR_STENCIL)) {
 		resource_written(ctx, pfb->zsbuf->texture);
-		ctx->gmem_reason |= FD_GMEM_CLEARS_DEPTH_STENCIL;
+		ctx->batch->gmem_reason |= FD_GMEM_CLEARS_DEPTH_STENCIL;
 	}
 
 	DBG("%x depth=%f, stencil=%u (%s/%s)", buffers, depth, stencil,
 		util_format_short_name(pipe_surface_format(pfb->cbufs[0])),
 		util_format_short_name(pipe_surface_format(pfb->zsbuf)));
 
-	fd_hw_query_set_stage(ctx, ctx->ring, FD_STAGE_CLEAR);
+	fd_hw_query_set_stage(ctx, ctx->batch->ring, FD_STAGE_CLEAR);
 
 	ctx->clear(ctx, buffers, color, depth, stencil);
 
@@ -303,8 +321,6 @@ fd_clear_depth_stencil(struct pipe_context *pctx, struct pipe_surface *ps,
 void
 fd_draw_init(struct pipe_context *pctx)
 {
-	list_inithead(&fd_context(pctx)->used_resources);
-
 	pctx->draw_vbo = fd_draw_vbo;
 	pctx->clear = fd_clear;
 	pctx->clear_render_target = fd_clear_render_target;
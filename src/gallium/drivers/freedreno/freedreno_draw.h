@@ -81,7 +81,7 @@ fd_draw(struct fd_context *ctx, struct fd_ringbuffer *ring,
 		 * we know if we are binning or not
 		 */
 		OUT_RINGP(ring, DRAW(primtype, src_sel, idx_type, 0, instances),
-				&ctx->draw_patches);
+				&ctx->batch->draw_patches);
 	} else {
 		OUT_RING(ring, DRAW(primtype, src_sel, idx_type, vismode, instances));
 	}
@@ -106,8 +106,8 @@ static void
 calculate_tiles(struct fd_context *ctx)
 {
 	struct fd_gmem_stateobj *gmem = &ctx->gmem;
-	struct pipe_scissor_state *scissor = &ctx->max_scissor;
-	struct pipe_framebuffer_state *pfb = &ctx->framebuffer;
+	struct pipe_scissor_state *scissor = &ctx->batch->max_scissor;
+	struct pipe_framebuffer_state *pfb = &ctx->batch->framebuffer;
 	uint32_t gmem_size = ctx->screen->gmemsize_bytes;
 	uint32_t minx, miny, width, height;
 	uint32_t nbins_x = 1, nbins_y = 1;
@@ -116,7 +116,7 @@ calculate_tiles(struct fd_context *ctx)
 	uint8_t cbuf_cpp[MAX_RENDER_TARGETS] = {0}, zsbuf_cpp[2] = {0};
 	uint32_t i, j, t, xoff, yoff;
 	uint32_t tpp_x, tpp_y;
-	bool has_zs = !!(ctx->resolve & (FD_BUFFER_DEPTH | FD_BUFFER_STENCIL));
+	bool has_zs = !!(ctx->batch->resolve & (FD_BUFFER_DEPTH | FD_BUFFER_STENCIL));
 	int tile_n[ARRAY_SIZE(ctx->pipe)];
 
 	if (has_zs) {
@@ -305,13 +305,11 @@ static void
 render_tiles(struct fd_context *ctx)
 {
 	struct fd_gmem_stateobj *gmem = &ctx->gmem;
+	bool restored = false;
 	int i;
 
 	ctx->emit_tile_init(ctx);
 
-	if (ctx->restore)
-		ctx->stats.batch_restore++;
-
 	for (i = 0; i < (gmem->nbins_x * gmem->nbins_y); i++) {
 		struct fd_tile *tile = &ctx->tile[i];
 
@@ -320,25 +318,29 @@ render_tiles(struct fd_context *ctx)
 
 		ctx->emit_tile_prep(ctx, tile);
 
-		if (ctx->restore) {
-			fd_hw_query_set_stage(ctx, ctx->ring, FD_STAGE_MEM2GMEM);
+		if (fd_gmem_needs_restore(ctx, tile, FD_BUFFER_ALL)) {
+			restored = true;
+			fd_hw_query_set_stage(ctx, ctx->batch->ring, FD_STAGE_MEM2GMEM);
 			ctx->emit_tile_mem2gmem(ctx, tile);
-			fd_hw_query_set_stage(ctx, ctx->ring, FD_STAGE_NULL);
+			fd_hw_query_set_stage(ctx, ctx->batch->ring, FD_STAGE_NULL);
 		}
 
 		ctx->emit_tile_renderprep(ctx, tile);
 
-		fd_hw_query_prepare_tile(ctx, i, ctx->ring);
+		fd_hw_query_prepare_tile(ctx, i, ctx->batch->ring);
 
 		/* emit IB to drawcmds: */
-		ctx->emit_ib(ctx->ring, ctx->draw_start, ctx->draw_end);
+		ctx->emit_ib(ctx->batch->ring, ctx->batch->draw_start, ctx->batch->draw_end);
 		fd_reset_wfi(ctx);
 
 		/* emit gmem2mem to transfer tile back to system memory: */
-		fd_hw_query_set_stage(ctx, ctx->ring, FD_STAGE_GMEM2MEM);
+		fd_hw_query_set_stage(ctx, ctx->batch->ring, FD_STAGE_GMEM2MEM);
 		ctx->emit_tile_gmem2mem(ctx, tile);
-		fd_hw_query_set_stage(ctx, ctx->ring, FD_STAGE_NULL);
+		fd_hw_query_set_stage(ctx, ctx->batch->ring, FD_STAGE_NULL);
 	}
+
+	if (restored)
+		ctx->stats.batch_restore++;
 }
 
 static void
@@ -346,23 +348,23 @@ render_sysmem(struct fd_context *ctx)
 {
 	ctx->emit_sysmem_prep(ctx);
 
-	fd_hw_query_prepare_tile(ctx, 0, ctx->ring);
+	fd_hw_query_prepare_tile(ctx, 0, ctx->batch->ring);
 
 	/* emit IB to drawcmds: */
-	ctx->emit_ib(ctx->ring, ctx->draw_start, ctx->draw_end);
+	ctx->emit_ib(ctx->batch->ring, ctx->batch->draw_start, ctx->batch->draw_end);
 	fd_reset_wfi(ctx);
 }
 
 void
 fd_gmem_render_tiles(struct fd_context *ctx)
 {
-	struct pipe_framebuffer_state *pfb = &ctx->framebuffer;
+	struct pipe_framebuffer_state *pfb = &ctx->batch->framebuffer;
 	bool sysmem = false;
 
 	if (ctx->emit_sysmem_prep) {
-		if (ctx->cleared || ctx->gmem_reason || (ctx->num_draws > 5)) {
+		if (ctx->batch->cleared || ctx->batch->gmem_reason || (ctx->batch->num_draws > 5)) {
 			DBG("GMEM: cleared=%x, gmem_reason=%x, num_draws=%u",
-				ctx->cleared, ctx->gmem_reason, ctx->num_draws);
+				ctx->batch->cleared, ctx->batch->gmem_reason, ctx->batch->num_draws);
 		} else if (!(fd_mesa_debug & FD_DBG_NOBYPASS)) {
 			sysmem = true;
 		}
@@ -371,11 +373,11 @@ fd_gmem_render_tiles(struct fd_context *ctx)
 	/* close out the draw cmds by making sure any active queries are
 	 * paused:
 	 */
-	fd_hw_query_set_stage(ctx, ctx->ring, FD_STAGE_NULL);
+	fd_hw_query_set_stage(ctx, ctx->batch->ring, FD_STAGE_NULL);
 
 	/* mark the end of the clear/draw cmds before emitting per-tile cmds: */
-	fd_ringmarker_mark(ctx->draw_end);
-	fd_ringmarker_mark(ctx->binning_end);
+	fd_ringmarker_mark(ctx->batch->draw_end);
+	fd_ringmarker_mark(ctx->batch->binning_end);
 
 	fd_reset_wfi(ctx);
 
@@ -400,62 +402,135 @@ fd_gmem_render_tiles(struct fd_context *ctx)
 	}
 
 	/* GPU executes starting from tile cmds, which IB back to draw cmds: */
-	fd_ringmarker_flush(ctx->draw_end);
+	fd_ringmarker_flush(ctx->batch->draw_end);
 
 	/* mark start for next draw/binning cmds: */
-	fd_ringmarker_mark(ctx->draw_start);
-	fd_ringmarker_mark(ctx->binning_start);
+	fd_ringmarker_mark(ctx->batch->draw_start);
+	fd_ringmarker_mark(ctx->batch->binning_start);
 
 	fd_reset_wfi(ctx);
 
 	/* reset maximal bounds: */
-	ctx->max_scissor.minx = ctx->max_scissor.miny = ~0;
-	ctx->max_scissor.maxx = ctx->max_scissor.maxy = 0;
+	ctx->batch->max_scissor.minx = ctx->batch->max_scissor.miny = ~0;
+	ctx->batch->max_scissor.maxx = ctx->batch->max_scissor.maxy = 0;
 
 	ctx->dirty = ~0;
 }
 
-/* tile needs restore if it isn't completely contained within the
- * cleared scissor:
- */
+/* the part of the tile which is within the framebuffer: */
+static void
+tile_rect(struct fd_context *ctx, struct fd_tile *tile,
+		struct pipe_scissor_state *rect)
+{
+	struct pipe_framebuffer_state *pfb = &ctx->batch->framebuffer;
+
+	rect->minx = tile->xoff;
+	rect->miny = tile->yoff;
+	rect->maxx = MIN2(tile->xoff + tile->bin_w, pfb->width);
+	rect->maxy = MIN2(tile->yoff + tile->bin_h, pfb->height);
+}
+
+/* is the tile completely contained within one of the region's rects: */
 static bool
-skip_restore(struct pipe_scissor_state *scissor, struct fd_tile *tile)
+region_covers(struct fd_region *region, struct pipe_scissor_state *t)
+{
+	unsigned i;
+	for (i = 0; i < region->num_rects; i++) {
+		struct pipe_scissor_state *r = &region->rects[i];
+		if ((t->minx >= r->minx) && (t->maxx <= r->maxx) &&
+				(t->miny >= r->miny) && (t->maxy <= r->maxy))
+			return true;
+	}
+	return false;
+}
+
+/* does the tile overlap any of the region's rects: */
+static bool
+region_overlaps(struct fd_region *region, struct pipe_scissor_state *t)
+{
+	unsigned i;
+	for (i = 0; i < region->num_rects; i++) {
+		struct pipe_scissor_state *r = &region->rects[i];
+		if ((t->minx < r->maxx) && (t->maxx > r->minx) &&
+				(t->miny < r->maxy) && (t->maxy > r->miny))
+			return true;
+	}
+	return false;
+}
+
+static struct fd_region *
+written_region(struct fd_batch *batch, uint32_t buffer)
+{
+	if (buffer & FD_BUFFER_DEPTH)
+		return &batch->written_region.depth;
+	if (buffer & FD_BUFFER_STENCIL)
+		return &batch->written_region.stencil;
+	return &batch->written_region.color;
+}
+
+static struct fd_region *
+cleared_region(struct fd_batch *batch, uint32_t buffer)
 {
-	unsigned minx = tile->xoff;
-	unsigned maxx = tile->xoff + tile->bin_w;
-	unsigned miny = tile->yoff;
-	unsigned maxy = tile->yoff + tile->bin_h;
-	return (minx >= scissor->minx) && (maxx <= scissor->maxx) &&
-			(miny >= scissor->miny) && (maxy <= scissor->maxy);
+	if (buffer & FD_BUFFER_DEPTH)
+		return &batch->cleared_region.depth;
+	if (buffer & FD_BUFFER_STENCIL)
+		return &batch->cleared_region.stencil;
+	return &batch->cleared_region.color[ffs(buffer) - ffs(PIPE_CLEAR_COLOR0)];
 }
 
-/* When deciding whether a tile needs mem2gmem, we need to take into
- * account the scissor rect(s) that were cleared.  To simplify we only
- * consider the last scissor rect for each buffer, since the common
- * case would be a single clear.
+/* A tile needs mem2gmem for a buffer if some clear or draw writes the
+ * tile (otherwise it is not resolved either, so the previous contents
+ * stay untouched in memory) and it isn't completely covered by a clear
+ * which happened before any draw to the buffer.
  */
 bool
 fd_gmem_needs_restore(struct fd_context *ctx, struct fd_tile *tile,
 		uint32_t buffers)
 {
-	if (!(ctx->restore & buffers))
+	struct fd_batch *batch = ctx->batch;
+	struct pipe_scissor_state t;
+
+	buffers &= batch->resolve & ~batch->cleared;
+	if (!buffers)
 		return false;
 
-	/* if buffers partially cleared, then slow-path to figure out
-	 * if this particular tile needs restoring:
-	 */
-	if ((buffers & FD_BUFFER_COLOR) &&
-			(ctx->partial_cleared & FD_BUFFER_COLOR) &&
-			skip_restore(&ctx->cleared_scissor.color, tile))
+	tile_rect(ctx, tile, &t);
+
+	while (buffers) {
+		uint32_t b = 1 << u_bit_scan(&buffers);
+		if (region_overlaps(written_region(batch, b), &t) &&
+				!region_covers(cleared_region(batch, b), &t))
+			return true;
+	}
+
+	return false;
+}
+
+/* A tile only needs gmem2mem for buffers that some clear or draw in the
+ * batch may have written within the tile.
+ */
+bool
+fd_gmem_needs_resolve(struct fd_context *ctx, struct fd_tile *tile,
+		uint32_t buffers)
+{
+	struct fd_batch *batch = ctx->batch;
+	struct pipe_scissor_state t;
+
+	buffers &= batch->resolve;
+	if (!buffers)
 		return false;
+
+	tile_rect(ctx, tile, &t);
+
+	if ((buffers & FD_BUFFER_COLOR) &&
+			region_overlaps(&batch->written_region.color, &t))
+		return true;
 	if ((buffers & FD_BUFFER_DEPTH) &&
-			(ctx->partial_cleared & FD_BUFFER_DEPTH) &&
-			skip_restore(&ctx->cleared_scissor.depth, tile))
-		return false;
+			region_overlaps(&batch->written_region.depth, &t))
+		return true;
 	if ((buffers & FD_BUFFER_STENCIL) &&
-			(ctx->partial_cleared & FD_BUFFER_STENCIL) &&
-			skip_restore(&ctx->cleared_scissor.stencil, tile))
-		return false;
+			region_overlaps(&batch->written_region.stencil, &t))
+		return true;
 
-	return true;
+	return false;
 }
@@ -65,5 +65,7 @@ void fd_gmem_render_tiles(struct fd_context *ctx);
 
 bool fd_gmem_needs_restore(struct fd_context *ctx, struct fd_tile *tile,
 		uint32_t buffers);
+bool fd_gmem_needs_resolve(struct fd_context *ctx, struct fd_tile *tile,
+		uint32_t buffers);
 
 #endif /* FREEDRENO_GMEM_H_ */
@@ -147,8 +147,19 @@ fd_hw_begin_query(struct fd_context *ctx, struct fd_query *q)
 	/* begin_query() should clear previous results: */
 	destroy_periods(ctx, &hq->periods);
 
+	/* samples are only tracked for the bound batch, so make sure no
+	 * other batch has rendering queued up once queries are in use (see
+	 * fd_set_framebuffer_state()):
+	 */
+	if (!fd_hw_query_in_use(ctx)) {
+		unsigned i;
+		for (i = 0; i < ARRAY_SIZE(ctx->batches); i++)
+			if (ctx->batches[i] && (ctx->batches[i] != ctx->batch))
+				fd_batch_flush(ctx->batches[i]);
+	}
+
 	if (is_active(hq, ctx->stage))
-		resume_query(ctx, hq, ctx->ring);
+		resume_query(ctx, hq, ctx->batch->ring);
 
 	q->active = true;
 
@@ -171,7 +182,7 @@ fd_hw_end_query(struct fd_context *ctx, struct fd_query *q)
 	if (!q->active)
 		return;
 	if (is_active(hq, ctx->stage))
-		pause_query(ctx, hq, ctx->ring);
+		pause_query(ctx, hq, ctx->batch->ring);
 	q->active = false;
 	/* move to current list: */
 	list_del(&hq->list);
@@ -203,10 +214,10 @@ fd_hw_get_query_result(struct fd_context *ctx, struct fd_query *q,
 		/* if app didn't actually trigger any cmdstream, then
 		 * we have nothing to do:
 		 */
-		if (!ctx->needs_flush)
+		if (!ctx->batch->needs_flush)
 			return true;
 		DBG("reading query result forces flush!");
-		fd_context_render(&ctx->base);
+		fd_batch_flush(ctx->batch);
 	}
 
 	util_query_clear_result(result, q->type);
@@ -155,6 +155,16 @@ void fd_hw_query_register_provider(struct pipe_context *pctx,
 void fd_hw_query_init(struct pipe_context *pctx);
 void fd_hw_query_fini(struct pipe_context *pctx);
 
+/* are there hw queries with samples in the bound batch (or which will
+ * have once the next draw resumes them)?
+ */
+static inline bool
+fd_hw_query_in_use(struct fd_context *ctx)
+{
+	return !LIST_IS_EMPTY(&ctx->active_queries) ||
+			!LIST_IS_EMPTY(&ctx->current_queries);
+}
+
 static inline void
 fd_hw_sample_reference(struct fd_context *ctx,
 		struct fd_hw_sample **ptr, struct fd_hw_sample *samp)
@@ -44,13 +44,6 @@
 #include <errno.h>
 
 
-static bool
-pending(struct fd_resource *rsc, enum fd_resource_status status)
-{
-	return (rsc->status & status) ||
-		(rsc->stencil && (rsc->stencil->status & status));
-}
-
 static void
 fd_invalidate_resource(struct fd_context *ctx, struct pipe_resource *prsc)
 {
@@ -106,9 +99,7 @@ realloc_bo(struct fd_resource *rsc, uint32_t size)
 
 	rsc->bo = fd_bo_new(screen->dev, size, flags);
 	rsc->timestamp = 0;
-	rsc->status = 0;
-	rsc->pending_ctx = NULL;
-	list_delinit(&rsc->list);
+	fd_batch_resource_remove(rsc);
 	util_range_set_empty(&rsc->valid_buffer_range);
 }
 
@@ -322,10 +313,8 @@ fd_resource_transfer_map(struct pipe_context *pctx,
 		/* If the GPU is writing to the resource, or if it is reading from the
 		 * resource and we're trying to write to it, flush the renders.
 		 */
-		if (((ptrans->usage & PIPE_TRANSFER_WRITE) &&
-					pending(rsc, FD_PENDING_READ | FD_PENDING_WRITE)) ||
-				pending(rsc, FD_PENDING_WRITE))
-			fd_context_render(pctx);
+		fd_batch_flush_resource(ctx, rsc,
+				!!(ptrans->usage & PIPE_TRANSFER_WRITE));
 
 		/* The GPU keeps track of how the various bo's are being used, and
 		 * will wait if necessary for the proper operation to have
@@ -452,7 +441,7 @@ fd_resource_destroy(struct pipe_screen *pscreen,
 	struct fd_resource *rsc = fd_resource(prsc);
 	if (rsc->bo)
 		fd_bo_del(rsc->bo);
-	list_delinit(&rsc->list);
+	fd_batch_resource_remove(rsc);
 	util_range_destroy(&rsc->valid_buffer_range);
 	FREE(rsc);
 }
@@ -569,7 +558,6 @@ fd_resource_create(struct pipe_screen *pscreen,
 	*prsc = *tmpl;
 
 	pipe_reference_init(&prsc->reference, 1);
-	list_inithead(&rsc->list);
 	prsc->screen = pscreen;
 
 	util_range_init(&rsc->valid_buffer_range);
@@ -657,7 +645,6 @@ fd_resource_from_handle(struct pipe_screen *pscreen,
 	*prsc = *tmpl;
 
 	pipe_reference_init(&prsc->reference, 1);
-	list_inithead(&rsc->list);
 	prsc->screen = pscreen;
 
 	util_range_init(&rsc->valid_buffer_range);
@@ -820,7 +807,7 @@ fd_blitter_pipe_begin(struct fd_context *ctx, bool render_cond)
 	util_blitter_save_depth_stencil_alpha(ctx->blitter, ctx->zsa);
 	util_blitter_save_stencil_ref(ctx->blitter, &ctx->stencil_ref);
 	util_blitter_save_sample_mask(ctx->blitter, ctx->sample_mask);
-	util_blitter_save_framebuffer(ctx->blitter, &ctx->framebuffer);
+	util_blitter_save_framebuffer(ctx->blitter, &ctx->batch->framebuffer);
 	util_blitter_save_fragment_sampler_states(ctx->blitter,
 			ctx->fragtex.num_samplers,
 			(void **)ctx->fragtex.samplers);
@@ -830,13 +817,13 @@ fd_blitter_pipe_begin(struct fd_context *ctx, bool render_cond)
 		util_blitter_save_render_condition(ctx->blitter,
 			ctx->cond_query, ctx->cond_cond, ctx->cond_mode);
 
-	fd_hw_query_set_stage(ctx, ctx->ring, FD_STAGE_BLIT);
+	fd_hw_query_set_stage(ctx, ctx->batch->ring, FD_STAGE_BLIT);
 }
 
 static void
 fd_blitter_pipe_end(struct fd_context *ctx)
 {
-	fd_hw_query_set_stage(ctx, ctx->ring, FD_STAGE_NULL);
+	fd_hw_query_set_stage(ctx, ctx->batch->ring, FD_STAGE_NULL);
 }
 
 static void
@@ -844,8 +831,7 @@ fd_flush_resource(struct pipe_context *pctx, struct pipe_resource *prsc)
 {
 	struct fd_resource *rsc = fd_resource(prsc);
 
-	if (pending(rsc, FD_PENDING_WRITE | FD_PENDING_READ))
-		fd_context_render(pctx);
+	fd_batch_flush_resource(fd_context(pctx), rsc, true);
 }
 
 void
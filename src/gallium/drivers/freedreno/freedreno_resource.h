@@ -29,7 +29,6 @@
 #ifndef FREEDRENO_RESOURCE_H_
 #define FREEDRENO_RESOURCE_H_
 
-#include "util/list.h"
 #include "util/u_range.h"
 #include "util/u_transfer.h"
 
@@ -60,15 +59,6 @@ struct fd_resource_slice {
 	uint32_t size0;          /* size of first layer in slice */
 };
 
-/* status of queued up but not flushed reads and write operations.
- * In _transfer_map() we need to know if queued up rendering needs
- * to be flushed to preserve the order of cpu and gpu access.
- */
-enum fd_resource_status {
-	FD_PENDING_WRITE = 0x01,
-	FD_PENDING_READ  = 0x02,
-};
-
 struct fd_resource {
 	struct u_resource base;
 	struct fd_bo *bo;
@@ -85,12 +75,14 @@ struct fd_resource {
 	/* TODO rename to secondary or auxiliary? */
 	struct fd_resource *stencil;
 
-	/* pending read/write state: */
-	enum fd_resource_status status;
-	/* resources accessed by queued but not flushed draws are tracked
-	 * in the used_resources list.
+	/* pending read/write state, for batches which are queued up but
+	 * not flushed.  In _transfer_map() we need to know if queued up
+	 * rendering needs to be flushed to preserve the order of cpu and
+	 * gpu access, and batches need to know which other batches they
+	 * depend on:
 	 */
-	struct list_head list;
+	uint32_t batch_mask;              /* bitmask of fd_batch::idx */
+	struct fd_batch *write_batch;     /* batch with a queued up write */
 	struct fd_context *pending_ctx;
 };
 
@@ -54,6 +54,8 @@
 #include "a3xx/fd3_screen.h"
 #include "a4xx/fd4_screen.h"
 
+#include "ir3_compiler.h"
+
 /* XXX this should go away */
 #include "state_tracker/drm_driver.h"
 
@@ -114,6 +116,9 @@ fd_screen_destroy(struct pipe_screen *pscreen)
 {
 	struct fd_screen *screen = fd_screen(pscreen);
 
+	if (screen->compiler && is_ir3(screen))
+		ir3_compiler_destroy(screen->compiler);
+
 	if (screen->pipe)
 		fd_pipe_del(screen->pipe);
 
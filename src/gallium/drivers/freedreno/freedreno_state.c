@@ -31,12 +31,14 @@
 #include "util/u_string.h"
 #include "util/u_memory.h"
 #include "util/u_helpers.h"
+#include "util/u_framebuffer.h"
 
 #include "freedreno_state.h"
 #include "freedreno_context.h"
 #include "freedreno_resource.h"
 #include "freedreno_texture.h"
 #include "freedreno_gmem.h"
+#include "freedreno_query_hw.h"
 #include "freedreno_util.h"
 
 /* All the generic state handling.. In case of CSO's that are specific
@@ -119,18 +121,37 @@ fd_set_framebuffer_state(struct pipe_context *pctx,
 		const struct pipe_framebuffer_state *framebuffer)
 {
 	struct fd_context *ctx = fd_context(pctx);
-	struct pipe_framebuffer_state *cso = &ctx->framebuffer;
+	struct pipe_framebuffer_state *cso;
+	struct fd_batch *batch;
+	bool resized;
 
-	DBG("%d: cbufs[0]=%p, zsbuf=%p", ctx->needs_flush,
+	DBG("%d: cbufs[0]=%p, zsbuf=%p", ctx->batch->needs_flush,
 			framebuffer->cbufs[0], framebuffer->zsbuf);
 
-	fd_context_render(pctx);
+	resized = (ctx->batch->framebuffer.width != framebuffer->width) ||
+			(ctx->batch->framebuffer.height != framebuffer->height);
 
-	if ((cso->width != framebuffer->width) ||
-			(cso->height != framebuffer->height))
+	/* hw query samples are only tracked for the bound batch, so while
+	 * queries are in use fall back to flushing on every switch:
+	 */
+	if (fd_hw_query_in_use(ctx) &&
+			!util_framebuffer_state_equal(&ctx->batch->framebuffer, framebuffer))
+		fd_batch_flush(ctx->batch);
+
+	batch = fd_batch_for_framebuffer(ctx, framebuffer);
+	cso = &batch->framebuffer;
+
+	if (resized)
 		ctx->needs_rb_fbd = true;
 
-	util_copy_framebuffer_state(cso, framebuffer);
+	if (batch != ctx->batch) {
+		/* the state last emitted in the new batch's cmds is whatever
+		 * was current when it was last bound, so re-emit everything:
+		 */
+		ctx->batch = batch;
+		ctx->dirty = ~0;
+		fd_reset_wfi(ctx);
+	}
 
 	ctx->dirty |= FD_DIRTY_FRAMEBUFFER;
 
@@ -27,6 +27,11 @@
  */
 
 #include "util/ralloc.h"
+#include "util/u_debug.h"
+#include "util/u_string.h"
+#include "util/disk_cache.h"
+
+#include "freedreno_util.h"
 
 #include "ir3_compiler.h"
 
@@ -36,10 +41,28 @@ struct ir3_compiler * ir3_compiler_create(struct fd_device *dev, uint32_t gpu_id
 	compiler->dev = dev;
 	compiler->gpu_id = gpu_id;
 	compiler->set = ir3_ra_alloc_reg_set(compiler);
+
+	/* ir3_cmdline has no device to upload cached variants to, and the
+	 * disasm and shader-db output come from the compiler, so skip the
+	 * cache in those cases:
+	 */
+	if (dev && debug_get_bool_option("FD_DISK_CACHE", FALSE) &&
+			!(fd_mesa_debug & (FD_DBG_DISASM | FD_DBG_SHADERDB))) {
+		char gpu_name[16], driver_id[128];
+
+		util_snprintf(gpu_name, sizeof(gpu_name), "ir3 a%u", gpu_id);
+		/* debug flags like fraghalf change the generated code: */
+		util_snprintf(driver_id, sizeof(driver_id),
+				"ir3 " PACKAGE_VERSION " " __DATE__ " " __TIME__ " %x",
+				fd_mesa_debug);
+		compiler->disk_cache = disk_cache_create(gpu_name, driver_id);
+	}
+
 	return compiler;
 }
 
 void ir3_compiler_destroy(struct ir3_compiler *compiler)
 {
+	disk_cache_destroy(compiler->disk_cache);
 	ralloc_free(compiler);
 }
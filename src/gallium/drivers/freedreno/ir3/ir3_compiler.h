@@ -32,12 +32,15 @@
 #include "ir3_shader.h"
 
 struct ir3_ra_reg_set;
+struct disk_cache;
 
 struct ir3_compiler {
 	struct fd_device *dev;
 	uint32_t gpu_id;
 	struct ir3_ra_reg_set *set;
 	uint32_t shader_count;
+	/* on-disk cache of assembled variants, if enabled (FD_DISK_CACHE): */
+	struct disk_cache *disk_cache;
 };
 
 struct ir3_compiler * ir3_compiler_create(struct fd_device *dev, uint32_t gpu_id);
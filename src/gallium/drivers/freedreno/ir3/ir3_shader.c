@@ -31,6 +31,8 @@
 #include "util/u_memory.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
 #include "tgsi/tgsi_dump.h"
 #include "tgsi/tgsi_parse.h"
 
@@ -124,6 +126,108 @@ void * ir3_shader_assemble(struct ir3_shader_variant *v, uint32_t gpu_id)
 	return bin;
 }
 
+/* The disk cache key is the shader's sha1, the stage and the variant key.
+ * The state-specific key fields are only compared when has_per_samp is
+ * set (see ir3_shader_key_equal()), so leave them out otherwise.
+ */
+static void
+variant_cache_key(struct ir3_shader_variant *v, cache_key hash)
+{
+	struct ir3_shader *shader = v->shader;
+	struct {
+		unsigned char sha1[20];
+		uint32_t type;
+		struct ir3_shader_key key;
+	} data;
+
+	memset(&data, 0, sizeof(data));
+	memcpy(data.sha1, shader->sha1, sizeof(data.sha1));
+	data.type = v->type;
+	data.key.ucp_enables = v->key.ucp_enables;
+	data.key.has_per_samp = v->key.has_per_samp;
+	data.key.binning_pass = v->key.binning_pass;
+	data.key.color_two_side = v->key.color_two_side;
+	data.key.half_precision = v->key.half_precision;
+	data.key.rasterflat = v->key.rasterflat;
+	if (v->key.has_per_samp) {
+		data.key.vsaturate_s = v->key.vsaturate_s;
+		data.key.vsaturate_t = v->key.vsaturate_t;
+		data.key.vsaturate_r = v->key.vsaturate_r;
+		data.key.fsaturate_s = v->key.fsaturate_s;
+		data.key.fsaturate_t = v->key.fsaturate_t;
+		data.key.fsaturate_r = v->key.fsaturate_r;
+	}
+
+	disk_cache_compute_key(shader->compiler->disk_cache,
+			&data, sizeof(data), hash);
+}
+
+/* A cache entry is a copy of the assembled variant followed by its
+ * binary.  Only the pointers and the debug id need fixing up on load.
+ */
+static void
+store_variant(struct ir3_shader_variant *v, const uint32_t *bin)
+{
+	struct ir3_compiler *compiler = v->shader->compiler;
+	uint32_t sz = v->info.sizedwords * 4;
+	cache_key hash;
+	uint8_t *data;
+
+	data = malloc(sizeof(*v) + sz);
+	if (!data)
+		return;
+
+	memcpy(data, v, sizeof(*v));
+	memcpy(data + sizeof(*v), bin, sz);
+
+	variant_cache_key(v, hash);
+	disk_cache_put(compiler->disk_cache, hash, data, sizeof(*v) + sz);
+	free(data);
+}
+
+static bool
+load_variant(struct ir3_shader_variant *v)
+{
+	struct ir3_compiler *compiler = v->shader->compiler;
+	struct ir3_shader_variant cached;
+	cache_key hash;
+	uint8_t *data;
+	size_t size;
+	uint32_t sz;
+
+	variant_cache_key(v, hash);
+	data = disk_cache_get(compiler->disk_cache, hash, &size);
+	if (!data)
+		return false;
+
+	if (size < sizeof(cached))
+		goto invalid;
+	memcpy(&cached, data, sizeof(cached));
+	sz = cached.info.sizedwords * 4;
+	if (size != sizeof(cached) + sz || !sz ||
+			cached.type != v->type || cached.info.gpu_id != compiler->gpu_id)
+		goto invalid;
+
+	cached.id = v->id;
+	cached.key = v->key;
+	cached.ir = NULL;
+	cached.next = NULL;
+	cached.shader = v->shader;
+	cached.bo = fd_bo_new(compiler->dev, sz,
+			DRM_FREEDRENO_GEM_CACHE_WCOMBINE |
+			DRM_FREEDRENO_GEM_TYPE_KMEM);
+	memcpy(fd_bo_map(cached.bo), data + sizeof(cached), sz);
+
+	*v = cached;
+	free(data);
+	return true;
+
+invalid:
+	disk_cache_remove(compiler->disk_cache, hash);
+	free(data);
+	return false;
+}
+
 static void
 assemble_variant(struct ir3_shader_variant *v)
 {
@@ -166,6 +270,9 @@ assemble_variant(struct ir3_shader_variant *v)
 				v->constlen);
 	}
 
+	if (compiler->disk_cache)
+		store_variant(v, bin);
+
 	free(bin);
 
 	/* no need to keep the ir around beyond this point: */
@@ -187,6 +294,9 @@ create_variant(struct ir3_shader *shader, struct ir3_shader_key key)
 	v->key = key;
 	v->type = shader->type;
 
+	if (shader->compiler->disk_cache && load_variant(v))
+		return v;
+
 	ret = ir3_compile_shader_nir(shader->compiler, v);
 	if (ret) {
 		debug_error("compile failed!");
@@ -286,6 +396,14 @@ ir3_shader_create(struct ir3_compiler *compiler,
 		nir_print_shader(shader->nir, stdout);
 	}
 	shader->stream_output = cso->stream_output;
+	if (compiler->disk_cache) {
+		struct mesa_sha1 *ctx = _mesa_sha1_init();
+		_mesa_sha1_update(ctx, cso->tokens,
+				tgsi_num_tokens(cso->tokens) * sizeof(struct tgsi_token));
+		_mesa_sha1_update(ctx, &cso->stream_output,
+				sizeof(cso->stream_output));
+		_mesa_sha1_final(ctx, shader->sha1);
+	}
 	if (fd_mesa_debug & FD_DBG_SHADERDB) {
 		/* if shader-db run, create a standard variant immediately
 		 * (as otherwise nothing will trigger the shader to be
@@ -244,6 +244,9 @@ struct ir3_shader {
 	nir_shader *nir;
 	struct pipe_stream_output_info stream_output;
 
+	/* sha1 of the tgsi tokens and stream output, for the disk cache: */
+	unsigned char sha1[20];
+
 	struct ir3_shader_variant *variants;
 };
 
@@ -44,6 +44,7 @@
 #include "lp_state.h"
 #include "lp_surface.h"
 #include "lp_query.h"
+#include "lp_screen.h"
 #include "lp_setup.h"
 
 /* This is only safe if there's just one concurrent context */
@@ -95,8 +96,12 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
       pipe_resource_reference(&llvmpipe->vertex_buffer[i].buffer, NULL);
    }
 
+   llvmpipe_cleanup_compute(llvmpipe);
+
    lp_delete_setup_variants(llvmpipe);
 
+   util_slab_destroy_child(&llvmpipe->transfer_pool);
+
 #ifndef USE_GLOBAL_LLVM_CONTEXT
    LLVMContextDispose(llvmpipe->context);
 #endif
@@ -149,6 +154,9 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
    llvmpipe->pipe.screen = screen;
    llvmpipe->pipe.priv = priv;
 
+   util_slab_create_child(&llvmpipe->transfer_pool,
+                          &llvmpipe_screen(screen)->transfer_pool);
+
    /* Init the pipe context methods */
    llvmpipe->pipe.destroy = llvmpipe_destroy;
    llvmpipe->pipe.set_framebuffer_state = llvmpipe_set_framebuffer_state;
@@ -167,6 +175,7 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
    llvmpipe_init_fs_funcs(llvmpipe);
    llvmpipe_init_vs_funcs(llvmpipe);
    llvmpipe_init_gs_funcs(llvmpipe);
+   llvmpipe_init_compute_funcs(llvmpipe);
    llvmpipe_init_rasterizer_funcs(llvmpipe);
    llvmpipe_init_context_resource_funcs( &llvmpipe->pipe );
    llvmpipe_init_surface_functions(llvmpipe);
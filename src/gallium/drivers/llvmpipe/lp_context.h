@@ -35,15 +35,18 @@
 
 #include "draw/draw_vertex.h"
 #include "util/u_blitter.h"
+#include "util/u_slab.h"
 
 #include "lp_tex_sample.h"
 #include "lp_jit.h"
 #include "lp_setup.h"
 #include "lp_state_fs.h"
 #include "lp_state_setup.h"
+#include "lp_state_cs.h"
 
 
 struct llvmpipe_vbuf_render;
+struct lp_cs_tpool;
 struct draw_context;
 struct draw_stage;
 struct draw_vertex_shader;
@@ -67,6 +70,7 @@ struct llvmpipe_context {
    const struct lp_geometry_shader *gs;
    const struct lp_velems_state *velems;
    const struct lp_so_state *so;
+   struct lp_compute_shader *cs;
 
    /** Other rendering state */
    unsigned sample_mask;
@@ -78,6 +82,7 @@ struct llvmpipe_context {
    struct pipe_poly_stipple poly_stipple;
    struct pipe_scissor_state scissors[PIPE_MAX_VIEWPORTS];
    struct pipe_sampler_view *sampler_views[PIPE_SHADER_TYPES][PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   struct pipe_shader_buffer ssbos[PIPE_MAX_SHADER_BUFFERS]; /**< compute only */
 
    struct pipe_viewport_state viewports[PIPE_MAX_VIEWPORTS];
    struct pipe_vertex_buffer vertex_buffer[PIPE_MAX_ATTRIBS];
@@ -134,6 +139,9 @@ struct llvmpipe_context {
    /** The primitive drawing context */
    struct draw_context *draw;
 
+   /** Threads running compute workgroups, created on first use */
+   struct lp_cs_tpool *cs_tpool;
+
    struct blitter_context *blitter;
 
    unsigned tex_timestamp;
@@ -154,6 +162,9 @@ struct llvmpipe_context {
 
    /** The LLVMContext to use for LLVM related work */
    LLVMContextRef context;
+
+   /** This context's cache of the screen's transfer_pool */
+   struct util_slab_child_pool transfer_pool;
 };
 
 
@@ -0,0 +1,190 @@
+/**************************************************************************
+ * 
+ * Copyright 2016 VMware, Inc.
+ * All Rights Reserved.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Compute shader thread pool.
+ */
+
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "util/u_math.h"
+
+#include "lp_cs_tpool.h"
+
+
+struct lp_cs_tpool_thread_data {
+   struct lp_cs_tpool *pool;
+   unsigned thread_idx;
+};
+
+
+static PIPE_THREAD_ROUTINE( lp_cs_tpool_worker, init_data )
+{
+   struct lp_cs_tpool_thread_data *thread_data =
+      (struct lp_cs_tpool_thread_data *) init_data;
+   struct lp_cs_tpool *pool = thread_data->pool;
+   unsigned thread_idx = thread_data->thread_idx;
+   char thread_name[16];
+   unsigned fpstate;
+
+   FREE(thread_data);
+
+   util_snprintf(thread_name, sizeof thread_name, "llvmpipe-cs-%u", thread_idx);
+   pipe_thread_setname(thread_name);
+
+   /* Same denorm handling as the rasterizer threads. */
+   fpstate = util_fpstate_get();
+   util_fpstate_set_denorms_to_zero(fpstate);
+
+   pipe_mutex_lock(pool->m);
+   while (1) {
+      struct lp_cs_tpool_task *task;
+      unsigned iter;
+
+      while (!pool->shutdown &&
+             (!pool->task || pool->task->next_iter == pool->task->num_iters))
+         pipe_condvar_wait(pool->new_work, pool->m);
+
+      if (pool->shutdown)
+         break;
+
+      task = pool->task;
+      iter = task->next_iter++;
+      pipe_mutex_unlock(pool->m);
+
+      task->func(task->data, iter, thread_idx);
+
+      pipe_mutex_lock(pool->m);
+      if (++task->iters_done == task->num_iters)
+         pipe_condvar_signal(pool->work_done);
+   }
+   pipe_mutex_unlock(pool->m);
+
+   return 0;
+}
+
+
+/**
+ * Create a pool of num_threads threads.  Returns NULL when num_threads is
+ * zero, in which case lp_cs_tpool_run() runs everything on the calling
+ * thread.
+ */
+struct lp_cs_tpool *
+lp_cs_tpool_create(unsigned num_threads)
+{
+   struct lp_cs_tpool *pool;
+   unsigned i;
+
+   if (!num_threads)
+      return NULL;
+
+   pool = CALLOC_STRUCT(lp_cs_tpool);
+   if (!pool)
+      return NULL;
+
+   pipe_mutex_init(pool->m);
+   pipe_condvar_init(pool->new_work);
+   pipe_condvar_init(pool->work_done);
+
+   for (i = 0; i < MIN2(num_threads, LP_MAX_THREADS); i++) {
+      struct lp_cs_tpool_thread_data *thread_data =
+         CALLOC_STRUCT(lp_cs_tpool_thread_data);
+      if (!thread_data)
+         break;
+      thread_data->pool = pool;
+      thread_data->thread_idx = i;
+      pool->threads[i] = pipe_thread_create(lp_cs_tpool_worker, thread_data);
+   }
+   pool->num_threads = i;
+
+   if (!pool->num_threads) {
+      lp_cs_tpool_destroy(pool);
+      return NULL;
+   }
+
+   return pool;
+}
+
+
+void
+lp_cs_tpool_destroy(struct lp_cs_tpool *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   pipe_mutex_lock(pool->m);
+   pool->shutdown = TRUE;
+   pipe_condvar_broadcast(pool->new_work);
+   pipe_mutex_unlock(pool->m);
+
+   for (i = 0; i < pool->num_threads; i++)
+      pipe_thread_wait(pool->threads[i]);
+
+   pipe_condvar_destroy(pool->new_work);
+   pipe_condvar_destroy(pool->work_done);
+   pipe_mutex_destroy(pool->m);
+   FREE(pool);
+}
+
+
+/**
+ * Run func for every iteration in [0, num_iters) and wait for all of them
+ * to complete.  Iterations may run in any order and concurrently.
+ */
+void
+lp_cs_tpool_run(struct lp_cs_tpool *pool,
+                lp_cs_tpool_task_func func, void *data,
+                unsigned num_iters)
+{
+   struct lp_cs_tpool_task task;
+   unsigned i;
+
+   if (!pool || num_iters == 1) {
+      for (i = 0; i < num_iters; i++)
+         func(data, i, 0);
+      return;
+   }
+
+   task.func = func;
+   task.data = data;
+   task.num_iters = num_iters;
+   task.next_iter = 0;
+   task.iters_done = 0;
+
+   pipe_mutex_lock(pool->m);
+   assert(!pool->task);
+   pool->task = &task;
+   pipe_condvar_broadcast(pool->new_work);
+   while (task.iters_done != num_iters)
+      pipe_condvar_wait(pool->work_done, pool->m);
+   pool->task = NULL;
+   pipe_mutex_unlock(pool->m);
+}
@@ -0,0 +1,90 @@
+/**************************************************************************
+ * 
+ * Copyright 2016 VMware, Inc.
+ * All Rights Reserved.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ **************************************************************************/
+
+
+/**
+ * @file
+ * A small thread pool used to run compute shader workgroups.
+ *
+ * This is kept apart from the rasterizer threads, which process whole
+ * scenes from the scene queue and can't be handed arbitrary work.  Each
+ * task is split into a number of iterations, which are handed out to the
+ * worker threads in order until none are left; lp_cs_tpool_run() returns
+ * once all of them have finished.
+ */
+
+#ifndef LP_CS_TPOOL_H
+#define LP_CS_TPOOL_H
+
+#include "os/os_thread.h"
+#include "lp_limits.h"
+
+
+/**
+ * @param data        task data passed to lp_cs_tpool_run()
+ * @param iter        iteration to run, in [0, num_iters)
+ * @param thread_idx  index of the thread running it, in [0, num_threads)
+ */
+typedef void
+(*lp_cs_tpool_task_func)(void *data, unsigned iter, unsigned thread_idx);
+
+
+struct lp_cs_tpool_task {
+   lp_cs_tpool_task_func func;
+   void *data;
+   unsigned num_iters;
+   unsigned next_iter;
+   unsigned iters_done;
+};
+
+
+struct lp_cs_tpool {
+   pipe_mutex m;
+   pipe_condvar new_work;
+   pipe_condvar work_done;
+
+   pipe_thread threads[LP_MAX_THREADS];
+   unsigned num_threads;
+   boolean shutdown;
+
+   /** The task being run, or NULL */
+   struct lp_cs_tpool_task *task;
+};
+
+
+struct lp_cs_tpool *
+lp_cs_tpool_create(unsigned num_threads);
+
+void
+lp_cs_tpool_destroy(struct lp_cs_tpool *pool);
+
+void
+lp_cs_tpool_run(struct lp_cs_tpool *pool,
+                lp_cs_tpool_task_func func, void *data,
+                unsigned num_iters);
+
+#endif /* LP_CS_TPOOL_H */
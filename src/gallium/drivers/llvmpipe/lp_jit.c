@@ -39,6 +39,7 @@
 #include "gallivm/lp_bld_format.h"
 #include "lp_context.h"
 #include "lp_jit.h"
+#include "lp_state_cs.h"
 
 
 static void
@@ -247,3 +248,58 @@ lp_jit_init_types(struct lp_fragment_shader_variant *lp)
    if (!lp->jit_context_ptr_type)
       lp_jit_create_types(lp);
 }
+
+
+static void
+lp_jit_create_cs_types(struct lp_compute_shader *cs)
+{
+   struct gallivm_state *gallivm = cs->gallivm;
+   LLVMContextRef lc = gallivm->context;
+
+   /* struct lp_jit_cs_context */
+   {
+      LLVMTypeRef elem_types[LP_JIT_CS_CTX_COUNT];
+      LLVMTypeRef context_type;
+
+      elem_types[LP_JIT_CS_CTX_CONSTANTS] =
+         LLVMArrayType(LLVMPointerType(LLVMFloatTypeInContext(lc), 0), LP_MAX_TGSI_CONST_BUFFERS);
+      elem_types[LP_JIT_CS_CTX_NUM_CONSTANTS] =
+         LLVMArrayType(LLVMInt32TypeInContext(lc), LP_MAX_TGSI_CONST_BUFFERS);
+      elem_types[LP_JIT_CS_CTX_SSBOS] =
+         LLVMArrayType(LLVMPointerType(LLVMInt32TypeInContext(lc), 0), PIPE_MAX_SHADER_BUFFERS);
+      elem_types[LP_JIT_CS_CTX_SSBO_SIZES] =
+         LLVMArrayType(LLVMInt32TypeInContext(lc), PIPE_MAX_SHADER_BUFFERS);
+
+      context_type = LLVMStructTypeInContext(lc, elem_types,
+                                             Elements(elem_types), 0);
+
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, constants,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_CONSTANTS);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, num_constants,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_NUM_CONSTANTS);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, ssbos,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_SSBOS);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, ssbo_sizes,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_SSBO_SIZES);
+      LP_CHECK_STRUCT_SIZE(struct lp_jit_cs_context,
+                           gallivm->target, context_type);
+
+      cs->jit_context_ptr_type = LLVMPointerType(context_type, 0);
+   }
+
+   if (gallivm_debug & GALLIVM_DEBUG_IR) {
+      LLVMDumpModule(gallivm->module);
+   }
+}
+
+
+void
+lp_jit_init_cs_types(struct lp_compute_shader *cs)
+{
+   if (!cs->jit_context_ptr_type)
+      lp_jit_create_cs_types(cs);
+}
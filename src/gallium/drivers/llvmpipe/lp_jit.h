@@ -45,6 +45,7 @@
 
 struct lp_build_format_cache;
 struct lp_fragment_shader_variant;
+struct lp_compute_shader;
 struct llvmpipe_screen;
 
 
@@ -254,6 +255,80 @@ typedef void
                     unsigned depth_stride);
 
 
+/**
+ * This structure is passed directly to the generated compute shader.
+ *
+ * Changes here must be reflected in the lp_jit_cs_context_* macros and
+ * lp_jit_init_cs_types function. Same rules as for lp_jit_context apply.
+ */
+struct lp_jit_cs_context
+{
+   const float *constants[LP_MAX_TGSI_CONST_BUFFERS];
+   int num_constants[LP_MAX_TGSI_CONST_BUFFERS];
+
+   uint32_t *ssbos[PIPE_MAX_SHADER_BUFFERS];
+   int ssbo_sizes[PIPE_MAX_SHADER_BUFFERS];  /* in bytes */
+};
+
+
+/**
+ * These enum values must match the position of the fields in the
+ * lp_jit_cs_context struct above.
+ */
+enum {
+   LP_JIT_CS_CTX_CONSTANTS = 0,
+   LP_JIT_CS_CTX_NUM_CONSTANTS,
+   LP_JIT_CS_CTX_SSBOS,
+   LP_JIT_CS_CTX_SSBO_SIZES,
+   LP_JIT_CS_CTX_COUNT
+};
+
+
+#define lp_jit_cs_context_constants(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_CONSTANTS, "constants")
+
+#define lp_jit_cs_context_num_constants(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_NUM_CONSTANTS, "num_constants")
+
+#define lp_jit_cs_context_ssbos(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_SSBOS, "ssbos")
+
+#define lp_jit_cs_context_ssbo_sizes(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_SSBO_SIZES, "ssbo_sizes")
+
+
+/**
+ * typedef for compute shader function, runs all invocations of one
+ * workgroup
+ *
+ * @param context       jit cs context
+ * @param block_id_x    workgroup id
+ * @param block_id_y
+ * @param block_id_z
+ * @param grid_x        number of workgroups
+ * @param grid_y
+ * @param grid_z
+ * @param block_size_x  number of invocations in the workgroup
+ * @param block_size_y
+ * @param block_size_z
+ * @param shared_mem    workgroup shared memory
+ * @param shared_size   size of shared_mem in bytes
+ */
+typedef void
+(*lp_jit_cs_func)(const struct lp_jit_cs_context *context,
+                  uint32_t block_id_x,
+                  uint32_t block_id_y,
+                  uint32_t block_id_z,
+                  uint32_t grid_x,
+                  uint32_t grid_y,
+                  uint32_t grid_z,
+                  uint32_t block_size_x,
+                  uint32_t block_size_y,
+                  uint32_t block_size_z,
+                  void *shared_mem,
+                  uint32_t shared_size);
+
+
 void
 lp_jit_screen_cleanup(struct llvmpipe_screen *screen);
 
@@ -266,4 +341,8 @@ void
 lp_jit_init_types(struct lp_fragment_shader_variant *lp);
 
 
+void
+lp_jit_init_cs_types(struct lp_compute_shader *cs);
+
+
 #endif /* LP_JIT_H */
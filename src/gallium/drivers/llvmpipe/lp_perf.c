@@ -50,6 +50,7 @@ lp_print_counters(void)
 
       debug_printf("llvmpipe: nr_triangles:                 %9u\n", lp_count.nr_tris);
       debug_printf("llvmpipe: nr_culled_triangles:          %9u\n", lp_count.nr_culled_tris);
+      debug_printf("llvmpipe: nr_batched_triangles:         %9u\n", lp_count.nr_batched_tris);
 
       total_64 = (lp_count.nr_empty_64 + 
                   lp_count.nr_fully_covered_64 +
@@ -102,6 +103,10 @@ lp_print_counters(void)
       debug_printf("llvmpipe: nr_color_tile_load:           %9u\n", lp_count.nr_color_tile_load);
       debug_printf("llvmpipe: nr_color_tile_store:          %9u\n", lp_count.nr_color_tile_store);
 
+      debug_printf("llvmpipe: nr_scene_oom_flushes:         %9u\n", lp_count.nr_scene_oom_flushes);
+      debug_printf("llvmpipe: nr_scene_block_allocs:        %9u\n", lp_count.nr_scene_block_allocs);
+      debug_printf("llvmpipe: scene_peak_size:              %9u\n", lp_count.scene_peak_size);
+
       debug_printf("llvmpipe: nr_llvm_compiles:             %u\n", lp_count.nr_llvm_compiles);
       debug_printf("llvmpipe: total LLVM compile time:      %.2f sec\n", lp_count.llvm_compile_time / 1000000.0);
       debug_printf("llvmpipe: average LLVM compile time:    %.2f sec\n", lp_count.llvm_compile_time / 1000000.0 / lp_count.nr_llvm_compiles);
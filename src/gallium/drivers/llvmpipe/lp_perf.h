@@ -42,6 +42,7 @@ struct lp_counters
 {
    unsigned nr_tris;
    unsigned nr_culled_tris;
+   unsigned nr_batched_tris;
    unsigned nr_empty_64;
    unsigned nr_fully_covered_64;
    unsigned nr_partially_covered_64;
@@ -62,6 +63,10 @@ struct lp_counters
    unsigned nr_color_tile_clear;
    unsigned nr_color_tile_load;
    unsigned nr_color_tile_store;
+
+   unsigned nr_scene_oom_flushes;   /**< scenes flushed for running out of memory */
+   unsigned nr_scene_block_allocs;  /**< data blocks not found in the pools */
+   unsigned scene_peak_size;        /**< in bytes */
 };
 
 
@@ -73,10 +78,13 @@ extern struct lp_counters lp_count;
 #define LP_COUNT(counter) lp_count.counter++
 #define LP_COUNT_ADD(counter, incr)  lp_count.counter += (incr)
 #define LP_COUNT_GET(counter) (lp_count.counter)
+#define LP_COUNT_MAX(counter, val) \
+   lp_count.counter = MAX2(lp_count.counter, (val))
 #else
 #define LP_COUNT(counter)
 #define LP_COUNT_ADD(counter, incr) (void)(incr)
 #define LP_COUNT_GET(counter) 0
+#define LP_COUNT_MAX(counter, val) (void)(val)
 #endif
 
 
@@ -25,6 +25,7 @@
  *
  **************************************************************************/
 
+#include <float.h>
 #include <limits.h>
 #include "util/u_memory.h"
 #include "util/u_math.h"
@@ -73,15 +74,352 @@ lp_rast_begin( struct lp_rasterizer *rast,
 }
 
 
+/**
+ * The scene is left as it is: setup releases what it holds on to once it
+ * sees the scene's fence signalled, which may be several scenes later.
+ */
 static void
 lp_rast_end( struct lp_rasterizer *rast )
 {
-   lp_scene_end_rasterization( rast->curr_scene );
-
    rast->curr_scene = NULL;
 }
 
 
+/**
+ * Set up the coarse depth for a new tile, see struct lp_rast_hiz.
+ */
+static void
+lp_rast_hiz_begin_tile(struct lp_rasterizer_task *task)
+{
+   const struct lp_scene *scene = task->scene;
+   struct lp_rast_hiz *hiz = &task->hiz;
+   const struct util_format_description *desc;
+   const struct util_format_channel_description *chan;
+
+   hiz->supported = FALSE;
+   hiz->test = FALSE;
+   hiz->valid = 0;
+
+#ifdef PIPE_ARCH_LITTLE_ENDIAN
+   if (!scene->fb.zsbuf || !scene->zsbuf.map || scene->fb_max_layer != 0)
+      return;
+
+   desc = util_format_description(scene->fb.zsbuf->format);
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->swizzle[0] >= 4 ||
+       desc->block.bits < 16 || desc->block.bits > 64)
+      return;
+
+   chan = &desc->channel[desc->swizzle[0]];
+   if (chan->shift + chan->size > 32)
+      return;
+
+   hiz->format_bytes = desc->block.bits / 8;
+   hiz->shift = chan->shift;
+
+   if (chan->type == UTIL_FORMAT_TYPE_FLOAT && chan->size == 32) {
+      hiz->is_float = TRUE;
+      hiz->mask = ~0u;
+      hiz->scale = 1.0f;
+      hiz->epsilon = 1e-5f;
+   }
+   else if (chan->type == UTIL_FORMAT_TYPE_UNSIGNED && chan->normalized) {
+      hiz->is_float = FALSE;
+      hiz->mask = chan->size == 32 ? ~0u : (1u << chan->size) - 1;
+      hiz->scale = (float) (1.0 / hiz->mask);
+      hiz->epsilon = MAX2(2.0f * hiz->scale, 1e-5f);
+   }
+   else {
+      return;
+   }
+
+   hiz->supported = TRUE;
+#endif
+}
+
+
+/**
+ * Update the coarse depth for a new rasterization state.  Rejection needs a
+ * LESS or LEQUAL test of the interpolated depth, with fragments failing it
+ * having no other effect.  States which may raise the depth discard it.
+ */
+static void
+lp_rast_hiz_set_state(struct lp_rasterizer_task *task)
+{
+   const struct lp_fragment_shader_variant *variant = task->state->variant;
+   struct lp_rast_hiz *hiz = &task->hiz;
+
+   hiz->test = FALSE;
+
+   if (!hiz->supported || !variant || !variant->key.depth.enabled)
+      return;
+
+   switch (variant->key.depth.func) {
+   case PIPE_FUNC_LESS:
+   case PIPE_FUNC_LEQUAL:
+      hiz->test = !variant->key.stencil[0].enabled &&
+                  !variant->key.depth_clamp &&
+                  !variant->shader->info.base.writes_z;
+      break;
+   case PIPE_FUNC_NEVER:
+   case PIPE_FUNC_EQUAL:
+      break;
+   default:
+      if (variant->key.depth.writemask)
+         hiz->valid = 0;
+      break;
+   }
+}
+
+
+/**
+ * Update the coarse depth for a clear of the depth/stencil tile.
+ */
+static void
+lp_rast_hiz_clear(struct lp_rasterizer_task *task,
+                  uint64_t value, uint64_t mask)
+{
+   struct lp_rast_hiz *hiz = &task->hiz;
+   const uint64_t depth_mask = (uint64_t) hiz->mask << hiz->shift;
+   float zmax;
+   unsigned i;
+
+   if (!hiz->supported || (mask & depth_mask) == 0)
+      return;
+
+   if ((mask & depth_mask) != depth_mask) {
+      hiz->valid = 0;
+      return;
+   }
+
+   if (hiz->is_float) {
+      union fi fi;
+      fi.ui = (uint32_t) value;
+      zmax = fi.f;
+   }
+   else {
+      zmax = (float) ((value >> hiz->shift) & hiz->mask) * hiz->scale;
+   }
+
+   for (i = 0; i < Elements(hiz->zmax); i++)
+      hiz->zmax[i] = zmax;
+   hiz->valid = (1 << Elements(hiz->zmax)) - 1;
+}
+
+
+/**
+ * Get the upper bound of the depth of a block of the tile, computing it
+ * from the depth buffer if needed.
+ * \param bx, by  position of the block within the tile, in blocks
+ */
+static float
+lp_rast_hiz_block_zmax(struct lp_rasterizer_task *task,
+                       unsigned bx, unsigned by)
+{
+   struct lp_rast_hiz *hiz = &task->hiz;
+   const unsigned block = by * LP_HIZ_BLOCKS_X + bx;
+
+   if (!(hiz->valid & (1 << block))) {
+      const unsigned stride = task->depth_stride;
+      const unsigned x0 = bx << LP_HIZ_BLOCK_ORDER;
+      const unsigned y0 = by << LP_HIZ_BLOCK_ORDER;
+      const unsigned width = MIN2(task->width - x0, 1 << LP_HIZ_BLOCK_ORDER);
+      const unsigned height = MIN2(task->height - y0, 1 << LP_HIZ_BLOCK_ORDER);
+      const uint8_t *row = task->depth_tile + y0 * stride +
+                           x0 * hiz->format_bytes;
+      unsigned i, j;
+
+      assert(x0 < task->width && y0 < task->height);
+
+      if (hiz->is_float) {
+         float zmax = -FLT_MAX;
+
+         for (i = 0; i < height; i++) {
+            for (j = 0; j < width; j++) {
+               const float *z = (const float *)(row + j * hiz->format_bytes);
+               zmax = MAX2(zmax, *z);
+            }
+            row += stride;
+         }
+         hiz->zmax[block] = zmax;
+      }
+      else if (hiz->format_bytes == 2) {
+         uint16_t zmax = 0;
+
+         for (i = 0; i < height; i++) {
+            const uint16_t *z = (const uint16_t *)row;
+            for (j = 0; j < width; j++)
+               zmax = MAX2(zmax, z[j]);
+            row += stride;
+         }
+         hiz->zmax[block] = (float) ((zmax >> hiz->shift) & hiz->mask) *
+                            hiz->scale;
+      }
+      else {
+         uint32_t zmax = 0;
+
+         for (i = 0; i < height; i++) {
+            for (j = 0; j < width; j++) {
+               const uint32_t *z = (const uint32_t *)(row + j * hiz->format_bytes);
+               zmax = MAX2(zmax, (*z >> hiz->shift) & hiz->mask);
+            }
+            row += stride;
+         }
+         hiz->zmax[block] = (float) zmax * hiz->scale;
+      }
+
+      hiz->valid |= 1 << block;
+   }
+
+   return hiz->zmax[block];
+}
+
+
+/**
+ * Check whether all fragments of a primitive within a size x size square
+ * of the tile fail the depth test, going by the depth plane of the
+ * primitive and the coarse depth of the tile.  Conservative, only to be
+ * called when task->hiz.test is set.
+ * \param x, y  position of the square in window coords
+ */
+boolean
+lp_rast_hiz_reject(struct lp_rasterizer_task *task,
+                   const struct lp_rast_shader_inputs *inputs,
+                   unsigned x, unsigned y, unsigned size)
+{
+   const struct lp_rast_hiz *hiz = &task->hiz;
+   const float z0 = GET_A0(inputs)[0][2];
+   const float dzdx = GET_DADX(inputs)[0][2];
+   const float dzdy = GET_DADY(inputs)[0][2];
+   const unsigned px = x % TILE_SIZE;
+   const unsigned py = y % TILE_SIZE;
+   unsigned bx, by, bx1, by1;
+   float x0, x1, y0, y1, zmin;
+
+   assert(hiz->test);
+
+   if (px >= task->width || py >= task->height)
+      return FALSE;
+
+   /* Minimum of the depth plane, over the square grown by a pixel to
+    * cover wherever the pixel centers are.
+    */
+   x0 = (float) x - 1.0f;
+   x1 = (float) (x + size) + 1.0f;
+   y0 = (float) y - 1.0f;
+   y1 = (float) (y + size) + 1.0f;
+   zmin = z0 + MIN2(dzdx * x0, dzdx * x1) + MIN2(dzdy * y0, dzdy * y1);
+
+   /* Unorm depth is clamped to 1.0, which may pass a LEQUAL test. */
+   if (!hiz->is_float)
+      zmin = MIN2(zmin, 1.0f);
+
+   zmin -= hiz->epsilon;
+
+   bx1 = (MIN2(px + size, task->width) - 1) >> LP_HIZ_BLOCK_ORDER;
+   by1 = (MIN2(py + size, task->height) - 1) >> LP_HIZ_BLOCK_ORDER;
+
+   for (by = py >> LP_HIZ_BLOCK_ORDER; by <= by1; by++) {
+      for (bx = px >> LP_HIZ_BLOCK_ORDER; bx <= bx1; bx++) {
+         if (!(zmin > lp_rast_hiz_block_zmax(task, bx, by)))
+            return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Size of the tile-local buffers, enough for any color or depth/stencil
+ * format.
+ */
+#define LP_LOCAL_TILE_SIZE (TILE_SIZE * TILE_SIZE * 16)
+
+
+/**
+ * Whether to use a tile-local buffer for a buffer of the current tile, with
+ * \p tile pointing at the task's buffer for it.  Allocates it if needed.
+ */
+static boolean
+lp_rast_get_local_tile(struct lp_rasterizer_task *task, uint8_t **tile)
+{
+   if (!task->rast->local_tiles || task->scene->fb_max_layer != 0)
+      return FALSE;
+
+   if (!*tile)
+      *tile = align_malloc(LP_LOCAL_TILE_SIZE, 64);
+
+   return *tile != NULL;
+}
+
+
+/**
+ * Copy the current tile between a buffer and its tile-local copy.
+ */
+static void
+lp_rast_copy_tile(const struct lp_rasterizer_task *task,
+                  uint8_t *dst, unsigned dst_stride,
+                  const uint8_t *src, unsigned src_stride,
+                  unsigned format_bytes)
+{
+   const unsigned row_bytes = task->width * format_bytes;
+   unsigned i;
+
+   for (i = 0; i < task->height; i++) {
+      memcpy(dst, src, row_bytes);
+      dst += dst_stride;
+      src += src_stride;
+   }
+}
+
+
+/**
+ * Find the buffers the bin starts by clearing entirely, which don't need
+ * to be loaded into the tile-local buffers.
+ * \return mask of color buffers, with bit PIPE_MAX_COLOR_BUFS for the
+ * depth/stencil buffer
+ */
+static unsigned
+lp_rast_tile_cleared_mask(const struct lp_rasterizer_task *task,
+                          const struct cmd_bin *bin)
+{
+   const struct lp_scene *scene = task->scene;
+   const struct cmd_block *block;
+   unsigned cleared = 0;
+   unsigned k;
+
+   for (block = bin->head; block; block = block->next) {
+      for (k = 0; k < block->count; k++) {
+         const union lp_rast_cmd_arg arg = block->arg[k];
+
+         switch (block->cmd[k]) {
+         case LP_RAST_OP_CLEAR_COLOR:
+            cleared |= 1 << arg.clear_rb->cbuf;
+            break;
+         case LP_RAST_OP_CLEAR_ZSTENCIL:
+            {
+               const uint64_t mask =
+                  util_pack64_mask_z_stencil(scene->fb.zsbuf->format,
+                                             0xffffffff, 0xff);
+               if ((arg.clear_zstencil.mask & mask) == mask)
+                  cleared |= 1 << PIPE_MAX_COLOR_BUFS;
+            }
+            break;
+         case LP_RAST_OP_SET_STATE:
+         case LP_RAST_OP_BEGIN_QUERY:
+         case LP_RAST_OP_END_QUERY:
+            break;
+         default:
+            return cleared;
+         }
+      }
+   }
+
+   return cleared;
+}
+
+
 /**
  * Beginning rasterization of a tile.
  * \param x  window X position of the tile, in pixels
@@ -92,7 +430,7 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
                    const struct cmd_bin *bin,
                    int x, int y)
 {
-   unsigned i;
+   unsigned i, cleared;
    struct lp_scene *scene = task->scene;
 
    LP_DBG(DEBUG_RAST, "%s %d,%d\n", __FUNCTION__, x, y);
@@ -108,18 +446,46 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
    task->thread_data.vis_counter = 0;
    task->ps_invocations = 0;
 
+   cleared = task->rast->local_tiles ? lp_rast_tile_cleared_mask(task, bin) : 0;
+
    for (i = 0; i < task->scene->fb.nr_cbufs; i++) {
       if (task->scene->fb.cbufs[i]) {
-         task->color_tiles[i] = scene->cbufs[i].map +
-                                scene->cbufs[i].stride * task->y +
-                                scene->cbufs[i].format_bytes * task->x;
+         uint8_t *map = scene->cbufs[i].map +
+                        scene->cbufs[i].stride * task->y +
+                        scene->cbufs[i].format_bytes * task->x;
+
+         task->color_tiles[i] = map;
+         task->color_strides[i] = scene->cbufs[i].stride;
+
+         if (lp_rast_get_local_tile(task, &task->local_color_tiles[i])) {
+            task->color_tiles[i] = task->local_color_tiles[i];
+            task->color_strides[i] = TILE_SIZE * scene->cbufs[i].format_bytes;
+            if (!(cleared & (1 << i)))
+               lp_rast_copy_tile(task, task->color_tiles[i],
+                                 task->color_strides[i],
+                                 map, scene->cbufs[i].stride,
+                                 scene->cbufs[i].format_bytes);
+         }
       }
    }
    if (task->scene->fb.zsbuf) {
-      task->depth_tile = scene->zsbuf.map +
-                         scene->zsbuf.stride * task->y +
-                         scene->zsbuf.format_bytes * task->x;
+      uint8_t *map = scene->zsbuf.map +
+                     scene->zsbuf.stride * task->y +
+                     scene->zsbuf.format_bytes * task->x;
+
+      task->depth_tile = map;
+      task->depth_stride = scene->zsbuf.stride;
+
+      if (map && lp_rast_get_local_tile(task, &task->local_depth_tile)) {
+         task->depth_tile = task->local_depth_tile;
+         task->depth_stride = TILE_SIZE * scene->zsbuf.format_bytes;
+         if (!(cleared & (1 << PIPE_MAX_COLOR_BUFS)))
+            lp_rast_copy_tile(task, task->depth_tile, task->depth_stride,
+                              map, scene->zsbuf.stride,
+                              scene->zsbuf.format_bytes);
+      }
    }
+   lp_rast_hiz_begin_tile(task);
 }
 
 
@@ -152,12 +518,12 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
           __FUNCTION__, format, uc.ui[0], uc.ui[1], uc.ui[2], uc.ui[3]);
 
 
-   util_fill_box(scene->cbufs[cbuf].map,
+   util_fill_box(task->color_tiles[cbuf],
                  format,
-                 scene->cbufs[cbuf].stride,
+                 task->color_strides[cbuf],
                  scene->cbufs[cbuf].layer_stride,
-                 task->x,
-                 task->y,
+                 0,
+                 0,
                  0,
                  task->width,
                  task->height,
@@ -185,7 +551,7 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
    uint32_t clear_mask = (uint32_t) clear_mask64;
    const unsigned height = task->height;
    const unsigned width = task->width;
-   const unsigned dst_stride = scene->zsbuf.stride;
+   const unsigned dst_stride = task->depth_stride;
    uint8_t *dst;
    unsigned i, j;
    unsigned block_size;
@@ -280,6 +646,9 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
          }
          dst_layer += scene->zsbuf.layer_stride;
       }
+
+      lp_rast_hiz_clear(task, arg.clear_zstencil.value,
+                        arg.clear_zstencil.mask);
    }
 }
 
@@ -315,6 +684,10 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    }
    variant = state->variant;
 
+   if (task->hiz.test &&
+       lp_rast_hiz_reject(task, inputs, tile_x, tile_y, TILE_SIZE))
+      return;
+
    /* render the whole 64x64 tile in 4x4 chunks */
    for (y = 0; y < task->height; y += 4){
       for (x = 0; x < task->width; x += 4) {
@@ -324,10 +697,14 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          unsigned depth_stride = 0;
          unsigned i;
 
+         if (task->hiz.test &&
+             lp_rast_hiz_reject(task, inputs, tile_x + x, tile_y + y, 4))
+            continue;
+
          /* color buffer */
          for (i = 0; i < scene->fb.nr_cbufs; i++){
             if (scene->fb.cbufs[i]) {
-               stride[i] = scene->cbufs[i].stride;
+               stride[i] = task->color_strides[i];
                color[i] = lp_rast_get_color_block_pointer(task, i, tile_x + x,
                                                           tile_y + y, inputs->layer);
             }
@@ -341,7 +718,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          if (scene->zsbuf.map) {
             depth = lp_rast_get_depth_block_pointer(task, tile_x + x,
                                                     tile_y + y, inputs->layer);
-            depth_stride = scene->zsbuf.stride;
+            depth_stride = task->depth_stride;
          }
 
          /* Propagate non-interpolated raster state. */
@@ -422,7 +799,7 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
    /* color buffer */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
       if (scene->fb.cbufs[i]) {
-         stride[i] = scene->cbufs[i].stride;
+         stride[i] = task->color_strides[i];
          color[i] = lp_rast_get_color_block_pointer(task, i, x, y,
                                                     inputs->layer);
       }
@@ -434,7 +811,7 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
 
    /* depth buffer */
    if (scene->zsbuf.map) {
-      depth_stride = scene->zsbuf.stride;
+      depth_stride = task->depth_stride;
       depth = lp_rast_get_depth_block_pointer(task, x, y, inputs->layer);
    }
 
@@ -444,7 +821,8 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
     * The rasterizer may produce fragments outside our
     * allocated 4x4 blocks hence need to filter them out here.
     */
-   if ((x % TILE_SIZE) < task->width && (y % TILE_SIZE) < task->height) {
+   if ((x % TILE_SIZE) < task->width && (y % TILE_SIZE) < task->height &&
+       !(task->hiz.test && lp_rast_hiz_reject(task, inputs, x, y, 4))) {
       /* not very accurate would need a popcount on the mask */
       /* always count this not worth bothering? */
       task->ps_invocations += 1 * variant->ps_inv_multiplier;
@@ -536,6 +914,7 @@ lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg)
 {
    task->state = arg.state;
+   lp_rast_hiz_set_state(task);
 }
 
 
@@ -546,12 +925,35 @@ lp_rast_set_state(struct lp_rasterizer_task *task,
 static void
 lp_rast_tile_end(struct lp_rasterizer_task *task)
 {
+   const struct lp_scene *scene = task->scene;
    unsigned i;
 
    for (i = 0; i < task->scene->num_active_queries; ++i) {
       lp_rast_end_query(task, lp_rast_arg_query(task->scene->active_queries[i]));
    }
 
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->fb.cbufs[i] &&
+          task->color_tiles[i] == task->local_color_tiles[i]) {
+         lp_rast_copy_tile(task,
+                           scene->cbufs[i].map +
+                           scene->cbufs[i].stride * task->y +
+                           scene->cbufs[i].format_bytes * task->x,
+                           scene->cbufs[i].stride,
+                           task->color_tiles[i], task->color_strides[i],
+                           scene->cbufs[i].format_bytes);
+      }
+   }
+   if (task->depth_tile && task->depth_tile == task->local_depth_tile) {
+      lp_rast_copy_tile(task,
+                        scene->zsbuf.map +
+                        scene->zsbuf.stride * task->y +
+                        scene->zsbuf.format_bytes * task->x,
+                        scene->zsbuf.stride,
+                        task->depth_tile, task->depth_stride,
+                        scene->zsbuf.format_bytes);
+   }
+
    /* debug */
    memset(task->color_tiles, 0, sizeof(task->color_tiles));
    task->depth_tile = NULL;
@@ -589,7 +991,8 @@ static lp_rast_cmd_func dispatch[LP_RAST_OP_MAX] =
    lp_rast_triangle_32_8,
    lp_rast_triangle_32_3_4,
    lp_rast_triangle_32_3_16,
-   lp_rast_triangle_32_4_16
+   lp_rast_triangle_32_4_16,
+   lp_rast_triangle_32_3_4_batch
 };
 
 
@@ -667,14 +1070,8 @@ rasterize_scene(struct lp_rasterizer_task *task,
 
    /* Clear the cache tags. This should not always be necessary but
       simpler for now. */
-#if LP_USE_TEXTURE_CACHE
    memset(task->thread_data.cache->cache_tags, 0,
           sizeof(task->thread_data.cache->cache_tags));
-#if LP_BUILD_FORMAT_CACHE_DEBUG
-   task->thread_data.cache->cache_access_total = 0;
-   task->thread_data.cache->cache_access_miss = 0;
-#endif
-#endif
 
    if (!task->rast->no_rast && !scene->discard) {
       /* loop over scene bins, rasterize each */
@@ -691,19 +1088,6 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 
 
-#if LP_BUILD_FORMAT_CACHE_DEBUG
-   {
-      uint64_t total, miss;
-      total = task->thread_data.cache->cache_access_total;
-      miss = task->thread_data.cache->cache_access_miss;
-      if (total) {
-         debug_printf("thread %d cache access %llu miss %llu hit rate %f\n",
-                 task->thread_index, (long long unsigned)total,
-                 (long long unsigned)miss,
-                 (float)(total - miss)/(float)total);
-      }
-   }
-#endif
 
    if (scene->fence) {
       lp_fence_signal(scene->fence);
@@ -757,29 +1141,11 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 }
 
 
-void
-lp_rast_finish( struct lp_rasterizer *rast )
-{
-   if (rast->num_threads == 0) {
-      /* nothing to do */
-   }
-   else {
-      int i;
-
-      /* wait for work to complete */
-      for (i = 0; i < rast->num_threads; i++) {
-         pipe_semaphore_wait(&rast->tasks[i].work_done);
-      }
-   }
-}
-
-
 /**
  * This is the thread's main entrypoint.
  * It's a simple loop:
  *   1. wait for work
- *   2. do work
- *   3. signal that we're done
+ *   2. do work, signalling the scene's fence when done
  */
 static PIPE_THREAD_ROUTINE( thread_function, init_data )
 {
@@ -837,11 +1203,11 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
          lp_rast_end( rast );
       }
 
-      /* signal done with work */
+      /* Completion is signalled through the scene's fence, there's
+       * nobody waiting on the threads themselves.
+       */
       if (debug)
          debug_printf("thread %d done working\n", task->thread_index);
-
-      pipe_semaphore_signal(&task->work_done);
    }
 
 #ifdef _WIN32
@@ -901,11 +1267,13 @@ lp_rast_create( unsigned num_threads )
       if (!task->thread_data.cache) {
          goto no_thread_data_cache;
       }
+      memset(task->thread_data.cache, 0, sizeof(struct lp_build_format_cache));
    }
 
    rast->num_threads = num_threads;
 
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
+   rast->local_tiles = debug_get_bool_option("LP_LOCAL_TILES", FALSE);
 
    create_rast_threads(rast);
 
@@ -965,7 +1333,26 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
       pipe_semaphore_destroy(&rast->tasks[i].work_done);
    }
    for (i = 0; i < MAX2(1, rast->num_threads); i++) {
-      align_free(rast->tasks[i].thread_data.cache);
+      struct lp_rasterizer_task *task = &rast->tasks[i];
+      uint64_t total = task->thread_data.cache->cache_access_total;
+      uint64_t miss = task->thread_data.cache->cache_access_miss;
+      unsigned j;
+
+      if ((LP_DEBUG & DEBUG_COUNTERS) && total) {
+         debug_printf("llvmpipe: thread %u texel cache access %llu miss %llu"
+                      " hit rate %f\n",
+                      task->thread_index, (long long unsigned)total,
+                      (long long unsigned)miss,
+                      (float)(total - miss)/(float)total);
+      }
+
+      align_free(task->thread_data.cache);
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++) {
+         if (task->local_color_tiles[j])
+            align_free(task->local_color_tiles[j]);
+      }
+      if (task->local_depth_tile)
+         align_free(task->local_depth_tile);
    }
 
    /* for synchronizing rasterization threads */
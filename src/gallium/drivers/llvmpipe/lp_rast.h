@@ -143,6 +143,21 @@ struct lp_rast_triangle {
 };
 
 
+/**
+ * A run of triangles each contained in a single 4x4 stamp of the same
+ * tile and binned with the same state, rasterized by one command.
+ * pos[] holds the stamp position within the tile packed as x | y << 8,
+ * as in lp_rast_arg_triangle_contained().
+ */
+#define LP_RAST_TRI_BATCH_MAX 16
+
+struct lp_rast_tri_batch {
+   unsigned count;
+   uint16_t pos[LP_RAST_TRI_BATCH_MAX];
+   const struct lp_rast_triangle *tri[LP_RAST_TRI_BATCH_MAX];
+};
+
+
 struct lp_rast_clear_rb {
    union util_color color_val;
    unsigned cbuf;
@@ -166,9 +181,6 @@ void
 lp_rast_queue_scene( struct lp_rasterizer *rast,
                      struct lp_scene *scene );
 
-void
-lp_rast_finish( struct lp_rasterizer *rast );
-
 
 union lp_rast_cmd_arg {
    const struct lp_rast_shader_inputs *shade_tile;
@@ -176,6 +188,7 @@ union lp_rast_cmd_arg {
       const struct lp_rast_triangle *tri;
       unsigned plane_mask;
    } triangle;
+   const struct lp_rast_tri_batch *tri_batch;
    const struct lp_rast_state *set_state;
    const struct lp_rast_clear_rb *clear_rb;
    struct {
@@ -224,6 +237,14 @@ lp_rast_arg_triangle_contained( const struct lp_rast_triangle *triangle,
    return arg;
 }
 
+static inline union lp_rast_cmd_arg
+lp_rast_arg_tri_batch( const struct lp_rast_tri_batch *batch )
+{
+   union lp_rast_cmd_arg arg;
+   arg.tri_batch = batch;
+   return arg;
+}
+
 static inline union lp_rast_cmd_arg
 lp_rast_arg_state( const struct lp_rast_state *state )
 {
@@ -302,8 +323,9 @@ lp_rast_arg_null( void )
 #define LP_RAST_OP_TRIANGLE_32_3_4   0x1a
 #define LP_RAST_OP_TRIANGLE_32_3_16  0x1b
 #define LP_RAST_OP_TRIANGLE_32_4_16  0x1c
+#define LP_RAST_OP_TRIANGLE_32_3_4_BATCH 0x1d
 
-#define LP_RAST_OP_MAX               0x1d
+#define LP_RAST_OP_MAX               0x1e
 #define LP_RAST_OP_MASK              0xff
 
 void
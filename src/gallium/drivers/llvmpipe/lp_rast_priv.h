@@ -76,6 +76,37 @@ extern const struct lp_rasterizer_task *jit_task;
 struct lp_rasterizer;
 struct cmd_bin;
 
+/** Size of the blocks of the coarse depth, as a power of two */
+#define LP_HIZ_BLOCK_ORDER 4
+#define LP_HIZ_BLOCKS_X (TILE_SIZE >> LP_HIZ_BLOCK_ORDER)
+
+/**
+ * Coarse depth of the current tile, for rejecting fragments which can't
+ * pass a LESS or LEQUAL depth test before running the shader.
+ *
+ * zmax[] holds an upper bound of the depth of each 16x16 block of the
+ * tile, for the blocks set in the valid mask.  Those are computed from the
+ * depth buffer when first needed.  They stay correct while depth writes
+ * can only lower the depth, so they are only discarded when a state which
+ * may raise it is set.
+ */
+struct lp_rast_hiz
+{
+   boolean supported;  /**< depth buffer format handled, single layer */
+   boolean test;       /**< current state allows rejection */
+
+   unsigned valid;
+   float zmax[LP_HIZ_BLOCKS_X * LP_HIZ_BLOCKS_X];
+
+   /* Depth buffer format */
+   unsigned format_bytes;
+   unsigned shift;
+   uint32_t mask;
+   boolean is_float;
+   float scale;
+   float epsilon;  /**< bounds the rounding of the fragment depth */
+};
+
 /**
  * Per-thread rasterization state
  */
@@ -90,6 +121,17 @@ struct lp_rasterizer_task
 
    uint8_t *color_tiles[PIPE_MAX_COLOR_BUFS];
    uint8_t *depth_tile;
+   unsigned color_strides[PIPE_MAX_COLOR_BUFS];
+   unsigned depth_stride;
+
+   /**
+    * Tile-local copies of the color and depth/stencil tiles, with
+    * LP_LOCAL_TILES, allocated on first use.  When used, the above point at
+    * these, loaded in lp_rast_tile_begin() unless the bin starts with a
+    * clear of the buffer, and stored back in lp_rast_tile_end().
+    */
+   uint8_t *local_color_tiles[PIPE_MAX_COLOR_BUFS];
+   uint8_t *local_depth_tile;
 
    /** "back" pointer */
    struct lp_rasterizer *rast;
@@ -102,6 +144,8 @@ struct lp_rasterizer_task
    uint64_t ps_invocations;
    uint8_t ps_inv_multiplier;
 
+   struct lp_rast_hiz hiz;
+
    pipe_semaphore work_ready;
    pipe_semaphore work_done;
 };
@@ -116,6 +160,7 @@ struct lp_rasterizer
 {
    boolean exit_flag;
    boolean no_rast;  /**< For debugging/profiling */
+   boolean local_tiles;  /**< Shade into tile-local copies of the buffers */
 
    /** The incoming queue of scenes ready to rasterize */
    struct lp_scene_queue *full_scenes;
@@ -140,6 +185,11 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                          unsigned x, unsigned y,
                          unsigned mask);
 
+boolean
+lp_rast_hiz_reject(struct lp_rasterizer_task *task,
+                   const struct lp_rast_shader_inputs *inputs,
+                   unsigned x, unsigned y, unsigned size);
+
 
 /**
  * Get the pointer to a 4x4 color block (within a 64x64 tile).
@@ -170,7 +220,7 @@ lp_rast_get_color_block_pointer(struct lp_rasterizer_task *task,
    py = y % TILE_SIZE;
 
    pixel_offset = px * task->scene->cbufs[buf].format_bytes +
-                  py * task->scene->cbufs[buf].stride;
+                  py * task->color_strides[buf];
    color = task->color_tiles[buf] + pixel_offset;
 
    if (layer) {
@@ -204,7 +254,7 @@ lp_rast_get_depth_block_pointer(struct lp_rasterizer_task *task,
    py = y % TILE_SIZE;
 
    pixel_offset = px * task->scene->zsbuf.format_bytes +
-                  py * task->scene->zsbuf.stride;
+                  py * task->depth_stride;
    depth = task->depth_tile + pixel_offset;
 
    if (layer) {
@@ -239,7 +289,7 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
    /* color buffer */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
       if (scene->fb.cbufs[i]) {
-         stride[i] = scene->cbufs[i].stride;
+         stride[i] = task->color_strides[i];
          color[i] = lp_rast_get_color_block_pointer(task, i, x, y,
                                                     inputs->layer);
       }
@@ -251,14 +301,15 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
 
    if (scene->zsbuf.map) {
       depth = lp_rast_get_depth_block_pointer(task, x, y, inputs->layer);
-      depth_stride = scene->zsbuf.stride;
+      depth_stride = task->depth_stride;
    }
 
    /*
     * The rasterizer may produce fragments outside our
     * allocated 4x4 blocks hence need to filter them out here.
     */
-   if ((x % TILE_SIZE) < task->width && (y % TILE_SIZE) < task->height) {
+   if ((x % TILE_SIZE) < task->width && (y % TILE_SIZE) < task->height &&
+       !(task->hiz.test && lp_rast_hiz_reject(task, inputs, x, y, 4))) {
       /* not very accurate would need a popcount on the mask */
       /* always count this not worth bothering? */
       task->ps_invocations += 1 * variant->ps_inv_multiplier;
@@ -337,6 +388,9 @@ void lp_rast_triangle_32_3_16( struct lp_rasterizer_task *,
 void lp_rast_triangle_32_4_16( struct lp_rasterizer_task *, 
                             const union lp_rast_cmd_arg );
 
+void lp_rast_triangle_32_3_4_batch(struct lp_rasterizer_task *,
+                                   const union lp_rast_cmd_arg );
+
 void
 lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg);
@@ -350,14 +350,14 @@ lp_rast_triangle_32_3_16(struct lp_rasterizer_task *task,
                                0xffff & ~out[i].mask);
 }
 
-void
-lp_rast_triangle_32_3_4(struct lp_rasterizer_task *task,
-                        const union lp_rast_cmd_arg arg)
+/**
+ * Coverage mask of a 3-plane triangle over the 4x4 stamp at x, y.
+ */
+static inline unsigned
+tri_32_3_4_mask(const struct lp_rast_triangle *tri,
+                unsigned x, unsigned y)
 {
-   const struct lp_rast_triangle *tri = arg.triangle.tri;
    const struct lp_rast_plane *plane = GET_PLANES(tri);
-   unsigned x = (arg.triangle.plane_mask & 0xff) + task->x;
-   unsigned y = (arg.triangle.plane_mask >> 8) + task->y;
 
    /* p0 and p2 are aligned, p1 is not (plane size 24 bytes). */
    __m128i p0 = _mm_load_si128((__m128i *)&plane[0]); /* clo, chi, dcdx, dcdy */
@@ -423,12 +423,49 @@ lp_rast_triangle_32_3_4(struct lp_rasterizer_task *task,
 
       unsigned mask = _mm_movemask_epi8(c_0123);
 
-      if (mask != 0xffff)
+      return 0xffff & ~mask;
+   }
+}
+
+void
+lp_rast_triangle_32_3_4(struct lp_rasterizer_task *task,
+                        const union lp_rast_cmd_arg arg)
+{
+   const struct lp_rast_triangle *tri = arg.triangle.tri;
+   unsigned x = (arg.triangle.plane_mask & 0xff) + task->x;
+   unsigned y = (arg.triangle.plane_mask >> 8) + task->y;
+   unsigned mask = tri_32_3_4_mask(tri, x, y);
+
+   if (mask)
+      lp_rast_shade_quads_mask(task, &tri->inputs, x, y, mask);
+}
+
+void
+lp_rast_triangle_32_3_4_batch(struct lp_rasterizer_task *task,
+                              const union lp_rast_cmd_arg arg)
+{
+   const struct lp_rast_tri_batch *batch = arg.tri_batch;
+   unsigned mask[LP_RAST_TRI_BATCH_MAX];
+   unsigned i;
+
+   assert(batch->count <= LP_RAST_TRI_BATCH_MAX);
+
+   /* Evaluate the edge functions for the whole batch up front, so that
+    * this tight loop isn't interleaved with running the shader.
+    */
+   for (i = 0; i < batch->count; i++) {
+      mask[i] = tri_32_3_4_mask(batch->tri[i],
+                                (batch->pos[i] & 0xff) + task->x,
+                                (batch->pos[i] >> 8) + task->y);
+   }
+
+   for (i = 0; i < batch->count; i++) {
+      if (mask[i])
          lp_rast_shade_quads_mask(task,
-                                  &tri->inputs,
-                                  x,
-                                  y,
-                                  0xffff & ~mask);
+                                  &batch->tri[i]->inputs,
+                                  (batch->pos[i] & 0xff) + task->x,
+                                  (batch->pos[i] >> 8) + task->y,
+                                  mask[i]);
    }
 }
 
@@ -681,6 +718,21 @@ lp_rast_triangle_32_3_4(struct lp_rasterizer_task *task,
    lp_rast_triangle_32_3_16(task, arg);
 }
 
+void
+lp_rast_triangle_32_3_4_batch(struct lp_rasterizer_task *task,
+                              const union lp_rast_cmd_arg arg)
+{
+   const struct lp_rast_tri_batch *batch = arg.tri_batch;
+   unsigned i;
+
+   for (i = 0; i < batch->count; i++) {
+      lp_rast_triangle_32_3_4(task,
+                              lp_rast_arg_triangle_contained(batch->tri[i],
+                                                             batch->pos[i] & 0xff,
+                                                             batch->pos[i] >> 8));
+   }
+}
+
 #endif
 
 
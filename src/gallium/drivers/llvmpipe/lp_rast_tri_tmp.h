@@ -81,6 +81,10 @@ TAG(do_block_16)(struct lp_rasterizer_task *task,
    unsigned outmask, inmask, partmask, partial_mask;
    unsigned j;
 
+   if (task->hiz.test &&
+       lp_rast_hiz_reject(task, &tri->inputs, x, y, 16))
+      return;
+
    outmask = 0;                 /* outside one or more trivial reject planes */
    partmask = 0;                /* outside one or more trivial accept planes */
 
@@ -191,6 +195,10 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
       return;
    }
 
+   if (task->hiz.test &&
+       lp_rast_hiz_reject(task, &tri->inputs, x, y, TILE_SIZE))
+      return;
+
    outmask = 0;                 /* outside one or more trivial reject planes */
    partmask = 0;                /* outside one or more trivial accept planes */
 
@@ -345,6 +353,10 @@ TRI_16(struct lp_rasterizer_task *task,
    x += task->x;
    y += task->y;
 
+   if (task->hiz.test &&
+       lp_rast_hiz_reject(task, &tri->inputs, x, y, 16))
+      return;
+
    for (j = 0; j < NR_PLANES; j++) {
       const int dcdx = -plane[j].dcdx * 4;
       const int dcdy = plane[j].dcdy * 4;
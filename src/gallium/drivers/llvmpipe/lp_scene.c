@@ -31,9 +31,11 @@
 #include "util/u_inlines.h"
 #include "util/simple_list.h"
 #include "util/u_format.h"
+#include "util/u_atomic.h"
 #include "lp_scene.h"
 #include "lp_fence.h"
 #include "lp_debug.h"
+#include "lp_perf.h"
 
 
 #define RESOURCE_REF_SZ 32
@@ -62,8 +64,6 @@ lp_scene_create( struct pipe_context *pipe )
    scene->data.head =
       CALLOC_STRUCT(data_block);
 
-   pipe_mutex_init(scene->mutex);
-
 #ifdef DEBUG
    /* Do some scene limit sanity checks here */
    {
@@ -89,10 +89,17 @@ lp_scene_create( struct pipe_context *pipe )
 void
 lp_scene_destroy(struct lp_scene *scene)
 {
+   struct data_block *block, *next;
+
    lp_fence_reference(&scene->fence, NULL);
-   pipe_mutex_destroy(scene->mutex);
    assert(scene->data.head->next == NULL);
    FREE(scene->data.head);
+
+   for (block = scene->free_blocks; block; block = next) {
+      next = block->next;
+      FREE(block);
+   }
+
    FREE(scene);
 }
 
@@ -274,15 +281,40 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                       j, scene->resource_reference_size);
    }
 
-   /* Free all scene data blocks:
+   LP_COUNT_MAX(scene_peak_size, scene->scene_size);
+
+   /* Put the scene data blocks back into the scene's pool.  Keep enough
+    * for the larger of this use and the previous one, so that a scene
+    * drawing about the same every frame doesn't allocate anything, and
+    * give back what is beyond that.
     */
    {
       struct data_block_list *list = &scene->data;
       struct data_block *block, *tmp;
+      struct data_block **link;
+      unsigned num_blocks = 0, keep;
 
       for (block = list->head->next; block; block = tmp) {
          tmp = block->next;
-	 FREE(block);
+         block->next = scene->free_blocks;
+         scene->free_blocks = block;
+         scene->num_free_blocks++;
+         num_blocks++;
+      }
+
+      keep = MAX2(num_blocks, scene->prev_num_blocks);
+      scene->prev_num_blocks = num_blocks;
+
+      if (scene->num_free_blocks > keep) {
+         link = &scene->free_blocks;
+         while (keep--)
+            link = &(*link)->next;
+         for (block = *link; block; block = tmp) {
+            tmp = block->next;
+            FREE(block);
+            scene->num_free_blocks--;
+         }
+         *link = NULL;
       }
 
       list->head->next = NULL;
@@ -336,10 +368,19 @@ lp_scene_new_data_block( struct lp_scene *scene )
       return NULL;
    }
    else {
-      struct data_block *block = MALLOC_STRUCT(data_block);
-      if (!block)
-         return NULL;
-      
+      struct data_block *block = scene->free_blocks;
+
+      if (block) {
+         scene->free_blocks = block->next;
+         scene->num_free_blocks--;
+      }
+      else {
+         block = MALLOC_STRUCT(data_block);
+         if (!block)
+            return NULL;
+         LP_COUNT(nr_scene_block_allocs);
+      }
+
       scene->scene_size += sizeof *block;
 
       block->used = 0;
@@ -449,61 +490,82 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 
 
 
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
+static int
+compare_bin_cost(const void *a, const void *b)
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
-   }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
-   }
-   return TRUE;
+   const struct lp_bin_info *bin_a = (const struct lp_bin_info *) a;
+   const struct lp_bin_info *bin_b = (const struct lp_bin_info *) b;
+
+   if (bin_a->cost != bin_b->cost)
+      return bin_a->cost > bin_b->cost ? -1 : 1;
+
+   /* keep the raster order otherwise */
+   if (bin_a->y != bin_b->y)
+      return bin_a->y < bin_b->y ? -1 : 1;
+
+   return bin_a->x < bin_b->x ? -1 : (bin_a->x > bin_b->x);
 }
 
 
+/**
+ * Set up the order the bins get rasterized in.  Called by a single thread
+ * before the rasterizer threads start on the scene.
+ *
+ * Empty bins are left out, and the bins with the most commands go first so
+ * that the most expensive tiles don't end up last on a single thread.
+ */
 void
 lp_scene_bin_iter_begin( struct lp_scene *scene )
 {
-   scene->curr_x = scene->curr_y = -1;
+   unsigned x, y;
+   unsigned n = 0;
+
+   for (y = 0; y < scene->tiles_y; y++) {
+      for (x = 0; x < scene->tiles_x; x++) {
+         const struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
+         const struct cmd_block *block;
+         unsigned cost = 0;
+
+         if (bin->head == NULL)
+            continue;
+
+         for (block = bin->head; block; block = block->next)
+            cost += block->count;
+
+         scene->bin_order[n].cost = cost;
+         scene->bin_order[n].x = x;
+         scene->bin_order[n].y = y;
+         n++;
+      }
+   }
+
+   qsort(scene->bin_order, n, sizeof(scene->bin_order[0]), compare_bin_cost);
+
+   scene->num_bins = n;
+   scene->curr_bin = 0;
 }
 
 
 /**
  * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
  * Multiple rendering threads will call this function to get a chunk
  * of work (a bin) to work on.
  */
 struct cmd_bin *
 lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
 {
-   struct cmd_bin *bin = NULL;
-
-   pipe_mutex_lock(scene->mutex);
+   unsigned i = p_atomic_inc_return(&scene->curr_bin) - 1;
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   }
-   else if (!next_bin(scene)) {
+   if (i >= scene->num_bins) {
       /* no more bins left */
-      goto end;
+      return NULL;
    }
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
+   *x = scene->bin_order[i].x;
+   *y = scene->bin_order[i].y;
 
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   pipe_mutex_unlock(scene->mutex);
-   return bin;
+   /*printf("return bin %u at %d, %d\n", i, *x, *y);*/
+   return lp_scene_get_bin(scene, *x, *y);
 }
 
 
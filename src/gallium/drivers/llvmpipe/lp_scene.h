@@ -98,6 +98,15 @@ struct cmd_bin {
    struct cmd_block *head;
    struct cmd_block *tail;
 };
+
+
+/**
+ * Position and estimated rasterization cost of a bin.
+ */
+struct lp_bin_info {
+   unsigned cost;       /**< number of commands in the bin */
+   uint16_t x, y;
+};
    
 
 /**
@@ -173,11 +182,23 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
-   pipe_mutex mutex;
+   /** The non-empty bins, in the order they are handed out to the
+    * rasterizer threads.
+    */
+   struct lp_bin_info bin_order[TILES_X * TILES_Y];
+   unsigned num_bins;   /**< number of entries in bin_order */
+   int curr_bin;        /**< next entry of bin_order, atomically incremented */
 
    struct cmd_bin tile[TILES_X][TILES_Y];
    struct data_block_list data;
+
+   /**
+    * Data blocks kept from the last uses of the scene, and the number of
+    * blocks the previous use needed, see lp_scene_end_rasterization().
+    */
+   struct data_block *free_blocks;
+   unsigned num_free_blocks;
+   unsigned prev_num_blocks;
 };
 
 
@@ -210,7 +210,7 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_QUADS_FOLLOW_PROVOKING_VERTEX_CONVENTION:
       return 0;
    case PIPE_CAP_COMPUTE:
-      return 0;
+      return 1;
    case PIPE_CAP_USER_VERTEX_BUFFERS:
    case PIPE_CAP_USER_INDEX_BUFFERS:
       return 1;
@@ -356,9 +356,62 @@ llvmpipe_get_shader_param(struct pipe_screen *screen, unsigned shader, enum pipe
       default:
          return draw_get_shader_param(shader, param);
       }
+   case PIPE_SHADER_COMPUTE:
+      switch (param) {
+      case PIPE_SHADER_CAP_MAX_TEXTURE_SAMPLERS:
+      case PIPE_SHADER_CAP_MAX_SAMPLER_VIEWS:
+      case PIPE_SHADER_CAP_MAX_SHADER_IMAGES:
+         return 0;
+      case PIPE_SHADER_CAP_MAX_SHADER_BUFFERS:
+         return PIPE_MAX_SHADER_BUFFERS;
+      case PIPE_SHADER_CAP_PREFERRED_IR:
+         return PIPE_SHADER_IR_TGSI;
+      case PIPE_SHADER_CAP_SUPPORTED_IRS:
+         return 1 << PIPE_SHADER_IR_TGSI;
+      default:
+         return gallivm_get_shader_param(param);
+      }
+   default:
+      return 0;
+   }
+}
+
+static int
+llvmpipe_get_compute_param(struct pipe_screen *_screen,
+                           enum pipe_compute_cap param,
+                           void *ret)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
+
+#define RET(x) do {                  \
+   if (ret)                          \
+      memcpy(ret, x, sizeof(x));     \
+   return sizeof(x);                 \
+} while (0)
+
+   switch (param) {
+   case PIPE_COMPUTE_CAP_GRID_DIMENSION:
+      RET((uint64_t []) { 3 });
+   case PIPE_COMPUTE_CAP_MAX_GRID_SIZE:
+      RET(((uint64_t []) { 65535, 65535, 65535 }));
+   case PIPE_COMPUTE_CAP_MAX_BLOCK_SIZE:
+      RET(((uint64_t []) { 1024, 1024, 64 }));
+   case PIPE_COMPUTE_CAP_MAX_THREADS_PER_BLOCK:
+      RET((uint64_t []) { 1024 });
+   case PIPE_COMPUTE_CAP_MAX_LOCAL_SIZE:
+      RET((uint64_t []) { 32 << 10 });
+   case PIPE_COMPUTE_CAP_SUBGROUP_SIZE:
+      RET((uint32_t []) { lp_native_vector_width / 32 });
+   case PIPE_COMPUTE_CAP_IMAGES_SUPPORTED:
+      RET((uint32_t []) { 0 });
+   case PIPE_COMPUTE_CAP_MAX_COMPUTE_UNITS:
+      RET((uint32_t []) { MAX2(screen->num_threads, 1) });
    default:
+      /* No OpenCL, there is no IR_TARGET. */
       return 0;
    }
+
+#undef RET
 }
 
 static float
@@ -513,6 +566,19 @@ llvmpipe_flush_frontbuffer(struct pipe_screen *_screen,
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
    struct sw_winsys *winsys = screen->winsys;
    struct llvmpipe_resource *texture = llvmpipe_resource(resource);
+   struct lp_fence *fence = NULL;
+
+   /* Flushes don't wait for the rasterizer, so the scenes drawing to the
+    * display target may still be in flight.
+    */
+   pipe_mutex_lock(screen->rast_mutex);
+   lp_fence_reference(&fence, screen->last_fence);
+   pipe_mutex_unlock(screen->rast_mutex);
+
+   if (fence) {
+      lp_fence_wait(fence);
+      lp_fence_reference(&fence, NULL);
+   }
 
    assert(texture->dt);
    if (texture->dt)
@@ -528,12 +594,15 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
    if (screen->rast)
       lp_rast_destroy(screen->rast);
 
+   lp_fence_reference(&screen->last_fence, NULL);
+
    lp_jit_screen_cleanup(screen);
 
    if(winsys->destroy)
       winsys->destroy(winsys);
 
    pipe_mutex_destroy(screen->rast_mutex);
+   util_slab_destroy_parent(&screen->transfer_pool);
 
    FREE(screen);
 }
@@ -615,6 +684,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.get_param = llvmpipe_get_param;
    screen->base.get_shader_param = llvmpipe_get_shader_param;
    screen->base.get_paramf = llvmpipe_get_paramf;
+   screen->base.get_compute_param = llvmpipe_get_compute_param;
    screen->base.is_format_supported = llvmpipe_is_format_supported;
 
    screen->base.context_create = llvmpipe_create_context;
@@ -640,6 +710,8 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
       return NULL;
    }
    pipe_mutex_init(screen->rast_mutex);
+   util_slab_create_parent(&screen->transfer_pool,
+                           sizeof(struct llvmpipe_transfer), 64);
 
    util_format_s3tc_init();
 
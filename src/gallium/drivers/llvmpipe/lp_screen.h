@@ -37,10 +37,12 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
+#include "util/u_slab.h"
 #include "gallivm/lp_bld.h"
 
 
 struct sw_winsys;
+struct lp_fence;
 
 
 struct llvmpipe_screen
@@ -57,6 +59,12 @@ struct llvmpipe_screen
 
    struct lp_rasterizer *rast;
    pipe_mutex rast_mutex;
+
+   /** Fence of the last scene queued by any context, under rast_mutex */
+   struct lp_fence *last_fence;
+
+   /** Storage for llvmpipe_transfer objects */
+   struct util_slab_parent_pool transfer_pool;
 };
 
 
@@ -47,6 +47,7 @@
 #include "lp_texture.h"
 #include "lp_debug.h"
 #include "lp_fence.h"
+#include "lp_perf.h"
 #include "lp_query.h"
 #include "lp_rast.h"
 #include "lp_setup_context.h"
@@ -63,6 +64,35 @@ static boolean set_scene_state( struct lp_setup_context *, enum setup_state,
 static boolean try_update_scene_state( struct lp_setup_context *setup );
 
 
+/**
+ * Release the resources and memory of a scene handed to the rasterizer,
+ * once it is done with it.  The rasterizer never touches a scene after
+ * signalling its fence, so from then on the scene belongs to setup again.
+ *
+ * \return TRUE if the scene is empty now.
+ */
+static boolean
+lp_setup_retire_scene(struct lp_scene *scene, boolean wait)
+{
+   if (!scene->fence)
+      return TRUE;
+
+   if (!lp_fence_signalled(scene->fence)) {
+      if (!wait)
+         return FALSE;
+
+      if (LP_DEBUG & DEBUG_SETUP)
+         debug_printf("%s: wait for scene %d\n",
+                      __FUNCTION__, scene->fence->id);
+
+      lp_fence_wait(scene->fence);
+   }
+
+   lp_scene_end_rasterization(scene);
+   return TRUE;
+}
+
+
 static void
 lp_setup_get_empty_scene(struct lp_setup_context *setup)
 {
@@ -73,13 +103,7 @@ lp_setup_get_empty_scene(struct lp_setup_context *setup)
 
    setup->scene = setup->scenes[setup->scene_idx];
 
-   if (setup->scene->fence) {
-      if (LP_DEBUG & DEBUG_SETUP)
-         debug_printf("%s: wait for scene %d\n",
-                      __FUNCTION__, setup->scene->fence->id);
-
-      lp_fence_wait(setup->scene->fence);
-   }
+   lp_setup_retire_scene(setup->scene, TRUE);
 
    lp_scene_begin_binning(setup->scene, &setup->fb, setup->rasterizer_discard);
 
@@ -164,23 +188,16 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
    if (setup->last_fence)
       setup->last_fence->issued = TRUE;
 
-   pipe_mutex_lock(screen->rast_mutex);
-
-   /* FIXME: We enqueue the scene then wait on the rasterizer to finish.
-    * This means we never actually run any vertex stuff in parallel to
-    * rasterization (not in the same context at least) which is what the
-    * multiple scenes per setup is about - when we get a new empty scene
-    * any old one is already empty again because we waited here for
-    * raster tasks to be finished. Ideally, we shouldn't need to wait here
-    * and rely on fences elsewhere when waiting is necessary.
-    * Certainly, lp_scene_end_rasterization() would need to be deferred too
-    * and there's probably other bits why this doesn't actually work.
+   /* Don't wait for the rasterizer: the scene is retired when it comes
+    * around again in lp_setup_get_empty_scene(), and anything that needs
+    * the results waits on the fence.  This lets draw and setup work on
+    * the next scene while this one is rasterized.
     */
+   pipe_mutex_lock(screen->rast_mutex);
    lp_rast_queue_scene(screen->rast, scene);
-   lp_rast_finish(screen->rast);
+   lp_fence_reference(&screen->last_fence, scene->fence);
    pipe_mutex_unlock(screen->rast_mutex);
 
-   lp_scene_end_rasterization(setup->scene);
    lp_setup_reset( setup );
 
    LP_DBG(DEBUG_SETUP, "%s done \n", __FUNCTION__);
@@ -989,9 +1006,22 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
       return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
    }
 
-   /* check textures referenced by the scene */
+   /* check the scenes still in flight, along with the one being binned */
    for (i = 0; i < Elements(setup->scenes); i++) {
-      if (lp_scene_is_resource_referenced(setup->scenes[i], texture)) {
+      struct lp_scene *scene = setup->scenes[i];
+      unsigned j;
+
+      if (scene != setup->scene && lp_setup_retire_scene(scene, FALSE))
+         continue;
+
+      for (j = 0; j < scene->fb.nr_cbufs; j++) {
+         if (scene->fb.cbufs[j] && scene->fb.cbufs[j]->texture == texture)
+            return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+      }
+      if (scene->fb.zsbuf && scene->fb.zsbuf->texture == texture)
+         return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+
+      if (lp_scene_is_resource_referenced(scene, texture)) {
          return LP_REFERENCED_FOR_READ;
       }
    }
@@ -1141,6 +1171,11 @@ try_update_scene_state( struct lp_setup_context *setup )
 
 
    if (setup->dirty & LP_SETUP_NEW_FS) {
+      /* The variant may still be compiling, see generate_variant(). */
+      if (setup->fs.current.variant)
+         llvmpipe_fs_variant_finish(llvmpipe_context(setup->pipe),
+                                    setup->fs.current.variant);
+
       if (!setup->fs.stored ||
           memcmp(setup->fs.stored,
                  &setup->fs.current,
@@ -1295,9 +1330,7 @@ lp_setup_destroy( struct lp_setup_context *setup )
    for (i = 0; i < Elements(setup->scenes); i++) {
       struct lp_scene *scene = setup->scenes[i];
 
-      if (scene->fence)
-         lp_fence_wait(scene->fence);
-
+      lp_setup_retire_scene(scene, TRUE);
       lp_scene_destroy(scene);
    }
 
@@ -1495,6 +1528,8 @@ lp_setup_flush_and_restart(struct lp_setup_context *setup)
 
    assert(setup->state == SETUP_ACTIVE);
 
+   LP_COUNT(nr_scene_oom_flushes);
+
    if (!set_scene_state(setup, SETUP_FLUSHED, __FUNCTION__))
       return FALSE;
    
@@ -54,9 +54,12 @@
 struct lp_setup_variant;
 
 
-/** Max number of scenes */
-/* XXX: make multiple scenes per context work, see lp_setup_rasterize_scene */
-#define MAX_SCENES 1
+/**
+ * Max number of scenes.  Flushing a scene only queues it, so with three
+ * scenes setup can bin one while another is rasterized and a third waits in
+ * the queue.
+ */
+#define MAX_SCENES 3
 
 
 
@@ -749,6 +749,63 @@ floor_pot(uint32_t n)
 }
 
 
+/**
+ * Bin a 3-plane triangle contained in a single 4x4 stamp.
+ *
+ * Dense meshes produce long runs of these in the same tile, so rather
+ * than one command each, consecutive ones binned with the same state are
+ * merged into a single LP_RAST_OP_TRIANGLE_32_3_4_BATCH command.  This
+ * keeps the command stream short and lets the rasterizer evaluate the
+ * edge functions of the whole run back to back.
+ */
+static boolean
+bin_triangle_32_3_4(struct lp_setup_context *setup,
+                    struct lp_rast_triangle *tri,
+                    int ix0, int iy0,
+                    unsigned px, unsigned py)
+{
+   struct lp_scene *scene = setup->scene;
+   struct cmd_bin *bin = lp_scene_get_bin(scene, ix0, iy0);
+   struct cmd_block *tail = bin->tail;
+
+   if (tail && tail->count &&
+       bin->last_state == setup->fs.stored) {
+      unsigned last = tail->count - 1;
+      struct lp_rast_tri_batch *batch = NULL;
+
+      if (tail->cmd[last] == LP_RAST_OP_TRIANGLE_32_3_4_BATCH) {
+         /* The batch was allocated by us in the scene data, below */
+         batch = (struct lp_rast_tri_batch *)tail->arg[last].tri_batch;
+         if (batch->count == LP_RAST_TRI_BATCH_MAX)
+            batch = NULL;
+      }
+      else if (tail->cmd[last] == LP_RAST_OP_TRIANGLE_32_3_4) {
+         batch = lp_scene_alloc(scene, sizeof *batch);
+         if (batch) {
+            batch->count = 1;
+            batch->tri[0] = tail->arg[last].triangle.tri;
+            batch->pos[0] = tail->arg[last].triangle.plane_mask;
+            tail->cmd[last] = LP_RAST_OP_TRIANGLE_32_3_4_BATCH;
+            tail->arg[last] = lp_rast_arg_tri_batch(batch);
+         }
+      }
+
+      if (batch) {
+         batch->tri[batch->count] = tri;
+         batch->pos[batch->count] = px | (py << 8);
+         batch->count++;
+         LP_COUNT(nr_batched_tris);
+         return TRUE;
+      }
+   }
+
+   return lp_scene_bin_cmd_with_state( scene, ix0, iy0,
+                                       setup->fs.stored,
+                                       LP_RAST_OP_TRIANGLE_32_3_4,
+                                       lp_rast_arg_triangle_contained(tri, px, py) );
+}
+
+
 boolean
 lp_setup_bin_triangle( struct lp_setup_context *setup,
                        struct lp_rast_triangle *tri,
@@ -799,10 +856,11 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
              */
             assert(px + 4 <= TILE_SIZE);
             assert(py + 4 <= TILE_SIZE);
+            if (use_32bits)
+               return bin_triangle_32_3_4(setup, tri, ix0, iy0, px, py);
+
             return lp_scene_bin_cmd_with_state( scene, ix0, iy0,
                                                 setup->fs.stored,
-                                                use_32bits ?
-                                                LP_RAST_OP_TRIANGLE_32_3_4 :
                                                 LP_RAST_OP_TRIANGLE_3_4,
                                                 lp_rast_arg_triangle_contained(tri, px, py) );
          }
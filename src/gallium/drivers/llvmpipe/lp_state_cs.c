@@ -0,0 +1,524 @@
+/**************************************************************************
+ * 
+ * Copyright 2016 VMware, Inc.
+ * All Rights Reserved.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Compute shaders.
+ *
+ * A compute shader is compiled into a single function which runs every
+ * invocation of one workgroup, a SoA vector at a time.  Workgroups are
+ * spread over the compute thread pool, see lp_cs_tpool.h, and
+ * llvmpipe_launch_grid() returns once they have all run.
+ */
+
+#include "pipe/p_defines.h"
+#include "util/u_memory.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_string.h"
+#include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_logic.h"
+#include "gallivm/lp_bld_tgsi.h"
+#include "gallivm/lp_bld_type.h"
+
+#include "lp_context.h"
+#include "lp_cs_tpool.h"
+#include "lp_debug.h"
+#include "lp_flush.h"
+#include "lp_screen.h"
+#include "lp_state.h"
+#include "lp_state_cs.h"
+#include "lp_texture.h"
+
+
+static unsigned cs_no = 0;
+
+
+/**
+ * Whether the shader only uses things generate_compute() can translate.
+ */
+static boolean
+cs_is_supported(const struct tgsi_shader_info *info)
+{
+   unsigned i;
+
+   if (info->file_count[TGSI_FILE_SAMPLER] ||
+       info->file_count[TGSI_FILE_SAMPLER_VIEW] ||
+       info->file_count[TGSI_FILE_IMAGE])
+      return FALSE;
+
+   for (i = TGSI_OPCODE_ATOMUADD; i <= TGSI_OPCODE_ATOMIMAX; i++) {
+      if (info->opcode_count[i])
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+static void
+generate_compute(struct llvmpipe_context *lp,
+                 struct lp_compute_shader *cs)
+{
+   struct gallivm_state *gallivm = cs->gallivm;
+   LLVMContextRef lc = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(lc);
+   LLVMTypeRef arg_types[13];
+   LLVMTypeRef func_type;
+   LLVMValueRef function;
+   LLVMValueRef context_ptr, shared_ptr, shared_size;
+   LLVMValueRef block_id[3], grid_size[3], block_size[3];
+   LLVMValueRef consts_ptr, num_consts_ptr;
+   LLVMValueRef num_invocations, lane_ids;
+   LLVMBasicBlockRef block;
+   struct lp_type cs_type;
+   struct lp_build_context uint_bld;
+   struct lp_build_loop_state loop_state;
+   struct lp_bld_tgsi_system_values system_values;
+   struct lp_build_tgsi_cs_iface cs_iface;
+   char func_name[64];
+   unsigned i;
+
+   memset(&cs_type, 0, sizeof cs_type);
+   cs_type.floating = TRUE;      /* floating point values */
+   cs_type.sign = TRUE;          /* values are signed */
+   cs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
+   cs_type.width = 32;           /* 32-bit float */
+   cs_type.length = lp_native_vector_width / 32;
+
+   util_snprintf(func_name, sizeof(func_name), "cs%u", cs->no);
+
+   arg_types[0] = cs->jit_context_ptr_type;             /* context */
+   for (i = 1; i < 10; i++)
+      arg_types[i] = int32_type;                        /* block id, grid, block size */
+   arg_types[10] = LLVMPointerType(int32_type, 0);      /* shared_mem */
+   arg_types[11] = int32_type;                          /* shared_size */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(lc),
+                                arg_types, 12, 0);
+
+   function = LLVMAddFunction(gallivm->module, func_name, func_type);
+   LLVMSetFunctionCallConv(function, LLVMCCallConv);
+
+   cs->function = function;
+
+   for (i = 0; i < 12; ++i)
+      if (LLVMGetTypeKind(arg_types[i]) == LLVMPointerTypeKind)
+         LLVMAddAttribute(LLVMGetParam(function, i), LLVMNoAliasAttribute);
+
+   context_ptr = LLVMGetParam(function, 0);
+   for (i = 0; i < 3; i++) {
+      block_id[i] = LLVMGetParam(function, 1 + i);
+      grid_size[i] = LLVMGetParam(function, 4 + i);
+      block_size[i] = LLVMGetParam(function, 7 + i);
+      lp_build_name(block_id[i], "block_id.%c", "xyz"[i]);
+      lp_build_name(grid_size[i], "grid_size.%c", "xyz"[i]);
+      lp_build_name(block_size[i], "block_size.%c", "xyz"[i]);
+   }
+   shared_ptr = LLVMGetParam(function, 10);
+   shared_size = LLVMGetParam(function, 11);
+
+   lp_build_name(context_ptr, "context");
+   lp_build_name(shared_ptr, "shared_mem");
+   lp_build_name(shared_size, "shared_size");
+
+   /*
+    * Function body
+    */
+
+   block = LLVMAppendBasicBlockInContext(lc, function, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_context_init(&uint_bld, gallivm, lp_uint_type(cs_type));
+
+   consts_ptr = lp_jit_cs_context_constants(gallivm, context_ptr);
+   num_consts_ptr = lp_jit_cs_context_num_constants(gallivm, context_ptr);
+
+   memset(&cs_iface, 0, sizeof cs_iface);
+   cs_iface.ssbo_ptr = lp_jit_cs_context_ssbos(gallivm, context_ptr);
+   cs_iface.ssbo_sizes_ptr = lp_jit_cs_context_ssbo_sizes(gallivm, context_ptr);
+   cs_iface.shared_ptr = shared_ptr;
+   cs_iface.shared_size = shared_size;
+
+   memset(&system_values, 0, sizeof system_values);
+   for (i = 0; i < 3; i++) {
+      system_values.block_id[i] = block_id[i];
+      system_values.grid_size[i] = grid_size[i];
+      system_values.block_size[i] = block_size[i];
+   }
+
+   num_invocations = LLVMBuildMul(builder, block_size[0], block_size[1], "");
+   num_invocations = LLVMBuildMul(builder, num_invocations, block_size[2],
+                                  "num_invocations");
+
+   {
+      LLVMValueRef elems[LP_MAX_VECTOR_LENGTH];
+      for (i = 0; i < cs_type.length; i++)
+         elems[i] = lp_build_const_int32(gallivm, i);
+      lane_ids = LLVMConstVector(elems, cs_type.length);
+   }
+
+   /*
+    * Loop over the invocations of the workgroup, x varying fastest.
+    */
+   lp_build_loop_begin(&loop_state, gallivm, lp_build_const_int32(gallivm, 0));
+   {
+      struct lp_build_mask_context mask;
+      LLVMValueRef tid, tid_yz, mask_val, size_x, size_y;
+
+      tid = lp_build_broadcast_scalar(&uint_bld, loop_state.counter);
+      tid = LLVMBuildAdd(builder, tid, lane_ids, "tid");
+
+      mask_val = lp_build_cmp(&uint_bld, PIPE_FUNC_LESS, tid,
+                              lp_build_broadcast_scalar(&uint_bld,
+                                                        num_invocations));
+
+      size_x = lp_build_broadcast_scalar(&uint_bld, block_size[0]);
+      size_y = lp_build_broadcast_scalar(&uint_bld, block_size[1]);
+      system_values.thread_id[0] = LLVMBuildURem(builder, tid, size_x, "");
+      tid_yz = LLVMBuildUDiv(builder, tid, size_x, "");
+      system_values.thread_id[1] = LLVMBuildURem(builder, tid_yz, size_y, "");
+      system_values.thread_id[2] = LLVMBuildUDiv(builder, tid_yz, size_y, "");
+
+      lp_build_mask_begin(&mask, gallivm, cs_type, mask_val);
+
+      lp_build_tgsi_soa(gallivm, cs->tokens, cs_type, &mask,
+                        consts_ptr, num_consts_ptr, &system_values,
+                        NULL, NULL, context_ptr, NULL,
+                        NULL, &cs->info, NULL, &cs_iface);
+
+      lp_build_mask_end(&mask);
+   }
+   lp_build_loop_end_cond(&loop_state, num_invocations,
+                          lp_build_const_int32(gallivm, cs_type.length),
+                          LLVMIntUGE);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, function);
+}
+
+
+static void *
+llvmpipe_create_compute_state(struct pipe_context *pipe,
+                              const struct pipe_compute_state *templ)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct lp_compute_shader *cs;
+   char module_name[64];
+
+   cs = CALLOC_STRUCT(lp_compute_shader);
+   if (!cs)
+      return NULL;
+
+   cs->tokens = tgsi_dup_tokens(templ->prog);
+   if (!cs->tokens) {
+      FREE(cs);
+      return NULL;
+   }
+
+   cs->no = cs_no++;
+   cs->req_local_mem = templ->req_local_mem;
+
+   tgsi_scan_shader(cs->tokens, &cs->info);
+   cs->uses_barrier = cs->info.opcode_count[TGSI_OPCODE_BARRIER] > 0;
+
+   if (LP_DEBUG & DEBUG_TGSI) {
+      debug_printf("llvmpipe: Create compute shader %p:\n", (void *) cs);
+      tgsi_dump(cs->tokens, 0);
+   }
+
+   if (!cs_is_supported(&cs->info)) {
+      debug_printf("llvmpipe: compute shaders using samplers, images or "
+                   "atomics are not supported\n");
+      return cs;
+   }
+
+   util_snprintf(module_name, sizeof(module_name), "cs%u", cs->no);
+
+   cs->gallivm = gallivm_create(module_name, llvmpipe->context);
+   if (!cs->gallivm) {
+      FREE((void *) cs->tokens);
+      FREE(cs);
+      return NULL;
+   }
+
+   lp_jit_init_cs_types(cs);
+
+   generate_compute(llvmpipe, cs);
+
+   gallivm_compile_module(cs->gallivm);
+
+   cs->jit_function = (lp_jit_cs_func)
+         gallivm_jit_function(cs->gallivm, cs->function);
+
+   gallivm_free_ir(cs->gallivm);
+
+   return cs;
+}
+
+
+static void
+llvmpipe_bind_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+
+   llvmpipe->cs = (struct lp_compute_shader *) cs;
+}
+
+
+static void
+llvmpipe_delete_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct lp_compute_shader *shader = (struct lp_compute_shader *) cs;
+
+   if (!shader)
+      return;
+
+   if (shader->gallivm)
+      gallivm_destroy(shader->gallivm);
+
+   FREE((void *) shader->tokens);
+   FREE(shader);
+}
+
+
+static void
+llvmpipe_set_shader_buffers(struct pipe_context *pipe, unsigned shader,
+                            unsigned start_slot, unsigned count,
+                            struct pipe_shader_buffer *buffers)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   /* Only compute shaders can access buffers. */
+   if (shader != PIPE_SHADER_COMPUTE)
+      return;
+
+   assert(start_slot + count <= Elements(llvmpipe->ssbos));
+
+   for (i = 0; i < count; i++) {
+      struct pipe_shader_buffer *dst = &llvmpipe->ssbos[start_slot + i];
+
+      if (buffers && buffers[i].buffer) {
+         pipe_resource_reference(&dst->buffer, buffers[i].buffer);
+         dst->buffer_offset = buffers[i].buffer_offset;
+         dst->buffer_size = buffers[i].buffer_size;
+      } else {
+         pipe_resource_reference(&dst->buffer, NULL);
+         dst->buffer_offset = 0;
+         dst->buffer_size = 0;
+      }
+   }
+}
+
+
+/**
+ * Point the jit context at the current constant and shader buffers.
+ */
+static void
+cs_update_jit_context(struct llvmpipe_context *llvmpipe,
+                      struct lp_jit_cs_context *jit_context)
+{
+   /* The shader can't handle NULL pointers, see lp_setup_update_state(). */
+   static const float fake_const_buf[4];
+   static uint32_t fake_ssbo[4];
+   unsigned i;
+
+   for (i = 0; i < LP_MAX_TGSI_CONST_BUFFERS; ++i) {
+      const struct pipe_constant_buffer *cb =
+         &llvmpipe->constants[PIPE_SHADER_COMPUTE][i];
+      const unsigned size = MIN2(cb->buffer_size,
+                                 LP_MAX_TGSI_CONST_BUFFER_SIZE);
+      const ubyte *data = NULL;
+
+      if (cb->buffer) {
+         data = (const ubyte *) llvmpipe_resource_data(cb->buffer);
+      }
+      else if (cb->user_buffer) {
+         data = (const ubyte *) cb->user_buffer;
+      }
+
+      if (data) {
+         jit_context->constants[i] =
+            (const float *) (data + cb->buffer_offset);
+         jit_context->num_constants[i] = size / (sizeof(float) * 4);
+      }
+      else {
+         jit_context->constants[i] = fake_const_buf;
+         jit_context->num_constants[i] = 0;
+      }
+   }
+
+   for (i = 0; i < PIPE_MAX_SHADER_BUFFERS; ++i) {
+      const struct pipe_shader_buffer *sb = &llvmpipe->ssbos[i];
+
+      if (sb->buffer) {
+         ubyte *data = (ubyte *) llvmpipe_resource_data(sb->buffer);
+
+         /* A queued scene may still read the buffer, as a texture buffer. */
+         llvmpipe_flush_resource(&llvmpipe->pipe, sb->buffer, 0,
+                                 FALSE, TRUE, FALSE, "compute");
+
+         jit_context->ssbos[i] = (uint32_t *) (data + sb->buffer_offset);
+         jit_context->ssbo_sizes[i] =
+            MIN2(sb->buffer_size, sb->buffer->width0 - sb->buffer_offset);
+      }
+      else {
+         jit_context->ssbos[i] = fake_ssbo;
+         jit_context->ssbo_sizes[i] = 0;
+      }
+   }
+}
+
+
+struct lp_cs_job {
+   const struct lp_compute_shader *cs;
+   struct lp_jit_cs_context jit_context;
+   unsigned grid[3];
+   unsigned block[3];
+
+   /** Slice of the grid being run */
+   unsigned z;
+
+   /** One shared memory block of shared_stride bytes per thread */
+   uint8_t *shared_mem;
+   unsigned shared_stride;
+};
+
+
+static void
+cs_run_workgroup(void *data, unsigned iter, unsigned thread_idx)
+{
+   struct lp_cs_job *job = (struct lp_cs_job *) data;
+
+   job->cs->jit_function(&job->jit_context,
+                         iter % job->grid[0], iter / job->grid[0], job->z,
+                         job->grid[0], job->grid[1], job->grid[2],
+                         job->block[0], job->block[1], job->block[2],
+                         job->shared_mem + thread_idx * job->shared_stride,
+                         job->cs->req_local_mem);
+}
+
+
+static void
+llvmpipe_launch_grid(struct pipe_context *pipe,
+                     const struct pipe_grid_info *info)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   const struct lp_compute_shader *cs = llvmpipe->cs;
+   struct lp_cs_job job;
+   unsigned num_threads;
+   unsigned z;
+
+   if (!cs || !cs->jit_function)
+      return;
+
+   if (info->indirect) {
+      const ubyte *data;
+
+      llvmpipe_flush_resource(pipe, info->indirect, 0,
+                              TRUE, TRUE, FALSE, "compute indirect");
+      data = (const ubyte *) llvmpipe_resource_data(info->indirect);
+      memcpy(job.grid, data + info->indirect_offset, sizeof job.grid);
+   }
+   else {
+      memcpy(job.grid, info->grid, sizeof job.grid);
+   }
+   memcpy(job.block, info->block, sizeof job.block);
+
+   if (!job.grid[0] || !job.grid[1] || !job.grid[2] ||
+       !job.block[0] || !job.block[1] || !job.block[2])
+      return;
+
+   /*
+    * Invocations of a workgroup run one after another, a vector at a time,
+    * so BARRIER can only be honored if they all fit in a single vector.
+    */
+   if (cs->uses_barrier &&
+       job.block[0] * job.block[1] * job.block[2] > lp_native_vector_width / 32) {
+      debug_printf("llvmpipe: compute shaders with barriers are limited to "
+                   "%u invocations per workgroup\n",
+                   lp_native_vector_width / 32);
+      return;
+   }
+
+   if (!llvmpipe->cs_tpool && screen->num_threads)
+      llvmpipe->cs_tpool = lp_cs_tpool_create(screen->num_threads);
+
+   num_threads = llvmpipe->cs_tpool ? llvmpipe->cs_tpool->num_threads : 1;
+
+   job.cs = cs;
+   cs_update_jit_context(llvmpipe, &job.jit_context);
+
+   /* Keep the pointer valid even without shared memory, for masked loads. */
+   job.shared_stride = align(MAX2(cs->req_local_mem, 16), 16);
+   job.shared_mem = align_malloc(num_threads * job.shared_stride, 16);
+   if (!job.shared_mem)
+      return;
+
+   /* One slice at a time, so that the workgroup count fits in 32 bits. */
+   for (z = 0; z < job.grid[2]; z++) {
+      job.z = z;
+      lp_cs_tpool_run(llvmpipe->cs_tpool, cs_run_workgroup, &job,
+                      job.grid[0] * job.grid[1]);
+   }
+
+   align_free(job.shared_mem);
+}
+
+
+void
+llvmpipe_cleanup_compute(struct llvmpipe_context *llvmpipe)
+{
+   unsigned i;
+
+   for (i = 0; i < Elements(llvmpipe->ssbos); i++)
+      pipe_resource_reference(&llvmpipe->ssbos[i].buffer, NULL);
+
+   lp_cs_tpool_destroy(llvmpipe->cs_tpool);
+   llvmpipe->cs_tpool = NULL;
+}
+
+
+void
+llvmpipe_init_compute_funcs(struct llvmpipe_context *llvmpipe)
+{
+   llvmpipe->pipe.create_compute_state = llvmpipe_create_compute_state;
+   llvmpipe->pipe.bind_compute_state = llvmpipe_bind_compute_state;
+   llvmpipe->pipe.delete_compute_state = llvmpipe_delete_compute_state;
+   llvmpipe->pipe.set_shader_buffers = llvmpipe_set_shader_buffers;
+   llvmpipe->pipe.launch_grid = llvmpipe_launch_grid;
+}
@@ -106,6 +106,19 @@
 /** Fragment shader number (for debugging) */
 static unsigned fs_no = 0;
 
+DEBUG_GET_ONCE_BOOL_OPTION(lp_precompile_fs, "LP_PRECOMPILE_FS", FALSE)
+
+
+static void
+make_variant_key(struct llvmpipe_context *lp,
+                 struct lp_fragment_shader *shader,
+                 struct lp_fragment_shader_variant_key *key);
+
+static struct lp_fragment_shader_variant *
+create_variant(struct llvmpipe_context *lp,
+               struct lp_fragment_shader *shader,
+               const struct lp_fragment_shader_variant_key *key);
+
 
 /**
  * Expand the relevant bits of mask_input to a n*4-dword mask for the
@@ -422,7 +435,7 @@ generate_fs_loop(struct gallivm_state *gallivm,
                      consts_ptr, num_consts_ptr, &system_values,
                      interp->inputs,
                      outputs, context_ptr, thread_data_ptr,
-                     sampler, &shader->info.base, NULL);
+                     sampler, &shader->info.base, NULL, NULL);
 
    /* Alpha test */
    if (key->alpha.enabled) {
@@ -2569,7 +2582,12 @@ generate_variant(struct llvmpipe_context *lp,
    util_snprintf(module_name, sizeof(module_name), "fs%u_variant%u",
                  shader->no, shader->variants_created);
 
-   variant->gallivm = gallivm_create(module_name, lp->context);
+   /* With compile threads, give the variant its own LLVMContext so that it
+    * can be compiled in the background.
+    */
+   variant->gallivm = gallivm_create(module_name,
+                                     gallivm_can_compile_async() ?
+                                     NULL : lp->context);
    if (!variant->gallivm) {
       FREE(variant);
       return NULL;
@@ -2629,9 +2647,31 @@ generate_variant(struct llvmpipe_context *lp,
     * Compile everything
     */
 
-   gallivm_compile_module(variant->gallivm);
+   gallivm_compile_module_async(variant->gallivm);
+   variant->pending = TRUE;
+
+   if (!variant->gallivm->context_owned)
+      llvmpipe_fs_variant_finish(lp, variant);
+
+   return variant;
+}
+
+
+/**
+ * Get the code of a variant from generate_variant(), waiting for its
+ * compile if that went to a gallivm compile thread.  Done at the last
+ * moment, when the rasterization state is set up for a scene, so the
+ * compile overlaps with whatever happens in between, such as generating
+ * the setup and draw variants and running the vertex shader.
+ */
+void
+llvmpipe_fs_variant_finish(struct llvmpipe_context *lp,
+                           struct lp_fragment_shader_variant *variant)
+{
+   unsigned nr_instrs;
 
-   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+   if (!variant->pending)
+      return;
 
    if (variant->function[RAST_EDGE_TEST]) {
       variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
@@ -2647,9 +2687,13 @@ generate_variant(struct llvmpipe_context *lp,
       variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
    }
 
+   nr_instrs = lp_build_count_ir_module(variant->gallivm->module);
+   variant->nr_instrs += nr_instrs;
+   lp->nr_fs_instrs += nr_instrs;
+
    gallivm_free_ir(variant->gallivm);
 
-   return variant;
+   variant->pending = FALSE;
 }
 
 
@@ -2745,6 +2789,23 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
       debug_printf("\n");
    }
 
+   /* With LP_PRECOMPILE_FS, start compiling the variant for the currently
+    * bound state in the background, as the shader is likely to be drawn
+    * with it.  Not if that would cull variants, which may still be bound.
+    */
+   if (debug_get_option_lp_precompile_fs() &&
+       gallivm_can_compile_async() &&
+       llvmpipe->rasterizer &&
+       llvmpipe->depth_stencil &&
+       llvmpipe->blend &&
+       llvmpipe->nr_fs_variants < LP_MAX_SHADER_VARIANTS &&
+       llvmpipe->nr_fs_instrs < LP_MAX_SHADER_INSTRUCTIONS) {
+      struct lp_fragment_shader_variant_key key;
+
+      make_variant_key(llvmpipe, shader, &key);
+      create_variant(llvmpipe, shader, &key);
+   }
+
    return shader;
 }
 
@@ -3071,6 +3132,8 @@ make_variant_key(struct llvmpipe_context *lp,
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER_VIEW] & (1 << i)) {
             lp_sampler_static_texture_state(&key->state[i].texture_state,
                                             lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            key->state[i].texture_state.block_cache =
+               lp_sampler_view_use_block_cache(lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
          }
       }
    }
@@ -3080,6 +3143,8 @@ make_variant_key(struct llvmpipe_context *lp,
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
             lp_sampler_static_texture_state(&key->state[i].texture_state,
                                             lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            key->state[i].texture_state.block_cache =
+               lp_sampler_view_use_block_cache(lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
          }
       }
    }
@@ -3087,6 +3152,83 @@ make_variant_key(struct llvmpipe_context *lp,
 
 
 
+/**
+ * Generate a new variant of \p shader and add it to the variant lists,
+ * culling the least recently used variants first if there are too many.
+ */
+static struct lp_fragment_shader_variant *
+create_variant(struct llvmpipe_context *lp,
+               struct lp_fragment_shader *shader,
+               const struct lp_fragment_shader_variant_key *key)
+{
+   struct lp_fragment_shader_variant *variant;
+   int64_t t0, t1, dt;
+   unsigned i;
+   unsigned variants_to_cull;
+
+   if (0) {
+      debug_printf("%u variants,\t%u instrs,\t%u instrs/variant\n",
+                   lp->nr_fs_variants,
+                   lp->nr_fs_instrs,
+                   lp->nr_fs_variants ? lp->nr_fs_instrs / lp->nr_fs_variants : 0);
+   }
+
+   /* First, check if we've exceeded the max number of shader variants.
+    * If so, free 25% of them (the least recently used ones).
+    */
+   variants_to_cull = lp->nr_fs_variants >= LP_MAX_SHADER_VARIANTS ? LP_MAX_SHADER_VARIANTS / 4 : 0;
+
+   if (variants_to_cull ||
+       lp->nr_fs_instrs >= LP_MAX_SHADER_INSTRUCTIONS) {
+      struct pipe_context *pipe = &lp->pipe;
+
+      /*
+       * XXX: we need to flush the context until we have some sort of
+       * reference counting in fragment shaders as they may still be binned
+       * Flushing alone might not be sufficient we need to wait on it too.
+       */
+      llvmpipe_finish(pipe, __FUNCTION__);
+
+      /*
+       * We need to re-check lp->nr_fs_variants because an arbitrarliy large
+       * number of shader variants (potentially all of them) could be
+       * pending for destruction on flush.
+       */
+
+      for (i = 0; i < variants_to_cull || lp->nr_fs_instrs >= LP_MAX_SHADER_INSTRUCTIONS; i++) {
+         struct lp_fs_variant_list_item *item;
+         if (is_empty_list(&lp->fs_variants_list)) {
+            break;
+         }
+         item = last_elem(&lp->fs_variants_list);
+         assert(item);
+         assert(item->base);
+         llvmpipe_remove_shader_variant(lp, item->base);
+      }
+   }
+
+   /*
+    * Generate the new variant.
+    */
+   t0 = os_time_get();
+   variant = generate_variant(lp, shader, key);
+   t1 = os_time_get();
+   dt = t1 - t0;
+   LP_COUNT_ADD(llvm_compile_time, dt);
+   LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
+
+   /* Put the new variant into the list */
+   if (variant) {
+      insert_at_head(&shader->variants, &variant->list_item_local);
+      insert_at_head(&lp->fs_variants_list, &variant->list_item_global);
+      lp->nr_fs_variants++;
+      shader->variants_cached++;
+   }
+
+   return variant;
+}
+
+
 /**
  * Update fragment shader state.  This is called just prior to drawing
  * something when some fragment-related state has changed.
@@ -3119,69 +3261,7 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
    }
    else {
       /* variant not found, create it now */
-      int64_t t0, t1, dt;
-      unsigned i;
-      unsigned variants_to_cull;
-
-      if (0) {
-         debug_printf("%u variants,\t%u instrs,\t%u instrs/variant\n",
-                      lp->nr_fs_variants,
-                      lp->nr_fs_instrs,
-                      lp->nr_fs_variants ? lp->nr_fs_instrs / lp->nr_fs_variants : 0);
-      }
-
-      /* First, check if we've exceeded the max number of shader variants.
-       * If so, free 25% of them (the least recently used ones).
-       */
-      variants_to_cull = lp->nr_fs_variants >= LP_MAX_SHADER_VARIANTS ? LP_MAX_SHADER_VARIANTS / 4 : 0;
-
-      if (variants_to_cull ||
-          lp->nr_fs_instrs >= LP_MAX_SHADER_INSTRUCTIONS) {
-         struct pipe_context *pipe = &lp->pipe;
-
-         /*
-          * XXX: we need to flush the context until we have some sort of
-          * reference counting in fragment shaders as they may still be binned
-          * Flushing alone might not be sufficient we need to wait on it too.
-          */
-         llvmpipe_finish(pipe, __FUNCTION__);
-
-         /*
-          * We need to re-check lp->nr_fs_variants because an arbitrarliy large
-          * number of shader variants (potentially all of them) could be
-          * pending for destruction on flush.
-          */
-
-         for (i = 0; i < variants_to_cull || lp->nr_fs_instrs >= LP_MAX_SHADER_INSTRUCTIONS; i++) {
-            struct lp_fs_variant_list_item *item;
-            if (is_empty_list(&lp->fs_variants_list)) {
-               break;
-            }
-            item = last_elem(&lp->fs_variants_list);
-            assert(item);
-            assert(item->base);
-            llvmpipe_remove_shader_variant(lp, item->base);
-         }
-      }
-
-      /*
-       * Generate the new variant.
-       */
-      t0 = os_time_get();
-      variant = generate_variant(lp, shader, &key);
-      t1 = os_time_get();
-      dt = t1 - t0;
-      LP_COUNT_ADD(llvm_compile_time, dt);
-      LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
-
-      /* Put the new variant into the list */
-      if (variant) {
-         insert_at_head(&shader->variants, &variant->list_item_local);
-         insert_at_head(&lp->fs_variants_list, &variant->list_item_global);
-         lp->nr_fs_variants++;
-         lp->nr_fs_instrs += variant->nr_instrs;
-         shader->variants_cached++;
-      }
+      variant = create_variant(lp, shader, &key);
    }
 
    /* Bind this variant */
@@ -110,6 +110,9 @@ struct lp_fragment_shader_variant
 
    lp_jit_frag_func jit_function[2];
 
+   /* Still being compiled, see llvmpipe_fs_variant_finish() */
+   boolean pending;
+
    /* Total number of LLVM instructions generated */
    unsigned nr_instrs;
 
@@ -150,6 +153,10 @@ void
 llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                                struct lp_fragment_shader_variant *variant);
 
+void
+llvmpipe_fs_variant_finish(struct llvmpipe_context *lp,
+                           struct lp_fragment_shader_variant *variant);
+
 boolean
 llvmpipe_rasterization_disabled(struct llvmpipe_context *lp);
 
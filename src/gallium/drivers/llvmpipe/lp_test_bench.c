@@ -0,0 +1,521 @@
+/**************************************************************************
+ *
+ * Copyright 2016 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Microbenchmarks for gallivm building blocks.
+ *
+ * Each kernel is JIT compiled into a loop which streams over a buffer much
+ * larger than the caches, once for every vector width up to
+ * lp_native_vector_width.  The best of several runs is reported in
+ * nanoseconds per pixel, together with the CPU features in use, so that
+ * code generation changes can be compared across machines.
+ *
+ * Setting LP_NATIVE_VECTOR_WIDTH=128 also disables AVX code generation, so
+ * the SSE and AVX paths can be compared on the same machine.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "util/u_memory.h"
+#include "util/u_math.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_format.h"
+#include "os/os_time.h"
+
+#include "gallivm/lp_bld.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_type.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_arit.h"
+#include "gallivm/lp_bld_conv.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_format.h"
+#include "gallivm/lp_bld_struct.h"
+#include "lp_bld_blend.h"
+#include "lp_test.h"
+
+
+/** Number of pixels each kernel streams over per run */
+#define BENCH_NUM_PIXELS (1 << 18)
+
+/** Worst case bytes per pixel of any kernel's source or destination */
+#define BENCH_MAX_PIXEL_BYTES 16
+
+/** Number of timed runs per kernel in test_all() */
+#define BENCH_DEFAULT_RUNS 20
+
+
+typedef void (*bench_func_t)(void *dst, const void *src, int32_t count);
+
+
+/**
+ * Builds the body of one loop iteration.
+ *
+ * \param dst  destination pointer (i8 *)
+ * \param src  source pointer (i8 *)
+ * \param i    loop counter
+ * \return number of pixels processed per iteration
+ */
+typedef unsigned
+(*bench_build_t)(struct gallivm_state *gallivm,
+                 unsigned width,
+                 LLVMValueRef dst,
+                 LLVMValueRef src,
+                 LLVMValueRef i);
+
+
+struct bench_kernel
+{
+   const char *name;
+   bench_build_t build;
+};
+
+
+static LLVMValueRef
+cast_ptr(struct gallivm_state *gallivm, LLVMValueRef ptr, LLVMTypeRef type)
+{
+   return LLVMBuildBitCast(gallivm->builder, ptr,
+                           LLVMPointerType(type, 0), "");
+}
+
+
+/*
+ * Arithmetic kernels, on float32 vectors.
+ */
+
+static unsigned
+build_unary_float(struct gallivm_state *gallivm,
+                  unsigned width,
+                  LLVMValueRef dst,
+                  LLVMValueRef src,
+                  LLVMValueRef i,
+                  LLVMValueRef (*op)(struct lp_build_context *bld,
+                                     LLVMValueRef a))
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type = lp_type_float_vec(32, width);
+   struct lp_build_context bld;
+   LLVMTypeRef vec_type;
+   LLVMValueRef a;
+
+   lp_build_context_init(&bld, gallivm, type);
+   vec_type = bld.vec_type;
+
+   src = cast_ptr(gallivm, src, vec_type);
+   dst = cast_ptr(gallivm, dst, vec_type);
+
+   a = lp_build_pointer_get(builder, src, i);
+   a = op(&bld, a);
+   lp_build_pointer_set(builder, dst, i, a);
+
+   return type.length;
+}
+
+
+static LLVMValueRef
+add_self(struct lp_build_context *bld, LLVMValueRef a)
+{
+   return lp_build_add(bld, a, a);
+}
+
+
+static LLVMValueRef
+mul_self(struct lp_build_context *bld, LLVMValueRef a)
+{
+   return lp_build_mul(bld, a, a);
+}
+
+
+#define UNARY_KERNEL(_name, _op) \
+   static unsigned \
+   build_##_name(struct gallivm_state *gallivm, unsigned width, \
+                 LLVMValueRef dst, LLVMValueRef src, LLVMValueRef i) \
+   { \
+      return build_unary_float(gallivm, width, dst, src, i, _op); \
+   }
+
+UNARY_KERNEL(add, add_self)
+UNARY_KERNEL(mul, mul_self)
+UNARY_KERNEL(floor, lp_build_floor)
+UNARY_KERNEL(rcp, lp_build_rcp)
+UNARY_KERNEL(sqrt, lp_build_sqrt)
+UNARY_KERNEL(exp2, lp_build_exp2)
+UNARY_KERNEL(log2, lp_build_log2)
+
+#undef UNARY_KERNEL
+
+
+/*
+ * Conversion kernels, between float32 and unorm8 (16 pixels per iteration).
+ */
+
+static unsigned
+build_conv(struct gallivm_state *gallivm,
+           struct lp_type src_type,
+           struct lp_type dst_type,
+           LLVMValueRef dst,
+           LLVMValueRef src,
+           LLVMValueRef i)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   unsigned num_srcs = MAX2(dst_type.length / src_type.length, 1);
+   unsigned num_dsts = MAX2(src_type.length / dst_type.length, 1);
+   LLVMValueRef srcs[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef dsts[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef base;
+   unsigned j;
+
+   src = cast_ptr(gallivm, src, lp_build_vec_type(gallivm, src_type));
+   dst = cast_ptr(gallivm, dst, lp_build_vec_type(gallivm, dst_type));
+
+   base = LLVMBuildMul(builder, i, lp_build_const_int32(gallivm, num_srcs), "");
+   for (j = 0; j < num_srcs; ++j) {
+      LLVMValueRef index = LLVMBuildAdd(builder, base,
+                                        lp_build_const_int32(gallivm, j), "");
+      srcs[j] = lp_build_pointer_get(builder, src, index);
+   }
+
+   lp_build_conv(gallivm, src_type, dst_type, srcs, num_srcs, dsts, num_dsts);
+
+   base = LLVMBuildMul(builder, i, lp_build_const_int32(gallivm, num_dsts), "");
+   for (j = 0; j < num_dsts; ++j) {
+      LLVMValueRef index = LLVMBuildAdd(builder, base,
+                                        lp_build_const_int32(gallivm, j), "");
+      lp_build_pointer_set(builder, dst, index, dsts[j]);
+   }
+
+   return src_type.length * num_srcs;
+}
+
+
+static unsigned
+build_conv_f32_to_unorm8(struct gallivm_state *gallivm, unsigned width,
+                         LLVMValueRef dst, LLVMValueRef src, LLVMValueRef i)
+{
+   return build_conv(gallivm,
+                     lp_type_float_vec(32, width), lp_type_unorm(8, 128),
+                     dst, src, i);
+}
+
+
+static unsigned
+build_conv_unorm8_to_f32(struct gallivm_state *gallivm, unsigned width,
+                         LLVMValueRef dst, LLVMValueRef src, LLVMValueRef i)
+{
+   return build_conv(gallivm,
+                     lp_type_unorm(8, 128), lp_type_float_vec(32, width),
+                     dst, src, i);
+}
+
+
+/*
+ * Format fetch kernel: unpack B8G8R8A8_UNORM pixels into float32 SoA.
+ */
+
+static unsigned
+build_unpack_bgra8(struct gallivm_state *gallivm, unsigned width,
+                   LLVMValueRef dst, LLVMValueRef src, LLVMValueRef i)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct util_format_description *desc =
+      util_format_description(PIPE_FORMAT_B8G8R8A8_UNORM);
+   struct lp_type type = lp_type_float_vec(32, width);
+   LLVMValueRef packed;
+   LLVMValueRef rgba[4];
+   LLVMValueRef base;
+   unsigned chan;
+
+   src = cast_ptr(gallivm, src, lp_build_int_vec_type(gallivm, type));
+   dst = cast_ptr(gallivm, dst, lp_build_vec_type(gallivm, type));
+
+   packed = lp_build_pointer_get(builder, src, i);
+   lp_build_unpack_rgba_soa(gallivm, desc, type, packed, rgba);
+
+   base = LLVMBuildMul(builder, i, lp_build_const_int32(gallivm, 4), "");
+   for (chan = 0; chan < 4; ++chan) {
+      LLVMValueRef index = LLVMBuildAdd(builder, base,
+                                        lp_build_const_int32(gallivm, chan), "");
+      lp_build_pointer_set(builder, dst, index, rgba[chan]);
+   }
+
+   return type.length;
+}
+
+
+/*
+ * Blend kernel: src * src + dst * (1 - src) on unorm8 AoS pixels, the way
+ * the fragment shader back end blends RGBA8 render targets.
+ */
+
+static unsigned
+build_blend_unorm8(struct gallivm_state *gallivm, unsigned width,
+                   LLVMValueRef dst, LLVMValueRef src, LLVMValueRef i)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type = lp_type_unorm(8, width);
+   struct lp_build_context bld;
+   LLVMValueRef s, d, term1, term2, res;
+
+   lp_build_context_init(&bld, gallivm, type);
+
+   src = cast_ptr(gallivm, src, bld.vec_type);
+   dst = cast_ptr(gallivm, dst, bld.vec_type);
+
+   s = lp_build_pointer_get(builder, src, i);
+   d = lp_build_pointer_get(builder, dst, i);
+
+   term1 = lp_build_mul(&bld, s, s);
+   term2 = lp_build_mul(&bld, d, lp_build_comp(&bld, s));
+   res = lp_build_blend_func(&bld, PIPE_BLEND_ADD, term1, term2);
+
+   lp_build_pointer_set(builder, dst, i, res);
+
+   return type.length / 4;
+}
+
+
+static const struct bench_kernel
+bench_kernels[] = {
+   { "add", &build_add },
+   { "mul", &build_mul },
+   { "floor", &build_floor },
+   { "rcp", &build_rcp },
+   { "sqrt", &build_sqrt },
+   { "exp2", &build_exp2 },
+   { "log2", &build_log2 },
+   { "conv_f32_to_unorm8", &build_conv_f32_to_unorm8 },
+   { "conv_unorm8_to_f32", &build_conv_unorm8_to_f32 },
+   { "unpack_b8g8r8a8_unorm", &build_unpack_bgra8 },
+   { "blend_unorm8", &build_blend_unorm8 },
+};
+
+
+static LLVMValueRef
+build_bench_func(struct gallivm_state *gallivm,
+                 const struct bench_kernel *kernel,
+                 unsigned width,
+                 unsigned *pixels_per_iter)
+{
+   LLVMContextRef context = gallivm->context;
+   LLVMModuleRef module = gallivm->module;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i8ptr = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+   LLVMTypeRef args[3];
+   LLVMValueRef func;
+   LLVMBasicBlockRef block;
+   struct lp_build_loop_state loop;
+
+   args[0] = i8ptr;
+   args[1] = i8ptr;
+   args[2] = LLVMInt32TypeInContext(context);
+
+   func = LLVMAddFunction(module, kernel->name,
+                          LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                           args, Elements(args), 0));
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+
+   block = LLVMAppendBasicBlockInContext(context, func, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0));
+
+   *pixels_per_iter = kernel->build(gallivm, width,
+                                    LLVMGetParam(func, 0),
+                                    LLVMGetParam(func, 1),
+                                    loop.counter);
+
+   lp_build_loop_end_cond(&loop, LLVMGetParam(func, 2), NULL, LLVMIntUGE);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+static void
+dump_cpu_caps(FILE *fp)
+{
+   if (util_cpu_caps.has_sse2)
+      fprintf(fp, " sse2");
+   if (util_cpu_caps.has_sse4_1)
+      fprintf(fp, " sse4.1");
+   if (util_cpu_caps.has_avx)
+      fprintf(fp, " avx");
+   if (util_cpu_caps.has_avx2)
+      fprintf(fp, " avx2");
+   if (util_cpu_caps.has_f16c)
+      fprintf(fp, " f16c");
+   if (util_cpu_caps.has_altivec)
+      fprintf(fp, " altivec");
+}
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "kernel\t"
+           "width\t"
+           "ns_per_pixel\t"
+           "cpu_caps\n");
+
+   fflush(fp);
+}
+
+
+static void
+bench_kernel(unsigned verbose, FILE *fp,
+             const struct bench_kernel *kernel,
+             unsigned width,
+             unsigned num_runs,
+             void *dst, const void *src)
+{
+   struct gallivm_state *gallivm;
+   LLVMValueRef func;
+   bench_func_t func_jit;
+   unsigned pixels_per_iter;
+   unsigned count;
+   int64_t best = 0;
+   unsigned run;
+   double ns_per_pixel;
+
+   gallivm = gallivm_create("bench_module", LLVMGetGlobalContext());
+
+   func = build_bench_func(gallivm, kernel, width, &pixels_per_iter);
+
+   gallivm_compile_module(gallivm);
+
+   func_jit = (bench_func_t) gallivm_jit_function(gallivm, func);
+
+   gallivm_free_ir(gallivm);
+
+   count = MAX2(BENCH_NUM_PIXELS / pixels_per_iter, 1);
+
+   /* Warm up the caches and page in the buffers */
+   func_jit(dst, src, count);
+
+   for (run = 0; run < num_runs; ++run) {
+      int64_t start = os_time_get_nano();
+      int64_t elapsed;
+
+      func_jit(dst, src, count);
+
+      elapsed = os_time_get_nano() - start;
+      if (run == 0 || elapsed < best)
+         best = elapsed;
+   }
+
+   ns_per_pixel = (double)best / (double)(count * pixels_per_iter);
+
+   if (verbose || !fp) {
+      printf("%-24s %4u bits  %8.3f ns/pixel  cpu:", kernel->name, width,
+             ns_per_pixel);
+      dump_cpu_caps(stdout);
+      printf("\n");
+      fflush(stdout);
+   }
+
+   if (fp) {
+      fprintf(fp, "%s\t%u\t%f\t", kernel->name, width, ns_per_pixel);
+      dump_cpu_caps(fp);
+      fprintf(fp, "\n");
+      fflush(fp);
+   }
+
+   gallivm_destroy(gallivm);
+}
+
+
+static boolean
+bench_all(unsigned verbose, FILE *fp, unsigned num_runs)
+{
+   const unsigned size = BENCH_NUM_PIXELS * BENCH_MAX_PIXEL_BYTES;
+   float *src;
+   void *dst;
+   unsigned width;
+   unsigned i;
+
+   src = align_malloc(size, 64);
+   dst = align_malloc(size, 64);
+   if (!src || !dst) {
+      align_free(src);
+      align_free(dst);
+      return FALSE;
+   }
+
+   /*
+    * Positive, finite values, so that sqrt/log2 stay on their fast paths;
+    * the unorm8 kernels just see their bit patterns.
+    */
+   for (i = 0; i < size / sizeof(float); ++i) {
+      src[i] = 1.0f + (float)(i % 251) / 256.0f;
+   }
+   memset(dst, 0, size);
+
+   for (width = 128; width <= lp_native_vector_width; width *= 2) {
+      for (i = 0; i < Elements(bench_kernels); ++i) {
+         bench_kernel(verbose, fp, &bench_kernels[i], width, num_runs,
+                      dst, src);
+      }
+   }
+
+   align_free(src);
+   align_free(dst);
+
+   return TRUE;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   return bench_all(verbose, fp, BENCH_DEFAULT_RUNS);
+}
+
+
+/**
+ * \param n  number of timed runs per kernel
+ */
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return bench_all(verbose, fp, MAX2(MIN2(n, 1000), 1));
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return bench_all(verbose, fp, 1);
+}
@@ -355,6 +355,7 @@ test_all(unsigned verbose, FILE *fp)
 
 #if USE_TEXTURE_CACHE
    cache_ptr = align_malloc(sizeof(struct lp_build_format_cache), 16);
+   memset(cache_ptr, 0, sizeof(struct lp_build_format_cache));
 #endif
 
    for (format = 1; format < PIPE_FORMAT_COUNT; ++format) {
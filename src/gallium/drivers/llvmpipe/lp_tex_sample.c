@@ -42,8 +42,11 @@
 
 #include "pipe/p_defines.h"
 #include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "util/u_format.h"
 #include "gallivm/lp_bld_debug.h"
 #include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_format.h"
 #include "gallivm/lp_bld_type.h"
 #include "gallivm/lp_bld_sample.h"
 #include "gallivm/lp_bld_tgsi.h"
@@ -53,6 +56,22 @@
 #include "lp_debug.h"
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(lp_texture_cache, "LP_TEXTURE_CACHE", FALSE)
+
+
+boolean
+lp_sampler_view_use_block_cache(const struct pipe_sampler_view *view)
+{
+   const struct util_format_description *format_desc;
+
+   if (!view || !debug_get_option_lp_texture_cache())
+      return FALSE;
+
+   format_desc = util_format_description(util_format_linear(view->format));
+   return format_desc && lp_build_format_cacheable(format_desc);
+}
+
+
 /**
  * This provides the bridge between the sampler state store in
  * lp_jit_context and lp_jit_texture and the sampler code
@@ -221,7 +240,6 @@ LP_LLVM_SAMPLER_MEMBER(lod_bias,   LP_JIT_SAMPLER_LOD_BIAS, TRUE)
 LP_LLVM_SAMPLER_MEMBER(border_color, LP_JIT_SAMPLER_BORDER_COLOR, FALSE)
 
 
-#if LP_USE_TEXTURE_CACHE
 static LLVMValueRef
 lp_llvm_texture_cache_ptr(const struct lp_sampler_dynamic_state *base,
                           struct gallivm_state *gallivm,
@@ -233,7 +251,6 @@ lp_llvm_texture_cache_ptr(const struct lp_sampler_dynamic_state *base,
 
    return lp_jit_thread_data_cache(gallivm, thread_data_ptr);
 }
-#endif
 
 
 static void
@@ -329,9 +346,7 @@ lp_llvm_sampler_soa_create(const struct lp_sampler_static_state *static_state)
    sampler->dynamic_state.base.lod_bias = lp_llvm_sampler_lod_bias;
    sampler->dynamic_state.base.border_color = lp_llvm_sampler_border_color;
 
-#if LP_USE_TEXTURE_CACHE
    sampler->dynamic_state.base.cache_ptr = lp_llvm_texture_cache_ptr;
-#endif
 
    sampler->dynamic_state.static_state = static_state;
 
@@ -33,11 +33,14 @@
 
 
 struct lp_sampler_static_state;
+struct pipe_sampler_view;
+
 
 /**
- * Whether texture cache is used for s3tc textures.
+ * Whether to sample the view through the decoded block cache.
  */
-#define LP_USE_TEXTURE_CACHE 0
+boolean
+lp_sampler_view_use_block_cache(const struct pipe_sampler_view *view);
 
 /**
  * Pure-LLVM texture sampling code generator.
@@ -52,6 +52,7 @@
 #include "lp_rast.h"
 
 #include "state_tracker/sw_winsys.h"
+#include "gallivm/lp_bld_sample.h"
 
 
 #ifdef DEBUG
@@ -59,6 +60,32 @@ static struct llvmpipe_resource resource_list;
 #endif
 static unsigned id_counter = 0;
 
+DEBUG_GET_ONCE_BOOL_OPTION(lp_tiled_textures, "LP_TILED_TEXTURES", FALSE)
+
+
+/**
+ * Whether to store a texture in tiles (see LP_RESOURCE_FLAG_TILED) so
+ * that bilinear footprints and vertical neighbours share cache lines.
+ * Only done for plain 2D textures which are never rendered to or mapped
+ * persistently, as only the sampler code knows about the tiled layout.
+ */
+static boolean
+llvmpipe_resource_want_tiled(const struct pipe_resource *pt)
+{
+   return debug_get_option_lp_tiled_textures() &&
+          (pt->target == PIPE_TEXTURE_2D ||
+           pt->target == PIPE_TEXTURE_RECT) &&
+          pt->bind == PIPE_BIND_SAMPLER_VIEW &&
+          pt->usage != PIPE_USAGE_STAGING &&
+          !(pt->flags & (PIPE_RESOURCE_FLAG_MAP_PERSISTENT |
+                         PIPE_RESOURCE_FLAG_MAP_COHERENT)) &&
+          pt->array_size == 1 &&
+          pt->nr_samples <= 1 &&
+          !util_format_is_compressed(pt->format) &&
+          util_format_get_blockwidth(pt->format) == 1 &&
+          util_format_get_blockheight(pt->format) == 1;
+}
+
 
 /**
  * Conventional allocation path for non-display textures:
@@ -91,6 +118,7 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
    for (level = 0; level <= pt->last_level; level++) {
       uint64_t mipsize;
       unsigned align_x, align_y, nblocksx, nblocksy, block_size, num_slices;
+      unsigned nfullrows;
 
       /* Row stride and image stride */
 
@@ -120,16 +148,25 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
 
       if (util_format_is_compressed(pt->format))
          lpr->row_stride[level] = nblocksx * block_size;
+      else if (pt->flags & LP_RESOURCE_FLAG_TILED)
+         /* stride between rows of tiles, nblocksy is tile aligned */
+         lpr->row_stride[level] = align(nblocksx * block_size * LP_TEX_TILE_SIZE,
+                                        util_cpu_caps.cacheline);
       else
          lpr->row_stride[level] = align(nblocksx * block_size, util_cpu_caps.cacheline);
 
+      if (pt->flags & LP_RESOURCE_FLAG_TILED)
+         nfullrows = nblocksy / LP_TEX_TILE_SIZE;
+      else
+         nfullrows = nblocksy;
+
       /* if row_stride * height > LP_MAX_TEXTURE_SIZE */
-      if ((uint64_t)lpr->row_stride[level] * nblocksy > LP_MAX_TEXTURE_SIZE) {
+      if ((uint64_t)lpr->row_stride[level] * nfullrows > LP_MAX_TEXTURE_SIZE) {
          /* image too large */
          goto fail;
       }
 
-      lpr->img_stride[level] = lpr->row_stride[level] * nblocksy;
+      lpr->img_stride[level] = lpr->row_stride[level] * nfullrows;
 
       /* Number of 3D image slices, cube faces or texture array layers */
       if (lpr->base.target == PIPE_TEXTURE_CUBE) {
@@ -262,6 +299,8 @@ llvmpipe_resource_create_front(struct pipe_screen *_screen,
       }
       else {
          /* texture map */
+         if (llvmpipe_resource_want_tiled(&lpr->base))
+            lpr->base.flags |= LP_RESOURCE_FLAG_TILED;
          if (!llvmpipe_texture_layout(screen, lpr, true))
             goto fail;
       }
@@ -500,6 +539,48 @@ llvmpipe_resource_get_handle(struct pipe_screen *screen,
 }
 
 
+/**
+ * Copy a box of a tiled texture level to (to_tiled == FALSE) or from
+ * (to_tiled == TRUE) a linear buffer.
+ */
+static void
+llvmpipe_tiled_copy_box(struct llvmpipe_resource *lpr,
+                        unsigned level,
+                        const struct pipe_box *box,
+                        uint8_t *linear,
+                        unsigned linear_stride,
+                        boolean to_tiled)
+{
+   const unsigned bpp = util_format_get_blocksize(lpr->base.format);
+   const unsigned tile_bytes = LP_TEX_TILE_SIZE * LP_TEX_TILE_SIZE * bpp;
+   uint8_t *tiled = llvmpipe_get_texture_image_address(lpr, 0, level);
+   int x, y;
+
+   for (y = 0; y < box->height; y++) {
+      unsigned ty = box->y + y;
+      uint8_t *row = tiled +
+                     ty / LP_TEX_TILE_SIZE * lpr->row_stride[level] +
+                     ty % LP_TEX_TILE_SIZE * LP_TEX_TILE_SIZE * bpp;
+      uint8_t *lin = linear + y * linear_stride;
+
+      for (x = 0; x < box->width; ) {
+         unsigned tx = box->x + x;
+         unsigned run = MIN2(LP_TEX_TILE_SIZE - tx % LP_TEX_TILE_SIZE,
+                             box->width - x);
+         uint8_t *p = row +
+                      tx / LP_TEX_TILE_SIZE * tile_bytes +
+                      tx % LP_TEX_TILE_SIZE * bpp;
+
+         if (to_tiled)
+            memcpy(p, lin + x * bpp, run * bpp);
+         else
+            memcpy(lin + x * bpp, p, run * bpp);
+         x += run;
+      }
+   }
+}
+
+
 static void *
 llvmpipe_transfer_map( struct pipe_context *pipe,
                        struct pipe_resource *resource,
@@ -542,6 +623,12 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
       }
    }
 
+   /* Tiled textures can only be mapped through a linear copy */
+   if ((resource->flags & LP_RESOURCE_FLAG_TILED) &&
+       (usage & PIPE_TRANSFER_MAP_DIRECTLY)) {
+      return NULL;
+   }
+
    /* Check if we're mapping the current constant buffer */
    if ((usage & PIPE_TRANSFER_WRITE) &&
        (resource->bind & PIPE_BIND_CONSTANT_BUFFER)) {
@@ -555,9 +642,10 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
       }
    }
 
-   lpt = CALLOC_STRUCT(llvmpipe_transfer);
+   lpt = util_slab_child_alloc(&llvmpipe->transfer_pool);
    if (!lpt)
       return NULL;
+   memset(lpt, 0, sizeof(*lpt));
    pt = &lpt->base;
    pipe_resource_reference(&pt->resource, resource);
    pt->box = *box;
@@ -597,6 +685,25 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
                                box->z,
                                tex_usage);
 
+   if (resource->flags & LP_RESOURCE_FLAG_TILED) {
+      assert(box->z == 0 && box->depth == 1);
+      pt->stride = box->width * util_format_get_blocksize(format);
+      pt->layer_stride = pt->stride * box->height;
+      lpt->staging = MALLOC(pt->layer_stride);
+      if (!lpt->staging) {
+         llvmpipe_resource_unmap(resource, level, box->z);
+         pipe_resource_reference(&pt->resource, NULL);
+         util_slab_child_free(&llvmpipe->transfer_pool, lpt);
+         *transfer = NULL;
+         return NULL;
+      }
+      if (!(usage & (PIPE_TRANSFER_DISCARD_RANGE |
+                     PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE))) {
+         llvmpipe_tiled_copy_box(lpr, level, box, lpt->staging,
+                                 pt->stride, FALSE);
+      }
+   }
+
 
    /* May want to do different things here depending on read/write nature
     * of the map:
@@ -607,6 +714,9 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
       screen->timestamp++;
    }
 
+   if (lpt->staging)
+      return lpt->staging;
+
    map +=
       box->y / util_format_get_blockheight(format) * pt->stride +
       box->x / util_format_get_blockwidth(format) * util_format_get_blocksize(format);
@@ -619,8 +729,20 @@ static void
 llvmpipe_transfer_unmap(struct pipe_context *pipe,
                         struct pipe_transfer *transfer)
 {
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_transfer *lpt = llvmpipe_transfer(transfer);
+
    assert(transfer->resource);
 
+   if (lpt->staging) {
+      if (transfer->usage & PIPE_TRANSFER_WRITE) {
+         llvmpipe_tiled_copy_box(llvmpipe_resource(transfer->resource),
+                                 transfer->level, &transfer->box,
+                                 lpt->staging, transfer->stride, TRUE);
+      }
+      FREE(lpt->staging);
+   }
+
    llvmpipe_resource_unmap(transfer->resource,
                            transfer->level,
                            transfer->box.z);
@@ -631,7 +753,7 @@ llvmpipe_transfer_unmap(struct pipe_context *pipe,
     */
    assert (transfer->resource);
    pipe_resource_reference(&transfer->resource, NULL);
-   FREE(transfer);
+   util_slab_child_free(&llvmpipe->transfer_pool, lpt);
 }
 
 unsigned int
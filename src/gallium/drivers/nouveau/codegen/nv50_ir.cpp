@@ -234,6 +234,8 @@ LValue::LValue(Function *fn, DataFile file)
    fixedReg = 0;
    noSpill = 0;
 
+   livei.setPool(&fn->getProgram()->mem_Interval);
+
    fn->add(this, this->id);
 }
 
@@ -251,6 +253,8 @@ LValue::LValue(Function *fn, LValue *lval)
    fixedReg = 0;
    noSpill = 0;
 
+   livei.setPool(&fn->getProgram()->mem_Interval);
+
    fn->add(this, this->id);
 }
 
@@ -1056,7 +1060,8 @@ Program::Program(Type type, Target *arch)
      mem_FlowInstruction(sizeof(FlowInstruction), 4),
      mem_LValue(sizeof(LValue), 8),
      mem_Symbol(sizeof(Symbol), 7),
-     mem_ImmediateValue(sizeof(ImmediateValue), 7)
+     mem_ImmediateValue(sizeof(ImmediateValue), 7),
+     mem_Interval(Interval::getRangeSize(), 8)
 {
    code = NULL;
    binSize = 0;
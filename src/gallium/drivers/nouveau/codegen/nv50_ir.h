@@ -1197,6 +1197,7 @@ public:
    MemoryPool mem_LValue;
    MemoryPool mem_Symbol;
    MemoryPool mem_ImmediateValue;
+   MemoryPool mem_Interval; // live range segments of LValues
 
    uint32_t dbgFlags;
    uint8_t  optLevel;
@@ -203,6 +203,14 @@ extern void
 nv50_ir_change_interp(void *interpData, uint32_t *code,
                       bool force_per_sample, bool flatshade);
 
+/* size in bytes of the relocation and interpolation data, which is a single
+ * allocation and can be copied, e.g. to store it in a shader cache */
+extern uint32_t nv50_ir_reloc_data_size(const void *relocData);
+extern uint32_t nv50_ir_interp_data_size(const void *interpData);
+
+/* fix up interpolation data copied back from a cache into a new allocation */
+extern void nv50_ir_restore_interp_data(void *interpData, uint32_t chipset);
+
 /* obtain code that will be shared among programs */
 extern void nv50_ir_get_target_library(uint32_t chipset,
                                        const uint32_t **code, uint32_t *size);
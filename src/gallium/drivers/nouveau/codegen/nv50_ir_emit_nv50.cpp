@@ -38,6 +38,7 @@ public:
    virtual bool emitInstruction(Instruction *);
 
    virtual uint32_t getMinEncodingSize(const Instruction *) const;
+   virtual InterpApply getInterpApply() const;
 
    inline void setProgramType(Program::Type pType) { progType = pType; }
 
@@ -905,6 +906,12 @@ interpApply(const InterpEntry *entry, uint32_t *code,
    }
 }
 
+InterpApply
+CodeEmitterNV50::getInterpApply() const
+{
+   return interpApply;
+}
+
 void
 CodeEmitterNV50::emitINTERP(const Instruction *i)
 {
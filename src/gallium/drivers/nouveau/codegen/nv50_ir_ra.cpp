@@ -24,6 +24,7 @@
 #include "codegen/nv50_ir_target.h"
 
 #include <algorithm>
+#include <queue>
 #include <stack>
 #include <limits>
 #if __cplusplus >= 201103L
@@ -225,6 +226,418 @@ RegisterSet::release(DataFile f, int32_t reg, unsigned int size)
    INFO_DBG(0, REG_ALLOC, "reg release: %u[%i] %u\n", f, reg, size);
 }
 
+// List scheduler run on each basic block before register allocation. It moves
+// long latency instructions like texture and memory loads up so their
+// latency is hidden by independent work, and keeps the estimated register
+// pressure from growing beyond what the original order needed.
+class PreRAScheduler : public Pass
+{
+public:
+   PreRAScheduler(const Target *targ) : targ(targ) { }
+
+private:
+   enum SchedClass
+   {
+      SCHED_PURE,    // only depends on its sources
+      SCHED_READ,    // reads memory others may write
+      SCHED_WRITE,   // writes memory or has other side effects
+      SCHED_BARRIER  // nothing may be moved across it
+   };
+
+   struct Node
+   {
+      Instruction *insn;
+      std::vector<std::pair<int, int> > succs; // (node, latency)
+      std::vector<Value *> gprSrcs;
+      int numPreds;
+      int earliest;
+      int height;
+      int latency;
+      int defUnits;
+   };
+
+   virtual bool visit(BasicBlock *);
+
+   SchedClass classify(const Instruction *) const;
+   void schedule(BasicBlock *, const std::vector<Instruction *>&, Instruction *);
+   void buildGraph(const std::vector<Instruction *>&);
+   void addEdge(int from, int to, int latency);
+   int pressureDelta(const Node&) const;
+   void issue(const Node&);
+   int simulatePressure(const std::vector<Instruction *>&);
+
+   static int units(const Value *v) { return (v->reg.size + 3) / 4; }
+
+   const Target *targ;
+
+   std::vector<Node> nodes;
+   unordered_map<Value *, int> remainingUses;
+   unordered_map<Value *, bool> liveOut;
+   int pressure;
+};
+
+// Register pressure below which the scheduler doesn't try to reduce it.
+#define SCHED_PRESSURE_LIMIT 32
+
+PreRAScheduler::SchedClass
+PreRAScheduler::classify(const Instruction *i) const
+{
+   if (i->fixed || i->join || i->terminator || i->exit || i->asFlow())
+      return SCHED_BARRIER;
+
+   for (int d = 0; i->defExists(d); ++d)
+      if (i->getDef(d)->reg.data.id >= 0)
+         return SCHED_BARRIER;
+   for (int s = 0; i->srcExists(s); ++s)
+      if (i->getSrc(s)->asLValue() && i->getSrc(s)->reg.data.id >= 0)
+         return SCHED_BARRIER;
+
+   switch (i->op) {
+   case OP_LOAD:
+      if (i->src(0).getFile() == FILE_MEMORY_CONST ||
+          i->src(0).getFile() == FILE_SHADER_INPUT)
+         return SCHED_PURE;
+      return SCHED_READ;
+   case OP_LINTERP:
+   case OP_PINTERP:
+   case OP_DFDX:
+   case OP_DFDY:
+   case OP_PIXLD:
+   case OP_SHFL:
+   case OP_VOTE:
+   case OP_SUBFM:
+   case OP_SUCLAMP:
+   case OP_SUEAU:
+      return SCHED_PURE;
+   case OP_RDSV:
+      if (i->getSrc(0)->reg.data.sv.sv == SV_CLOCK)
+         return SCHED_BARRIER;
+      return SCHED_PURE;
+   case OP_VFETCH:
+   case OP_SULDB:
+   case OP_SULDP:
+   case OP_SUQ:
+      return SCHED_READ;
+   case OP_STORE:
+   case OP_EXPORT:
+   case OP_ATOM:
+   case OP_SUSTB:
+   case OP_SUSTP:
+   case OP_SUREDB:
+   case OP_SUREDP:
+      return SCHED_WRITE;
+   default:
+      break;
+   }
+
+   switch (Target::getOpClass(i->op)) {
+   case OPCLASS_MOVE:
+   case OPCLASS_ARITH:
+   case OPCLASS_SHIFT:
+   case OPCLASS_SFU:
+   case OPCLASS_LOGIC:
+   case OPCLASS_COMPARE:
+   case OPCLASS_CONVERT:
+   case OPCLASS_BITFIELD:
+   case OPCLASS_VECTOR:
+   case OPCLASS_PSEUDO:
+      return SCHED_PURE;
+   case OPCLASS_TEXTURE:
+   case OPCLASS_SURFACE:
+      return SCHED_READ;
+   default:
+      return SCHED_BARRIER;
+   }
+}
+
+void
+PreRAScheduler::addEdge(int from, int to, int latency)
+{
+   nodes[from].succs.push_back(std::make_pair(to, latency));
+   ++nodes[to].numPreds;
+}
+
+void
+PreRAScheduler::buildGraph(const std::vector<Instruction *>& insns)
+{
+   unordered_map<Value *, int> lastDef;
+   unordered_map<Value *, std::vector<int> > readers;
+   std::vector<int> memReads;
+   int lastWrite = -1;
+
+   nodes.clear();
+   nodes.resize(insns.size());
+
+   for (size_t n = 0; n < insns.size(); ++n) {
+      Instruction *i = insns[n];
+      Node &node = nodes[n];
+
+      node.insn = i;
+      node.numPreds = 0;
+      node.earliest = 0;
+      node.latency = targ->getLatency(i);
+      node.defUnits = 0;
+
+      for (int s = 0; i->srcExists(s); ++s) {
+         Value *v = i->getSrc(s);
+         if (!v->asLValue())
+            continue;
+         if (lastDef.count(v))
+            addEdge(lastDef[v], n, nodes[lastDef[v]].latency);
+         readers[v].push_back(n);
+         if (v->reg.file == FILE_GPR &&
+             std::find(node.gprSrcs.begin(), node.gprSrcs.end(), v) ==
+             node.gprSrcs.end())
+            node.gprSrcs.push_back(v);
+      }
+
+      for (int d = 0; i->defExists(d); ++d) {
+         Value *v = i->getDef(d);
+         std::vector<int> &r = readers[v];
+
+         if (lastDef.count(v))
+            addEdge(lastDef[v], n, 0);
+         for (size_t k = 0; k < r.size(); ++k)
+            if (r[k] != (int)n)
+               addEdge(r[k], n, 0);
+         r.clear();
+         lastDef[v] = n;
+      }
+
+      switch (classify(i)) {
+      case SCHED_READ:
+         if (lastWrite >= 0)
+            addEdge(lastWrite, n, 0);
+         memReads.push_back(n);
+         break;
+      case SCHED_WRITE:
+         if (lastWrite >= 0)
+            addEdge(lastWrite, n, 0);
+         for (size_t k = 0; k < memReads.size(); ++k)
+            addEdge(memReads[k], n, 0);
+         memReads.clear();
+         lastWrite = n;
+         break;
+      default:
+         break;
+      }
+   }
+
+   // Height: latency of the longest dependency chain starting at a node.
+   for (int n = nodes.size() - 1; n >= 0; --n) {
+      Node &node = nodes[n];
+
+      node.height = node.latency;
+      for (size_t k = 0; k < node.succs.size(); ++k)
+         node.height = MAX2(node.height, node.succs[k].second +
+                            nodes[node.succs[k].first].height);
+   }
+}
+
+int
+PreRAScheduler::simulatePressure(const std::vector<Instruction *>& insns)
+{
+   unordered_map<Instruction *, bool> inRegion;
+   int maxPressure;
+
+   remainingUses.clear();
+   liveOut.clear();
+   pressure = 0;
+
+   for (size_t n = 0; n < insns.size(); ++n)
+      inRegion[insns[n]] = true;
+
+   for (size_t n = 0; n < nodes.size(); ++n) {
+      Node &node = nodes[n];
+
+      for (size_t k = 0; k < node.gprSrcs.size(); ++k) {
+         Value *v = node.gprSrcs[k];
+         if (!remainingUses.count(v) && !inRegion.count(v->getInsn()))
+            pressure += units(v); // live-in
+         ++remainingUses[v];
+      }
+
+      for (int d = 0; node.insn->defExists(d); ++d) {
+         Value *v = node.insn->getDef(d);
+         if (v->reg.file == FILE_GPR)
+            node.defUnits += units(v);
+      }
+   }
+
+   for (size_t n = 0; n < nodes.size(); ++n) {
+      Instruction *i = nodes[n].insn;
+
+      for (int d = 0; i->defExists(d); ++d) {
+         Value *v = i->getDef(d);
+         for (Value::UseIterator u = v->uses.begin(); u != v->uses.end(); ++u)
+            if (!inRegion.count((*u)->getInsn()))
+               liveOut[v] = true;
+      }
+   }
+   for (unordered_map<Value *, int>::iterator it = remainingUses.begin();
+        it != remainingUses.end(); ++it) {
+      Value *v = it->first;
+      for (Value::UseIterator u = v->uses.begin(); u != v->uses.end(); ++u)
+         if (!inRegion.count((*u)->getInsn()))
+            liveOut[v] = true;
+   }
+
+   // Pressure of the original order, which we are allowed to reach.
+   const unordered_map<Value *, int> uses = remainingUses;
+   const int initial = pressure;
+
+   maxPressure = pressure;
+   for (size_t n = 0; n < nodes.size(); ++n) {
+      maxPressure = MAX2(maxPressure, pressure + nodes[n].defUnits);
+      issue(nodes[n]);
+   }
+
+   remainingUses = uses;
+   pressure = initial;
+
+   return maxPressure;
+}
+
+int
+PreRAScheduler::pressureDelta(const Node &node) const
+{
+   int delta = node.defUnits;
+
+   for (size_t k = 0; k < node.gprSrcs.size(); ++k) {
+      Value *v = node.gprSrcs[k];
+      if (remainingUses.find(v)->second == 1 && !liveOut.count(v))
+         delta -= units(v);
+   }
+   return delta;
+}
+
+void
+PreRAScheduler::issue(const Node &node)
+{
+   pressure += pressureDelta(node);
+
+   for (size_t k = 0; k < node.gprSrcs.size(); ++k)
+      --remainingUses[node.gprSrcs[k]];
+
+   // Results nobody reads die right away.
+   for (int d = 0; node.insn->defExists(d); ++d) {
+      Value *v = node.insn->getDef(d);
+      if (v->reg.file == FILE_GPR && !remainingUses.count(v) &&
+          !liveOut.count(v))
+         pressure -= units(v);
+   }
+}
+
+void
+PreRAScheduler::schedule(BasicBlock *bb, const std::vector<Instruction *>& insns,
+                         Instruction *next)
+{
+   std::vector<int> ready, order;
+   int cycle = 0;
+
+   if (insns.size() < 3)
+      return;
+
+   buildGraph(insns);
+   const int limit = MAX2(simulatePressure(insns), SCHED_PRESSURE_LIMIT);
+
+   for (size_t n = 0; n < nodes.size(); ++n)
+      if (!nodes[n].numPreds)
+         ready.push_back(n);
+
+   while (!ready.empty()) {
+      int best = -1;
+
+      for (size_t k = 0; k < ready.size(); ++k) {
+         const Node &c = nodes[ready[k]];
+
+         if (best < 0) {
+            best = k;
+            continue;
+         }
+         const Node &b = nodes[ready[best]];
+
+         if (pressure + c.defUnits > limit || pressure + b.defUnits > limit) {
+            // Close to the limit, prefer what frees registers.
+            const int dc = pressureDelta(c), db = pressureDelta(b);
+            if (dc != db) {
+               if (dc < db)
+                  best = k;
+               continue;
+            }
+         }
+
+         const bool cAvail = c.earliest <= cycle;
+         const bool bAvail = b.earliest <= cycle;
+         if (cAvail != bAvail) {
+            if (cAvail)
+               best = k;
+         } else if (!cAvail && c.earliest != b.earliest) {
+            if (c.earliest < b.earliest)
+               best = k;
+         } else if (c.height != b.height) {
+            if (c.height > b.height)
+               best = k;
+         } else if (ready[k] < ready[best]) {
+            best = k;
+         }
+      }
+
+      const int n = ready[best];
+      Node &node = nodes[n];
+
+      ready.erase(ready.begin() + best);
+      order.push_back(n);
+      issue(node);
+
+      cycle = MAX2(cycle, node.earliest);
+      for (size_t k = 0; k < node.succs.size(); ++k) {
+         Node &s = nodes[node.succs[k].first];
+         s.earliest = MAX2(s.earliest, cycle + node.succs[k].second);
+         if (!--s.numPreds)
+            ready.push_back(node.succs[k].first);
+      }
+      ++cycle;
+   }
+
+   assert(order.size() == insns.size());
+
+   size_t n;
+   for (n = 0; n < order.size() && order[n] == (int)n; ++n);
+   if (n == order.size())
+      return;
+
+   for (n = 0; n < insns.size(); ++n)
+      bb->remove(insns[n]);
+   for (n = 0; n < order.size(); ++n) {
+      if (next)
+         bb->insertBefore(next, insns[order[n]]);
+      else
+         bb->insertTail(insns[order[n]]);
+   }
+}
+
+bool
+PreRAScheduler::visit(BasicBlock *bb)
+{
+   std::vector<Instruction *> region;
+   Instruction *next;
+
+   for (Instruction *i = bb->getEntry(); i; i = next) {
+      next = i->next;
+
+      if (classify(i) == SCHED_BARRIER) {
+         schedule(bb, region, i);
+         region.clear();
+      } else {
+         region.push_back(i);
+      }
+   }
+   schedule(bb, region, NULL);
+
+   return true;
+}
+
 class RegAlloc
 {
 public:
@@ -290,6 +703,7 @@ private:
    ArrayList insns;
 
    int sequence; // for manual passes through CFG
+   bool liveSetsChanged; // set by buildLiveSets if it added any live values
 };
 
 typedef std::pair<Value *, Value *> ValuePair;
@@ -563,6 +977,11 @@ RegAlloc::buildLiveSets(BasicBlock *bb)
 
    bb->liveSet.allocate(func->allLValues.getSize(), false);
 
+   // live sets only grow from one pass to the next, so counting suffices
+   // to detect whether we still need another one
+   const unsigned int prevCount =
+      bb->liveSet.marker ? bb->liveSet.popCount() : ~0u;
+
    int n = 0;
    for (Graph::EdgeIterator ei = bb->cfg.outgoing(); !ei.end(); ei.next()) {
       bn = BasicBlock::get(ei.getNode());
@@ -606,6 +1025,9 @@ RegAlloc::buildLiveSets(BasicBlock *bb)
    for (i = bb->getPhi(); i && i->op == OP_PHI; i = i->next)
       bb->liveSet.clr(i->getDef(0)->id);
 
+   if (bb->liveSet.popCount() != prevCount)
+      liveSetsChanged = true;
+
    if (prog->dbgFlags & NV50_IR_DEBUG_REG_ALLOC) {
       INFO("BB:%i live set after propagation:\n", bb->getId());
       bb->liveSet.print();
@@ -667,9 +1089,9 @@ RegAlloc::BuildIntervalsPass::visit(BasicBlock *bb)
 
    // remaining live-outs are live until end
    if (bb->getExit()) {
-      for (unsigned int j = 0; j < bb->liveSet.getSize(); ++j)
-         if (bb->liveSet.test(j))
-            addLiveRange(func->getLValue(j), bb, bb->getExit()->serial + 1);
+      for (int j = bb->liveSet.findNextSet(0); j >= 0;
+           j = bb->liveSet.findNextSet(j + 1))
+         addLiveRange(func->getLValue(j), bb, bb->getExit()->serial + 1);
    }
 
    for (Instruction *i = bb->getExit(); i && i->op != OP_PHI; i = i->prev) {
@@ -743,6 +1165,11 @@ private:
          return static_cast<RIG_Node *>(ei.getNode());
       }
 
+      static inline bool beginsBefore(const RIG_Node *a, const RIG_Node *b)
+      {
+         return a->livei.begin() < b->livei.begin();
+      }
+
    public:
       uint32_t degree;
       uint16_t degreeLimit; // if deg < degLimit, node is trivially colourable
@@ -764,6 +1191,27 @@ private:
       std::list<RIG_Node *> prefRegs;
    };
 
+   // entry of the queue of spill candidates, ordered so that the top has the
+   // lowest score; scores only grow as neighbours are simplified, so entries
+   // with an outdated degree are refreshed when they reach the top
+   struct SpillCandidate
+   {
+      SpillCandidate(RIG_Node *n) : node(n), degree(n->degree),
+         score(n->weight / (float)n->degree) { }
+
+      bool operator<(const SpillCandidate& that) const
+      {
+         if (score != that.score)
+            return score > that.score;
+         // prefer the same node as a walk of the hi list would
+         return node < that.node;
+      }
+
+      RIG_Node *node;
+      uint32_t degree;
+      float score;
+   };
+
 private:
    inline RIG_Node *getNode(const LValue *v) const { return &nodes[v->id]; }
 
@@ -784,8 +1232,8 @@ private:
 
    inline void checkInterference(const RIG_Node *, Graph::EdgeIterator&);
 
-   inline void insertOrderedTail(std::list<RIG_Node *>&, RIG_Node *);
-   void checkList(std::list<RIG_Node *>&);
+   inline void addLiveValue(std::vector<RIG_Node *>&, RIG_Node *);
+   void checkList(std::vector<RIG_Node *>&);
 
 private:
    std::stack<uint32_t> stack;
@@ -1162,11 +1610,11 @@ GCRA::~GCRA()
 }
 
 void
-GCRA::checkList(std::list<RIG_Node *>& lst)
+GCRA::checkList(std::vector<RIG_Node *>& lst)
 {
    GCRA::RIG_Node *prev = NULL;
 
-   for (std::list<RIG_Node *>::iterator it = lst.begin();
+   for (std::vector<RIG_Node *>::iterator it = lst.begin();
         it != lst.end();
         ++it) {
       assert((*it)->getValue()->join == (*it)->getValue());
@@ -1177,55 +1625,53 @@ GCRA::checkList(std::list<RIG_Node *>& lst)
 }
 
 void
-GCRA::insertOrderedTail(std::list<RIG_Node *>& list, RIG_Node *node)
+GCRA::addLiveValue(std::vector<RIG_Node *>& list, RIG_Node *node)
 {
-   if (node->livei.isEmpty())
-      return;
-   // only the intervals of joined values don't necessarily arrive in order
-   std::list<RIG_Node *>::iterator prev, it;
-   for (it = list.end(); it != list.begin(); it = prev) {
-      prev = it;
-      --prev;
-      if ((*prev)->livei.begin() <= node->livei.begin())
-         break;
-   }
-   list.insert(it, node);
+   if (!node->livei.isEmpty())
+      list.push_back(node);
 }
 
 void
 GCRA::buildRIG(ArrayList& insns)
 {
-   std::list<RIG_Node *> values, active;
+   std::vector<RIG_Node *> values;
+   // values live at the current point of the sweep, one list per file as
+   // values of different files never interfere
+   std::list<RIG_Node *> active[LAST_REGISTER_FILE + 1];
 
    for (std::deque<ValueDef>::iterator it = func->ins.begin();
         it != func->ins.end(); ++it)
-      insertOrderedTail(values, getNode(it->get()->asLValue()));
+      addLiveValue(values, getNode(it->get()->asLValue()));
 
    for (int i = 0; i < insns.getSize(); ++i) {
       Instruction *insn = reinterpret_cast<Instruction *>(insns.get(i));
       for (int d = 0; insn->defExists(d); ++d)
          if (insn->getDef(d)->rep() == insn->getDef(d))
-            insertOrderedTail(values, getNode(insn->getDef(d)->asLValue()));
+            addLiveValue(values, getNode(insn->getDef(d)->asLValue()));
    }
+   // only the intervals of joined values don't necessarily arrive in order,
+   // sorting once replaces searching for the insertion point of each of them
+   std::stable_sort(values.begin(), values.end(), RIG_Node::beginsBefore);
    checkList(values);
 
-   while (!values.empty()) {
-      RIG_Node *cur = values.front();
+   for (std::vector<RIG_Node *>::iterator v = values.begin();
+        v != values.end(); ++v) {
+      RIG_Node *cur = *v;
+      std::list<RIG_Node *>& live = active[cur->f];
 
-      for (std::list<RIG_Node *>::iterator it = active.begin();
-           it != active.end();) {
+      for (std::list<RIG_Node *>::iterator it = live.begin();
+           it != live.end();) {
          RIG_Node *node = *it;
 
          if (node->livei.end() <= cur->livei.begin()) {
-            it = active.erase(it);
+            it = live.erase(it);
          } else {
-            if (node->f == cur->f && node->livei.overlaps(cur->livei))
+            if (node->livei.overlaps(cur->livei))
                cur->addInterference(node);
             ++it;
          }
       }
-      values.pop_front();
-      active.push_back(cur);
+      live.push_back(cur);
    }
 }
 
@@ -1307,6 +1753,11 @@ GCRA::simplifyNode(RIG_Node *node)
 void
 GCRA::simplify()
 {
+   std::priority_queue<SpillCandidate> spillQueue;
+
+   for (RIG_Node *it = hi.next; it != &hi; it = it->next)
+      spillQueue.push(SpillCandidate(it));
+
    for (;;) {
       if (!DLLIST_EMPTY(&lo[0])) {
          do {
@@ -1317,17 +1768,25 @@ GCRA::simplify()
          simplifyNode(lo[1].next);
       } else
       if (!DLLIST_EMPTY(&hi)) {
-         RIG_Node *best = hi.next;
-         float bestScore = best->weight / (float)best->degree;
+         RIG_Node *best = NULL;
+         float bestScore = 0.0f;
          // spill candidate
-         for (RIG_Node *it = best->next; it != &hi; it = it->next) {
-            float score = it->weight / (float)it->degree;
-            if (score < bestScore) {
-               best = it;
-               bestScore = score;
+         while (!spillQueue.empty()) {
+            const SpillCandidate top = spillQueue.top();
+            spillQueue.pop();
+            RIG_Node *node = top.node;
+            if (DLLIST_EMPTY(node) || node->degree < node->degreeLimit)
+               continue; // already simplified or moved to lo
+            if (top.degree != node->degree) {
+               spillQueue.push(SpillCandidate(node));
+               continue;
             }
+            best = node;
+            bestScore = top.score;
+            break;
          }
-         if (isinf(bestScore)) {
+         assert(best);
+         if (!best || isinf(bestScore)) {
             ERROR("no viable spill candidates left\n");
             break;
          }
@@ -1816,6 +2275,14 @@ RegAlloc::execFunc()
    unsigned int i, retries;
    bool ret;
 
+   if (prog->optLevel >= 2 &&
+       prog->getTarget()->getChipset() >= NVISA_GF100_CHIPSET_C0) {
+      PreRAScheduler sched(prog->getTarget());
+      ret = sched.run(func);
+      if (!ret)
+         goto out;
+   }
+
    if (!func->ins.empty()) {
       // Insert a nop at the entry so inputs only used by the first instruction
       // don't count as having an empty live range.
@@ -1844,10 +2311,13 @@ RegAlloc::execFunc()
 
       // spilling to registers may add live ranges, need to rebuild everything
       ret = true;
+      liveSetsChanged = true;
       for (sequence = func->cfg.nextSequence(), i = 0;
-           ret && i <= func->loopNestingBound;
-           sequence = func->cfg.nextSequence(), ++i)
+           ret && liveSetsChanged && i <= func->loopNestingBound;
+           sequence = func->cfg.nextSequence(), ++i) {
+         liveSetsChanged = false;
          ret = buildLiveSets(BasicBlock::get(func->cfg.getRoot()));
+      }
       // reset marker
       for (ArrayList::Iterator bi = func->allBBlocks.iterator();
            !bi.end(); bi.next())
@@ -324,6 +324,15 @@ Function::convertToSSA()
    // 0. calculate live in variables (for pruned SSA)
    buildLiveSets();
 
+   // Most values coming from TGSI never leave the block they are defined in,
+   // they can't need a phi function anywhere and are skipped in step 2.
+   BitSet liveIn(allLValues.getSize(), true);
+   for (ArrayList::Iterator bi = allBBlocks.iterator(); !bi.end(); bi.next()) {
+      BasicBlock *b = BasicBlock::get(bi);
+      if (b->liveSet.getSize() == liveIn.getSize())
+         liveIn |= b->liveSet;
+   }
+
    // 1. create the dominator tree
    domTree = new DominatorTree(&cfg);
    reinterpret_cast<DominatorTree *>(domTree)->findDominanceFrontiers();
@@ -344,13 +353,10 @@ Function::convertToSSA()
       if (!allLValues.get(var))
          continue;
       lval = reinterpret_cast<Value *>(allLValues.get(var))->asLValue();
-      if (!lval || lval->defs.empty())
+      if (!lval || lval->defs.empty() || !liveIn.test(lval->id))
          continue;
       ++iterCount;
 
-      // TODO: don't add phi functions for values that aren't used outside
-      //  the BB they're defined in
-
       // gather blocks with assignments to lval in workList
       for (Value::DefIterator d = lval->defs.begin();
            d != lval->defs.end(); ++d) {
@@ -514,6 +514,40 @@ nv50_ir_change_interp(void *interpData, uint32_t *code,
       info->apply(&info->entry[i], code, force_persample_interp, flatshade);
 }
 
+uint32_t
+nv50_ir_reloc_data_size(const void *relocData)
+{
+   const nv50_ir::RelocInfo *info =
+      reinterpret_cast<const nv50_ir::RelocInfo *>(relocData);
+
+   return sizeof(*info) + info->count * sizeof(info->entry[0]);
+}
+
+uint32_t
+nv50_ir_interp_data_size(const void *interpData)
+{
+   const nv50_ir::InterpInfo *info =
+      reinterpret_cast<const nv50_ir::InterpInfo *>(interpData);
+
+   return sizeof(*info) + info->count * sizeof(info->entry[0]);
+}
+
+void
+nv50_ir_restore_interp_data(void *interpData, uint32_t chipset)
+{
+   nv50_ir::InterpInfo *info = reinterpret_cast<nv50_ir::InterpInfo *>(
+      interpData);
+   nv50_ir::Target *targ = nv50_ir::Target::create(chipset);
+   nv50_ir::CodeEmitter *emit =
+      targ->getCodeEmitter(nv50_ir::Program::TYPE_FRAGMENT);
+
+   // The apply function pointer is only valid within one process.
+   info->apply = emit->getInterpApply();
+
+   delete emit;
+   nv50_ir::Target::destroy(targ);
+}
+
 void
 nv50_ir_get_target_library(uint32_t chipset,
                            const uint32_t **code, uint32_t *size)
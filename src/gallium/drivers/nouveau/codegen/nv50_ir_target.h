@@ -86,6 +86,10 @@ public:
 
    virtual uint32_t getMinEncodingSize(const Instruction *) const = 0;
 
+   // function patching the interpolation mode of the instructions listed in
+   // InterpInfo, needed again when the info is loaded from a cache
+   virtual InterpApply getInterpApply() const = 0;
+
    void setCodeLocation(void *, uint32_t size);
    inline void *getCodeLocation() const { return code; }
    inline uint32_t getCodeSize() const { return codeSize; }
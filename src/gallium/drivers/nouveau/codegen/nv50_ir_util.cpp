@@ -88,11 +88,29 @@ Stack::moveTo(Stack& that)
    this->size = 0;
 }
 
-Interval::Interval(const Interval& that) : head(NULL), tail(NULL)
+Interval::Interval(const Interval& that) : head(NULL), tail(NULL), pool(NULL)
 {
    this->insert(that);
 }
 
+Interval::Range *
+Interval::newRange(int a, int b)
+{
+   if (!pool)
+      return new Range(a, b);
+   void *mem = pool->allocate();
+   return mem ? new (mem) Range(a, b) : NULL;
+}
+
+void
+Interval::deleteRange(Range *r)
+{
+   if (!pool)
+      delete r;
+   else
+      pool->release(r);
+}
+
 Interval::~Interval()
 {
    clear();
@@ -103,7 +121,7 @@ Interval::clear()
 {
    for (Range *next, *r = head; r; r = next) {
       next = r->next;
-      delete r;
+      deleteRange(r);
    }
    head = tail = NULL;
 }
@@ -132,12 +150,12 @@ Interval::extend(int a, int b)
          r->bgn = a;
          if (b > r->end)
             r->end = b;
-         r->coalesce(&tail);
+         coalesce(r);
          return true;
       }
       if (b > r->end) {
          r->end = b;
-         r->coalesce(&tail);
+         coalesce(r);
          return true;
       }
       assert(a >= r->bgn);
@@ -145,7 +163,11 @@ Interval::extend(int a, int b)
       return true;
    }
 
-   (*nextp) = new Range(a, b);
+   (*nextp) = newRange(a, b);
+   if (!(*nextp)) {
+      (*nextp) = r;
+      return false;
+   }
    (*nextp)->next = r;
 
    for (r = (*nextp); r->next; r = r->next);
@@ -198,7 +220,7 @@ void Interval::unify(Interval &that)
    for (Range *next, *r = that.head; r; r = next) {
       next = r->next;
       this->extend(r->bgn, r->end);
-      delete r;
+      that.deleteRange(r);
    }
    that.head = NULL;
 }
@@ -311,6 +333,25 @@ void BitSet::setOr(BitSet *pA, BitSet *pB)
    }
 }
 
+int BitSet::findNextSet(unsigned int i) const
+{
+   const unsigned int end = (size + 31) / 32;
+   unsigned int w = i / 32;
+   uint32_t bits;
+
+   if (i >= size)
+      return -1;
+
+   bits = data[w] & (~0u << (i % 32));
+   while (!bits) {
+      if (++w == end)
+         return -1;
+      bits = data[w];
+   }
+   i = w * 32 + ffs(bits) - 1;
+   return (i < size) ? (int)i : -1;
+}
+
 int BitSet::findFreeRange(unsigned int count) const
 {
    const uint32_t m = (1 << count) - 1;
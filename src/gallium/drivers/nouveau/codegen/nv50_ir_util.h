@@ -415,13 +415,19 @@ private:
    unsigned int size;
 };
 
+class MemoryPool;
+
 class Interval
 {
 public:
-   Interval() : head(0), tail(0) { }
+   Interval() : head(0), tail(0), pool(0) { }
    Interval(const Interval&);
    ~Interval();
 
+   // allocate ranges from @pool instead of the heap, interval must be empty
+   inline void setPool(MemoryPool *p) { assert(!head); pool = p; }
+   static inline unsigned int getRangeSize() { return sizeof(Range); }
+
    bool extend(int, int);
    void insert(const Interval&);
    void unify(Interval&); // clears source interval
@@ -449,25 +455,29 @@ private:
       Range *next;
       int bgn;
       int end;
+   };
 
-      void coalesce(Range **ptail)
-      {
-         Range *rnn;
-
-         while (next && end >= next->bgn) {
-            assert(bgn <= next->bgn);
-            rnn = next->next;
-            end = MAX2(end, next->end);
-            delete next;
-            next = rnn;
-         }
-         if (!next)
-            *ptail = this;
+   Range *newRange(int a, int b);
+   void deleteRange(Range *);
+
+   void coalesce(Range *r)
+   {
+      Range *rnn;
+
+      while (r->next && r->end >= r->next->bgn) {
+         assert(r->bgn <= r->next->bgn);
+         rnn = r->next->next;
+         r->end = MAX2(r->end, r->next->end);
+         deleteRange(r->next);
+         r->next = rnn;
       }
-   };
+      if (!r->next)
+         tail = r;
+   }
 
    Range *head;
    Range *tail;
+   MemoryPool *pool;
 };
 
 class BitSet
@@ -538,6 +548,9 @@ public:
    // Find a range of size (<= 32) clear bits aligned to roundup_pow2(size).
    int findFreeRange(unsigned int size) const;
 
+   // Find the first set bit at or after position i, or -1 if there is none.
+   int findNextSet(unsigned int i) const;
+
    BitSet& operator|=(const BitSet&);
 
    BitSet& operator=(const BitSet& set)
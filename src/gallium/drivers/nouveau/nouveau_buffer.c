@@ -13,15 +13,6 @@
 
 #define NOUVEAU_TRANSFER_PUSHBUF_THRESHOLD 192
 
-struct nouveau_transfer {
-   struct pipe_transfer base;
-
-   uint8_t *map;
-   struct nouveau_bo *bo;
-   struct nouveau_mm_allocation *mm;
-   uint32_t offset;
-};
-
 static inline struct nouveau_transfer *
 nouveau_transfer(struct pipe_transfer *transfer)
 {
@@ -133,9 +124,110 @@ nouveau_buffer_destroy(struct pipe_screen *pscreen,
    NOUVEAU_DRV_STAT(nouveau_screen(pscreen), buf_obj_current_count, -1);
 }
 
+/* Release the oldest chunks of the staging ring the GPU is done with. */
+static void
+nouveau_staging_ring_reclaim(struct nouveau_context *nv)
+{
+   while (nv->staging.count) {
+      const unsigned i = nv->staging.first;
+
+      if (nv->staging.chunk[i].mapped ||
+          (nv->staging.chunk[i].fence &&
+           !nouveau_fence_signalled(nv->staging.chunk[i].fence)))
+         break;
+      nouveau_fence_ref(NULL, &nv->staging.chunk[i].fence);
+      nv->staging.tail = nv->staging.chunk[i].end;
+      nv->staging.first = (i + 1) % NOUVEAU_STAGING_RING_CHUNKS;
+      nv->staging.count--;
+   }
+   if (!nv->staging.count)
+      nv->staging.head = nv->staging.tail = 0;
+}
+
+/* Allocate @size bytes from the staging ring, returns the chunk index or -1
+ * if there is no room (the caller falls back to a GART allocation then).
+ */
+static int
+nouveau_staging_ring_alloc(struct nouveau_context *nv, unsigned size,
+                           uint32_t *offset)
+{
+   unsigned start;
+   int i;
+
+   if (size > NOUVEAU_STAGING_RING_SIZE / 4)
+      return -1;
+
+   if (!nv->staging.bo) {
+      if (nouveau_bo_new(nv->screen->device, NOUVEAU_BO_GART | NOUVEAU_BO_MAP,
+                         4096, NOUVEAU_STAGING_RING_SIZE, NULL,
+                         &nv->staging.bo))
+         return -1;
+      if (nouveau_bo_map(nv->staging.bo, 0, NULL)) {
+         nouveau_bo_ref(NULL, &nv->staging.bo);
+         return -1;
+      }
+      nv->staging.map = nv->staging.bo->map;
+   }
+
+   nouveau_staging_ring_reclaim(nv);
+   if (nv->staging.count == NOUVEAU_STAGING_RING_CHUNKS)
+      return -1;
+
+   size = align(size, NOUVEAU_MIN_BUFFER_MAP_ALIGN);
+
+   /* Chunks in use are in [tail, head) or, after wrapping around, in
+    * [tail, end) and [0, head). head never catches up with tail.
+    */
+   if (!nv->staging.count || nv->staging.head > nv->staging.tail) {
+      if (nv->staging.head + size <= NOUVEAU_STAGING_RING_SIZE)
+         start = nv->staging.head;
+      else
+      if (size < nv->staging.tail)
+         start = 0;
+      else
+         return -1;
+   } else {
+      if (nv->staging.head + size < nv->staging.tail)
+         start = nv->staging.head;
+      else
+         return -1;
+   }
+
+   i = (nv->staging.first + nv->staging.count) % NOUVEAU_STAGING_RING_CHUNKS;
+   nv->staging.chunk[i].end = start + size;
+   nv->staging.chunk[i].mapped = true;
+   nv->staging.count++;
+   nv->staging.head = start + size;
+
+   *offset = start;
+   return i;
+}
+
+/* The chunk can be reused once the commands reading it have completed. */
+static inline void
+nouveau_staging_ring_release(struct nouveau_context *nv, int i)
+{
+   nv->staging.chunk[i].mapped = false;
+   nouveau_fence_ref(nv->screen->fence.current, &nv->staging.chunk[i].fence);
+}
+
+void
+nouveau_staging_ring_fini(struct nouveau_context *nv)
+{
+   int i;
+
+   for (i = 0; i < NOUVEAU_STAGING_RING_CHUNKS; ++i)
+      nouveau_fence_ref(NULL, &nv->staging.chunk[i].fence);
+   nouveau_bo_ref(NULL, &nv->staging.bo);
+}
+
 /* Set up a staging area for the transfer. This is either done in "regular"
  * system memory if the driver supports push_data (nv50+) and the data is
  * small enough (and permit_pb == true), or in GART memory.
+ *
+ * Staging areas that are only written (permit_pb == true) come from the
+ * context's staging ring if possible, sparing an allocation. Those that are
+ * read must not: waiting for the copy into them would wait for the ring.
  */
 static uint8_t *
 nouveau_transfer_staging(struct nouveau_context *nv,
@@ -143,6 +235,7 @@ nouveau_transfer_staging(struct nouveau_context *nv,
 {
    const unsigned adj = tx->base.box.x & NOUVEAU_MIN_BUFFER_MAP_ALIGN_MASK;
    const unsigned size = align(tx->base.box.width, 4) + adj;
+   const bool permit_ring = permit_pb;
 
    if (!nv->push_data)
       permit_pb = false;
@@ -151,6 +244,14 @@ nouveau_transfer_staging(struct nouveau_context *nv,
       tx->map = align_malloc(size, NOUVEAU_MIN_BUFFER_MAP_ALIGN);
       if (tx->map)
          tx->map += adj;
+   } else
+   if (permit_ring &&
+       (tx->ring_chunk = nouveau_staging_ring_alloc(nv, size,
+                                                    &tx->offset)) >= 0) {
+      tx->bo = nv->staging.bo;
+      tx->mm = NULL;
+      tx->offset += adj;
+      tx->map = nv->staging.map + tx->offset;
    } else {
       tx->mm =
          nouveau_mm_allocate(nv->screen->mm_GART, size, &tx->bo, &tx->offset);
@@ -279,6 +380,7 @@ nouveau_buffer_transfer_init(struct nouveau_transfer *tx,
 
    tx->bo = NULL;
    tx->map = NULL;
+   tx->ring_chunk = -1;
 }
 
 static inline void
@@ -286,6 +388,9 @@ nouveau_buffer_transfer_del(struct nouveau_context *nv,
                             struct nouveau_transfer *tx)
 {
    if (tx->map) {
+      if (tx->ring_chunk >= 0) {
+         nouveau_staging_ring_release(nv, tx->ring_chunk);
+      } else
       if (likely(tx->bo)) {
          nouveau_fence_work(nv->screen->fence.current,
                             nouveau_fence_unref_bo, tx->bo);
@@ -309,6 +414,7 @@ nouveau_buffer_cache(struct nouveau_context *nv, struct nv04_resource *buf)
    tx.base.box.width = buf->base.width0;
    tx.bo = NULL;
    tx.map = NULL;
+   tx.ring_chunk = -1;
 
    if (!buf->data)
       if (!nouveau_buffer_malloc(buf))
@@ -381,7 +487,7 @@ nouveau_buffer_transfer_map(struct pipe_context *pipe,
 {
    struct nouveau_context *nv = nouveau_context(pipe);
    struct nv04_resource *buf = nv04_resource(resource);
-   struct nouveau_transfer *tx = MALLOC_STRUCT(nouveau_transfer);
+   struct nouveau_transfer *tx = util_slab_child_alloc(&nv->transfer_pool);
    uint8_t *map;
    int ret;
 
@@ -462,7 +568,7 @@ nouveau_buffer_transfer_map(struct pipe_context *pipe,
                         buf->mm ? 0 : nouveau_screen_transfer_flags(usage),
                         nv->client);
    if (ret) {
-      FREE(tx);
+      util_slab_child_free(&nv->transfer_pool, tx);
       return NULL;
    }
    map = (uint8_t *)buf->bo->map + buf->offset + box->x;
@@ -502,7 +608,7 @@ nouveau_buffer_transfer_map(struct pipe_context *pipe,
       }
    }
    if (!map)
-      FREE(tx);
+      util_slab_child_free(&nv->transfer_pool, tx);
    return map;
 }
 
@@ -559,7 +665,7 @@ nouveau_buffer_transfer_unmap(struct pipe_context *pipe,
       NOUVEAU_DRV_STAT(nv->screen, buf_write_bytes_direct, tx->base.box.width);
 
    nouveau_buffer_transfer_del(nv, tx);
-   FREE(tx);
+   util_slab_child_free(&nv->transfer_pool, tx);
 }
 
 
@@ -777,7 +883,15 @@ nouveau_buffer_migrate(struct nouveau_context *nv,
       struct nouveau_mm_allocation *mm = buf->mm;
 
       if (new_domain == NOUVEAU_BO_VRAM) {
-         /* keep a system memory copy of our data in case we hit a fallback */
+         /* keep a system memory copy of our data in case we hit a fallback,
+          * unless the GPU is still writing it: don't wait for that, the copy
+          * is read back from VRAM if it's ever needed
+          */
+         if (nouveau_buffer_busy(buf, PIPE_TRANSFER_READ)) {
+            align_free(buf->data);
+            buf->data = NULL;
+            buf->status |= NOUVEAU_BUFFER_STATUS_DIRTY;
+         } else
          if (!nouveau_buffer_data_fetch(nv, buf, buf->bo, buf->offset, size))
             return false;
          if (nouveau_mesa_debug)
@@ -806,6 +920,7 @@ nouveau_buffer_migrate(struct nouveau_context *nv,
       tx.base.box.width = buf->base.width0;
       tx.bo = NULL;
       tx.map = NULL;
+      tx.ring_chunk = -1;
       if (!nouveau_transfer_staging(nv, &tx, false))
          return false;
       nouveau_transfer_write(nv, &tx, 0, tx.base.box.width);
@@ -866,6 +981,28 @@ nouveau_scratch_unref_bos(void *d)
    FREE(b);
 }
 
+/* Runouts mean the scratch buffers are too small for what the application
+ * uploads per draw (e.g. large client vertex arrays every frame), so replace
+ * them with larger ones instead of allocating extra bos for every draw.
+ */
+static void
+nouveau_scratch_grow(struct nouveau_context *nv)
+{
+   unsigned i;
+
+   nv->scratch.bo_size = MIN2(util_next_power_of_two(nv->scratch.runout_size),
+                              NOUVEAU_MAX_SCRATCH_BO_SIZE);
+
+   for (i = 0; i < NOUVEAU_MAX_SCRATCH_BUFS; ++i) {
+      if (!nv->scratch.bo[i])
+         continue;
+      nouveau_fence_work(nv->screen->fence.current, nouveau_fence_unref_bo,
+                         nv->scratch.bo[i]);
+      nv->scratch.bo[i] = NULL;
+   }
+   nv->scratch.current = NULL;
+}
+
 void
 nouveau_scratch_runout_release(struct nouveau_context *nv)
 {
@@ -876,6 +1013,11 @@ nouveau_scratch_runout_release(struct nouveau_context *nv)
          nv->scratch.runout))
       return;
 
+   if (nv->scratch.runout_size > nv->scratch.bo_size &&
+       nv->scratch.bo_size < NOUVEAU_MAX_SCRATCH_BO_SIZE)
+      nouveau_scratch_grow(nv);
+   nv->scratch.runout_size = 0;
+
    nv->scratch.end = 0;
    nv->scratch.runout = NULL;
 }
@@ -898,6 +1040,7 @@ nouveau_scratch_runout(struct nouveau_context *nv, unsigned size)
                                  sizeof(*nv->scratch.runout) + (n + 1) * sizeof(void *));
    nv->scratch.runout->nr = n + 1;
    nv->scratch.runout->bo[n] = NULL;
+   nv->scratch.runout_size = MAX2(nv->scratch.runout_size, size);
 
    ret = nouveau_scratch_bo_alloc(nv, &nv->scratch.runout->bo[n], size);
    if (!ret) {
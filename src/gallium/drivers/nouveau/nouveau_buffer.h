@@ -52,6 +52,17 @@ struct nv04_resource {
    struct util_range valid_buffer_range;
 };
 
+/* Buffer transfers are allocated from nouveau_screen::transfer_pool. */
+struct nouveau_transfer {
+   struct pipe_transfer base;
+
+   uint8_t *map;
+   struct nouveau_bo *bo;
+   struct nouveau_mm_allocation *mm;
+   uint32_t offset;
+   int ring_chunk; /* index in nouveau_context::staging or -1 */
+};
+
 void
 nouveau_buffer_release_gpu_storage(struct nv04_resource *);
 
@@ -3,11 +3,17 @@
 
 #include "pipe/p_context.h"
 #include "pipe/p_state.h"
+#include "util/u_slab.h"
 #include <nouveau.h>
 
 #define NOUVEAU_MAX_SCRATCH_BUFS 4
+#define NOUVEAU_MAX_SCRATCH_BO_SIZE (32 << 20)
+
+#define NOUVEAU_STAGING_RING_SIZE   (1 << 20)
+#define NOUVEAU_STAGING_RING_CHUNKS 32
 
 struct nv04_resource;
+struct nouveau_fence;
 
 struct nouveau_context {
    struct pipe_context pipe;
@@ -17,6 +23,9 @@ struct nouveau_context {
    struct nouveau_pushbuf *pushbuf;
    struct pipe_debug_callback debug;
 
+   /* Cache of nouveau_screen::transfer_pool, for buffer transfers. */
+   struct util_slab_child_pool transfer_pool;
+
    bool vbo_dirty;
 
    void (*copy_data)(struct nouveau_context *,
@@ -47,9 +56,27 @@ struct nouveau_context {
          unsigned nr;
          struct nouveau_bo *bo[0];
       } *runout;
+      unsigned runout_size; /* largest runout since the last release */
       unsigned bo_size;
    } scratch;
 
+   /* GART ring for write transfer staging; chunks are recycled in allocation
+    * order once they are unmapped and their fence has signalled
+    */
+   struct {
+      struct nouveau_bo *bo;
+      uint8_t *map;
+      unsigned head; /* end of the newest chunk */
+      unsigned tail; /* start of the oldest chunk */
+      unsigned first; /* index of the oldest chunk */
+      unsigned count;
+      struct {
+         unsigned end;
+         bool mapped;
+         struct nouveau_fence *fence;
+      } chunk[NOUVEAU_STAGING_RING_CHUNKS];
+   } staging;
+
    struct {
       uint32_t buf_cache_count;
       uint32_t buf_cache_frame;
@@ -71,6 +98,9 @@ nouveau_context_init(struct nouveau_context *);
 void
 nouveau_scratch_runout_release(struct nouveau_context *);
 
+void
+nouveau_staging_ring_fini(struct nouveau_context *);
+
 /* This is needed because we don't hold references outside of context::scratch,
  * because we don't want to un-bo_ref each allocation every time. This is less
  * work, and we need the wrap index anyway for extreme situations.
@@ -99,6 +129,10 @@ nouveau_context_destroy(struct nouveau_context *ctx)
       if (ctx->scratch.bo[i])
          nouveau_bo_ref(NULL, &ctx->scratch.bo[i]);
 
+   nouveau_staging_ring_fini(ctx);
+
+   util_slab_destroy_child(&ctx->transfer_pool);
+
    FREE(ctx);
 }
 
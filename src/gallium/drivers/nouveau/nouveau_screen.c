@@ -7,6 +7,7 @@
 #include "util/u_format.h"
 #include "util/u_format_s3tc.h"
 #include "util/u_string.h"
+#include "util/disk_cache.h"
 
 #include "os/os_time.h"
 
@@ -132,6 +133,34 @@ nouveau_screen_bo_get_handle(struct pipe_screen *pscreen,
    }
 }
 
+static void
+nouveau_screen_init_disk_cache(struct nouveau_screen *screen)
+{
+   char gpu_name[32], driver_id[128];
+
+   if (!debug_get_bool_option("NOUVEAU_DISK_CACHE", false))
+      return;
+
+   snprintf(gpu_name, sizeof(gpu_name), "nouveau_%02x",
+            screen->device->chipset);
+
+   /* The options changing code generation are part of the driver identity,
+    * so that entries compiled with different ones are never mixed up.
+    */
+#ifdef DEBUG
+   snprintf(driver_id, sizeof(driver_id),
+            "nouveau " PACKAGE_VERSION " " __DATE__ " " __TIME__
+            " opt %li dbg %li",
+            debug_get_num_option("NV50_PROG_OPTIMIZE", 3),
+            debug_get_num_option("NV50_PROG_DEBUG", 0));
+#else
+   snprintf(driver_id, sizeof(driver_id),
+            "nouveau " PACKAGE_VERSION " " __DATE__ " " __TIME__);
+#endif
+
+   screen->disk_shader_cache = disk_cache_create(gpu_name, driver_id);
+}
+
 int
 nouveau_screen_init(struct nouveau_screen *screen, struct nouveau_device *dev)
 {
@@ -228,6 +257,11 @@ nouveau_screen_init(struct nouveau_screen *screen, struct nouveau_device *dev)
                                        NOUVEAU_BO_GART | NOUVEAU_BO_MAP,
                                        &mm_config);
    screen->mm_VRAM = nouveau_mm_create(dev, NOUVEAU_BO_VRAM, &mm_config);
+
+   util_slab_create_parent(&screen->transfer_pool,
+                           sizeof(struct nouveau_transfer), 64);
+
+   nouveau_screen_init_disk_cache(screen);
    return 0;
 }
 
@@ -239,6 +273,9 @@ nouveau_screen_fini(struct nouveau_screen *screen)
    nouveau_mm_destroy(screen->mm_GART);
    nouveau_mm_destroy(screen->mm_VRAM);
 
+   disk_cache_destroy(screen->disk_shader_cache);
+   util_slab_destroy_parent(&screen->transfer_pool);
+
    nouveau_pushbuf_del(&screen->pushbuf);
 
    nouveau_client_del(&screen->client);
@@ -265,4 +302,7 @@ void
 nouveau_context_init(struct nouveau_context *context)
 {
    context->pipe.set_debug_callback = nouveau_set_debug_callback;
+
+   util_slab_create_child(&context->transfer_pool,
+                          &context->screen->transfer_pool);
 }
@@ -3,6 +3,7 @@
 
 #include "pipe/p_screen.h"
 #include "util/u_memory.h"
+#include "util/u_slab.h"
 
 #ifdef DEBUG
 # define NOUVEAU_ENABLE_DRIVER_STATISTICS
@@ -14,6 +15,7 @@ typedef uint16_t u16;
 extern int nouveau_mesa_debug;
 
 struct nouveau_bo;
+struct disk_cache;
 
 struct nouveau_screen {
    struct pipe_screen base;
@@ -54,6 +56,10 @@ struct nouveau_screen {
 
    unsigned vram_domain;
 
+   struct disk_cache *disk_shader_cache; /* NULL unless NOUVEAU_DISK_CACHE */
+
+   struct util_slab_parent_pool transfer_pool;
+
    struct {
       unsigned profiles_checked;
       unsigned profiles_present;
@@ -22,7 +22,9 @@
 
 #include "pipe/p_defines.h"
 
+#include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_ureg.h"
+#include "util/disk_cache.h"
 
 #include "nvc0/nvc0_context.h"
 
@@ -517,13 +519,251 @@ nvc0_program_dump(struct nvc0_program *prog)
 }
 #endif
 
+/* Layout of the programs stored in the disk cache: this header is followed
+ * by the vp, fp and tp state and then by the variable-sized parts in the
+ * order of their sizes below.
+ */
+struct nvc0_program_cache_header {
+   uint32_t size; /* of the whole entry, to catch truncated files */
+   uint32_t code_size;
+   uint32_t immd_size;
+   uint32_t relocs_size;
+   uint32_t interps_size;
+   uint32_t num_syms;
+   uint32_t has_tfb;
+   uint32_t tls_space;
+   uint32_t instructions;
+   uint8_t num_gprs;
+   uint8_t num_barriers;
+   uint8_t need_tls;
+   uint8_t pad;
+   uint32_t hdr[20];
+   uint32_t flags[2];
+};
+
+#define NVC0_PROGRAM_CACHE_FP_SIZE 4 /* early_z, colors, color_interp[2] */
+
+static bool
+nvc0_program_cache_key(const struct nvc0_program *prog, uint16_t chipset,
+                       struct disk_cache *cache, cache_key key)
+{
+   const unsigned tokens_size =
+      tgsi_num_tokens(prog->pipe.tokens) * sizeof(struct tgsi_token);
+   const struct pipe_stream_output_info *so = &prog->pipe.stream_output;
+   uint32_t head[4];
+   uint8_t *data;
+   unsigned size;
+
+   /* Everything the translation depends on besides the driver identity. */
+   head[0] = chipset;
+   head[1] = prog->type;
+   head[2] = prog->vp.num_ucps;
+   head[3] = so->num_outputs;
+
+   size = sizeof(head) + tokens_size;
+   if (so->num_outputs)
+      size += sizeof(*so);
+
+   data = MALLOC(size);
+   if (!data)
+      return false;
+   memcpy(data, head, sizeof(head));
+   memcpy(data + sizeof(head), prog->pipe.tokens, tokens_size);
+   if (so->num_outputs)
+      memcpy(data + sizeof(head) + tokens_size, so, sizeof(*so));
+
+   disk_cache_compute_key(cache, data, size, key);
+   FREE(data);
+   return true;
+}
+
+static inline void
+nvc0_program_cache_write(uint8_t **pos, const void *data, uint32_t size)
+{
+   if (size)
+      memcpy(*pos, data, size);
+   *pos += size;
+}
+
+static void
+nvc0_program_cache_store(const struct nvc0_program *prog,
+                         const struct nv50_ir_prog_info *info,
+                         struct disk_cache *cache, const cache_key key)
+{
+   struct nvc0_program_cache_header head;
+   uint32_t syms_size = 0;
+   uint8_t *blob, *pos;
+
+   memset(&head, 0, sizeof(head));
+   head.code_size = prog->code_size;
+   head.immd_size = prog->immd_size;
+   if (prog->relocs)
+      head.relocs_size = nv50_ir_reloc_data_size(prog->relocs);
+   if (prog->interps)
+      head.interps_size = nv50_ir_interp_data_size(prog->interps);
+   if (prog->type == PIPE_SHADER_COMPUTE) {
+      head.num_syms = prog->cp.num_syms;
+      syms_size = head.num_syms * sizeof(struct nv50_ir_prog_symbol);
+   }
+   head.has_tfb = prog->tfb != NULL;
+   head.tls_space = info->bin.tlsSpace;
+   head.instructions = info->bin.instructions;
+   head.num_gprs = prog->num_gprs;
+   head.num_barriers = prog->num_barriers;
+   head.need_tls = prog->need_tls;
+   memcpy(head.hdr, prog->hdr, sizeof(head.hdr));
+   memcpy(head.flags, prog->flags, sizeof(head.flags));
+
+   head.size = sizeof(head) + sizeof(prog->vp) + NVC0_PROGRAM_CACHE_FP_SIZE +
+      sizeof(prog->tp) + head.code_size + head.immd_size + head.relocs_size +
+      head.interps_size + syms_size +
+      (head.has_tfb ? sizeof(*prog->tfb) : 0);
+
+   blob = pos = MALLOC(head.size);
+   if (!blob)
+      return;
+   nvc0_program_cache_write(&pos, &head, sizeof(head));
+   nvc0_program_cache_write(&pos, &prog->vp, sizeof(prog->vp));
+   nvc0_program_cache_write(&pos, &prog->fp.early_z, 1);
+   nvc0_program_cache_write(&pos, &prog->fp.colors, 1);
+   nvc0_program_cache_write(&pos, prog->fp.color_interp, 2);
+   nvc0_program_cache_write(&pos, &prog->tp, sizeof(prog->tp));
+   nvc0_program_cache_write(&pos, prog->code, head.code_size);
+   nvc0_program_cache_write(&pos, prog->immd_data, head.immd_size);
+   nvc0_program_cache_write(&pos, prog->relocs, head.relocs_size);
+   nvc0_program_cache_write(&pos, prog->interps, head.interps_size);
+   nvc0_program_cache_write(&pos, prog->cp.syms, syms_size);
+   if (head.has_tfb)
+      nvc0_program_cache_write(&pos, prog->tfb, sizeof(*prog->tfb));
+   assert(pos == blob + head.size);
+
+   disk_cache_put(cache, key, blob, head.size);
+   FREE(blob);
+}
+
+static inline void *
+nvc0_program_cache_read(const uint8_t **pos, uint32_t size, bool *oom)
+{
+   void *data = NULL;
+
+   if (size) {
+      data = MALLOC(size);
+      if (data)
+         memcpy(data, *pos, size);
+      else
+         *oom = true;
+   }
+   *pos += size;
+   return data;
+}
+
+/* Restore a program from the disk cache, returns false on misses. Entries
+ * that don't look like what we stored are dropped from the cache.
+ */
+static bool
+nvc0_program_cache_load(struct nvc0_program *prog, uint16_t chipset,
+                        struct disk_cache *cache, const cache_key key,
+                        struct pipe_debug_callback *debug)
+{
+   struct nvc0_program_cache_header head;
+   const uint8_t *pos;
+   uint32_t syms_size;
+   uint8_t *blob;
+   size_t size;
+   bool oom = false;
+
+   blob = disk_cache_get(cache, key, &size);
+   if (!blob)
+      return false;
+
+   if (size < sizeof(head))
+      goto invalid;
+   memcpy(&head, blob, sizeof(head));
+   syms_size = head.num_syms * sizeof(struct nv50_ir_prog_symbol);
+   if (head.size != size ||
+       (uint64_t)head.code_size + head.immd_size + head.relocs_size +
+       head.interps_size + syms_size +
+       (head.has_tfb ? sizeof(*prog->tfb) : 0) + sizeof(head) +
+       sizeof(prog->vp) + NVC0_PROGRAM_CACHE_FP_SIZE +
+       sizeof(prog->tp) != size ||
+       (head.num_syms && prog->type != PIPE_SHADER_COMPUTE))
+      goto invalid;
+
+   pos = blob + sizeof(head);
+   memcpy(&prog->vp, pos, sizeof(prog->vp));
+   pos += sizeof(prog->vp);
+   prog->fp.early_z = pos[0];
+   prog->fp.colors = pos[1];
+   prog->fp.color_interp[0] = pos[2];
+   prog->fp.color_interp[1] = pos[3];
+   pos += NVC0_PROGRAM_CACHE_FP_SIZE;
+   memcpy(&prog->tp, pos, sizeof(prog->tp));
+   pos += sizeof(prog->tp);
+
+   prog->code = nvc0_program_cache_read(&pos, head.code_size, &oom);
+   prog->immd_data = nvc0_program_cache_read(&pos, head.immd_size, &oom);
+   prog->relocs = nvc0_program_cache_read(&pos, head.relocs_size, &oom);
+   prog->interps = nvc0_program_cache_read(&pos, head.interps_size, &oom);
+   prog->cp.syms = nvc0_program_cache_read(&pos, syms_size, &oom);
+   if (head.has_tfb)
+      prog->tfb = nvc0_program_cache_read(&pos, sizeof(*prog->tfb), &oom);
+   free(blob);
+
+   if (oom) {
+      FREE(prog->code);
+      FREE(prog->immd_data);
+      FREE(prog->relocs);
+      FREE(prog->interps);
+      FREE(prog->cp.syms);
+      FREE(prog->tfb);
+      prog->code = prog->immd_data = NULL;
+      prog->relocs = prog->interps = prog->cp.syms = NULL;
+      prog->tfb = NULL;
+      return false;
+   }
+
+   if (prog->interps)
+      nv50_ir_restore_interp_data(prog->interps, chipset);
+
+   prog->code_size = head.code_size;
+   prog->immd_size = head.immd_size;
+   prog->cp.num_syms = head.num_syms;
+   prog->num_gprs = head.num_gprs;
+   prog->num_barriers = head.num_barriers;
+   prog->need_tls = head.need_tls;
+   memcpy(prog->hdr, head.hdr, sizeof(prog->hdr));
+   memcpy(prog->flags, head.flags, sizeof(prog->flags));
+
+   pipe_debug_message(debug, SHADER_INFO,
+                      "type: %d, local: %d, gpr: %d, inst: %d, bytes: %d",
+                      prog->type, head.tls_space, prog->num_gprs,
+                      head.instructions, prog->code_size);
+   return true;
+
+invalid:
+   disk_cache_remove(cache, key);
+   free(blob);
+   return false;
+}
+
 bool
 nvc0_program_translate(struct nvc0_program *prog, uint16_t chipset,
+                       struct disk_cache *cache,
                        struct pipe_debug_callback *debug)
 {
    struct nv50_ir_prog_info *info;
+   cache_key key;
    int ret;
 
+   if (cache && prog->pipe.tokens) {
+      if (!nvc0_program_cache_key(prog, chipset, cache, key))
+         cache = NULL;
+      else if (nvc0_program_cache_load(prog, chipset, cache, key, debug))
+         return true;
+   } else {
+      cache = NULL;
+   }
+
    info = CALLOC_STRUCT(nv50_ir_prog_info);
    if (!info)
       return false;
@@ -652,11 +892,49 @@ nvc0_program_translate(struct nvc0_program *prog, uint16_t chipset,
                       prog->type, info->bin.tlsSpace, prog->num_gprs,
                       info->bin.instructions, info->bin.codeSize);
 
+   if (cache)
+      nvc0_program_cache_store(prog, info, cache, key);
+
 out:
    FREE(info);
    return !ret;
 }
 
+static inline bool
+nvc0_program_is_bound(struct nvc0_context *nvc0, struct nvc0_program *prog)
+{
+   return prog == nvc0->vertprog || prog == nvc0->tctlprog ||
+          prog == nvc0->tevlprog || prog == nvc0->gmtyprog ||
+          prog == nvc0->fragprog || prog == nvc0->compprog ||
+          prog == nvc0->tcp_empty;
+}
+
+/* Find the resident program that was validated the longest time ago. Unless
+ * told otherwise, skip the ones bound to the context as they are likely to be
+ * needed by the draw being validated.
+ */
+static struct nvc0_program *
+nvc0_program_find_lru(struct nvc0_context *nvc0, struct nvc0_program *except,
+                      bool bound)
+{
+   const uint32_t serial = nvc0->screen->text_lru_serial;
+   struct nouveau_heap *heap;
+   struct nvc0_program *lru = NULL;
+
+   for (heap = nvc0->screen->text_heap; heap; heap = heap->next) {
+      struct nvc0_program *prog = heap->priv;
+
+      /* The code library has no priv pointer. */
+      if (!heap->in_use || !prog || prog == except ||
+          (!bound && nvc0_program_is_bound(nvc0, prog)))
+         continue;
+      /* Compare ages rather than serials, which may wrap around. */
+      if (!lru || serial - prog->lru_serial > serial - lru->lru_serial)
+         lru = prog;
+   }
+   return lru;
+}
+
 bool
 nvc0_program_upload_code(struct nvc0_context *nvc0, struct nvc0_program *prog)
 {
@@ -684,16 +962,25 @@ nvc0_program_upload_code(struct nvc0_context *nvc0, struct nvc0_program *prog)
 
    ret = nouveau_heap_alloc(screen->text_heap, size, prog, &prog->mem);
    if (ret) {
-      struct nouveau_heap *heap = screen->text_heap;
-      /* Note that the code library, which is allocated before anything else,
-       * does not have a priv pointer. We can stop once we hit it.
+      /* Make room by evicting the least recently used programs first, so
+       * that the ones in use don't all have to be uploaded again.
        */
-      while (heap->next && heap->next->priv) {
-         struct nvc0_program *evict = heap->next->priv;
+      struct nvc0_program *evict;
+
+      while (ret && (evict = nvc0_program_find_lru(nvc0, prog, false))) {
          nouveau_heap_free(&evict->mem);
+         ret = nouveau_heap_alloc(screen->text_heap, size, prog, &prog->mem);
       }
+      if (!ret)
+         IMMED_NVC0(nvc0->base.pushbuf, NVC0_3D(SERIALIZE), 0);
+   }
+   if (ret) {
+      struct nvc0_program *evict;
+
+      while ((evict = nvc0_program_find_lru(nvc0, prog, true)))
+         nouveau_heap_free(&evict->mem);
       debug_printf("WARNING: out of code space, evicting all shaders.\n");
-      ret = nouveau_heap_alloc(heap, size, prog, &prog->mem);
+      ret = nouveau_heap_alloc(screen->text_heap, size, prog, &prog->mem);
       if (ret) {
          NOUVEAU_ERR("shader too large (0x%x) to fit in code space ?\n", size);
          return false;
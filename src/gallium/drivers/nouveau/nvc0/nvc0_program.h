@@ -68,6 +68,8 @@ struct nvc0_program {
 
    struct nvc0_transform_feedback_state *tfb;
 
+   uint32_t lru_serial; /* last time the code was needed, for eviction */
+
    struct nouveau_heap *mem;
 };
 
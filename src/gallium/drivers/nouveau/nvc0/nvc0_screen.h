@@ -77,6 +77,7 @@ struct nvc0_screen {
 
    struct nouveau_heap *text_heap;
    struct nouveau_heap *lib_code; /* allocated from text_heap */
+   uint32_t text_lru_serial; /* bumped each time a program is validated */
 
    struct nvc0_blitter *blitter;
 
@@ -69,12 +69,15 @@ nvc0_program_update_context_state(struct nvc0_context *nvc0,
 static inline bool
 nvc0_program_validate(struct nvc0_context *nvc0, struct nvc0_program *prog)
 {
+   prog->lru_serial = ++nvc0->screen->text_lru_serial;
+
    if (prog->mem)
       return true;
 
    if (!prog->translated) {
       prog->translated = nvc0_program_translate(
-         prog, nvc0->screen->base.device->chipset, &nvc0->base.debug);
+         prog, nvc0->screen->base.device->chipset,
+         nvc0->screen->base.disk_shader_cache, &nvc0->base.debug);
       if (!prog->translated)
          return false;
    }
@@ -227,19 +227,76 @@ nvc0_release_user_vbufs(struct nvc0_context *nvc0)
    }
 }
 
+/* Upload the user vertex arrays in @mask and store the GPU address that
+ * corresponds to offset 0 of each array in @address.
+ * All arrays are packed into a single scratch allocation, so the draw only
+ * needs one buffer reference instead of one per array.
+ */
+static void
+nvc0_upload_user_vbufs(struct nvc0_context *nvc0, uint32_t mask,
+                       uint64_t address[], uint32_t base[], uint32_t size[])
+{
+   const uint32_t bo_flags = NOUVEAU_BO_RD | NOUVEAU_BO_GART;
+   struct nouveau_bo *bo = NULL;
+   uint64_t gpu_addr = 0;
+   uint8_t *map = NULL;
+   unsigned total = 0;
+   unsigned offset = 0;
+   uint32_t m;
+
+   for (m = mask; m;) {
+      const int b = ffs(m) - 1;
+      m &= ~(1 << b);
+
+      nvc0_user_vbuf_range(nvc0, b, &base[b], &size[b]);
+      total += align(size[b], 4);
+
+      NOUVEAU_DRV_STAT(&nvc0->screen->base, user_buffer_upload_bytes, size[b]);
+   }
+   if (util_bitcount(mask) > 1)
+      map = nouveau_scratch_get(&nvc0->base, total, &gpu_addr, &bo);
+   if (map)
+      BCTX_REFN_bo(nvc0->bufctx_3d, 3D_VTX_TMP, bo_flags, bo);
+
+   for (m = mask; m;) {
+      const int b = ffs(m) - 1;
+      const uint8_t *data = (const uint8_t *)nvc0->vtxbuf[b].user_buffer;
+      m &= ~(1 << b);
+
+      /* don't let the address of offset 0 wrap around below 0 */
+      if (map && gpu_addr + offset >= base[b]) {
+         memcpy(map + offset, data + base[b], size[b]);
+         address[b] = gpu_addr + offset - base[b];
+         offset += align(size[b], 4);
+      } else {
+         address[b] = nouveau_scratch_data(&nvc0->base, data,
+                                           base[b], size[b], &bo);
+         if (address[b])
+            BCTX_REFN_bo(nvc0->bufctx_3d, 3D_VTX_TMP, bo_flags, bo);
+      }
+   }
+}
+
 static void
 nvc0_update_user_vbufs(struct nvc0_context *nvc0)
 {
    uint64_t address[PIPE_MAX_ATTRIBS];
+   uint32_t vb_base[PIPE_MAX_ATTRIBS], vb_size[PIPE_MAX_ATTRIBS];
    struct nouveau_pushbuf *push = nvc0->base.pushbuf;
    int i;
-   uint32_t written = 0;
+   uint32_t mask = 0;
+
+   for (i = 0; i < nvc0->vertex->num_elements; ++i) {
+      const unsigned b = nvc0->vertex->element[i].pipe.vertex_buffer_index;
+      mask |= 1 << b;
+   }
+   mask &= nvc0->vbo_user & ~nvc0->constant_vbos;
+   nvc0_upload_user_vbufs(nvc0, mask, address, vb_base, vb_size);
 
    PUSH_SPACE(push, nvc0->vertex->num_elements * 8);
    for (i = 0; i < nvc0->vertex->num_elements; ++i) {
       struct pipe_vertex_element *ve = &nvc0->vertex->element[i].pipe;
       const unsigned b = ve->vertex_buffer_index;
-      struct pipe_vertex_buffer *vb = &nvc0->vtxbuf[b];
       uint32_t base, size;
 
       if (!(nvc0->vbo_user & (1 << b)))
@@ -248,19 +305,8 @@ nvc0_update_user_vbufs(struct nvc0_context *nvc0)
          nvc0_set_constant_vertex_attrib(nvc0, i);
          continue;
       }
-      nvc0_user_vbuf_range(nvc0, b, &base, &size);
-
-      if (!(written & (1 << b))) {
-         struct nouveau_bo *bo;
-         const uint32_t bo_flags = NOUVEAU_BO_RD | NOUVEAU_BO_GART;
-         written |= 1 << b;
-         address[b] = nouveau_scratch_data(&nvc0->base, vb->user_buffer,
-                                           base, size, &bo);
-         if (bo)
-            BCTX_REFN_bo(nvc0->bufctx_3d, 3D_VTX_TMP, bo_flags, bo);
-
-         NOUVEAU_DRV_STAT(&nvc0->screen->base, user_buffer_upload_bytes, size);
-      }
+      base = vb_base[b];
+      size = vb_size[b];
 
       BEGIN_1IC0(push, NVC0_3D(MACRO_VERTEX_ARRAY_SELECT), 5);
       PUSH_DATA (push, i);
@@ -275,33 +321,25 @@ nvc0_update_user_vbufs(struct nvc0_context *nvc0)
 static void
 nvc0_update_user_vbufs_shared(struct nvc0_context *nvc0)
 {
+   uint64_t address[PIPE_MAX_ATTRIBS];
+   uint32_t vb_base[PIPE_MAX_ATTRIBS], vb_size[PIPE_MAX_ATTRIBS];
    struct nouveau_pushbuf *push = nvc0->base.pushbuf;
    uint32_t mask = nvc0->vbo_user & ~nvc0->constant_vbos;
 
+   nvc0_upload_user_vbufs(nvc0, mask, address, vb_base, vb_size);
+
    PUSH_SPACE(push, nvc0->num_vtxbufs * 8);
    while (mask) {
-      struct nouveau_bo *bo;
-      const uint32_t bo_flags = NOUVEAU_BO_RD | NOUVEAU_BO_GART;
-      uint64_t address;
-      uint32_t base, size;
       const int b = ffs(mask) - 1;
+      const uint64_t limit = address[b] + vb_base[b] + vb_size[b] - 1;
       mask &= ~(1 << b);
 
-      nvc0_user_vbuf_range(nvc0, b, &base, &size);
-
-      address = nouveau_scratch_data(&nvc0->base, nvc0->vtxbuf[b].user_buffer,
-                                     base, size, &bo);
-      if (bo)
-         BCTX_REFN_bo(nvc0->bufctx_3d, 3D_VTX_TMP, bo_flags, bo);
-
       BEGIN_1IC0(push, NVC0_3D(MACRO_VERTEX_ARRAY_SELECT), 5);
       PUSH_DATA (push, b);
-      PUSH_DATAh(push, address + base + size - 1);
-      PUSH_DATA (push, address + base + size - 1);
-      PUSH_DATAh(push, address);
-      PUSH_DATA (push, address);
-
-      NOUVEAU_DRV_STAT(&nvc0->screen->base, user_buffer_upload_bytes, size);
+      PUSH_DATAh(push, limit);
+      PUSH_DATA (push, limit);
+      PUSH_DATAh(push, address[b]);
+      PUSH_DATA (push, address[b]);
    }
 
    mask = nvc0->state.constant_elts;
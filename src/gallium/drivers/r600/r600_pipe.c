@@ -29,12 +29,14 @@
 #include "sb/sb_public.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include "pipe/p_shader_tokens.h"
 #include "util/u_debug.h"
 #include "util/u_memory.h"
 #include "util/u_simple_shaders.h"
 #include "util/u_upload_mgr.h"
 #include "util/u_math.h"
+#include "util/disk_cache.h"
 #include "vl/vl_decoder.h"
 #include "vl/vl_video_buffer.h"
 #include "radeon/radeon_video.h"
@@ -571,9 +573,32 @@ static void r600_destroy_screen(struct pipe_screen* pscreen)
 		compute_memory_pool_delete(rscreen->global_pool);
 	}
 
+	disk_cache_destroy(rscreen->disk_shader_cache);
+
 	r600_destroy_common_screen(&rscreen->b);
 }
 
+static void r600_init_disk_shader_cache(struct r600_screen *rscreen)
+{
+	char gpu_name[32], driver_id[128];
+
+	if (!debug_get_bool_option("RADEON_DISK_CACHE", FALSE))
+		return;
+
+	snprintf(gpu_name, sizeof(gpu_name), "r600_%s",
+		 r600_get_llvm_processor_name(rscreen->b.family));
+
+	/* The bytecode also depends on the debug flags (e.g. nosb) and on
+	 * the kernel MSAA texturing support. */
+	snprintf(driver_id, sizeof(driver_id),
+		 "r600 " PACKAGE_VERSION " " __DATE__ " " __TIME__
+		 " family %u msaa %u flags %"PRIx64,
+		 rscreen->b.family, rscreen->has_compressed_msaa_texturing,
+		 rscreen->b.debug_flags);
+
+	rscreen->disk_shader_cache = disk_cache_create(gpu_name, driver_id);
+}
+
 static struct pipe_resource *r600_resource_create(struct pipe_screen *screen,
 						  const struct pipe_resource *templ)
 {
@@ -670,6 +695,8 @@ struct pipe_screen *r600_screen_create(struct radeon_winsys *ws)
 
 	rscreen->global_pool = compute_memory_pool_new(rscreen);
 
+	r600_init_disk_shader_cache(rscreen);
+
 	/* Create the auxiliary context. This must be done last. */
 	rscreen->b.aux_context = rscreen->b.b.context_create(&rscreen->b.b, NULL, 0);
 
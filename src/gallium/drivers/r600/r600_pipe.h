@@ -252,6 +252,8 @@ struct r600_gs_rings_state {
 #define DBG_SB_DISASM	(1 << 27)
 #define DBG_SB_SAFEMATH	(1 << 28)
 
+struct disk_cache;
+
 struct r600_screen {
 	struct r600_common_screen	b;
 	bool				has_msaa;
@@ -262,6 +264,8 @@ struct r600_screen {
 	 * XXX: Not sure if this is the best place for global_pool.  Also,
 	 * it's not thread safe, so it won't work with multiple contexts. */
 	struct compute_memory_pool *global_pool;
+
+	struct disk_cache		*disk_shader_cache;
 };
 
 struct r600_pipe_sampler_view {
@@ -35,6 +35,7 @@
 #include "tgsi/tgsi_dump.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
+#include "util/disk_cache.h"
 #include <stdio.h>
 #include <errno.h>
 
@@ -154,6 +155,150 @@ static int store_shader(struct pipe_context *ctx,
 	return 0;
 }
 
+/* Shaders in the disk cache: this header, a copy of struct r600_shader
+ * (only the scalar fields of which are used) and the bytecode.
+ */
+struct r600_shader_cache_header {
+	uint32_t size; /* of the whole entry, to catch truncated files */
+	uint32_t ndw;
+	uint32_t ngpr;
+	uint32_t nstack;
+	uint32_t nlds_dw;
+	uint32_t enabled_stream_buffers_mask;
+};
+
+/* Export shaders are compiled against the current geometry shader and
+ * geometry shaders come with a copy shader, neither are cached.
+ */
+static bool r600_shader_cache_enabled(struct r600_context *rctx,
+				      struct r600_pipe_shader *shader,
+				      union r600_shader_key key, bool dump)
+{
+	if (!rctx->screen->disk_shader_cache || dump)
+		return false;
+
+	switch (tgsi_get_processor_type(shader->selector->tokens)) {
+	case TGSI_PROCESSOR_VERTEX:
+		return !key.vs.as_es;
+	case TGSI_PROCESSOR_TESS_EVAL:
+		return !key.tes.as_es;
+	case TGSI_PROCESSOR_GEOMETRY:
+		return false;
+	default:
+		return true;
+	}
+}
+
+static bool r600_shader_cache_key(struct r600_context *rctx,
+				  struct r600_pipe_shader *shader,
+				  union r600_shader_key key, cache_key hash)
+{
+	struct r600_pipe_shader_selector *sel = shader->selector;
+	unsigned tokens_size = tgsi_num_tokens(sel->tokens) *
+			       sizeof(struct tgsi_token);
+	unsigned size = sizeof(key) + sizeof(sel->so) + tokens_size;
+	uint8_t *data = MALLOC(size);
+
+	if (!data)
+		return false;
+
+	memcpy(data, &key, sizeof(key));
+	memcpy(data + sizeof(key), &sel->so, sizeof(sel->so));
+	memcpy(data + sizeof(key) + sizeof(sel->so), sel->tokens, tokens_size);
+
+	disk_cache_compute_key(rctx->screen->disk_shader_cache, data, size,
+			       hash);
+	FREE(data);
+	return true;
+}
+
+static void r600_shader_cache_store(struct r600_context *rctx,
+				    struct r600_pipe_shader *shader,
+				    const cache_key hash)
+{
+	struct r600_shader_cache_header head;
+	struct r600_bytecode *bc = &shader->shader.bc;
+	uint8_t *blob;
+
+	head.size = sizeof(head) + sizeof(shader->shader) + bc->ndw * 4;
+	head.ndw = bc->ndw;
+	head.ngpr = bc->ngpr;
+	head.nstack = bc->nstack;
+	head.nlds_dw = bc->nlds_dw;
+	head.enabled_stream_buffers_mask = shader->enabled_stream_buffers_mask;
+
+	blob = MALLOC(head.size);
+	if (!blob)
+		return;
+
+	memcpy(blob, &head, sizeof(head));
+	memcpy(blob + sizeof(head), &shader->shader, sizeof(shader->shader));
+	memcpy(blob + sizeof(head) + sizeof(shader->shader), bc->bytecode,
+	       bc->ndw * 4);
+
+	disk_cache_put(rctx->screen->disk_shader_cache, hash, blob, head.size);
+	FREE(blob);
+}
+
+static bool r600_shader_cache_load(struct r600_context *rctx,
+				   struct r600_pipe_shader *shader,
+				   const cache_key hash)
+{
+	struct disk_cache *cache = rctx->screen->disk_shader_cache;
+	struct r600_shader_cache_header head;
+	struct r600_bytecode bc;
+	uint32_t *bytecode;
+	uint8_t *blob;
+	size_t size;
+
+	blob = disk_cache_get(cache, hash, &size);
+	if (!blob)
+		return false;
+
+	if (size < sizeof(head))
+		goto invalid;
+	memcpy(&head, blob, sizeof(head));
+	if (head.size != size ||
+	    head.ndw != (size - sizeof(head) - sizeof(shader->shader)) / 4 ||
+	    !head.ndw)
+		goto invalid;
+
+	bytecode = malloc(head.ndw * 4);
+	if (!bytecode) {
+		free(blob);
+		return false;
+	}
+	memcpy(bytecode, blob + sizeof(head) + sizeof(shader->shader),
+	       head.ndw * 4);
+
+	/* Only keep the scalar fields, the bytecode lists must be valid for
+	 * r600_bytecode_clear. */
+	bc = shader->shader.bc;
+	memcpy(&shader->shader, blob + sizeof(head), sizeof(shader->shader));
+	free(blob);
+
+	shader->shader.bc = bc;
+	shader->shader.arrays = NULL;
+	shader->shader.num_arrays = 0;
+	shader->shader.max_arrays = 0;
+
+	r600_bytecode_init(&shader->shader.bc, rctx->b.chip_class,
+			   rctx->b.family,
+			   rctx->screen->has_compressed_msaa_texturing);
+	shader->shader.bc.bytecode = bytecode;
+	shader->shader.bc.ndw = head.ndw;
+	shader->shader.bc.ngpr = head.ngpr;
+	shader->shader.bc.nstack = head.nstack;
+	shader->shader.bc.nlds_dw = head.nlds_dw;
+	shader->enabled_stream_buffers_mask = head.enabled_stream_buffers_mask;
+	return true;
+
+invalid:
+	disk_cache_remove(cache, hash);
+	free(blob);
+	return false;
+}
+
 int r600_pipe_shader_create(struct pipe_context *ctx,
 			    struct r600_pipe_shader *shader,
 			    union r600_shader_key key)
@@ -166,9 +311,17 @@ int r600_pipe_shader_create(struct pipe_context *ctx,
 	unsigned use_sb = !(rctx->screen->b.debug_flags & DBG_NO_SB);
 	unsigned sb_disasm = use_sb || (rctx->screen->b.debug_flags & DBG_SB_DISASM);
 	unsigned export_shader;
+	bool use_cache = r600_shader_cache_enabled(rctx, shader, key, dump);
+	cache_key hash;
 
 	shader->shader.bc.isa = rctx->isa;
 
+	if (use_cache) {
+		use_cache = r600_shader_cache_key(rctx, shader, key, hash);
+		if (use_cache && r600_shader_cache_load(rctx, shader, hash))
+			goto store;
+	}
+
 	if (dump) {
 		fprintf(stderr, "--------------------------------------------------------------\n");
 		tgsi_dump(sel->tokens, 0);
@@ -228,6 +381,10 @@ int r600_pipe_shader_create(struct pipe_context *ctx,
 			goto error;
 	}
 
+	if (use_cache)
+		r600_shader_cache_store(rctx, shader, hash);
+
+store:
 	/* Store the shader in a buffer. */
 	if ((r = store_shader(ctx, shader)))
 		goto error;
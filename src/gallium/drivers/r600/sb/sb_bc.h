@@ -643,6 +643,9 @@ public:
 	static unsigned dskip_end;
 	static unsigned dskip_mode;
 
+	// max processing time per shader in ms (0 - unlimited)
+	static unsigned time_budget;
+
 	sb_context() : src_stats(), opt_stats(), isa(0),
 			hw_chip(HW_CHIP_UNKNOWN), hw_class(HW_CLASS_UNKNOWN) {}
 
@@ -67,6 +67,8 @@ sb_context *r600_sb_context_create(struct r600_context *rctx) {
 	sb_context::dskip_end = debug_get_num_option("R600_SB_DSKIP_END", 0);
 	sb_context::dskip_mode = debug_get_num_option("R600_SB_DSKIP_MODE", 0);
 
+	sb_context::time_budget = debug_get_num_option("R600_SB_TIME_BUDGET", 0);
+
 	return sctx;
 }
 
@@ -101,7 +103,8 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 	}
 
 	int64_t time_start = 0;
-	if (sb_context::dump_stat) {
+	const int64_t time_budget = sb_context::time_budget * 1000000LL;
+	if (sb_context::dump_stat || time_budget) {
 		time_start = os_time_get_nano();
 	}
 
@@ -159,6 +162,7 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 
 #define SB_RUN_PASS(n, dump) \
 	do { \
+		int64_t pass_start = time_start ? os_time_get_nano() : 0; \
 		r = n(*sh).run(); \
 		if (r) { \
 			sblog << "sb: error (" << r << ") in the " << #n << " pass.\n"; \
@@ -168,6 +172,17 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 			delete sh; \
 			return 0; \
 		} \
+		if (time_start) { \
+			int64_t pass_end = os_time_get_nano(); \
+			SB_DUMP_STAT( sblog << "sb: " << #n << " pass: " \
+				<< ((double)(pass_end - pass_start))/1000000.0 << " ms\n"; ); \
+			if (time_budget && pass_end - time_start > time_budget) { \
+				SB_DUMP_STAT( sblog << "sb: time budget exceeded in the " \
+					<< #n << " pass, using unoptimized bytecode...\n"; ); \
+				delete sh; \
+				return 0; \
+			} \
+		} \
 		if (dump) { \
 			SB_DUMP_PASS( sblog << "\n\n###### after " << #n << "\n"; \
 				sh->dump_ir();); \
@@ -217,7 +217,11 @@ class gcm : public pass {
 	sched_queue bu_ready_next[SQ_NUM];
 	sched_queue bu_ready_early[SQ_NUM];
 	sched_queue ready;
-	sched_queue ready_above;
+
+	// ops released by the bottom-up pass that are placed in a bb above the
+	// current one, grouped by that bb
+	typedef std::map<bb_node*, sched_queue> bb_queue_map;
+	bb_queue_map ready_above;
 
 	container_node pending;
 
@@ -163,6 +163,13 @@ bool r600_init_resource(struct r600_common_screen *rscreen,
 		flags |= RADEON_FLAG_NO_CPU_ACCESS;
 	}
 
+	/* Textures and shared buffers may be exported, which requires a
+	 * buffer of their own.
+	 */
+	if (res->b.b.target != PIPE_BUFFER ||
+	    res->b.b.bind & PIPE_BIND_SHARED)
+		flags |= RADEON_FLAG_HANDLE;
+
 	if (rscreen->debug_flags & DBG_NO_WC)
 		flags &= ~RADEON_FLAG_GTT_WC;
 
@@ -255,7 +262,7 @@ static void *r600_buffer_get_transfer(struct pipe_context *ctx,
 				      unsigned offset)
 {
 	struct r600_common_context *rctx = (struct r600_common_context*)ctx;
-	struct r600_transfer *transfer = util_slab_alloc(&rctx->pool_transfers);
+	struct r600_transfer *transfer = util_slab_child_alloc(&rctx->pool_transfers);
 
 	transfer->transfer.resource = resource;
 	transfer->transfer.level = level;
@@ -355,22 +362,37 @@ static void *r600_buffer_transfer_map(struct pipe_context *ctx,
 			    PIPE_TRANSFER_PERSISTENT)) &&
 		 rbuffer->domains == RADEON_DOMAIN_VRAM &&
 		 r600_can_dma_copy_buffer(rctx, 0, box->x, box->width)) {
-		struct r600_resource *staging;
+		struct r600_resource *staging = NULL;
+		unsigned offset;
+
+		/* The staging memory is sub-allocated from a ring of cached
+		 * GTT buffers, so that repeated readbacks don't create a new
+		 * buffer each time.
+		 */
+		u_upload_alloc(rctx->readback_uploader, 0,
+			       box->width + (box->x % R600_MAP_BUFFER_ALIGNMENT),
+			       256, &offset, (struct pipe_resource**)&staging,
+			       (void**)&data);
 
-		staging = (struct r600_resource*) pipe_buffer_create(
-				ctx->screen, PIPE_BIND_TRANSFER_READ, PIPE_USAGE_STAGING,
-				box->width + (box->x % R600_MAP_BUFFER_ALIGNMENT));
 		if (staging) {
 			/* Copy the VRAM buffer to the staging buffer. */
 			rctx->dma_copy(ctx, &staging->b.b, 0,
-				       box->x % R600_MAP_BUFFER_ALIGNMENT,
+				       offset + box->x % R600_MAP_BUFFER_ALIGNMENT,
 				       0, 0, resource, level, box);
 
-			data = r600_buffer_map_sync_with_rings(rctx, staging, PIPE_TRANSFER_READ);
-			data += box->x % R600_MAP_BUFFER_ALIGNMENT;
+			/* Wait for the copy. The ring buffer is mapped
+			 * persistently, so the pointer from u_upload_alloc
+			 * stays valid.
+			 */
+			if (r600_buffer_map_sync_with_rings(rctx, staging,
+							    PIPE_TRANSFER_READ)) {
+				data += box->x % R600_MAP_BUFFER_ALIGNMENT;
 
-			return r600_buffer_get_transfer(ctx, resource, level, usage, box,
-							ptransfer, data, staging, 0);
+				return r600_buffer_get_transfer(ctx, resource, level,
+								usage, box, ptransfer,
+								data, staging, offset);
+			}
+			pipe_resource_reference((struct pipe_resource**)&staging, NULL);
 		}
 	}
 
@@ -437,7 +459,7 @@ static void r600_buffer_transfer_unmap(struct pipe_context *ctx,
 	if (rtransfer->staging)
 		pipe_resource_reference((struct pipe_resource**)&rtransfer->staging, NULL);
 
-	util_slab_free(&rctx->pool_transfers, transfer);
+	util_slab_child_free(&rctx->pool_transfers, transfer);
 }
 
 static const struct u_resource_vtbl r600_buffer_vtbl =
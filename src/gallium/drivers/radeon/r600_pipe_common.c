@@ -261,9 +261,7 @@ static void r600_set_debug_callback(struct pipe_context *ctx,
 bool r600_common_context_init(struct r600_common_context *rctx,
 			      struct r600_common_screen *rscreen)
 {
-	util_slab_create(&rctx->pool_transfers,
-			 sizeof(struct r600_transfer), 64,
-			 UTIL_SLAB_SINGLETHREADED);
+	util_slab_create_child(&rctx->pool_transfers, &rscreen->pool_transfers);
 
 	rctx->screen = rscreen;
 	rctx->ws = rscreen->ws;
@@ -311,6 +309,12 @@ bool r600_common_context_init(struct r600_common_context *rctx,
 	if (!rctx->uploader)
 		return false;
 
+	rctx->readback_uploader = u_upload_create(&rctx->b, 1024 * 1024,
+						  PIPE_BIND_TRANSFER_READ,
+						  PIPE_USAGE_STAGING);
+	if (!rctx->readback_uploader)
+		return false;
+
 	rctx->ctx = rctx->ws->ctx_create(rctx->ws);
 	if (!rctx->ctx)
 		return false;
@@ -337,8 +341,11 @@ void r600_common_context_cleanup(struct r600_common_context *rctx)
 	if (rctx->uploader) {
 		u_upload_destroy(rctx->uploader);
 	}
+	if (rctx->readback_uploader) {
+		u_upload_destroy(rctx->readback_uploader);
+	}
 
-	util_slab_destroy(&rctx->pool_transfers);
+	util_slab_destroy_child(&rctx->pool_transfers);
 
 	if (rctx->allocator_so_filled_size) {
 		u_suballocator_destroy(rctx->allocator_so_filled_size);
@@ -900,6 +907,8 @@ bool r600_common_screen_init(struct r600_common_screen *rscreen,
 	util_format_s3tc_init();
 	pipe_mutex_init(rscreen->aux_context_lock);
 	pipe_mutex_init(rscreen->gpu_load_mutex);
+	util_slab_create_parent(&rscreen->pool_transfers,
+				sizeof(struct r600_transfer), 64);
 
 	if (rscreen->debug_flags & DBG_INFO) {
 		printf("pci_id = 0x%x\n", rscreen->info.pci_id);
@@ -946,6 +955,8 @@ void r600_destroy_common_screen(struct r600_common_screen *rscreen)
 	pipe_mutex_destroy(rscreen->aux_context_lock);
 	rscreen->aux_context->destroy(rscreen->aux_context);
 
+	util_slab_destroy_parent(&rscreen->pool_transfers);
+
 	rscreen->ws->destroy(rscreen->ws);
 	FREE(rscreen);
 }
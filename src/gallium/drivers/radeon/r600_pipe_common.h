@@ -42,6 +42,7 @@
 #include "util/u_slab.h"
 #include "util/u_suballoc.h"
 #include "util/u_transfer.h"
+#include "os/os_time.h"
 
 #define ATI_VENDOR_ID 0x1002
 
@@ -98,6 +99,16 @@
 struct r600_common_context;
 struct r600_perfcounters;
 
+/* Phases of draw_vbo whose CPU time is reported by the draw-time queries. */
+enum r600_draw_time_phase {
+	R600_DRAW_TIME_TOTAL,
+	R600_DRAW_TIME_SHADERS,
+	R600_DRAW_TIME_DESCRIPTORS,
+	R600_DRAW_TIME_CS_SPACE,
+	R600_DRAW_TIME_STATE_EMIT,
+	R600_NUM_DRAW_TIME_PHASES
+};
+
 struct radeon_shader_reloc {
 	char name[32];
 	uint64_t offset;
@@ -311,6 +322,13 @@ struct r600_common_screen {
 	 * are loading shaders on demand. This is a monotonic counter.
 	 */
 	unsigned			num_shaders_created;
+	/* Shader variants compiled for a new key, either at draw time or
+	 * ahead of time by the compiler threads. */
+	unsigned			num_shader_variants;
+
+	/* Transfers of all contexts; each context allocates from its own
+	 * child pool. */
+	struct util_slab_parent_pool	pool_transfers;
 
 	/* GPU load thread. */
 	pipe_mutex			gpu_load_mutex;
@@ -411,8 +429,10 @@ struct r600_common_context {
 	unsigned			last_compressed_colortex_counter;
 
 	struct u_upload_mgr		*uploader;
+	/* Cached GTT memory for reading back VRAM buffers. */
+	struct u_upload_mgr		*readback_uploader;
 	struct u_suballocator		*allocator_so_filled_size;
-	struct util_slab_mempool	pool_transfers;
+	struct util_slab_child_pool	pool_transfers;
 
 	/* Current unaccounted memory usage. */
 	uint64_t			vram;
@@ -441,6 +461,12 @@ struct r600_common_context {
 	unsigned			max_db; /* for OQ */
 	/* Misc stats. */
 	unsigned			num_draw_calls;
+	uint64_t			num_cs_buffers; /* summed over flushed gfx IBs */
+
+	/* CPU time spent in draw_vbo, in nanoseconds. Clocks are only read
+	 * while a draw-time query is active. */
+	unsigned			num_draw_time_queries;
+	uint64_t			draw_time[R600_NUM_DRAW_TIME_PHASES];
 
 	/* Render condition. */
 	struct r600_atom		render_cond_atom;
@@ -638,6 +664,18 @@ r600_resource_reference(struct r600_resource **ptr, struct r600_resource *res)
 				(struct pipe_resource *)res);
 }
 
+/* Charge the time since *last to the given draw_vbo phase and restart
+ * the clock. */
+static inline void
+r600_draw_time_account(struct r600_common_context *rctx,
+		       enum r600_draw_time_phase phase, int64_t *last)
+{
+	int64_t now = os_time_get_nano();
+
+	rctx->draw_time[phase] += now - *last;
+	*last = now;
+}
+
 static inline unsigned r600_tex_aniso_filter(unsigned filter)
 {
 	if (filter <= 1)   return 0;
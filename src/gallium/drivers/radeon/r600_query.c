@@ -100,6 +100,21 @@ static boolean r600_query_sw_begin(struct r600_common_context *rctx,
 	case R600_QUERY_NUM_SHADERS_CREATED:
 		query->begin_result = p_atomic_read(&rctx->screen->num_shaders_created);
 		break;
+	case R600_QUERY_DRAW_TIME:
+	case R600_QUERY_DRAW_TIME_SHADERS:
+	case R600_QUERY_DRAW_TIME_DESCRIPTORS:
+	case R600_QUERY_DRAW_TIME_CS_SPACE:
+	case R600_QUERY_DRAW_TIME_STATE_EMIT:
+		rctx->num_draw_time_queries++;
+		query->begin_result =
+			rctx->draw_time[query->b.type - R600_QUERY_DRAW_TIME];
+		break;
+	case R600_QUERY_NUM_SHADER_VARIANTS:
+		query->begin_result = p_atomic_read(&rctx->screen->num_shader_variants);
+		break;
+	case R600_QUERY_NUM_CS_BUFFERS:
+		query->begin_result = rctx->num_cs_buffers;
+		break;
 	case R600_QUERY_GPIN_ASIC_ID:
 	case R600_QUERY_GPIN_NUM_SIMD:
 	case R600_QUERY_GPIN_NUM_RB:
@@ -152,6 +167,22 @@ static void r600_query_sw_end(struct r600_common_context *rctx,
 	case R600_QUERY_NUM_SHADERS_CREATED:
 		query->end_result = p_atomic_read(&rctx->screen->num_shaders_created);
 		break;
+	case R600_QUERY_DRAW_TIME:
+	case R600_QUERY_DRAW_TIME_SHADERS:
+	case R600_QUERY_DRAW_TIME_DESCRIPTORS:
+	case R600_QUERY_DRAW_TIME_CS_SPACE:
+	case R600_QUERY_DRAW_TIME_STATE_EMIT:
+		assert(rctx->num_draw_time_queries);
+		rctx->num_draw_time_queries--;
+		query->end_result =
+			rctx->draw_time[query->b.type - R600_QUERY_DRAW_TIME];
+		break;
+	case R600_QUERY_NUM_SHADER_VARIANTS:
+		query->end_result = p_atomic_read(&rctx->screen->num_shader_variants);
+		break;
+	case R600_QUERY_NUM_CS_BUFFERS:
+		query->end_result = rctx->num_cs_buffers;
+		break;
 	case R600_QUERY_GPIN_ASIC_ID:
 	case R600_QUERY_GPIN_NUM_SIMD:
 	case R600_QUERY_GPIN_NUM_RB:
@@ -206,6 +237,11 @@ static boolean r600_query_sw_get_result(struct r600_common_context *rctx,
 	switch (query->b.type) {
 	case R600_QUERY_BUFFER_WAIT_TIME:
 	case R600_QUERY_GPU_TEMPERATURE:
+	case R600_QUERY_DRAW_TIME:
+	case R600_QUERY_DRAW_TIME_SHADERS:
+	case R600_QUERY_DRAW_TIME_DESCRIPTORS:
+	case R600_QUERY_DRAW_TIME_CS_SPACE:
+	case R600_QUERY_DRAW_TIME_STATE_EMIT:
 		result->u64 /= 1000;
 		break;
 	case R600_QUERY_CURRENT_GPU_SCLK:
@@ -1151,6 +1187,16 @@ static struct pipe_driver_query_info r600_driver_query_list[] = {
 	X("VRAM-usage",			VRAM_USAGE,		BYTES, AVERAGE),
 	X("GTT-usage",			GTT_USAGE,		BYTES, AVERAGE),
 
+	/* CPU overhead of draw calls. The draw-time queries only make the
+	 * driver read the clock while they are active. */
+	X("draw-time",			DRAW_TIME,		MICROSECONDS, CUMULATIVE),
+	X("draw-time-shaders",		DRAW_TIME_SHADERS,	MICROSECONDS, CUMULATIVE),
+	X("draw-time-descriptors",	DRAW_TIME_DESCRIPTORS,	MICROSECONDS, CUMULATIVE),
+	X("draw-time-cs-space",		DRAW_TIME_CS_SPACE,	MICROSECONDS, CUMULATIVE),
+	X("draw-time-state-emit",	DRAW_TIME_STATE_EMIT,	MICROSECONDS, CUMULATIVE),
+	X("num-shader-variants",	NUM_SHADER_VARIANTS,	UINT64, CUMULATIVE),
+	X("num-cs-buffers",		NUM_CS_BUFFERS,		UINT64, CUMULATIVE),
+
 	/* GPIN queries are for the benefit of old versions of GPUPerfStudio,
 	 * which use it as a fallback path to detect the GPU type.
 	 *
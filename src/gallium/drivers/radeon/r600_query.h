@@ -59,6 +59,13 @@ struct r600_resource;
 #define R600_QUERY_GPIN_NUM_RB		(PIPE_QUERY_DRIVER_SPECIFIC + 16)
 #define R600_QUERY_GPIN_NUM_SPI		(PIPE_QUERY_DRIVER_SPECIFIC + 17)
 #define R600_QUERY_GPIN_NUM_SE		(PIPE_QUERY_DRIVER_SPECIFIC + 18)
+#define R600_QUERY_DRAW_TIME		(PIPE_QUERY_DRIVER_SPECIFIC + 19)
+#define R600_QUERY_DRAW_TIME_SHADERS	(PIPE_QUERY_DRIVER_SPECIFIC + 20)
+#define R600_QUERY_DRAW_TIME_DESCRIPTORS (PIPE_QUERY_DRIVER_SPECIFIC + 21)
+#define R600_QUERY_DRAW_TIME_CS_SPACE	(PIPE_QUERY_DRIVER_SPECIFIC + 22)
+#define R600_QUERY_DRAW_TIME_STATE_EMIT	(PIPE_QUERY_DRIVER_SPECIFIC + 23)
+#define R600_QUERY_NUM_SHADER_VARIANTS	(PIPE_QUERY_DRIVER_SPECIFIC + 24)
+#define R600_QUERY_NUM_CS_BUFFERS	(PIPE_QUERY_DRIVER_SPECIFIC + 25)
 #define R600_QUERY_FIRST_PERFCOUNTER	(PIPE_QUERY_DRIVER_SPECIFIC + 100)
 
 enum {
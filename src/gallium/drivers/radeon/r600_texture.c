@@ -1174,9 +1174,10 @@ static void *r600_texture_transfer_map(struct pipe_context *ctx,
 		return NULL;
 	}
 
-	trans = CALLOC_STRUCT(r600_transfer);
+	trans = util_slab_child_alloc(&rctx->pool_transfers);
 	if (!trans)
 		return NULL;
+	memset(trans, 0, sizeof(*trans));
 	trans->transfer.resource = texture;
 	trans->transfer.level = level;
 	trans->transfer.usage = usage;
@@ -1202,7 +1203,7 @@ static void *r600_texture_transfer_map(struct pipe_context *ctx,
 
 			if (!r600_init_flushed_depth_texture(ctx, &resource, &staging_depth)) {
 				R600_ERR("failed to create temporary texture to hold untiled copy\n");
-				FREE(trans);
+				util_slab_child_free(&rctx->pool_transfers, trans);
 				return NULL;
 			}
 
@@ -1210,7 +1211,7 @@ static void *r600_texture_transfer_map(struct pipe_context *ctx,
 				struct pipe_resource *temp = ctx->screen->resource_create(ctx->screen, &resource);
 				if (!temp) {
 					R600_ERR("failed to create a temporary depth texture\n");
-					FREE(trans);
+					util_slab_child_free(&rctx->pool_transfers, trans);
 					return NULL;
 				}
 
@@ -1225,7 +1226,7 @@ static void *r600_texture_transfer_map(struct pipe_context *ctx,
 			/* XXX: when discard is true, no need to read back from depth texture */
 			if (!r600_init_flushed_depth_texture(ctx, texture, &staging_depth)) {
 				R600_ERR("failed to create temporary texture to hold untiled copy\n");
-				FREE(trans);
+				util_slab_child_free(&rctx->pool_transfers, trans);
 				return NULL;
 			}
 
@@ -1253,7 +1254,7 @@ static void *r600_texture_transfer_map(struct pipe_context *ctx,
 		staging = (struct r600_texture*)ctx->screen->resource_create(ctx->screen, &resource);
 		if (!staging) {
 			R600_ERR("failed to create temporary texture to hold untiled copy\n");
-			FREE(trans);
+			util_slab_child_free(&rctx->pool_transfers, trans);
 			return NULL;
 		}
 		trans->staging = &staging->resource;
@@ -1279,7 +1280,7 @@ static void *r600_texture_transfer_map(struct pipe_context *ctx,
 
 	if (!(map = r600_buffer_map_sync_with_rings(rctx, buf, usage))) {
 		pipe_resource_reference((struct pipe_resource**)&trans->staging, NULL);
-		FREE(trans);
+		util_slab_child_free(&rctx->pool_transfers, trans);
 		return NULL;
 	}
 
@@ -1290,6 +1291,7 @@ static void *r600_texture_transfer_map(struct pipe_context *ctx,
 static void r600_texture_transfer_unmap(struct pipe_context *ctx,
 					struct pipe_transfer* transfer)
 {
+	struct r600_common_context *rctx = (struct r600_common_context*)ctx;
 	struct r600_transfer *rtransfer = (struct r600_transfer*)transfer;
 	struct pipe_resource *texture = transfer->resource;
 	struct r600_texture *rtex = (struct r600_texture*)texture;
@@ -1308,7 +1310,7 @@ static void r600_texture_transfer_unmap(struct pipe_context *ctx,
 	if (rtransfer->staging)
 		pipe_resource_reference((struct pipe_resource**)&rtransfer->staging, NULL);
 
-	FREE(transfer);
+	util_slab_child_free(&rctx->pool_transfers, transfer);
 }
 
 static const struct u_resource_vtbl r600_texture_vtbl =
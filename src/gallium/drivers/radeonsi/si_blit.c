@@ -203,6 +203,8 @@ static void si_blit_decompress_depth_in_place(struct si_context *sctx,
 
 	surf_tmpl.format = texture->resource.b.b.format;
 
+	util_blitter_begin_batch(sctx->blitter);
+
 	for (level = first_level; level <= last_level; level++) {
 		if (!(*dirty_level_mask & (1 << level)))
 			continue;
@@ -236,6 +238,8 @@ static void si_blit_decompress_depth_in_place(struct si_context *sctx,
 		}
 	}
 
+	util_blitter_end_batch(sctx->blitter);
+
 	sctx->db_flush_depth_inplace = false;
 	sctx->db_flush_stencil_inplace = false;
 	si_mark_atom_dirty(sctx, &sctx->db_render_state);
@@ -281,6 +285,8 @@ static void si_blit_decompress_color(struct pipe_context *ctx,
 	if (!rtex->dirty_level_mask && !need_dcc_decompress)
 		return;
 
+	util_blitter_begin_batch(sctx->blitter);
+
 	for (level = first_level; level <= last_level; level++) {
 		void* custom_blend;
 
@@ -322,6 +328,8 @@ static void si_blit_decompress_color(struct pipe_context *ctx,
 			rtex->dirty_level_mask &= ~(1 << level);
 		}
 	}
+
+	util_blitter_end_batch(sctx->blitter);
 }
 
 static void
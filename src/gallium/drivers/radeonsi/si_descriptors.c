@@ -108,6 +108,7 @@ static void si_init_descriptors(struct si_descriptors *desc,
 	desc->element_dw_size = element_dw_size;
 	desc->num_elements = num_elements;
 	desc->list_dirty = true; /* upload the list before the next draw */
+	desc->active_mask = u_bit_consecutive64(0, num_elements);
 	desc->shader_userdata_offset = shader_userdata_index * 4;
 
 	/* Initialize the array to NULL descriptors if the element size is 8. */
@@ -128,7 +129,9 @@ static void si_release_descriptors(struct si_descriptors *desc)
 static bool si_upload_descriptors(struct si_context *sctx,
 				  struct si_descriptors *desc)
 {
-	unsigned list_size = desc->num_elements * desc->element_dw_size * 4;
+	unsigned element_size = desc->element_dw_size * 4;
+	unsigned list_size = desc->num_elements * element_size;
+	uint64_t mask = desc->active_mask;
 	void *ptr;
 
 	if (!desc->list_dirty)
@@ -140,7 +143,18 @@ static bool si_upload_descriptors(struct si_context *sctx,
 	if (!desc->buffer)
 		return false; /* skip the draw call */
 
-	util_memcpy_cpu_to_le32(ptr, desc->list, list_size);
+	/* Only copy the elements that shaders can read. The space for the
+	 * whole list is still allocated, so that the shader pointer doesn't
+	 * depend on which elements are active.
+	 */
+	while (mask) {
+		int start, count;
+
+		u_bit_scan_consecutive_range64(&mask, &start, &count);
+		util_memcpy_cpu_to_le32((char*)ptr + start * element_size,
+					desc->list + start * desc->element_dw_size,
+					count * element_size);
+	}
 
 	radeon_add_to_buffer_list(&sctx->b, &sctx->b.gfx, desc->buffer,
 			      RADEON_USAGE_READ, RADEON_PRIO_DESCRIPTORS);
@@ -1250,6 +1264,56 @@ void si_emit_shader_userdata(struct si_context *sctx, struct r600_atom *atom)
 	si_emit_shader_pointer(sctx, &sctx->vertex_buffers, sh_base[PIPE_SHADER_VERTEX], false);
 }
 
+/* ACTIVE DESCRIPTORS */
+
+static void si_set_active_descriptor_mask(struct si_descriptors *desc,
+					  uint64_t new_active_mask)
+{
+	/* Elements that weren't active before may be stale or undefined in
+	 * the last uploaded copy, so the list must be uploaded again.
+	 */
+	if (new_active_mask & ~desc->active_mask)
+		desc->list_dirty = true;
+
+	desc->active_mask = new_active_mask;
+}
+
+/**
+ * Update the elements of the descriptor lists of a shader stage that can be
+ * read by the selector bound to that stage. Elements used by the driver
+ * itself (e.g. in prologs and epilogs) are always active.
+ */
+void si_set_active_descriptors(struct si_context *sctx, unsigned shader,
+			       struct si_shader_selector *sel)
+{
+	uint64_t const_mask = 1llu << SI_DRIVER_STATE_CONST_BUF;
+	uint64_t sampler_mask = 1llu << SI_POLY_STIPPLE_SAMPLER;
+	uint64_t image_mask = 0;
+	unsigned i;
+
+	if (sel) {
+		const struct tgsi_shader_info *info = &sel->info;
+
+		for (i = 0; i < SI_NUM_USER_CONST_BUFFERS; i++)
+			if (info->const_file_max[i] >= 0)
+				const_mask |= 1llu << i;
+
+		sampler_mask |= u_bit_consecutive64(0,
+			MIN2(MAX2(info->file_max[TGSI_FILE_SAMPLER],
+				  info->file_max[TGSI_FILE_SAMPLER_VIEW]) + 1,
+			     SI_NUM_USER_SAMPLERS));
+		image_mask = u_bit_consecutive64(0,
+			MIN2(info->file_max[TGSI_FILE_IMAGE] + 1,
+			     SI_NUM_IMAGES));
+	}
+
+	si_set_active_descriptor_mask(&sctx->const_buffers[shader].desc,
+				      const_mask);
+	si_set_active_descriptor_mask(&sctx->samplers[shader].views.desc,
+				      sampler_mask);
+	si_set_active_descriptor_mask(&sctx->images[shader].desc, image_mask);
+}
+
 /* INIT/DEINIT/UPLOAD */
 
 void si_init_all_descriptors(struct si_context *sctx)
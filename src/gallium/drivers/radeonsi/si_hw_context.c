@@ -117,6 +117,8 @@ void si_context_gfx_flush(void *context, unsigned flags,
 		ws->cs_get_buffer_list(cs, ctx->last_bo_list);
 	}
 
+	ctx->b.num_cs_buffers += ws->cs_get_buffer_list(cs, NULL);
+
 	/* Flush the CS. */
 	ws->cs_flush(cs, flags, &ctx->last_gfx_fence);
 
@@ -31,6 +31,25 @@
 #include "util/u_memory.h"
 #include "vl/vl_decoder.h"
 
+#include <unistd.h>
+
+/* Used by both the context and the shader compiler threads. */
+static LLVMTargetMachineRef si_create_llvm_target_machine(struct si_screen *sscreen)
+{
+	const char *triple = "amdgcn--";
+
+	return LLVMCreateTargetMachine(radeon_llvm_get_r600_target(triple), triple,
+				       r600_get_llvm_processor_name(sscreen->b.family),
+#if HAVE_LLVM >= 0x0308
+				       sscreen->b.debug_flags & DBG_SI_SCHED ?
+					       "+DumpCode,+vgpr-spilling,+si-scheduler" :
+#endif
+					       "+DumpCode,+vgpr-spilling",
+				       sscreen->llvm_opt_level,
+				       LLVMRelocDefault,
+				       LLVMCodeModelDefault);
+}
+
 /*
  * pipe_context
  */
@@ -77,7 +96,8 @@ static void si_destroy_context(struct pipe_context *context)
 
 	r600_common_context_cleanup(&sctx->b);
 
-	LLVMDisposeTargetMachine(sctx->tm);
+	if (sctx->tm)
+		LLVMDisposeTargetMachine(sctx->tm);
 
 	r600_resource_reference(&sctx->trace_buf, NULL);
 	r600_resource_reference(&sctx->last_trace_buf, NULL);
@@ -104,8 +124,6 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen,
 	struct si_context *sctx = CALLOC_STRUCT(si_context);
 	struct si_screen* sscreen = (struct si_screen *)screen;
 	struct radeon_winsys *ws = sscreen->b.ws;
-	LLVMTargetRef r600_target;
-	const char *triple = "amdgcn--";
 	int shader, i;
 
 	if (!sctx)
@@ -208,18 +226,7 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen,
 	 */
 	sctx->scratch_waves = 32 * sscreen->b.info.num_good_compute_units;
 
-	/* Initialize LLVM TargetMachine */
-	r600_target = radeon_llvm_get_r600_target(triple);
-	sctx->tm = LLVMCreateTargetMachine(r600_target, triple,
-					   r600_get_llvm_processor_name(sscreen->b.family),
-#if HAVE_LLVM >= 0x0308
-					   sscreen->b.debug_flags & DBG_SI_SCHED ?
-					   	"+DumpCode,+vgpr-spilling,+si-scheduler" :
-#endif
-					   	"+DumpCode,+vgpr-spilling",
-					   LLVMCodeGenLevelDefault,
-					   LLVMRelocDefault,
-					   LLVMCodeModelDefault);
+	sctx->tm = si_create_llvm_target_machine(sscreen);
 
 	return &sctx->b.b;
 fail:
@@ -563,6 +570,13 @@ static void si_destroy_screen(struct pipe_screen* pscreen)
 	if (!sscreen->b.ws->unref(sscreen->b.ws))
 		return;
 
+	if (util_queue_is_initialized(&sscreen->shader_compiler_queue))
+		util_queue_destroy(&sscreen->shader_compiler_queue);
+
+	for (i = 0; i < ARRAY_SIZE(sscreen->tm); i++)
+		if (sscreen->tm[i])
+			LLVMDisposeTargetMachine(sscreen->tm[i]);
+
 	/* Free shader parts. */
 	for (i = 0; i < ARRAY_SIZE(parts); i++) {
 		while (parts[i]) {
@@ -610,6 +624,7 @@ static bool si_init_gs_info(struct si_screen *sscreen)
 struct pipe_screen *radeonsi_screen_create(struct radeon_winsys *ws)
 {
 	struct si_screen *sscreen = CALLOC_STRUCT(si_screen);
+	unsigned num_cpus, num_compiler_threads, i;
 
 	if (!sscreen) {
 		return NULL;
@@ -632,6 +647,28 @@ struct pipe_screen *radeonsi_screen_create(struct radeon_winsys *ws)
 		return NULL;
 	}
 
+	/* Codegen level of the LLVM backend. Lower levels trade shader
+	 * quality for compile time, which matters for huge compute shaders.
+	 */
+	sscreen->llvm_opt_level = CLAMP(debug_get_num_option("RADEON_LLVM_OPT_LEVEL",
+							     LLVMCodeGenLevelDefault),
+					LLVMCodeGenLevelNone,
+					LLVMCodeGenLevelAggressive);
+
+	/* Compile shaders in the background if there are spare CPU cores.
+	 * Without the queue, shaders are compiled by the calling thread.
+	 */
+	num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	num_compiler_threads = MIN2(num_cpus, ARRAY_SIZE(sscreen->tm));
+
+	if (num_cpus > 1) {
+		for (i = 0; i < num_compiler_threads; i++)
+			sscreen->tm[i] = si_create_llvm_target_machine(sscreen);
+
+		util_queue_init(&sscreen->shader_compiler_queue, "si_shader",
+				32, num_compiler_threads);
+	}
+
 	if (!debug_get_bool_option("RADEON_DISABLE_PERFCOUNTERS", FALSE))
 		si_init_perfcounters(sscreen);
 
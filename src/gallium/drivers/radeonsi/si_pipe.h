@@ -27,6 +27,7 @@
 #define SI_PIPE_H
 
 #include "si_state.h"
+#include "util/u_queue.h"
 
 #include <llvm-c/TargetMachine.h>
 
@@ -81,6 +82,7 @@
 
 struct si_compute;
 struct hash_table;
+struct disk_cache;
 
 struct si_screen {
 	struct r600_common_screen	b;
@@ -110,6 +112,16 @@ struct si_screen {
 	 */
 	pipe_mutex			shader_cache_mutex;
 	struct hash_table		*shader_cache;
+
+	/* Persistent tier of the shader cache. Entries are stored under the
+	 * same TGSI key and survive process restarts. NULL if disabled.
+	 */
+	struct disk_cache		*disk_shader_cache;
+
+	/* Shader compiler queue for multithreaded compilation. */
+	struct util_queue		shader_compiler_queue;
+	LLVMTargetMachineRef		tm[4]; /* used by the queue only */
+	LLVMCodeGenOptLevel		llvm_opt_level; /* for all target machines */
 };
 
 struct si_blend_color {
@@ -6494,22 +6494,85 @@ static bool si_shader_select_ps_parts(struct si_screen *sscreen,
 	return true;
 }
 
+/* Whether the main part was compiled for the hw stage of the shader. */
+static bool si_main_part_matches(struct si_shader *shader,
+				 struct si_shader *mainp)
+{
+	switch (shader->selector->type) {
+	case PIPE_SHADER_VERTEX:
+		return shader->key.vs.as_es == mainp->key.vs.as_es &&
+		       shader->key.vs.as_ls == mainp->key.vs.as_ls;
+	case PIPE_SHADER_TESS_EVAL:
+		return shader->key.tes.as_es == mainp->key.tes.as_es;
+	default:
+		return true;
+	}
+}
+
+/**
+ * Return the main part for the hw stage of the shader. If the selector has
+ * separate main parts but none for this stage, compile one now. That's
+ * still a lot cheaper than compiling monolithic variants for every
+ * prolog/epilog key in that stage.
+ *
+ * Must be called with the selector mutex locked. Returns NULL if the
+ * shader has to be compiled as a monolithic shader.
+ */
+static struct si_shader *si_get_main_shader_part(struct si_screen *sscreen,
+						 LLVMTargetMachineRef tm,
+						 struct si_shader *shader,
+						 struct pipe_debug_callback *debug)
+{
+	struct si_shader_selector *sel = shader->selector;
+	struct si_shader *mainp;
+	unsigned i;
+
+	if (!sel->main_shader_part)
+		return NULL;
+
+	if (si_main_part_matches(shader, sel->main_shader_part))
+		return sel->main_shader_part;
+
+	for (i = 0; i < ARRAY_SIZE(sel->extra_main_parts); i++) {
+		if (!sel->extra_main_parts[i])
+			break;
+		if (si_main_part_matches(shader, sel->extra_main_parts[i]))
+			return sel->extra_main_parts[i];
+	}
+
+	if (i == ARRAY_SIZE(sel->extra_main_parts))
+		return NULL;
+
+	mainp = CALLOC_STRUCT(si_shader);
+	if (!mainp)
+		return NULL;
+
+	mainp->selector = sel;
+	if (sel->type == PIPE_SHADER_VERTEX) {
+		mainp->key.vs.as_es = shader->key.vs.as_es;
+		mainp->key.vs.as_ls = shader->key.vs.as_ls;
+	} else if (sel->type == PIPE_SHADER_TESS_EVAL) {
+		mainp->key.tes.as_es = shader->key.tes.as_es;
+	}
+
+	if (si_compile_tgsi_shader(sscreen, tm, mainp, false, debug)) {
+		FREE(mainp);
+		return NULL;
+	}
+
+	sel->extra_main_parts[i] = mainp;
+	return mainp;
+}
+
 int si_shader_create(struct si_screen *sscreen, LLVMTargetMachineRef tm,
 		     struct si_shader *shader,
 		     struct pipe_debug_callback *debug)
 {
-	struct si_shader *mainp = shader->selector->main_shader_part;
+	struct si_shader *mainp = si_get_main_shader_part(sscreen, tm, shader,
+							  debug);
 	int r;
 
-	/* LS, ES, VS are compiled on demand if the main part hasn't been
-	 * compiled for that stage.
-	 */
-	if (!mainp ||
-	    (shader->selector->type == PIPE_SHADER_VERTEX &&
-	     (shader->key.vs.as_es != mainp->key.vs.as_es ||
-	      shader->key.vs.as_ls != mainp->key.vs.as_ls)) ||
-	    (shader->selector->type == PIPE_SHADER_TESS_EVAL &&
-	     shader->key.tes.as_es != mainp->key.tes.as_es)) {
+	if (!mainp) {
 		/* Monolithic shader (compiled as a whole, has many variants,
 		 * may take a long time to compile).
 		 */
@@ -6519,9 +6582,9 @@ int si_shader_create(struct si_screen *sscreen, LLVMTargetMachineRef tm,
 	} else {
 		/* The shader consists of 2-3 parts:
 		 *
-		 * - the middle part is the user shader, it has 1 variant only
-		 *   and it was compiled during the creation of the shader
-		 *   selector
+		 * - the middle part is the user shader, it has 1 variant per
+		 *   hw stage; the one for the predicted stage was compiled
+		 *   during the creation of the shader selector
 		 * - the prolog part is inserted at the beginning
 		 * - the epilog part is inserted at the end
 		 *
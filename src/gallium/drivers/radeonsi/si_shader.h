@@ -70,6 +70,7 @@
 
 #include <llvm-c/Core.h> /* LLVMModuleRef */
 #include "tgsi/tgsi_scan.h"
+#include "util/u_queue.h"
 #include "si_state.h"
 
 struct radeon_shader_binary;
@@ -179,6 +180,13 @@ struct si_shader;
  * binaries for one TGSI program. This can be shared by multiple contexts.
  */
 struct si_shader_selector {
+	struct si_screen	*screen;
+	struct util_queue_fence ready;
+
+	/* Only used when the selector is compiled by the calling thread. */
+	LLVMTargetMachineRef	tm;
+	struct pipe_debug_callback debug;
+
 	pipe_mutex		mutex;
 	struct si_shader	*first_variant; /* immutable after the first variant */
 	struct si_shader	*last_variant; /* mutable */
@@ -188,6 +196,12 @@ struct si_shader_selector {
 	 */
 	struct si_shader	*main_shader_part;
 
+	/* Main parts compiled on demand when the shader is used in a stage
+	 * other than the one predicted by TGSI_PROPERTY_NEXT_SHADER (VS as
+	 * LS, ES or hw VS; TES as ES or hw VS). Protected by the mutex.
+	 */
+	struct si_shader	*extra_main_parts[2];
+
 	struct tgsi_token       *tokens;
 	struct pipe_stream_output_info  so;
 	struct tgsi_shader_info		info;
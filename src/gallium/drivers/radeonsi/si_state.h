@@ -35,6 +35,7 @@
 
 struct si_screen;
 struct si_shader;
+struct si_shader_selector;
 
 struct si_state_blend {
 	struct si_pm4_state	pm4;
@@ -198,6 +199,12 @@ struct si_descriptors {
 	/* The i-th bit is set if that element is enabled (non-NULL resource). */
 	uint64_t enabled_mask;
 
+	/* The i-th bit is set if that element can be read by the bound
+	 * shaders. Only those elements are copied when the list is uploaded;
+	 * the others are left undefined in the uploaded copy.
+	 */
+	uint64_t active_mask;
+
 	/* The shader userdata offset within a shader where the 64-bit pointer to the descriptor
 	 * array will be stored. */
 	unsigned shader_userdata_offset;
@@ -251,6 +258,8 @@ void si_all_descriptors_begin_new_cs(struct si_context *sctx);
 void si_upload_const_buffer(struct si_context *sctx, struct r600_resource **rbuffer,
 			    const uint8_t *ptr, unsigned size, uint32_t *const_offset);
 void si_shader_change_notify(struct si_context *sctx);
+void si_set_active_descriptors(struct si_context *sctx, unsigned shader,
+			       struct si_shader_selector *sel);
 void si_update_compressed_colortex_masks(struct si_context *sctx);
 void si_emit_shader_userdata(struct si_context *sctx, struct r600_atom *atom);
 
@@ -749,6 +749,9 @@ void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
 	struct si_state_rasterizer *rs = sctx->queued.named.rasterizer;
 	struct pipe_index_buffer ib = {};
 	unsigned mask, dirty_fb_counter;
+	int64_t start_time = 0, phase_time = 0;
+	bool timed;
+	bool ok;
 
 	if (!info->count && !info->indirect &&
 	    (info->indexed || !info->count_from_stream_output))
@@ -779,6 +782,12 @@ void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
 
 	si_decompress_textures(sctx);
 
+	/* Start timing after decompression, because decompress blits go
+	 * through draw_vbo and time themselves. */
+	timed = unlikely(sctx->b.num_draw_time_queries != 0);
+	if (timed)
+		start_time = phase_time = os_time_get_nano();
+
 	/* Set the rasterization primitive type.
 	 *
 	 * This must be done after si_decompress_textures, which can call
@@ -792,8 +801,16 @@ void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
 	else
 		sctx->current_rast_prim = info->mode;
 
-	if (!si_update_shaders(sctx) ||
-	    !si_upload_shader_descriptors(sctx))
+	ok = si_update_shaders(sctx);
+	if (timed)
+		r600_draw_time_account(&sctx->b, R600_DRAW_TIME_SHADERS, &phase_time);
+	if (!ok)
+		return;
+
+	ok = si_upload_shader_descriptors(sctx);
+	if (timed)
+		r600_draw_time_account(&sctx->b, R600_DRAW_TIME_DESCRIPTORS, &phase_time);
+	if (!ok)
 		return;
 
 	if (info->indexed) {
@@ -857,7 +874,11 @@ void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
 	if (sctx->b.flags)
 		si_mark_atom_dirty(sctx, sctx->atoms.s.cache_flush);
 
+	if (timed)
+		phase_time = os_time_get_nano();
 	si_need_cs_space(sctx);
+	if (timed)
+		r600_draw_time_account(&sctx->b, R600_DRAW_TIME_CS_SPACE, &phase_time);
 
 	/* Emit states. */
 	mask = sctx->dirty_atoms;
@@ -877,6 +898,9 @@ void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
 	if (sctx->trace_buf)
 		si_trace_emit(sctx);
 
+	if (timed)
+		r600_draw_time_account(&sctx->b, R600_DRAW_TIME_STATE_EMIT, &phase_time);
+
 	/* Workaround for a VGT hang when streamout is enabled.
 	 * It must be done after drawing. */
 	if ((sctx->b.family == CHIP_HAWAII ||
@@ -913,6 +937,10 @@ void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
 
 	pipe_resource_reference(&ib.buffer, NULL);
 	sctx->b.num_draw_calls++;
+
+	if (timed)
+		sctx->b.draw_time[R600_DRAW_TIME_TOTAL] +=
+			os_time_get_nano() - start_time;
 }
 
 void si_trace_emit(struct si_context *sctx)
@@ -32,12 +32,15 @@
 
 #include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_ureg.h"
+#include "util/disk_cache.h"
 #include "util/hash_table.h"
 #include "util/u_hash.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
 #include "util/u_simple_shaders.h"
 
+#include <inttypes.h>
+
 /* SHADER_CACHE */
 
 /**
@@ -188,6 +191,63 @@ static bool si_shader_cache_insert_shader(struct si_screen *sscreen,
 		return false;
 	}
 
+	if (sscreen->disk_shader_cache) {
+		cache_key key;
+
+		disk_cache_compute_key(sscreen->disk_shader_cache, tgsi_binary,
+				       *(uint32_t*)tgsi_binary, key);
+		disk_cache_put(sscreen->disk_shader_cache, key, hw_binary,
+			       *(uint32_t*)hw_binary);
+	}
+
+	return true;
+}
+
+/**
+ * Look the shader up in the disk cache. On success, the binary is also
+ * added to the in-memory cache, so that it's only read from disk once per
+ * process.
+ */
+static bool si_shader_cache_load_disk_shader(struct si_screen *sscreen,
+					     void *tgsi_binary,
+					     struct si_shader *shader)
+{
+	uint32_t tgsi_size = *(uint32_t*)tgsi_binary;
+	void *hw_binary, *key_copy, *entry_data;
+	cache_key key;
+	size_t size;
+
+	disk_cache_compute_key(sscreen->disk_shader_cache, tgsi_binary,
+			       tgsi_size, key);
+	hw_binary = disk_cache_get(sscreen->disk_shader_cache, key, &size);
+	if (!hw_binary)
+		return false;
+
+	/* The first dword is the size of the binary. Mismatches mean the
+	 * file was truncated or corrupted. */
+	if (size < 8 || *(uint32_t*)hw_binary != size ||
+	    !si_load_shader_binary(shader, hw_binary)) {
+		disk_cache_remove(sscreen->disk_shader_cache, key);
+		free(hw_binary);
+		return false;
+	}
+
+	/* In-memory entries are freed with FREE, so they need copies. */
+	key_copy = MALLOC(tgsi_size);
+	entry_data = MALLOC(size);
+	if (key_copy && entry_data) {
+		memcpy(key_copy, tgsi_binary, tgsi_size);
+		memcpy(entry_data, hw_binary, size);
+		if (_mesa_hash_table_insert(sscreen->shader_cache, key_copy,
+					    entry_data) == NULL) {
+			FREE(key_copy);
+			FREE(entry_data);
+		}
+	} else {
+		FREE(key_copy);
+		FREE(entry_data);
+	}
+	free(hw_binary);
 	return true;
 }
 
@@ -197,8 +257,13 @@ static bool si_shader_cache_load_shader(struct si_screen *sscreen,
 {
 	struct hash_entry *entry =
 		_mesa_hash_table_search(sscreen->shader_cache, tgsi_binary);
-	if (!entry)
+	if (!entry) {
+		if (sscreen->disk_shader_cache)
+			return si_shader_cache_load_disk_shader(sscreen,
+								tgsi_binary,
+								shader);
 		return false;
+	}
 
 	return si_load_shader_binary(shader, entry->data);
 }
@@ -227,6 +292,29 @@ static void si_destroy_shader_cache_entry(struct hash_entry *entry)
 	FREE(entry->data);
 }
 
+static void si_init_disk_shader_cache(struct si_screen *sscreen)
+{
+	char gpu_name[32], driver_id[128];
+
+	if (!debug_get_bool_option("RADEON_DISK_CACHE", FALSE))
+		return;
+
+	snprintf(gpu_name, sizeof(gpu_name), "radeonsi_%s",
+		 r600_get_llvm_processor_name(sscreen->b.family));
+
+	/* Binaries depend on the chip family, the compiler and the debug
+	 * flags that change code generation, so all of them are part of the
+	 * driver identity folded into every key.
+	 */
+	snprintf(driver_id, sizeof(driver_id),
+		 "radeonsi " PACKAGE_VERSION " " __DATE__ " " __TIME__
+		 " family %u LLVM %i.%i.%i flags %"PRIx64,
+		 sscreen->b.family, (HAVE_LLVM >> 8) & 0xff, HAVE_LLVM & 0xff,
+		 MESA_LLVM_VERSION_PATCH, sscreen->b.debug_flags);
+
+	sscreen->disk_shader_cache = disk_cache_create(gpu_name, driver_id);
+}
+
 bool si_init_shader_cache(struct si_screen *sscreen)
 {
 	pipe_mutex_init(sscreen->shader_cache_mutex);
@@ -234,11 +322,16 @@ bool si_init_shader_cache(struct si_screen *sscreen)
 		_mesa_hash_table_create(NULL,
 					si_shader_cache_key_hash,
 					si_shader_cache_key_equals);
-	return sscreen->shader_cache != NULL;
+	if (!sscreen->shader_cache)
+		return false;
+
+	si_init_disk_shader_cache(sscreen);
+	return true;
 }
 
 void si_destroy_shader_cache(struct si_screen *sscreen)
 {
+	disk_cache_destroy(sscreen->disk_shader_cache);
 	if (sscreen->shader_cache)
 		_mesa_hash_table_destroy(sscreen->shader_cache,
 					 si_destroy_shader_cache_entry);
@@ -977,12 +1070,19 @@ static inline void si_shader_selector_key(struct pipe_context *ctx,
 	}
 }
 
-/* Select the hw shader variant depending on the current state. */
-static int si_shader_select_with_key(struct pipe_context *ctx,
+/* Select the hw shader variant depending on the current state.
+ *
+ * thread_index is the index of the compiler thread calling this, or -1 for
+ * the thread owning the context. Only the latter needs to wait for the
+ * selector to be ready.
+ */
+static int si_shader_select_with_key(struct si_screen *sscreen,
+				     LLVMTargetMachineRef tm,
+				     struct pipe_debug_callback *debug,
 				     struct si_shader_ctx_state *state,
-				     union si_shader_key *key)
+				     union si_shader_key *key,
+				     int thread_index)
 {
-	struct si_context *sctx = (struct si_context *)ctx;
 	struct si_shader_selector *sel = state->cso;
 	struct si_shader *current = state->current;
 	struct si_shader *iter, *shader = NULL;
@@ -995,6 +1095,12 @@ static int si_shader_select_with_key(struct pipe_context *ctx,
 	if (likely(current && memcmp(&current->key, key, sizeof(*key)) == 0))
 		return 0;
 
+	/* This must be done before the mutex is locked, because the compiler
+	 * thread holds the mutex while pre-compiling variants.
+	 */
+	if (thread_index < 0)
+		util_queue_job_wait(&sel->ready);
+
 	pipe_mutex_lock(sel->mutex);
 
 	/* Find the shader variant. */
@@ -1017,7 +1123,7 @@ static int si_shader_select_with_key(struct pipe_context *ctx,
 	shader->selector = sel;
 	shader->key = *key;
 
-	r = si_shader_create(sctx->screen, sctx->tm, shader, &sctx->b.debug);
+	r = si_shader_create(sscreen, tm, shader, debug);
 	if (unlikely(r)) {
 		R600_ERR("Failed to build shader variant (type=%u) %d\n",
 			 sel->type, r);
@@ -1026,6 +1132,7 @@ static int si_shader_select_with_key(struct pipe_context *ctx,
 		return r;
 	}
 	si_shader_init_pm4_state(shader);
+	p_atomic_inc(&sscreen->b.num_shader_variants);
 
 	if (!sel->last_variant) {
 		sel->first_variant = shader;
@@ -1042,10 +1149,12 @@ static int si_shader_select_with_key(struct pipe_context *ctx,
 static int si_shader_select(struct pipe_context *ctx,
 			    struct si_shader_ctx_state *state)
 {
+	struct si_context *sctx = (struct si_context *)ctx;
 	union si_shader_key key;
 
 	si_shader_selector_key(ctx, state->cso, &key);
-	return si_shader_select_with_key(ctx, state, &key);
+	return si_shader_select_with_key(sctx->screen, sctx->tm,
+					 &sctx->b.debug, state, &key, -1);
 }
 
 static void si_parse_next_shader_property(const struct tgsi_shader_info *info,
@@ -1073,6 +1182,105 @@ static void si_parse_next_shader_property(const struct tgsi_shader_info *info,
 	}
 }
 
+/* Compile the main shader part and pre-compile the variants that are
+ * expected to be used. This is the job executed by the shader compiler
+ * queue; thread_index is -1 if it's called by the thread creating the
+ * selector.
+ */
+static void si_init_shader_selector_async(void *job, int thread_index)
+{
+	struct si_shader_selector *sel = (struct si_shader_selector *)job;
+	struct si_screen *sscreen = sel->screen;
+	LLVMTargetMachineRef tm;
+	struct pipe_debug_callback *debug;
+	int i;
+
+	if (thread_index >= 0) {
+		assert(thread_index < ARRAY_SIZE(sscreen->tm));
+		tm = sscreen->tm[thread_index];
+		debug = NULL;
+	} else {
+		tm = sel->tm;
+		debug = &sel->debug;
+	}
+
+	/* Compile the main shader part for use with a prolog and/or epilog. */
+	if (sel->type != PIPE_SHADER_GEOMETRY &&
+	    !sscreen->use_monolithic_shaders) {
+		struct si_shader *shader = CALLOC_STRUCT(si_shader);
+		void *tgsi_binary;
+
+		if (!shader) {
+			fprintf(stderr, "radeonsi: can't allocate a main shader part\n");
+			return;
+		}
+
+		shader->selector = sel;
+		si_parse_next_shader_property(&sel->info, &shader->key);
+
+		tgsi_binary = si_get_tgsi_binary(sel);
+
+		/* Try to load the shader from the shader cache. */
+		pipe_mutex_lock(sscreen->shader_cache_mutex);
+
+		if (tgsi_binary &&
+		    si_shader_cache_load_shader(sscreen, tgsi_binary, shader)) {
+			FREE(tgsi_binary);
+		} else {
+			/* Compile the shader if it hasn't been loaded from the cache. */
+			if (si_compile_tgsi_shader(sscreen, tm, shader, false,
+						   debug) != 0) {
+				FREE(shader);
+				FREE(tgsi_binary);
+				pipe_mutex_unlock(sscreen->shader_cache_mutex);
+				fprintf(stderr, "radeonsi: can't compile a main shader part\n");
+				return;
+			}
+
+			if (tgsi_binary &&
+			    !si_shader_cache_insert_shader(sscreen, tgsi_binary, shader))
+				FREE(tgsi_binary);
+		}
+		pipe_mutex_unlock(sscreen->shader_cache_mutex);
+
+		sel->main_shader_part = shader;
+	}
+
+	/* Pre-compilation. With separate shader parts and a compiler
+	 * thread, the default variant is cheap to build here and is the
+	 * one most likely to be selected at draw time.
+	 */
+	if (sel->type == PIPE_SHADER_GEOMETRY ||
+	    (thread_index >= 0 && !sscreen->use_monolithic_shaders) ||
+	    sscreen->b.debug_flags & DBG_PRECOMPILE) {
+		struct si_shader_ctx_state state = {sel};
+		union si_shader_key key;
+
+		memset(&key, 0, sizeof(key));
+		si_parse_next_shader_property(&sel->info, &key);
+
+		/* Set reasonable defaults, so that the shader key doesn't
+		 * cause any code to be eliminated.
+		 */
+		switch (sel->type) {
+		case PIPE_SHADER_TESS_CTRL:
+			key.tcs.epilog.prim_mode = PIPE_PRIM_TRIANGLES;
+			break;
+		case PIPE_SHADER_FRAGMENT:
+			key.ps.epilog.alpha_func = PIPE_FUNC_ALWAYS;
+			for (i = 0; i < 8; i++)
+				if (sel->info.colors_written & (1 << i))
+					key.ps.epilog.spi_shader_col_format |=
+						V_028710_SPI_SHADER_FP16_ABGR << (i * 4);
+			break;
+		}
+
+		if (si_shader_select_with_key(sscreen, tm, debug, &state, &key,
+					      thread_index))
+			fprintf(stderr, "radeonsi: can't create a shader\n");
+	}
+}
+
 static void *si_create_shader_selector(struct pipe_context *ctx,
 				       const struct pipe_shader_state *state)
 {
@@ -1090,6 +1298,7 @@ static void *si_create_shader_selector(struct pipe_context *ctx,
 		return NULL;
 	}
 
+	sel->screen = sscreen;
 	sel->so = state->stream_output;
 	tgsi_scan_shader(state->tokens, &sel->info);
 	sel->type = util_pipe_shader_from_tgsi_processor(sel->info.processor);
@@ -1192,82 +1401,24 @@ static void *si_create_shader_selector(struct pipe_context *ctx,
 		sel->db_shader_control |= S_02880C_EXEC_ON_HIER_FAIL(1) |
 					  S_02880C_EXEC_ON_NOOP(1);
 
-	/* Compile the main shader part for use with a prolog and/or epilog. */
-	if (sel->type != PIPE_SHADER_GEOMETRY &&
-	    !sscreen->use_monolithic_shaders) {
-		struct si_shader *shader = CALLOC_STRUCT(si_shader);
-		void *tgsi_binary;
-
-		if (!shader)
-			goto error;
-
-		shader->selector = sel;
-		si_parse_next_shader_property(&sel->info, &shader->key);
-
-		tgsi_binary = si_get_tgsi_binary(sel);
-
-		/* Try to load the shader from the shader cache. */
-		pipe_mutex_lock(sscreen->shader_cache_mutex);
-
-		if (tgsi_binary &&
-		    si_shader_cache_load_shader(sscreen, tgsi_binary, shader)) {
-			FREE(tgsi_binary);
-		} else {
-			/* Compile the shader if it hasn't been loaded from the cache. */
-			if (si_compile_tgsi_shader(sscreen, sctx->tm, shader, false,
-						   &sctx->b.debug) != 0) {
-				FREE(shader);
-				FREE(tgsi_binary);
-				pipe_mutex_unlock(sscreen->shader_cache_mutex);
-				goto error;
-			}
-
-			if (tgsi_binary &&
-			    !si_shader_cache_insert_shader(sscreen, tgsi_binary, shader))
-				FREE(tgsi_binary);
-		}
-		pipe_mutex_unlock(sscreen->shader_cache_mutex);
-
-		sel->main_shader_part = shader;
-	}
-
-	/* Pre-compilation. */
-	if (sel->type == PIPE_SHADER_GEOMETRY ||
-	    sscreen->b.debug_flags & DBG_PRECOMPILE) {
-		struct si_shader_ctx_state state = {sel};
-		union si_shader_key key;
-
-		memset(&key, 0, sizeof(key));
-		si_parse_next_shader_property(&sel->info, &key);
-
-		/* Set reasonable defaults, so that the shader key doesn't
-		 * cause any code to be eliminated.
-		 */
-		switch (sel->type) {
-		case PIPE_SHADER_TESS_CTRL:
-			key.tcs.epilog.prim_mode = PIPE_PRIM_TRIANGLES;
-			break;
-		case PIPE_SHADER_FRAGMENT:
-			key.ps.epilog.alpha_func = PIPE_FUNC_ALWAYS;
-			for (i = 0; i < 8; i++)
-				if (sel->info.colors_written & (1 << i))
-					key.ps.epilog.spi_shader_col_format |=
-						V_028710_SPI_SHADER_FP16_ABGR << (i * 4);
-			break;
-		}
+	pipe_mutex_init(sel->mutex);
+	util_queue_fence_init(&sel->ready);
 
-		if (si_shader_select_with_key(ctx, &state, &key))
-			goto error;
+	/* Compile the shader in the background if possible. The debug
+	 * callback can't be called from another thread, so don't use the
+	 * queue if it's set.
+	 */
+	if (util_queue_is_initialized(&sscreen->shader_compiler_queue) &&
+	    !sctx->b.debug.debug_message) {
+		util_queue_add_job(&sscreen->shader_compiler_queue, sel,
+				   &sel->ready, si_init_shader_selector_async);
+	} else {
+		sel->tm = sctx->tm;
+		sel->debug = sctx->b.debug;
+		si_init_shader_selector_async(sel, -1);
 	}
 
-	pipe_mutex_init(sel->mutex);
 	return sel;
-
-error:
-	fprintf(stderr, "radeonsi: can't create a shader\n");
-	tgsi_free_tokens(sel->tokens);
-	FREE(sel);
-	return NULL;
 }
 
 /**
@@ -1299,6 +1450,7 @@ static void si_bind_vs_shader(struct pipe_context *ctx, void *state)
 
 	sctx->vs_shader.cso = sel;
 	sctx->vs_shader.current = sel ? sel->first_variant : NULL;
+	si_set_active_descriptors(sctx, PIPE_SHADER_VERTEX, sel);
 	si_mark_atom_dirty(sctx, &sctx->clip_regs);
 	si_update_viewports_and_scissors(sctx);
 }
@@ -1314,6 +1466,7 @@ static void si_bind_gs_shader(struct pipe_context *ctx, void *state)
 
 	sctx->gs_shader.cso = sel;
 	sctx->gs_shader.current = sel ? sel->first_variant : NULL;
+	si_set_active_descriptors(sctx, PIPE_SHADER_GEOMETRY, sel);
 	si_mark_atom_dirty(sctx, &sctx->clip_regs);
 	sctx->last_rast_prim = -1; /* reset this so that it gets updated */
 
@@ -1333,6 +1486,7 @@ static void si_bind_tcs_shader(struct pipe_context *ctx, void *state)
 
 	sctx->tcs_shader.cso = sel;
 	sctx->tcs_shader.current = sel ? sel->first_variant : NULL;
+	si_set_active_descriptors(sctx, PIPE_SHADER_TESS_CTRL, sel);
 
 	if (enable_changed)
 		sctx->last_tcs = NULL; /* invalidate derived tess state */
@@ -1349,6 +1503,7 @@ static void si_bind_tes_shader(struct pipe_context *ctx, void *state)
 
 	sctx->tes_shader.cso = sel;
 	sctx->tes_shader.current = sel ? sel->first_variant : NULL;
+	si_set_active_descriptors(sctx, PIPE_SHADER_TESS_EVAL, sel);
 	si_mark_atom_dirty(sctx, &sctx->clip_regs);
 	sctx->last_rast_prim = -1; /* reset this so that it gets updated */
 
@@ -1370,6 +1525,7 @@ static void si_bind_ps_shader(struct pipe_context *ctx, void *state)
 
 	sctx->ps_shader.cso = sel;
 	sctx->ps_shader.current = sel ? sel->first_variant : NULL;
+	si_set_active_descriptors(sctx, PIPE_SHADER_FRAGMENT, sel);
 	si_mark_atom_dirty(sctx, &sctx->cb_render_state);
 }
 
@@ -1420,6 +1576,9 @@ static void si_delete_shader_selector(struct pipe_context *ctx, void *state)
 		[PIPE_SHADER_GEOMETRY] = &sctx->gs_shader,
 		[PIPE_SHADER_FRAGMENT] = &sctx->ps_shader,
 	};
+	unsigned i;
+
+	util_queue_job_wait(&sel->ready);
 
 	if (current_shader[sel->type]->cso == sel) {
 		current_shader[sel->type]->cso = NULL;
@@ -1434,7 +1593,11 @@ static void si_delete_shader_selector(struct pipe_context *ctx, void *state)
 
 	if (sel->main_shader_part)
 		si_delete_shader(sctx, sel->main_shader_part);
+	for (i = 0; i < ARRAY_SIZE(sel->extra_main_parts); i++)
+		if (sel->extra_main_parts[i])
+			si_delete_shader(sctx, sel->extra_main_parts[i]);
 
+	util_queue_fence_destroy(&sel->ready);
 	pipe_mutex_destroy(sel->mutex);
 	free(sel->tokens);
 	free(sel);
@@ -93,6 +93,8 @@ softpipe_destroy( struct pipe_context *pipe )
    sp_destroy_tile_cache(softpipe->zsbuf_cache);
    pipe_surface_reference(&softpipe->framebuffer.zsbuf, NULL);
 
+   sp_destroy_tile_threads(softpipe->tile_threads);
+
    for (sh = 0; sh < Elements(softpipe->tex_cache); sh++) {
       for (i = 0; i < Elements(softpipe->tex_cache[0]); i++) {
          sp_destroy_tex_tile_cache(softpipe->tex_cache[sh][i]);
@@ -230,9 +232,13 @@ softpipe_create_context(struct pipe_screen *screen,
     * Alloc caches for accessing drawing surfaces and textures.
     * Must be before quad stage setup!
     */
+   softpipe->tile_threads =
+      sp_create_tile_threads(debug_get_num_option("SOFTPIPE_NUM_THREADS", 0));
    for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
-      softpipe->cbuf_cache[i] = sp_create_tile_cache( &softpipe->pipe );
-   softpipe->zsbuf_cache = sp_create_tile_cache( &softpipe->pipe );
+      softpipe->cbuf_cache[i] = sp_create_tile_cache( &softpipe->pipe,
+                                                      softpipe->tile_threads );
+   softpipe->zsbuf_cache = sp_create_tile_cache( &softpipe->pipe,
+                                                 softpipe->tile_threads );
 
    /* Allocate texture caches */
    for (sh = 0; sh < Elements(softpipe->tex_cache); sh++) {
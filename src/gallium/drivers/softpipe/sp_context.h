@@ -52,6 +52,7 @@ struct draw_context;
 struct draw_stage;
 struct softpipe_tile_cache;
 struct softpipe_tex_tile_cache;
+struct sp_tile_threads;
 struct sp_fragment_shader;
 struct sp_vertex_shader;
 struct sp_velems_state;
@@ -190,6 +191,9 @@ struct softpipe_context {
    struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
    struct softpipe_tile_cache *zsbuf_cache;
 
+   /** Helper threads for flushing the tile caches, may be NULL */
+   struct sp_tile_threads *tile_threads;
+
    unsigned tex_timestamp;
 
    /*
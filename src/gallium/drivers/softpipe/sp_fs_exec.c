@@ -47,7 +47,7 @@
 struct sp_exec_fragment_shader
 {
    struct sp_fragment_shader_variant base;
-   /* No other members for now */
+   struct tgsi_decoded_shader *decoded;  /**< decoded var->tokens */
 };
 
 
@@ -64,12 +64,21 @@ exec_prepare( const struct sp_fragment_shader_variant *var,
               struct tgsi_exec_machine *machine,
               struct tgsi_sampler *sampler )
 {
+   struct sp_exec_fragment_shader *spefs = sp_exec_fragment_shader(var);
+
    /*
     * Bind tokens/shader to the interpreter's machine state.
+    * The tokens are decoded once per variant rather than on every bind.
     */
-   tgsi_exec_machine_bind_shader(machine,
-                                 var->tokens,
-                                 sampler);
+   if (!spefs->decoded) {
+      spefs->decoded = tgsi_decode_shader(var->tokens);
+      if (!spefs->decoded)
+         return;
+   }
+
+   tgsi_exec_machine_bind_decoded(machine,
+                                  spefs->decoded,
+                                  sampler);
 }
 
 
@@ -179,10 +188,13 @@ static void
 exec_delete(struct sp_fragment_shader_variant *var,
             struct tgsi_exec_machine *machine)
 {
+   struct sp_exec_fragment_shader *spefs = sp_exec_fragment_shader(var);
+
    if (machine->Tokens == var->tokens) {
       tgsi_exec_machine_bind_shader(machine, NULL, NULL);
    }
 
+   tgsi_free_decoded_shader(spefs->decoded);
    FREE( (void *) var->tokens );
    FREE(var);
 }
@@ -32,6 +32,7 @@
  *    Brian Paul
  */
 
+#include "os/os_thread.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
 #include "util/u_memory.h"
@@ -41,6 +42,120 @@
 static struct softpipe_cached_tile *
 sp_alloc_tile(struct softpipe_tile_cache *tc);
 
+static void
+sp_flush_tile_cache_part(struct softpipe_tile_cache *tc,
+                         unsigned part, unsigned num_parts);
+
+
+struct sp_tile_thread_data
+{
+   struct sp_tile_threads *pool;
+   unsigned index;
+};
+
+
+/**
+ * Helper threads which write back a tile cache in parallel with the
+ * calling thread.  Each thread (and the caller) handles a disjoint set
+ * of tiles so the results are identical to a serial flush.
+ */
+struct sp_tile_threads
+{
+   unsigned num_threads;  /**< not counting the calling thread */
+   pipe_thread threads[SP_MAX_TILE_THREADS];
+   pipe_semaphore work_ready[SP_MAX_TILE_THREADS];
+   pipe_semaphore work_done;
+   struct sp_tile_thread_data data[SP_MAX_TILE_THREADS];
+   struct softpipe_tile_cache *tc;  /**< cache being flushed */
+   boolean exit_flag;
+};
+
+
+static PIPE_THREAD_ROUTINE( sp_tile_thread_function, init_data )
+{
+   struct sp_tile_thread_data *data = (struct sp_tile_thread_data *) init_data;
+   struct sp_tile_threads *pool = data->pool;
+
+   pipe_thread_setname("softpipe");
+
+   while (1) {
+      pipe_semaphore_wait(&pool->work_ready[data->index]);
+
+      if (pool->exit_flag)
+         break;
+
+      /* part 0 is done by the calling thread */
+      sp_flush_tile_cache_part(pool->tc, data->index + 1,
+                               pool->num_threads + 1);
+
+      pipe_semaphore_signal(&pool->work_done);
+   }
+
+#ifdef _WIN32
+   pipe_semaphore_signal(&pool->work_done);
+#endif
+
+   return 0;
+}
+
+
+struct sp_tile_threads *
+sp_create_tile_threads(unsigned num_threads)
+{
+   struct sp_tile_threads *pool;
+   unsigned i;
+
+   num_threads = MIN2(num_threads, SP_MAX_TILE_THREADS);
+   if (!num_threads)
+      return NULL;
+
+   pool = CALLOC_STRUCT(sp_tile_threads);
+   if (!pool)
+      return NULL;
+
+   pool->num_threads = num_threads;
+   pipe_semaphore_init(&pool->work_done, 0);
+   for (i = 0; i < num_threads; i++) {
+      pool->data[i].pool = pool;
+      pool->data[i].index = i;
+      pipe_semaphore_init(&pool->work_ready[i], 0);
+      pool->threads[i] = pipe_thread_create(sp_tile_thread_function,
+                                            (void *) &pool->data[i]);
+   }
+
+   return pool;
+}
+
+
+void
+sp_destroy_tile_threads(struct sp_tile_threads *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   pool->exit_flag = TRUE;
+   for (i = 0; i < pool->num_threads; i++) {
+      pipe_semaphore_signal(&pool->work_ready[i]);
+   }
+
+   /* See lp_rast_destroy() for why pipe_thread_wait isn't used on Windows */
+   for (i = 0; i < pool->num_threads; i++) {
+#ifdef _WIN32
+      pipe_semaphore_wait(&pool->work_done);
+#else
+      pipe_thread_wait(pool->threads[i]);
+#endif
+   }
+
+   for (i = 0; i < pool->num_threads; i++) {
+      pipe_semaphore_destroy(&pool->work_ready[i]);
+   }
+   pipe_semaphore_destroy(&pool->work_done);
+
+   FREE(pool);
+}
 
 /**
  * Return the position in the cache for the tile that contains win pos (x,y).
@@ -88,7 +203,8 @@ clear_clear_flag(uint *bitvec, union tile_address addr, unsigned max)
    
 
 struct softpipe_tile_cache *
-sp_create_tile_cache( struct pipe_context *pipe )
+sp_create_tile_cache( struct pipe_context *pipe,
+                      struct sp_tile_threads *threads )
 {
    struct softpipe_tile_cache *tc;
    uint pos;
@@ -106,6 +222,7 @@ sp_create_tile_cache( struct pipe_context *pipe )
    tc = CALLOC_STRUCT( softpipe_tile_cache );
    if (tc) {
       tc->pipe = pipe;
+      tc->threads = threads;
       for (pos = 0; pos < Elements(tc->tile_addrs); pos++) {
          tc->tile_addrs[pos].bits.invalid = 1;
       }
@@ -337,9 +454,12 @@ clear_tile(struct softpipe_cached_tile *tile,
 
 /**
  * Actually clear the tiles which were flagged as being in a clear state.
+ * Only every num_parts'th row of tiles, starting at row part, is handled.
+ * The scratch tile must already hold the clear value.
  */
 static void
-sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc, int layer)
+sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc, int layer,
+                          unsigned part, unsigned num_parts)
 {
    struct pipe_transfer *pt = tc->transfer[layer];
    const uint w = tc->transfer[layer]->box.width;
@@ -349,15 +469,8 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc, int layer)
 
    assert(pt->resource);
 
-   /* clear the scratch tile to the clear value */
-   if (tc->depth_stencil) {
-      clear_tile(tc->tile, pt->resource->format, tc->clear_val);
-   } else {
-      clear_tile_rgba(tc->tile, pt->resource->format, &tc->clear_color);
-   }
-
    /* push the tile to all positions marked as clear */
-   for (y = 0; y < h; y += TILE_SIZE) {
+   for (y = part * TILE_SIZE; y < h; y += num_parts * TILE_SIZE) {
       for (x = 0; x < w; x += TILE_SIZE) {
          union tile_address addr = tile_address(x, y, layer);
 
@@ -443,35 +556,69 @@ sp_flush_tile(struct softpipe_tile_cache* tc, unsigned pos)
 void
 sp_flush_tile_cache(struct softpipe_tile_cache *tc)
 {
-   int inuse = 0, pos;
-   int i;
    if (tc->num_maps) {
-      /* caching a drawing transfer */
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
-         struct softpipe_cached_tile *tile = tc->entries[pos];
-         if (!tile)
-         {
-            assert(tc->tile_addrs[pos].bits.invalid);
-            continue;
-         }
-         sp_flush_tile(tc, pos);
-         ++inuse;
-      }
+      struct sp_tile_threads *pool = tc->threads;
+      unsigned i;
 
       if (!tc->tile)
          tc->tile = sp_alloc_tile(tc);
 
-      for (i = 0; i < tc->num_maps; i++)
-         sp_tile_cache_flush_clear(tc, i);
+      /* clear the scratch tile to the clear value */
+      if (tc->depth_stencil) {
+         clear_tile(tc->tile, tc->surface->texture->format, tc->clear_val);
+      } else {
+         clear_tile_rgba(tc->tile, tc->surface->texture->format,
+                         &tc->clear_color);
+      }
+
+      /* caching a drawing transfer */
+      if (pool) {
+         pool->tc = tc;
+         for (i = 0; i < pool->num_threads; i++)
+            pipe_semaphore_signal(&pool->work_ready[i]);
+
+         sp_flush_tile_cache_part(tc, 0, pool->num_threads + 1);
+
+         for (i = 0; i < pool->num_threads; i++)
+            pipe_semaphore_wait(&pool->work_done);
+         pool->tc = NULL;
+      }
+      else {
+         sp_flush_tile_cache_part(tc, 0, 1);
+      }
+
       /* reset all clear flags to zero */
       memset(tc->clear_flags, 0, tc->clear_flags_size);
 
       tc->last_tile_addr.bits.invalid = 1;
    }
+}
 
-#if 0
-   debug_printf("flushed tiles in use: %d\n", inuse);
-#endif
+
+/**
+ * Write back one part of the tile cache: every num_parts'th cache entry
+ * and row of cleared tiles, starting at part.  Cached tiles never have
+ * their clear flag set, so the different parts touch disjoint tiles.
+ */
+static void
+sp_flush_tile_cache_part(struct softpipe_tile_cache *tc,
+                         unsigned part, unsigned num_parts)
+{
+   unsigned pos;
+   int i;
+
+   for (pos = part; pos < Elements(tc->entries); pos += num_parts) {
+      struct softpipe_cached_tile *tile = tc->entries[pos];
+      if (!tile)
+      {
+         assert(tc->tile_addrs[pos].bits.invalid);
+         continue;
+      }
+      sp_flush_tile(tc, pos);
+   }
+
+   for (i = 0; i < tc->num_maps; i++)
+      sp_tile_cache_flush_clear(tc, i, part, num_parts);
 }
 
 static struct softpipe_cached_tile *
@@ -34,6 +34,7 @@
 
 
 struct softpipe_tile_cache;
+struct sp_tile_threads;
 
 
 /**
@@ -78,10 +79,14 @@ struct softpipe_cached_tile
 
 #define NUM_ENTRIES 50
 
+/** Max number of helper threads used for tile cache flushes */
+#define SP_MAX_TILE_THREADS 32
+
 
 struct softpipe_tile_cache
 {
    struct pipe_context *pipe;
+   struct sp_tile_threads *threads;  /**< helper threads, may be NULL */
    struct pipe_surface *surface;  /**< the surface we're caching */
    struct pipe_transfer **transfer;
    void **transfer_map;
@@ -102,8 +107,15 @@ struct softpipe_tile_cache
 };
 
 
+extern struct sp_tile_threads *
+sp_create_tile_threads(unsigned num_threads);
+
+extern void
+sp_destroy_tile_threads(struct sp_tile_threads *threads);
+
 extern struct softpipe_tile_cache *
-sp_create_tile_cache( struct pipe_context *pipe );
+sp_create_tile_cache( struct pipe_context *pipe,
+                      struct sp_tile_threads *threads );
 
 extern void
 sp_destroy_tile_cache(struct softpipe_tile_cache *tc);
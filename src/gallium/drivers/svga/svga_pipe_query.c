@@ -744,6 +744,8 @@ svga_create_query(struct pipe_context *pipe,
    case SVGA_QUERY_NUM_BUFFER_UPLOADS:
    case SVGA_QUERY_NUM_CONST_BUF_UPDATES:
    case SVGA_QUERY_NUM_CONST_UPDATES:
+   case SVGA_QUERY_SURFACE_CACHE_HITS:
+   case SVGA_QUERY_SURFACE_CACHE_MISSES:
       break;
    default:
       assert(!"unexpected query type in svga_create_query()");
@@ -821,6 +823,8 @@ svga_destroy_query(struct pipe_context *pipe, struct pipe_query *q)
    case SVGA_QUERY_NUM_BUFFER_UPLOADS:
    case SVGA_QUERY_NUM_CONST_BUF_UPDATES:
    case SVGA_QUERY_NUM_CONST_UPDATES:
+   case SVGA_QUERY_SURFACE_CACHE_HITS:
+   case SVGA_QUERY_SURFACE_CACHE_MISSES:
       /* nothing */
       break;
    default:
@@ -838,6 +842,7 @@ static boolean
 svga_begin_query(struct pipe_context *pipe, struct pipe_query *q)
 {
    struct svga_context *svga = svga_context(pipe);
+   struct svga_screen *svgascreen = svga_screen(pipe->screen);
    struct svga_query *sq = svga_query(q);
    enum pipe_error ret;
 
@@ -927,6 +932,12 @@ svga_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    case SVGA_QUERY_NUM_CONST_UPDATES:
       sq->begin_count = svga->hud.num_const_updates;
       break;
+   case SVGA_QUERY_SURFACE_CACHE_HITS:
+      sq->begin_count = svgascreen->hud.num_surface_cache_hits;
+      break;
+   case SVGA_QUERY_SURFACE_CACHE_MISSES:
+      sq->begin_count = svgascreen->hud.num_surface_cache_misses;
+      break;
    case SVGA_QUERY_MEMORY_USED:
    case SVGA_QUERY_NUM_SHADERS:
    case SVGA_QUERY_NUM_RESOURCES:
@@ -949,6 +960,7 @@ static void
 svga_end_query(struct pipe_context *pipe, struct pipe_query *q)
 {
    struct svga_context *svga = svga_context(pipe);
+   struct svga_screen *svgascreen = svga_screen(pipe->screen);
    struct svga_query *sq = svga_query(q);
    enum pipe_error ret;
 
@@ -1045,6 +1057,12 @@ svga_end_query(struct pipe_context *pipe, struct pipe_query *q)
    case SVGA_QUERY_NUM_CONST_UPDATES:
       sq->end_count = svga->hud.num_const_updates;
       break;
+   case SVGA_QUERY_SURFACE_CACHE_HITS:
+      sq->end_count = svgascreen->hud.num_surface_cache_hits;
+      break;
+   case SVGA_QUERY_SURFACE_CACHE_MISSES:
+      sq->end_count = svgascreen->hud.num_surface_cache_misses;
+      break;
    case SVGA_QUERY_MEMORY_USED:
    case SVGA_QUERY_NUM_SHADERS:
    case SVGA_QUERY_NUM_RESOURCES:
@@ -1151,6 +1169,8 @@ svga_get_query_result(struct pipe_context *pipe,
    case SVGA_QUERY_NUM_BUFFER_UPLOADS:
    case SVGA_QUERY_NUM_CONST_BUF_UPDATES:
    case SVGA_QUERY_NUM_CONST_UPDATES:
+   case SVGA_QUERY_SURFACE_CACHE_HITS:
+   case SVGA_QUERY_SURFACE_CACHE_MISSES:
       vresult->u64 = sq->end_count - sq->begin_count;
       break;
    /* These are running total counters */
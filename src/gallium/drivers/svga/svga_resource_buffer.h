@@ -42,6 +42,14 @@
  */
 #define SVGA_BUFFER_MAX_RANGES 32
 
+/**
+ * Dirty ranges which are at most this many bytes apart get merged into
+ * one, so that lots of small scattered writes to a buffer (typically
+ * dynamic vertex/index data) turn into a single upload box, rather than
+ * patching up the pending upload and starting a new one every time.
+ */
+#define SVGA_BUFFER_RANGE_MERGE_GAP 1024
+
 
 struct svga_context;
 struct svga_winsys_buffer;
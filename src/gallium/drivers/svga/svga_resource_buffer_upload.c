@@ -510,9 +510,19 @@ svga_buffer_add_range(struct svga_buffer *sbuf,
    unsigned i;
    unsigned nearest_range;
    unsigned nearest_dist;
+   int merge_gap;
 
    assert(end > start);
 
+   /* Uploading the bytes in between two ranges again is harmless, since
+    * we hold the current contents of the buffer, unless the host writes
+    * to the buffer itself.
+    */
+   if (sbuf->bind_flags & PIPE_BIND_STREAM_OUTPUT)
+      merge_gap = 0;
+   else
+      merge_gap = SVGA_BUFFER_RANGE_MERGE_GAP;
+
    if (sbuf->map.num_ranges < SVGA_BUFFER_MAX_RANGES) {
       nearest_range = sbuf->map.num_ranges;
       nearest_dist = ~0;
@@ -534,9 +544,10 @@ svga_buffer_add_range(struct svga_buffer *sbuf,
       right_dist = sbuf->map.ranges[i].start - end;
       dist = MAX2(left_dist, right_dist);
 
-      if (dist <= 0) {
+      if (dist <= merge_gap) {
          /*
-          * Ranges are contiguous or overlapping -- extend this one and return.
+          * Ranges are contiguous, overlapping or close enough -- extend this
+          * one and return.
           *
           * Note that it is not this function's task to prevent overlapping
           * ranges, as the GMR was already given so it is too late to do
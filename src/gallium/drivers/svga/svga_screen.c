@@ -847,6 +847,10 @@ svga_get_driver_query_info(struct pipe_screen *screen,
             PIPE_DRIVER_QUERY_TYPE_UINT64),
       QUERY("num-const-updates", SVGA_QUERY_NUM_CONST_UPDATES,
             PIPE_DRIVER_QUERY_TYPE_UINT64),
+      QUERY("surface-cache-hits", SVGA_QUERY_SURFACE_CACHE_HITS,
+            PIPE_DRIVER_QUERY_TYPE_UINT64),
+      QUERY("surface-cache-misses", SVGA_QUERY_SURFACE_CACHE_MISSES,
+            PIPE_DRIVER_QUERY_TYPE_UINT64),
 
       /* running total counters */
       QUERY("memory-used", SVGA_QUERY_MEMORY_USED,
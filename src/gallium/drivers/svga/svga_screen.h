@@ -85,6 +85,8 @@ struct svga_screen
       /** Memory used by all resources (buffers and surfaces) */
       uint64_t total_resource_bytes;
       uint64_t num_resources;
+      uint64_t num_surface_cache_hits;
+      uint64_t num_surface_cache_misses;
    } hud;
 };
 
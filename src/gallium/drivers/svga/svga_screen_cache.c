@@ -133,8 +133,10 @@ svga_screen_cache_lookup(struct svga_screen *svgascreen,
          /* Remove from hash table */
          LIST_DEL(&entry->bucket_head);
 
-         /* remove from LRU list */
+         /* remove from LRU lists */
          LIST_DEL(&entry->head);
+         if (entry->key.format != SVGA3D_BUFFER)
+            LIST_DEL(&entry->surface_head);
 
          /* Add the cache entry (but not the surface!) to the empty list */
          LIST_ADD(&entry->head, &cache->empty);
@@ -154,6 +156,11 @@ svga_screen_cache_lookup(struct svga_screen *svgascreen,
       next = curr->next;
    }
 
+   if (handle)
+      svgascreen->hud.num_surface_cache_hits++;
+   else
+      svgascreen->hud.num_surface_cache_misses++;
+
    pipe_mutex_unlock(cache->mutex);
 
    if (SVGA_DEBUG & DEBUG_DMA)
@@ -178,26 +185,27 @@ svga_screen_cache_shrink(struct svga_screen *svgascreen,
    struct svga_winsys_screen *sws = svgascreen->sws;
    struct svga_host_surface_cache_entry *entry = NULL, *next_entry;
 
-   /* Walk over the list of unused buffers in reverse order: from oldest
-    * to newest.
+   /* Walk over the list of unused surfaces in reverse order: from oldest
+    * to newest.  We don't want to discard vertex/index buffers, which
+    * aren't on this list.
     */
-   LIST_FOR_EACH_ENTRY_SAFE_REV(entry, next_entry, &cache->unused, head) {
-      if (entry->key.format != SVGA3D_BUFFER) {
-         /* we don't want to discard vertex/index buffers */
+   LIST_FOR_EACH_ENTRY_SAFE_REV(entry, next_entry, &cache->unused_surfaces,
+                                surface_head) {
+      assert(entry->key.format != SVGA3D_BUFFER);
 
-         cache->total_size -= surface_size(&entry->key);
+      cache->total_size -= surface_size(&entry->key);
 
-         assert(entry->handle);
-         sws->surface_reference(sws, &entry->handle, NULL);
+      assert(entry->handle);
+      sws->surface_reference(sws, &entry->handle, NULL);
 
-         LIST_DEL(&entry->bucket_head);
-         LIST_DEL(&entry->head);
-         LIST_ADD(&entry->head, &cache->empty);
+      LIST_DEL(&entry->bucket_head);
+      LIST_DEL(&entry->surface_head);
+      LIST_DEL(&entry->head);
+      LIST_ADD(&entry->head, &cache->empty);
 
-         if (cache->total_size <= target_size) {
-            /* all done */
-            break;
-         }
+      if (cache->total_size <= target_size) {
+         /* all done */
+         break;
       }
    }
 }
@@ -278,8 +286,10 @@ svga_screen_cache_add(struct svga_screen *svgascreen,
       /* Remove from hash table */
       LIST_DEL(&entry->bucket_head);
 
-      /* Remove from LRU list */
+      /* Remove from LRU lists */
       LIST_DEL(&entry->head);
+      if (entry->key.format != SVGA3D_BUFFER)
+         LIST_DEL(&entry->surface_head);
    }
 
    if (entry) {
@@ -336,6 +346,8 @@ svga_screen_cache_flush(struct svga_screen *svgascreen,
 
          /* Add entry to the unused list */
          LIST_ADD(&entry->head, &cache->unused);
+         if (entry->key.format != SVGA3D_BUFFER)
+            LIST_ADD(&entry->surface_head, &cache->unused_surfaces);
 
          /* Add entry to the hash table bucket */
          bucket = svga_screen_cache_bucket(&entry->key);
@@ -393,6 +405,7 @@ svga_screen_cache_init(struct svga_screen *svgascreen)
       LIST_INITHEAD(&cache->bucket[i]);
 
    LIST_INITHEAD(&cache->unused);
+   LIST_INITHEAD(&cache->unused_surfaces);
 
    LIST_INITHEAD(&cache->validated);
 
@@ -473,6 +486,19 @@ svga_screen_surface_create(struct svga_screen *svgascreen,
       }
 
       handle = svga_screen_cache_lookup(svgascreen, key);
+
+      if (!handle && key->format == SVGA3D_BUFFER &&
+          key->size.width <= SVGA_HOST_SURFACE_CACHE_MAX_BUFFER_MATCH) {
+         /* Also accept a cached buffer from the next size class up, rather
+          * than defining a new one.  The caller's key is updated since it
+          * has to describe the surface when it's put back in the cache.
+          */
+         key->size.width <<= 1;
+         handle = svga_screen_cache_lookup(svgascreen, key);
+         if (!handle)
+            key->size.width >>= 1;
+      }
+
       if (handle) {
          if (key->format == SVGA3D_BUFFER)
             SVGA_DBG(DEBUG_CACHE|DEBUG_DMA,
@@ -50,6 +50,12 @@
  */
 #define SVGA_HOST_SURFACE_CACHE_BUCKETS 256
 
+/* Largest (rounded up) buffer size for which a cached buffer of twice the
+ * size may be returned, since cached buffers don't count against
+ * SVGA_HOST_SURFACE_CACHE_BYTES:
+ */
+#define SVGA_HOST_SURFACE_CACHE_MAX_BUFFER_MATCH (1024 * 1024)
+
 
 struct svga_winsys_surface;
 struct svga_screen;
@@ -82,6 +88,12 @@ struct svga_host_surface_cache_entry
    /** Head for the bucket lists. */
    struct list_head bucket_head;
 
+   /**
+    * Head for svga_host_surface_cache::unused_surfaces, only used for
+    * entries which aren't buffers while they're on the unused list.
+    */
+   struct list_head surface_head;
+
    struct svga_host_surface_cache_key key;
    struct svga_winsys_surface *handle;
    
@@ -112,6 +124,13 @@ struct svga_host_surface_cache
    /* Entries with unused buffers, ordered from most to least recently used 
     * (3 and 4) */
    struct list_head unused;
+
+   /* The subset of the unused entries which aren't SVGA3D_BUFFERs, in the
+    * same order.  Only these count against the cache size, so this is what
+    * svga_screen_cache_shrink() evicts from, without having to skip over
+    * all the cached vertex/index buffers.
+    */
+   struct list_head unused_surfaces;
    
    /* Entries with buffers still in validate lists (2) */
    struct list_head validated;
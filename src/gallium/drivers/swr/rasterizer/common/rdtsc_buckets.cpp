@@ -29,8 +29,11 @@
 ******************************************************************************/
 #include "rdtsc_buckets.h"
 #include <inttypes.h>
+#include <chrono>
 
 THREAD UINT tlsThreadId = 0;
+THREAD uint32_t tlsTraceDrawId = 0;
+THREAD uint32_t tlsTraceMacroTile = TRACE_NO_MACROTILE;
 
 void BucketManager::RegisterThread(const std::string& name)
 {
@@ -56,6 +59,11 @@ void BucketManager::RegisterThread(const std::string& name)
         newThread.vizFile = fopen(ss.str().c_str(), "wb");
     }
 
+    if (mTrace)
+    {
+        newThread.pTrace = new TRACE_RING;
+    }
+
     // store new thread
     mThreads.push_back(newThread);
 
@@ -167,12 +175,124 @@ void BucketManager::DumpThreadViz()
     fclose(f);
 }
 
+void BucketManager::StartTrace()
+{
+    uint32_t pid = GetCurrentProcessId();
+    std::stringstream ss;
+    ss << "rdtsc_trace." << pid << ".json";
+
+    mTraceFile = fopen(ss.str().c_str(), "w");
+    if (mTraceFile == nullptr)
+    {
+        return;
+    }
+
+    // calibrate the timestamp counter, trace event times are in microseconds
+    auto startTime = std::chrono::steady_clock::now();
+    uint64_t startTsc = __rdtsc();
+    std::chrono::steady_clock::duration elapsed;
+    do
+    {
+        elapsed = std::chrono::steady_clock::now() - startTime;
+    } while (elapsed < std::chrono::milliseconds(10));
+
+    double elapsedUs = std::chrono::duration<double, std::micro>(elapsed).count();
+    mTraceTscPerUs = (double)(__rdtsc() - startTsc) / elapsedUs;
+    mTraceStartTsc = __rdtsc();
+
+    // JSON array format, which the trace viewers also accept unterminated
+    fprintf(mTraceFile, "[\n");
+    mTraceFirstEvent = true;
+
+    mThreadMutex.lock();
+    for (const BUCKET_THREAD& thread : mThreads)
+    {
+        fprintf(mTraceFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+            mTraceFirstEvent ? "" : ",\n", pid, thread.id, thread.name.c_str(), thread.id);
+        mTraceFirstEvent = false;
+    }
+    mThreadMutex.unlock();
+}
+
+void BucketManager::StopTrace()
+{
+    if (mTraceFile == nullptr)
+    {
+        return;
+    }
+
+    FlushTrace();
+
+    uint32_t pid = GetCurrentProcessId();
+    double ts = (double)(__rdtsc() - mTraceStartTsc) / mTraceTscPerUs;
+
+    mThreadMutex.lock();
+    for (const BUCKET_THREAD& thread : mThreads)
+    {
+        uint32_t numDropped = thread.pTrace->numDropped.load(std::memory_order_relaxed);
+        if (numDropped)
+        {
+            fprintf(mTraceFile, "%s{\"name\":\"DroppedEvents\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"args\":{\"count\":%u}}",
+                mTraceFirstEvent ? "" : ",\n", pid, thread.id, ts, numDropped);
+            mTraceFirstEvent = false;
+        }
+    }
+    mThreadMutex.unlock();
+
+    fprintf(mTraceFile, "\n]\n");
+    fclose(mTraceFile);
+    mTraceFile = nullptr;
+}
+
+void BucketManager::FlushTrace()
+{
+    if (mTraceFile == nullptr)
+    {
+        return;
+    }
+
+    uint32_t pid = GetCurrentProcessId();
+
+    mThreadMutex.lock();
+    for (const BUCKET_THREAD& thread : mThreads)
+    {
+        TRACE_RING* pRing = thread.pTrace;
+        uint32_t tail = pRing->tail.load(std::memory_order_relaxed);
+        uint32_t head = pRing->head.load(std::memory_order_acquire);
+
+        for (; tail != head; ++tail)
+        {
+            const TRACE_EVENT& event = pRing->events[tail % TRACE_RING::NUM_EVENTS];
+            double ts = (double)(int64_t)(event.start - mTraceStartTsc) / mTraceTscPerUs;
+            double dur = (double)(event.stop - event.start) / mTraceTscPerUs;
+
+            fprintf(mTraceFile, "%s{\"name\":\"%s\",\"cat\":\"swr\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"draw\":%u",
+                mTraceFirstEvent ? "" : ",\n", mBuckets[event.bucketId].name.c_str(), pid, thread.id, ts, dur, event.drawId);
+            if (event.macroTile != TRACE_NO_MACROTILE)
+            {
+                fprintf(mTraceFile, ",\"macrotile\":%u", event.macroTile);
+            }
+            fprintf(mTraceFile, "}}");
+            mTraceFirstEvent = false;
+        }
+
+        pRing->tail.store(tail, std::memory_order_release);
+    }
+    mThreadMutex.unlock();
+
+    fflush(mTraceFile);
+}
+
 void BucketManager::PrintReport(const std::string& filename)
 {
     if (mThreadViz)
     {
         DumpThreadViz();
     }
+    else if (mTrace)
+    {
+        // trace events are written out as they are captured
+    }
     else
     {
         FILE* f = fopen(filename.c_str(), "w");
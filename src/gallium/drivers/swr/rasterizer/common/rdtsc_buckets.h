@@ -32,6 +32,7 @@
 #include "os.h"
 #include <vector>
 #include <mutex>
+#include <atomic>
 #include <sstream>
 
 #include "rdtsc_buckets_shared.h"
@@ -39,6 +40,48 @@
 // unique thread id stored in thread local storage
 extern THREAD UINT tlsThreadId;
 
+// draw and macrotile the thread is working on, used to tag trace events
+extern THREAD uint32_t tlsTraceDrawId;
+extern THREAD uint32_t tlsTraceMacroTile;
+
+#define TRACE_NO_MACROTILE 0xffffffff
+
+struct TRACE_EVENT
+{
+    uint64_t start;
+    uint64_t stop;
+    uint32_t bucketId;
+    uint32_t drawId;
+    uint32_t macroTile;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Ring of trace events, written only by the thread it belongs to
+///        and drained only by the thread writing the trace file, so it
+///        needs no lock.  Events are dropped while the ring is full.
+struct TRACE_RING
+{
+    static const uint32_t NUM_EVENTS = 64 * 1024;
+
+    TRACE_EVENT events[NUM_EVENTS];
+    std::atomic<uint32_t> head{ 0 };
+    std::atomic<uint32_t> tail{ 0 };
+    std::atomic<uint32_t> numDropped{ 0 };
+
+    INLINE void Push(const TRACE_EVENT& event)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == NUM_EVENTS)
+        {
+            numDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        events[h % NUM_EVENTS] = event;
+        head.store(h + 1, std::memory_order_release);
+    }
+};
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief BucketManager encapsulates a single instance of the buckets
 ///        functionality. There can be one or many bucket managers active
@@ -47,7 +90,8 @@ extern THREAD UINT tlsThreadId;
 class BucketManager
 {
 public:
-    BucketManager(bool enableThreadViz) : mThreadViz(enableThreadViz)
+    BucketManager(bool enableThreadViz, bool enableTrace = false) :
+        mThreadViz(enableThreadViz), mTrace(enableTrace && !enableThreadViz)
     {
         if (mThreadViz)
         {
@@ -63,6 +107,10 @@ public:
     void ClearThreads()
     {
         mThreadMutex.lock();
+        for (BUCKET_THREAD& t : mThreads)
+        {
+            delete t.pTrace;
+        }
         mThreads.clear();
         mThreadMutex.unlock();
     }
@@ -91,9 +139,23 @@ public:
     // print report
     void PrintReport(const std::string& filename);
 
+    // write out the trace events recorded so far
+    void FlushTrace();
+
+    // set the draw and macrotile trace events of this thread are tagged with
+    INLINE void SetTraceContext(uint32_t drawId, uint32_t macroTile)
+    {
+        tlsTraceDrawId = drawId;
+        tlsTraceMacroTile = macroTile;
+    }
+
     // start capturing
     INLINE void StartCapture()
     {
+        if (mTrace)
+        {
+            StartTrace();
+        }
         mCapturing = true;
     }
 
@@ -116,6 +178,11 @@ public:
                 }
             }
         }
+
+        if (mTrace)
+        {
+            StopTrace();
+        }
     }
 
     // start a bucket
@@ -138,6 +205,13 @@ public:
                 Serialize(bt.vizFile, data);
             }
         }
+        else if (mTrace)
+        {
+            if (mBuckets[id].enableThreadViz && bt.level < TRACE_MAX_LEVELS)
+            {
+                bt.traceStart[bt.level] = __rdtsc();
+            }
+        }
         else
         {
             if (bt.pCurrent->children.size() < mBuckets.size())
@@ -173,6 +247,15 @@ public:
                 Serialize(bt.vizFile, data);
             }
         }
+        else if (mTrace)
+        {
+            uint32_t level = bt.level - 1;
+            if (mBuckets[id].enableThreadViz && level < TRACE_MAX_LEVELS)
+            {
+                TRACE_EVENT event{ bt.traceStart[level], __rdtsc(), id, tlsTraceDrawId, tlsTraceMacroTile };
+                bt.pTrace->Push(event);
+            }
+        }
         else
         {
             if (bt.pCurrent->start == 0) return;
@@ -196,8 +279,8 @@ public:
 
         BUCKET_THREAD& bt = mThreads[tlsThreadId];
 
-        // don't record events for threadviz
-        if (!mThreadViz)
+        // don't record events for threadviz or traces
+        if (!mThreadViz && !mTrace)
         {
             if (bt.pCurrent->children.size() < mBuckets.size())
             {
@@ -213,6 +296,8 @@ public:
 private:
     void PrintBucket(FILE* f, UINT level, uint64_t threadCycles, uint64_t parentCycles, const BUCKET& bucket);
     void PrintThread(FILE* f, const BUCKET_THREAD& thread);
+    void StartTrace();
+    void StopTrace();
 
     // list of active threads that have registered with this manager
     std::vector<BUCKET_THREAD> mThreads;
@@ -228,6 +313,13 @@ private:
     // enable threadviz
     bool mThreadViz{ false };
     std::string mThreadVizDir;
+
+    // enable chrome trace output
+    bool mTrace{ false };
+    FILE* mTraceFile{ nullptr };
+    bool mTraceFirstEvent{ true };
+    uint64_t mTraceStartTsc{ 0 };
+    double mTraceTscPerUs{ 1.0 };
 };
 
 
@@ -58,6 +58,9 @@ struct BUCKET_DESC
     uint32_t color;
 };
 
+// deepest bucket nesting recorded in traces
+static const uint32_t TRACE_MAX_LEVELS = 16;
+
 struct BUCKET_THREAD
 {
     // name of thread, used in reports
@@ -78,6 +81,12 @@ struct BUCKET_THREAD
     // threadviz file object
     FILE* vizFile{ nullptr };
 
+    // trace event ring, drained to the trace file
+    struct TRACE_RING* pTrace{ nullptr };
+
+    // start timestamps of the traced buckets, per hierarchy level
+    uint64_t traceStart[TRACE_MAX_LEVELS];
+
     BUCKET_THREAD() {}
     BUCKET_THREAD(const BUCKET_THREAD& that)
     {
@@ -86,6 +95,7 @@ struct BUCKET_THREAD
         root = that.root;
         pCurrent = &root;
         vizFile = that.vizFile;
+        pTrace = that.pTrace;
     }
 };
 
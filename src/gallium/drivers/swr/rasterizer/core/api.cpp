@@ -61,10 +61,13 @@ HANDLE SwrCreateContext(
     pContext->driverType = pCreateInfo->driver;
     pContext->privateStateSize = pCreateInfo->privateStateSize;
 
-    pContext->dcRing.Init(KNOB_MAX_DRAWS_IN_FLIGHT);
-    pContext->dsRing.Init(KNOB_MAX_DRAWS_IN_FLIGHT);
+    pContext->MAX_DRAWS_IN_FLIGHT = KNOB_MAX_DRAWS_IN_FLIGHT;
+    pContext->dcRing.Init(pContext->MAX_DRAWS_IN_FLIGHT);
+    pContext->dsRing.Init(pContext->MAX_DRAWS_IN_FLIGHT);
+    pContext->dcRing.SetMaxInFlight(
+        std::min(std::max(KNOB_MIN_DRAWS_IN_FLIGHT, 1u), pContext->MAX_DRAWS_IN_FLIGHT));
 
-    for (uint32_t dc = 0; dc < KNOB_MAX_DRAWS_IN_FLIGHT; ++dc)
+    for (uint32_t dc = 0; dc < pContext->MAX_DRAWS_IN_FLIGHT; ++dc)
     {
         pContext->dcRing[dc].pArena = new CachingArena(pContext->cachingArenaAllocator);
         pContext->dcRing[dc].pTileMgr = new MacroTileMgr(*(pContext->dcRing[dc].pArena));
@@ -127,7 +130,7 @@ void SwrDestroyContext(HANDLE hContext)
     DestroyThreadPool(pContext, &pContext->threadPool);
 
     // free the fifos
-    for (uint32_t i = 0; i < KNOB_MAX_DRAWS_IN_FLIGHT; ++i)
+    for (uint32_t i = 0; i < pContext->MAX_DRAWS_IN_FLIGHT; ++i)
     {
         delete pContext->dcRing[i].pArena;
         delete pContext->dsRing[i].pArena;
@@ -154,7 +157,14 @@ void CopyState(DRAW_STATE& dst, const DRAW_STATE& src)
 
 void WakeAllThreads(SWR_CONTEXT *pContext)
 {
-    pContext->FifosNotEmpty.notify_all();
+    if (pContext->threadPool.isShared)
+    {
+        WakeSharedThreadPool();
+    }
+    else
+    {
+        pContext->FifosNotEmpty.notify_all();
+    }
 }
 
 template<bool IsDraw>
@@ -220,6 +230,25 @@ INLINE void QueueDispatch(SWR_CONTEXT* pContext)
     QueueWork<false>(pContext);
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Called when the API thread finds the DC ring full.  Stalling
+///        again within a ring's worth of draws means the workers retire
+///        draws about as fast as they are submitted, typically lots of
+///        small ones, and more of them in flight keeps both sides busy.
+static void GrowDrawRing(SWR_CONTEXT *pContext)
+{
+    uint64_t head = pContext->dcRing.GetHead();
+    uint32_t maxInFlight = pContext->dcRing.GetMaxInFlight();
+
+    if ((head - pContext->lastStallDrawId) < maxInFlight &&
+        maxInFlight < pContext->MAX_DRAWS_IN_FLIGHT)
+    {
+        pContext->dcRing.SetMaxInFlight(std::min(maxInFlight * 2, pContext->MAX_DRAWS_IN_FLIGHT));
+    }
+
+    pContext->lastStallDrawId = head;
+}
+
 DRAW_CONTEXT* GetDrawContext(SWR_CONTEXT *pContext, bool isSplitDraw = false)
 {
     RDTSC_START(APIGetDrawContext);
@@ -227,18 +256,23 @@ DRAW_CONTEXT* GetDrawContext(SWR_CONTEXT *pContext, bool isSplitDraw = false)
     if (pContext->pCurDrawContext == nullptr)
     {
         // Need to wait for a free entry.
-        while (pContext->dcRing.IsFull())
+        if (pContext->dcRing.IsFull())
         {
-            _mm_pause();
+            GrowDrawRing(pContext);
+
+            while (pContext->dcRing.IsFull())
+            {
+                _mm_pause();
+            }
         }
 
-        uint32_t dcIndex = pContext->dcRing.GetHead() % KNOB_MAX_DRAWS_IN_FLIGHT;
+        uint32_t dcIndex = pContext->dcRing.GetHead() % pContext->MAX_DRAWS_IN_FLIGHT;
 
         DRAW_CONTEXT* pCurDrawContext = &pContext->dcRing[dcIndex];
         pContext->pCurDrawContext = pCurDrawContext;
 
         // Assign next available entry in DS ring to this DC.
-        uint32_t dsIndex = pContext->curStateId % KNOB_MAX_DRAWS_IN_FLIGHT;
+        uint32_t dsIndex = pContext->curStateId % pContext->MAX_DRAWS_IN_FLIGHT;
         pCurDrawContext->pState = &pContext->dsRing[dsIndex];
 
         // Copy previous state to current state.
@@ -288,6 +322,7 @@ DRAW_CONTEXT* GetDrawContext(SWR_CONTEXT *pContext, bool isSplitDraw = false)
 
         // Assign unique drawId for this DC
         pCurDrawContext->drawId = pContext->dcRing.GetHead();
+        RDTSC_SET_CONTEXT(pCurDrawContext->drawId, TRACE_NO_MACROTILE);
 
         pCurDrawContext->cleanupState = true;
     }
@@ -889,14 +924,31 @@ void InitDraw(
     }
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Number of vertices shared by consecutive parts of a split draw.
+/// @param topology - Topology used for draw
+INLINE uint32_t GetSplitDrawOverlap(PRIMITIVE_TOPOLOGY topology)
+{
+    switch (topology)
+    {
+    case TOP_LINE_STRIP: return 1;
+    case TOP_TRIANGLE_STRIP: return 2;
+    default: return 0;
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief We can split the draw for certain topologies for better performance.
+///        Each part of a split draw is a draw of its own, so the parts go through
+///        the FE on different workers and through the BE in order.
 /// @param totalVerts - Total vertices for draw
 /// @param topology - Topology used for draw
+/// @param isIndexed - Whether the draw is indexed
 uint32_t MaxVertsPerDraw(
     DRAW_CONTEXT* pDC,
     uint32_t totalVerts,
-    PRIMITIVE_TOPOLOGY topology)
+    PRIMITIVE_TOPOLOGY topology,
+    bool isIndexed)
 {
     API_STATE& state = pDC->pState->state;
 
@@ -914,6 +966,21 @@ uint32_t MaxVertsPerDraw(
         vertsPerDraw = KNOB_MAX_PRIMS_PER_DRAW;
         break;
 
+    case TOP_LINE_LIST:
+        vertsPerDraw = KNOB_MAX_PRIMS_PER_DRAW & ~1;
+        break;
+
+    // Strips are split into overlapping parts (see GetSplitDrawOverlap).  Parts of
+    // triangle strips start on an even triangle to keep the winding.  Indexed strips
+    // aren't split, as a primitive restart would change where their triangles start.
+    case TOP_LINE_STRIP:
+    case TOP_TRIANGLE_STRIP:
+        if (!isIndexed)
+        {
+            vertsPerDraw = (KNOB_MAX_PRIMS_PER_DRAW & ~1) + GetSplitDrawOverlap(topology);
+        }
+        break;
+
     case TOP_PATCHLIST_1:
     case TOP_PATCHLIST_2:
     case TOP_PATCHLIST_3:
@@ -1029,9 +1096,11 @@ void DrawInstanced(
     SWR_CONTEXT *pContext = GetContext(hContext);
     DRAW_CONTEXT* pDC = GetDrawContext(pContext);
 
-    int32_t maxVertsPerDraw = MaxVertsPerDraw(pDC, numVertices, topology);
+    int32_t maxVertsPerDraw = MaxVertsPerDraw(pDC, numVertices, topology, false);
     uint32_t primsPerDraw = GetNumPrims(topology, maxVertsPerDraw);
+    uint32_t overlap = GetSplitDrawOverlap(topology);
     int32_t remainingVerts = numVertices;
+    uint32_t vertexOffset = 0;
 
     API_STATE    *pState = &pDC->pState->state;
     pState->topology = topology;
@@ -1067,14 +1136,23 @@ void DrawInstanced(
         pDC->FeWork.desc.draw.numInstances = numInstances;
         pDC->FeWork.desc.draw.startInstance = startInstance;
         pDC->FeWork.desc.draw.startPrimID = draw * primsPerDraw;
-        pDC->FeWork.desc.draw.startVertexID = draw * maxVertsPerDraw;
+        pDC->FeWork.desc.draw.startVertexID = vertexOffset;
 
         pDC->cleanupState = (remainingVerts == numVertsForDraw);
 
         //enqueue DC
         QueueDraw(pContext);
 
-        remainingVerts -= numVertsForDraw;
+        if (remainingVerts == numVertsForDraw)
+        {
+            remainingVerts = 0;
+        }
+        else
+        {
+            // the next part starts with the last vertices of this one
+            remainingVerts -= numVertsForDraw - overlap;
+            vertexOffset += numVertsForDraw - overlap;
+        }
         draw++;
     }
 
@@ -1149,7 +1227,7 @@ void DrawIndexedInstance(
     DRAW_CONTEXT* pDC = GetDrawContext(pContext);
     API_STATE* pState = &pDC->pState->state;
 
-    int32_t maxIndicesPerDraw = MaxVertsPerDraw(pDC, numIndices, topology);
+    int32_t maxIndicesPerDraw = MaxVertsPerDraw(pDC, numIndices, topology, true);
     uint32_t primsPerDraw = GetNumPrims(topology, maxIndicesPerDraw);
     int32_t remainingIndices = numIndices;
 
@@ -1355,7 +1433,8 @@ void SwrDispatch(
 void SwrStoreTiles(
     HANDLE hContext,
     SWR_RENDERTARGET_ATTACHMENT attachment,
-    SWR_TILE_STATE postStoreTileState)
+    SWR_TILE_STATE postStoreTileState,
+    SWR_RECT rect)
 {
     RDTSC_START(APIStoreTiles);
 
@@ -1368,6 +1447,7 @@ void SwrStoreTiles(
     pDC->FeWork.pfnWork = ProcessStoreTiles;
     pDC->FeWork.desc.storeTiles.attachment = attachment;
     pDC->FeWork.desc.storeTiles.postStoreTileState = postStoreTileState;
+    pDC->FeWork.desc.storeTiles.rect = rect;
 
     //enqueue
     QueueDraw(pContext);
@@ -67,15 +67,19 @@ typedef void(SWR_API *PFN_STORE_TILE)(HANDLE hPrivateContext, SWR_FORMAT srcForm
     SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
     uint32_t x, uint32_t y, uint32_t renderTargetArrayIndex, uint8_t *pSrcHotTile);
 
-/// @brief Function signature for clearing from the hot tiles clear value
+/// @brief Function signature for storing a hot tile's pending clear
+///        straight to the surface
 /// @param hPrivateContext - handle to private data
 /// @param renderTargetIndex - render target to store, can be color, depth or stencil
 /// @param x - destination x coordinate
 /// @param y - destination y coordinate
+/// @param renderTargetArrayIndex - destination array slice
 /// @param pClearColor - pointer to the hot tile's clear value
-typedef void(SWR_API *PFN_CLEAR_TILE)(HANDLE hPrivateContext,
+/// @return false if the clear couldn't be stored, in which case the hot tile
+///         is cleared and stored instead
+typedef bool(SWR_API *PFN_CLEAR_TILE)(HANDLE hPrivateContext,
     SWR_RENDERTARGET_ATTACHMENT rtIndex,
-    uint32_t x, uint32_t y, const float* pClearColor);
+    uint32_t x, uint32_t y, uint32_t renderTargetArrayIndex, const float* pClearColor);
 
 class BucketManager;
 
@@ -439,10 +443,13 @@ enum SWR_TILE_STATE
 };
 
 /// @todo Add a good description for what attachments are and when and why you would use the different SWR_TILE_STATEs.
+/// @param rect - only macrotiles touching rect are stored. If rect is all
+///               zeros, the viewport is used.
 void SWR_API SwrStoreTiles(
     HANDLE hContext,
     SWR_RENDERTARGET_ATTACHMENT attachment,
-    SWR_TILE_STATE postStoreTileState);
+    SWR_TILE_STATE postStoreTileState,
+    SWR_RECT rect);
 
 void SWR_API SwrClearRenderTarget(
     HANDLE hContext,
@@ -225,6 +225,7 @@ INLINE void ClearMacroTile(DRAW_CONTEXT *pDC, SWR_RENDERTARGET_ATTACHMENT rt, ui
     const uint32_t pitch = (FormatTraits<format>::bpp * KNOB_MACROTILE_X_DIM / 8);
 
     HOTTILE *pHotTile = pDC->pContext->pHotTileMgr->GetHotTile(pDC->pContext, pDC, macroTile, rt, true, numSamples);
+    pHotTile->maxDepthValid = false;
     uint32_t rasterTileStartOffset = (ComputeTileOffset2D< TilingTraits<SWR_TILE_SWRZ, FormatTraits<format>::bpp > >(pitch, left, top)) * numSamples;
     uint8_t* pRasterTileRow = pHotTile->pBuffer + rasterTileStartOffset; //(ComputeTileOffset2D< TilingTraits<SWR_TILE_SWRZ, FormatTraits<format>::bpp > >(pitch, x, y)) * numSamples;
 
@@ -276,6 +277,7 @@ void ProcessClearBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile, vo
             HOTTILE *pHotTile = pContext->pHotTileMgr->GetHotTile(pContext, pDC, macroTile, SWR_ATTACHMENT_DEPTH, true, numSamples);
             pHotTile->clearData[0] = *(DWORD*)&pClear->clearDepth;
             pHotTile->state = HOTTILE_CLEAR;
+            pHotTile->maxDepthValid = false;
         }
 
         if (pClear->flags.mask & SWR_CLEAR_STENCIL)
@@ -371,6 +373,21 @@ void ProcessStoreTileBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile
     HOTTILE *pHotTile = pContext->pHotTileMgr->GetHotTile(pContext, pDC, macroTile, pDesc->attachment, false);
     if (pHotTile)
     {
+        // a pending clear can be written straight to the surface, leaving the
+        // hottile untouched and still pending the clear
+        if (pHotTile->state == HOTTILE_CLEAR && pContext->pfnClearTile != nullptr &&
+            pContext->pfnClearTile(GetPrivateState(pDC), pDesc->attachment,
+                KNOB_MACROTILE_X_DIM * x, KNOB_MACROTILE_Y_DIM * y, pHotTile->renderTargetArrayIndex,
+                (const float*)pHotTile->clearData))
+        {
+            if (pDesc->postStoreTileState == SWR_TILE_INVALID)
+            {
+                pHotTile->state = HOTTILE_INVALID;
+            }
+            RDTSC_STOP(BEStoreTiles, numTiles, pDC->drawId);
+            return;
+        }
+
         // clear if clear is pending (i.e., not rendered to), then mark as dirty for store.
         if (pHotTile->state == HOTTILE_CLEAR)
         {
@@ -415,6 +432,7 @@ void ProcessDiscardInvalidateTilesBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint3
             if (pHotTile)
             {
                 pHotTile->state = (HOTTILE_STATE)pDesc->newTileState;
+                pHotTile->maxDepthValid = false;
             }
         }
     }
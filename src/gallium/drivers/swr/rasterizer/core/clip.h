@@ -383,42 +383,57 @@ public:
         // set up new PA for binning clipped primitives
         PFN_PROCESS_PRIMS pfnBinFunc = nullptr;
         PRIMITIVE_TOPOLOGY clipTopology = TOP_UNKNOWN;
+        PRIMITIVE_TOPOLOGY binTopology = TOP_UNKNOWN;
         if (NumVertsPerPrim == 3)
         {
             pfnBinFunc = BinTriangles;
             clipTopology = TOP_TRIANGLE_FAN;
+            binTopology = TOP_TRIANGLE_LIST;
 
             // so that the binner knows to bloat wide points later
             if (pa.binTopology == TOP_POINT_LIST)
+            {
                 clipTopology = TOP_POINT_LIST;
+                binTopology = TOP_POINT_LIST;
+            }
         }
         else if (NumVertsPerPrim == 2)
         {
             pfnBinFunc = BinLines;
             clipTopology = TOP_LINE_LIST;
+            binTopology = TOP_LINE_LIST;
         }
         else
         {
             SWR_ASSERT(0 && "Unexpected points in clipper.");
         }
-        
+
+        // slots to copy out of the clipper output
+        uint32_t copySlots[KNOB_NUM_ATTRIBUTES];
+        uint32_t numCopySlots = 0;
+        copySlots[numCopySlots++] = VERTEX_POSITION_SLOT;
+        for (uint32_t attrib = 0; attrib < numAttribs; ++attrib)
+        {
+            copySlots[numCopySlots++] = VERTEX_ATTRIB_START_SLOT + attrib;
+        }
+        if (this->state.rastState.clipDistanceMask & 0xf)
+        {
+            copySlots[numCopySlots++] = VERTEX_CLIPCULL_DIST_LO_SLOT;
+        }
+        if (this->state.rastState.clipDistanceMask & 0xf0)
+        {
+            copySlots[numCopySlots++] = VERTEX_CLIPCULL_DIST_HI_SLOT;
+        }
 
         uint32_t* pVertexCount = (uint32_t*)&vNumClippedVerts;
         uint32_t* pPrimitiveId = (uint32_t*)&vPrimId;
 
-        const simdscalari vOffsets = _mm256_set_epi32(
-            0 * sizeof(simdvertex),  // unused lane
-            6 * sizeof(simdvertex),
-            5 * sizeof(simdvertex),
-            4 * sizeof(simdvertex),
-            3 * sizeof(simdvertex),
-            2 * sizeof(simdvertex),
-            1 * sizeof(simdvertex),
-            0 * sizeof(simdvertex));
-
-        // only need to gather 7 verts
-        // @todo dynamic mask based on actual # of verts generated per lane
-        const simdscalar vMask = _mm256_set_ps(0, -1, -1, -1, -1, -1, -1, -1);
+        // The clipped prims of all lanes are unrolled into a list and binned
+        // a full SIMD at a time, instead of binning each lane's fan alone.
+        const uint32_t numBinVertsPerPrim = (binTopology == TOP_POINT_LIST) ? 1 : NumVertsPerPrim;
+        simdvertex binVerts[NumVertsPerPrim];
+        OSALIGNSIMD(uint32_t) binPrimIds[KNOB_SIMD_WIDTH];
+        uint32_t numBinPrims = 0;
 
         uint32_t numClippedPrims = 0;
         for (uint32_t inputPrim = 0; inputPrim < pa.NumPrims(); ++inputPrim)
@@ -433,73 +448,68 @@ public:
             uint32_t numEmittedPrims = GetNumPrims(clipTopology, numEmittedVerts);
             numClippedPrims += numEmittedPrims;
 
-            // tranpose clipper output so that each lane's vertices are in SIMD order
-            // set aside space for 2 vertices, as the PA will try to read up to 16 verts
-            // for triangle fan
-            simdvertex transposedPrims[2];
-
-            // transpose pos
-            uint8_t* pBase = (uint8_t*)(&vertices[0].attrib[VERTEX_POSITION_SLOT]) + sizeof(float) * inputPrim;
-            for (uint32_t c = 0; c < 4; ++c)
-            {
-                transposedPrims[0].attrib[VERTEX_POSITION_SLOT][c] = _simd_mask_i32gather_ps(_mm256_undefined_ps(), (const float*)pBase, vOffsets, vMask, 1);
-                pBase += sizeof(simdscalar);
-            }
-
-            // transpose attribs
-            pBase = (uint8_t*)(&vertices[0].attrib[VERTEX_ATTRIB_START_SLOT]) + sizeof(float) * inputPrim;
-            for (uint32_t attrib = 0; attrib < numAttribs; ++attrib)
+            for (uint32_t prim = 0; prim < numEmittedPrims; ++prim)
             {
-                uint32_t attribSlot = VERTEX_ATTRIB_START_SLOT + attrib;
-                for (uint32_t c = 0; c < 4; ++c)
+                for (uint32_t v = 0; v < numBinVertsPerPrim; ++v)
                 {
-                    transposedPrims[0].attrib[attribSlot][c] = _simd_mask_i32gather_ps(_mm256_undefined_ps(), (const float*)pBase, vOffsets, vMask, 1);
-                    pBase += sizeof(simdscalar);
-                }
-            }
-
-            // transpose user clip distances if enabled
-            if (this->state.rastState.clipDistanceMask & 0xf)
-            {
-                pBase = (uint8_t*)(&vertices[0].attrib[VERTEX_CLIPCULL_DIST_LO_SLOT]) + sizeof(float) * inputPrim;
-                for (uint32_t c = 0; c < 4; ++c)
-                {
-                    transposedPrims[0].attrib[VERTEX_CLIPCULL_DIST_LO_SLOT][c] = _simd_mask_i32gather_ps(_mm256_undefined_ps(), (const float*)pBase, vOffsets, vMask, 1);
-                    pBase += sizeof(simdscalar);
+                    // fans are emitted as (0, prim + 1, prim + 2)
+                    uint32_t srcVert = (clipTopology == TOP_TRIANGLE_FAN) ? (v ? prim + v : 0) : prim * numBinVertsPerPrim + v;
+                    uint32_t dstVert = numBinPrims * numBinVertsPerPrim + v;
+                    const simdvertex& src = vertices[srcVert];
+                    simdvertex& dst = binVerts[dstVert / KNOB_SIMD_WIDTH];
+                    uint32_t dstLane = dstVert % KNOB_SIMD_WIDTH;
+
+                    for (uint32_t s = 0; s < numCopySlots; ++s)
+                    {
+                        uint32_t slot = copySlots[s];
+                        for (uint32_t c = 0; c < 4; ++c)
+                        {
+                            ((float*)&dst.attrib[slot][c])[dstLane] = ((const float*)&src.attrib[slot][c])[inputPrim];
+                        }
+                    }
                 }
-            }
 
-            if (this->state.rastState.clipDistanceMask & 0xf0)
-            {
-                pBase = (uint8_t*)(&vertices[0].attrib[VERTEX_CLIPCULL_DIST_HI_SLOT]) + sizeof(float) * inputPrim;
-                for (uint32_t c = 0; c < 4; ++c)
+                binPrimIds[numBinPrims++] = pPrimitiveId[inputPrim];
+                if (numBinPrims == KNOB_SIMD_WIDTH)
                 {
-                    transposedPrims[0].attrib[VERTEX_CLIPCULL_DIST_HI_SLOT][c] = _simd_mask_i32gather_ps(_mm256_undefined_ps(), (const float*)pBase, vOffsets, vMask, 1);
-                    pBase += sizeof(simdscalar);
+                    BinClippedPrims(binVerts, numBinPrims, numBinVertsPerPrim, binTopology, pfnBinFunc, binPrimIds);
+                    numBinPrims = 0;
                 }
             }
+        }
 
-            PA_STATE_OPT clipPa(this->pDC, numEmittedPrims, (uint8_t*)&transposedPrims[0], numEmittedVerts, true, clipTopology);
-
-            while (clipPa.GetNextStreamOutput())
-            {
-                do
-                {
-                    simdvector attrib[NumVertsPerPrim];
-                    bool assemble = clipPa.Assemble(VERTEX_POSITION_SLOT, attrib);
-                    if (assemble)
-                    {
-                        static const uint32_t primMaskMap[] = { 0x0, 0x1, 0x3, 0x7, 0xf, 0x1f, 0x3f, 0x7f, 0xff };
-                        pfnBinFunc(this->pDC, clipPa, this->workerId, attrib, primMaskMap[numEmittedPrims], _simd_set1_epi32(pPrimitiveId[inputPrim]));
-                    }
-                } while (clipPa.NextPrim());
-            }
+        if (numBinPrims)
+        {
+            BinClippedPrims(binVerts, numBinPrims, numBinVertsPerPrim, binTopology, pfnBinFunc, binPrimIds);
         }
 
         // update global pipeline stat
         SWR_CONTEXT* pContext = this->pDC->pContext;
         UPDATE_STAT(CPrimitives, numClippedPrims);
     }
+
+    // bins up to a SIMD of clipped prims, stored in list order
+    void BinClippedPrims(simdvertex* pVertices, uint32_t numPrims, uint32_t numVertsPerPrim, PRIMITIVE_TOPOLOGY topology,
+        PFN_PROCESS_PRIMS pfnBinFunc, const uint32_t* pPrimIds)
+    {
+        static const uint32_t primMaskMap[] = { 0x0, 0x1, 0x3, 0x7, 0xf, 0x1f, 0x3f, 0x7f, 0xff };
+        simdscalari vPrimId = _simd_load_si((const simdscalari*)pPrimIds);
+
+        PA_STATE_OPT clipPa(this->pDC, numPrims, (uint8_t*)pVertices, numVertsPerPrim * KNOB_SIMD_WIDTH, true, topology);
+
+        while (clipPa.GetNextStreamOutput())
+        {
+            do
+            {
+                simdvector attrib[NumVertsPerPrim];
+                bool assemble = clipPa.Assemble(VERTEX_POSITION_SLOT, attrib);
+                if (assemble)
+                {
+                    pfnBinFunc(this->pDC, clipPa, this->workerId, attrib, primMaskMap[numPrims], vPrimId);
+                }
+            } while (clipPa.NextPrim());
+        }
+    }
     
     // execute the clipper stage
     void ExecuteStage(PA_STATE& pa, simdvector prim[], uint32_t primMask, simdscalari primId)
@@ -904,6 +914,56 @@ private:
     /// @param pVertices - pointer to vertices in SOA form. Clipper will read input and write results to this buffer
     /// @param vPrimMask - mask of valid input primitives, including non-clipped prims
     /// @param numAttribs - number of valid input attribs, including position
+    template<SWR_CLIPCODES ClippingPlane>
+    inline simdscalari ClipToPlane(float*& pInVerts, float*& pOutVerts, const simdscalari& vNumInPts, int numAttribs)
+    {
+        simdscalari vNumOutPts;
+        if (NumVertsPerPrim == 3)
+        {
+            vNumOutPts = ClipTriToPlane<ClippingPlane>(pInVerts, vNumInPts, numAttribs, pOutVerts);
+        }
+        else
+        {
+            SWR_ASSERT(NumVertsPerPrim == 2);
+            vNumOutPts = ClipLineToPlane<ClippingPlane>(pInVerts, vNumInPts, numAttribs, pOutVerts);
+        }
+
+        std::swap(pInVerts, pOutVerts);
+        return vNumOutPts;
+    }
+
+    // returns the frustum planes the clipped prims need to be clipped against
+    uint32_t ComputeClipPlanes(const simdscalar& vClipMask)
+    {
+        OSALIGNSIMD(uint32_t) clipCodes[KNOB_SIMD_WIDTH];
+        _simd_store_ps((float*)clipCodes, _simd_and_ps(ComputeClipCodeUnion(), vClipMask));
+
+        uint32_t clipCodeUnion = 0;
+        for (uint32_t lane = 0; lane < KNOB_SIMD_WIDTH; ++lane)
+        {
+            clipCodeUnion |= clipCodes[lane];
+        }
+
+        // vertices behind the eye need the full clip
+        if (clipCodeUnion & NEGW)
+        {
+            return FRUSTUM_CLIP_MASK;
+        }
+
+        // Otherwise only clip to the planes some vertex is outside of.
+        // Clipping to one plane leaves the new vertices on the inside of all
+        // the half-spaces the prim was already in, so the x/y planes are only
+        // needed past the guardband, where the rasterizer can't handle the prim.
+        // The guardband codes share their high bit, so test the low bits.
+        uint32_t clipPlanes = clipCodeUnion & (FRUSTUM_NEAR | FRUSTUM_FAR);
+        if (clipCodeUnion & GUARDBAND_LEFT & 0xf)   clipPlanes |= FRUSTUM_LEFT;
+        if (clipCodeUnion & GUARDBAND_TOP & 0xf)    clipPlanes |= FRUSTUM_TOP;
+        if (clipCodeUnion & GUARDBAND_RIGHT & 0xf)  clipPlanes |= FRUSTUM_RIGHT;
+        if (clipCodeUnion & GUARDBAND_BOTTOM & 0xf) clipPlanes |= FRUSTUM_BOTTOM;
+
+        return clipPlanes;
+    }
+
     simdscalari ClipPrims(float* pVertices, const simdscalar& vPrimMask, const simdscalar& vClipMask, int numAttribs)
     {
         // temp storage
@@ -913,28 +973,36 @@ private:
         simdscalari vNumInPts = _simd_set1_epi32(NumVertsPerPrim);
         vNumInPts = _simd_blendv_epi32(_simd_setzero_si(), vNumInPts, vClipMask);
 
-        // clip prims to frustum
-        simdscalari vNumOutPts;
-        if (NumVertsPerPrim == 3)
-        {
-            vNumOutPts = ClipTriToPlane<FRUSTUM_NEAR>(pVertices, vNumInPts, numAttribs, pTempVerts);
-            vNumOutPts = ClipTriToPlane<FRUSTUM_FAR>(pTempVerts, vNumOutPts, numAttribs, pVertices);
-            vNumOutPts = ClipTriToPlane<FRUSTUM_LEFT>(pVertices, vNumOutPts, numAttribs, pTempVerts);
-            vNumOutPts = ClipTriToPlane<FRUSTUM_RIGHT>(pTempVerts, vNumOutPts, numAttribs, pVertices);
-            vNumOutPts = ClipTriToPlane<FRUSTUM_BOTTOM>(pVertices, vNumOutPts, numAttribs, pTempVerts);
-            vNumOutPts = ClipTriToPlane<FRUSTUM_TOP>(pTempVerts, vNumOutPts, numAttribs, pVertices);
-        }
-        else
+        uint32_t clipPlanes = ComputeClipPlanes(vClipMask);
+
+        // The non-clipped lanes are only present in pVertices, so the output
+        // has to end up back there.  For an odd number of planes, also clip to
+        // one of the remaining ones, which is always safe.
+        if (_mm_popcnt_u32(clipPlanes) & 1)
         {
-            SWR_ASSERT(NumVertsPerPrim == 2);
-            vNumOutPts = ClipLineToPlane<FRUSTUM_NEAR>(pVertices, vNumInPts, numAttribs, pTempVerts);
-            vNumOutPts = ClipLineToPlane<FRUSTUM_FAR>(pTempVerts, vNumOutPts, numAttribs, pVertices);
-            vNumOutPts = ClipLineToPlane<FRUSTUM_LEFT>(pVertices, vNumOutPts, numAttribs, pTempVerts);
-            vNumOutPts = ClipLineToPlane<FRUSTUM_RIGHT>(pTempVerts, vNumOutPts, numAttribs, pVertices);
-            vNumOutPts = ClipLineToPlane<FRUSTUM_BOTTOM>(pVertices, vNumOutPts, numAttribs, pTempVerts);
-            vNumOutPts = ClipLineToPlane<FRUSTUM_TOP>(pTempVerts, vNumOutPts, numAttribs, pVertices);
+            static const uint32_t padPlanes[] = { FRUSTUM_LEFT, FRUSTUM_RIGHT, FRUSTUM_BOTTOM, FRUSTUM_TOP, FRUSTUM_NEAR, FRUSTUM_FAR };
+            for (uint32_t plane : padPlanes)
+            {
+                if (!(clipPlanes & plane))
+                {
+                    clipPlanes |= plane;
+                    break;
+                }
+            }
         }
 
+        // clip prims to frustum
+        float* pInVerts = pVertices;
+        float* pOutVerts = pTempVerts;
+        simdscalari vNumOutPts = vNumInPts;
+        if (clipPlanes & FRUSTUM_NEAR)   vNumOutPts = ClipToPlane<FRUSTUM_NEAR>(pInVerts, pOutVerts, vNumOutPts, numAttribs);
+        if (clipPlanes & FRUSTUM_FAR)    vNumOutPts = ClipToPlane<FRUSTUM_FAR>(pInVerts, pOutVerts, vNumOutPts, numAttribs);
+        if (clipPlanes & FRUSTUM_LEFT)   vNumOutPts = ClipToPlane<FRUSTUM_LEFT>(pInVerts, pOutVerts, vNumOutPts, numAttribs);
+        if (clipPlanes & FRUSTUM_RIGHT)  vNumOutPts = ClipToPlane<FRUSTUM_RIGHT>(pInVerts, pOutVerts, vNumOutPts, numAttribs);
+        if (clipPlanes & FRUSTUM_BOTTOM) vNumOutPts = ClipToPlane<FRUSTUM_BOTTOM>(pInVerts, pOutVerts, vNumOutPts, numAttribs);
+        if (clipPlanes & FRUSTUM_TOP)    vNumOutPts = ClipToPlane<FRUSTUM_TOP>(pInVerts, pOutVerts, vNumOutPts, numAttribs);
+        SWR_ASSERT(pInVerts == pVertices);
+
         // restore num verts for non-clipped, active lanes
         simdscalar vNonClippedMask = _simd_andnot_ps(vClipMask, vPrimMask);
         vNumOutPts = _simd_blendv_epi32(vNumOutPts, _simd_set1_epi32(NumVertsPerPrim), vNonClippedMask);
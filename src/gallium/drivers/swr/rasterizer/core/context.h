@@ -140,6 +140,7 @@ struct STORE_TILES_DESC
 {
     SWR_RENDERTARGET_ATTACHMENT attachment;
     SWR_TILE_STATE postStoreTileState;
+    SWR_RECT rect;
 };
 
 struct COMPUTE_DESC
@@ -442,7 +443,12 @@ struct SWR_CONTEXT
     //  3. State - When an applications sets state after draw
     //     a. Same as step 1.
     //     b. State is copied from prev draw context to current.
+    //  4. The ring is allocated with MAX_DRAWS_IN_FLIGHT entries but starts out accepting fewer.
+    //     When the API thread stalls on a full ring again before a ring's worth of draws went
+    //     by, the accepted count is doubled, see GetDrawContext.
     RingBuffer<DRAW_CONTEXT> dcRing;
+    uint32_t MAX_DRAWS_IN_FLIGHT;      // Number of entries in the DC and DS rings.
+    uint64_t lastStallDrawId;          // Head of the DC ring the last time the API thread stalled on it.
 
     DRAW_CONTEXT *pCurDrawContext;    // This points to DC entry in ring for an unsubmitted draw.
     DRAW_CONTEXT *pPrevDrawContext;   // This points to DC entry for the previous context submitted that we can copy state from.
@@ -459,6 +465,7 @@ struct SWR_CONTEXT
     uint32_t NumWorkerThreads;
 
     THREAD_POOL threadPool; // Thread pool associated with this context
+    THREAD_CONTEXT_STATE *pWorkerState; // Per worker progress, when using the shared thread pool
 
     std::condition_variable FifosNotEmpty;
     std::mutex WaitLock;
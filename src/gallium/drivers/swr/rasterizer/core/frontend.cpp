@@ -166,18 +166,32 @@ void ProcessStoreTiles(
     const uint32_t macroWidth = KNOB_MACROTILE_X_DIM;
     const uint32_t macroHeight = KNOB_MACROTILE_Y_DIM;
 
+    uint32_t macroTileStartX = 0;
+    uint32_t macroTileStartY = 0;
     uint32_t numMacroTilesX = ((uint32_t)state.vp[0].width + (uint32_t)state.vp[0].x + (macroWidth - 1)) / macroWidth;
     uint32_t numMacroTilesY = ((uint32_t)state.vp[0].height + (uint32_t)state.vp[0].y + (macroHeight - 1)) / macroHeight;
 
+    if (pStore->rect.top | pStore->rect.bottom | pStore->rect.right | pStore->rect.left)
+    {
+        // only the macrotiles covered by rect, including partial ones
+        macroTileStartX = pStore->rect.left / macroWidth;
+        macroTileStartY = pStore->rect.top / macroHeight;
+        numMacroTilesX = (pStore->rect.right + macroWidth - 1) / macroWidth;
+        numMacroTilesY = (pStore->rect.bottom + macroHeight - 1) / macroHeight;
+    }
+
+    numMacroTilesX = std::min<uint32_t>(numMacroTilesX, KNOB_NUM_HOT_TILES_X);
+    numMacroTilesY = std::min<uint32_t>(numMacroTilesY, KNOB_NUM_HOT_TILES_Y);
+
     // store tiles
     BE_WORK work;
     work.type = STORETILES;
     work.pfnWork = ProcessStoreTileBE;
     work.desc.storeTiles = *pStore;
 
-    for (uint32_t x = 0; x < numMacroTilesX; ++x)
+    for (uint32_t x = macroTileStartX; x < numMacroTilesX; ++x)
     {
-        for (uint32_t y = 0; y < numMacroTilesY; ++y)
+        for (uint32_t y = macroTileStartY; y < numMacroTilesY; ++y)
         {
             pTileMgr->enqueue(x, y, &work);
         }
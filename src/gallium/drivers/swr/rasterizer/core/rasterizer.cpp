@@ -422,6 +422,64 @@ void ComputeEdgeData(const POS& p0, const POS& p1, EDGE& edge)
     ComputeEdgeData(p0.y - p1.y, p1.x - p0.x, edge);
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns true if samples of a primitive failing the LT/LE depth test
+/// have no effect at all.  Raster tiles whose max depth is in front of the
+/// nearest depth of the primitive can then be skipped.
+INLINE bool CanDepthCull(const API_STATE& state)
+{
+    const SWR_DEPTH_STENCIL_STATE &dsState = state.depthStencilState;
+
+    return state.depthHottileEnable && dsState.depthTestEnable &&
+        (dsState.depthTestFunc == ZFUNC_LT || dsState.depthTestFunc == ZFUNC_LE) &&
+        !dsState.stencilTestEnable && !dsState.stencilWriteEnable &&
+        !state.psState.writesODepth && !state.psState.usesUAV;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Get the depth hottile if its max depth needs to be used or
+/// maintained by the rasterizer, or nullptr.
+/// @param depthCull - in: depth culling is possible for the primitive,
+///                    out: the max depth of the hottile can be used for it
+HOTTILE* GetMaxDepthHotTile(DRAW_CONTEXT *pDC, uint32_t macroTile, uint32_t numSamples,
+    uint32_t renderTargetArrayIndex, bool &depthCull)
+{
+    const API_STATE &state = GetApiState(pDC);
+    SWR_CONTEXT *pContext = pDC->pContext;
+
+    if (!KNOB_DEPTH_CULL || !state.depthHottileEnable)
+    {
+        depthCull = false;
+        return nullptr;
+    }
+
+    HOTTILE *pHotTile = pContext->pHotTileMgr->GetHotTile(pContext, pDC, macroTile, SWR_ATTACHMENT_DEPTH, true,
+        numSamples, renderTargetArrayIndex);
+
+    // only rebuild the max depth for a primitive that can use it
+    if (depthCull && !pHotTile->maxDepthValid)
+    {
+        HotTileMgr::UpdateMaxDepth(pHotTile);
+    }
+
+    if (!pHotTile->maxDepthValid)
+    {
+        return nullptr;
+    }
+
+    // nothing to cull against or maintain
+    if (!depthCull && !state.depthStencilState.depthWriteEnable)
+    {
+        return nullptr;
+    }
+
+    return pHotTile;
+}
+
+// Margin for the difference between the depth interpolated by the backend
+// and the nearest vertex depth.
+static const float DepthCullEpsilon = 1.0f / (1 << 16);
+
 template<bool RasterizeScissorEdges, SWR_MULTISAMPLE_COUNT sampleCount>
 void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile, void* pDesc)
 {
@@ -544,7 +602,12 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
     triDesc.Z[2] = a[2];
         
     // add depth bias
-    triDesc.Z[2] += ComputeDepthBias(&rastState, &triDesc, workDesc.pTriBuffer + 8);
+    float depthBias = ComputeDepthBias(&rastState, &triDesc, workDesc.pTriBuffer + 8);
+    triDesc.Z[2] += depthBias;
+
+    // nearest depth the backend can compute for the triangle, clamped like in DepthStencilTest
+    float minZ = std::min(std::min(a[0], a[1]), a[2]) + depthBias;
+    minZ = std::min(state.vp[0].maxZ, std::max(state.vp[0].minZ, minZ));
 
     // Compute edge data
     OSALIGNSIMD(int32_t) aAi[4], aBi[4];
@@ -619,6 +682,39 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
         return;
     }
 
+    // raster tile indices of the triangle bbox within the hottile
+    uint32_t hotTileX = tileX - macroX * KNOB_MACROTILE_X_DIM_IN_TILES;
+    uint32_t hotTileY = tileY - macroY * KNOB_MACROTILE_Y_DIM_IN_TILES;
+
+    bool depthCull = CanDepthCull(state);
+    HOTTILE *pDepthHotTile = GetMaxDepthHotTile(pDC, macroTile, MultisampleTraits<sampleCount>::numSamples,
+        triDesc.triFlags.renderTargetArrayIndex, depthCull);
+
+    // reject the whole triangle if it's behind all raster tiles it touches
+    if (depthCull)
+    {
+        bool anyVisible = false;
+        for (uint32_t y = 0; y < numTilesY && !anyVisible; ++y)
+        {
+            const float *pMaxDepth = pDepthHotTile->pMaxDepth + (hotTileY + y) * KNOB_MACROTILE_X_DIM_IN_TILES + hotTileX;
+            for (uint32_t x = 0; x < numTilesX; ++x)
+            {
+                if (minZ <= pMaxDepth[x] + DepthCullEpsilon)
+                {
+                    anyVisible = true;
+                    break;
+                }
+            }
+        }
+
+        if (!anyVisible)
+        {
+            RDTSC_EVENT(BEEmptyTriangle, 1, 0);
+            RDTSC_STOP(BERasterizeTriangle, 1, 0);
+            return;
+        }
+    }
+
     RDTSC_START(BEStepSetup);
 
     // Step to pixel center of top-left pixel of the triangle bbox
@@ -754,9 +850,18 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
         {
             triDesc.anyCoveredSamples = 0;
 
+            uint32_t rasterTileX = hotTileX + (tileX - tX);
+            uint32_t rasterTileY = hotTileY + (tileY - tY);
+
             // is the corner of the edge outside of the raster tile? (vEdge < 0)
             int mask0, mask1, mask2;
-            if (sampleCount == SWR_MULTISAMPLE_1X)
+            if (depthCull &&
+                minZ > pDepthHotTile->pMaxDepth[rasterTileY * KNOB_MACROTILE_X_DIM_IN_TILES + rasterTileX] + DepthCullEpsilon)
+            {
+                // whole raster tile is behind the depth buffer, treat as trivially rejected
+                mask0 = mask1 = mask2 = 0;
+            }
+            else if (sampleCount == SWR_MULTISAMPLE_1X)
             {
                 mask0 = _mm256_movemask_pd(vEdgeFix16[0]);
                 mask1 = _mm256_movemask_pd(vEdgeFix16[1]);
@@ -866,6 +971,11 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
                 RDTSC_START(BEPixelBackend);
                 backendFuncs.pfnBackend(pDC, workerId, tileX << KNOB_TILE_X_DIM_SHIFT, tileY << KNOB_TILE_Y_DIM_SHIFT, triDesc, renderBuffers);
                 RDTSC_STOP(BEPixelBackend, 0, 0);
+
+                if (pDepthHotTile && state.depthStencilState.depthWriteEnable)
+                {
+                    HotTileMgr::UpdateMaxDepth(pDepthHotTile, rasterTileX, rasterTileY);
+                }
             }
 
             // step to the next tile in X
@@ -1032,6 +1142,7 @@ void RasterizeSimplePoint(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTi
 #endif
 
     const TRIANGLE_WORK_DESC& workDesc = *(const TRIANGLE_WORK_DESC*)pData;
+    const API_STATE &state = GetApiState(pDC);
     const BACKEND_FUNCS& backendFuncs = pDC->pState->backendFuncs;
 
     // map x,y relative offsets from start of raster tile to bit position in 
@@ -1075,6 +1186,22 @@ void RasterizeSimplePoint(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTi
     triDesc.J[0] = triDesc.J[1] = triDesc.J[2] = 0.0f;
     triDesc.Z[0] = triDesc.Z[1] = triDesc.Z[2] = z;
 
+    uint32_t macroX, macroY;
+    MacroTileMgr::getTileIndices(macroTile, macroX, macroY);
+    uint32_t rasterTileX = (tileAlignedX >> KNOB_TILE_X_DIM_SHIFT) - macroX * KNOB_MACROTILE_X_DIM_IN_TILES;
+    uint32_t rasterTileY = (tileAlignedY >> KNOB_TILE_Y_DIM_SHIFT) - macroY * KNOB_MACROTILE_Y_DIM_IN_TILES;
+
+    bool depthCull = CanDepthCull(state);
+    HOTTILE *pDepthHotTile = GetMaxDepthHotTile(pDC, macroTile, 1, triDesc.triFlags.renderTargetArrayIndex, depthCull);
+    if (depthCull)
+    {
+        float minZ = std::min(state.vp[0].maxZ, std::max(state.vp[0].minZ, z));
+        if (minZ > pDepthHotTile->pMaxDepth[rasterTileY * KNOB_MACROTILE_X_DIM_IN_TILES + rasterTileX] + DepthCullEpsilon)
+        {
+            return;
+        }
+    }
+
     RenderOutputBuffers renderBuffers;
     GetRenderHotTiles(pDC, macroTile, tileAlignedX >> KNOB_TILE_X_DIM_SHIFT , tileAlignedY >> KNOB_TILE_Y_DIM_SHIFT, 
         renderBuffers, 1, triDesc.triFlags.renderTargetArrayIndex);
@@ -1082,6 +1209,11 @@ void RasterizeSimplePoint(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTi
     RDTSC_START(BEPixelBackend);
     backendFuncs.pfnBackend(pDC, workerId, tileAlignedX, tileAlignedY, triDesc, renderBuffers);
     RDTSC_STOP(BEPixelBackend, 0, 0);
+
+    if (pDepthHotTile && state.depthStencilState.depthWriteEnable)
+    {
+        HotTileMgr::UpdateMaxDepth(pDepthHotTile, rasterTileX, rasterTileY);
+    }
 }
 
 // Get pointers to hot tile memory for color RT, depth, stencil
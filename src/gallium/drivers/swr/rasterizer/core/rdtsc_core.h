@@ -96,6 +96,7 @@ void rdtscInit(int threadId);
 void rdtscStart(uint32_t bucketId);
 void rdtscStop(uint32_t bucketId, uint32_t count, uint64_t drawId);
 void rdtscEvent(uint32_t bucketId, uint32_t count1, uint32_t count2);
+void rdtscSetContext(uint32_t drawId, uint32_t macroTile);
 void rdtscEndFrame();
 
 #ifdef KNOB_ENABLE_RDTSC
@@ -104,6 +105,7 @@ void rdtscEndFrame();
 #define RDTSC_START(bucket) rdtscStart(bucket)
 #define RDTSC_STOP(bucket, count, draw) rdtscStop(bucket, count, draw)
 #define RDTSC_EVENT(bucket, count1, count2) rdtscEvent(bucket, count1, count2)
+#define RDTSC_SET_CONTEXT(draw, macroTile) rdtscSetContext((uint32_t)(draw), macroTile)
 #define RDTSC_ENDFRAME() rdtscEndFrame()
 #else
 #define RDTSC_RESET()
@@ -111,6 +113,7 @@ void rdtscEndFrame();
 #define RDTSC_START(bucket)
 #define RDTSC_STOP(bucket, count, draw)
 #define RDTSC_EVENT(bucket, count1, count2)
+#define RDTSC_SET_CONTEXT(draw, macroTile)
 #define RDTSC_ENDFRAME()
 #endif
 
@@ -160,10 +163,18 @@ INLINE void rdtscEvent(uint32_t bucketId, uint32_t count1, uint32_t count2)
     gBucketMgr.AddEvent(id, count1);
 }
 
+INLINE void rdtscSetContext(uint32_t drawId, uint32_t macroTile)
+{
+    gBucketMgr.SetTraceContext(drawId, macroTile);
+}
+
 INLINE void rdtscEndFrame()
 {
     gCurrentFrame++;
 
+    // stream out the trace events of the last frame
+    gBucketMgr.FlushTrace();
+
     if (gCurrentFrame == KNOB_BUCKETS_START_FRAME)
     {
         gBucketMgr.StartCapture();
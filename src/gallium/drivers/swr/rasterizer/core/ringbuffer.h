@@ -34,7 +34,7 @@ class RingBuffer
 {
 public:
     RingBuffer()
-        : mpRingBuffer(nullptr), mNumEntries(0), mRingHead(0), mRingTail(0)
+        : mpRingBuffer(nullptr), mNumEntries(0), mMaxInFlight(0), mRingHead(0), mRingTail(0)
     {
     }
 
@@ -47,6 +47,7 @@ public:
     {
         SWR_ASSERT(numEntries > 0);
         mNumEntries = numEntries;
+        mMaxInFlight = numEntries;
         mpRingBuffer = (T*)_aligned_malloc(sizeof(T)*numEntries, 64);
         SWR_ASSERT(mpRingBuffer != nullptr);
         memset(mpRingBuffer, 0, sizeof(T)*numEntries);
@@ -58,6 +59,18 @@ public:
         mpRingBuffer = nullptr;
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Limit the number of enqueued entries IsFull() allows, so the
+    ///        ring can be grown without moving entries other threads use.
+    ///        Indices still wrap at numEntries.
+    void SetMaxInFlight(uint32_t maxInFlight)
+    {
+        SWR_ASSERT(maxInFlight > 0 && maxInFlight <= mNumEntries);
+        mMaxInFlight = maxInFlight;
+    }
+
+    INLINE uint32_t GetMaxInFlight() { return mMaxInFlight; }
+
     T& operator[](const uint32_t index)
     {
         SWR_ASSERT(index < mNumEntries);
@@ -87,7 +100,7 @@ public:
         uint64_t numEnqueued = GetHead() - GetTail();
         SWR_ASSERT(numEnqueued <= mNumEntries);
 
-        return (numEnqueued == mNumEntries);
+        return (numEnqueued >= mMaxInFlight);
     }
 
     INLINE volatile uint64_t GetTail() { return mRingTail; }
@@ -96,6 +109,7 @@ public:
 protected:
     T* mpRingBuffer;
     uint32_t mNumEntries;
+    uint32_t mMaxInFlight;  // Only touched by the producer
 
     OSALIGNLINE(volatile uint64_t) mRingHead;  // Consumer Counter
     OSALIGNLINE(volatile uint64_t) mRingTail;  // Producer Counter
@@ -29,6 +29,9 @@
 #include <utility>
 #include <fstream>
 #include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 #if defined(__linux__) || defined(__gnu_linux__)
 #include <pthread.h>
@@ -269,7 +272,7 @@ uint64_t GetEnqueuedDraw(SWR_CONTEXT *pContext)
 INLINE
 DRAW_CONTEXT *GetDC(SWR_CONTEXT *pContext, uint64_t drawId)
 {
-    return &pContext->dcRing[(drawId-1) % KNOB_MAX_DRAWS_IN_FLIGHT];
+    return &pContext->dcRing[(drawId-1) % pContext->MAX_DRAWS_IN_FLIGHT];
 }
 
 // returns true if dependency not met
@@ -308,7 +311,7 @@ INLINE bool FindFirstIncompleteDraw(SWR_CONTEXT* pContext, uint64_t& curDrawBE)
     uint64_t drawEnqueued = GetEnqueuedDraw(pContext);
     while (curDrawBE < drawEnqueued)
     {
-        DRAW_CONTEXT *pDC = &pContext->dcRing[curDrawBE % KNOB_MAX_DRAWS_IN_FLIGHT];
+        DRAW_CONTEXT *pDC = &pContext->dcRing[curDrawBE % pContext->MAX_DRAWS_IN_FLIGHT];
 
         // If its not compute and FE is not done then break out of loop.
         if (!pDC->doneFE && !pDC->isCompute) break;
@@ -332,7 +335,7 @@ INLINE bool FindFirstIncompleteDraw(SWR_CONTEXT* pContext, uint64_t& curDrawBE)
 }
 
 //////////////////////////////////////////////////////////////////////////
-/// @brief If there is any BE work then go work on it.
+/// @brief If there is any BE work on the macrotiles of a NUMA node then go work on it.
 /// @param pContext - pointer to SWR context.
 /// @param workerId - The unique worker ID that is assigned to this thread.
 /// @param curDrawBE - This tracks the draw contexts that this thread has processed. Each worker thread
@@ -345,7 +348,10 @@ INLINE bool FindFirstIncompleteDraw(SWR_CONTEXT* pContext, uint64_t& curDrawBE)
 ///                      still have work pending in a previous draw. Additionally, the lockedTiles is
 ///                      hueristic that can steer a worker back to the same macrotile that it had been
 ///                      working on in a previous draw.
-void WorkOnFifoBE(
+/// @param numaNode - NUMA node whose macrotiles to work on.
+/// @param numaMask - Mask applied to macrotile coordinates to get their NUMA node.
+/// @return true if any macrotile was worked on.
+static bool WorkOnMacroTiles(
     SWR_CONTEXT *pContext,
     uint32_t workerId,
     uint64_t &curDrawBE,
@@ -353,14 +359,17 @@ void WorkOnFifoBE(
     uint32_t numaNode,
     uint32_t numaMask)
 {
+    uint32_t numWorkers = std::max(pContext->NumWorkerThreads, 1u);
+    bool foundWork = false;
+
     // Find the first incomplete draw that has pending work. If no such draw is found then
     // return. FindFirstIncompleteDraw is responsible for incrementing the curDrawBE.
     if (FindFirstIncompleteDraw(pContext, curDrawBE) == false)
     {
-        return;
+        return false;
     }
 
-    uint64_t lastRetiredDraw = pContext->dcRing[curDrawBE % KNOB_MAX_DRAWS_IN_FLIGHT].drawId - 1;
+    uint64_t lastRetiredDraw = pContext->dcRing[curDrawBE % pContext->MAX_DRAWS_IN_FLIGHT].drawId - 1;
 
     // Reset our history for locked tiles. We'll have to re-learn which tiles are locked.
     lockedTiles.clear();
@@ -372,26 +381,33 @@ void WorkOnFifoBE(
     //      maintain order. The locked tiles provides the history to ensures this.
     for (uint64_t i = curDrawBE; i < GetEnqueuedDraw(pContext); ++i)
     {
-        DRAW_CONTEXT *pDC = &pContext->dcRing[i % KNOB_MAX_DRAWS_IN_FLIGHT];
+        DRAW_CONTEXT *pDC = &pContext->dcRing[i % pContext->MAX_DRAWS_IN_FLIGHT];
 
-        if (pDC->isCompute) return; // We don't look at compute work.
+        if (pDC->isCompute) return foundWork; // We don't look at compute work.
 
         // First wait for FE to be finished with this draw. This keeps threading model simple
         // but if there are lots of bubbles between draws then serializing FE and BE may
         // need to be revisited.
-        if (!pDC->doneFE) return;
+        if (!pDC->doneFE) return foundWork;
         
         // If this draw is dependent on a previous draw then we need to bail.
         if (CheckDependency(pContext, pDC, lastRetiredDraw))
         {
-            return;
+            return foundWork;
         }
 
         // Grab the list of all dirty macrotiles. A tile is dirty if it has work queued to it.
         std::vector<uint32_t> &macroTiles = pDC->pTileMgr->getDirtyTiles();
 
-        for (uint32_t tileID : macroTiles)
+        // Start each worker at a different point of the list, so that workers don't all
+        // contend for the first tiles and tend to get the same tiles from draw to draw.
+        size_t numTiles = macroTiles.size();
+        size_t firstTile = numTiles ? (workerId * numTiles / numWorkers) : 0;
+
+        for (size_t t = 0; t < numTiles; ++t)
         {
+            uint32_t tileID = macroTiles[(firstTile + t) % numTiles];
+
             // Only work on tiles for for this numa node
             uint32_t x, y;
             pDC->pTileMgr->getTileIndices(tileID, x, y);
@@ -417,7 +433,9 @@ void WorkOnFifoBE(
             {
                 BE_WORK *pWork;
 
+                RDTSC_SET_CONTEXT(pDC->drawId, tileID);
                 RDTSC_START(WorkerFoundWork);
+                foundWork = true;
 
                 uint32_t numWorkItems = tile.getNumQueued();
                 SWR_ASSERT(numWorkItems);
@@ -461,6 +479,43 @@ void WorkOnFifoBE(
             }
         }
     }
+
+    return foundWork;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief If there is any BE work then go work on it.
+/// @param pContext - pointer to SWR context.
+/// @param workerId - The unique worker ID that is assigned to this thread.
+/// @param curDrawBE - This tracks the draw contexts that this thread has processed.
+/// @param lockedTiles - This is the set of tiles locked by other threads.
+/// @param numaNode - NUMA node of the worker.
+/// @param numaMask - Mask applied to macrotile coordinates to get their NUMA node.
+/// @see WorkOnMacroTiles
+void WorkOnFifoBE(
+    SWR_CONTEXT *pContext,
+    uint32_t workerId,
+    uint64_t &curDrawBE,
+    TileSet& lockedTiles,
+    uint32_t numaNode,
+    uint32_t numaMask)
+{
+    if (WorkOnMacroTiles(pContext, workerId, curDrawBE, lockedTiles, numaNode, numaMask))
+    {
+        return;
+    }
+
+    // Nothing to do on our own node, so steal the macrotiles of the others. Each pass
+    // only ever looks at the tiles of one node, which keeps the locked tile history
+    // valid. CPUNumaNodes has no node distances, so victims are visited by increasing
+    // XOR distance of their id.
+    for (uint32_t distance = 1; distance <= numaMask; ++distance)
+    {
+        if (WorkOnMacroTiles(pContext, workerId, curDrawBE, lockedTiles, numaNode ^ distance, numaMask))
+        {
+            return;
+        }
+    }
 }
 
 void WorkOnFifoFE(SWR_CONTEXT *pContext, uint32_t workerId, uint64_t &curDrawFE, uint32_t numaNode)
@@ -469,7 +524,7 @@ void WorkOnFifoFE(SWR_CONTEXT *pContext, uint32_t workerId, uint64_t &curDrawFE,
     uint64_t drawEnqueued = GetEnqueuedDraw(pContext);
     while (curDrawFE < drawEnqueued)
     {
-        uint32_t dcSlot = curDrawFE % KNOB_MAX_DRAWS_IN_FLIGHT;
+        uint32_t dcSlot = curDrawFE % pContext->MAX_DRAWS_IN_FLIGHT;
         DRAW_CONTEXT *pDC = &pContext->dcRing[dcSlot];
         if (pDC->isCompute || pDC->doneFE || pDC->FeLock)
         {
@@ -485,7 +540,7 @@ void WorkOnFifoFE(SWR_CONTEXT *pContext, uint32_t workerId, uint64_t &curDrawFE,
     uint64_t curDraw = curDrawFE;
     while (curDraw < drawEnqueued)
     {
-        uint32_t dcSlot = curDraw % KNOB_MAX_DRAWS_IN_FLIGHT;
+        uint32_t dcSlot = curDraw % pContext->MAX_DRAWS_IN_FLIGHT;
         DRAW_CONTEXT *pDC = &pContext->dcRing[dcSlot];
 
         if (!pDC->isCompute && !pDC->FeLock)
@@ -494,6 +549,7 @@ void WorkOnFifoFE(SWR_CONTEXT *pContext, uint32_t workerId, uint64_t &curDrawFE,
             if (initial == 0)
             {
                 // successfully grabbed the DC, now run the FE
+                RDTSC_SET_CONTEXT(pDC->drawId, TRACE_NO_MACROTILE);
                 pDC->FeWork.pfnWork(pContext, pDC, workerId, &pDC->FeWork.desc);
 
                 _ReadWriteBarrier();
@@ -521,9 +577,9 @@ void WorkOnCompute(
         return;
     }
 
-    uint64_t lastRetiredDraw = pContext->dcRing[curDrawBE % KNOB_MAX_DRAWS_IN_FLIGHT].drawId - 1;
+    uint64_t lastRetiredDraw = pContext->dcRing[curDrawBE % pContext->MAX_DRAWS_IN_FLIGHT].drawId - 1;
 
-    DRAW_CONTEXT *pDC = &pContext->dcRing[curDrawBE % KNOB_MAX_DRAWS_IN_FLIGHT];
+    DRAW_CONTEXT *pDC = &pContext->dcRing[curDrawBE % pContext->MAX_DRAWS_IN_FLIGHT];
     if (pDC->isCompute == false) return;
 
     // check dependencies
@@ -538,6 +594,8 @@ void WorkOnCompute(
     // Is there any work remaining?
     if (queue.getNumQueued() > 0)
     {
+        RDTSC_SET_CONTEXT(pDC->drawId, TRACE_NO_MACROTILE);
+
         uint32_t threadGroupId = 0;
         while (queue.getWork(threadGroupId))
         {
@@ -548,6 +606,132 @@ void WorkOnCompute(
     }
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief The process-wide thread pool, used by all contexts when
+///        KNOB_SHARED_THREAD_POOL is set.
+///
+///        Each worker keeps its progress through the draws of each context in
+///        the context's pWorkerState, and visits the contexts in turn, so each
+///        context sees the same threading model as with its own pool.
+///
+///        The workers keep a copy of the context list, refreshed whenever
+///        contextsVersion changes. workerVersion tells which version of
+///        the list each worker is using, or ~0 while it sleeps, so that a
+///        context can wait for all workers to drop it before it goes away.
+struct SHARED_THREAD_POOL
+{
+    THREAD_POOL pool;
+    std::mutex createLock;              // serializes attaching and detaching contexts
+    std::mutex lock;                    // protects contexts, and sleeping on workAvailable
+    std::condition_variable workAvailable;
+    std::vector<SWR_CONTEXT*> contexts;
+    std::atomic<uint64_t> contextsVersion;
+    std::atomic<uint64_t> workerVersion[KNOB_MAX_NUM_THREADS];
+};
+
+static SHARED_THREAD_POOL gSharedPool;
+
+static DWORD sharedWorkerThreadMain(THREAD_DATA *pThreadData)
+{
+    SHARED_THREAD_POOL &shared = gSharedPool;
+    uint32_t workerId = pThreadData->workerId;
+    uint32_t numaNode = pThreadData->numaId;
+    uint32_t numaMask = shared.pool.numaMask;
+
+    std::vector<SWR_CONTEXT*> contexts;
+    uint64_t contextsVersion = 0;
+    uint32_t firstContext = 0;
+
+    std::unique_lock<std::mutex> lock(shared.lock, std::defer_lock);
+
+    auto refreshContexts = [&]()
+    {
+        lock.lock();
+        contexts = shared.contexts;
+        contextsVersion = shared.contextsVersion.load();
+        lock.unlock();
+    };
+
+    auto threadHasWork = [&]()
+    {
+        for (SWR_CONTEXT *pContext : contexts)
+        {
+            if (pContext->pWorkerState[workerId].curDrawBE != pContext->dcRing.GetHead())
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    while (shared.pool.inThreadShutdown == false)
+    {
+        // publish the version of the context list in use, then make sure it
+        // didn't change meanwhile
+        do
+        {
+            if (shared.contextsVersion.load() != contextsVersion)
+            {
+                refreshContexts();
+            }
+            shared.workerVersion[workerId].store(contextsVersion);
+        } while (shared.contextsVersion.load() != contextsVersion);
+
+        uint32_t loop = 0;
+        while (loop++ < KNOB_WORKER_SPIN_LOOP_COUNT && !threadHasWork())
+        {
+            _mm_pause();
+        }
+
+        if (!threadHasWork())
+        {
+            lock.lock();
+
+            // check for thread idle condition again under lock, new contexts are
+            // picked up on the next pass
+            if (threadHasWork() || shared.contextsVersion.load() != contextsVersion)
+            {
+                lock.unlock();
+                continue;
+            }
+
+            if (shared.pool.inThreadShutdown)
+            {
+                lock.unlock();
+                break;
+            }
+
+            RDTSC_START(WorkerWaitForThreadEvent);
+
+            shared.workerVersion[workerId].store(~0ULL);
+            shared.workAvailable.wait(lock);
+            lock.unlock();
+
+            RDTSC_STOP(WorkerWaitForThreadEvent, 0, 0);
+            continue;
+        }
+
+        // one pass over each context, starting from a different one each time
+        uint32_t numContexts = (uint32_t)contexts.size();
+        for (uint32_t i = 0; i < numContexts; ++i)
+        {
+            SWR_CONTEXT *pContext = contexts[(firstContext + i) % numContexts];
+            THREAD_CONTEXT_STATE &state = pContext->pWorkerState[workerId];
+
+            RDTSC_START(WorkerWorkOnFifoBE);
+            WorkOnFifoBE(pContext, workerId, state.curDrawBE, state.lockedTiles, numaNode, numaMask);
+            RDTSC_STOP(WorkerWorkOnFifoBE, 0, 0);
+
+            WorkOnCompute(pContext, workerId, state.curDrawBE);
+
+            WorkOnFifoFE(pContext, workerId, state.curDrawFE, numaNode);
+        }
+        firstContext++;
+    }
+
+    return 0;
+}
+
 DWORD workerThreadMain(LPVOID pData)
 {
     THREAD_DATA *pThreadData = (THREAD_DATA*)pData;
@@ -559,12 +743,18 @@ DWORD workerThreadMain(LPVOID pData)
 
     RDTSC_INIT(threadId);
 
-    uint32_t numaNode = pThreadData->numaId;
-    uint32_t numaMask = pContext->threadPool.numaMask;
-
     // flush denormals to 0
     _mm_setcsr(_mm_getcsr() | _MM_FLUSH_ZERO_ON | _MM_DENORMALS_ZERO_ON);
 
+    // workers of the shared pool aren't tied to a context
+    if (pContext == nullptr)
+    {
+        return sharedWorkerThreadMain(pThreadData);
+    }
+
+    uint32_t numaNode = pThreadData->numaId;
+    uint32_t numaMask = pContext->threadPool.numaMask;
+
     // Track tiles locked by other threads. If we try to lock a macrotile and find its already
     // locked then we'll add it to this list so that we don't try and lock it again.
     TileSet lockedTiles;
@@ -662,7 +852,10 @@ DWORD workerThreadInit(LPVOID pData)
     return 1;
 }
 
-void CreateThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
+//////////////////////////////////////////////////////////////////////////
+/// @brief Spawns the worker threads of a pool.
+/// @param pContext - context the workers work for, nullptr for the shared pool.
+static void StartWorkerThreads(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
 {
     bindThread(0);
 
@@ -749,7 +942,6 @@ void CreateThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
     }
 
     pPool->numThreads = numThreads;
-    pContext->NumWorkerThreads = pPool->numThreads;
 
     pPool->inThreadShutdown = false;
     pPool->pThreadData = (THREAD_DATA *)malloc(pPool->numThreads * sizeof(THREAD_DATA));
@@ -807,8 +999,122 @@ void CreateThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
     }
 }
 
+static void StopWorkerThreads(THREAD_POOL *pPool)
+{
+    // Wait for threads to finish and destroy them
+    for (uint32_t t = 0; t < pPool->numThreads; ++t)
+    {
+        pPool->threads[t]->join();
+        delete(pPool->threads[t]);
+    }
+
+    // Clean up data used by threads
+    free(pPool->pThreadData);
+    pPool->pThreadData = nullptr;
+    pPool->numThreads = 0;
+}
+
+static void AttachSharedThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
+{
+    SHARED_THREAD_POOL &shared = gSharedPool;
+    std::lock_guard<std::mutex> createGuard(shared.createLock);
+
+    if (shared.contexts.empty())
+    {
+        StartWorkerThreads(nullptr, &shared.pool);
+    }
+
+    // a single HW thread, the context runs single threaded
+    if (shared.pool.numThreads == 0)
+    {
+        pPool->numThreads = 0;
+        return;
+    }
+
+    pPool->numThreads = shared.pool.numThreads;
+    pPool->numaMask = shared.pool.numaMask;
+    pPool->inThreadShutdown = false;
+    pPool->pThreadData = nullptr;
+    pPool->isShared = true;
+
+    pContext->NumWorkerThreads = pPool->numThreads;
+    pContext->pWorkerState = new THREAD_CONTEXT_STATE[pPool->numThreads];
+
+    std::lock_guard<std::mutex> guard(shared.lock);
+    shared.contexts.push_back(pContext);
+    shared.contextsVersion++;
+}
+
+static void DetachSharedThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
+{
+    SHARED_THREAD_POOL &shared = gSharedPool;
+    std::lock_guard<std::mutex> createGuard(shared.createLock);
+
+    uint64_t version;
+    {
+        std::lock_guard<std::mutex> guard(shared.lock);
+        shared.contexts.erase(std::find(shared.contexts.begin(), shared.contexts.end(), pContext));
+        version = ++shared.contextsVersion;
+    }
+
+    // wait for the workers to move to a context list without this context
+    for (uint32_t t = 0; t < shared.pool.numThreads; ++t)
+    {
+        while (shared.workerVersion[t].load() < version)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    delete[] pContext->pWorkerState;
+    pContext->pWorkerState = nullptr;
+
+    if (shared.contexts.empty())
+    {
+        std::unique_lock<std::mutex> lock(shared.lock);
+        shared.pool.inThreadShutdown = true;
+        _mm_mfence();
+        shared.workAvailable.notify_all();
+        lock.unlock();
+
+        StopWorkerThreads(&shared.pool);
+    }
+}
+
+void WakeSharedThreadPool()
+{
+    // Taking the lock orders the wakeup after the idle check of any worker
+    // about to sleep.
+    {
+        std::lock_guard<std::mutex> guard(gSharedPool.lock);
+    }
+    gSharedPool.workAvailable.notify_all();
+}
+
+void CreateThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
+{
+    if (KNOB_SHARED_THREAD_POOL)
+    {
+        AttachSharedThreadPool(pContext, pPool);
+        return;
+    }
+
+    StartWorkerThreads(pContext, pPool);
+
+    if (pPool->numThreads)
+    {
+        pContext->NumWorkerThreads = pPool->numThreads;
+    }
+}
+
 void DestroyThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
 {
+    if (pPool->isShared)
+    {
+        DetachSharedThreadPool(pContext, pPool);
+        return;
+    }
+
     if (!KNOB_SINGLE_THREADED)
     {
         // Inform threads to finish up
@@ -818,14 +1124,6 @@ void DestroyThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
         pContext->FifosNotEmpty.notify_all();
         lock.unlock();
 
-        // Wait for threads to finish and destroy them
-        for (uint32_t t = 0; t < pPool->numThreads; ++t)
-        {
-            pPool->threads[t]->join();
-            delete(pPool->threads[t]);
-        }
-
-        // Clean up data used by threads
-        free(pPool->pThreadData);
+        StopWorkerThreads(pPool);
     }
 }
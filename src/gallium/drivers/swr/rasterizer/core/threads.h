@@ -54,12 +54,22 @@ struct THREAD_POOL
     uint32_t numaMask;
     volatile bool inThreadShutdown;
     THREAD_DATA *pThreadData;
+    bool isShared;          // context uses the process-wide pool, threads aren't its own
 };
 
 typedef std::unordered_set<uint32_t> TileSet;
 
+// Progress of one worker through the draws of one context
+struct THREAD_CONTEXT_STATE
+{
+    uint64_t curDrawBE{ 0 };
+    uint64_t curDrawFE{ 0 };
+    TileSet lockedTiles;
+};
+
 void CreateThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool);
 void DestroyThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool);
+void WakeSharedThreadPool();
 
 // Expose FE and BE worker functions to the API thread if single threaded
 void WorkOnFifoFE(SWR_CONTEXT *pContext, uint32_t workerId, uint64_t &curDrawFE, uint32_t numaNode);
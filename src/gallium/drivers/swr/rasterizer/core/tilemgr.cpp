@@ -124,6 +124,7 @@ HOTTILE* HotTileMgr::GetHotTile(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, uint32
             hotTile.state = HOTTILE_INVALID;
             hotTile.numSamples = numSamples;
             hotTile.renderTargetArrayIndex = renderTargetArrayIndex;
+            hotTile.maxDepthValid = false;
         }
         else
         {
@@ -147,6 +148,7 @@ HOTTILE* HotTileMgr::GetHotTile(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, uint32
             hotTile.pBuffer = (uint8_t*)AllocHotTileMem(size, KNOB_SIMD_WIDTH * 4, numaNode);
             hotTile.state = HOTTILE_INVALID;
             hotTile.numSamples = numSamples;
+            hotTile.maxDepthValid = false;
         }
 
         // if requested render target array index isn't currently loaded, need to store out the current hottile 
@@ -180,8 +182,18 @@ HOTTILE* HotTileMgr::GetHotTile(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, uint32
 
             hotTile.renderTargetArrayIndex = renderTargetArrayIndex;
             hotTile.state = HOTTILE_DIRTY;
+            hotTile.maxDepthValid = false;
         }
     }
+
+    if (attachment == SWR_ATTACHMENT_DEPTH && hotTile.pMaxDepth == NULL)
+    {
+        uint32_t size = KNOB_MACROTILE_X_DIM_IN_TILES * KNOB_MACROTILE_Y_DIM_IN_TILES * sizeof(float);
+        uint32_t numaNode = ((x ^ y) & pContext->threadPool.numaMask);
+        hotTile.pMaxDepth = (float*)AllocHotTileMem(size, KNOB_SIMD_WIDTH * 4, numaNode);
+        hotTile.maxDepthValid = false;
+    }
+
     return &tile.Attachment[attachment];
 }
 
@@ -269,6 +281,54 @@ void HotTileMgr::ClearDepthHotTile(const HOTTILE* pHotTile)  // clear a macro ti
     }
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Recompute the max depth of one raster tile of a depth hottile,
+/// after the backend wrote to it.  Raster tiles are stored contiguously,
+/// with all samples of a raster tile next to each other.
+/// @param rasterTileX - raster tile x index within the hottile
+/// @param rasterTileY - raster tile y index within the hottile
+void HotTileMgr::UpdateMaxDepth(HOTTILE* pHotTile, uint32_t rasterTileX, uint32_t rasterTileY)
+{
+    static_assert(KNOB_DEPTH_HOT_TILE_FORMAT == R32_FLOAT, "Unsupported depth hot tile format");
+
+    const uint32_t numFloats = KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * pHotTile->numSamples;
+    const uint32_t rasterTile = rasterTileY * KNOB_MACROTILE_X_DIM_IN_TILES + rasterTileX;
+    const float *pfBuf = (const float*)pHotTile->pBuffer + rasterTile * numFloats;
+
+    simdscalar vMax = _simd_load_ps(pfBuf);
+    for (uint32_t si = KNOB_SIMD_WIDTH; si < numFloats; si += KNOB_SIMD_WIDTH)
+    {
+        vMax = _simd_max_ps(vMax, _simd_load_ps(pfBuf + si));
+    }
+
+    OSALIGNSIMD(float) maxLanes[KNOB_SIMD_WIDTH];
+    _simd_store_ps(maxLanes, vMax);
+
+    float maxDepth = maxLanes[0];
+    for (uint32_t lane = 1; lane < KNOB_SIMD_WIDTH; ++lane)
+    {
+        maxDepth = std::max(maxDepth, maxLanes[lane]);
+    }
+
+    pHotTile->pMaxDepth[rasterTile] = maxDepth;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Recompute the max depth of all raster tiles of a depth hottile,
+/// once its contents came from somewhere else than the backend.
+void HotTileMgr::UpdateMaxDepth(HOTTILE* pHotTile)
+{
+    for (uint32_t y = 0; y < KNOB_MACROTILE_Y_DIM_IN_TILES; ++y)
+    {
+        for (uint32_t x = 0; x < KNOB_MACROTILE_X_DIM_IN_TILES; ++x)
+        {
+            UpdateMaxDepth(pHotTile, x, y);
+        }
+    }
+
+    pHotTile->maxDepthValid = true;
+}
+
 void HotTileMgr::ClearStencilHotTile(const HOTTILE* pHotTile)
 {
     // convert from F32 to U8.
@@ -349,6 +409,7 @@ void HotTileMgr::InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, ui
             // invalid hottile before draw requires a load from surface before we can draw to it
             pContext->pfnLoadTile(GetPrivateState(pDC), KNOB_DEPTH_HOT_TILE_FORMAT, SWR_ATTACHMENT_DEPTH, x, y, pHotTile->renderTargetArrayIndex, pHotTile->pBuffer);
             pHotTile->state = HOTTILE_DIRTY;
+            pHotTile->maxDepthValid = false;
             RDTSC_STOP(BELoadTiles, 0, 0);
         }
         else if (pHotTile->state == HOTTILE_CLEAR)
@@ -357,6 +418,7 @@ void HotTileMgr::InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, ui
             // Clear the tile.
             ClearDepthHotTile(pHotTile);
             pHotTile->state = HOTTILE_DIRTY;
+            pHotTile->maxDepthValid = false;
             RDTSC_STOP(BELoadTiles, 0, 0);
         }
     }
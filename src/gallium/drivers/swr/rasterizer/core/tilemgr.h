@@ -254,6 +254,8 @@ struct HOTTILE
     DWORD clearData[4];                 // May need to change based on pfnClearTile implementation.  Reorder for alignment?
     uint32_t numSamples;
     uint32_t renderTargetArrayIndex;    // current render target array index loaded
+    float *pMaxDepth;                   // depth only: max depth of each raster tile, for depth culling
+    bool maxDepthValid;                 // depth only: pMaxDepth is up to date with pBuffer
 };
 
 union HotTileSet
@@ -292,6 +294,7 @@ public:
                 for (int a = 0; a < SWR_NUM_ATTACHMENTS; ++a)
                 {
                     FreeHotTileMem(mHotTiles[x][y].Attachment[a].pBuffer);
+                    FreeHotTileMem(mHotTiles[x][y].Attachment[a].pMaxDepth);
                 }
             }
         }
@@ -308,6 +311,9 @@ public:
     static void ClearDepthHotTile(const HOTTILE* pHotTile);
     static void ClearStencilHotTile(const HOTTILE* pHotTile);
 
+    static void UpdateMaxDepth(HOTTILE* pHotTile);
+    static void UpdateMaxDepth(HOTTILE* pHotTile, uint32_t rasterTileX, uint32_t rasterTileY);
+
 private:
     HotTileSet mHotTiles[KNOB_NUM_HOT_TILES_X][KNOB_NUM_HOT_TILES_Y];
     uint32_t mHotTileSize[SWR_NUM_ATTACHMENTS];
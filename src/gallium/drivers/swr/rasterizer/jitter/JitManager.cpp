@@ -41,7 +41,9 @@
 #include "llvm/IR/Function.h"
 #include "llvm/Support/DynamicLibrary.h"
 
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 
 #include "llvm/Analysis/CFGPrinter.h"
@@ -56,6 +58,7 @@
 
 #include "state_llvm.h"
 
+#include <algorithm>
 #include <sstream>
 #if defined(_WIN32)
 #include <psapi.h>
@@ -105,8 +108,10 @@ JitManager::JitManager(uint32_t simdWidth, const char *arch)
     // force JIT to use the same CPU arch as the rest of swr
     if(mArch.AVX512F())
     {
-        assert(0 && "Implement AVX512 jitter");
-        hostCPUName = sys::getHostCPUName();
+        // The vector width still follows the core, so for the 8-wide core
+        // this gets EVEX encoded 256-bit code, with 32 vector registers and
+        // AVX512VL where available.
+        hostCPUName = mArch.AVX512ER() ? StringRef("knl") : StringRef("skx");
         if (mVWidth == 0)
         {
             mVWidth = 16;
@@ -155,6 +160,12 @@ JitManager::JitManager(uint32_t simdWidth, const char *arch)
 
     mpExec = EB.create();
 
+    mCache.Init(hostCPUName.str());
+    if (mCache.IsEnabled())
+    {
+        mpExec->setObjectCache(&mCache);
+    }
+
 #if LLVM_USE_INTEL_JITEVENTS
     JITEventListener *vTune = JITEventListener::createIntelJITEventListener();
     mpExec->RegisterJITEventListener(vTune);
@@ -227,6 +238,60 @@ void JitManager::SetupNewModule()
     mIsModuleFinalized = false;
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Computes a hash of the IR of a module, ignoring its identifier.
+/// @param M - module to hash
+/// @param salt - extra data to include in the hash
+static std::string HashModule(const Module* M, const std::string& salt)
+{
+    std::string ir;
+    raw_string_ostream irStream(ir);
+    M->print(irStream, nullptr);
+    irStream.flush();
+
+    MD5 hash;
+    hash.update(salt);
+
+    StringRef lines(ir);
+    while (!lines.empty())
+    {
+        std::pair<StringRef, StringRef> split = lines.split('\n');
+        if (!split.first.startswith("; ModuleID") &&
+            !split.first.startswith("source_filename"))
+        {
+            hash.update(split.first);
+            hash.update("\n");
+        }
+        lines = split.second;
+    }
+
+    MD5::MD5Result result;
+    hash.final(result);
+
+    SmallString<32> hex;
+    MD5::stringifyResult(result, hex);
+    return hex.str().str();
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Names a jitted function after the contents of its module when
+/// the object cache is enabled.  The names otherwise come from counters,
+/// so the same function would get different object code in each process.
+/// @param pFunc - the function of the current module
+void JitManager::SetCacheableName(Function* pFunc)
+{
+    if (!mCache.IsEnabled())
+    {
+        return;
+    }
+
+    std::string name = pFunc->getName().str();
+    name.erase(name.find_last_not_of("0123456789") + 1);
+
+    pFunc->setName(name);
+    pFunc->setName(name + "_" + HashModule(pFunc->getParent(), ""));
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Create new LLVM module from IR.
 bool JitManager::SetupModuleFromIR(const uint8_t *pIR)
@@ -315,3 +380,168 @@ extern "C"
         delete reinterpret_cast<JitManager*>(hJitContext);
     }
 }
+
+//////////////////////////////////////////////////////////////////////////
+/// JitCache
+//////////////////////////////////////////////////////////////////////////
+
+struct JitCacheHeader
+{
+    uint64_t magic;
+    uint64_t objSize;
+};
+
+static const uint64_t JIT_CACHE_MAGIC = 0x314548434a525753ULL; // "SWRJCHE1"
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Enables the cache if KNOB_JIT_ENABLE_CACHE is set.
+/// @param cpuName - CPU the jitted code is compiled for
+void JitCache::Init(const std::string& cpuName)
+{
+    if (!KNOB_JIT_ENABLE_CACHE)
+    {
+        return;
+    }
+
+    mCacheDir = KNOB_JIT_CACHE_DIR;
+    if (mCacheDir.empty())
+    {
+#if defined(_WIN32)
+        mCacheDir = JITTER_OUTPUT_DIR "\\Cache";
+#else
+        const char* pXdgCacheHome = getenv("XDG_CACHE_HOME");
+        const char* pHome = getenv("HOME");
+
+        if (pXdgCacheHome && *pXdgCacheHome)
+        {
+            mCacheDir = std::string(pXdgCacheHome) + "/mesa/swr";
+        }
+        else if (pHome && *pHome)
+        {
+            mCacheDir = std::string(pHome) + "/.cache/mesa/swr";
+        }
+        else
+        {
+            return;
+        }
+#endif
+    }
+
+    if (sys::fs::create_directories(mCacheDir))
+    {
+        return;
+    }
+
+    // Everything besides the IR that changes the generated code.  The
+    // engines of gallivm target the host CPU rather than cpuName.
+    std::stringstream target;
+    target << sys::getProcessTriple() << " " << cpuName << " "
+           << sys::getHostCPUName().str() << " LLVM " << LLVM_VERSION_MAJOR
+           << "." << LLVM_VERSION_MINOR;
+
+    StringMap<bool> hostFeatures;
+    if (sys::getHostCPUFeatures(hostFeatures))
+    {
+        std::vector<std::string> features;
+        for (auto& feature : hostFeatures)
+        {
+            features.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+        }
+        std::sort(features.begin(), features.end());
+        for (auto& feature : features)
+        {
+            target << " " << feature;
+        }
+    }
+
+    mTarget = target.str();
+    mEnabled = true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns the path of the cache file for a module.
+std::string JitCache::GetFilename(const Module* M)
+{
+    SmallString<256> path(mCacheDir);
+    sys::path::append(path, HashModule(M, mTarget) + ".o");
+    return path.str().str();
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Called by MCJIT when it has compiled a module that missed in
+/// getObject.  Writes the object code out to the cache.
+void JitCache::notifyObjectCompiled(const Module* M, MemoryBufferRef Obj)
+{
+    std::string filename;
+
+    auto it = mPending.find(M);
+    if (it != mPending.end())
+    {
+        filename = it->second;
+        mPending.erase(it);
+    }
+    else
+    {
+        filename = GetFilename(M);
+    }
+
+    // Write to a temporary file first, so that other processes never see
+    // a partial entry.
+    SmallString<256> tmpFilename;
+    int fd;
+    if (sys::fs::createUniqueFile(filename + ".%%%%%%", fd, tmpFilename))
+    {
+        return;
+    }
+
+    JitCacheHeader header;
+    header.magic = JIT_CACHE_MAGIC;
+    header.objSize = Obj.getBufferSize();
+
+    bool failed;
+    {
+        raw_fd_ostream fileObj(fd, true);
+        fileObj.write((const char*)&header, sizeof(header));
+        fileObj.write(Obj.getBufferStart(), Obj.getBufferSize());
+        fileObj.close();
+        failed = fileObj.has_error();
+        fileObj.clear_error();
+    }
+
+    if (failed || sys::fs::rename(tmpFilename, filename))
+    {
+        sys::fs::remove(tmpFilename);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Called by MCJIT before compiling a module.  Returns the object
+/// code of the module from the cache, or nullptr to have it compiled.
+std::unique_ptr<MemoryBuffer> JitCache::getObject(const Module* M)
+{
+    std::string filename = GetFilename(M);
+
+    ErrorOr<std::unique_ptr<MemoryBuffer>> file =
+        MemoryBuffer::getFile(filename, -1, false);
+
+    if (file)
+    {
+        const MemoryBuffer* pFile = file.get().get();
+        JitCacheHeader header;
+
+        if (pFile->getBufferSize() >= sizeof(header))
+        {
+            memcpy(&header, pFile->getBufferStart(), sizeof(header));
+
+            if (header.magic == JIT_CACHE_MAGIC &&
+                header.objSize == pFile->getBufferSize() - sizeof(header))
+            {
+                return MemoryBuffer::getMemBufferCopy(
+                    StringRef(pFile->getBufferStart() + sizeof(header), header.objSize));
+            }
+        }
+    }
+
+    mPending[M] = filename;
+    return nullptr;
+}
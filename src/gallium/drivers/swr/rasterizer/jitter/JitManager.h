@@ -31,6 +31,7 @@
 
 #include "common/os.h"
 #include "common/isa.hpp"
+#include "fetch_jit.h"
 
 #if defined(_WIN32)
 #pragma warning(disable : 4146 4244 4267 4800 4996)
@@ -59,6 +60,7 @@
 
 #include "llvm/IR/Verifier.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/Support/FileSystem.h"
 #define LLVM_F_NONE sys::fs::F_None
 
@@ -81,6 +83,9 @@
 
 #pragma pop_macro("DEBUG")
 
+#include <string>
+#include <unordered_map>
+
 using namespace llvm;
 //////////////////////////////////////////////////////////////////////////
 /// JitInstructionSet
@@ -108,14 +113,12 @@ public:
             bForceAVX2 = true;
             bForceAVX512 = false;
         }
-        #if 0
         else if(isaRequest == "avx512")
         {
             bForceAVX = false;
             bForceAVX2 = false;
             bForceAVX512 = true;
         }
-        #endif
     };
 
     bool AVX2(void) { return bForceAVX ? 0 : InstructionSet::AVX2(); }
@@ -136,6 +139,38 @@ struct JitLLVMContext : LLVMContext
 };
 
 
+//////////////////////////////////////////////////////////////////////////
+/// JitCache
+/// @brief Persistent cache of the object code of jitted modules, hooked
+/// into MCJIT engines with setObjectCache().  Entries are keyed by the IR
+/// of the module and the target it is compiled for, and stored as files
+/// in KNOB_JIT_CACHE_DIR.
+//////////////////////////////////////////////////////////////////////////
+class JitCache : public ObjectCache
+{
+public:
+    JitCache() {};
+    virtual ~JitCache() {};
+
+    void Init(const std::string& target);
+    bool IsEnabled() const { return mEnabled; }
+
+    /// ObjectCache interface
+    virtual void notifyObjectCompiled(const Module* M, MemoryBufferRef Obj);
+    virtual std::unique_ptr<MemoryBuffer> getObject(const Module* M);
+
+private:
+    std::string GetFilename(const Module* M);
+
+    bool mEnabled = false;
+    std::string mCacheDir;
+    std::string mTarget;
+
+    // File names of the modules that missed, until their code is compiled.
+    std::unordered_map<const Module*, std::string> mPending;
+};
+
+
 //////////////////////////////////////////////////////////////////////////
 /// JitManager
 //////////////////////////////////////////////////////////////////////////
@@ -181,7 +216,14 @@ struct JitManager
 
     JitInstructionSet mArch;
 
+    JitCache mCache;
+
+    // Fetch shaders already jitted, so state changes that come back to an
+    // earlier vertex layout don't rebuild and optimize the IR again.
+    std::unordered_map<FETCH_COMPILE_STATE, PFN_FETCH_FUNC, FetchCompileStateHash> mFetchCache;
+
     void SetupNewModule();
+    void SetCacheableName(Function* pFunc);
     bool SetupModuleFromIR(const uint8_t *pIR);
 
     static void DumpToFile(Function *f, const char *fileName);
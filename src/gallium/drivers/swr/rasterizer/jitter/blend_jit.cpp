@@ -782,6 +782,7 @@ extern "C" PFN_BLEND_JIT_FUNC JITCALL JitCompileBlend(HANDLE hJitMgr, const BLEN
 
     BlendJit theJit(pJitMgr);
     HANDLE hFunc = theJit.Create(state);
+    pJitMgr->SetCacheableName((Function*)hFunc);
 
     return JitBlendFunc(hJitMgr, hFunc);
 }
@@ -1432,10 +1432,20 @@ extern "C" PFN_FETCH_FUNC JITCALL JitCompileFetch(HANDLE hJitMgr, const FETCH_CO
 {
     JitManager* pJitMgr = reinterpret_cast<JitManager*>(hJitMgr);
 
+    auto it = pJitMgr->mFetchCache.find(state);
+    if (it != pJitMgr->mFetchCache.end())
+    {
+        return it->second;
+    }
+
     pJitMgr->SetupNewModule();
 
     FetchJit theJit(pJitMgr);
     HANDLE hFunc = theJit.Create(state);
+    pJitMgr->SetCacheableName((Function*)hFunc);
 
-    return JitFetchFunc(hJitMgr, hFunc);
+    PFN_FETCH_FUNC pfnFetch = JitFetchFunc(hJitMgr, hFunc);
+    pJitMgr->mFetchCache[state] = pfnFetch;
+
+    return pfnFetch;
 }
@@ -31,6 +31,7 @@
 
 #include "common/formats.h"
 #include "core/state.h"
+#include "core/utils.h"
 
 //////////////////////////////////////////////////////////////////////////
 /// INPUT_ELEMENT_DESC
@@ -126,3 +127,29 @@ struct FETCH_COMPILE_STATE
         return true;
     }
 };
+
+//////////////////////////////////////////////////////////////////////////
+/// Hash of the FETCH_COMPILE_STATE fields compared by operator==.
+//////////////////////////////////////////////////////////////////////////
+struct FetchCompileStateHash
+{
+    size_t operator()(const FETCH_COMPILE_STATE &state) const
+    {
+        uint32_t flags = (state.bDisableVGATHER ? 0x1 : 0) |
+                         (state.bDisableIndexOOBCheck ? 0x2 : 0) |
+                         (state.bEnableCutIndex ? 0x4 : 0);
+
+        uint32_t crc = ComputeCRC(0, &state.numAttribs, sizeof(state.numAttribs));
+        crc = ComputeCRC(crc, &state.indexType, sizeof(state.indexType));
+        crc = ComputeCRC(crc, &state.cutIndex, sizeof(state.cutIndex));
+        crc = ComputeCRC(crc, &flags, sizeof(flags));
+
+        // InstanceDataStepRate is left out, it only matters for instanced elements
+        for (uint32_t i = 0; i < state.numAttribs; ++i)
+        {
+            crc = ComputeCRC(crc, &state.layout[i].bits, sizeof(state.layout[i].bits));
+        }
+
+        return crc;
+    }
+};
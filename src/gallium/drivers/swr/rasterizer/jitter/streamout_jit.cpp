@@ -358,6 +358,7 @@ extern "C" PFN_SO_FUNC JITCALL JitCompileStreamout(HANDLE hJitMgr, const STREAMO
 
     StreamOutJit theJit(pJitMgr);
     HANDLE hFunc = theJit.Create(soState);
+    pJitMgr->SetCacheableName((Function*)hFunc);
 
     return JitStreamoutFunc(hJitMgr, hFunc);
 }
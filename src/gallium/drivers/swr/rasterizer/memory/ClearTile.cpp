@@ -33,7 +33,7 @@
 #include "memory/tilingtraits.h"
 #include "memory/Convert.h"
 
-typedef void(*PFN_STORE_TILES_CLEAR)(const float*, SWR_SURFACE_STATE*, UINT, UINT);
+typedef void(*PFN_STORE_TILES_CLEAR)(const float*, SWR_SURFACE_STATE*, UINT, UINT, uint32_t);
 
 //////////////////////////////////////////////////////////////////////////
 /// Clear Raster Tile Function Tables.
@@ -50,44 +50,53 @@ struct StoreRasterTileClear
 {
     //////////////////////////////////////////////////////////////////////////
     /// @brief Stores an 8x8 raster tile to the destination surface.
-    /// @param pColor - Pointer to clear color.
+    /// @param dstFormattedRow - Clear color in the destination format,
+    ///        repeated for a row of the raster tile.
     /// @param pDstSurface - Destination surface state
     /// @param x, y - Coordinates to raster tile.
     INLINE static void StoreClear(
-        const uint8_t* dstFormattedColor,
+        const uint8_t* dstFormattedRow,
         UINT dstBytesPerPixel,
         SWR_SURFACE_STATE* pDstSurface,
-        UINT x, UINT y) // (x, y) pixel coordinate to start of raster tile.
+        UINT x, UINT y, // (x, y) pixel coordinate to start of raster tile.
+        uint32_t sampleNum, uint32_t renderTargetArrayIndex)
     {
-        // Compute destination address for raster tile.
-        uint8_t* pDstTile = (uint8_t*)pDstSurface->pBaseAddress +
-            (y * pDstSurface->pitch) + (x * dstBytesPerPixel);
+        uint32_t lodWidth = std::max(pDstSurface->width >> pDstSurface->lod, 1U);
+        uint32_t lodHeight = std::max(pDstSurface->height >> pDstSurface->lod, 1U);
+        uint32_t arrayIndex = pDstSurface->arrayIndex + renderTargetArrayIndex;
 
-        // start of first row
-        uint8_t* pDst = pDstTile;
-        UINT dstBytesPerRow = 0;
-
-        // For each raster tile pixel in row 0 (rx, 0)
-        for (UINT rx = 0; (rx < KNOB_TILE_X_DIM) && ((x + rx) < pDstSurface->width); ++rx)
+        if (x >= lodWidth || y >= lodHeight)
         {
-            memcpy(pDst, dstFormattedColor, dstBytesPerPixel);
-
-            // Increment pointer to next pixel in row.
-            pDst += dstBytesPerPixel;
-            dstBytesPerRow += dstBytesPerPixel;
+            return;
         }
 
-        // start of second row
-        pDst = pDstTile + pDstSurface->pitch;
+        UINT width = std::min<UINT>(KNOB_TILE_X_DIM, lodWidth - x);
+        UINT height = std::min<UINT>(KNOB_TILE_Y_DIM, lodHeight - y);
 
-        // For each remaining row in the rest of the raster tile
-        for (UINT ry = 1; (ry < KNOB_TILE_Y_DIM) && ((y + ry) < pDstSurface->height); ++ry)
+        // Rows are contiguous in linear surfaces, other layouts go through the
+        // surface address of each pixel.
+        if (pDstSurface->tileMode == SWR_TILE_NONE && !pDstSurface->bInterleavedSamples)
         {
-            // copy row
-            memcpy(pDst, pDstTile, dstBytesPerRow);
+            uint8_t* pDst = (uint8_t*)ComputeSurfaceAddress<false>(x, y, arrayIndex, arrayIndex,
+                sampleNum, pDstSurface->lod, pDstSurface);
 
-            // Increment pointer to first pixel in next row.
-            pDst += pDstSurface->pitch;
+            for (UINT ry = 0; ry < height; ++ry)
+            {
+                memcpy(pDst, dstFormattedRow, width * dstBytesPerPixel);
+                pDst += pDstSurface->pitch;
+            }
+        }
+        else
+        {
+            for (UINT ry = 0; ry < height; ++ry)
+            {
+                for (UINT rx = 0; rx < width; ++rx)
+                {
+                    uint8_t* pDst = (uint8_t*)ComputeSurfaceAddress<false>(x + rx, y + ry, arrayIndex, arrayIndex,
+                        sampleNum, pDstSurface->lod, pDstSurface);
+                    memcpy(pDst, dstFormattedRow, dstBytesPerPixel);
+                }
+            }
         }
     }
 };
@@ -106,11 +115,11 @@ struct StoreMacroTileClear
     static void StoreClear(
         const float *pColor,
         SWR_SURFACE_STATE* pDstSurface,
-        UINT x, UINT y)
+        UINT x, UINT y, uint32_t renderTargetArrayIndex)
     {
         UINT dstBytesPerPixel = (FormatTraits<DstFormat>::bpp / 8);
 
-        uint8_t dstFormattedColor[16]; // max bpp is 128, so 16 is all we need here for one pixel
+        uint8_t dstFormattedRow[16 * KNOB_TILE_X_DIM]; // max bpp is 128, so 16 is all we need here for one pixel
 
         float srcColor[4];
 
@@ -120,39 +129,65 @@ struct StoreMacroTileClear
         }
 
         // using this helper function, but the Tiling Traits is unused inside it so just using a dummy value
-        ConvertPixelFromFloat<DstFormat>(dstFormattedColor, srcColor);
+        ConvertPixelFromFloat<DstFormat>(dstFormattedRow, srcColor);
+
+        for (UINT rx = 1; rx < KNOB_TILE_X_DIM; ++rx)
+        {
+            memcpy(&dstFormattedRow[rx * dstBytesPerPixel], dstFormattedRow, dstBytesPerPixel);
+        }
 
         // Store each raster tile from the hot tile to the destination surface.
-        // TODO:  Put in check for partial coverage on x/y -- SWR_ASSERT if it happens.
-        //        Intent is for this function to only handle full tiles.
         for (UINT row = 0; row < KNOB_MACROTILE_Y_DIM; row += KNOB_TILE_Y_DIM)
         {
             for (UINT col = 0; col < KNOB_MACROTILE_X_DIM; col += KNOB_TILE_X_DIM)
             {
-                StoreRasterTileClear<SrcFormat, DstFormat>::StoreClear(dstFormattedColor, dstBytesPerPixel, pDstSurface, (x + col), (y + row));
+                for (uint32_t sampleNum = 0; sampleNum < pDstSurface->numSamples; sampleNum++)
+                {
+                    StoreRasterTileClear<SrcFormat, DstFormat>::StoreClear(dstFormattedRow, dstBytesPerPixel, pDstSurface,
+                        (x + col), (y + row), sampleNum, renderTargetArrayIndex);
+                }
             }
         }
     }
 };
 
 //////////////////////////////////////////////////////////////////////////
-/// @brief Writes clear color to every pixel of a render surface
-/// @param hPrivateContext - Handle to private DC
+/// @brief Writes clear color to every pixel of a macro tile of a render
+///        surface, without going through a hot tile.
+/// @param pDstSurface - Destination surface state
 /// @param renderTargetIndex - Index to destination render target
-/// @param x, y - Coordinates to raster tile.
+/// @param x, y - Coordinates to macro tile.
+/// @param renderTargetArrayIndex - Array slice of the destination
 /// @param pClearColor - Pointer to clear color
-void StoreHotTileClear(
+/// @return false if the surface format isn't supported; the caller has to
+///         store a cleared hot tile instead.
+bool StoreHotTileClear(
     SWR_SURFACE_STATE *pDstSurface,
     SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
     UINT x,
     UINT y,
+    uint32_t renderTargetArrayIndex,
     const float* pClearColor)
 {
     PFN_STORE_TILES_CLEAR pfnStoreTilesClear = NULL;
 
-    SWR_ASSERT(renderTargetIndex != SWR_ATTACHMENT_STENCIL);  ///@todo Not supported yet.
+    if (pDstSurface->type == SURFACE_NULL)
+    {
+        return true;
+    }
+
+    // force 0 if requested renderTargetArrayIndex is OOB
+    if (renderTargetArrayIndex >= pDstSurface->depth)
+    {
+        renderTargetArrayIndex = 0;
+    }
 
-    if (renderTargetIndex != SWR_ATTACHMENT_DEPTH)
+    if (renderTargetIndex == SWR_ATTACHMENT_STENCIL)
+    {
+        ///@todo Not supported yet.
+        return false;
+    }
+    else if (renderTargetIndex != SWR_ATTACHMENT_DEPTH)
     {
         pfnStoreTilesClear = sStoreTilesClearColorTable[pDstSurface->format];
     }
@@ -161,14 +196,15 @@ void StoreHotTileClear(
         pfnStoreTilesClear = sStoreTilesClearDepthTable[pDstSurface->format];
     }
 
-    SWR_ASSERT(pfnStoreTilesClear != NULL);
-
-    // Store a macro tile.
-    /// @todo Once all formats are supported then if check can go away. This is to help us near term to make progress.
-    if (pfnStoreTilesClear != NULL)
+    if (pfnStoreTilesClear == NULL)
     {
-        pfnStoreTilesClear(pClearColor, pDstSurface, x, y);
+        return false;
     }
+
+    // Store a macro tile.
+    pfnStoreTilesClear(pClearColor, pDstSurface, x, y, renderTargetArrayIndex);
+
+    return true;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -277,6 +313,7 @@ void StoreHotTileClear(
     \
     sStoreTilesClearDepthTable[R32_FLOAT] = StoreMacroTileClear<R32_FLOAT, R32_FLOAT>::StoreClear; \
     sStoreTilesClearDepthTable[R24_UNORM_X8_TYPELESS] = StoreMacroTileClear<R32_FLOAT, R24_UNORM_X8_TYPELESS>::StoreClear; \
+    sStoreTilesClearDepthTable[R16_UNORM] = StoreMacroTileClear<R32_FLOAT, R16_UNORM>::StoreClear; \
 
 //////////////////////////////////////////////////////////////////////////
 /// @brief Sets up tables for ClearTile
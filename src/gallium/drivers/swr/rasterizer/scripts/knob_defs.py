@@ -53,6 +53,41 @@ KNOBS = [
         'category'  : 'perf',
     }],
 
+    ['DEPTH_CULL', {
+        'type'      : 'bool',
+        'default'   : 'true',
+        'desc'      : ['Keep the max depth of each raster tile of the depth hottiles and',
+                       'reject triangles and raster tiles behind it before the backend'],
+        'category'  : 'perf',
+    }],
+
+    ['JIT_INSTRUCTION_SET', {
+        'type'      : 'std::string',
+        'default'   : '',
+        'desc'      : ['Instruction set targeted by jitted code: AVX, AVX2 or AVX512.',
+                       'Defaults to the instruction set the core was built for.',
+                       'Only ever reduced to what the CPU supports, and jitted',
+                       'code keeps the SIMD width of the core.'],
+        'category'  : 'perf',
+    }],
+
+    ['JIT_ENABLE_CACHE', {
+        'type'      : 'bool',
+        'default'   : 'false',
+        'desc'      : ['Enables the persistent cache of jitted object code.',
+                       'Shaders and fetch, blend and streamout functions whose',
+                       'IR was compiled before skip LLVM code generation.'],
+        'category'  : 'perf',
+    }],
+
+    ['JIT_CACHE_DIR', {
+        'type'      : 'std::string',
+        'default'   : '',
+        'desc'      : ['Directory of the jitted object code cache.',
+                       'Defaults to $XDG_CACHE_HOME/mesa/swr or ~/.cache/mesa/swr.'],
+        'category'  : 'perf',
+    }],
+
     ['MAX_NUMA_NODES', {
         'type'      : 'uint32_t',
         'default'   : '0',
@@ -91,6 +126,15 @@ KNOBS = [
         'category'  : 'perf',
     }],
 
+    ['SHARED_THREAD_POOL', {
+        'type'      : 'bool',
+        'default'   : 'false',
+        'desc'      : ['Share a single process-wide pool of worker threads between all',
+                       'contexts, instead of creating one pool per context.',
+                       'Workers visit the draws of the contexts in round-robin order.'],
+        'category'  : 'perf',
+    }],
+
     ['BUCKETS_START_FRAME', {
         'type'      : 'uint32_t',
         'default'   : '1200',
@@ -120,9 +164,19 @@ KNOBS = [
     }],
 
     ['MAX_DRAWS_IN_FLIGHT', {
+        'type'      : 'uint32_t',
+        'default'   : '384',
+        'desc'      : ['Maximum number of draws outstanding before API thread blocks.',
+                       'The draw ring starts out at MIN_DRAWS_IN_FLIGHT entries and grows',
+                       'towards this while the API thread keeps stalling on a full ring.'],
+        'category'  : 'perf',
+    }],
+
+    ['MIN_DRAWS_IN_FLIGHT', {
         'type'      : 'uint32_t',
         'default'   : '96',
-        'desc'      : ['Maximum number of draws outstanding before API thread blocks.'],
+        'desc'      : ['Number of draws outstanding before API thread blocks for the first time.',
+                       'Set to MAX_DRAWS_IN_FLIGHT to disable draw ring growth.'],
         'category'  : 'perf',
     }],
 
@@ -152,6 +206,18 @@ KNOBS = [
         'category'  : 'perf',
     }],
 
+    ['BUCKETS_ENABLE_TRACE', {
+        'type'      : 'bool',
+        'default'   : 'false',
+        'desc'      : ['Write the buckets enabled for threadviz as Chrome trace events',
+                       '(chrome://tracing) to rdtsc_trace.<pid>.json, tagged with the',
+                       'draw and macrotile being worked on.',
+                       '',
+                       'NOTE: KNOB_ENABLE_RDTSC must be enabled in core/knobs.h',
+                       'for this to have an effect.'],
+        'category'  : 'perf',
+    }],
+
     ['TOSS_DRAW', {
         'type'      : 'bool',
         'default'   : 'false',
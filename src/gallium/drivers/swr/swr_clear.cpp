@@ -23,6 +23,7 @@
 
 #include "swr_context.h"
 #include "swr_query.h"
+#include "swr_resource.h"
 
 static void
 swr_clear(struct pipe_context *pipe,
@@ -78,6 +79,13 @@ swr_clear(struct pipe_context *pipe,
 
    swr_update_draw_context(ctx);
    SwrClearRenderTarget(ctx->swrContext, clearMask, color->f, depth, stencil);
+
+   /* Clears write the attachments just like draws do */
+   SWR_RECT rect = {0, fb->width, 0, fb->height};
+   if (clearMask & SWR_CLEAR_COLOR)
+      swr_resource_write(fb->cbufs[0]->texture, rect);
+   if (clearMask & (SWR_CLEAR_DEPTH | SWR_CLEAR_STENCIL))
+      swr_resource_write(fb->zsbuf->texture, rect);
 }
 
 
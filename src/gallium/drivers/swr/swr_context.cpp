@@ -116,6 +116,9 @@ swr_transfer_map(struct pipe_context *pipe,
    swr_store_dirty_resource(pipe, resource, SWR_TILE_INVALID);
 
    if (!(usage & PIPE_TRANSFER_UNSYNCHRONIZED)) {
+      /* Attachment changes may have left stores without a fence */
+      swr_fence_pending_stores(pipe);
+
       /* If resource is in use, finish fence before mapping.
        * Unless requested not to block, then if not done return NULL map */
       if (usage & PIPE_TRANSFER_DONTBLOCK) {
@@ -205,6 +208,7 @@ swr_resource_copy(struct pipe_context *pipe,
    swr_store_dirty_resource(pipe, src, SWR_TILE_RESOLVED);
    swr_store_dirty_resource(pipe, dst, SWR_TILE_RESOLVED);
 
+   swr_fence_pending_stores(pipe);
    swr_fence_finish(pipe->screen, screen->flush_fence, 0);
    swr_resource_unused(src);
    swr_resource_unused(dst);
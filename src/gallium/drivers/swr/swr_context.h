@@ -154,6 +154,9 @@ struct swr_context {
    struct swr_draw_context swrDC;
 
    unsigned dirty; /**< Mask of SWR_NEW_x flags */
+
+   /* StoreTiles from attachment changes not followed by a fence yet */
+   boolean stores_unfenced;
 };
 
 static INLINE struct swr_context *
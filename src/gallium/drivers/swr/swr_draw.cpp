@@ -193,6 +193,9 @@ swr_flush(struct pipe_context *pipe,
    if (cb && swr_resource(cb->texture)->display_target)
       swr_store_dirty_resource(pipe, cb->texture, SWR_TILE_RESOLVED);
 
+   /* The returned fence has to cover deferred attachment stores too */
+   swr_fence_pending_stores(pipe);
+
    if (fence)
       swr_fence_reference(pipe->screen, fence, screen->flush_fence);
 }
@@ -210,11 +213,13 @@ swr_finish(struct pipe_context *pipe)
 
 /*
  * Store SWR HotTiles back to renderTarget surface.
+ * Only the macrotiles touching rect are visited.
  */
 void
 swr_store_render_target(struct pipe_context *pipe,
                         uint32_t attachment,
-                        enum SWR_TILE_STATE post_tile_state)
+                        enum SWR_TILE_STATE post_tile_state,
+                        SWR_RECT rect)
 {
    struct swr_context *ctx = swr_context(pipe);
    struct swr_draw_context *pDC = &ctx->swrDC;
@@ -222,19 +227,7 @@ swr_store_render_target(struct pipe_context *pipe,
 
    /* Only proceed if there's a valid surface to store to */
    if (renderTarget->pBaseAddress) {
-      /* Set viewport to full renderTarget width/height and disable scissor
-       * before StoreTiles */
-      boolean change_viewport =
-         (ctx->derived.vp.x != 0.0f || ctx->derived.vp.y != 0.0f
-          || ctx->derived.vp.width != renderTarget->width
-          || ctx->derived.vp.height != renderTarget->height);
-      if (change_viewport) {
-         SWR_VIEWPORT vp = {0};
-         vp.width = renderTarget->width;
-         vp.height = renderTarget->height;
-         SwrSetViewports(ctx->swrContext, 1, &vp, NULL);
-      }
-
+      /* Disable scissor before StoreTiles */
       boolean scissor_enable = ctx->derived.rastState.scissorEnable;
       if (scissor_enable) {
          ctx->derived.rastState.scissorEnable = FALSE;
@@ -244,11 +237,10 @@ swr_store_render_target(struct pipe_context *pipe,
       swr_update_draw_context(ctx);
       SwrStoreTiles(ctx->swrContext,
                     (enum SWR_RENDERTARGET_ATTACHMENT)attachment,
-                    post_tile_state);
+                    post_tile_state,
+                    rect);
 
-      /* Restore viewport and scissor enable */
-      if (change_viewport)
-         SwrSetViewports(ctx->swrContext, 1, &ctx->derived.vp, &ctx->derived.vpm);
+      /* Restore scissor enable */
       if (scissor_enable) {
          ctx->derived.rastState.scissorEnable = scissor_enable;
          SwrSetRastState(ctx->swrContext, &ctx->derived.rastState);
@@ -271,24 +263,54 @@ swr_store_dirty_resource(struct pipe_context *pipe,
       SWR_SURFACE_STATE *renderTargets = pDC->renderTargets;
       for (uint32_t i = 0; i < SWR_NUM_ATTACHMENTS; i++)
          if (renderTargets[i].pBaseAddress == spr->swr.pBaseAddress) {
-            swr_store_render_target(pipe, i, post_tile_state);
+            /* Tiles outside the dirty rect are already resolved.  Moving
+             * them to SWR_TILE_INVALID still has to touch all of them. */
+            SWR_RECT rect = spr->dirty_rect;
+            if (post_tile_state != SWR_TILE_RESOLVED) {
+               rect.left = rect.top = 0;
+               rect.right = renderTargets[i].width;
+               rect.bottom = renderTargets[i].height;
+            } else if (rect.left >= rect.right || rect.top >= rect.bottom) {
+               break;
+            }
+
+            swr_store_render_target(pipe, i, post_tile_state, rect);
 
             /* Mesa thinks depth/stencil are fused, so we'll never get an
              * explicit resource for stencil.  So, if checking depth, then
              * also check for stencil. */
             if (spr->has_stencil && (i == SWR_ATTACHMENT_DEPTH)) {
                swr_store_render_target(
-                  pipe, SWR_ATTACHMENT_STENCIL, post_tile_state);
+                  pipe, SWR_ATTACHMENT_STENCIL, post_tile_state, rect);
             }
 
+            spr->dirty_rect = {0};
+
             /* This fence signals StoreTiles completion */
             swr_fence_submit(ctx, screen->flush_fence);
+            ctx->stores_unfenced = FALSE;
 
             break;
          }
    }
 }
 
+/*
+ * Attachment changes queue their StoreTiles without a fence, so draws
+ * keep flowing.  Submit one before anything reads the stored surfaces,
+ * the CPU or a draw sampling from them.
+ */
+void
+swr_fence_pending_stores(struct pipe_context *pipe)
+{
+   struct swr_context *ctx = swr_context(pipe);
+
+   if (ctx->stores_unfenced) {
+      swr_fence_submit(ctx, swr_screen(pipe->screen)->flush_fence);
+      ctx->stores_unfenced = FALSE;
+   }
+}
+
 void
 swr_draw_init(struct pipe_context *pipe)
 {
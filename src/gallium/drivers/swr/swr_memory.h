@@ -37,11 +37,12 @@ void StoreHotTile(
     UINT x, UINT y, uint32_t renderTargetArrayIndex,
     uint8_t *pSrcHotTile);
 
-void StoreHotTileClear(
+bool StoreHotTileClear(
     SWR_SURFACE_STATE *pDstSurface,
     SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
     UINT x,
     UINT y,
+    uint32_t renderTargetArrayIndex,
     const float* pClearColor);
 
 INLINE void
@@ -72,18 +73,20 @@ swr_StoreHotTile(HANDLE hPrivateContext,
    StoreHotTile(pDstSurface, srcFormat, renderTargetIndex, x, y, renderTargetArrayIndex, pSrcHotTile);
 }
 
-INLINE void
+INLINE bool
 swr_StoreHotTileClear(HANDLE hPrivateContext,
                       SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
                       UINT x,
                       UINT y,
+                      uint32_t renderTargetArrayIndex,
                       const float* pClearColor)
 {
    // Grab destination surface state from private context
    swr_draw_context *pDC = (swr_draw_context*)hPrivateContext;
    SWR_SURFACE_STATE *pDstSurface = &pDC->renderTargets[renderTargetIndex];
 
-   StoreHotTileClear(pDstSurface, renderTargetIndex, x, y, pClearColor);
+   return StoreHotTileClear(pDstSurface, renderTargetIndex, x, y,
+                            renderTargetArrayIndex, pClearColor);
 }
 
 void InitSimLoadTilesTable();
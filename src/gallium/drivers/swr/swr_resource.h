@@ -24,6 +24,8 @@
 #ifndef SWR_RESOURCE_H
 #define SWR_RESOURCE_H
 
+#include <algorithm>
+
 #include "pipe/p_state.h"
 #include "api.h"
 
@@ -54,6 +56,10 @@ struct swr_resource {
    unsigned mip_offsets[PIPE_MAX_TEXTURE_LEVELS];
 
    enum swr_resource_status status;
+
+   /* Pixels drawn to since the last StoreTiles, a resolve only has to visit
+    * the macrotiles under this rect.  All zeros when nothing was written. */
+   SWR_RECT dirty_rect;
 };
 
 
@@ -98,12 +104,15 @@ swr_resource_data(struct pipe_resource *resource)
 
 void swr_store_render_target(struct pipe_context *pipe,
                              uint32_t attachment,
-                             enum SWR_TILE_STATE post_tile_state);
+                             enum SWR_TILE_STATE post_tile_state,
+                             SWR_RECT rect);
 
 void swr_store_dirty_resource(struct pipe_context *pipe,
                               struct pipe_resource *resource,
                               enum SWR_TILE_STATE post_tile_state);
 
+void swr_fence_pending_stores(struct pipe_context *pipe);
+
 void swr_update_resource_status(struct pipe_context *,
                                 const struct pipe_draw_info *);
 
@@ -123,9 +132,24 @@ swr_resource_read(struct pipe_resource *resource)
 }
 
 static INLINE void
-swr_resource_write(struct pipe_resource *resource)
+swr_resource_write(struct pipe_resource *resource, const SWR_RECT &rect)
 {
-   swr_resource(resource)->status |= SWR_RESOURCE_WRITE;
+   struct swr_resource *spr = swr_resource(resource);
+   SWR_RECT &dirty = spr->dirty_rect;
+
+   spr->status |= SWR_RESOURCE_WRITE;
+
+   if (rect.left >= rect.right || rect.top >= rect.bottom)
+      return;
+
+   if (dirty.left >= dirty.right || dirty.top >= dirty.bottom) {
+      dirty = rect;
+   } else {
+      dirty.left = std::min(dirty.left, rect.left);
+      dirty.top = std::min(dirty.top, rect.top);
+      dirty.right = std::max(dirty.right, rect.right);
+      dirty.bottom = std::max(dirty.bottom, rect.bottom);
+   }
 }
 
 static INLINE void
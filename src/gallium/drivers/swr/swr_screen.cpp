@@ -624,6 +624,8 @@ swr_resource_destroy(struct pipe_screen *p_screen, struct pipe_resource *pt)
 
    /* Only wait on fence if the resource is being used */
    if (pipe && spr->status) {
+      swr_fence_pending_stores(pipe);
+
       /* But, if there's no fence pending, submit one.
        * XXX: Remove once draw timestamps are implmented. */
       if (!swr_is_fence_pending(screen->flush_fence))
@@ -664,6 +666,7 @@ swr_flush_frontbuffer(struct pipe_screen *p_screen,
    struct pipe_context *pipe = screen->pipe;
 
    if (pipe) {
+      swr_fence_pending_stores(pipe);
       swr_fence_finish(p_screen, screen->flush_fence, 0);
       swr_resource_unused(resource);
       SwrEndFrame(swr_context(pipe)->swrContext);
@@ -725,7 +728,9 @@ swr_create_screen(struct sw_winsys *winsys)
 
    screen->base.flush_frontbuffer = swr_flush_frontbuffer;
 
-   screen->hJitMgr = JitCreateContext(KNOB_SIMD_WIDTH, KNOB_ARCH_STR);
+   const char *jitArch = KNOB_JIT_INSTRUCTION_SET.empty() ?
+      KNOB_ARCH_STR : KNOB_JIT_INSTRUCTION_SET.c_str();
+   screen->hJitMgr = JitCreateContext(KNOB_SIMD_WIDTH, jitArch);
 
    swr_fence_init(&screen->base);
 
@@ -128,6 +128,9 @@ BuilderSWR::CompileVS(struct pipe_context *ctx, swr_vertex_shader *swr_vs)
    struct gallivm_state *gallivm =
       gallivm_create("VS", wrap(&JM()->mContext));
    gallivm->module = wrap(JM()->mpCurrentModule);
+   if (JM()->mCache.IsEnabled())
+      gallivm->cache = reinterpret_cast<lp_object_cache *>(
+         static_cast<ObjectCache *>(&JM()->mCache));
 
    LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS][TGSI_NUM_CHANNELS];
    LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
@@ -278,6 +281,9 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_key &key)
    struct gallivm_state *gallivm =
       gallivm_create("FS", wrap(&JM()->mContext));
    gallivm->module = wrap(JM()->mpCurrentModule);
+   if (JM()->mCache.IsEnabled())
+      gallivm->cache = reinterpret_cast<lp_object_cache *>(
+         static_cast<ObjectCache *>(&JM()->mCache));
 
    LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS][TGSI_NUM_CHANNELS];
    LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
@@ -630,6 +630,38 @@ swr_set_sample_mask(struct pipe_context *pipe, unsigned sample_mask)
    }
 }
 
+/*
+ * Pixels a draw can touch in the attachments, as clipped by the
+ * rasterizer: the scissor if enabled, the viewport otherwise.
+ */
+static SWR_RECT
+swr_draw_rect(struct swr_context *ctx)
+{
+   struct pipe_framebuffer_state *fb = &ctx->framebuffer;
+   SWR_VIEWPORT *vp = &ctx->derived.vp;
+   int32_t left, right, top, bottom;
+   SWR_RECT rect = {0};
+
+   if (ctx->derived.rastState.scissorEnable) {
+      left = ctx->scissor.minx;
+      right = ctx->scissor.maxx;
+      top = ctx->scissor.miny;
+      bottom = ctx->scissor.maxy;
+   } else {
+      left = (int32_t)vp->x;
+      right = (int32_t)vp->x + (int32_t)ceilf(vp->width);
+      top = (int32_t)vp->y;
+      bottom = (int32_t)vp->y + (int32_t)ceilf(vp->height);
+   }
+
+   rect.left = CLAMP(left, 0, (int32_t)fb->width);
+   rect.right = CLAMP(right, 0, (int32_t)fb->width);
+   rect.top = CLAMP(top, 0, (int32_t)fb->height);
+   rect.bottom = CLAMP(bottom, 0, (int32_t)fb->height);
+
+   return rect;
+}
+
 /*
  * Update resource in-use status
  * All resources bound to color or depth targets marked as WRITE resources.
@@ -641,16 +673,17 @@ swr_update_resource_status(struct pipe_context *pipe,
 {
    struct swr_context *ctx = swr_context(pipe);
    struct pipe_framebuffer_state *fb = &ctx->framebuffer;
+   SWR_RECT rect = swr_draw_rect(ctx);
 
    /* colorbuffer targets */
    if (fb->nr_cbufs)
       for (uint32_t i = 0; i < fb->nr_cbufs; ++i)
          if (fb->cbufs[i])
-            swr_resource_write(fb->cbufs[i]->texture);
+            swr_resource_write(fb->cbufs[i]->texture, rect);
 
    /* depth/stencil target */
    if (fb->zsbuf)
-      swr_resource_write(fb->zsbuf->texture);
+      swr_resource_write(fb->zsbuf->texture, rect);
 
    /* VBO vertex buffers */
    for (uint32_t i = 0; i < ctx->num_vertex_buffers; i++) {
@@ -670,8 +703,13 @@ swr_update_resource_status(struct pipe_context *pipe,
    for (uint32_t i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
       struct pipe_sampler_view *view =
          ctx->sampler_views[PIPE_SHADER_FRAGMENT][i];
-      if (view)
+      if (view) {
+         /* Sampling a former render target: its tiles have to land in
+          * memory before this draw reads them. */
+         if (swr_resource(view->texture)->status & SWR_RESOURCE_WRITE)
+            swr_fence_pending_stores(pipe);
          swr_resource_read(view->texture);
+      }
    }
 }
 
@@ -719,7 +757,6 @@ swr_update_derived(struct pipe_context *pipe,
       /* Make the attachment updates */
       swr_draw_context *pDC = &ctx->swrDC;
       SWR_SURFACE_STATE *renderTargets = pDC->renderTargets;
-      unsigned need_fence = FALSE;
       for (i = 0; i < SWR_NUM_ATTACHMENTS; i++) {
          void *new_base = nullptr;
          if (new_attachment[i])
@@ -734,9 +771,14 @@ swr_update_derived(struct pipe_context *pipe,
                 * won't try to load from non-existent target. */
                enum SWR_TILE_STATE post_state = (new_attachment[i]
                   ? SWR_TILE_INVALID : SWR_TILE_RESOLVED);
-               swr_store_render_target(pipe, i, post_state);
-
-               need_fence |= TRUE;
+               SWR_RECT rect = {0, renderTargets[i].width,
+                                0, renderTargets[i].height};
+               swr_store_render_target(pipe, i, post_state, rect);
+
+               /* The store runs asynchronously, StoreTiles captures the
+                * old surface in its own draw state.  Readers of it submit
+                * the fence, see swr_fence_pending_stores. */
+               ctx->stores_unfenced = TRUE;
             }
 
             /* Make new attachment */
@@ -747,11 +789,6 @@ swr_update_derived(struct pipe_context *pipe,
                   renderTargets[i] = {0};
          }
       }
-
-      /* This fence ensures any attachment changes are resolved before the
-       * next draw */
-      if (need_fence)
-         swr_fence_submit(ctx, screen->flush_fence);
    }
 
    /* Raster state */
@@ -1312,10 +1349,6 @@ swr_update_derived(struct pipe_context *pipe,
 
    SwrSetBackendState(ctx->swrContext, &backendState);
 
-   /* Ensure that any in-progress attachment change StoreTiles finish */
-   if (swr_is_fence_pending(screen->flush_fence))
-      swr_fence_finish(pipe->screen, screen->flush_fence, 0);
-
    /* Finally, update the in-use status of all resources involved in draw */
    swr_update_resource_status(pipe, p_draw_info);
 
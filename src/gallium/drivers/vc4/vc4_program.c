@@ -29,12 +29,16 @@
 #include "util/u_memory.h"
 #include "util/ralloc.h"
 #include "util/hash_table.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
+#include "compiler/glsl/blob.h"
 #include "tgsi/tgsi_dump.h"
 #include "tgsi/tgsi_lowering.h"
 #include "tgsi/tgsi_parse.h"
 #include "compiler/nir/nir.h"
 #include "compiler/nir/nir_builder.h"
 #include "nir/tgsi_to_nir.h"
+#include "compiler/nir/nir_serialize.h"
 #include "vc4_context.h"
 #include "vc4_qpu.h"
 #include "vc4_qir.h"
@@ -1363,25 +1367,32 @@ emit_coord_end(struct vc4_compile *c)
                 emit_point_size_write(c);
 }
 
-static void
+static struct nir_shader *
 vc4_optimize_nir(struct nir_shader *s)
 {
         bool progress;
+        unsigned iterations = 0;
 
         do {
                 progress = false;
+                iterations++;
+
+                NIR_PASS_V(s, nir_lower_vars_to_ssa);
+                NIR_PASS_V(s, nir_lower_alu_to_scalar);
+
+                NIR_PASS(progress, s, nir_copy_prop);
+                NIR_PASS(progress, s, nir_opt_dce);
+                NIR_PASS(progress, s, nir_opt_cse);
+                NIR_PASS(progress, s, nir_opt_peephole_select);
+                NIR_PASS(progress, s, nir_opt_algebraic);
+                NIR_PASS(progress, s, nir_opt_constant_folding);
+                NIR_PASS(progress, s, nir_opt_undef);
+                NIR_PASS(progress, s, nir_opt_loop_unroll);
+        } while (progress);
 
-                nir_lower_vars_to_ssa(s);
-                nir_lower_alu_to_scalar(s);
+        nir_pass_stats_loop("vc4_optimize_nir", iterations);
 
-                progress = nir_copy_prop(s) || progress;
-                progress = nir_opt_dce(s) || progress;
-                progress = nir_opt_cse(s) || progress;
-                progress = nir_opt_peephole_select(s) || progress;
-                progress = nir_opt_algebraic(s) || progress;
-                progress = nir_opt_constant_folding(s) || progress;
-                progress = nir_opt_undef(s) || progress;
-        } while (progress);
+        return s;
 }
 
 static int
@@ -1746,8 +1757,20 @@ static const nir_shader_compiler_options nir_options = {
         .lower_fsat = true,
         .lower_fsqrt = true,
         .lower_negate = true,
+        /* We don't have loops, so unroll anything we can. */
+        .max_unroll_iterations = 32,
+        .max_unroll_instructions = 1024,
 };
 
+const void *
+vc4_get_compiler_options(enum pipe_shader_ir ir, unsigned shader)
+{
+        if (ir != PIPE_SHADER_IR_NIR)
+                return NULL;
+
+        return &nir_options;
+}
+
 static bool
 count_nir_instrs_in_block(nir_block *block, void *state)
 {
@@ -1800,18 +1823,24 @@ vc4_shader_ntq(struct vc4_context *vc4, enum qstage stage,
                 break;
         }
 
-        const struct tgsi_token *tokens = key->shader_state->base.tokens;
+        if (key->shader_state->base.type == PIPE_SHADER_IR_NIR) {
+                /* Compiled once per stage and key, so keep the original. */
+                c->s = nir_shader_clone(NULL, key->shader_state->base.nir);
+        } else {
+                const struct tgsi_token *tokens =
+                        key->shader_state->base.tokens;
 
-        if (vc4_debug & VC4_DEBUG_TGSI) {
-                fprintf(stderr, "%s prog %d/%d TGSI:\n",
-                        qir_get_stage_name(c->stage),
-                        c->program_id, c->variant_id);
-                tgsi_dump(tokens, 0);
-        }
+                if (vc4_debug & VC4_DEBUG_TGSI) {
+                        fprintf(stderr, "%s prog %d/%d TGSI:\n",
+                                qir_get_stage_name(c->stage),
+                                c->program_id, c->variant_id);
+                        tgsi_dump(tokens, 0);
+                }
 
-        c->s = tgsi_to_nir(tokens, &nir_options);
-        nir_opt_global_to_local(c->s);
-        nir_convert_to_ssa(c->s);
+                c->s = tgsi_to_nir(tokens, &nir_options);
+                nir_opt_global_to_local(c->s);
+                nir_convert_to_ssa(c->s);
+        }
 
         if (stage == QSTAGE_FRAG)
                 vc4_nir_lower_blend(c);
@@ -1879,7 +1908,7 @@ vc4_shader_ntq(struct vc4_context *vc4, enum qstage stage,
         nir_lower_idiv(c->s);
         nir_lower_load_const_to_scalar(c->s);
 
-        vc4_optimize_nir(c->s);
+        c->s = vc4_optimize_nir(c->s);
 
         nir_remove_dead_variables(c->s);
 
@@ -1962,9 +1991,29 @@ vc4_shader_state_create(struct pipe_context *pctx,
         if (!so)
                 return NULL;
 
-        so->base.tokens = tgsi_dup_tokens(cso->tokens);
+        if (cso->type == PIPE_SHADER_IR_NIR) {
+                /* The state tracker hands us ownership of the NIR. */
+                so->base.type = PIPE_SHADER_IR_NIR;
+                so->base.nir = cso->nir;
+        } else {
+                so->base.tokens = tgsi_dup_tokens(cso->tokens);
+        }
         so->program_id = vc4->next_uncompiled_program_id++;
 
+        if (vc4->screen->disk_shader_cache) {
+                if (so->base.type == PIPE_SHADER_IR_NIR) {
+                        struct blob *blob = blob_create(NULL);
+                        nir_serialize(blob, so->base.nir);
+                        _mesa_sha1_compute(blob->data, blob->size, so->sha1);
+                        ralloc_free(blob);
+                } else {
+                        _mesa_sha1_compute(so->base.tokens,
+                                           tgsi_num_tokens(so->base.tokens) *
+                                           sizeof(struct tgsi_token),
+                                           so->sha1);
+                }
+        }
+
         return so;
 }
 
@@ -1987,6 +2036,213 @@ copy_uniform_state_to_shader(struct vc4_compiled_shader *shader,
         vc4_set_shader_uniform_dirty_flags(shader);
 }
 
+/**
+ * Layout of a compiled shader in the on-disk cache: this header, followed
+ * by the QPU instructions, the uniform contents and data, the UBO ranges
+ * and the FS input slots.
+ */
+struct vc4_shader_cache_header {
+        uint32_t size; /* of the whole entry, to catch truncated files */
+        uint32_t qpu_inst_count;
+        uint32_t uniform_count;
+        uint32_t num_texture_samples;
+        uint32_t num_ubo_ranges;
+        uint32_t ubo_size;
+        uint32_t color_inputs;
+        uint32_t num_inputs;
+        uint32_t num_input_slots;
+        uint8_t vattr_offsets[9];
+        uint8_t vattrs_live;
+};
+
+static uint32_t
+vc4_shader_cache_entry_size(const struct vc4_shader_cache_header *head)
+{
+        return (sizeof(*head) +
+                head->qpu_inst_count * sizeof(uint64_t) +
+                head->uniform_count * (sizeof(enum quniform_contents) +
+                                       sizeof(uint32_t)) +
+                head->num_ubo_ranges * sizeof(struct vc4_ubo_range) +
+                head->num_input_slots * sizeof(struct vc4_varying_slot));
+}
+
+/**
+ * Computes the disk cache key for a variant.  The in-memory key identifies
+ * the uncompiled shader and (for VS/CS) the FS it's linked with by pointer
+ * and program ID, so those are replaced by the shader's SHA-1 and the FS's
+ * input slots.
+ */
+static void
+vc4_shader_cache_key(struct vc4_context *vc4, enum qstage stage,
+                     struct vc4_key *key, uint32_t key_size,
+                     cache_key hash)
+{
+        struct vc4_fs_key fs_key;
+        struct vc4_vs_key vs_key;
+        struct vc4_key *stable_key;
+        const void *slots = NULL;
+        uint32_t slots_size = 0;
+
+        if (stage == QSTAGE_FRAG) {
+                memcpy(&fs_key, key, sizeof(fs_key));
+                stable_key = &fs_key.base;
+        } else {
+                memcpy(&vs_key, key, sizeof(vs_key));
+                vs_key.compiled_fs_id = 0;
+                stable_key = &vs_key.base;
+
+                slots = vc4->prog.fs->input_slots;
+                slots_size = (vc4->prog.fs->num_inputs *
+                              sizeof(struct vc4_varying_slot));
+        }
+        stable_key->shader_state = NULL;
+
+        uint32_t stage_id = stage;
+        uint32_t size = (sizeof(stage_id) + sizeof(key->shader_state->sha1) +
+                         key_size + slots_size);
+        uint8_t *data = malloc(size), *p = data;
+        if (!data) {
+                memset(hash, 0, sizeof(cache_key));
+                return;
+        }
+
+        memcpy(p, &stage_id, sizeof(stage_id));
+        p += sizeof(stage_id);
+        memcpy(p, key->shader_state->sha1, sizeof(key->shader_state->sha1));
+        p += sizeof(key->shader_state->sha1);
+        memcpy(p, stable_key, key_size);
+        p += key_size;
+        if (slots_size)
+                memcpy(p, slots, slots_size);
+
+        disk_cache_compute_key(vc4->screen->disk_shader_cache, data, size,
+                               hash);
+        free(data);
+}
+
+static void
+vc4_shader_cache_store(struct vc4_context *vc4,
+                       struct vc4_compiled_shader *shader,
+                       struct vc4_compile *c, const cache_key hash,
+                       bool is_frag)
+{
+        struct vc4_shader_uniform_info *uinfo = &shader->uniforms;
+        struct vc4_shader_cache_header head;
+
+        memset(&head, 0, sizeof(head));
+        head.qpu_inst_count = c->qpu_inst_count;
+        head.uniform_count = uinfo->count;
+        head.num_texture_samples = uinfo->num_texture_samples;
+        head.num_ubo_ranges = shader->num_ubo_ranges;
+        head.ubo_size = shader->ubo_size;
+        head.color_inputs = shader->color_inputs;
+        head.num_inputs = shader->num_inputs;
+        head.num_input_slots = is_frag ? shader->num_inputs : 0;
+        memcpy(head.vattr_offsets, shader->vattr_offsets,
+               sizeof(head.vattr_offsets));
+        head.vattrs_live = shader->vattrs_live;
+        head.size = vc4_shader_cache_entry_size(&head);
+
+        uint8_t *blob = malloc(head.size), *p = blob;
+        if (!blob)
+                return;
+
+#define WRITE(src, bytes) do {                  \
+                memcpy(p, src, bytes);          \
+                p += bytes;                     \
+        } while (0)
+        WRITE(&head, sizeof(head));
+        WRITE(c->qpu_insts, head.qpu_inst_count * sizeof(uint64_t));
+        WRITE(uinfo->contents,
+              head.uniform_count * sizeof(enum quniform_contents));
+        WRITE(uinfo->data, head.uniform_count * sizeof(uint32_t));
+        WRITE(shader->ubo_ranges,
+              head.num_ubo_ranges * sizeof(struct vc4_ubo_range));
+        WRITE(shader->input_slots,
+              head.num_input_slots * sizeof(struct vc4_varying_slot));
+#undef WRITE
+        assert(p == blob + head.size);
+
+        disk_cache_put(vc4->screen->disk_shader_cache, hash, blob, head.size);
+        free(blob);
+}
+
+static struct vc4_compiled_shader *
+vc4_shader_cache_load(struct vc4_context *vc4, const cache_key hash)
+{
+        struct disk_cache *cache = vc4->screen->disk_shader_cache;
+        struct vc4_shader_cache_header head;
+        size_t size;
+
+        uint8_t *blob = disk_cache_get(cache, hash, &size);
+        if (!blob)
+                return NULL;
+
+        if (size < sizeof(head))
+                goto invalid;
+        memcpy(&head, blob, sizeof(head));
+        if (head.size != size || !head.qpu_inst_count ||
+            vc4_shader_cache_entry_size(&head) != size) {
+                goto invalid;
+        }
+
+        struct vc4_compiled_shader *shader =
+                rzalloc(NULL, struct vc4_compiled_shader);
+        struct vc4_shader_uniform_info *uinfo = &shader->uniforms;
+        const uint8_t *p = blob + sizeof(head);
+
+        const uint64_t *qpu_insts = (const uint64_t *)p;
+        p += head.qpu_inst_count * sizeof(uint64_t);
+
+        uinfo->count = head.uniform_count;
+        uinfo->num_texture_samples = head.num_texture_samples;
+        uinfo->contents = ralloc_array(shader, enum quniform_contents,
+                                       head.uniform_count);
+        memcpy(uinfo->contents, p,
+               head.uniform_count * sizeof(enum quniform_contents));
+        p += head.uniform_count * sizeof(enum quniform_contents);
+        uinfo->data = ralloc_array(shader, uint32_t, head.uniform_count);
+        memcpy(uinfo->data, p, head.uniform_count * sizeof(uint32_t));
+        p += head.uniform_count * sizeof(uint32_t);
+
+        if (head.num_ubo_ranges) {
+                shader->num_ubo_ranges = head.num_ubo_ranges;
+                shader->ubo_ranges = ralloc_array(shader, struct vc4_ubo_range,
+                                                  head.num_ubo_ranges);
+                memcpy(shader->ubo_ranges, p,
+                       head.num_ubo_ranges * sizeof(struct vc4_ubo_range));
+                p += head.num_ubo_ranges * sizeof(struct vc4_ubo_range);
+        }
+        shader->ubo_size = head.ubo_size;
+
+        if (head.num_input_slots) {
+                shader->input_slots = ralloc_array(shader,
+                                                   struct vc4_varying_slot,
+                                                   head.num_input_slots);
+                memcpy(shader->input_slots, p,
+                       head.num_input_slots * sizeof(struct vc4_varying_slot));
+        }
+
+        shader->color_inputs = head.color_inputs;
+        shader->num_inputs = head.num_inputs;
+        memcpy(shader->vattr_offsets, head.vattr_offsets,
+               sizeof(shader->vattr_offsets));
+        shader->vattrs_live = head.vattrs_live;
+
+        vc4_set_shader_uniform_dirty_flags(shader);
+        shader->bo = vc4_bo_alloc_shader(vc4->screen, qpu_insts,
+                                         head.qpu_inst_count *
+                                         sizeof(uint64_t));
+        free(blob);
+
+        return shader;
+
+invalid:
+        disk_cache_remove(cache, hash);
+        free(blob);
+        return NULL;
+}
+
 static struct vc4_compiled_shader *
 vc4_get_compiled_shader(struct vc4_context *vc4, enum qstage stage,
                         struct vc4_key *key)
@@ -2006,6 +2262,17 @@ vc4_get_compiled_shader(struct vc4_context *vc4, enum qstage stage,
         if (entry)
                 return entry->data;
 
+        bool use_disk_cache = vc4->screen->disk_shader_cache != NULL;
+        cache_key hash;
+        if (use_disk_cache) {
+                vc4_shader_cache_key(vc4, stage, key, key_size, hash);
+                shader = vc4_shader_cache_load(vc4, hash);
+                if (shader) {
+                        shader->program_id = vc4->next_compiled_program_id++;
+                        goto done;
+                }
+        }
+
         struct vc4_compile *c = vc4_shader_ntq(vc4, stage, key);
         shader = rzalloc(NULL, struct vc4_compiled_shader);
 
@@ -2095,9 +2362,15 @@ vc4_get_compiled_shader(struct vc4_context *vc4, enum qstage stage,
                 }
         }
 
+        if (use_disk_cache) {
+                vc4_shader_cache_store(vc4, shader, c, hash,
+                                       stage == QSTAGE_FRAG);
+        }
+
         qir_compile_destroy(c);
 
         struct vc4_key *dup_key;
+done:
         dup_key = ralloc_size(shader, key_size);
         memcpy(dup_key, key, key_size);
         _mesa_hash_table_insert(ht, dup_key, shader);
@@ -2308,7 +2581,10 @@ vc4_shader_state_delete(struct pipe_context *pctx, void *hwcso)
         hash_table_foreach(vc4->vs_cache, entry)
                 delete_from_cache_if_matches(vc4->vs_cache, entry, so);
 
-        free((void *)so->base.tokens);
+        if (so->base.type == PIPE_SHADER_IR_NIR)
+                ralloc_free(so->base.nir);
+        else
+                free((void *)so->base.tokens);
         free(so);
 }
 
@@ -418,6 +418,14 @@ struct vc4_compile {
         uint32_t qpu_inst_size;
         uint32_t num_inputs;
 
+        /* Statistics from qpu_schedule_instructions(), reported with
+         * VC4_DEBUG=shaderdb.
+         */
+        uint32_t qpu_sched_pairs;
+        uint32_t qpu_sched_nops;
+        uint32_t qpu_sched_regfile_conflicts;
+        uint32_t qpu_sched_tmu_stall_cycles;
+
         uint32_t program_id;
         uint32_t variant_id;
 };
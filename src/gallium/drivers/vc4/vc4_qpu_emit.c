@@ -529,10 +529,28 @@ vc4_generate_code(struct vc4_context *vc4, struct vc4_compile *c)
         cycles += c->qpu_inst_count - inst_count_at_schedule_time;
 
         if (vc4_debug & VC4_DEBUG_SHADERDB) {
+                const char *stage = qir_get_stage_name(c->stage);
+
                 fprintf(stderr, "SHADER-DB: %s prog %d/%d: %d estimated cycles\n",
-                        qir_get_stage_name(c->stage),
-                        c->program_id, c->variant_id,
+                        stage, c->program_id, c->variant_id,
                         cycles);
+                /* Share of the scheduled operations that got paired up
+                 * with another one into a single instruction.
+                 */
+                uint32_t ops = (inst_count_at_schedule_time -
+                                c->qpu_sched_nops + c->qpu_sched_pairs);
+                fprintf(stderr, "SHADER-DB: %s prog %d/%d: %d%% dual-issued\n",
+                        stage, c->program_id, c->variant_id,
+                        ops ? 200 * c->qpu_sched_pairs / ops : 0);
+                fprintf(stderr, "SHADER-DB: %s prog %d/%d: %d scheduler NOPs\n",
+                        stage, c->program_id, c->variant_id,
+                        c->qpu_sched_nops);
+                fprintf(stderr, "SHADER-DB: %s prog %d/%d: %d regfile conflict NOPs\n",
+                        stage, c->program_id, c->variant_id,
+                        c->qpu_sched_regfile_conflicts);
+                fprintf(stderr, "SHADER-DB: %s prog %d/%d: %d TMU stall cycles\n",
+                        stage, c->program_id, c->variant_id,
+                        c->qpu_sched_tmu_stall_cycles);
         }
 
         if (vc4_debug & VC4_DEBUG_QPU)
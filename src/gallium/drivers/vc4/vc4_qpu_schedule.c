@@ -439,6 +439,11 @@ struct choose_scoreboard {
         int tick;
         int last_sfu_write_tick;
         uint32_t last_waddr_a, last_waddr_b;
+
+        /* Set when a candidate was skipped for reading a regfile A/B
+         * location written by the previous instruction.
+         */
+        bool regfile_conflict;
 };
 
 static bool
@@ -517,9 +522,11 @@ get_instruction_priority(uint64_t inst)
 static struct schedule_node *
 choose_instruction_to_schedule(struct choose_scoreboard *scoreboard,
                                struct list_head *schedule_list,
-                               struct schedule_node *prev_inst)
+                               struct schedule_node *prev_inst,
+                               uint32_t time)
 {
         struct schedule_node *chosen = NULL;
+        bool chosen_ready = false;
         int chosen_prio = 0;
 
         list_for_each_entry(struct schedule_node, n, schedule_list, link) {
@@ -529,8 +536,11 @@ choose_instruction_to_schedule(struct choose_scoreboard *scoreboard,
                  *  regfile A or B that was written to by the previous
                  *  instruction."
                  */
-                if (reads_too_soon_after_write(scoreboard, inst))
+                if (reads_too_soon_after_write(scoreboard, inst)) {
+                        if (!prev_inst)
+                                scoreboard->regfile_conflict = true;
                         continue;
+                }
 
                 /* "A scoreboard wait must not occur in the first two
                  *  instructions of a fragment shader. This is either the
@@ -547,11 +557,23 @@ choose_instruction_to_schedule(struct choose_scoreboard *scoreboard,
                         if (prev_inst->uniform != -1 && n->uniform != -1)
                                 continue;
 
+                        /* Don't hold up the instruction we're pairing with
+                         * waiting on this one's results to be available.
+                         */
+                        if (n->unblocked_time > time)
+                                continue;
+
                         inst = qpu_merge_inst(prev_inst->inst->inst, inst);
                         if (!inst)
                                 continue;
                 }
 
+                /* Prefer instructions that can issue without stalling on
+                 * their parents' latency (such as a TMU result load issued
+                 * right after its coordinates), so that the stall gets
+                 * covered by independent work.
+                 */
+                bool ready = n->unblocked_time <= time;
                 int prio = get_instruction_priority(inst);
 
                 /* Found a valid instruction.  If nothing better comes along,
@@ -559,19 +581,32 @@ choose_instruction_to_schedule(struct choose_scoreboard *scoreboard,
                  */
                 if (!chosen) {
                         chosen = n;
+                        chosen_ready = ready;
+                        chosen_prio = prio;
+                        continue;
+                }
+
+                if (ready && !chosen_ready) {
+                        chosen = n;
+                        chosen_ready = ready;
                         chosen_prio = prio;
                         continue;
+                } else if (!ready && chosen_ready) {
+                        continue;
                 }
 
                 if (prio > chosen_prio) {
                         chosen = n;
+                        chosen_ready = ready;
                         chosen_prio = prio;
                 } else if (prio < chosen_prio) {
                         continue;
                 }
 
+                /* Then take the instruction on the longest critical path. */
                 if (n->delay > chosen->delay) {
                         chosen = n;
+                        chosen_ready = ready;
                         chosen_prio = prio;
                 } else if (n->delay < chosen->delay) {
                         continue;
@@ -756,10 +791,11 @@ schedule_instructions(struct vc4_compile *c, struct list_head *schedule_list)
         }
 
         while (!list_empty(schedule_list)) {
+                scoreboard.regfile_conflict = false;
                 struct schedule_node *chosen =
                         choose_instruction_to_schedule(&scoreboard,
                                                        schedule_list,
-                                                       NULL);
+                                                       NULL, time);
                 struct schedule_node *merge = NULL;
 
                 /* If there are no valid instructions to schedule, drop a NOP
@@ -767,6 +803,12 @@ schedule_instructions(struct vc4_compile *c, struct list_head *schedule_list)
                  */
                 uint64_t inst = chosen ? chosen->inst->inst : qpu_NOP();
 
+                if (!chosen) {
+                        c->qpu_sched_nops++;
+                        if (scoreboard.regfile_conflict)
+                                c->qpu_sched_regfile_conflicts++;
+                }
+
                 if (debug) {
                         fprintf(stderr, "t=%4d: current list:\n",
                                 time);
@@ -780,6 +822,14 @@ schedule_instructions(struct vc4_compile *c, struct list_head *schedule_list)
                  * find an instruction to pair with it.
                  */
                 if (chosen) {
+                        if (chosen->unblocked_time > time) {
+                                uint32_t sig = QPU_GET_FIELD(inst, QPU_SIG);
+                                if (sig == QPU_SIG_LOAD_TMU0 ||
+                                    sig == QPU_SIG_LOAD_TMU1) {
+                                        c->qpu_sched_tmu_stall_cycles +=
+                                                chosen->unblocked_time - time;
+                                }
+                        }
                         time = MAX2(chosen->unblocked_time, time);
                         list_del(&chosen->link);
                         mark_instruction_scheduled(schedule_list, time,
@@ -794,8 +844,9 @@ schedule_instructions(struct vc4_compile *c, struct list_head *schedule_list)
 
                         merge = choose_instruction_to_schedule(&scoreboard,
                                                                schedule_list,
-                                                               chosen);
+                                                               chosen, time);
                         if (merge) {
+                                c->qpu_sched_pairs++;
                                 time = MAX2(merge->unblocked_time, time);
                                 list_del(&merge->link);
                                 inst = qpu_merge_inst(inst, merge->inst->inst);
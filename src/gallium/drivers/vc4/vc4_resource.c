@@ -115,7 +115,7 @@ vc4_resource_transfer_unmap(struct pipe_context *pctx,
                 blit.filter = PIPE_TEX_FILTER_NEAREST;
 
                 pctx->blit(pctx, &blit);
-                vc4_flush(pctx);
+                vc4_flush_jobs_writing_resource(vc4, ptrans->resource);
 
                 pipe_resource_reference(&trans->ss_resource, NULL);
         }
@@ -157,6 +157,12 @@ vc4_resource_transfer_map(struct pipe_context *pctx,
         char *buf;
 
         if (usage & PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE) {
+                /* A queued job rendering to this resource picks up the
+                 * resource's BO at submit time, so get it out before we
+                 * swap in a new BO.
+                 */
+                vc4_flush_jobs_writing_resource(vc4, prsc);
+
                 if (vc4_resource_bo_alloc(rsc)) {
 
                         /* If it might be bound as one of our vertex buffers,
@@ -165,24 +171,35 @@ vc4_resource_transfer_map(struct pipe_context *pctx,
                         if (prsc->bind & PIPE_BIND_VERTEX_BUFFER)
                                 vc4->dirty |= VC4_DIRTY_VTXBUF;
                 } else {
-                        /* If we failed to reallocate, flush everything so
-                         * that we don't violate any syncing requirements.
+                        /* If we failed to reallocate, flush the jobs using
+                         * the resource so that we don't violate any syncing
+                         * requirements.
                          */
-                        vc4_flush(pctx);
+                        vc4_flush_jobs_reading_resource(vc4, prsc);
                 }
         } else if (!(usage & PIPE_TRANSFER_UNSYNCHRONIZED)) {
-                if (vc4_cl_references_bo(pctx, rsc->bo)) {
-                        if ((usage & PIPE_TRANSFER_DISCARD_RANGE) &&
-                            prsc->last_level == 0 &&
-                            prsc->width0 == box->width &&
-                            prsc->height0 == box->height &&
-                            prsc->depth0 == box->depth &&
-                            vc4_resource_bo_alloc(rsc)) {
+                if ((usage & PIPE_TRANSFER_DISCARD_RANGE) &&
+                    prsc->last_level == 0 &&
+                    prsc->width0 == box->width &&
+                    prsc->height0 == box->height &&
+                    prsc->depth0 == box->depth &&
+                    vc4_cl_references_bo(pctx, rsc->bo)) {
+                        vc4_flush_jobs_writing_resource(vc4, prsc);
+
+                        if (vc4_resource_bo_alloc(rsc)) {
                                 if (prsc->bind & PIPE_BIND_VERTEX_BUFFER)
                                         vc4->dirty |= VC4_DIRTY_VTXBUF;
                         } else {
-                                vc4_flush(pctx);
+                                vc4_flush_jobs_reading_resource(vc4, prsc);
                         }
+                } else if (usage & PIPE_TRANSFER_WRITE) {
+                        /* Writes have to wait for any job reading or writing
+                         * the resource, while reads only have to wait for
+                         * the jobs writing it.
+                         */
+                        vc4_flush_jobs_reading_resource(vc4, prsc);
+                } else {
+                        vc4_flush_jobs_writing_resource(vc4, prsc);
                 }
         }
 
@@ -237,7 +254,8 @@ vc4_resource_transfer_map(struct pipe_context *pctx,
                         blit.filter = PIPE_TEX_FILTER_NEAREST;
 
                         pctx->blit(pctx, &blit);
-                        vc4_flush(pctx);
+                        vc4_flush_jobs_writing_resource(vc4,
+                                                        trans->ss_resource);
                 }
 
                 /* The rest of the mapping process should use our temporary. */
@@ -31,6 +31,7 @@
 #include "util/u_memory.h"
 #include "util/u_format.h"
 #include "util/ralloc.h"
+#include "util/disk_cache.h"
 
 #include "vc4_screen.h"
 #include "vc4_context.h"
@@ -47,6 +48,8 @@ static const struct debug_named_value debug_options[] = {
           "Dump NIR during program compile" },
         { "tgsi",     VC4_DEBUG_TGSI,
           "Dump TGSI during program compile" },
+        { "glsl_nir", VC4_DEBUG_GLSL_NIR,
+          "Take GLSL shaders as NIR instead of TGSI" },
         { "shaderdb", VC4_DEBUG_SHADERDB,
           "Dump program compile information for shader-db analysis" },
         { "perf",     VC4_DEBUG_PERF,
@@ -82,6 +85,9 @@ vc4_screen_get_vendor(struct pipe_screen *pscreen)
 static void
 vc4_screen_destroy(struct pipe_screen *pscreen)
 {
+        struct vc4_screen *screen = vc4_screen(pscreen);
+
+        disk_cache_destroy(screen->disk_shader_cache);
         vc4_bufmgr_destroy(pscreen);
         ralloc_free(pscreen);
 }
@@ -360,6 +366,8 @@ vc4_screen_get_shader_param(struct pipe_screen *pscreen, unsigned shader,
         case PIPE_SHADER_CAP_MAX_SAMPLER_VIEWS:
                 return VC4_MAX_TEXTURE_SAMPLERS;
         case PIPE_SHADER_CAP_PREFERRED_IR:
+                if (vc4_debug & VC4_DEBUG_GLSL_NIR)
+                        return PIPE_SHADER_IR_NIR;
                 return PIPE_SHADER_IR_TGSI;
         case PIPE_SHADER_CAP_SUPPORTED_IRS:
                 return 0;
@@ -375,6 +383,17 @@ vc4_screen_get_shader_param(struct pipe_screen *pscreen, unsigned shader,
         return 0;
 }
 
+static const void *
+vc4_screen_get_compiler_options(struct pipe_screen *pscreen,
+                                enum pipe_shader_ir ir, unsigned shader)
+{
+        if (shader != PIPE_SHADER_VERTEX &&
+            shader != PIPE_SHADER_FRAGMENT)
+                return NULL;
+
+        return vc4_get_compiler_options(ir, shader);
+}
+
 static boolean
 vc4_screen_is_format_supported(struct pipe_screen *pscreen,
                                enum pipe_format format,
@@ -495,6 +514,7 @@ vc4_screen_create(int fd)
         pscreen->get_param = vc4_screen_get_param;
         pscreen->get_paramf = vc4_screen_get_paramf;
         pscreen->get_shader_param = vc4_screen_get_shader_param;
+        pscreen->get_compiler_options = vc4_screen_get_compiler_options;
         pscreen->context_create = vc4_context_create;
         pscreen->is_format_supported = vc4_screen_is_format_supported;
 
@@ -513,6 +533,18 @@ vc4_screen_create(int fd)
 
         vc4_resource_screen_init(pscreen);
 
+        /* The shader dumps and shader-db statistics come from the compiler,
+         * so don't skip it when they were asked for.
+         */
+        if (debug_get_bool_option("VC4_DISK_CACHE", false) &&
+            !(vc4_debug & (VC4_DEBUG_QPU | VC4_DEBUG_QIR | VC4_DEBUG_NIR |
+                           VC4_DEBUG_TGSI | VC4_DEBUG_SHADERDB))) {
+                screen->disk_shader_cache =
+                        disk_cache_create("vc4",
+                                          "vc4 " PACKAGE_VERSION
+                                          " " __DATE__ " " __TIME__);
+        }
+
         pscreen->get_name = vc4_screen_get_name;
         pscreen->get_vendor = vc4_screen_get_vendor;
         pscreen->get_device_vendor = vc4_screen_get_vendor;
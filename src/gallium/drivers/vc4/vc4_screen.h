@@ -42,10 +42,13 @@ struct vc4_bo;
 #define VC4_DEBUG_ALWAYS_SYNC  0x0100
 #define VC4_DEBUG_NIR       0x0200
 #define VC4_DEBUG_DUMP      0x0400
+#define VC4_DEBUG_GLSL_NIR  0x0800
 
 #define VC4_MAX_MIP_LEVELS 12
 #define VC4_MAX_TEXTURE_SAMPLERS 16
 
+struct disk_cache;
+
 struct vc4_screen {
         struct pipe_screen base;
         int fd;
@@ -75,6 +78,9 @@ struct vc4_screen {
 
         uint32_t bo_size;
         uint32_t bo_count;
+
+        /** On-disk cache of compiled shaders, if enabled. */
+        struct disk_cache *disk_shader_cache;
 };
 
 static inline struct vc4_screen *
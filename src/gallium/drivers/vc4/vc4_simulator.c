@@ -77,8 +77,8 @@ static int
 vc4_simulator_pin_bos(struct drm_device *dev, struct vc4_exec_info *exec)
 {
         struct drm_vc4_submit_cl *args = exec->args;
-        struct vc4_context *vc4 = dev->vc4;
-        struct vc4_bo **bos = vc4->bo_pointers.base;
+        struct vc4_job *job = dev->job;
+        struct vc4_bo **bos = job->bo_pointers.base;
 
         exec->bo_count = args->bo_handle_count;
         exec->bo = calloc(exec->bo_count, sizeof(void *));
@@ -219,10 +219,11 @@ vc4_dump_to_file(struct vc4_exec_info *exec)
 }
 
 int
-vc4_simulator_flush(struct vc4_context *vc4, struct drm_vc4_submit_cl *args)
+vc4_simulator_flush(struct vc4_context *vc4, struct drm_vc4_submit_cl *args,
+                    struct vc4_job *job)
 {
         struct vc4_screen *screen = vc4->screen;
-        struct vc4_surface *csurf = vc4_surface(vc4->framebuffer.cbufs[0]);
+        struct vc4_surface *csurf = vc4_surface(job->key.cbuf);
         struct vc4_resource *ctex = csurf ? vc4_resource(csurf->base.texture) : NULL;
         uint32_t winsys_stride = ctex ? ctex->bo->simulator_winsys_stride : 0;
         uint32_t sim_stride = ctex ? ctex->slices[0].stride : 0;
@@ -230,6 +231,7 @@ vc4_simulator_flush(struct vc4_context *vc4, struct drm_vc4_submit_cl *args)
         struct vc4_exec_info exec;
         struct drm_device local_dev = {
                 .vc4 = vc4,
+                .job = job,
                 .simulator_mem_next = OVERFLOW_SIZE,
         };
         struct drm_device *dev = &local_dev;
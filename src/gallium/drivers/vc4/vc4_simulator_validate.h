@@ -61,6 +61,7 @@ typedef uint32_t u32;
 
 struct drm_device {
         struct vc4_context *vc4;
+        struct vc4_job *job;
         uint32_t simulator_mem_next;
 };
 
@@ -52,6 +52,10 @@
 #include "vc4_context.h"
 #include "vc4_tiling.h"
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 /** Return the width in pixels of a 64-byte microtile. */
 uint32_t
 vc4_utile_width(int cpp)
@@ -98,30 +102,112 @@ vc4_size_is_lt(uint32_t width, uint32_t height, int cpp)
                 height <= 4 * vc4_utile_height(cpp));
 }
 
-void
-vc4_load_utile(void *dst, void *src, uint32_t dst_stride, uint32_t cpp)
+/**
+ * Copies one 64-byte utile out to a raster image with rows of @row_size
+ * bytes (8 for cpp == 1, 16 otherwise).
+ */
+static inline void
+vc4_load_utile_rows(void *dst, const void *src, uint32_t dst_stride,
+                    uint32_t row_size)
 {
-        uint32_t utile_h = vc4_utile_height(cpp);
-        uint32_t row_size = 64 / utile_h;
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+        const uint8_t *s = src;
+        uint8_t *d = dst;
+        uint8x16_t q0 = vld1q_u8(s + 0);
+        uint8x16_t q1 = vld1q_u8(s + 16);
+        uint8x16_t q2 = vld1q_u8(s + 32);
+        uint8x16_t q3 = vld1q_u8(s + 48);
 
-        for (int y = 0; y < utile_h; y++) {
-                memcpy(dst, src, row_size);
-                dst += dst_stride;
-                src += row_size;
+        if (row_size == 16) {
+                vst1q_u8(d, q0); d += dst_stride;
+                vst1q_u8(d, q1); d += dst_stride;
+                vst1q_u8(d, q2); d += dst_stride;
+                vst1q_u8(d, q3);
+        } else {
+                vst1_u8(d, vget_low_u8(q0)); d += dst_stride;
+                vst1_u8(d, vget_high_u8(q0)); d += dst_stride;
+                vst1_u8(d, vget_low_u8(q1)); d += dst_stride;
+                vst1_u8(d, vget_high_u8(q1)); d += dst_stride;
+                vst1_u8(d, vget_low_u8(q2)); d += dst_stride;
+                vst1_u8(d, vget_high_u8(q2)); d += dst_stride;
+                vst1_u8(d, vget_low_u8(q3)); d += dst_stride;
+                vst1_u8(d, vget_high_u8(q3));
         }
+#else
+        /* Constant-size copies so that the compiler can open-code them. */
+        if (row_size == 16) {
+                for (int y = 0; y < 4; y++) {
+                        memcpy(dst, src, 16);
+                        dst += dst_stride;
+                        src += 16;
+                }
+        } else {
+                for (int y = 0; y < 8; y++) {
+                        memcpy(dst, src, 8);
+                        dst += dst_stride;
+                        src += 8;
+                }
+        }
+#endif
 }
 
-void
-vc4_store_utile(void *dst, void *src, uint32_t src_stride, uint32_t cpp)
+/**
+ * Copies one 64-byte utile in from a raster image with rows of @row_size
+ * bytes (8 for cpp == 1, 16 otherwise).
+ */
+static inline void
+vc4_store_utile_rows(void *dst, const void *src, uint32_t src_stride,
+                     uint32_t row_size)
 {
-        uint32_t utile_h = vc4_utile_height(cpp);
-        uint32_t row_size = 64 / utile_h;
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+        const uint8_t *s = src;
+        uint8_t *d = dst;
 
-        for (int y = 0; y < utile_h; y++) {
-                memcpy(dst, src, row_size);
-                dst += row_size;
-                src += src_stride;
+        if (row_size == 16) {
+                uint8x16_t q0 = vld1q_u8(s); s += src_stride;
+                uint8x16_t q1 = vld1q_u8(s); s += src_stride;
+                uint8x16_t q2 = vld1q_u8(s); s += src_stride;
+                uint8x16_t q3 = vld1q_u8(s);
+                vst1q_u8(d + 0, q0);
+                vst1q_u8(d + 16, q1);
+                vst1q_u8(d + 32, q2);
+                vst1q_u8(d + 48, q3);
+        } else {
+                for (int i = 0; i < 4; i++) {
+                        uint8x8_t lo = vld1_u8(s); s += src_stride;
+                        uint8x8_t hi = vld1_u8(s); s += src_stride;
+                        vst1q_u8(d + i * 16, vcombine_u8(lo, hi));
+                }
         }
+#else
+        if (row_size == 16) {
+                for (int y = 0; y < 4; y++) {
+                        memcpy(dst, src, 16);
+                        dst += 16;
+                        src += src_stride;
+                }
+        } else {
+                for (int y = 0; y < 8; y++) {
+                        memcpy(dst, src, 8);
+                        dst += 8;
+                        src += src_stride;
+                }
+        }
+#endif
+}
+
+void
+vc4_load_utile(void *dst, void *src, uint32_t dst_stride, uint32_t cpp)
+{
+        vc4_load_utile_rows(dst, src, dst_stride,
+                            64 / vc4_utile_height(cpp));
+}
+
+void
+vc4_store_utile(void *dst, void *src, uint32_t src_stride, uint32_t cpp)
+{
+        vc4_store_utile_rows(dst, src, src_stride,
+                             64 / vc4_utile_height(cpp));
 }
 
 static void
@@ -133,6 +219,9 @@ check_box_utile_alignment(const struct pipe_box *box, int cpp)
         assert(!(box->height & (vc4_utile_height(cpp) - 1)));
 }
 
+/* LT images are a raster-order grid of utiles, so each row of utiles is
+ * one contiguous run of 64-byte utiles that we can walk linearly.
+ */
 static void
 vc4_load_lt_image(void *dst, uint32_t dst_stride,
                   void *src, uint32_t src_stride,
@@ -140,16 +229,19 @@ vc4_load_lt_image(void *dst, uint32_t dst_stride,
 {
         uint32_t utile_w = vc4_utile_width(cpp);
         uint32_t utile_h = vc4_utile_height(cpp);
-        uint32_t xstart = box->x / utile_w;
-        uint32_t ystart = box->y / utile_h;
+        uint32_t row_size = 64 / utile_h;
+        uint32_t utiles_w = box->width / utile_w;
 
         for (uint32_t y = 0; y < box->height; y += utile_h) {
-                for (int x = 0; x < box->width; x += utile_w) {
-                        vc4_load_utile(dst + (dst_stride * y +
-                                              x * cpp),
-                                       src + ((ystart + y) * src_stride +
-                                              (xstart + x) * 64 / utile_w),
-                                       dst_stride, cpp);
+                void *src_utile = src + ((box->y + y) * src_stride +
+                                         box->x / utile_w * 64);
+                void *dst_utile = dst + dst_stride * y;
+
+                for (uint32_t x = 0; x < utiles_w; x++) {
+                        vc4_load_utile_rows(dst_utile, src_utile,
+                                            dst_stride, row_size);
+                        src_utile += 64;
+                        dst_utile += row_size;
                 }
         }
 }
@@ -161,16 +253,19 @@ vc4_store_lt_image(void *dst, uint32_t dst_stride,
 {
         uint32_t utile_w = vc4_utile_width(cpp);
         uint32_t utile_h = vc4_utile_height(cpp);
-        uint32_t xstart = box->x / utile_w;
-        uint32_t ystart = box->y / utile_h;
+        uint32_t row_size = 64 / utile_h;
+        uint32_t utiles_w = box->width / utile_w;
 
         for (uint32_t y = 0; y < box->height; y += utile_h) {
-                for (int x = 0; x < box->width; x += utile_w) {
-                        vc4_store_utile(dst + ((ystart + y) * dst_stride +
-                                               (xstart + x) * 64 / utile_w),
-                                        src + (src_stride * y +
-                                               x * cpp),
-                                        src_stride, cpp);
+                void *dst_utile = dst + ((box->y + y) * dst_stride +
+                                         box->x / utile_w * 64);
+                void *src_utile = src + src_stride * y;
+
+                for (uint32_t x = 0; x < utiles_w; x++) {
+                        vc4_store_utile_rows(dst_utile, src_utile,
+                                             src_stride, row_size);
+                        dst_utile += 64;
+                        src_utile += row_size;
                 }
         }
 }
@@ -179,7 +274,7 @@ vc4_store_lt_image(void *dst, uint32_t dst_stride,
  * Takes a utile x and y (and the number of utiles of width of the image) and
  * returns the offset to the utile within a VC4_TILING_FORMAT_TF image.
  */
-static uint32_t
+static inline uint32_t
 t_utile_address(uint32_t utile_x, uint32_t utile_y,
                 uint32_t utile_stride)
 {
@@ -222,6 +317,53 @@ t_utile_address(uint32_t utile_x, uint32_t utile_y,
         return tile_offset + stile_offset + utile_offset;
 }
 
+/**
+ * The parts of t_utile_address() that only depend on the utile row, so that
+ * walking a row of utiles only has to do the per-column math.
+ */
+struct vc4_t_utile_row {
+        uint32_t offset;
+        uint32_t tile_stride;
+        bool odd_tile_y;
+        const uint32_t *stile_map;
+};
+
+static void
+t_utile_row_init(struct vc4_t_utile_row *row, uint32_t utile_y,
+                 uint32_t utile_stride)
+{
+        static const uint32_t odd_stile_map[2][2] = {{2, 1}, {3, 0}};
+        static const uint32_t even_stile_map[2][2] = {{0, 3}, {1, 2}};
+
+        assert(!(utile_stride & 7));
+        row->tile_stride = utile_stride >> 3;
+
+        uint32_t tile_y = utile_y >> 3;
+        uint32_t stile_y = (utile_y >> 2) & 1;
+
+        row->odd_tile_y = tile_y & 1;
+        row->stile_map = (row->odd_tile_y ?
+                          odd_stile_map[stile_y] :
+                          even_stile_map[stile_y]);
+        row->offset = (4096 * tile_y * row->tile_stride +
+                       64 * (utile_y & 3) * 4);
+}
+
+static inline uint32_t
+t_utile_row_address(const struct vc4_t_utile_row *row, uint32_t utile_x)
+{
+        uint32_t tile_x = utile_x >> 3;
+
+        /* Odd lines of 4k tiles go right-to-left. */
+        if (row->odd_tile_y)
+                tile_x = row->tile_stride - tile_x - 1;
+
+        return (row->offset +
+                4096 * tile_x +
+                1024 * row->stile_map[(utile_x >> 2) & 1] +
+                64 * (utile_x & 3));
+}
+
 static void
 vc4_load_t_image(void *dst, uint32_t dst_stride,
                  void *src, uint32_t src_stride,
@@ -229,18 +371,25 @@ vc4_load_t_image(void *dst, uint32_t dst_stride,
 {
         uint32_t utile_w = vc4_utile_width(cpp);
         uint32_t utile_h = vc4_utile_height(cpp);
+        uint32_t row_size = 64 / utile_h;
         uint32_t utile_stride = src_stride / cpp / utile_w;
         uint32_t xstart = box->x / utile_w;
         uint32_t ystart = box->y / utile_h;
 
         for (uint32_t y = 0; y < box->height / utile_h; y++) {
-                for (int x = 0; x < box->width / utile_w; x++) {
-                        vc4_load_utile(dst + (y * utile_h * dst_stride +
-                                              x * utile_w * cpp),
-                                       src + t_utile_address(xstart + x,
-                                                             ystart + y,
-                                                             utile_stride),
-                                       dst_stride, cpp);
+                struct vc4_t_utile_row row;
+                t_utile_row_init(&row, ystart + y, utile_stride);
+                void *dst_utile = dst + y * utile_h * dst_stride;
+
+                for (uint32_t x = 0; x < box->width / utile_w; x++) {
+                        assert(t_utile_row_address(&row, xstart + x) ==
+                               t_utile_address(xstart + x, ystart + y,
+                                               utile_stride));
+                        vc4_load_utile_rows(dst_utile,
+                                            src + t_utile_row_address(&row,
+                                                                      xstart + x),
+                                            dst_stride, row_size);
+                        dst_utile += row_size;
                 }
         }
 }
@@ -252,18 +401,25 @@ vc4_store_t_image(void *dst, uint32_t dst_stride,
 {
         uint32_t utile_w = vc4_utile_width(cpp);
         uint32_t utile_h = vc4_utile_height(cpp);
+        uint32_t row_size = 64 / utile_h;
         uint32_t utile_stride = dst_stride / cpp / utile_w;
         uint32_t xstart = box->x / utile_w;
         uint32_t ystart = box->y / utile_h;
 
         for (uint32_t y = 0; y < box->height / utile_h; y++) {
-                for (int x = 0; x < box->width / utile_w; x++) {
-                        vc4_store_utile(dst + t_utile_address(xstart + x,
-                                                              ystart + y,
-                                                              utile_stride),
-                                        src + (y * utile_h * src_stride +
-                                               x * utile_w * cpp),
-                                        src_stride, cpp);
+                struct vc4_t_utile_row row;
+                t_utile_row_init(&row, ystart + y, utile_stride);
+                void *src_utile = src + y * utile_h * src_stride;
+
+                for (uint32_t x = 0; x < box->width / utile_w; x++) {
+                        assert(t_utile_row_address(&row, xstart + x) ==
+                               t_utile_address(xstart + x, ystart + y,
+                                               utile_stride));
+                        vc4_store_utile_rows(dst + t_utile_row_address(&row,
+                                                                       xstart + x),
+                                             src_utile,
+                                             src_stride, row_size);
+                        src_utile += row_size;
                 }
         }
 }
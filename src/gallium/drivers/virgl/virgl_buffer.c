@@ -38,6 +38,91 @@ static void virgl_buffer_destroy(struct pipe_screen *screen,
    FREE(vbuf);
 }
 
+/*
+ * Queue up a range of the buffer written by the cpu, to be sent to the
+ * host with the next flush.  All writes between two flushes are merged
+ * into a single transfer per buffer, instead of one per unmap.
+ */
+static void virgl_buffer_add_dirty_range(struct virgl_context *vctx,
+                                         struct virgl_buffer *vbuf,
+                                         unsigned start, unsigned end)
+{
+   if (!vbuf->on_list) {
+       struct pipe_resource *res = NULL;
+
+       list_addtail(&vbuf->flush_list, &vctx->to_flush_bufs);
+       vbuf->on_list = TRUE;
+       pipe_resource_reference(&res, &vbuf->base.u.b);
+   }
+
+   util_range_add(&vbuf->valid_buffer_range, start, end);
+
+   vbuf->base.clean = FALSE;
+}
+
+void virgl_buffer_flush(struct virgl_context *vctx,
+                        struct virgl_buffer *vbuf)
+{
+   struct virgl_screen *rs = virgl_screen(vctx->base.screen);
+   struct pipe_box box;
+
+   assert(vbuf->on_list);
+
+   if (vbuf->valid_buffer_range.start >= vbuf->valid_buffer_range.end)
+      return;
+
+   box.height = 1;
+   box.depth = 1;
+   box.y = 0;
+   box.z = 0;
+
+   box.x = vbuf->valid_buffer_range.start;
+   box.width = MIN2(vbuf->valid_buffer_range.end - vbuf->valid_buffer_range.start, vbuf->base.u.b.width0);
+
+   vctx->num_transfers++;
+   rs->vws->transfer_put(rs->vws, vbuf->base.hw_res,
+                         &box, 0, 0, box.x, 0);
+
+   util_range_set_empty(&vbuf->valid_buffer_range);
+}
+
+/*
+ * Replace the hw resource of a buffer whose whole contents are being
+ * discarded, so the map doesn't have to wait for the host to be done
+ * with the old one.  The winsys keeps a cache of idle vertex/index/
+ * constant buffers, so streaming buffers end up cycling through a small
+ * pool of resources.
+ */
+static boolean virgl_buffer_rename(struct virgl_context *vctx,
+                                   struct virgl_buffer *vbuf)
+{
+   struct virgl_screen *vs = virgl_screen(vctx->base.screen);
+   struct pipe_resource *res = &vbuf->base.u.b;
+   struct virgl_hw_res *hw_res;
+   uint32_t vbind = pipe_to_virgl_bind(res->bind);
+
+   /* only bindings that virgl_rebind_buffer() knows how to restore */
+   if (vbind & ~(VIRGL_BIND_VERTEX_BUFFER | VIRGL_BIND_INDEX_BUFFER |
+                 VIRGL_BIND_CONSTANT_BUFFER))
+      return FALSE;
+
+   hw_res = vs->vws->resource_create(vs->vws, res->target, res->format, vbind,
+                                     res->width0, 1, 1, 1, 0, 0, res->width0);
+   if (!hw_res)
+      return FALSE;
+
+   /* the cmds already queued up still need the old data on the host */
+   if (vbuf->on_list)
+      virgl_buffer_flush(vctx, vbuf);
+
+   vs->vws->resource_unref(vs->vws, vbuf->base.hw_res);
+   vbuf->base.hw_res = hw_res;
+   vbuf->base.clean = TRUE;
+
+   virgl_rebind_buffer(vctx, res);
+   return TRUE;
+}
+
 static void *virgl_buffer_transfer_map(struct pipe_context *ctx,
                                        struct pipe_resource *resource,
                                        unsigned level,
@@ -54,7 +139,16 @@ static void *virgl_buffer_transfer_map(struct pipe_context *ctx,
    uint32_t offset;
    bool doflushwait = false;
 
-   if ((usage & PIPE_TRANSFER_READ) && (vbuf->on_list == TRUE))
+   if ((usage & PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE) &&
+       !(usage & PIPE_TRANSFER_UNSYNCHRONIZED) &&
+       !vbuf->base.clean &&
+       virgl_buffer_rename(vctx, vbuf))
+      usage |= PIPE_TRANSFER_UNSYNCHRONIZED;
+
+   readback = virgl_res_needs_readback(vctx, &vbuf->base, usage);
+
+   /* queued up writes must reach the host before anything is read back */
+   if (((usage & PIPE_TRANSFER_READ) || readback) && (vbuf->on_list == TRUE))
       doflushwait = true;
    else
       doflushwait = virgl_res_needs_flush_wait(vctx, &vbuf->base, usage);
@@ -75,7 +169,6 @@ static void *virgl_buffer_transfer_map(struct pipe_context *ctx,
 
    offset = box->x;
 
-   readback = virgl_res_needs_readback(vctx, &vbuf->base, usage);
    if (readback)
       vs->vws->transfer_get(vs->vws, vbuf->base.hw_res, box, trans->base.stride, trans->base.layer_stride, offset, level);
 
@@ -104,14 +197,9 @@ static void virgl_buffer_transfer_unmap(struct pipe_context *ctx,
    struct virgl_buffer *vbuf = virgl_buffer(transfer->resource);
 
    if (trans->base.usage & PIPE_TRANSFER_WRITE) {
-      if (!(transfer->usage & PIPE_TRANSFER_FLUSH_EXPLICIT)) {
-         struct virgl_screen *vs = virgl_screen(ctx->screen);
-         vbuf->base.clean = FALSE;
-         vctx->num_transfers++;
-         vs->vws->transfer_put(vs->vws, vbuf->base.hw_res,
-                               &transfer->box, trans->base.stride, trans->base.layer_stride, trans->offset, transfer->level);
-
-      }
+      if (!(transfer->usage & PIPE_TRANSFER_FLUSH_EXPLICIT))
+         virgl_buffer_add_dirty_range(vctx, vbuf, transfer->box.x,
+                                      transfer->box.x + transfer->box.width);
    }
 
    util_slab_free(&vctx->texture_transfer_pool, trans);
@@ -124,18 +212,8 @@ static void virgl_buffer_transfer_flush_region(struct pipe_context *ctx,
    struct virgl_context *vctx = virgl_context(ctx);
    struct virgl_buffer *vbuf = virgl_buffer(transfer->resource);
 
-   if (!vbuf->on_list) {
-       struct pipe_resource *res = NULL;
-
-       list_addtail(&vbuf->flush_list, &vctx->to_flush_bufs);
-       vbuf->on_list = TRUE;
-       pipe_resource_reference(&res, &vbuf->base.u.b);
-   }
-
-   util_range_add(&vbuf->valid_buffer_range, transfer->box.x + box->x,
-                  transfer->box.x + box->x + box->width);
-
-   vbuf->base.clean = FALSE;
+   virgl_buffer_add_dirty_range(vctx, vbuf, transfer->box.x + box->x,
+                                transfer->box.x + box->x + box->width);
 }
 
 static const struct u_resource_vtbl virgl_buffer_vtbl =
@@ -27,6 +27,7 @@
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 #include "pipe/p_state.h"
+#include "util/hash_table.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_format.h"
@@ -35,6 +36,7 @@
 #include "util/u_slab.h"
 #include "util/u_upload_mgr.h"
 #include "util/u_blitter.h"
+#include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_text.h"
 #include "indices/u_primconvert.h"
 
@@ -53,27 +55,112 @@ uint32_t virgl_object_assign_handle(void)
    return ++next_handle;
 }
 
-static void virgl_buffer_flush(struct virgl_context *vctx,
-                              struct virgl_buffer *vbuf)
+/*
+ * Host objects created from state objects and shaders are deduplicated
+ * per context: creating a CSO with the same contents as a live one just
+ * takes a reference on the existing host handle, instead of sending the
+ * state (and for shaders, the tokens to compile) to the host again.
+ * The CSO pointer handed back to the state tracker is the virgl_object.
+ */
+struct virgl_object {
+   uint32_t handle;
+   uint32_t type;          /* VIRGL_OBJECT_x */
+   unsigned refcount;
+   uint32_t hash;
+   unsigned size;
+   /* followed by the state the object was created from */
+};
+
+static inline const void *virgl_object_data(const struct virgl_object *obj)
 {
-   struct virgl_screen *rs = virgl_screen(vctx->base.screen);
-   struct pipe_box box;
+   return obj + 1;
+}
 
-   assert(vbuf->on_list);
+static inline uint32_t virgl_object_handle(void *cso)
+{
+   struct virgl_object *obj = cso;
+   return obj ? obj->handle : 0;
+}
 
-   box.height = 1;
-   box.depth = 1;
-   box.y = 0;
-   box.z = 0;
+static uint32_t virgl_object_hash(const void *key)
+{
+   const struct virgl_object *obj = key;
+   return obj->hash;
+}
 
-   box.x = vbuf->valid_buffer_range.start;
-   box.width = MIN2(vbuf->valid_buffer_range.end - vbuf->valid_buffer_range.start, vbuf->base.u.b.width0);
+static bool virgl_object_equal(const void *a, const void *b)
+{
+   const struct virgl_object *obj_a = a, *obj_b = b;
+   return obj_a->type == obj_b->type && obj_a->size == obj_b->size &&
+      !memcmp(virgl_object_data(obj_a), virgl_object_data(obj_b), obj_a->size);
+}
+
+/*
+ * Look up the object created from the given state, which is the
+ * concatenation of data0 and data1.  If there is none yet, a new one is
+ * returned with *created set, and the caller has to encode its creation.
+ */
+static struct virgl_object *virgl_object_get(struct virgl_context *vctx,
+                                             uint32_t type,
+                                             const void *data0, unsigned size0,
+                                             const void *data1, unsigned size1,
+                                             bool *created)
+{
+   struct virgl_object *obj;
+   struct hash_entry *entry;
+   uint8_t *data;
+
+   *created = false;
 
-   vctx->num_transfers++;
-   rs->vws->transfer_put(rs->vws, vbuf->base.hw_res,
-                         &box, 0, 0, box.x, 0);
+   obj = MALLOC(sizeof(*obj) + size0 + size1);
+   if (!obj)
+      return NULL;
 
-   util_range_set_empty(&vbuf->valid_buffer_range);
+   data = (uint8_t *)(obj + 1);
+   memcpy(data, data0, size0);
+   if (size1)
+      memcpy(data + size0, data1, size1);
+
+   obj->type = type;
+   obj->size = size0 + size1;
+   obj->hash = _mesa_fnv32_1a_accumulate_block(_mesa_fnv32_1a_offset_bias,
+                                                &type, sizeof(type));
+   obj->hash = _mesa_fnv32_1a_accumulate_block(obj->hash, data, obj->size);
+
+   entry = _mesa_hash_table_search_pre_hashed(vctx->objects, obj->hash, obj);
+   if (entry) {
+      FREE(obj);
+      obj = entry->data;
+      obj->refcount++;
+      return obj;
+   }
+
+   obj->handle = virgl_object_assign_handle();
+   obj->refcount = 1;
+   _mesa_hash_table_insert_pre_hashed(vctx->objects, obj->hash, obj, obj);
+   *created = true;
+   return obj;
+}
+
+static void virgl_object_put(struct virgl_context *vctx, void *cso)
+{
+   struct virgl_object *obj = cso;
+   struct hash_entry *entry;
+
+   if (!obj || --obj->refcount)
+      return;
+
+   virgl_encode_delete_object(vctx, obj->handle, obj->type);
+
+   entry = _mesa_hash_table_search_pre_hashed(vctx->objects, obj->hash, obj);
+   assert(entry);
+   _mesa_hash_table_remove(vctx->objects, entry);
+   FREE(obj);
+}
+
+static void virgl_object_free(struct hash_entry *entry)
+{
+   FREE(entry->data);
 }
 
 static void virgl_attach_res_framebuffer(struct virgl_context *vctx)
@@ -239,19 +326,21 @@ static void *virgl_create_blend_state(struct pipe_context *ctx,
                                               const struct pipe_blend_state *blend_state)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle;
-   handle = virgl_object_assign_handle();
-
-   virgl_encode_blend_state(vctx, handle, blend_state);
-   return (void *)(unsigned long)handle;
-
+   struct virgl_object *obj;
+   bool created;
+
+   obj = virgl_object_get(vctx, VIRGL_OBJECT_BLEND,
+                          blend_state, sizeof(*blend_state), NULL, 0, &created);
+   if (created)
+      virgl_encode_blend_state(vctx, obj->handle, blend_state);
+   return obj;
 }
 
 static void virgl_bind_blend_state(struct pipe_context *ctx,
                                            void *blend_state)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle = (unsigned long)blend_state;
+   uint32_t handle = virgl_object_handle(blend_state);
    virgl_encode_bind_object(vctx, handle, VIRGL_OBJECT_BLEND);
 }
 
@@ -259,26 +348,28 @@ static void virgl_delete_blend_state(struct pipe_context *ctx,
                                      void *blend_state)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle = (unsigned long)blend_state;
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_BLEND);
+   virgl_object_put(vctx, blend_state);
 }
 
 static void *virgl_create_depth_stencil_alpha_state(struct pipe_context *ctx,
                                                    const struct pipe_depth_stencil_alpha_state *blend_state)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle;
-   handle = virgl_object_assign_handle();
-
-   virgl_encode_dsa_state(vctx, handle, blend_state);
-   return (void *)(unsigned long)handle;
+   struct virgl_object *obj;
+   bool created;
+
+   obj = virgl_object_get(vctx, VIRGL_OBJECT_DSA,
+                          blend_state, sizeof(*blend_state), NULL, 0, &created);
+   if (created)
+      virgl_encode_dsa_state(vctx, obj->handle, blend_state);
+   return obj;
 }
 
 static void virgl_bind_depth_stencil_alpha_state(struct pipe_context *ctx,
                                                 void *blend_state)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle = (unsigned long)blend_state;
+   uint32_t handle = virgl_object_handle(blend_state);
    virgl_encode_bind_object(vctx, handle, VIRGL_OBJECT_DSA);
 }
 
@@ -286,26 +377,28 @@ static void virgl_delete_depth_stencil_alpha_state(struct pipe_context *ctx,
                                                   void *dsa_state)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle = (unsigned long)dsa_state;
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_DSA);
+   virgl_object_put(vctx, dsa_state);
 }
 
 static void *virgl_create_rasterizer_state(struct pipe_context *ctx,
                                                    const struct pipe_rasterizer_state *rs_state)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle;
-   handle = virgl_object_assign_handle();
-
-   virgl_encode_rasterizer_state(vctx, handle, rs_state);
-   return (void *)(unsigned long)handle;
+   struct virgl_object *obj;
+   bool created;
+
+   obj = virgl_object_get(vctx, VIRGL_OBJECT_RASTERIZER,
+                          rs_state, sizeof(*rs_state), NULL, 0, &created);
+   if (created)
+      virgl_encode_rasterizer_state(vctx, obj->handle, rs_state);
+   return obj;
 }
 
 static void virgl_bind_rasterizer_state(struct pipe_context *ctx,
                                                 void *rs_state)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle = (unsigned long)rs_state;
+   uint32_t handle = virgl_object_handle(rs_state);
 
    virgl_encode_bind_object(vctx, handle, VIRGL_OBJECT_RASTERIZER);
 }
@@ -314,8 +407,7 @@ static void virgl_delete_rasterizer_state(struct pipe_context *ctx,
                                          void *rs_state)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle = (unsigned long)rs_state;
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_RASTERIZER);
+   virgl_object_put(vctx, rs_state);
 }
 
 static void virgl_set_framebuffer_state(struct pipe_context *ctx,
@@ -342,27 +434,31 @@ static void *virgl_create_vertex_elements_state(struct pipe_context *ctx,
                                                         const struct pipe_vertex_element *elements)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle = virgl_object_assign_handle();
-   virgl_encoder_create_vertex_elements(vctx, handle,
-                                       num_elements, elements);
-   return (void*)(unsigned long)handle;
-
+   struct virgl_object *obj;
+   bool created;
+
+   obj = virgl_object_get(vctx, VIRGL_OBJECT_VERTEX_ELEMENTS,
+                          elements, num_elements * sizeof(*elements),
+                          NULL, 0, &created);
+   if (created)
+      virgl_encoder_create_vertex_elements(vctx, obj->handle,
+                                           num_elements, elements);
+   return obj;
 }
 
 static void virgl_delete_vertex_elements_state(struct pipe_context *ctx,
                                               void *ve)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle = (unsigned long)ve;
 
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_VERTEX_ELEMENTS);
+   virgl_object_put(vctx, ve);
 }
 
 static void virgl_bind_vertex_elements_state(struct pipe_context *ctx,
                                                      void *ve)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle = (unsigned long)ve;
+   uint32_t handle = virgl_object_handle(ve);
    virgl_encode_bind_object(vctx, handle, VIRGL_OBJECT_VERTEX_ELEMENTS);
 }
 
@@ -437,6 +533,8 @@ static void virgl_set_constant_buffer(struct pipe_context *ctx,
          virgl_encoder_set_uniform_buffer(vctx, shader, index, buf->buffer_offset,
                                           buf->buffer_size, res);
          pipe_resource_reference(&vctx->ubos[shader][index], buf->buffer);
+         vctx->ubo_offset[shader][index] = buf->buffer_offset;
+         vctx->ubo_size[shader][index] = buf->buffer_size;
          return;
       }
       pipe_resource_reference(&vctx->ubos[shader][index], NULL);
@@ -447,6 +545,33 @@ static void virgl_set_constant_buffer(struct pipe_context *ctx,
    }
 }
 
+/*
+ * A buffer got a new hw resource (see virgl_buffer_transfer_map()), so
+ * any bindings of it that the host already knows about need to be
+ * re-emitted.  Index buffers are emitted on every indexed draw anyway.
+ */
+void virgl_rebind_buffer(struct virgl_context *vctx,
+                         struct pipe_resource *res)
+{
+   unsigned shader, i;
+
+   for (i = 0; i < vctx->num_vertex_buffers; i++) {
+      if (vctx->vertex_buffer[i].buffer == res)
+         vctx->vertex_array_dirty = TRUE;
+   }
+
+   for (shader = 0; shader < PIPE_SHADER_TYPES; shader++) {
+      for (i = 0; i < PIPE_MAX_CONSTANT_BUFFERS; i++) {
+         if (vctx->ubos[shader][i] != res)
+            continue;
+         virgl_encoder_set_uniform_buffer(vctx, shader, i,
+                                          vctx->ubo_offset[shader][i],
+                                          vctx->ubo_size[shader][i],
+                                          virgl_resource(res));
+      }
+   }
+}
+
 void virgl_transfer_inline_write(struct pipe_context *ctx,
                                 struct pipe_resource *res,
                                 unsigned level,
@@ -478,26 +603,43 @@ static void *virgl_shader_encoder(struct pipe_context *ctx,
                                   unsigned type)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle;
+   struct virgl_object *obj;
    struct tgsi_token *new_tokens;
+   struct {
+      unsigned type;
+      struct pipe_stream_output_info so;
+   } key;
+   bool created;
    int ret;
 
+   memset(&key, 0, sizeof(key));
+   key.type = type;
+   key.so = shader->stream_output;
+
+   obj = virgl_object_get(vctx, VIRGL_OBJECT_SHADER, &key, sizeof(key),
+                          shader->tokens,
+                          tgsi_num_tokens(shader->tokens) * sizeof(struct tgsi_token),
+                          &created);
+   if (!obj || !created)
+      return obj;
+
    new_tokens = virgl_tgsi_transform(shader->tokens);
-   if (!new_tokens)
+   if (!new_tokens) {
+      virgl_object_put(vctx, obj);
       return NULL;
+   }
 
-   handle = virgl_object_assign_handle();
    /* encode VS state */
-   ret = virgl_encode_shader_state(vctx, handle, type,
+   ret = virgl_encode_shader_state(vctx, obj->handle, type,
                                    &shader->stream_output,
                                    new_tokens);
+   FREE(new_tokens);
    if (ret) {
+      virgl_object_put(vctx, obj);
       return NULL;
    }
 
-   FREE(new_tokens);
-   return (void *)(unsigned long)handle;
-
+   return obj;
 }
 static void *virgl_create_vs_state(struct pipe_context *ctx,
                                    const struct pipe_shader_state *shader)
@@ -521,36 +663,33 @@ static void
 virgl_delete_fs_state(struct pipe_context *ctx,
                      void *fs)
 {
-   uint32_t handle = (unsigned long)fs;
    struct virgl_context *vctx = virgl_context(ctx);
 
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_SHADER);
+   virgl_object_put(vctx, fs);
 }
 
 static void
 virgl_delete_gs_state(struct pipe_context *ctx,
                      void *gs)
 {
-   uint32_t handle = (unsigned long)gs;
    struct virgl_context *vctx = virgl_context(ctx);
 
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_SHADER);
+   virgl_object_put(vctx, gs);
 }
 
 static void
 virgl_delete_vs_state(struct pipe_context *ctx,
                      void *vs)
 {
-   uint32_t handle = (unsigned long)vs;
    struct virgl_context *vctx = virgl_context(ctx);
 
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_SHADER);
+   virgl_object_put(vctx, vs);
 }
 
 static void virgl_bind_vs_state(struct pipe_context *ctx,
                                         void *vss)
 {
-   uint32_t handle = (unsigned long)vss;
+   uint32_t handle = virgl_object_handle(vss);
    struct virgl_context *vctx = virgl_context(ctx);
 
    virgl_encode_bind_shader(vctx, handle, PIPE_SHADER_VERTEX);
@@ -559,7 +698,7 @@ static void virgl_bind_vs_state(struct pipe_context *ctx,
 static void virgl_bind_gs_state(struct pipe_context *ctx,
                                void *vss)
 {
-   uint32_t handle = (unsigned long)vss;
+   uint32_t handle = virgl_object_handle(vss);
    struct virgl_context *vctx = virgl_context(ctx);
 
    virgl_encode_bind_shader(vctx, handle, PIPE_SHADER_GEOMETRY);
@@ -569,7 +708,7 @@ static void virgl_bind_gs_state(struct pipe_context *ctx,
 static void virgl_bind_fs_state(struct pipe_context *ctx,
                                         void *vss)
 {
-   uint32_t handle = (unsigned long)vss;
+   uint32_t handle = virgl_object_handle(vss);
    struct virgl_context *vctx = virgl_context(ctx);
 
    virgl_encode_bind_shader(vctx, handle, PIPE_SHADER_FRAGMENT);
@@ -748,21 +887,22 @@ static void *virgl_create_sampler_state(struct pipe_context *ctx,
                                         const struct pipe_sampler_state *state)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle;
-
-   handle = virgl_object_assign_handle();
-
-   virgl_encode_sampler_state(vctx, handle, state);
-   return (void *)(unsigned long)handle;
+   struct virgl_object *obj;
+   bool created;
+
+   obj = virgl_object_get(vctx, VIRGL_OBJECT_SAMPLER_STATE,
+                          state, sizeof(*state), NULL, 0, &created);
+   if (created)
+      virgl_encode_sampler_state(vctx, obj->handle, state);
+   return obj;
 }
 
 static void virgl_delete_sampler_state(struct pipe_context *ctx,
                                       void *ss)
 {
    struct virgl_context *vctx = virgl_context(ctx);
-   uint32_t handle = (unsigned long)ss;
 
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_SAMPLER_STATE);
+   virgl_object_put(vctx, ss);
 }
 
 static void virgl_bind_sampler_states(struct pipe_context *ctx,
@@ -774,7 +914,7 @@ static void virgl_bind_sampler_states(struct pipe_context *ctx,
    uint32_t handles[32];
    int i;
    for (i = 0; i < num_samplers; i++) {
-      handles[i] = (unsigned long)(samplers[i]);
+      handles[i] = virgl_object_handle(samplers[i]);
    }
    virgl_encode_bind_sampler_states(vctx, shader, start_slot, num_samplers, handles);
 }
@@ -863,6 +1003,7 @@ virgl_context_destroy( struct pipe_context *ctx )
    util_primconvert_destroy(vctx->primconvert);
 
    util_slab_destroy(&vctx->texture_transfer_pool);
+   _mesa_hash_table_destroy(vctx->objects, virgl_object_free);
    FREE(vctx);
 }
 
@@ -880,6 +1021,14 @@ struct pipe_context *virgl_context_create(struct pipe_screen *pscreen,
       return NULL;
    }
 
+   vctx->objects = _mesa_hash_table_create(NULL, virgl_object_hash,
+                                           virgl_object_equal);
+   if (!vctx->objects) {
+      rs->vws->cmd_buf_destroy(vctx->cbuf);
+      FREE(vctx);
+      return NULL;
+   }
+
    vctx->base.destroy = virgl_context_destroy;
    vctx->base.create_surface = virgl_create_surface;
    vctx->base.surface_destroy = virgl_surface_destroy;
@@ -28,6 +28,7 @@
 #include "util/u_slab.h"
 #include "util/list.h"
 
+struct hash_table;
 struct pipe_screen;
 struct tgsi_token;
 struct u_upload_mgr;
@@ -69,12 +70,17 @@ struct virgl_context {
    unsigned num_so_targets;
 
    struct pipe_resource *ubos[PIPE_SHADER_TYPES][PIPE_MAX_CONSTANT_BUFFERS];
+   uint32_t ubo_offset[PIPE_SHADER_TYPES][PIPE_MAX_CONSTANT_BUFFERS];
+   uint32_t ubo_size[PIPE_SHADER_TYPES][PIPE_MAX_CONSTANT_BUFFERS];
    int num_transfers;
    int num_draws;
    struct list_head to_flush_bufs;
 
    struct primconvert_context *primconvert;
    uint32_t hw_sub_ctx_id;
+
+   /* live state objects and shaders, see virgl_object_get() */
+   struct hash_table *objects;
 };
 
 static inline struct virgl_sampler_view *
@@ -110,6 +116,9 @@ void virgl_transfer_inline_write(struct pipe_context *ctx,
                                 unsigned stride,
                                 unsigned layer_stride);
 
+void virgl_rebind_buffer(struct virgl_context *vctx,
+                         struct pipe_resource *res);
+
 struct tgsi_token *virgl_tgsi_transform(const struct tgsi_token *tokens_in);
 
 #endif
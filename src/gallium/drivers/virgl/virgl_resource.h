@@ -109,6 +109,9 @@ static inline struct virgl_transfer *virgl_transfer(struct pipe_transfer *trans)
 struct pipe_resource *virgl_buffer_create(struct virgl_screen *vs,
                                           const struct pipe_resource *templ);
 
+void virgl_buffer_flush(struct virgl_context *vctx,
+                        struct virgl_buffer *vbuf);
+
 static inline unsigned pipe_to_virgl_bind(unsigned pbind)
 {
    unsigned outbind = 0;
@@ -767,7 +767,8 @@ enum pipe_shader_ir
 {
    PIPE_SHADER_IR_TGSI,
    PIPE_SHADER_IR_LLVM,
-   PIPE_SHADER_IR_NATIVE
+   PIPE_SHADER_IR_NATIVE,
+   PIPE_SHADER_IR_NIR
 };
 
 /**
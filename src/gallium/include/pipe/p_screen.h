@@ -119,6 +119,16 @@ struct pipe_screen {
 			    enum pipe_compute_cap param,
 			    void *ret);
 
+   /**
+    * Return the compiler options (e.g. a nir_shader_compiler_options) the
+    * driver wants shaders in the given IR to be built with, or NULL if the
+    * IR isn't supported for that shader stage.
+    * \param shader  one of PIPE_SHADER_x
+    */
+   const void *(*get_compiler_options)(struct pipe_screen *screen,
+                                       enum pipe_shader_ir ir,
+                                       unsigned shader);
+
    /**
     * Query a timestamp in nanoseconds. The returned value should match
     * PIPE_QUERY_TIMESTAMP. This function returns immediately and doesn't
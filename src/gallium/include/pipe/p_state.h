@@ -216,6 +216,13 @@ struct pipe_shader_state
 {
    const struct tgsi_token *tokens;
    struct pipe_stream_output_info stream_output;
+
+   /**
+    * PIPE_SHADER_IR_TGSI (the default) or PIPE_SHADER_IR_NIR.  For NIR,
+    * tokens is NULL and the driver takes ownership of the nir_shader.
+    */
+   enum pipe_shader_ir type;
+   struct nir_shader *nir;
 };
 
 
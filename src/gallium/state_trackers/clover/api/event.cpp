@@ -129,13 +129,11 @@ clSetEventCallback(cl_event d_ev, cl_int type,
    if (!pfn_notify || type != CL_COMPLETE)
       throw error(CL_INVALID_VALUE);
 
-   // Create a temporary soft event that depends on ev, with
-   // pfn_notify as completion action.
-   create<soft_event>(ev.context(), ref_vector<event> { ev }, true,
-                      [=, &ev](event &) {
-                         ev.wait();
-                         pfn_notify(desc(ev), ev.status(), user_data);
-                      });
+   // Run pfn_notify from the context's completion thread once ev has
+   // completed, so neither the caller nor whoever triggers ev blocks.
+   ev.context().notify_completion(ev, [=](event &ev) {
+         pfn_notify(desc(ev), ev.status(), user_data);
+      });
 
    return CL_SUCCESS;
 
@@ -191,7 +189,8 @@ clEnqueueMarkerWithWaitList(cl_command_queue d_q, cl_uint num_deps,
 
    // Create a hard event that depends on the events in the wait list:
    // previous commands in the same queue are implicitly serialized
-   // with respect to it -- hard events always are.
+   // with respect to it -- hard events always are, and markers
+   // without a wait list are on out-of-order queues too.
    auto hev = create<hard_event>(q, CL_COMMAND_MARKER, deps);
 
    ret_object(rd_ev, hev);
@@ -203,9 +202,12 @@ clEnqueueMarkerWithWaitList(cl_command_queue d_q, cl_uint num_deps,
 
 CLOVER_API cl_int
 clEnqueueBarrier(cl_command_queue d_q) try {
-   obj(d_q);
+   auto &q = obj(d_q);
 
-   // No need to do anything, q preserves data ordering strictly.
+   // In-order queues preserve data ordering strictly, out-of-order
+   // queues need a barrier event to serialize against.
+   if (q.out_of_order())
+      create<hard_event>(q, CL_COMMAND_BARRIER, ref_vector<event> {});
 
    return CL_SUCCESS;
 
@@ -226,7 +228,8 @@ clEnqueueBarrierWithWaitList(cl_command_queue d_q, cl_uint num_deps,
 
    // Create a hard event that depends on the events in the wait list:
    // subsequent commands in the same queue will be implicitly
-   // serialized with respect to it -- hard events always are.
+   // serialized with respect to it -- hard events always are, and
+   // barriers are on out-of-order queues too.
    auto hev = create<hard_event>(q, CL_COMMAND_BARRIER, deps);
 
    ret_object(rd_ev, hev);
@@ -61,6 +61,7 @@ clReleaseCommandQueue(cl_command_queue d_q) try {
    auto &q = obj(d_q);
 
    q.flush();
+   q.finish_trace();
 
    if (q.release())
       delete pobj(d_q);
@@ -270,6 +270,112 @@ namespace {
                                    src_obj->resource(q), src_orig);
       };
    }
+
+   ///
+   /// Hardware copy of a rectangular region from the buffer \a src_obj
+   /// to the buffer \a dst_obj.  Rows and slices that are contiguous
+   /// in both buffers are merged into a single copy.
+   ///
+   std::function<void (event &)>
+   hard_rect_copy_op(command_queue &q,
+                     buffer *dst_obj, const vector_t &dst_orig,
+                     const vector_t &dst_pitch,
+                     buffer *src_obj, const vector_t &src_orig,
+                     const vector_t &src_pitch,
+                     const vector_t &region) {
+      return [=, &q](event &) {
+         auto &dst = dst_obj->resource(q);
+         auto &src = src_obj->resource(q);
+         size_t width = region[0];
+         vector_t count = region;
+
+         if (dst_pitch[1] == width && src_pitch[1] == width) {
+            width *= region[1];
+            count[1] = 1;
+
+            if (dst_pitch[2] == width && src_pitch[2] == width) {
+               width *= region[2];
+               count[2] = 1;
+            }
+         }
+
+         vector_t v = {};
+
+         for (v[2] = 0; v[2] < count[2]; ++v[2]) {
+            for (v[1] = 0; v[1] < count[1]; ++v[1]) {
+               dst.copy(q, {{ dot(dst_pitch, dst_orig + v) }},
+                        {{ width, 1, 1 }},
+                        src, {{ dot(src_pitch, src_orig + v) }});
+            }
+         }
+      };
+   }
+
+   ///
+   /// Copy from the buffer \a src_obj to the image \a dst_obj.  Gallium
+   /// can't copy between buffers and textures on the device, so the
+   /// buffer is mapped and the image is written through the driver's
+   /// transfer path, which doesn't have to wait for the GPU to finish
+   /// with the image.
+   ///
+   std::function<void (event &)>
+   buffer_to_image_op(command_queue &q,
+                      image *dst_obj, const vector_t &dst_orig,
+                      buffer *src_obj, size_t src_offset,
+                      const vector_t &region) {
+      return [=, &q](event &) {
+         const size_t row_pitch = dst_obj->pixel_size() * region[0];
+         const size_t slice_pitch = row_pitch * region[1];
+         mapping src { q, src_obj->resource(q), CL_MAP_READ, true,
+                       {{ src_offset }}, {{ slice_pitch * region[2], 1, 1 }} };
+
+         dst_obj->resource(q).write(q, dst_orig, region,
+                                    static_cast<const void *>(src),
+                                    row_pitch, slice_pitch);
+      };
+   }
+
+   ///
+   /// Copy from the image \a src_obj to the buffer \a dst_obj, the
+   /// other way around: the image is mapped and the buffer is written
+   /// through the driver's transfer path.
+   ///
+   std::function<void (event &)>
+   image_to_buffer_op(command_queue &q,
+                      buffer *dst_obj, size_t dst_offset,
+                      image *src_obj, const vector_t &src_orig,
+                      const vector_t &region) {
+      return [=, &q](event &) {
+         mapping src { q, src_obj->resource(q), CL_MAP_READ, true,
+                       src_orig, region };
+         auto &dst = dst_obj->resource(q);
+         size_t width = src_obj->pixel_size() * region[0];
+         vector_t count = region;
+
+         if (src.row_pitch() == width) {
+            width *= region[1];
+            count[1] = 1;
+
+            if (src.slice_pitch() == width) {
+               width *= region[2];
+               count[2] = 1;
+            }
+         }
+
+         vector_t v = {};
+
+         for (v[2] = 0; v[2] < count[2]; ++v[2]) {
+            for (v[1] = 0; v[1] < count[1]; ++v[1]) {
+               const size_t offset = v[2] * width * count[1] + v[1] * width;
+
+               dst.write(q, {{ dst_offset + offset }}, {{ width, 1, 1 }},
+                         static_cast<const char *>(src) +
+                         v[2] * src.slice_pitch() + v[1] * src.row_pitch(),
+                         width, width);
+            }
+         }
+      };
+   }
 }
 
 CLOVER_API cl_int
@@ -466,9 +572,9 @@ clEnqueueCopyBufferRect(cl_command_queue d_q, cl_mem d_src_mem,
 
    auto hev = create<hard_event>(
       q, CL_COMMAND_COPY_BUFFER_RECT, deps,
-      soft_copy_op(q, &dst_mem, dst_origin, dst_pitch,
-                   &src_mem, src_origin, src_pitch,
-                   region));
+      hard_rect_copy_op(q, &dst_mem, dst_origin, dst_pitch,
+                        &src_mem, src_origin, src_pitch,
+                        region));
 
    ret_object(rd_ev, hev);
    return CL_SUCCESS;
@@ -592,9 +698,6 @@ clEnqueueCopyImageToBuffer(cl_command_queue d_q,
    vector_t dst_origin = { dst_offset };
    auto dst_pitch = pitch(region, {{ src_img.pixel_size() }});
    auto src_origin = vector(p_src_origin);
-   auto src_pitch = pitch(region, {{ src_img.pixel_size(),
-                                     src_img.row_pitch(),
-                                     src_img.slice_pitch() }});
 
    validate_common(q, deps);
    validate_object(q, dst_mem, dst_origin, dst_pitch, region);
@@ -602,9 +705,9 @@ clEnqueueCopyImageToBuffer(cl_command_queue d_q,
 
    auto hev = create<hard_event>(
       q, CL_COMMAND_COPY_IMAGE_TO_BUFFER, deps,
-      soft_copy_op(q, &dst_mem, dst_origin, dst_pitch,
-                   &src_img, src_origin, src_pitch,
-                   region));
+      image_to_buffer_op(q, &dst_mem, dst_offset,
+                         &src_img, src_origin,
+                         region));
 
    ret_object(rd_ev, hev);
    return CL_SUCCESS;
@@ -626,9 +729,6 @@ clEnqueueCopyBufferToImage(cl_command_queue d_q,
    auto deps = objs<wait_list_tag>(d_deps, num_deps);
    auto region = vector(p_region);
    auto dst_origin = vector(p_dst_origin);
-   auto dst_pitch = pitch(region, {{ dst_img.pixel_size(),
-                                     dst_img.row_pitch(),
-                                     dst_img.slice_pitch() }});
    vector_t src_origin = { src_offset };
    auto src_pitch = pitch(region, {{ dst_img.pixel_size() }});
 
@@ -638,9 +738,9 @@ clEnqueueCopyBufferToImage(cl_command_queue d_q,
 
    auto hev = create<hard_event>(
       q, CL_COMMAND_COPY_BUFFER_TO_IMAGE, deps,
-      soft_copy_op(q, &dst_img, dst_origin, dst_pitch,
-                   &src_mem, src_origin, src_pitch,
-                   region));
+      buffer_to_image_op(q, &dst_img, dst_origin,
+                         &src_mem, src_offset,
+                         region));
 
    ret_object(rd_ev, hev);
    return CL_SUCCESS;
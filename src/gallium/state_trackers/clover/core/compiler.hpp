@@ -39,6 +39,11 @@ namespace clover {
 
    module compile_program_tgsi(const std::string &source,
                                std::string &r_log);
+
+   /// Describe the compiler and the libraries the LLVM path links in
+   /// for \a target, so cached binaries are dropped when any of them
+   /// changes.
+   std::string compiler_id_llvm(const std::string &target);
 }
 
 #endif
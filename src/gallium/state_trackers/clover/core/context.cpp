@@ -21,15 +21,128 @@
 //
 
 #include "core/context.hpp"
+#include "core/event.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <thread>
 
 using namespace clover;
 
+namespace {
+   // How long the completion thread sleeps before looking at events
+   // that don't have a fence to block on yet.
+   const std::chrono::milliseconds poll_interval(10);
+   const uint64_t fence_timeout = 10000000; // ns
+}
+
+///
+/// State shared between a context and its completion thread.  The
+/// thread keeps it alive by itself, so the context may be destroyed
+/// from one of the callbacks the thread runs.
+///
+struct context::completion_worker {
+   typedef std::pair<intrusive_ref<event>,
+                     std::function<void (event &)>> entry;
+
+   std::mutex mutex;
+   std::condition_variable cv;
+   std::list<entry> pending;
+   bool stop = false;
+   std::thread thread;
+};
+
 context::context(const property_list &props,
                  const ref_vector<device> &devs,
                  const notify_action &notify) :
    notify(notify), props(props), devs(devs) {
 }
 
+context::~context() {
+   if (completion) {
+      {
+         std::lock_guard<std::mutex> lock(completion->mutex);
+         completion->stop = true;
+      }
+      completion->cv.notify_all();
+
+      if (completion->thread.get_id() == std::this_thread::get_id())
+         completion->thread.detach();
+      else
+         completion->thread.join();
+   }
+}
+
+void
+context::completion_loop(std::shared_ptr<completion_worker> w) {
+   std::unique_lock<std::mutex> lock(w->mutex);
+
+   while (!w->stop) {
+      if (w->pending.empty()) {
+         w->cv.wait(lock);
+         continue;
+      }
+
+      std::list<completion_worker::entry> pending;
+      intrusive_ptr<hard_event> fenced;
+      bool progress = false;
+
+      pending.swap(w->pending);
+      lock.unlock();
+
+      for (auto it = pending.begin(); it != pending.end();) {
+         event &ev = it->first;
+         const cl_int status = ev.status();
+
+         if (status == CL_COMPLETE || status < 0) {
+            it->second(ev);
+            it = pending.erase(it);
+            progress = true;
+         } else {
+            auto hev = dynamic_cast<hard_event *>(&ev);
+
+            if (!fenced && hev && hev->fence())
+               fenced = hev;
+            ++it;
+         }
+      }
+
+      if (!progress && fenced)
+         fenced->wait_fence(fence_timeout);
+
+      lock.lock();
+      w->pending.splice(w->pending.begin(), pending);
+
+      if (!progress && !fenced && !w->stop)
+         w->cv.wait_for(lock, poll_interval);
+   }
+}
+
+void
+context::notify_completion(event &ev,
+                           const std::function<void (event &)> &action) {
+   std::lock_guard<std::mutex> create_lock(completion_mutex);
+
+   // Start the thread the first time it's needed.
+   if (!completion) {
+      completion = std::make_shared<completion_worker>();
+      completion->thread = std::thread(completion_loop, completion);
+   }
+
+   std::lock_guard<std::mutex> lock(completion->mutex);
+   completion->pending.emplace_back(ev, action);
+   completion->cv.notify_all();
+}
+
+void
+context::poll_completion() {
+   std::lock_guard<std::mutex> create_lock(completion_mutex);
+
+   if (completion)
+      completion->cv.notify_all();
+}
+
 bool
 context::operator==(const context &ctx) const {
    return this == &ctx;
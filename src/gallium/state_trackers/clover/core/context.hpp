@@ -23,11 +23,16 @@
 #ifndef CLOVER_CORE_CONTEXT_HPP
 #define CLOVER_CORE_CONTEXT_HPP
 
+#include <memory>
+#include <mutex>
+
 #include "core/object.hpp"
 #include "core/device.hpp"
 #include "core/property.hpp"
 
 namespace clover {
+   class event;
+
    class context : public ref_counter, public _cl_context {
    private:
       typedef adaptor_range<
@@ -40,6 +45,7 @@ namespace clover {
 
       context(const property_list &props, const ref_vector<device> &devs,
               const notify_action &notify);
+      ~context();
 
       context(const context &ctx) = delete;
       context &
@@ -56,11 +62,33 @@ namespace clover {
       device_range
       devices() const;
 
+      ///
+      /// Call \a action from the context's completion thread once \a ev
+      /// has completed or failed.  The thread blocks on command fences
+      /// instead of the application having to poll the event status.
+      ///
+      void
+      notify_completion(event &ev, const std::function<void (event &)> &action);
+
+      ///
+      /// Wake up the completion thread, e.g. because a queue flush has
+      /// attached fences to pending events.
+      ///
+      void
+      poll_completion();
+
       const notify_action notify;
 
    private:
+      struct completion_worker;
+
+      static void
+      completion_loop(std::shared_ptr<completion_worker> w);
+
       property_list props;
       const std::vector<intrusive_ref<device>> devs;
+      std::mutex completion_mutex;
+      std::shared_ptr<completion_worker> completion;
    };
 }
 
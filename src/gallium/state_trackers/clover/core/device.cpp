@@ -21,9 +21,12 @@
 //
 
 #include "core/device.hpp"
+#include "core/compiler.hpp"
 #include "core/platform.hpp"
 #include "pipe/p_screen.h"
 #include "pipe/p_state.h"
+#include "util/disk_cache.h"
+#include "util/u_debug.h"
 
 using namespace clover;
 
@@ -40,16 +43,29 @@ namespace {
 }
 
 device::device(clover::platform &platform, pipe_loader_device *ldev) :
-   platform(platform), ldev(ldev) {
+   platform(platform), ldev(ldev), cache(NULL) {
    pipe = pipe_loader_create_screen(ldev);
    if (!pipe || !pipe->get_param(pipe, PIPE_CAP_COMPUTE)) {
       if (pipe)
          pipe->destroy(pipe);
       throw error(CL_INVALID_DEVICE);
    }
+
+   // Programs built from source through LLVM can be stored in the
+   // on-disk cache.  The target and the compiler identity are folded
+   // into every key.
+   if (ir_format() != PIPE_SHADER_IR_TGSI &&
+       debug_get_bool_option("CLOVER_DISK_CACHE", false)) {
+      const std::string gpu_name = "clover_" + ir_target();
+      const std::string driver_id = "clover " PACKAGE_VERSION " "
+         __DATE__ " " __TIME__ " " + compiler_id_llvm(ir_target());
+
+      cache = disk_cache_create(gpu_name.c_str(), driver_id.c_str());
+   }
 }
 
 device::~device() {
+   disk_cache_destroy(cache);
    if (pipe)
       pipe->destroy(pipe);
    if (ldev)
@@ -213,6 +229,11 @@ device::ir_target() const {
    return { target.data() };
 }
 
+struct disk_cache *
+device::binary_cache() const {
+   return cache;
+}
+
 enum pipe_endian
 device::endianness() const {
    return (enum pipe_endian)pipe->get_param(pipe, PIPE_CAP_ENDIANNESS);
@@ -30,6 +30,8 @@
 #include "core/format.hpp"
 #include "pipe-loader/pipe_loader.h"
 
+struct disk_cache;
+
 namespace clover {
    class platform;
    class root_resource;
@@ -73,6 +75,7 @@ namespace clover {
       enum pipe_shader_ir ir_format() const;
       std::string ir_target() const;
       enum pipe_endian endianness() const;
+      struct disk_cache *binary_cache() const;
 
       friend class command_queue;
       friend class root_resource;
@@ -85,6 +88,7 @@ namespace clover {
    private:
       pipe_screen *pipe;
       pipe_loader_device *ldev;
+      struct disk_cache *cache;
    };
 }
 
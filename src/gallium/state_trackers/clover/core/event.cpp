@@ -21,6 +21,7 @@
 //
 
 #include "core/event.hpp"
+#include "core/trace.hpp"
 #include "pipe/p_screen.h"
 
 using namespace clover;
@@ -119,7 +120,7 @@ hard_event::hard_event(command_queue &q, cl_command_type command,
                        const ref_vector<event> &deps, action action) :
    event(q.context(), deps, profile(q, action), [](event &ev){}),
    _queue(q), _command(command), _fence(NULL) {
-   if (q.profiling_enabled())
+   if (q.profiling_enabled() || trace::enabled())
       _time_queued = timestamp::current(q);
 
    q.sequence(*this);
@@ -172,6 +173,13 @@ hard_event::wait() const {
       throw error(CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST);
 }
 
+bool
+hard_event::wait_fence(uint64_t timeout) const {
+   pipe_screen *screen = queue()->device().pipe;
+
+   return _fence && screen->fence_finish(screen, _fence, timeout);
+}
+
 const lazy<cl_ulong> &
 hard_event::time_queued() const {
    return _time_queued;
@@ -200,7 +208,7 @@ hard_event::fence(pipe_fence_handle *fence) {
 
 event::action
 hard_event::profile(command_queue &q, const action &action) const {
-   if (q.profiling_enabled()) {
+   if (q.profiling_enabled() || trace::enabled()) {
       return [&q, action] (event &ev) {
          auto &hev = static_cast<hard_event &>(ev);
 
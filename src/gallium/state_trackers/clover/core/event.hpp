@@ -100,9 +100,10 @@ namespace clover {
    ///
    /// Similar to a normal clover::event.  In addition it's associated
    /// with a given command queue \a q and a given OpenCL \a command.
-   /// hard_event instances created for the same queue are implicitly
-   /// ordered with respect to each other, and they are implicitly
-   /// triggered on construction.
+   /// hard_event instances created for the same in-order queue are
+   /// implicitly ordered with respect to each other, and they are
+   /// implicitly triggered on construction.  On out-of-order queues
+   /// only markers and barriers impose an implicit ordering.
    ///
    /// A hard_event is considered complete when the associated
    /// hardware task finishes execution.
@@ -119,6 +120,11 @@ namespace clover {
       virtual cl_command_type command() const;
       virtual void wait() const;
 
+      /// Wait up to \a timeout nanoseconds for the command to finish
+      /// executing, without flushing the queue.  Returns false if the
+      /// command hasn't been submitted yet or is still running.
+      bool wait_fence(uint64_t timeout) const;
+
       const lazy<cl_ulong> &time_queued() const;
       const lazy<cl_ulong> &time_submit() const;
       const lazy<cl_ulong> &time_start() const;
@@ -26,6 +26,8 @@
 #include "util/u_math.h"
 #include "pipe/p_context.h"
 
+#include <algorithm>
+
 using namespace clover;
 
 kernel::kernel(clover::program &prog, const std::string &name,
@@ -38,6 +40,9 @@ kernel::kernel(clover::program &prog, const std::string &name,
    }
 }
 
+// Maximum number of compute states kept around per kernel.
+static const unsigned max_compute_states = 8;
+
 template<typename V>
 static inline std::vector<uint>
 pad_vector(command_queue &q, const V &v, uint x) {
@@ -51,7 +56,7 @@ kernel::launch(command_queue &q,
                const std::vector<size_t> &grid_offset,
                const std::vector<size_t> &grid_size,
                const std::vector<size_t> &block_size) {
-   const auto m = program().binary(q.device());
+   const auto &m = program().binary(q.device());
    const auto reduced_grid_size =
       map(divides(), grid_size, block_size);
    void *st = exec.bind(&q, grid_offset);
@@ -63,17 +68,22 @@ kernel::launch(command_queue &q,
          return (uint32_t *)&exec.input[h];
       }, exec.g_handles);
 
+   // Every launch unbinds what it bound, so there is nothing to do for
+   // kinds of objects the kernel doesn't use.
    q.pipe->bind_compute_state(q.pipe, st);
-   q.pipe->bind_sampler_states(q.pipe, PIPE_SHADER_COMPUTE,
-                               0, exec.samplers.size(),
-                               exec.samplers.data());
-
-   q.pipe->set_sampler_views(q.pipe, PIPE_SHADER_COMPUTE, 0,
-                             exec.sviews.size(), exec.sviews.data());
-   q.pipe->set_compute_resources(q.pipe, 0, exec.resources.size(),
-                                 exec.resources.data());
-   q.pipe->set_global_binding(q.pipe, 0, exec.g_buffers.size(),
-                              exec.g_buffers.data(), g_handles.data());
+   if (!exec.samplers.empty())
+      q.pipe->bind_sampler_states(q.pipe, PIPE_SHADER_COMPUTE,
+                                  0, exec.samplers.size(),
+                                  exec.samplers.data());
+   if (!exec.sviews.empty())
+      q.pipe->set_sampler_views(q.pipe, PIPE_SHADER_COMPUTE, 0,
+                                exec.sviews.size(), exec.sviews.data());
+   if (!exec.resources.empty())
+      q.pipe->set_compute_resources(q.pipe, 0, exec.resources.size(),
+                                    exec.resources.data());
+   if (!exec.g_buffers.empty())
+      q.pipe->set_global_binding(q.pipe, 0, exec.g_buffers.size(),
+                                 exec.g_buffers.data(), g_handles.data());
 
    // Fill information for the launch_grid() call.
    copy(pad_vector(q, block_size, 1), info.block);
@@ -83,12 +93,17 @@ kernel::launch(command_queue &q,
 
    q.pipe->launch_grid(q.pipe, &info);
 
-   q.pipe->set_global_binding(q.pipe, 0, exec.g_buffers.size(), NULL, NULL);
-   q.pipe->set_compute_resources(q.pipe, 0, exec.resources.size(), NULL);
-   q.pipe->set_sampler_views(q.pipe, PIPE_SHADER_COMPUTE, 0,
-                             exec.sviews.size(), NULL);
-   q.pipe->bind_sampler_states(q.pipe, PIPE_SHADER_COMPUTE, 0,
-                               exec.samplers.size(), NULL);
+   if (!exec.g_buffers.empty())
+      q.pipe->set_global_binding(q.pipe, 0, exec.g_buffers.size(),
+                                 NULL, NULL);
+   if (!exec.resources.empty())
+      q.pipe->set_compute_resources(q.pipe, 0, exec.resources.size(), NULL);
+   if (!exec.sviews.empty())
+      q.pipe->set_sampler_views(q.pipe, PIPE_SHADER_COMPUTE, 0,
+                                exec.sviews.size(), NULL);
+   if (!exec.samplers.empty())
+      q.pipe->bind_sampler_states(q.pipe, PIPE_SHADER_COMPUTE, 0,
+                                  exec.samplers.size(), NULL);
    exec.unbind();
 }
 
@@ -142,13 +157,84 @@ kernel::module(const command_queue &q) const {
    return program().binary(q.device());
 }
 
+namespace {
+   ///
+   /// Pad buffer \a v to the next multiple of \a n.
+   ///
+   template<typename T>
+   void
+   align(T &v, size_t n) {
+      v.resize(util_align_npot(v.size(), n));
+   }
+
+   ///
+   /// Append the \a size bytes at \a x to buffer \a v, resized to \a n
+   /// bytes using sign or zero extension according to \a ext and
+   /// transformed from the native byte order into the byte order
+   /// specified by \a e.
+   ///
+   template<typename T>
+   void
+   append(T &v, const void *x, size_t size,
+          enum module::argument::ext_type ext, size_t n, pipe_endian e) {
+      const uint8_t *p = (const uint8_t *)x;
+      const size_t pos = v.size();
+      const size_t m = std::min(size, n);
+      const bool sign_ext = (ext == module::argument::sign_ext);
+      const bool msb = (PIPE_ENDIAN_NATIVE == PIPE_ENDIAN_LITTLE ?
+                        p[size - 1] : p[0]) & 0x80;
+
+      v.resize(pos + n, (sign_ext && msb ? ~0 : 0));
+
+      if (PIPE_ENDIAN_NATIVE == PIPE_ENDIAN_LITTLE)
+         std::copy_n(p, m, v.begin() + pos);
+      else
+         std::copy_n(p + size - m, m, v.end() - m);
+
+      if (PIPE_ENDIAN_NATIVE != e)
+         std::reverse(v.begin() + pos, v.end());
+   }
+
+   ///
+   /// Append object \a x to buffer \a v, zero-extended to \a n bytes.
+   ///
+   template<typename T, typename X>
+   void
+   append(T &v, const X &x, size_t n, pipe_endian e) {
+      append(v, &x, sizeof(x), module::argument::zero_ext, n, e);
+   }
+
+   ///
+   /// Append \a n elements to the end of buffer \a v.
+   ///
+   template<typename T>
+   size_t
+   allocate(T &v, size_t n) {
+      size_t pos = v.size();
+      v.resize(pos + n);
+      return pos;
+   }
+
+   ///
+   /// Append the implicit argument \a x described by \a marg to the
+   /// input buffer of \a ctx.
+   ///
+   template<typename C>
+   void
+   append_implicit(C &ctx, const module::argument &marg, cl_uint x) {
+      align(ctx.input, marg.target_align);
+      append(ctx.input, &x, sizeof(x), marg.ext_type, marg.target_size,
+             ctx.q->device().endianness());
+   }
+}
+
 kernel::exec_context::exec_context(kernel &kern) :
-   kern(kern), q(NULL), mem_local(0), st(NULL), cs() {
+   kern(kern), q(NULL), mem_local(0) {
 }
 
 kernel::exec_context::~exec_context() {
-   if (st)
-      q->pipe->delete_compute_state(q->pipe, st);
+   for (auto &s : states)
+      s.q->pipe->delete_compute_state(s.q->pipe, s.st);
 }
 
 void *
@@ -170,65 +256,62 @@ kernel::exec_context::bind(intrusive_ptr<command_queue> _q,
 
       case module::argument::grid_dimension: {
          const cl_uint dimension = grid_offset.size();
-         auto arg = argument::create(marg);
 
-         arg->set(sizeof(dimension), &dimension);
-         arg->bind(*this, marg);
+         append_implicit(*this, marg, dimension);
          break;
       }
       case module::argument::grid_offset: {
-         for (cl_uint x : pad_vector(*q, grid_offset, 1)) {
-            auto arg = argument::create(marg);
-
-            arg->set(sizeof(x), &x);
-            arg->bind(*this, marg);
-         }
+         for (cl_uint x : pad_vector(*q, grid_offset, 1))
+            append_implicit(*this, marg, x);
          break;
       }
       case module::argument::image_size: {
          auto img = dynamic_cast<image_argument &>(**(explicit_arg - 1)).get();
-         std::vector<cl_uint> image_size{
-               static_cast<cl_uint>(img->width()),
-               static_cast<cl_uint>(img->height()),
-               static_cast<cl_uint>(img->depth())};
-         for (auto x : image_size) {
-            auto arg = argument::create(marg);
-
-            arg->set(sizeof(x), &x);
-            arg->bind(*this, marg);
-         }
+
+         append_implicit(*this, marg, img->width());
+         append_implicit(*this, marg, img->height());
+         append_implicit(*this, marg, img->depth());
          break;
       }
       case module::argument::image_format: {
          auto img = dynamic_cast<image_argument &>(**(explicit_arg - 1)).get();
          cl_image_format fmt = img->format();
-         std::vector<cl_uint> image_format{
-               static_cast<cl_uint>(fmt.image_channel_data_type),
-               static_cast<cl_uint>(fmt.image_channel_order)};
-         for (auto x : image_format) {
-            auto arg = argument::create(marg);
-
-            arg->set(sizeof(x), &x);
-            arg->bind(*this, marg);
-         }
+
+         append_implicit(*this, marg, fmt.image_channel_data_type);
+         append_implicit(*this, marg, fmt.image_channel_order);
          break;
       }
       }
    }
 
-   // Create a new compute state if anything changed.
-   if (!st || q != _q ||
-       cs.req_local_mem != mem_local ||
-       cs.req_input_mem != input.size()) {
-      if (st)
-         _q->pipe->delete_compute_state(_q->pipe, st);
-
-      cs.prog = &(msec.data[0]);
-      cs.req_local_mem = mem_local;
-      cs.req_input_mem = input.size();
-      st = q->pipe->create_compute_state(q->pipe, &cs);
+   // Look for a compute state created for the same queue and memory
+   // requirements, so alternating between queues or argument sizes
+   // doesn't recreate it every time.
+   auto it = std::find_if(states.begin(), states.end(),
+                          [&](const compute_state &s) {
+                             return s.q == q &&
+                                s.req_local_mem == mem_local &&
+                                s.req_input_mem == input.size();
+                          });
+
+   if (it != states.end()) {
+      std::rotate(it, it + 1, states.end());
+      return states.back().st;
+   }
+
+   if (states.size() >= max_compute_states) {
+      auto &s = states.front();
+      s.q->pipe->delete_compute_state(s.q->pipe, s.st);
+      states.erase(states.begin());
    }
 
+   pipe_compute_state cs = {};
+   cs.prog = &(msec.data[0]);
+   cs.req_local_mem = mem_local;
+   cs.req_input_mem = input.size();
+
+   void *st = q->pipe->create_compute_state(q->pipe, &cs);
+   states.push_back({ q, mem_local, input.size(), st });
    return st;
 }
 
@@ -246,82 +329,6 @@ kernel::exec_context::unbind() {
    mem_local = 0;
 }
 
-namespace {
-   template<typename T>
-   std::vector<uint8_t>
-   bytes(const T& x) {
-      return { (uint8_t *)&x, (uint8_t *)&x + sizeof(x) };
-   }
-
-   ///
-   /// Transform buffer \a v from the native byte order into the byte
-   /// order specified by \a e.
-   ///
-   template<typename T>
-   void
-   byteswap(T &v, pipe_endian e) {
-      if (PIPE_ENDIAN_NATIVE != e)
-         std::reverse(v.begin(), v.end());
-   }
-
-   ///
-   /// Pad buffer \a v to the next multiple of \a n.
-   ///
-   template<typename T>
-   void
-   align(T &v, size_t n) {
-      v.resize(util_align_npot(v.size(), n));
-   }
-
-   bool
-   msb(const std::vector<uint8_t> &s) {
-      if (PIPE_ENDIAN_NATIVE == PIPE_ENDIAN_LITTLE)
-         return s.back() & 0x80;
-      else
-         return s.front() & 0x80;
-   }
-
-   ///
-   /// Resize buffer \a v to size \a n using sign or zero extension
-   /// according to \a ext.
-   ///
-   template<typename T>
-   void
-   extend(T &v, enum module::argument::ext_type ext, size_t n) {
-      const size_t m = std::min(v.size(), n);
-      const bool sign_ext = (ext == module::argument::sign_ext);
-      const uint8_t fill = (sign_ext && msb(v) ? ~0 : 0);
-      T w(n, fill);
-
-      if (PIPE_ENDIAN_NATIVE == PIPE_ENDIAN_LITTLE)
-         std::copy_n(v.begin(), m, w.begin());
-      else
-         std::copy_n(v.end() - m, m, w.end() - m);
-
-      std::swap(v, w);
-   }
-
-   ///
-   /// Append buffer \a w to \a v.
-   ///
-   template<typename T>
-   void
-   insert(T &v, const T &w) {
-      v.insert(v.end(), w.begin(), w.end());
-   }
-
-   ///
-   /// Append \a n elements to the end of buffer \a v.
-   ///
-   template<typename T>
-   size_t
-   allocate(T &v, size_t n) {
-      size_t pos = v.size();
-      v.resize(pos + n);
-      return pos;
-   }
-}
-
 std::unique_ptr<kernel::argument>
 kernel::argument::create(const module::argument &marg) {
    switch (marg.type) {
@@ -376,19 +383,16 @@ kernel::scalar_argument::set(size_t size, const void *value) {
    if (size != this->size)
       throw error(CL_INVALID_ARG_SIZE);
 
-   v = { (uint8_t *)value, (uint8_t *)value + size };
+   v.assign((uint8_t *)value, (uint8_t *)value + size);
    _set = true;
 }
 
 void
 kernel::scalar_argument::bind(exec_context &ctx,
                               const module::argument &marg) {
-   auto w = v;
-
-   extend(w, marg.ext_type, marg.target_size);
-   byteswap(w, ctx.q->device().endianness());
    align(ctx.input, marg.target_align);
-   insert(ctx.input, w);
+   append(ctx.input, v.data(), v.size(), marg.ext_type, marg.target_size,
+          ctx.q->device().endianness());
 }
 
 void
@@ -417,10 +421,8 @@ kernel::global_argument::bind(exec_context &ctx,
       // How to handle multi-demensional offsets?
       // We don't need to.  Buffer offsets are always
       // one-dimensional.
-      auto v = bytes(r.offset[0]);
-      extend(v, marg.ext_type, marg.target_size);
-      byteswap(v, ctx.q->device().endianness());
-      insert(ctx.input, v);
+      append(ctx.input, &r.offset[0], sizeof(r.offset[0]), marg.ext_type,
+             marg.target_size, ctx.q->device().endianness());
    } else {
       // Null pointer.
       allocate(ctx.input, marg.target_size);
@@ -451,12 +453,9 @@ kernel::local_argument::set(size_t size, const void *value) {
 void
 kernel::local_argument::bind(exec_context &ctx,
                              const module::argument &marg) {
-   auto v = bytes(ctx.mem_local);
-
-   extend(v, module::argument::zero_ext, marg.target_size);
-   byteswap(v, ctx.q->device().endianness());
    align(ctx.input, marg.target_align);
-   insert(ctx.input, v);
+   append(ctx.input, ctx.mem_local, marg.target_size,
+          ctx.q->device().endianness());
 
    ctx.mem_local += _storage;
 }
@@ -481,11 +480,8 @@ kernel::constant_argument::bind(exec_context &ctx,
 
    if (buf) {
       resource &r = buf->resource(*ctx.q);
-      auto v = bytes(ctx.resources.size() << 24 | r.offset[0]);
-
-      extend(v, module::argument::zero_ext, marg.target_size);
-      byteswap(v, ctx.q->device().endianness());
-      insert(ctx.input, v);
+      append(ctx.input, ctx.resources.size() << 24 | r.offset[0],
+             marg.target_size, ctx.q->device().endianness());
 
       st = r.bind_surface(*ctx.q, false);
       ctx.resources.push_back(st);
@@ -516,12 +512,9 @@ kernel::image_rd_argument::set(size_t size, const void *value) {
 void
 kernel::image_rd_argument::bind(exec_context &ctx,
                                 const module::argument &marg) {
-   auto v = bytes(ctx.sviews.size());
-
-   extend(v, module::argument::zero_ext, marg.target_size);
-   byteswap(v, ctx.q->device().endianness());
    align(ctx.input, marg.target_align);
-   insert(ctx.input, v);
+   append(ctx.input, ctx.sviews.size(), marg.target_size,
+          ctx.q->device().endianness());
 
    st = img->resource(*ctx.q).bind_sampler_view(*ctx.q);
    ctx.sviews.push_back(st);
@@ -547,12 +540,9 @@ kernel::image_wr_argument::set(size_t size, const void *value) {
 void
 kernel::image_wr_argument::bind(exec_context &ctx,
                                 const module::argument &marg) {
-   auto v = bytes(ctx.resources.size());
-
-   extend(v, module::argument::zero_ext, marg.target_size);
-   byteswap(v, ctx.q->device().endianness());
    align(ctx.input, marg.target_align);
-   insert(ctx.input, v);
+   append(ctx.input, ctx.resources.size(), marg.target_size,
+          ctx.q->device().endianness());
 
    st = img->resource(*ctx.q).bind_surface(*ctx.q, true);
    ctx.resources.push_back(st);
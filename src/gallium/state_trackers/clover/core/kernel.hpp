@@ -62,8 +62,16 @@ namespace clover {
          size_t mem_local;
 
       private:
-         void *st;
-         pipe_compute_state cs;
+         struct compute_state {
+            intrusive_ptr<command_queue> q;
+            size_t req_local_mem;
+            size_t req_input_mem;
+            void *st;
+         };
+
+         /// Compute states created by previous launches, most recently
+         /// used last.
+         std::vector<compute_state> states;
       };
 
    public:
@@ -83,19 +83,22 @@ root_buffer::root_buffer(clover::context &ctx, cl_mem_flags flags,
 
 resource &
 root_buffer::resource(command_queue &q) {
+   auto it = resources.find(&q.device());
+
    // Create a new resource if there's none for this device yet.
-   if (!resources.count(&q.device())) {
+   if (it == resources.end()) {
       auto r = (!resources.empty() ?
                 new root_resource(q.device(), *this,
                                   *resources.begin()->second) :
                 new root_resource(q.device(), *this, q, data));
 
-      resources.insert(std::make_pair(&q.device(),
-                                      std::unique_ptr<root_resource>(r)));
+      it = resources.insert(std::make_pair(
+                               &q.device(),
+                               std::unique_ptr<root_resource>(r))).first;
       data.clear();
    }
 
-   return *resources.find(&q.device())->second;
+   return *it->second;
 }
 
 sub_buffer::sub_buffer(root_buffer &parent, cl_mem_flags flags,
@@ -107,15 +110,18 @@ sub_buffer::sub_buffer(root_buffer &parent, cl_mem_flags flags,
 
 resource &
 sub_buffer::resource(command_queue &q) {
+   auto it = resources.find(&q.device());
+
    // Create a new resource if there's none for this device yet.
-   if (!resources.count(&q.device())) {
+   if (it == resources.end()) {
       auto r = new sub_resource(parent().resource(q), {{ offset() }});
 
-      resources.insert(std::make_pair(&q.device(),
-                                      std::unique_ptr<sub_resource>(r)));
+      it = resources.insert(std::make_pair(
+                               &q.device(),
+                               std::unique_ptr<sub_resource>(r))).first;
    }
 
-   return *resources.find(&q.device())->second;
+   return *it->second;
 }
 
 size_t
@@ -135,19 +141,22 @@ image::image(clover::context &ctx, cl_mem_flags flags,
 
 resource &
 image::resource(command_queue &q) {
+   auto it = resources.find(&q.device());
+
    // Create a new resource if there's none for this device yet.
-   if (!resources.count(&q.device())) {
+   if (it == resources.end()) {
       auto r = (!resources.empty() ?
                 new root_resource(q.device(), *this,
                                   *resources.begin()->second) :
                 new root_resource(q.device(), *this, q, data));
 
-      resources.insert(std::make_pair(&q.device(),
-                                      std::unique_ptr<root_resource>(r)));
+      it = resources.insert(std::make_pair(
+                               &q.device(),
+                               std::unique_ptr<root_resource>(r))).first;
       data.clear();
    }
 
-   return *resources.find(&q.device())->second;
+   return *it->second;
 }
 
 cl_image_format
@@ -21,9 +21,95 @@
 //
 
 #include "core/program.hpp"
+#include "util/disk_cache.h"
+
+#include <exception>
+#include <sstream>
+#include <memory>
+#include <thread>
 
 using namespace clover;
 
+namespace {
+   void
+   append_key(std::string &key, const std::string &s) {
+      key += std::to_string(s.size()) + ":" + s;
+   }
+
+   ///
+   /// Compile \a source for \a dev, reusing the result of an identical
+   /// earlier build if the device has an on-disk binary cache.  The
+   /// build log is cached along with the module.
+   ///
+   module
+   compile_program(const device &dev, const std::string &source,
+                   const header_map &headers, const std::string &opts,
+                   std::string &log) {
+      struct disk_cache *cache = dev.binary_cache();
+      std::string key_data;
+      cache_key key;
+
+      if (dev.ir_format() == PIPE_SHADER_IR_TGSI)
+         return compile_program_tgsi(source, log);
+
+      if (cache) {
+         append_key(key_data, std::to_string(dev.ir_format()));
+         append_key(key_data, opts);
+         append_key(key_data, source);
+         for (auto &h : headers) {
+            append_key(key_data, h.first);
+            append_key(key_data, h.second);
+         }
+
+         disk_cache_compute_key(cache, key_data.data(), key_data.size(),
+                                key);
+
+         size_t size;
+         char *data = (char *)disk_cache_get(cache, key, &size);
+
+         if (data) {
+            std::istringstream is(std::string(data, size));
+            free(data);
+
+            try {
+               is.exceptions(std::ios::failbit | std::ios::badbit);
+               uint32_t log_size;
+               is.read(reinterpret_cast<char *>(&log_size), sizeof(log_size));
+               std::string cached_log(log_size, '\0');
+               is.read(&cached_log[0], log_size);
+               module m = module::deserialize(is);
+
+               if (is.tellg() == (std::streampos)size) {
+                  log = cached_log;
+                  return m;
+               }
+            } catch (const std::exception &) {
+            }
+
+            // Truncated or otherwise corrupt entry, rebuild it.
+            disk_cache_remove(cache, key);
+         }
+      }
+
+      module m = compile_program_llvm(source, headers, dev.ir_format(),
+                                      dev.ir_target(), opts, log);
+
+      if (cache) {
+         std::ostringstream os;
+         uint32_t log_size = log.size();
+
+         os.write(reinterpret_cast<const char *>(&log_size), sizeof(log_size));
+         os.write(log.data(), log_size);
+         m.serialize(os);
+
+         const std::string blob = os.str();
+         disk_cache_put(cache, key, blob.data(), blob.size());
+      }
+
+      return m;
+   }
+}
+
 program::program(clover::context &ctx, const std::string &source) :
    has_source(true), context(ctx), _source(source), _kernel_ref_counter(0) {
 }
@@ -43,6 +129,12 @@ void
 program::build(const ref_vector<device> &devs, const char *opts,
                const header_map &headers) {
    if (has_source) {
+      const std::string build_opts = opts;
+      std::vector<std::unique_ptr<module>> modules(devs.size());
+      std::vector<std::string> logs(devs.size());
+      std::vector<std::exception_ptr> errors(devs.size());
+      std::vector<std::thread> threads;
+
       _devices = devs;
 
       for (auto &dev : devs) {
@@ -50,23 +142,39 @@ program::build(const ref_vector<device> &devs, const char *opts,
          _logs.erase(&dev);
          _opts.erase(&dev);
 
-         _opts.insert({ &dev, opts });
-
-         std::string log;
+         _opts.insert({ &dev, build_opts });
+      }
 
+      // Build for every device, concurrently if there are several of
+      // them.  Each build has its own LLVM context.
+      auto build_one = [&](unsigned i) {
          try {
-            auto module = (dev.ir_format() == PIPE_SHADER_IR_TGSI ?
-                           compile_program_tgsi(_source, log) :
-                           compile_program_llvm(_source, headers,
-                                                dev.ir_format(),
-                                                dev.ir_target(), build_opts(dev),
-                                                log));
-            _binaries.insert({ &dev, module });
-            _logs.insert({ &dev, log });
-         } catch (const error &) {
-            _logs.insert({ &dev, log });
-            throw;
+            modules[i].reset(new module(
+               compile_program(devs[i], _source, headers,
+                               build_opts, logs[i])));
+         } catch (...) {
+            errors[i] = std::current_exception();
          }
+      };
+
+      if (devs.size() > 1) {
+         for (unsigned i = 0; i < devs.size(); ++i)
+            threads.emplace_back(build_one, i);
+         for (auto &t : threads)
+            t.join();
+      } else if (devs.size()) {
+         build_one(0);
+      }
+
+      for (unsigned i = 0; i < devs.size(); ++i) {
+         if (modules[i])
+            _binaries.insert({ &devs[i], *modules[i] });
+         _logs.insert({ &devs[i], logs[i] });
+      }
+
+      for (auto &e : errors) {
+         if (e)
+            std::rethrow_exception(e);
       }
    }
 }
@@ -22,6 +22,7 @@
 
 #include "core/queue.hpp"
 #include "core/event.hpp"
+#include "core/trace.hpp"
 #include "pipe/p_screen.h"
 #include "pipe/p_context.h"
 #include "pipe/p_state.h"
@@ -69,14 +70,32 @@ command_queue::flush() {
    if (!queued_events.empty()) {
       pipe->flush(pipe, &fence, 0);
 
-      while (!queued_events.empty() &&
-             queued_events.front()().signalled()) {
-         queued_events.front()().fence(fence);
-         queued_events.pop_front();
+      // Events of an out-of-order queue may be signalled in any
+      // order, so look past the ones still waiting for dependencies.
+      for (auto it = queued_events.begin(); it != queued_events.end();) {
+         if ((*it)().signalled()) {
+            (*it)().fence(fence);
+            if (trace::enabled())
+               traced_events.push_back(*it);
+            it = queued_events.erase(it);
+         } else if (out_of_order()) {
+            ++it;
+         } else {
+            break;
+         }
       }
 
       screen->fence_reference(screen, &fence, NULL);
    }
+
+   if (last_barrier && last_barrier->signalled())
+      last_barrier = NULL;
+
+   trace_completed(0);
+
+   // Pending events may have fences now, which the completion thread
+   // can block on.
+   context().poll_completion();
 }
 
 cl_command_queue_properties
@@ -89,11 +108,70 @@ command_queue::profiling_enabled() const {
    return props & CL_QUEUE_PROFILING_ENABLE;
 }
 
+void
+command_queue::finish_trace() {
+   std::lock_guard<std::mutex> lock(queued_events_mutex);
+   trace_completed(PIPE_TIMEOUT_INFINITE);
+}
+
+bool
+command_queue::out_of_order() const {
+   return props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+}
+
 void
 command_queue::sequence(hard_event &ev) {
    std::lock_guard<std::mutex> lock(queued_events_mutex);
-   if (!queued_events.empty())
-      queued_events.back()().chain(ev);
+
+   if (!out_of_order()) {
+      if (!queued_events.empty())
+         queued_events.back()().chain(ev);
+
+   } else if (ev.command() == CL_COMMAND_MARKER ||
+              ev.command() == CL_COMMAND_BARRIER) {
+      // Without an explicit wait list, markers and barriers wait for
+      // every command enqueued before them.  Commands no longer in
+      // the pending list have been executed already.
+      if (ev.deps.empty()) {
+         for (hard_event &qev : queued_events)
+            qev.chain(ev);
+      }
+
+      if (last_barrier)
+         last_barrier->chain(ev);
+
+      if (ev.command() == CL_COMMAND_BARRIER)
+         last_barrier = &ev;
+
+   } else if (last_barrier) {
+      last_barrier->chain(ev);
+   }
 
    queued_events.push_back(ev);
 }
+
+void
+command_queue::trace_completed(uint64_t timeout) {
+   for (auto it = traced_events.begin(); it != traced_events.end();) {
+      hard_event &ev = *it;
+
+      if (ev.wait_fence(timeout) || ev.status() < 0) {
+         if (ev.status() == CL_COMPLETE) {
+            std::vector<const void *> deps;
+
+            for (event &dep : ev.deps)
+               deps.push_back(&dep);
+
+            trace::command(*this, &ev, ev.command(), deps,
+                           ev.time_queued(), ev.time_submit(),
+                           ev.time_start(), ev.time_end());
+         }
+
+         it = traced_events.erase(it);
+      } else if (out_of_order()) {
+         ++it;
+      } else {
+         break;
+      }
+   }
+}
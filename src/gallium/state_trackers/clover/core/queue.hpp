@@ -48,8 +48,13 @@ namespace clover {
 
       void flush();
 
+      /// Wait for the commands submitted so far to finish and write
+      /// them to the command trace, if enabled.
+      void finish_trace();
+
       cl_command_queue_properties properties() const;
       bool profiling_enabled() const;
+      bool out_of_order() const;
 
       const intrusive_ref<clover::context> context;
       const intrusive_ref<clover::device> device;
@@ -65,13 +70,21 @@ namespace clover {
 
    private:
       /// Serialize a hardware event with respect to the previous ones,
-      /// and push it to the pending list.
+      /// and push it to the pending list.  Out-of-order queues only
+      /// order events with respect to markers and barriers.
       void sequence(hard_event &ev);
 
+      /// Write the submitted commands that have finished executing to
+      /// the command trace.  Must be called with queued_events_mutex
+      /// held.
+      void trace_completed(uint64_t timeout);
+
       cl_command_queue_properties props;
       pipe_context *pipe;
       std::mutex queued_events_mutex;
       std::deque<intrusive_ref<hard_event>> queued_events;
+      intrusive_ptr<hard_event> last_barrier;
+      std::deque<intrusive_ref<hard_event>> traced_events;
    };
 }
 
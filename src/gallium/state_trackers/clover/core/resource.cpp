@@ -25,6 +25,10 @@
 #include "pipe/p_screen.h"
 #include "util/u_sampler.h"
 #include "util/u_format.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#include <unistd.h>
 
 using namespace clover;
 
@@ -63,18 +67,30 @@ resource::copy(command_queue &q, const vector &origin, const vector &region,
                                 box(src_res.offset + src_origin, region));
 }
 
+void
+resource::write(command_queue &q, const vector &origin, const vector &region,
+                const void *data, size_t row_pitch, size_t slice_pitch) {
+   q.pipe->transfer_inline_write(q.pipe, pipe, 0, PIPE_TRANSFER_WRITE,
+                                 box(offset + origin, region), data,
+                                 row_pitch, slice_pitch);
+}
+
 void *
 resource::add_map(command_queue &q, cl_map_flags flags, bool blocking,
                   const vector &origin, const vector &region) {
-   maps.emplace_back(q, *this, flags, blocking, origin, region);
-   return maps.back();
+   mapping m { q, *this, flags, blocking, origin, region };
+   void *p = m;
+
+   maps.emplace(p, std::move(m));
+   return p;
 }
 
 void
 resource::del_map(void *p) {
-   erase_if([&](const mapping &m) {
-         return static_cast<void *>(m) == p;
-      }, maps);
+   auto it = maps.find(p);
+
+   if (it != maps.end())
+      maps.erase(it);
 }
 
 unsigned
@@ -116,7 +132,7 @@ resource::unbind_surface(command_queue &q, pipe_surface *st) {
 
 root_resource::root_resource(clover::device &dev, memory_obj &obj,
                              command_queue &q, const std::string &data) :
-   resource(dev, obj) {
+   resource(dev, obj), user_storage(NULL) {
    pipe_resource info {};
    const bool user_ptr_support = dev.pipe->get_param(dev.pipe,
          PIPE_CAP_RESOURCE_FROM_USER_MEMORY);
@@ -140,12 +156,47 @@ root_resource::root_resource(clover::device &dev, memory_obj &obj,
                 PIPE_BIND_TRANSFER_READ |
                 PIPE_BIND_TRANSFER_WRITE);
 
-   if (obj.flags() & CL_MEM_USE_HOST_PTR && user_ptr_support) {
-      // Page alignment is normally required for this, just try, hope for the
-      // best and fall back if it fails.
-      pipe = dev.pipe->resource_from_user_memory(dev.pipe, &info, obj.host_ptr());
-      if (pipe)
-         return;
+   if (info.target == PIPE_BUFFER && user_ptr_support &&
+       obj.flags() & (CL_MEM_USE_HOST_PTR | CL_MEM_ALLOC_HOST_PTR)) {
+      // Back the buffer directly with host memory so that the GPU
+      // accesses it in place and mapping it doesn't need a staging
+      // copy.  Drivers normally require page alignment, so wrap the
+      // whole pages spanned by the user pointer and address the
+      // buffer at an offset into them.
+      const size_t page = sysconf(_SC_PAGESIZE);
+
+      if (obj.flags() & CL_MEM_USE_HOST_PTR) {
+         const uintptr_t base = uintptr_t(obj.host_ptr()) & ~(page - 1);
+         const size_t skip = uintptr_t(obj.host_ptr()) - base;
+
+         info.width0 = align(skip + obj.size(), page);
+         pipe = dev.pipe->resource_from_user_memory(dev.pipe, &info,
+                                                    (void *)base);
+         if (pipe) {
+            offset[0] = skip;
+            return;
+         }
+
+      } else {
+         info.width0 = align(obj.size(), page);
+         user_storage = align_malloc(info.width0, page);
+
+         if (user_storage) {
+            if (obj.flags() & CL_MEM_COPY_HOST_PTR)
+               std::copy(data.begin(), data.end(), (char *)user_storage);
+
+            pipe = dev.pipe->resource_from_user_memory(dev.pipe, &info,
+                                                       user_storage);
+            if (pipe)
+               return;
+
+            align_free(user_storage);
+            user_storage = NULL;
+         }
+      }
+
+      // Fall back to a regular staging resource.
+      info.width0 = obj.size();
    }
 
    if (obj.flags() & (CL_MEM_ALLOC_HOST_PTR | CL_MEM_USE_HOST_PTR)) {
@@ -169,12 +220,13 @@ root_resource::root_resource(clover::device &dev, memory_obj &obj,
 
 root_resource::root_resource(clover::device &dev, memory_obj &obj,
                              root_resource &r) :
-   resource(dev, obj) {
+   resource(dev, obj), user_storage(NULL) {
    assert(0); // XXX -- resource shared among dev and r.dev
 }
 
 root_resource::~root_resource() {
    device().pipe->resource_destroy(device().pipe, pipe);
+   align_free(user_storage);
 }
 
 sub_resource::sub_resource(resource &r, const vector &offset) :
@@ -215,6 +267,16 @@ mapping::~mapping() {
    }
 }
 
+size_t
+mapping::row_pitch() const {
+   return pxfer->stride;
+}
+
+size_t
+mapping::slice_pitch() const {
+   return pxfer->layer_stride;
+}
+
 mapping &
 mapping::operator=(mapping m) {
    std::swap(pctx, m.pctx);
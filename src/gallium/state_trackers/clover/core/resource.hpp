@@ -23,7 +23,7 @@
 #ifndef CLOVER_CORE_RESOURCE_HPP
 #define CLOVER_CORE_RESOURCE_HPP
 
-#include <list>
+#include <unordered_map>
 
 #include "core/queue.hpp"
 #include "util/algebra.hpp"
@@ -49,6 +49,8 @@ namespace clover {
 
       void copy(command_queue &q, const vector &origin, const vector &region,
                 resource &src_resource, const vector &src_origin);
+      void write(command_queue &q, const vector &origin, const vector &region,
+                 const void *data, size_t row_pitch, size_t slice_pitch);
 
       void *add_map(command_queue &q, cl_map_flags flags, bool blocking,
                     const vector &origin, const vector &region);
@@ -76,7 +78,7 @@ namespace clover {
       vector offset;
 
    private:
-      std::list<mapping> maps;
+      std::unordered_multimap<void *, mapping> maps;
    };
 
    ///
@@ -89,6 +91,9 @@ namespace clover {
                     command_queue &q, const std::string &data);
       root_resource(clover::device &dev, memory_obj &obj, root_resource &r);
       virtual ~root_resource();
+
+   private:
+      void *user_storage;
    };
 
    ///
@@ -122,6 +127,9 @@ namespace clover {
          return (T *)p;
       }
 
+      size_t row_pitch() const;
+      size_t slice_pitch() const;
+
    private:
       pipe_context *pctx;
       pipe_transfer *pxfer;
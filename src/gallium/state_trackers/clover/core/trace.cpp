@@ -0,0 +1,169 @@
+//
+// Copyright 2016 The Mesa Project
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <unistd.h>
+
+#include "core/trace.hpp"
+#include "core/queue.hpp"
+#include "util/u_debug.h"
+
+using namespace clover;
+
+namespace {
+   const char *
+   command_name(cl_command_type type) {
+      switch (type) {
+      case CL_COMMAND_NDRANGE_KERNEL:
+         return "NDRangeKernel";
+      case CL_COMMAND_TASK:
+         return "Task";
+      case CL_COMMAND_NATIVE_KERNEL:
+         return "NativeKernel";
+      case CL_COMMAND_READ_BUFFER:
+         return "ReadBuffer";
+      case CL_COMMAND_WRITE_BUFFER:
+         return "WriteBuffer";
+      case CL_COMMAND_COPY_BUFFER:
+         return "CopyBuffer";
+      case CL_COMMAND_READ_IMAGE:
+         return "ReadImage";
+      case CL_COMMAND_WRITE_IMAGE:
+         return "WriteImage";
+      case CL_COMMAND_COPY_IMAGE:
+         return "CopyImage";
+      case CL_COMMAND_COPY_IMAGE_TO_BUFFER:
+         return "CopyImageToBuffer";
+      case CL_COMMAND_COPY_BUFFER_TO_IMAGE:
+         return "CopyBufferToImage";
+      case CL_COMMAND_MAP_BUFFER:
+         return "MapBuffer";
+      case CL_COMMAND_MAP_IMAGE:
+         return "MapImage";
+      case CL_COMMAND_UNMAP_MEM_OBJECT:
+         return "UnmapMemObject";
+      case CL_COMMAND_MARKER:
+         return "Marker";
+      case CL_COMMAND_READ_BUFFER_RECT:
+         return "ReadBufferRect";
+      case CL_COMMAND_WRITE_BUFFER_RECT:
+         return "WriteBufferRect";
+      case CL_COMMAND_COPY_BUFFER_RECT:
+         return "CopyBufferRect";
+      case CL_COMMAND_BARRIER:
+         return "Barrier";
+      case CL_COMMAND_MIGRATE_MEM_OBJECTS:
+         return "MigrateMemObjects";
+      case CL_COMMAND_FILL_BUFFER:
+         return "FillBuffer";
+      case CL_COMMAND_FILL_IMAGE:
+         return "FillImage";
+      default:
+         return "Command";
+      }
+   }
+
+   struct writer {
+      writer() : f(NULL), pid(getpid()) {
+         const char *path = debug_get_option("CLOVER_TRACE", NULL);
+
+         if (path) {
+            f = std::fopen(path, "w");
+            if (f)
+               // The trace event format allows the closing bracket of
+               // the array to be missing, so the output stays valid
+               // however the application terminates.
+               std::fputs("[\n", f);
+         }
+      }
+
+      ~writer() {
+         if (f)
+            std::fclose(f);
+      }
+
+      unsigned
+      queue_id(const command_queue &q) {
+         auto it = queues.find(&q);
+
+         if (it == queues.end()) {
+            it = queues.insert({ &q, queues.size() + 1 }).first;
+            std::fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\","
+                         "\"pid\":%d,\"tid\":%u,\"args\":{\"name\":"
+                         "\"Queue %u (%s)\"}},\n", pid, it->second,
+                         it->second, q.device().device_name().c_str());
+         }
+
+         return it->second;
+      }
+
+      std::FILE *f;
+      int pid;
+      std::mutex mutex;
+      std::map<const command_queue *, unsigned> queues;
+   };
+
+   writer &
+   get_writer() {
+      static writer w;
+      return w;
+   }
+
+   double
+   usecs(cl_ulong ns) {
+      return ns / 1000.0;
+   }
+}
+
+bool
+trace::enabled() {
+   return get_writer().f;
+}
+
+void
+trace::command(const command_queue &q, const void *ev,
+               cl_command_type type, const std::vector<const void *> &deps,
+               cl_ulong queued, cl_ulong submit,
+               cl_ulong start, cl_ulong end) {
+   writer &w = get_writer();
+   std::lock_guard<std::mutex> lock(w.mutex);
+
+   if (!w.f)
+      return;
+
+   const unsigned tid = w.queue_id(q);
+
+   std::fprintf(w.f, "{\"name\":\"%s\",\"cat\":\"clover\",\"ph\":\"X\","
+                "\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                "\"args\":{\"event\":\"%p\",\"queued\":%.3f,"
+                "\"submit\":%.3f,\"deps\":[",
+                command_name(type), w.pid, tid, usecs(start),
+                usecs(end > start ? end - start : 0), ev,
+                usecs(queued), usecs(submit));
+
+   for (size_t i = 0; i < deps.size(); ++i)
+      std::fprintf(w.f, "%s\"%p\"", i ? "," : "", deps[i]);
+
+   std::fputs("]}},\n", w.f);
+}
@@ -0,0 +1,54 @@
+//
+// Copyright 2016 The Mesa Project
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef CLOVER_CORE_TRACE_HPP
+#define CLOVER_CORE_TRACE_HPP
+
+#include <vector>
+
+#include "core/object.hpp"
+
+namespace clover {
+   ///
+   /// Writer of a timeline of the commands executed by every command
+   /// queue, in the Chrome trace event format.  Enabled by pointing
+   /// the CLOVER_TRACE environment variable to the output file.
+   ///
+   namespace trace {
+      ///
+      /// \a true if commands should be timestamped and traced.
+      ///
+      bool enabled();
+
+      ///
+      /// Record the execution of the command identified by \a ev on
+      /// queue \a q, which waited for the events \a deps.  Timestamps
+      /// are in nanoseconds, as returned by the timestamp queries.
+      ///
+      void command(const command_queue &q, const void *ev,
+                   cl_command_type type, const std::vector<const void *> &deps,
+                   cl_ulong queued, cl_ulong submit,
+                   cl_ulong start, cl_ulong end);
+   }
+}
+
+#endif
@@ -74,8 +74,10 @@
 #include <fstream>
 #include <cstdio>
 #include <sstream>
+#include <mutex>
 #include <libelf.h>
 #include <gelf.h>
+#include <sys/stat.h>
 
 using namespace clover;
 
@@ -631,10 +633,24 @@ namespace {
       }
    }
 
+   LLVMCodeGenOptLevel
+   get_codegen_opt_level(unsigned optimization_level) {
+      switch (optimization_level) {
+      case 0:
+         return LLVMCodeGenLevelNone;
+      case 1:
+         return LLVMCodeGenLevelLess;
+      case 2:
+         return LLVMCodeGenLevelDefault;
+      default:
+         return LLVMCodeGenLevelAggressive;
+      }
+   }
+
    std::vector<char>
    compile_native(const llvm::Module *mod, const std::string &triple,
-                  const std::string &processor, unsigned dump_asm,
-                  std::string &r_log) {
+                  const std::string &processor, unsigned optimization_level,
+                  unsigned dump_asm, std::string &r_log) {
 
       std::string log;
       LLVMTargetRef target;
@@ -652,7 +668,8 @@ namespace {
 
       LLVMTargetMachineRef tm = LLVMCreateTargetMachine(
             target, triple.c_str(), processor.c_str(), "",
-            LLVMCodeGenLevelDefault, LLVMRelocDefault, LLVMCodeModelDefault);
+            get_codegen_opt_level(optimization_level),
+            LLVMRelocDefault, LLVMCodeModelDefault);
 
       if (!tm) {
          r_log = "Could not create TargetMachine: " + triple;
@@ -803,14 +820,15 @@ namespace {
 
    void
    init_targets() {
-      static bool targets_initialized = false;
-      if (!targets_initialized) {
-         LLVMInitializeAllTargets();
-         LLVMInitializeAllTargetInfos();
-         LLVMInitializeAllTargetMCs();
-         LLVMInitializeAllAsmPrinters();
-         targets_initialized = true;
-      }
+      // Programs for several devices may be built concurrently.
+      static std::once_flag targets_initialized;
+
+      std::call_once(targets_initialized, []() {
+            LLVMInitializeAllTargets();
+            LLVMInitializeAllTargetInfos();
+            LLVMInitializeAllTargetMCs();
+            LLVMInitializeAllAsmPrinters();
+         });
    }
 
 #define DBG_CLC  (1 << 0)
@@ -834,6 +852,28 @@ namespace {
 
 } // End anonymous namespace
 
+std::string
+clover::compiler_id_llvm(const std::string &target) {
+   size_t processor_str_len = std::string(target).find_first_of("-");
+   std::string processor(target, 0, processor_str_len);
+   std::string triple(target, processor_str_len + 1,
+                      target.size() - processor_str_len - 1);
+   std::string libclc_path = LIBCLC_LIBEXECDIR + processor + "-"
+                                               + triple + ".bc";
+   std::ostringstream id;
+   struct stat st = {};
+
+   id << "LLVM " << (HAVE_LLVM >> 8) << "." << (HAVE_LLVM & 0xff)
+      << "." << MESA_LLVM_VERSION_PATCH;
+
+   // libclc is linked into every program, identify the installed copy
+   // by its size and modification time.
+   stat(libclc_path.c_str(), &st);
+   id << " libclc " << st.st_size << ":" << st.st_mtime;
+
+   return id.str();
+}
+
 module
 clover::compile_program_llvm(const std::string &source,
                              const header_map &headers,
@@ -886,6 +926,7 @@ clover::compile_program_llvm(const std::string &source,
          break;
       case PIPE_SHADER_IR_NATIVE: {
          std::vector<char> code = compile_native(mod, triple, processor,
+                                                 optimization_level,
                                                  get_debug_flags() & DBG_ASM,
                                                  r_log);
          m = build_module_native(code, mod, address_spaces, r_log);
@@ -39,6 +39,7 @@ struct d3dadapter9_context
     int throttling_value;
     int vblank_mode;
     BOOL thread_submit;
+    BOOL csmt;
 
     void (*destroy)( struct d3dadapter9_context *ctx );
 };
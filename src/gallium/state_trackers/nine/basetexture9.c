@@ -65,7 +65,6 @@ NineBaseTexture9_ctor( struct NineBaseTexture9 *This,
         return hr;
 
     This->format = format;
-    This->pipe = pParams->device->pipe;
     This->mipfilter = (Usage & D3DUSAGE_AUTOGENMIPMAP) ?
         D3DTEXF_LINEAR : D3DTEXF_NONE;
     This->managed.lod = 0;
@@ -98,6 +97,9 @@ NineBaseTexture9_dtor( struct NineBaseTexture9 *This )
 {
     DBG("This=%p\n", This);
 
+    /* The views are destroyed through the context. */
+    if (This->view[0] || This->view[1])
+        NineDevice9_GetPipe(This->base.base.device);
     pipe_sampler_view_reference(&This->view[0], NULL);
     pipe_sampler_view_reference(&This->view[1], NULL);
 
@@ -201,6 +203,7 @@ NineBaseTexture9_UploadSelf( struct NineBaseTexture9 *This )
 
         DBG("updating LOD from %u to %u ...\n", This->managed.lod_resident, This->managed.lod);
 
+        NineDevice9_GetPipe(This->base.base.device); /* sync, see dtor */
         pipe_sampler_view_reference(&This->view[0], NULL);
         pipe_sampler_view_reference(&This->view[1], NULL);
 
@@ -411,7 +414,7 @@ NineBaseTexture9_GenerateMipSubLevels( struct NineBaseTexture9 *This )
 
     resource = This->base.resource;
 
-    util_gen_mipmap(This->pipe, resource,
+    util_gen_mipmap(NineDevice9_GetPipe(This->base.base.device), resource,
                     resource->format, base_level, last_level,
                     first_layer, last_layer, filter);
 
@@ -422,7 +425,7 @@ HRESULT
 NineBaseTexture9_CreatePipeResource( struct NineBaseTexture9 *This,
                                      BOOL CopyData )
 {
-    struct pipe_context *pipe = This->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This->base.base.device);
     struct pipe_screen *screen = This->base.info.screen;
     struct pipe_resource templ;
     unsigned l, m;
@@ -492,7 +495,7 @@ NineBaseTexture9_UpdateSamplerView( struct NineBaseTexture9 *This,
                                     const int sRGB )
 {
     const struct util_format_description *desc;
-    struct pipe_context *pipe = This->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This->base.base.device);
     struct pipe_screen *screen = pipe->screen;
     struct pipe_resource *resource = This->base.resource;
     struct pipe_sampler_view templ;
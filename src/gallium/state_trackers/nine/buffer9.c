@@ -57,7 +57,6 @@ NineBuffer9_ctor( struct NineBuffer9 *This,
     This->maxmaps = 1;
     This->size = Size;
 
-    This->pipe = pParams->device->pipe;
 
     info->screen = pParams->device->screen;
     info->target = PIPE_BUFFER;
@@ -150,6 +149,7 @@ NineBuffer9_Lock( struct NineBuffer9 *This,
                         void **ppbData,
                         DWORD Flags )
 {
+    struct pipe_context *pipe;
     struct pipe_box box;
     void *data;
     unsigned usage = d3dlock_buffer_to_pipe_transfer_usage(Flags);
@@ -204,8 +204,9 @@ NineBuffer9_Lock( struct NineBuffer9 *This,
         This->maps = newmaps;
     }
 
-    data = This->pipe->transfer_map(This->pipe, This->base.resource, 0,
-                                    usage, &box, &This->maps[This->nmaps]);
+    pipe = NineDevice9_GetPipe(This->base.base.device);
+    data = pipe->transfer_map(pipe, This->base.resource, 0,
+                              usage, &box, &This->maps[This->nmaps]);
 
     if (!data) {
         DBG("pipe::transfer_map failed\n"
@@ -232,9 +233,10 @@ NineBuffer9_Unlock( struct NineBuffer9 *This )
     DBG("This=%p\n", This);
 
     user_assert(This->nmaps > 0, D3DERR_INVALIDCALL);
-    if (This->base.pool != D3DPOOL_MANAGED)
-        This->pipe->transfer_unmap(This->pipe, This->maps[--(This->nmaps)]);
-    else {
+    if (This->base.pool != D3DPOOL_MANAGED) {
+        struct pipe_context *pipe = NineDevice9_GetPipe(This->base.base.device);
+        pipe->transfer_unmap(pipe, This->maps[--(This->nmaps)]);
+    } else {
         This->nmaps--;
         /* TODO: Fix this to upload at the first draw call needing the data,
          * instead of at the next draw call */
@@ -37,6 +37,7 @@
 #include "nine_helpers.h"
 #include "nine_pipe.h"
 #include "nine_ff.h"
+#include "nine_csmt.h"
 #include "nine_dump.h"
 #include "nine_limits.h"
 
@@ -180,6 +181,11 @@ NineDevice9_ctor( struct NineDevice9 *This,
     /* Create first, it messes up our state. */
     This->hud = hud_create(This->pipe, This->cso); /* NULL result is fine */
 
+    if (pCTX->csmt) {
+        This->csmt = nine_csmt_create(This->pipe);
+        if (!This->csmt) { return E_OUTOFMEMORY; }
+    }
+
     /* Available memory counter. Updated only for allocations with this device
      * instance. This is the Win 7 behavior.
      * Win XP shares this counter across multiple devices. */
@@ -413,6 +419,14 @@ NineDevice9_ctor( struct NineDevice9 *This,
     This->driver_caps.user_ibufs = GET_PCAP(USER_INDEX_BUFFERS);
     This->driver_caps.user_cbufs = GET_PCAP(USER_CONSTANT_BUFFERS);
 
+    /* Queued draws run after the call returned, when constants and UP
+     * buffers may already have changed. Upload them instead. */
+    if (This->csmt) {
+        This->driver_caps.user_vbufs = FALSE;
+        This->driver_caps.user_ibufs = FALSE;
+        This->driver_caps.user_cbufs = FALSE;
+    }
+
     if (!This->driver_caps.user_vbufs)
         This->vertex_uploader = u_upload_create(This->pipe, 65536,
                                                 PIPE_BIND_VERTEX_BUFFER, PIPE_USAGE_STREAM);
@@ -455,6 +469,12 @@ NineDevice9_dtor( struct NineDevice9 *This )
 
     DBG("This=%p\n", This);
 
+    /* Everything below talks to the pipe directly. */
+    if (This->csmt) {
+        nine_csmt_destroy(This->csmt);
+        This->csmt = NULL;
+    }
+
     if (This->pipe && This->cso)
         nine_pipe_context_clear(This);
     nine_ff_fini(This);
@@ -509,6 +529,10 @@ NineDevice9_GetScreen( struct NineDevice9 *This )
 struct pipe_context *
 NineDevice9_GetPipe( struct NineDevice9 *This )
 {
+    /* Draws may still be running on the csmt thread, the context must
+     * not be used concurrently. */
+    if (This->csmt)
+        nine_csmt_wait(This->csmt);
     return This->pipe;
 }
 
@@ -630,7 +654,7 @@ NineDevice9_SetCursorProperties( struct NineDevice9 *This,
                                  IDirect3DSurface9 *pCursorBitmap )
 {
     struct NineSurface9 *surf = NineSurface9(pCursorBitmap);
-    struct pipe_context *pipe = This->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This);
     struct pipe_box box;
     struct pipe_transfer *transfer;
     BOOL hw_cursor;
@@ -1488,7 +1512,7 @@ NineDevice9_StretchRect( struct NineDevice9 *This,
                          D3DTEXTUREFILTERTYPE Filter )
 {
     struct pipe_screen *screen = This->screen;
-    struct pipe_context *pipe = This->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This);
     struct NineSurface9 *dst = NineSurface9(pDestSurface);
     struct NineSurface9 *src = NineSurface9(pSourceSurface);
     struct pipe_resource *dst_res = NineSurface9_GetResource(dst);
@@ -1689,7 +1713,7 @@ NineDevice9_ColorFill( struct NineDevice9 *This,
                        const RECT *pRect,
                        D3DCOLOR color )
 {
-    struct pipe_context *pipe = This->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This);
     struct NineSurface9 *surf = NineSurface9(pSurface);
     struct pipe_surface *psurf;
     unsigned x, y, w, h;
@@ -1897,7 +1921,7 @@ NineDevice9_Clear( struct NineDevice9 *This,
 {
     const int sRGB = This->state.rs[D3DRS_SRGBWRITEENABLE] ? 1 : 0;
     struct pipe_surface *cbuf, *zsbuf;
-    struct pipe_context *pipe = This->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This);
     struct NineSurface9 *zsbuf_surf = This->state.ds;
     struct NineSurface9 *rt;
     unsigned bufs = 0;
@@ -2326,6 +2350,7 @@ NineDevice9_ResolveZ( struct NineDevice9 *This )
     const struct util_format_description *desc;
     struct NineSurface9 *source = state->ds;
     struct NineBaseTexture9 *destination = state->texture[0];
+    struct pipe_context *pipe;
     struct pipe_resource *src, *dst;
     struct pipe_blit_info blit;
 
@@ -2368,7 +2393,8 @@ NineDevice9_ResolveZ( struct NineDevice9 *This )
     blit.filter = PIPE_TEX_FILTER_NEAREST;
     blit.scissor_enable = FALSE;
 
-    This->pipe->blit(This->pipe, &blit);
+    pipe = NineDevice9_GetPipe(This);
+    pipe->blit(pipe, &blit);
     return D3D_OK;
 }
 
@@ -2909,6 +2935,15 @@ init_draw_info(struct pipe_draw_info *info,
     info->indirect = NULL;
 }
 
+static inline void
+submit_draw(struct NineDevice9 *dev, const struct pipe_draw_info *info)
+{
+    if (dev->csmt)
+        nine_csmt_draw_vbo(dev->csmt, info);
+    else
+        dev->pipe->draw_vbo(dev->pipe, info);
+}
+
 HRESULT NINE_WINAPI
 NineDevice9_DrawPrimitive( struct NineDevice9 *This,
                            D3DPRIMITIVETYPE PrimitiveType,
@@ -2929,7 +2964,7 @@ NineDevice9_DrawPrimitive( struct NineDevice9 *This,
     info.min_index = info.start;
     info.max_index = info.count - 1;
 
-    This->pipe->draw_vbo(This->pipe, &info);
+    submit_draw(This, &info);
 
     return D3D_OK;
 }
@@ -2963,7 +2998,7 @@ NineDevice9_DrawIndexedPrimitive( struct NineDevice9 *This,
     info.min_index = MinVertexIndex;
     info.max_index = MinVertexIndex + NumVertices - 1;
 
-    This->pipe->draw_vbo(This->pipe, &info);
+    submit_draw(This, &info);
 
     return D3D_OK;
 }
@@ -2975,6 +3010,7 @@ NineDevice9_DrawPrimitiveUP( struct NineDevice9 *This,
                              const void *pVertexStreamZeroData,
                              UINT VertexStreamZeroStride )
 {
+    struct pipe_context *pipe;
     struct pipe_vertex_buffer vtxbuf;
     struct pipe_draw_info info;
 
@@ -2986,6 +3022,7 @@ NineDevice9_DrawPrimitiveUP( struct NineDevice9 *This,
                 D3DERR_INVALIDCALL);
 
     nine_update_state(This);
+    pipe = NineDevice9_GetPipe(This);
 
     init_draw_info(&info, This, PrimitiveType, PrimitiveCount);
     info.indexed = FALSE;
@@ -3011,9 +3048,9 @@ NineDevice9_DrawPrimitiveUP( struct NineDevice9 *This,
         vtxbuf.user_buffer = NULL;
     }
 
-    This->pipe->set_vertex_buffers(This->pipe, 0, 1, &vtxbuf);
+    pipe->set_vertex_buffers(pipe, 0, 1, &vtxbuf);
 
-    This->pipe->draw_vbo(This->pipe, &info);
+    submit_draw(This, &info);
 
     NineDevice9_PauseRecording(This);
     NineDevice9_SetStreamSource(This, 0, NULL, 0, 0);
@@ -3035,6 +3072,7 @@ NineDevice9_DrawIndexedPrimitiveUP( struct NineDevice9 *This,
                                     const void *pVertexStreamZeroData,
                                     UINT VertexStreamZeroStride )
 {
+    struct pipe_context *pipe;
     struct pipe_draw_info info;
     struct pipe_vertex_buffer vbuf;
     struct pipe_index_buffer ibuf;
@@ -3052,6 +3090,7 @@ NineDevice9_DrawIndexedPrimitiveUP( struct NineDevice9 *This,
                 IndexDataFormat == D3DFMT_INDEX32, D3DERR_INVALIDCALL);
 
     nine_update_state(This);
+    pipe = NineDevice9_GetPipe(This);
 
     init_draw_info(&info, This, PrimitiveType, PrimitiveCount);
     info.indexed = TRUE;
@@ -3097,10 +3136,10 @@ NineDevice9_DrawIndexedPrimitiveUP( struct NineDevice9 *This,
         ibuf.user_buffer = NULL;
     }
 
-    This->pipe->set_vertex_buffers(This->pipe, 0, 1, &vbuf);
-    This->pipe->set_index_buffer(This->pipe, &ibuf);
+    pipe->set_vertex_buffers(pipe, 0, 1, &vbuf);
+    pipe->set_index_buffer(pipe, &ibuf);
 
-    This->pipe->draw_vbo(This->pipe, &info);
+    submit_draw(This, &info);
 
     pipe_resource_reference(&vbuf.buffer, NULL);
     pipe_resource_reference(&ibuf.buffer, NULL);
@@ -3126,6 +3165,7 @@ NineDevice9_ProcessVertices( struct NineDevice9 *This,
                              DWORD Flags )
 {
     struct pipe_screen *screen = This->screen;
+    struct pipe_context *pipe;
     struct NineVertexDeclaration9 *vdecl = NineVertexDeclaration9(pVertexDecl);
     struct NineVertexShader9 *vs;
     struct pipe_resource *resource;
@@ -3143,6 +3183,7 @@ NineDevice9_ProcessVertices( struct NineDevice9 *This,
         STUB(D3DERR_INVALIDCALL);
 
     nine_update_state(This);
+    pipe = NineDevice9_GetPipe(This);
 
     /* TODO: Create shader with stream output. */
     STUB(D3DERR_INVALIDCALL);
@@ -3172,9 +3213,9 @@ NineDevice9_ProcessVertices( struct NineDevice9 *This,
         resource = NineVertexBuffer9_GetResource(dst);
         buffer_offset = DestIndex * vs->so->stride[0];
     }
-    target = This->pipe->create_stream_output_target(This->pipe, resource,
-                                                     buffer_offset,
-                                                     buffer_size);
+    target = pipe->create_stream_output_target(pipe, resource,
+                                               buffer_offset,
+                                               buffer_size);
     if (!target) {
         pipe_resource_reference(&resource, NULL);
         return D3DERR_DRIVERINTERNALERROR;
@@ -3194,10 +3235,10 @@ NineDevice9_ProcessVertices( struct NineDevice9 *This,
     draw.min_index = SrcStartIndex;
     draw.max_index = SrcStartIndex + VertexCount - 1;
 
-    This->pipe->set_stream_output_targets(This->pipe, 1, &target, 0);
-    This->pipe->draw_vbo(This->pipe, &draw);
-    This->pipe->set_stream_output_targets(This->pipe, 0, NULL, 0);
-    This->pipe->stream_output_target_destroy(This->pipe, target);
+    pipe->set_stream_output_targets(pipe, 1, &target, 0);
+    pipe->draw_vbo(pipe, &draw);
+    pipe->set_stream_output_targets(pipe, 0, NULL, 0);
+    pipe->stream_output_target_destroy(pipe, target);
 
     hr = NineVertexDeclaration9_ConvertStreamOutput(vdecl,
                                                     dst, DestIndex, VertexCount,
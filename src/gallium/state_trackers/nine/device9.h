@@ -38,6 +38,7 @@ struct pipe_context;
 struct cso_context;
 struct hud_context;
 struct u_upload_mgr;
+struct nine_csmt;
 
 struct NineSwapChain9;
 struct NineStateBlock9;
@@ -53,6 +54,7 @@ struct NineDevice9
     struct pipe_screen *screen;
     struct pipe_context *pipe;
     struct cso_context *cso;
+    struct nine_csmt *csmt; /* NULL unless draws go through a worker thread */
 
     /* creation parameters */
     D3DCAPS9 caps;
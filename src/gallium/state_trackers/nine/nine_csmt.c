@@ -0,0 +1,147 @@
+/*
+ * Copyright 2016 Gallium Nine contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+
+#include "nine_csmt.h"
+#include "nine_debug.h"
+
+#include "pipe/p_context.h"
+#include "pipe/p_state.h"
+#include "os/os_thread.h"
+#include "util/u_memory.h"
+
+#define DBG_CHANNEL DBG_DEVICE
+
+#define NINE_CSMT_QUEUE_SIZE 64
+
+struct nine_csmt {
+    struct pipe_context *pipe;
+
+    pipe_thread thread;
+    pipe_mutex mutex;
+    pipe_condvar queued;    /* signalled when a draw was pushed */
+    pipe_condvar processed; /* signalled when a draw was submitted */
+
+    /* head and tail only ever increase; tail - head is the number of
+     * pending draws. draws[head] stays valid until the worker has
+     * submitted it, the producer only writes at tail. */
+    struct pipe_draw_info draws[NINE_CSMT_QUEUE_SIZE];
+    unsigned head;
+    unsigned tail;
+    boolean terminate;
+};
+
+static PIPE_THREAD_ROUTINE(nine_csmt_worker, arg)
+{
+    struct nine_csmt *csmt = arg;
+
+    pipe_mutex_lock(csmt->mutex);
+    for (;;) {
+        struct pipe_draw_info *info;
+
+        while (csmt->head == csmt->tail && !csmt->terminate)
+            pipe_condvar_wait(csmt->queued, csmt->mutex);
+        if (csmt->head == csmt->tail)
+            break;
+
+        info = &csmt->draws[csmt->head % NINE_CSMT_QUEUE_SIZE];
+        pipe_mutex_unlock(csmt->mutex);
+
+        csmt->pipe->draw_vbo(csmt->pipe, info);
+
+        pipe_mutex_lock(csmt->mutex);
+        csmt->head++;
+        pipe_condvar_broadcast(csmt->processed);
+    }
+    pipe_mutex_unlock(csmt->mutex);
+
+    return 0;
+}
+
+struct nine_csmt *
+nine_csmt_create( struct pipe_context *pipe )
+{
+    struct nine_csmt *csmt = CALLOC_STRUCT(nine_csmt);
+
+    if (!csmt)
+        return NULL;
+
+    csmt->pipe = pipe;
+    pipe_mutex_init(csmt->mutex);
+    pipe_condvar_init(csmt->queued);
+    pipe_condvar_init(csmt->processed);
+
+    csmt->thread = pipe_thread_create(nine_csmt_worker, csmt);
+    if (!csmt->thread) {
+        pipe_condvar_destroy(csmt->processed);
+        pipe_condvar_destroy(csmt->queued);
+        pipe_mutex_destroy(csmt->mutex);
+        FREE(csmt);
+        return NULL;
+    }
+
+    DBG("csmt=%p\n", csmt);
+
+    return csmt;
+}
+
+void
+nine_csmt_destroy( struct nine_csmt *csmt )
+{
+    pipe_mutex_lock(csmt->mutex);
+    csmt->terminate = TRUE;
+    pipe_condvar_signal(csmt->queued);
+    pipe_mutex_unlock(csmt->mutex);
+
+    /* The worker drains the queue before it exits. */
+    pipe_thread_wait(csmt->thread);
+
+    pipe_condvar_destroy(csmt->processed);
+    pipe_condvar_destroy(csmt->queued);
+    pipe_mutex_destroy(csmt->mutex);
+    FREE(csmt);
+}
+
+void
+nine_csmt_draw_vbo( struct nine_csmt *csmt,
+                    const struct pipe_draw_info *info )
+{
+    assert(!info->indirect && !info->count_from_stream_output);
+
+    pipe_mutex_lock(csmt->mutex);
+    while (csmt->tail - csmt->head == NINE_CSMT_QUEUE_SIZE)
+        pipe_condvar_wait(csmt->processed, csmt->mutex);
+
+    csmt->draws[csmt->tail % NINE_CSMT_QUEUE_SIZE] = *info;
+    csmt->tail++;
+    pipe_condvar_signal(csmt->queued);
+    pipe_mutex_unlock(csmt->mutex);
+}
+
+void
+nine_csmt_wait( struct nine_csmt *csmt )
+{
+    pipe_mutex_lock(csmt->mutex);
+    while (csmt->head != csmt->tail)
+        pipe_condvar_wait(csmt->processed, csmt->mutex);
+    pipe_mutex_unlock(csmt->mutex);
+}
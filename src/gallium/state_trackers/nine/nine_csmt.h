@@ -0,0 +1,52 @@
+/*
+ * Copyright 2016 Gallium Nine contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+
+#ifndef _NINE_CSMT_H_
+#define _NINE_CSMT_H_
+
+#include "pipe/p_compiler.h"
+
+struct pipe_context;
+struct pipe_draw_info;
+struct nine_csmt;
+
+/* Hands draw_vbo calls to a worker thread so that the driver's draw
+ * processing overlaps with the application building the next draw.
+ * Every other use of the pipe_context must nine_csmt_wait() first, the
+ * context is never entered from two threads at once. */
+struct nine_csmt *
+nine_csmt_create( struct pipe_context *pipe );
+
+void
+nine_csmt_destroy( struct nine_csmt *csmt );
+
+/* Queue a copy of info. The draw must not reference user memory. */
+void
+nine_csmt_draw_vbo( struct nine_csmt *csmt,
+                    const struct pipe_draw_info *info );
+
+/* Returns once all queued draws have been submitted to the pipe. */
+void
+nine_csmt_wait( struct nine_csmt *csmt );
+
+#endif /* _NINE_CSMT_H_ */
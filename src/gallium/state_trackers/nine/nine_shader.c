@@ -3517,7 +3517,7 @@ nine_translate_shader(struct NineDevice9 *device, struct nine_shader_info *info)
         ureg_free_tokens(toks);
     }
 
-    info->cso = ureg_create_shader_and_destroy(tx->ureg, device->pipe);
+    info->cso = ureg_create_shader_and_destroy(tx->ureg, NineDevice9_GetPipe(device));
     if (!info->cso) {
         hr = D3DERR_DRIVERINTERNALERROR;
         FREE(info->lconstf.data);
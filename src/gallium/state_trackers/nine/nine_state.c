@@ -31,6 +31,7 @@
 #include "pixelshader9.h"
 #include "nine_pipe.h"
 #include "nine_ff.h"
+#include "nine_csmt.h"
 #include "pipe/p_context.h"
 #include "pipe/p_state.h"
 #include "cso_cache/cso_context.h"
@@ -946,11 +947,28 @@ update_managed_buffers(struct NineDevice9 *device)
     }
 }
 
+/* Nothing to validate or commit, so nine_update_state won't touch the pipe
+ * and draws queued on the csmt thread can keep running. */
+static inline boolean
+nine_state_is_clean(struct NineDevice9 *device)
+{
+    struct nine_state *state = &device->state;
+
+    return !(state->changed.group & ~NINE_STATE_FF) &&
+           !state->changed.vtxbuf && !state->changed.ucp && !state->commit &&
+           state->programmable_vs && state->ps &&
+           LIST_IS_EMPTY(&device->update_textures) &&
+           LIST_IS_EMPTY(&device->update_buffers);
+}
+
 void
 nine_update_state_framebuffer_clear(struct NineDevice9 *device)
 {
     struct nine_state *state = &device->state;
 
+    if (device->csmt)
+        nine_csmt_wait(device->csmt);
+
     validate_textures(device);
 
     if (state->changed.group & NINE_STATE_FB)
@@ -966,6 +984,9 @@ nine_update_state(struct NineDevice9 *device)
 
     DBG("changed state groups: %x\n", state->changed.group);
 
+    if (device->csmt && !nine_state_is_clean(device))
+        nine_csmt_wait(device->csmt);
+
     /* NOTE: We may want to use the cso cache for everything, or let
      * NineDevice9.RestoreNonCSOState actually set the states, then we wouldn't
      * have to care about state being clobbered here and could merge this back
@@ -93,7 +93,7 @@ NineQuery9_ctor( struct NineQuery9 *This,
                  struct NineUnknownParams *pParams,
                  D3DQUERYTYPE Type )
 {
-    struct pipe_context *pipe = pParams->device->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(pParams->device);
     const unsigned ptype = d3dquerytype_to_pipe_query(pParams->device->screen, Type);
     HRESULT hr;
 
@@ -132,7 +132,7 @@ NineQuery9_ctor( struct NineQuery9 *This,
 void
 NineQuery9_dtor( struct NineQuery9 *This )
 {
-    struct pipe_context *pipe = This->base.device->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This->base.device);
 
     if (This->pq) {
         if (This->state == NINE_QUERY_STATE_RUNNING)
@@ -159,7 +159,7 @@ HRESULT NINE_WINAPI
 NineQuery9_Issue( struct NineQuery9 *This,
                   DWORD dwIssueFlags )
 {
-    struct pipe_context *pipe = This->base.device->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This->base.device);
 
     DBG("This=%p dwIssueFlags=%d\n", This, dwIssueFlags);
 
@@ -203,7 +203,7 @@ NineQuery9_GetData( struct NineQuery9 *This,
                     DWORD dwSize,
                     DWORD dwGetDataFlags )
 {
-    struct pipe_context *pipe = This->base.device->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This->base.device);
     boolean ok, wait_query_result = FALSE;
     union pipe_query_result presult;
     union nine_query_result nresult;
@@ -58,7 +58,7 @@ NineSurface9_ctor( struct NineSurface9 *This,
     HRESULT hr;
     union pipe_color_union rgba = {0};
     struct pipe_surface *surf;
-    struct pipe_context *pipe = pParams->device->pipe;
+    struct pipe_context *pipe;
 
     DBG("This=%p pDevice=%p pResource=%p Level=%u Layer=%u pDesc=%p\n",
         This, pParams->device, pResource, Level, Layer, pDesc);
@@ -127,7 +127,6 @@ NineSurface9_ctor( struct NineSurface9 *This,
     if (FAILED(hr))
         return hr;
 
-    This->pipe = This->base.base.device->pipe;
     This->transfer = NULL;
 
     This->texture = TextureType;
@@ -143,6 +142,7 @@ NineSurface9_ctor( struct NineSurface9 *This,
 
     /* TODO: investigate what else exactly needs to be cleared */
     if (This->base.resource && (pDesc->Usage & D3DUSAGE_RENDERTARGET)) {
+        pipe = NineDevice9_GetPipe(pParams->device);
         surf = NineSurface9_GetSurface(This, 0);
         pipe->clear_render_target(pipe, surf, &rgba, 0, 0, pDesc->Width, pDesc->Height);
     }
@@ -158,6 +158,9 @@ NineSurface9_dtor( struct NineSurface9 *This )
     if (This->transfer)
         NineSurface9_UnlockRect(This);
 
+    /* The surfaces are destroyed through the context. */
+    if (This->surface[0] || This->surface[1])
+        NineDevice9_GetPipe(This->base.base.device);
     pipe_surface_reference(&This->surface[0], NULL);
     pipe_surface_reference(&This->surface[1], NULL);
 
@@ -170,7 +173,7 @@ NineSurface9_dtor( struct NineSurface9 *This )
 struct pipe_surface *
 NineSurface9_CreatePipeSurface( struct NineSurface9 *This, const int sRGB )
 {
-    struct pipe_context *pipe = This->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This->base.base.device);
     struct pipe_screen *screen = pipe->screen;
     struct pipe_resource *resource = This->base.resource;
     struct pipe_surface templ;
@@ -319,6 +322,7 @@ NineSurface9_LockRect( struct NineSurface9 *This,
                        const RECT *pRect,
                        DWORD Flags )
 {
+    struct pipe_context *pipe;
     struct pipe_resource *resource = This->base.resource;
     struct pipe_box box;
     unsigned usage;
@@ -403,9 +407,10 @@ NineSurface9_LockRect( struct NineSurface9 *This,
         DBG("mapping pipe_resource %p (level=%u usage=%x)\n",
             resource, This->level, usage);
 
-        pLockedRect->pBits = This->pipe->transfer_map(This->pipe, resource,
-                                                      This->level, usage, &box,
-                                                      &This->transfer);
+        pipe = NineDevice9_GetPipe(This->base.base.device);
+        pLockedRect->pBits = pipe->transfer_map(pipe, resource,
+                                                This->level, usage, &box,
+                                                &This->transfer);
         if (!This->transfer) {
             DBG("transfer_map failed\n");
             if (Flags & D3DLOCK_DONOTWAIT)
@@ -430,7 +435,8 @@ NineSurface9_UnlockRect( struct NineSurface9 *This )
     DBG("This=%p lock_count=%u\n", This, This->lock_count);
     user_assert(This->lock_count, D3DERR_INVALIDCALL);
     if (This->transfer) {
-        This->pipe->transfer_unmap(This->pipe, This->transfer);
+        struct pipe_context *pipe = NineDevice9_GetPipe(This->base.base.device);
+        pipe->transfer_unmap(pipe, This->transfer);
         This->transfer = NULL;
     }
     --This->lock_count;
@@ -479,7 +485,7 @@ NineSurface9_CopyMemToDefault( struct NineSurface9 *This,
                                const POINT *pDestPoint,
                                const RECT *pSourceRect )
 {
-    struct pipe_context *pipe = This->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This->base.base.device);
     struct pipe_resource *r_dst = This->base.resource;
     struct pipe_box dst_box;
     const uint8_t *p_src;
@@ -524,7 +530,7 @@ void
 NineSurface9_CopyDefaultToMem( struct NineSurface9 *This,
                                struct NineSurface9 *From )
 {
-    struct pipe_context *pipe = This->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This->base.base.device);
     struct pipe_resource *r_src = From->base.resource;
     struct pipe_transfer *transfer;
     struct pipe_box src_box;
@@ -564,7 +570,7 @@ HRESULT
 NineSurface9_UploadSelf( struct NineSurface9 *This,
                          const struct pipe_box *damaged )
 {
-    struct pipe_context *pipe = This->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This->base.base.device);
     struct pipe_resource *res = This->base.resource;
     uint8_t *ptr;
     struct pipe_box box;
@@ -612,6 +618,8 @@ NineSurface9_SetResourceResize( struct NineSurface9 *This,
     This->stride = nine_format_get_stride(This->base.info.format,
                                           This->desc.Width);
 
+    if (This->surface[0] || This->surface[1])
+        NineDevice9_GetPipe(This->base.base.device);
     pipe_surface_reference(&This->surface[0], NULL);
     pipe_surface_reference(&This->surface[1], NULL);
 }
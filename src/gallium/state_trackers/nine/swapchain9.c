@@ -668,6 +668,9 @@ present( struct NineSwapChain9 *This,
             pDestRect->left, pDestRect->right,
             pDestRect->top, pDestRect->bottom);
 
+    /* This->pipe is used directly from here on, wait for queued draws. */
+    NineDevice9_GetPipe(This->base.device);
+
     /* TODO: in the case the source and destination rect have different size:
      * We need to allocate a new buffer, and do a blit to it to resize.
      * We can't use the present_buffer for that since when we created it,
@@ -423,7 +423,7 @@ NineVertexDeclaration9_ConvertStreamOutput(
     struct pipe_resource *pSrcBuf,
     const struct pipe_stream_output_info *so )
 {
-    struct pipe_context *pipe = This->base.device->pipe;
+    struct pipe_context *pipe = NineDevice9_GetPipe(This->base.device);
     struct pipe_transfer *transfer = NULL;
     struct translate *translate;
     struct translate_key transkey;
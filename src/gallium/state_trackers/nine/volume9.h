@@ -50,8 +50,6 @@ struct NineVolume9
     struct pipe_transfer *transfer;
     unsigned lock_count;
 
-    struct pipe_context *pipe;
-
     /* for [GS]etPrivateData/FreePrivateData */
     struct util_hash_table *pdata;
 };
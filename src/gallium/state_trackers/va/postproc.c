@@ -291,7 +291,11 @@ vlVaHandleVAProcPipelineParameterBufferType(vlVaDriver *drv, vlVaContext *contex
    src_region = vlVaRegionDefault(param->surface_region, src_surface->buffer, &def_src_region);
    dst_region = vlVaRegionDefault(param->output_region, context->target, &def_dst_region);
 
-   if (context->target->buffer_format != PIPE_FORMAT_NV12)
+   /* Only color conversion needs the compositor, same format copies and
+    * scales are plain blits of each plane. */
+   if (context->target->buffer_format != PIPE_FORMAT_NV12 &&
+       (context->target->buffer_format != src->buffer_format ||
+        context->target->interlaced != src->interlaced))
       return vlVaPostProcCompositor(drv, context, src_region, dst_region,
                                     src, context->target, deinterlace);
    else
@@ -31,6 +31,7 @@
 
 #include "state_tracker/drm_driver.h"
 
+#include "util/u_format.h"
 #include "util/u_memory.h"
 #include "util/u_handle_table.h"
 #include "util/u_rect.h"
@@ -218,6 +219,75 @@ vlVaPutSubpictures(vlVaSurface *surf, vlVaDriver *drv,
    return VA_STATUS_SUCCESS;
 }
 
+/**
+ * Present RGB surfaces with a plain blit when that's all the compositor
+ * would do: no scaling, and a destination covering the whole drawable so
+ * there is no background left to clear.
+ */
+static bool
+vlVaPutSurfaceBlit(vlVaDriver *drv, vlVaSurface *surf, struct pipe_resource *tex,
+                   const struct u_rect *src_rect, const struct u_rect *dst_rect,
+                   struct u_rect *dirty_area)
+{
+   const struct util_format_description *desc;
+   struct pipe_surface **surfaces;
+   struct pipe_resource *src;
+   struct pipe_blit_info blit;
+
+   if (surf->buffer->interlaced)
+      return false;
+
+   desc = util_format_description(surf->buffer->buffer_format);
+   if (!desc || desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB)
+      return false;
+
+   if (dst_rect->x0 != 0 || dst_rect->y0 != 0 ||
+       dst_rect->x1 != tex->width0 || dst_rect->y1 != tex->height0)
+      return false;
+
+   if (src_rect->x1 - src_rect->x0 != dst_rect->x1 ||
+       src_rect->y1 - src_rect->y0 != dst_rect->y1)
+      return false;
+
+   surfaces = surf->buffer->get_surfaces(surf->buffer);
+   if (!surfaces || !surfaces[0])
+      return false;
+
+   src = surfaces[0]->texture;
+   if (src_rect->x0 < 0 || src_rect->y0 < 0 ||
+       src_rect->x1 > src->width0 || src_rect->y1 > src->height0)
+      return false;
+
+   memset(&blit, 0, sizeof(blit));
+   blit.src.resource = src;
+   blit.src.format = surfaces[0]->format;
+   blit.src.level = 0;
+   blit.src.box.x = src_rect->x0;
+   blit.src.box.y = src_rect->y0;
+   blit.src.box.z = surfaces[0]->u.tex.first_layer;
+   blit.src.box.width = dst_rect->x1;
+   blit.src.box.height = dst_rect->y1;
+   blit.src.box.depth = 1;
+
+   blit.dst.resource = tex;
+   blit.dst.format = tex->format;
+   blit.dst.level = 0;
+   blit.dst.box.width = dst_rect->x1;
+   blit.dst.box.height = dst_rect->y1;
+   blit.dst.box.depth = 1;
+
+   blit.mask = PIPE_MASK_RGBA;
+   blit.filter = PIPE_TEX_FILTER_NEAREST;
+
+   drv->pipe->blit(drv->pipe, &blit);
+
+   /* Like the compositor, remember what was drawn for the next clear */
+   if (dirty_area)
+      *dirty_area = *dst_rect;
+
+   return true;
+}
+
 VAStatus
 vlVaPutSurface(VADriverContextP ctx, VASurfaceID surface_id, void* draw, short srcx, short srcy,
                unsigned short srcw, unsigned short srch, short destx, short desty,
@@ -270,10 +340,12 @@ vlVaPutSurface(VADriverContextP ctx, VASurfaceID surface_id, void* draw, short s
    src_rect.x1 = srcw + srcx;
    src_rect.y1 = srch + srcy;
 
-   vl_compositor_clear_layers(&drv->cstate);
-   vl_compositor_set_buffer_layer(&drv->cstate, &drv->compositor, 0, surf->buffer, &src_rect, NULL, VL_COMPOSITOR_WEAVE);
-   vl_compositor_set_layer_dst_area(&drv->cstate, 0, &dst_rect);
-   vl_compositor_render(&drv->cstate, &drv->compositor, surf_draw, dirty_area, true);
+   if (!vlVaPutSurfaceBlit(drv, surf, tex, &src_rect, &dst_rect, dirty_area)) {
+      vl_compositor_clear_layers(&drv->cstate);
+      vl_compositor_set_buffer_layer(&drv->cstate, &drv->compositor, 0, surf->buffer, &src_rect, NULL, VL_COMPOSITOR_WEAVE);
+      vl_compositor_set_layer_dst_area(&drv->cstate, 0, &dst_rect);
+      vl_compositor_render(&drv->cstate, &drv->compositor, surf_draw, dirty_area, true);
+   }
 
    status = vlVaPutSubpictures(surf, drv, surf_draw, dirty_area, &src_rect, &dst_rect);
    if (status) {
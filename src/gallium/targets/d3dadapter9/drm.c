@@ -56,6 +56,7 @@ DRI_CONF_BEGIN
         DRI_CONF_NINE_OVERRIDEVENDOR(-1)
         DRI_CONF_NINE_THROTTLE(-2)
         DRI_CONF_NINE_THREADSUBMIT("false")
+        DRI_CONF_NINE_CSMT("false")
     DRI_CONF_SECTION_END
 DRI_CONF_END;
 
@@ -278,6 +279,9 @@ drm_create_adapter( int fd,
                 "You should not expect any benefit.");
     }
 
+    if (driCheckOption(&userInitOptions, "csmt", DRI_BOOL))
+        ctx->base.csmt = driQueryOptionb(&userInitOptions, "csmt");
+
     if (driCheckOption(&userInitOptions, "override_vendorid", DRI_INT)) {
         override_vendorid = driQueryOptioni(&userInitOptions, "override_vendorid");
     }
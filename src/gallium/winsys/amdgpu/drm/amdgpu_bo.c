@@ -162,6 +162,7 @@ static void *amdgpu_bo_map(struct pb_buffer *buf,
                            enum pipe_transfer_usage usage)
 {
    struct amdgpu_winsys_bo *bo = (struct amdgpu_winsys_bo*)buf;
+   struct amdgpu_winsys_bo *real;
    struct amdgpu_cs *cs = (struct amdgpu_cs*)rcs;
    int r;
    void *cpu = NULL;
@@ -233,20 +234,24 @@ static void *amdgpu_bo_map(struct pb_buffer *buf,
    if (bo->user_ptr)
        return bo->user_ptr;
 
-   r = amdgpu_bo_cpu_map(bo->bo, &cpu);
+   /* Slab entries are mapped through the buffer they are part of. */
+   real = bo->real ? bo->real : bo;
+
+   r = amdgpu_bo_cpu_map(real->bo, &cpu);
    if (r) {
       /* Clear the cache and try again. */
       pb_cache_release_all_buffers(&bo->ws->bo_cache);
-      r = amdgpu_bo_cpu_map(bo->bo, &cpu);
+      r = amdgpu_bo_cpu_map(real->bo, &cpu);
    }
-   return r ? NULL : cpu;
+   return r ? NULL : (uint8_t*)cpu + (bo->va - real->va);
 }
 
 static void amdgpu_bo_unmap(struct pb_buffer *buf)
 {
    struct amdgpu_winsys_bo *bo = (struct amdgpu_winsys_bo*)buf;
+   struct amdgpu_winsys_bo *real = bo->real ? bo->real : bo;
 
-   amdgpu_bo_cpu_unmap(bo->bo);
+   amdgpu_bo_cpu_unmap(real->bo);
 }
 
 static const struct pb_vtbl amdgpu_winsys_bo_vtbl = {
@@ -361,6 +366,115 @@ bool amdgpu_bo_can_reclaim(struct pb_buffer *_buf)
    return amdgpu_bo_wait(_buf, 0, RADEON_USAGE_READWRITE);
 }
 
+bool amdgpu_bo_can_reclaim_slab(void *priv, struct pb_slab_entry *entry)
+{
+   struct amdgpu_winsys_bo *bo = NULL;
+
+   bo = container_of(entry, bo, slab_entry);
+
+   return amdgpu_bo_can_reclaim(&bo->base);
+}
+
+static void amdgpu_bo_slab_destroy(struct pb_buffer *_buf)
+{
+   struct amdgpu_winsys_bo *bo = amdgpu_winsys_bo(_buf);
+
+   assert(!bo->bo);
+
+   pb_slab_free(&bo->ws->bo_slabs, &bo->slab_entry);
+}
+
+static const struct pb_vtbl amdgpu_winsys_bo_slab_vtbl = {
+   amdgpu_bo_slab_destroy
+   /* other functions are never called */
+};
+
+/* The heap index encodes the initial domain and the flags, see
+ * AMDGPU_NUM_SLAB_HEAPS.
+ */
+static unsigned amdgpu_slab_heap(enum radeon_bo_domain domain,
+                                 enum radeon_bo_flag flags)
+{
+   assert(domain & RADEON_DOMAIN_VRAM_GTT);
+   assert(flags < 8);
+
+   return ((domain >> 1) - 1) * 8 + flags;
+}
+
+struct pb_slab *amdgpu_bo_slab_alloc(void *priv, unsigned heap,
+                                     unsigned entry_size,
+                                     unsigned group_index)
+{
+   struct amdgpu_winsys *ws = priv;
+   struct amdgpu_slab *slab = CALLOC_STRUCT(amdgpu_slab);
+   enum radeon_bo_domain domains = ((heap / 8) + 1) << 1;
+   enum radeon_bo_flag flags = heap % 8;
+   unsigned slab_size = 1 << AMDGPU_SLAB_BO_SIZE_LOG2;
+   unsigned i;
+
+   if (!slab)
+      return NULL;
+
+   slab->buffer = amdgpu_winsys_bo(ws->base.buffer_create(&ws->base,
+                                                          slab_size,
+                                                          slab_size,
+                                                          true, domains,
+                                                          flags));
+   if (!slab->buffer)
+      goto fail;
+
+   assert(slab->buffer->bo);
+
+   slab->base.num_entries = slab_size / entry_size;
+   slab->base.num_free = slab->base.num_entries;
+   slab->entries = CALLOC(slab->base.num_entries, sizeof(*slab->entries));
+   if (!slab->entries)
+      goto fail_buffer;
+
+   LIST_INITHEAD(&slab->base.free);
+
+   for (i = 0; i < slab->base.num_entries; ++i) {
+      struct amdgpu_winsys_bo *bo = &slab->entries[i];
+
+      bo->base.alignment = entry_size;
+      bo->base.usage = slab->buffer->base.usage;
+      bo->base.size = entry_size;
+      bo->base.vtbl = &amdgpu_winsys_bo_slab_vtbl;
+      bo->ws = ws;
+      bo->va = slab->buffer->va + i * entry_size;
+      bo->initial_domain = slab->buffer->initial_domain;
+      bo->unique_id = __sync_fetch_and_add(&ws->next_bo_unique_id, 1);
+      bo->real = slab->buffer;
+      bo->slab_entry.slab = &slab->base;
+      bo->slab_entry.group_index = group_index;
+
+      LIST_ADDTAIL(&bo->slab_entry.head, &slab->base.free);
+   }
+
+   return &slab->base;
+
+fail_buffer:
+   amdgpu_winsys_bo_reference(&slab->buffer, NULL);
+fail:
+   FREE(slab);
+   return NULL;
+}
+
+void amdgpu_bo_slab_free(void *priv, struct pb_slab *pslab)
+{
+   struct amdgpu_slab *slab = (struct amdgpu_slab *)pslab;
+   unsigned i, j;
+
+   for (i = 0; i < slab->base.num_entries; ++i) {
+      for (j = 0; j < RING_LAST; ++j)
+         amdgpu_fence_reference(&slab->entries[i].fence[j], NULL);
+   }
+
+   FREE(slab->entries);
+   amdgpu_winsys_bo_reference(&slab->buffer, NULL);
+   FREE(slab);
+}
+
 static unsigned eg_tile_split(unsigned tile_split)
 {
    switch (tile_split) {
@@ -398,6 +512,8 @@ static void amdgpu_buffer_get_metadata(struct pb_buffer *_buf,
    uint32_t tiling_flags;
    int r;
 
+   assert(bo->bo && "must not be called for slab entries");
+
    r = amdgpu_bo_query_info(bo->bo, &info);
    if (r)
       return;
@@ -429,6 +545,8 @@ static void amdgpu_buffer_set_metadata(struct pb_buffer *_buf,
    struct amdgpu_bo_metadata metadata = {0};
    uint32_t tiling_flags = 0;
 
+   assert(bo->bo && "must not be called for slab entries");
+
    if (md->macrotile == RADEON_LAYOUT_TILED)
       tiling_flags |= AMDGPU_TILING_SET(ARRAY_MODE, 4); /* 2D_TILED_THIN1 */
    else if (md->microtile == RADEON_LAYOUT_TILED)
@@ -467,6 +585,9 @@ amdgpu_bo_create(struct radeon_winsys *rws,
    struct amdgpu_winsys *ws = amdgpu_winsys(rws);
    struct amdgpu_winsys_bo *bo;
    unsigned usage = 0;
+   bool can_suballoc = !(flags & RADEON_FLAG_HANDLE);
+
+   flags &= ~RADEON_FLAG_HANDLE;
 
    /* Don't use VRAM if the GPU doesn't have much. This is only the initial
     * domain. The kernel is free to move the buffer if it wants to.
@@ -478,6 +599,34 @@ amdgpu_bo_create(struct radeon_winsys *rws,
       flags = RADEON_FLAG_GTT_WC;
    }
 
+   /* Sub-allocate small buffers from slabs. Entries are aligned to their
+    * (power of two) size, so a bigger alignment is handled by asking for
+    * a bigger entry.
+    */
+   if (can_suballoc &&
+       size <= (1 << AMDGPU_SLAB_MAX_SIZE_LOG2) &&
+       alignment <= (1 << AMDGPU_SLAB_MAX_SIZE_LOG2)) {
+      struct pb_slab_entry *entry;
+      unsigned heap = amdgpu_slab_heap(domain, flags);
+
+      entry = pb_slab_alloc(&ws->bo_slabs, MAX2(size, alignment), heap);
+      if (!entry) {
+         /* Clear the cache and try again. */
+         pb_cache_release_all_buffers(&ws->bo_cache);
+         entry = pb_slab_alloc(&ws->bo_slabs, MAX2(size, alignment), heap);
+      }
+      if (!entry)
+         return NULL;
+
+      bo = NULL;
+      bo = container_of(entry, bo, slab_entry);
+
+      pipe_reference_init(&bo->base.reference, 1);
+      bo->base.size = size;
+
+      return &bo->base;
+   }
+
    /* Align size to page size. This is the minimum alignment for normal
     * BOs. Aligning this here helps the cached bufmgr. Especially small BOs,
     * like constant/uniform buffers, can benefit from better and more reuse.
@@ -620,6 +769,11 @@ static boolean amdgpu_bo_get_handle(struct pb_buffer *buffer,
    enum amdgpu_bo_handle_type type;
    int r;
 
+   /* Slab entries don't have a kernel BO of their own. Buffers that may be
+    * shared must be created with RADEON_FLAG_HANDLE. */
+   if (!bo->bo)
+      return FALSE;
+
    bo->use_reusable_pool = false;
 
    switch (whandle->type) {
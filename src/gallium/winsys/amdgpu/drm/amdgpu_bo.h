@@ -35,6 +35,19 @@
 
 #include "amdgpu_winsys.h"
 #include "pipebuffer/pb_bufmgr.h"
+#include "pipebuffer/pb_slab.h"
+
+/* Buffers of up to 2^AMDGPU_SLAB_MAX_SIZE_LOG2 bytes are suballocated from
+ * slabs of 2^AMDGPU_SLAB_BO_SIZE_LOG2 bytes, so that they don't each need a
+ * kernel BO and an entry in the buffer list of every CS they are used in.
+ */
+#define AMDGPU_SLAB_MIN_SIZE_LOG2   8
+#define AMDGPU_SLAB_MAX_SIZE_LOG2   16
+#define AMDGPU_SLAB_BO_SIZE_LOG2    18
+
+/* One slab heap for each initial domain (GTT, VRAM, VRAM_GTT) and each
+ * combination of RADEON_FLAG_GTT_WC, CPU_ACCESS and NO_CPU_ACCESS. */
+#define AMDGPU_NUM_SLAB_HEAPS       (3 * 8)
 
 struct amdgpu_winsys_bo {
    struct pb_buffer base;
@@ -43,7 +56,7 @@ struct amdgpu_winsys_bo {
    struct amdgpu_winsys *ws;
    void *user_ptr; /* from buffer_from_ptr */
 
-   amdgpu_bo_handle bo;
+   amdgpu_bo_handle bo; /* NULL for slab entries */
    uint32_t unique_id;
    amdgpu_va_handle va_handle;
    uint64_t va;
@@ -53,6 +66,14 @@ struct amdgpu_winsys_bo {
    /* how many command streams is this bo referenced in? */
    int num_cs_references;
 
+   /* The CS context this bo was last added to or looked up in, and its
+    * index in the buffer list of that context. This makes
+    * amdgpu_lookup_buffer O(1) unless the bo is used by several command
+    * streams at the same time.
+    */
+   uint32_t cs_generation;
+   int cs_index;
+
    /* whether buffer_get_handle or buffer_from_handle was called,
     * it can only transition from false to true
     */
@@ -62,10 +83,25 @@ struct amdgpu_winsys_bo {
    struct pipe_fence_handle *fence[RING_LAST];
 
    struct list_head global_list_item;
+
+   /* Slab entries only: the entry and the buffer it is carved out of. */
+   struct pb_slab_entry slab_entry;
+   struct amdgpu_winsys_bo *real;
+};
+
+struct amdgpu_slab {
+   struct pb_slab base;
+   struct amdgpu_winsys_bo *buffer;
+   struct amdgpu_winsys_bo *entries;
 };
 
 bool amdgpu_bo_can_reclaim(struct pb_buffer *_buf);
 void amdgpu_bo_destroy(struct pb_buffer *_buf);
+bool amdgpu_bo_can_reclaim_slab(void *priv, struct pb_slab_entry *entry);
+struct pb_slab *amdgpu_bo_slab_alloc(void *priv, unsigned heap,
+                                     unsigned entry_size,
+                                     unsigned group_index);
+void amdgpu_bo_slab_free(void *priv, struct pb_slab *pslab);
 void amdgpu_bo_init_functions(struct amdgpu_winsys *ws);
 
 static inline
@@ -50,6 +50,7 @@ amdgpu_fence_create(struct amdgpu_ctx *ctx, unsigned ip_type,
    fence->fence.ip_type = ip_type;
    fence->fence.ip_instance = ip_instance;
    fence->fence.ring = ring;
+   fence->submission_in_progress = true;
    p_atomic_inc(&ctx->refcount);
    return (struct pipe_fence_handle *)fence;
 }
@@ -62,6 +63,7 @@ static void amdgpu_fence_submitted(struct pipe_fence_handle *fence,
 
    rfence->fence.fence = request->seq_no;
    rfence->user_fence_cpu_address = user_fence_cpu_address;
+   p_atomic_set(&rfence->submission_in_progress, false);
 }
 
 static void amdgpu_fence_signalled(struct pipe_fence_handle *fence)
@@ -69,6 +71,7 @@ static void amdgpu_fence_signalled(struct pipe_fence_handle *fence)
    struct amdgpu_fence *rfence = (struct amdgpu_fence*)fence;
 
    rfence->signalled = true;
+   p_atomic_set(&rfence->submission_in_progress, false);
 }
 
 bool amdgpu_fence_wait(struct pipe_fence_handle *fence, uint64_t timeout,
@@ -88,6 +91,13 @@ bool amdgpu_fence_wait(struct pipe_fence_handle *fence, uint64_t timeout,
    else
       abs_timeout = os_time_get_absolute_timeout(timeout);
 
+   /* The fence might not have a number assigned if its IB is being
+    * submitted in the other thread right now. Wait until the submission
+    * is done. */
+   if (!os_wait_until_zero_abs_timeout(&rfence->submission_in_progress,
+                                       abs_timeout))
+      return false;
+
    user_fence_cpu = rfence->user_fence_cpu_address;
    if (user_fence_cpu && *user_fence_cpu >= rfence->fence.fence) {
 	rfence->signalled = true;
@@ -210,6 +220,12 @@ static bool amdgpu_get_new_ib(struct amdgpu_cs *cs)
    cs->base.cdw = 0;
    cs->base.buf = NULL;
 
+   /* Buffers added from now on go to a new buffer list. 0 is never used,
+    * so freshly created buffers never match. */
+   do {
+      cs->csc->generation = p_atomic_inc_return(&cs->ctx->ws->next_cs_generation);
+   } while (!cs->csc->generation);
+
    /* Allocate a new buffer for IBs if the current buffer is all used. */
    if (!cs->big_ib_buffer ||
        cs->used_ib_space + ib_size > cs->big_ib_buffer->size) {
@@ -237,13 +253,14 @@ static bool amdgpu_get_new_ib(struct amdgpu_cs *cs)
       cs->big_ib_winsys_buffer = (struct amdgpu_winsys_bo*)cs->big_ib_buffer;
    }
 
-   cs->ib.ib_mc_address = cs->big_ib_winsys_buffer->va + cs->used_ib_space;
+   cs->csc->ib.ib_mc_address = cs->big_ib_winsys_buffer->va +
+                               cs->used_ib_space;
    cs->base.buf = (uint32_t*)(cs->ib_mapped + cs->used_ib_space);
    cs->base.max_dw = ib_size / 4;
    return true;
 }
 
-static boolean amdgpu_init_cs_context(struct amdgpu_cs *cs,
+static boolean amdgpu_init_cs_context(struct amdgpu_cs_context *cs,
                                       enum ring_type ring_type)
 {
    int i;
@@ -300,7 +317,7 @@ static boolean amdgpu_init_cs_context(struct amdgpu_cs *cs,
    return TRUE;
 }
 
-static void amdgpu_cs_context_cleanup(struct amdgpu_cs *cs)
+static void amdgpu_cs_context_cleanup(struct amdgpu_cs_context *cs)
 {
    unsigned i;
 
@@ -311,7 +328,13 @@ static void amdgpu_cs_context_cleanup(struct amdgpu_cs *cs)
       cs->flags[i] = 0;
    }
 
+   for (i = 0; i < cs->num_fence_dependencies; i++)
+      amdgpu_fence_reference(&cs->fence_dependencies[i], NULL);
+
+   amdgpu_fence_reference(&cs->fence, NULL);
+
    cs->num_buffers = 0;
+   cs->num_fence_dependencies = 0;
    cs->used_gart = 0;
    cs->used_vram = 0;
 
@@ -320,13 +343,14 @@ static void amdgpu_cs_context_cleanup(struct amdgpu_cs *cs)
    }
 }
 
-static void amdgpu_destroy_cs_context(struct amdgpu_cs *cs)
+static void amdgpu_destroy_cs_context(struct amdgpu_cs_context *cs)
 {
    amdgpu_cs_context_cleanup(cs);
    FREE(cs->flags);
    FREE(cs->buffers);
    FREE(cs->handles);
    FREE(cs->request.dependencies);
+   FREE(cs->fence_dependencies);
 }
 
 
@@ -350,31 +374,59 @@ amdgpu_cs_create(struct radeon_winsys_ctx *rwctx,
    cs->flush_data = flush_ctx;
    cs->base.ring_type = ring_type;
 
-   if (!amdgpu_init_cs_context(cs, ring_type)) {
+   if (!amdgpu_init_cs_context(&cs->csc1, ring_type)) {
       FREE(cs);
       return NULL;
    }
 
+   if (!amdgpu_init_cs_context(&cs->csc2, ring_type)) {
+      amdgpu_destroy_cs_context(&cs->csc1);
+      FREE(cs);
+      return NULL;
+   }
+
+   /* Set the first submission context as current. */
+   cs->csc = &cs->csc1;
+   cs->cst = &cs->csc2;
+
    if (!amdgpu_get_new_ib(cs)) {
-      amdgpu_destroy_cs_context(cs);
+      amdgpu_destroy_cs_context(&cs->csc2);
+      amdgpu_destroy_cs_context(&cs->csc1);
       FREE(cs);
       return NULL;
    }
 
+   pipe_semaphore_init(&cs->flush_completed, 1);
+
    p_atomic_inc(&ctx->ws->num_cs);
    return &cs->base;
 }
 
 #define OUT_CS(cs, value) (cs)->buf[(cs)->cdw++] = (value)
 
-int amdgpu_lookup_buffer(struct amdgpu_cs *cs, struct amdgpu_winsys_bo *bo)
+int amdgpu_lookup_buffer(struct amdgpu_cs_context *cs, struct amdgpu_winsys_bo *bo)
 {
    unsigned hash = bo->unique_id & (Elements(cs->buffer_indices_hashlist)-1);
-   int i = cs->buffer_indices_hashlist[hash];
+   int i = bo->cs_index;
+
+   /* Fast path: the bo was last used with this context. Another thread may
+    * be updating the fields for a different context at the same time, so
+    * verify the index before trusting it. */
+   if (bo->cs_generation == cs->generation &&
+       i >= 0 && i < cs->num_buffers && cs->buffers[i].bo == bo)
+      return i;
+
+   i = cs->buffer_indices_hashlist[hash];
 
    /* not found or found */
-   if (i == -1 || cs->buffers[i].bo == bo)
+   if (i == -1)
+      return -1;
+
+   if (cs->buffers[i].bo == bo) {
+      bo->cs_generation = cs->generation;
+      bo->cs_index = i;
       return i;
+   }
 
    /* Hash collision, look for the BO in the list of buffers linearly. */
    for (i = cs->num_buffers - 1; i >= 0; i--) {
@@ -389,13 +441,15 @@ int amdgpu_lookup_buffer(struct amdgpu_cs *cs, struct amdgpu_winsys_bo *bo)
           * will collide here: ^ and here:   ^,
           * meaning that we should get very few collisions in the end. */
          cs->buffer_indices_hashlist[hash] = i;
+         bo->cs_generation = cs->generation;
+         bo->cs_index = i;
          return i;
       }
    }
    return -1;
 }
 
-static unsigned amdgpu_add_buffer(struct amdgpu_cs *cs,
+static unsigned amdgpu_add_buffer(struct amdgpu_cs_context *cs,
                                  struct amdgpu_winsys_bo *bo,
                                  enum radeon_bo_usage usage,
                                  enum radeon_bo_domain domains,
@@ -448,6 +502,8 @@ static unsigned amdgpu_add_buffer(struct amdgpu_cs *cs,
    buffer->domains = domains;
 
    cs->buffer_indices_hashlist[hash] = cs->num_buffers;
+   bo->cs_generation = cs->generation;
+   bo->cs_index = cs->num_buffers;
 
    *added_domains = domains;
    return cs->num_buffers++;
@@ -462,11 +518,23 @@ static unsigned amdgpu_cs_add_buffer(struct radeon_winsys_cs *rcs,
    /* Don't use the "domains" parameter. Amdgpu doesn't support changing
     * the buffer placement during command submission.
     */
-   struct amdgpu_cs *cs = amdgpu_cs(rcs);
+   struct amdgpu_cs_context *cs = amdgpu_cs(rcs)->csc;
    struct amdgpu_winsys_bo *bo = (struct amdgpu_winsys_bo*)buf;
    enum radeon_bo_domain added_domains;
-   unsigned index = amdgpu_add_buffer(cs, bo, usage, bo->initial_domain,
-                                     priority, &added_domains);
+   unsigned index;
+
+   /* The kernel only knows about the buffer a slab entry is carved out of.
+    * Add that one too, the entry itself is only tracked for fences and
+    * buffer usage queries.
+    */
+   if (bo->real) {
+      amdgpu_cs_add_buffer(rcs, &bo->real->base, usage, domains, priority);
+      return amdgpu_add_buffer(cs, bo, usage, bo->initial_domain,
+                               priority, &added_domains);
+   }
+
+   index = amdgpu_add_buffer(cs, bo, usage, bo->initial_domain,
+                             priority, &added_domains);
 
    if (added_domains & RADEON_DOMAIN_GTT)
       cs->used_gart += bo->base.size;
@@ -481,7 +549,7 @@ static int amdgpu_cs_lookup_buffer(struct radeon_winsys_cs *rcs,
 {
    struct amdgpu_cs *cs = amdgpu_cs(rcs);
 
-   return amdgpu_lookup_buffer(cs, (struct amdgpu_winsys_bo*)buf);
+   return amdgpu_lookup_buffer(cs->csc, (struct amdgpu_winsys_bo*)buf);
 }
 
 static boolean amdgpu_cs_validate(struct radeon_winsys_cs *rcs)
@@ -493,8 +561,8 @@ static boolean amdgpu_cs_memory_below_limit(struct radeon_winsys_cs *rcs, uint64
 {
    struct amdgpu_cs *cs = amdgpu_cs(rcs);
    boolean status =
-         (cs->used_gart + gtt) < cs->ctx->ws->info.gart_size * 0.7 &&
-         (cs->used_vram + vram) < cs->ctx->ws->info.vram_size * 0.7;
+         (cs->csc->used_gart + gtt) < cs->ctx->ws->info.gart_size * 0.7 &&
+         (cs->csc->used_vram + vram) < cs->ctx->ws->info.vram_size * 0.7;
 
    return status;
 }
@@ -502,7 +570,7 @@ static boolean amdgpu_cs_memory_below_limit(struct radeon_winsys_cs *rcs, uint64
 static unsigned amdgpu_cs_get_buffer_list(struct radeon_winsys_cs *rcs,
                                           struct radeon_bo_list_item *list)
 {
-    struct amdgpu_cs *cs = amdgpu_cs(rcs);
+    struct amdgpu_cs_context *cs = amdgpu_cs(rcs)->csc;
     int i;
 
     if (list) {
@@ -515,36 +583,28 @@ static unsigned amdgpu_cs_get_buffer_list(struct radeon_winsys_cs *rcs,
     return cs->num_buffers;
 }
 
-static void amdgpu_cs_do_submission(struct amdgpu_cs *cs,
-                                    struct pipe_fence_handle **out_fence)
+/* Since the kernel driver doesn't synchronize execution between different
+ * rings automatically, we have to add fence dependencies manually.
+ *
+ * This must be called with bo_fence_lock held, before the fences of the
+ * buffers are replaced by the fence of this CS.
+ */
+static void amdgpu_add_fence_dependencies(struct amdgpu_cs *acs)
 {
-   struct amdgpu_winsys *ws = cs->ctx->ws;
-   struct pipe_fence_handle *fence;
-   int i, j, r;
-
-   /* Create a fence. */
-   fence = amdgpu_fence_create(cs->ctx,
-                               cs->request.ip_type,
-                               cs->request.ip_instance,
-                               cs->request.ring);
-   if (out_fence)
-      amdgpu_fence_reference(out_fence, fence);
+   struct amdgpu_cs_context *cs = acs->csc;
+   int i, j;
 
-   cs->request.number_of_dependencies = 0;
+   cs->num_fence_dependencies = 0;
 
-   /* Since the kernel driver doesn't synchronize execution between different
-    * rings automatically, we have to add fence dependencies manually. */
-   pipe_mutex_lock(ws->bo_fence_lock);
    for (i = 0; i < cs->num_buffers; i++) {
       for (j = 0; j < RING_LAST; j++) {
-         struct amdgpu_cs_fence *dep;
          unsigned idx;
 
          struct amdgpu_fence *bo_fence = (void *)cs->buffers[i].bo->fence[j];
          if (!bo_fence)
             continue;
 
-         if (bo_fence->ctx == cs->ctx &&
+         if (bo_fence->ctx == acs->ctx &&
              bo_fence->fence.ip_type == cs->request.ip_type &&
              bo_fence->fence.ip_instance == cs->request.ip_instance &&
              bo_fence->fence.ring == cs->request.ring)
@@ -553,27 +613,123 @@ static void amdgpu_cs_do_submission(struct amdgpu_cs *cs,
          if (amdgpu_fence_wait((void *)bo_fence, 0, false))
             continue;
 
-         idx = cs->request.number_of_dependencies++;
-         if (idx >= cs->max_dependencies) {
+         idx = cs->num_fence_dependencies++;
+         if (idx >= cs->max_fence_dependencies) {
             unsigned size;
 
-            cs->max_dependencies = idx + 8;
-            size = cs->max_dependencies * sizeof(struct amdgpu_cs_fence);
-            cs->request.dependencies = realloc(cs->request.dependencies, size);
+            cs->max_fence_dependencies = idx + 8;
+            size = cs->max_fence_dependencies * sizeof(struct pipe_fence_handle*);
+            cs->fence_dependencies = realloc(cs->fence_dependencies, size);
+            /* Clear the newly-allocated elements. */
+            memset(cs->fence_dependencies + idx, 0,
+                   8 * sizeof(struct pipe_fence_handle*));
          }
 
-         dep = &cs->request.dependencies[idx];
-         memcpy(dep, &bo_fence->fence, sizeof(*dep));
+         amdgpu_fence_reference(&cs->fence_dependencies[idx],
+                                (struct pipe_fence_handle*)bo_fence);
+      }
+   }
+}
+
+DEBUG_GET_ONCE_BOOL_OPTION(all_bos, "RADEON_ALL_BOS", FALSE)
+
+/* Build the buffer list and submit the IB. This is called either from
+ * amdgpu_cs_flush directly or from the submission thread, and cleans up
+ * the context when it's done.
+ */
+void amdgpu_cs_submit_ib(struct amdgpu_cs *acs, struct amdgpu_cs_context *cs)
+{
+   struct amdgpu_winsys *ws = acs->ctx->ws;
+   int i, r;
+
+   cs->request.number_of_dependencies = 0;
+
+   for (i = 0; i < cs->num_fence_dependencies; i++) {
+      struct amdgpu_fence *fence =
+         (struct amdgpu_fence*)cs->fence_dependencies[i];
+      unsigned idx;
+
+      /* Fences are queued in the order they are created, so all of them
+       * have been submitted by now, unless another thread is submitting
+       * its own IB synchronously. */
+      os_wait_until_zero(&fence->submission_in_progress,
+                         PIPE_TIMEOUT_INFINITE);
+
+      /* The submission of the fence failed or it has signalled already. */
+      if (fence->signalled)
+         continue;
+
+      idx = cs->request.number_of_dependencies++;
+      if (idx >= cs->max_dependencies) {
+         unsigned size;
+
+         cs->max_dependencies = idx + 8;
+         size = cs->max_dependencies * sizeof(struct amdgpu_cs_fence);
+         cs->request.dependencies = realloc(cs->request.dependencies, size);
+      }
+
+      memcpy(&cs->request.dependencies[idx], &fence->fence,
+             sizeof(struct amdgpu_cs_fence));
+   }
+
+   /* Use a buffer list containing all allocated buffers if requested. */
+   if (debug_get_option_all_bos()) {
+      struct amdgpu_winsys_bo *bo;
+      amdgpu_bo_handle *handles;
+      unsigned num = 0;
+
+      pipe_mutex_lock(ws->global_bo_list_lock);
+
+      handles = malloc(sizeof(handles[0]) * ws->num_buffers);
+      if (!handles) {
+         pipe_mutex_unlock(ws->global_bo_list_lock);
+         amdgpu_fence_signalled(cs->fence);
+         goto cleanup;
+      }
+
+      LIST_FOR_EACH_ENTRY(bo, &ws->global_bo_list, global_list_item) {
+         assert(num < ws->num_buffers);
+         handles[num++] = bo->bo;
+      }
+
+      r = amdgpu_bo_list_create(ws->dev, ws->num_buffers,
+                                handles, NULL,
+                                &cs->request.resources);
+      free(handles);
+      pipe_mutex_unlock(ws->global_bo_list_lock);
+   } else {
+      unsigned num_handles = 0;
+
+      /* Slab entries don't have a handle; the buffers they belong to are
+       * in the list already. */
+      for (i = 0; i < cs->num_buffers; i++) {
+         if (!cs->handles[i])
+            continue;
+
+         cs->handles[num_handles] = cs->handles[i];
+         cs->flags[num_handles] = cs->flags[i];
+         num_handles++;
       }
+
+      r = amdgpu_bo_list_create(ws->dev, num_handles,
+                                cs->handles, cs->flags,
+                                &cs->request.resources);
+   }
+
+   if (r) {
+      fprintf(stderr, "amdgpu: resource list creation failed (%d)\n", r);
+      cs->request.resources = NULL;
+      amdgpu_fence_signalled(cs->fence);
+      goto cleanup;
    }
 
    cs->request.fence_info.handle = NULL;
    if (cs->request.ip_type != AMDGPU_HW_IP_UVD && cs->request.ip_type != AMDGPU_HW_IP_VCE) {
-	cs->request.fence_info.handle = cs->ctx->user_fence_bo;
-	cs->request.fence_info.offset = cs->base.ring_type;
+	cs->request.fence_info.handle = acs->ctx->user_fence_bo;
+	cs->request.fence_info.offset = acs->base.ring_type;
    }
 
-   r = amdgpu_cs_submit(cs->ctx->ctx, 0, &cs->request, 1);
+   r = amdgpu_cs_submit(acs->ctx->ctx, 0, &cs->request, 1);
    if (r) {
       if (r == -ENOMEM)
          fprintf(stderr, "amdgpu: Not enough memory for command submission.\n");
@@ -581,30 +737,38 @@ static void amdgpu_cs_do_submission(struct amdgpu_cs *cs,
          fprintf(stderr, "amdgpu: The CS has been rejected, "
                  "see dmesg for more information.\n");
 
-      amdgpu_fence_signalled(fence);
+      amdgpu_fence_signalled(cs->fence);
    } else {
       /* Success. */
       uint64_t *user_fence = NULL;
       if (cs->request.ip_type != AMDGPU_HW_IP_UVD && cs->request.ip_type != AMDGPU_HW_IP_VCE)
-         user_fence = cs->ctx->user_fence_cpu_address_base +
+         user_fence = acs->ctx->user_fence_cpu_address_base +
                       cs->request.fence_info.offset;
-      amdgpu_fence_submitted(fence, &cs->request, user_fence);
-
-      for (i = 0; i < cs->num_buffers; i++)
-         amdgpu_fence_reference(&cs->buffers[i].bo->fence[cs->base.ring_type],
-                                fence);
+      amdgpu_fence_submitted(cs->fence, &cs->request, user_fence);
    }
-   pipe_mutex_unlock(ws->bo_fence_lock);
-   amdgpu_fence_reference(&fence, NULL);
+
+   /* Cleanup. */
+   amdgpu_bo_list_destroy(cs->request.resources);
+
+cleanup:
+   amdgpu_cs_context_cleanup(cs);
 }
 
+/*
+ * Make sure previous submission of this cs are completed
+ */
 static void amdgpu_cs_sync_flush(struct radeon_winsys_cs *rcs)
 {
-   /* no-op */
+   struct amdgpu_cs *cs = amdgpu_cs(rcs);
+
+   /* Wait for any pending ioctl of this CS to complete. */
+   if (cs->ctx->ws->thread) {
+      pipe_semaphore_wait(&cs->flush_completed);
+      pipe_semaphore_signal(&cs->flush_completed);
+   }
 }
 
 DEBUG_GET_ONCE_BOOL_OPTION(noop, "RADEON_NOOP", FALSE)
-DEBUG_GET_ONCE_BOOL_OPTION(all_bos, "RADEON_ALL_BOS", FALSE)
 
 static void amdgpu_cs_flush(struct radeon_winsys_cs *rcs,
                             unsigned flags,
@@ -641,56 +805,54 @@ static void amdgpu_cs_flush(struct radeon_winsys_cs *rcs,
 
    /* If the CS is not empty or overflowed.... */
    if (cs->base.cdw && cs->base.cdw <= cs->base.max_dw && !debug_get_option_noop()) {
-      int r;
-
-      /* Use a buffer list containing all allocated buffers if requested. */
-      if (debug_get_option_all_bos()) {
-         struct amdgpu_winsys_bo *bo;
-         amdgpu_bo_handle *handles;
-         unsigned num = 0;
+      struct amdgpu_cs_context *cur = cs->csc;
+      unsigned i, num_buffers = cur->num_buffers;
 
-         pipe_mutex_lock(ws->global_bo_list_lock);
-
-         handles = malloc(sizeof(handles[0]) * ws->num_buffers);
-         if (!handles) {
-            pipe_mutex_unlock(ws->global_bo_list_lock);
-            goto cleanup;
-         }
-
-         LIST_FOR_EACH_ENTRY(bo, &ws->global_bo_list, global_list_item) {
-            assert(num < ws->num_buffers);
-            handles[num++] = bo->bo;
-         }
+      cur->ib.size = cs->base.cdw;
+      cs->used_ib_space += cs->base.cdw * 4;
 
-         r = amdgpu_bo_list_create(ws->dev, ws->num_buffers,
-                                   handles, NULL,
-                                   &cs->request.resources);
-         free(handles);
-         pipe_mutex_unlock(ws->global_bo_list_lock);
+      /* Create a fence. */
+      amdgpu_fence_reference(&cur->fence, NULL);
+      cur->fence = amdgpu_fence_create(cs->ctx,
+                                       cur->request.ip_type,
+                                       cur->request.ip_instance,
+                                       cur->request.ring);
+      if (fence)
+         amdgpu_fence_reference(fence, cur->fence);
+
+      /* The other context must not be in use by the thread anymore. */
+      if (ws->thread)
+         pipe_semaphore_wait(&cs->flush_completed);
+
+      /* Gather the dependencies and set the new buffer fences. The queueing
+       * is done under the same lock, so that the thread submits the IBs in
+       * the same order as their fences appear in the buffers. */
+      pipe_mutex_lock(ws->bo_fence_lock);
+      amdgpu_add_fence_dependencies(cs);
+
+      for (i = 0; i < num_buffers; i++)
+         amdgpu_fence_reference(&cur->buffers[i].bo->fence[cs->base.ring_type],
+                                cur->fence);
+
+      /* Swap command streams. "cst" is going to be submitted. */
+      cs->csc = cs->cst;
+      cs->cst = cur;
+
+      if (ws->thread)
+         amdgpu_ws_queue_cs(ws, cs);
+      pipe_mutex_unlock(ws->bo_fence_lock);
+
+      /* Submit. */
+      if (ws->thread) {
+         if (!(flags & RADEON_FLUSH_ASYNC))
+            amdgpu_cs_sync_flush(rcs);
       } else {
-         r = amdgpu_bo_list_create(ws->dev, cs->num_buffers,
-                                   cs->handles, cs->flags,
-                                   &cs->request.resources);
-      }
-
-      if (r) {
-         fprintf(stderr, "amdgpu: resource list creation failed (%d)\n", r);
-         cs->request.resources = NULL;
-	 goto cleanup;
+         amdgpu_cs_submit_ib(cs, cur);
       }
-
-      cs->ib.size = cs->base.cdw;
-      cs->used_ib_space += cs->base.cdw * 4;
-
-      amdgpu_cs_do_submission(cs, fence);
-
-      /* Cleanup. */
-      if (cs->request.resources)
-         amdgpu_bo_list_destroy(cs->request.resources);
+   } else {
+      amdgpu_cs_context_cleanup(cs->csc);
    }
 
-cleanup:
-   amdgpu_cs_context_cleanup(cs);
    amdgpu_get_new_ib(cs);
 
    ws->num_cs_flushes++;
@@ -700,9 +862,12 @@ static void amdgpu_cs_destroy(struct radeon_winsys_cs *rcs)
 {
    struct amdgpu_cs *cs = amdgpu_cs(rcs);
 
-   amdgpu_destroy_cs_context(cs);
+   amdgpu_cs_sync_flush(rcs);
+   pipe_semaphore_destroy(&cs->flush_completed);
    p_atomic_dec(&cs->ctx->ws->num_cs);
    pb_reference(&cs->big_ib_buffer, NULL);
+   amdgpu_destroy_cs_context(&cs->csc1);
+   amdgpu_destroy_cs_context(&cs->csc2);
    FREE(cs);
 }
 
@@ -30,6 +30,7 @@
  */
 
 #include "amdgpu_winsys.h"
+#include "util/u_hash.h"
 
 #ifndef NO_ENTRIES
 #define NO_ENTRIES 32
@@ -276,10 +277,9 @@ static int compute_level(struct amdgpu_winsys *ws,
    return 0;
 }
 
-static int amdgpu_surface_init(struct radeon_winsys *rws,
-                               struct radeon_surf *surf)
+static int amdgpu_surface_compute(struct amdgpu_winsys *ws,
+                                  struct radeon_surf *surf)
 {
-   struct amdgpu_winsys *ws = (struct amdgpu_winsys*)rws;
    unsigned level, mode, type;
    bool compressed;
    ADDR_COMPUTE_SURFACE_INFO_INPUT AddrSurfInfoIn = {0};
@@ -459,6 +459,94 @@ static int amdgpu_surface_init(struct radeon_winsys *rws,
    return 0;
 }
 
+static void amdgpu_surface_get_key(const struct radeon_surf *surf,
+                                   struct amdgpu_surface_key *key)
+{
+   key->npix_x = surf->npix_x;
+   key->npix_y = surf->npix_y;
+   key->npix_z = surf->npix_z;
+   key->blk_w = surf->blk_w;
+   key->blk_h = surf->blk_h;
+   key->blk_d = surf->blk_d;
+   key->array_size = surf->array_size;
+   key->last_level = surf->last_level;
+   key->bpe = surf->bpe;
+   key->nsamples = surf->nsamples;
+   key->flags = surf->flags;
+   key->bankw = surf->bankw;
+   key->bankh = surf->bankh;
+   key->mtilea = surf->mtilea;
+   key->tile_split = surf->tile_split;
+   key->stencil_tile_split = surf->stencil_tile_split;
+}
+
+/* Copy the fields amdgpu_surface_compute would have set. */
+static void amdgpu_surface_copy_layout(struct radeon_surf *dst,
+                                       const struct radeon_surf *src)
+{
+   unsigned num_levels = src->last_level + 1;
+
+   dst->bo_size = src->bo_size;
+   dst->bo_alignment = src->bo_alignment;
+   dst->bankw = src->bankw;
+   dst->bankh = src->bankh;
+   dst->mtilea = src->mtilea;
+   dst->tile_split = src->tile_split;
+   dst->stencil_tile_split = src->stencil_tile_split;
+   dst->pipe_config = src->pipe_config;
+   dst->dcc_size = src->dcc_size;
+   dst->dcc_alignment = src->dcc_alignment;
+   memcpy(dst->level, src->level, num_levels * sizeof(src->level[0]));
+   memcpy(dst->tiling_index, src->tiling_index,
+          num_levels * sizeof(src->tiling_index[0]));
+
+   if (src->level[0].mode == RADEON_SURF_MODE_2D)
+      dst->num_banks = src->num_banks;
+
+   if (src->flags & RADEON_SURF_SBUFFER) {
+      dst->stencil_offset = src->stencil_offset;
+      memcpy(dst->stencil_level, src->stencil_level,
+             num_levels * sizeof(src->stencil_level[0]));
+      memcpy(dst->stencil_tiling_index, src->stencil_tiling_index,
+             num_levels * sizeof(src->stencil_tiling_index[0]));
+   }
+}
+
+/* Addrlib is slow and the same few layouts tend to be computed over and
+ * over, e.g. for transient render targets, so remember the most recent
+ * ones.  Failures aren't cached. */
+static int amdgpu_surface_init(struct radeon_winsys *rws,
+                               struct radeon_surf *surf)
+{
+   struct amdgpu_winsys *ws = (struct amdgpu_winsys*)rws;
+   struct amdgpu_surface_cache_entry *entry;
+   struct amdgpu_surface_key key;
+   int r;
+
+   amdgpu_surface_get_key(surf, &key);
+   entry = &ws->surf_cache[util_hash_crc32(&key, sizeof(key)) %
+                           AMDGPU_SURFACE_CACHE_SIZE];
+
+   pipe_mutex_lock(ws->surf_cache_lock);
+   if (entry->valid && !memcmp(&entry->key, &key, sizeof(key))) {
+      amdgpu_surface_copy_layout(surf, &entry->surf);
+      pipe_mutex_unlock(ws->surf_cache_lock);
+      return 0;
+   }
+   pipe_mutex_unlock(ws->surf_cache_lock);
+
+   r = amdgpu_surface_compute(ws, surf);
+   if (r)
+      return r;
+
+   pipe_mutex_lock(ws->surf_cache_lock);
+   entry->valid = true;
+   entry->key = key;
+   entry->surf = *surf;
+   pipe_mutex_unlock(ws->surf_cache_lock);
+   return 0;
+}
+
 static int amdgpu_surface_best(struct radeon_winsys *rws,
                                struct radeon_surf *surf)
 {
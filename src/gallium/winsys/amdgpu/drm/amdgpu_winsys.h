@@ -33,6 +33,7 @@
 #define AMDGPU_WINSYS_H
 
 #include "pipebuffer/pb_cache.h"
+#include "pipebuffer/pb_slab.h"
 #include "gallium/drivers/radeon/radeon_winsys.h"
 #include "addrlib/addrinterface.h"
 #include "os/os_thread.h"
@@ -40,10 +41,39 @@
 
 struct amdgpu_cs;
 
+#define AMDGPU_SURFACE_CACHE_SIZE 64
+
+/* The inputs of amdgpu_surface_init, including the tiling hints. */
+struct amdgpu_surface_key {
+   uint32_t npix_x;
+   uint32_t npix_y;
+   uint32_t npix_z;
+   uint32_t blk_w;
+   uint32_t blk_h;
+   uint32_t blk_d;
+   uint32_t array_size;
+   uint32_t last_level;
+   uint32_t bpe;
+   uint32_t nsamples;
+   uint32_t flags;
+   uint32_t bankw;
+   uint32_t bankh;
+   uint32_t mtilea;
+   uint32_t tile_split;
+   uint32_t stencil_tile_split;
+};
+
+struct amdgpu_surface_cache_entry {
+   bool valid;
+   struct amdgpu_surface_key key;
+   struct radeon_surf surf;
+};
+
 struct amdgpu_winsys {
    struct radeon_winsys base;
    struct pipe_reference reference;
    struct pb_cache bo_cache;
+   struct pb_slabs bo_slabs;
 
    amdgpu_device_handle dev;
 
@@ -51,6 +81,7 @@ struct amdgpu_winsys {
 
    int num_cs; /* The number of command streams created. */
    uint32_t next_bo_unique_id;
+   uint32_t next_cs_generation;
    uint64_t allocated_vram;
    uint64_t allocated_gtt;
    uint64_t buffer_wait_time; /* time spent in buffer_wait in ns */
@@ -64,10 +95,22 @@ struct amdgpu_winsys {
    uint32_t rev_id;
    unsigned family;
 
+   /* Recently computed surface layouts, indexed by the key hash. */
+   pipe_mutex surf_cache_lock;
+   struct amdgpu_surface_cache_entry surf_cache[AMDGPU_SURFACE_CACHE_SIZE];
+
    /* List of all allocated buffers */
    pipe_mutex global_bo_list_lock;
    struct list_head global_bo_list;
    unsigned num_buffers;
+
+   /* rings submission thread */
+   pipe_mutex cs_stack_lock;
+   pipe_semaphore cs_queued;
+   pipe_thread thread;
+   int kill_thread;
+   int ncs;
+   struct amdgpu_cs *cs_stack[RING_LAST];
 };
 
 static inline struct amdgpu_winsys *
@@ -76,6 +119,7 @@ amdgpu_winsys(struct radeon_winsys *base)
    return (struct amdgpu_winsys*)base;
 }
 
+void amdgpu_ws_queue_cs(struct amdgpu_winsys *ws, struct amdgpu_cs *cs);
 void amdgpu_surface_init_functions(struct amdgpu_winsys *ws);
 ADDR_HANDLE amdgpu_addr_create(struct amdgpu_winsys *ws);
 
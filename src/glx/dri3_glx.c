@@ -160,7 +160,17 @@ glx_dri3_show_fps(struct loader_dri3_drawable *draw, uint64_t current_ust)
          fprintf(stderr, "libGL: FPS = %.1f\n",
                  ((uint64_t) priv->frames * 1000000) /
                  (double)(current_ust - priv->previous_ust));
+         if (draw->idle_latency_count) {
+            fprintf(stderr, "libGL: back buffers = %d, present to idle "
+                    "avg = %.1f ms, max = %.1f ms\n", draw->num_back,
+                    draw->idle_latency_total /
+                    (double) (draw->idle_latency_count * 1000),
+                    draw->idle_latency_max / 1000.0);
+         }
       }
+      draw->idle_latency_total = 0;
+      draw->idle_latency_max = 0;
+      draw->idle_latency_count = 0;
       priv->frames = 0;
       priv->previous_ust = current_ust;
    }
@@ -364,6 +364,12 @@ struct glx_context
      */
    GLint maxSmallRenderCommandSize;
 
+    /**
+     * Number of times the rendering command buffer has been flushed.  Lets
+     * code that keeps pointers into \c buf notice that the data is gone.
+     */
+   unsigned renderFlushCount;
+
     /**
      * Major opcode for the extension.  Copied here so a lookup isn't
      * needed.
@@ -456,6 +462,13 @@ extern void __glFreeAttributeState(struct glx_context *);
  */
 #define __GLX_RENDER_CMD_SIZE_LIMIT 4096
 
+/**
+ * Upper bound for the rendering command buffer when the server supports
+ * BIG-REQUESTS.  Bigger buffers mean fewer GLXRender requests, which
+ * matters most on remote displays.
+ */
+#define __GLX_MAX_RENDER_BUFFER_SIZE (1024 * 1024)
+
 /**
  * One of these records exists per screen of the display.  It contains
  * a pointer to the config data for that screen (if the screen supports GL).
@@ -994,6 +994,7 @@ __glXFlushRenderBuffer(struct glx_context * ctx, GLubyte * pc)
 
    /* Reset pointer and return it */
    ctx->pc = ctx->buf;
+   ctx->renderFlushCount++;
    return ctx->pc;
 }
 
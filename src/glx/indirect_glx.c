@@ -389,6 +389,20 @@ indirect_create_context(struct glx_screen *psc,
     */
 
    bufSize = (XMaxRequestSize(psc->dpy) * 4) - sz_xGLXRenderReq;
+
+   /*
+    ** GLXRender requests are sent through xcb, which switches to the
+    ** BIG-REQUESTS encoding by itself when a request doesn't fit.  Use it
+    ** to send more commands per request when the server supports it.
+    */
+   if (XExtendedMaxRequestSize(psc->dpy) * 4 > bufSize + sz_xGLXRenderReq) {
+      long extSize = XExtendedMaxRequestSize(psc->dpy) * 4;
+
+      if (extSize > __GLX_MAX_RENDER_BUFFER_SIZE)
+         extSize = __GLX_MAX_RENDER_BUFFER_SIZE;
+      if (extSize - sz_xGLXRenderReq > bufSize)
+         bufSize = extSize - sz_xGLXRenderReq;
+   }
    gc->buf = malloc(bufSize);
    if (!gc->buf) {
       free(gc->client_state_private);
@@ -668,6 +668,95 @@ emit_DrawArrays_header_old(struct glx_context * gc,
 }
 
 
+/**
+ * Try to append the vertices of a \c glDrawArrays call to the DrawArrays
+ * command emitted by the previous call.  This is only possible if nothing
+ * else was written to the command buffer since, the array layout is the
+ * same, and the primitive type is one that doesn't connect vertices across
+ * primitives.  Applications drawing lots of small batches this way then
+ * end up with few, larger commands on the wire.
+ *
+ * \returns
+ * \c GL_TRUE if the vertices were appended.
+ */
+static GLboolean
+append_DrawArrays_old(struct glx_context * gc,
+                      struct array_state_vector *arrays,
+                      GLenum mode, GLint first, GLsizei count)
+{
+   GLubyte *const cmd = arrays->last_DrawArrays_pc;
+   size_t single_vertex_size;
+   size_t added_size;
+   unsigned prim_size;
+   unsigned i;
+   GLubyte *pc;
+
+
+   switch (mode) {
+   case GL_POINTS:
+      prim_size = 1;
+      break;
+   case GL_LINES:
+      prim_size = 2;
+      break;
+   case GL_TRIANGLES:
+      prim_size = 3;
+      break;
+   case GL_QUADS:
+      prim_size = 4;
+      break;
+   default:
+      return GL_FALSE;
+   }
+
+   if (cmd == NULL || gc->pc != arrays->last_DrawArrays_end
+       || gc->renderFlushCount != arrays->last_DrawArrays_flush) {
+      return GL_FALSE;
+   }
+
+   /* Leftover vertices of an incomplete primitive would get combined with
+    * the appended ones.
+    */
+   if ((count % prim_size) != 0
+       || (*(uint32_t *) (cmd + 4) % prim_size) != 0) {
+      return GL_FALSE;
+   }
+
+   if (*(uint32_t *) (cmd + 8) != arrays->enabled_client_array_count
+       || *(uint32_t *) (cmd + 12) != mode
+       || memcmp(cmd + 16, arrays->array_info_cache,
+                 arrays->array_info_cache_size) != 0) {
+      return GL_FALSE;
+   }
+
+   single_vertex_size = 0;
+   for (i = 0; i < arrays->num_arrays; i++) {
+      if (arrays->arrays[i].enabled) {
+         single_vertex_size += __GLX_PAD(arrays->arrays[i].element_size);
+      }
+   }
+
+   added_size = single_vertex_size * count;
+   if (*(uint16_t *) (cmd + 0) + added_size > gc->maxSmallRenderCommandSize
+       || (gc->pc + added_size) >= gc->bufEnd) {
+      return GL_FALSE;
+   }
+
+   pc = gc->pc;
+   for (i = 0; i < count; i++) {
+      pc = emit_element_old(pc, arrays, i + first);
+   }
+
+   *(uint16_t *) (cmd + 0) += added_size;
+   *(uint32_t *) (cmd + 4) += count;
+
+   gc->pc = pc;
+   arrays->last_DrawArrays_end = pc;
+
+   return GL_TRUE;
+}
+
+
 /**
  */
 void
@@ -685,6 +774,13 @@ emit_DrawArrays_old(GLenum mode, GLint first, GLsizei count)
    size_t total_sent = 0;
 
 
+   if (append_DrawArrays_old(gc, arrays, mode, first, count)) {
+      if (gc->pc > gc->limit) {
+         (void) __glXFlushRenderBuffer(gc, gc->pc);
+      }
+      return;
+   }
+
    pc = emit_DrawArrays_header_old(gc, arrays, &elements_per_request,
                                    &total_requests, mode, count);
 
@@ -695,6 +791,8 @@ emit_DrawArrays_old(GLenum mode, GLint first, GLsizei count)
    if (total_requests == 0) {
       assert(elements_per_request >= count);
 
+      arrays->last_DrawArrays_pc = pc - (16 + arrays->array_info_cache_size);
+
       for (i = 0; i < count; i++) {
          pc = emit_element_old(pc, arrays, i + first);
       }
@@ -702,6 +800,8 @@ emit_DrawArrays_old(GLenum mode, GLint first, GLsizei count)
       assert(pc <= gc->bufEnd);
 
       gc->pc = pc;
+      arrays->last_DrawArrays_end = pc;
+      arrays->last_DrawArrays_flush = gc->renderFlushCount;
       if (gc->pc > gc->limit) {
          (void) __glXFlushRenderBuffer(gc, gc->pc);
       }
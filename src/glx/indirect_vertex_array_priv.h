@@ -256,6 +256,16 @@ struct array_state_vector
      */
    GLboolean new_DrawArrays_possible;
 
+    /**
+     * Start and end of the last DrawArrays render command written to the
+     * command buffer by \c emit_DrawArrays_old, and the value of
+     * \c glx_context::renderFlushCount at that time.  Used to append
+     * following draws of independent primitives to that command.
+     */
+   GLubyte *last_DrawArrays_pc;
+   GLubyte *last_DrawArrays_end;
+   unsigned last_DrawArrays_flush;
+
     /**
      * Active texture unit set by \c glClientActiveTexture.
      * 
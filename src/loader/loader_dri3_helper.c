@@ -23,6 +23,7 @@
 
 #include <fcntl.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <X11/xshmfence.h>
@@ -40,6 +41,20 @@
 #define DRI_CONF_VBLANK_DEF_INTERVAL_1 2
 #define DRI_CONF_VBLANK_ALWAYS_SYNC 3
 
+/* Number of swaps in a row that must find a spare idle back buffer before
+ * an adaptively added one is released again.
+ */
+#define LOADER_DRI3_SHRINK_SWAPS 120
+
+static int64_t
+dri3_get_time_us(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 static inline void
 dri3_fence_reset(xcb_connection_t *c, struct loader_dri3_buffer *buffer)
 {
@@ -77,6 +92,10 @@ dri3_update_num_back(struct loader_dri3_drawable *draw)
    }
    if (draw->vtable->get_swap_interval(draw) == 0)
       draw->num_back++;
+
+   draw->num_back += draw->extra_back;
+   if (draw->num_back > LOADER_DRI3_MAX_BACK)
+      draw->num_back = LOADER_DRI3_MAX_BACK;
 }
 
 void
@@ -149,6 +168,13 @@ loader_dri3_drawable_init(xcb_connection_t *conn,
    draw->have_fake_front = 0;
    draw->first_init = true;
 
+   draw->extra_back = 0;
+   draw->spare_swaps = 0;
+   draw->last_find_sbc = 0;
+   draw->idle_latency_total = 0;
+   draw->idle_latency_max = 0;
+   draw->idle_latency_count = 0;
+
    if (draw->ext->config)
       draw->ext->config->configQueryi(draw->dri_screen,
                                       "vblank_mode", &vblank_mode);
@@ -256,6 +282,14 @@ dri3_handle_present_event(struct loader_dri3_drawable *draw,
          struct loader_dri3_buffer *buf = draw->buffers[b];
 
          if (buf && buf->pixmap == ie->pixmap) {
+            if (buf->busy && buf->present_time) {
+               uint64_t latency = dri3_get_time_us() - buf->present_time;
+
+               draw->idle_latency_total += latency;
+               if (latency > draw->idle_latency_max)
+                  draw->idle_latency_max = latency;
+               draw->idle_latency_count++;
+            }
             buf->busy = 0;
             if (draw->num_back <= b && b < LOADER_DRI3_MAX_BACK) {
                dri3_free_render_buffer(draw, buf);
@@ -354,10 +388,36 @@ loader_dri3_wait_for_sbc(struct loader_dri3_drawable *draw,
    return 1;
 }
 
+/** dri3_shrink_back
+ *
+ * Drop one adaptively added back buffer. Idle buffers beyond the new count
+ * are freed right away, busy ones once their IdleNotify arrives.
+ */
+static void
+dri3_shrink_back(struct loader_dri3_drawable *draw)
+{
+   int b;
+
+   draw->extra_back--;
+   dri3_update_num_back(draw);
+
+   for (b = draw->num_back; b < LOADER_DRI3_MAX_BACK; b++) {
+      int id = LOADER_DRI3_BACK_ID(b);
+      struct loader_dri3_buffer *buffer = draw->buffers[id];
+
+      if (buffer && !buffer->busy) {
+         dri3_free_render_buffer(draw, buffer);
+         draw->buffers[id] = NULL;
+      }
+   }
+}
+
 /** loader_dri3_find_back
  *
- * Find an idle back buffer. If there isn't one, then
- * wait for a present idle notify event from the X server
+ * Find an idle back buffer. If there isn't one, handle any events that are
+ * already queued, then add another back buffer if we aren't at the maximum
+ * yet, and only wait for a present idle notify event from the X server as a
+ * last resort.
  */
 static int
 dri3_find_back(struct loader_dri3_drawable *draw)
@@ -367,17 +427,51 @@ dri3_find_back(struct loader_dri3_drawable *draw)
    xcb_present_generic_event_t *ge;
 
    for (;;) {
+      int found = -1;
+      int num_idle = 0;
+
       for (b = 0; b < draw->num_back; b++) {
          int id = LOADER_DRI3_BACK_ID((b + draw->cur_back) % draw->num_back);
          struct loader_dri3_buffer *buffer = draw->buffers[id];
 
          if (!buffer || !buffer->busy) {
-            draw->cur_back = id;
-            return id;
+            if (found < 0)
+               found = id;
+            num_idle++;
          }
       }
+
+      if (found >= 0) {
+         /* Only account for pressure once per swap, this is called more
+          * than once per frame.
+          */
+         if (draw->extra_back && draw->last_find_sbc != draw->send_sbc) {
+            draw->last_find_sbc = draw->send_sbc;
+            if (num_idle > 1) {
+               if (++draw->spare_swaps >= LOADER_DRI3_SHRINK_SWAPS) {
+                  draw->spare_swaps = 0;
+                  dri3_shrink_back(draw);
+                  continue;
+               }
+            } else {
+               draw->spare_swaps = 0;
+            }
+         }
+
+         draw->cur_back = found;
+         return found;
+      }
+
       xcb_flush(draw->conn);
-      ev = xcb_wait_for_special_event(draw->conn, draw->special_event);
+      ev = xcb_poll_for_special_event(draw->conn, draw->special_event);
+      if (!ev && draw->num_back < LOADER_DRI3_MAX_BACK) {
+         draw->extra_back++;
+         draw->spare_swaps = 0;
+         dri3_update_num_back(draw);
+         continue;
+      }
+      if (!ev)
+         ev = xcb_wait_for_special_event(draw->conn, draw->special_event);
       if (!ev)
          return -1;
       ge = (void *) ev;
@@ -702,6 +796,7 @@ loader_dri3_swap_buffers_msc(struct loader_dri3_drawable *draw,
 
       back->busy = 1;
       back->last_swap = draw->send_sbc;
+      back->present_time = dri3_get_time_us();
       xcb_present_pixmap(draw->conn,
                          draw->drawable,
                          back->pixmap,
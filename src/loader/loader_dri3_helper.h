@@ -67,6 +67,7 @@ struct loader_dri3_buffer {
    uint32_t     flags;
    uint32_t     width, height;
    uint64_t     last_swap;
+   int64_t      present_time;   /* Monotonic time of the last present, in us */
 
    enum loader_dri3_buffer_type        buffer_type;
 };
@@ -149,6 +150,21 @@ struct loader_dri3_drawable {
    int cur_back;
    int num_back;
 
+   /* Back buffers added on top of what dri3_update_num_back() asks for,
+    * because the server kept all of them busy.  They are dropped again
+    * after enough swaps where a spare buffer was idle.
+    */
+   int extra_back;
+   unsigned spare_swaps;
+   uint64_t last_find_sbc;
+
+   /* Time from PresentPixmap to the IdleNotify of the presented buffer, in
+    * microseconds, accumulated since the statistics were last reset.
+    */
+   uint64_t idle_latency_total;
+   uint64_t idle_latency_max;
+   unsigned idle_latency_count;
+
    uint32_t *stamp;
 
    xcb_present_event_t eid;
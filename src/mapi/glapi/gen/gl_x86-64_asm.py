@@ -227,9 +227,11 @@ class PrintGenericStubs(gl_XML.gl_print_base):
             print '\tHIDDEN(GL_PREFIX(%s))' % (name)
         print 'GL_PREFIX(%s):' % (name)
         print '#if defined(GLX_USE_TLS)'
-        print '\tcall\t_x86_64_get_dispatch@PLT'
-        print '\tmovq\t%u(%%rax), %%r11' % (f.offset * 8)
-        print '\tjmp\t*%r11'
+        # With initial-exec TLS the dispatch table pointer is one load
+        # away, so don't pay for a call through the PLT on every GL call.
+        print '\tmovq\t_glapi_tls_Dispatch@GOTTPOFF(%rip), %rax'
+        print '\tmovq\t%fs:(%rax), %r11'
+        print '\tjmp\t*%u(%%r11)' % (f.offset * 8)
         print '#elif defined(HAVE_PTHREAD)'
 
         save_all_regs(registers)
@@ -364,6 +364,11 @@ DRI_CONF_OPT_BEGIN_B(thread_submit, def) \
         DRI_CONF_DESC(en,gettext("Use an additional thread to submit buffers.")) \
 DRI_CONF_OPT_END
 
+#define DRI_CONF_NINE_CSMT(def) \
+DRI_CONF_OPT_BEGIN_B(csmt, def) \
+        DRI_CONF_DESC(en,gettext("Run draw submission on a separate thread.")) \
+DRI_CONF_OPT_END
+
 #define DRI_CONF_NINE_OVERRIDEVENDOR(def) \
 DRI_CONF_OPT_BEGIN(override_vendorid, int, def) \
         DRI_CONF_DESC(en,"Define the vendor_id to report. This allows faking another hardware vendor.") \
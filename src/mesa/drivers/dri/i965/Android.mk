@@ -51,6 +51,13 @@ LOCAL_SRC_FILES := \
 	$(i965_compiler_FILES) \
 	$(i965_FILES)
 
+ifeq ($(ARCH_X86_HAVE_SSE4_1),true)
+LOCAL_SRC_FILES += \
+	$(i965_sse41_FILES)
+LOCAL_CFLAGS += \
+	-msse4.1
+endif
+
 LOCAL_WHOLE_STATIC_LIBRARIES := \
 	$(MESA_DRI_WHOLE_STATIC_LIBRARIES)
 
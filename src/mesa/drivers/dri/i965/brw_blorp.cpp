@@ -173,6 +173,20 @@ extern "C" {
 void
 intel_hiz_exec(struct brw_context *brw, struct intel_mipmap_tree *mt,
 	       unsigned int level, unsigned int layer, gen6_hiz_op op)
+{
+   intel_hiz_exec_layers(brw, mt, level, layer, 1, op);
+}
+
+/**
+ * Perform a HiZ op on a range of layers of one miplevel.
+ *
+ * On Gen6-7 this goes through a single batched blorp operation, so the
+ * 3D pipeline is only set up once rather than for every layer.
+ */
+void
+intel_hiz_exec_layers(struct brw_context *brw, struct intel_mipmap_tree *mt,
+                      unsigned int level, unsigned int first_layer,
+                      unsigned int num_layers, gen6_hiz_op op)
 {
    const char *opname = NULL;
 
@@ -191,81 +205,120 @@ intel_hiz_exec(struct brw_context *brw, struct intel_mipmap_tree *mt,
       break;
    }
 
-   DBG("%s %s to mt %p level %d layer %d\n",
-       __func__, opname, mt, level, layer);
+   DBG("%s %s to mt %p level %d layers %d-%d\n",
+       __func__, opname, mt, level, first_layer,
+       first_layer + num_layers - 1);
 
    if (brw->gen >= 8) {
-      gen8_hiz_exec(brw, mt, level, layer, op);
+      for (unsigned int i = 0; i < num_layers; i++)
+         gen8_hiz_exec(brw, mt, level, first_layer + i, op);
    } else {
-      brw_hiz_op_params params(mt, level, layer, op);
-      brw_blorp_exec(brw, &params);
+      const brw_blorp_params **params =
+         new const brw_blorp_params *[num_layers];
+
+      for (unsigned int i = 0; i < num_layers; i++)
+         params[i] = new brw_hiz_op_params(mt, level, first_layer + i, op);
+
+      brw_blorp_exec_batch(brw, params, num_layers);
+
+      for (unsigned int i = 0; i < num_layers; i++)
+         delete params[i];
+      delete[] params;
    }
 }
 
 } /* extern "C" */
 
+/**
+ * Upper bound on the number of slices emitted after a single setup of the
+ * shared state, so that a whole run safely fits in one batch.
+ */
+#define BRW_BLORP_MAX_BATCHED_SLICES 16
+
 void
 brw_blorp_exec(struct brw_context *brw, const brw_blorp_params *params)
+{
+   brw_blorp_exec_batch(brw, &params, 1);
+}
+
+void
+brw_blorp_exec_batch(struct brw_context *brw,
+                     const brw_blorp_params *const *params,
+                     unsigned num_params)
 {
    struct gl_context *ctx = &brw->ctx;
-   uint32_t estimated_max_batch_usage = 1500;
-   bool check_aperture_failed_once = false;
-
-   /* Flush the sampler and render caches.  We definitely need to flush the
-    * sampler cache so that we get updated contents from the render cache for
-    * the glBlitFramebuffer() source.  Also, we are sometimes warned in the
-    * docs to flush the cache between reinterpretations of the same surface
-    * data with different formats, which blorp does for stencil and depth
-    * data.
-    */
-   brw_emit_mi_flush(brw);
 
-retry:
-   intel_batchbuffer_require_space(brw, estimated_max_batch_usage, RENDER_RING);
-   intel_batchbuffer_save_state(brw);
-   drm_intel_bo *saved_bo = brw->batch.bo;
-   uint32_t saved_used = USED_BATCH(brw->batch);
-   uint32_t saved_state_batch_offset = brw->batch.state_batch_offset;
-
-   switch (brw->gen) {
-   case 6:
-      gen6_blorp_exec(brw, params);
-      break;
-   case 7:
-      gen7_blorp_exec(brw, params);
-      break;
-   default:
-      /* BLORP is not supported before Gen6. */
-      unreachable("not reached");
+   for (unsigned i = 1; i < num_params; i++) {
+      assert(params[i]->use_wm_prog == params[0]->use_wm_prog);
+      assert(params[i]->hiz_op == params[0]->hiz_op);
+      assert(params[i]->dst.num_samples == params[0]->dst.num_samples);
    }
 
-   /* Make sure we didn't wrap the batch unintentionally, and make sure we
-    * reserved enough space that a wrap will never happen.
-    */
-   assert(brw->batch.bo == saved_bo);
-   assert((USED_BATCH(brw->batch) - saved_used) * 4 +
-          (saved_state_batch_offset - brw->batch.state_batch_offset) <
-          estimated_max_batch_usage);
-   /* Shut up compiler warnings on release build */
-   (void)saved_bo;
-   (void)saved_used;
-   (void)saved_state_batch_offset;
-
-   /* Check if the blorp op we just did would make our batch likely to fail to
-    * map all the BOs into the GPU at batch exec time later.  If so, flush the
-    * batch and try again with nothing else in the batch.
-    */
-   if (dri_bufmgr_check_aperture_space(&brw->batch.bo, 1)) {
-      if (!check_aperture_failed_once) {
-         check_aperture_failed_once = true;
-         intel_batchbuffer_reset_to_saved(brw);
-         intel_batchbuffer_flush(brw);
-         goto retry;
-      } else {
-         int ret = intel_batchbuffer_flush(brw);
-         WARN_ONCE(ret == -ENOSPC,
-                   "i965: blorp emit exceeded available aperture space\n");
+   for (unsigned first = 0; first < num_params; ) {
+      const unsigned count =
+         MIN2(num_params - first, BRW_BLORP_MAX_BATCHED_SLICES);
+      const uint32_t estimated_max_batch_usage = 1500 + (count - 1) * 800;
+      bool check_aperture_failed_once = false;
+
+      /* Flush the sampler and render caches.  We definitely need to flush
+       * the sampler cache so that we get updated contents from the render
+       * cache for the glBlitFramebuffer() source.  Also, we are sometimes
+       * warned in the docs to flush the cache between reinterpretations of
+       * the same surface data with different formats, which blorp does for
+       * stencil and depth data.
+       */
+      brw_emit_mi_flush(brw);
+
+retry:
+      intel_batchbuffer_require_space(brw, estimated_max_batch_usage,
+                                      RENDER_RING);
+      intel_batchbuffer_save_state(brw);
+      drm_intel_bo *saved_bo = brw->batch.bo;
+      uint32_t saved_used = USED_BATCH(brw->batch);
+      uint32_t saved_state_batch_offset = brw->batch.state_batch_offset;
+
+      switch (brw->gen) {
+      case 6:
+         gen6_blorp_exec(brw, params + first, count);
+         break;
+      case 7:
+         gen7_blorp_exec(brw, params + first, count);
+         break;
+      default:
+         /* BLORP is not supported before Gen6. */
+         unreachable("not reached");
+      }
+
+      /* Make sure we didn't wrap the batch unintentionally, and make sure we
+       * reserved enough space that a wrap will never happen.
+       */
+      assert(brw->batch.bo == saved_bo);
+      assert((USED_BATCH(brw->batch) - saved_used) * 4 +
+             (saved_state_batch_offset - brw->batch.state_batch_offset) <
+             estimated_max_batch_usage);
+      /* Shut up compiler warnings on release build */
+      (void)saved_bo;
+      (void)saved_used;
+      (void)saved_state_batch_offset;
+
+      /* Check if the blorp ops we just did would make our batch likely to
+       * fail to map all the BOs into the GPU at batch exec time later.  If
+       * so, flush the batch and try again with nothing else in the batch.
+       */
+      if (dri_bufmgr_check_aperture_space(&brw->batch.bo, 1)) {
+         if (!check_aperture_failed_once) {
+            check_aperture_failed_once = true;
+            intel_batchbuffer_reset_to_saved(brw);
+            intel_batchbuffer_flush(brw);
+            goto retry;
+         } else {
+            int ret = intel_batchbuffer_flush(brw);
+            WARN_ONCE(ret == -ENOSPC,
+                      "i965: blorp emit exceeded available aperture space\n");
+         }
       }
+
+      first += count;
    }
 
    if (unlikely(brw->always_flush_batch))
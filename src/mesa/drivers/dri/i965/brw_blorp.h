@@ -215,6 +215,8 @@ public:
                     unsigned num_draw_buffers = 1,
                     unsigned num_layers = 1);
 
+   virtual ~brw_blorp_params() {}
+
    virtual uint32_t get_wm_prog(struct brw_context *brw,
                                 brw_blorp_prog_data **prog_data) const = 0;
 
@@ -238,13 +240,27 @@ public:
 void
 brw_blorp_exec(struct brw_context *brw, const brw_blorp_params *params);
 
+/**
+ * Execute several blorp operations, emitting the state they have in common
+ * only once per run and then just the surfaces and rectangle of each slice.
+ *
+ * All the operations must share the same WM program, sample count and HiZ
+ * op, which is the case for e.g. the layers of a single miptree.
+ */
+void
+brw_blorp_exec_batch(struct brw_context *brw,
+                     const brw_blorp_params *const *params,
+                     unsigned num_params);
+
 void
 gen6_blorp_exec(struct brw_context *brw,
-                const brw_blorp_params *params);
+                const brw_blorp_params *const *slices,
+                unsigned num_slices);
 
 void
 gen7_blorp_exec(struct brw_context *brw,
-                const brw_blorp_params *params);
+                const brw_blorp_params *const *slices,
+                unsigned num_slices);
 
 /**
  * Parameters for a HiZ or depth resolve operation.
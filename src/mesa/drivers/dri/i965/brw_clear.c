@@ -184,11 +184,9 @@ brw_fast_clear_depth(struct gl_context *ctx)
    brw_emit_mi_flush(brw);
 
    if (fb->MaxNumLayers > 0) {
-      for (unsigned layer = 0; layer < depth_irb->layer_count; layer++) {
-         intel_hiz_exec(brw, mt, depth_irb->mt_level,
-                        depth_irb->mt_layer + layer,
-                        GEN6_HIZ_OP_DEPTH_CLEAR);
-      }
+      intel_hiz_exec_layers(brw, mt, depth_irb->mt_level,
+                            depth_irb->mt_layer, depth_irb->layer_count,
+                            GEN6_HIZ_OP_DEPTH_CLEAR);
    } else {
       intel_hiz_exec(brw, mt, depth_irb->mt_level, depth_irb->mt_layer,
                      GEN6_HIZ_OP_DEPTH_CLEAR);
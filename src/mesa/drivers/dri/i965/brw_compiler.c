@@ -82,7 +82,9 @@ shader_perf_log_mesa(void *data, const char *fmt, ...)
    .lower_uadd_carry = true,                                                  \
    .lower_usub_borrow = true,                                                 \
    .lower_fdiv = true,                                                        \
-   .native_integers = true
+   .native_integers = true,                                                   \
+   .max_unroll_iterations = 32,                                               \
+   .max_unroll_instructions = 512
 
 static const struct nir_shader_compiler_options scalar_nir_options = {
    COMMON_OPTIONS,
@@ -96,6 +98,11 @@ static const struct nir_shader_compiler_options scalar_nir_options = {
    .lower_unpack_snorm_4x8 = true,
    .lower_unpack_unorm_2x16 = true,
    .lower_unpack_unorm_4x8 = true,
+
+   /* A 32-bit SIMD16 value takes two of the 128 GRFs; leave some room for
+    * payload and temporaries.
+    */
+   .gcm_register_budget = 48,
 };
 
 static const struct nir_shader_compiler_options vector_nir_options = {
@@ -116,6 +123,9 @@ static const struct nir_shader_compiler_options vector_nir_options = {
    .lower_unpack_unorm_2x16 = true,
    .lower_extract_byte = true,
    .lower_extract_word = true,
+
+   /* 128 vec4 GRFs, though not every value fills all four components */
+   .gcm_register_budget = 192,
 };
 
 static const struct nir_shader_compiler_options vector_nir_options_gen6 = {
@@ -133,6 +143,9 @@ static const struct nir_shader_compiler_options vector_nir_options_gen6 = {
    .lower_unpack_unorm_2x16 = true,
    .lower_extract_byte = true,
    .lower_extract_word = true,
+
+   /* 128 vec4 GRFs, though not every value fills all four components */
+   .gcm_register_budget = 192,
 };
 
 struct brw_compiler *
@@ -149,14 +162,18 @@ brw_compiler_create(void *mem_ctx, const struct brw_device_info *devinfo)
 
    compiler->scalar_stage[MESA_SHADER_VERTEX] =
       devinfo->gen >= 8 && !(INTEL_DEBUG & DEBUG_VEC4VS);
+   /* There is no scalar TCS backend yet. */
    compiler->scalar_stage[MESA_SHADER_TESS_CTRL] = false;
    compiler->scalar_stage[MESA_SHADER_TESS_EVAL] =
       devinfo->gen >= 8 && env_var_as_boolean("INTEL_SCALAR_TES", true);
    compiler->scalar_stage[MESA_SHADER_GEOMETRY] =
-      devinfo->gen >= 8 && env_var_as_boolean("INTEL_SCALAR_GS", false);
+      devinfo->gen >= 8 && env_var_as_boolean("INTEL_SCALAR_GS", true);
    compiler->scalar_stage[MESA_SHADER_FRAGMENT] = true;
    compiler->scalar_stage[MESA_SHADER_COMPUTE] = true;
 
+   compiler->threaded_fs_compile =
+      env_var_as_boolean("INTEL_THREADED_FS", false);
+
    /* We want the GLSL compiler to emit code that uses condition codes */
    for (int i = 0; i < MESA_SHADER_STAGES; i++) {
       compiler->glsl_compiler_options[i].MaxUnrollIterations = 32;
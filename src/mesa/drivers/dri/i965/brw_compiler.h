@@ -91,6 +91,13 @@ struct brw_compiler {
    void (*shader_perf_log)(void *, const char *str, ...) PRINTFLIKE(2, 3);
 
    bool scalar_stage[MESA_SHADER_STAGES];
+
+   /**
+    * Whether brw_compile_fs() runs the SIMD16 compile on a thread of its own,
+    * concurrently with the SIMD8 one.
+    */
+   bool threaded_fs_compile;
+
    struct gl_shader_compiler_options glsl_compiler_options[MESA_SHADER_STAGES];
 };
 
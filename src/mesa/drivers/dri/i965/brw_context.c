@@ -611,6 +611,11 @@ brw_initialize_context_constants(struct brw_context *brw)
    ctx->Const.NativeIntegers = true;
    ctx->Const.VertexID_is_zero_based = true;
 
+   /* The URB just stores whatever bits the previous stage wrote, so nothing
+    * but the fragment shader inputs depends on interpolation qualifiers.
+    */
+   ctx->Const.AggressiveVaryingPacking = true;
+
    /* Regarding the CMP instruction, the Ivybridge PRM says:
     *
     *   "For each enabled channel 0b or 1b is assigned to the appropriate flag
@@ -751,6 +756,10 @@ brw_process_driconf_options(struct brw_context *brw)
           brw->has_separate_stencil = false;
    }
 
+   /* Without an LLC, userptr memory is snooped, which is slow to read. */
+   brw->vb.use_userptr = brw->has_llc &&
+      driQueryOptionb(options, "client_array_userptr");
+
    if (driQueryOptionb(options, "always_flush_batch")) {
       fprintf(stderr, "flushing batchbuffer before/after each draw call\n");
       brw->always_flush_batch = true;
@@ -1002,6 +1011,8 @@ brwCreateContext(gl_api api,
       (env_var_as_boolean("INTEL_USE_HW_BT", false) ||
        env_var_as_boolean("INTEL_USE_GATHER", false));
 
+   brw->wm.async_compile = env_var_as_boolean("INTEL_ASYNC_FS", false);
+
    ctx->VertexProgram._MaintainTnlProgram = true;
    ctx->FragmentProgram._MaintainTexEnvProgram = true;
 
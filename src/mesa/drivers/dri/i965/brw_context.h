@@ -151,6 +151,7 @@ struct brw_wm_prog_key;
 struct brw_wm_prog_data;
 struct brw_cs_prog_key;
 struct brw_cs_prog_data;
+struct brw_wm_async;
 
 enum brw_pipeline {
    BRW_RENDER_PIPELINE,
@@ -525,17 +526,36 @@ struct brw_cache_item {
    uint32_t offset;
    uint32_t size;
 
+   /** Next item in brw_cache::items */
    struct brw_cache_item *next;
 };
 
+/**
+ * Slot of the open-addressed brw_cache::table.  The hash is kept next to
+ * the item, so probes only look at the items whose hash matches.
+ */
+struct brw_cache_slot {
+   GLuint hash;
+   struct brw_cache_item *item;
+};
 
 struct brw_cache {
    struct brw_context *brw;
 
-   struct brw_cache_item **items;
+   /** All items, most recently added first */
+   struct brw_cache_item *items;
+
+   /** Hash table of the items, size is a power of two */
+   struct brw_cache_slot *table;
    drm_intel_bo *bo;
    GLuint size, n_items;
 
+   /**
+    * Item last returned by brw_search_cache() for each cache_id.  The same
+    * keys tend to be looked up on every draw.
+    */
+   struct brw_cache_item *last_hit[BRW_MAX_CACHE];
+
    uint32_t next_offset;
    bool bo_used_by_gpu;
 };
@@ -552,6 +572,18 @@ struct brw_tracked_state {
    void (*emit)( struct brw_context *brw );
 };
 
+#define BRW_MAX_ATOMS 76
+#define BRW_ATOM_SET_WORDS DIV_ROUND_UP(BRW_MAX_ATOMS, 64)
+
+/**
+ * For each dirty bit, the set of atoms of a pipeline checking it, so that
+ * brw_upload_pipeline_state() only has to visit the atoms to emit.
+ */
+struct brw_atom_index {
+   uint64_t mesa[32][BRW_ATOM_SET_WORDS];
+   uint64_t brw[BRW_NUM_STATE_BITS][BRW_ATOM_SET_WORDS];
+};
+
 enum shader_time_shader_type {
    ST_NONE,
    ST_VS,
@@ -571,6 +603,22 @@ struct brw_vertex_buffer {
    GLuint stride;
    GLuint step_rate;
 };
+/**
+ * Client memory wrapped in a userptr BO for drawing from client arrays in
+ * place, see use_userptr_array().
+ */
+struct brw_userptr_array {
+   /** Page-aligned range of client memory, size is 0 for a free entry */
+   uintptr_t start;
+   size_t size;
+   /** NULL until the range has been drawn from in two different frames */
+   drm_intel_bo *bo;
+   unsigned first_frame;
+   unsigned last_frame;
+};
+
+#define BRW_MAX_USERPTR_ARRAYS 16
+
 struct brw_vertex_element {
    const struct gl_client_array *glarray;
 
@@ -599,12 +647,23 @@ enum brw_gpu_ring {
    BLT_RING,
 };
 
+#define BATCH_RING_SIZE 4
+
 struct intel_batchbuffer {
    /** Current batchbuffer being queued up. */
    drm_intel_bo *bo;
    /** Last BO submitted to the hardware.  Used for glFinish(). */
    drm_intel_bo *last_bo;
 
+   /**
+    * Batch BOs reused round robin once idle, mapped for their lifetime on
+    * LLC.  See intel_batchbuffer_reset().
+    */
+   drm_intel_bo *ring_bo[BATCH_RING_SIZE];
+   unsigned ring_slot;
+   /** Whether \c bo is referenced by someone waiting on it */
+   bool bo_shared;
+
 #ifdef DEBUG
    uint16_t emit, total;
 #endif
@@ -973,6 +1032,14 @@ struct brw_context
        * These bitfields indicate which workarounds are needed.
        */
       uint8_t attrib_wa_flags[VERT_ATTRIB_MAX];
+
+      /**
+       * Large client arrays drawn from in place rather than copied, with
+       * the client_array_userptr driconf option.  frame counts SwapBuffers.
+       */
+      bool use_userptr;
+      unsigned frame;
+      struct brw_userptr_array userptr[BRW_MAX_USERPTR_ARRAYS];
    } vb;
 
    struct {
@@ -1196,6 +1263,14 @@ struct brw_context
       uint32_t fast_clear_op;
 
       float offset_clamp;
+
+      /**
+       * Compile missing fragment program variants in the background
+       * (INTEL_ASYNC_FS), drawing with a compatible variant meanwhile.
+       * See brw_wm.c.
+       */
+      bool async_compile;
+      struct brw_wm_async *async;
    } wm;
 
    struct {
@@ -1261,11 +1336,18 @@ struct brw_context
 
       /** Number of 32-bit entries in a hardware counter snapshot. */
       int entries_per_oa_snapshot;
+
+      /**
+       * For each group, the raw OA counter ID behind each of its counters,
+       * or NULL if the group isn't an OA metric set.
+       */
+      const int *const *oa_metric_sets;
    } perfmon;
 
    int num_atoms[BRW_NUM_PIPELINES];
-   const struct brw_tracked_state render_atoms[76];
+   const struct brw_tracked_state render_atoms[BRW_MAX_ATOMS];
    const struct brw_tracked_state compute_atoms[11];
+   struct brw_atom_index atom_index[BRW_NUM_PIPELINES];
 
    /* If (INTEL_DEBUG & DEBUG_BATCH) */
    struct {
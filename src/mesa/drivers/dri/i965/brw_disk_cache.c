@@ -0,0 +1,350 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file brw_disk_cache.c
+ *
+ * Persistent tier of the program cache (INTEL_DISK_CACHE=true).
+ *
+ * The in-memory brw_cache is keyed by the brw_*_prog_key, whose
+ * program_string_id only means something within the current process.  For
+ * the disk, the key of a program is made of the prog key with that id
+ * cleared, the NIR of the program, the prog_data set up for the compile and
+ * the state the backend looks at besides those.  The disk cache itself adds
+ * the device and driver build to it.
+ *
+ * Most of prog_data is plain data, except for the param[] and pull_param[]
+ * arrays, which point at the values backing each uniform in the current
+ * process.  Those are stored as indices into the param[] array set up
+ * before the compile, which the backend only reorders and condenses, and
+ * rebuilt from the param[] array set up for the program being restored.
+ * The only other values the backend points params at here are constant
+ * zeros used as padding.
+ */
+
+#include <stdio.h>
+
+#include "main/imports.h"
+#include "compiler/nir/nir.h"
+#include "program/prog_parameter.h"
+#include "util/debug.h"
+#include "util/disk_cache.h"
+#include "util/hash_table.h"
+#include "util/mesa-sha1.h"
+#include "brw_context.h"
+#include "brw_state.h"
+
+#define PARAM_ZERO (~0u)
+
+struct brw_disk_cache_header {
+   uint32_t prog_data_size;
+   uint32_t program_size;
+   uint32_t nr_params;
+   uint32_t nr_pull_params;
+};
+
+struct disk_cache *
+brw_disk_cache_create(const struct intel_screen *screen)
+{
+   char gpu_name[16];
+
+   if (!env_var_as_boolean("INTEL_DISK_CACHE", false))
+      return NULL;
+
+   snprintf(gpu_name, sizeof(gpu_name), "i965_%04x", screen->deviceID);
+
+   return disk_cache_create(gpu_name,
+                            "i965 " PACKAGE_VERSION " " __DATE__ " " __TIME__);
+}
+
+static void
+sha1_update_prog_data(struct mesa_sha1 *ctx,
+                      const struct brw_stage_prog_data *prog_data,
+                      unsigned prog_data_size)
+{
+   uint8_t *data = malloc(prog_data_size);
+   struct brw_stage_prog_data *base = (struct brw_stage_prog_data *) data;
+
+   memcpy(data, prog_data, prog_data_size);
+   base->param = NULL;
+   base->pull_param = NULL;
+   base->image_param = NULL;
+
+   _mesa_sha1_update(ctx, data, prog_data_size);
+   free(data);
+}
+
+static bool
+sha1_update_nir(struct mesa_sha1 *ctx, nir_shader *nir)
+{
+   char *text = NULL;
+   size_t size = 0;
+   FILE *fp = open_memstream(&text, &size);
+
+   if (fp == NULL)
+      return false;
+
+   nir_print_shader(nir, fp);
+   fclose(fp);
+
+   _mesa_sha1_update(ctx, text, size);
+   free(text);
+
+   return true;
+}
+
+static bool
+compute_program_key(struct brw_context *brw,
+                    enum brw_cache_id cache_id,
+                    const void *key, unsigned key_size,
+                    unsigned program_string_id_offset,
+                    uint32_t compile_flags,
+                    struct gl_program *prog,
+                    const struct brw_stage_prog_data *prog_data,
+                    unsigned prog_data_size,
+                    cache_key out_key)
+{
+   const struct brw_compiler *compiler = brw->intelScreen->compiler;
+   const uint32_t no_id = 0;
+   const uint32_t id = cache_id;
+   unsigned char sha1[20];
+   struct mesa_sha1 *ctx = _mesa_sha1_init();
+
+   if (ctx == NULL)
+      return false;
+
+   _mesa_sha1_update(ctx, &id, sizeof(id));
+   _mesa_sha1_update(ctx, &compile_flags, sizeof(compile_flags));
+   _mesa_sha1_update(ctx, compiler->scalar_stage,
+                     sizeof(compiler->scalar_stage));
+
+   _mesa_sha1_update(ctx, key, program_string_id_offset);
+   _mesa_sha1_update(ctx, &no_id, sizeof(no_id));
+   _mesa_sha1_update(ctx, (const char *) key + program_string_id_offset +
+                          sizeof(no_id),
+                     key_size - program_string_id_offset - sizeof(no_id));
+
+   sha1_update_prog_data(ctx, prog_data, prog_data_size);
+
+   bool ok = sha1_update_nir(ctx, prog->nir);
+   _mesa_sha1_final(ctx, sha1);
+
+   if (!ok)
+      return false;
+
+   disk_cache_compute_key(brw->intelScreen->disk_cache, sha1, sizeof(sha1),
+                          out_key);
+   return true;
+}
+
+/**
+ * Looks for the program about to be compiled in the disk cache.
+ *
+ * To be called once \p prog_data is set up for the compile, including its
+ * param[] array.  On a hit, \p prog_data is updated to the state it would
+ * be in after the compile and the program is returned in \p program,
+ * allocated out of \p mem_ctx.  On a miss, \p dcp holds what
+ * brw_disk_cache_store_program() needs to store the program once compiled.
+ */
+bool
+brw_disk_cache_load_program(struct brw_context *brw,
+                            struct brw_disk_cache_program *dcp,
+                            enum brw_cache_id cache_id,
+                            const void *key, unsigned key_size,
+                            unsigned program_string_id_offset,
+                            uint32_t compile_flags,
+                            struct gl_program *prog,
+                            struct brw_stage_prog_data *prog_data,
+                            unsigned prog_data_size,
+                            void *mem_ctx,
+                            const unsigned **program,
+                            unsigned *program_size)
+{
+   struct disk_cache *cache = brw->intelScreen->disk_cache;
+   struct brw_disk_cache_header header;
+   size_t size;
+   uint8_t *data;
+   unsigned i;
+
+   dcp->enabled = false;
+
+   /* Debug flags either change the generated code or ask for output from
+    * the compile.
+    */
+   if (cache == NULL || INTEL_DEBUG || prog->nir == NULL)
+      return false;
+
+   if (!compute_program_key(brw, cache_id, key, key_size,
+                            program_string_id_offset, compile_flags, prog,
+                            prog_data, prog_data_size, dcp->key))
+      return false;
+
+   dcp->enabled = true;
+   dcp->nr_params = prog_data->nr_params;
+   dcp->params = ralloc_array(mem_ctx, const union gl_constant_value *,
+                              dcp->nr_params);
+   memcpy(dcp->params, prog_data->param,
+          dcp->nr_params * sizeof(dcp->params[0]));
+
+   data = disk_cache_get(cache, dcp->key, &size);
+   if (data == NULL)
+      return false;
+
+   if (size < sizeof(header))
+      goto fail;
+
+   memcpy(&header, data, sizeof(header));
+
+   if (header.prog_data_size != prog_data_size ||
+       header.program_size % sizeof(uint32_t) != 0 ||
+       header.nr_params > dcp->nr_params ||
+       header.nr_pull_params > dcp->nr_params ||
+       size != sizeof(header) + header.prog_data_size + header.program_size +
+               (header.nr_params + header.nr_pull_params) * sizeof(uint32_t))
+      goto fail;
+
+   const uint32_t *indices = (const uint32_t *)
+      (data + sizeof(header) + prog_data_size + header.program_size);
+
+   for (i = 0; i < header.nr_params + header.nr_pull_params; i++) {
+      if (indices[i] != PARAM_ZERO && indices[i] >= dcp->nr_params)
+         goto fail;
+   }
+
+   static const union gl_constant_value zero = { 0 };
+   const union gl_constant_value **param = prog_data->param;
+   const union gl_constant_value **pull_param = prog_data->pull_param;
+   struct brw_image_param *image_param = prog_data->image_param;
+
+   memcpy(prog_data, data + sizeof(header), prog_data_size);
+   prog_data->param = param;
+   prog_data->pull_param = pull_param;
+   prog_data->image_param = image_param;
+
+   for (i = 0; i < header.nr_params; i++) {
+      param[i] = indices[i] == PARAM_ZERO ? &zero : dcp->params[indices[i]];
+   }
+   indices += header.nr_params;
+   for (i = 0; i < header.nr_pull_params; i++) {
+      pull_param[i] = indices[i] == PARAM_ZERO ? &zero :
+                      dcp->params[indices[i]];
+   }
+
+   void *binary = ralloc_size(mem_ctx, header.program_size);
+   memcpy(binary, data + sizeof(header) + prog_data_size,
+          header.program_size);
+   *program = binary;
+   *program_size = header.program_size;
+
+   free(data);
+
+   /* Nothing to store. */
+   dcp->enabled = false;
+   return true;
+
+fail:
+   free(data);
+   disk_cache_remove(cache, dcp->key);
+   return false;
+}
+
+static bool
+param_indices(struct hash_table *ht, const union gl_constant_value **param,
+              unsigned count, uint32_t *indices)
+{
+   for (unsigned i = 0; i < count; i++) {
+      struct hash_entry *entry = _mesa_hash_table_search(ht, param[i]);
+
+      if (entry) {
+         indices[i] = (uintptr_t) entry->data;
+      } else if (param[i]->u == 0) {
+         indices[i] = PARAM_ZERO;
+      } else {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+/**
+ * Writes a freshly compiled program through to the disk cache, following a
+ * miss in brw_disk_cache_load_program().
+ */
+void
+brw_disk_cache_store_program(struct brw_context *brw,
+                             const struct brw_disk_cache_program *dcp,
+                             const unsigned *program, unsigned program_size,
+                             const struct brw_stage_prog_data *prog_data,
+                             unsigned prog_data_size)
+{
+   struct brw_disk_cache_header header;
+   struct hash_table *ht;
+   unsigned i;
+
+   if (!dcp->enabled)
+      return;
+
+   header.prog_data_size = prog_data_size;
+   header.program_size = program_size;
+   header.nr_params = prog_data->nr_params;
+   header.nr_pull_params = prog_data->nr_pull_params;
+
+   const size_t indices_offset =
+      sizeof(header) + prog_data_size + program_size;
+   const size_t size = indices_offset +
+      (header.nr_params + header.nr_pull_params) * sizeof(uint32_t);
+   uint8_t *data = malloc(size);
+   if (data == NULL)
+      return;
+
+   ht = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                _mesa_key_pointer_equal);
+   for (i = 0; i < dcp->nr_params; i++) {
+      if (_mesa_hash_table_search(ht, dcp->params[i]) == NULL)
+         _mesa_hash_table_insert(ht, dcp->params[i], (void *)(uintptr_t) i);
+   }
+
+   uint32_t *indices = (uint32_t *) (data + indices_offset);
+   bool ok = param_indices(ht, prog_data->param, header.nr_params,
+                           indices) &&
+             param_indices(ht, prog_data->pull_param, header.nr_pull_params,
+                           indices + header.nr_params);
+
+   _mesa_hash_table_destroy(ht, NULL);
+
+   if (ok) {
+      memcpy(data, &header, sizeof(header));
+      memcpy(data + sizeof(header), prog_data, prog_data_size);
+
+      struct brw_stage_prog_data *base =
+         (struct brw_stage_prog_data *) (data + sizeof(header));
+      base->param = NULL;
+      base->pull_param = NULL;
+      base->image_param = NULL;
+
+      memcpy(data + sizeof(header) + prog_data_size, program, program_size);
+      disk_cache_put(brw->intelScreen->disk_cache, dcp->key, data, size);
+   }
+
+   free(data);
+}
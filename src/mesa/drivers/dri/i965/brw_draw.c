@@ -683,6 +683,9 @@ brw_draw_destroy(struct brw_context *brw)
    }
    brw->vb.nr_enabled = 0;
 
+   for (i = 0; i < ARRAY_SIZE(brw->vb.userptr); i++)
+      drm_intel_bo_unreference(brw->vb.userptr[i].bo);
+
    drm_intel_bo_unreference(brw->ib.bo);
    brw->ib.bo = NULL;
 }
@@ -341,6 +341,91 @@ brw_get_vertex_surface_type(struct brw_context *brw,
    }
 }
 
+/* Client arrays smaller than this are cheaper to copy than to wrap. */
+#define USERPTR_MIN_SIZE (256 * 1024)
+
+/* Frames after which an array that wasn't drawn from is forgotten. */
+#define USERPTR_MAX_AGE 2
+
+/**
+ * Points \p buffer at a userptr BO wrapping the client memory at \p src
+ * instead of copying it, for large arrays that the application keeps
+ * drawing from frame after frame.
+ *
+ * GL lets the application change or free a client array as soon as the
+ * draw call returns, whereas the GPU reads it when the batch executes.  So
+ * this is only done with the client_array_userptr driconf option, for
+ * applications known to leave their arrays alone.
+ *
+ * Arrays are looked up by the pages they cover.  The first time a range is
+ * seen, it is only recorded and the array copied as usual; the BO is made
+ * once the range is drawn from again in a later frame, so one-off arrays
+ * never pay for the ioctl and the pinning of their pages.
+ */
+static bool
+use_userptr_array(struct brw_context *brw, const unsigned char *src,
+                  size_t size, struct brw_vertex_buffer *buffer)
+{
+   const uintptr_t start = (uintptr_t) src & ~(uintptr_t) 4095;
+   const uintptr_t end = ALIGN((uintptr_t) src + size, 4096);
+   const unsigned frame = brw->vb.frame;
+   struct brw_userptr_array *entry = NULL, *victim = NULL;
+   unsigned i;
+
+   if (!brw->vb.use_userptr || size < USERPTR_MIN_SIZE)
+      return false;
+
+   for (i = 0; i < ARRAY_SIZE(brw->vb.userptr); i++) {
+      struct brw_userptr_array *array = &brw->vb.userptr[i];
+
+      if (array->size != 0 && frame - array->last_frame > USERPTR_MAX_AGE) {
+         drm_intel_bo_unreference(array->bo);
+         memset(array, 0, sizeof(*array));
+      }
+
+      if (entry == NULL && array->size != 0 &&
+          start >= array->start && end <= array->start + array->size)
+         entry = array;
+
+      if (victim == NULL ||
+          (victim->size != 0 &&
+           (array->size == 0 || array->last_frame < victim->last_frame)))
+         victim = array;
+   }
+
+   if (entry == NULL) {
+      drm_intel_bo_unreference(victim->bo);
+      victim->start = start;
+      victim->size = end - start;
+      victim->bo = NULL;
+      victim->first_frame = frame;
+      victim->last_frame = frame;
+      return false;
+   }
+
+   entry->last_frame = frame;
+
+   if (entry->bo == NULL) {
+      if (entry->first_frame == frame)
+         return false;
+
+      entry->bo = drm_intel_bo_alloc_userptr(brw->bufmgr, "client array",
+                                             (void *) entry->start,
+                                             I915_TILING_NONE, 0,
+                                             entry->size, 0);
+      if (entry->bo == NULL) {
+         perf_debug("userptr BO creation failed, copying client arrays\n");
+         brw->vb.use_userptr = false;
+         return false;
+      }
+   }
+
+   drm_intel_bo_reference(entry->bo);
+   buffer->bo = entry->bo;
+   buffer->offset = (uintptr_t) src - entry->start;
+   return true;
+}
+
 static void
 copy_array_to_vbo_array(struct brw_context *brw,
 			struct brw_vertex_element *element,
@@ -367,6 +452,13 @@ copy_array_to_vbo_array(struct brw_context *brw,
    const unsigned char *src = element->glarray->Ptr + min * src_stride;
    int count = max - min + 1;
    GLuint size = count * dst_stride;
+
+   if (use_userptr_array(brw, src, (count - 1) * src_stride + dst_stride,
+                         buffer)) {
+      buffer->stride = src_stride;
+      return;
+   }
+
    uint8_t *dst = intel_upload_space(brw, size, dst_stride,
                                      &buffer->bo, &buffer->offset);
 
@@ -1026,6 +1026,53 @@ fs_visitor::import_uniforms(fs_visitor *v)
    this->param_size = v->param_size;
 }
 
+/**
+ * Marks the SIMD8 side of \p handoff as done, with the uniform layout of
+ * \p source if it got as far as deciding on one.
+ */
+static void
+signal_uniform_handoff(fs_uniform_handoff *handoff, fs_visitor *source)
+{
+   mtx_lock(&handoff->mutex);
+   if (!handoff->done) {
+      handoff->source = source;
+      handoff->done = true;
+      cnd_broadcast(&handoff->cond);
+   }
+   mtx_unlock(&handoff->mutex);
+}
+
+/**
+ * Waits for the concurrent SIMD8 compile to assign its constant locations
+ * and imports them, as import_uniforms() does for the serial case.
+ */
+void
+fs_visitor::wait_for_uniforms()
+{
+   mtx_lock(&uniform_handoff->mutex);
+   while (!uniform_handoff->done)
+      cnd_wait(&uniform_handoff->cond, &uniform_handoff->mutex);
+   fs_visitor *v = uniform_handoff->source;
+   mtx_unlock(&uniform_handoff->mutex);
+
+   if (v == NULL) {
+      fail("SIMD8 compile failed before assigning uniforms");
+      return;
+   }
+
+   /* no16() is only ever called while emitting code, before the SIMD8
+    * compile gets here.
+    */
+   if (v->simd16_unsupported) {
+      fail("%s", "SIMD16 unsupported by the SIMD8 compile");
+      return;
+   }
+
+   import_uniforms(v);
+   stage_prog_data->nr_params = v->stage_prog_data->nr_params;
+   stage_prog_data->nr_pull_params = v->stage_prog_data->nr_pull_params;
+}
+
 fs_reg *
 fs_visitor::emit_fragcoord_interpolation(bool pixel_center_integer,
                                          bool origin_upper_left)
@@ -1934,8 +1981,11 @@ void
 fs_visitor::assign_constant_locations()
 {
    /* Only the first compile gets to decide on locations. */
-   if (dispatch_width != min_dispatch_width)
+   if (dispatch_width != min_dispatch_width) {
+      if (uniform_handoff)
+         wait_for_uniforms();
       return;
+   }
 
    unsigned int num_pull_constants = 0;
 
@@ -2034,6 +2084,9 @@ fs_visitor::assign_constant_locations()
          stage_prog_data->param[push_constant_loc[i]] = value;
       }
    }
+
+   if (uniform_handoff)
+      signal_uniform_handoff(uniform_handoff, this);
 }
 
 /**
@@ -5197,6 +5250,7 @@ void
 fs_visitor::allocate_registers()
 {
    bool allocated_without_spills;
+   unsigned ra_passes = 0, spills = 0;
 
    static const enum instruction_scheduler_mode pre_modes[] = {
       SCHEDULE_PRE,
@@ -5216,6 +5270,7 @@ fs_visitor::allocate_registers()
          allocated_without_spills = true;
       } else {
          allocated_without_spills = assign_regs(false);
+         ra_passes++;
       }
       if (allocated_without_spills)
          break;
@@ -5241,9 +5296,20 @@ fs_visitor::allocate_registers()
        * get an allocation.
        */
       while (!assign_regs(true)) {
+         ra_passes++;
+         spills++;
          if (failed)
             break;
       }
+      ra_passes++;
+   }
+
+   if (!failed && ra_passes > 1) {
+      compiler->shader_perf_log(log_data,
+                                "%s SIMD%d shader took %u register allocation "
+                                "passes (%u spills, %u GRFs used)\n",
+                                stage_abbrev, dispatch_width, ra_passes,
+                                spills, grf_used);
    }
 
    /* This must come after all optimization and register allocation, since
@@ -5440,6 +5506,9 @@ fs_visitor::run_fs(bool do_rep_send)
 
       optimize();
 
+      if (failed)
+         return false;
+
       assign_curb_setup();
       assign_urb_setup();
 
@@ -5584,6 +5653,26 @@ computed_depth_mode(const nir_shader *shader)
    return BRW_PSCDEPTH_OFF;
 }
 
+namespace {
+
+struct simd16_fs_job {
+   fs_visitor *v;
+   bool do_rep_send;
+   bool success;
+};
+
+} /* anonymous namespace */
+
+static int
+run_simd16_fs(void *data)
+{
+   simd16_fs_job *job = (simd16_fs_job *) data;
+
+   job->success = job->v->run_fs(job->do_rep_send);
+
+   return 0;
+}
+
 const unsigned *
 brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
                void *mem_ctx,
@@ -5621,10 +5710,61 @@ brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
                                            key->persample_shading,
                                            shader);
 
+   const bool try_simd16 = likely(!(INTEL_DEBUG & DEBUG_NO16) || use_rep_send);
+
+   /* When the SIMD16 compile runs concurrently with the SIMD8 one, it gets
+    * its own ralloc context and its own copy of prog_data to write to, and
+    * picks up the uniform layout of the SIMD8 compile through a handoff as
+    * soon as it is decided, right before optimization.  Only code emission
+    * can get ahead of that point, but optimization and register allocation
+    * are where most of the time goes anyway.
+    */
+   const bool threaded = try_simd16 && compiler->threaded_fs_compile;
+   brw_wm_prog_data simd16_prog_data = *prog_data;
+   fs_uniform_handoff handoff;
+   simd16_fs_job job;
+   thrd_t thread;
+   bool thread_started = false;
+
    fs_visitor v(compiler, log_data, mem_ctx, key,
                 &prog_data->base, prog, shader, 8,
                 shader_time_index8);
-   if (!v.run_fs(false /* do_rep_send */)) {
+   fs_visitor v2(compiler, log_data,
+                 threaded ? ralloc_context(mem_ctx) : mem_ctx, key,
+                 threaded ? &simd16_prog_data.base : &prog_data->base,
+                 prog, shader, 16, shader_time_index16);
+
+   if (threaded) {
+      mtx_init(&handoff.mutex, mtx_plain);
+      cnd_init(&handoff.cond);
+      handoff.source = NULL;
+      handoff.done = false;
+      v.uniform_handoff = &handoff;
+      v2.uniform_handoff = &handoff;
+
+      job.v = &v2;
+      job.do_rep_send = use_rep_send;
+      job.success = false;
+      thread_started =
+         thrd_create(&thread, run_simd16_fs, &job) == thrd_success;
+   }
+
+   const bool simd8_success = v.run_fs(false /* do_rep_send */);
+
+   if (threaded) {
+      /* Let the SIMD16 compile go if it is still waiting for uniforms. */
+      signal_uniform_handoff(&handoff, NULL);
+
+      if (thread_started)
+         thrd_join(thread, NULL);
+      else
+         run_simd16_fs(&job);
+
+      cnd_destroy(&handoff.cond);
+      mtx_destroy(&handoff.mutex);
+   }
+
+   if (!simd8_success) {
       if (error_str)
          *error_str = ralloc_strdup(mem_ctx, v.fail_msg);
 
@@ -5632,10 +5772,28 @@ brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
    }
 
    cfg_t *simd16_cfg = NULL;
-   fs_visitor v2(compiler, log_data, mem_ctx, key,
-                 &prog_data->base, prog, shader, 16,
-                 shader_time_index16);
-   if (likely(!(INTEL_DEBUG & DEBUG_NO16) || use_rep_send)) {
+   if (threaded && !v.simd16_unsupported) {
+      if (!job.success) {
+         compiler->shader_perf_log(log_data,
+                                   "SIMD16 shader failed to compile: %s",
+                                   v2.fail_msg);
+      } else {
+         simd16_cfg = v2.cfg;
+
+         /* Everything else the SIMD16 compile writes to prog_data is the
+          * same for both dispatch widths.
+          */
+         prog_data->dispatch_grf_start_reg_16 =
+            simd16_prog_data.dispatch_grf_start_reg_16;
+         prog_data->reg_blocks_16 = simd16_prog_data.reg_blocks_16;
+         prog_data->base.total_scratch =
+            MAX2(prog_data->base.total_scratch,
+                 simd16_prog_data.base.total_scratch);
+         prog_data->base.binding_table.size_bytes =
+            MAX2(prog_data->base.binding_table.size_bytes,
+                 simd16_prog_data.base.binding_table.size_bytes);
+      }
+   } else if (!threaded && try_simd16) {
       if (!v.simd16_unsupported) {
          /* Try a SIMD16 compile */
          v2.import_uniforms(&v);
@@ -5784,7 +5942,16 @@ brw_compile_cs(const struct brw_compiler *compiler, void *log_data,
    }
 
    if (unlikely(cfg == NULL)) {
-      assert(fail_msg);
+      /* Neither variant was attempted: the workgroup is too big for SIMD8
+       * and SIMD16 was disabled or can't cover it either.
+       */
+      if (fail_msg == NULL) {
+         fail_msg = ralloc_asprintf(mem_ctx,
+                                    "Local workgroup size %u needs SIMD%u, "
+                                    "which is unavailable",
+                                    local_workgroup_size,
+                                    simd_required <= 16 ? 16 : 32);
+      }
       if (error_str)
          *error_str = ralloc_strdup(mem_ctx, fail_msg);
 
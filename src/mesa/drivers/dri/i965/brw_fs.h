@@ -32,6 +32,7 @@
 #include "brw_fs_builder.h"
 #include "compiler/glsl/ir.h"
 #include "compiler/nir/nir.h"
+#include "c11/threads.h"
 
 struct bblock_t;
 namespace {
@@ -71,6 +72,23 @@ offset(fs_reg reg, const brw::fs_builder& bld, unsigned delta)
  *
  * Translates either GLSL IR or Mesa IR (for ARB_fragment_program) into FS IR.
  */
+class fs_visitor;
+
+/**
+ * Hands the uniform layout decided by a SIMD8 compile over to the SIMD16
+ * compile of the same shader when the two run on different threads.
+ */
+struct fs_uniform_handoff {
+   mtx_t mutex;
+   cnd_t cond;
+
+   /** The SIMD8 visitor, once its constant locations are assigned. */
+   fs_visitor *source;
+
+   /** Set when the SIMD8 compile is done publishing, successfully or not. */
+   bool done;
+};
+
 class fs_visitor : public backend_shader
 {
 public:
@@ -94,6 +112,7 @@ public:
 
    fs_reg vgrf(const glsl_type *const type);
    void import_uniforms(fs_visitor *v);
+   void wait_for_uniforms();
    void setup_uniform_clipplane_values(gl_clip_plane *clip_planes);
    void compute_clip_distance(gl_clip_plane *clip_planes);
 
@@ -332,6 +351,12 @@ public:
    int *virtual_grf_end;
    brw::fs_live_variables *live_intervals;
 
+   /**
+    * Whether virtual_grf_start/end are up to date although live_intervals
+    * was invalidated, because spill_reg() updated them in place.
+    */
+   bool spilled_live_ranges_valid;
+
    int *regs_live_at_ip;
 
    /** Number of uniform variable components visited. */
@@ -374,6 +399,9 @@ public:
    bool simd16_unsupported;
    char *no16_msg;
 
+   /** Set when the SIMD8 and SIMD16 compiles run concurrently. */
+   fs_uniform_handoff *uniform_handoff;
+
    /* Result of last visit() method. Still used by emit_texture() */
    fs_reg result;
 
@@ -295,6 +295,7 @@ fs_visitor::invalidate_live_intervals()
 {
    ralloc_free(live_intervals);
    live_intervals = NULL;
+   spilled_live_ranges_valid = false;
 }
 
 /**
@@ -32,6 +32,8 @@
 
 using namespace brw;
 
+#define MAX_INSTRUCTION (1 << 30)
+
 static void
 assign_reg(unsigned *reg_hw_locations, fs_reg *reg)
 {
@@ -541,6 +543,155 @@ setup_mrf_hack_interference(fs_visitor *v, struct ra_graph *g,
    }
 }
 
+/**
+ * Adds interference between the virtual GRFs whose live ranges overlap, in
+ * the sense of virtual_grf_interferes().
+ *
+ * Instead of testing every pair, this sweeps over the ranges in order of
+ * their start, keeping track of the ones still live at that point.  Only
+ * those can overlap the ranges starting there.
+ */
+static void
+setup_vgrf_interference(fs_visitor *v, struct ra_graph *g)
+{
+   const int *start = v->virtual_grf_start;
+   const int *end = v->virtual_grf_end;
+   const int count = v->alloc.count;
+   int last_start = -1;
+
+   /* Unused VGRFs have an empty range and don't interfere with anything. */
+   for (int i = 0; i < count; i++) {
+      if (end[i] >= start[i])
+         last_start = MAX2(last_start, start[i]);
+   }
+
+   int *first_at_ip = (int *) malloc((last_start + 1) * sizeof(int));
+   int *next_at_ip = (int *) malloc(count * sizeof(int));
+   int *live = (int *) malloc(count * sizeof(int));
+   int num_live = 0;
+
+   memset(first_at_ip, -1, (last_start + 1) * sizeof(int));
+   for (int i = count - 1; i >= 0; i--) {
+      if (end[i] >= start[i]) {
+         next_at_ip[i] = first_at_ip[start[i]];
+         first_at_ip[start[i]] = i;
+      }
+   }
+
+   for (int ip = 0; ip <= last_start; ip++) {
+      if (first_at_ip[ip] == -1)
+         continue;
+
+      /* Ranges ending here or earlier can't overlap any starting later. */
+      int n = 0;
+      for (int k = 0; k < num_live; k++) {
+         if (end[live[k]] > ip)
+            live[n++] = live[k];
+      }
+      num_live = n;
+
+      for (int i = first_at_ip[ip]; i != -1; i = next_at_ip[i]) {
+         for (int k = 0; k < num_live; k++) {
+            const int j = live[k];
+
+            if (end[j] > start[i] && end[i] > start[j])
+               ra_add_node_interference(g, i, j);
+         }
+
+         live[num_live++] = i;
+      }
+   }
+
+   free(first_at_ip);
+   free(next_at_ip);
+   free(live);
+}
+
+/**
+ * Brings virtual_grf_start/end up to date after spill_reg() replaced all
+ * accesses to \p spilled by new VGRFs, numbered from \p first_new_vgrf,
+ * local to the spill and unspill instructions around each access.
+ *
+ * The liveness of the other VGRFs doesn't change, only the IPs of the
+ * instructions do, so their ranges are mapped to the new IPs rather than
+ * recomputed.  A range starting at an instruction is extended to the
+ * unspills inserted in front of it, and one ending at an instruction to
+ * the spills inserted after it.  That is where the range would start or
+ * end if it was live across a block boundary there, and only adds
+ * interference otherwise.
+ */
+static void
+update_live_ranges_after_spill(fs_visitor *v, int spilled,
+                               int first_new_vgrf)
+{
+   const int count = v->alloc.count;
+   const int num_insts = v->cfg->blocks[v->cfg->num_blocks - 1]->end_ip + 1;
+   int *start = reralloc(v->mem_ctx, v->virtual_grf_start, int, count);
+   int *end = reralloc(v->mem_ctx, v->virtual_grf_end, int, count);
+   int *first_ip = (int *) malloc(num_insts * sizeof(int));
+   int *last_ip = (int *) malloc(num_insts * sizeof(int));
+   int old_ip = 0, ip = 0, pending_ip = -1;
+
+   for (int i = first_new_vgrf; i < count; i++) {
+      start[i] = MAX_INSTRUCTION;
+      end[i] = -1;
+   }
+
+   foreach_block_and_inst (block, fs_inst, inst, v->cfg) {
+      const bool is_unspill =
+         (inst->opcode == SHADER_OPCODE_GEN4_SCRATCH_READ ||
+          inst->opcode == SHADER_OPCODE_GEN7_SCRATCH_READ) &&
+         inst->dst.file == VGRF && (int)inst->dst.nr >= first_new_vgrf;
+      const bool is_spill =
+         inst->opcode == SHADER_OPCODE_GEN4_SCRATCH_WRITE &&
+         inst->src[0].file == VGRF && (int)inst->src[0].nr >= first_new_vgrf;
+
+      if (is_unspill) {
+         if (pending_ip == -1)
+            pending_ip = ip;
+         start[inst->dst.nr] = MIN2(start[inst->dst.nr], ip);
+      } else if (is_spill) {
+         assert(old_ip > 0);
+         last_ip[old_ip - 1] = ip;
+         end[inst->src[0].nr] = MAX2(end[inst->src[0].nr], ip);
+      } else {
+         first_ip[old_ip] = pending_ip != -1 ? pending_ip : ip;
+         last_ip[old_ip] = ip;
+         pending_ip = -1;
+         old_ip++;
+
+         for (int i = 0; i < inst->sources; i++) {
+            if (inst->src[i].file == VGRF &&
+                (int)inst->src[i].nr >= first_new_vgrf)
+               end[inst->src[i].nr] = MAX2(end[inst->src[i].nr], ip);
+         }
+
+         if (inst->dst.file == VGRF && (int)inst->dst.nr >= first_new_vgrf)
+            start[inst->dst.nr] = MIN2(start[inst->dst.nr], ip);
+      }
+
+      ip++;
+   }
+
+   for (int i = 0; i < first_new_vgrf; i++) {
+      if (i == spilled) {
+         start[i] = MAX_INSTRUCTION;
+         end[i] = -1;
+      } else if (end[i] >= start[i]) {
+         assert(end[i] < old_ip);
+         start[i] = first_ip[start[i]];
+         end[i] = last_ip[end[i]];
+      }
+   }
+
+   free(first_ip);
+   free(last_ip);
+
+   v->virtual_grf_start = start;
+   v->virtual_grf_end = end;
+   v->spilled_live_ranges_valid = true;
+}
+
 bool
 fs_visitor::assign_regs(bool allow_spilling)
 {
@@ -554,7 +705,8 @@ fs_visitor::assign_regs(bool allow_spilling)
    unsigned hw_reg_mapping[this->alloc.count];
    int payload_node_count = ALIGN(this->first_non_payload_grf, reg_width);
    int rsi = reg_width - 1; /* Which compiler->fs_reg_sets[] to use */
-   calculate_live_intervals();
+   if (!spilled_live_ranges_valid)
+      calculate_live_intervals();
 
    int node_count = this->alloc.count;
    int first_payload_node = node_count;
@@ -589,14 +741,10 @@ fs_visitor::assign_regs(bool allow_spilling)
       }
 
       ra_set_node_class(g, i, c);
-
-      for (unsigned j = 0; j < i; j++) {
-	 if (virtual_grf_interferes(i, j)) {
-	    ra_add_node_interference(g, i, j);
-	 }
-      }
    }
 
+   setup_vgrf_interference(this, g);
+
    /* Certain instructions can't safely use the same register for their
     * sources and destination.  Add interference.
     */
@@ -868,6 +1016,8 @@ fs_visitor::spill_reg(int spill_reg)
 {
    int size = alloc.sizes[spill_reg];
    unsigned int spill_offset = last_scratch;
+   int first_new_vgrf = alloc.count;
+   bool live_ranges_valid = live_intervals || spilled_live_ranges_valid;
    assert(ALIGN(spill_offset, 16) == spill_offset); /* oword read/write req. */
    int spill_base_mrf = dispatch_width > 8 ? FIRST_SPILL_MRF(devinfo->gen) :
                                              FIRST_SPILL_MRF(devinfo->gen) + 1;
@@ -948,4 +1098,7 @@ fs_visitor::spill_reg(int spill_reg)
    }
 
    invalidate_live_intervals();
+
+   if (live_ranges_valid)
+      update_live_ranges_after_spill(this, spill_reg, first_new_vgrf);
 }
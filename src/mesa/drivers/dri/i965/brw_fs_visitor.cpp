@@ -1038,6 +1038,7 @@ fs_visitor::init()
    this->failed = false;
    this->simd16_unsupported = false;
    this->no16_msg = NULL;
+   this->uniform_handoff = NULL;
 
    this->nir_locals = NULL;
    this->nir_ssa_values = NULL;
@@ -1052,6 +1053,7 @@ fs_visitor::init()
    this->virtual_grf_start = NULL;
    this->virtual_grf_end = NULL;
    this->live_intervals = NULL;
+   this->spilled_live_ranges_valid = false;
    this->regs_live_at_ip = NULL;
 
    this->uniforms = 0;
@@ -399,8 +399,10 @@ static nir_shader *
 nir_optimize(nir_shader *nir, bool is_scalar)
 {
    bool progress;
+   unsigned iterations = 0;
    do {
       progress = false;
+      iterations++;
       OPT_V(nir_lower_vars_to_ssa);
 
       if (is_scalar) {
@@ -422,8 +424,12 @@ nir_optimize(nir_shader *nir, bool is_scalar)
       OPT(nir_opt_dead_cf);
       OPT(nir_opt_remove_phis);
       OPT(nir_opt_undef);
+      OPT(nir_opt_loop_unroll);
    } while (progress);
 
+   nir_pass_stats_loop(is_scalar ? "brw nir_optimize (scalar)" :
+                                   "brw nir_optimize (vec4)", iterations);
+
    return nir;
 }
 
@@ -473,6 +479,28 @@ brw_preprocess_nir(nir_shader *nir, bool is_scalar)
    return nir;
 }
 
+/**
+ * Tells nir_opt_load_store_vectorize which combined memory accesses the
+ * scalar backend can do in a single message.
+ */
+static bool
+brw_nir_should_vectorize_mem(nir_intrinsic_op intrin, unsigned num_components,
+                             unsigned align_mul, unsigned align_offset,
+                             void *data)
+{
+   switch (intrin) {
+   case nir_intrinsic_load_ubo:
+      /* Constant offset UBO loads fetch one 16-byte aligned block, so the
+       * vector must not straddle two.  Loads with a varying offset are done
+       * a component at a time anyway.
+       */
+      return align_mul >= 16 && (align_offset % 16) / 4 + num_components <= 4;
+   default:
+      /* Untyped surface reads and writes take up to four components. */
+      return num_components <= 4;
+   }
+}
+
 /* Prepare the given shader for codegen
  *
  * This function is intended to be called right before going into the actual
@@ -493,6 +521,9 @@ brw_postprocess_nir(nir_shader *nir,
 
    nir = nir_optimize(nir, is_scalar);
 
+   if (is_scalar)
+      OPT(nir_opt_load_store_vectorize, brw_nir_should_vectorize_mem, NULL);
+
    if (devinfo->gen >= 6) {
       /* Try and fuse multiply-adds */
       OPT(brw_nir_opt_peephole_ffma);
@@ -140,8 +140,24 @@ brw_perf_monitor(struct gl_perf_monitor_object *m)
 enum brw_counter_groups {
    OA_COUNTERS, /* Observability Architecture (MI_REPORT_PERF_COUNT) Counters */
    PIPELINE_STATS_COUNTERS, /* Pipeline Statistics Register Counters */
+   RENDER_BASIC_COUNTERS, /* OA metric set: render basic */
+   COMPUTE_BASIC_COUNTERS, /* OA metric set: compute basic */
 };
 
+/**
+ * OA metric sets:
+ *
+ * The raw OA group hands back every aggregating counter the hardware has,
+ * which is more than most profilers want to sift through.  Metric sets are
+ * additional groups made of a subset of those same counters, so that each
+ * one shows up as a self-contained query through INTEL_performance_query.
+ *
+ * They don't cost any extra hardware state: a metric set's values come out
+ * of the very same MI_REPORT_PERF_COUNT snapshots as the raw OA group.  Each
+ * set is described by its counter list plus a parallel array of the raw OA
+ * counter IDs backing them.
+ */
+
 /**
  * Ironlake:
  *  @{
@@ -343,9 +359,46 @@ static const int gen6_statistics_register_addresses[] = {
    GEN6_SO_PRIM_STORAGE_NEEDED,
 };
 
+static const struct gl_perf_monitor_counter gen6_render_basic_counters[] = {
+   COUNTER("Aggregated Core Array Active"),
+   COUNTER("Aggregated Core Array Stalled"),
+   COUNTER("Vertex Shader Active Time"),
+   COUNTER("Pixel Shader Active Time"),
+   COUNTER("Pixel Shader Stall Time - Core Stall"),
+   COUNTER("# PS threads loaded"),
+   COUNTER("Early Z Test Pixels Passing"),
+   COUNTER("Early Z Test Pixels Failing"),
+   COUNTER("Pixel Kill Count"),
+   COUNTER("Pixels/samples Written in the frame buffer"),
+   COUNTER("GPU Busy"),
+};
+
+/** Raw OA counter IDs for gen6_render_basic_counters. */
+static const int gen6_render_basic_oa_counters[] = {
+    0, /* Aggregated Core Array Active */
+    1, /* Aggregated Core Array Stalled */
+    2, /* Vertex Shader Active Time */
+   10, /* Pixel Shader Active Time */
+   11, /* Pixel Shader Stall Time - Core Stall */
+   12, /* # PS threads loaded */
+   14, /* Early Z Test Pixels Passing */
+   15, /* Early Z Test Pixels Failing */
+   18, /* Pixel Kill Count */
+   22, /* Pixels/samples Written in the frame buffer */
+   23, /* GPU Busy */
+};
+
 static const struct gl_perf_monitor_group gen6_groups[] = {
-   GROUP("Observability Architecture Counters", INT_MAX, gen6_raw_oa_counters),
-   GROUP("Pipeline Statistics Registers", INT_MAX, gen6_statistics_counters),
+   [OA_COUNTERS] =
+      GROUP("Observability Architecture Counters", INT_MAX, gen6_raw_oa_counters),
+   [PIPELINE_STATS_COUNTERS] =
+      GROUP("Pipeline Statistics Registers", INT_MAX, gen6_statistics_counters),
+   [RENDER_BASIC_COUNTERS] =
+      GROUP("Render Metrics Basic", INT_MAX, gen6_render_basic_counters),
+};
+
+static const int *const gen6_oa_metric_sets[ARRAY_SIZE(gen6_groups)] = {
+   [RENDER_BASIC_COUNTERS] = gen6_render_basic_oa_counters,
 };
 /** @} */
 
@@ -512,9 +565,74 @@ static const int gen7_statistics_register_addresses[] = {
    GEN7_SO_PRIM_STORAGE_NEEDED(3),
 };
 
+static const struct gl_perf_monitor_counter gen7_render_basic_counters[] = {
+   COUNTER("Aggregated Core Array Active"),
+   COUNTER("Aggregated Core Array Stalled"),
+   COUNTER("Vertex Shader Active Time"),
+   COUNTER("Pixel Shader Active Time"),
+   COUNTER("Pixel Shader Stall Time - Core Stall"),
+   COUNTER("# PS threads loaded"),
+   COUNTER("HiZ Fast Z Test Pixels Passing"),
+   COUNTER("HiZ Fast Z Test Pixels Failing"),
+   COUNTER("Pixel Kill Count"),
+   COUNTER("3D/GPGPU Render Target Writes"),
+   COUNTER("Render Engine Busy"),
+   COUNTER("VS bottleneck"),
+   COUNTER("GS bottleneck"),
+};
+
+/** Raw OA counter IDs for gen7_render_basic_counters. */
+static const int gen7_render_basic_oa_counters[] = {
+    0, /* Aggregated Core Array Active */
+    1, /* Aggregated Core Array Stalled */
+    2, /* Vertex Shader Active Time */
+   17, /* Pixel Shader Active Time */
+   18, /* Pixel Shader Stall Time - Core Stall */
+   19, /* # PS threads loaded */
+   20, /* HiZ Fast Z Test Pixels Passing */
+   21, /* HiZ Fast Z Test Pixels Failing */
+   24, /* Pixel Kill Count */
+   28, /* 3D/GPGPU Render Target Writes */
+   29, /* Render Engine Busy */
+   30, /* VS bottleneck */
+   31, /* GS bottleneck */
+};
+
+static const struct gl_perf_monitor_counter gen7_compute_basic_counters[] = {
+   COUNTER("Aggregated Core Array Active"),
+   COUNTER("Aggregated Core Array Stalled"),
+   COUNTER("Compute Shader Active Time"),
+   COUNTER("Compute Shader Stall Time - Core Stall"),
+   COUNTER("# CS threads loaded"),
+   COUNTER("3D/GPGPU Render Target Writes"),
+   COUNTER("Render Engine Busy"),
+};
+
+/** Raw OA counter IDs for gen7_compute_basic_counters. */
+static const int gen7_compute_basic_oa_counters[] = {
+    0, /* Aggregated Core Array Active */
+    1, /* Aggregated Core Array Stalled */
+   11, /* Compute Shader Active Time */
+   12, /* Compute Shader Stall Time - Core Stall */
+   13, /* # CS threads loaded */
+   28, /* 3D/GPGPU Render Target Writes */
+   29, /* Render Engine Busy */
+};
+
 static const struct gl_perf_monitor_group gen7_groups[] = {
-   GROUP("Observability Architecture Counters", INT_MAX, gen7_raw_oa_counters),
-   GROUP("Pipeline Statistics Registers", INT_MAX, gen7_statistics_counters),
+   [OA_COUNTERS] =
+      GROUP("Observability Architecture Counters", INT_MAX, gen7_raw_oa_counters),
+   [PIPELINE_STATS_COUNTERS] =
+      GROUP("Pipeline Statistics Registers", INT_MAX, gen7_statistics_counters),
+   [RENDER_BASIC_COUNTERS] =
+      GROUP("Render Metrics Basic", INT_MAX, gen7_render_basic_counters),
+   [COMPUTE_BASIC_COUNTERS] =
+      GROUP("Compute Metrics Basic", INT_MAX, gen7_compute_basic_counters),
+};
+
+static const int *const gen7_oa_metric_sets[ARRAY_SIZE(gen7_groups)] = {
+   [RENDER_BASIC_COUNTERS] = gen7_render_basic_oa_counters,
+   [COMPUTE_BASIC_COUNTERS] = gen7_compute_basic_oa_counters,
 };
 /** @} */
 
@@ -633,7 +751,36 @@ static bool
 monitor_needs_oa(struct brw_context *brw,
                  struct gl_perf_monitor_object *m)
 {
-   return m->ActiveGroups[OA_COUNTERS];
+   if (m->ActiveGroups[OA_COUNTERS])
+      return true;
+
+   if (brw->perfmon.oa_metric_sets) {
+      for (int g = 0; g < brw->ctx.PerfMonitor.NumGroups; g++) {
+         if (brw->perfmon.oa_metric_sets[g] && m->ActiveGroups[g])
+            return true;
+      }
+   }
+
+   return false;
+}
+
+/**
+ * Look up the accumulated value of a raw OA counter.
+ *
+ * monitor->oa_results is indexed by snapshot offset rather than counter ID,
+ * so find where MI_REPORT_PERF_COUNT stores the counter.
+ */
+static uint32_t
+oa_counter_result(struct brw_context *brw,
+                  struct brw_perf_monitor_object *monitor,
+                  int counter)
+{
+   for (int i = 0; i < brw->perfmon.entries_per_oa_snapshot; i++) {
+      if (brw->perfmon.oa_snapshot_layout[i] == counter)
+         return monitor->oa_results[i];
+   }
+
+   unreachable("OA counter missing from the snapshot layout");
 }
 
 /**
@@ -1317,6 +1464,29 @@ brw_get_perf_monitor_result(struct gl_context *ctx,
          }
       }
 
+      /* Metric sets are reported in counter order, which is what
+       * INTEL_performance_query's counter offsets assume.
+       */
+      for (int group = 0; group < ctx->PerfMonitor.NumGroups; group++) {
+         const int *oa_counters = brw->perfmon.oa_metric_sets ?
+            brw->perfmon.oa_metric_sets[group] : NULL;
+
+         if (!oa_counters || !m->ActiveGroups[group])
+            continue;
+
+         for (int i = 0; i < ctx->PerfMonitor.Groups[group].NumCounters; i++) {
+            if (!BITSET_TEST(m->ActiveCounters[group], i))
+               continue;
+
+            if (data + offset + 3 <= data_end) {
+               data[offset++] = group;
+               data[offset++] = i;
+               data[offset++] =
+                  oa_counter_result(brw, monitor, oa_counters[i]);
+            }
+         }
+      }
+
       clean_bookend_bo(brw);
    }
 
@@ -1457,12 +1627,14 @@ brw_init_performance_monitors(struct brw_context *brw)
       brw->perfmon.oa_snapshot_layout = gen6_oa_snapshot_layout;
       brw->perfmon.entries_per_oa_snapshot = ARRAY_SIZE(gen6_oa_snapshot_layout);
       brw->perfmon.statistics_registers = gen6_statistics_register_addresses;
+      brw->perfmon.oa_metric_sets = gen6_oa_metric_sets;
    } else if (brw->gen == 7) {
       ctx->PerfMonitor.Groups = gen7_groups;
       ctx->PerfMonitor.NumGroups = ARRAY_SIZE(gen7_groups);
       brw->perfmon.oa_snapshot_layout = gen7_oa_snapshot_layout;
       brw->perfmon.entries_per_oa_snapshot = ARRAY_SIZE(gen7_oa_snapshot_layout);
       brw->perfmon.statistics_registers = gen7_statistics_register_addresses;
+      brw->perfmon.oa_metric_sets = gen7_oa_metric_sets;
    }
 
    brw->perfmon.unresolved =
@@ -1658,9 +1658,257 @@ instruction_scheduler::run(cfg_t *cfg)
    cfg->cycle_count = get_cycle_count(cfg);
 }
 
+/**
+ * Registers accessed by a range of instructions that others are moved
+ * across, for hoist_sends_above_branches().
+ */
+struct hoist_barrier {
+   BITSET_WORD *read;
+   BITSET_WORD *written;
+   bool fixed_grf_written;
+};
+
+static void
+hoist_barrier_add(struct hoist_barrier *barrier, const fs_inst *inst)
+{
+   for (int i = 0; i < inst->sources; i++) {
+      if (inst->src[i].file == VGRF)
+         BITSET_SET(barrier->read, inst->src[i].nr);
+   }
+
+   if (inst->dst.file == VGRF)
+      BITSET_SET(barrier->written, inst->dst.nr);
+   else if (inst->dst.file == FIXED_GRF)
+      barrier->fixed_grf_written = true;
+}
+
+/** Whether \p inst may be moved in front of everything in \p barrier. */
+static bool
+hoist_barrier_allows(const struct hoist_barrier *barrier, const fs_inst *inst,
+                     const struct brw_device_info *devinfo)
+{
+   if (inst->is_control_flow() ||
+       inst->has_side_effects() ||
+       inst->is_volatile() ||
+       inst->base_mrf != -1 ||
+       inst->eot ||
+       inst->reads_flag() ||
+       inst->writes_flag() ||
+       inst->reads_accumulator_implicitly() ||
+       inst->writes_accumulator_implicitly(devinfo) ||
+       inst->dst.file != VGRF ||
+       BITSET_TEST(barrier->read, inst->dst.nr) ||
+       BITSET_TEST(barrier->written, inst->dst.nr))
+      return false;
+
+   for (int i = 0; i < inst->sources; i++) {
+      switch (inst->src[i].file) {
+      case BAD_FILE:
+      case IMM:
+      case UNIFORM:
+      case ATTR:
+         break;
+      case VGRF:
+         if (BITSET_TEST(barrier->written, inst->src[i].nr))
+            return false;
+         break;
+      case FIXED_GRF:
+         if (inst->src[i].is_accumulator() || barrier->fixed_grf_written)
+            return false;
+         break;
+      default:
+         return false;
+      }
+   }
+
+   return true;
+}
+
+/**
+ * Whether \p later may be moved above \p earlier, within a block.
+ * Virtual GRFs are compared as a whole.
+ */
+static bool
+insts_commute(const fs_inst *earlier, const fs_inst *later)
+{
+   assert(earlier->dst.file == VGRF && later->dst.file == VGRF);
+
+   if (earlier->dst.nr == later->dst.nr)
+      return false;
+
+   for (int i = 0; i < later->sources; i++) {
+      if (later->src[i].file == VGRF && later->src[i].nr == earlier->dst.nr)
+         return false;
+   }
+
+   for (int i = 0; i < earlier->sources; i++) {
+      if (earlier->src[i].file == VGRF && earlier->src[i].nr == later->dst.nr)
+         return false;
+   }
+
+   return true;
+}
+
+/**
+ * Adds everything between the IF ending \p if_block and its ENDIF to \p
+ * barrier.
+ *
+ * \return the block starting with the ENDIF, or NULL if some of the
+ * instructions in between could make the channels enabled after the ENDIF
+ * differ from the ones enabled at the IF, or access memory.
+ */
+static bblock_t *
+find_join_block(bblock_t *if_block, struct hoist_barrier *barrier)
+{
+   int depth = 0;
+
+   hoist_barrier_add(barrier, (fs_inst *)if_block->end());
+
+   for (bblock_t *block = if_block->next(); block; block = block->next()) {
+      foreach_inst_in_block(fs_inst, inst, block) {
+         switch (inst->opcode) {
+         case BRW_OPCODE_IF:
+            depth++;
+            break;
+         case BRW_OPCODE_ENDIF:
+            if (depth-- == 0)
+               return block;
+            break;
+         case BRW_OPCODE_BREAK:
+         case BRW_OPCODE_CONTINUE:
+         case BRW_OPCODE_HALT:
+         case FS_OPCODE_DISCARD_JUMP:
+         case FS_OPCODE_PLACEHOLDER_HALT:
+            return NULL;
+         default:
+            if (inst->has_side_effects() || inst->is_volatile())
+               return NULL;
+            break;
+         }
+
+         hoist_barrier_add(barrier, inst);
+      }
+   }
+
+   return NULL;
+}
+
+/* Instructions at the start of a join block looked at for hoisting. */
+#define HOIST_MAX_CANDIDATES 32
+
+/* Registers the hoisted instructions of a join block may write, which are
+ * kept live across the whole if/else.
+ */
+#define HOIST_MAX_REGS_WRITTEN 16
+
+/**
+ * Superblock step of the pre-RA FS scheduling: moves messages sent right
+ * after an ENDIF, along with the instructions computing their payload, in
+ * front of the matching IF.
+ *
+ * The list scheduler only works within a basic block, so the latency of a
+ * texture fetch or pull constant load at the start of the block following
+ * an if/else can't be hidden behind the if/else itself, and the thread
+ * stalls on the first use of the result.  Once moved to the block ending
+ * with the IF, the list scheduler can issue the message early there.
+ *
+ * With structured control flow and no BREAK, CONTINUE or HALT in between,
+ * the channels enabled after an ENDIF are the ones that were enabled at the
+ * IF, so this doesn't change which channels send the message, and the
+ * message still executes exactly once.  The moved instructions must not
+ * depend on or interfere with anything in between, and the if/else must not
+ * access memory for the messages to see the same data.
+ */
+static bool
+hoist_sends_above_branches(fs_visitor *v)
+{
+   const struct brw_device_info *devinfo = v->devinfo;
+   void *mem_ctx = ralloc_context(NULL);
+   bool progress = false;
+   struct hoist_barrier barrier;
+
+   barrier.read = rzalloc_array(mem_ctx, BITSET_WORD,
+                                BITSET_WORDS(v->alloc.count));
+   barrier.written = rzalloc_array(mem_ctx, BITSET_WORD,
+                                   BITSET_WORDS(v->alloc.count));
+
+   foreach_block(block, v->cfg) {
+      if (block->end()->opcode != BRW_OPCODE_IF)
+         continue;
+
+      memset(barrier.read, 0,
+             BITSET_WORDS(v->alloc.count) * sizeof(BITSET_WORD));
+      memset(barrier.written, 0,
+             BITSET_WORDS(v->alloc.count) * sizeof(BITSET_WORD));
+      barrier.fixed_grf_written = false;
+
+      bblock_t *join = find_join_block(block, &barrier);
+      if (join == NULL)
+         continue;
+
+      /* Find what could be moved, in program order. */
+      fs_inst *candidates[HOIST_MAX_CANDIDATES];
+      int num_candidates = 0, scanned = 0;
+
+      foreach_inst_in_block(fs_inst, inst, join) {
+         if (inst->opcode == BRW_OPCODE_ENDIF)
+            continue;
+
+         if (inst->is_control_flow() || scanned++ == HOIST_MAX_CANDIDATES)
+            break;
+
+         if (hoist_barrier_allows(&barrier, inst, devinfo))
+            candidates[num_candidates++] = inst;
+         else
+            hoist_barrier_add(&barrier, inst);
+      }
+
+      /* Only keep the messages and what they can't be moved without.  Any
+       * other candidate stays behind, so the ones kept after it have to
+       * commute with it.
+       */
+      bool keep[HOIST_MAX_CANDIDATES];
+      bool any_message = false;
+      unsigned regs_written = 0;
+
+      for (int i = num_candidates - 1; i >= 0; i--) {
+         keep[i] = candidates[i]->mlen > 0;
+
+         for (int j = i + 1; j < num_candidates && !keep[i]; j++) {
+            if (keep[j] && !insts_commute(candidates[i], candidates[j]))
+               keep[i] = true;
+         }
+
+         if (keep[i]) {
+            any_message |= candidates[i]->mlen > 0;
+            regs_written += candidates[i]->regs_written;
+         }
+      }
+
+      if (!any_message || regs_written > HOIST_MAX_REGS_WRITTEN)
+         continue;
+
+      for (int i = 0; i < num_candidates; i++) {
+         if (!keep[i])
+            continue;
+
+         candidates[i]->remove(join);
+         block->end()->insert_before(block, candidates[i]);
+         progress = true;
+      }
+   }
+
+   ralloc_free(mem_ctx);
+
+   return progress;
+}
+
 void
 fs_visitor::schedule_instructions(instruction_scheduler_mode mode)
 {
+   if (mode == SCHEDULE_PRE && hoist_sends_above_branches(this))
+      invalidate_live_intervals();
+
    if (mode != SCHEDULE_POST)
       calculate_live_intervals();
 
@@ -34,6 +34,7 @@
 #define BRW_STATE_H
 
 #include "brw_context.h"
+#include "util/disk_cache.h"
 #include "brw_defines.h"
 
 #ifdef __cplusplus
@@ -245,11 +246,56 @@ bool brw_search_cache(struct brw_cache *cache,
 		      const void *key,
 		      GLuint key_size,
 		      uint32_t *inout_offset, void *inout_aux);
+bool brw_search_cache_compatible(struct brw_cache *cache,
+                                 enum brw_cache_id cache_id,
+                                 const void *key,
+                                 GLuint key_size,
+                                 bool (*compatible)(const void *key,
+                                                    const void *other),
+                                 uint32_t *inout_offset, void *inout_aux);
 void brw_state_cache_check_size( struct brw_context *brw );
 
 void brw_init_caches( struct brw_context *brw );
 void brw_destroy_caches( struct brw_context *brw );
 
+/***********************************************************************
+ * brw_disk_cache.c
+ */
+
+/** What a program compile needs to go through the disk cache. */
+struct brw_disk_cache_program {
+   /** False if the program is not to be written to the disk cache. */
+   bool enabled;
+
+   cache_key key;
+
+   /** The param[] array as set up before the compile. */
+   const union gl_constant_value **params;
+   unsigned nr_params;
+};
+
+struct disk_cache *brw_disk_cache_create(const struct intel_screen *screen);
+
+bool brw_disk_cache_load_program(struct brw_context *brw,
+                                 struct brw_disk_cache_program *dcp,
+                                 enum brw_cache_id cache_id,
+                                 const void *key, unsigned key_size,
+                                 unsigned program_string_id_offset,
+                                 uint32_t compile_flags,
+                                 struct gl_program *prog,
+                                 struct brw_stage_prog_data *prog_data,
+                                 unsigned prog_data_size,
+                                 void *mem_ctx,
+                                 const unsigned **program,
+                                 unsigned *program_size);
+
+void brw_disk_cache_store_program(struct brw_context *brw,
+                                  const struct brw_disk_cache_program *dcp,
+                                  const unsigned *program,
+                                  unsigned program_size,
+                                  const struct brw_stage_prog_data *prog_data,
+                                  unsigned prog_data_size);
+
 /***********************************************************************
  * brw_state_batch.c
  */
@@ -37,8 +37,10 @@
  * of state (plus associated auxiliary data) in return.  Objects in
  * the cache may not have relocations (pointers to other BOs) in them.
  *
- * The inner workings are a simple hash table based on a CRC of the
- * key data.
+ * The inner workings are an open-addressed hash table, with linear
+ * probing, based on a CRC of the key data.  Lookups first check the item
+ * last found for the same cache_id, which in steady state is the one
+ * wanted.
  *
  * Replacement is not implemented.  Instead, when the cache gets too
  * big we throw out all of the cache data and let it get regenerated.
@@ -87,46 +89,47 @@ static struct brw_cache_item *
 search_cache(struct brw_cache *cache, GLuint hash,
 	     struct brw_cache_item *lookup)
 {
-   struct brw_cache_item *c;
-
-#if 0
-   int bucketcount = 0;
-
-   for (c = cache->items[hash % cache->size]; c; c = c->next)
-      bucketcount++;
-
-   fprintf(stderr, "bucket %d/%d = %d/%d items\n", hash % cache->size,
-	   cache->size, bucketcount, cache->n_items);
-#endif
+   const GLuint mask = cache->size - 1;
+   GLuint i;
 
-   for (c = cache->items[hash % cache->size]; c; c = c->next) {
-      if (brw_cache_item_equals(lookup, c))
-	 return c;
+   for (i = hash & mask; cache->table[i].item; i = (i + 1) & mask) {
+      if (cache->table[i].hash == hash &&
+          brw_cache_item_equals(lookup, cache->table[i].item))
+	 return cache->table[i].item;
    }
 
    return NULL;
 }
 
+static void
+insert_slot(struct brw_cache_slot *table, GLuint size,
+            struct brw_cache_item *item)
+{
+   const GLuint mask = size - 1;
+   GLuint i;
+
+   for (i = item->hash & mask; table[i].item; i = (i + 1) & mask)
+      ;
+
+   table[i].hash = item->hash;
+   table[i].item = item;
+}
 
 static void
 rehash(struct brw_cache *cache)
 {
-   struct brw_cache_item **items;
-   struct brw_cache_item *c, *next;
-   GLuint size, i;
+   struct brw_cache_slot *table;
+   struct brw_cache_item *c;
+   GLuint size;
 
-   size = cache->size * 3;
-   items = calloc(size, sizeof(*items));
+   size = cache->size * 2;
+   table = calloc(size, sizeof(*table));
 
-   for (i = 0; i < cache->size; i++)
-      for (c = cache->items[i]; c; c = next) {
-	 next = c->next;
-	 c->next = items[c->hash % size];
-	 items[c->hash % size] = c;
-      }
+   for (c = cache->items; c; c = c->next)
+      insert_slot(table, size, c);
 
-   free(cache->items);
-   cache->items = items;
+   free(cache->table);
+   cache->table = table;
    cache->size = size;
 }
 
@@ -141,17 +144,59 @@ brw_search_cache(struct brw_cache *cache,
                  uint32_t *inout_offset, void *inout_aux)
 {
    struct brw_context *brw = cache->brw;
-   struct brw_cache_item *item;
+   struct brw_cache_item *item = cache->last_hit[cache_id];
    struct brw_cache_item lookup;
    GLuint hash;
 
-   lookup.cache_id = cache_id;
-   lookup.key = key;
-   lookup.key_size = key_size;
-   hash = hash_key(&lookup);
-   lookup.hash = hash;
+   if (item == NULL || item->key_size != key_size ||
+       memcmp(item->key, key, key_size) != 0) {
+      lookup.cache_id = cache_id;
+      lookup.key = key;
+      lookup.key_size = key_size;
+      hash = hash_key(&lookup);
+      lookup.hash = hash;
 
-   item = search_cache(cache, hash, &lookup);
+      item = search_cache(cache, hash, &lookup);
+
+      if (item == NULL)
+         return false;
+
+      cache->last_hit[cache_id] = item;
+   }
+
+   void *aux = ((char *) item->key) + item->key_size;
+
+   if (item->offset != *inout_offset || aux != *((void **) inout_aux)) {
+      brw->ctx.NewDriverState |= (1 << cache_id);
+      *inout_offset = item->offset;
+      *((void **) inout_aux) = aux;
+   }
+
+   return true;
+}
+
+/**
+ * Like brw_search_cache(), but returns any item of \p cache_id for which
+ * \p compatible returns true, for a caller that can make do with a program
+ * that isn't the exact one for \p key.  Walks the whole cache, most recent
+ * item first.
+ */
+bool
+brw_search_cache_compatible(struct brw_cache *cache,
+                            enum brw_cache_id cache_id,
+                            const void *key, GLuint key_size,
+                            bool (*compatible)(const void *key,
+                                               const void *other),
+                            uint32_t *inout_offset, void *inout_aux)
+{
+   struct brw_context *brw = cache->brw;
+   struct brw_cache_item *item;
+
+   for (item = cache->items; item; item = item->next) {
+      if (item->cache_id == cache_id && item->key_size == key_size &&
+          compatible(key, item->key))
+         break;
+   }
 
    if (item == NULL)
       return false;
@@ -210,26 +255,23 @@ brw_lookup_prog(const struct brw_cache *cache,
                 const void *data, unsigned data_size)
 {
    const struct brw_context *brw = cache->brw;
-   unsigned i;
    const struct brw_cache_item *item;
 
-   for (i = 0; i < cache->size; i++) {
-      for (item = cache->items[i]; item; item = item->next) {
-	 int ret;
+   for (item = cache->items; item; item = item->next) {
+      int ret;
 
-	 if (item->cache_id != cache_id || item->size != data_size)
-	    continue;
+      if (item->cache_id != cache_id || item->size != data_size)
+         continue;
 
-         if (!brw->has_llc)
-            drm_intel_bo_map(cache->bo, false);
-	 ret = memcmp(cache->bo->virtual + item->offset, data, item->size);
-         if (!brw->has_llc)
-            drm_intel_bo_unmap(cache->bo);
-	 if (ret)
-	    continue;
+      if (!brw->has_llc)
+         drm_intel_bo_map(cache->bo, false);
+      ret = memcmp(cache->bo->virtual + item->offset, data, item->size);
+      if (!brw->has_llc)
+         drm_intel_bo_unmap(cache->bo);
+      if (ret)
+         continue;
 
-	 return item;
-      }
+      return item;
    }
 
    return NULL;
@@ -321,12 +363,13 @@ brw_upload_cache(struct brw_cache *cache,
 
    item->key = tmp;
 
-   if (cache->n_items > cache->size * 1.5f)
+   /* Keep the table at most half full, so that probe sequences stay short. */
+   if (2 * (cache->n_items + 1) > cache->size)
       rehash(cache);
 
-   hash %= cache->size;
-   item->next = cache->items[hash];
-   cache->items[hash] = item;
+   insert_slot(cache->table, cache->size, item);
+   item->next = cache->items;
+   cache->items = item;
    cache->n_items++;
 
    *out_offset = item->offset;
@@ -341,10 +384,10 @@ brw_init_caches(struct brw_context *brw)
 
    cache->brw = brw;
 
-   cache->size = 7;
+   cache->size = 64;
    cache->n_items = 0;
-   cache->items =
-      calloc(cache->size, sizeof(struct brw_cache_item *));
+   cache->items = NULL;
+   cache->table = calloc(cache->size, sizeof(struct brw_cache_slot));
 
    cache->bo = drm_intel_bo_alloc(brw->bufmgr,
 				  "program cache",
@@ -357,26 +400,25 @@ static void
 brw_clear_cache(struct brw_context *brw, struct brw_cache *cache)
 {
    struct brw_cache_item *c, *next;
-   GLuint i;
 
    DBG("%s\n", __func__);
 
-   for (i = 0; i < cache->size; i++) {
-      for (c = cache->items[i]; c; c = next) {
-	 next = c->next;
-         if (c->cache_id == BRW_CACHE_VS_PROG ||
-             c->cache_id == BRW_CACHE_GS_PROG ||
-             c->cache_id == BRW_CACHE_FS_PROG ||
-             c->cache_id == BRW_CACHE_CS_PROG) {
-            const void *item_aux = c->key + c->key_size;
-            brw_stage_prog_data_free(item_aux);
-         }
-	 free((void *)c->key);
-	 free(c);
+   for (c = cache->items; c; c = next) {
+      next = c->next;
+      if (c->cache_id == BRW_CACHE_VS_PROG ||
+          c->cache_id == BRW_CACHE_GS_PROG ||
+          c->cache_id == BRW_CACHE_FS_PROG ||
+          c->cache_id == BRW_CACHE_CS_PROG) {
+         const void *item_aux = c->key + c->key_size;
+         brw_stage_prog_data_free(item_aux);
       }
-      cache->items[i] = NULL;
+      free((void *)c->key);
+      free(c);
    }
 
+   cache->items = NULL;
+   memset(cache->table, 0, cache->size * sizeof(struct brw_cache_slot));
+   memset(cache->last_hit, 0, sizeof(cache->last_hit));
    cache->n_items = 0;
 
    /* Start putting programs into the start of the BO again, since
@@ -436,8 +478,8 @@ brw_destroy_cache(struct brw_context *brw, struct brw_cache *cache)
    drm_intel_bo_unreference(cache->bo);
    cache->bo = NULL;
    brw_clear_cache(brw, cache);
-   free(cache->items);
-   cache->items = NULL;
+   free(cache->table);
+   cache->table = NULL;
    cache->size = 0;
 }
 
@@ -459,10 +459,30 @@ brw_copy_pipeline_atoms(struct brw_context *brw,
    struct brw_tracked_state *context_atoms =
       (struct brw_tracked_state *) brw_get_pipeline_atoms(brw, pipeline);
 
+   struct brw_atom_index *index = &brw->atom_index[pipeline];
+
+   memset(index, 0, sizeof(*index));
+
    for (int i = 0; i < num_atoms; i++) {
       context_atoms[i] = *atoms[i];
       assert(context_atoms[i].dirty.mesa | context_atoms[i].dirty.brw);
       assert(context_atoms[i].emit);
+
+      GLbitfield mesa = context_atoms[i].dirty.mesa;
+      uint64_t brw_bits = context_atoms[i].dirty.brw;
+
+      while (mesa) {
+         const int bit = ffs(mesa) - 1;
+         mesa &= ~(1u << bit);
+         index->mesa[bit][i / 64] |= 1ull << (i % 64);
+      }
+
+      while (brw_bits) {
+         const int bit = ffsll(brw_bits) - 1;
+         brw_bits &= ~(1ull << bit);
+         assert(bit < BRW_NUM_STATE_BITS);
+         index->brw[bit][i / 64] |= 1ull << (i % 64);
+      }
    }
 
    brw->num_atoms[pipeline] = num_atoms;
@@ -539,6 +559,7 @@ void brw_init_state( struct brw_context *brw )
 
 void brw_destroy_state( struct brw_context *brw )
 {
+   brw_wm_destroy_async(brw);
    brw_destroy_caches(brw);
 }
 
@@ -690,6 +711,34 @@ brw_print_dirty_count(struct dirty_bit_map *bit_map)
    }
 }
 
+/**
+ * Emit counts and CPU time of each atom, for INTEL_DEBUG=state.
+ */
+static struct {
+   uint32_t count;
+   double time;
+} atom_stats[BRW_NUM_PIPELINES][BRW_MAX_ATOMS];
+
+static void
+brw_print_atom_stats(struct brw_context *brw, enum brw_pipeline pipeline)
+{
+   const struct brw_tracked_state *atoms =
+      brw_get_pipeline_atoms(brw, pipeline);
+
+   for (int i = 0; i < brw->num_atoms[pipeline]; i++) {
+      if (atom_stats[pipeline][i].count == 0)
+         continue;
+
+      fprintf(stderr, "atom %2d (mesa 0x%08x, brw 0x%016"PRIx64"): "
+              "%12u emits, %10.3f ms, %8.3f us/emit\n", i,
+              atoms[i].dirty.mesa, atoms[i].dirty.brw,
+              atom_stats[pipeline][i].count,
+              atom_stats[pipeline][i].time * 1000,
+              atom_stats[pipeline][i].time * 1000000 /
+              atom_stats[pipeline][i].count);
+   }
+}
+
 static inline void
 brw_upload_tess_programs(struct brw_context *brw)
 {
@@ -773,6 +822,40 @@ check_and_emit_atom(struct brw_context *brw,
    }
 }
 
+/**
+ * Adds the atoms after \p first checking any of the given dirty bits to
+ * \p pending.
+ */
+static inline void
+add_dirty_atoms(const struct brw_atom_index *index,
+                uint64_t pending[BRW_ATOM_SET_WORDS], int first,
+                GLbitfield mesa, uint64_t brw_bits)
+{
+   uint64_t atoms[BRW_ATOM_SET_WORDS] = { 0 };
+
+   while (mesa) {
+      const int bit = ffs(mesa) - 1;
+      mesa &= ~(1u << bit);
+      for (int w = 0; w < BRW_ATOM_SET_WORDS; w++)
+         atoms[w] |= index->mesa[bit][w];
+   }
+
+   while (brw_bits) {
+      const int bit = ffsll(brw_bits) - 1;
+      brw_bits &= ~(1ull << bit);
+      for (int w = 0; w < BRW_ATOM_SET_WORDS; w++)
+         atoms[w] |= index->brw[bit][w];
+   }
+
+   for (int w = 0; w < BRW_ATOM_SET_WORDS; w++) {
+      if (first >= (w + 1) * 64)
+         continue;
+      if (first > w * 64)
+         atoms[w] &= ~0ull << (first - w * 64);
+      pending[w] |= atoms[w];
+   }
+}
+
 static inline void
 brw_upload_pipeline_state(struct brw_context *brw,
                           enum brw_pipeline pipeline)
@@ -792,6 +875,8 @@ brw_upload_pipeline_state(struct brw_context *brw,
    }
 
    if (pipeline == BRW_RENDER_PIPELINE) {
+      brw_wm_finish_async_compiles(brw);
+
       if (brw->fragment_program != ctx->FragmentProgram._Current) {
          brw->fragment_program = ctx->FragmentProgram._Current;
          brw->ctx.NewDriverState |= BRW_NEW_FRAGMENT_PROGRAM;
@@ -862,7 +947,17 @@ brw_upload_pipeline_state(struct brw_context *brw,
 	 const struct brw_tracked_state *atom = &atoms[i];
 	 struct brw_state_flags generated;
 
-         check_and_emit_atom(brw, &state, atom);
+         if (unlikely(INTEL_DEBUG & DEBUG_STATE) &&
+             check_state(&state, &atom->dirty)) {
+            double start_time = get_time();
+
+            check_and_emit_atom(brw, &state, atom);
+
+            atom_stats[pipeline][i].count++;
+            atom_stats[pipeline][i].time += get_time() - start_time;
+         } else {
+            check_and_emit_atom(brw, &state, atom);
+         }
 
 	 accumulate_state(&examined, &atom->dirty);
 
@@ -876,10 +971,32 @@ brw_upload_pipeline_state(struct brw_context *brw,
       }
    }
    else {
-      for (i = 0; i < num_atoms; i++) {
-	 const struct brw_tracked_state *atom = &atoms[i];
+      /* Only visit the atoms checking a dirty bit, in order.  Emitting an
+       * atom can flag more state, which the atoms after it have to see.
+       */
+      const struct brw_atom_index *index = &brw->atom_index[pipeline];
+      uint64_t pending[BRW_ATOM_SET_WORDS] = { 0 };
+
+      add_dirty_atoms(index, pending, 0, state.mesa, state.brw);
+
+      for (int w = 0; w < BRW_ATOM_SET_WORDS; w++) {
+         while (pending[w]) {
+            const int bit = ffsll(pending[w]) - 1;
+            const struct brw_state_flags prev = state;
+
+            pending[w] &= ~(1ull << bit);
+            i = w * 64 + bit;
+            assert(i < num_atoms);
+
+            atoms[i].emit(brw);
+            merge_ctx_state(brw, &state);
 
-         check_and_emit_atom(brw, &state, atom);
+            if ((state.mesa & ~prev.mesa) | (state.brw & ~prev.brw)) {
+               add_dirty_atoms(index, pending, i + 1,
+                               state.mesa & ~prev.mesa,
+                               state.brw & ~prev.brw);
+            }
+         }
       }
    }
 
@@ -891,6 +1008,7 @@ brw_upload_pipeline_state(struct brw_context *brw,
       if (dirty_count++ % 1000 == 0) {
 	 brw_print_dirty_count(mesa_bits);
 	 brw_print_dirty_count(brw_bits);
+	 brw_print_atom_stats(brw, pipeline);
 	 fprintf(stderr, "\n");
       }
    }
@@ -46,17 +46,13 @@ brw_tes_debug_recompile(struct brw_context *brw,
    perf_debug("Recompiling tessellation evaluation shader for program %d\n",
               shader_prog->Name);
 
-   for (unsigned int i = 0; i < brw->cache.size; i++) {
-      for (c = brw->cache.items[i]; c; c = c->next) {
-         if (c->cache_id == BRW_CACHE_TES_PROG) {
-            old_key = c->key;
-
-            if (old_key->program_string_id == key->program_string_id)
-               break;
-         }
+   for (c = brw->cache.items; c; c = c->next) {
+      if (c->cache_id == BRW_CACHE_TES_PROG) {
+         old_key = c->key;
+
+         if (old_key->program_string_id == key->program_string_id)
+            break;
       }
-      if (c)
-         break;
    }
 
    if (!c) {
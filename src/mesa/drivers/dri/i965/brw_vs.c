@@ -157,6 +157,21 @@ brw_codegen_vs_prog(struct brw_context *brw,
 			       true);
    }
 
+   /* User clip planes are uploaded as params pointing at GL state, which the
+    * disk cache has no way to relocate.
+    */
+   struct brw_disk_cache_program dcp = { .enabled = false };
+   if (key->nr_userclip_plane_consts == 0 &&
+       brw_disk_cache_load_program(brw, &dcp, BRW_CACHE_VS_PROG,
+                                   key, sizeof(struct brw_vs_prog_key),
+                                   offsetof(struct brw_vs_prog_key,
+                                            program_string_id),
+                                   !_mesa_is_gles3(&brw->ctx),
+                                   &vp->program.Base,
+                                   &prog_data.base.base, sizeof(prog_data),
+                                   mem_ctx, &program, &program_size))
+      goto upload;
+
    if (unlikely(brw->perf_debug)) {
       start_busy = (brw->batch.last_bo &&
                     drm_intel_bo_busy(brw->batch.last_bo));
@@ -205,6 +220,10 @@ brw_codegen_vs_prog(struct brw_context *brw,
       vs->compiled_once = true;
    }
 
+   brw_disk_cache_store_program(brw, &dcp, program, program_size,
+                                &prog_data.base.base, sizeof(prog_data));
+
+upload:
    /* Scratch space is used for register spilling */
    if (prog_data.base.base.total_scratch) {
       brw_get_scratch_bo(brw, &brw->vs.base.scratch_bo,
@@ -233,17 +252,13 @@ brw_vs_debug_recompile(struct brw_context *brw,
 
    perf_debug("Recompiling vertex shader for program %d\n", prog->Name);
 
-   for (unsigned int i = 0; i < brw->cache.size; i++) {
-      for (c = brw->cache.items[i]; c; c = c->next) {
-         if (c->cache_id == BRW_CACHE_VS_PROG) {
-            old_key = c->key;
+   for (c = brw->cache.items; c; c = c->next) {
+      if (c->cache_id == BRW_CACHE_VS_PROG) {
+         old_key = c->key;
 
-            if (old_key->program_string_id == key->program_string_id)
-               break;
-         }
+         if (old_key->program_string_id == key->program_string_id)
+            break;
       }
-      if (c)
-         break;
    }
 
    if (!c) {
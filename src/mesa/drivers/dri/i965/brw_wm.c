@@ -38,6 +38,9 @@
 #include "brw_nir.h"
 #include "brw_program.h"
 
+#include "c11/threads.h"
+#include "main/debug_output.h"
+#include "util/list.h"
 #include "util/ralloc.h"
 
 static void
@@ -60,37 +63,27 @@ assign_fs_binding_table_offsets(const struct brw_device_info *devinfo,
                                            next_binding_table_offset);
 }
 
-/**
- * All Mesa program -> GPU code generation goes through this function.
- * Depending on the instructions used (i.e. flow control instructions)
- * we'll use one of two code generators.
- */
-bool
-brw_codegen_wm_prog(struct brw_context *brw,
-                    struct gl_shader_program *prog,
-                    struct brw_fragment_program *fp,
-                    struct brw_wm_prog_key *key)
+static void
+wm_setup_prog_data(struct brw_context *brw,
+                   struct gl_shader_program *prog,
+                   struct brw_fragment_program *fp,
+                   const struct brw_wm_prog_key *key,
+                   struct brw_wm_prog_data *prog_data)
 {
    struct gl_context *ctx = &brw->ctx;
-   void *mem_ctx = ralloc_context(NULL);
-   struct brw_wm_prog_data prog_data;
-   const GLuint *program;
    struct brw_shader *fs = NULL;
-   GLuint program_size;
-   bool start_busy = false;
-   double start_time = 0;
 
    if (prog)
       fs = (struct brw_shader *)prog->_LinkedShaders[MESA_SHADER_FRAGMENT];
 
-   memset(&prog_data, 0, sizeof(prog_data));
+   memset(prog_data, 0, sizeof(*prog_data));
 
    /* Use ALT floating point mode for ARB programs so that 0^0 == 1. */
    if (!prog)
-      prog_data.base.use_alt_mode = true;
+      prog_data->base.use_alt_mode = true;
 
    assign_fs_binding_table_offsets(brw->intelScreen->devinfo, prog,
-                                   &fp->program.Base, key, &prog_data);
+                                   &fp->program.Base, key, prog_data);
 
    /* Allocate the references to the uniforms that will end up in the
     * prog_data associated with the compiled program, and which will be freed
@@ -98,26 +91,93 @@ brw_codegen_wm_prog(struct brw_context *brw,
     */
    int param_count = fp->program.Base.nir->num_uniforms;
    if (fs)
-      prog_data.base.nr_image_params = fs->base.NumImages;
+      prog_data->base.nr_image_params = fs->base.NumImages;
    /* The backend also sometimes adds params for texture size. */
    param_count += 2 * ctx->Const.Program[MESA_SHADER_FRAGMENT].MaxTextureImageUnits;
-   prog_data.base.param =
+   prog_data->base.param =
       rzalloc_array(NULL, const gl_constant_value *, param_count);
-   prog_data.base.pull_param =
+   prog_data->base.pull_param =
       rzalloc_array(NULL, const gl_constant_value *, param_count);
-   prog_data.base.image_param =
+   prog_data->base.image_param =
       rzalloc_array(NULL, struct brw_image_param,
-                    prog_data.base.nr_image_params);
-   prog_data.base.nr_params = param_count;
+                    prog_data->base.nr_image_params);
+   prog_data->base.nr_params = param_count;
 
    if (prog) {
       brw_nir_setup_glsl_uniforms(fp->program.Base.nir, prog, &fp->program.Base,
-                                  &prog_data.base, true);
+                                  &prog_data->base, true);
    } else {
       brw_nir_setup_arb_uniforms(fp->program.Base.nir, &fp->program.Base,
-                                 &prog_data.base);
+                                 &prog_data->base);
+   }
+}
+
+static bool
+wm_load_prog_from_disk(struct brw_context *brw,
+                       struct brw_fragment_program *fp,
+                       const struct brw_wm_prog_key *key,
+                       struct brw_wm_prog_data *prog_data,
+                       struct brw_disk_cache_program *dcp,
+                       void *mem_ctx,
+                       const GLuint **program, GLuint *program_size)
+{
+   return brw_disk_cache_load_program(brw, dcp, BRW_CACHE_FS_PROG,
+                                      key, sizeof(struct brw_wm_prog_key),
+                                      offsetof(struct brw_wm_prog_key,
+                                               program_string_id),
+                                      brw->use_rep_send, &fp->program.Base,
+                                      &prog_data->base, sizeof(*prog_data),
+                                      mem_ctx, program, program_size);
+}
+
+static void
+wm_upload_prog(struct brw_context *brw,
+               const struct brw_wm_prog_key *key,
+               const GLuint *program, GLuint program_size,
+               const struct brw_wm_prog_data *prog_data,
+               uint32_t *out_offset, struct brw_wm_prog_data **out_prog_data)
+{
+   if (prog_data->base.total_scratch) {
+      brw_get_scratch_bo(brw, &brw->wm.base.scratch_bo,
+			 prog_data->base.total_scratch * brw->max_wm_threads);
    }
 
+   brw_upload_cache(&brw->cache, BRW_CACHE_FS_PROG,
+		    key, sizeof(struct brw_wm_prog_key),
+		    program, program_size,
+		    prog_data, sizeof(*prog_data),
+		    out_offset, out_prog_data);
+}
+
+/**
+ * All Mesa program -> GPU code generation goes through this function.
+ * Depending on the instructions used (i.e. flow control instructions)
+ * we'll use one of two code generators.
+ */
+bool
+brw_codegen_wm_prog(struct brw_context *brw,
+                    struct gl_shader_program *prog,
+                    struct brw_fragment_program *fp,
+                    struct brw_wm_prog_key *key)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   struct brw_wm_prog_data prog_data;
+   const GLuint *program;
+   struct brw_shader *fs = NULL;
+   GLuint program_size;
+   bool start_busy = false;
+   double start_time = 0;
+
+   if (prog)
+      fs = (struct brw_shader *)prog->_LinkedShaders[MESA_SHADER_FRAGMENT];
+
+   wm_setup_prog_data(brw, prog, fp, key, &prog_data);
+
+   struct brw_disk_cache_program dcp;
+   if (wm_load_prog_from_disk(brw, fp, key, &prog_data, &dcp, mem_ctx,
+                              &program, &program_size))
+      goto upload;
+
    if (unlikely(brw->perf_debug)) {
       start_busy = (brw->batch.last_bo &&
                     drm_intel_bo_busy(brw->batch.last_bo));
@@ -161,25 +221,365 @@ brw_codegen_wm_prog(struct brw_context *brw,
       }
    }
 
-   if (prog_data.base.total_scratch) {
-      brw_get_scratch_bo(brw, &brw->wm.base.scratch_bo,
-			 prog_data.base.total_scratch * brw->max_wm_threads);
-   }
+   brw_disk_cache_store_program(brw, &dcp, program, program_size,
+                                &prog_data.base, sizeof(prog_data));
 
+upload:
    if (unlikely(INTEL_DEBUG & DEBUG_WM))
       fprintf(stderr, "\n");
 
-   brw_upload_cache(&brw->cache, BRW_CACHE_FS_PROG,
-		    key, sizeof(struct brw_wm_prog_key),
-		    program, program_size,
-		    &prog_data, sizeof(prog_data),
-		    &brw->wm.base.prog_offset, &brw->wm.prog_data);
+   wm_upload_prog(brw, key, program, program_size, &prog_data,
+                  &brw->wm.base.prog_offset, &brw->wm.prog_data);
 
    ralloc_free(mem_ctx);
 
    return true;
 }
 
+/**
+ * \name Background compiles of fragment program variants
+ *
+ * With INTEL_ASYNC_FS=true, a draw that misses the program cache for its
+ * brw_wm_prog_key doesn't wait for the compile when the cache already has a
+ * variant of the same program whose key only differs in texture swizzles,
+ * GL_CLAMP emulation or gather workarounds.  The compile is queued on a
+ * worker thread owned by the context and the draw goes ahead with that
+ * variant, which renders close to, but not exactly, what the application
+ * asked for.  If no such variant exists the compile happens right away as
+ * usual, so the first draw with a program always waits.
+ *
+ * Finished compiles are uploaded to the program cache by the context
+ * thread on the next render state upload, which also flags the fragment
+ * program as changed so that the lookup finds the exact variant.  A
+ * compile that failed in the background is done again synchronously the
+ * next time its key misses, which reports the error the usual way.
+ *
+ * The worker only runs brw_compile_fs() on a copy of the NIR and of the
+ * prog_data set up by the context thread, so it shares nothing with the
+ * context but the (thread-safe) debug output.  Background compiles are
+ * only used when nothing else wants to watch the compile: not with
+ * INTEL_DEBUG=wm or shader_time, perf_debug, or synchronous debug output.
+ * @{
+ */
+
+struct brw_wm_async_job {
+   struct list_head link;
+
+   struct brw_wm_prog_key key;
+   struct brw_wm_prog_data prog_data;
+   struct brw_disk_cache_program dcp;
+   bool use_rep_send;
+
+   /** Owns the NIR, the disk cache data and the compiled program */
+   void *mem_ctx;
+   nir_shader *nir;
+
+   /** Result of the compile, NULL on failure */
+   const GLuint *program;
+   GLuint program_size;
+};
+
+struct brw_wm_async {
+   struct brw_context *brw;
+
+   thrd_t thread;
+   mtx_t mutex;
+   cnd_t job_added;
+   bool kill;
+
+   /** Jobs waiting for the worker, in submission order */
+   struct list_head pending;
+   struct brw_wm_async_job *running;
+
+   /** Jobs done on the worker but not uploaded yet */
+   struct list_head done;
+
+   /** Jobs whose compile failed, only kept for their key */
+   struct list_head failed;
+};
+
+static void
+wm_async_job_free(struct brw_wm_async_job *job, bool free_params)
+{
+   if (free_params)
+      brw_stage_prog_data_free(&job->prog_data);
+   ralloc_free(job->mem_ctx);
+   free(job);
+}
+
+static int
+wm_async_thread(void *data)
+{
+   struct brw_wm_async *async = data;
+   struct brw_context *brw = async->brw;
+
+   mtx_lock(&async->mutex);
+
+   while (!async->kill) {
+      struct brw_wm_async_job *job;
+
+      if (list_empty(&async->pending)) {
+         cnd_wait(&async->job_added, &async->mutex);
+         continue;
+      }
+
+      job = list_first_entry(&async->pending, struct brw_wm_async_job, link);
+      list_del(&job->link);
+      async->running = job;
+      mtx_unlock(&async->mutex);
+
+      job->program = brw_compile_fs(brw->intelScreen->compiler, brw,
+                                    job->mem_ctx, &job->key, &job->prog_data,
+                                    job->nir, NULL, -1, -1, job->use_rep_send,
+                                    &job->program_size, NULL);
+
+      mtx_lock(&async->mutex);
+      async->running = NULL;
+      list_addtail(&job->link, &async->done);
+   }
+
+   mtx_unlock(&async->mutex);
+
+   return 0;
+}
+
+static struct brw_wm_async *
+wm_get_async(struct brw_context *brw)
+{
+   struct gl_context *ctx = &brw->ctx;
+   struct brw_wm_async *async = brw->wm.async;
+
+   if (!brw->wm.async_compile || unlikely(brw->perf_debug) ||
+       (INTEL_DEBUG & (DEBUG_WM | DEBUG_SHADER_TIME)))
+      return NULL;
+
+   /* The debug callback must be called from the application thread. */
+   if (ctx->Debug &&
+       _mesa_get_debug_state_int(ctx, GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB))
+      return NULL;
+
+   if (async)
+      return async;
+
+   async = CALLOC_STRUCT(brw_wm_async);
+   if (async == NULL)
+      return NULL;
+
+   async->brw = brw;
+   mtx_init(&async->mutex, mtx_plain);
+   cnd_init(&async->job_added);
+   list_inithead(&async->pending);
+   list_inithead(&async->done);
+   list_inithead(&async->failed);
+
+   if (thrd_create(&async->thread, wm_async_thread, async) != thrd_success) {
+      cnd_destroy(&async->job_added);
+      mtx_destroy(&async->mutex);
+      free(async);
+
+      /* Don't try again for every miss. */
+      brw->wm.async_compile = false;
+      return NULL;
+   }
+
+   brw->wm.async = async;
+   return async;
+}
+
+static struct brw_wm_async_job *
+wm_async_find_job(struct list_head *list, const struct brw_wm_prog_key *key)
+{
+   list_for_each_entry(struct brw_wm_async_job, job, list, link) {
+      if (memcmp(&job->key, key, sizeof(*key)) == 0)
+         return job;
+   }
+
+   return NULL;
+}
+
+/**
+ * Whether the program compiled for \p other can stand in for the one for
+ * \p key while the latter compiles: everything but the sampler state only
+ * affecting the returned values must match.
+ */
+static bool
+wm_key_compatible(const void *key, const void *other)
+{
+   const struct brw_wm_prog_key *a = key;
+   const struct brw_wm_prog_key *b = other;
+
+   return memcmp(a, b, offsetof(struct brw_wm_prog_key, tex)) == 0 &&
+          a->tex.compressed_multisample_layout_mask ==
+          b->tex.compressed_multisample_layout_mask &&
+          a->tex.msaa_16 == b->tex.msaa_16;
+}
+
+/**
+ * Handles a miss for \p key in the background if possible.
+ *
+ * \return false if the program has to be compiled synchronously.
+ */
+static bool
+wm_queue_prog(struct brw_context *brw,
+              struct gl_shader_program *prog,
+              struct brw_fragment_program *fp,
+              const struct brw_wm_prog_key *key)
+{
+   struct brw_wm_async *async = wm_get_async(brw);
+   struct brw_wm_async_job *job;
+   bool queued;
+
+   if (async == NULL)
+      return false;
+
+   /* Compiles that failed in the background are redone synchronously to
+    * report the error.
+    */
+   job = wm_async_find_job(&async->failed, key);
+   if (job) {
+      list_del(&job->link);
+      wm_async_job_free(job, false);
+      return false;
+   }
+
+   if (!brw_search_cache_compatible(&brw->cache, BRW_CACHE_FS_PROG,
+                                    key, sizeof(*key), wm_key_compatible,
+                                    &brw->wm.base.prog_offset,
+                                    &brw->wm.prog_data))
+      return false;
+
+   mtx_lock(&async->mutex);
+   queued = (async->running &&
+             memcmp(&async->running->key, key, sizeof(*key)) == 0) ||
+            wm_async_find_job(&async->pending, key) ||
+            wm_async_find_job(&async->done, key);
+   mtx_unlock(&async->mutex);
+
+   if (queued)
+      return true;
+
+   job = CALLOC_STRUCT(brw_wm_async_job);
+   if (job == NULL)
+      return false;
+
+   job->key = *key;
+   job->use_rep_send = brw->use_rep_send;
+   job->mem_ctx = ralloc_context(NULL);
+
+   wm_setup_prog_data(brw, prog, fp, key, &job->prog_data);
+
+   /* A hit in the disk cache is cheap enough to take right away. */
+   if (wm_load_prog_from_disk(brw, fp, key, &job->prog_data, &job->dcp,
+                              job->mem_ctx, &job->program,
+                              &job->program_size)) {
+      wm_upload_prog(brw, key, job->program, job->program_size,
+                     &job->prog_data, &brw->wm.base.prog_offset,
+                     &brw->wm.prog_data);
+      wm_async_job_free(job, false);
+      return true;
+   }
+
+   job->nir = nir_shader_clone(job->mem_ctx, fp->program.Base.nir);
+
+   mtx_lock(&async->mutex);
+   list_addtail(&job->link, &async->pending);
+   cnd_signal(&async->job_added);
+   mtx_unlock(&async->mutex);
+
+   return true;
+}
+
+/**
+ * Uploads the programs compiled in the background since the last call.
+ * Called at the start of each render state upload.
+ */
+void
+brw_wm_finish_async_compiles(struct brw_context *brw)
+{
+   struct brw_wm_async *async = brw->wm.async;
+   struct list_head done;
+
+   if (async == NULL)
+      return;
+
+   list_inithead(&done);
+
+   mtx_lock(&async->mutex);
+   list_for_each_entry_safe(struct brw_wm_async_job, job, &async->done, link) {
+      list_del(&job->link);
+      list_addtail(&job->link, &done);
+   }
+   mtx_unlock(&async->mutex);
+
+   list_for_each_entry_safe(struct brw_wm_async_job, job, &done, link) {
+      uint32_t offset = 0;
+      struct brw_wm_prog_data *prog_data = NULL;
+
+      list_del(&job->link);
+
+      if (job->program == NULL) {
+         brw_stage_prog_data_free(&job->prog_data);
+         list_addtail(&job->link, &async->failed);
+         continue;
+      }
+
+      /* The cache may have been cleared and the program compiled
+       * synchronously in the meantime.
+       */
+      if (brw_search_cache(&brw->cache, BRW_CACHE_FS_PROG,
+                           &job->key, sizeof(job->key),
+                           &offset, &prog_data)) {
+         wm_async_job_free(job, true);
+         continue;
+      }
+
+      brw_disk_cache_store_program(brw, &job->dcp,
+                                   job->program, job->program_size,
+                                   &job->prog_data.base,
+                                   sizeof(job->prog_data));
+
+      wm_upload_prog(brw, &job->key, job->program, job->program_size,
+                     &job->prog_data, &offset, &prog_data);
+      wm_async_job_free(job, false);
+
+      /* Look the key up again in case the draw used a stand-in for it. */
+      brw->ctx.NewDriverState |= BRW_NEW_FRAGMENT_PROGRAM;
+   }
+}
+
+void
+brw_wm_destroy_async(struct brw_context *brw)
+{
+   struct brw_wm_async *async = brw->wm.async;
+
+   if (async == NULL)
+      return;
+
+   mtx_lock(&async->mutex);
+   async->kill = true;
+   cnd_signal(&async->job_added);
+   mtx_unlock(&async->mutex);
+
+   thrd_join(async->thread, NULL);
+
+   list_for_each_entry_safe(struct brw_wm_async_job, job, &async->pending,
+                            link)
+      wm_async_job_free(job, true);
+   list_for_each_entry_safe(struct brw_wm_async_job, job, &async->done, link)
+      wm_async_job_free(job, true);
+   list_for_each_entry_safe(struct brw_wm_async_job, job, &async->failed,
+                            link)
+      wm_async_job_free(job, false);
+
+   cnd_destroy(&async->job_added);
+   mtx_destroy(&async->mutex);
+   free(async);
+
+   brw->wm.async = NULL;
+}
+
+/** @} */
+
 bool
 brw_debug_recompile_sampler_key(struct brw_context *brw,
                                 const struct brw_sampler_prog_key_data *old_key,
@@ -225,17 +625,13 @@ brw_wm_debug_recompile(struct brw_context *brw,
 
    perf_debug("Recompiling fragment shader for program %d\n", prog->Name);
 
-   for (unsigned int i = 0; i < brw->cache.size; i++) {
-      for (c = brw->cache.items[i]; c; c = c->next) {
-         if (c->cache_id == BRW_CACHE_FS_PROG) {
-            old_key = c->key;
+   for (c = brw->cache.items; c; c = c->next) {
+      if (c->cache_id == BRW_CACHE_FS_PROG) {
+         old_key = c->key;
 
-            if (old_key->program_string_id == key->program_string_id)
-               break;
-         }
+         if (old_key->program_string_id == key->program_string_id)
+            break;
       }
-      if (c)
-         break;
    }
 
    if (!c) {
@@ -577,7 +973,8 @@ brw_upload_wm_prog(struct brw_context *brw)
 
    if (!brw_search_cache(&brw->cache, BRW_CACHE_FS_PROG,
 			 &key, sizeof(key),
-			 &brw->wm.base.prog_offset, &brw->wm.prog_data)) {
+			 &brw->wm.base.prog_offset, &brw->wm.prog_data) &&
+       !wm_queue_prog(brw, current, fp, &key)) {
       bool success = brw_codegen_wm_prog(brw, current, fp, &key);
       (void) success;
       assert(success);
@@ -64,6 +64,8 @@ bool brw_codegen_wm_prog(struct brw_context *brw,
                          struct gl_shader_program *prog,
                          struct brw_fragment_program *fp,
                          struct brw_wm_prog_key *key);
+void brw_wm_finish_async_compiles(struct brw_context *brw);
+void brw_wm_destroy_async(struct brw_context *brw);
 void brw_wm_debug_recompile(struct brw_context *brw,
                             struct gl_shader_program *prog,
                             const struct brw_wm_prog_key *key);
@@ -1005,14 +1005,14 @@ gen6_blorp_emit_primitive(struct brw_context *brw,
  */
 void
 gen6_blorp_exec(struct brw_context *brw,
-                const brw_blorp_params *params)
+                const brw_blorp_params *const *slices,
+                unsigned num_slices)
 {
+   const brw_blorp_params *params = slices[0];
    brw_blorp_prog_data *prog_data = NULL;
    uint32_t cc_blend_state_offset = 0;
    uint32_t cc_state_offset = 0;
    uint32_t depthstencil_offset;
-   uint32_t wm_push_const_offset = 0;
-   uint32_t wm_bind_bo_offset = 0;
 
    uint32_t prog_offset = params->get_wm_prog(brw, &prog_data);
 
@@ -1024,7 +1024,6 @@ gen6_blorp_exec(struct brw_context *brw,
                                  params->dst.num_samples > 1 ?
                                  (1 << params->dst.num_samples) - 1 : 1);
    gen6_blorp_emit_state_base_address(brw, params);
-   gen6_blorp_emit_vertices(brw, params);
    gen6_blorp_emit_urb_config(brw, params);
    if (params->use_wm_prog) {
       cc_blend_state_offset = gen6_blorp_emit_blend_state(brw, params);
@@ -1034,25 +1033,7 @@ gen6_blorp_exec(struct brw_context *brw,
    gen6_blorp_emit_cc_state_pointers(brw, params, cc_blend_state_offset,
                                      depthstencil_offset, cc_state_offset);
    if (params->use_wm_prog) {
-      uint32_t wm_surf_offset_renderbuffer;
-      uint32_t wm_surf_offset_texture = 0;
-      uint32_t sampler_offset;
-      wm_push_const_offset = gen6_blorp_emit_wm_constants(brw, params);
-      intel_miptree_used_for_rendering(params->dst.mt);
-      wm_surf_offset_renderbuffer =
-         gen6_blorp_emit_surface_state(brw, params, &params->dst,
-                                       I915_GEM_DOMAIN_RENDER,
-                                       I915_GEM_DOMAIN_RENDER);
-      if (params->src.mt) {
-         wm_surf_offset_texture =
-            gen6_blorp_emit_surface_state(brw, params, &params->src,
-                                          I915_GEM_DOMAIN_SAMPLER, 0);
-      }
-      wm_bind_bo_offset =
-         gen6_blorp_emit_binding_table(brw,
-                                       wm_surf_offset_renderbuffer,
-                                       wm_surf_offset_texture);
-      sampler_offset =
+      uint32_t sampler_offset =
          gen6_blorp_emit_sampler_state(brw, BRW_MAPFILTER_LINEAR, 0, true);
       gen6_blorp_emit_sampler_state_pointers(brw, sampler_offset);
    }
@@ -1060,21 +1041,55 @@ gen6_blorp_exec(struct brw_context *brw,
    gen6_blorp_emit_gs_disable(brw, params);
    gen6_blorp_emit_clip_disable(brw);
    gen6_blorp_emit_sf_config(brw, params);
-   if (params->use_wm_prog)
-      gen6_blorp_emit_constant_ps(brw, params, wm_push_const_offset);
-   else
+   if (!params->use_wm_prog)
       gen6_blorp_emit_constant_ps_disable(brw, params);
    gen6_blorp_emit_wm_config(brw, params, prog_offset, prog_data);
-   if (params->use_wm_prog)
-      gen6_blorp_emit_binding_table_pointers(brw, wm_bind_bo_offset);
    gen6_blorp_emit_viewport_state(brw, params);
 
-   if (params->depth.mt)
-      gen6_blorp_emit_depth_stencil_config(brw, params);
-   else
-      gen6_blorp_emit_depth_disable(brw, params);
-   gen6_blorp_emit_clear_params(brw, params);
-   gen6_blorp_emit_drawing_rectangle(brw, params);
-   gen6_blorp_emit_primitive(brw, params);
+   /* Everything above is shared by all the slices.  Only the surfaces, the
+    * rectangle and the push constants describing it change per slice.
+    */
+   for (unsigned i = 0; i < num_slices; i++) {
+      params = slices[i];
+
+      /* Keep each slice ordered against the previous one, as if it were a
+       * separate blorp operation.
+       */
+      if (i > 0)
+         brw_emit_mi_flush(brw);
+
+      gen6_blorp_emit_vertices(brw, params);
+      if (params->use_wm_prog) {
+         uint32_t wm_surf_offset_renderbuffer;
+         uint32_t wm_surf_offset_texture = 0;
+         uint32_t wm_push_const_offset;
+         uint32_t wm_bind_bo_offset;
+         wm_push_const_offset = gen6_blorp_emit_wm_constants(brw, params);
+         intel_miptree_used_for_rendering(params->dst.mt);
+         wm_surf_offset_renderbuffer =
+            gen6_blorp_emit_surface_state(brw, params, &params->dst,
+                                          I915_GEM_DOMAIN_RENDER,
+                                          I915_GEM_DOMAIN_RENDER);
+         if (params->src.mt) {
+            wm_surf_offset_texture =
+               gen6_blorp_emit_surface_state(brw, params, &params->src,
+                                             I915_GEM_DOMAIN_SAMPLER, 0);
+         }
+         wm_bind_bo_offset =
+            gen6_blorp_emit_binding_table(brw,
+                                          wm_surf_offset_renderbuffer,
+                                          wm_surf_offset_texture);
+         gen6_blorp_emit_constant_ps(brw, params, wm_push_const_offset);
+         gen6_blorp_emit_binding_table_pointers(brw, wm_bind_bo_offset);
+      }
+
+      if (params->depth.mt)
+         gen6_blorp_emit_depth_stencil_config(brw, params);
+      else
+         gen6_blorp_emit_depth_disable(brw, params);
+      gen6_blorp_emit_clear_params(brw, params);
+      gen6_blorp_emit_drawing_rectangle(brw, params);
+      gen6_blorp_emit_primitive(brw, params);
+   }
 }
 
@@ -51,6 +51,50 @@ intel_batchbuffer_init(struct brw_context *brw)
    }
 }
 
+/**
+ * Gets the BO for the next batch from the ring.
+ *
+ * The BO in the next slot is reused if the GPU is done with it, and replaced
+ * with a new one otherwise, so that starting a batch never waits.  With
+ * LLC, BOs are mapped once when allocated: reused ones are known to be idle
+ * and the CPU cache is coherent, so there is no need to go through
+ * drm_intel_bo_map() again.  Reusing BOs also keeps their GTT offsets, and
+ * with them the presumed offsets of the relocations to the batch.
+ */
+static drm_intel_bo *
+get_batch_bo(struct brw_context *brw)
+{
+   struct intel_batchbuffer *batch = &brw->batch;
+   drm_intel_bo *bo;
+
+   /* Waits on the outgoing BO would also wait for the later batches it got
+    * reused for.
+    */
+   if (batch->bo_shared) {
+      drm_intel_bo_unreference(batch->ring_bo[batch->ring_slot]);
+      batch->ring_bo[batch->ring_slot] = NULL;
+      batch->bo_shared = false;
+   }
+
+   batch->ring_slot = (batch->ring_slot + 1) % BATCH_RING_SIZE;
+   bo = batch->ring_bo[batch->ring_slot];
+
+   if (bo && drm_intel_bo_busy(bo)) {
+      drm_intel_bo_unreference(bo);
+      bo = NULL;
+   }
+
+   if (bo == NULL) {
+      bo = drm_intel_bo_alloc(brw->bufmgr, "batchbuffer", BATCH_SZ, 4096);
+      if (brw->has_llc)
+         drm_intel_bo_map(bo, true);
+      batch->ring_bo[batch->ring_slot] = bo;
+   }
+
+   drm_intel_bo_reference(bo);
+   return bo;
+}
+
 static void
 intel_batchbuffer_reset(struct brw_context *brw)
 {
@@ -62,12 +106,9 @@ intel_batchbuffer_reset(struct brw_context *brw)
 
    brw_render_cache_set_clear(brw);
 
-   brw->batch.bo = drm_intel_bo_alloc(brw->bufmgr, "batchbuffer",
-					BATCH_SZ, 4096);
-   if (brw->has_llc) {
-      drm_intel_bo_map(brw->batch.bo, true);
+   brw->batch.bo = get_batch_bo(brw);
+   if (brw->has_llc)
       brw->batch.map = brw->batch.bo->virtual;
-   }
    brw->batch.map_next = brw->batch.map;
 
    brw->batch.reserved_space = BATCH_RESERVED;
@@ -104,6 +145,21 @@ intel_batchbuffer_free(struct brw_context *brw)
    free(brw->batch.cpu_map);
    drm_intel_bo_unreference(brw->batch.last_bo);
    drm_intel_bo_unreference(brw->batch.bo);
+
+   for (unsigned i = 0; i < BATCH_RING_SIZE; i++)
+      drm_intel_bo_unreference(brw->batch.ring_bo[i]);
+}
+
+/**
+ * Returns a new reference to the current batch BO, for something that wants
+ * to wait for the batch to complete.  The BO is then left out of the ring.
+ */
+drm_intel_bo *
+intel_batchbuffer_reference_bo(struct brw_context *brw)
+{
+   brw->batch.bo_shared = true;
+   drm_intel_bo_reference(brw->batch.bo);
+   return brw->batch.bo;
 }
 
 static void
@@ -358,10 +414,8 @@ _intel_batchbuffer_flush(struct brw_context *brw,
    if (USED_BATCH(brw->batch) == 0)
       return 0;
 
-   if (brw->throttle_batch[0] == NULL) {
-      brw->throttle_batch[0] = brw->batch.bo;
-      drm_intel_bo_reference(brw->throttle_batch[0]);
-   }
+   if (brw->throttle_batch[0] == NULL)
+      brw->throttle_batch[0] = intel_batchbuffer_reference_bo(brw);
 
    if (unlikely(INTEL_DEBUG & DEBUG_BATCH)) {
       int bytes_for_commands = 4 * USED_BATCH(brw->batch);
@@ -1909,13 +1909,9 @@ intel_miptree_alloc_hiz(struct brw_context *brw,
          continue;
 
       for (unsigned layer = 0; layer < mt->level[level].depth; ++layer) {
-         struct intel_resolve_map *m = malloc(sizeof(struct intel_resolve_map));
-         exec_node_init(&m->link);
-         m->level = level;
-         m->layer = layer;
-         m->need = GEN6_HIZ_OP_HIZ_RESOLVE;
-
-         exec_list_push_tail(&mt->hiz_map, &m->link);
+         mt->level[level].slice[layer].hiz_resolve =
+            intel_resolve_map_add(&mt->hiz_map, level, layer,
+                                  GEN6_HIZ_OP_HIZ_RESOLVE);
       }
    }
 
@@ -1932,6 +1928,31 @@ intel_miptree_level_has_hiz(struct intel_mipmap_tree *mt, uint32_t level)
    return mt->level[level].has_hiz;
 }
 
+static void
+intel_miptree_slice_set_hiz_need(struct intel_mipmap_tree *mt,
+                                 uint32_t level,
+                                 uint32_t layer,
+                                 enum gen6_hiz_op need)
+{
+   intel_miptree_check_level_layer(mt, level, layer);
+
+   struct intel_mipmap_slice *slice = &mt->level[level].slice[layer];
+
+   if (slice->hiz_resolve)
+      slice->hiz_resolve->need = need;
+   else
+      slice->hiz_resolve = intel_resolve_map_add(&mt->hiz_map,
+                                                 level, layer, need);
+}
+
+static void
+intel_miptree_slice_remove_hiz_need(struct intel_mipmap_tree *mt,
+                                    struct intel_resolve_map *item)
+{
+   mt->level[item->level].slice[item->layer].hiz_resolve = NULL;
+   intel_resolve_map_remove(item);
+}
+
 void
 intel_miptree_slice_set_needs_hiz_resolve(struct intel_mipmap_tree *mt,
 					  uint32_t level,
@@ -1940,8 +1961,8 @@ intel_miptree_slice_set_needs_hiz_resolve(struct intel_mipmap_tree *mt,
    if (!intel_miptree_level_has_hiz(mt, level))
       return;
 
-   intel_resolve_map_set(&mt->hiz_map,
-			 level, layer, GEN6_HIZ_OP_HIZ_RESOLVE);
+   intel_miptree_slice_set_hiz_need(mt, level, layer,
+                                    GEN6_HIZ_OP_HIZ_RESOLVE);
 }
 
 
@@ -1953,8 +1974,8 @@ intel_miptree_slice_set_needs_depth_resolve(struct intel_mipmap_tree *mt,
    if (!intel_miptree_level_has_hiz(mt, level))
       return;
 
-   intel_resolve_map_set(&mt->hiz_map,
-			 level, layer, GEN6_HIZ_OP_DEPTH_RESOLVE);
+   intel_miptree_slice_set_hiz_need(mt, level, layer,
+                                    GEN6_HIZ_OP_DEPTH_RESOLVE);
 }
 
 void
@@ -1978,14 +1999,13 @@ intel_miptree_slice_resolve(struct brw_context *brw,
 {
    intel_miptree_check_level_layer(mt, level, layer);
 
-   struct intel_resolve_map *item =
-	 intel_resolve_map_get(&mt->hiz_map, level, layer);
+   struct intel_resolve_map *item = mt->level[level].slice[layer].hiz_resolve;
 
    if (!item || item->need != need)
       return false;
 
    intel_hiz_exec(brw, mt, level, layer, need);
-   intel_resolve_map_remove(item);
+   intel_miptree_slice_remove_hiz_need(mt, item);
    return true;
 }
 
@@ -2015,16 +2035,34 @@ intel_miptree_all_slices_resolve(struct brw_context *brw,
 				 enum gen6_hiz_op need)
 {
    bool did_resolve = false;
+   uint32_t level = 0, first_layer = 0, num_layers = 0;
 
    foreach_list_typed_safe(struct intel_resolve_map, map, link, &mt->hiz_map) {
       if (map->need != need)
 	 continue;
 
-      intel_hiz_exec(brw, mt, map->level, map->layer, need);
-      intel_resolve_map_remove(map);
+      /* Collect runs of consecutive layers within a level, so that each
+       * run gets resolved by a single batched HiZ op.
+       */
+      if (num_layers > 0 &&
+          (map->level != level || map->layer != first_layer + num_layers)) {
+         intel_hiz_exec_layers(brw, mt, level, first_layer, num_layers, need);
+         num_layers = 0;
+      }
+
+      if (num_layers == 0) {
+         level = map->level;
+         first_layer = map->layer;
+      }
+      num_layers++;
+
+      intel_miptree_slice_remove_hiz_need(mt, map);
       did_resolve = true;
    }
 
+   if (num_layers > 0)
+      intel_hiz_exec_layers(brw, mt, level, first_layer, num_layers, need);
+
    return did_resolve;
 }
 
@@ -155,6 +155,12 @@ struct intel_mipmap_level
        * intel_miptree_map/unmap on this slice.
        */
       struct intel_miptree_map *map;
+
+      /**
+       * The element of \c mt->hiz_map for this slice, or NULL if the slice
+       * doesn't need a HiZ or depth resolve.
+       */
+      struct intel_resolve_map *hiz_resolve;
    } *slice;
 };
 
@@ -965,6 +971,11 @@ void
 intel_hiz_exec(struct brw_context *brw, struct intel_mipmap_tree *mt,
 	       unsigned int level, unsigned int layer, enum gen6_hiz_op op);
 
+void
+intel_hiz_exec_layers(struct brw_context *brw, struct intel_mipmap_tree *mt,
+                      unsigned int level, unsigned int first_layer,
+                      unsigned int num_layers, enum gen6_hiz_op op);
+
 #ifdef __cplusplus
 }
 #endif
@@ -206,7 +206,8 @@ intel_readpixels_tiled_memcpy(struct gl_context * ctx,
       dst_pitch, irb->mt->pitch,
       brw->has_swizzling,
       irb->mt->tiling,
-      mem_copy
+      mem_copy,
+      brw->intelScreen->tiled_memcpy_pool
    );
 
    drm_intel_bo_unmap(bo);
@@ -26,48 +26,31 @@
 #include <stdlib.h>
 
 /**
- * \brief Set that the miptree slice at (level, layer) needs a resolve.
+ * \brief Add an element saying that the miptree slice at (level, layer)
+ * needs a resolve.
  *
- * If a map element already exists with the given key, then the value is
- * changed to the given value of \c need.
+ * The caller must make sure that the map doesn't already have an element
+ * for the slice.
+ *
+ * \return the new element, or null if allocating it failed.
  */
-void
-intel_resolve_map_set(struct exec_list *resolve_map,
+struct intel_resolve_map *
+intel_resolve_map_add(struct exec_list *resolve_map,
 		      uint32_t level,
 		      uint32_t layer,
 		      enum gen6_hiz_op need)
 {
-   foreach_list_typed(struct intel_resolve_map, map, link, resolve_map) {
-      if (map->level == level && map->layer == layer) {
-         map->need = need;
-	 return;
-      }
-   }
-
    struct intel_resolve_map *m = malloc(sizeof(struct intel_resolve_map));
+   if (!m)
+      return NULL;
+
    exec_node_init(&m->link);
    m->level = level;
    m->layer = layer;
    m->need = need;
 
    exec_list_push_tail(resolve_map, &m->link);
-}
-
-/**
- * \brief Get an element from the map.
- * \return null if element is not contained in map.
- */
-struct intel_resolve_map *
-intel_resolve_map_get(struct exec_list *resolve_map,
-		      uint32_t level,
-		      uint32_t layer)
-{
-   foreach_list_typed(struct intel_resolve_map, map, link, resolve_map) {
-      if (map->level == level && map->layer == layer)
-         return map;
-   }
-
-   return NULL;
+   return m;
 }
 
 /**
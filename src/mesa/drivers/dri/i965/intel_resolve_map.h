@@ -50,7 +50,10 @@ enum gen6_hiz_op {
 /**
  * \brief Map of miptree slices to needed resolves.
  *
- * The map is implemented as a linear doubly-linked list.
+ * The map is implemented as a linear doubly-linked list, holding only the
+ * slices that need a resolve.  Each slice also points at its own element
+ * (see intel_mipmap_slice::hiz_resolve), so that looking up one slice
+ * doesn't require walking the list.
  *
  * In the intel_resolve_map*() functions, the \c head argument is not
  * inspected for its data. It only serves as an anchor for the list.
@@ -71,7 +74,9 @@ enum gen6_hiz_op {
  *     2.1).
  *
  *     By choosing design 2, the number of iterations is exactly the minimum
- *     necessary.
+ *     necessary.  Looking up a single slice through the list is O(slices)
+ *     though, which adds up for array textures with many layers, so the
+ *     per-slice pointers from design 1 are kept as well.
  */
 struct intel_resolve_map {
    struct exec_node link;
@@ -81,17 +86,12 @@ struct intel_resolve_map {
    enum gen6_hiz_op need;
 };
 
-void
-intel_resolve_map_set(struct exec_list *resolve_map,
+struct intel_resolve_map *
+intel_resolve_map_add(struct exec_list *resolve_map,
 		      uint32_t level,
 		      uint32_t layer,
 		      enum gen6_hiz_op need);
 
-struct intel_resolve_map *
-intel_resolve_map_get(struct exec_list *resolve_map,
-		      uint32_t level,
-		      uint32_t layer);
-
 void
 intel_resolve_map_remove(struct intel_resolve_map *resolve_map);
 
@@ -60,6 +60,13 @@ DRI_CONF_BEGIN
       DRI_CONF_OPT_BEGIN_B(hiz, "true")
 	 DRI_CONF_DESC(en, "Enable Hierarchical Z on gen6+")
       DRI_CONF_OPT_END
+
+      DRI_CONF_OPT_BEGIN_B(client_array_userptr, "false")
+	 DRI_CONF_DESC(en, "Draw from large client vertex arrays in place "
+                       "instead of copying them. Only for applications that "
+                       "don't modify or free their arrays until the frame "
+                       "is done.")
+      DRI_CONF_OPT_END
    DRI_CONF_SECTION_END
 
    DRI_CONF_SECTION_QUALITY
@@ -96,9 +103,11 @@ DRI_CONF_END
 #include "intel_mipmap_tree.h"
 #include "intel_screen.h"
 #include "intel_tex.h"
+#include "intel_tiled_memcpy.h"
 #include "intel_image.h"
 
 #include "brw_context.h"
+#include "brw_state.h"
 
 #include "i915_drm.h"
 
@@ -174,8 +183,10 @@ intel_dri2_flush_with_flags(__DRIcontext *cPriv,
    if (flags & __DRI2_FLUSH_DRAWABLE)
       intel_resolve_for_dri2_flush(brw, dPriv);
 
-   if (reason == __DRI2_THROTTLE_SWAPBUFFER)
+   if (reason == __DRI2_THROTTLE_SWAPBUFFER) {
       brw->need_swap_throttle = true;
+      brw->vb.frame++;
+   }
    if (reason == __DRI2_THROTTLE_FLUSHFRONT)
       brw->need_flush_throttle = true;
 
@@ -964,6 +975,8 @@ intelDestroyScreen(__DRIscreen * sPriv)
 {
    struct intel_screen *intelScreen = sPriv->driverPrivate;
 
+   intel_tiled_memcpy_pool_destroy(intelScreen->tiled_memcpy_pool);
+   disk_cache_destroy(intelScreen->disk_cache);
    dri_bufmgr_destroy(intelScreen->bufmgr);
    driDestroyOptionInfo(&intelScreen->optionCache);
 
@@ -1517,6 +1530,8 @@ __DRIconfig **intelInitScreen2(__DRIscreen *psp)
    intelScreen->compiler = brw_compiler_create(intelScreen,
                                                intelScreen->devinfo);
    intelScreen->program_id = 1;
+   intelScreen->disk_cache = brw_disk_cache_create(intelScreen);
+   intelScreen->tiled_memcpy_pool = intel_tiled_memcpy_pool_create();
 
    if (intelScreen->devinfo->has_resource_streamer) {
       int val = -1;
@@ -71,6 +71,16 @@ struct intel_screen
 
    struct brw_compiler *compiler;
 
+   /**
+    * Persistent tier of the program cache, or NULL if disabled.
+    */
+   struct disk_cache *disk_cache;
+
+   /**
+    * Threads splitting large tiled <-> linear copies, or NULL.
+    */
+   struct intel_tiled_memcpy_pool *tiled_memcpy_pool;
+
    /**
    * Configuration cache with default values for all contexts
    */
@@ -70,8 +70,7 @@ brw_fence_insert(struct brw_context *brw, struct brw_fence *fence)
    assert(!fence->signalled);
 
    brw_emit_mi_flush(brw);
-   fence->batch_bo = brw->batch.bo;
-   drm_intel_bo_reference(fence->batch_bo);
+   fence->batch_bo = intel_batchbuffer_reference_bo(brw);
    intel_batchbuffer_flush(brw);
 }
 
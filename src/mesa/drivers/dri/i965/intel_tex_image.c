@@ -461,7 +461,8 @@ intel_gettexsubimage_tiled_memcpy(struct gl_context *ctx,
       dst_pitch, image->mt->pitch,
       brw->has_swizzling,
       image->mt->tiling,
-      mem_copy
+      mem_copy,
+      brw->intelScreen->tiled_memcpy_pool
    );
 
    drm_intel_bo_unmap(bo);
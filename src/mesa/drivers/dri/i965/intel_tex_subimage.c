@@ -183,7 +183,8 @@ intel_texsubimage_tiled_memcpy(struct gl_context * ctx,
       image->mt->pitch, src_pitch,
       brw->has_swizzling,
       image->mt->tiling,
-      mem_copy
+      mem_copy,
+      brw->intelScreen->tiled_memcpy_pool
    );
 
    drm_intel_bo_unmap(bo);
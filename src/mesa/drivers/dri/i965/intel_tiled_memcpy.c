@@ -29,12 +29,16 @@
  *    Frank Henigman <fjhenigman@google.com>
  */
 
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "c11/threads.h"
 #include "util/macros.h"
 
 #include "brw_context.h"
 #include "intel_tiled_memcpy.h"
+#include "x86/common_x86_asm.h"
 
 #ifdef __SSSE3__
 #include <tmmintrin.h>
@@ -45,17 +49,6 @@
 #define ALIGN_DOWN(a, b) ROUND_DOWN_TO(a, b)
 #define ALIGN_UP(a, b) ALIGN(a, b)
 
-/* Tile dimensions.  Width and span are in bytes, height is in pixels (i.e.
- * unitless).  A "span" is the most number of bytes we can copy from linear
- * to tiled without needing to calculate a new destination address.
- */
-static const uint32_t xtile_width = 512;
-static const uint32_t xtile_height = 8;
-static const uint32_t xtile_span = 64;
-static const uint32_t ytile_width = 128;
-static const uint32_t ytile_height = 32;
-static const uint32_t ytile_span = 16;
-
 #ifdef __SSSE3__
 static const uint8_t rgba8_permutation[16] =
    { 2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15 };
@@ -390,6 +383,21 @@ linear_to_xtiled_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
                         uint32_t swizzle_bit,
                         mem_copy_fn mem_copy)
 {
+#if defined(USE_SSE41)
+   /* The span-aligned middle with SSE 4.1, the ragged edges as usual. */
+   if (cpu_has_sse4_1 && x1 < x2) {
+      intel_linear_to_xtiled_sse41(x1, x2, y0, y1, dst, src, src_pitch,
+                                   swizzle_bit, mem_copy != memcpy);
+      if (x0 < x1)
+         linear_to_xtiled(x0, x1, x1, x1, y0, y1,
+                          dst, src, src_pitch, swizzle_bit, mem_copy);
+      if (x2 < x3)
+         linear_to_xtiled(x2, x2, x2, x3, y0, y1,
+                          dst, src, src_pitch, swizzle_bit, mem_copy);
+      return;
+   }
+#endif
+
    if (x0 == 0 && x3 == xtile_width && y0 == 0 && y1 == xtile_height) {
       if (mem_copy == memcpy)
          return linear_to_xtiled(0, 0, xtile_width, xtile_width, 0, xtile_height,
@@ -432,6 +440,21 @@ linear_to_ytiled_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
                         uint32_t swizzle_bit,
                         mem_copy_fn mem_copy)
 {
+#if defined(USE_SSE41)
+   /* The span-aligned middle with SSE 4.1, the ragged edges as usual. */
+   if (cpu_has_sse4_1 && x1 < x2 && ((y0 | y1) & 3) == 0) {
+      intel_linear_to_ytiled_sse41(x1, x2, y0, y1, dst, src, src_pitch,
+                                   swizzle_bit, mem_copy != memcpy);
+      if (x0 < x1)
+         linear_to_ytiled(x0, x1, x1, x1, y0, y1,
+                          dst, src, src_pitch, swizzle_bit, mem_copy);
+      if (x2 < x3)
+         linear_to_ytiled(x2, x2, x2, x3, y0, y1,
+                          dst, src, src_pitch, swizzle_bit, mem_copy);
+      return;
+   }
+#endif
+
    if (x0 == 0 && x3 == ytile_width && y0 == 0 && y1 == ytile_height) {
       if (mem_copy == memcpy)
          return linear_to_ytiled(0, 0, ytile_width, ytile_width, 0, ytile_height,
@@ -474,6 +497,21 @@ xtiled_to_linear_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
                         uint32_t swizzle_bit,
                         mem_copy_fn mem_copy)
 {
+#if defined(USE_SSE41)
+   /* The span-aligned middle with SSE 4.1, the ragged edges as usual. */
+   if (cpu_has_sse4_1 && x1 < x2) {
+      intel_xtiled_to_linear_sse41(x1, x2, y0, y1, dst, src, dst_pitch,
+                                   swizzle_bit, mem_copy != memcpy);
+      if (x0 < x1)
+         xtiled_to_linear(x0, x1, x1, x1, y0, y1,
+                          dst, src, dst_pitch, swizzle_bit, mem_copy);
+      if (x2 < x3)
+         xtiled_to_linear(x2, x2, x2, x3, y0, y1,
+                          dst, src, dst_pitch, swizzle_bit, mem_copy);
+      return;
+   }
+#endif
+
    if (x0 == 0 && x3 == xtile_width && y0 == 0 && y1 == xtile_height) {
       if (mem_copy == memcpy)
          return xtiled_to_linear(0, 0, xtile_width, xtile_width, 0, xtile_height,
@@ -516,6 +554,21 @@ ytiled_to_linear_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
                         uint32_t swizzle_bit,
                         mem_copy_fn mem_copy)
 {
+#if defined(USE_SSE41)
+   /* The span-aligned middle with SSE 4.1, the ragged edges as usual. */
+   if (cpu_has_sse4_1 && x1 < x2 && ((y0 | y1) & 3) == 0) {
+      intel_ytiled_to_linear_sse41(x1, x2, y0, y1, dst, src, dst_pitch,
+                                   swizzle_bit, mem_copy != memcpy);
+      if (x0 < x1)
+         ytiled_to_linear(x0, x1, x1, x1, y0, y1,
+                          dst, src, dst_pitch, swizzle_bit, mem_copy);
+      if (x2 < x3)
+         ytiled_to_linear(x2, x2, x2, x3, y0, y1,
+                          dst, src, dst_pitch, swizzle_bit, mem_copy);
+      return;
+   }
+#endif
+
    if (x0 == 0 && x3 == ytile_width && y0 == 0 && y1 == ytile_height) {
       if (mem_copy == memcpy)
          return ytiled_to_linear(0, 0, ytile_width, ytile_width, 0, ytile_height,
@@ -552,14 +605,14 @@ ytiled_to_linear_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
  * 'dst' is the start of the texture and 'src' is the corresponding
  * address to copy from, though copying begins at (xt1, yt1).
  */
-void
-linear_to_tiled(uint32_t xt1, uint32_t xt2,
-                uint32_t yt1, uint32_t yt2,
-                char *dst, const char *src,
-                uint32_t dst_pitch, int32_t src_pitch,
-                bool has_swizzling,
-                uint32_t tiling,
-                mem_copy_fn mem_copy)
+static void
+linear_to_tiled_rows(uint32_t xt1, uint32_t xt2,
+                     uint32_t yt1, uint32_t yt2,
+                     char *dst, const char *src,
+                     uint32_t dst_pitch, int32_t src_pitch,
+                     bool has_swizzling,
+                     uint32_t tiling,
+                     mem_copy_fn mem_copy)
 {
    tile_copy_fn tile_copy;
    uint32_t xt0, xt3;
@@ -643,14 +696,14 @@ linear_to_tiled(uint32_t xt1, uint32_t xt2,
  * 'dst' is the start of the texture and 'src' is the corresponding
  * address to copy from, though copying begins at (xt1, yt1).
  */
-void
-tiled_to_linear(uint32_t xt1, uint32_t xt2,
-                uint32_t yt1, uint32_t yt2,
-                char *dst, const char *src,
-                int32_t dst_pitch, uint32_t src_pitch,
-                bool has_swizzling,
-                uint32_t tiling,
-                mem_copy_fn mem_copy)
+static void
+tiled_to_linear_rows(uint32_t xt1, uint32_t xt2,
+                     uint32_t yt1, uint32_t yt2,
+                     char *dst, const char *src,
+                     int32_t dst_pitch, uint32_t src_pitch,
+                     bool has_swizzling,
+                     uint32_t tiling,
+                     mem_copy_fn mem_copy)
 {
    tile_copy_fn tile_copy;
    uint32_t xt0, xt3;
@@ -724,6 +777,299 @@ tiled_to_linear(uint32_t xt1, uint32_t xt2,
 }
 
 
+
+/**
+ * \name Splitting of large copies across threads
+ *
+ * A copy of at least PARALLEL_COPY_MIN_SIZE bytes is cut into bands of
+ * whole tile rows, which are handed out to the threads of the screen's
+ * intel_tiled_memcpy_pool and to the calling thread.  Bands never share a
+ * tile, so they can be copied in any order.  The pool takes one copy at a
+ * time; a copy started while it is busy runs on the calling thread alone.
+ * @{
+ */
+
+#define PARALLEL_COPY_MIN_SIZE (1024 * 1024)
+#define MAX_COPY_THREADS 8
+
+struct tiled_copy_job {
+   bool upload;
+   uint32_t xt1, xt2, yt1, yt2;
+   char *dst;
+   const char *src;
+   int32_t linear_pitch;
+   uint32_t tiled_pitch;
+   bool has_swizzling;
+   uint32_t tiling;
+   mem_copy_fn mem_copy;
+
+   /** Tile rows covered by the copy, starting at tile row yt0 */
+   uint32_t yt0, tile_height, tile_rows;
+   unsigned num_bands;
+};
+
+struct intel_tiled_memcpy_pool {
+   mtx_t mutex;
+   cnd_t job_added;
+   cnd_t job_done;
+   bool kill;
+
+   unsigned num_threads;
+   thrd_t threads[MAX_COPY_THREADS];
+
+   /** Copy being split, or NULL if the pool is idle */
+   const struct tiled_copy_job *job;
+   unsigned next_band;
+   unsigned bands_done;
+};
+
+static void
+run_band(const struct tiled_copy_job *job, unsigned band)
+{
+   const uint32_t first = job->tile_rows * band / job->num_bands;
+   const uint32_t last = job->tile_rows * (band + 1) / job->num_bands;
+   const uint32_t y1 = MAX2(job->yt1, job->yt0 + first * job->tile_height);
+   const uint32_t y2 = MIN2(job->yt2, job->yt0 + last * job->tile_height);
+
+   if (y1 >= y2)
+      return;
+
+   if (job->upload) {
+      linear_to_tiled_rows(job->xt1, job->xt2, y1, y2, job->dst, job->src,
+                           job->tiled_pitch, job->linear_pitch,
+                           job->has_swizzling, job->tiling, job->mem_copy);
+   } else {
+      tiled_to_linear_rows(job->xt1, job->xt2, y1, y2, job->dst, job->src,
+                           job->linear_pitch, job->tiled_pitch,
+                           job->has_swizzling, job->tiling, job->mem_copy);
+   }
+}
+
+static int
+tiled_copy_thread(void *data)
+{
+   struct intel_tiled_memcpy_pool *pool = data;
+
+   mtx_lock(&pool->mutex);
+
+   while (!pool->kill) {
+      const struct tiled_copy_job *job = pool->job;
+
+      if (job == NULL || pool->next_band == job->num_bands) {
+         cnd_wait(&pool->job_added, &pool->mutex);
+         continue;
+      }
+
+      unsigned band = pool->next_band++;
+      mtx_unlock(&pool->mutex);
+
+      run_band(job, band);
+
+      mtx_lock(&pool->mutex);
+      if (++pool->bands_done == job->num_bands)
+         cnd_signal(&pool->job_done);
+   }
+
+   mtx_unlock(&pool->mutex);
+
+   return 0;
+}
+
+/**
+ * Runs \p job on the pool, if worth it and the pool is free.
+ *
+ * \return false if the caller has to do the copy itself.
+ */
+static bool
+run_parallel_copy(struct intel_tiled_memcpy_pool *pool,
+                  struct tiled_copy_job *job)
+{
+   if (pool == NULL || job->xt1 >= job->xt2 || job->yt1 >= job->yt2 ||
+       (uint64_t) (job->xt2 - job->xt1) * (job->yt2 - job->yt1) <
+       PARALLEL_COPY_MIN_SIZE)
+      return false;
+
+   if (job->tiling == I915_TILING_X)
+      job->tile_height = xtile_height;
+   else if (job->tiling == I915_TILING_Y)
+      job->tile_height = ytile_height;
+   else
+      unreachable("unsupported tiling");
+
+   job->yt0 = ALIGN_DOWN(job->yt1, job->tile_height);
+   job->tile_rows =
+      (ALIGN_UP(job->yt2, job->tile_height) - job->yt0) / job->tile_height;
+
+   /* A couple of bands per thread evens out the load a bit. */
+   job->num_bands = MIN2(job->tile_rows, 2 * (pool->num_threads + 1));
+   if (job->num_bands < 2)
+      return false;
+
+   mtx_lock(&pool->mutex);
+
+   if (pool->job) {
+      mtx_unlock(&pool->mutex);
+      return false;
+   }
+
+   pool->job = job;
+   pool->next_band = 0;
+   pool->bands_done = 0;
+   cnd_broadcast(&pool->job_added);
+
+   while (pool->next_band < job->num_bands) {
+      unsigned band = pool->next_band++;
+      mtx_unlock(&pool->mutex);
+
+      run_band(job, band);
+
+      mtx_lock(&pool->mutex);
+      pool->bands_done++;
+   }
+
+   while (pool->bands_done < job->num_bands)
+      cnd_wait(&pool->job_done, &pool->mutex);
+
+   pool->job = NULL;
+
+   mtx_unlock(&pool->mutex);
+
+   return true;
+}
+
+/**
+ * Starts the threads used to split large copies.  Their number comes from
+ * INTEL_TILED_MEMCPY_THREADS, and defaults to one less than the number of
+ * CPUs, up to 3.
+ *
+ * \return NULL if no threads are to be used.
+ */
+struct intel_tiled_memcpy_pool *
+intel_tiled_memcpy_pool_create(void)
+{
+   struct intel_tiled_memcpy_pool *pool;
+   const char *env = getenv("INTEL_TILED_MEMCPY_THREADS");
+   long num_threads;
+
+   if (env) {
+      num_threads = strtol(env, NULL, 0);
+   } else {
+      num_threads = MIN2(sysconf(_SC_NPROCESSORS_ONLN) - 1, 3);
+   }
+
+   num_threads = MIN2(num_threads, MAX_COPY_THREADS);
+   if (num_threads <= 0)
+      return NULL;
+
+   pool = calloc(1, sizeof(*pool));
+   if (pool == NULL)
+      return NULL;
+
+   mtx_init(&pool->mutex, mtx_plain);
+   cnd_init(&pool->job_added);
+   cnd_init(&pool->job_done);
+
+   for (unsigned i = 0; i < num_threads; i++) {
+      if (thrd_create(&pool->threads[i], tiled_copy_thread,
+                      pool) != thrd_success)
+         break;
+      pool->num_threads++;
+   }
+
+   if (pool->num_threads == 0) {
+      intel_tiled_memcpy_pool_destroy(pool);
+      return NULL;
+   }
+
+   return pool;
+}
+
+void
+intel_tiled_memcpy_pool_destroy(struct intel_tiled_memcpy_pool *pool)
+{
+   if (pool == NULL)
+      return;
+
+   mtx_lock(&pool->mutex);
+   pool->kill = true;
+   cnd_broadcast(&pool->job_added);
+   mtx_unlock(&pool->mutex);
+
+   for (unsigned i = 0; i < pool->num_threads; i++)
+      thrd_join(pool->threads[i], NULL);
+
+   cnd_destroy(&pool->job_added);
+   cnd_destroy(&pool->job_done);
+   mtx_destroy(&pool->mutex);
+   free(pool);
+}
+
+/** @} */
+
+/**
+ * Copy from linear to tiled texture.
+ *
+ * Same as linear_to_tiled_rows(), except that large copies are split
+ * across the threads of \p pool, if not NULL.
+ */
+void
+linear_to_tiled(uint32_t xt1, uint32_t xt2,
+                uint32_t yt1, uint32_t yt2,
+                char *dst, const char *src,
+                uint32_t dst_pitch, int32_t src_pitch,
+                bool has_swizzling,
+                uint32_t tiling,
+                mem_copy_fn mem_copy,
+                struct intel_tiled_memcpy_pool *pool)
+{
+   struct tiled_copy_job job = {
+      .upload = true,
+      .xt1 = xt1, .xt2 = xt2, .yt1 = yt1, .yt2 = yt2,
+      .dst = dst, .src = src,
+      .linear_pitch = src_pitch, .tiled_pitch = dst_pitch,
+      .has_swizzling = has_swizzling,
+      .tiling = tiling,
+      .mem_copy = mem_copy,
+   };
+
+   if (!run_parallel_copy(pool, &job)) {
+      linear_to_tiled_rows(xt1, xt2, yt1, yt2, dst, src, dst_pitch, src_pitch,
+                           has_swizzling, tiling, mem_copy);
+   }
+}
+
+/**
+ * Copy from tiled to linear texture.
+ *
+ * Same as tiled_to_linear_rows(), except that large copies are split
+ * across the threads of \p pool, if not NULL.
+ */
+void
+tiled_to_linear(uint32_t xt1, uint32_t xt2,
+                uint32_t yt1, uint32_t yt2,
+                char *dst, const char *src,
+                int32_t dst_pitch, uint32_t src_pitch,
+                bool has_swizzling,
+                uint32_t tiling,
+                mem_copy_fn mem_copy,
+                struct intel_tiled_memcpy_pool *pool)
+{
+   struct tiled_copy_job job = {
+      .upload = false,
+      .xt1 = xt1, .xt2 = xt2, .yt1 = yt1, .yt2 = yt2,
+      .dst = dst, .src = src,
+      .linear_pitch = dst_pitch, .tiled_pitch = src_pitch,
+      .has_swizzling = has_swizzling,
+      .tiling = tiling,
+      .mem_copy = mem_copy,
+   };
+
+   if (!run_parallel_copy(pool, &job)) {
+      tiled_to_linear_rows(xt1, xt2, yt1, yt2, dst, src, dst_pitch, src_pitch,
+                           has_swizzling, tiling, mem_copy);
+   }
+}
+
 /**
  * Determine which copy function to use for the given format combination
  *
@@ -37,6 +37,19 @@
 
 typedef void *(*mem_copy_fn)(void *dest, const void *src, size_t n);
 
+struct intel_tiled_memcpy_pool;
+
+/* Tile dimensions.  Width and span are in bytes, height is in pixels (i.e.
+ * unitless).  A "span" is the most number of bytes we can copy from linear
+ * to tiled without needing to calculate a new destination address.
+ */
+static const uint32_t xtile_width = 512;
+static const uint32_t xtile_height = 8;
+static const uint32_t xtile_span = 64;
+static const uint32_t ytile_width = 128;
+static const uint32_t ytile_height = 32;
+static const uint32_t ytile_span = 16;
+
 void
 linear_to_tiled(uint32_t xt1, uint32_t xt2,
                 uint32_t yt1, uint32_t yt2,
@@ -44,7 +57,8 @@ linear_to_tiled(uint32_t xt1, uint32_t xt2,
                 uint32_t dst_pitch, int32_t src_pitch,
                 bool has_swizzling,
                 uint32_t tiling,
-                mem_copy_fn mem_copy);
+                mem_copy_fn mem_copy,
+                struct intel_tiled_memcpy_pool *pool);
 
 void
 tiled_to_linear(uint32_t xt1, uint32_t xt2,
@@ -53,7 +67,14 @@ tiled_to_linear(uint32_t xt1, uint32_t xt2,
                 int32_t dst_pitch, uint32_t src_pitch,
                 bool has_swizzling,
                 uint32_t tiling,
-                mem_copy_fn mem_copy);
+                mem_copy_fn mem_copy,
+                struct intel_tiled_memcpy_pool *pool);
+
+struct intel_tiled_memcpy_pool *
+intel_tiled_memcpy_pool_create(void);
+
+void
+intel_tiled_memcpy_pool_destroy(struct intel_tiled_memcpy_pool *pool);
 
 /* Tells intel_get_memcpy() whether the memcpy() is
  *
@@ -71,4 +92,37 @@ bool intel_get_memcpy(mesa_format tiledFormat, GLenum format,
                       GLenum type, mem_copy_fn *mem_copy, uint32_t *cpp,
                       enum intel_memcpy_direction direction);
 
+/* SSE 4.1 versions of the middle, span-aligned part [x1,x2) of the tile
+ * copy functions in intel_tiled_memcpy.c, built with -msse4.1 and only to
+ * be called when cpu_has_sse4_1.  For Y tiling, y0 and y1 must be multiples
+ * of 4.  'swap_rb' selects the RGBA <-> BGRA copy over a plain memcpy.
+ */
+void
+intel_linear_to_xtiled_sse41(uint32_t x1, uint32_t x2,
+                             uint32_t y0, uint32_t y1,
+                             char *dst, const char *src,
+                             int32_t src_pitch,
+                             uint32_t swizzle_bit, bool swap_rb);
+
+void
+intel_linear_to_ytiled_sse41(uint32_t x1, uint32_t x2,
+                             uint32_t y0, uint32_t y1,
+                             char *dst, const char *src,
+                             int32_t src_pitch,
+                             uint32_t swizzle_bit, bool swap_rb);
+
+void
+intel_xtiled_to_linear_sse41(uint32_t x1, uint32_t x2,
+                             uint32_t y0, uint32_t y1,
+                             char *dst, const char *src,
+                             int32_t dst_pitch,
+                             uint32_t swizzle_bit, bool swap_rb);
+
+void
+intel_ytiled_to_linear_sse41(uint32_t x1, uint32_t x2,
+                             uint32_t y0, uint32_t y1,
+                             char *dst, const char *src,
+                             int32_t dst_pitch,
+                             uint32_t swizzle_bit, bool swap_rb);
+
 #endif /* INTEL_TILED_MEMCPY */
@@ -0,0 +1,219 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file intel_tiled_memcpy_sse41.c
+ *
+ * SSE 4.1 kernels for the span-aligned part of tiled <-> linear copies.
+ *
+ * They move whole 64-byte lines of the tiled side at a time: four rows of a
+ * Y tile column (a column is a span wide) or one X tile span.  Swizzling
+ * only flips bit 6 of the tiled offset, so it just selects another line.
+ * Reads from the tile use MOVNTDQA, like _mesa_streaming_load_memcpy(),
+ * which is what makes reading from write-combined or uncached maps fast.
+ * Writes to the tile use non-temporal stores, since the data is for the
+ * GPU and each line is written whole.
+ *
+ * This file is built with -msse4.1; callers check cpu_has_sse4_1.
+ */
+
+#include <smmintrin.h>
+
+#include "util/macros.h"
+
+#include "intel_tiled_memcpy.h"
+
+static inline __m128i
+swap_rb(__m128i v)
+{
+   /* Same permutation as rgba8_copy_16_aligned_*(). */
+   return _mm_shuffle_epi8(v, _mm_set_epi8(15, 12, 13, 14, 11, 8, 9, 10,
+                                           7, 4, 5, 6, 3, 0, 1, 2));
+}
+
+static inline void
+load_line(__m128i v[4], const char *tiled, bool swap)
+{
+   __m128i *line = (__m128i *) tiled;
+
+   assert(((uintptr_t) tiled & 63) == 0);
+
+   v[0] = _mm_stream_load_si128(line + 0);
+   v[1] = _mm_stream_load_si128(line + 1);
+   v[2] = _mm_stream_load_si128(line + 2);
+   v[3] = _mm_stream_load_si128(line + 3);
+
+   if (swap) {
+      v[0] = swap_rb(v[0]);
+      v[1] = swap_rb(v[1]);
+      v[2] = swap_rb(v[2]);
+      v[3] = swap_rb(v[3]);
+   }
+}
+
+static inline void
+store_line(char *tiled, __m128i v[4], bool swap)
+{
+   __m128i *line = (__m128i *) tiled;
+
+   assert(((uintptr_t) tiled & 63) == 0);
+
+   if (swap) {
+      v[0] = swap_rb(v[0]);
+      v[1] = swap_rb(v[1]);
+      v[2] = swap_rb(v[2]);
+      v[3] = swap_rb(v[3]);
+   }
+
+   _mm_stream_si128(line + 0, v[0]);
+   _mm_stream_si128(line + 1, v[1]);
+   _mm_stream_si128(line + 2, v[2]);
+   _mm_stream_si128(line + 3, v[3]);
+}
+
+void
+intel_linear_to_xtiled_sse41(uint32_t x1, uint32_t x2,
+                             uint32_t y0, uint32_t y1,
+                             char *dst, const char *src,
+                             int32_t src_pitch,
+                             uint32_t swizzle_bit, bool swap)
+{
+   uint32_t x, yo;
+
+   src += (ptrdiff_t)y0 * src_pitch;
+
+   for (yo = y0 * xtile_width; yo < y1 * xtile_width; yo += xtile_width) {
+      uint32_t swizzle = ((yo >> 3) ^ (yo >> 4)) & swizzle_bit;
+
+      for (x = x1; x < x2; x += xtile_span) {
+         __m128i v[4];
+
+         v[0] = _mm_loadu_si128((const __m128i *) (src + x) + 0);
+         v[1] = _mm_loadu_si128((const __m128i *) (src + x) + 1);
+         v[2] = _mm_loadu_si128((const __m128i *) (src + x) + 2);
+         v[3] = _mm_loadu_si128((const __m128i *) (src + x) + 3);
+
+         store_line(dst + ((x + yo) ^ swizzle), v, swap);
+      }
+
+      src += src_pitch;
+   }
+
+   _mm_sfence();
+}
+
+void
+intel_linear_to_ytiled_sse41(uint32_t x1, uint32_t x2,
+                             uint32_t y0, uint32_t y1,
+                             char *dst, const char *src,
+                             int32_t src_pitch,
+                             uint32_t swizzle_bit, bool swap)
+{
+   const uint32_t bytes_per_column = ytile_span * ytile_height;
+   uint32_t x, y;
+
+   assert(y0 % 4 == 0 && y1 % 4 == 0);
+
+   for (x = x1; x < x2; x += ytile_span) {
+      const uint32_t xo = (x / ytile_span) * bytes_per_column;
+      const uint32_t swizzle = (xo >> 3) & swizzle_bit;
+
+      for (y = y0; y < y1; y += 4) {
+         const char *s = src + (ptrdiff_t)y * src_pitch + x;
+         __m128i v[4];
+
+         v[0] = _mm_loadu_si128((const __m128i *) (s + 0 * src_pitch));
+         v[1] = _mm_loadu_si128((const __m128i *) (s + 1 * src_pitch));
+         v[2] = _mm_loadu_si128((const __m128i *) (s + 2 * src_pitch));
+         v[3] = _mm_loadu_si128((const __m128i *) (s + 3 * src_pitch));
+
+         store_line(dst + ((xo + y * ytile_span) ^ swizzle), v, swap);
+      }
+   }
+
+   _mm_sfence();
+}
+
+void
+intel_xtiled_to_linear_sse41(uint32_t x1, uint32_t x2,
+                             uint32_t y0, uint32_t y1,
+                             char *dst, const char *src,
+                             int32_t dst_pitch,
+                             uint32_t swizzle_bit, bool swap)
+{
+   uint32_t x, yo;
+
+   dst += (ptrdiff_t)y0 * dst_pitch;
+
+   /* Order the streaming loads after any earlier stores to the buffer. */
+   _mm_mfence();
+
+   for (yo = y0 * xtile_width; yo < y1 * xtile_width; yo += xtile_width) {
+      uint32_t swizzle = ((yo >> 3) ^ (yo >> 4)) & swizzle_bit;
+
+      for (x = x1; x < x2; x += xtile_span) {
+         __m128i v[4];
+
+         load_line(v, src + ((x + yo) ^ swizzle), swap);
+
+         _mm_storeu_si128((__m128i *) (dst + x) + 0, v[0]);
+         _mm_storeu_si128((__m128i *) (dst + x) + 1, v[1]);
+         _mm_storeu_si128((__m128i *) (dst + x) + 2, v[2]);
+         _mm_storeu_si128((__m128i *) (dst + x) + 3, v[3]);
+      }
+
+      dst += dst_pitch;
+   }
+}
+
+void
+intel_ytiled_to_linear_sse41(uint32_t x1, uint32_t x2,
+                             uint32_t y0, uint32_t y1,
+                             char *dst, const char *src,
+                             int32_t dst_pitch,
+                             uint32_t swizzle_bit, bool swap)
+{
+   const uint32_t bytes_per_column = ytile_span * ytile_height;
+   uint32_t x, y;
+
+   assert(y0 % 4 == 0 && y1 % 4 == 0);
+
+   /* Order the streaming loads after any earlier stores to the buffer. */
+   _mm_mfence();
+
+   for (x = x1; x < x2; x += ytile_span) {
+      const uint32_t xo = (x / ytile_span) * bytes_per_column;
+      const uint32_t swizzle = (xo >> 3) & swizzle_bit;
+
+      for (y = y0; y < y1; y += 4) {
+         char *d = dst + (ptrdiff_t)y * dst_pitch + x;
+         __m128i v[4];
+
+         load_line(v, src + ((xo + y * ytile_span) ^ swizzle), swap);
+
+         _mm_storeu_si128((__m128i *) (d + 0 * dst_pitch), v[0]);
+         _mm_storeu_si128((__m128i *) (d + 1 * dst_pitch), v[1]);
+         _mm_storeu_si128((__m128i *) (d + 2 * dst_pitch), v[2]);
+         _mm_storeu_si128((__m128i *) (d + 3 * dst_pitch), v[3]);
+      }
+   }
+}
@@ -586,6 +586,10 @@ _mesa_init_constants(struct gl_constants *consts, gl_api api)
    consts->MaxViewportHeight = 16384;
    consts->MinMapBufferAlignment = 64;
 
+   /* Single threaded texture uploads unless the driver opts in. */
+   consts->MaxTexStoreThreads = 0;
+   consts->TexStoreThreadThreshold = 512 * 512;
+
    /* Driver must override these values if ARB_viewport_array is supported. */
    consts->MaxViewports = 1;
    consts->ViewportSubpixelBits = 0;
@@ -509,6 +509,20 @@ struct dd_function_table {
     */
    GLboolean (*LinkShader)(struct gl_context *ctx,
                            struct gl_shader_program *shader);
+
+   /**
+    * Called instead of LinkShader() when the linker results for a program
+    * were found in the on-disk shader cache (see gl_context::Cache).
+    *
+    * The program metadata (uniform storage, resource list, interface
+    * blocks, ...) and the per-stage linked shaders, without IR, have
+    * already been restored.  The driver must recreate its programs from
+    * the binaries it stored under \p key.  Returning false makes core Mesa
+    * discard the restored state and perform a full link from source.
+    */
+   GLboolean (*LinkShaderFromCache)(struct gl_context *ctx,
+                                    struct gl_shader_program *shader,
+                                    const unsigned char *key);
    /*@}*/
 
    /**
@@ -37,7 +37,9 @@
 #include "glheader.h"
 #include "imports.h"
 #include "hash.h"
+#include "macros.h"
 #include "util/hash_table.h"
+#include "util/u_atomic.h"
 
 /**
  * Magic GLuint object name that gets stored outside of the struct hash_table.
@@ -52,6 +54,27 @@
  */
 #define DELETED_KEY_VALUE 1
 
+/**
+ * Keys below this are mirrored in a flat array which _mesa_HashLookup()
+ * reads without taking the mutex.  glGen*() hands out small contiguous
+ * names, so in practice that covers nearly every lookup.
+ */
+#define DIRECT_MAX_KEYS (1 << 16)
+
+/**
+ * Flat key -> data array for keys below size.
+ *
+ * Writers update it with the table mutex held, readers only load the
+ * published pointer and one slot.  When it has to grow, a copy is published
+ * and the old one is kept until the table is destroyed, since readers may
+ * still be looking at it.
+ */
+struct direct_table {
+   GLuint size;
+   struct direct_table *retired;  /**< previous, smaller arrays */
+   void *data[];
+};
+
 /**
  * The hash table data structure.  
  */
@@ -63,6 +86,8 @@ struct _mesa_HashTable {
    GLboolean InDeleteAll;                /**< Debug check */
    /** Value that would be in the table for DELETED_KEY_VALUE. */
    void *deleted_key_data;
+   /** Lock-free lookup array, see struct direct_table. */
+   struct direct_table *direct;
 };
 
 /** @{
@@ -160,6 +185,12 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 
    _mesa_hash_table_destroy(table->ht, NULL);
 
+   while (table->direct) {
+      struct direct_table *retired = table->direct->retired;
+      free(table->direct);
+      table->direct = retired;
+   }
+
    mtx_destroy(&table->Mutex);
    mtx_destroy(&table->WalkMutex);
    free(table);
@@ -201,8 +232,16 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 void *
 _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
+   const struct direct_table *direct;
    void *res;
    assert(table);
+   assert(key);
+
+   /* Most names are in the direct array, which doesn't need the lock. */
+   direct = p_atomic_read(&table->direct);
+   if (direct && key < direct->size)
+      return p_atomic_read(&direct->data[key]);
+
    mtx_lock(&table->Mutex);
    res = _mesa_HashLookup_unlocked(table, key);
    mtx_unlock(&table->Mutex);
@@ -258,6 +297,74 @@ _mesa_HashUnlockMutex(struct _mesa_HashTable *table)
 }
 
 
+/**
+ * Publish a pointer for other threads.  The compare-and-swap is a full
+ * barrier, so everything written before is visible to a reader seeing the
+ * new value.  The table mutex must be held.
+ */
+static inline void
+publish_pointer(void **ptr, void *value)
+{
+   void *old = *ptr;
+   (void) p_atomic_cmpxchg(ptr, old, value);
+}
+
+
+/**
+ * Replace the direct array with one covering key.  Must be called with the
+ * mutex held.
+ */
+static void
+grow_direct_table(struct _mesa_HashTable *table, GLuint key)
+{
+   struct direct_table *old = table->direct;
+   GLuint old_size = old ? old->size : 0;
+   GLuint size = MAX2(old_size, 64);
+   struct direct_table *direct;
+   GLuint i;
+
+   while (size <= key)
+      size *= 2;
+
+   direct = malloc(sizeof(*direct) + size * sizeof(direct->data[0]));
+   if (!direct)
+      return;  /* the hash table works without it */
+
+   direct->size = size;
+   direct->retired = old;
+   direct->data[0] = NULL;
+   if (old_size)
+      memcpy(direct->data, old->data, old_size * sizeof(direct->data[0]));
+   for (i = MAX2(old_size, 1); i < size; i++)
+      direct->data[i] = _mesa_HashLookup_unlocked(table, i);
+
+   publish_pointer((void **) &table->direct, direct);
+}
+
+
+/**
+ * Mirror the data of a key in the direct array, if it covers the key.  Must
+ * be called with the mutex held, after updating the hash table.
+ */
+static inline void
+update_direct_table(struct _mesa_HashTable *table, GLuint key, void *data)
+{
+   if (key >= DIRECT_MAX_KEYS)
+      return;
+
+   if (!table->direct || key >= table->direct->size) {
+      /* Nothing to mirror for a missing key. */
+      if (!data)
+         return;
+      grow_direct_table(table, key);
+      if (!table->direct || key >= table->direct->size)
+         return;
+   }
+
+   publish_pointer(&table->direct->data[key], data);
+}
+
+
 static inline void
 _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
 {
@@ -280,6 +387,8 @@ _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
          _mesa_hash_table_insert_pre_hashed(table->ht, hash, uint_key(key), data);
       }
    }
+
+   update_direct_table(table, key, data);
 }
 
 
@@ -350,6 +459,7 @@ _mesa_HashRemove(struct _mesa_HashTable *table, GLuint key)
       entry = _mesa_hash_table_search(table->ht, uint_key(key));
       _mesa_hash_table_remove(table->ht, entry);
    }
+   update_direct_table(table, key, NULL);
    mtx_unlock(&table->Mutex);
 }
 
@@ -376,12 +486,16 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
    mtx_lock(&table->Mutex);
    table->InDeleteAll = GL_TRUE;
    hash_table_foreach(table->ht, entry) {
-      callback((uintptr_t)entry->key, entry->data, userData);
+      GLuint key = (uintptr_t)entry->key;
+
+      callback(key, entry->data, userData);
       _mesa_hash_table_remove(table->ht, entry);
+      update_direct_table(table, key, NULL);
    }
    if (table->deleted_key_data) {
       callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
       table->deleted_key_data = NULL;
+      update_direct_table(table, DELETED_KEY_VALUE, NULL);
    }
    table->InDeleteAll = GL_FALSE;
    mtx_unlock(&table->Mutex);
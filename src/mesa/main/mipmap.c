@@ -38,6 +38,8 @@
 #include "image.h"
 #include "macros.h"
 #include "util/half_float.h"
+#include "sse_mipmap.h"
+#include "x86/common_x86_asm.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
 #include "../../gallium/auxiliary/util/u_format_r11g11b10f.h"
 
@@ -349,6 +351,11 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
       }
    }
 
+#if defined(USE_SSE41)
+   else if (datatype == GL_FLOAT && colStride == 2 && cpu_has_sse4_1) {
+      _mesa_sse_average_float_rows(comps, srcRowA, srcRowB, dstWidth, dstRow);
+   }
+#endif
    else if (datatype == GL_FLOAT && comps == 4) {
       GLuint i, j, k;
       const GLfloat(*rowA)[4] = (const GLfloat(*)[4]) srcRowA;
@@ -87,6 +87,9 @@ struct gl_program_parameter_list;
 struct set;
 struct set_entry;
 struct vbo_context;
+struct disk_cache;
+struct gl_shader_job;
+struct gl_shader_queue;
 /*@}*/
 
 
@@ -2239,6 +2242,9 @@ struct gl_shader
    GLboolean CompileStatus;
    bool IsES;              /**< True if this shader uses GLSL ES */
 
+   /** Pending background compile, see main/shaderqueue.c */
+   struct gl_shader_job *AsyncJob;
+
    GLuint SourceChecksum;       /**< for debug/logging purposes */
    const GLchar *Source;  /**< Source code string */
 
@@ -2625,6 +2631,9 @@ struct gl_shader_program
    GLint RefCount;  /**< Reference count */
    GLboolean DeletePending;
 
+   /** Pending background link, see main/shaderqueue.c */
+   struct gl_shader_job *AsyncJob;
+
    /**
     * Is the application intending to glGetProgramBinary this program?
     */
@@ -2873,6 +2882,7 @@ struct gl_shader_program
 #define GLSL_USE_PROG 0x80  /**< Log glUseProgram calls */
 #define GLSL_REPORT_ERRORS 0x100  /**< Print compilation errors */
 #define GLSL_DUMP_ON_ERROR 0x200 /**< Dump shaders to stderr on compile error */
+#define GLSL_ASYNC   0x400  /**< Compile and link on a worker thread */
 
 
 /**
@@ -3086,6 +3096,9 @@ struct gl_shared_state
    /** Table of both gl_shader and gl_shader_program objects */
    struct _mesa_HashTable *ShaderObjects;
 
+   /** Worker for MESA_GLSL=async, created on first use */
+   struct gl_shader_queue *ShaderQueue;
+
    /* GL_EXT_framebuffer_object */
    struct _mesa_HashTable *RenderBuffers;
    struct _mesa_HashTable *FrameBuffers;
@@ -3597,6 +3610,16 @@ struct gl_constants
     **/
    GLboolean StripTextureBorder;
 
+   /**
+    * Number of threads _mesa_texstore() may use to convert uncompressed
+    * images of at least TexStoreThreadThreshold texels to the texture
+    * format.  0 or 1 means the conversion is done by the calling thread,
+    * which is the default.  Drivers whose texture memory can be written
+    * from other threads while mapped may raise this.
+    */
+   GLuint MaxTexStoreThreads;
+   GLuint TexStoreThreadThreshold;
+
    /**
     * For drivers which can do a better job at eliminating unused uniforms
     * than the GLSL compiler.
@@ -3629,6 +3652,15 @@ struct gl_constants
     */
    GLboolean DisableVaryingPacking;
 
+   /**
+    * Pack varyings that aren't read by the fragment shader without regard
+    * to their interpolation qualifiers, which only matter for the
+    * rasterizer.  The packed slots of such interfaces are always declared
+    * as flat ivec4s, with floats stored bitwise, so drivers must be able to
+    * pass integer varyings between all of their non-fragment stages.
+    */
+   GLboolean AggressiveVaryingPacking;
+
    /**
     * Should meaningful names be generated for compiler temporary variables?
     *
@@ -4598,6 +4630,15 @@ struct gl_context
     * Once this field becomes true, it is never reset to false.
     */
    GLboolean ShareGroupReset;
+
+   /**
+    * On-disk shader cache, or NULL if disabled.
+    *
+    * Set up and owned by drivers that implement
+    * \c dd_function_table::LinkShaderFromCache, typically shared by all
+    * contexts of a screen.
+    */
+   struct disk_cache *Cache;
 };
 
 /**
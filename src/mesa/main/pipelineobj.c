@@ -41,6 +41,7 @@
 #include "main/pipelineobj.h"
 #include "main/shaderapi.h"
 #include "main/shaderobj.h"
+#include "main/shaderqueue.h"
 #include "main/transformfeedback.h"
 #include "main/uniforms.h"
 #include "compiler/glsl/glsl_parser_extras.h"
@@ -393,6 +394,7 @@ _mesa_BindProgramPipeline(GLuint pipeline)
 {
    GET_CURRENT_CONTEXT(ctx);
    struct gl_pipeline_object *newObj = NULL;
+   unsigned i;
 
    if (MESA_VERBOSE & VERBOSE_API)
       _mesa_debug(ctx, "glBindProgramPipeline(%u)\n", pipeline);
@@ -433,6 +435,14 @@ _mesa_BindProgramPipeline(GLuint pipeline)
        * glIsProgramPipeline and GetProgramPipelineInfoLog
        */
       newObj->EverBound = GL_TRUE;
+
+      /* The programs may have been relinked in the background since they
+       * were attached to the pipeline.
+       */
+      for (i = 0; i < MESA_SHADER_STAGES; i++) {
+         if (newObj->CurrentProgram[i])
+            _mesa_shader_queue_wait_program(ctx, newObj->CurrentProgram[i]);
+      }
    }
 
    _mesa_bind_pipeline(ctx, newObj);
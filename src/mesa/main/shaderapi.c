@@ -47,6 +47,7 @@
 #include "main/pipelineobj.h"
 #include "main/shaderapi.h"
 #include "main/shaderobj.h"
+#include "main/shaderqueue.h"
 #include "main/transformfeedback.h"
 #include "main/uniforms.h"
 #include "compiler/glsl/glsl_parser_extras.h"
@@ -91,6 +92,8 @@ _mesa_get_shader_flags(void)
          flags |= GLSL_USE_PROG;
       if (strstr(env, "errors"))
          flags |= GLSL_REPORT_ERRORS;
+      if (strstr(env, "async"))
+         flags |= GLSL_ASYNC;
    }
 
    return flags;
@@ -119,7 +122,7 @@ _mesa_init_shader_state(struct gl_context *ctx)
 
    ctx->Shader.Flags = _mesa_get_shader_flags();
 
-   if (ctx->Shader.Flags != 0)
+   if ((ctx->Shader.Flags & ~GLSL_ASYNC) != 0)
       ctx->Const.GenerateTemporaryNames = true;
 
    /* Extended for ARB_separate_shader_objects */
@@ -154,6 +157,9 @@ _mesa_free_shader_state(struct gl_context *ctx)
 
    assert(ctx->Shader.RefCount == 1);
    mtx_destroy(&ctx->Shader.Mutex);
+
+   /* Background jobs submitted through this context may still use it. */
+   _mesa_shader_queue_finish(ctx);
 }
 
 
@@ -957,10 +963,13 @@ shader_source(struct gl_shader *sh, const GLchar *source)
 
 
 /**
- * Compile a shader.
+ * Compile a shader, using \p flags rather than the GLSL_x flags of the
+ * context.  This is what background compiles call, as the current pipeline
+ * may change underneath them.
  */
 void
-_mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
+_mesa_compile_shader_with_flags(struct gl_context *ctx, struct gl_shader *sh,
+                                GLbitfield flags)
 {
    if (!sh)
       return;
@@ -971,7 +980,7 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
        */
       sh->CompileStatus = GL_FALSE;
    } else {
-      if (ctx->_Shader->Flags & GLSL_DUMP) {
+      if (flags & GLSL_DUMP) {
          _mesa_log("GLSL source for %s shader %d:\n",
                  _mesa_shader_stage_to_string(sh->Stage), sh->Name);
          _mesa_log("%s\n", sh->Source);
@@ -982,11 +991,11 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
        */
       _mesa_glsl_compile_shader(ctx, sh, false, false);
 
-      if (ctx->_Shader->Flags & GLSL_LOG) {
+      if (flags & GLSL_LOG) {
          _mesa_write_shader_to_file(sh);
       }
 
-      if (ctx->_Shader->Flags & GLSL_DUMP) {
+      if (flags & GLSL_DUMP) {
          if (sh->CompileStatus) {
             _mesa_log("GLSL IR for shader %d:\n", sh->Name);
             _mesa_print_ir(_mesa_get_log_file(), sh->ir, NULL);
@@ -1002,14 +1011,14 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
    }
 
    if (!sh->CompileStatus) {
-      if (ctx->_Shader->Flags & GLSL_DUMP_ON_ERROR) {
+      if (flags & GLSL_DUMP_ON_ERROR) {
          _mesa_log("GLSL source for %s shader %d:\n",
                  _mesa_shader_stage_to_string(sh->Stage), sh->Name);
          _mesa_log("%s\n", sh->Source);
          _mesa_log("Info Log:\n%s\n", sh->InfoLog);
       }
 
-      if (ctx->_Shader->Flags & GLSL_REPORT_ERRORS) {
+      if (flags & GLSL_REPORT_ERRORS) {
          _mesa_debug(ctx, "Error compiling shader %u:\n%s\n",
                      sh->Name, sh->InfoLog);
       }
@@ -1018,10 +1027,24 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
 
 
 /**
- * Link a program's shaders.
+ * Compile a shader.
  */
 void
-_mesa_link_program(struct gl_context *ctx, struct gl_shader_program *shProg)
+_mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
+{
+   _mesa_compile_shader_with_flags(ctx, sh, ctx->_Shader->Flags);
+}
+
+
+/**
+ * Link a program's shaders.
+ *
+ * \param async  allow the link to go to the background worker, only for
+ *               glLinkProgram() with the program looked up by name.
+ */
+static void
+link_program(struct gl_context *ctx, struct gl_shader_program *shProg,
+             bool async)
 {
    if (!shProg)
       return;
@@ -1039,6 +1062,9 @@ _mesa_link_program(struct gl_context *ctx, struct gl_shader_program *shProg)
 
    FLUSH_VERTICES(ctx, _NEW_PROGRAM);
 
+   if (async && _mesa_shader_queue_link(ctx, shProg))
+      return;
+
    _mesa_glsl_link_shader(ctx, shProg);
 
    if (shProg->LinkStatus == GL_FALSE &&
@@ -1064,6 +1090,13 @@ _mesa_link_program(struct gl_context *ctx, struct gl_shader_program *shProg)
 }
 
 
+void
+_mesa_link_program(struct gl_context *ctx, struct gl_shader_program *shProg)
+{
+   link_program(ctx, shProg, false);
+}
+
+
 /**
  * Print basic shader info (for debug).
  */
@@ -1261,11 +1294,13 @@ _mesa_AttachShader(GLuint program, GLuint shader)
 void GLAPIENTRY
 _mesa_CompileShader(GLuint shaderObj)
 {
+   struct gl_shader *sh;
    GET_CURRENT_CONTEXT(ctx);
    if (MESA_VERBOSE & VERBOSE_API)
       _mesa_debug(ctx, "glCompileShader %u\n", shaderObj);
-   _mesa_compile_shader(ctx, _mesa_lookup_shader_err(ctx, shaderObj,
-                                                     "glCompileShader"));
+   sh = _mesa_lookup_shader_err(ctx, shaderObj, "glCompileShader");
+   if (!_mesa_shader_queue_compile(ctx, sh))
+      _mesa_compile_shader(ctx, sh);
 }
 
 
@@ -1512,8 +1547,9 @@ _mesa_LinkProgram(GLuint programObj)
    GET_CURRENT_CONTEXT(ctx);
    if (MESA_VERBOSE & VERBOSE_API)
       _mesa_debug(ctx, "glLinkProgram %u\n", programObj);
-   _mesa_link_program(ctx, _mesa_lookup_shader_program_err(ctx, programObj,
-                                                           "glLinkProgram"));
+   link_program(ctx, _mesa_lookup_shader_program_err(ctx, programObj,
+                                                     "glLinkProgram"),
+                true);
 }
 
 #if defined(HAVE_SHA1)
@@ -57,6 +57,10 @@ _mesa_active_program(struct gl_context *ctx, struct gl_shader_program *shProg,
 extern void
 _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh);
 
+extern void
+_mesa_compile_shader_with_flags(struct gl_context *ctx, struct gl_shader *sh,
+                                GLbitfield flags);
+
 extern void
 _mesa_link_program(struct gl_context *ctx, struct gl_shader_program *sh_prog);
 
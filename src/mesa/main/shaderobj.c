@@ -36,6 +36,7 @@
 #include "main/mtypes.h"
 #include "main/shaderapi.h"
 #include "main/shaderobj.h"
+#include "main/shaderqueue.h"
 #include "main/uniforms.h"
 #include "program/program.h"
 #include "program/prog_parameter.h"
@@ -143,6 +144,8 @@ _mesa_lookup_shader(struct gl_context *ctx, GLuint name)
       if (sh && sh->Type == GL_SHADER_PROGRAM_MESA) {
          return NULL;
       }
+      if (sh)
+         _mesa_shader_queue_wait_shader(ctx, sh);
       return sh;
    }
    return NULL;
@@ -170,6 +173,7 @@ _mesa_lookup_shader_err(struct gl_context *ctx, GLuint name, const char *caller)
          _mesa_error(ctx, GL_INVALID_OPERATION, "%s", caller);
          return NULL;
       }
+      _mesa_shader_queue_wait_shader(ctx, sh);
       return sh;
    }
 }
@@ -402,6 +406,8 @@ _mesa_lookup_shader_program(struct gl_context *ctx, GLuint name)
       if (shProg && shProg->Type != GL_SHADER_PROGRAM_MESA) {
          return NULL;
       }
+      if (shProg)
+         _mesa_shader_queue_wait_program(ctx, shProg);
       return shProg;
    }
    return NULL;
@@ -430,6 +436,7 @@ _mesa_lookup_shader_program_err(struct gl_context *ctx, GLuint name,
          _mesa_error(ctx, GL_INVALID_OPERATION, "%s", caller);
          return NULL;
       }
+      _mesa_shader_queue_wait_program(ctx, shProg);
       return shProg;
    }
 }
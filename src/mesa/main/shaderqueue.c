@@ -0,0 +1,423 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file shaderqueue.c
+ *
+ * Background compilation of GLSL shaders and programs (MESA_GLSL=async).
+ *
+ * glCompileShader and glLinkProgram queue a job on a worker thread owned by
+ * the share group and return immediately.  The job is recorded in the
+ * object's AsyncJob field, and every lookup of the object by name waits for
+ * it (see _mesa_lookup_shader() and _mesa_lookup_shader_program()).  Since
+ * all of the GL entry points taking a shader or program go through those
+ * lookups, the application only blocks when it actually looks at the
+ * result, typically when querying GL_COMPILE_STATUS / GL_LINK_STATUS or
+ * binding the program.
+ *
+ * There is a single worker per share group, so jobs run in the order they
+ * were submitted.  That keeps a link behind the compiles of its shaders and
+ * a recompile behind any link still reading the old IR, without having to
+ * track dependencies between jobs.
+ *
+ * Only the GLSL front end and linker run on the worker, as they depend on
+ * nothing but the context constants.  The driver half of a link,
+ * dd_function_table::LinkShader, is run by whichever thread first waits on
+ * the program, with its own current context.
+ *
+ * A single mutex protects all queues, jobs and AsyncJob pointers.
+ */
+
+#include "c11/threads.h"
+#include "main/context.h"
+#include "main/debug_output.h"
+#include "main/imports.h"
+#include "main/mtypes.h"
+#include "main/shaderapi.h"
+#include "main/shaderqueue.h"
+#include "program/ir_to_mesa.h"
+#include "util/list.h"
+
+
+enum gl_shader_job_state {
+   SHADER_JOB_QUEUED,
+   SHADER_JOB_RUNNING,
+   SHADER_JOB_DONE,
+   SHADER_JOB_FINISHING,
+};
+
+struct gl_shader_job {
+   struct list_head link;
+
+   struct gl_shader_queue *queue;
+   enum gl_shader_job_state state;
+
+   /** Context that submitted the job, for its constants */
+   struct gl_context *ctx;
+   GLbitfield flags;
+
+   /** Exactly one of these is set */
+   struct gl_shader *shader;
+   struct gl_shader_program *program;
+};
+
+struct gl_shader_queue {
+   thrd_t thread;
+   cnd_t job_added;
+   cnd_t job_done;
+   bool kill;
+
+   /** Jobs waiting for the worker, in submission order */
+   struct list_head pending;
+
+   /** Links that went through the worker but not through the driver yet */
+   struct list_head finished;
+
+   struct gl_shader_job *running;
+};
+
+static mtx_t queue_mutex = _MTX_INITIALIZER_NP;
+
+
+static int
+shader_queue_thread(void *data)
+{
+   struct gl_shader_queue *queue = data;
+
+   mtx_lock(&queue_mutex);
+
+   while (!queue->kill) {
+      struct gl_shader_job *job;
+
+      if (list_empty(&queue->pending)) {
+         cnd_wait(&queue->job_added, &queue_mutex);
+         continue;
+      }
+
+      job = list_first_entry(&queue->pending, struct gl_shader_job, link);
+      list_del(&job->link);
+      job->state = SHADER_JOB_RUNNING;
+      queue->running = job;
+      mtx_unlock(&queue_mutex);
+
+      if (job->shader)
+         _mesa_compile_shader_with_flags(job->ctx, job->shader, job->flags);
+      else
+         _mesa_glsl_link_shader_ir(job->ctx, job->program);
+
+      mtx_lock(&queue_mutex);
+      queue->running = NULL;
+
+      /* Compiles need nothing else, links still have to go through the
+       * driver on a thread with a current context.
+       */
+      if (job->shader) {
+         job->shader->AsyncJob = NULL;
+         free(job);
+      } else {
+         job->state = SHADER_JOB_DONE;
+         list_addtail(&job->link, &queue->finished);
+      }
+
+      cnd_broadcast(&queue->job_done);
+   }
+
+   mtx_unlock(&queue_mutex);
+
+   return 0;
+}
+
+
+/**
+ * Get the queue of the share group, creating it on first use.
+ *
+ * \return NULL if background compiles are disabled or not possible for
+ * \p ctx right now, in which case the caller compiles synchronously.
+ */
+static struct gl_shader_queue *
+get_shader_queue(struct gl_context *ctx)
+{
+   struct gl_shared_state *shared = ctx->Shared;
+   struct gl_shader_queue *queue;
+
+   if (!(ctx->Shader.Flags & GLSL_ASYNC))
+      return NULL;
+
+   /* The debug callback must be called from the application thread. */
+   if (ctx->Debug &&
+       _mesa_get_debug_state_int(ctx, GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB))
+      return NULL;
+
+   mtx_lock(&queue_mutex);
+
+   queue = shared->ShaderQueue;
+   if (queue == NULL) {
+      queue = CALLOC_STRUCT(gl_shader_queue);
+      if (queue) {
+         list_inithead(&queue->pending);
+         list_inithead(&queue->finished);
+         cnd_init(&queue->job_added);
+         cnd_init(&queue->job_done);
+
+         if (thrd_create(&queue->thread, shader_queue_thread,
+                         queue) != thrd_success) {
+            cnd_destroy(&queue->job_added);
+            cnd_destroy(&queue->job_done);
+            free(queue);
+            queue = NULL;
+         }
+      }
+
+      shared->ShaderQueue = queue;
+   }
+
+   mtx_unlock(&queue_mutex);
+
+   return queue;
+}
+
+
+static GLboolean
+queue_job(struct gl_context *ctx, struct gl_shader *sh,
+          struct gl_shader_program *prog)
+{
+   struct gl_shader_queue *queue = get_shader_queue(ctx);
+   struct gl_shader_job *job;
+
+   if (queue == NULL)
+      return GL_FALSE;
+
+   job = CALLOC_STRUCT(gl_shader_job);
+   if (job == NULL)
+      return GL_FALSE;
+
+   job->queue = queue;
+   job->state = SHADER_JOB_QUEUED;
+   job->ctx = ctx;
+   job->flags = ctx->_Shader->Flags;
+   job->shader = sh;
+   job->program = prog;
+
+   mtx_lock(&queue_mutex);
+
+   /* The lookup of the object waited for any earlier job. */
+   if (sh) {
+      assert(sh->AsyncJob == NULL);
+      sh->AsyncJob = job;
+   } else {
+      assert(prog->AsyncJob == NULL);
+      prog->AsyncJob = job;
+   }
+
+   list_addtail(&job->link, &queue->pending);
+   cnd_signal(&queue->job_added);
+
+   mtx_unlock(&queue_mutex);
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Queue the compilation of \p sh.
+ *
+ * \return GL_FALSE if the shader needs to be compiled synchronously.
+ */
+GLboolean
+_mesa_shader_queue_compile(struct gl_context *ctx, struct gl_shader *sh)
+{
+   if (sh == NULL || sh->Source == NULL)
+      return GL_FALSE;
+
+   return queue_job(ctx, sh, NULL);
+}
+
+
+static bool
+is_program_bound(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   unsigned i;
+
+   if (ctx->Shader.ActiveProgram == prog ||
+       ctx->_Shader->ActiveProgram == prog)
+      return true;
+
+   for (i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (ctx->Shader.CurrentProgram[i] == prog ||
+          ctx->_Shader->CurrentProgram[i] == prog)
+         return true;
+   }
+
+   return false;
+}
+
+
+/**
+ * Queue the link of \p prog.
+ *
+ * \return GL_FALSE if the program needs to be linked synchronously.
+ */
+GLboolean
+_mesa_shader_queue_link(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   /* Relinking a bound program changes the state used for drawing, which
+    * doesn't look the program up again.
+    */
+   if (is_program_bound(ctx, prog))
+      return GL_FALSE;
+
+   /* A cache hit doesn't run the linker, which is the expensive part.  Let
+    * _mesa_glsl_link_shader() deal with the cache.
+    */
+   if (ctx->Cache)
+      return GL_FALSE;
+
+   return queue_job(ctx, NULL, prog);
+}
+
+
+static void
+finish_link(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   _mesa_glsl_link_shader_driver(ctx, prog);
+
+   if (prog->LinkStatus == GL_FALSE &&
+       (ctx->_Shader->Flags & GLSL_REPORT_ERRORS)) {
+      _mesa_debug(ctx, "Error linking program %u:\n%s\n",
+                  prog->Name, prog->InfoLog);
+   }
+}
+
+
+/**
+ * Wait for a pending compile of \p sh.
+ */
+void
+_mesa_shader_queue_wait_shader(struct gl_context *ctx, struct gl_shader *sh)
+{
+   struct gl_shader_job *job;
+
+   if (ctx->Shared->ShaderQueue == NULL)
+      return;
+
+   mtx_lock(&queue_mutex);
+
+   while ((job = sh->AsyncJob) != NULL)
+      cnd_wait(&job->queue->job_done, &queue_mutex);
+
+   mtx_unlock(&queue_mutex);
+}
+
+
+/**
+ * Wait for a pending link of \p prog and complete it.
+ */
+void
+_mesa_shader_queue_wait_program(struct gl_context *ctx,
+                                struct gl_shader_program *prog)
+{
+   struct gl_shader_job *job;
+
+   if (ctx->Shared->ShaderQueue == NULL)
+      return;
+
+   mtx_lock(&queue_mutex);
+
+   while ((job = prog->AsyncJob) != NULL) {
+      if (job->state != SHADER_JOB_DONE) {
+         /* Also covers another thread running the driver link. */
+         cnd_wait(&job->queue->job_done, &queue_mutex);
+         continue;
+      }
+
+      job->state = SHADER_JOB_FINISHING;
+      mtx_unlock(&queue_mutex);
+
+      finish_link(ctx, prog);
+
+      mtx_lock(&queue_mutex);
+      list_del(&job->link);
+      prog->AsyncJob = NULL;
+      cnd_broadcast(&job->queue->job_done);
+      free(job);
+   }
+
+   mtx_unlock(&queue_mutex);
+}
+
+
+/**
+ * Wait until the worker is idle.  Called before \p ctx is destroyed, as
+ * queued jobs may refer to it.
+ */
+void
+_mesa_shader_queue_finish(struct gl_context *ctx)
+{
+   struct gl_shader_queue *queue = ctx->Shared->ShaderQueue;
+
+   if (queue == NULL)
+      return;
+
+   mtx_lock(&queue_mutex);
+
+   while (!list_empty(&queue->pending) || queue->running)
+      cnd_wait(&queue->job_done, &queue_mutex);
+
+   mtx_unlock(&queue_mutex);
+}
+
+
+/**
+ * Stop the worker of a share group.  All contexts of the group have been
+ * destroyed, so the queue is idle; links that never reached the driver are
+ * dropped along with their programs.
+ */
+void
+_mesa_shader_queue_destroy(struct gl_shared_state *shared)
+{
+   struct gl_shader_queue *queue = shared->ShaderQueue;
+
+   if (queue == NULL)
+      return;
+
+   mtx_lock(&queue_mutex);
+   assert(list_empty(&queue->pending) && !queue->running);
+   queue->kill = true;
+   cnd_signal(&queue->job_added);
+   mtx_unlock(&queue_mutex);
+
+   thrd_join(queue->thread, NULL);
+
+   list_for_each_entry_safe(struct gl_shader_job, job, &queue->finished,
+                            link) {
+      job->program->AsyncJob = NULL;
+      list_del(&job->link);
+      free(job);
+   }
+
+   cnd_destroy(&queue->job_added);
+   cnd_destroy(&queue->job_done);
+   free(queue);
+
+   shared->ShaderQueue = NULL;
+}
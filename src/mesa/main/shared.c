@@ -38,6 +38,7 @@
 #include "samplerobj.h"
 #include "shaderapi.h"
 #include "shaderobj.h"
+#include "shaderqueue.h"
 #include "syncobj.h"
 
 #include "util/hash_table.h"
@@ -325,6 +326,7 @@ free_shared_state(struct gl_context *ctx, struct gl_shared_state *shared)
    _mesa_HashDeleteAll(shared->BitmapAtlas, delete_bitmap_atlas_cb, ctx);
    _mesa_DeleteHashTable(shared->BitmapAtlas);
 
+   _mesa_shader_queue_destroy(shared);
    _mesa_HashWalk(shared->ShaderObjects, free_shader_program_data_cb, ctx);
    _mesa_HashDeleteAll(shared->ShaderObjects, delete_shader_cb, ctx);
    _mesa_DeleteHashTable(shared->ShaderObjects);
@@ -29,66 +29,117 @@
 #include <smmintrin.h>
 #include <stdint.h>
 
-void
-_mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
-                         unsigned *max_index, const unsigned count)
-{
-   unsigned max_ui = 0;
-   unsigned min_ui = ~0U;
-   unsigned i = 0;
-   unsigned aligned_count = count;
-
-   /* handle the first few values without SSE until the pointer is aligned */
-   while (((uintptr_t)ui_indices & 15) && aligned_count) {
-      if (*ui_indices > max_ui)
-         max_ui = *ui_indices;
-      if (*ui_indices < min_ui)
-         min_ui = *ui_indices;
-
-      aligned_count--;
-      ui_indices++;
-   }
-
-   /* TODO: The actual threshold for SSE begin useful may be higher than 8.
-    * Some careful microbenchmarks and measurement are required to
-    * find the actual tipping point.
-    */
-   if (aligned_count >= 8) {
-      unsigned max_arr[4] __attribute__ ((aligned (16)));
-      unsigned min_arr[4] __attribute__ ((aligned (16)));
-      unsigned vec_count;
-      __m128i max_ui4 = _mm_setzero_si128();
-      __m128i min_ui4 = _mm_set1_epi32(~0U);
-      __m128i ui_indices4;
-      __m128i *ui_indices_ptr;
-
-      vec_count = aligned_count & ~0x3;
-      ui_indices_ptr = (__m128i *)ui_indices;
-      for (i = 0; i < vec_count / 4; i++) {
-         ui_indices4 = _mm_load_si128(&ui_indices_ptr[i]);
-         max_ui4 = _mm_max_epu32(ui_indices4, max_ui4);
-         min_ui4 = _mm_min_epu32(ui_indices4, min_ui4);
-      }
-
-      _mm_store_si128((__m128i *)max_arr, max_ui4);
-      _mm_store_si128((__m128i *)min_arr, min_ui4);
+/**
+ * Generate a min/max scanner for one index type.
+ *
+ * When \p restart is set, elements equal to \p restart_index are skipped.
+ * In the vector loop this is done by forcing restart lanes to the neutral
+ * element of each reduction: all ones for the minimum and zero for the
+ * maximum.
+ *
+ * If none of the elements were considered, ~0 and 0 are returned, exactly
+ * like the scalar loops in vbo_get_minmax_index().
+ */
+#define MINMAX_FUNC(NAME, TYPE, TYPE_MAX, LANES, SET1, CMPEQ, MIN, MAX)      \
+void                                                                         \
+NAME(const TYPE *indices, unsigned *min_index, unsigned *max_index,          \
+     const unsigned count, bool restart, unsigned restart_index)             \
+{                                                                            \
+   TYPE max_val = 0;                                                         \
+   TYPE min_val = TYPE_MAX;                                                  \
+   TYPE restart_val = (TYPE) restart_index;                                  \
+   bool found = false;                                                       \
+   unsigned i = 0;                                                           \
+   unsigned aligned_count = count;                                           \
+                                                                             \
+   /* A restart index that doesn't fit the index type never matches. */      \
+   if (restart_index > TYPE_MAX)                                             \
+      restart = false;                                                       \
+                                                                             \
+   /* handle the first few values without SSE until the pointer is aligned */\
+   while (((uintptr_t)indices & 15) && aligned_count) {                      \
+      if (!restart || *indices != restart_val) {                             \
+         if (*indices > max_val)                                             \
+            max_val = *indices;                                              \
+         if (*indices < min_val)                                             \
+            min_val = *indices;                                              \
+         found = true;                                                       \
+      }                                                                      \
+                                                                             \
+      aligned_count--;                                                       \
+      indices++;                                                             \
+   }                                                                         \
+                                                                             \
+   if (aligned_count >= 2 * (LANES)) {                                       \
+      TYPE max_arr[LANES] __attribute__ ((aligned (16)));                    \
+      TYPE min_arr[LANES] __attribute__ ((aligned (16)));                    \
+      unsigned vec_count;                                                    \
+      __m128i max4 = _mm_setzero_si128();                                    \
+      __m128i min4 = _mm_set1_epi32(~0U);                                    \
+      __m128i restart4 = SET1(restart_val);                                  \
+      __m128i indices4;                                                      \
+      const __m128i *indices_ptr;                                            \
+                                                                             \
+      vec_count = aligned_count & ~((LANES) - 1);                            \
+      indices_ptr = (const __m128i *)indices;                                \
+      if (restart) {                                                         \
+         for (i = 0; i < vec_count / (LANES); i++) {                         \
+            __m128i mask;                                                    \
+            indices4 = _mm_load_si128(&indices_ptr[i]);                      \
+            mask = CMPEQ(indices4, restart4);                                \
+            max4 = MAX(_mm_andnot_si128(mask, indices4), max4);              \
+            min4 = MIN(_mm_or_si128(mask, indices4), min4);                  \
+         }                                                                   \
+      } else {                                                               \
+         for (i = 0; i < vec_count / (LANES); i++) {                         \
+            indices4 = _mm_load_si128(&indices_ptr[i]);                      \
+            max4 = MAX(indices4, max4);                                      \
+            min4 = MIN(indices4, min4);                                      \
+         }                                                                   \
+      }                                                                      \
+                                                                             \
+      _mm_store_si128((__m128i *)max_arr, max4);                             \
+      _mm_store_si128((__m128i *)min_arr, min4);                             \
+                                                                             \
+      for (i = 0; i < (LANES); i++) {                                        \
+         if (max_arr[i] > max_val)                                           \
+            max_val = max_arr[i];                                            \
+         if (min_arr[i] < min_val)                                           \
+            min_val = min_arr[i];                                            \
+      }                                                                      \
+      /* With restart, a lane that only saw restart indices contributes     \
+       * TYPE_MAX to the minimum and 0 to the maximum, so a genuine element \
+       * was seen iff the reductions are ordered.                           \
+       */                                                                    \
+      if (!restart || min_val <= max_val)                                    \
+         found = true;                                                       \
+      i = vec_count;                                                         \
+   }                                                                         \
+                                                                             \
+   for (; i < aligned_count; i++) {                                          \
+      if (restart && indices[i] == restart_val)                              \
+         continue;                                                           \
+      if (indices[i] > max_val)                                              \
+         max_val = indices[i];                                               \
+      if (indices[i] < min_val)                                              \
+         min_val = indices[i];                                               \
+      found = true;                                                          \
+   }                                                                         \
+                                                                             \
+   if (found) {                                                              \
+      *min_index = min_val;                                                  \
+      *max_index = max_val;                                                  \
+   } else {                                                                  \
+      *min_index = ~0U;                                                      \
+      *max_index = 0;                                                        \
+   }                                                                         \
+}
 
-      for (i = 0; i < 4; i++) {
-         if (max_arr[i] > max_ui)
-            max_ui = max_arr[i];
-         if (min_arr[i] < min_ui)
-            min_ui = min_arr[i];
-      }
-      i = vec_count;
-   }
+MINMAX_FUNC(_mesa_uint_array_min_max, unsigned, ~0U, 4,
+            _mm_set1_epi32, _mm_cmpeq_epi32, _mm_min_epu32, _mm_max_epu32)
 
-   for (; i < aligned_count; i++) {
-      if (ui_indices[i] > max_ui)
-         max_ui = ui_indices[i];
-      if (ui_indices[i] < min_ui)
-         min_ui = ui_indices[i];
-   }
+MINMAX_FUNC(_mesa_ushort_array_min_max, uint16_t, 0xffff, 8,
+            _mm_set1_epi16, _mm_cmpeq_epi16, _mm_min_epu16, _mm_max_epu16)
 
-   *min_index = min_ui;
-   *max_index = max_ui;
-}
+MINMAX_FUNC(_mesa_ubyte_array_min_max, uint8_t, 0xff, 16,
+            _mm_set1_epi8, _mm_cmpeq_epi8, _mm_min_epu8, _mm_max_epu8)
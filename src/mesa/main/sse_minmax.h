@@ -25,6 +25,30 @@
  *
  */
 
+#ifndef SSE_MINMAX_H
+#define SSE_MINMAX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * SSE4.1 index range scanners. If restart is true, elements equal to
+ * restart_index are ignored.
+ */
+
 void
 _mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
-                         unsigned *max_index, const unsigned count);
+                         unsigned *max_index, const unsigned count,
+                         bool restart, unsigned restart_index);
+
+void
+_mesa_ushort_array_min_max(const uint16_t *us_indices, unsigned *min_index,
+                           unsigned *max_index, const unsigned count,
+                           bool restart, unsigned restart_index);
+
+void
+_mesa_ubyte_array_min_max(const uint8_t *ub_indices, unsigned *min_index,
+                          unsigned *max_index, const unsigned count,
+                          bool restart, unsigned restart_index);
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "main/sse_mipmap.h"
+#include <xmmintrin.h>
+
+/* Built along with the other SSE4.1 code, but only needs SSE. */
+
+static inline __m128
+average4(__m128 aj, __m128 ak, __m128 bj, __m128 bk)
+{
+   return _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(aj, ak), bj), bk),
+                     _mm_set1_ps(0.25F));
+}
+
+void
+_mesa_sse_average_float_rows(unsigned comps, const float *rowA,
+                             const float *rowB, int dstWidth, float *dst)
+{
+   int i = 0;
+   unsigned c;
+
+   switch (comps) {
+   case 4:
+      for (; i < dstWidth; i++) {
+         const float *a = rowA + i * 8, *b = rowB + i * 8;
+
+         _mm_storeu_ps(dst + i * 4,
+                       average4(_mm_loadu_ps(a), _mm_loadu_ps(a + 4),
+                                _mm_loadu_ps(b), _mm_loadu_ps(b + 4)));
+      }
+      break;
+   case 3:
+      /* Each pixel is loaded and stored as 4 floats, the extra one belongs
+       * to the next pixel and gets overwritten by the next iteration.  The
+       * last pixel is left to the C loop below so we never touch memory
+       * past the end of the rows.
+       */
+      for (; i + 1 < dstWidth; i++) {
+         const float *a = rowA + i * 6, *b = rowB + i * 6;
+
+         _mm_storeu_ps(dst + i * 3,
+                       average4(_mm_loadu_ps(a), _mm_loadu_ps(a + 3),
+                                _mm_loadu_ps(b), _mm_loadu_ps(b + 3)));
+      }
+      break;
+   case 2:
+      /* Two destination pixels at a time. */
+      for (; i + 2 <= dstWidth; i += 2) {
+         const float *a = rowA + i * 4, *b = rowB + i * 4;
+         const __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4);
+         const __m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4);
+
+         _mm_storeu_ps(dst + i * 2,
+                       average4(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(1, 0, 1, 0)),
+                                _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 2, 3, 2)),
+                                _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(1, 0, 1, 0)),
+                                _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 2, 3, 2))));
+      }
+      break;
+   case 1:
+      /* Four destination pixels at a time. */
+      for (; i + 4 <= dstWidth; i += 4) {
+         const float *a = rowA + i * 2, *b = rowB + i * 2;
+         const __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4);
+         const __m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4);
+
+         _mm_storeu_ps(dst + i,
+                       average4(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)),
+                                _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)),
+                                _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)),
+                                _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1))));
+      }
+      break;
+   }
+
+   for (; i < dstWidth; i++) {
+      const unsigned j = i * 2 * comps, k = j + comps;
+
+      for (c = 0; c < comps; c++) {
+         dst[i * comps + c] = (rowA[j + c] + rowA[k + c] +
+                               rowB[j + c] + rowB[k + c]) * 0.25F;
+      }
+   }
+}
@@ -0,0 +1,79 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "main/sse_swizzle.h"
+#include "main/formats.h"
+#include <tmmintrin.h>
+
+/* Built along with the other SSE4.1 code, SSE4.1 implies SSSE3. */
+
+void
+_mesa_ssse3_swizzle_ubyte_to_ubyte4(uint8_t *dst, const uint8_t *src,
+                                    int num_src_channels,
+                                    const uint8_t swizzle[4],
+                                    bool normalized, int count)
+{
+   const uint8_t one = normalized ? 0xff : 1;
+   uint8_t shuffle[16] __attribute__ ((aligned (16)));
+   uint8_t fill[16] __attribute__ ((aligned (16)));
+   uint8_t tmp[7];
+   __m128i shuffle4, fill4;
+   int p, c, i = 0;
+
+   /* pshufb mask for 4 pixels, with 0x80 producing zero bytes that
+    * constant ones are or'ed into.
+    */
+   for (p = 0; p < 4; p++) {
+      for (c = 0; c < 4; c++) {
+         const uint8_t swz = swizzle[c];
+
+         shuffle[p * 4 + c] = swz < num_src_channels ?
+            p * num_src_channels + swz : 0x80;
+         fill[p * 4 + c] = swz == MESA_FORMAT_SWIZZLE_ONE ? one : 0;
+      }
+   }
+   shuffle4 = _mm_load_si128((const __m128i *) shuffle);
+   fill4 = _mm_load_si128((const __m128i *) fill);
+
+   /* Every iteration loads 16 source bytes but only consumes the ones of
+    * 4 pixels, stop once that would read past the end of the source.
+    */
+   for (; i + 4 <= count && (count - i) * num_src_channels >= 16; i += 4) {
+      __m128i pixels =
+         _mm_loadu_si128((const __m128i *) (src + i * num_src_channels));
+
+      pixels = _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle4), fill4);
+      _mm_storeu_si128((__m128i *) (dst + i * 4), pixels);
+   }
+
+   tmp[4] = 0;
+   tmp[5] = one;
+   tmp[6] = 0;
+   for (; i < count; i++) {
+      for (c = 0; c < num_src_channels; c++)
+         tmp[c] = src[i * num_src_channels + c];
+      for (; c < 4; c++)
+         tmp[c] = 0;
+
+      for (c = 0; c < 4; c++)
+         dst[i * 4 + c] = tmp[swizzle[c]];
+   }
+}
@@ -0,0 +1,39 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef SSE_SWIZZLE_H
+#define SSE_SWIZZLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * SSSE3 version of _mesa_swizzle_and_convert() for ubyte to 4 channel
+ * ubyte conversions, the most common case for texture uploads (RGB to
+ * RGBA, BGRA to RGBA, luminance to RGBA, ...).
+ */
+void
+_mesa_ssse3_swizzle_ubyte_to_ubyte4(uint8_t *dst, const uint8_t *src,
+                                    int num_src_channels,
+                                    const uint8_t swizzle[4],
+                                    bool normalized, int count);
+
+#endif
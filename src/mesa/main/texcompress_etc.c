@@ -665,17 +665,111 @@ etc2_rgba8_fetch_texel(const struct etc2_block *block,
    etc2_alpha8_fetch_texel(block, x, y, dst);
 }
 
+/**
+ * Decode a whole RGB block at once.  The colors a texel can take only
+ * depend on the block, so they are computed and clamped once up front and
+ * the texels just pick one of them, instead of redoing the mode checks
+ * and clamps for every texel like etc2_rgb8_fetch_texel does.
+ */
 static void
-etc2_unpack_rgb8(uint8_t *dst_row,
-                 unsigned dst_stride,
-                 const uint8_t *src_row,
-                 unsigned src_stride,
-                 unsigned width,
-                 unsigned height)
+etc2_rgb8_decode_block(const struct etc2_block *block,
+                       uint8_t texels[4][4][4],
+                       GLboolean punchthrough_alpha)
+{
+   uint8_t colors[2][4][4];
+   int x, y, blk, idx, bit;
+
+   if (block->is_planar_mode) {
+      for (y = 0; y < 4; y++) {
+         for (x = 0; x < 4; x++) {
+            etc2_rgb8_fetch_texel(block, x, y, texels[y][x],
+                                  punchthrough_alpha);
+            texels[y][x][3] = 255;
+         }
+      }
+      return;
+   }
+
+   if (block->is_ind_mode || block->is_diff_mode) {
+      for (blk = 0; blk < 2; blk++) {
+         const uint8_t *base_color = block->base_colors[blk];
+
+         for (idx = 0; idx < 4; idx++) {
+            const int modifier = block->modifier_tables[blk][idx];
+
+            colors[blk][idx][0] = etc2_clamp(base_color[0] + modifier);
+            colors[blk][idx][1] = etc2_clamp(base_color[1] + modifier);
+            colors[blk][idx][2] = etc2_clamp(base_color[2] + modifier);
+            colors[blk][idx][3] = 255;
+         }
+      }
+   }
+   else {
+      /* T and H modes have a single set of paint colors. */
+      for (idx = 0; idx < 4; idx++) {
+         colors[0][idx][0] = block->paint_colors[idx][0];
+         colors[0][idx][1] = block->paint_colors[idx][1];
+         colors[0][idx][2] = block->paint_colors[idx][2];
+         colors[0][idx][3] = 255;
+      }
+      memcpy(colors[1], colors[0], sizeof(colors[0]));
+   }
+
+   if (punchthrough_alpha && !block->opaque) {
+      memset(colors[0][2], 0, 4);
+      memset(colors[1][2], 0, 4);
+   }
+
+   for (y = 0; y < 4; y++) {
+      for (x = 0; x < 4; x++) {
+         bit = y + x * 4;
+         idx = ((block->pixel_indices[0] >> (15 + bit)) & 0x2) |
+               ((block->pixel_indices[0] >>      (bit)) & 0x1);
+         blk = (block->flipped) ? (y >= 2) : (x >= 2);
+         memcpy(texels[y][x], colors[blk][idx], 4);
+      }
+   }
+}
+
+static void
+etc2_alpha8_decode_block(const struct etc2_block *block,
+                         uint8_t texels[4][4][4])
 {
-   const unsigned bw = 4, bh = 4, bs = 8, comps = 4;
+   uint8_t alphas[8];
+   int x, y, idx;
+
+   for (idx = 0; idx < 8; idx++) {
+      const int modifier = etc2_modifier_tables[block->table_index][idx];
+      alphas[idx] = etc2_clamp(block->base_codeword +
+                               modifier * block->multiplier);
+   }
+
+   for (y = 0; y < 4; y++) {
+      for (x = 0; x < 4; x++)
+         texels[y][x][3] = alphas[etc2_get_pixel_index(block, x, y)];
+   }
+}
+
+/**
+ * Unpack the 8-bit RGB(A) ETC2 formats a full 4x4 block at a time.
+ */
+static void
+etc2_unpack_rgba8888_blocks(uint8_t *dst_row,
+                            unsigned dst_stride,
+                            const uint8_t *src_row,
+                            unsigned src_stride,
+                            unsigned width,
+                            unsigned height,
+                            bool has_alpha,
+                            GLboolean punchthrough_alpha,
+                            bool bgra)
+{
+   const unsigned bw = 4, bh = 4, comps = 4;
+   const unsigned bs = has_alpha ? 16 : 8;
    struct etc2_block block;
+   uint8_t texels[4][4][4];
    unsigned x, y, i, j;
+   uint8_t tmp;
 
    for (y = 0; y < height; y += bh) {
       const uint8_t *src = src_row;
@@ -692,19 +786,32 @@ etc2_unpack_rgb8(uint8_t *dst_row,
           */
          const unsigned w = MIN2(bw, width - x);
 
-         etc2_rgb8_parse_block(&block, src,
-                               false /* punchthrough_alpha */);
+         if (has_alpha) {
+            etc2_rgba8_parse_block(&block, src);
+            etc2_rgb8_decode_block(&block, texels, false);
+            etc2_alpha8_decode_block(&block, texels);
+         }
+         else {
+            etc2_rgb8_parse_block(&block, src, punchthrough_alpha);
+            etc2_rgb8_decode_block(&block, texels, punchthrough_alpha);
+         }
 
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgb8_fetch_texel(&block, i, j, dst,
-                                     false /* punchthrough_alpha */);
-               dst[3] = 255;
-               dst += comps;
+         if (bgra) {
+            /* Convert to MESA_FORMAT_B8G8R8A8_SRGB */
+            for (j = 0; j < 4; j++) {
+               for (i = 0; i < 4; i++) {
+                  tmp = texels[j][i][0];
+                  texels[j][i][0] = texels[j][i][2];
+                  texels[j][i][2] = tmp;
+               }
             }
          }
 
+         for (j = 0; j < h; j++) {
+            memcpy(dst_row + (y + j) * dst_stride + x * comps, texels[j],
+                   w * comps);
+         }
+
          src += bs;
       }
 
@@ -712,6 +819,18 @@ etc2_unpack_rgb8(uint8_t *dst_row,
    }
 }
 
+static void
+etc2_unpack_rgb8(uint8_t *dst_row,
+                 unsigned dst_stride,
+                 const uint8_t *src_row,
+                 unsigned src_stride,
+                 unsigned width,
+                 unsigned height)
+{
+   etc2_unpack_rgba8888_blocks(dst_row, dst_stride, src_row, src_stride,
+                               width, height, false, false, false);
+}
+
 static void
 etc2_unpack_srgb8(uint8_t *dst_row,
                   unsigned dst_stride,
@@ -720,40 +839,8 @@ etc2_unpack_srgb8(uint8_t *dst_row,
                   unsigned width,
                   unsigned height)
 {
-   const unsigned bw = 4, bh = 4, bs = 8, comps = 4;
-   struct etc2_block block;
-   unsigned x, y, i, j;
-   uint8_t tmp;
-
-   for (y = 0; y < height; y += bh) {
-      const uint8_t *src = src_row;
-      const unsigned h = MIN2(bh, height - y);
-
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         etc2_rgb8_parse_block(&block, src,
-                               false /* punchthrough_alpha */);
-
-
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgb8_fetch_texel(&block, i, j, dst,
-                                     false /* punchthrough_alpha */);
-               /* Convert to MESA_FORMAT_B8G8R8A8_SRGB */
-               tmp = dst[0];
-               dst[0] = dst[2];
-               dst[2] = tmp;
-               dst[3] = 255;
-
-               dst += comps;
-            }
-         }
-         src += bs;
-      }
-
-      src_row += src_stride;
-   }
+   etc2_unpack_rgba8888_blocks(dst_row, dst_stride, src_row, src_stride,
+                               width, height, false, false, true);
 }
 
 static void
@@ -764,34 +851,8 @@ etc2_unpack_rgba8(uint8_t *dst_row,
                   unsigned width,
                   unsigned height)
 {
-   /* If internalformat is COMPRESSED_RGBA8_ETC2_EAC, each 4 × 4 block of
-    * RGBA8888 information is compressed to 128 bits. To decode a block, the
-    * two 64-bit integers int64bitAlpha and int64bitColor are calculated.
-   */
-   const unsigned bw = 4, bh = 4, bs = 16, comps = 4;
-   struct etc2_block block;
-   unsigned x, y, i, j;
-
-   for (y = 0; y < height; y += bh) {
-      const uint8_t *src = src_row;
-      const unsigned h = MIN2(bh, height - y);
-
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         etc2_rgba8_parse_block(&block, src);
-
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgba8_fetch_texel(&block, i, j, dst);
-               dst += comps;
-            }
-         }
-         src += bs;
-      }
-
-      src_row += src_stride;
-   }
+   etc2_unpack_rgba8888_blocks(dst_row, dst_stride, src_row, src_stride,
+                               width, height, true, false, false);
 }
 
 static void
@@ -802,42 +863,8 @@ etc2_unpack_srgb8_alpha8(uint8_t *dst_row,
                          unsigned width,
                          unsigned height)
 {
-   /* If internalformat is COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, each 4 × 4 block
-    * of RGBA8888 information is compressed to 128 bits. To decode a block, the
-    * two 64-bit integers int64bitAlpha and int64bitColor are calculated.
-    */
-   const unsigned bw = 4, bh = 4, bs = 16, comps = 4;
-   struct etc2_block block;
-   unsigned x, y, i, j;
-   uint8_t tmp;
-
-   for (y = 0; y < height; y += bh) {
-      const unsigned h = MIN2(bh, height - y);
-      const uint8_t *src = src_row;
-
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         etc2_rgba8_parse_block(&block, src);
-
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgba8_fetch_texel(&block, i, j, dst);
-
-               /* Convert to MESA_FORMAT_B8G8R8A8_SRGB */
-               tmp = dst[0];
-               dst[0] = dst[2];
-               dst[2] = tmp;
-               dst[3] = dst[3];
-
-               dst += comps;
-            }
-         }
-         src += bs;
-      }
-
-      src_row += src_stride;
-   }
+   etc2_unpack_rgba8888_blocks(dst_row, dst_stride, src_row, src_stride,
+                               width, height, true, false, true);
 }
 
 static void
@@ -1023,75 +1050,20 @@ etc2_unpack_rgb8_punchthrough_alpha1(uint8_t *dst_row,
                                      unsigned width,
                                      unsigned height)
 {
-   const unsigned bw = 4, bh = 4, bs = 8, comps = 4;
-   struct etc2_block block;
-   unsigned x, y, i, j;
-
-   for (y = 0; y < height; y += bh) {
-      const unsigned h = MIN2(bh, height - y);
-      const uint8_t *src = src_row;
-
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         etc2_rgb8_parse_block(&block, src,
-                               true /* punchthrough_alpha */);
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgb8_fetch_texel(&block, i, j, dst,
-                                     true /* punchthrough_alpha */);
-               dst += comps;
-            }
-         }
-
-         src += bs;
-      }
-
-      src_row += src_stride;
-   }
+   etc2_unpack_rgba8888_blocks(dst_row, dst_stride, src_row, src_stride,
+                               width, height, false, true, false);
 }
 
 static void
 etc2_unpack_srgb8_punchthrough_alpha1(uint8_t *dst_row,
-                                     unsigned dst_stride,
-                                     const uint8_t *src_row,
-                                     unsigned src_stride,
-                                     unsigned width,
-                                     unsigned height)
+                                      unsigned dst_stride,
+                                      const uint8_t *src_row,
+                                      unsigned src_stride,
+                                      unsigned width,
+                                      unsigned height)
 {
-   const unsigned bw = 4, bh = 4, bs = 8, comps = 4;
-   struct etc2_block block;
-   unsigned x, y, i, j;
-   uint8_t tmp;
-
-   for (y = 0; y < height; y += bh) {
-      const unsigned h = MIN2(bh, height - y);
-      const uint8_t *src = src_row;
-
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         etc2_rgb8_parse_block(&block, src,
-                               true /* punchthrough_alpha */);
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgb8_fetch_texel(&block, i, j, dst,
-                                     true /* punchthrough_alpha */);
-               /* Convert to MESA_FORMAT_B8G8R8A8_SRGB */
-               tmp = dst[0];
-               dst[0] = dst[2];
-               dst[2] = tmp;
-               dst[3] = dst[3];
-
-               dst += comps;
-            }
-         }
-
-         src += bs;
-      }
-
-      src_row += src_stride;
-   }
+   etc2_unpack_rgba8888_blocks(dst_row, dst_stride, src_row, src_stride,
+                               width, height, false, true, true);
 }
 
 /* ETC2 texture formats are valid in glCompressedTexImage2D and
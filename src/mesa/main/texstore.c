@@ -51,6 +51,7 @@
  */
 
 
+#include "c11/threads.h"
 #include "glheader.h"
 #include "bufferobj.h"
 #include "format_pack.h"
@@ -669,6 +670,112 @@ texstore_compressed(TEXSTORE_PARAMS)
                            srcFormat, srcType, srcAddr, srcPacking);
 }
 
+/** Upper limit for gl_constants::MaxTexStoreThreads */
+#define MAX_TEXSTORE_THREADS 16
+
+/**
+ * A band of rows of a (possibly 3D) image for _mesa_format_convert().
+ * Rows are numbered across all the slices of the image.
+ */
+struct texstore_band {
+   GLubyte **dstSlices;
+   uint32_t dstFormat;
+   size_t dstRowStride;
+   const GLubyte *src;
+   uint32_t srcFormat;
+   size_t srcRowStride;
+   size_t width, height;
+   uint8_t *rebaseSwizzle;
+   GLuint firstRow, numRows;
+};
+
+static void
+convert_band(const struct texstore_band *band)
+{
+   GLuint row = band->firstRow;
+   const GLuint end = band->firstRow + band->numRows;
+
+   while (row < end) {
+      const GLuint img = row / band->height;
+      const GLuint y = row % band->height;
+      const GLuint rows = MIN2(band->height - y, end - row);
+      const GLubyte *src =
+         band->src + (img * band->height + y) * band->srcRowStride;
+
+      _mesa_format_convert(band->dstSlices[img] + y * band->dstRowStride,
+                           band->dstFormat, band->dstRowStride,
+                           (void *) src, band->srcFormat, band->srcRowStride,
+                           band->width, rows, band->rebaseSwizzle);
+      row += rows;
+   }
+}
+
+static int
+convert_band_thread(void *data)
+{
+   convert_band(data);
+   return 0;
+}
+
+/**
+ * Convert all the slices of an image with _mesa_format_convert(), where
+ * the source slices are consecutive.  Large images are split in bands of
+ * rows converted in parallel if the driver allows it.
+ */
+static void
+convert_image_slices(struct gl_context *ctx,
+                     GLubyte **dstSlices, uint32_t dstFormat,
+                     size_t dstRowStride,
+                     const GLubyte *src, uint32_t srcFormat,
+                     size_t srcRowStride,
+                     size_t width, size_t height, size_t depth,
+                     uint8_t *rebaseSwizzle)
+{
+   struct texstore_band bands[MAX_TEXSTORE_THREADS];
+   thrd_t threads[MAX_TEXSTORE_THREADS];
+   bool started[MAX_TEXSTORE_THREADS];
+   const GLuint totalRows = height * depth;
+   GLuint numBands = MIN2(ctx->Const.MaxTexStoreThreads, MAX_TEXSTORE_THREADS);
+   GLuint rowsPerBand, i;
+
+   if (width * totalRows < ctx->Const.TexStoreThreadThreshold)
+      numBands = 1;
+   numBands = MAX2(MIN2(numBands, totalRows), 1);
+   rowsPerBand = DIV_ROUND_UP(totalRows, numBands);
+
+   for (i = 0; i < numBands; i++) {
+      bands[i].dstSlices = dstSlices;
+      bands[i].dstFormat = dstFormat;
+      bands[i].dstRowStride = dstRowStride;
+      bands[i].src = src;
+      bands[i].srcFormat = srcFormat;
+      bands[i].srcRowStride = srcRowStride;
+      bands[i].width = width;
+      bands[i].height = height;
+      bands[i].rebaseSwizzle = rebaseSwizzle;
+      bands[i].firstRow = MIN2(i * rowsPerBand, totalRows);
+      bands[i].numRows = MIN2(rowsPerBand, totalRows - bands[i].firstRow);
+   }
+
+   /* The first band is converted by this thread, as is any band we fail
+    * to start a thread for.
+    */
+   for (i = 1; i < numBands; i++) {
+      started[i] = bands[i].numRows &&
+                   thrd_create(&threads[i], convert_band_thread,
+                               &bands[i]) == thrd_success;
+   }
+
+   convert_band(&bands[0]);
+
+   for (i = 1; i < numBands; i++) {
+      if (started[i])
+         thrd_join(threads[i], NULL);
+      else if (bands[i].numRows)
+         convert_band(&bands[i]);
+   }
+}
+
 static GLboolean
 texstore_rgba(TEXSTORE_PARAMS)
 {
@@ -805,13 +912,10 @@ texstore_rgba(TEXSTORE_PARAMS)
       needRebase = false;
    }
 
-   for (img = 0; img < srcDepth; img++) {
-      _mesa_format_convert(dstSlices[img], dstFormat, dstRowStride,
-                           src, srcMesaFormat, srcRowStride,
-                           srcWidth, srcHeight,
-                           needRebase ? rebaseSwizzle : NULL);
-      src += srcHeight * srcRowStride;
-   }
+   convert_image_slices(ctx, dstSlices, dstFormat, dstRowStride,
+                        src, srcMesaFormat, srcRowStride,
+                        srcWidth, srcHeight, srcDepth,
+                        needRebase ? rebaseSwizzle : NULL);
 
    free(tempImage);
    free(tempRGBA);
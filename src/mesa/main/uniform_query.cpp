@@ -657,6 +657,131 @@ glsl_type_name(enum glsl_base_type type)
 }
 
 
+/**
+ * Check whether storing \c count elements of \c values at \c offset would
+ * modify the backing storage of a non-matrix uniform.
+ */
+static bool
+uniform_values_changed(const struct gl_context *ctx,
+                       const struct gl_uniform_storage *uni,
+                       unsigned offset, int count, const GLvoid *values,
+                       enum glsl_base_type basicType, unsigned components)
+{
+   const int size_mul = basicType == GLSL_TYPE_DOUBLE ? 2 : 1;
+
+   if (!uni->type->is_boolean()) {
+      return memcmp(&uni->storage[size_mul * components * offset], values,
+                    sizeof(uni->storage[0]) * components * count * size_mul)
+         != 0;
+   }
+
+   const union gl_constant_value *src =
+      (const union gl_constant_value *) values;
+   const union gl_constant_value *dst = &uni->storage[components * offset];
+   const unsigned elems = components * count;
+
+   for (unsigned i = 0; i < elems; i++) {
+      const bool b = basicType == GLSL_TYPE_FLOAT ? src[i].f != 0.0f
+                                                  : src[i].i != 0;
+
+      if (dst[i].i != (b ? (int) ctx->Const.UniformBooleanTrue : 0))
+         return true;
+   }
+
+   return false;
+}
+
+template<typename T>
+static bool
+transposed_matrix_changed(const T *dst, const T *src, int count,
+                          unsigned rows, unsigned cols)
+{
+   const unsigned elements = rows * cols;
+
+   for (int i = 0; i < count; i++) {
+      for (unsigned r = 0; r < rows; r++) {
+         for (unsigned c = 0; c < cols; c++) {
+            if (dst[(c * rows) + r] != src[c + (r * cols)])
+               return true;
+         }
+      }
+
+      dst += elements;
+      src += elements;
+   }
+
+   return false;
+}
+
+/**
+ * Matrix counterpart of uniform_values_changed().
+ */
+static bool
+uniform_matrix_changed(const struct gl_uniform_storage *uni,
+                       unsigned offset, int count, const GLvoid *values,
+                       enum glsl_base_type basicType, GLboolean transpose,
+                       unsigned rows, unsigned cols)
+{
+   const unsigned elements = rows * cols;
+   const int size_mul = basicType == GLSL_TYPE_DOUBLE ? 2 : 1;
+
+   if (!transpose) {
+      return memcmp(&uni->storage[elements * offset], values,
+                    sizeof(uni->storage[0]) * elements * count * size_mul)
+         != 0;
+   } else if (basicType == GLSL_TYPE_FLOAT) {
+      return transposed_matrix_changed(&uni->storage[elements * offset].f,
+                                       (const float *) values, count,
+                                       rows, cols);
+   } else {
+      assert(basicType == GLSL_TYPE_DOUBLE);
+      return transposed_matrix_changed(
+         (const double *) &uni->storage[elements * offset].f,
+         (const double *) values, count, rows, cols);
+   }
+}
+
+/**
+ * Fast path for setting a single, non-array float vector or matrix
+ * uniform without transposition, which is what the vast majority of
+ * glUniform*f[v]() and glUniformMatrix*fv() calls do.  Everything that
+ * would need conversion, error checking beyond the location lookup, or
+ * logging is left to the full path.
+ *
+ * \return true if the call was handled.
+ */
+static bool
+uniform_float_fast_path(struct gl_context *ctx,
+                        struct gl_shader_program *shProg,
+                        GLint location, GLsizei count, const GLvoid *values,
+                        unsigned cols, unsigned rows)
+{
+   if (shProg == NULL || count != 1 || location < 0 ||
+       location >= (GLint) shProg->NumUniformRemapTable ||
+       unlikely(ctx->_Shader->Flags & GLSL_UNIFORMS))
+      return false;
+
+   struct gl_uniform_storage *const uni = shProg->UniformRemapTable[location];
+
+   if (uni == NULL || uni == INACTIVE_UNIFORM_EXPLICIT_LOCATION ||
+       uni->builtin || uni->array_elements != 0 ||
+       uni->type->base_type != GLSL_TYPE_FLOAT ||
+       uni->type->matrix_columns != cols ||
+       uni->type->vector_elements != rows)
+      return false;
+
+   const unsigned size = sizeof(uni->storage[0]) * cols * rows;
+
+   if (memcmp(uni->storage, values, size) != 0) {
+      FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
+      memcpy(uni->storage, values, size);
+      _mesa_propagate_uniforms_to_driver_storage(uni, 0, 1);
+   }
+
+   uni->initialized = true;
+   return true;
+}
+
 /**
  * Called via glUniform*() functions.
  */
@@ -670,6 +795,11 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
    unsigned offset;
    int size_mul = basicType == GLSL_TYPE_DOUBLE ? 2 : 1;
 
+   if (basicType == GLSL_TYPE_FLOAT &&
+       uniform_float_fast_path(ctx, shProg, location, count, values,
+                               1, src_components))
+      return;
+
    struct gl_uniform_storage *const uni =
       validate_uniform_parameters(ctx, shProg, location, count,
                                   &offset, "glUniform");
@@ -793,6 +923,17 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
       count = MIN2(count, (int) (uni->array_elements - offset));
    }
 
+   /* Applications frequently re-set uniforms to the values they already
+    * hold.  Don't flush, propagate to the driver storage or flag the
+    * constants dirty in that case.  Sampler and image units are derived
+    * from the same values, so they can't have changed either.
+    */
+   if (!uniform_values_changed(ctx, uni, offset, count, values, basicType,
+                               components)) {
+      uni->initialized = true;
+      return;
+   }
+
    FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
 
    /* Store the data in the "actual type" backing storage for the uniform.
@@ -904,6 +1045,12 @@ _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
    unsigned components;
    unsigned elements;
    int size_mul;
+
+   if (!transpose && basicType == GLSL_TYPE_FLOAT &&
+       uniform_float_fast_path(ctx, shProg, location, count, values,
+                               cols, rows))
+      return;
+
    struct gl_uniform_storage *const uni =
       validate_uniform_parameters(ctx, shProg, location, count,
                                   &offset, "glUniformMatrix");
@@ -988,11 +1135,20 @@ _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
       count = MIN2(count, (int) (uni->array_elements - offset));
    }
 
+   elements = components * vectors;
+
+   /* As in _mesa_uniform(), skip everything if nothing changes.
+    */
+   if (!uniform_matrix_changed(uni, offset, count, values, basicType,
+                               transpose, rows, cols)) {
+      uni->initialized = true;
+      return;
+   }
+
    FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
 
    /* Store the data in the "actual type" backing storage for the uniform.
     */
-   elements = components * vectors;
 
    if (!transpose) {
       memcpy(&uni->storage[elements * offset], values,
@@ -46,6 +46,7 @@
 #include "compiler/glsl_types.h"
 #include "compiler/glsl/linker.h"
 #include "compiler/glsl/program.h"
+#include "compiler/glsl/shader_cache.h"
 #include "program/hash_table.h"
 #include "program/prog_instruction.h"
 #include "program/prog_optimize.h"
@@ -2980,11 +2981,8 @@ _mesa_ir_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
    return prog->LinkStatus;
 }
 
-/**
- * Link a GLSL shader program.  Called via glLinkProgram().
- */
-void
-_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+static void
+begin_link(struct gl_shader_program *prog)
 {
    unsigned int i;
 
@@ -2997,6 +2995,54 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 	 linker_error(prog, "linking with uncompiled shader");
       }
    }
+}
+
+static void
+dump_link_results(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   if (ctx->_Shader->Flags & GLSL_DUMP) {
+      if (!prog->LinkStatus) {
+	 fprintf(stderr, "GLSL shader program %d failed to link\n", prog->Name);
+      }
+
+      if (prog->InfoLog && prog->InfoLog[0] != 0) {
+	 fprintf(stderr, "GLSL shader program %d info log:\n", prog->Name);
+	 fprintf(stderr, "%s\n", prog->InfoLog);
+      }
+   }
+}
+
+/**
+ * Link a GLSL shader program.  Called via glLinkProgram().
+ */
+void
+_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   unsigned int i;
+
+   begin_link(prog);
+
+   cache_key key;
+   bool cacheable = prog->LinkStatus &&
+      shader_cache_compute_program_key(ctx, prog, key);
+
+   /* On a cache hit the metadata is restored and the driver recreates its
+    * programs from its own cache entries.  If the driver can't, throw the
+    * restored state away and do a full link.
+    */
+   if (cacheable && shader_cache_read_program_metadata(ctx, prog, key)) {
+      if (ctx->Driver.LinkShaderFromCache(ctx, prog, key))
+         goto done;
+
+      _mesa_clear_shader_program_data(prog);
+      for (i = 0; i < MESA_SHADER_STAGES; i++) {
+         if (prog->_LinkedShaders[i] != NULL)
+            _mesa_delete_shader(ctx, prog->_LinkedShaders[i]);
+
+         prog->_LinkedShaders[i] = NULL;
+      }
+      prog->LinkStatus = GL_TRUE;
+   }
 
    if (prog->LinkStatus) {
       link_shaders(ctx, prog);
@@ -3008,16 +3054,44 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
       }
    }
 
-   if (ctx->_Shader->Flags & GLSL_DUMP) {
-      if (!prog->LinkStatus) {
-	 fprintf(stderr, "GLSL shader program %d failed to link\n", prog->Name);
-      }
+   if (cacheable && prog->LinkStatus)
+      shader_cache_write_program_metadata(ctx, prog, key);
 
-      if (prog->InfoLog && prog->InfoLog[0] != 0) {
-	 fprintf(stderr, "GLSL shader program %d info log:\n", prog->Name);
-	 fprintf(stderr, "%s\n", prog->InfoLog);
+done:
+   dump_link_results(ctx, prog);
+}
+
+/**
+ * First half of _mesa_glsl_link_shader() for deferred links: run the GLSL
+ * linker only.  This doesn't touch any context state besides the
+ * constants, so it may run on a worker thread.
+ */
+void
+_mesa_glsl_link_shader_ir(struct gl_context *ctx,
+                          struct gl_shader_program *prog)
+{
+   begin_link(prog);
+
+   if (prog->LinkStatus) {
+      link_shaders(ctx, prog);
+   }
+}
+
+/**
+ * Second half of a deferred link: hand the linked IR to the driver.  Must
+ * be called from a thread that has \p ctx current.
+ */
+void
+_mesa_glsl_link_shader_driver(struct gl_context *ctx,
+                              struct gl_shader_program *prog)
+{
+   if (prog->LinkStatus) {
+      if (!ctx->Driver.LinkShader(ctx, prog)) {
+	 prog->LinkStatus = GL_FALSE;
       }
    }
+
+   dump_link_results(ctx, prog);
 }
 
 } /* extern "C" */
@@ -23,7 +23,7 @@
 
 #include "main/imports.h"
 #include "symbol_table.h"
-#include "hash_table.h"
+#include "util/hash_table.h"
 
 struct symbol {
     /**
@@ -184,9 +184,45 @@ _mesa_symbol_table_push_scope(struct _mesa_symbol_table *table)
 
 
 static struct symbol_header *
-find_symbol(struct _mesa_symbol_table *table, const char *name)
+find_symbol(struct _mesa_symbol_table *table, uint32_t hash, const char *name)
 {
-    return (struct symbol_header *) hash_table_find(table->ht, name);
+    struct hash_entry *entry =
+       _mesa_hash_table_search_pre_hashed(table->ht, hash, name);
+
+    return entry ? (struct symbol_header *) entry->data : NULL;
+}
+
+
+/**
+ * Get the header for \p name, creating it if the name has never been seen.
+ */
+static struct symbol_header *
+get_symbol_header(struct _mesa_symbol_table *table, const char *name)
+{
+    const uint32_t hash = _mesa_hash_string(name);
+    struct symbol_header *hdr = find_symbol(table, hash, name);
+
+    if (hdr != NULL)
+       return hdr;
+
+    hdr = calloc(1, sizeof(*hdr));
+    if (hdr == NULL) {
+       _mesa_error_no_memory(__func__);
+       return NULL;
+    }
+
+    hdr->name = strdup(name);
+    if (hdr->name == NULL) {
+       free(hdr);
+       _mesa_error_no_memory(__func__);
+       return NULL;
+    }
+
+    _mesa_hash_table_insert_pre_hashed(table->ht, hash, hdr->name, hdr);
+    hdr->next = table->hdr;
+    table->hdr = hdr;
+
+    return hdr;
 }
 
 
@@ -202,7 +238,8 @@ int
 _mesa_symbol_table_symbol_scope(struct _mesa_symbol_table *table,
 				int name_space, const char *name)
 {
-    struct symbol_header *const hdr = find_symbol(table, name);
+    struct symbol_header *const hdr =
+       find_symbol(table, _mesa_hash_string(name), name);
     struct symbol *sym;
 
     if (hdr != NULL) {
@@ -224,7 +261,8 @@ void *
 _mesa_symbol_table_find_symbol(struct _mesa_symbol_table *table,
                                int name_space, const char *name)
 {
-    struct symbol_header *const hdr = find_symbol(table, name);
+    struct symbol_header *const hdr =
+       find_symbol(table, _mesa_hash_string(name), name);
 
     if (hdr != NULL) {
         struct symbol *sym;
@@ -253,28 +291,9 @@ _mesa_symbol_table_add_symbol(struct _mesa_symbol_table *table,
 
     check_symbol_table(table);
 
-    hdr = find_symbol(table, name);
-
-    check_symbol_table(table);
-
-    if (hdr == NULL) {
-       hdr = calloc(1, sizeof(*hdr));
-       if (hdr == NULL) {
-          _mesa_error_no_memory(__func__);
-          return -1;
-       }
-
-       hdr->name = strdup(name);
-       if (hdr->name == NULL) {
-          free(hdr);
-          _mesa_error_no_memory(__func__);
-          return -1;
-       }
-
-       hash_table_insert(table->ht, hdr, hdr->name);
-       hdr->next = table->hdr;
-       table->hdr = hdr;
-    }
+    hdr = get_symbol_header(table, name);
+    if (hdr == NULL)
+       return -1;
 
     check_symbol_table(table);
 
@@ -325,23 +344,9 @@ _mesa_symbol_table_add_global_symbol(struct _mesa_symbol_table *table,
 
     check_symbol_table(table);
 
-    hdr = find_symbol(table, name);
-
-    check_symbol_table(table);
-
-    if (hdr == NULL) {
-        hdr = calloc(1, sizeof(*hdr));
-        if (hdr == NULL) {
-           _mesa_error_no_memory(__func__);
-           return -1;
-        }
-
-        hdr->name = strdup(name);
-
-        hash_table_insert(table->ht, hdr, hdr->name);
-        hdr->next = table->hdr;
-        table->hdr = hdr;
-    }
+    hdr = get_symbol_header(table, name);
+    if (hdr == NULL)
+       return -1;
 
     check_symbol_table(table);
 
@@ -404,8 +409,8 @@ _mesa_symbol_table_ctor(void)
     struct _mesa_symbol_table *table = calloc(1, sizeof(*table));
 
     if (table != NULL) {
-       table->ht = hash_table_ctor(32, hash_table_string_hash,
-				   hash_table_string_compare);
+       table->ht = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                                           _mesa_key_string_equal);
 
        _mesa_symbol_table_push_scope(table);
     }
@@ -430,6 +435,6 @@ _mesa_symbol_table_dtor(struct _mesa_symbol_table *table)
        free(hdr);
    }
 
-   hash_table_dtor(table->ht);
+   _mesa_hash_table_destroy(table->ht, NULL);
    free(table);
 }
@@ -31,8 +31,12 @@
 #include "main/context.h"
 
 #include "pipe/p_defines.h"
+#include "os/os_time.h"
+#include "util/u_phase.h"
+#include "util/u_math.h"
 #include "st_context.h"
 #include "st_atom.h"
+#include "st_debug.h"
 #include "st_program.h"
 #include "st_manager.h"
 
@@ -114,41 +118,86 @@ static const struct st_tracked_state *compute_atoms[] =
 };
 
 
+/**
+ * Build the dirty bit -> atoms dispatch masks, so validation only has to
+ * look at the bits which are actually set.
+ */
+static void
+init_atom_table(struct st_atom_table *table,
+                const struct st_tracked_state **atoms, unsigned num_atoms)
+{
+   unsigned i, bit;
+
+   memset(table, 0, sizeof(*table));
+   table->atoms = atoms;
+   table->num_atoms = num_atoms;
+
+   for (i = 0; i < num_atoms; i++) {
+      const struct st_tracked_state *atom = atoms[i];
+
+      if (!(atom->dirty.mesa || atom->dirty.st) || !atom->update) {
+         printf("malformed atom %s\n", atom->name);
+         assert(0);
+      }
+
+      for (bit = 0; bit < 32; bit++) {
+         if (atom->dirty.mesa & (1u << bit))
+            table->mesa_bit_atoms[bit] |= BITFIELD64_BIT(i);
+      }
+      for (bit = 0; bit < 64; bit++) {
+         if (atom->dirty.st & BITFIELD64_BIT(bit))
+            table->st_bit_atoms[bit] |= BITFIELD64_BIT(i);
+      }
+   }
+}
+
+
 void st_init_atoms( struct st_context *st )
 {
-   /* no-op */
+   STATIC_ASSERT(ARRAY_SIZE(render_atoms) <= ST_MAX_ATOMS);
+   STATIC_ASSERT(ARRAY_SIZE(compute_atoms) <= ST_MAX_ATOMS);
+
+   init_atom_table(&st->render_atoms, render_atoms,
+                   ARRAY_SIZE(render_atoms));
+   init_atom_table(&st->compute_atoms, compute_atoms,
+                   ARRAY_SIZE(compute_atoms));
 }
 
 
 void st_destroy_atoms( struct st_context *st )
 {
-   /* no-op */
+   if (ST_DEBUG & DEBUG_ATOMS)
+      st_print_atom_stats(st);
 }
 
 
 
+#ifdef DEBUG
 static bool
 check_state(const struct st_state_flags *a, const struct st_state_flags *b)
 {
    return (a->mesa & b->mesa) || (a->st & b->st);
 }
+#endif
 
 
-static void
-accumulate_state(struct st_state_flags *a, const struct st_state_flags *b)
+/**
+ * Return the mask of atoms interested in any of the given dirty bits.
+ */
+static uint64_t
+get_dirty_atoms(const struct st_atom_table *table,
+                const struct st_state_flags *state)
 {
-   a->mesa |= b->mesa;
-   a->st |= b->st;
-}
+   uint64_t atoms = 0;
+   unsigned mesa = state->mesa;
+   uint64_t st = state->st;
 
+   while (mesa)
+      atoms |= table->mesa_bit_atoms[u_bit_scan(&mesa)];
+   while (st)
+      atoms |= table->st_bit_atoms[u_bit_scan64(&st)];
 
-static void
-xor_states(struct st_state_flags *result,
-           const struct st_state_flags *a,
-           const struct st_state_flags *b)
-{
-   result->mesa = a->mesa ^ b->mesa;
-   result->st = a->st ^ b->st;
+   return atoms;
 }
 
 
@@ -201,21 +250,19 @@ static void check_attrib_edgeflag(struct st_context *st)
 
 void st_validate_state( struct st_context *st, enum st_pipeline pipeline )
 {
-   const struct st_tracked_state **atoms;
+   struct st_atom_table *table;
    struct st_state_flags *state;
-   GLuint num_atoms;
-   GLuint i;
+   uint64_t pending;
+   int64_t phase_start;
 
    /* Get pipeline state. */
    switch (pipeline) {
     case ST_PIPELINE_RENDER:
-      atoms     = render_atoms;
-      num_atoms = ARRAY_SIZE(render_atoms);
+      table     = &st->render_atoms;
       state     = &st->dirty;
       break;
    case ST_PIPELINE_COMPUTE:
-      atoms     = compute_atoms;
-      num_atoms = ARRAY_SIZE(compute_atoms);
+      table     = &st->compute_atoms;
       state     = &st->dirty_cp;
       break;
    default:
@@ -240,55 +287,56 @@ void st_validate_state( struct st_context *st, enum st_pipeline pipeline )
 
    /*printf("%s %x/%x\n", __func__, state->mesa, state->st);*/
 
+   phase_start = util_phase_begin();
+
+   /* Run the atoms in list order.  An atom may flag state for atoms after
+    * it, which are then added to the pending set.
+    */
+   pending = get_dirty_atoms(table, state);
+
+   while (pending) {
+      const int i = u_bit_scan64(&pending);
+      const struct st_tracked_state *atom = table->atoms[i];
+      struct st_state_flags prev = *state;
+      struct st_state_flags generated;
+
+      if (ST_DEBUG & DEBUG_ATOMS) {
+         int64_t start = os_time_get_nano();
+
+         atom->update(st);
+         table->stats[i].time_ns += os_time_get_nano() - start;
+         table->stats[i].count++;
+      } else {
+         atom->update(st);
+      }
+
+      generated.mesa = prev.mesa ^ state->mesa;
+      generated.st = prev.st ^ state->st;
+      if (!generated.mesa && !generated.st)
+         continue;
+
 #ifdef DEBUG
-   if (1) {
-#else
-   if (0) {
-#endif
-      /* Debug version which enforces various sanity checks on the
-       * state flags which are generated and checked to help ensure
-       * state atoms are ordered correctly in the list.
+      /* Sanity check that the atoms are ordered correctly: nothing may
+       * flag state which an atom up to and including this one examined.
        */
-      struct st_state_flags examined, prev;      
-      memset(&examined, 0, sizeof(examined));
-      prev = *state;
-
-      for (i = 0; i < num_atoms; i++) {
-	 const struct st_tracked_state *atom = atoms[i];
-	 struct st_state_flags generated;
-	 
-	 /*printf("atom %s %x/%x\n", atom->name, atom->dirty.mesa, atom->dirty.st);*/
-
-	 if (!(atom->dirty.mesa || atom->dirty.st) ||
-	     !atom->update) {
-	    printf("malformed atom %s\n", atom->name);
-	    assert(0);
-	 }
-
-	 if (check_state(state, &atom->dirty)) {
-	    atoms[i]->update( st );
-	    /*printf("after: %x\n", atom->dirty.mesa);*/
-	 }
-
-	 accumulate_state(&examined, &atom->dirty);
-
-	 /* generated = (prev ^ state)
-	  * if (examined & generated)
-	  *     fail;
-	  */
-	 xor_states(&generated, &prev, state);
-	 assert(!check_state(&examined, &generated));
-	 prev = *state;
+      {
+         struct st_state_flags examined;
+         int j;
+
+         memset(&examined, 0, sizeof(examined));
+         for (j = 0; j <= i; j++) {
+            examined.mesa |= table->atoms[j]->dirty.mesa;
+            examined.st |= table->atoms[j]->dirty.st;
+         }
+         assert(!check_state(&examined, &generated));
       }
-      /*printf("\n");*/
+#endif
 
-   }
-   else {
-      for (i = 0; i < num_atoms; i++) {
-	 if (check_state(state, &atoms[i]->dirty))
-	    atoms[i]->update( st );
-      }
+      pending |= get_dirty_atoms(table, &generated) &
+                 ~BITFIELD64_MASK(i + 1);
    }
 
    memset(state, 0, sizeof(*state));
+
+   util_phase_end(UTIL_PHASE_VALIDATE, phase_start);
 }
@@ -227,26 +227,6 @@ get_texture_format_swizzle(const struct st_context *st,
 }
 
 
-/**
- * Return TRUE if the texture's sampler view swizzle is not equal to
- * the texture's swizzle.
- *
- * \param stObj  the st texture object,
- */
-static boolean
-check_sampler_swizzle(const struct st_context *st,
-                      const struct st_texture_object *stObj,
-		      struct pipe_sampler_view *sv, unsigned glsl_version)
-{
-   unsigned swizzle = get_texture_format_swizzle(st, stObj, glsl_version);
-
-   return ((sv->swizzle_r != GET_SWZ(swizzle, 0)) ||
-           (sv->swizzle_g != GET_SWZ(swizzle, 1)) ||
-           (sv->swizzle_b != GET_SWZ(swizzle, 2)) ||
-           (sv->swizzle_a != GET_SWZ(swizzle, 3)));
-}
-
-
 static unsigned last_level(struct st_texture_object *stObj)
 {
    unsigned ret = MIN2(stObj->base.MinLevel + stObj->base._MaxLevel,
@@ -264,16 +244,22 @@ static unsigned last_layer(struct st_texture_object *stObj)
    return stObj->pt->array_size - 1;
 }
 
-static struct pipe_sampler_view *
-st_create_texture_sampler_view_from_stobj(struct st_context *st,
-					  struct st_texture_object *stObj,
-					  enum pipe_format format,
-                                          unsigned glsl_version)
+/**
+ * Fill in the template of the sampler view needed to sample from the
+ * texture with the given format.
+ *
+ * \return FALSE if the texture can't be sampled (empty buffer range).
+ */
+static boolean
+st_init_sampler_view_template_from_stobj(struct st_context *st,
+                                         struct st_texture_object *stObj,
+                                         enum pipe_format format,
+                                         unsigned glsl_version,
+                                         struct pipe_sampler_view *templ)
 {
-   struct pipe_sampler_view templ;
    unsigned swizzle = get_texture_format_swizzle(st, stObj, glsl_version);
 
-   u_sampler_view_default_template(&templ,
+   u_sampler_view_default_template(templ,
                                    stObj->pt,
                                    format);
 
@@ -281,37 +267,37 @@ st_create_texture_sampler_view_from_stobj(struct st_context *st,
       unsigned base, size;
       unsigned f, n;
       const struct util_format_description *desc
-         = util_format_description(templ.format);
+         = util_format_description(templ->format);
 
       base = stObj->base.BufferOffset;
       if (base >= stObj->pt->width0)
-         return NULL;
+         return FALSE;
       size = MIN2(stObj->pt->width0 - base, (unsigned)stObj->base.BufferSize);
 
       f = (base / (desc->block.bits / 8)) * desc->block.width;
       n = (size / (desc->block.bits / 8)) * desc->block.width;
       if (!n)
-         return NULL;
-      templ.u.buf.first_element = f;
-      templ.u.buf.last_element  = f + (n - 1);
+         return FALSE;
+      templ->u.buf.first_element = f;
+      templ->u.buf.last_element  = f + (n - 1);
    } else {
-      templ.u.tex.first_level = stObj->base.MinLevel + stObj->base.BaseLevel;
-      templ.u.tex.last_level = last_level(stObj);
-      assert(templ.u.tex.first_level <= templ.u.tex.last_level);
-      templ.u.tex.first_layer = stObj->base.MinLayer;
-      templ.u.tex.last_layer = last_layer(stObj);
-      assert(templ.u.tex.first_layer <= templ.u.tex.last_layer);
-      templ.target = gl_target_to_pipe(stObj->base.Target);
+      templ->u.tex.first_level = stObj->base.MinLevel + stObj->base.BaseLevel;
+      templ->u.tex.last_level = last_level(stObj);
+      assert(templ->u.tex.first_level <= templ->u.tex.last_level);
+      templ->u.tex.first_layer = stObj->base.MinLayer;
+      templ->u.tex.last_layer = last_layer(stObj);
+      assert(templ->u.tex.first_layer <= templ->u.tex.last_layer);
+      templ->target = gl_target_to_pipe(stObj->base.Target);
    }
 
    if (swizzle != SWIZZLE_NOOP) {
-      templ.swizzle_r = GET_SWZ(swizzle, 0);
-      templ.swizzle_g = GET_SWZ(swizzle, 1);
-      templ.swizzle_b = GET_SWZ(swizzle, 2);
-      templ.swizzle_a = GET_SWZ(swizzle, 3);
+      templ->swizzle_r = GET_SWZ(swizzle, 0);
+      templ->swizzle_g = GET_SWZ(swizzle, 1);
+      templ->swizzle_b = GET_SWZ(swizzle, 2);
+      templ->swizzle_a = GET_SWZ(swizzle, 3);
    }
 
-   return st->pipe->create_sampler_view(st->pipe, stObj->pt, &templ);
+   return TRUE;
 }
 
 
@@ -321,14 +307,15 @@ st_get_texture_sampler_view_from_stobj(struct st_context *st,
 				       enum pipe_format format,
                                        unsigned glsl_version)
 {
+   struct pipe_sampler_view templ;
    struct pipe_sampler_view **sv;
    const struct st_texture_image *firstImage;
+   boolean found;
+
    if (!stObj || !stObj->pt) {
       return NULL;
    }
 
-   sv = st_texture_get_sampler_view(st, stObj);
-
    if (util_format_is_depth_and_stencil(format)) {
       if (stObj->base.StencilSampling)
          format = util_format_stencil_only(format);
@@ -339,29 +326,17 @@ st_get_texture_sampler_view_from_stobj(struct st_context *st,
       }
    }
 
-   /* if sampler view has changed dereference it */
-   if (*sv) {
-      if (check_sampler_swizzle(st, stObj, *sv, glsl_version) ||
-	  (format != (*sv)->format) ||
-          gl_target_to_pipe(stObj->base.Target) != (*sv)->target ||
-          stObj->base.MinLevel + stObj->base.BaseLevel != (*sv)->u.tex.first_level ||
-          last_level(stObj) != (*sv)->u.tex.last_level ||
-          stObj->base.MinLayer != (*sv)->u.tex.first_layer ||
-          last_layer(stObj) != (*sv)->u.tex.last_layer) {
-	 pipe_sampler_view_reference(sv, NULL);
-      }
-   }
-
-   if (!*sv) {
-      *sv = st_create_texture_sampler_view_from_stobj(st, stObj,
-                                                      format, glsl_version);
+   if (!st_init_sampler_view_template_from_stobj(st, stObj, format,
+                                                 glsl_version, &templ))
+      return NULL;
 
-   } else if ((*sv)->context != st->pipe) {
-      /* Recreate view in correct context, use existing view as template */
-      struct pipe_sampler_view *new_sv =
-         st->pipe->create_sampler_view(st->pipe, stObj->pt, *sv);
+   /* Views are kept for the last few templates used with this texture in
+    * this context, so only create one if none of them matches.
+    */
+   sv = st_texture_find_sampler_view(st, stObj, &templ, &found);
+   if (!found) {
       pipe_sampler_view_reference(sv, NULL);
-      *sv = new_sv;
+      *sv = st->pipe->create_sampler_view(st->pipe, stObj->pt, &templ);
    }
 
    return *sv;
@@ -44,6 +44,8 @@
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 #include "util/u_gen_mipmap.h"
+#include "util/u_upload_mgr.h"
+#include "util/u_phase.h"
 
 
 /** Check if we have a front color buffer and if it's been drawn to. */
@@ -79,12 +81,33 @@ void st_flush(struct st_context *st,
               struct pipe_fence_handle **fence,
               unsigned flags)
 {
+   struct pipe_screen *screen = st->pipe->screen;
+   struct pipe_fence_handle *local_fence = NULL;
+   int64_t phase_start;
+
    FLUSH_VERTICES(st->ctx, 0);
    FLUSH_CURRENT(st->ctx, 0);
 
    st_flush_bitmap_cache(st);
 
-   st->pipe->flush(st->pipe, fence, flags);
+   /* Always get a fence, so that the upload managers can recycle their
+    * buffers once the GPU is done with them. */
+   phase_start = util_phase_begin();
+   st->pipe->flush(st->pipe, &local_fence, flags);
+   util_phase_end(UTIL_PHASE_FLUSH, phase_start);
+
+   if (fence)
+      screen->fence_reference(screen, fence, local_fence);
+
+   if (local_fence) {
+      u_upload_fence(st->uploader, local_fence);
+      if (st->indexbuf_uploader)
+         u_upload_fence(st->indexbuf_uploader, local_fence);
+      if (st->constbuf_uploader)
+         u_upload_fence(st->constbuf_uploader, local_fence);
+
+      screen->fence_reference(screen, &local_fence, NULL);
+   }
 }
 
 
@@ -36,6 +36,7 @@
 #include "main/shaderapi.h"
 #include "program/prog_instruction.h"
 #include "program/program.h"
+#include "util/ralloc.h"
 
 #include "cso_cache/cso_context.h"
 #include "draw/draw_context.h"
@@ -154,6 +155,9 @@ st_delete_program(struct gl_context *ctx, struct gl_program *prog)
          
          if (stvp->glsl_to_tgsi)
             free_glsl_to_tgsi_visitor(stvp->glsl_to_tgsi);
+
+         if (stvp->tgsi.type == PIPE_SHADER_IR_NIR)
+            ralloc_free(stvp->tgsi.nir);
       }
       break;
    case GL_GEOMETRY_PROGRAM_NV:
@@ -177,6 +181,9 @@ st_delete_program(struct gl_context *ctx, struct gl_program *prog)
          
          if (stfp->glsl_to_tgsi)
             free_glsl_to_tgsi_visitor(stfp->glsl_to_tgsi);
+
+         if (stfp->tgsi.type == PIPE_SHADER_IR_NIR)
+            ralloc_free(stfp->tgsi.nir);
       }
       break;
    case GL_TESS_CONTROL_PROGRAM_NV:
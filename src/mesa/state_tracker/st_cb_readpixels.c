@@ -25,6 +25,7 @@
  * 
  **************************************************************************/
 
+#include "main/bufferobj.h"
 #include "main/image.h"
 #include "main/pbo.h"
 #include "main/imports.h"
@@ -33,11 +34,17 @@
 #include "main/framebuffer.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
+#include "util/u_sampler.h"
+#include "util/u_surface.h"
+#include "util/u_upload_mgr.h"
+#include "cso_cache/cso_context.h"
+#include "tgsi/tgsi_ureg.h"
 
 #include "st_cb_fbo.h"
 #include "st_atom.h"
 #include "st_context.h"
 #include "st_cb_bitmap.h"
+#include "st_cb_bufferobjects.h"
 #include "st_cb_readpixels.h"
 #include "state_tracker/st_cb_texture.h"
 #include "state_tracker/st_format.h"
@@ -68,6 +75,496 @@ needs_integer_signed_unsigned_conversion(const struct gl_context *ctx,
    return FALSE;
 }
 
+void
+st_init_pbo_download(struct st_context *st)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct pipe_screen *screen = pipe->screen;
+
+   st->pbo_download.enabled =
+      pipe->set_shader_images &&
+      screen->get_param(screen, PIPE_CAP_TEXTURE_BUFFER_OBJECTS) &&
+      screen->get_param(screen, PIPE_CAP_TEXTURE_BUFFER_OFFSET_ALIGNMENT) >= 1 &&
+      screen->get_shader_param(screen, PIPE_SHADER_FRAGMENT, PIPE_SHADER_CAP_INTEGERS) &&
+      screen->get_shader_param(screen, PIPE_SHADER_FRAGMENT,
+                               PIPE_SHADER_CAP_MAX_SHADER_IMAGES) >= 1;
+}
+
+void
+st_destroy_pbo_download(struct st_context *st)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(st->pbo_download.fs); i++) {
+      if (st->pbo_download.fs[i]) {
+         cso_delete_fragment_shader(st->cso_context, st->pbo_download.fs[i]);
+         st->pbo_download.fs[i] = NULL;
+      }
+   }
+}
+
+/**
+ * Create a fragment shader which fetches one texel of the read buffer and
+ * stores it into the pixel pack buffer, which is bound as a buffer image
+ * of the format matching the format and type combo. The conversion to
+ * the packed format is done by the image store.
+ */
+static void *
+create_pbo_download_fs(struct st_context *st, enum pipe_format format)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct pipe_screen *screen = pipe->screen;
+   struct ureg_program *ureg;
+   struct ureg_dst image;
+   struct ureg_src sampler;
+   struct ureg_src pos;
+   struct ureg_src const0, const1;
+   struct ureg_dst temp0, temp1, temp2;
+   struct ureg_src src[2];
+
+   ureg = ureg_create(TGSI_PROCESSOR_FRAGMENT);
+   if (!ureg)
+      return NULL;
+
+   sampler = ureg_DECL_sampler(ureg, 0);
+   image = ureg_dst(ureg_DECL_image(ureg, 0, TGSI_TEXTURE_BUFFER, format,
+                                    true, false));
+   if (screen->get_param(screen, PIPE_CAP_TGSI_FS_POSITION_IS_SYSVAL)) {
+      pos = ureg_DECL_system_value(ureg, TGSI_SEMANTIC_POSITION, 0);
+   } else {
+      pos = ureg_DECL_fs_input(ureg, TGSI_SEMANTIC_POSITION, 0,
+                               TGSI_INTERPOLATE_LINEAR);
+   }
+   const0 = ureg_DECL_constant(ureg, 0);
+   const1 = ureg_DECL_constant(ureg, 1);
+   temp0 = ureg_DECL_temporary(ureg);
+   temp1 = ureg_DECL_temporary(ureg);
+   temp2 = ureg_DECL_temporary(ureg);
+
+   /* Note: const0 = [ x, y, y_step, 0 ]
+    *       const1 = [ skip_pixels, stride, 0, 0 ]
+    */
+
+   /* temp0.xy = f2i(pos.xy) */
+   ureg_F2I(ureg, ureg_writemask(temp0, TGSI_WRITEMASK_XY),
+                  ureg_swizzle(pos,
+                               TGSI_SWIZZLE_X, TGSI_SWIZZLE_Y,
+                               TGSI_SWIZZLE_Y, TGSI_SWIZZLE_Y));
+
+   /* temp1.x = temp0.x + const0.x */
+   ureg_UADD(ureg, ureg_writemask(temp1, TGSI_WRITEMASK_X),
+                   ureg_scalar(ureg_src(temp0), TGSI_SWIZZLE_X),
+                   ureg_scalar(const0, TGSI_SWIZZLE_X));
+
+   /* temp1.y = const0.z * temp0.y + const0.y */
+   ureg_UMAD(ureg, ureg_writemask(temp1, TGSI_WRITEMASK_Y),
+                   ureg_scalar(const0, TGSI_SWIZZLE_Z),
+                   ureg_scalar(ureg_src(temp0), TGSI_SWIZZLE_Y),
+                   ureg_scalar(const0, TGSI_SWIZZLE_Y));
+
+   /* temp1.zw = 0 */
+   ureg_MOV(ureg, ureg_writemask(temp1, TGSI_WRITEMASK_ZW),
+                  ureg_imm1u(ureg, 0));
+
+   /* temp0.x = const1.y * temp0.y + temp0.x */
+   ureg_UMAD(ureg, ureg_writemask(temp0, TGSI_WRITEMASK_X),
+                   ureg_scalar(const1, TGSI_SWIZZLE_Y),
+                   ureg_scalar(ureg_src(temp0), TGSI_SWIZZLE_Y),
+                   ureg_scalar(ureg_src(temp0), TGSI_SWIZZLE_X));
+
+   /* temp0.x = temp0.x + const1.x */
+   ureg_UADD(ureg, ureg_writemask(temp0, TGSI_WRITEMASK_X),
+                   ureg_scalar(ureg_src(temp0), TGSI_SWIZZLE_X),
+                   ureg_scalar(const1, TGSI_SWIZZLE_X));
+
+   /* temp2 = txf(sampler, temp1) */
+   ureg_TXF(ureg, temp2, TGSI_TEXTURE_2D, ureg_src(temp1), sampler);
+
+   /* store(image, temp0.x, temp2) */
+   src[0] = ureg_scalar(ureg_src(temp0), TGSI_SWIZZLE_X);
+   src[1] = ureg_src(temp2);
+   ureg_memory_insn(ureg, TGSI_OPCODE_STORE, &image, 1, src, 2, 0,
+                    TGSI_TEXTURE_BUFFER, format);
+
+   ureg_release_temporary(ureg, temp0);
+   ureg_release_temporary(ureg, temp1);
+   ureg_release_temporary(ureg, temp2);
+
+   ureg_END(ureg);
+
+   return ureg_create_shader_and_destroy(ureg, pipe);
+}
+
+/**
+ * Read pixels into a pixel pack buffer without a CPU round-trip: a quad
+ * covering the read region is drawn with a fragment shader which stores
+ * every texel of the read buffer into the PBO, bound as a buffer image.
+ * Nothing is mapped here, so the GPU work is only waited for when the
+ * application maps the PBO.
+ *
+ * Returns false if this path can't be used, in which case nothing was
+ * written yet.
+ */
+static bool
+try_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
+                   enum pipe_format src_format,
+                   GLint x, GLint y, GLsizei width, GLsizei height,
+                   GLenum format, GLenum type,
+                   const struct gl_pixelstore_attrib *pack,
+                   const void *pixels)
+{
+   struct gl_context *ctx = st->ctx;
+   struct cso_context *cso = st->cso_context;
+   struct pipe_context *pipe = st->pipe;
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_resource *texture = strb->texture;
+   struct pipe_resource *buffer = st_buffer_object(pack->BufferObj)->buffer;
+   struct pipe_resource *rt = NULL;
+   struct pipe_surface *surface = NULL;
+   const struct util_format_description *desc;
+   enum pipe_format dst_format;
+   intptr_t buf_offset;
+   unsigned bytes_per_pixel;
+   unsigned stride;
+   unsigned skip_pixels = 0;
+   bool success = false;
+
+   if (!buffer || pack->Invert)
+      return false;
+
+   /* The shader only handles single-sampled, single layer 2D sources. */
+   if (texture->target != PIPE_TEXTURE_2D ||
+       texture->nr_samples > 1 ||
+       strb->surface->u.tex.first_layer != 0)
+      return false;
+
+   /* Choose the format the PBO is viewed as. Like for PBO uploads, this
+    * is done without checking texture support, as drivers may support
+    * formats for buffers which they don't support for regular textures. */
+   dst_format = st_choose_matching_format(st, 0, format, type,
+                                          pack->SwapBytes);
+   if (!dst_format)
+      return false;
+
+   desc = util_format_description(dst_format);
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB)
+      return false;
+
+   if (util_format_is_pure_integer(src_format) !=
+       util_format_is_pure_integer(dst_format))
+      return false;
+
+   if (!screen->is_format_supported(screen, dst_format, PIPE_BUFFER, 0,
+                                    PIPE_BIND_SHADER_IMAGE))
+      return false;
+
+   /* Compute the offset and the stride in pixels */
+   {
+      intptr_t bytes_per_row =
+         _mesa_image_row_stride(pack, width, format, type);
+
+      bytes_per_pixel = desc->block.bits / 8;
+      buf_offset = (intptr_t) _mesa_image_address2d(pack, pixels,
+                                                    width, height,
+                                                    format, type, 0, 0);
+
+      if (buf_offset % bytes_per_pixel || bytes_per_row % bytes_per_pixel)
+         return false;
+
+      buf_offset = buf_offset / bytes_per_pixel;
+      stride = bytes_per_row / bytes_per_pixel;
+   }
+
+   /* Check alignment. */
+   {
+      unsigned ofs = (buf_offset * bytes_per_pixel) % ctx->Const.TextureBufferOffsetAlignment;
+      if (ofs != 0) {
+         if (ofs % bytes_per_pixel != 0)
+            return false;
+
+         skip_pixels = ofs / bytes_per_pixel;
+         buf_offset -= skip_pixels;
+      }
+   }
+
+   if (skip_pixels + width - 1 + (height - 1) * stride >
+       ctx->Const.MaxTextureBufferSize - 1)
+      return false;
+
+   /* The fragments are generated by drawing into a dummy render target
+    * of the size of the region, with color writes disabled. */
+   if (!screen->is_format_supported(screen, PIPE_FORMAT_R8_UNORM,
+                                    PIPE_TEXTURE_2D, 0,
+                                    PIPE_BIND_RENDER_TARGET))
+      return false;
+
+   if (!st->pbo_upload.vs) {
+      st->pbo_upload.vs = st_create_pbo_upload_vs(st);
+      if (!st->pbo_upload.vs)
+         return false;
+   }
+
+   if (!st->pbo_download.fs[dst_format]) {
+      st->pbo_download.fs[dst_format] = create_pbo_download_fs(st, dst_format);
+      if (!st->pbo_download.fs[dst_format])
+         return false;
+   }
+
+   {
+      struct pipe_resource templ;
+      struct pipe_surface surf_templ;
+
+      memset(&templ, 0, sizeof(templ));
+      templ.target = PIPE_TEXTURE_2D;
+      templ.format = PIPE_FORMAT_R8_UNORM;
+      templ.width0 = width;
+      templ.height0 = height;
+      templ.depth0 = 1;
+      templ.array_size = 1;
+      templ.bind = PIPE_BIND_RENDER_TARGET;
+      templ.usage = PIPE_USAGE_DEFAULT;
+
+      rt = screen->resource_create(screen, &templ);
+      if (!rt)
+         return false;
+
+      u_surface_default_template(&surf_templ, rt);
+      surface = pipe->create_surface(pipe, rt, &surf_templ);
+      if (!surface) {
+         pipe_resource_reference(&rt, NULL);
+         return false;
+      }
+   }
+
+   cso_save_state(cso, (CSO_BIT_FRAGMENT_SAMPLER_VIEWS |
+                        CSO_BIT_FRAGMENT_SAMPLERS |
+                        CSO_BIT_VERTEX_ELEMENTS |
+                        CSO_BIT_AUX_VERTEX_BUFFER_SLOT |
+                        CSO_BIT_FRAMEBUFFER |
+                        CSO_BIT_VIEWPORT |
+                        CSO_BIT_BLEND |
+                        CSO_BIT_DEPTH_STENCIL_ALPHA |
+                        CSO_BIT_RASTERIZER |
+                        CSO_BIT_RENDER_CONDITION |
+                        CSO_BIT_STREAM_OUTPUTS |
+                        CSO_BITS_ALL_SHADERS));
+   cso_save_constant_buffer_slot0(cso, PIPE_SHADER_FRAGMENT);
+
+   cso_set_render_condition(cso, NULL, FALSE, 0);
+
+   /* Set up the sampler view of the read buffer */
+   {
+      struct pipe_sampler_view templ;
+      struct pipe_sampler_view *sampler_view;
+      struct pipe_sampler_state sampler = {0};
+      const struct pipe_sampler_state *samplers[1] = {&sampler};
+
+      u_sampler_view_default_template(&templ, texture, src_format);
+      templ.u.tex.first_level = strb->surface->u.tex.level;
+      templ.u.tex.last_level = strb->surface->u.tex.level;
+
+      sampler_view = pipe->create_sampler_view(pipe, texture, &templ);
+      if (sampler_view == NULL)
+         goto fail;
+
+      cso_set_sampler_views(cso, PIPE_SHADER_FRAGMENT, 1, &sampler_view);
+
+      pipe_sampler_view_reference(&sampler_view, NULL);
+
+      cso_set_samplers(cso, PIPE_SHADER_FRAGMENT, 1, samplers);
+   }
+
+   /* Set up the PBO image */
+   {
+      struct pipe_image_view image;
+
+      memset(&image, 0, sizeof(image));
+      image.resource = buffer;
+      image.format = dst_format;
+      image.access = PIPE_IMAGE_ACCESS_WRITE;
+      image.u.buf.first_element = buf_offset;
+      image.u.buf.last_element = buf_offset + skip_pixels + width - 1
+         + (height - 1) * stride;
+
+      pipe->set_shader_images(pipe, PIPE_SHADER_FRAGMENT, 0, 1, &image);
+   }
+
+   /* Upload vertices */
+   {
+      struct pipe_vertex_buffer vbo;
+      struct pipe_vertex_element velem;
+      float *verts = NULL;
+
+      vbo.user_buffer = NULL;
+      vbo.buffer = NULL;
+      vbo.stride = 2 * sizeof(float);
+
+      u_upload_alloc(st->uploader, 0, 8 * sizeof(float), 4,
+                     &vbo.buffer_offset, &vbo.buffer, (void **) &verts);
+      if (!verts)
+         goto fail_image;
+
+      verts[0] = -1.0f;
+      verts[1] = -1.0f;
+      verts[2] = -1.0f;
+      verts[3] = 1.0f;
+      verts[4] = 1.0f;
+      verts[5] = -1.0f;
+      verts[6] = 1.0f;
+      verts[7] = 1.0f;
+
+      u_upload_unmap(st->uploader);
+
+      velem.src_offset = 0;
+      velem.instance_divisor = 0;
+      velem.vertex_buffer_index = cso_get_aux_vertex_buffer_slot(cso);
+      velem.src_format = PIPE_FORMAT_R32G32_FLOAT;
+
+      cso_set_vertex_elements(cso, 1, &velem);
+
+      cso_set_vertex_buffers(cso, velem.vertex_buffer_index, 1, &vbo);
+
+      pipe_resource_reference(&vbo.buffer, NULL);
+   }
+
+   /* Upload constants */
+   /* Note: the user buffer must be valid until draw time */
+   struct {
+      int32_t x;
+      int32_t y;
+      int32_t y_step;
+      int32_t pad0;
+      int32_t skip_pixels;
+      int32_t stride;
+      int32_t pad1[2];
+   } constants;
+
+   {
+      struct pipe_constant_buffer cb;
+
+      memset(&constants, 0, sizeof(constants));
+      constants.x = x;
+      constants.skip_pixels = skip_pixels;
+      constants.stride = stride;
+
+      /* Row 0 of the image is the bottom row of the region. */
+      if (st_fb_orientation(ctx->ReadBuffer) == Y_0_TOP) {
+         constants.y = strb->Base.Height - 1 - y;
+         constants.y_step = -1;
+      } else {
+         constants.y = y;
+         constants.y_step = 1;
+      }
+
+      if (st->constbuf_uploader) {
+         cb.buffer = NULL;
+         cb.user_buffer = NULL;
+         u_upload_data(st->constbuf_uploader, 0, sizeof(constants),
+                       ctx->Const.UniformBufferOffsetAlignment,
+                       &constants, &cb.buffer_offset, &cb.buffer);
+         if (!cb.buffer)
+            goto fail_image;
+
+         u_upload_unmap(st->constbuf_uploader);
+      } else {
+         cb.buffer = NULL;
+         cb.user_buffer = &constants;
+         cb.buffer_offset = 0;
+      }
+      cb.buffer_size = sizeof(constants);
+
+      cso_set_constant_buffer(cso, PIPE_SHADER_FRAGMENT, 0, &cb);
+
+      pipe_resource_reference(&cb.buffer, NULL);
+   }
+
+   /* Framebuffer_state */
+   {
+      struct pipe_framebuffer_state fb;
+      memset(&fb, 0, sizeof(fb));
+      fb.width = surface->width;
+      fb.height = surface->height;
+      fb.nr_cbufs = 1;
+      pipe_surface_reference(&fb.cbufs[0], surface);
+
+      cso_set_framebuffer(cso, &fb);
+
+      pipe_surface_reference(&fb.cbufs[0], NULL);
+   }
+
+   cso_set_viewport_dims(cso, surface->width, surface->height, FALSE);
+
+   /* Blend state, with all color writes disabled */
+   {
+      struct pipe_blend_state blend;
+      memset(&blend, 0, sizeof(blend));
+      cso_set_blend(cso, &blend);
+   }
+
+   /* Depth/stencil/alpha state */
+   {
+      struct pipe_depth_stencil_alpha_state dsa;
+      memset(&dsa, 0, sizeof(dsa));
+      cso_set_depth_stencil_alpha(cso, &dsa);
+   }
+
+   /* Rasterizer state */
+   {
+      struct pipe_rasterizer_state raster;
+      memset(&raster, 0, sizeof(raster));
+      raster.half_pixel_center = 1;
+      cso_set_rasterizer(cso, &raster);
+   }
+
+   /* Set up the shaders */
+   cso_set_vertex_shader_handle(cso, st->pbo_upload.vs);
+
+   cso_set_geometry_shader_handle(cso, NULL);
+
+   cso_set_tessctrl_shader_handle(cso, NULL);
+
+   cso_set_tesseval_shader_handle(cso, NULL);
+
+   cso_set_fragment_shader_handle(cso, st->pbo_download.fs[dst_format]);
+
+   /* Disable stream output */
+   cso_set_stream_outputs(cso, 0, NULL, 0);
+
+   cso_draw_arrays(cso, PIPE_PRIM_TRIANGLE_STRIP, 0, 4);
+
+   /* Make the stores visible to whatever the PBO is used for next. */
+   if (pipe->memory_barrier) {
+      pipe->memory_barrier(pipe, PIPE_BARRIER_MAPPED_BUFFER |
+                                 PIPE_BARRIER_SHADER_BUFFER |
+                                 PIPE_BARRIER_VERTEX_BUFFER |
+                                 PIPE_BARRIER_INDEX_BUFFER |
+                                 PIPE_BARRIER_CONSTANT_BUFFER |
+                                 PIPE_BARRIER_INDIRECT_BUFFER |
+                                 PIPE_BARRIER_TEXTURE |
+                                 PIPE_BARRIER_IMAGE |
+                                 PIPE_BARRIER_STREAMOUT_BUFFER);
+   }
+
+   success = true;
+
+fail_image:
+   /* Images aren't part of the saved CSO state; let the image atom rebind
+    * the application's images. */
+   pipe->set_shader_images(pipe, PIPE_SHADER_FRAGMENT, 0, 1, NULL);
+   st->dirty.st |= ST_NEW_IMAGE_UNITS;
+
+fail:
+   cso_restore_state(cso);
+   cso_restore_constant_buffer_slot0(cso, PIPE_SHADER_FRAGMENT);
+
+   pipe_surface_reference(&surface, NULL);
+   pipe_resource_reference(&rt, NULL);
+
+   return success;
+}
+
 /**
  * This uses a blit to copy the read buffer to a texture format which matches
  * the format and type combo and then a fast read-back is done using memcpy.
@@ -120,14 +617,6 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
       goto fallback;
    }
 
-   /* We are creating a texture of the size of the region being read back.
-    * Need to check for NPOT texture support. */
-   if (!screen->get_param(screen, PIPE_CAP_NPOT_TEXTURES) &&
-       (!util_is_power_of_two(width) ||
-        !util_is_power_of_two(height))) {
-      goto fallback;
-   }
-
    /* If the base internal format and the texture format don't match, we have
     * to use the slow path. */
    if (rb->_BaseFormat !=
@@ -135,14 +624,6 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
       goto fallback;
    }
 
-   /* See if the texture format already matches the format and type,
-    * in which case the memcpy-based fast path will likely be used and
-    * we don't have to blit. */
-   if (_mesa_format_matches_format_and_type(rb->Format, format,
-                                            type, pack->SwapBytes, NULL)) {
-      goto fallback;
-   }
-
    if (_mesa_readpixels_needs_slow_path(ctx, format, type, GL_TRUE)) {
       goto fallback;
    }
@@ -164,6 +645,32 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
       goto fallback;
    }
 
+   /* Reading into a PBO is done entirely on the GPU if possible, even if
+    * the formats match, to avoid mapping the read buffer here. */
+   if (st->pbo_download.enabled &&
+       _mesa_is_bufferobj(pack->BufferObj) &&
+       format != GL_DEPTH_COMPONENT && format != GL_STENCIL_INDEX &&
+       try_pbo_readpixels(st, strb, src_format, x, y, width, height,
+                          format, type, pack, pixels)) {
+      return;
+   }
+
+   /* See if the texture format already matches the format and type,
+    * in which case the memcpy-based fast path will likely be used and
+    * we don't have to blit. */
+   if (_mesa_format_matches_format_and_type(rb->Format, format,
+                                            type, pack->SwapBytes, NULL)) {
+      goto fallback;
+   }
+
+   /* We are creating a texture of the size of the region being read back.
+    * Need to check for NPOT texture support. */
+   if (!screen->get_param(screen, PIPE_CAP_NPOT_TEXTURES) &&
+       (!util_is_power_of_two(width) ||
+        !util_is_power_of_two(height))) {
+      goto fallback;
+   }
+
    if (format == GL_DEPTH_COMPONENT || format == GL_DEPTH_STENCIL)
       bind |= PIPE_BIND_DEPTH_STENCIL;
    else
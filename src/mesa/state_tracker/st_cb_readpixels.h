@@ -32,9 +32,16 @@
 #include "main/glheader.h"
 
 struct dd_function_table;
+struct st_context;
 
 extern void
 st_init_readpixels_functions(struct dd_function_table *functions);
 
+extern void
+st_init_pbo_download(struct st_context *st);
+
+extern void
+st_destroy_pbo_download(struct st_context *st);
+
 
 #endif /* ST_CB_READPIXELS_H */
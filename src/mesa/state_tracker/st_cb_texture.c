@@ -1122,8 +1122,8 @@ reinterpret_formats(enum pipe_format *src_format, enum pipe_format *dst_format)
    return true;
 }
 
-static void *
-create_pbo_upload_vs(struct st_context *st)
+void *
+st_create_pbo_upload_vs(struct st_context *st)
 {
    struct ureg_program *ureg;
    struct ureg_src in_pos;
@@ -1318,7 +1318,7 @@ try_pbo_upload_common(struct gl_context *ctx,
 
    /* Create the shaders */
    if (!st->pbo_upload.vs) {
-      st->pbo_upload.vs = create_pbo_upload_vs(st);
+      st->pbo_upload.vs = st_create_pbo_upload_vs(st);
       if (!st->pbo_upload.vs)
          return false;
    }
@@ -59,4 +59,7 @@ st_init_pbo_upload(struct st_context *st);
 extern void
 st_destroy_pbo_upload(struct st_context *st);
 
+extern void *
+st_create_pbo_upload_vs(struct st_context *st);
+
 #endif /* ST_CB_TEXTURE_H */
@@ -79,6 +79,27 @@ struct st_tracked_state {
    void (*update)( struct st_context *st );
 };
 
+/** Atoms are tracked in 64-bit masks, so no pipeline may have more. */
+#define ST_MAX_ATOMS 64
+
+/**
+ * Per-pipeline atom bookkeeping, see st_init_atoms().
+ */
+struct st_atom_table {
+   const struct st_tracked_state **atoms;
+   unsigned num_atoms;
+
+   /** Mask of atoms to run for each _NEW_x / ST_NEW_x bit. */
+   uint64_t mesa_bit_atoms[32];
+   uint64_t st_bit_atoms[64];
+
+   /** Per-atom statistics, gathered with ST_DEBUG=atoms. */
+   struct {
+      uint64_t count;
+      int64_t time_ns;
+   } stats[ST_MAX_ATOMS];
+};
+
 
 /**
  * Enumeration of state tracker pipelines.
@@ -174,6 +195,9 @@ struct st_context
    struct st_state_flags dirty;
    struct st_state_flags dirty_cp;
 
+   struct st_atom_table render_atoms;
+   struct st_atom_table compute_atoms;
+
    GLboolean vertdata_edgeflags;
    GLboolean edgeflag_culls_prims;
 
@@ -248,6 +272,12 @@ struct st_context
       bool use_gs;
    } pbo_upload;
 
+   /* For glReadPixels into a pixel pack buffer */
+   struct {
+      void *fs[PIPE_FORMAT_COUNT]; /**< indexed by the PBO's pipe_format */
+      bool enabled;
+   } pbo_download;
+
    /** for drawing with st_util_vertex */
    struct pipe_vertex_element util_velems[3];
 
@@ -26,6 +26,8 @@
  **************************************************************************/
 
 
+#include <inttypes.h>
+
 #include "main/context.h"
 #include "program/prog_print.h"
 
@@ -58,6 +60,8 @@ static const struct debug_named_value st_debug_flags[] = {
    { "wf",       DEBUG_WIREFRAME, NULL },
    { "precompile",  DEBUG_PRECOMPILE, NULL },
    { "gremedy",  DEBUG_GREMEDY, "Enable GREMEDY debug extensions" },
+   { "variants", DEBUG_VARIANTS, "Print shader variant counts" },
+   { "atoms",    DEBUG_ATOMS, "Print per-atom validation counts and times" },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -75,6 +79,42 @@ st_debug_init(void)
 
 
 
+static void
+print_atom_table_stats(const char *pipeline, const struct st_atom_table *table)
+{
+   unsigned i;
+
+   debug_printf("%s atoms:\n", pipeline);
+   debug_printf("  %-28s %10s %12s %10s\n", "atom", "updates", "total (us)",
+                "avg (ns)");
+
+   for (i = 0; i < table->num_atoms; i++) {
+      uint64_t count = table->stats[i].count;
+      int64_t time_ns = table->stats[i].time_ns;
+
+      if (!count)
+         continue;
+
+      debug_printf("  %-28s %10"PRIu64" %12"PRId64" %10"PRId64"\n",
+                   table->atoms[i]->name, count, time_ns / 1000,
+                   time_ns / (int64_t) count);
+   }
+}
+
+
+/**
+ * Print how often each state atom ran and how long it took, gathered
+ * when ST_DEBUG=atoms is set.
+ */
+void
+st_print_atom_stats(struct st_context *st)
+{
+   print_atom_table_stats("render", &st->render_atoms);
+   print_atom_table_stats("compute", &st->compute_atoms);
+}
+
+
+
 /**
  * Print current state.  May be called from inside gdb to see currently
  * bound vertex/fragment shaders and associated constants.
@@ -94,14 +134,18 @@ st_print_current(void)
    }
 #endif
 
-   if (st->vp->variants)
+   if (st->vp->variants && st->vp->variants[0].tgsi.tokens)
       tgsi_dump( st->vp->variants[0].tgsi.tokens, 0 );
    if (st->vp->Base.Base.Parameters)
       _mesa_print_parameter_list(st->vp->Base.Base.Parameters);
 
-   tgsi_dump(st->fp->tgsi.tokens, 0);
+   if (st->fp->tgsi.tokens)
+      tgsi_dump(st->fp->tgsi.tokens, 0);
    if (st->fp->Base.Base.Parameters)
       _mesa_print_parameter_list(st->fp->Base.Base.Parameters);
+
+   printf("Vertex program variants: %u\n", st->vp->num_variants);
+   printf("Fragment program variants: %u\n", st->fp->num_variants);
 }
 
 
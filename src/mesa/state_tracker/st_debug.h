@@ -51,6 +51,8 @@ st_print_current(void);
 #define DEBUG_WIREFRAME 0x400
 #define DEBUG_PRECOMPILE   0x800
 #define DEBUG_GREMEDY   0x1000
+#define DEBUG_VARIANTS  0x2000
+#define DEBUG_ATOMS     0x4000
 
 #ifdef DEBUG
 extern int ST_DEBUG;
@@ -64,6 +66,8 @@ void st_debug_init( void );
 
 void st_enable_debug_output(struct st_context *st, boolean enable);
 
+void st_print_atom_stats(struct st_context *st);
+
 static inline void
 ST_DBG( unsigned flag, const char *fmt, ... )
 {
@@ -62,6 +62,7 @@
 #include "util/u_prim.h"
 #include "util/u_draw.h"
 #include "util/u_upload_mgr.h"
+#include "util/u_phase.h"
 #include "draw/draw_context.h"
 #include "cso_cache/cso_context.h"
 
@@ -194,6 +195,7 @@ st_draw_vbo(struct gl_context *ctx,
    struct pipe_draw_info info;
    const struct gl_client_array **arrays = ctx->Array._DrawArrays;
    unsigned i;
+   int64_t phase_start;
 
    /* Mesa core state should have been validated already */
    assert(ctx->NewState == 0x0);
@@ -254,6 +256,8 @@ st_draw_vbo(struct gl_context *ctx,
 
    assert(!indirect);
 
+   phase_start = util_phase_begin();
+
    /* do actual drawing */
    for (i = 0; i < nr_prims; i++) {
       info.mode = translate_prim(ctx, prims[i].mode);
@@ -289,6 +293,8 @@ st_draw_vbo(struct gl_context *ctx,
       }
    }
 
+   util_phase_end(UTIL_PHASE_DRAW, phase_start);
+
    if (ib && st->indexbuf_uploader && !_mesa_is_bufferobj(ib->obj)) {
       pipe_resource_reference(&ibuffer.buffer, NULL);
    }
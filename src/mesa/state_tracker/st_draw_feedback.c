@@ -26,6 +26,7 @@
  **************************************************************************/
 
 #include "main/imports.h"
+#include "main/errors.h"
 #include "main/image.h"
 #include "main/macros.h"
 
@@ -149,6 +150,12 @@ st_feedback_draw_vbo(struct gl_context *ctx,
    vp = st->vp;
    vs = &st->vp_variant->tgsi;
 
+   /* The draw module only runs TGSI. */
+   if (vs->type == PIPE_SHADER_IR_NIR) {
+      _mesa_problem(ctx, "feedback/select not supported with NIR shaders");
+      return;
+   }
+
    if (!st->vp_variant->draw_shader) {
       st->vp_variant->draw_shader = draw_create_vertex_shader(draw, vs);
    }
@@ -34,6 +34,7 @@
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_math.h"
 
 #include "st_context.h"
@@ -1005,6 +1006,12 @@ void st_init_extensions(struct pipe_screen *screen,
    consts->MinMapBufferAlignment =
       screen->get_param(screen, PIPE_CAP_MIN_MAP_BUFFER_ALIGNMENT);
 
+   /* Texture transfers are plain CPU mappings, so large format conversions
+    * in _mesa_texstore() can be split across a few threads.
+    */
+   util_cpu_detect();
+   consts->MaxTexStoreThreads = MIN2(util_cpu_caps.nr_cpus, 4);
+
    if (extensions->ARB_texture_buffer_object) {
       consts->MaxTextureBufferSize =
          _min(screen->get_param(screen, PIPE_CAP_MAX_TEXTURE_BUFFER_SIZE),
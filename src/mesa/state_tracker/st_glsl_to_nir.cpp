@@ -0,0 +1,393 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Link-time half of the GLSL -> NIR path: the counterpart of
+ * get_mesa_program() in st_glsl_to_tgsi.cpp for drivers whose preferred IR
+ * is NIR.  Shaders using anything the TGSI-shaped NIR interface can't
+ * express return NULL here and take the TGSI path.
+ */
+
+#include "st_nir.h"
+
+#include "compiler/glsl/glsl_parser_extras.h"
+#include "compiler/glsl/ir.h"
+#include "compiler/glsl/ir_optimization.h"
+#include "compiler/glsl_types.h"
+#include "compiler/nir/nir.h"
+#include "compiler/nir/glsl_to_nir.h"
+
+#include "main/errors.h"
+#include "main/shaderapi.h"
+#include "main/uniforms.h"
+#include "program/ir_to_mesa.h"
+#include "program/prog_instruction.h"
+#include "program/prog_parameter.h"
+#include "program/program.h"
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+
+#include "st_context.h"
+#include "st_debug.h"
+#include "st_program.h"
+
+
+extern "C" int
+st_glsl_type_size(const struct glsl_type *type)
+{
+   return type->count_attribute_slots(false);
+}
+
+
+/**
+ * Whether the driver wants NIR for this stage and the shader only uses
+ * features the NIR path handles.
+ */
+static bool
+st_nir_can_translate(struct gl_context *ctx,
+                     struct gl_shader_program *shader_program,
+                     struct gl_shader *shader)
+{
+   struct pipe_screen *screen = st_context(ctx)->pipe->screen;
+   unsigned ptarget = st_shader_stage_to_ptarget(shader->Stage);
+
+   if (shader->Stage != MESA_SHADER_VERTEX &&
+       shader->Stage != MESA_SHADER_FRAGMENT)
+      return false;
+
+   if (!screen->get_compiler_options ||
+       screen->get_shader_param(screen, ptarget,
+                                PIPE_SHADER_CAP_PREFERRED_IR) !=
+       PIPE_SHADER_IR_NIR)
+      return false;
+
+   /* The driver interface mirrors TGSI with native integers and
+    * gl_FragCoord as an input.
+    */
+   if (!ctx->Const.NativeIntegers || ctx->Const.GLSLFragCoordIsSysVal)
+      return false;
+
+   /* Only the y-flip is done here, see st_nir_lower_fs_io(). */
+   if (shader->Stage == MESA_SHADER_FRAGMENT &&
+       (!screen->get_param(screen, PIPE_CAP_TGSI_FS_COORD_ORIGIN_UPPER_LEFT) ||
+        !screen->get_param(screen,
+                           PIPE_CAP_TGSI_FS_COORD_PIXEL_CENTER_HALF_INTEGER)))
+      return false;
+
+   if (shader->NumUniformBlocks || shader->NumShaderStorageBlocks ||
+       shader->NumAtomicBuffers || shader->NumImages)
+      return false;
+
+   if (shader->Stage == MESA_SHADER_VERTEX &&
+       (shader_program->TransformFeedback.NumVarying ||
+        shader_program->Vert.ClipDistanceArraySize))
+      return false;
+
+   foreach_in_list(ir_instruction, node, shader->ir) {
+      ir_variable *var = node->as_variable();
+
+      if (!var)
+         continue;
+
+      switch (var->data.mode) {
+      case ir_var_uniform:
+         /* Built-in structures are made of state slots, user ones would
+          * need a parameter lookup per field.
+          */
+         if (var->type->contains_double() ||
+             (var->type->without_array()->is_record() &&
+              !var->get_state_slots()))
+            return false;
+         break;
+      case ir_var_shader_in:
+      case ir_var_shader_out:
+         if (var->type->contains_double() || var->data.location_frac)
+            return false;
+         break;
+      default:
+         break;
+      }
+   }
+
+   return true;
+}
+
+
+/**
+ * Whether values of a state slot are laid out the way load_uniform reads
+ * them: the leading components in order, possibly followed by a repeat of
+ * the last one (see _mesa_add_state_reference() users in ir_to_mesa).
+ */
+static bool
+st_nir_state_swizzle_is_direct(unsigned swizzle)
+{
+   unsigned last = GET_SWZ(swizzle, 0);
+   bool repeating = false;
+
+   if (last != SWIZZLE_X)
+      return false;
+
+   for (unsigned i = 1; i < 4; i++) {
+      unsigned swz = GET_SWZ(swizzle, i);
+
+      if (swz == last) {
+         repeating = true;
+      } else if (!repeating && swz == i) {
+         last = swz;
+      } else {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+
+/**
+ * Point the uniform variables at their parameters.  Sampler uniforms are
+ * dropped, nir_lower_samplers() has turned them into texture indices.
+ */
+static bool
+st_nir_assign_uniform_locations(struct gl_program *prog, nir_shader *nir)
+{
+   struct gl_program_parameter_list *params = prog->Parameters;
+
+   foreach_list_typed_safe(nir_variable, var, node, &nir->uniforms) {
+      int loc;
+
+      if (var->type->without_array()->is_sampler()) {
+         exec_node_remove(&var->node);
+         continue;
+      }
+
+      if (var->state_slots) {
+         /* Built-in uniforms aren't in the list yet. */
+         loc = -1;
+         for (unsigned i = 0; i < var->num_state_slots; i++) {
+            int index = _mesa_add_state_reference(params,
+                           (gl_state_index *) var->state_slots[i].tokens);
+
+            if (i == 0)
+               loc = index;
+            else if (index != loc + (int) i)
+               return false;
+
+            if (!st_nir_state_swizzle_is_direct(var->state_slots[i].swizzle))
+               return false;
+         }
+      } else {
+         loc = _mesa_lookup_parameter_index(params, var->name);
+      }
+
+      if (loc < 0)
+         return false;
+
+      var->data.driver_location = loc;
+   }
+
+   return true;
+}
+
+
+static void
+st_nir_opts(nir_shader *nir)
+{
+   bool progress;
+
+   /* The driver runs its own optimization loop on the final shader; this
+    * only removes what the lowering above leaves behind.
+    */
+   do {
+      progress = false;
+
+      NIR_PASS(progress, nir, nir_copy_prop);
+      NIR_PASS(progress, nir, nir_opt_remove_phis);
+      NIR_PASS(progress, nir, nir_opt_dce);
+      NIR_PASS(progress, nir, nir_opt_constant_folding);
+   } while (progress);
+}
+
+
+static unsigned
+st_nir_num_functions(nir_shader *nir)
+{
+   unsigned count = 0;
+
+   nir_foreach_function(nir, function) {
+      if (function->impl)
+         count++;
+   }
+   return count;
+}
+
+
+/**
+ * Build the gl_program for a linked shader as NIR.  Returns NULL, leaving
+ * the shader untouched, if the TGSI path has to be used instead.
+ */
+struct gl_program *
+st_nir_get_mesa_program(struct gl_context *ctx,
+                        struct gl_shader_program *shader_program,
+                        struct gl_shader *shader)
+{
+   struct pipe_screen *screen = st_context(ctx)->pipe->screen;
+   unsigned ptarget = st_shader_stage_to_ptarget(shader->Stage);
+   GLenum target = _mesa_shader_stage_to_program(shader->Stage);
+   const nir_shader_compiler_options *options;
+   struct gl_program *prog;
+   nir_shader *nir;
+
+   if (!st_nir_can_translate(ctx, shader_program, shader))
+      return NULL;
+
+   options = (const nir_shader_compiler_options *)
+      screen->get_compiler_options(screen, PIPE_SHADER_IR_NIR, ptarget);
+   if (!options)
+      return NULL;
+
+   prog = ctx->Driver.NewProgram(ctx, target, shader_program->Name);
+   if (!prog)
+      return NULL;
+   prog->Parameters = _mesa_new_parameter_list();
+
+   _mesa_copy_linked_program_data(shader->Stage, shader_program, prog);
+   _mesa_generate_parameters_list_for_uniforms(shader_program, shader,
+                                               prog->Parameters);
+
+   do_set_program_inouts(shader->ir, prog, shader->Stage);
+   prog->SamplersUsed = shader->active_samplers;
+   prog->ShadowSamplers = shader->shadow_samplers;
+   _mesa_update_shader_textures_used(shader_program, prog);
+
+   if (shader->Stage == MESA_SHADER_VERTEX) {
+      if (prog->DoubleInputsRead)
+         goto fallback;
+   } else {
+      struct gl_fragment_program *fp = (struct gl_fragment_program *) prog;
+
+      fp->FragDepthLayout = shader_program->FragDepthLayout;
+
+      /* This must be done before the uniform storage is associated. */
+      if (prog->InputsRead & VARYING_BIT_POS) {
+         static const gl_state_index wposTransformState[STATE_LENGTH] = {
+            STATE_INTERNAL, STATE_FB_WPOS_Y_TRANSFORM
+         };
+
+         _mesa_add_state_reference(prog->Parameters, wposTransformState);
+      }
+   }
+
+   /* glsl_to_nir() takes the program info from shader->Program. */
+   _mesa_reference_program(ctx, &shader->Program, prog);
+
+   nir = glsl_to_nir(shader_program, shader->Stage, options);
+
+   if (shader->Stage == MESA_SHADER_FRAGMENT) {
+      struct gl_fragment_program *fp = (struct gl_fragment_program *) prog;
+
+      nir_foreach_variable(var, &nir->inputs) {
+         if (var->data.location == VARYING_SLOT_POS) {
+            fp->OriginUpperLeft = var->data.origin_upper_left;
+            fp->PixelCenterInteger = var->data.pixel_center_integer;
+         }
+      }
+   }
+
+   NIR_PASS_V(nir, nir_split_var_copies);
+   NIR_PASS_V(nir, nir_lower_var_copies);
+   NIR_PASS_V(nir, nir_lower_global_vars_to_local);
+   NIR_PASS_V(nir, nir_lower_returns);
+   NIR_PASS_V(nir, nir_inline_functions);
+   NIR_PASS_V(nir, nir_lower_system_values);
+   NIR_PASS_V(nir, nir_lower_samplers, shader_program);
+
+   /* TGSI-shaped inputs, outputs and temporaries are never indirect. */
+   NIR_PASS_V(nir, nir_lower_indirect_derefs,
+              (1 << nir_var_shader_in) | (1 << nir_var_shader_out) |
+              (1 << nir_var_local));
+   NIR_PASS_V(nir, nir_lower_vars_to_ssa);
+   NIR_PASS_V(nir, nir_remove_dead_variables);
+
+   if (st_nir_num_functions(nir) != 1 ||
+       !st_nir_assign_uniform_locations(prog, nir)) {
+      ralloc_free(nir);
+      goto fallback;
+   }
+
+   NIR_PASS_V(nir, st_nir_lower_uniforms);
+   st_nir_opts(nir);
+
+   if (ctx->_Shader->Flags & GLSL_DUMP) {
+      _mesa_log("\n");
+      _mesa_log("NIR for linked %s program %d:\n",
+                _mesa_shader_stage_to_string(shader->Stage),
+                shader_program->Name);
+      nir_print_shader(nir, _mesa_get_log_file());
+      _mesa_log("\n\n");
+   }
+
+   prog->Instructions = NULL;
+   prog->NumInstructions = 0;
+
+   /* The GLSL IR won't be needed anymore. */
+   ralloc_free(shader->ir);
+   shader->ir = NULL;
+
+   /* Avoid reallocation of the program parameter list, because the uniform
+    * storage is only associated with the original parameter list.
+    * This should be enough for Bitmap and DrawPixels constants.
+    */
+   _mesa_reserve_parameter_storage(prog->Parameters, 8);
+
+   /* This has to be done last.  Any operation the can cause
+    * prog->ParameterValues to get reallocated (e.g., anything that adds a
+    * program constant) has to happen before creating this linkage.
+    */
+   _mesa_associate_uniform_storage(ctx, shader_program, prog->Parameters);
+   if (!shader_program->LinkStatus) {
+      ralloc_free(nir);
+      _mesa_reference_program(ctx, &shader->Program, NULL);
+      _mesa_reference_program(ctx, &prog, NULL);
+      return NULL;
+   }
+
+   if (shader->Stage == MESA_SHADER_VERTEX) {
+      struct st_vertex_program *stvp = (struct st_vertex_program *) prog;
+
+      stvp->tgsi.type = PIPE_SHADER_IR_NIR;
+      stvp->tgsi.nir = nir;
+   } else {
+      struct st_fragment_program *stfp = (struct st_fragment_program *) prog;
+
+      stfp->tgsi.type = PIPE_SHADER_IR_NIR;
+      stfp->tgsi.nir = nir;
+   }
+
+   ST_DBG(DEBUG_MESA, "st: %s program %u translated with glsl_to_nir\n",
+          _mesa_shader_stage_to_string(shader->Stage), prog->Id);
+   return prog;
+
+fallback:
+   _mesa_reference_program(ctx, &shader->Program, NULL);
+   _mesa_reference_program(ctx, &prog, NULL);
+   return NULL;
+}
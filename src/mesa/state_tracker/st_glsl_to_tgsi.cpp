@@ -51,6 +51,7 @@
 #include "util/u_memory.h"
 #include "st_program.h"
 #include "st_mesa_to_tgsi.h"
+#include "st_nir.h"
 #include "st_format.h"
 
 
@@ -359,8 +360,9 @@ find_array_type(struct array_decl *arrays, unsigned count, unsigned array_id)
    return GLSL_TYPE_ERROR;
 }
 
+/* Indexed by the old register index. */
 struct rename_reg_pair {
-   int old_reg;
+   bool valid;
    int new_reg;
 };
 
@@ -531,7 +533,7 @@ public:
 
    void simplify_cmp(void);
 
-   void rename_temp_registers(int num_renames, struct rename_reg_pair *renames);
+   void rename_temp_registers(struct rename_reg_pair *renames);
    void get_first_temp_read(int *first_reads);
    void get_last_temp_read_first_temp_write(int *last_reads, int *first_writes);
    void get_last_temp_write(int *last_writes);
@@ -4489,32 +4491,31 @@ glsl_to_tgsi_visitor::simplify_cmp(void)
    free(tempWrites);
 }
 
-/* Replaces all references to a temporary register index with another index. */
+/* Replaces all references to a temporary register index with another index.
+ * renames has one entry per temporary register.
+ */
 void
-glsl_to_tgsi_visitor::rename_temp_registers(int num_renames, struct rename_reg_pair *renames)
+glsl_to_tgsi_visitor::rename_temp_registers(struct rename_reg_pair *renames)
 {
    foreach_in_list(glsl_to_tgsi_instruction, inst, &this->instructions) {
       unsigned j;
-      int k;
       for (j = 0; j < num_inst_src_regs(inst); j++) {
-         if (inst->src[j].file == PROGRAM_TEMPORARY)
-            for (k = 0; k < num_renames; k++)
-               if (inst->src[j].index == renames[k].old_reg)
-                  inst->src[j].index = renames[k].new_reg;
+         if (inst->src[j].file == PROGRAM_TEMPORARY &&
+             renames[inst->src[j].index].valid)
+            inst->src[j].index = renames[inst->src[j].index].new_reg;
       }
 
       for (j = 0; j < inst->tex_offset_num_offset; j++) {
-         if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY)
-            for (k = 0; k < num_renames; k++)
-               if (inst->tex_offsets[j].index == renames[k].old_reg)
-                  inst->tex_offsets[j].index = renames[k].new_reg;
+         if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY &&
+             renames[inst->tex_offsets[j].index].valid)
+            inst->tex_offsets[j].index =
+               renames[inst->tex_offsets[j].index].new_reg;
       }
 
       for (j = 0; j < num_inst_dst_regs(inst); j++) {
-         if (inst->dst[j].file == PROGRAM_TEMPORARY)
-             for (k = 0; k < num_renames; k++)
-                if (inst->dst[j].index == renames[k].old_reg)
-                   inst->dst[j].index = renames[k].new_reg;
+         if (inst->dst[j].file == PROGRAM_TEMPORARY &&
+             renames[inst->dst[j].index].valid)
+            inst->dst[j].index = renames[inst->dst[j].index].new_reg;
       }
    }
 }
@@ -4551,28 +4552,58 @@ glsl_to_tgsi_visitor::get_first_temp_read(int *first_reads)
    }
 }
 
+/* Records an access to temporary register index at instruction i.  Inside
+ * loops the access is marked with -2 and the register remembered in
+ * loop_temps, so the outermost ENDLOOP can resolve it without looking at
+ * every temporary.
+ */
+static inline void
+record_temp_access(int *last, int index, int depth, int i,
+                   int *loop_temps, int *num_loop_temps)
+{
+   if (depth == 0) {
+      last[index] = i;
+   } else if (last[index] != -2) {
+      last[index] = -2;
+      loop_temps[(*num_loop_temps)++] = index;
+   }
+}
+
+static inline void
+resolve_loop_temps(int *last, int i, int *loop_temps, int *num_loop_temps)
+{
+   for (int k = 0; k < *num_loop_temps; k++)
+      last[loop_temps[k]] = i;
+   *num_loop_temps = 0;
+}
+
 void
 glsl_to_tgsi_visitor::get_last_temp_read_first_temp_write(int *last_reads, int *first_writes)
 {
    int depth = 0; /* loop depth */
    int loop_start = -1; /* index of the first active BGNLOOP (if any) */
    unsigned i = 0, j;
-   int k;
+   int *loop_temps = ralloc_array(mem_ctx, int, this->next_temp);
+   int num_loop_temps = 0;
+
    foreach_in_list(glsl_to_tgsi_instruction, inst, &this->instructions) {
       for (j = 0; j < num_inst_src_regs(inst); j++) {
          if (inst->src[j].file == PROGRAM_TEMPORARY)
-            last_reads[inst->src[j].index] = (depth == 0) ? i : -2;
+            record_temp_access(last_reads, inst->src[j].index, depth, i,
+                               loop_temps, &num_loop_temps);
       }
       for (j = 0; j < num_inst_dst_regs(inst); j++) {
          if (inst->dst[j].file == PROGRAM_TEMPORARY) {
             if (first_writes[inst->dst[j].index] == -1)
                first_writes[inst->dst[j].index] = (depth == 0) ? i : loop_start;
-            last_reads[inst->dst[j].index] = (depth == 0) ? i : -2;
+            record_temp_access(last_reads, inst->dst[j].index, depth, i,
+                               loop_temps, &num_loop_temps);
          }
       }
       for (j = 0; j < inst->tex_offset_num_offset; j++) {
          if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY)
-            last_reads[inst->tex_offsets[j].index] = (depth == 0) ? i : -2;
+            record_temp_access(last_reads, inst->tex_offsets[j].index, depth,
+                               i, loop_temps, &num_loop_temps);
       }
       if (inst->op == TGSI_OPCODE_BGNLOOP) {
          if(depth++ == 0)
@@ -4580,44 +4611,42 @@ glsl_to_tgsi_visitor::get_last_temp_read_first_temp_write(int *last_reads, int *
       } else if (inst->op == TGSI_OPCODE_ENDLOOP) {
          if (--depth == 0) {
             loop_start = -1;
-            for (k = 0; k < this->next_temp; k++) {
-               if (last_reads[k] == -2) {
-                  last_reads[k] = i;
-               }
-            }
+            resolve_loop_temps(last_reads, i, loop_temps, &num_loop_temps);
          }
       }
       assert(depth >= 0);
       i++;
    }
+
+   ralloc_free(loop_temps);
 }
 
 void
 glsl_to_tgsi_visitor::get_last_temp_write(int *last_writes)
 {
    int depth = 0; /* loop depth */
-   int i = 0, k;
+   int i = 0;
    unsigned j;
+   int *loop_temps = ralloc_array(mem_ctx, int, this->next_temp);
+   int num_loop_temps = 0;
 
    foreach_in_list(glsl_to_tgsi_instruction, inst, &this->instructions) {
       for (j = 0; j < num_inst_dst_regs(inst); j++) {
          if (inst->dst[j].file == PROGRAM_TEMPORARY)
-            last_writes[inst->dst[j].index] = (depth == 0) ? i : -2;
+            record_temp_access(last_writes, inst->dst[j].index, depth, i,
+                               loop_temps, &num_loop_temps);
       }
 
       if (inst->op == TGSI_OPCODE_BGNLOOP)
          depth++;
       else if (inst->op == TGSI_OPCODE_ENDLOOP)
-         if (--depth == 0) {
-            for (k = 0; k < this->next_temp; k++) {
-               if (last_writes[k] == -2) {
-                  last_writes[k] = i;
-               }
-            }
-         }
+         if (--depth == 0)
+            resolve_loop_temps(last_writes, i, loop_temps, &num_loop_temps);
       assert(depth >= 0);
       i++;
    }
+
+   ralloc_free(loop_temps);
 }
 
 /*
@@ -4639,7 +4668,90 @@ glsl_to_tgsi_visitor::get_last_temp_write(int *last_writes)
  * 2: TXP TEMP[2], INPUT[4].xyyw, texture[0], 2D;
  *
  * which allows for dead code elimination on TEMP[1]'s writes.
+ *
+ * Besides the ACP itself, the entries are kept in lists by the register
+ * they copy from, by the if-nesting level they were added at, and in one
+ * list of everything added since the ACP was last emptied, so that writes
+ * and the ends of blocks only visit the entries they can affect.
  */
+struct acp_list_node {
+   glsl_to_tgsi_instruction *inst;
+   int slot;
+   int next;
+};
+
+struct acp_lists {
+   /* Node 0 terminates the lists. */
+   struct acp_list_node *nodes;
+   int num_nodes;
+
+   int *temp_users;
+   int *output_users;
+   int num_outputs;
+   int *level;
+   int all;
+};
+
+static void
+acp_list_push(struct acp_lists *lists, int *head,
+              glsl_to_tgsi_instruction *inst, int slot)
+{
+   int n = lists->num_nodes++;
+
+   lists->nodes[n].inst = inst;
+   lists->nodes[n].slot = slot;
+   lists->nodes[n].next = *head;
+   *head = n;
+}
+
+/* Nodes whose ACP slot has been overwritten or cleared since are stale. */
+static inline bool
+acp_node_is_live(glsl_to_tgsi_instruction **acp,
+                 const struct acp_list_node *node)
+{
+   return acp[node->slot] == node->inst;
+}
+
+/* Clears the live entries of a list from the ACP and empties it. */
+static void
+acp_clear_list(glsl_to_tgsi_instruction **acp, struct acp_lists *lists,
+               int *head)
+{
+   for (int n = *head; n; n = lists->nodes[n].next) {
+      if (acp_node_is_live(acp, &lists->nodes[n]))
+         acp[lists->nodes[n].slot] = NULL;
+   }
+   *head = 0;
+}
+
+/* Clears the entries copying from a register the instruction writes,
+ * dropping stale nodes on the way.
+ */
+static void
+acp_clear_users(glsl_to_tgsi_instruction **acp, struct acp_lists *lists,
+                int *head, const st_dst_reg *dst)
+{
+   int *link = head;
+
+   while (*link) {
+      struct acp_list_node *node = &lists->nodes[*link];
+
+      if (acp_node_is_live(acp, node)) {
+         int src_chan = GET_SWZ(node->inst->src[0].swizzle, node->slot % 4);
+
+         assert(node->inst->src[0].file == dst->file &&
+                node->inst->src[0].index == dst->index);
+
+         if (!(dst->writemask & (1 << src_chan))) {
+            link = &node->next;
+            continue;
+         }
+         acp[node->slot] = NULL;
+      }
+      *link = node->next;
+   }
+}
+
 void
 glsl_to_tgsi_visitor::copy_propagate(void)
 {
@@ -4648,6 +4760,26 @@ glsl_to_tgsi_visitor::copy_propagate(void)
                                                   this->next_temp * 4);
    int *acp_level = rzalloc_array(mem_ctx, int, this->next_temp * 4);
    int level = 0;
+   struct acp_lists lists;
+   int num_insts = 0, num_ifs = 0;
+
+   lists.num_outputs = 0;
+   foreach_in_list(glsl_to_tgsi_instruction, inst, &this->instructions) {
+      num_insts++;
+      if (inst->op == TGSI_OPCODE_IF || inst->op == TGSI_OPCODE_UIF)
+         num_ifs++;
+      if (inst->op == TGSI_OPCODE_MOV && inst->src[0].file == PROGRAM_OUTPUT)
+         lists.num_outputs = MAX2(lists.num_outputs, inst->src[0].index + 1);
+   }
+
+   /* Each copied channel goes in at most three lists. */
+   lists.nodes = ralloc_array(mem_ctx, struct acp_list_node,
+                              1 + 12 * num_insts);
+   lists.num_nodes = 1;
+   lists.temp_users = rzalloc_array(mem_ctx, int, this->next_temp);
+   lists.output_users = rzalloc_array(mem_ctx, int, lists.num_outputs);
+   lists.level = rzalloc_array(mem_ctx, int, num_ifs + 1);
+   lists.all = 0;
 
    foreach_in_list(glsl_to_tgsi_instruction, inst, &this->instructions) {
       assert(inst->dst[0].file != PROGRAM_TEMPORARY
@@ -4717,7 +4849,7 @@ glsl_to_tgsi_visitor::copy_propagate(void)
       case TGSI_OPCODE_BGNLOOP:
       case TGSI_OPCODE_ENDLOOP:
          /* End of a basic block, clear the ACP entirely. */
-         memset(acp, 0, sizeof(*acp) * this->next_temp * 4);
+         acp_clear_list(acp, &lists, &lists.all);
          break;
 
       case TGSI_OPCODE_IF:
@@ -4728,17 +4860,10 @@ glsl_to_tgsi_visitor::copy_propagate(void)
       case TGSI_OPCODE_ENDIF:
       case TGSI_OPCODE_ELSE:
          /* Clear all channels written inside the block from the ACP, but
-          * leaving those that were not touched.
+          * leaving those that were not touched.  Entries of deeper levels
+          * were cleared at their own ENDIF already.
           */
-         for (int r = 0; r < this->next_temp; r++) {
-            for (int c = 0; c < 4; c++) {
-               if (!acp[4 * r + c])
-                  continue;
-
-               if (acp_level[4 * r + c] >= level)
-                  acp[4 * r + c] = NULL;
-            }
-         }
+         acp_clear_list(acp, &lists, &lists.level[level]);
          if (inst->op == TGSI_OPCODE_ENDIF)
             --level;
          break;
@@ -4752,21 +4877,14 @@ glsl_to_tgsi_visitor::copy_propagate(void)
                /* Any temporary might be written, so no copy propagation
                 * across this instruction.
                 */
-               memset(acp, 0, sizeof(*acp) * this->next_temp * 4);
+               acp_clear_list(acp, &lists, &lists.all);
             } else if (inst->dst[d].file == PROGRAM_OUTPUT &&
                        inst->dst[d].reladdr) {
                /* Any output might be written, so no copy propagation
                 * from outputs across this instruction.
                 */
-               for (int r = 0; r < this->next_temp; r++) {
-                  for (int c = 0; c < 4; c++) {
-                     if (!acp[4 * r + c])
-                        continue;
-
-                     if (acp[4 * r + c]->src[0].file == PROGRAM_OUTPUT)
-                        acp[4 * r + c] = NULL;
-                  }
-               }
+               for (int r = 0; r < lists.num_outputs; r++)
+                  acp_clear_list(acp, &lists, &lists.output_users[r]);
             } else if (inst->dst[d].file == PROGRAM_TEMPORARY ||
                        inst->dst[d].file == PROGRAM_OUTPUT) {
                /* Clear where it's used as dst. */
@@ -4778,19 +4896,14 @@ glsl_to_tgsi_visitor::copy_propagate(void)
                }
 
                /* Clear where it's used as src. */
-               for (int r = 0; r < this->next_temp; r++) {
-                  for (int c = 0; c < 4; c++) {
-                     if (!acp[4 * r + c])
-                        continue;
-
-                     int src_chan = GET_SWZ(acp[4 * r + c]->src[0].swizzle, c);
-
-                     if (acp[4 * r + c]->src[0].file == inst->dst[d].file &&
-                         acp[4 * r + c]->src[0].index == inst->dst[d].index &&
-                         inst->dst[d].writemask & (1 << src_chan)) {
-                        acp[4 * r + c] = NULL;
-                     }
-                  }
+               if (inst->dst[d].file == PROGRAM_TEMPORARY) {
+                  acp_clear_users(acp, &lists,
+                                  &lists.temp_users[inst->dst[d].index],
+                                  &inst->dst[d]);
+               } else if (inst->dst[d].index < lists.num_outputs) {
+                  acp_clear_users(acp, &lists,
+                                  &lists.output_users[inst->dst[d].index],
+                                  &inst->dst[d]);
                }
             }
          }
@@ -4809,15 +4922,33 @@ glsl_to_tgsi_visitor::copy_propagate(void)
           !inst->src[0].reladdr &&
           !inst->src[0].reladdr2 &&
           !inst->src[0].negate) {
+         int *users = NULL;
+
+         if (inst->src[0].file == PROGRAM_TEMPORARY)
+            users = &lists.temp_users[inst->src[0].index];
+         else if (inst->src[0].file == PROGRAM_OUTPUT)
+            users = &lists.output_users[inst->src[0].index];
+
          for (int i = 0; i < 4; i++) {
             if (inst->dst[0].writemask & (1 << i)) {
-               acp[4 * inst->dst[0].index + i] = inst;
-               acp_level[4 * inst->dst[0].index + i] = level;
+               int slot = 4 * inst->dst[0].index + i;
+
+               acp[slot] = inst;
+               acp_level[slot] = level;
+
+               acp_list_push(&lists, &lists.all, inst, slot);
+               acp_list_push(&lists, &lists.level[level], inst, slot);
+               if (users)
+                  acp_list_push(&lists, users, inst, slot);
             }
          }
       }
    }
 
+   ralloc_free(lists.level);
+   ralloc_free(lists.output_users);
+   ralloc_free(lists.temp_users);
+   ralloc_free(lists.nodes);
    ralloc_free(acp_level);
    ralloc_free(acp);
 }
@@ -5040,19 +5171,78 @@ glsl_to_tgsi_visitor::merge_two_dsts(void)
    }
 }
 
+struct temp_live_range {
+   int first_write;
+   int last_read;
+   int index;
+};
+
+static int
+compare_live_range_start(const void *a, const void *b)
+{
+   const struct temp_live_range *ra = (const struct temp_live_range *) a;
+   const struct temp_live_range *rb = (const struct temp_live_range *) b;
+
+   if (ra->first_write != rb->first_write)
+      return ra->first_write - rb->first_write;
+   return ra->index - rb->index;
+}
+
+/* Min-heap of merged registers keyed by the end of their live range. */
+static void
+live_range_heap_sift_down(struct temp_live_range *heap, int size, int i)
+{
+   for (;;) {
+      int smallest = i;
+      int l = 2 * i + 1, r = 2 * i + 2;
+
+      if (l < size && heap[l].last_read < heap[smallest].last_read)
+         smallest = l;
+      if (r < size && heap[r].last_read < heap[smallest].last_read)
+         smallest = r;
+      if (smallest == i)
+         return;
+
+      struct temp_live_range tmp = heap[i];
+      heap[i] = heap[smallest];
+      heap[smallest] = tmp;
+      i = smallest;
+   }
+}
+
+static void
+live_range_heap_push(struct temp_live_range *heap, int *size,
+                     const struct temp_live_range *range)
+{
+   int i = (*size)++;
+
+   while (i > 0 && heap[(i - 1) / 2].last_read > range->last_read) {
+      heap[i] = heap[(i - 1) / 2];
+      i = (i - 1) / 2;
+   }
+   heap[i] = *range;
+}
+
 /* Merges temporary registers together where possible to reduce the number of
  * registers needed to run a program.
  *
+ * The live ranges are visited in order of their first write, and each one is
+ * merged into the register whose live range ended first, if that was before
+ * (or at) the write.  This is interval scheduling, so it needs as few
+ * registers as the ranges allow in O(n log n).
+ *
  * Produces optimal code only after copy propagation and dead code elimination
  * have been run. */
 void
 glsl_to_tgsi_visitor::merge_registers(void)
 {
-   int *last_reads = rzalloc_array(mem_ctx, int, this->next_temp);
-   int *first_writes = rzalloc_array(mem_ctx, int, this->next_temp);
+   int *last_reads = ralloc_array(mem_ctx, int, this->next_temp);
+   int *first_writes = ralloc_array(mem_ctx, int, this->next_temp);
    struct rename_reg_pair *renames = rzalloc_array(mem_ctx, struct rename_reg_pair, this->next_temp);
-   int i, j;
-   int num_renames = 0;
+   struct temp_live_range *ranges = ralloc_array(mem_ctx, struct temp_live_range, this->next_temp);
+   struct temp_live_range *heap = ralloc_array(mem_ctx, struct temp_live_range, this->next_temp);
+   int num_ranges = 0, heap_size = 0;
+   int i;
 
    /* Read the indices of the last read and first write to each temp register
     * into an array so that we don't have to traverse the instruction list as
@@ -5063,38 +5253,37 @@ glsl_to_tgsi_visitor::merge_registers(void)
    }
    get_last_temp_read_first_temp_write(last_reads, first_writes);
 
-   /* Start looking for registers with non-overlapping usages that can be
-    * merged together. */
    for (i = 0; i < this->next_temp; i++) {
       /* Don't touch unused registers. */
       if (last_reads[i] < 0 || first_writes[i] < 0) continue;
 
-      for (j = 0; j < this->next_temp; j++) {
-         /* Don't touch unused registers. */
-         if (last_reads[j] < 0 || first_writes[j] < 0) continue;
-
-         /* We can merge the two registers if the first write to j is after or
-          * in the same instruction as the last read from i.  Note that the
-          * register at index i will always be used earlier or at the same time
-          * as the register at index j. */
-         if (first_writes[i] <= first_writes[j] &&
-             last_reads[i] <= first_writes[j]) {
-            renames[num_renames].old_reg = j;
-            renames[num_renames].new_reg = i;
-            num_renames++;
-
-            /* Update the first_writes and last_reads arrays with the new
-             * values for the merged register index, and mark the newly unused
-             * register index as such. */
-            assert(last_reads[j] >= last_reads[i]);
-            last_reads[i] = last_reads[j];
-            first_writes[j] = -1;
-            last_reads[j] = -1;
-         }
+      ranges[num_ranges].first_write = first_writes[i];
+      ranges[num_ranges].last_read = last_reads[i];
+      ranges[num_ranges].index = i;
+      num_ranges++;
+   }
+
+   qsort(ranges, num_ranges, sizeof(*ranges), compare_live_range_start);
+
+   for (i = 0; i < num_ranges; i++) {
+      /* We can merge the two registers if the first write to this one is
+       * after or in the same instruction as the last read from the other.
+       */
+      if (heap_size && heap[0].last_read <= ranges[i].first_write) {
+         assert(ranges[i].last_read >= heap[0].last_read);
+         renames[ranges[i].index].valid = true;
+         renames[ranges[i].index].new_reg = heap[0].index;
+
+         heap[0].last_read = ranges[i].last_read;
+         live_range_heap_sift_down(heap, heap_size, 0);
+      } else {
+         live_range_heap_push(heap, &heap_size, &ranges[i]);
       }
    }
 
-   rename_temp_registers(num_renames, renames);
+   rename_temp_registers(renames);
+   ralloc_free(heap);
+   ralloc_free(ranges);
    ralloc_free(renames);
    ralloc_free(last_reads);
    ralloc_free(first_writes);
@@ -5109,7 +5298,6 @@ glsl_to_tgsi_visitor::renumber_registers(void)
    int new_index = 0;
    int *first_reads = rzalloc_array(mem_ctx, int, this->next_temp);
    struct rename_reg_pair *renames = rzalloc_array(mem_ctx, struct rename_reg_pair, this->next_temp);
-   int num_renames = 0;
    for (i = 0; i < this->next_temp; i++) {
       first_reads[i] = -1;
    }
@@ -5118,14 +5306,13 @@ glsl_to_tgsi_visitor::renumber_registers(void)
    for (i = 0; i < this->next_temp; i++) {
       if (first_reads[i] < 0) continue;
       if (i != new_index) {
-         renames[num_renames].old_reg = i;
-         renames[num_renames].new_reg = new_index;
-         num_renames++;
+         renames[i].valid = true;
+         renames[i].new_reg = new_index;
       }
       new_index++;
    }
 
-   rename_temp_registers(num_renames, renames);
+   rename_temp_registers(renames);
    this->next_temp = new_index;
    ralloc_free(renames);
    ralloc_free(first_reads);
@@ -6819,7 +7006,10 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
       if (prog->_LinkedShaders[i] == NULL)
          continue;
 
-      linked_prog = get_mesa_program(ctx, prog, prog->_LinkedShaders[i]);
+      linked_prog = st_nir_get_mesa_program(ctx, prog,
+                                            prog->_LinkedShaders[i]);
+      if (!linked_prog)
+         linked_prog = get_mesa_program(ctx, prog, prog->_LinkedShaders[i]);
 
       if (linked_prog) {
          _mesa_reference_program(ctx, &prog->_LinkedShaders[i]->Program,
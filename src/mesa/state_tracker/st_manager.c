@@ -56,6 +56,12 @@
 #include "util/u_inlines.h"
 #include "util/u_atomic.h"
 #include "util/u_surface.h"
+#include "util/u_threaded_context.h"
+#include "util/u_debug.h"
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(gallium_thread, "GALLIUM_THREAD", FALSE)
+
 
 /**
  * Cast wrapper to convert a struct gl_framebuffer to an st_framebuffer.
@@ -669,6 +675,9 @@ st_api_create_context(struct st_api *stapi, struct st_manager *smapi,
       return NULL;
    }
 
+   if (debug_get_option_gallium_thread())
+      pipe = threaded_context_create(pipe);
+
    st_visual_to_context_mode(&attribs->visual, &mode);
    st = st_create_context(api, pipe, &mode, shared_ctx, &attribs->options);
    if (!st) {
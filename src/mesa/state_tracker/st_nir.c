@@ -0,0 +1,874 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Translation-time and variant-time lowering of the NIR built by
+ * st_nir_get_mesa_program().  The TGSI path does the same things while
+ * translating registers (st_translate_program) or with tgsi_transform
+ * (tgsi_emulate, st_get_bitmap_shader, st_get_drawpix_shader).
+ */
+
+#include "main/imports.h"
+#include "main/mtypes.h"
+#include "program/prog_parameter.h"
+#include "program/prog_statevars.h"
+
+#include "pipe/p_defines.h"
+#include "pipe/p_shader_tokens.h"
+
+#include "compiler/nir/nir.h"
+#include "compiler/nir/nir_builder.h"
+
+#include "st_context.h"
+#include "st_nir.h"
+#include "st_program.h"
+
+
+static nir_function_impl *
+st_nir_main_impl(nir_shader *nir)
+{
+   nir_foreach_function(nir, function) {
+      if (function->impl)
+         return function->impl;
+   }
+   assert(!"NIR shader without main()");
+   return NULL;
+}
+
+
+/**
+ * The inverse of the semantic assignment in st_translate_vertex_program()
+ * and st_translate_fragment_program(), i.e. the variable location
+ * tgsi_to_nir would give a register with this semantic.
+ */
+static gl_varying_slot
+st_nir_semantic_to_slot(unsigned name, unsigned index)
+{
+   switch (name) {
+   case TGSI_SEMANTIC_POSITION:
+      return VARYING_SLOT_POS;
+   case TGSI_SEMANTIC_COLOR:
+      return index ? VARYING_SLOT_COL1 : VARYING_SLOT_COL0;
+   case TGSI_SEMANTIC_BCOLOR:
+      return index ? VARYING_SLOT_BFC1 : VARYING_SLOT_BFC0;
+   case TGSI_SEMANTIC_FOG:
+      return VARYING_SLOT_FOGC;
+   case TGSI_SEMANTIC_PSIZE:
+      return VARYING_SLOT_PSIZ;
+   case TGSI_SEMANTIC_FACE:
+      return VARYING_SLOT_FACE;
+   case TGSI_SEMANTIC_EDGEFLAG:
+      return VARYING_SLOT_EDGE;
+   case TGSI_SEMANTIC_PRIMID:
+      return VARYING_SLOT_PRIMITIVE_ID;
+   case TGSI_SEMANTIC_CLIPDIST:
+      return index ? VARYING_SLOT_CLIP_DIST1 : VARYING_SLOT_CLIP_DIST0;
+   case TGSI_SEMANTIC_CLIPVERTEX:
+      return VARYING_SLOT_CLIP_VERTEX;
+   case TGSI_SEMANTIC_TEXCOORD:
+      return VARYING_SLOT_TEX0 + index;
+   case TGSI_SEMANTIC_PCOORD:
+      return VARYING_SLOT_PNTC;
+   case TGSI_SEMANTIC_VIEWPORT_INDEX:
+      return VARYING_SLOT_VIEWPORT;
+   case TGSI_SEMANTIC_LAYER:
+      return VARYING_SLOT_LAYER;
+   case TGSI_SEMANTIC_GENERIC:
+   default:
+      assert(name == TGSI_SEMANTIC_GENERIC);
+      return VARYING_SLOT_VAR0 + index;
+   }
+}
+
+
+static nir_ssa_def *
+st_nir_load_input(nir_builder *b, unsigned index)
+{
+   nir_intrinsic_instr *load =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_load_input);
+
+   load->num_components = 4;
+   nir_intrinsic_set_base(load, index);
+   load->src[0] = nir_src_for_ssa(nir_imm_int(b, 0));
+   nir_ssa_dest_init(&load->instr, &load->dest, 4, 32, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+
+   return &load->dest.ssa;
+}
+
+
+static nir_ssa_def *
+st_nir_load_uniform(nir_builder *b, unsigned index, nir_ssa_def *offset)
+{
+   nir_intrinsic_instr *load =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_load_uniform);
+
+   load->num_components = 4;
+   nir_intrinsic_set_base(load, index);
+   load->src[0] = nir_src_for_ssa(offset ? offset : nir_imm_int(b, 0));
+   nir_ssa_dest_init(&load->instr, &load->dest, 4, 32, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+
+   return &load->dest.ssa;
+}
+
+
+static void
+st_nir_store_output(nir_builder *b, unsigned index, nir_ssa_def *value)
+{
+   nir_intrinsic_instr *store =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_store_output);
+
+   assert(value->num_components == 4);
+   store->num_components = 4;
+   nir_intrinsic_set_base(store, index);
+   nir_intrinsic_set_write_mask(store, 0xf);
+   store->src[0] = nir_src_for_ssa(value);
+   store->src[1] = nir_src_for_ssa(nir_imm_int(b, 0));
+   nir_builder_instr_insert(b, &store->instr);
+}
+
+
+/** Return the first \p num_components channels of a vec4. */
+static nir_ssa_def *
+st_nir_narrow(nir_builder *b, nir_ssa_def *vec4, unsigned num_components)
+{
+   static unsigned swiz[4] = { 0, 1, 2, 3 };
+
+   if (num_components == 4)
+      return vec4;
+   return nir_swizzle(b, vec4, swiz, num_components, false);
+}
+
+
+/**
+ * Place the channels of \p value at \p first_chan of a vec4 and fill the
+ * rest with zeros.
+ */
+static nir_ssa_def *
+st_nir_widen(nir_builder *b, nir_ssa_def *value, unsigned first_chan)
+{
+   nir_ssa_def *chans[4];
+   unsigned i;
+
+   if (value->num_components == 4 && first_chan == 0)
+      return value;
+
+   for (i = 0; i < 4; i++) {
+      if (i >= first_chan && i < first_chan + value->num_components)
+         chans[i] = nir_channel(b, value, i - first_chan);
+      else
+         chans[i] = nir_imm_float(b, 0.0f);
+   }
+   return nir_vec(b, chans, 4);
+}
+
+
+static unsigned
+st_nir_const_offset(nir_intrinsic_instr *intr)
+{
+   nir_const_value *offset = nir_src_as_const_value(*nir_get_io_offset_src(intr));
+
+   /* Indirect input and output access was lowered at link time. */
+   assert(offset);
+   return offset ? offset->u32[0] : 0;
+}
+
+
+struct st_nir_io_state {
+   nir_builder b;
+
+   /* VERT_ATTRIB_x/VARYING_SLOT_x/FRAG_RESULT_x -> register index */
+   const GLuint *input_map;
+   const GLuint *output_map;
+
+   /* for the fragment shader */
+   int wpos_transform_const;
+   bool wpos_invert;
+   GLfloat wpos_adjX, wpos_adjY[2];
+};
+
+
+/**
+ * Apply the pixel center adjustment and the y-flip of
+ * STATE_FB_WPOS_Y_TRANSFORM to the fragment position, as emit_wpos() does.
+ */
+static nir_ssa_def *
+st_nir_transform_wpos(struct st_nir_io_state *state, nir_ssa_def *wpos)
+{
+   nir_builder *b = &state->b;
+   nir_ssa_def *wpostrans =
+      st_nir_load_uniform(b, state->wpos_transform_const, NULL);
+   const unsigned flip = state->wpos_invert ? 0 : 2;
+   nir_ssa_def *x = nir_channel(b, wpos, 0);
+   nir_ssa_def *y = nir_channel(b, wpos, 1);
+   nir_ssa_def *chans[4];
+
+   if (state->wpos_adjX)
+      x = nir_fadd(b, x, nir_imm_float(b, state->wpos_adjX));
+
+   if (state->wpos_adjY[0] != state->wpos_adjY[1]) {
+      /* The adjustment depends on whether the y-flip is actually applied,
+       * which is the case when the scale is negative.
+       */
+      nir_ssa_def *adj =
+         nir_bcsel(b, nir_flt(b, nir_channel(b, wpostrans, state->wpos_invert ? 2 : 0),
+                              nir_imm_float(b, 0.0f)),
+                   nir_imm_float(b, state->wpos_adjY[0]),
+                   nir_imm_float(b, state->wpos_adjY[1]));
+      y = nir_fadd(b, y, adj);
+   } else if (state->wpos_adjY[0]) {
+      y = nir_fadd(b, y, nir_imm_float(b, state->wpos_adjY[0]));
+   }
+
+   chans[0] = x;
+   chans[1] = nir_fadd(b, nir_fmul(b, y, nir_channel(b, wpostrans, flip)),
+                       nir_channel(b, wpostrans, flip + 1));
+   chans[2] = nir_channel(b, wpos, 2);
+   chans[3] = nir_channel(b, wpos, 3);
+   return nir_vec(b, chans, 4);
+}
+
+
+static void
+st_nir_lower_io_intrinsic(struct st_nir_io_state *state,
+                          nir_intrinsic_instr *intr)
+{
+   nir_builder *b = &state->b;
+   gl_shader_stage stage = b->shader->stage;
+   nir_ssa_def *def;
+   unsigned slot;
+
+   b->cursor = nir_before_instr(&intr->instr);
+
+   switch (intr->intrinsic) {
+   case nir_intrinsic_load_input:
+      slot = nir_intrinsic_base(intr) + st_nir_const_offset(intr);
+      def = st_nir_load_input(b, state->input_map[slot]);
+      if (stage == MESA_SHADER_FRAGMENT && slot == VARYING_SLOT_POS)
+         def = st_nir_transform_wpos(state, def);
+      def = st_nir_narrow(b, def, intr->num_components);
+      nir_ssa_def_rewrite_uses(&intr->dest.ssa, nir_src_for_ssa(def));
+      break;
+
+   case nir_intrinsic_load_front_face:
+      /* TGSI_SEMANTIC_FACE is +1 for front-facing, -1 for back-facing. */
+      def = st_nir_load_input(b, state->input_map[VARYING_SLOT_FACE]);
+      def = nir_fge(b, nir_channel(b, def, 0), nir_imm_float(b, 0.0f));
+      nir_ssa_def_rewrite_uses(&intr->dest.ssa, nir_src_for_ssa(def));
+      break;
+
+   case nir_intrinsic_store_output: {
+      unsigned first_chan = 0;
+
+      slot = nir_intrinsic_base(intr) + st_nir_const_offset(intr);
+      assert(intr->src[0].is_ssa);
+
+      /* TGSI carries these in a single channel of the output register. */
+      if (stage == MESA_SHADER_FRAGMENT) {
+         if (slot == FRAG_RESULT_DEPTH)
+            first_chan = 2;
+         else if (slot == FRAG_RESULT_STENCIL)
+            first_chan = 1;
+      }
+
+      def = st_nir_widen(b, intr->src[0].ssa, first_chan);
+      st_nir_store_output(b, state->output_map[slot], def);
+      break;
+   }
+
+   default:
+      return;
+   }
+
+   nir_instr_remove(&intr->instr);
+}
+
+
+static bool
+st_nir_lower_io_block(nir_block *block, void *data)
+{
+   struct st_nir_io_state *state = (struct st_nir_io_state *) data;
+
+   nir_foreach_instr_safe(block, instr) {
+      if (instr->type == nir_instr_type_intrinsic)
+         st_nir_lower_io_intrinsic(state, nir_instr_as_intrinsic(instr));
+   }
+
+   return true;
+}
+
+
+/**
+ * Lower GLSL inputs and outputs to intrinsics indexed like the TGSI
+ * registers the TGSI path would declare.
+ */
+static void
+st_nir_lower_io_to_registers(struct st_nir_io_state *state, nir_shader *nir)
+{
+   nir_function_impl *impl = st_nir_main_impl(nir);
+
+   /* Until now the variables are located by Mesa slot. */
+   nir_foreach_variable(var, &nir->inputs)
+      var->data.driver_location = var->data.location;
+   nir_foreach_variable(var, &nir->outputs)
+      var->data.driver_location = var->data.location;
+
+   nir_lower_io(nir, nir_var_shader_in, st_glsl_type_size);
+   nir_lower_io(nir, nir_var_shader_out, st_glsl_type_size);
+   nir_opt_constant_folding(nir);
+
+   nir_builder_init(&state->b, impl);
+   nir_foreach_block(impl, st_nir_lower_io_block, state);
+   nir_metadata_preserve(impl, nir_metadata_block_index |
+                               nir_metadata_dominance);
+
+   nir_opt_dce(nir);
+
+   exec_list_make_empty(&nir->inputs);
+   exec_list_make_empty(&nir->outputs);
+}
+
+
+static bool
+st_nir_lower_uniforms_block(nir_block *block, void *data)
+{
+   nir_builder *b = (nir_builder *) data;
+
+   nir_foreach_instr_safe(block, instr) {
+      nir_intrinsic_instr *intr;
+      nir_ssa_def *def;
+
+      if (instr->type != nir_instr_type_intrinsic)
+         continue;
+
+      intr = nir_instr_as_intrinsic(instr);
+      if (intr->intrinsic != nir_intrinsic_load_uniform ||
+          intr->num_components == 4)
+         continue;
+
+      b->cursor = nir_before_instr(instr);
+      assert(intr->src[0].is_ssa);
+      def = st_nir_load_uniform(b, nir_intrinsic_base(intr), intr->src[0].ssa);
+      def = st_nir_narrow(b, def, intr->num_components);
+      nir_ssa_def_rewrite_uses(&intr->dest.ssa, nir_src_for_ssa(def));
+      nir_instr_remove(instr);
+   }
+
+   return true;
+}
+
+
+/**
+ * Lower uniform variables, whose driver_location is their index in the
+ * parameter list, to vec4 load_uniform intrinsics and leave one vec4 (array)
+ * variable per uniform, like tgsi_to_nir does for CONST declarations.
+ */
+void
+st_nir_lower_uniforms(nir_shader *nir)
+{
+   nir_function_impl *impl = st_nir_main_impl(nir);
+   struct exec_list uniforms;
+   nir_builder b;
+
+   nir_lower_io(nir, nir_var_uniform, st_glsl_type_size);
+
+   nir_builder_init(&b, impl);
+   nir_foreach_block(impl, st_nir_lower_uniforms_block, &b);
+   nir_metadata_preserve(impl, nir_metadata_block_index |
+                               nir_metadata_dominance);
+
+   exec_list_move_nodes_to(&nir->uniforms, &uniforms);
+
+   foreach_list_typed(nir_variable, old, node, &uniforms) {
+      const int size = st_glsl_type_size(old->type);
+      nir_variable *var =
+         nir_variable_create(nir, nir_var_uniform,
+                             size > 1 ? glsl_array_type(glsl_vec4_type(), size)
+                                      : glsl_vec4_type(),
+                             old->name);
+
+      var->data.driver_location = old->data.driver_location;
+   }
+}
+
+
+static nir_variable *
+st_nir_add_register(nir_shader *nir, nir_variable_mode mode,
+                    unsigned index, int location)
+{
+   nir_variable *var =
+      nir_variable_create(nir, mode, glsl_vec4_type(), NULL);
+
+   var->name = ralloc_asprintf(var, mode == nir_var_shader_in ?
+                               "in_%u" : "out_%u", index);
+   var->data.driver_location = index;
+   var->data.location = location;
+   if (mode == nir_var_shader_in)
+      var->data.read_only = true;
+
+   return var;
+}
+
+
+void
+st_nir_lower_vs_io(struct st_context *st, struct st_vertex_program *stvp,
+                   const GLuint input_to_index[],
+                   GLuint num_outputs,
+                   const ubyte output_semantic_name[],
+                   const ubyte output_semantic_index[])
+{
+   nir_shader *nir = stvp->tgsi.nir;
+   struct st_nir_io_state state;
+   unsigned i;
+
+   (void) st;
+
+   memset(&state, 0, sizeof(state));
+   state.input_map = input_to_index;
+   state.output_map = stvp->result_to_output;
+   st_nir_lower_io_to_registers(&state, nir);
+
+   for (i = 0; i < stvp->num_inputs; i++)
+      st_nir_add_register(nir, nir_var_shader_in, i, VERT_ATTRIB_GENERIC0 + i);
+
+   for (i = 0; i < num_outputs; i++) {
+      st_nir_add_register(nir, nir_var_shader_out, i,
+                          st_nir_semantic_to_slot(output_semantic_name[i],
+                                                  output_semantic_index[i]));
+   }
+
+   nir->num_inputs = stvp->num_inputs;
+   nir->num_outputs = num_outputs;
+}
+
+
+void
+st_nir_lower_fs_io(struct st_context *st, struct st_fragment_program *stfp,
+                   const GLuint inputMapping[],
+                   GLuint num_inputs,
+                   const ubyte input_semantic_name[],
+                   const ubyte input_semantic_index[],
+                   const GLuint interpMode[],
+                   const GLuint interpLocation[],
+                   const GLuint outputMapping[],
+                   GLuint num_outputs,
+                   const ubyte output_semantic_name[],
+                   const ubyte output_semantic_index[],
+                   boolean write_all)
+{
+   nir_shader *nir = stfp->tgsi.nir;
+   struct st_nir_io_state state;
+   unsigned i;
+
+   memset(&state, 0, sizeof(state));
+   state.input_map = inputMapping;
+   state.output_map = outputMapping;
+
+   if (stfp->Base.Base.InputsRead & VARYING_BIT_POS) {
+      static const gl_state_index wposTransformState[STATE_LENGTH] = {
+         STATE_INTERNAL, STATE_FB_WPOS_Y_TRANSFORM
+      };
+
+      /* This was added at link time, so it won't grow the list. */
+      state.wpos_transform_const =
+         _mesa_add_state_reference(stfp->Base.Base.Parameters,
+                                   wposTransformState);
+
+      /* The link step only chooses this path for drivers with an upper-left
+       * origin and half-integer pixel centers, see emit_wpos().
+       */
+      state.wpos_invert = !stfp->Base.OriginUpperLeft;
+      if (stfp->Base.PixelCenterInteger) {
+         state.wpos_adjX = -0.5f;
+         state.wpos_adjY[0] = -0.5f;
+         state.wpos_adjY[1] = 0.5f;
+      }
+   }
+
+   st_nir_lower_io_to_registers(&state, nir);
+
+   for (i = 0; i < num_inputs; i++) {
+      nir_variable *var =
+         st_nir_add_register(nir, nir_var_shader_in, i,
+                             st_nir_semantic_to_slot(input_semantic_name[i],
+                                                     input_semantic_index[i]));
+
+      switch (interpMode[i]) {
+      case TGSI_INTERPOLATE_CONSTANT:
+         var->data.interpolation = INTERP_QUALIFIER_FLAT;
+         break;
+      case TGSI_INTERPOLATE_LINEAR:
+         var->data.interpolation = INTERP_QUALIFIER_NOPERSPECTIVE;
+         break;
+      case TGSI_INTERPOLATE_PERSPECTIVE:
+         var->data.interpolation = INTERP_QUALIFIER_SMOOTH;
+         break;
+      }
+
+      var->data.centroid = interpLocation[i] == TGSI_INTERPOLATE_LOC_CENTROID;
+      var->data.sample = interpLocation[i] == TGSI_INTERPOLATE_LOC_SAMPLE;
+   }
+
+   for (i = 0; i < num_outputs; i++) {
+      int location;
+
+      switch (output_semantic_name[i]) {
+      case TGSI_SEMANTIC_POSITION:
+         location = FRAG_RESULT_DEPTH;
+         break;
+      case TGSI_SEMANTIC_STENCIL:
+         location = FRAG_RESULT_STENCIL;
+         break;
+      case TGSI_SEMANTIC_SAMPLEMASK:
+         location = FRAG_RESULT_SAMPLE_MASK;
+         break;
+      case TGSI_SEMANTIC_COLOR:
+      default:
+         assert(output_semantic_name[i] == TGSI_SEMANTIC_COLOR);
+         location = write_all ? FRAG_RESULT_COLOR :
+                                FRAG_RESULT_DATA0 + output_semantic_index[i];
+         break;
+      }
+
+      st_nir_add_register(nir, nir_var_shader_out, i, location);
+   }
+
+   nir->num_inputs = num_inputs;
+   nir->num_outputs = num_outputs;
+
+   (void) st;
+}
+
+
+static nir_variable *
+st_nir_find_register(struct exec_list *list, unsigned index)
+{
+   nir_foreach_variable(var, list) {
+      if (var->data.driver_location == index)
+         return var;
+   }
+   return NULL;
+}
+
+
+static nir_variable *
+st_nir_find_input_slot(nir_shader *nir, int location)
+{
+   nir_foreach_variable(var, &nir->inputs) {
+      if (var->data.location == location)
+         return var;
+   }
+   return NULL;
+}
+
+
+/** Find the texcoord input used by glBitmap/glDrawPixels, declare if needed */
+static nir_variable *
+st_nir_get_texcoord_input(nir_shader *nir, bool use_texcoord)
+{
+   const int location = use_texcoord ? VARYING_SLOT_TEX0 : VARYING_SLOT_VAR0;
+   nir_variable *var = st_nir_find_input_slot(nir, location);
+
+   if (!var) {
+      var = st_nir_add_register(nir, nir_var_shader_in, nir->num_inputs++,
+                                location);
+      var->data.interpolation = INTERP_QUALIFIER_SMOOTH;
+   }
+   return var;
+}
+
+
+static nir_ssa_def *
+st_nir_tex(nir_builder *b, nir_ssa_def *coord, unsigned sampler_index,
+           unsigned tex_target)
+{
+   nir_tex_instr *tex = nir_tex_instr_create(b->shader, 1);
+
+   tex->op = nir_texop_tex;
+   tex->sampler_dim = tex_target == PIPE_TEXTURE_RECT ?
+                      GLSL_SAMPLER_DIM_RECT : GLSL_SAMPLER_DIM_2D;
+   tex->dest_type = nir_type_float;
+   tex->coord_components = 2;
+   tex->texture_index = sampler_index;
+   tex->sampler_index = sampler_index;
+   tex->src[0].src_type = nir_tex_src_coord;
+   tex->src[0].src = nir_src_for_ssa(st_nir_narrow(b, coord, 2));
+   nir_ssa_dest_init(&tex->instr, &tex->dest, 4, 32, NULL);
+   nir_builder_instr_insert(b, &tex->instr);
+
+   return &tex->dest.ssa;
+}
+
+
+static bool
+st_nir_clamp_color_block(nir_block *block, void *data)
+{
+   nir_builder *b = (nir_builder *) data;
+
+   nir_foreach_instr(block, instr) {
+      nir_intrinsic_instr *intr;
+      nir_variable *var;
+      bool is_color;
+
+      if (instr->type != nir_instr_type_intrinsic)
+         continue;
+
+      intr = nir_instr_as_intrinsic(instr);
+      if (intr->intrinsic != nir_intrinsic_store_output)
+         continue;
+
+      var = st_nir_find_register(&b->shader->outputs, nir_intrinsic_base(intr));
+      assert(var);
+
+      if (b->shader->stage == MESA_SHADER_FRAGMENT) {
+         is_color = var->data.location == FRAG_RESULT_COLOR ||
+                    var->data.location >= FRAG_RESULT_DATA0;
+      } else {
+         is_color = var->data.location == VARYING_SLOT_COL0 ||
+                    var->data.location == VARYING_SLOT_COL1 ||
+                    var->data.location == VARYING_SLOT_BFC0 ||
+                    var->data.location == VARYING_SLOT_BFC1;
+      }
+
+      if (!is_color)
+         continue;
+
+      b->cursor = nir_before_instr(instr);
+      nir_instr_rewrite_src(instr, &intr->src[0],
+                            nir_src_for_ssa(nir_fsat(b, intr->src[0].ssa)));
+   }
+
+   return true;
+}
+
+
+/** NIR version of TGSI_EMU_CLAMP_COLOR_OUTPUTS */
+void
+st_nir_lower_clamp_color(nir_shader *nir)
+{
+   nir_function_impl *impl = st_nir_main_impl(nir);
+   nir_builder b;
+
+   nir_builder_init(&b, impl);
+   nir_foreach_block(impl, st_nir_clamp_color_block, &b);
+   nir_metadata_preserve(impl, nir_metadata_block_index |
+                               nir_metadata_dominance);
+}
+
+
+/** NIR version of TGSI_EMU_FORCE_PERSAMPLE_INTERP */
+void
+st_nir_force_persample_interp(nir_shader *nir)
+{
+   nir_foreach_variable(var, &nir->inputs) {
+      var->data.centroid = false;
+      var->data.sample = true;
+   }
+}
+
+
+/** NIR version of TGSI_EMU_PASSTHROUGH_EDGEFLAG */
+void
+st_nir_passthrough_edgeflags(nir_shader *nir, unsigned input, unsigned output)
+{
+   nir_function_impl *impl = st_nir_main_impl(nir);
+   nir_builder b;
+
+   st_nir_add_register(nir, nir_var_shader_in, input,
+                       VERT_ATTRIB_GENERIC0 + input);
+   st_nir_add_register(nir, nir_var_shader_out, output, VARYING_SLOT_EDGE);
+   nir->num_inputs = MAX2(nir->num_inputs, input + 1);
+   nir->num_outputs = MAX2(nir->num_outputs, output + 1);
+
+   nir_builder_init(&b, impl);
+   b.cursor = nir_after_cf_list(&impl->body);
+   st_nir_store_output(&b, output, st_nir_load_input(&b, input));
+   nir_metadata_preserve(impl, nir_metadata_block_index |
+                               nir_metadata_dominance);
+}
+
+
+/**
+ * NIR version of st_get_bitmap_shader(): sample the bitmap at the start of
+ * the shader and kill the fragment where it is set.
+ */
+void
+st_nir_lower_bitmap(nir_shader *nir,
+                    unsigned tex_target, unsigned sampler_index,
+                    bool use_texcoord, bool swizzle_xxxx)
+{
+   nir_function_impl *impl = st_nir_main_impl(nir);
+   nir_variable *texcoord = st_nir_get_texcoord_input(nir, use_texcoord);
+   nir_intrinsic_instr *discard;
+   nir_ssa_def *texel, *cond;
+   nir_builder b;
+   unsigned i;
+
+   assert(tex_target == PIPE_TEXTURE_2D ||
+          tex_target == PIPE_TEXTURE_RECT);
+
+   nir_builder_init(&b, impl);
+   b.cursor = nir_before_cf_list(&impl->body);
+
+   texel = st_nir_tex(&b, st_nir_load_input(&b, texcoord->data.driver_location),
+                      sampler_index, tex_target);
+
+   /* texel=0 -> keep / texel!=0 -> discard */
+   cond = nir_flt(&b, nir_imm_float(&b, 0.0f), nir_channel(&b, texel, 0));
+   if (!swizzle_xxxx) {
+      for (i = 1; i < 4; i++) {
+         cond = nir_ior(&b, cond, nir_flt(&b, nir_imm_float(&b, 0.0f),
+                                          nir_channel(&b, texel, i)));
+      }
+   }
+
+   discard = nir_intrinsic_instr_create(nir, nir_intrinsic_discard_if);
+   discard->src[0] = nir_src_for_ssa(cond);
+   nir_builder_instr_insert(&b, &discard->instr);
+
+   nir->info.fs.uses_discard = true;
+   nir->info.num_textures = MAX2(nir->info.num_textures, sampler_index + 1);
+
+   nir_metadata_preserve(impl, nir_metadata_block_index |
+                               nir_metadata_dominance);
+}
+
+
+struct st_nir_drawpix_state {
+   nir_builder b;
+   nir_instr *prologue_load;
+   nir_ssa_def *color;
+   unsigned color_input;
+   unsigned texcoord_input;
+   unsigned texcoord_const;
+};
+
+
+static bool
+st_nir_drawpix_block(nir_block *block, void *data)
+{
+   struct st_nir_drawpix_state *state = (struct st_nir_drawpix_state *) data;
+   nir_builder *b = &state->b;
+
+   nir_foreach_instr_safe(block, instr) {
+      nir_intrinsic_instr *intr;
+      nir_ssa_def *def;
+      unsigned index;
+
+      if (instr->type != nir_instr_type_intrinsic ||
+          instr == state->prologue_load)
+         continue;
+
+      intr = nir_instr_as_intrinsic(instr);
+      if (intr->intrinsic != nir_intrinsic_load_input)
+         continue;
+
+      b->cursor = nir_before_instr(instr);
+
+      index = nir_intrinsic_base(intr);
+      if (index == state->color_input)
+         def = state->color;
+      else if (index == state->texcoord_input)
+         def = st_nir_load_uniform(b, state->texcoord_const, NULL);
+      else
+         continue;
+
+      def = st_nir_narrow(b, def, intr->num_components);
+      nir_ssa_def_rewrite_uses(&intr->dest.ssa, nir_src_for_ssa(def));
+      nir_instr_remove(instr);
+   }
+
+   return true;
+}
+
+
+/**
+ * NIR version of st_get_drawpix_shader(): fetch the color from the
+ * glDrawPixels texture, apply scale/bias and the pixel maps and use it in
+ * place of the color input.  The texcoord input is replaced by the current
+ * texcoord attribute.
+ */
+void
+st_nir_lower_drawpixels(nir_shader *nir, bool use_texcoord,
+                        bool scale_and_bias, unsigned scale_const,
+                        unsigned bias_const, bool pixel_maps,
+                        unsigned drawpix_sampler, unsigned pixelmap_sampler,
+                        unsigned texcoord_const, unsigned tex_target)
+{
+   nir_function_impl *impl = st_nir_main_impl(nir);
+   nir_variable *texcoord = st_nir_get_texcoord_input(nir, use_texcoord);
+   nir_variable *color_var = st_nir_find_input_slot(nir, VARYING_SLOT_COL0);
+   struct st_nir_drawpix_state state;
+   nir_builder *b = &state.b;
+   nir_ssa_def *coord, *color;
+
+   assert(tex_target == PIPE_TEXTURE_2D ||
+          tex_target == PIPE_TEXTURE_RECT);
+
+   memset(&state, 0, sizeof(state));
+   nir_builder_init(b, impl);
+   b->cursor = nir_before_cf_list(&impl->body);
+
+   /* Get initial pixel color from the texture. */
+   coord = st_nir_load_input(b, texcoord->data.driver_location);
+   color = st_nir_tex(b, coord, drawpix_sampler, tex_target);
+
+   /* Apply the scale and bias. */
+   if (scale_and_bias) {
+      color = nir_fadd(b, nir_fmul(b, color,
+                                   st_nir_load_uniform(b, scale_const, NULL)),
+                       st_nir_load_uniform(b, bias_const, NULL));
+   }
+
+   if (pixel_maps) {
+      static unsigned zw[4] = { 2, 3, 3, 3 };
+      nir_ssa_def *rg, *ba, *chans[4];
+
+      /* do four pixel map look-ups with two TEX instructions */
+      rg = st_nir_tex(b, color, pixelmap_sampler, PIPE_TEXTURE_2D);
+      ba = st_nir_tex(b, nir_swizzle(b, color, zw, 2, false),
+                      pixelmap_sampler, PIPE_TEXTURE_2D);
+
+      chans[0] = nir_channel(b, rg, 0);
+      chans[1] = nir_channel(b, rg, 1);
+      chans[2] = nir_channel(b, ba, 2);
+      chans[3] = nir_channel(b, ba, 3);
+      color = nir_vec(b, chans, 4);
+   }
+
+   /* Now "color" is used in place of the COLOR0 input and the
+    * texcoord_const uniform in place of the texcoord input.
+    */
+   state.prologue_load = coord->parent_instr;
+   state.color = color;
+   state.color_input = color_var ? color_var->data.driver_location : ~0u;
+   state.texcoord_input = texcoord->data.driver_location;
+   state.texcoord_const = texcoord_const;
+   nir_foreach_block(impl, st_nir_drawpix_block, &state);
+
+   nir->info.num_textures =
+      MAX3(nir->info.num_textures, drawpix_sampler + 1,
+           pixel_maps ? pixelmap_sampler + 1 : 0);
+
+   nir_metadata_preserve(impl, nir_metadata_block_index |
+                               nir_metadata_dominance);
+}
@@ -0,0 +1,111 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * GLSL -> NIR path for drivers which prefer NIR over TGSI
+ * (PIPE_SHADER_CAP_PREFERRED_IR == PIPE_SHADER_IR_NIR).
+ *
+ * The NIR handed to the driver is shaped like the output of tgsi_to_nir:
+ * vec4 load_input/store_output/load_uniform intrinsics with constant zero
+ * offsets, whose base is the TGSI register index the TGSI path would have
+ * used, and one vec4 variable per input/output register. Uniforms are
+ * indexed like the program's parameter list, i.e. constant buffer 0.
+ */
+
+#ifndef ST_NIR_H
+#define ST_NIR_H
+
+#include "main/glheader.h"
+#include "pipe/p_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct gl_context;
+struct gl_program;
+struct gl_shader;
+struct gl_shader_program;
+struct glsl_type;
+struct nir_shader;
+struct st_context;
+struct st_fragment_program;
+struct st_vertex_program;
+
+int
+st_glsl_type_size(const struct glsl_type *type);
+
+struct gl_program *
+st_nir_get_mesa_program(struct gl_context *ctx,
+                        struct gl_shader_program *shader_program,
+                        struct gl_shader *shader);
+
+void
+st_nir_lower_uniforms(struct nir_shader *nir);
+
+void
+st_nir_lower_vs_io(struct st_context *st, struct st_vertex_program *stvp,
+                   const GLuint input_to_index[],
+                   GLuint num_outputs,
+                   const ubyte output_semantic_name[],
+                   const ubyte output_semantic_index[]);
+
+void
+st_nir_lower_fs_io(struct st_context *st, struct st_fragment_program *stfp,
+                   const GLuint inputMapping[],
+                   GLuint num_inputs,
+                   const ubyte input_semantic_name[],
+                   const ubyte input_semantic_index[],
+                   const GLuint interpMode[],
+                   const GLuint interpLocation[],
+                   const GLuint outputMapping[],
+                   GLuint num_outputs,
+                   const ubyte output_semantic_name[],
+                   const ubyte output_semantic_index[],
+                   boolean write_all);
+
+void
+st_nir_lower_clamp_color(struct nir_shader *nir);
+
+void
+st_nir_force_persample_interp(struct nir_shader *nir);
+
+void
+st_nir_passthrough_edgeflags(struct nir_shader *nir,
+                             unsigned input, unsigned output);
+
+void
+st_nir_lower_bitmap(struct nir_shader *nir,
+                    unsigned tex_target, unsigned sampler_index,
+                    bool use_texcoord, bool swizzle_xxxx);
+
+void
+st_nir_lower_drawpixels(struct nir_shader *nir, bool use_texcoord,
+                        bool scale_and_bias, unsigned scale_const,
+                        unsigned bias_const, bool pixel_maps,
+                        unsigned drawpix_sampler, unsigned pixelmap_sampler,
+                        unsigned texcoord_const, unsigned tex_target);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ST_NIR_H */
@@ -38,6 +38,8 @@
 #include "program/prog_print.h"
 #include "program/programopt.h"
 
+#include "compiler/nir/nir.h"
+
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 #include "pipe/p_shader_tokens.h"
@@ -46,6 +48,7 @@
 #include "tgsi/tgsi_emulate.h"
 #include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_ureg.h"
+#include "util/u_phase.h"
 
 #include "st_debug.h"
 #include "st_cb_bitmap.h"
@@ -53,6 +56,7 @@
 #include "st_context.h"
 #include "st_program.h"
 #include "st_mesa_to_tgsi.h"
+#include "st_nir.h"
 #include "cso_cache/cso_context.h"
 
 
@@ -94,6 +98,7 @@ st_release_vp_variants( struct st_context *st,
    }
 
    stvp->variants = NULL;
+   stvp->num_variants = 0;
 
    if (stvp->tgsi.tokens) {
       tgsi_free_tokens(stvp->tgsi.tokens);
@@ -131,6 +136,7 @@ st_release_fp_variants(struct st_context *st, struct st_fragment_program *stfp)
    }
 
    stfp->variants = NULL;
+   stfp->num_variants = 0;
 
    if (stfp->tgsi.tokens) {
       ureg_free_tokens(stfp->tgsi.tokens);
@@ -355,6 +361,12 @@ st_translate_vertex_program(struct st_context *st,
    output_semantic_name[num_outputs] = TGSI_SEMANTIC_EDGEFLAG;
    output_semantic_index[num_outputs] = 0;
 
+   if (stvp->tgsi.type == PIPE_SHADER_IR_NIR) {
+      st_nir_lower_vs_io(st, stvp, input_to_index, num_outputs,
+                         output_semantic_name, output_semantic_index);
+      return true;
+   }
+
    if (!stvp->glsl_to_tgsi)
       _mesa_remove_output_reads(&stvp->Base.Base, PROGRAM_OUTPUT);
 
@@ -437,9 +449,37 @@ st_create_vp_variant(struct st_context *st,
    struct pipe_context *pipe = st->pipe;
 
    vpv->key = *key;
+   vpv->num_inputs = stvp->num_inputs;
+
+   if (stvp->tgsi.type == PIPE_SHADER_IR_NIR) {
+      nir_shader *nir = nir_shader_clone(NULL, stvp->tgsi.nir);
+
+      if (key->clamp_color)
+         st_nir_lower_clamp_color(nir);
+
+      if (key->passthrough_edgeflags) {
+         st_nir_passthrough_edgeflags(nir, stvp->num_inputs,
+                                      stvp->result_to_output[VARYING_SLOT_EDGE]);
+         vpv->num_inputs++;
+      }
+
+      nir->num_uniforms = stvp->Base.Base.Parameters->NumParameters;
+
+      if (ST_DEBUG & DEBUG_TGSI) {
+         nir_print_shader(nir, stderr);
+         debug_printf("\n");
+      }
+
+      /* The driver takes ownership of the NIR. */
+      vpv->tgsi.type = PIPE_SHADER_IR_NIR;
+      vpv->tgsi.nir = nir;
+      vpv->driver_shader = pipe->create_vs_state(pipe, &vpv->tgsi);
+      vpv->tgsi.nir = NULL;
+      return vpv;
+   }
+
    vpv->tgsi.tokens = tgsi_dup_tokens(stvp->tgsi.tokens);
    vpv->tgsi.stream_output = stvp->tgsi.stream_output;
-   vpv->num_inputs = stvp->num_inputs;
 
    /* Emulate features. */
    if (key->clamp_color || key->passthrough_edgeflags) {
@@ -478,25 +518,41 @@ st_get_vp_variant(struct st_context *st,
                   struct st_vertex_program *stvp,
                   const struct st_vp_variant_key *key)
 {
-   struct st_vp_variant *vpv;
+   struct st_vp_variant *vpv, **prevPtr;
+
+   /* The list is kept in most-recently-used order, so the common case of
+    * re-binding the same variant only compares the first entry.
+    */
+   vpv = stvp->variants;
+   if (vpv && memcmp(&vpv->key, key, sizeof(*key)) == 0)
+      return vpv;
 
    /* Search for existing variant */
-   for (vpv = stvp->variants; vpv; vpv = vpv->next) {
+   for (prevPtr = &stvp->variants; (vpv = *prevPtr); prevPtr = &vpv->next) {
       if (memcmp(&vpv->key, key, sizeof(*key)) == 0) {
+         /* unlink from list */
+         *prevPtr = vpv->next;
          break;
       }
    }
 
    if (!vpv) {
       /* create now */
+      int64_t phase_start = util_phase_begin();
       vpv = st_create_vp_variant(st, stvp, key);
-      if (vpv) {
-         /* insert into list */
-         vpv->next = stvp->variants;
-         stvp->variants = vpv;
-      }
+      util_phase_end(UTIL_PHASE_SHADER_COMPILE, phase_start);
+      if (!vpv)
+         return NULL;
+
+      stvp->num_variants++;
+      ST_DBG(DEBUG_VARIANTS, "st: vertex program %u: %u variants\n",
+             stvp->Base.Base.Id, stvp->num_variants);
    }
 
+   /* insert at head of list */
+   vpv->next = stvp->variants;
+   stvp->variants = vpv;
+
    return vpv;
 }
 
@@ -753,6 +809,16 @@ st_translate_fragment_program(struct st_context *st,
       }
    }
 
+   if (stfp->tgsi.type == PIPE_SHADER_IR_NIR) {
+      st_nir_lower_fs_io(st, stfp, inputMapping,
+                         fs_num_inputs, input_semantic_name,
+                         input_semantic_index, interpMode, interpLocation,
+                         outputMapping, fs_num_outputs,
+                         fs_output_semantic_name, fs_output_semantic_index,
+                         write_all);
+      return true;
+   }
+
    ureg = ureg_create_with_screen(TGSI_PROCESSOR_FRAGMENT, st->pipe->screen);
    if (ureg == NULL)
       return false;
@@ -833,6 +899,91 @@ st_translate_fragment_program(struct st_context *st,
    return stfp->tgsi.tokens != NULL;
 }
 
+/**
+ * The NIR counterpart of the TGSI variant code in st_create_fp_variant().
+ */
+static struct st_fp_variant *
+st_create_fp_variant_nir(struct st_context *st,
+                         struct st_fragment_program *stfp,
+                         const struct st_fp_variant_key *key,
+                         struct st_fp_variant *variant)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct pipe_shader_state state;
+   nir_shader *nir = nir_shader_clone(NULL, stfp->tgsi.nir);
+
+   if (key->clamp_color)
+      st_nir_lower_clamp_color(nir);
+
+   if (key->persample_shading)
+      st_nir_force_persample_interp(nir);
+
+   /* glBitmap */
+   if (key->bitmap) {
+      variant->bitmap_sampler = ffs(~stfp->Base.Base.SamplersUsed) - 1;
+
+      st_nir_lower_bitmap(nir, st->internal_target, variant->bitmap_sampler,
+                          st->needs_texcoord_semantic,
+                          st->bitmap.tex_format == PIPE_FORMAT_L8_UNORM);
+   }
+
+   /* glDrawPixels (color only) */
+   if (key->drawpixels) {
+      unsigned scale_const = 0, bias_const = 0, texcoord_const = 0;
+      struct gl_program_parameter_list *params = stfp->Base.Base.Parameters;
+
+      /* Find the first unused slot. */
+      variant->drawpix_sampler = ffs(~stfp->Base.Base.SamplersUsed) - 1;
+
+      if (key->pixelMaps) {
+         unsigned samplers_used = stfp->Base.Base.SamplersUsed |
+                                  (1 << variant->drawpix_sampler);
+
+         variant->pixelmap_sampler = ffs(~samplers_used) - 1;
+      }
+
+      if (key->scaleAndBias) {
+         static const gl_state_index scale_state[STATE_LENGTH] =
+            { STATE_INTERNAL, STATE_PT_SCALE };
+         static const gl_state_index bias_state[STATE_LENGTH] =
+            { STATE_INTERNAL, STATE_PT_BIAS };
+
+         scale_const = _mesa_add_state_reference(params, scale_state);
+         bias_const = _mesa_add_state_reference(params, bias_state);
+      }
+
+      {
+         static const gl_state_index state[STATE_LENGTH] =
+            { STATE_INTERNAL, STATE_CURRENT_ATTRIB, VERT_ATTRIB_TEX0 };
+
+         texcoord_const = _mesa_add_state_reference(params, state);
+      }
+
+      st_nir_lower_drawpixels(nir, st->needs_texcoord_semantic,
+                              key->scaleAndBias, scale_const, bias_const,
+                              key->pixelMaps, variant->drawpix_sampler,
+                              variant->pixelmap_sampler, texcoord_const,
+                              st->internal_target);
+   }
+
+   nir->num_uniforms = stfp->Base.Base.Parameters->NumParameters;
+
+   if (ST_DEBUG & DEBUG_TGSI) {
+      nir_print_shader(nir, stderr);
+      debug_printf("\n");
+   }
+
+   /* The driver takes ownership of the NIR. */
+   memset(&state, 0, sizeof(state));
+   state.type = PIPE_SHADER_IR_NIR;
+   state.nir = nir;
+
+   variant->driver_shader = pipe->create_fs_state(pipe, &state);
+   variant->key = *key;
+   return variant;
+}
+
+
 static struct st_fp_variant *
 st_create_fp_variant(struct st_context *st,
                      struct st_fragment_program *stfp,
@@ -845,6 +996,9 @@ st_create_fp_variant(struct st_context *st,
    if (!variant)
       return NULL;
 
+   if (stfp->tgsi.type == PIPE_SHADER_IR_NIR)
+      return st_create_fp_variant_nir(st, stfp, key, variant);
+
    tgsi.tokens = stfp->tgsi.tokens;
 
    assert(!(key->bitmap && key->drawpixels));
@@ -956,25 +1110,41 @@ st_get_fp_variant(struct st_context *st,
                   struct st_fragment_program *stfp,
                   const struct st_fp_variant_key *key)
 {
-   struct st_fp_variant *fpv;
+   struct st_fp_variant *fpv, **prevPtr;
+
+   /* The list is kept in most-recently-used order, so the common case of
+    * re-binding the same variant only compares the first entry.
+    */
+   fpv = stfp->variants;
+   if (fpv && memcmp(&fpv->key, key, sizeof(*key)) == 0)
+      return fpv;
 
    /* Search for existing variant */
-   for (fpv = stfp->variants; fpv; fpv = fpv->next) {
+   for (prevPtr = &stfp->variants; (fpv = *prevPtr); prevPtr = &fpv->next) {
       if (memcmp(&fpv->key, key, sizeof(*key)) == 0) {
+         /* unlink from list */
+         *prevPtr = fpv->next;
          break;
       }
    }
 
    if (!fpv) {
       /* create new */
+      int64_t phase_start = util_phase_begin();
       fpv = st_create_fp_variant(st, stfp, key);
-      if (fpv) {
-         /* insert into list */
-         fpv->next = stfp->variants;
-         stfp->variants = fpv;
-      }
+      util_phase_end(UTIL_PHASE_SHADER_COMPILE, phase_start);
+      if (!fpv)
+         return NULL;
+
+      stfp->num_variants++;
+      ST_DBG(DEBUG_VARIANTS, "st: fragment program %u: %u variants\n",
+             stfp->Base.Base.Id, stfp->num_variants);
    }
 
+   /* insert at head of list */
+   fpv->next = stfp->variants;
+   stfp->variants = fpv;
+
    return fpv;
 }
 
@@ -1509,6 +1679,7 @@ destroy_program_variants(struct st_context *st, struct gl_program *target)
                *prevPtr = next;
                /* destroy this variant */
                delete_vp_variant(st, vpv);
+               stvp->num_variants--;
             }
             else {
                prevPtr = &vpv->next;
@@ -1530,6 +1701,7 @@ destroy_program_variants(struct st_context *st, struct gl_program *target)
                *prevPtr = next;
                /* destroy this variant */
                delete_fp_variant(st, fpv);
+               stfp->num_variants--;
             }
             else {
                prevPtr = &fpv->next;
@@ -1673,7 +1845,8 @@ st_print_current_vertex_program(void)
 
       for (stv = stvp->variants; stv; stv = stv->next) {
          debug_printf("variant %p\n", stv);
-         tgsi_dump(stv->tgsi.tokens, 0);
+         if (stv->tgsi.tokens)
+            tgsi_dump(stv->tgsi.tokens, 0);
       }
    }
 }
@@ -101,6 +101,7 @@ struct st_fragment_program
    struct glsl_to_tgsi_visitor* glsl_to_tgsi;
 
    struct st_fp_variant *variants;
+   unsigned num_variants;
 };
 
 
@@ -167,6 +168,7 @@ struct st_vertex_program
    /** List of translated variants of this vertex program.
     */
    struct st_vp_variant *variants;
+   unsigned num_variants;
 };
 
 
@@ -463,6 +463,82 @@ st_texture_get_sampler_view(struct st_context *st,
 }
 
 
+static boolean
+sampler_view_matches(const struct pipe_sampler_view *sv,
+                     const struct pipe_sampler_view *templ)
+{
+   if (sv->target != templ->target ||
+       sv->format != templ->format ||
+       sv->swizzle_r != templ->swizzle_r ||
+       sv->swizzle_g != templ->swizzle_g ||
+       sv->swizzle_b != templ->swizzle_b ||
+       sv->swizzle_a != templ->swizzle_a)
+      return FALSE;
+
+   if (templ->target == PIPE_BUFFER)
+      return sv->u.buf.first_element == templ->u.buf.first_element &&
+             sv->u.buf.last_element == templ->u.buf.last_element;
+
+   return sv->u.tex.first_layer == templ->u.tex.first_layer &&
+          sv->u.tex.last_layer == templ->u.tex.last_layer &&
+          sv->u.tex.first_level == templ->u.tex.first_level &&
+          sv->u.tex.last_level == templ->u.tex.last_level;
+}
+
+
+/**
+ * Look for a sampler view of the calling context which matches the given
+ * template.  If there is one, *found is set and its slot is returned.
+ * Otherwise the returned slot is where a new view for the template should
+ * be stored; it may still hold the view it replaces, which the caller
+ * must release.
+ */
+struct pipe_sampler_view **
+st_texture_find_sampler_view(struct st_context *st,
+                             struct st_texture_object *stObj,
+                             const struct pipe_sampler_view *templ,
+                             boolean *found)
+{
+   struct pipe_sampler_view **free = NULL, **evict = NULL;
+   unsigned num_views = 0;
+   GLuint i;
+
+   for (i = 0; i < stObj->num_sampler_views; ++i) {
+      struct pipe_sampler_view **sv = &stObj->sampler_views[i];
+
+      if (!*sv) {
+         free = sv;
+      } else if ((*sv)->context == st->pipe) {
+         if (sampler_view_matches(*sv, templ)) {
+            *found = TRUE;
+            return sv;
+         }
+         if (!evict)
+            evict = sv;
+         num_views++;
+      }
+   }
+
+   *found = FALSE;
+
+   /* Don't let a context accumulate views without bound; recycle its
+    * first one instead.
+    */
+   if (num_views >= ST_MAX_SAMPLER_VIEWS_PER_CONTEXT)
+      return evict;
+
+   if (!free) {
+      GLuint old_size = stObj->num_sampler_views * sizeof(void *);
+      GLuint new_size = old_size + sizeof(void *);
+      stObj->sampler_views = REALLOC(stObj->sampler_views, old_size, new_size);
+      free = &stObj->sampler_views[stObj->num_sampler_views++];
+      *free = NULL;
+   }
+
+   return free;
+}
+
+
 /**
  * For the given texture object, release any sampler views which belong
  * to the calling context.
@@ -476,10 +552,8 @@ st_texture_release_sampler_view(struct st_context *st,
    for (i = 0; i < stObj->num_sampler_views; ++i) {
       struct pipe_sampler_view **sv = &stObj->sampler_views[i];
 
-      if (*sv && (*sv)->context == st->pipe) {
+      if (*sv && (*sv)->context == st->pipe)
          pipe_sampler_view_reference(sv, NULL);
-         break;
-      }
    }
 }
 
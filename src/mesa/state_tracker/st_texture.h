@@ -93,8 +93,10 @@ struct st_texture_object
    /* Number of views in sampler_views array */
    GLuint num_sampler_views;
 
-   /* Array of sampler views (one per context) attached to this texture
-    * object. Created lazily on first binding in context.
+   /* Array of sampler views attached to this texture object. Created
+    * lazily on first binding in context.  A context may have up to
+    * ST_MAX_SAMPLER_VIEWS_PER_CONTEXT views here, so that switching
+    * between e.g. sRGB decode or depth modes doesn't recreate them.
     */
    struct pipe_sampler_view **sampler_views;
 
@@ -111,6 +113,10 @@ struct st_texture_object
 };
 
 
+/** Number of sampler view variants a context may cache per texture */
+#define ST_MAX_SAMPLER_VIEWS_PER_CONTEXT 4
+
+
 static inline struct st_texture_image *
 st_texture_image(struct gl_texture_image *img)
 {
@@ -240,6 +246,12 @@ extern struct pipe_sampler_view **
 st_texture_get_sampler_view(struct st_context *st,
                             struct st_texture_object *stObj);
 
+extern struct pipe_sampler_view **
+st_texture_find_sampler_view(struct st_context *st,
+                             struct st_texture_object *stObj,
+                             const struct pipe_sampler_view *templ,
+                             boolean *found);
+
 extern void
 st_texture_release_sampler_view(struct st_context *st,
                                 struct st_texture_object *stObj);
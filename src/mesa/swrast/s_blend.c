@@ -50,6 +50,10 @@
 #include "x86/common_x86_asm.h"
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 
 /**
  * Integer divide by 255
@@ -159,6 +163,152 @@ blend_transparency_ubyte(struct gl_context *ctx, GLuint n, const GLubyte mask[],
 }
 
 
+#if defined(__SSE2__)
+
+/**
+ * Round(x / 255) for x in [0, 255 * 255], vectorized below.
+ */
+static inline GLubyte
+div255_round(GLuint x)
+{
+   x += 128;
+   return (GLubyte) ((x + (x >> 8)) >> 8);
+}
+
+
+/**
+ * SSE2 version of blend_transparency_ubyte(), four pixels at a time.
+ * The MMX code above is only available on 32-bit x86, SSE2 is always there
+ * on x86-64.  Computes (src * a + dst * (255 - a)) / 255 with rounding,
+ * which is exact for a = 0 and a = 255.
+ */
+static void
+blend_transparency_ubyte_sse2(struct gl_context *ctx, GLuint n,
+                              const GLubyte mask[], GLvoid *src,
+                              const GLvoid *dst, GLenum chanType)
+{
+   GLubyte (*rgba)[4] = (GLubyte (*)[4]) src;
+   const GLubyte (*dest)[4] = (const GLubyte (*)[4]) dst;
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i c255 = _mm_set1_epi16(255);
+   const __m128i c128 = _mm_set1_epi16(128);
+   GLuint i;
+
+   assert(ctx->Color.Blend[0].EquationRGB == GL_FUNC_ADD);
+   assert(ctx->Color.Blend[0].SrcRGB == GL_SRC_ALPHA);
+   assert(ctx->Color.Blend[0].DstRGB == GL_ONE_MINUS_SRC_ALPHA);
+   assert(chanType == GL_UNSIGNED_BYTE);
+   STATIC_ASSERT(ACOMP == 3);
+
+   (void) ctx;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128i s = _mm_loadu_si128((const __m128i *) rgba[i]);
+      const __m128i d = _mm_loadu_si128((const __m128i *) dest[i]);
+      __m128i keep, lo, hi, res;
+      GLuint m;
+      int half;
+
+      memcpy(&m, mask + i, sizeof(m));
+      if (m == 0)
+         continue;
+
+      /* All ones in the pixels whose mask is zero, which stay untouched */
+      keep = _mm_unpacklo_epi8(_mm_cvtsi32_si128(m), zero);
+      keep = _mm_unpacklo_epi16(keep, zero);
+      keep = _mm_cmpeq_epi32(keep, zero);
+
+      for (half = 0; half < 2; half++) {
+         const __m128i s16 = half ? _mm_unpackhi_epi8(s, zero)
+                                  : _mm_unpacklo_epi8(s, zero);
+         const __m128i d16 = half ? _mm_unpackhi_epi8(d, zero)
+                                  : _mm_unpacklo_epi8(d, zero);
+         __m128i a, x;
+
+         a = _mm_shufflelo_epi16(s16, _MM_SHUFFLE(3, 3, 3, 3));
+         a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+
+         x = _mm_add_epi16(_mm_mullo_epi16(s16, a),
+                           _mm_mullo_epi16(d16, _mm_sub_epi16(c255, a)));
+         x = _mm_add_epi16(x, c128);
+         x = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+
+         if (half)
+            hi = x;
+         else
+            lo = x;
+      }
+
+      res = _mm_packus_epi16(lo, hi);
+      res = _mm_or_si128(_mm_and_si128(keep, s), _mm_andnot_si128(keep, res));
+      _mm_storeu_si128((__m128i *) rgba[i], res);
+   }
+
+   for (; i < n; i++) {
+      if (mask[i]) {
+         const GLuint t = rgba[i][ACOMP];
+         GLuint c;
+
+         for (c = 0; c < 4; c++) {
+            rgba[i][c] = div255_round(rgba[i][c] * t +
+                                      dest[i][c] * (255 - t));
+         }
+      }
+   }
+}
+
+
+/**
+ * SSE2 version of the GL_UNSIGNED_BYTE case of blend_add().
+ */
+static void
+blend_add_ubyte_sse2(struct gl_context *ctx, GLuint n, const GLubyte mask[],
+                     GLvoid *src, const GLvoid *dst, GLenum chanType)
+{
+   GLubyte (*rgba)[4] = (GLubyte (*)[4]) src;
+   const GLubyte (*dest)[4] = (const GLubyte (*)[4]) dst;
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i;
+
+   assert(ctx->Color.Blend[0].EquationRGB == GL_FUNC_ADD);
+   assert(ctx->Color.Blend[0].SrcRGB == GL_ONE);
+   assert(ctx->Color.Blend[0].DstRGB == GL_ONE);
+   assert(chanType == GL_UNSIGNED_BYTE);
+
+   (void) ctx;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128i s = _mm_loadu_si128((const __m128i *) rgba[i]);
+      const __m128i d = _mm_loadu_si128((const __m128i *) dest[i]);
+      __m128i keep, res;
+      GLuint m;
+
+      memcpy(&m, mask + i, sizeof(m));
+      if (m == 0)
+         continue;
+
+      keep = _mm_unpacklo_epi8(_mm_cvtsi32_si128(m), zero);
+      keep = _mm_unpacklo_epi16(keep, zero);
+      keep = _mm_cmpeq_epi32(keep, zero);
+
+      res = _mm_adds_epu8(s, d);
+      res = _mm_or_si128(_mm_and_si128(keep, s), _mm_andnot_si128(keep, res));
+      _mm_storeu_si128((__m128i *) rgba[i], res);
+   }
+
+   for (; i < n; i++) {
+      if (mask[i]) {
+         GLuint c;
+
+         for (c = 0; c < 4; c++)
+            rgba[i][c] = (GLubyte) MIN2(rgba[i][c] + dest[i][c], 255);
+      }
+   }
+}
+
+#endif /* __SSE2__ */
+
+
 static void
 blend_transparency_ushort(struct gl_context *ctx, GLuint n, const GLubyte mask[],
                           GLvoid *src, const GLvoid *dst, GLenum chanType)
@@ -939,6 +1089,12 @@ _swrast_choose_blend_func(struct gl_context *ctx, GLenum chanType)
          swrast->BlendFunc = _mesa_mmx_blend_transparency;
       }
       else
+#endif
+#if defined(__SSE2__)
+      if (chanType == GL_UNSIGNED_BYTE) {
+         swrast->BlendFunc = blend_transparency_ubyte_sse2;
+      }
+      else
 #endif
       {
          if (chanType == GL_UNSIGNED_BYTE)
@@ -955,6 +1111,12 @@ _swrast_choose_blend_func(struct gl_context *ctx, GLenum chanType)
          swrast->BlendFunc = _mesa_mmx_blend_add;
       }
       else
+#endif
+#if defined(__SSE2__)
+      if (chanType == GL_UNSIGNED_BYTE) {
+         swrast->BlendFunc = blend_add_ubyte_sse2;
+      }
+      else
 #endif
          swrast->BlendFunc = blend_add;
    }
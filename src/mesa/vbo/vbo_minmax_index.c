@@ -263,6 +263,13 @@ vbo_get_minmax_index(struct gl_context *ctx,
       const GLuint *ui_indices = (const GLuint *)indices;
       GLuint max_ui = 0;
       GLuint min_ui = ~0U;
+#if defined(USE_SSE41)
+      if (cpu_has_sse4_1) {
+         _mesa_uint_array_min_max(ui_indices, &min_ui, &max_ui, count,
+                                  restart, restartIndex);
+      }
+      else
+#endif
       if (restart) {
          for (i = 0; i < count; i++) {
             if (ui_indices[i] != restartIndex) {
@@ -272,16 +279,10 @@ vbo_get_minmax_index(struct gl_context *ctx,
          }
       }
       else {
-#if defined(USE_SSE41)
-         if (cpu_has_sse4_1) {
-            _mesa_uint_array_min_max(ui_indices, &min_ui, &max_ui, count);
+         for (i = 0; i < count; i++) {
+            if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
+            if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
          }
-         else
-#endif
-            for (i = 0; i < count; i++) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
       }
       *min_index = min_ui;
       *max_index = max_ui;
@@ -291,6 +292,13 @@ vbo_get_minmax_index(struct gl_context *ctx,
       const GLushort *us_indices = (const GLushort *)indices;
       GLuint max_us = 0;
       GLuint min_us = ~0U;
+#if defined(USE_SSE41)
+      if (cpu_has_sse4_1) {
+         _mesa_ushort_array_min_max(us_indices, &min_us, &max_us, count,
+                                    restart, restartIndex);
+      }
+      else
+#endif
       if (restart) {
          for (i = 0; i < count; i++) {
             if (us_indices[i] != restartIndex) {
@@ -313,6 +321,13 @@ vbo_get_minmax_index(struct gl_context *ctx,
       const GLubyte *ub_indices = (const GLubyte *)indices;
       GLuint max_ub = 0;
       GLuint min_ub = ~0U;
+#if defined(USE_SSE41)
+      if (cpu_has_sse4_1) {
+         _mesa_ubyte_array_min_max(ub_indices, &min_ub, &max_ub, count,
+                                   restart, restartIndex);
+      }
+      else
+#endif
       if (restart) {
          for (i = 0; i < count; i++) {
             if (ub_indices[i] != restartIndex) {
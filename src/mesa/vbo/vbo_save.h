@@ -83,8 +83,26 @@ struct vbo_save_vertex_list {
 
    struct vbo_save_vertex_store *vertex_store;
    struct vbo_save_primitive_store *prim_store;
+
+   /* Indexed version of prim[] built when the list is compiled, where
+    * consecutive primitives have been merged into a few independent
+    * point/line/triangle/quad lists.  The original prim[] is kept for
+    * loopback and for the cases where the conversion isn't exact, see
+    * VBO_SAVE_MERGED_*.
+    */
+   struct _mesa_prim *merged_prim;
+   GLuint merged_prim_count;
+   GLbitfield merged_flags;
+   struct _mesa_index_buffer merged_ib;
 };
 
+/* Conditions under which vbo_save_vertex_list::merged_prim may be drawn
+ * instead of prim[]:
+ */
+#define VBO_SAVE_MERGED_LAST_VERTEX  0x1 /**< needs last vertex provoking */
+#define VBO_SAVE_MERGED_NO_STIPPLE   0x2 /**< needs line stipple disabled */
+#define VBO_SAVE_MERGED_FILL         0x4 /**< needs GL_FILL polygon modes */
+
 /* These buffers should be a reasonable size to support upload to
  * hardware.  Current vbo implementation will re-upload on any
  * changes, so don't make too big or apps which dynamically create
@@ -94,9 +112,14 @@ struct vbo_save_vertex_list {
  * case of dynamic vbos.  Then make the dlist code signal that
  * likelyhood as it occurs.  No reason we couldn't change usage
  * internally even though this probably isn't allowed for client VBOs?
+ *
+ * The stores are shared by all lists compiled in a row, and filling
+ * one ends the current vertex list, so lists built from many small
+ * glBegin/End pairs only get merged into few draws if these aren't too
+ * small either.
  */
-#define VBO_SAVE_BUFFER_SIZE (8*1024) /* dwords */
-#define VBO_SAVE_PRIM_SIZE   128
+#define VBO_SAVE_BUFFER_SIZE (256*1024) /* dwords */
+#define VBO_SAVE_PRIM_SIZE   1024
 #define VBO_SAVE_PRIM_MODE_MASK         0x3f
 #define VBO_SAVE_PRIM_WEAK              0x40
 #define VBO_SAVE_PRIM_NO_CURRENT_UPDATE 0x80
@@ -405,6 +405,228 @@ convert_line_loop_to_strip(struct vbo_save_context *save,
 }
 
 
+/**
+ * Return the independent primitive type that the vertices of \p prim
+ * are converted to when building the merged index list, or
+ * \p mode itself if the primitive is copied as it is.  The VBO_SAVE_MERGED_*
+ * conditions under which the conversion is exact are added to \p flags.
+ */
+static GLenum
+get_merged_prim_mode(const struct _mesa_prim *prim, bool edgeflags,
+                     GLbitfield *flags)
+{
+   switch (prim->mode) {
+   case GL_LINE_LOOP:
+      /* the closing line of a wrapped loop isn't within this node */
+      if (!prim->begin || !prim->end)
+         return GL_LINE_LOOP;
+      /* fall-through */
+   case GL_LINE_STRIP:
+      /* line stipple continues along strips but restarts for each line */
+      *flags |= VBO_SAVE_MERGED_NO_STIPPLE;
+      return GL_LINES;
+   case GL_TRIANGLE_STRIP:
+   case GL_TRIANGLE_FAN:
+      /* the index order below keeps the provoking vertex of the last vertex
+       * convention only
+       */
+      *flags |= VBO_SAVE_MERGED_LAST_VERTEX;
+      if (edgeflags)
+         *flags |= VBO_SAVE_MERGED_FILL;
+      return GL_TRIANGLES;
+   case GL_POLYGON:
+      /* the inner edges would show up with GL_LINE/GL_POINT polygon modes */
+      *flags |= VBO_SAVE_MERGED_LAST_VERTEX | VBO_SAVE_MERGED_FILL;
+      return GL_TRIANGLES;
+   default:
+      return prim->mode;
+   }
+}
+
+
+/**
+ * Write the indices of one primitive as \p merged_mode primitives, return
+ * the number of indices written.
+ */
+static GLuint
+emit_merged_indices(const struct _mesa_prim *prim, GLenum merged_mode,
+                    GLuint *indices)
+{
+   const GLuint start = prim->start;
+   GLuint n = 0;
+   GLuint i;
+
+   if (merged_mode == prim->mode) {
+      GLuint count = prim->count;
+
+      /* drop incomplete trailing primitives, as the draw would */
+      switch (merged_mode) {
+      case GL_LINES:
+         count -= count % 2;
+         break;
+      case GL_TRIANGLES:
+         count -= count % 3;
+         break;
+      case GL_QUADS:
+         count -= count % 4;
+         break;
+      default:
+         break;
+      }
+
+      for (i = 0; i < count; i++)
+         indices[n++] = start + i;
+      return n;
+   }
+
+   switch (prim->mode) {
+   case GL_LINE_LOOP:
+   case GL_LINE_STRIP:
+      for (i = 0; i + 1 < prim->count; i++) {
+         indices[n++] = start + i;
+         indices[n++] = start + i + 1;
+      }
+      if (prim->mode == GL_LINE_LOOP && prim->count >= 2) {
+         indices[n++] = start + prim->count - 1;
+         indices[n++] = start;
+      }
+      break;
+   case GL_TRIANGLE_STRIP:
+      for (i = 0; i + 2 < prim->count; i++) {
+         /* odd triangles are flipped to keep the winding */
+         indices[n++] = start + i + (i & 1);
+         indices[n++] = start + i + 1 - (i & 1);
+         indices[n++] = start + i + 2;
+      }
+      break;
+   case GL_TRIANGLE_FAN:
+      for (i = 1; i + 1 < prim->count; i++) {
+         indices[n++] = start;
+         indices[n++] = start + i;
+         indices[n++] = start + i + 1;
+      }
+      break;
+   case GL_POLYGON:
+      /* the first vertex provokes all triangles of a polygon */
+      for (i = 1; i + 1 < prim->count; i++) {
+         indices[n++] = start + i;
+         indices[n++] = start + i + 1;
+         indices[n++] = start;
+      }
+      break;
+   default:
+      unreachable("unexpected primitive conversion");
+   }
+
+   return n;
+}
+
+
+/**
+ * Build node->merged_prim and its index buffer: all the primitives of the
+ * node are converted to point, line, triangle or quad lists where possible
+ * and consecutive lists of the same type are drawn with a single indexed
+ * primitive.  Legacy applications tend to build display lists out of many
+ * tiny glBegin/End pairs, which would otherwise result in one draw each.
+ */
+static void
+compile_merged_prims(struct gl_context *ctx,
+                     struct vbo_save_vertex_list *node)
+{
+   const bool edgeflags = node->attrsz[VBO_ATTRIB_EDGEFLAG] != 0;
+   struct _mesa_prim *merged;
+   struct gl_buffer_object *bufferobj;
+   GLuint *indices;
+   GLuint max_indices = 0;
+   GLuint num_indices = 0;
+   GLuint num_merged = 0;
+   GLbitfield flags = 0;
+   GLuint i;
+
+   node->merged_prim = NULL;
+   node->merged_prim_count = 0;
+   node->merged_flags = 0;
+   memset(&node->merged_ib, 0, sizeof(node->merged_ib));
+
+   if (node->prim_count < 2 || node->count == 0)
+      return;
+
+   for (i = 0; i < node->prim_count; i++) {
+      /* strips and fans expand to at most three indices per vertex */
+      max_indices += 3 * node->prim[i].count;
+   }
+
+   merged = malloc(node->prim_count * sizeof(*merged));
+   indices = malloc(max_indices * sizeof(GLuint));
+   if (!merged || !indices)
+      goto fail;
+
+   for (i = 0; i < node->prim_count; i++) {
+      const struct _mesa_prim *prim = &node->prim[i];
+      GLenum mode = get_merged_prim_mode(prim, edgeflags, &flags);
+      GLuint n = emit_merged_indices(prim, mode, indices + num_indices);
+      struct _mesa_prim *last = num_merged ? &merged[num_merged - 1] : NULL;
+
+      if (n == 0)
+         continue;
+
+      if (last && last->mode == mode &&
+          (mode == GL_POINTS || mode == GL_LINES ||
+           mode == GL_TRIANGLES || mode == GL_QUADS)) {
+         last->count += n;
+      }
+      else {
+         last = &merged[num_merged++];
+         *last = *prim;
+         last->mode = mode;
+         last->indexed = 1;
+         if (mode != prim->mode) {
+            last->begin = 1;
+            last->end = 1;
+         }
+         last->start = num_indices;
+         last->count = n;
+         last->basevertex = 0;
+      }
+
+      num_indices += n;
+   }
+
+   /* not worth an index buffer if no draws were saved */
+   if (num_merged == 0 || num_merged >= node->prim_count)
+      goto fail;
+
+   bufferobj = ctx->Driver.NewBufferObject(ctx, VBO_BUF_ID);
+   if (!bufferobj)
+      goto fail;
+
+   if (!ctx->Driver.BufferData(ctx, GL_ELEMENT_ARRAY_BUFFER_ARB,
+                               num_indices * sizeof(GLuint), indices,
+                               GL_STATIC_DRAW_ARB,
+                               GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT,
+                               bufferobj)) {
+      _mesa_reference_buffer_object(ctx, &bufferobj, NULL);
+      goto fail;
+   }
+
+   free(indices);
+
+   node->merged_prim = merged;
+   node->merged_prim_count = num_merged;
+   node->merged_flags = flags;
+   node->merged_ib.count = num_indices;
+   node->merged_ib.type = GL_UNSIGNED_INT;
+   node->merged_ib.obj = bufferobj;
+   node->merged_ib.ptr = NULL;
+   return;
+
+fail:
+   /* Not fatal, the list is drawn from node->prim[] instead. */
+   free(merged);
+   free(indices);
+}
+
+
 /**
  * Insert the active immediate struct onto the display list currently
  * being built.
@@ -492,6 +714,8 @@ _save_compile_vertex_list(struct gl_context *ctx)
 
    merge_prims(node->prim, &node->prim_count);
 
+   compile_merged_prims(ctx, node);
+
    /* Deal with GL_COMPILE_AND_EXECUTE:
     */
    if (ctx->ExecuteFlag) {
@@ -1583,6 +1807,10 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
 
    free(node->current_data);
    node->current_data = NULL;
+
+   free(node->merged_prim);
+   node->merged_prim = NULL;
+   _mesa_reference_buffer_object(ctx, &node->merged_ib.obj, NULL);
 }
 
 
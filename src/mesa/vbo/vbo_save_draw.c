@@ -240,6 +240,37 @@ vbo_save_loopback_vertex_list(struct gl_context *ctx,
 }
 
 
+/**
+ * Whether the merged, indexed version of the node's primitives built at
+ * compile time draws the same as node->prim[] with the current state.
+ */
+static bool
+use_merged_prims(const struct gl_context *ctx,
+                 const struct vbo_save_vertex_list *node)
+{
+   if (!node->merged_prim)
+      return false;
+
+   /* the merged indices must not be taken for restart indices */
+   if (ctx->Array._PrimitiveRestart)
+      return false;
+
+   if ((node->merged_flags & VBO_SAVE_MERGED_LAST_VERTEX) &&
+       ctx->Light.ProvokingVertex != GL_LAST_VERTEX_CONVENTION_EXT)
+      return false;
+
+   if ((node->merged_flags & VBO_SAVE_MERGED_NO_STIPPLE) &&
+       ctx->Line.StippleFlag)
+      return false;
+
+   if ((node->merged_flags & VBO_SAVE_MERGED_FILL) &&
+       (ctx->Polygon.FrontMode != GL_FILL || ctx->Polygon.BackMode != GL_FILL))
+      return false;
+
+   return true;
+}
+
+
 /**
  * Execute the buffer and save copied verts.
  * This is called from the display list code when executing
@@ -306,7 +337,17 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
       if (ctx->NewState)
 	 _mesa_update_state( ctx );
 
-      if (node->count > 0) {
+      if (node->count > 0 && use_merged_prims(ctx, node)) {
+         vbo_context(ctx)->draw_prims(ctx,
+                                      node->merged_prim,
+                                      node->merged_prim_count,
+                                      &node->merged_ib,
+                                      GL_TRUE,
+                                      0,
+                                      node->count - 1,
+                                      NULL, 0, NULL);
+      }
+      else if (node->count > 0) {
          vbo_context(ctx)->draw_prims(ctx, 
                                       node->prim,
                                       node->prim_count,
@@ -32,11 +32,14 @@
 
 #include "main/glheader.h"
 #include "main/context.h"
+#include "main/macros.h"
 #include "math/m_xform.h"
 #include "tnl/t_context.h"
 #include "x86-64.h"
 #include "../x86/x86_xform.h"
 
+#include <xmmintrin.h>
+
 #ifdef DEBUG
 #include "math/m_debug.h"
 #endif
@@ -46,6 +49,68 @@ extern void _mesa_x86_64_cpuid(unsigned int *regs);
 DECLARE_XFORM_GROUP( x86_64, 4 )
 DECLARE_XFORM_GROUP( 3dnow, 4 )
 
+
+/*
+ * The assembly only covers 4-component input, but most fixed-function
+ * geometry comes in as glVertex3f()-style data.  SSE is always available
+ * on x86-64, so do the 3-component general and 3D cases with intrinsics:
+ * each vertex is one multiply-add per matrix column on all four lanes.
+ */
+static void
+_mesa_sse_transform_points3_general( GLvector4f *to_vec,
+                                     const GLfloat m[16],
+                                     const GLvector4f *from_vec )
+{
+   const GLuint stride = from_vec->stride;
+   GLfloat *from = from_vec->start;
+   GLfloat (*to)[4] = (GLfloat (*)[4])to_vec->start;
+   const GLuint count = from_vec->count;
+   const __m128 c0 = _mm_loadu_ps(m + 0);
+   const __m128 c1 = _mm_loadu_ps(m + 4);
+   const __m128 c2 = _mm_loadu_ps(m + 8);
+   const __m128 c3 = _mm_loadu_ps(m + 12);
+   GLuint i;
+
+   for (i = 0; i < count; i++, STRIDE_F(from, stride)) {
+      __m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(from[0])), c3);
+      r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(from[1])));
+      r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(from[2])));
+      _mm_storeu_ps(to[i], r);
+   }
+   to_vec->size = 4;
+   to_vec->flags |= VEC_SIZE_4;
+   to_vec->count = from_vec->count;
+}
+
+static void
+_mesa_sse_transform_points3_3d( GLvector4f *to_vec,
+                                const GLfloat m[16],
+                                const GLvector4f *from_vec )
+{
+   const GLuint stride = from_vec->stride;
+   GLfloat *from = from_vec->start;
+   GLfloat (*to)[4] = (GLfloat (*)[4])to_vec->start;
+   const GLuint count = from_vec->count;
+   const __m128 c0 = _mm_loadu_ps(m + 0);
+   const __m128 c1 = _mm_loadu_ps(m + 4);
+   const __m128 c2 = _mm_loadu_ps(m + 8);
+   const __m128 c3 = _mm_loadu_ps(m + 12);
+   GLuint i;
+
+   /* The fourth lane ends up as m[15] == 1, which is harmless for a size 3
+    * result.
+    */
+   for (i = 0; i < count; i++, STRIDE_F(from, stride)) {
+      __m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(from[0])), c3);
+      r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(from[1])));
+      r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(from[2])));
+      _mm_storeu_ps(to[i], r);
+   }
+   to_vec->size = 3;
+   to_vec->flags |= VEC_SIZE_3;
+   to_vec->count = from_vec->count;
+}
+
 #else
 /* just to silence warning below */
 #include "x86-64.h"
@@ -90,6 +155,11 @@ void _mesa_init_all_x86_64_transform_asm(void)
    _mesa_transform_tab[4][MATRIX_3D] =
       _mesa_x86_64_transform_points4_3d;
 
+   _mesa_transform_tab[3][MATRIX_GENERAL] =
+      _mesa_sse_transform_points3_general;
+   _mesa_transform_tab[3][MATRIX_3D] =
+      _mesa_sse_transform_points3_3d;
+
    regs[0] = 0x80000001;
    regs[1] = 0x00000000;
    regs[2] = 0x00000000;
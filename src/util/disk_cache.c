@@ -0,0 +1,833 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifdef ENABLE_SHADER_CACHE
+
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/file.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <errno.h>
+#include <dirent.h>
+
+#include "util/u_atomic.h"
+#include "util/mesa-sha1.h"
+#include "util/ralloc.h"
+
+#include "disk_cache.h"
+
+/* Number of bits to mask off from a cache key to get an index. */
+#define CACHE_INDEX_KEY_BITS 16
+
+/* Mask for computing an index from a key. */
+#define CACHE_INDEX_KEY_MASK ((1 << CACHE_INDEX_KEY_BITS) - 1)
+
+/* The number of keys that can be stored in the index. */
+#define CACHE_INDEX_MAX_KEYS (1 << CACHE_INDEX_KEY_BITS)
+
+/* Cache size used when $MESA_GLSL_CACHE_MAX_SIZE is not set. */
+#define CACHE_DEFAULT_MAX_SIZE (1024 * 1024 * 1024)
+
+struct disk_cache {
+   /* The path to the cache directory. */
+   char *path;
+
+   /* A pointer to the mmapped index file within the cache directory. */
+   uint8_t *index_mmap;
+   size_t index_mmap_size;
+
+   /* Pointer to total size of all objects in cache (within index_mmap) */
+   uint64_t *size;
+
+   /* Pointer to stored keys, (within index_mmap). */
+   uint8_t *stored_keys;
+
+   /* Maximum size of all cached objects (in bytes). */
+   uint64_t max_size;
+
+   /* SHA-1 of the gpu name and driver identity, prepended to the data of
+    * every key computed by disk_cache_compute_key().
+    */
+   cache_key driver_key;
+};
+
+/* Create a directory named 'path' if it does not already exist.
+ *
+ * Returns: 0 if path already exists as a directory or if created.
+ *         -1 in all other cases.
+ */
+static int
+mkdir_if_needed(const char *path)
+{
+   struct stat sb;
+
+   /* If the path exists already, then our work is done if it's a
+    * directory, but it's an error if it is not.
+    */
+   if (stat(path, &sb) == 0) {
+      if (S_ISDIR(sb.st_mode)) {
+         return 0;
+      } else {
+         fprintf(stderr, "Cannot use %s for shader cache (not a directory)"
+                         "---disabling.\n", path);
+         return -1;
+      }
+   }
+
+   if (mkdir(path, 0755) == 0 || errno == EEXIST)
+      return 0;
+
+   fprintf(stderr, "Failed to create %s for shader cache (%s)---disabling.\n",
+           path, strerror(errno));
+
+   return -1;
+}
+
+/* Concatenate an existing path and a new name to form a new path.  If the new
+ * path does not exist as a directory, create it then return the resulting
+ * name of the new path (ralloc'ed off of 'ctx').
+ *
+ * Returns NULL on any error, such as:
+ *
+ *      <path> does not exist or is not a directory
+ *      <path>/<name> exists but is not a directory
+ *      <path>/<name> cannot be created as a directory
+ */
+static char *
+concatenate_and_mkdir(void *ctx, const char *path, const char *name)
+{
+   char *new_path;
+   struct stat sb;
+
+   if (stat(path, &sb) != 0 || ! S_ISDIR(sb.st_mode))
+      return NULL;
+
+   new_path = ralloc_asprintf(ctx, "%s/%s", path, name);
+
+   if (mkdir_if_needed(new_path) == 0)
+      return new_path;
+   else
+      return NULL;
+}
+
+/* Parse a size with an optional K, M or G suffix (case-insensitive). A bare
+ * number is taken to be a number of bytes.
+ */
+static uint64_t
+parse_max_size(const char *str)
+{
+   char *end;
+   uint64_t size;
+
+   size = strtoul(str, &end, 10);
+   if (end == str)
+      return 0;
+
+   switch (*end) {
+   case 'K':
+   case 'k':
+      size *= 1024;
+      break;
+   case 'M':
+   case 'm':
+      size *= 1024*1024;
+      break;
+   case 'G':
+   case 'g':
+      size *= 1024*1024*1024;
+      break;
+   default:
+      break;
+   }
+
+   return size;
+}
+
+struct disk_cache *
+disk_cache_create(const char *gpu_name, const char *driver_id)
+{
+   void *local;
+   struct disk_cache *cache = NULL;
+   char *path, *max_size_str;
+   struct mesa_sha1 *sha1_ctx;
+   int fd = -1;
+   struct stat sb;
+   size_t size;
+
+   /* A ralloc context for transient data during this invocation. */
+   local = ralloc_context(NULL);
+   if (local == NULL)
+      goto fail;
+
+   /* At user request, disable shader cache entirely. */
+   if (getenv("MESA_GLSL_CACHE_DISABLE"))
+      goto fail;
+
+   /* Determine path for cache based on the first defined name as follows:
+    *
+    *   $MESA_GLSL_CACHE_DIR
+    *   $XDG_CACHE_HOME/mesa
+    *   <pwd.pw_dir>/.cache/mesa
+    */
+   path = getenv("MESA_GLSL_CACHE_DIR");
+   if (path && mkdir_if_needed(path) == -1) {
+      goto fail;
+   }
+
+   if (path == NULL) {
+      char *xdg_cache_home = getenv("XDG_CACHE_HOME");
+
+      if (xdg_cache_home) {
+         if (mkdir_if_needed(xdg_cache_home) == -1)
+            goto fail;
+
+         path = concatenate_and_mkdir(local, xdg_cache_home, "mesa");
+         if (path == NULL)
+            goto fail;
+      }
+   }
+
+   if (path == NULL) {
+      char *buf;
+      size_t buf_size;
+      struct passwd pwd, *result;
+
+      buf_size = sysconf(_SC_GETPW_R_SIZE_MAX);
+      if (buf_size == -1)
+         buf_size = 512;
+
+      /* Loop until buf_size is large enough to query the directory */
+      while (1) {
+         buf = ralloc_size(local, buf_size);
+
+         getpwuid_r(getuid(), &pwd, buf, buf_size, &result);
+         if (result)
+            break;
+
+         if (errno == ERANGE) {
+            ralloc_free(buf);
+            buf = NULL;
+            buf_size *= 2;
+         } else {
+            goto fail;
+         }
+      }
+
+      path = concatenate_and_mkdir(local, pwd.pw_dir, ".cache");
+      if (path == NULL)
+         goto fail;
+
+      path = concatenate_and_mkdir(local, path, "mesa");
+      if (path == NULL)
+         goto fail;
+   }
+
+   cache = rzalloc(NULL, struct disk_cache);
+   if (cache == NULL)
+      goto fail;
+
+   cache->path = ralloc_strdup(cache, path);
+   if (cache->path == NULL)
+      goto fail;
+
+   path = ralloc_asprintf(local, "%s/index", cache->path);
+   if (path == NULL)
+      goto fail;
+
+   fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+   if (fd == -1)
+      goto fail;
+
+   if (fstat(fd, &sb) == -1)
+      goto fail;
+
+   /* Force the index file to be the expected size. */
+   size = sizeof(*cache->size) + CACHE_INDEX_MAX_KEYS * CACHE_KEY_SIZE;
+   if (sb.st_size != size) {
+      if (ftruncate(fd, size) == -1)
+         goto fail;
+   }
+
+   /* We map this shared so that other processes see updates that we
+    * make.
+    *
+    * Note: We do use atomic addition to ensure that multiple
+    * processes don't scramble the cache size recorded in the
+    * index. But we don't use any locking to prevent multiple
+    * processes from updating the same entry simultaneously. The idea
+    * is that if either result lands entirely in the index, then
+    * that's equivalent to a well-ordered write followed by an
+    * eviction and a write. On the other hand, if the simultaneous
+    * writes result in a corrupt entry, that's not really any
+    * different than both entries being evicted, (since within the
+    * guarantees of the cryptographic hash, a corrupt entry is
+    * unlikely to ever match a real cache key).
+    */
+   cache->index_mmap = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, 0);
+   if (cache->index_mmap == MAP_FAILED)
+      goto fail;
+   cache->index_mmap_size = size;
+
+   close(fd);
+   fd = -1;
+
+   cache->size = (uint64_t *) cache->index_mmap;
+   cache->stored_keys = cache->index_mmap + sizeof(uint64_t);
+
+   cache->max_size = 0;
+   max_size_str = getenv("MESA_GLSL_CACHE_MAX_SIZE");
+   if (max_size_str)
+      cache->max_size = parse_max_size(max_size_str);
+
+   /* Default to 1GB for maximum cache size. */
+   if (cache->max_size == 0)
+      cache->max_size = CACHE_DEFAULT_MAX_SIZE;
+
+   /* Fold the driver identity into a single key once, so that computing an
+    * item key only costs one extra SHA-1 block.
+    */
+   sha1_ctx = _mesa_sha1_init();
+   if (sha1_ctx == NULL)
+      goto fail;
+   _mesa_sha1_update(sha1_ctx, gpu_name, strlen(gpu_name) + 1);
+   _mesa_sha1_update(sha1_ctx, driver_id, strlen(driver_id) + 1);
+   _mesa_sha1_final(sha1_ctx, cache->driver_key);
+
+   ralloc_free(local);
+
+   return cache;
+
+ fail:
+   if (fd != -1)
+      close(fd);
+   if (cache && cache->index_mmap && cache->index_mmap != MAP_FAILED)
+      munmap(cache->index_mmap, cache->index_mmap_size);
+   if (cache)
+      ralloc_free(cache);
+   ralloc_free(local);
+
+   return NULL;
+}
+
+void
+disk_cache_destroy(struct disk_cache *cache)
+{
+   if (cache == NULL)
+      return;
+
+   munmap(cache->index_mmap, cache->index_mmap_size);
+
+   ralloc_free(cache);
+}
+
+void
+disk_cache_compute_key(struct disk_cache *cache, const void *data,
+                       size_t size, cache_key key)
+{
+   struct mesa_sha1 *sha1_ctx = _mesa_sha1_init();
+
+   if (sha1_ctx == NULL) {
+      memset(key, 0, CACHE_KEY_SIZE);
+      return;
+   }
+
+   _mesa_sha1_update(sha1_ctx, cache->driver_key, CACHE_KEY_SIZE);
+   _mesa_sha1_update(sha1_ctx, data, size);
+   _mesa_sha1_final(sha1_ctx, key);
+}
+
+/* Return a filename within the cache's directory corresponding to 'key'. The
+ * returned filename is ralloced with 'cache' as the parent context.
+ *
+ * Returns NULL if out of memory.
+ */
+static char *
+get_cache_file(struct disk_cache *cache, const cache_key key)
+{
+   char buf[41];
+
+   _mesa_sha1_format(buf, key);
+
+   return ralloc_asprintf(cache, "%s/%c%c/%s",
+                          cache->path, buf[0], buf[1], buf + 2);
+}
+
+/* Create the directory that will be needed for the cache file for \key.
+ *
+ * Obviously, the implementation here must closely match
+ * get_cache_file above.
+*/
+static void
+make_cache_file_directory(struct disk_cache *cache, const cache_key key)
+{
+   char *dir;
+   char buf[41];
+
+   _mesa_sha1_format(buf, key);
+
+   dir = ralloc_asprintf(cache, "%s/%c%c", cache->path, buf[0], buf[1]);
+
+   mkdir_if_needed(dir);
+
+   ralloc_free(dir);
+}
+
+/* Given a directory path and predicate function, find the entry in that
+ * directory that satisfies the predicate and was accessed least recently.
+ *
+ * Cache hits refresh the access time of the file that was read (see
+ * disk_cache_get()), so on filesystems mounted with noatime or relatime
+ * this is still a reasonable approximation of LRU order.
+ *
+ * Returns: A malloc'ed string for the path to the chosen file, (or
+ * NULL on any error). The caller should free the string when
+ * finished.
+ */
+static char *
+choose_lru_file_matching(const char *dir_path,
+                         bool (*predicate)(const struct dirent *))
+{
+   DIR *dir;
+   struct dirent *entry;
+   struct stat sb;
+   char *filename = NULL, *lru_name = NULL;
+   time_t lru_atime = 0;
+   int dir_fd;
+
+   dir = opendir(dir_path);
+   if (dir == NULL)
+      return NULL;
+   dir_fd = dirfd(dir);
+
+   while ((entry = readdir(dir)) != NULL) {
+      if (!predicate(entry))
+         continue;
+
+      if (fstatat(dir_fd, entry->d_name, &sb, 0) != 0 ||
+          !S_ISREG(sb.st_mode))
+         continue;
+
+      if (lru_name == NULL || sb.st_atime < lru_atime) {
+         free(lru_name);
+         lru_name = strdup(entry->d_name);
+         if (lru_name == NULL)
+            break;
+         lru_atime = sb.st_atime;
+      }
+   }
+
+   closedir(dir);
+
+   if (lru_name == NULL)
+      return NULL;
+
+   if (asprintf(&filename, "%s/%s", dir_path, lru_name) < 0)
+      filename = NULL;
+
+   free(lru_name);
+
+   return filename;
+}
+
+/* Is entry a regular file, and not having a name with a trailing
+ * ".tmp"
+ */
+static bool
+is_regular_non_tmp_file(const struct dirent *entry)
+{
+   size_t len;
+
+   if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN)
+      return false;
+
+   if (entry->d_name[0] == '.')
+      return false;
+
+   len = strlen (entry->d_name);
+   if (len >= 4 &&
+       strcmp(&entry->d_name[len-4], ".tmp") == 0)
+      return false;
+
+   return true;
+}
+
+/* Returns the size of the deleted file, (or 0 on any error). */
+static size_t
+unlink_lru_file_matching(const char *path,
+                         bool (*predicate)(const struct dirent *))
+{
+   struct stat sb;
+   char *filename;
+
+   filename = choose_lru_file_matching(path, predicate);
+   if (filename == NULL)
+      return 0;
+
+   if (stat(filename, &sb) == -1) {
+      free (filename);
+      return 0;
+   }
+
+   unlink(filename);
+
+   free (filename);
+
+   return sb.st_size;
+}
+
+/* Is entry a directory with a two-character name, (and not the
+ * special name of "..")
+ */
+static bool
+is_two_character_sub_directory(const struct dirent *entry)
+{
+   if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN)
+      return false;
+
+   if (strlen(entry->d_name) != 2)
+      return false;
+
+   if (strcmp(entry->d_name, "..") == 0)
+      return false;
+
+   return true;
+}
+
+/* Evict the least recently used item out of a few randomly chosen cache
+ * sub-directories.
+ *
+ * Scanning the whole cache on every eviction would be a lot of I/O for a
+ * cache that can hold hundreds of thousands of items, so instead we sample
+ * a handful of the 256 sub-directories (items are spread uniformly over
+ * them by their SHA-1 names) and drop the oldest file among them. This
+ * converges on LRU order as the cache fills while keeping each eviction
+ * bounded.
+ */
+#define EVICT_SAMPLE_DIRECTORIES 4
+
+static void
+evict_lru_item(struct disk_cache *cache)
+{
+   const char hex[] = "0123456789abcdef";
+   char *dir_path, *best = NULL;
+   time_t best_atime = 0;
+   struct stat sb;
+   size_t size;
+   unsigned tries, sampled = 0;
+
+   /* Try harder than the number of samples we want, since many of the
+    * sub-directories may not exist yet in a small cache.
+    */
+   for (tries = 0; tries < 64 && sampled < EVICT_SAMPLE_DIRECTORIES; tries++) {
+      int a = rand() % 16, b = rand() % 16;
+      char *filename;
+
+      dir_path = ralloc_asprintf(cache, "%s/%c%c", cache->path,
+                                 hex[a], hex[b]);
+      if (dir_path == NULL)
+         return;
+
+      filename = choose_lru_file_matching(dir_path, is_regular_non_tmp_file);
+      ralloc_free(dir_path);
+      if (filename == NULL)
+         continue;
+
+      sampled++;
+
+      if (stat(filename, &sb) == -1) {
+         free(filename);
+         continue;
+      }
+
+      if (best == NULL || sb.st_atime < best_atime) {
+         free(best);
+         best = filename;
+         best_atime = sb.st_atime;
+      } else {
+         free(filename);
+      }
+   }
+
+   if (best && stat(best, &sb) == 0 && unlink(best) == 0) {
+      p_atomic_add(cache->size, - (uint64_t) sb.st_size);
+      free(best);
+      return;
+   }
+
+   free(best);
+
+   /* If random sampling found nothing, (the cache is very sparse), fall
+    * back to walking the sub-directories in order.
+    */
+   size = 0;
+   dir_path = NULL;
+   {
+      DIR *dir = opendir(cache->path);
+      struct dirent *entry;
+
+      if (dir == NULL)
+         return;
+
+      while ((entry = readdir(dir)) != NULL) {
+         if (!is_two_character_sub_directory(entry))
+            continue;
+
+         dir_path = ralloc_asprintf(cache, "%s/%s", cache->path,
+                                    entry->d_name);
+         if (dir_path == NULL)
+            break;
+
+         size = unlink_lru_file_matching(dir_path, is_regular_non_tmp_file);
+         ralloc_free(dir_path);
+         if (size)
+            break;
+      }
+
+      closedir(dir);
+   }
+
+   if (size)
+      p_atomic_add(cache->size, - (uint64_t) size);
+}
+
+void
+disk_cache_remove(struct disk_cache *cache, const cache_key key)
+{
+   struct stat sb;
+   char *filename;
+
+   filename = get_cache_file(cache, key);
+   if (filename == NULL)
+      return;
+
+   if (stat(filename, &sb) == -1) {
+      ralloc_free(filename);
+      return;
+   }
+
+   if (unlink(filename) == 0)
+      p_atomic_add(cache->size, - (uint64_t) sb.st_size);
+
+   ralloc_free(filename);
+}
+
+void
+disk_cache_put(struct disk_cache *cache,
+               const cache_key key,
+               const void *data,
+               size_t size)
+{
+   int fd = -1, fd_final = -1, err, ret;
+   size_t len;
+   char *filename = NULL, *filename_tmp = NULL;
+   const char *p = data;
+
+   filename = get_cache_file(cache, key);
+   if (filename == NULL)
+      goto done;
+
+   /* Write to a temporary file to allow for an atomic rename to the
+    * final destination filename, (to prevent any readers from seeing
+    * a partially written file).
+    */
+   filename_tmp = ralloc_asprintf(cache, "%s.tmp", filename);
+   if (filename_tmp == NULL)
+      goto done;
+
+   fd = open(filename_tmp, O_WRONLY | O_CLOEXEC | O_CREAT, 0644);
+
+   /* Make the two-character subdirectory within the cache as needed. */
+   if (fd == -1) {
+      if (errno != ENOENT)
+         goto done;
+
+      make_cache_file_directory(cache, key);
+
+      fd = open(filename_tmp, O_WRONLY | O_CLOEXEC | O_CREAT, 0644);
+      if (fd == -1)
+         goto done;
+   }
+
+   /* With the temporary file open, we take an exclusive flock on
+    * it. If the flock fails, then another process still has the file
+    * open with the flock held. So just let that file be responsible
+    * for writing the file.
+    */
+   err = flock(fd, LOCK_EX | LOCK_NB);
+   if (err == -1)
+      goto done;
+
+   /* Now that we have the lock on the open temporary file, we can
+    * check to see if the destination file already exists. If so,
+    * another process won the race between when we saw that the file
+    * didn't exist and now. In this case, we don't do anything more,
+    * (to ensure the size accounting of the cache doesn't get off).
+    */
+   fd_final = open(filename, O_RDONLY | O_CLOEXEC);
+   if (fd_final != -1)
+      goto done;
+
+   /* OK, we're now on the hook to write out a file that we know is
+    * not in the cache, and is also not being written out to the cache
+    * by some other process.
+    *
+    * Before we do that, if the cache is too large, evict something
+    * else first.
+    */
+   if (*cache->size + size > cache->max_size)
+      evict_lru_item(cache);
+
+   /* Now, finally, write out the contents to the temporary file, then
+    * rename them atomically to the destination filename, and also
+    * perform an atomic increment of the total cache size.
+    */
+   for (len = 0; len < size; len += ret) {
+      ret = write(fd, p + len, size - len);
+      if (ret == -1) {
+         unlink(filename_tmp);
+         goto done;
+      }
+   }
+
+   rename(filename_tmp, filename);
+
+   p_atomic_add(cache->size, size);
+
+ done:
+   if (fd_final != -1)
+      close(fd_final);
+   /* This close finally releases the flock, (now that the final file
+    * has been renamed into place and the size has been added).
+    */
+   if (fd != -1)
+      close(fd);
+   if (filename_tmp)
+      ralloc_free(filename_tmp);
+   if (filename)
+      ralloc_free(filename);
+}
+
+void *
+disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
+{
+   int fd = -1, ret, len;
+   struct stat sb;
+   char *filename = NULL;
+   uint8_t *data = NULL;
+
+   if (size)
+      *size = 0;
+
+   filename = get_cache_file(cache, key);
+   if (filename == NULL)
+      goto fail;
+
+   fd = open(filename, O_RDONLY | O_CLOEXEC);
+   if (fd == -1)
+      goto fail;
+
+   if (fstat(fd, &sb) == -1)
+      goto fail;
+
+   data = malloc(sb.st_size);
+   if (data == NULL)
+      goto fail;
+
+   for (len = 0; len < sb.st_size; len += ret) {
+      ret = read(fd, data + len, sb.st_size - len);
+      if (ret <= 0)
+         goto fail;
+   }
+
+   /* Refresh the access time explicitly, since the filesystem may be
+    * mounted noatime, and eviction relies on it to find cold items.
+    */
+   {
+      struct timespec times[2];
+
+      times[0].tv_sec = 0;
+      times[0].tv_nsec = UTIME_NOW;
+      times[1].tv_sec = 0;
+      times[1].tv_nsec = UTIME_OMIT;
+      futimens(fd, times);
+   }
+
+   ralloc_free(filename);
+   close(fd);
+
+   if (size)
+      *size = sb.st_size;
+
+   return data;
+
+ fail:
+   if (data)
+      free(data);
+   if (filename)
+      ralloc_free(filename);
+   if (fd != -1)
+      close(fd);
+
+   return NULL;
+}
+
+void
+disk_cache_put_key(struct disk_cache *cache, const cache_key key)
+{
+   uint32_t *key_chunk = (uint32_t *) key;
+   int i = *key_chunk & CACHE_INDEX_KEY_MASK;
+   unsigned char *entry;
+
+   entry = &cache->stored_keys[i * CACHE_KEY_SIZE];
+
+   memcpy(entry, key, CACHE_KEY_SIZE);
+}
+
+/* This function lets us test whether a given key was previously
+ * stored in the cache with disk_cache_put_key(). The implement is
+ * efficient by not using syscalls or hitting the disk. It's not
+ * race-free, but the races are benign. If we race with someone else
+ * calling disk_cache_put_key, then that's just an extra cache miss and an
+ * extra recompile.
+ */
+bool
+disk_cache_has_key(struct disk_cache *cache, const cache_key key)
+{
+   uint32_t *key_chunk = (uint32_t *) key;
+   int i = *key_chunk & CACHE_INDEX_KEY_MASK;
+   unsigned char *entry;
+
+   entry = &cache->stored_keys[i * CACHE_KEY_SIZE];
+
+   return memcmp(entry, key, CACHE_KEY_SIZE) == 0;
+}
+
+#endif /* ENABLE_SHADER_CACHE */
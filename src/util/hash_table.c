@@ -127,15 +127,16 @@ _mesa_hash_table_create(void *mem_ctx,
    ht->max_entries = hash_sizes[ht->size_index].max_entries;
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(ht, struct hash_entry, ht->size);
    ht->entries = 0;
    ht->deleted_entries = 0;
    ht->deleted_key = &deleted_key_value;
 
-   if (ht->table == NULL) {
-      ralloc_free(ht);
-      return NULL;
-   }
+   /* Small tables live in the storage at the end of the struct until they
+    * grow, rather than in a second allocation.
+    */
+   assert(ht->size == HASH_TABLE_INLINE_SIZE);
+   ht->table = ht->inline_table;
+   memset(ht->inline_table, 0, sizeof(ht->inline_table));
 
    return ht;
 }
@@ -210,23 +211,22 @@ hash_table_search(struct hash_table *ht, uint32_t hash, const void *key)
 {
    uint32_t start_hash_address = hash % ht->size;
    uint32_t hash_address = start_hash_address;
+   uint32_t double_hash = 1 + hash % ht->rehash;
 
    do {
-      uint32_t double_hash;
-
       struct hash_entry *entry = ht->table + hash_address;
 
       if (entry_is_free(entry)) {
          return NULL;
-      } else if (entry_is_present(ht, entry) && entry->hash == hash) {
+      } else if (entry->hash == hash && entry_is_present(ht, entry)) {
          if (ht->key_equals_function(key, entry->key)) {
             return entry;
          }
       }
 
-      double_hash = 1 + hash % ht->rehash;
-
-      hash_address = (hash_address + double_hash) % ht->size;
+      hash_address += double_hash;
+      if (hash_address >= ht->size)
+         hash_address -= ht->size;
    } while (hash_address != start_hash_address);
 
    return NULL;
@@ -285,14 +285,15 @@ _mesa_hash_table_rehash(struct hash_table *ht, unsigned new_size_index)
       hash_table_insert(ht, entry->hash, entry->key, entry->data);
    }
 
-   ralloc_free(old_ht.table);
+   if (old_ht.table != ht->inline_table)
+      ralloc_free(old_ht.table);
 }
 
 static struct hash_entry *
 hash_table_insert(struct hash_table *ht, uint32_t hash,
                   const void *key, void *data)
 {
-   uint32_t start_hash_address, hash_address;
+   uint32_t start_hash_address, hash_address, double_hash;
    struct hash_entry *available_entry = NULL;
 
    if (ht->entries >= ht->max_entries) {
@@ -303,9 +304,9 @@ hash_table_insert(struct hash_table *ht, uint32_t hash,
 
    start_hash_address = hash % ht->size;
    hash_address = start_hash_address;
+   double_hash = 1 + hash % ht->rehash;
    do {
       struct hash_entry *entry = ht->table + hash_address;
-      uint32_t double_hash;
 
       if (!entry_is_present(ht, entry)) {
          /* Stash the first available entry we find */
@@ -334,10 +335,9 @@ hash_table_insert(struct hash_table *ht, uint32_t hash,
          return entry;
       }
 
-
-      double_hash = 1 + hash % ht->rehash;
-
-      hash_address = (hash_address + double_hash) % ht->size;
+      hash_address += double_hash;
+      if (hash_address >= ht->size)
+         hash_address -= ht->size;
    } while (hash_address != start_hash_address);
 
    if (available_entry) {
@@ -395,6 +395,59 @@ _mesa_hash_table_remove(struct hash_table *ht,
    ht->deleted_entries++;
 }
 
+/**
+ * Returns the number of slots probed to find the present entry at index i.
+ */
+static uint32_t
+hash_table_probe_length(const struct hash_table *ht, uint32_t i)
+{
+   uint32_t hash = ht->table[i].hash;
+   uint32_t hash_address = hash % ht->size;
+   uint32_t double_hash = 1 + hash % ht->rehash;
+   uint32_t length = 1;
+
+   while (hash_address != i) {
+      hash_address += double_hash;
+      if (hash_address >= ht->size)
+         hash_address -= ht->size;
+      length++;
+   }
+
+   return length;
+}
+
+/**
+ * Fills in the occupancy and probe length statistics of the table.
+ *
+ * This walks the whole table, so it is meant for debugging the hash
+ * functions of the callers rather than for use at runtime.
+ */
+void
+_mesa_hash_table_get_stats(const struct hash_table *ht,
+                           struct hash_table_stats *stats)
+{
+   uint32_t i;
+
+   stats->size = ht->size;
+   stats->entries = ht->entries;
+   stats->deleted_entries = ht->deleted_entries;
+   stats->max_probe_length = 0;
+   stats->total_probe_length = 0;
+
+   for (i = 0; i < ht->size; i++) {
+      const struct hash_entry *entry = ht->table + i;
+      uint32_t length;
+
+      if (entry->key == NULL || entry->key == ht->deleted_key)
+         continue;
+
+      length = hash_table_probe_length(ht, i);
+      stats->total_probe_length += length;
+      if (length > stats->max_probe_length)
+         stats->max_probe_length = length;
+   }
+}
+
 /**
  * This function is an iterator over the hash table.
  *
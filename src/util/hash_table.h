@@ -44,6 +44,13 @@ struct hash_entry {
    void *data;
 };
 
+/**
+ * Number of entries in the storage embedded in struct hash_table, which is
+ * used until the table first grows.  This matches the smallest table size,
+ * so that tables holding only a couple of entries need a single allocation.
+ */
+#define HASH_TABLE_INLINE_SIZE 5
+
 struct hash_table {
    struct hash_entry *table;
    uint32_t (*key_hash_function)(const void *key);
@@ -55,6 +62,20 @@ struct hash_table {
    uint32_t size_index;
    uint32_t entries;
    uint32_t deleted_entries;
+   struct hash_entry inline_table[HASH_TABLE_INLINE_SIZE];
+};
+
+/**
+ * Occupancy and probe sequence lengths of a table, as returned by
+ * _mesa_hash_table_get_stats() and _mesa_set_get_stats().  A probe length of
+ * 1 means the entry was found in its first slot.
+ */
+struct hash_table_stats {
+   uint32_t size;
+   uint32_t entries;
+   uint32_t deleted_entries;
+   uint32_t max_probe_length;
+   uint64_t total_probe_length;
 };
 
 struct hash_table *
@@ -87,6 +108,9 @@ _mesa_hash_table_search_pre_hashed(struct hash_table *ht, uint32_t hash,
 void _mesa_hash_table_remove(struct hash_table *ht,
                              struct hash_entry *entry);
 
+void _mesa_hash_table_get_stats(const struct hash_table *ht,
+                                struct hash_table_stats *stats);
+
 struct hash_entry *_mesa_hash_table_next_entry(struct hash_table *ht,
                                                struct hash_entry *entry);
 struct hash_entry *
@@ -515,3 +515,92 @@ ralloc_vasprintf_rewrite_tail(char **str, size_t *start, const char *fmt,
    *start += new_length;
    return true;
 }
+
+/*
+ * Linear allocator
+ *
+ * The context is an ordinary ralloc allocation, and so are the blocks,
+ * which hang off the context.  Freeing the context frees all of them.
+ */
+
+#define LINEAR_BLOCK_SIZE (32 * 1024)
+#define LINEAR_ALIGNMENT 8
+
+/* Allocations at least this large get a block of their own rather than
+ * wasting the rest of the current one.
+ */
+#define LINEAR_LARGE_ALLOC (LINEAR_BLOCK_SIZE / 4)
+
+struct linear_ctx
+{
+   char *next;
+   char *end;
+};
+
+linear_ctx *
+linear_context(void *ralloc_ctx)
+{
+   return rzalloc(ralloc_ctx, linear_ctx);
+}
+
+void *
+linear_alloc(linear_ctx *ctx, size_t size)
+{
+   char *ptr;
+
+   size = (size + LINEAR_ALIGNMENT - 1) & ~(size_t) (LINEAR_ALIGNMENT - 1);
+
+   if (unlikely(size > (size_t) (ctx->end - ctx->next))) {
+      char *block;
+
+      if (size >= LINEAR_LARGE_ALLOC)
+         return ralloc_size(ctx, size);
+
+      block = ralloc_size(ctx, LINEAR_BLOCK_SIZE);
+      if (unlikely(block == NULL))
+         return NULL;
+
+      ctx->next = block;
+      ctx->end = block + LINEAR_BLOCK_SIZE;
+   }
+
+   ptr = ctx->next;
+   ctx->next += size;
+   return ptr;
+}
+
+void *
+linear_zalloc(linear_ctx *ctx, size_t size)
+{
+   void *ptr = linear_alloc(ctx, size);
+
+   if (likely(ptr != NULL))
+      memset(ptr, 0, size);
+
+   return ptr;
+}
+
+char *
+linear_strdup(linear_ctx *ctx, const char *str)
+{
+   size_t n;
+   char *ptr;
+
+   if (unlikely(str == NULL))
+      return NULL;
+
+   n = strlen(str);
+   ptr = linear_alloc(ctx, n + 1);
+   if (unlikely(ptr == NULL))
+      return NULL;
+
+   memcpy(ptr, str, n);
+   ptr[n] = '\0';
+   return ptr;
+}
+
+void
+linear_free(linear_ctx *ctx)
+{
+   ralloc_free(ctx);
+}
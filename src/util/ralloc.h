@@ -407,6 +407,46 @@ bool ralloc_asprintf_append (char **str, const char *fmt, ...)
 bool ralloc_vasprintf_append(char **str, const char *fmt, va_list args);
 /// @}
 
+/**
+ * \name Linear allocator
+ *
+ * A linear context hands out memory by bumping a pointer through large
+ * blocks.  Allocations carry no header and can't be freed, resized,
+ * stolen or used as ralloc contexts; everything is released at once when
+ * the linear context, or the ralloc context it hangs off, is freed.
+ *
+ * This suits large numbers of small objects which all share a lifetime,
+ * such as the AST of a shader.
+ */
+/// @{
+typedef struct linear_ctx linear_ctx;
+
+/**
+ * Create a linear context, owned by the ralloc context \p ralloc_ctx.
+ */
+linear_ctx *linear_context(void *ralloc_ctx);
+
+/**
+ * Allocate \p size bytes from \p ctx.  The memory is not initialized.
+ */
+void *linear_alloc(linear_ctx *ctx, size_t size) MALLOCLIKE;
+
+/**
+ * Allocate zero-initialized memory from \p ctx.
+ */
+void *linear_zalloc(linear_ctx *ctx, size_t size) MALLOCLIKE;
+
+/**
+ * Duplicate a string, allocating the copy from \p ctx.
+ */
+char *linear_strdup(linear_ctx *ctx, const char *str) MALLOCLIKE;
+
+/**
+ * Free a linear context and everything allocated from it.
+ */
+void linear_free(linear_ctx *ctx);
+/// @}
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
@@ -448,5 +488,29 @@ public:                                                                  \
       ralloc_free(p);                                                    \
    }
 
+/**
+ * Declare a C++ new operator which uses the linear allocator.
+ *
+ * Placing this macro in the body of a class makes it possible to do:
+ *
+ * TYPE *var = new(lin_ctx) TYPE(...);
+ *
+ * where lin_ctx is a linear_ctx.  Such objects must never be deleted, and
+ * their destructors never run, so they must not own any other memory.
+ */
+#define DECLARE_LINEAR_ALLOC_CXX_OPERATORS(TYPE)                         \
+public:                                                                  \
+   static void* operator new(size_t size, linear_ctx *lin_ctx)           \
+   {                                                                     \
+      void *p = linear_zalloc(lin_ctx, size);                            \
+      assert(p != NULL);                                                 \
+      return p;                                                          \
+   }                                                                     \
+                                                                         \
+   /* Only called if the constructor throws. */                          \
+   static void operator delete(void *p, linear_ctx *lin_ctx)             \
+   {                                                                     \
+   }
+
 
 #endif
@@ -125,11 +125,14 @@ struct ra_node {
    /** @{
     *
     * List of which nodes this node interferes with.  This should be
-    * symmetric with the other node.
+    * symmetric with the other node.  The node itself is in the bitset but
+    * not in the list.
+    *
+    * The lists are built in one go by ra_build_adjacency_lists() once the
+    * graph is complete, and point into ra_graph::adjacency_lists.
     */
    BITSET_WORD *adjacency;
    unsigned int *adjacency_list;
-   unsigned int adjacency_list_size;
    unsigned int adjacency_count;
    /** @} */
 
@@ -166,6 +169,18 @@ struct ra_graph {
    struct ra_node *nodes;
    unsigned int count; /**< count of nodes. */
 
+   /**
+    * Interferences in the order they were added, as pairs of nodes.  This
+    * is all that ra_add_node_interference() has to touch besides the
+    * bitsets; the adjacency lists are laid out from it when needed.
+    */
+   unsigned int *edges;
+   unsigned int edge_count;
+   unsigned int edge_array_size;
+
+   /** Storage for all of the nodes' adjacency lists, or NULL if stale */
+   unsigned int *adjacency_lists;
+
    unsigned int *stack;
    unsigned int stack_count;
 
@@ -390,24 +405,11 @@ ra_set_finalize(struct ra_regs *regs, unsigned int **q_values)
 static void
 ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 {
-   BITSET_SET(g->nodes[n1].adjacency, n2);
-
-   if (n1 != n2) {
-      int n1_class = g->nodes[n1].class;
-      int n2_class = g->nodes[n2].class;
-      g->nodes[n1].q_total += g->regs->classes[n1_class]->q[n2_class];
-   }
+   int n1_class = g->nodes[n1].class;
+   int n2_class = g->nodes[n2].class;
 
-   if (g->nodes[n1].adjacency_count >=
-       g->nodes[n1].adjacency_list_size) {
-      g->nodes[n1].adjacency_list_size *= 2;
-      g->nodes[n1].adjacency_list = reralloc(g, g->nodes[n1].adjacency_list,
-                                             unsigned int,
-                                             g->nodes[n1].adjacency_list_size);
-   }
-
-   g->nodes[n1].adjacency_list[g->nodes[n1].adjacency_count] = n2;
-   g->nodes[n1].adjacency_count++;
+   BITSET_SET(g->nodes[n1].adjacency, n2);
+   g->nodes[n1].q_total += g->regs->classes[n1_class]->q[n2_class];
 }
 
 struct ra_graph *
@@ -415,6 +417,8 @@ ra_alloc_interference_graph(struct ra_regs *regs, unsigned int count)
 {
    struct ra_graph *g;
    unsigned int i;
+   unsigned int bitset_count = BITSET_WORDS(count);
+   BITSET_WORD *adjacency;
 
    g = rzalloc(NULL, struct ra_graph);
    g->regs = regs;
@@ -423,23 +427,59 @@ ra_alloc_interference_graph(struct ra_regs *regs, unsigned int count)
 
    g->stack = rzalloc_array(g, unsigned int, count);
 
-   for (i = 0; i < count; i++) {
-      int bitset_count = BITSET_WORDS(count);
-      g->nodes[i].adjacency = rzalloc_array(g, BITSET_WORD, bitset_count);
+   g->edge_array_size = MAX2(count * 2, 16);
+   g->edges = ralloc_array(g, unsigned int, g->edge_array_size);
 
-      g->nodes[i].adjacency_list_size = 4;
-      g->nodes[i].adjacency_list =
-         ralloc_array(g, unsigned int, g->nodes[i].adjacency_list_size);
-      g->nodes[i].adjacency_count = 0;
-      g->nodes[i].q_total = 0;
+   /* One allocation for the whole adjacency matrix rather than a row at a
+    * time.
+    */
+   adjacency = rzalloc_array(g, BITSET_WORD, count * bitset_count);
 
-      ra_add_node_adjacency(g, i, i);
+   for (i = 0; i < count; i++) {
+      g->nodes[i].adjacency = adjacency + i * bitset_count;
+      BITSET_SET(g->nodes[i].adjacency, i);
+      g->nodes[i].q_total = 0;
       g->nodes[i].reg = NO_REG;
    }
 
    return g;
 }
 
+/**
+ * Lays out the adjacency lists of all nodes in a single array, in the
+ * order the interferences were added.
+ */
+static void
+ra_build_adjacency_lists(struct ra_graph *g)
+{
+   unsigned int i, offset = 0;
+
+   if (g->adjacency_lists)
+      return;
+
+   for (i = 0; i < g->count; i++)
+      g->nodes[i].adjacency_count = 0;
+
+   for (i = 0; i < g->edge_count; i++)
+      g->nodes[g->edges[i]].adjacency_count++;
+
+   g->adjacency_lists = ralloc_array(g, unsigned int, MAX2(g->edge_count, 1));
+
+   for (i = 0; i < g->count; i++) {
+      g->nodes[i].adjacency_list = g->adjacency_lists + offset;
+      offset += g->nodes[i].adjacency_count;
+      g->nodes[i].adjacency_count = 0;
+   }
+
+   for (i = 0; i < g->edge_count; i += 2) {
+      unsigned int n1 = g->edges[i], n2 = g->edges[i + 1];
+      struct ra_node *node1 = &g->nodes[n1], *node2 = &g->nodes[n2];
+
+      node1->adjacency_list[node1->adjacency_count++] = n2;
+      node2->adjacency_list[node2->adjacency_count++] = n1;
+   }
+}
+
 void
 ra_set_node_class(struct ra_graph *g,
                   unsigned int n, unsigned int class)
@@ -454,6 +494,18 @@ ra_add_node_interference(struct ra_graph *g,
    if (!BITSET_TEST(g->nodes[n1].adjacency, n2)) {
       ra_add_node_adjacency(g, n1, n2);
       ra_add_node_adjacency(g, n2, n1);
+
+      if (g->edge_count + 2 > g->edge_array_size) {
+         g->edge_array_size *= 2;
+         g->edges = reralloc(g, g->edges, unsigned int, g->edge_array_size);
+      }
+      g->edges[g->edge_count++] = n1;
+      g->edges[g->edge_count++] = n2;
+
+      if (g->adjacency_lists) {
+         ralloc_free(g->adjacency_lists);
+         g->adjacency_lists = NULL;
+      }
    }
 }
 
@@ -475,13 +527,23 @@ decrement_q(struct ra_graph *g, unsigned int n)
       unsigned int n2 = g->nodes[n].adjacency_list[i];
       unsigned int n2_class = g->nodes[n2].class;
 
-      if (n != n2 && !g->nodes[n2].in_stack) {
+      if (!g->nodes[n2].in_stack) {
          assert(g->nodes[n2].q_total >= g->regs->classes[n2_class]->q[n_class]);
          g->nodes[n2].q_total -= g->regs->classes[n2_class]->q[n_class];
       }
    }
 }
 
+static void
+ra_push_node(struct ra_graph *g, unsigned int n, BITSET_WORD *remaining)
+{
+   decrement_q(g, n);
+   g->stack[g->stack_count] = n;
+   g->stack_count++;
+   g->nodes[n].in_stack = true;
+   BITSET_CLEAR(remaining, n);
+}
+
 /**
  * Simplifies the interference graph by pushing all
  * trivially-colorable nodes into a stack of nodes to be colored,
@@ -491,13 +553,26 @@ decrement_q(struct ra_graph *g, unsigned int n)
  * we optimistically choose a node and push it on the stack. We heuristically
  * push the node with the lowest total q value, since it has the fewest
  * neighbors and therefore is most likely to be allocated.
+ *
+ * Every round walks the nodes from the highest number down, but a bitset
+ * of the nodes still in the graph lets us skip over the ones that are
+ * already on the stack (or precolored) a word at a time, so later rounds
+ * only cost as much as what's left of the graph.
  */
 static void
 ra_simplify(struct ra_graph *g)
 {
    bool progress = true;
    unsigned int stack_optimistic_start = UINT_MAX;
-   int i;
+   unsigned int bitset_count = BITSET_WORDS(g->count);
+   BITSET_WORD *remaining = rzalloc_array(g, BITSET_WORD, bitset_count);
+   unsigned int i;
+   int w;
+
+   for (i = 0; i < g->count; i++) {
+      if (!g->nodes[i].in_stack && g->nodes[i].reg == NO_REG)
+         BITSET_SET(remaining, i);
+   }
 
    while (progress) {
       unsigned int best_optimistic_node = ~0;
@@ -505,38 +580,43 @@ ra_simplify(struct ra_graph *g)
 
       progress = false;
 
-      for (i = g->count - 1; i >= 0; i--) {
-	 if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
-	    continue;
-
-	 if (pq_test(g, i)) {
-	    decrement_q(g, i);
-	    g->stack[g->stack_count] = i;
-	    g->stack_count++;
-	    g->nodes[i].in_stack = true;
-	    progress = true;
-	 } else {
-	    unsigned int new_q_total = g->nodes[i].q_total;
-	    if (new_q_total < lowest_q_total) {
-	       best_optimistic_node = i;
-	       lowest_q_total = new_q_total;
-	    }
-	 }
+      for (w = bitset_count - 1; w >= 0; w--) {
+         int first = w * (int) BITSET_WORDBITS;
+         int n;
+
+         if (remaining[w] == 0)
+            continue;
+
+         for (n = MIN2((int) g->count, first + (int) BITSET_WORDBITS) - 1;
+              n >= first; n--) {
+            if (!BITSET_TEST(remaining, n))
+               continue;
+
+            if (pq_test(g, n)) {
+               ra_push_node(g, n, remaining);
+               progress = true;
+            } else {
+               unsigned int new_q_total = g->nodes[n].q_total;
+               if (new_q_total < lowest_q_total) {
+                  best_optimistic_node = n;
+                  lowest_q_total = new_q_total;
+               }
+            }
+         }
       }
 
       if (!progress && best_optimistic_node != ~0U) {
          if (stack_optimistic_start == UINT_MAX)
             stack_optimistic_start = g->stack_count;
 
-	 decrement_q(g, best_optimistic_node);
-	 g->stack[g->stack_count] = best_optimistic_node;
-	 g->stack_count++;
-	 g->nodes[best_optimistic_node].in_stack = true;
-	 progress = true;
+         ra_push_node(g, best_optimistic_node, remaining);
+         progress = true;
       }
    }
 
    g->stack_optimistic_start = stack_optimistic_start;
+
+   ralloc_free(remaining);
 }
 
 /**
@@ -610,6 +690,7 @@ ra_select(struct ra_graph *g)
 bool
 ra_allocate(struct ra_graph *g)
 {
+   ra_build_adjacency_lists(g);
    ra_simplify(g);
    return ra_select(g);
 }
@@ -654,11 +735,9 @@ ra_get_spill_benefit(struct ra_graph *g, unsigned int n)
     */
    for (j = 0; j < g->nodes[n].adjacency_count; j++) {
       unsigned int n2 = g->nodes[n].adjacency_list[j];
-      if (n != n2) {
-	 unsigned int n2_class = g->nodes[n2].class;
-	 benefit += ((float)g->regs->classes[n_class]->q[n2_class] /
-		     g->regs->classes[n_class]->p);
-      }
+      unsigned int n2_class = g->nodes[n2].class;
+      benefit += ((float)g->regs->classes[n_class]->q[n2_class] /
+                  g->regs->classes[n_class]->p);
    }
 
    return benefit;
@@ -675,6 +754,8 @@ ra_get_best_spill_node(struct ra_graph *g)
    float best_benefit = 0.0;
    unsigned int n;
 
+   ra_build_adjacency_lists(g);
+
    /* Consider any nodes that we colored successfully or the node we failed to
     * color for spilling. When we failed to color a node in ra_select(), we
     * only considered these nodes, so spilling any other ones would not result
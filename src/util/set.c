@@ -33,8 +33,10 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
+#include "hash_table.h"
 #include "macros.h"
 #include "ralloc.h"
 #include "set.h"
@@ -97,7 +99,7 @@ entry_is_deleted(struct set_entry *entry)
 }
 
 static int
-entry_is_present(struct set_entry *entry)
+entry_is_present(const struct set_entry *entry)
 {
    return entry->key != NULL && entry->key != deleted_key;
 }
@@ -120,14 +122,12 @@ _mesa_set_create(void *mem_ctx,
    ht->max_entries = hash_sizes[ht->size_index].max_entries;
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(ht, struct set_entry, ht->size);
    ht->entries = 0;
    ht->deleted_entries = 0;
 
-   if (ht->table == NULL) {
-      ralloc_free(ht);
-      return NULL;
-   }
+   assert(ht->size == SET_INLINE_SIZE);
+   ht->table = ht->inline_table;
+   memset(ht->inline_table, 0, sizeof(ht->inline_table));
 
    return ht;
 }
@@ -151,10 +151,39 @@ _mesa_set_destroy(struct set *ht, void (*delete_function)(struct set_entry *entr
          delete_function(entry);
       }
    }
-   ralloc_free(ht->table);
+   if (ht->table != ht->inline_table)
+      ralloc_free(ht->table);
    ralloc_free(ht);
 }
 
+/**
+ * Deletes all entries of the given set without deleting the set itself or
+ * changing its structure.
+ *
+ * If delete_function is passed, it gets called on each entry present.
+ */
+void
+_mesa_set_clear(struct set *set, void (*delete_function)(struct set_entry *entry))
+{
+   struct set_entry *entry;
+
+   if (set->entries == 0 && set->deleted_entries == 0)
+      return;
+
+   for (entry = set->table; entry != set->table + set->size; entry++) {
+      if (entry->key == NULL)
+         continue;
+
+      if (delete_function != NULL && entry_is_present(entry))
+         delete_function(entry);
+
+      entry->key = NULL;
+   }
+
+   set->entries = 0;
+   set->deleted_entries = 0;
+}
+
 /**
  * Finds a set entry with the given key and hash of that key.
  *
@@ -163,26 +192,25 @@ _mesa_set_destroy(struct set *ht, void (*delete_function)(struct set_entry *entr
 static struct set_entry *
 set_search(const struct set *ht, uint32_t hash, const void *key)
 {
-   uint32_t hash_address;
+   uint32_t start_hash_address = hash % ht->size;
+   uint32_t hash_address = start_hash_address;
+   uint32_t double_hash = 1 + hash % ht->rehash;
 
-   hash_address = hash % ht->size;
    do {
-      uint32_t double_hash;
-
       struct set_entry *entry = ht->table + hash_address;
 
       if (entry_is_free(entry)) {
          return NULL;
-      } else if (entry_is_present(entry) && entry->hash == hash) {
+      } else if (entry->hash == hash && entry_is_present(entry)) {
          if (ht->key_equals_function(key, entry->key)) {
             return entry;
          }
       }
 
-      double_hash = 1 + hash % ht->rehash;
-
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != hash % ht->size);
+      hash_address += double_hash;
+      if (hash_address >= ht->size)
+         hash_address -= ht->size;
+   } while (hash_address != start_hash_address);
 
    return NULL;
 }
@@ -238,7 +266,8 @@ set_rehash(struct set *ht, unsigned new_size_index)
       }
    }
 
-   ralloc_free(old_ht.table);
+   if (old_ht.table != ht->inline_table)
+      ralloc_free(old_ht.table);
 }
 
 /**
@@ -250,7 +279,7 @@ set_rehash(struct set *ht, unsigned new_size_index)
 static struct set_entry *
 set_add(struct set *ht, uint32_t hash, const void *key)
 {
-   uint32_t hash_address;
+   uint32_t start_hash_address, hash_address, double_hash;
    struct set_entry *available_entry = NULL;
 
    if (ht->entries >= ht->max_entries) {
@@ -259,10 +288,11 @@ set_add(struct set *ht, uint32_t hash, const void *key)
       set_rehash(ht, ht->size_index);
    }
 
-   hash_address = hash % ht->size;
+   start_hash_address = hash % ht->size;
+   hash_address = start_hash_address;
+   double_hash = 1 + hash % ht->rehash;
    do {
       struct set_entry *entry = ht->table + hash_address;
-      uint32_t double_hash;
 
       if (!entry_is_present(entry)) {
          /* Stash the first available entry we find */
@@ -289,10 +319,10 @@ set_add(struct set *ht, uint32_t hash, const void *key)
          return entry;
       }
 
-      double_hash = 1 + hash % ht->rehash;
-
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != hash % ht->size);
+      hash_address += double_hash;
+      if (hash_address >= ht->size)
+         hash_address -= ht->size;
+   } while (hash_address != start_hash_address);
 
    if (available_entry) {
       if (entry_is_deleted(available_entry))
@@ -341,6 +371,55 @@ _mesa_set_remove(struct set *ht, struct set_entry *entry)
    ht->deleted_entries++;
 }
 
+/**
+ * Returns the number of slots probed to find the present entry at index i.
+ */
+static uint32_t
+set_probe_length(const struct set *ht, uint32_t i)
+{
+   uint32_t hash = ht->table[i].hash;
+   uint32_t hash_address = hash % ht->size;
+   uint32_t double_hash = 1 + hash % ht->rehash;
+   uint32_t length = 1;
+
+   while (hash_address != i) {
+      hash_address += double_hash;
+      if (hash_address >= ht->size)
+         hash_address -= ht->size;
+      length++;
+   }
+
+   return length;
+}
+
+/**
+ * Fills in the occupancy and probe length statistics of the set, see
+ * _mesa_hash_table_get_stats().
+ */
+void
+_mesa_set_get_stats(const struct set *ht, struct hash_table_stats *stats)
+{
+   uint32_t i;
+
+   stats->size = ht->size;
+   stats->entries = ht->entries;
+   stats->deleted_entries = ht->deleted_entries;
+   stats->max_probe_length = 0;
+   stats->total_probe_length = 0;
+
+   for (i = 0; i < ht->size; i++) {
+      uint32_t length;
+
+      if (!entry_is_present(ht->table + i))
+         continue;
+
+      length = set_probe_length(ht, i);
+      stats->total_probe_length += length;
+      if (length > stats->max_probe_length)
+         stats->max_probe_length = length;
+   }
+}
+
 /**
  * This function is an iterator over the hash table.
  *
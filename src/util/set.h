@@ -40,6 +40,9 @@ struct set_entry {
    const void *key;
 };
 
+/** See HASH_TABLE_INLINE_SIZE. */
+#define SET_INLINE_SIZE 5
+
 struct set {
    void *mem_ctx;
    struct set_entry *table;
@@ -51,8 +54,11 @@ struct set {
    uint32_t size_index;
    uint32_t entries;
    uint32_t deleted_entries;
+   struct set_entry inline_table[SET_INLINE_SIZE];
 };
 
+struct hash_table_stats;
+
 struct set *
 _mesa_set_create(void *mem_ctx,
                  uint32_t (*key_hash_function)(const void *key),
@@ -61,6 +67,9 @@ _mesa_set_create(void *mem_ctx,
 void
 _mesa_set_destroy(struct set *set,
                   void (*delete_function)(struct set_entry *entry));
+void
+_mesa_set_clear(struct set *set,
+                void (*delete_function)(struct set_entry *entry));
 
 struct set_entry *
 _mesa_set_add(struct set *set, const void *key);
@@ -76,6 +85,9 @@ _mesa_set_search_pre_hashed(const struct set *set, uint32_t hash,
 void
 _mesa_set_remove(struct set *set, struct set_entry *entry);
 
+void
+_mesa_set_get_stats(const struct set *set, struct hash_table_stats *stats);
+
 struct set_entry *
 _mesa_set_next_entry(const struct set *set, struct set_entry *entry);
 